@@ -14,6 +14,14 @@
   * - Rolled up loops in [Inv]ShiftRows() and [Inv]MixSubColumns()
   * - Combined ShiftRows() and InvShiftRows() into one function
   *
+  * On 32 bit platforms, define AES_32BIT to use alternative versions of
+  * aesEncrypt() and aesDecrypt() which hold each column of the state in
+  * a 32 bit word and do MixColumns/InvMixColumns on all 4 bytes of a column
+  * at once. The only table lookups are into the same S-boxes as the
+  * byte-oriented version. Large "T-tables" are not used, because they would
+  * need 8K of program memory (too much for the LPC11Uxx) and have a much
+  * larger cache footprint.
+  *
   * This file is licensed as described by the file LICENCE.
   */
 
@@ -24,6 +32,11 @@
 #include "test_helpers.h"
 #endif // #ifdef TEST_AES
 
+#ifdef BENCH_AES
+#include <stdlib.h>
+#include "test_helpers.h"
+#endif // #ifdef BENCH_AES
+
 #include "common.h"
 #include "aes.h"
 
@@ -65,6 +78,98 @@ static const uint8_t inv_sbox[256] PROGMEM = {
 0xa0, 0xe0, 0x3b, 0x4d, 0xae, 0x2a, 0xf5, 0xb0, 0xc8, 0xeb, 0xbb, 0x3c, 0x83, 0x53, 0x99, 0x61,
 0x17, 0x2b, 0x04, 0x7e, 0xba, 0x77, 0xd6, 0x26, 0xe1, 0x69, 0x14, 0x63, 0x55, 0x21, 0x0c, 0x7d};
 
+#ifdef AES_32BIT
+
+/** Load 4 bytes as a little-endian 32 bit word. Each word holds one column
+  * of the AES state, with row 0 in the least-significant byte. */
+#define LOAD_COLUMN(p)		((uint32_t)(p)[0] | ((uint32_t)(p)[1] << 8) \
+							| ((uint32_t)(p)[2] << 16) | ((uint32_t)(p)[3] << 24))
+/** Rotate a column right by n bits, so that row (i + n / 8) ends up in
+  * row i. */
+#define ROTR_COLUMN(x, n)	(((x) >> (n)) | ((x) << (32 - (n))))
+
+/** Store a column (see #LOAD_COLUMN) as 4 bytes.
+  * \param out Byte array with space for 4 bytes.
+  * \param x The column to store.
+  */
+static void storeColumn(uint8_t *out, uint32_t x)
+{
+	out[0] = (uint8_t)x;
+	out[1] = (uint8_t)(x >> 8);
+	out[2] = (uint8_t)(x >> 16);
+	out[3] = (uint8_t)(x >> 24);
+}
+
+/** Multiply each of the 4 bytes in x by 2 under the field GF(2 ^ 8) with
+  * the reducing polynomial x ^ 8 + x ^ 4 + x ^ 3 + x + 1. Like
+  * xTimes2InGF(), this doesn't branch on x. It also avoids a multiplication,
+  * since not every core has a constant-time multiplier. */
+static uint32_t xTimes2InGFPacked(uint32_t x)
+{
+	uint32_t high_bits;
+
+	high_bits = (x >> 7) & 0x01010101;
+	// 0x1b = (1 << 4) | (1 << 3) | (1 << 1) | 1
+	return ((x & 0x7f7f7f7f) << 1) ^ (high_bits << 4) ^ (high_bits << 3) ^ (high_bits << 1) ^ high_bits;
+}
+
+/** Apply MixColumns to one column. Each output row is
+  * 2 * a[i] + 3 * a[i + 1] + a[i + 2] + a[i + 3]. */
+static uint32_t mixColumn(uint32_t x)
+{
+	uint32_t r;
+
+	r = ROTR_COLUMN(x, 8);
+	return xTimes2InGFPacked(x ^ r) ^ r ^ ROTR_COLUMN(x, 16) ^ ROTR_COLUMN(x, 24);
+}
+
+/** Apply InvMixColumns to one column. This uses the fact that the
+  * InvMixColumns polynomial is the MixColumns polynomial multiplied by
+  * 4 * x ^ 2 + 5, so that only doublings are needed. */
+static uint32_t invMixColumn(uint32_t x)
+{
+	x ^= xTimes2InGFPacked(xTimes2InGFPacked(x ^ ROTR_COLUMN(x, 16)));
+	return mixColumn(x);
+}
+
+/** Combined SubBytes and ShiftRows, operating on columns. Row r of output
+  * column c comes from input column c + r.
+  * \param out The 4 output columns.
+  * \param in The 4 input columns. This must not overlap out.
+  */
+static void subShiftColumns(uint32_t *out, const uint32_t *in)
+{
+	uint8_t c;
+
+	for (c = 0; c < 4; c++)
+	{
+		out[c] = (uint32_t)LOOKUP_BYTE(sbox[in[c] & 0xff])
+			| ((uint32_t)LOOKUP_BYTE(sbox[(in[(c + 1) & 3] >> 8) & 0xff]) << 8)
+			| ((uint32_t)LOOKUP_BYTE(sbox[(in[(c + 2) & 3] >> 16) & 0xff]) << 16)
+			| ((uint32_t)LOOKUP_BYTE(sbox[in[(c + 3) & 3] >> 24]) << 24);
+	}
+}
+
+/** Combined InvSubBytes and InvShiftRows, operating on columns. Row r of
+  * output column c comes from input column c - r.
+  * \param out The 4 output columns.
+  * \param in The 4 input columns. This must not overlap out.
+  */
+static void invSubShiftColumns(uint32_t *out, const uint32_t *in)
+{
+	uint8_t c;
+
+	for (c = 0; c < 4; c++)
+	{
+		out[c] = (uint32_t)LOOKUP_BYTE(inv_sbox[in[c] & 0xff])
+			| ((uint32_t)LOOKUP_BYTE(inv_sbox[(in[(c + 3) & 3] >> 8) & 0xff]) << 8)
+			| ((uint32_t)LOOKUP_BYTE(inv_sbox[(in[(c + 2) & 3] >> 16) & 0xff]) << 16)
+			| ((uint32_t)LOOKUP_BYTE(inv_sbox[in[(c + 1) & 3] >> 24]) << 24);
+	}
+}
+
+#else
+
 /** Multiply x by 2 under the field GF(2 ^ 8) with the reducing polynomial
   * x ^ 8 + x ^ 4 + x ^ 3 + x + 1. */
 static uint8_t xTimes2InGF(uint8_t x)
@@ -239,6 +344,8 @@ static void invMixSubColumns(uint8_t *state)
 	}
 }
 
+#endif // #ifdef AES_32BIT
+
 /** XOR (r = r XOR op1) 16 bytes with another 16 bytes.
   * \param r One operand for the XOR operation. The result will also be
   *          written here.
@@ -295,6 +402,8 @@ void aesExpandKey(uint8_t *expanded_key, uint8_t *key)
 	}
 }
 
+#ifdef AES_32BIT
+
 /** Encrypt one 128 bit block.
   * \param out The resulting ciphertext will be placed here. This should be a
   *            16 byte array.
@@ -302,7 +411,89 @@ void aesExpandKey(uint8_t *expanded_key, uint8_t *key)
   * \param expanded_key Should point to an array containing the expanded
   *                     key (see aesExpandKey()).
   */
-void aesEncrypt(uint8_t *out, uint8_t *in, uint8_t *expanded_key)
+HOT_FUNCTION void aesEncrypt(uint8_t *out, uint8_t *in, uint8_t *expanded_key)
+{
+	uint32_t state[4];
+	uint32_t tmp[4];
+	uint8_t round;
+	uint8_t c;
+
+	for (c = 0; c < 4; c++)
+	{
+		state[c] = LOAD_COLUMN(&(in[c * 4])) ^ LOAD_COLUMN(&(expanded_key[c * 4]));
+	}
+
+	for (round = 1; round < 11; round++)
+	{
+		subShiftColumns(tmp, state);
+		for (c = 0; c < 4; c++)
+		{
+			if (round < 10)
+			{
+				tmp[c] = mixColumn(tmp[c]);
+			}
+			state[c] = tmp[c] ^ LOAD_COLUMN(&(expanded_key[round * 16 + c * 4]));
+		}
+	}
+
+	for (c = 0; c < 4; c++)
+	{
+		storeColumn(&(out[c * 4]), state[c]);
+	}
+}
+
+/** Decrypt one 128 bit block.
+  * \param out The resulting plaintext will be placed here. This should be a
+  *            16 byte array.
+  * \param in The ciphertext to decrypt. This should also be a 16 byte array.
+  * \param expanded_key Should point to an array containing the expanded
+  *                     key (see aesExpandKey()).
+  */
+HOT_FUNCTION void aesDecrypt(uint8_t *out, uint8_t *in, uint8_t *expanded_key)
+{
+	uint32_t state[4];
+	uint32_t tmp[4];
+	uint8_t round;
+	uint8_t c;
+
+	for (c = 0; c < 4; c++)
+	{
+		tmp[c] = LOAD_COLUMN(&(in[c * 4])) ^ LOAD_COLUMN(&(expanded_key[160 + c * 4]));
+	}
+	invSubShiftColumns(state, tmp);
+
+	for (round = 10; round--; )
+	{
+		for (c = 0; c < 4; c++)
+		{
+			tmp[c] = state[c] ^ LOAD_COLUMN(&(expanded_key[round * 16 + c * 4]));
+			if (round != 0)
+			{
+				tmp[c] = invMixColumn(tmp[c]);
+			}
+		}
+		if (round != 0)
+		{
+			invSubShiftColumns(state, tmp);
+		}
+	}
+
+	for (c = 0; c < 4; c++)
+	{
+		storeColumn(&(out[c * 4]), tmp[c]);
+	}
+}
+
+#else
+
+/** Encrypt one 128 bit block.
+  * \param out The resulting ciphertext will be placed here. This should be a
+  *            16 byte array.
+  * \param in The plaintext to encrypt. This should also be a 16 byte array.
+  * \param expanded_key Should point to an array containing the expanded
+  *                     key (see aesExpandKey()).
+  */
+HOT_FUNCTION void aesEncrypt(uint8_t *out, uint8_t *in, uint8_t *expanded_key)
 {
 	uint8_t round;
 
@@ -332,7 +523,7 @@ void aesEncrypt(uint8_t *out, uint8_t *in, uint8_t *expanded_key)
   * \param expanded_key Should point to an array containing the expanded
   *                     key (see aesExpandKey()).
   */
-void aesDecrypt(uint8_t *out, uint8_t *in, uint8_t *expanded_key)
+HOT_FUNCTION void aesDecrypt(uint8_t *out, uint8_t *in, uint8_t *expanded_key)
 {
 	uint8_t round;
 
@@ -351,6 +542,8 @@ void aesDecrypt(uint8_t *out, uint8_t *in, uint8_t *expanded_key)
 	}
 }
 
+#endif // #ifdef AES_32BIT
+
 #ifdef TEST_AES
 
 /** Run unit tests using test vectors from a file. The file is expected to be
@@ -517,3 +710,45 @@ int main(void)
 
 #endif // #ifdef TEST_AES
 
+#ifdef BENCH_AES
+
+/** Key for the AES benchmarks. */
+static uint8_t bench_key[32];
+/** Expanded version of #bench_key. */
+static uint8_t bench_expanded_key[EXPANDED_KEY_SIZE];
+/** Block to encrypt/decrypt. */
+static uint8_t bench_block[16];
+
+/** Expand a key. */
+static void benchAesExpandKey(void)
+{
+	uint8_t expanded_key[EXPANDED_KEY_SIZE];
+
+	aesExpandKey(expanded_key, bench_key);
+}
+
+/** Encrypt one block. */
+static void benchAesEncrypt(void)
+{
+	aesEncrypt(bench_block, bench_block, bench_expanded_key);
+}
+
+/** Decrypt one block. */
+static void benchAesDecrypt(void)
+{
+	aesDecrypt(bench_block, bench_block, bench_expanded_key);
+}
+
+int main(void)
+{
+	initBenchmarks(__FILE__);
+	fillWithRandom(bench_key, sizeof(bench_key));
+	fillWithRandom(bench_block, sizeof(bench_block));
+	aesExpandKey(bench_expanded_key, bench_key);
+	runHostBenchmark("aes_expand_key", &benchAesExpandKey, 0);
+	runHostBenchmark("aes_encrypt_16", &benchAesEncrypt, 16);
+	runHostBenchmark("aes_decrypt_16", &benchAesDecrypt, 16);
+	exit(0);
+}
+
+#endif // #ifdef BENCH_AES
@@ -14,6 +14,12 @@
   * Those pins can be connected to a charge pump circuit to generate the
   * required voltage.
   *
+  * Sampling happens in the background: the ADC conversion complete
+  * interrupt stores each sample in a ring buffer and starts the next
+  * conversion, until the buffer is full. hardwareRandom32Bytes() takes
+  * samples out of the buffer, so it only has to wait for conversions if
+  * the buffer has been drained (eg. by several calls in quick succession).
+  *
   * This file is licensed as described by the file LICENCE.
   */
 
@@ -24,14 +30,37 @@
 #include "../hwinterface.h"
 #include "hwinit.h"
 
+#ifndef ADC_BUFFER_SIZE
+/** Number of samples which the ring buffer can hold. This can be
+  * overridden by defining ADC_BUFFER_SIZE in the platform's build settings.
+  * \warning This must be a power of 2.
+  * \warning This must be >= 32 and must be <= 128.
+  */
+#define ADC_BUFFER_SIZE	64
+#endif // #ifndef ADC_BUFFER_SIZE
+
+/** Bitwise AND mask for ring buffer index. */
+#define ADC_BUFFER_MASK	(ADC_BUFFER_SIZE - 1)
+
+/** Storage for the ring buffer. Each entry is a sample, already folded down
+  * to 8 bits by the ADC conversion complete interrupt. */
+static volatile uint8_t adc_buffer[ADC_BUFFER_SIZE];
+/** Index in the ring buffer of the oldest sample. */
+static volatile uint8_t adc_buffer_start;
+/** Number of samples in the ring buffer. */
+static volatile uint8_t adc_buffer_count;
+/** Whether a conversion is in progress. If this is false, the ring buffer is
+  * full and the ADC is idle. */
+static volatile bool adc_running;
+
 /** Enable ADC with prescaler 128 (ADC clock 125 kHz), pointing at input ADC0.
   * On Arduino, that's analog in, pin 0. This also sets up the charge pump
-  * cycler.
+  * cycler and starts filling the ring buffer with samples.
   */
 void initAdc(void)
 {
 	ADMUX = _BV(REFS0);
-	ADCSRA = _BV(ADEN) |  _BV(ADPS2) |  _BV(ADPS1) |  _BV(ADPS0);
+	ADCSRA = _BV(ADEN) | _BV(ADIE) | _BV(ADPS2) |  _BV(ADPS1) |  _BV(ADPS0);
 	ADCSRB = 0;
 	PRR = (uint8_t)(PRR & ~_BV(PRADC));
 	DDRB |= 3; // set PB0 and PB1 to output
@@ -46,6 +75,10 @@ void initAdc(void)
 	TCNT2 = 0;
 	OCR2A = 9; // frequency = (16000000 / 32) / (9 + 1) = 50 kHz
 	TIMSK2 = _BV(OCIE2A); // enable interrupt on compare match A
+	adc_buffer_start = 0;
+	adc_buffer_count = 0;
+	adc_running = true;
+	ADCSRA |= _BV(ADSC);
 	sei();
 }
 
@@ -58,24 +91,35 @@ ISR(TIMER2_COMPA_vect)
 	PORTB = (uint8_t)(state ^ (_BV(PORTB0) | _BV(PORTB1)));
 }
 
-/** Get one 10 bit sample from the ADC. */
-static uint16_t adcSample(void)
+/** Store the sample from the conversion which just completed in the ring
+  * buffer and start the next conversion, unless the ring buffer is full. */
+ISR(ADC_vect)
 {
 	uint8_t sample_lo;
 	uint8_t sample_hi;
 
-	ADCSRA |= _BV(ADSC);
-	while (ADCSRA & _BV(ADSC))
-	{
-		// do nothing
-	}
 	sample_lo = ADCL;
 	sample_hi = ADCH;
-
-	return ((uint16_t)sample_hi << 8) | sample_lo; 
+	// Each sample is 10 bits. XOR the most-significant (MS) 2 bits into
+	// the least-significant (LS) 2 bits. As long as they are not
+	// significantly correlated, this shouldn't result in a decrease in
+	// total entropy. Since the MS 2 bits and LS 2 bits are a factor of
+	// 256 apart (in significance), this correlation should be minimal.
+	adc_buffer[(adc_buffer_start + adc_buffer_count) & ADC_BUFFER_MASK] = (uint8_t)(sample_lo ^ sample_hi);
+	adc_buffer_count++;
+	if (adc_buffer_count < ADC_BUFFER_SIZE)
+	{
+		ADCSRA |= _BV(ADSC);
+	}
+	else
+	{
+		adc_running = false;
+	}
 }
 
 /** Fill buffer with 32 random bytes from a hardware random number generator.
+  * This takes samples out of the ring buffer, so it returns immediately if
+  * at least 32 samples have been collected since the last call.
   * \param buffer The buffer to fill. This should have enough space for 32
   *               bytes.
   * \return An estimate of the total number of bits (not bytes) of entropy in
@@ -84,7 +128,6 @@ static uint16_t adcSample(void)
 int hardwareRandom32Bytes(uint8_t *buffer)
 {
 	uint8_t i;
-	uint16_t sample;
 	uint16_t entropy;
 
 	// Just assume each sample has 4 bits of entropy.
@@ -93,13 +136,30 @@ int hardwareRandom32Bytes(uint8_t *buffer)
 	entropy = 128;
 	for (i = 0; i < 32; i++)
 	{
-		sample = adcSample();
-		// Each sample is 10 bits. XOR the most-significant (MS) 2 bits into
-		// the least-significant (LS) 2 bits. As long as they are not
-		// significantly correlated, this shouldn't result in a decrease in
-		// total entropy. Since the MS 2 bits and LS 2 bits are a factor of
-		// 256 apart (in significance), this correlation should be minimal.
-		buffer[i] = (uint8_t)((uint8_t)sample ^ (uint8_t)(sample >> 8));
+		while (adc_buffer_count == 0)
+		{
+			// sanitiseRam() clears the ring buffer state. If the ring buffer
+			// was full at the time, the ADC is idle and nothing else will
+			// restart it.
+			cli();
+			if (!adc_running)
+			{
+				adc_running = true;
+				ADCSRA |= _BV(ADSC);
+			}
+			sei();
+		}
+		cli();
+		buffer[i] = adc_buffer[adc_buffer_start];
+		adc_buffer_start = (uint8_t)((adc_buffer_start + 1) & ADC_BUFFER_MASK);
+		adc_buffer_count--;
+		if (!adc_running)
+		{
+			// There's room in the ring buffer again.
+			adc_running = true;
+			ADCSRA |= _BV(ADSC);
+		}
+		sei();
 	}
 	return entropy;
 }
@@ -7,10 +7,20 @@
   * the storage space is not much (only 1024 bytes on the ATmega328), but it's
   * enough to fit a couple of wallets.
   *
+  * Programming one byte of EEPROM takes about 3.4 ms, so writes aren't done
+  * synchronously. Instead, nonVolatileWrite() puts the bytes which actually
+  * change into a write queue, and the EEPROM ready interrupt programs them
+  * one at a time in the background. Bytes which already have the right
+  * value aren't queued at all. nonVolatileRead() sees queued writes, so
+  * callers don't need to care whether a write has been programmed yet;
+  * nonVolatileFlush() waits until the queue is empty.
+  *
   * This file is licensed as described by the file LICENCE.
   */
 
 #include <avr/eeprom.h>
+#include <avr/interrupt.h>
+#include <avr/io.h>
 
 #include "../common.h"
 #include "../hwinterface.h"
@@ -18,6 +28,95 @@
 /** Size of EEPROM, in number of bytes. */
 #define EEPROM_SIZE		1024
 
+#ifndef EEPROM_QUEUE_SIZE
+/** Number of bytes which the write queue can hold. If the queue is full,
+  * nonVolatileWrite() waits for some of it to be programmed. Each entry uses
+  * 3 bytes of RAM. This can be overridden by defining EEPROM_QUEUE_SIZE in
+  * the platform's build settings.
+  * \warning This must be a power of 2.
+  * \warning This must be >= 2 and must be <= 128.
+  */
+#define EEPROM_QUEUE_SIZE	32
+#endif // #ifndef EEPROM_QUEUE_SIZE
+
+/** Bitwise AND mask for write queue index. */
+#define EEPROM_QUEUE_MASK	(EEPROM_QUEUE_SIZE - 1)
+
+/** EEPROM addresses of the queued writes. */
+static volatile uint16_t eeprom_queue_address[EEPROM_QUEUE_SIZE];
+/** Values to write, for each entry in #eeprom_queue_address. */
+static volatile uint8_t eeprom_queue_data[EEPROM_QUEUE_SIZE];
+/** Index in the write queue of the next byte to program. */
+static volatile uint8_t eeprom_queue_start;
+/** Number of entries in the write queue. */
+static volatile uint8_t eeprom_queue_count;
+
+/** Stop the EEPROM ready interrupt from taking anything out of the write
+  * queue and wait for any byte which it is programming to finish. After
+  * this, the EEPROM can be read and the write queue can be changed.
+  * startEepromQueue() must be called afterwards. */
+static void stopEepromQueue(void)
+{
+	EECR &= (uint8_t)~_BV(EERIE);
+	eeprom_busy_wait();
+}
+
+/** Let the EEPROM ready interrupt continue programming whatever is in the
+  * write queue. */
+static void startEepromQueue(void)
+{
+	if (eeprom_queue_count != 0)
+	{
+		EECR |= _BV(EERIE);
+	}
+}
+
+/** Find an entry in the write queue. This must only be called between
+  * stopEepromQueue() and startEepromQueue().
+  * \param address The EEPROM address to look for.
+  * \return The index of the entry for that address, or #EEPROM_QUEUE_SIZE if
+  *         it isn't in the write queue. There is never more than one entry
+  *         for an address.
+  */
+static uint8_t findQueuedWrite(uint16_t address)
+{
+	uint8_t i;
+	uint8_t index;
+
+	index = eeprom_queue_start;
+	for (i = 0; i < eeprom_queue_count; i++)
+	{
+		if (eeprom_queue_address[index] == address)
+		{
+			return index;
+		}
+		index = (uint8_t)((index + 1) & EEPROM_QUEUE_MASK);
+	}
+	return EEPROM_QUEUE_SIZE;
+}
+
+/** Programs the next byte in the write queue, or disables itself if the
+  * write queue is empty. This fires whenever the EEPROM isn't busy and
+  * the EEPROM ready interrupt is enabled. */
+ISR(EE_READY_vect)
+{
+	if (eeprom_queue_count == 0)
+	{
+		EECR &= (uint8_t)~_BV(EERIE);
+	}
+	else
+	{
+		EEAR = eeprom_queue_address[eeprom_queue_start];
+		EEDR = eeprom_queue_data[eeprom_queue_start];
+		eeprom_queue_start = (uint8_t)((eeprom_queue_start + 1) & EEPROM_QUEUE_MASK);
+		eeprom_queue_count--;
+		// EEPE must be set within 4 clock cycles of setting EEMPE. EEPM1:0
+		// are left at their reset value (erase and write in one operation).
+		EECR |= _BV(EEMPE);
+		EECR |= _BV(EEPE);
+	}
+}
+
 /** Write to non-volatile storage.
   * \param data A pointer to the data to be written.
   * \param address Byte offset specifying where in non-volatile storage to
@@ -29,16 +128,47 @@
   */
 NonVolatileReturn nonVolatileWrite(uint8_t *data, uint32_t address, uint32_t length)
 {
+	uint16_t i;
+	uint16_t current_address;
+	uint8_t index;
+
 	if ((address > EEPROM_SIZE) || (length > EEPROM_SIZE)
 		|| ((address + length) > EEPROM_SIZE))
 	{
 		return NV_INVALID_ADDRESS;
 	}
-	eeprom_busy_wait();
-	// The (void *)(int) is there because pointers on AVR are 16 bit, so
-	// just doing (void *) would result in a "cast to pointer from integer
-	// of different size" warning.
-	eeprom_write_block(data, (void *)(int)address, (size_t)length);
+	stopEepromQueue();
+	for (i = 0; i < (uint16_t)length; i++)
+	{
+		current_address = (uint16_t)(address + i);
+		index = findQueuedWrite(current_address);
+		if (index != EEPROM_QUEUE_SIZE)
+		{
+			// Not programmed yet, so it can just be replaced.
+			eeprom_queue_data[index] = data[i];
+		}
+		// The (const uint8_t *)(int) is there because pointers on AVR are 16
+		// bit, so just doing (const uint8_t *) would result in a "cast to
+		// pointer from integer of different size" warning.
+		else if (eeprom_read_byte((const uint8_t *)(int)current_address) != data[i])
+		{
+			if (eeprom_queue_count == EEPROM_QUEUE_SIZE)
+			{
+				// Let the interrupt make some room.
+				startEepromQueue();
+				while (eeprom_queue_count == EEPROM_QUEUE_SIZE)
+				{
+					// do nothing
+				}
+				stopEepromQueue();
+			}
+			index = (uint8_t)((eeprom_queue_start + eeprom_queue_count) & EEPROM_QUEUE_MASK);
+			eeprom_queue_address[index] = current_address;
+			eeprom_queue_data[index] = data[i];
+			eeprom_queue_count++;
+		}
+	}
+	startEepromQueue();
 	return NV_NO_ERROR;
 }
 
@@ -51,26 +181,47 @@ NonVolatileReturn nonVolatileWrite(uint8_t *data, uint32_t address, uint32_t len
   */
 NonVolatileReturn nonVolatileRead(uint8_t *data, uint32_t address, uint32_t length)
 {
+	uint8_t i;
+	uint8_t index;
+	uint16_t offset;
+
 	if ((address > EEPROM_SIZE) || (length > EEPROM_SIZE)
 		|| ((address + (uint32_t)length) > EEPROM_SIZE))
 	{
 		return NV_INVALID_ADDRESS;
 	}
-	eeprom_busy_wait();
+	stopEepromQueue();
 	// The (void *)(int) is there because pointers on AVR are 16 bit, so
 	// just doing (void *) would result in a "cast to pointer from integer
 	// of different size" warning.
 	eeprom_read_block(data, (void *)(int)address, (size_t)length);
+	// Anything still in the write queue is newer than what's in EEPROM.
+	index = eeprom_queue_start;
+	for (i = 0; i < eeprom_queue_count; i++)
+	{
+		offset = (uint16_t)(eeprom_queue_address[index] - address);
+		if ((eeprom_queue_address[index] >= address) && (offset < length))
+		{
+			data[offset] = eeprom_queue_data[index];
+		}
+		index = (uint8_t)((index + 1) & EEPROM_QUEUE_MASK);
+	}
+	startEepromQueue();
 	return NV_NO_ERROR;
 }
 
 /** Ensure that all buffered writes are committed to non-volatile storage.
+  * This waits until the EEPROM ready interrupt has emptied the write queue
+  * and the last byte has been programmed.
   * \return See #NonVolatileReturnEnum for return values.
   */
 NonVolatileReturn nonVolatileFlush(void)
 {
-	// Nothing to do; writes are never buffered.
+	startEepromQueue();
+	while (eeprom_queue_count != 0)
+	{
+		// do nothing
+	}
+	eeprom_busy_wait();
 	return NV_NO_ERROR;
 }
-
-
@@ -9,6 +9,13 @@
   *
   * All references to "the datasheet" refer to this document.
   *
+  * Writes to the LCD don't go to the LCD straight away. Instead, they go
+  * to a shadow copy of the LCD's DDRAM (#lcd_shadow), and characters which
+  * have changed are marked as dirty. The timer ISR then sends dirty
+  * characters to the LCD in the background, a few at a time. This is done
+  * because the HD44780 is slow (every write needs a busy wait), so writing
+  * to it synchronously would hold up the caller.
+  *
   * This also (incidentally) deals with button inputs, since there's a
   * timer ISR which can handle the debouncing. The pin assignments in this
   * file are referred to by their Arduino pin mapping; if not using an
@@ -62,6 +69,21 @@
 
 /** Number of columns per line. */
 #define NUM_COLUMNS		16
+/** Number of bytes of DDRAM per line. */
+#define DDRAM_COLUMNS	40
+/** Number of lines. */
+#define NUM_LINES		2
+
+#ifndef LCD_WRITES_PER_TICK
+/** Maximum number of characters which the timer ISR will send to the LCD
+  * every 5 ms. Each character costs about 170 microseconds of busy waiting.
+  * The USART interrupts remain enabled while this is happening. This can be
+  * overridden by defining LCD_WRITES_PER_TICK in the platform's build
+  * settings.
+  * \warning This must be >= 1 and must be <= 20.
+  */
+#define LCD_WRITES_PER_TICK	8
+#endif // #ifndef LCD_WRITES_PER_TICK
 /** Scroll speed, in multiples of 5 ms. Example: 100 means scroll will happen
   * every 500 ms.
   * \warning This must be < 65536.
@@ -198,6 +220,28 @@ static inline uint8_t sampleArduinoPin(const uint8_t pin)
 /** 0-based column index. This specifies which column on the LCD the next
   * character will appear in. */
 static uint8_t current_column;
+/** 0-based line index. This specifies which line on the LCD the next
+  * character will appear in. */
+static uint8_t current_line;
+/** What the LCD's DDRAM should contain, in the order line 0 then line 1.
+  * Index i here corresponds to DDRAM address i on line 0 and
+  * DDRAM address 0x40 + (i - #DDRAM_COLUMNS) on line 1. */
+static uint8_t lcd_shadow[NUM_LINES * DDRAM_COLUMNS];
+/** Bit i of this bitmap (starting from the least significant bit of byte 0)
+  * is set if character i of #lcd_shadow hasn't been sent to the LCD yet. */
+static volatile uint8_t lcd_dirty[(NUM_LINES * DDRAM_COLUMNS + 7) / 8];
+/** Whether any bits in #lcd_dirty may be set. This is only cleared by the
+  * timer ISR, once it has checked every character. */
+static volatile bool lcd_any_dirty;
+/** Whether the timer ISR needs to send a "return home" command, to undo
+  * scrolling. */
+static volatile bool lcd_home_pending;
+/** Index into #lcd_shadow where the timer ISR will resume looking for dirty
+  * characters. */
+static uint8_t lcd_next;
+/** Whether the timer ISR is in the middle of doing LCD writes (with
+  * interrupts enabled). This prevents it from re-entering itself. */
+static volatile bool lcd_in_service;
 /** Largest size (in number of characters) of either line. */
 static uint8_t max_line_size;
 /** Scroll position (0 = leftmost) in number of characters. */
@@ -216,25 +260,45 @@ static uint8_t accept_debounce;
 /** Debounce counter for cancel button. */
 static uint8_t cancel_debounce;
 
+#ifdef DEFER_OUTPUT_FORMATTING
+/** Storage for transaction outputs, in binary form. These are only converted
+  * to text when they are displayed. */
+static OutputDescriptor list_output[MAX_OUTPUTS];
+#else
 /** Storage for the text of transaction output amounts. */
 static char list_amount[MAX_OUTPUTS][TEXT_AMOUNT_LENGTH];
 /** Storage for the text of transaction output addresses. */
 static char list_address[MAX_OUTPUTS][TEXT_ADDRESS_LENGTH];
-/** Index into #list_amount and #list_address which specifies where the next
-  * output amount/address will be copied into. */
+#endif // #ifdef DEFER_OUTPUT_FORMATTING
+/** Index into the output list which specifies where the next output will be
+  * copied into. */
 static uint8_t list_index;
 /** Whether the transaction fee has been set. If
   * the transaction fee still hasn't been set after parsing, then the
   * transaction is free. */
 static bool transaction_fee_set;
+#ifdef DEFER_OUTPUT_FORMATTING
+/** Storage for transaction fee amount, as a 64 bit, unsigned, little-endian
+  * integer. This is only valid if #transaction_fee_set is true. */
+static uint8_t transaction_fee_amount[8];
+#else
 /** Storage for transaction fee amount. This is only valid
   * if #transaction_fee_set is true. */
 static char transaction_fee_amount[TEXT_AMOUNT_LENGTH];
+#endif // #ifdef DEFER_OUTPUT_FORMATTING
 
-/** This does the scrolling and checks the state of the buttons. */
-ISR(TIMER0_COMPA_vect)
+/** Scroll the LCD, if a line is wider than the LCD, and send dirty
+  * characters from the shadow copy (#lcd_shadow) to the LCD. Characters are
+  * sent in runs, so that only one "set DDRAM address" command is needed for
+  * every run of consecutive dirty characters.
+  * This must only be called from the timer ISR.
+  */
+static void serviceLcd(void)
 {
-	bool temp;
+	uint8_t writes;
+	uint8_t i;
+	uint8_t bit;
+	bool address_set;
 
 	scroll_counter--;
 	if (scroll_counter == 0)
@@ -271,6 +335,72 @@ ISR(TIMER0_COMPA_vect)
 		scroll_counter = SCROLL_SPEED;
 	}
 
+	if (lcd_home_pending)
+	{
+		// Return home takes 1.52 ms, so leave everything else until the
+		// next tick.
+		writeArduinoPin(RS_PIN, 0);
+		write8(0x02);
+		lcd_home_pending = false;
+		return;
+	}
+	if (!lcd_any_dirty)
+	{
+		return;
+	}
+	writes = 0;
+	address_set = false;
+	for (i = 0; (i < sizeof(lcd_shadow)) && (writes < LCD_WRITES_PER_TICK); i++)
+	{
+		bit = (uint8_t)(1 << (lcd_next & 7));
+		if ((lcd_dirty[lcd_next >> 3] & bit) != 0)
+		{
+			if (!address_set)
+			{
+				writeArduinoPin(RS_PIN, 0);
+				if (lcd_next < DDRAM_COLUMNS)
+				{
+					write8((uint8_t)(0x80 | lcd_next));
+				}
+				else
+				{
+					write8((uint8_t)(0xc0 | (lcd_next - DDRAM_COLUMNS)));
+				}
+				writeArduinoPin(RS_PIN, 1);
+				address_set = true;
+			}
+			write8(lcd_shadow[lcd_next]);
+			lcd_dirty[lcd_next >> 3] = (uint8_t)(lcd_dirty[lcd_next >> 3] & ~bit);
+			writes++;
+		}
+		else
+		{
+			address_set = false;
+		}
+		lcd_next++;
+		if ((lcd_next == DDRAM_COLUMNS) || (lcd_next == sizeof(lcd_shadow)))
+		{
+			// DDRAM addresses aren't contiguous across lines.
+			address_set = false;
+		}
+		if (lcd_next == sizeof(lcd_shadow))
+		{
+			lcd_next = 0;
+		}
+	}
+	if (writes == 0)
+	{
+		// Looked at every character and none were dirty.
+		lcd_any_dirty = false;
+	}
+}
+
+/** This checks the state of the buttons, does the scrolling and sends
+  * pending writes to the LCD. */
+ISR(TIMER0_COMPA_vect)
+{
+	bool temp;
+
 	if (sampleArduinoPin(ACCEPT_PIN) != 0)
 	{
 		temp = true;
@@ -308,19 +438,67 @@ ISR(TIMER0_COMPA_vect)
 	{
 		cancel_debounce = 0;
 	}
+
+	// Writing to the LCD takes a while, so re-enable interrupts to avoid
+	// holding up the USART interrupts, which have much tighter deadlines.
+	if (!lcd_in_service)
+	{
+		lcd_in_service = true;
+		sei();
+		serviceLcd();
+		cli();
+		lcd_in_service = false;
+	}
+}
+
+/** Set a character in the shadow copy of the LCD's DDRAM, marking it as
+  * dirty if it has changed.
+  * \param index Index into #lcd_shadow of the character.
+  * \param c The character.
+  */
+static void setShadowCharacter(uint8_t index, uint8_t c)
+{
+	if (lcd_shadow[index] != c)
+	{
+		lcd_shadow[index] = c;
+		cli();
+		lcd_dirty[index >> 3] |= (uint8_t)(1 << (index & 7));
+		lcd_any_dirty = true;
+		sei();
+	}
+}
+
+/** Wait until all pending writes to the LCD have been sent. This must be
+  * called with interrupts enabled. */
+void flushLcd(void)
+{
+	while (lcd_any_dirty || lcd_home_pending)
+	{
+		// do nothing
+	}
 }
 
 /** Clear LCD of all text. */
 static void clearLcd(void)
 {
-	current_column = 0;
+	uint8_t i;
+
+	cli();
+	if (scroll_pos != 0)
+	{
+		lcd_home_pending = true;
+	}
 	max_line_size = 0;
 	scroll_pos = 0;
 	scroll_to_left = false;
 	scroll_counter = SCROLL_SPEED;
-	writeArduinoPin(RS_PIN, 0);
-	write8(0x01); // clear display
-	_delay_ms(10);
+	sei();
+	for (i = 0; i < sizeof(lcd_shadow); i++)
+	{
+		setShadowCharacter(i, ' ');
+	}
+	current_line = 0;
+	current_column = 0;
 }
 
 /** See page 46 of the datasheet for the HD44780 initialisation sequence. All
@@ -356,8 +534,15 @@ void initLcdAndInput(void)
 	// Now in 4 bit mode.
 	write8(0x28); // function set: 4 bit mode, 2 lines, 5x8 dots
 	write8(0x0c); // display on/off control: display on, no cursor
-	clearLcd();
+	write8(0x01); // clear display
+	_delay_ms(10);
 	write8(0x06); // entry mode set: increment, no display shift
+	memset(lcd_shadow, ' ', sizeof(lcd_shadow));
+	current_line = 0;
+	current_column = 0;
+	max_line_size = 0;
+	scroll_pos = 0;
+	scroll_to_left = false;
 	list_index = 0;
 }
 
@@ -368,14 +553,13 @@ void initLcdAndInput(void)
   */
 static void gotoStartOfLine(uint8_t line)
 {
-	writeArduinoPin(RS_PIN, 0);
 	if (line == 0)
 	{
-		write8(0x80);
+		current_line = 0;
 	}
 	else
 	{
-		write8(0xc0);
+		current_line = 1;
 	}
 	current_column = 0;
 }
@@ -391,7 +575,6 @@ static void writeString(char *str, bool is_progmem)
 {
 	char c;
 
-	writeArduinoPin(RS_PIN, 1);
 	if (is_progmem)
 	{
 		c = (char)pgm_read_byte(str);
@@ -401,9 +584,9 @@ static void writeString(char *str, bool is_progmem)
 		c = *str;
 	}
 	str++;
-	while ((c != 0) && (current_column < 40))
+	while ((c != 0) && (current_column < DDRAM_COLUMNS))
 	{
-		write8((uint8_t)c);
+		setShadowCharacter((uint8_t)(current_line * DDRAM_COLUMNS + current_column), (uint8_t)c);
 		if (is_progmem)
 		{
 			c = (char)pgm_read_byte(str);
@@ -422,6 +605,60 @@ static void writeString(char *str, bool is_progmem)
 	scroll_counter = SCROLL_PAUSE;
 }
 
+#ifdef DEFER_OUTPUT_FORMATTING
+
+/** Notify the user interface that the transaction parser has seen a new
+  * transaction output.
+  * \param output The transaction output. This will be copied.
+  * \return false if no error occurred, true if there was not enough space to
+  *         store the output.
+  */
+bool newOutputSeen(OutputDescriptor *output)
+{
+	if (list_index >= MAX_OUTPUTS)
+	{
+		return true; // not enough space to store the output
+	}
+	memcpy(&(list_output[list_index]), output, sizeof(OutputDescriptor));
+	list_index++;
+	return false; // success
+}
+
+/** Notify the user interface that the transaction parser has seen the
+  * transaction fee. If there is no transaction fee, the transaction parser
+  * will not call this.
+  * \param amount The transaction fee, in 10 ^ -8 BTC, as a 64 bit, unsigned,
+  *               little-endian integer.
+  */
+void setTransactionFee(uint8_t *amount)
+{
+	memcpy(transaction_fee_amount, amount, sizeof(transaction_fee_amount));
+	transaction_fee_set = true;
+}
+
+/** Get the text of one of the stored transaction outputs.
+  * \param text_amount The amount will be written here. This must have space
+  *                    for #TEXT_AMOUNT_LENGTH characters.
+  * \param text_address The address will be written here. This must have
+  *                     space for #TEXT_ADDRESS_LENGTH characters.
+  * \param index Index of the output in the output list.
+  */
+static void getOutputText(char *text_amount, char *text_address, uint8_t index)
+{
+	outputDescriptorToText(text_amount, text_address, &(list_output[index]));
+}
+
+/** Get the text of the stored transaction fee.
+  * \param text_amount The fee will be written here. This must have space
+  *                    for #TEXT_AMOUNT_LENGTH characters.
+  */
+static void getTransactionFeeText(char *text_amount)
+{
+	amountToText(text_amount, transaction_fee_amount);
+}
+
+#else
+
 /** Notify the user interface that the transaction parser has seen a new
   * Bitcoin amount/address pair.
   * \param text_amount The output amount, as a null-terminated text string
@@ -463,6 +700,30 @@ void setTransactionFee(char *text_amount)
 	transaction_fee_set = true;
 }
 
+/** Get the text of one of the stored transaction outputs.
+  * \param text_amount The amount will be written here. This must have space
+  *                    for #TEXT_AMOUNT_LENGTH characters.
+  * \param text_address The address will be written here. This must have
+  *                     space for #TEXT_ADDRESS_LENGTH characters.
+  * \param index Index of the output in the output list.
+  */
+static void getOutputText(char *text_amount, char *text_address, uint8_t index)
+{
+	strcpy(text_amount, list_amount[index]);
+	strcpy(text_address, list_address[index]);
+}
+
+/** Get the text of the stored transaction fee.
+  * \param text_amount The fee will be written here. This must have space
+  *                    for #TEXT_AMOUNT_LENGTH characters.
+  */
+static void getTransactionFeeText(char *text_amount)
+{
+	strcpy(text_amount, transaction_fee_amount);
+}
+
+#endif // #ifdef DEFER_OUTPUT_FORMATTING
+
 /** Notify the user interface that the list of Bitcoin amount/address pairs
   * should be cleared. */
 void clearOutputsSeen(void)
@@ -575,6 +836,8 @@ bool userDenied(AskUserCommand command)
 {
 	uint8_t i;
 	bool r; // what will be returned
+	char text_amount[TEXT_AMOUNT_LENGTH];
+	char text_address[TEXT_ADDRESS_LENGTH];
 
 	clearLcd();
 
@@ -601,14 +864,15 @@ bool userDenied(AskUserCommand command)
 	{
 		for (i = 0; i < list_index; i++)
 		{
+			getOutputText(text_amount, text_address, i);
 			clearLcd();
 			waitForNoButtonPress();
 			gotoStartOfLine(0);
 			writeString(str_sign_part0, true);
-			writeString(list_amount[i], false);
+			writeString(text_amount, false);
 			writeString(str_sign_part1, true);
 			gotoStartOfLine(1);
-			writeString(list_address[i], false);
+			writeString(text_address, false);
 			r = waitForButtonPress();
 			if (r)
 			{
@@ -620,12 +884,13 @@ bool userDenied(AskUserCommand command)
 		}
 		if (!r && transaction_fee_set)
 		{
+			getTransactionFeeText(text_amount);
 			clearLcd();
 			waitForNoButtonPress();
 			gotoStartOfLine(0);
 			writeString(str_fee_part0, true);
 			gotoStartOfLine(1);
-			writeString(transaction_fee_amount, false);
+			writeString(text_amount, false);
 			writeString(str_fee_part1, true);
 			r = waitForButtonPress();
 		}
@@ -833,4 +1098,7 @@ void streamError(void)
 	clearLcd();
 	gotoStartOfLine(0);
 	writeString(str_stream_error, true);
+	// The caller probably will halt the CPU after this, so the message
+	// needs to actually reach the LCD.
+	flushLcd();
 }
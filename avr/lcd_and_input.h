@@ -10,5 +10,6 @@
 
 extern void initLcdAndInput(void);
 extern void streamError(void);
+extern void flushLcd(void);
 
 #endif // #ifndef LCD_AND_INPUT_H_INCLUDED
@@ -52,13 +52,15 @@ static const char str_WALLET_NOT_LOADED[] PROGMEM = "Wallet not loaded";
 /** String for #WALLET_INVALID_HANDLE wallet error. */
 static const char str_WALLET_INVALID_HANDLE[] PROGMEM = "Invalid address handle";
 /** String for #WALLET_BACKUP_ERROR wallet error. */
-static const char str_WALLET_BACKUP_ERROR[] PROGMEM = "Seed could not be written to specified device";
+static const char str_WALLET_BACKUP_ERROR[] PROGMEM = "Seed could not be written to specified device, or backup is corrupt";
 /** String for #WALLET_RNG_FAILURE wallet error. */
 static const char str_WALLET_RNG_FAILURE[] PROGMEM = "Failure in random number generation system";
 /** String for #WALLET_INVALID_WALLET_NUM wallet error. */
 static const char str_WALLET_INVALID_WALLET_NUM[] PROGMEM = "Invalid wallet number";
 /** String for #WALLET_INVALID_OPERATION wallet error. */
 static const char str_WALLET_INVALID_OPERATION[] PROGMEM = "Operation not allowed";
+/** String for #WALLET_CANCELLED wallet error. */
+static const char str_WALLET_CANCELLED[] PROGMEM = "Operation cancelled by host";
 /** String for #TRANSACTION_INVALID_FORMAT transaction parser error. */
 static const char str_TRANSACTION_INVALID_FORMAT[] PROGMEM = "Format of transaction is unknown or invalid";
 /** String for #TRANSACTION_TOO_MANY_INPUTS transaction parser error. */
@@ -73,54 +75,66 @@ static const char str_TRANSACTION_NON_STANDARD[] PROGMEM = "Transaction is non-s
 static const char str_TRANSACTION_INVALID_AMOUNT[] PROGMEM = "Invalid output amount in transaction";
 /** String for #TRANSACTION_INVALID_REFERENCE transaction parser error. */
 static const char str_TRANSACTION_INVALID_REFERENCE[] PROGMEM = "Invalid transaction reference";
+/** String for #TRANSACTION_PREVOUT_NOT_CACHED transaction parser error. */
+static const char str_TRANSACTION_PREVOUT_NOT_CACHED[] PROGMEM = "Input transaction not cached";
 /** String for unknown error. */
 static const char str_UNKNOWN[] PROGMEM = "Unknown error";
 /**@}*/
 
-/** Obtain one character from one of the device's strings.
+/** Get one of the device's strings. This is faster than calling getString()
+  * for each character, since the string only needs to be looked up once.
+  * The string is in program memory, so it must be read using
+  * #LOOKUP_BYTE.
   * \param set Specifies which set of strings to use; should be
   *            one of #StringSetEnum.
-  * \param spec Specifies which string to get the character from. The
-  *             interpretation of this depends on the value of set;
-  *             see #StringSetEnum for clarification.
-  * \param pos The position of the character within the string; 0 means first,
-  *            1 means second etc.
-  * \return The character from the specified string.
+  * \param spec Specifies which string to get. The interpretation of this
+  *             depends on the value of set; see #StringSetEnum for
+  *             clarification.
+  * \param out_length The length of the string, in number of characters, will
+  *                   be written here.
+  * \return A pointer to the first character of the string. The string is not
+  *         necessarily null-terminated.
   */
-char getString(StringSet set, uint8_t spec, uint16_t pos)
+const char *getStringSpan(StringSet set, uint8_t spec, uint16_t *out_length)
 {
-	if (pos >= getStringLength(set, spec))
-	{
-		// Attempting to read beyond end of string.
-		return 0;
-	}
+	const char *str;
+	size_t length;
+
 	if (set == STRINGSET_MISC)
 	{
 		switch (spec)
 		{
 		case MISCSTR_VERSION:
-			return (char)pgm_read_byte(&(str_MISCSTR_VERSION[pos]));
+			str = str_MISCSTR_VERSION;
+			length = sizeof(str_MISCSTR_VERSION);
 			break;
 		case MISCSTR_PERMISSION_DENIED_USER:
-			return (char)pgm_read_byte(&(str_MISCSTR_PERMISSION_DENIED_USER[pos]));
+			str = str_MISCSTR_PERMISSION_DENIED_USER;
+			length = sizeof(str_MISCSTR_PERMISSION_DENIED_USER);
 			break;
 		case MISCSTR_INVALID_PACKET:
-			return (char)pgm_read_byte(&(str_MISCSTR_INVALID_PACKET[pos]));
+			str = str_MISCSTR_INVALID_PACKET;
+			length = sizeof(str_MISCSTR_INVALID_PACKET);
 			break;
 		case MISCSTR_PARAM_TOO_LARGE:
-			return (char)pgm_read_byte(&(str_MISCSTR_PARAM_TOO_LARGE[pos]));
+			str = str_MISCSTR_PARAM_TOO_LARGE;
+			length = sizeof(str_MISCSTR_PARAM_TOO_LARGE);
 			break;
 		case MISCSTR_PERMISSION_DENIED_HOST:
-			return (char)pgm_read_byte(&(str_MISCSTR_PERMISSION_DENIED_HOST[pos]));
+			str = str_MISCSTR_PERMISSION_DENIED_HOST;
+			length = sizeof(str_MISCSTR_PERMISSION_DENIED_HOST);
 			break;
 		case MISCSTR_UNEXPECTED_PACKET:
-			return (char)pgm_read_byte(&(str_MISCSTR_UNEXPECTED_PACKET[pos]));
+			str = str_MISCSTR_UNEXPECTED_PACKET;
+			length = sizeof(str_MISCSTR_UNEXPECTED_PACKET);
 			break;
 		case MISCSTR_OTP_MISMATCH:
-			return (char)pgm_read_byte(&(str_MISCSTR_OTP_MISMATCH[pos]));
+			str = str_MISCSTR_OTP_MISMATCH;
+			length = sizeof(str_MISCSTR_OTP_MISMATCH);
 			break;
 		default:
-			return (char)pgm_read_byte(&(str_UNKNOWN[pos]));
+			str = str_UNKNOWN;
+			length = sizeof(str_UNKNOWN);
 			break;
 		}
 	}
@@ -129,43 +143,60 @@ char getString(StringSet set, uint8_t spec, uint16_t pos)
 		switch (spec)
 		{
 		case WALLET_FULL:
-			return (char)pgm_read_byte(&(str_WALLET_FULL[pos]));
+			str = str_WALLET_FULL;
+			length = sizeof(str_WALLET_FULL);
 			break;
 		case WALLET_EMPTY:
-			return (char)pgm_read_byte(&(str_WALLET_EMPTY[pos]));
+			str = str_WALLET_EMPTY;
+			length = sizeof(str_WALLET_EMPTY);
 			break;
 		case WALLET_READ_ERROR:
-			return (char)pgm_read_byte(&(str_WALLET_READ_ERROR[pos]));
+			str = str_WALLET_READ_ERROR;
+			length = sizeof(str_WALLET_READ_ERROR);
 			break;
 		case WALLET_WRITE_ERROR:
-			return (char)pgm_read_byte(&(str_WALLET_WRITE_ERROR[pos]));
+			str = str_WALLET_WRITE_ERROR;
+			length = sizeof(str_WALLET_WRITE_ERROR);
 			break;
 		case WALLET_ADDRESS_NOT_FOUND:
-			return (char)pgm_read_byte(&(str_WALLET_ADDRESS_NOT_FOUND[pos]));
+			str = str_WALLET_ADDRESS_NOT_FOUND;
+			length = sizeof(str_WALLET_ADDRESS_NOT_FOUND);
 			break;
 		case WALLET_NOT_THERE:
-			return (char)pgm_read_byte(&(str_WALLET_NOT_THERE[pos]));
+			str = str_WALLET_NOT_THERE;
+			length = sizeof(str_WALLET_NOT_THERE);
 			break;
 		case WALLET_NOT_LOADED:
-			return (char)pgm_read_byte(&(str_WALLET_NOT_LOADED[pos]));
+			str = str_WALLET_NOT_LOADED;
+			length = sizeof(str_WALLET_NOT_LOADED);
 			break;
 		case WALLET_INVALID_HANDLE:
-			return (char)pgm_read_byte(&(str_WALLET_INVALID_HANDLE[pos]));
+			str = str_WALLET_INVALID_HANDLE;
+			length = sizeof(str_WALLET_INVALID_HANDLE);
 			break;
 		case WALLET_BACKUP_ERROR:
-			return (char)pgm_read_byte(&(str_WALLET_BACKUP_ERROR[pos]));
+			str = str_WALLET_BACKUP_ERROR;
+			length = sizeof(str_WALLET_BACKUP_ERROR);
 			break;
 		case WALLET_RNG_FAILURE:
-			return (char)pgm_read_byte(&(str_WALLET_RNG_FAILURE[pos]));
+			str = str_WALLET_RNG_FAILURE;
+			length = sizeof(str_WALLET_RNG_FAILURE);
 			break;
 		case WALLET_INVALID_WALLET_NUM:
-			return (char)pgm_read_byte(&(str_WALLET_INVALID_WALLET_NUM[pos]));
+			str = str_WALLET_INVALID_WALLET_NUM;
+			length = sizeof(str_WALLET_INVALID_WALLET_NUM);
 			break;
 		case WALLET_INVALID_OPERATION:
-			return (char)pgm_read_byte(&(str_WALLET_INVALID_OPERATION[pos]));
+			str = str_WALLET_INVALID_OPERATION;
+			length = sizeof(str_WALLET_INVALID_OPERATION);
+			break;
+		case WALLET_CANCELLED:
+			str = str_WALLET_CANCELLED;
+			length = sizeof(str_WALLET_CANCELLED);
 			break;
 		default:
-			return (char)pgm_read_byte(&(str_UNKNOWN[pos]));
+			str = str_UNKNOWN;
+			length = sizeof(str_UNKNOWN);
 			break;
 		}
 	}
@@ -174,35 +205,74 @@ char getString(StringSet set, uint8_t spec, uint16_t pos)
 		switch (spec)
 		{
 		case TRANSACTION_INVALID_FORMAT:
-			return (char)pgm_read_byte(&(str_TRANSACTION_INVALID_FORMAT[pos]));
+			str = str_TRANSACTION_INVALID_FORMAT;
+			length = sizeof(str_TRANSACTION_INVALID_FORMAT);
 			break;
 		case TRANSACTION_TOO_MANY_INPUTS:
-			return (char)pgm_read_byte(&(str_TRANSACTION_TOO_MANY_INPUTS[pos]));
+			str = str_TRANSACTION_TOO_MANY_INPUTS;
+			length = sizeof(str_TRANSACTION_TOO_MANY_INPUTS);
 			break;
 		case TRANSACTION_TOO_MANY_OUTPUTS:
-			return (char)pgm_read_byte(&(str_TRANSACTION_TOO_MANY_OUTPUTS[pos]));
+			str = str_TRANSACTION_TOO_MANY_OUTPUTS;
+			length = sizeof(str_TRANSACTION_TOO_MANY_OUTPUTS);
 			break;
 		case TRANSACTION_TOO_LARGE:
-			return (char)pgm_read_byte(&(str_TRANSACTION_TOO_LARGE[pos]));
+			str = str_TRANSACTION_TOO_LARGE;
+			length = sizeof(str_TRANSACTION_TOO_LARGE);
 			break;
 		case TRANSACTION_NON_STANDARD:
-			return (char)pgm_read_byte(&(str_TRANSACTION_NON_STANDARD[pos]));
+			str = str_TRANSACTION_NON_STANDARD;
+			length = sizeof(str_TRANSACTION_NON_STANDARD);
 			break;
 		case TRANSACTION_INVALID_AMOUNT:
-			return (char)pgm_read_byte(&(str_TRANSACTION_INVALID_AMOUNT[pos]));
+			str = str_TRANSACTION_INVALID_AMOUNT;
+			length = sizeof(str_TRANSACTION_INVALID_AMOUNT);
 			break;
 		case TRANSACTION_INVALID_REFERENCE:
-			return (char)pgm_read_byte(&(str_TRANSACTION_INVALID_REFERENCE[pos]));
+			str = str_TRANSACTION_INVALID_REFERENCE;
+			length = sizeof(str_TRANSACTION_INVALID_REFERENCE);
+			break;
+		case TRANSACTION_PREVOUT_NOT_CACHED:
+			str = str_TRANSACTION_PREVOUT_NOT_CACHED;
+			length = sizeof(str_TRANSACTION_PREVOUT_NOT_CACHED);
 			break;
 		default:
-			return (char)pgm_read_byte(&(str_UNKNOWN[pos]));
+			str = str_UNKNOWN;
+			length = sizeof(str_UNKNOWN);
 			break;
 		}
 	}
 	else
 	{
-		return (char)pgm_read_byte(&(str_UNKNOWN[pos]));
+		str = str_UNKNOWN;
+		length = sizeof(str_UNKNOWN);
 	}
+	*out_length = (uint16_t)(length - 1);
+	return str;
+}
+
+/** Obtain one character from one of the device's strings.
+  * \param set Specifies which set of strings to use; should be
+  *            one of #StringSetEnum.
+  * \param spec Specifies which string to get the character from. The
+  *             interpretation of this depends on the value of set;
+  *             see #StringSetEnum for clarification.
+  * \param pos The position of the character within the string; 0 means first,
+  *            1 means second etc.
+  * \return The character from the specified string.
+  */
+char getString(StringSet set, uint8_t spec, uint16_t pos)
+{
+	const char *str;
+	uint16_t length;
+
+	str = getStringSpan(set, spec, &length);
+	if (pos >= length)
+	{
+		// Attempting to read beyond end of string.
+		return 0;
+	}
+	return (char)LOOKUP_BYTE(str[pos]);
 }
 
 /** Get the length of one of the device's strings.
@@ -215,114 +285,9 @@ char getString(StringSet set, uint8_t spec, uint16_t pos)
   */
 uint16_t getStringLength(StringSet set, uint8_t spec)
 {
-	if (set == STRINGSET_MISC)
-	{
-		switch (spec)
-		{
-		case MISCSTR_VERSION:
-			return (uint16_t)(sizeof(str_MISCSTR_VERSION) - 1);
-			break;
-		case MISCSTR_PERMISSION_DENIED_USER:
-			return (uint16_t)(sizeof(str_MISCSTR_PERMISSION_DENIED_USER) - 1);
-			break;
-		case MISCSTR_INVALID_PACKET:
-			return (uint16_t)(sizeof(str_MISCSTR_INVALID_PACKET) - 1);
-			break;
-		case MISCSTR_PARAM_TOO_LARGE:
-			return (uint16_t)(sizeof(str_MISCSTR_PARAM_TOO_LARGE) - 1);
-			break;
-		case MISCSTR_PERMISSION_DENIED_HOST:
-			return (uint16_t)(sizeof(str_MISCSTR_PERMISSION_DENIED_HOST) - 1);
-			break;
-		case MISCSTR_UNEXPECTED_PACKET:
-			return (uint16_t)(sizeof(str_MISCSTR_UNEXPECTED_PACKET) - 1);
-			break;
-		case MISCSTR_OTP_MISMATCH:
-			return (uint16_t)(sizeof(str_MISCSTR_OTP_MISMATCH) - 1);
-			break;
-		default:
-			return (uint16_t)(sizeof(str_UNKNOWN) - 1);
-			break;
-		}
-	}
-	else if (set == STRINGSET_WALLET)
-	{
-		switch (spec)
-		{
-		case WALLET_FULL:
-			return (uint16_t)(sizeof(str_WALLET_FULL) - 1);
-			break;
-		case WALLET_EMPTY:
-			return (uint16_t)(sizeof(str_WALLET_EMPTY) - 1);
-			break;
-		case WALLET_READ_ERROR:
-			return (uint16_t)(sizeof(str_WALLET_READ_ERROR) - 1);
-			break;
-		case WALLET_WRITE_ERROR:
-			return (uint16_t)(sizeof(str_WALLET_WRITE_ERROR) - 1);
-			break;
-		case WALLET_ADDRESS_NOT_FOUND:
-			return (uint16_t)(sizeof(str_WALLET_ADDRESS_NOT_FOUND) - 1);
-			break;
-		case WALLET_NOT_THERE:
-			return (uint16_t)(sizeof(str_WALLET_NOT_THERE) - 1);
-			break;
-		case WALLET_NOT_LOADED:
-			return (uint16_t)(sizeof(str_WALLET_NOT_LOADED) - 1);
-			break;
-		case WALLET_INVALID_HANDLE:
-			return (uint16_t)(sizeof(str_WALLET_INVALID_HANDLE) - 1);
-			break;
-		case WALLET_BACKUP_ERROR:
-			return (uint16_t)(sizeof(str_WALLET_BACKUP_ERROR) - 1);
-			break;
-		case WALLET_RNG_FAILURE:
-			return (uint16_t)(sizeof(str_WALLET_RNG_FAILURE) - 1);
-			break;
-		case WALLET_INVALID_WALLET_NUM:
-			return (uint16_t)(sizeof(str_WALLET_INVALID_WALLET_NUM) - 1);
-			break;
-		case WALLET_INVALID_OPERATION:
-			return (uint16_t)(sizeof(str_WALLET_INVALID_OPERATION) - 1);
-			break;
-		default:
-			return (uint16_t)(sizeof(str_UNKNOWN) - 1);
-			break;
-		}
-	}
-	else if (set == STRINGSET_TRANSACTION)
-	{
-		switch (spec)
-		{
-		case TRANSACTION_INVALID_FORMAT:
-			return (uint16_t)(sizeof(str_TRANSACTION_INVALID_FORMAT) - 1);
-			break;
-		case TRANSACTION_TOO_MANY_INPUTS:
-			return (uint16_t)(sizeof(str_TRANSACTION_TOO_MANY_INPUTS) - 1);
-			break;
-		case TRANSACTION_TOO_MANY_OUTPUTS:
-			return (uint16_t)(sizeof(str_TRANSACTION_TOO_MANY_OUTPUTS) - 1);
-			break;
-		case TRANSACTION_TOO_LARGE:
-			return (uint16_t)(sizeof(str_TRANSACTION_TOO_LARGE) - 1);
-			break;
-		case TRANSACTION_NON_STANDARD:
-			return (uint16_t)(sizeof(str_TRANSACTION_NON_STANDARD) - 1);
-			break;
-		case TRANSACTION_INVALID_AMOUNT:
-			return (uint16_t)(sizeof(str_TRANSACTION_INVALID_AMOUNT) - 1);
-			break;
-		case TRANSACTION_INVALID_REFERENCE:
-			return (uint16_t)(sizeof(str_TRANSACTION_INVALID_REFERENCE) - 1);
-			break;
-		default:
-			return (uint16_t)(sizeof(str_UNKNOWN) - 1);
-			break;
-		}
-	}
-	else
-	{
-		return (uint16_t)(sizeof(str_UNKNOWN) - 1);
-	}
+	uint16_t length;
+
+	getStringSpan(set, spec, &length);
+	return length;
 }
 
@@ -7,6 +7,12 @@
   * allowing the host to communicate with the AVR over a USB connection.
   * See initUsart() for serial communication parameters.
   *
+  * Both directions are interrupt-driven and buffered by ring buffers whose
+  * sizes can be set in the build settings. If USART_HARDWARE_FLOW_CONTROL is
+  * defined, RTS/CTS hardware flow control is also used, so that the host
+  * can stream long packets (eg. SignTransaction) at full speed without
+  * overrunning the receive buffer while the packet parser is busy hashing.
+  *
   * This file is licensed as described by the file LICENCE.
   */
 
@@ -21,16 +27,76 @@
 #include "hwinit.h"
 #include "lcd_and_input.h"
 
-/** Size of transmit buffer, in number of bytes.
+#ifndef TX_BUFFER_SIZE
+/** Size of transmit buffer, in number of bytes. This can be overridden by
+  * defining TX_BUFFER_SIZE in the platform's build settings.
   * \warning This must be a power of 2.
   * \warning This must be >= 16 and must be <= 256.
   */
 #define TX_BUFFER_SIZE	32
-/** Size of receive buffer, in number of bytes.
+#endif // #ifndef TX_BUFFER_SIZE
+#ifndef RX_BUFFER_SIZE
+/** Size of receive buffer, in number of bytes. This is also the number of
+  * bytes the host is allowed to send between acknowledgements, so a larger
+  * receive buffer means the host needs to pause less often. This can be
+  * overridden by defining RX_BUFFER_SIZE in the platform's build settings.
   * \warning This must be a power of 2.
   * \warning This must be >= 16 and must be <= 256.
   */
 #define RX_BUFFER_SIZE	128
+#endif // #ifndef RX_BUFFER_SIZE
+
+#ifndef USART_BAUD
+/** Baud rate of the USART. util/setbaud.h will enable double speed mode
+  * (U2X) if that gives a more accurate baud rate. This can be overridden by
+  * defining USART_BAUD in the platform's build settings; for example,
+  * 115200 works with F_CPU = 16 MHz if USART_FORCE_2X is also defined.
+  */
+#define USART_BAUD		57600
+#endif // #ifndef USART_BAUD
+
+#ifdef USART_HARDWARE_FLOW_CONTROL
+#ifndef USART_RTS_THRESHOLD
+/** RTS is deasserted (telling the host to stop sending) when there are
+  * this many or fewer free bytes in the receive buffer. This leaves room
+  * for bytes which are still in flight in the host's USB-to-serial bridge
+  * when it notices RTS. This can be overridden by defining
+  * USART_RTS_THRESHOLD in the platform's build settings.
+  * \warning This must be < RX_BUFFER_SIZE.
+  */
+#define USART_RTS_THRESHOLD	16
+#endif // #ifndef USART_RTS_THRESHOLD
+#if USART_RTS_THRESHOLD >= RX_BUFFER_SIZE
+#error "USART_RTS_THRESHOLD must be less than RX_BUFFER_SIZE"
+#endif
+
+/**
+ * \defgroup FlowControlPins Pins used for hardware flow control.
+ *
+ * RTS is an output, CTS is an input. Both are active low. Arduino pins
+ * A2 and A3 are used because they aren't used by anything else.
+ *
+ * @{
+ */
+/** Port register for the RTS pin. */
+#define RTS_PORT		PORTC
+/** Data direction register for the RTS pin. */
+#define RTS_DDR			DDRC
+/** Bit mask of the RTS pin (Arduino pin A2). */
+#define RTS_BIT			_BV(PORTC2)
+/** Input register for the CTS pin. */
+#define CTS_PIN			PINC
+/** Port register for the CTS pin; used to enable its pull-up. */
+#define CTS_PORT		PORTC
+/** Bit mask of the CTS pin (Arduino pin A3). */
+#define CTS_BIT			_BV(PINC3)
+/** Bit mask of the CTS pin in its pin change mask register. */
+#define CTS_PCINT_BIT	_BV(PCINT11)
+/**@}*/
+
+/** Evaluates to true if the host is ready to receive bytes. */
+#define HOST_IS_READY()	((CTS_PIN & CTS_BIT) == 0)
+#endif // #ifdef USART_HARDWARE_FLOW_CONTROL
 
 /** Bitwise AND mask for transmit buffer index. */
 #define TX_BUFFER_MASK	(TX_BUFFER_SIZE - 1)
@@ -64,8 +130,9 @@ static uint32_t rx_acknowledge;
 static uint32_t tx_acknowledge;
 
 /** Initialises USART0 with the parameters:
-  * baud rate 57600, 8 data bits, no parity bit, 1 start bit, 0 stop bits.
-  * This also clears the transmit/receive buffers.
+  * baud rate #USART_BAUD, 8 data bits, no parity bit, 1 start bit, 0 stop
+  * bits. This also clears the transmit/receive buffers and, if
+  * USART_HARDWARE_FLOW_CONTROL is defined, sets up the RTS/CTS pins.
   */
 void initUsart(void)
 {
@@ -81,12 +148,20 @@ void initUsart(void)
 	rx_buffer_overrun = false;
 	rx_acknowledge = 16;
 	tx_acknowledge = 16;
-#define BAUD 57600
+#ifdef USART_FORCE_2X
+	// util/setbaud.h only selects double speed mode if the normal mode
+	// baud rate is out of tolerance, so compute UBRR for double speed mode
+	// (rounding to nearest) directly.
+#define USE_2X	1
+	UBRR0 = (uint16_t)(((F_CPU + 4UL * USART_BAUD) / (8UL * USART_BAUD)) - 1UL);
+#else
+#define BAUD USART_BAUD
 	// util/setbaud.h will set UBRRH_VALUE, UBRRL_VALUE and USE_2X to
 	// appropriate values, given some F_CPU and BAUD.
 #include <util/setbaud.h>
 	UBRR0H = UBRRH_VALUE;
 	UBRR0L = UBRRL_VALUE;
+#endif // #ifdef USART_FORCE_2X
 	// The datasheet says to set FE0, DOR0 and UPE0 to 0 whenever writing to
 	// UCSR0A.
 	temp = (uint8_t)(UCSR0A & ~_BV(FE0) & ~_BV(DOR0) & ~_BV(UPE0) & ~_BV(U2X0) & ~_BV(MPCM0));
@@ -97,13 +172,58 @@ void initUsart(void)
 	UCSR0B = _BV(RXCIE0) | _BV(RXEN0) | _BV(TXEN0);
 	UCSR0C = _BV(UCSZ01) | _BV(UCSZ00);
 	PRR = (uint8_t)(PRR & ~_BV(PRUSART0));
+#ifdef USART_HARDWARE_FLOW_CONTROL
+	// Receive buffer is empty, so assert RTS.
+	RTS_PORT = (uint8_t)(RTS_PORT & ~RTS_BIT);
+	RTS_DDR |= RTS_BIT;
+	// Enable pull-up on CTS, so that an unconnected CTS means "not ready"
+	// rather than a floating input. Changes in CTS trigger an interrupt so
+	// that transmission can resume as soon as the host is ready.
+	CTS_PORT |= CTS_BIT;
+	PCMSK1 |= CTS_PCINT_BIT;
+	PCICR |= _BV(PCIE1);
+#endif // #ifdef USART_HARDWARE_FLOW_CONTROL
 	sei();
 }
 
+#ifdef USART_HARDWARE_FLOW_CONTROL
+/** Get the number of bytes in the receive buffer.
+  * \warning This must be called with interrupts disabled.
+  * \return The number of bytes in the receive buffer.
+  */
+static uint16_t rxBufferUsed(void)
+{
+	if (rx_buffer_full)
+	{
+		return RX_BUFFER_SIZE;
+	}
+	else
+	{
+		return (uint8_t)((rx_buffer_end - rx_buffer_start) & RX_BUFFER_MASK);
+	}
+}
+
+/** Interrupt service routine which is called whenever CTS (or any other
+  * enabled pin on port C) changes. If the host has become ready, this
+  * restarts transmission of whatever is in the transmit buffer. */
+ISR(PCINT1_vect)
+{
+	if (HOST_IS_READY())
+	{
+		UCSR0B |= _BV(UDRIE0);
+	}
+}
+#endif // #ifdef USART_HARDWARE_FLOW_CONTROL
+
 /** Interrupt service routine which is called whenever the USART receives
   * a byte. */
 ISR(USART_RX_vect)
 {
+	if (UCSR0A & _BV(DOR0))
+	{
+		// A byte was lost because this ISR didn't get to run in time.
+		rx_buffer_overrun = true;
+	}
 	if (rx_buffer_full)
 	{
 		// Uh oh, no space left in receive buffer. Still need to read UDR0
@@ -122,15 +242,31 @@ ISR(USART_RX_vect)
 			rx_buffer_full = true;
 		}
 	}
+#ifdef USART_HARDWARE_FLOW_CONTROL
+	if (rxBufferUsed() >= (RX_BUFFER_SIZE - USART_RTS_THRESHOLD))
+	{
+		// Running out of space; deassert RTS.
+		RTS_PORT |= RTS_BIT;
+	}
+#endif // #ifdef USART_HARDWARE_FLOW_CONTROL
 }
 
 /** Interrupt service routine for USART Data Register Empty.
   * UDRE0 is used instead of TXC0 (transmit complete) because the ISR only
   * moves one byte into the transmit buffer, not an entire frame (however
   * large that happens to be).
+  * If hardware flow control is enabled and the host isn't ready, the
+  * UDRE interrupt is disabled until CTS is asserted again.
   */
 ISR(USART_UDRE_vect)
 {
+#ifdef USART_HARDWARE_FLOW_CONTROL
+	if (!HOST_IS_READY())
+	{
+		UCSR0B = (uint8_t)(UCSR0B & ~_BV(UDRIE0));
+		return;
+	}
+#endif // #ifdef USART_HARDWARE_FLOW_CONTROL
 	if ((tx_buffer_start != tx_buffer_end) || tx_buffer_full)
 	{
 		UDR0 = tx_buffer[tx_buffer_start];
@@ -159,14 +295,18 @@ static void usartSend(uint8_t data)
 	if (!tx_buffer_full && (tx_buffer_start == tx_buffer_end)
 		&& (UCSR0A & _BV(UDRE0)))
 	{
+#ifdef USART_HARDWARE_FLOW_CONTROL
+		send_immediately = HOST_IS_READY();
+#else
 		send_immediately = true;
+#endif // #ifdef USART_HARDWARE_FLOW_CONTROL
 	}
-	sei();
 	if (send_immediately)
 	{
 		UDR0 = data;
 	}
-	else
+	sei();
+	if (!send_immediately)
 	{
 		// Need to queue it.
 		while (tx_buffer_full)
@@ -205,6 +345,13 @@ static uint8_t usartReceive(void)
 	rx_buffer_start++;
 	rx_buffer_start = (uint8_t)(rx_buffer_start & RX_BUFFER_MASK);
 	rx_buffer_full = false;
+#ifdef USART_HARDWARE_FLOW_CONTROL
+	if (rxBufferUsed() < (RX_BUFFER_SIZE - USART_RTS_THRESHOLD))
+	{
+		// There's enough space again; assert RTS.
+		RTS_PORT = (uint8_t)(RTS_PORT & ~RTS_BIT);
+	}
+#endif // #ifdef USART_HARDWARE_FLOW_CONTROL
 	sei();
 	return r;
 }
@@ -273,6 +420,16 @@ uint8_t streamGetOneByte(void)
 	return one_byte;
 }
 
+/** Check whether there is at least one byte in the receive buffer. Like the
+  * check in usartReceive(), this doesn't need to be atomic.
+  * \return true if streamGetOneByte() would return without waiting, false
+  *         otherwise.
+  */
+bool streamIsByteAvailable(void)
+{
+	return (rx_buffer_start != rx_buffer_end) || rx_buffer_full;
+}
+
 /** Send one byte to the communication stream. There is no way for this
   * function to indicate a write error. This is intentional; it
   * makes program flow simpler (no need to put checks everywhere). As a
@@ -305,6 +462,58 @@ void streamPutOneByte(uint8_t one_byte)
 	}
 }
 
+/** Grab a number of bytes from the communication stream. This is
+  * equivalent to calling streamGetOneByte() length times. There's nothing
+  * to be gained from doing anything cleverer here, since the USART
+  * itself can only receive one byte at a time and disabling interrupts
+  * only costs a couple of cycles.
+  * \param buffer The received bytes will be written here. This must have
+  *               space for length bytes.
+  * \param length The number of bytes to receive.
+  */
+void streamGetBytes(uint8_t *buffer, uint32_t length)
+{
+	uint32_t i;
+
+	for (i = 0; i < length; i++)
+	{
+		buffer[i] = streamGetOneByte();
+	}
+}
+
+/** Throw away a number of bytes from the communication stream. This is
+  * equivalent to calling streamGetOneByte() length times and ignoring the
+  * result, for the same reason as streamGetBytes(); the receive buffer
+  * only ever holds a few bytes, and each one still has to be counted
+  * towards the next acknowledgement.
+  * \param length The number of bytes to throw away.
+  */
+void streamDiscardBytes(uint32_t length)
+{
+	uint32_t i;
+
+	for (i = 0; i < length; i++)
+	{
+		streamGetOneByte();
+	}
+}
+
+/** Send a number of bytes to the communication stream. This is equivalent
+  * to calling streamPutOneByte() length times; see streamGetBytes() for
+  * why.
+  * \param buffer The bytes to send.
+  * \param length The number of bytes to send.
+  */
+void streamPutBytes(const uint8_t *buffer, uint32_t length)
+{
+	uint32_t i;
+
+	for (i = 0; i < length; i++)
+	{
+		streamPutOneByte(buffer[i]);
+	}
+}
+
 /** Beginning of BSS (zero-initialised) section. */
 extern void __bss_start;
 
@@ -361,6 +570,10 @@ void sanitiseRam(void)
 	// was called as a result of a "unload wallet" packet, since the host
 	// isn't supposed to send anything until it receives a response from
 	// here.
+	// Pending LCD writes and queued EEPROM writes live in RAM too, so they
+	// need to be finished before RAM is cleared.
+	flushLcd();
+	nonVolatileFlush();
 
 	saved_rx_acknowledge = rx_acknowledge;
 	saved_tx_acknowledge = tx_acknowledge;
@@ -18,21 +18,28 @@
 #include "test_helpers.h"
 #endif // #ifdef TEST_BASECONV
 
+#ifdef BENCH_BASECONV
+#include <stdlib.h>
+#include "test_helpers.h"
+#endif // #ifdef BENCH_BASECONV
+
 #include "common.h"
 #include "endian.h"
 #include "baseconv.h"
 #include "bignum256.h"
 #include "sha256.h"
 
-/** Shift list for bigDivide() to have it do division by 58. */
-static const uint8_t base58_shift_list[16] PROGMEM = {
-0x00, 0x1d, 0x80, 0x0e, 0x40, 0x07, 0xa0, 0x03,
-0xd0, 0x01, 0xe8, 0x00, 0x74, 0x00, 0x3a, 0x00};
+/** 58 ^ 4. hashToAddr() divides by this, so that each pass over the number
+  * produces 4 base 58 digits. */
+#define BASE58_POW4				11316496UL
+/** Number of base 58 digits produced from each division by #BASE58_POW4. */
+#define BASE58_DIGITS_PER_PASS	4
 
-/** Shift list for bigDivide() to have it do division by 10. */
-static const uint8_t base10_shift_list[16] PROGMEM = {
-0x00, 0x05, 0x80, 0x02, 0x40, 0x01, 0xa0, 0x00,
-0x50, 0x00, 0x28, 0x00, 0x14, 0x00, 0x0a, 0x00};
+/** 10 ^ 4. amountToText() divides by this, so that each pass over the amount
+  * produces 4 decimal digits. */
+#define BASE10_POW4				10000UL
+/** Number of decimal digits produced from each division by #BASE10_POW4. */
+#define BASE10_DIGITS_PER_PASS	4
 
 /** Characters for the base 10 representation of numbers. */
 static const char base10_char_list[10] PROGMEM = {
@@ -47,50 +54,32 @@ static const char base58_char_list[58] PROGMEM = {
 'h', 'i', 'j', 'k', 'm', 'n', 'o', 'p', 'q', 'r',
 's', 't', 'u', 'v', 'w', 'x', 'y', 'z'};
 
-/** Do a multi-precision division of op1 by an 8 bit unsigned integer n,
-  * placing the quotient in r and the remainder in op1.
-  * \param r The quotient will be placed here. This should be an array with
-  *          space for size bytes.
+/** Do a multi-precision division of op1 by a small unsigned integer, in place.
+  * This processes one byte of op1 at a time, with a 32 bit remainder, so
+  * the divisor can be a power of the output base. That way, each pass over
+  * op1 produces several digits.
   * \param op1 As an input, this is the dividend, a multi-precision number.
-  *            But on output, this will be be remainder. This should be an
-  *            array with space for size + 1 bytes.
-  * \param temp A temporary work area. Its contents will be overwritten with
-  *             junk. This should be an array with space for size + 1 bytes.
-  * \param size The size of the division, in number of bytes.
-  * \param shift_list Specifies the divisor (the 8 bit unsigned integer n).
-  *                   This is actually an array of 8 little-endian 16 bit
-  *                   unsigned integers which are:
-  *                   n << 7, n << 6, n << 5, ..., n << 0.
-  * \warning r, op1 and temp cannot alias each other.
-  * \warning For platforms that use the PROGMEM attribute, the shift_list
-  *          array must have that attribute.
+  *            On output, this will be the quotient. This should be an array
+  *            with space for size bytes.
+  * \param size The size of op1, in number of bytes.
+  * \param divisor The divisor. This must be non-zero and less than 2 ^ 24,
+  *                so that the remainder, shifted left by 8 bits, fits in 32
+  *                bits.
+  * \return The remainder.
   */
-static void bigDivide(uint8_t *r, uint8_t *op1, uint8_t *temp, uint8_t size, const uint8_t *shift_list)
+static uint32_t bigDivideInPlace(uint8_t *op1, uint8_t size, uint32_t divisor)
 {
+	uint32_t remainder;
 	uint8_t i;
-	uint8_t j;
-	uint8_t one_bit;
-
-	memset(temp, 0, (uint16_t)(size + 1));
-	memset(r, 0, size);
-	op1[size] = 0;
 
+	remainder = 0;
 	for (i = (uint8_t)(size - 1); i < size; i--)
 	{
-		one_bit = 0x80;
-		for (j = 0; j < 8; j++)
-		{
-			temp[i] = LOOKUP_BYTE(shift_list[j * 2]);
-			temp[i + 1] = LOOKUP_BYTE(shift_list[j * 2 + 1]);
-			if (bigCompareVariableSize(temp, op1, (uint8_t)(size + 1)) != BIGCMP_GREATER)
-			{
-				bigSubtractVariableSizeNoModulo(op1, op1, temp, (uint8_t)(size + 1));
-				r[i] |= one_bit;
-			}
-			one_bit >>= 1;
-		}
-		temp[i + 1] = 0;
+		remainder = (remainder << 8) | op1[i];
+		op1[i] = (uint8_t)(remainder / divisor);
+		remainder = remainder % divisor;
 	}
+	return remainder;
 }
 
 /** Convert a transaction amount (which is in 10 ^ -8 BTC) to a human-readable
@@ -102,9 +91,8 @@ static void bigDivide(uint8_t *r, uint8_t *op1, uint8_t *temp, uint8_t size, con
   */
 void amountToText(char *out, uint8_t *in)
 {
-	uint8_t op1[9];
-	uint8_t temp[9];
 	uint8_t r[8];
+	uint32_t remainder;
 	uint8_t i;
 	uint8_t j;
 	uint8_t index;
@@ -112,16 +100,20 @@ void amountToText(char *out, uint8_t *in)
 	memcpy(r, in, 8);
 
 	// Write amount into a string like: "000000000000.00000000".
-	index = 20;
-	for (i = 0; i < 20; i++)
+	// 2 ^ 64 < 10 ^ 20, so 5 passes are enough.
+	index = 21;
+	for (i = 0; i < 5; i++)
 	{
-		memcpy(op1, r, 8);
-		bigDivide(r, op1, temp, 8, base10_shift_list);
-		if (i == 8)
+		remainder = bigDivideInPlace(r, 8, BASE10_POW4);
+		for (j = 0; j < BASE10_DIGITS_PER_PASS; j++)
 		{
-			out[index--] = '.';
+			if (index == 13)
+			{
+				out[--index] = '.';
+			}
+			out[--index] = LOOKUP_BYTE(base10_char_list[remainder % 10]);
+			remainder /= 10;
 		}
-		out[index--] = LOOKUP_BYTE(base10_char_list[op1[0]]);
 	}
 	out[21] = '\0';
 
@@ -170,24 +162,25 @@ void amountToText(char *out, uint8_t *in)
 void hashToAddr(char *out, uint8_t *in, uint8_t address_version)
 {
 	uint8_t r[25];
-	uint8_t op1[26];
-	uint8_t temp[26];
+	uint32_t remainder;
 	uint8_t index;
 	uint8_t i;
 	uint8_t j;
 	uint8_t leading_zero_bytes;
+	uint8_t versioned_hash[21];
 	HashState hs;
 
-	// Prepend address version and append checksum.
-	sha256Begin(&hs);
+	// Prepend address version and append checksum. The checksum is over
+	// just 21 bytes, so both hashes fit in one block each.
 	r[24] = address_version;
-	sha256WriteByte(&hs, address_version);
+	versioned_hash[0] = address_version;
 	for (i = 0; i < 20; i++)
 	{
 		r[23 - i] = in[i];
-		sha256WriteByte(&hs, in[i]);
+		versioned_hash[i + 1] = in[i];
 	}
-	sha256FinishDouble(&hs);
+	sha256Short(&hs, versioned_hash, sizeof(versioned_hash));
+	sha256Rehash(&hs);
 	writeU32LittleEndian(r, hs.h[0]);
 
 	// Count number of leading zero bytes.
@@ -204,13 +197,21 @@ void hashToAddr(char *out, uint8_t *in, uint8_t address_version)
 		}
 	}
 
-	// Convert to base 58.
-	index = 34;
-	for (i = 0; i < 35; i++)
+	// Convert to base 58. 9 passes produce 36 digits, but the most
+	// significant digit is always 0 since 58 ^ 35 > 2 ^ 200, so it's dropped.
+	index = 35;
+	for (i = 0; i < 9; i++)
 	{
-		memcpy(op1, r, 25);
-		bigDivide(r, op1, temp, 25, base58_shift_list);
-		out[index--] = LOOKUP_BYTE(base58_char_list[op1[0]]);
+		remainder = bigDivideInPlace(r, 25, BASE58_POW4);
+		for (j = 0; j < BASE58_DIGITS_PER_PASS; j++)
+		{
+			if (index != 0)
+			{
+				index--;
+				out[index] = LOOKUP_BYTE(base58_char_list[remainder % 58]);
+			}
+			remainder /= 58;
+		}
 	}
 	out[35] = '\0';
 
@@ -242,6 +243,23 @@ void hashToAddr(char *out, uint8_t *in, uint8_t address_version)
 	}
 }
 
+/** Convert a transaction output descriptor to the human-readable amount and
+  * address that amountToText() and hashToAddr() would produce.
+  * \param text_amount The amount will be written here, as a null-terminated
+  *                    string. This should point to a char array which has
+  *                    space for at least #TEXT_AMOUNT_LENGTH characters.
+  * \param text_address The address will be written here, as a
+  *                     null-terminated string. This should point to a char
+  *                     array which has space for at least
+  *                     #TEXT_ADDRESS_LENGTH characters.
+  * \param output The transaction output descriptor to convert.
+  */
+void outputDescriptorToText(char *text_amount, char *text_address, OutputDescriptor *output)
+{
+	amountToText(text_amount, output->amount);
+	hashToAddr(text_address, output->hash, output->address_version);
+}
+
 #ifdef TEST_BASECONV
 
 /** Stores one test case for amountToText(). */
@@ -479,3 +497,36 @@ int main(void)
 
 #endif // #ifdef TEST_BASECONV
 
+#ifdef BENCH_BASECONV
+
+/** Amount (little-endian, in satoshis) to convert to text. */
+static uint8_t bench_amount[8] = {0x15, 0xcd, 0x5b, 0x07, 0x00, 0x00, 0x00, 0x00};
+/** Hash to convert to an address. */
+static uint8_t bench_hash[20];
+
+/** Convert an amount to text. */
+static void benchAmountToText(void)
+{
+	char out[TEXT_AMOUNT_LENGTH];
+
+	amountToText(out, bench_amount);
+}
+
+/** Convert a hash to a Base58Check address. */
+static void benchHashToAddr(void)
+{
+	char out[TEXT_ADDRESS_LENGTH];
+
+	hashToAddr(out, bench_hash, ADDRESS_VERSION_PUBKEY);
+}
+
+int main(void)
+{
+	initBenchmarks(__FILE__);
+	fillWithRandom(bench_hash, sizeof(bench_hash));
+	runHostBenchmark("amount_to_text", &benchAmountToText, 8);
+	runHostBenchmark("hash_to_addr", &benchHashToAddr, 20);
+	exit(0);
+}
+
+#endif // #ifdef BENCH_BASECONV
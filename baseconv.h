@@ -34,8 +34,26 @@
   * address. This includes the terminating null. */
 #define TEXT_ADDRESS_LENGTH	36
 
+/** Compact, binary form of a transaction output. This is what the
+  * transaction parser hands to the user interface when
+  * DEFER_OUTPUT_FORMATTING is defined (see newOutputSeen()); it is much
+  * smaller than the text form and can be converted to text, using
+  * outputDescriptorToText(), only when it actually needs to be displayed. */
+typedef struct OutputDescriptorStruct
+{
+	/** The output amount, in 10 ^ -8 BTC, as a 64 bit, unsigned,
+	  * little-endian integer. */
+	uint8_t amount[8];
+	/** The address version, which also specifies the script type. This is
+	  * either #ADDRESS_VERSION_PUBKEY or #ADDRESS_VERSION_P2SH. */
+	uint8_t address_version;
+	/** The 160 bit hash from the output script, in big-endian format. */
+	uint8_t hash[20];
+} OutputDescriptor;
+
 extern void amountToText(char *out, uint8_t *in);
 extern void hashToAddr(char *out, uint8_t *in, uint8_t address_version);
+extern void outputDescriptorToText(char *text_amount, char *text_address, OutputDescriptor *output);
 
 #endif // #ifndef BASECONV_H_INCLUDED
 
@@ -0,0 +1,195 @@
+/** \file benchmark.c
+  *
+  * \brief Measures how long cryptographic primitives take to run.
+  *
+  * This is intended to be used on real hardware, so that performance
+  * regressions in code like pointMultiply() or pbkdf2() can be spotted. The
+  * timing comes from the platform-dependent getCycleCount() function. Since
+  * it allows the host to keep the device busy for an arbitrary amount of
+  * time, this is only compiled in if ENABLE_BENCHMARK is defined; that
+  * should only be done for debug builds.
+  *
+  * None of the primitives are run on secret data. The private key and
+  * password used here are fixed, publicly known values.
+  *
+  * This file is licensed as described by the file LICENCE.
+  */
+
+#ifdef TEST
+#include <time.h>
+#endif // #ifdef TEST
+
+#ifdef TEST_BENCHMARK
+#include <stdio.h>
+#include <stdlib.h>
+#include "test_helpers.h"
+#endif // #ifdef TEST_BENCHMARK
+
+#include "common.h"
+#include "benchmark.h"
+#include "bignum256.h"
+#include "ecdsa.h"
+#include "hwinterface.h"
+#include "pbkdf2.h"
+#include "sha256.h"
+#include "xex.h"
+
+#ifdef ENABLE_BENCHMARK
+
+/** Scalar/private key which is used for the benchmarks which need one.
+  * It's little-endian, like all other BigNum256 values. */
+static const uint8_t benchmark_scalar[32] = {
+0x2a, 0x54, 0x2c, 0xfe, 0xa4, 0xa0, 0x73, 0x6f,
+0x7e, 0x1d, 0xc1, 0x53, 0x9e, 0x4c, 0x27, 0x41,
+0x4b, 0x93, 0xe1, 0x5b, 0x06, 0x41, 0xba, 0xa4,
+0x11, 0x5c, 0x0f, 0x31, 0xc1, 0x09, 0x3e, 0x6f};
+
+/** Run one iteration of a benchmark. This is separate from runBenchmark()
+  * so that the buffers it uses don't stay on the stack while runBenchmark()
+  * reads the cycle counter.
+  * \param primitive The primitive to run; one of #BenchmarkPrimitives.
+  */
+static NOINLINE void runPrimitiveOnce(uint32_t primitive)
+{
+	PointAffine p;
+	HashState hs;
+	uint8_t buffer1[64];
+	uint8_t buffer2[32];
+	uint8_t buffer3[32];
+
+	memset(buffer1, 0x5a, sizeof(buffer1));
+	memcpy(buffer2, benchmark_scalar, sizeof(buffer2));
+	switch (primitive)
+	{
+	case BENCHMARK_POINT_MULTIPLY:
+		setToG(&p);
+		pointMultiply(&p, buffer2);
+		break;
+	case BENCHMARK_POINT_MULTIPLY_BASE:
+		pointMultiplyBase(&p, buffer2);
+		break;
+	case BENCHMARK_ECDSA_SIGN:
+		ecdsaSign(buffer3, &(buffer1[32]), buffer1, buffer2);
+		break;
+	case BENCHMARK_PBKDF2:
+		pbkdf2(buffer1, buffer2, 8, &(buffer2[8]), 8);
+		break;
+	case BENCHMARK_XEX_ENCRYPT:
+		xexEncrypt(buffer3, buffer1, &(buffer1[16]), 1);
+		break;
+	case BENCHMARK_SHA256_BLOCK:
+		sha256Begin(&hs);
+		sha256WriteBytes(&hs, buffer1, sizeof(buffer1));
+		break;
+	default:
+		break;
+	}
+}
+
+/** Time how long a primitive takes to run, by running it a number of times.
+  * The unit of the result is platform-dependent; see getCycleCount(). The
+  * cycle counter is 32 bits wide, so the host needs to choose the number of
+  * iterations so that the counter doesn't wrap around more than once.
+  * \param out_ticks The number of elapsed cycle counter ticks will be
+  *                  written here.
+  * \param primitive The primitive to time; one of #BenchmarkPrimitives.
+  * \param iterations Number of times to run the primitive.
+  * \return false on success, true if primitive is not a valid primitive.
+  */
+bool runBenchmark(uint32_t *out_ticks, uint32_t primitive, uint32_t iterations)
+{
+	uint32_t start_count;
+	uint32_t i;
+
+	*out_ticks = 0;
+	if (primitive >= BENCHMARK_NUMBER_OF_PRIMITIVES)
+	{
+		return true;
+	}
+	start_count = getCycleCount();
+	for (i = 0; i < iterations; i++)
+	{
+		runPrimitiveOnce(primitive);
+	}
+	*out_ticks = getCycleCount() - start_count;
+	return false;
+}
+
+#endif // #ifdef ENABLE_BENCHMARK
+
+// diagnostics.c and trace.c also use getCycleCount(). Their unit tests
+// provide their own getCycleCount(), so that timings are predictable.
+#if defined(TEST) && (defined(ENABLE_BENCHMARK) || defined(ENABLE_DIAGNOSTICS)) && !defined(TEST_DIAGNOSTICS) && !defined(TEST_TRACE)
+
+/** Get the current value of the cycle counter. For testing, this uses the
+  * processor time used by the program, in units of CLOCKS_PER_SEC.
+  * \return The current value of the cycle counter.
+  */
+uint32_t getCycleCount(void)
+{
+	return (uint32_t)clock();
+}
+
+#endif // #if defined(TEST) && (defined(ENABLE_BENCHMARK) || defined(ENABLE_DIAGNOSTICS)) && !defined(TEST_DIAGNOSTICS) && !defined(TEST_TRACE)
+
+#ifdef TEST_BENCHMARK
+
+int main(void)
+{
+	uint32_t primitive;
+	uint32_t ticks;
+
+	initTests(__FILE__);
+
+	// Every primitive should run.
+	for (primitive = 0; primitive < BENCHMARK_NUMBER_OF_PRIMITIVES; primitive++)
+	{
+		if (!runBenchmark(&ticks, primitive, 2))
+		{
+			reportSuccess();
+		}
+		else
+		{
+			printf("Primitive %u failed to run\n", (unsigned int)primitive);
+			reportFailure();
+		}
+	}
+
+	// Invalid primitives should be rejected.
+	if (runBenchmark(&ticks, BENCHMARK_NUMBER_OF_PRIMITIVES, 1))
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("Invalid primitive accepted\n");
+		reportFailure();
+	}
+	if (runBenchmark(&ticks, 0xffffffff, 1))
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("Invalid primitive 0xffffffff accepted\n");
+		reportFailure();
+	}
+
+	// Something as slow as point multiplication should take measurable
+	// time.
+	runBenchmark(&ticks, BENCHMARK_POINT_MULTIPLY, 10);
+	if (ticks > 0)
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("Point multiplication took no time\n");
+		reportFailure();
+	}
+
+	finishTests();
+	exit(0);
+}
+
+#endif // #ifdef TEST_BENCHMARK
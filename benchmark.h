@@ -0,0 +1,36 @@
+/** \file benchmark.h
+  *
+  * \brief Describes functions and types exported by benchmark.c.
+  *
+  * This file is licensed as described by the file LICENCE.
+  */
+
+#ifndef BENCHMARK_H_INCLUDED
+#define BENCHMARK_H_INCLUDED
+
+#include "common.h"
+
+/** The primitives which runBenchmark() knows how to time. The numbers here
+  * are part of the communication protocol (see #PACKET_TYPE_BENCHMARK), so
+  * don't change existing ones. */
+typedef enum BenchmarkPrimitivesEnum
+{
+	/** pointMultiply() with G as the point. */
+	BENCHMARK_POINT_MULTIPLY		=	0,
+	/** pointMultiplyBase(). */
+	BENCHMARK_POINT_MULTIPLY_BASE	=	1,
+	/** ecdsaSign(), including deterministic generation of k. */
+	BENCHMARK_ECDSA_SIGN			=	2,
+	/** pbkdf2(), with getPBKDF2Iterations() iterations. */
+	BENCHMARK_PBKDF2				=	3,
+	/** xexEncrypt() of one 16 byte block. */
+	BENCHMARK_XEX_ENCRYPT			=	4,
+	/** Hashing one 64 byte block using SHA-256. */
+	BENCHMARK_SHA256_BLOCK			=	5,
+	/** Number of valid primitives; this must be last. */
+	BENCHMARK_NUMBER_OF_PRIMITIVES	=	6
+} BenchmarkPrimitives;
+
+extern bool runBenchmark(uint32_t *out_ticks, uint32_t primitive, uint32_t iterations);
+
+#endif // #ifndef BENCHMARK_H_INCLUDED
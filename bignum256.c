@@ -29,6 +29,23 @@
   * bigSubtractVariableSizeNoModulo() and bigCompare()) do not need
   * bigSetField() to be called first.
   *
+  * On platforms with a fast 32 x 32 bit multiplier (eg. PIC32, Cortex-M0),
+  * define BIGNUM256_32BIT_LIMBS to use an alternative implementation of the
+  * field operations (bigModulo(), bigAdd(), bigSubtract(), bigMultiply() and
+  * bigInvert()) which works on 32 bit limbs instead of bytes. The interface
+  * is unchanged: numbers are still passed around as little-endian byte
+  * arrays, and are converted to and from limbs at the start and end of each
+  * operation. On 8 bit platforms (eg. AVR), the byte-oriented implementation
+  * is usually faster, so this should not be defined.
+  *
+  * There is also a set of Montgomery multiplication functions (eg.
+  * bigMultiplyMontgomery()), which operate on numbers in the Montgomery
+  * domain (i.e. x is represented by x x 2 ^ 256 modulo #n). They replace
+  * the complement-based reduction of bigMultiply(), which needs several
+  * passes when #n isn't close to 2 ^ 256, with one which always takes a
+  * fixed number of word multiplications. To use them, call
+  * bigSetMontgomery() after bigSetField().
+  *
   * This file is licensed as described by the file LICENCE.
   */
 
@@ -44,19 +61,86 @@
 #include "test_helpers.h"
 #endif // #ifdef TEST_BIGNUM256
 
+#ifdef BENCH_BIGNUM256
+#include <stdlib.h>
+#include "ecdsa.h"
+#include "test_helpers.h"
+#endif // #ifdef BENCH_BIGNUM256
+
 #include "common.h"
 #include "bignum256.h"
+#include "scratch.h"
 
 /** The prime modulus to operate under.
   * \warning This must be greater than 2 ^ 255.
   * \warning The least significant byte of this must be >= 2, otherwise
   *          bigInvert() will not work correctly.
   */
-static BigNum256 n;
+static THREAD_LOCAL BigNum256 n;
 /** The 2s complement of #n, with most significant zero bytes removed. */
-static uint8_t *complement_n;
+static THREAD_LOCAL uint8_t *complement_n;
 /** The size of #complement_n, in number of bytes. */
-static uint8_t size_complement_n;
+static THREAD_LOCAL uint8_t size_complement_n;
+/** 2 ^ 512 modulo #n, which is used by bigToMontgomery() to convert numbers
+  * into the Montgomery domain. */
+static THREAD_LOCAL BigNum256 montgomery_r_squared;
+/** -(#n ^ -1) modulo 2 ^ 32. Only the least significant byte of this is used
+  * by the byte-oriented implementation. */
+static THREAD_LOCAL uint32_t montgomery_n_prime;
+
+#ifdef BIGNUM256_32BIT_LIMBS
+
+/** Number of 32 bit limbs in a 256 bit multi-precision number. */
+#define LIMBS256				8
+
+/** #n, converted into 32 bit limbs (least significant limb first). */
+static THREAD_LOCAL uint32_t n_limbs[LIMBS256];
+/** #complement_n, converted into 32 bit limbs (least significant limb
+  * first). */
+static THREAD_LOCAL uint32_t complement_n_limbs[LIMBS256];
+/** The size of #complement_n_limbs, in number of limbs.
+  * \warning This must be < 8, and the most significant limb of
+  *          #complement_n_limbs must be < 2 ^ 31, otherwise the reduction
+  *          in limbMultiply() will not work correctly.
+  */
+static THREAD_LOCAL uint8_t size_complement_n_limbs;
+
+/** Convert a little-endian multi-precision number from a byte array into an
+  * array of 32 bit limbs.
+  * \param out The destination limb array. This must have space for
+  *            (in_size + 3) / 4 limbs.
+  * \param in The source little-endian byte array.
+  * \param in_size The size of in, in number of bytes. This does not need to
+  *                be a multiple of 4; if not, the most significant limb is
+  *                padded with zeroes.
+  */
+static void bytesToLimbs(uint32_t *out, const uint8_t *in, uint8_t in_size)
+{
+	uint8_t i;
+
+	memset(out, 0, (size_t)((in_size + 3) >> 2) * sizeof(uint32_t));
+	for (i = 0; i < in_size; i++)
+	{
+		out[i >> 2] |= (uint32_t)in[i] << ((i & 3) << 3);
+	}
+}
+
+/** Convert an array of 8 32 bit limbs into a 32 byte little-endian
+  * multi-precision number.
+  * \param out The destination 32 byte number.
+  * \param in The source limb array.
+  */
+static void limbsToBig(BigNum256 out, const uint32_t *in)
+{
+	uint8_t i;
+
+	for (i = 0; i < 32; i++)
+	{
+		out[i] = (uint8_t)(in[i >> 2] >> ((i & 3) << 3));
+	}
+}
+
+#endif // #ifdef BIGNUM256_32BIT_LIMBS
 
 /** Compare two multi-precision numbers of arbitrary size.
   * \param op1 One of the numbers to compare.
@@ -158,6 +242,41 @@ void bigAssign(BigNum256 r, BigNum256 op1)
 	memcpy(r, op1, 32);
 }
 
+/** Load a 32 byte big-endian octet string (eg. a hash, a BIP32 private key
+  * or a SEC 1 field element) into a 32 byte multi-precision number. This
+  * is the only conversion needed when reading such values, so there's no
+  * need to copy them first and then call swapEndian256().
+  * \param r The 32 byte multi-precision number will be written into here.
+  * \param in The 32 byte big-endian octet string to read from. This may
+  *           alias r exactly, but must not otherwise overlap it.
+  */
+void bigLoadBigEndian(BigNum256 r, const uint8_t *in)
+{
+	uint8_t i;
+	uint8_t low;
+	uint8_t high;
+
+	// Reading both ends before writing either one makes in-place loads work.
+	for (i = 0; i < 16; i++)
+	{
+		low = in[i];
+		high = in[31 - i];
+		r[i] = high;
+		r[31 - i] = low;
+	}
+}
+
+/** Store a 32 byte multi-precision number as a 32 byte big-endian octet
+  * string. This is the inverse of bigLoadBigEndian().
+  * \param out The 32 byte big-endian octet string will be written into here.
+  * \param op1 The 32 byte multi-precision number to store. This may alias
+  *            out exactly, but must not otherwise overlap it.
+  */
+void bigStoreBigEndian(uint8_t *out, const BigNum256 op1)
+{
+	bigLoadBigEndian(out, op1);
+}
+
 /** Swap endian representation of a 256 bit integer.
   * \param buffer An array of 32 bytes representing the integer to change.
   */
@@ -187,6 +306,24 @@ void bigSetField(const uint8_t *in_n, const uint8_t *in_complement_n, const uint
 	n = (BigNum256)in_n;
 	complement_n = (uint8_t *)in_complement_n;
 	size_complement_n = (uint8_t)in_size_complement_n;
+#ifdef BIGNUM256_32BIT_LIMBS
+	bytesToLimbs(n_limbs, in_n, 32);
+	bytesToLimbs(complement_n_limbs, in_complement_n, in_size_complement_n);
+	size_complement_n_limbs = (uint8_t)((in_size_complement_n + 3) >> 2);
+#endif // #ifdef BIGNUM256_32BIT_LIMBS
+}
+
+/** Set the parameters which the Montgomery multiplication functions (eg.
+  * bigMultiplyMontgomery()) need. These depend on #n, so this must be
+  * called after bigSetField(), and again whenever the field changes. As
+  * with bigSetField(), in_r_squared will never be written to.
+  * \param in_r_squared See #montgomery_r_squared.
+  * \param in_n_prime See #montgomery_n_prime.
+  */
+void bigSetMontgomery(const uint8_t *in_r_squared, const uint32_t in_n_prime)
+{
+	montgomery_r_squared = (BigNum256)in_r_squared;
+	montgomery_n_prime = in_n_prime;
 }
 
 /** Add (r = op1 + op2) two multi-precision numbers of arbitrary size,
@@ -252,6 +389,8 @@ uint8_t bigSubtractNoModulo(BigNum256 r, BigNum256 op1, BigNum256 op2)
 	return bigSubtractVariableSizeNoModulo(r, op1, op2, 32);
 }
 
+#ifndef BIGNUM256_32BIT_LIMBS
+
 /** Compute op1 modulo #n, where op1 is a 32 byte multi-precision number.
   * The "modulo" part makes it sound like this function does division
   * somewhere, but since #n is also a 32 byte multi-precision number, all
@@ -327,6 +466,8 @@ void bigSubtract(BigNum256 r, BigNum256 op1, BigNum256 op2)
 	bigAddVariableSizeNoModulo(r, r, lookup[too_small], 32);
 }
 
+#endif // #ifndef BIGNUM256_32BIT_LIMBS
+
 /** Divide a 32 byte multi-precision number by 2, truncating if necessary.
   * \param r The 32 byte result will be written into here.
   * \param op1 The 32 byte operand to divide by 2. This may alias r.
@@ -361,7 +502,8 @@ void bigShiftRightNoModulo(BigNum256 r, const BigNum256 op1)
   * \param op2_size The size, in number of bytes, of op2.
   * \warning This function is the speed bottleneck in an ECDSA signing
   *          operation. To speed up ECDSA signing, reimplement this in
-  *          assembly and define PLATFORM_SPECIFIC_BIGMULTIPLY.
+  *          assembly and define PLATFORM_SPECIFIC_BIGMULTIPLY; the AVR
+  *          port does this (see avr/bignum256_avr.S).
   */
 void bigMultiplyVariableSizeNoModulo(uint8_t *r, uint8_t *op1, uint8_t op1_size, uint8_t *op2, uint8_t op2_size)
 {
@@ -404,22 +546,103 @@ void bigMultiplyVariableSizeNoModulo(uint8_t *r, uint8_t *op1, uint8_t op1_size,
 	}
 }
 
+/** Squares (r = op1 x op1) a multi-precision number of arbitrary size,
+  * ignoring the current prime finite field. This gives the same result as
+  * bigMultiplyVariableSizeNoModulo(r, op1, op1_size, op1, op1_size), but
+  * is faster. Each cross product op1[i] x op1[j] (for i != j) appears twice
+  * in the schoolbook method. Here it is only computed once, and the sum of
+  * cross products is doubled. This means only about half as many byte
+  * multiplications are needed.
+  * \param r The result will be written into here. The size of the result (in
+  *          number of bytes) will be 2 x op1_size.
+  * \param op1 The operand to square. This cannot alias r.
+  * \param op1_size The size, in number of bytes, of op1.
+  */
+void bigSquareVariableSizeNoModulo(uint8_t *r, uint8_t *op1, uint8_t op1_size)
+{
+	uint8_t cached_op1;
+	uint8_t carry;
+	uint8_t temp;
+	uint16_t multiply_result16;
+	uint16_t partial_sum;
+	uint8_t i;
+	uint8_t j;
+
+	memset(r, 0, (uint16_t)(op1_size + op1_size));
+	// Sum the cross products op1[i] x op1[j] for i < j. Each partial sum is
+	// at most 255 x 255 + 255 + 255 = 65535, so it can't overflow.
+	for (i = 0; i < op1_size; i++)
+	{
+		cached_op1 = op1[i];
+		carry = 0;
+		for (j = (uint8_t)(i + 1); j < op1_size; j++)
+		{
+			partial_sum = (uint16_t)((uint16_t)cached_op1 * (uint16_t)op1[j] + (uint16_t)r[i + j] + (uint16_t)carry);
+			r[i + j] = (uint8_t)partial_sum;
+			carry = (uint8_t)(partial_sum >> 8);
+		}
+		r[i + op1_size] = carry;
+	}
+	// Double the sum of cross products.
+	carry = 0;
+	for (i = 0; i < (uint8_t)(op1_size + op1_size); i++)
+	{
+		temp = r[i];
+		r[i] = (uint8_t)((temp << 1) | carry);
+		carry = (uint8_t)(temp >> 7);
+	}
+	// Add the squares op1[i] x op1[i].
+	carry = 0;
+	for (i = 0; i < op1_size; i++)
+	{
+		multiply_result16 = (uint16_t)((uint16_t)op1[i] * (uint16_t)op1[i]);
+		partial_sum = (uint16_t)((uint16_t)r[2 * i] + (multiply_result16 & 0xff) + (uint16_t)carry);
+		r[2 * i] = (uint8_t)partial_sum;
+		carry = (uint8_t)(partial_sum >> 8);
+		partial_sum = (uint16_t)((uint16_t)r[2 * i + 1] + (multiply_result16 >> 8) + (uint16_t)carry);
+		r[2 * i + 1] = (uint8_t)partial_sum;
+		carry = (uint8_t)(partial_sum >> 8);
+	}
+#ifdef TEST
+	assert(carry == 0);
+#endif // #ifdef TEST
+}
+
+#else
+
+/** Squares (r = op1 x op1) a multi-precision number of arbitrary size,
+  * ignoring the current prime finite field. The platform-specific
+  * bigMultiplyVariableSizeNoModulo() is probably faster than a squaring
+  * routine written in C, so this just uses it.
+  * \param r The result will be written into here. The size of the result (in
+  *          number of bytes) will be 2 x op1_size.
+  * \param op1 The operand to square. This cannot alias r.
+  * \param op1_size The size, in number of bytes, of op1.
+  */
+void bigSquareVariableSizeNoModulo(uint8_t *r, uint8_t *op1, uint8_t op1_size)
+{
+	bigMultiplyVariableSizeNoModulo(r, op1, op1_size, op1, op1_size);
+}
+
 #endif // #ifndef PLATFORM_SPECIFIC_BIGMULTIPLY
 
-/** Multiplies (r = (op1 x op2) modulo #n) two 32 byte multi-precision
-  * numbers under the current prime finite field.
+#ifndef BIGNUM256_32BIT_LIMBS
+
+/** Reduce a 64 byte multi-precision number (typically a product) modulo #n.
   * \param r The 32 byte result will be written into here.
-  * \param op1 The first 32 byte operand to multiply. This may alias r.
-  * \param op2 The second 32 byte operand to multiply. This may alias r or
-  *            op1.
+  * \param full_r The 64 byte number to reduce. This will be overwritten.
   */
-void bigMultiply(BigNum256 r, BigNum256 op1, BigNum256 op2)
+static void bigReduce(BigNum256 r, uint8_t *full_r)
 {
-	uint8_t temp[64];
-	uint8_t full_r[64];
+	ScratchMark mark;
+	uint8_t *temp;
 	uint8_t remaining;
+	uint8_t carry_mask;
+	uint8_t i;
+
+	mark = scratchMark();
+	temp = scratchAllocate(64);
 
-	bigMultiplyVariableSizeNoModulo(full_r, op1, 32, op2, 32);
 	// The modular reduction is done by subtracting off some multiple of
 	// n. The upper 256 bits of r are used as an estimate for that multiple.
 	// As long as n is close to 2 ^ 256, this estimate should be very close.
@@ -445,11 +668,60 @@ void bigMultiply(BigNum256 r, BigNum256 op1, BigNum256 op2)
 		// This update of the bound is only valid for remaining > 32.
 		remaining = (uint8_t)(remaining - 32 + size_complement_n);
 	}
+	// The addition in the last iteration may have carried into full_r[32].
+	// Since 2 ^ 256 = complement_n modulo n, that carry can be folded back in
+	// by adding complement_n. If the carry is 1, the lower 256 bits must be
+	// small, so this addition will never overflow.
+	memset(temp, 0, 32);
+	carry_mask = (uint8_t)(-(int)full_r[32]);
+	for (i = 0; i < size_complement_n; i++)
+	{
+		temp[i] = (uint8_t)(complement_n[i] & carry_mask);
+	}
+	bigAddVariableSizeNoModulo(full_r, full_r, temp, 32);
 	// The upper 256 bits of r should now be 0. But r could still be >= n.
 	// As long as n > 2 ^ 255, at most one subtraction is
 	// required to ensure that r < n.
 	bigModulo(full_r, full_r);
 	bigAssign(r, full_r);
+	scratchRelease(mark);
+}
+
+/** Multiplies (r = (op1 x op2) modulo #n) two 32 byte multi-precision
+  * numbers under the current prime finite field.
+  * \param r The 32 byte result will be written into here.
+  * \param op1 The first 32 byte operand to multiply. This may alias r.
+  * \param op2 The second 32 byte operand to multiply. This may alias r or
+  *            op1.
+  */
+void bigMultiply(BigNum256 r, BigNum256 op1, BigNum256 op2)
+{
+	ScratchMark mark;
+	uint8_t *full_r;
+
+	mark = scratchMark();
+	full_r = scratchAllocate(64);
+	bigMultiplyVariableSizeNoModulo(full_r, op1, 32, op2, 32);
+	bigReduce(r, full_r);
+	scratchRelease(mark);
+}
+
+/** Squares (r = (op1 x op1) modulo #n) a 32 byte multi-precision number
+  * under the current prime finite field. This gives the same result as
+  * bigMultiply(r, op1, op1), but is faster.
+  * \param r The 32 byte result will be written into here.
+  * \param op1 The 32 byte operand to square. This may alias r.
+  */
+void bigSquare(BigNum256 r, BigNum256 op1)
+{
+	ScratchMark mark;
+	uint8_t *full_r;
+
+	mark = scratchMark();
+	full_r = scratchAllocate(64);
+	bigSquareVariableSizeNoModulo(full_r, op1, 32);
+	bigReduce(r, full_r);
+	scratchRelease(mark);
 }
 
 
@@ -478,29 +750,1176 @@ void bigInvert(BigNum256 r, BigNum256 op1)
 	lookup[1] = temp;
 	for (i = 31; i < 32; i--)
 	{
-		byte_of_n_minus_2 = n[i];
-		if (i == 0)
-		{
-			byte_of_n_minus_2 = (uint8_t)(byte_of_n_minus_2 - 2);
-		}
-		for (j = 0; j < 8; j++)
-		{
-			bit_of_n_minus_2 = (uint8_t)((byte_of_n_minus_2 & 0x80) >> 7);
-			byte_of_n_minus_2 = (uint8_t)(byte_of_n_minus_2 << 1);
-			// The next two lines do the following:
-			// if (bit_of_n_minus_2)
-			// {
-			//     bigMultiply(r, r, temp);
-			//     bigMultiply(temp, temp, temp);
-			// }
-			// else
-			// {
-			//     bigMultiply(temp, r, temp);
-			//     bigMultiply(r, r, r);
-			// }
-			bigMultiply(lookup[1 - bit_of_n_minus_2], r, temp);
-			bigMultiply(lookup[bit_of_n_minus_2], lookup[bit_of_n_minus_2], lookup[bit_of_n_minus_2]);
-		}
+		byte_of_n_minus_2 = n[i];
+		if (i == 0)
+		{
+			byte_of_n_minus_2 = (uint8_t)(byte_of_n_minus_2 - 2);
+		}
+		for (j = 0; j < 8; j++)
+		{
+			bit_of_n_minus_2 = (uint8_t)((byte_of_n_minus_2 & 0x80) >> 7);
+			byte_of_n_minus_2 = (uint8_t)(byte_of_n_minus_2 << 1);
+			// The next two lines do the following:
+			// if (bit_of_n_minus_2)
+			// {
+			//     bigMultiply(r, r, temp);
+			//     bigSquare(temp, temp);
+			// }
+			// else
+			// {
+			//     bigMultiply(temp, r, temp);
+			//     bigSquare(r, r);
+			// }
+			bigMultiply(lookup[1 - bit_of_n_minus_2], r, temp);
+			bigSquare(lookup[bit_of_n_minus_2], lookup[bit_of_n_minus_2]);
+		}
+	}
+}
+
+/** Do Montgomery reduction (r = full_r x 2 ^ -256 modulo #n) on a 64 byte
+  * multi-precision number. Each of the 32 passes adds a multiple of #n
+  * which clears the least significant remaining byte of full_r, so this
+  * always does exactly 32 x 32 byte multiplications, whatever #n is.
+  * \param r The 32 byte result will be written into here.
+  * \param full_r The 64 byte number to reduce. This will be overwritten.
+  * \warning full_r must be < #n x 2 ^ 256, otherwise the result may not be
+  *          fully reduced.
+  */
+static void bigMontgomeryReduce(BigNum256 r, uint8_t *full_r)
+{
+	uint16_t partial;
+	uint8_t temp[32];
+	uint8_t *lookup[2];
+	uint8_t m;
+	uint8_t carry;
+	uint8_t high_carry;
+	uint8_t borrow;
+	uint8_t i;
+	uint8_t j;
+
+	// high_carry is the carry out of full_r[i + 31] from the previous pass,
+	// which belongs in full_r[i + 32].
+	high_carry = 0;
+	for (i = 0; i < 32; i++)
+	{
+		m = (uint8_t)(full_r[i] * (uint8_t)montgomery_n_prime);
+		carry = 0;
+		for (j = 0; j < 32; j++)
+		{
+			partial = (uint16_t)((uint16_t)m * (uint16_t)n[j] + (uint16_t)full_r[i + j] + (uint16_t)carry);
+			full_r[i + j] = (uint8_t)partial;
+			carry = (uint8_t)(partial >> 8);
+		}
+		partial = (uint16_t)((uint16_t)full_r[i + 32] + (uint16_t)carry + (uint16_t)high_carry);
+		full_r[i + 32] = (uint8_t)partial;
+		high_carry = (uint8_t)(partial >> 8);
+	}
+	// The upper 256 bits of full_r (plus high_carry x 2 ^ 256) are now < 2n,
+	// so at most one subtraction of n is needed. It is needed if there was
+	// a carry or if the subtraction didn't borrow.
+	borrow = bigSubtractNoModulo(temp, &(full_r[32]), n);
+	lookup[0] = &(full_r[32]);
+	lookup[1] = temp;
+	bigAssign(r, lookup[high_carry | (borrow ^ 1)]);
+}
+
+/** Multiplies (r = op1 x op2 x 2 ^ -256 modulo #n) two 32 byte
+  * multi-precision numbers. If op1 and op2 are in the Montgomery domain,
+  * then so is r, and it represents the product of what op1 and op2
+  * represent.
+  * \param r The 32 byte result will be written into here.
+  * \param op1 The first 32 byte operand to multiply. This may alias r.
+  * \param op2 The second 32 byte operand to multiply. This may alias r or
+  *            op1.
+  * \warning op1 x op2 must be < #n x 2 ^ 256; this is true if either
+  *          operand is < #n.
+  */
+void bigMultiplyMontgomery(BigNum256 r, BigNum256 op1, BigNum256 op2)
+{
+	uint8_t full_r[64];
+
+	bigMultiplyVariableSizeNoModulo(full_r, op1, 32, op2, 32);
+	bigMontgomeryReduce(r, full_r);
+}
+
+/** Squares (r = op1 x op1 x 2 ^ -256 modulo #n) a 32 byte multi-precision
+  * number. This gives the same result as bigMultiplyMontgomery(r, op1, op1),
+  * but is faster.
+  * \param r The 32 byte result will be written into here.
+  * \param op1 The 32 byte operand to square. This may alias r.
+  * \warning op1 must be < #n.
+  */
+void bigSquareMontgomery(BigNum256 r, BigNum256 op1)
+{
+	uint8_t full_r[64];
+
+	bigSquareVariableSizeNoModulo(full_r, op1, 32);
+	bigMontgomeryReduce(r, full_r);
+}
+
+/** Convert (r = op1 x 2 ^ -256 modulo #n) a 32 byte multi-precision number
+  * out of the Montgomery domain.
+  * \param r The 32 byte result will be written into here.
+  * \param op1 The 32 byte operand to convert. This may alias r.
+  */
+void bigFromMontgomery(BigNum256 r, BigNum256 op1)
+{
+	uint8_t full_r[64];
+
+	memcpy(full_r, op1, 32);
+	memset(&(full_r[32]), 0, 32);
+	bigMontgomeryReduce(r, full_r);
+}
+
+/** Compute r = lo + hi x (2 ^ 32 + 977), where lo is a 32 byte
+  * multi-precision number and hi is a multi-precision number of arbitrary
+  * size. Since secp256k1's field prime p is 2 ^ 256 - (2 ^ 32 + 977), if hi
+  * is the part of a number above 2 ^ 256 and lo is the part below, then r
+  * is congruent to that number modulo p. Because 2 ^ 32 + 977 is so sparse,
+  * this can be done column by column with a few multiplications by small
+  * constants, instead of with a full multi-precision multiplication.
+  * \param r The result will be written into here.
+  * \param r_size The size, in number of bytes, of r. Any carry out of the
+  *               most significant byte will be discarded.
+  * \param lo The 32 byte lower part. This may alias r, but only if
+  *           r_size <= 32.
+  * \param hi The upper part. This cannot alias r, unless r_size <= 32.
+  * \param hi_size The size, in number of bytes, of hi.
+  */
+static void foldModP(uint8_t *r, uint8_t r_size, uint8_t *lo, uint8_t *hi, uint8_t hi_size)
+{
+	uint16_t column;
+	uint8_t i;
+
+	// 977 = 0x03d1 and 2 ^ 32 is a shift of 4 bytes. Each column sum is at
+	// most 255 x (1 + 0xd1 + 0x03 + 1) plus a carry, which fits in 16 bits.
+	column = 0;
+	for (i = 0; i < r_size; i++)
+	{
+		if (i < 32)
+		{
+			column = (uint16_t)(column + lo[i]);
+		}
+		if (i < hi_size)
+		{
+			column = (uint16_t)(column + (uint16_t)hi[i] * 0xd1);
+		}
+		if ((i >= 1) && (i < hi_size + 1))
+		{
+			column = (uint16_t)(column + (uint16_t)hi[i - 1] * 0x03);
+		}
+		if ((i >= 4) && (i < hi_size + 4))
+		{
+			column = (uint16_t)(column + hi[i - 4]);
+		}
+		r[i] = (uint8_t)column;
+		column = (uint16_t)(column >> 8);
+	}
+}
+
+/** Reduce a 64 byte multi-precision number (typically a product) modulo p,
+  * where p is secp256k1's field prime 2 ^ 256 - 2 ^ 32 - 977. This takes
+  * advantage of the special form of p; see foldModP().
+  * \param r The 32 byte result will be written into here.
+  * \param full_r The 64 byte number to reduce. This will be overwritten.
+  */
+static void reduceModP(BigNum256 r, uint8_t *full_r)
+{
+	uint8_t folded[37];
+	uint8_t *lookup[2];
+	uint8_t carry;
+
+	// full_r < 2 ^ 512, so after the first fold, folded < 2 ^ 289. After the
+	// second fold, full_r < 2 ^ 256 + 2 ^ 66, so full_r[32] is 0 or 1. If it
+	// is 1, the lower 256 bits must be small, so the third fold (which
+	// adds full_r[32] x (2 ^ 32 + 977)) will never overflow.
+	foldModP(folded, 37, full_r, &(full_r[32]), 32);
+	foldModP(full_r, 33, folded, &(folded[32]), 5);
+	foldModP(full_r, 32, full_r, &(full_r[32]), 1);
+	// full_r < 2 ^ 256 now, but it could still be >= p. full_r >= p if and
+	// only if adding 2 ^ 32 + 977 to it overflows, in which case the
+	// discarded carry performs the subtraction of p.
+	memset(folded, 0, 32);
+	folded[0] = 0xd1;
+	folded[1] = 0x03;
+	folded[4] = 0x01;
+	carry = bigAddVariableSizeNoModulo(folded, full_r, folded, 32);
+	lookup[0] = full_r;
+	lookup[1] = folded;
+	bigAssign(r, lookup[carry]);
+}
+
+/** Multiplies (r = (op1 x op2) modulo p) two 32 byte multi-precision
+  * numbers, where p is secp256k1's field prime 2 ^ 256 - 2 ^ 32 - 977.
+  * This gives the same result as bigMultiply() does when the field has been
+  * set to p, but the reduction takes advantage of the special form of p, so
+  * it's quite a bit faster. This doesn't depend on the current prime finite
+  * field, so it can be used even if bigSetField() hasn't been called.
+  * \param r The 32 byte result will be written into here.
+  * \param op1 The first 32 byte operand to multiply. This may alias r.
+  * \param op2 The second 32 byte operand to multiply. This may alias r or
+  *            op1.
+  */
+void bigMultiplyModP(BigNum256 r, BigNum256 op1, BigNum256 op2)
+{
+	ScratchMark mark;
+	uint8_t *full_r;
+
+	mark = scratchMark();
+	full_r = scratchAllocate(64);
+	bigMultiplyVariableSizeNoModulo(full_r, op1, 32, op2, 32);
+	reduceModP(r, full_r);
+	scratchRelease(mark);
+}
+
+/** Squares (r = (op1 x op1) modulo p) a 32 byte multi-precision number,
+  * where p is secp256k1's field prime. This gives the same result as
+  * bigMultiplyModP(r, op1, op1), but is faster.
+  * \param r The 32 byte result will be written into here.
+  * \param op1 The 32 byte operand to square. This may alias r.
+  */
+void bigSquareModP(BigNum256 r, BigNum256 op1)
+{
+	ScratchMark mark;
+	uint8_t *full_r;
+
+	mark = scratchMark();
+	full_r = scratchAllocate(64);
+	bigSquareVariableSizeNoModulo(full_r, op1, 32);
+	reduceModP(r, full_r);
+	scratchRelease(mark);
+}
+
+#endif // #ifndef BIGNUM256_32BIT_LIMBS
+
+#ifdef BIGNUM256_32BIT_LIMBS
+
+/** Add (r = op1 + op2) two multi-precision numbers, stored as arrays of 32
+  * bit limbs, ignoring the current prime finite field.
+  * \param r The result will be written into here.
+  * \param op1 The first operand to add. This may alias r.
+  * \param op2 The second operand to add. This may alias r or op1.
+  * \param size Size, in number of limbs, of the operands and the result.
+  * \return 1 if carry occurred, 0 if no carry occurred.
+  */
+static HOT_FUNCTION uint32_t limbAdd(uint32_t *r, const uint32_t *op1, const uint32_t *op2, uint8_t size)
+{
+	uint64_t partial;
+	uint32_t carry;
+	uint8_t i;
+
+	carry = 0;
+	for (i = 0; i < size; i++)
+	{
+		partial = (uint64_t)op1[i] + (uint64_t)op2[i] + (uint64_t)carry;
+		r[i] = (uint32_t)partial;
+		carry = (uint32_t)(partial >> 32);
+	}
+	return carry;
+}
+
+/** Subtract (r = op1 - op2) two multi-precision numbers, stored as arrays of
+  * 32 bit limbs, ignoring the current prime finite field.
+  * \param r The result will be written into here.
+  * \param op1 The operand to subtract from. This may alias r.
+  * \param op2 The operand to subtract off op1. This may alias r or op1.
+  * \param size Size, in number of limbs, of the operands and the result.
+  * \return 1 if borrow occurred, 0 if no borrow occurred.
+  */
+static HOT_FUNCTION uint32_t limbSubtract(uint32_t *r, const uint32_t *op1, const uint32_t *op2, uint8_t size)
+{
+	uint64_t partial;
+	uint32_t borrow;
+	uint8_t i;
+
+	borrow = 0;
+	for (i = 0; i < size; i++)
+	{
+		partial = (uint64_t)op1[i] - (uint64_t)op2[i] - (uint64_t)borrow;
+		r[i] = (uint32_t)partial;
+		borrow = (uint32_t)(partial >> 32) & 1;
+	}
+	return borrow;
+}
+
+/** Copy either op1 or op2 into r, depending on a mask, in a way which
+  * doesn't depend on the mask value.
+  * \param r The 8 limb result will be written into here. This may alias op1
+  *          or op2.
+  * \param op1 The 8 limb number which will be copied if mask is all ones.
+  * \param op2 The 8 limb number which will be copied if mask is all zeroes.
+  * \param mask Either 0xffffffff or 0.
+  */
+static void limbSelect(uint32_t *r, const uint32_t *op1, const uint32_t *op2, uint32_t mask)
+{
+	uint8_t i;
+
+	for (i = 0; i < LIMBS256; i++)
+	{
+		r[i] = (op1[i] & mask) | (op2[i] & ~mask);
+	}
+}
+
+/** Compute op1 modulo #n, where op1 is an 8 limb multi-precision number.
+  * See bigModulo() for more details.
+  * \param r The 8 limb result will be written into here.
+  * \param op1 The 8 limb operand to apply the modulo to. This may alias r.
+  */
+static HOT_FUNCTION void limbModulo(uint32_t *r, const uint32_t *op1)
+{
+	uint32_t temp[LIMBS256];
+	uint32_t borrow;
+
+	borrow = limbSubtract(temp, op1, n_limbs, LIMBS256);
+	// If there was no borrow, then op1 >= n, so op1 - n should be selected.
+	limbSelect(r, temp, op1, borrow - 1);
+}
+
+/** Multiplies (r = op1 x op2) two multi-precision numbers of arbitrary size,
+  * stored as arrays of 32 bit limbs, ignoring the current prime finite field.
+  * \param r The result will be written into here. The size of the result (in
+  *          number of limbs) will be op1_size + op2_size.
+  * \param op1 The first operand to multiply. This cannot alias r.
+  * \param op1_size The size, in number of limbs, of op1.
+  * \param op2 The second operand to multiply. This cannot alias r, but it can
+  *            alias op1.
+  * \param op2_size The size, in number of limbs, of op2.
+  * \warning This is the speed bottleneck when BIGNUM256_32BIT_LIMBS is
+  *          defined. To speed it up, reimplement it in assembly and define
+  *          PLATFORM_SPECIFIC_LIMBMULTIPLY; the PIC32 and LPC11Uxx ports
+  *          do this (see pic32/bignum256_mips32.S and
+  *          lpc11uxx/bignum256_armv6m.S). Those implementations go in RAM
+  *          if ENABLE_RAM_FUNCTIONS is defined (see #RAM_FUNCTION).
+  */
+#ifdef PLATFORM_SPECIFIC_LIMBMULTIPLY
+extern RAM_FUNCTION void limbMultiplyNoModulo(uint32_t *r, const uint32_t *op1, uint8_t op1_size, const uint32_t *op2, uint8_t op2_size);
+#else
+static HOT_FUNCTION void limbMultiplyNoModulo(uint32_t *r, const uint32_t *op1, uint8_t op1_size, const uint32_t *op2, uint8_t op2_size)
+{
+	uint64_t partial;
+	uint32_t cached_op1;
+	uint32_t carry;
+	uint8_t i;
+	uint8_t j;
+
+	memset(r, 0, (size_t)((op1_size + op2_size) * sizeof(uint32_t)));
+	// This is the same "schoolbook" method that
+	// bigMultiplyVariableSizeNoModulo() uses, except that each partial
+	// product is 64 bits wide. (2 ^ 32 - 1) ^ 2 + 2 * (2 ^ 32 - 1) is
+	// exactly 2 ^ 64 - 1, so partial can never overflow.
+	for (i = 0; i < op1_size; i++)
+	{
+		cached_op1 = op1[i];
+		carry = 0;
+		for (j = 0; j < op2_size; j++)
+		{
+			partial = (uint64_t)cached_op1 * (uint64_t)op2[j] + (uint64_t)r[i + j] + (uint64_t)carry;
+			r[i + j] = (uint32_t)partial;
+			carry = (uint32_t)(partial >> 32);
+		}
+		r[i + op2_size] = carry;
+	}
+}
+#endif // #ifdef PLATFORM_SPECIFIC_LIMBMULTIPLY
+
+#ifndef PLATFORM_SPECIFIC_LIMBMULTIPLY
+
+/** Squares (r = op1 x op1) a multi-precision number of arbitrary size
+  * which is stored as an array of 32 bit limbs, ignoring the current prime
+  * finite field. This uses the same method as
+  * bigSquareVariableSizeNoModulo(): each cross product is only computed
+  * once, then the sum of cross products is doubled and the squares are
+  * added.
+  * \param r The result will be written into here. The size of the result (in
+  *          number of limbs) will be 2 x op1_size.
+  * \param op1 The operand to square. This cannot alias r.
+  * \param op1_size The size, in number of limbs, of op1.
+  */
+static HOT_FUNCTION void limbSquareNoModulo(uint32_t *r, const uint32_t *op1, uint8_t op1_size)
+{
+	uint64_t partial;
+	uint32_t cached_op1;
+	uint32_t carry;
+	uint32_t temp;
+	uint8_t i;
+	uint8_t j;
+
+	memset(r, 0, (size_t)((op1_size + op1_size) * sizeof(uint32_t)));
+	for (i = 0; i < op1_size; i++)
+	{
+		cached_op1 = op1[i];
+		carry = 0;
+		for (j = (uint8_t)(i + 1); j < op1_size; j++)
+		{
+			partial = (uint64_t)cached_op1 * (uint64_t)op1[j] + (uint64_t)r[i + j] + (uint64_t)carry;
+			r[i + j] = (uint32_t)partial;
+			carry = (uint32_t)(partial >> 32);
+		}
+		r[i + op1_size] = carry;
+	}
+	carry = 0;
+	for (i = 0; i < (uint8_t)(op1_size + op1_size); i++)
+	{
+		temp = r[i];
+		r[i] = (temp << 1) | carry;
+		carry = temp >> 31;
+	}
+	carry = 0;
+	for (i = 0; i < op1_size; i++)
+	{
+		partial = (uint64_t)op1[i] * (uint64_t)op1[i];
+		temp = (uint32_t)partial;
+		r[2 * i] += carry;
+		carry = (uint32_t)(r[2 * i] < carry);
+		r[2 * i] += temp;
+		carry += (uint32_t)(r[2 * i] < temp);
+		temp = (uint32_t)(partial >> 32);
+		r[2 * i + 1] += carry;
+		carry = (uint32_t)(r[2 * i + 1] < carry);
+		r[2 * i + 1] += temp;
+		carry += (uint32_t)(r[2 * i + 1] < temp);
+	}
+#ifdef TEST
+	assert(carry == 0);
+#endif // #ifdef TEST
+}
+
+#else
+
+/** Squares (r = op1 x op1) a multi-precision number of arbitrary size
+  * which is stored as an array of 32 bit limbs, ignoring the current prime
+  * finite field. The platform-specific limbMultiplyNoModulo() is probably
+  * faster than a squaring routine written in C, so this just uses it.
+  * \param r The result will be written into here. The size of the result (in
+  *          number of limbs) will be 2 x op1_size.
+  * \param op1 The operand to square. This cannot alias r.
+  * \param op1_size The size, in number of limbs, of op1.
+  */
+static HOT_FUNCTION void limbSquareNoModulo(uint32_t *r, const uint32_t *op1, uint8_t op1_size)
+{
+	limbMultiplyNoModulo(r, op1, op1_size, op1, op1_size);
+}
+
+#endif // #ifndef PLATFORM_SPECIFIC_LIMBMULTIPLY
+
+/** Reduce a 16 limb multi-precision number (typically a product) modulo #n.
+  * \param r The 8 limb result will be written into here.
+  * \param full_r The 16 limb number to reduce. This will be overwritten.
+  */
+static HOT_FUNCTION void limbReduce(uint32_t *r, uint32_t *full_r)
+{
+	uint32_t temp[2 * LIMBS256];
+	uint32_t carry;
+	uint8_t remaining;
+	uint8_t high_size;
+	uint8_t temp_size;
+	uint8_t i;
+
+	// The reduction is the same as in the byte-oriented version of
+	// bigMultiply(): the upper part of full_r is multiplied by complement_n
+	// and added to the lower part, which is equivalent to subtracting some
+	// multiple of n. Unlike the byte-oriented version, this keeps track of
+	// the carry out of the lower 256 bits on the last pass, so that the
+	// final result is always correct.
+	// remaining denotes the maximum number of possible non-zero limbs left
+	// in full_r. The number of loop iterations depends only on
+	// size_complement_n_limbs, so this is still constant time.
+	remaining = 2 * LIMBS256;
+	while (true)
+	{
+		high_size = (uint8_t)(remaining - LIMBS256);
+		limbMultiplyNoModulo(\
+			temp,
+			complement_n_limbs, size_complement_n_limbs,
+			&(full_r[LIMBS256]), high_size);
+		memset(&(full_r[LIMBS256]), 0, high_size * sizeof(uint32_t));
+		temp_size = (uint8_t)(size_complement_n_limbs + high_size);
+		if (temp_size > LIMBS256)
+		{
+			// Because the most significant limb of complement_n is
+			// < 2 ^ 31, temp < 2 ^ (32 * temp_size - 1) and so the sum
+			// always fits in temp_size limbs.
+			carry = limbAdd(full_r, full_r, temp, temp_size);
+#ifdef TEST
+			assert(carry == 0);
+#endif // #ifdef TEST
+			remaining = temp_size;
+		}
+		else
+		{
+			for (i = temp_size; i < LIMBS256; i++)
+			{
+				temp[i] = 0;
+			}
+			carry = limbAdd(full_r, full_r, temp, LIMBS256);
+			break;
+		}
+	}
+	// full_r + carry * 2 ^ 256 is the (partially) reduced result. Since
+	// 2 ^ 256 = complement_n modulo n, the carry can be folded in by adding
+	// complement_n. If carry is 1, the lower 256 bits must be small, so this
+	// addition will never overflow.
+	for (i = 0; i < LIMBS256; i++)
+	{
+		temp[i] = complement_n_limbs[i] & (uint32_t)(-(int32_t)carry);
+	}
+	limbAdd(full_r, full_r, temp, LIMBS256);
+	// As long as n > 2 ^ 255, at most one subtraction is required to ensure
+	// that r < n.
+	limbModulo(r, full_r);
+}
+
+/** Multiplies (r = (op1 x op2) modulo #n) two 8 limb multi-precision
+  * numbers under the current prime finite field.
+  * \param r The 8 limb result will be written into here.
+  * \param op1 The first 8 limb operand to multiply. This may alias r.
+  * \param op2 The second 8 limb operand to multiply. This may alias r or
+  *            op1.
+  */
+static HOT_FUNCTION void limbMultiply(uint32_t *r, const uint32_t *op1, const uint32_t *op2)
+{
+	uint32_t full_r[2 * LIMBS256];
+
+	limbMultiplyNoModulo(full_r, op1, LIMBS256, op2, LIMBS256);
+	limbReduce(r, full_r);
+}
+
+/** Squares (r = (op1 x op1) modulo #n) an 8 limb multi-precision number
+  * under the current prime finite field.
+  * \param r The 8 limb result will be written into here.
+  * \param op1 The 8 limb operand to square. This may alias r.
+  */
+static HOT_FUNCTION void limbSquare(uint32_t *r, const uint32_t *op1)
+{
+	uint32_t full_r[2 * LIMBS256];
+
+	limbSquareNoModulo(full_r, op1, LIMBS256);
+	limbReduce(r, full_r);
+}
+
+/** Compute op1 modulo #n, where op1 is a 32 byte multi-precision number.
+  * The "modulo" part makes it sound like this function does division
+  * somewhere, but since #n is also a 32 byte multi-precision number, all
+  * this function actually does is subtract #n off op1 if op1 is >= #n.
+  * \param r The 32 byte result will be written into here.
+  * \param op1 The 32 byte operand to apply the modulo to. This may alias r.
+  */
+void bigModulo(BigNum256 r, BigNum256 op1)
+{
+	uint32_t op1_limbs[LIMBS256];
+
+	bytesToLimbs(op1_limbs, op1, 32);
+	limbModulo(op1_limbs, op1_limbs);
+	limbsToBig(r, op1_limbs);
+}
+
+/** Add (r = (op1 + op2) modulo #n) two 32 byte multi-precision numbers under
+  * the current prime finite field.
+  * \param r The 32 byte result will be written into here.
+  * \param op1 The first 32 byte operand to add. This may alias r.
+  * \param op2 The second 32 byte operand to add. This may alias r or op1.
+  * \warning op1 and op2 must both be < #n.
+  */
+void bigAdd(BigNum256 r, BigNum256 op1, BigNum256 op2)
+{
+	uint32_t op1_limbs[LIMBS256];
+	uint32_t op2_limbs[LIMBS256];
+	uint32_t carry;
+	uint32_t borrow;
+
+#ifdef TEST
+	assert(bigCompare(op1, n) == BIGCMP_LESS);
+	assert(bigCompare(op2, n) == BIGCMP_LESS);
+#endif // #ifdef TEST
+	bytesToLimbs(op1_limbs, op1, 32);
+	bytesToLimbs(op2_limbs, op2, 32);
+	carry = limbAdd(op1_limbs, op1_limbs, op2_limbs, LIMBS256);
+	borrow = limbSubtract(op2_limbs, op1_limbs, n_limbs, LIMBS256);
+	// n should be subtracted if the addition overflowed or if the sum is
+	// >= n (i.e. no borrow occurred when subtracting n).
+	limbSelect(op1_limbs, op2_limbs, op1_limbs, (uint32_t)(-(int32_t)(carry | (borrow ^ 1))));
+	limbsToBig(r, op1_limbs);
+}
+
+/** Subtract (r = (op1 - op2) modulo #n) two 32 byte multi-precision numbers
+  * under the current prime finite field.
+  * \param r The 32 byte result will be written into here.
+  * \param op1 The 32 byte operand to subtract from. This may alias r.
+  * \param op2 The 32 byte operand to sutract off op1. This may alias r or
+  *            op1.
+  * \warning op1 and op2 must both be < #n.
+  */
+void bigSubtract(BigNum256 r, BigNum256 op1, BigNum256 op2)
+{
+	uint32_t op1_limbs[LIMBS256];
+	uint32_t op2_limbs[LIMBS256];
+	uint32_t mask;
+	uint8_t i;
+
+#ifdef TEST
+	assert(bigCompare(op1, n) == BIGCMP_LESS);
+	assert(bigCompare(op2, n) == BIGCMP_LESS);
+#endif // #ifdef TEST
+	bytesToLimbs(op1_limbs, op1, 32);
+	bytesToLimbs(op2_limbs, op2, 32);
+	mask = (uint32_t)(-(int32_t)limbSubtract(op1_limbs, op1_limbs, op2_limbs, LIMBS256));
+	// If a borrow occurred, add n back on.
+	for (i = 0; i < LIMBS256; i++)
+	{
+		op2_limbs[i] = n_limbs[i] & mask;
+	}
+	limbAdd(op1_limbs, op1_limbs, op2_limbs, LIMBS256);
+	limbsToBig(r, op1_limbs);
+}
+
+/** Multiplies (r = (op1 x op2) modulo #n) two 32 byte multi-precision
+  * numbers under the current prime finite field.
+  * \param r The 32 byte result will be written into here.
+  * \param op1 The first 32 byte operand to multiply. This may alias r.
+  * \param op2 The second 32 byte operand to multiply. This may alias r or
+  *            op1.
+  */
+void bigMultiply(BigNum256 r, BigNum256 op1, BigNum256 op2)
+{
+	uint32_t op1_limbs[LIMBS256];
+	uint32_t op2_limbs[LIMBS256];
+
+	bytesToLimbs(op1_limbs, op1, 32);
+	bytesToLimbs(op2_limbs, op2, 32);
+	limbMultiply(op1_limbs, op1_limbs, op2_limbs);
+	limbsToBig(r, op1_limbs);
+}
+
+/** Squares (r = (op1 x op1) modulo #n) a 32 byte multi-precision number
+  * under the current prime finite field. This gives the same result as
+  * bigMultiply(r, op1, op1), but is faster.
+  * \param r The 32 byte result will be written into here.
+  * \param op1 The 32 byte operand to square. This may alias r.
+  */
+void bigSquare(BigNum256 r, BigNum256 op1)
+{
+	uint32_t op1_limbs[LIMBS256];
+
+	bytesToLimbs(op1_limbs, op1, 32);
+	limbSquare(op1_limbs, op1_limbs);
+	limbsToBig(r, op1_limbs);
+}
+
+/** Compute r = lo + hi x (2 ^ 32 + 977), where lo is an 8 limb
+  * multi-precision number and hi is a multi-precision number of arbitrary
+  * size, both stored as arrays of 32 bit limbs. See the byte-oriented
+  * version of foldModP() for more details.
+  * \param r The result will be written into here.
+  * \param r_size The size, in number of limbs, of r. Any carry out of the
+  *               most significant limb will be discarded.
+  * \param lo The 8 limb lower part. This may alias r, but only if
+  *           r_size <= 8.
+  * \param hi The upper part. This cannot alias r, unless r_size <= 8.
+  * \param hi_size The size, in number of limbs, of hi.
+  */
+static HOT_FUNCTION void limbFoldModP(uint32_t *r, uint8_t r_size, const uint32_t *lo, const uint32_t *hi, uint8_t hi_size)
+{
+	uint64_t column;
+	uint8_t i;
+
+	// 2 ^ 32 is a shift of 1 limb, so each column sum is at most
+	// (2 ^ 32 - 1) x (1 + 977 + 1) plus a carry, which fits in 64 bits.
+	column = 0;
+	for (i = 0; i < r_size; i++)
+	{
+		if (i < LIMBS256)
+		{
+			column += (uint64_t)lo[i];
+		}
+		if (i < hi_size)
+		{
+			column += (uint64_t)hi[i] * 977;
+		}
+		if ((i >= 1) && (i < hi_size + 1))
+		{
+			column += (uint64_t)hi[i - 1];
+		}
+		r[i] = (uint32_t)column;
+		column >>= 32;
+	}
+}
+
+/** Reduce a 16 limb multi-precision number (typically a product) modulo p,
+  * where p is secp256k1's field prime 2 ^ 256 - 2 ^ 32 - 977. See the
+  * byte-oriented version of reduceModP() for more details.
+  * \param r The 32 byte result will be written into here.
+  * \param full_r The 16 limb number to reduce. This will be overwritten.
+  */
+static HOT_FUNCTION void limbReduceModP(BigNum256 r, uint32_t *full_r)
+{
+	uint32_t folded[LIMBS256 + 2];
+	uint32_t sum[LIMBS256];
+	uint32_t carry;
+
+	// The bounds here are the same as in the byte-oriented version of
+	// reduceModP(): folded < 2 ^ 289, then full_r < 2 ^ 256 + 2 ^ 66,
+	// then full_r < 2 ^ 256.
+	limbFoldModP(folded, LIMBS256 + 2, full_r, &(full_r[LIMBS256]), LIMBS256);
+	limbFoldModP(full_r, LIMBS256 + 1, folded, &(folded[LIMBS256]), 2);
+	limbFoldModP(full_r, LIMBS256, full_r, &(full_r[LIMBS256]), 1);
+	// full_r >= p if and only if adding 2 ^ 32 + 977 to it overflows.
+	memset(folded, 0, sizeof(folded));
+	folded[0] = 977;
+	folded[1] = 1;
+	carry = limbAdd(sum, full_r, folded, LIMBS256);
+	limbSelect(sum, sum, full_r, (uint32_t)(-(int32_t)carry));
+	limbsToBig(r, sum);
+}
+
+/** Multiplies (r = (op1 x op2) modulo p) two 32 byte multi-precision
+  * numbers, where p is secp256k1's field prime 2 ^ 256 - 2 ^ 32 - 977.
+  * This gives the same result as bigMultiply() does when the field has been
+  * set to p, but the reduction takes advantage of the special form of p, so
+  * it's quite a bit faster. This doesn't depend on the current prime finite
+  * field, so it can be used even if bigSetField() hasn't been called.
+  * \param r The 32 byte result will be written into here.
+  * \param op1 The first 32 byte operand to multiply. This may alias r.
+  * \param op2 The second 32 byte operand to multiply. This may alias r or
+  *            op1.
+  */
+void bigMultiplyModP(BigNum256 r, BigNum256 op1, BigNum256 op2)
+{
+	uint32_t op1_limbs[LIMBS256];
+	uint32_t op2_limbs[LIMBS256];
+	uint32_t full_r[2 * LIMBS256];
+
+	bytesToLimbs(op1_limbs, op1, 32);
+	bytesToLimbs(op2_limbs, op2, 32);
+	limbMultiplyNoModulo(full_r, op1_limbs, LIMBS256, op2_limbs, LIMBS256);
+	limbReduceModP(r, full_r);
+}
+
+/** Squares (r = (op1 x op1) modulo p) a 32 byte multi-precision number,
+  * where p is secp256k1's field prime. This gives the same result as
+  * bigMultiplyModP(r, op1, op1), but is faster.
+  * \param r The 32 byte result will be written into here.
+  * \param op1 The 32 byte operand to square. This may alias r.
+  */
+void bigSquareModP(BigNum256 r, BigNum256 op1)
+{
+	uint32_t op1_limbs[LIMBS256];
+	uint32_t full_r[2 * LIMBS256];
+
+	bytesToLimbs(op1_limbs, op1, 32);
+	limbSquareNoModulo(full_r, op1_limbs, LIMBS256);
+	limbReduceModP(r, full_r);
+}
+
+/** Compute the modular inverse of a 32 byte multi-precision number under
+  * the current prime finite field (i.e. find r such that
+  * (r x op1) modulo #n = 1).
+  * \param r The 32 byte result will be written into here.
+  * \param op1 The 32 byte operand to find the inverse of. This may alias r.
+  */
+void bigInvert(BigNum256 r, BigNum256 op1)
+{
+	uint32_t temp[LIMBS256];
+	uint32_t result[LIMBS256];
+	uint32_t limb_of_n_minus_2;
+	uint32_t bit_of_n_minus_2;
+	uint32_t *lookup[2];
+	uint8_t i;
+	uint8_t j;
+
+	// This is the same Montgomery ladder as the byte-oriented version of
+	// bigInvert(), except that the intermediate values stay in limb form
+	// for the whole exponentiation.
+	bytesToLimbs(temp, op1, 32);
+	memset(result, 0, sizeof(result));
+	result[0] = 1;
+	lookup[0] = result;
+	lookup[1] = temp;
+	for (i = LIMBS256 - 1; i < LIMBS256; i--)
+	{
+		limb_of_n_minus_2 = n_limbs[i];
+		if (i == 0)
+		{
+			limb_of_n_minus_2 = limb_of_n_minus_2 - 2;
+		}
+		for (j = 0; j < 32; j++)
+		{
+			bit_of_n_minus_2 = limb_of_n_minus_2 >> 31;
+			limb_of_n_minus_2 = limb_of_n_minus_2 << 1;
+			limbMultiply(lookup[1 - bit_of_n_minus_2], result, temp);
+			limbSquare(lookup[bit_of_n_minus_2], lookup[bit_of_n_minus_2]);
+		}
+	}
+	limbsToBig(r, result);
+}
+
+/** Do Montgomery reduction (r = full_r x 2 ^ -256 modulo #n) on a 16 limb
+  * multi-precision number. See the byte-oriented version of
+  * bigMontgomeryReduce() for more details; this does exactly 8 x 8 limb
+  * multiplications.
+  * \param r The 8 limb result will be written into here.
+  * \param full_r The 16 limb number to reduce. This will be overwritten.
+  * \warning full_r must be < #n x 2 ^ 256.
+  */
+static HOT_FUNCTION void limbMontgomeryReduce(uint32_t *r, uint32_t *full_r)
+{
+	uint64_t partial;
+	uint32_t temp[LIMBS256];
+	uint32_t m;
+	uint32_t carry;
+	uint32_t high_carry;
+	uint32_t borrow;
+	uint8_t i;
+	uint8_t j;
+
+	high_carry = 0;
+	for (i = 0; i < LIMBS256; i++)
+	{
+		m = full_r[i] * montgomery_n_prime;
+		carry = 0;
+		for (j = 0; j < LIMBS256; j++)
+		{
+			partial = (uint64_t)m * (uint64_t)n_limbs[j] + (uint64_t)full_r[i + j] + (uint64_t)carry;
+			full_r[i + j] = (uint32_t)partial;
+			carry = (uint32_t)(partial >> 32);
+		}
+		partial = (uint64_t)full_r[i + LIMBS256] + (uint64_t)carry + (uint64_t)high_carry;
+		full_r[i + LIMBS256] = (uint32_t)partial;
+		high_carry = (uint32_t)(partial >> 32);
+	}
+	borrow = limbSubtract(temp, &(full_r[LIMBS256]), n_limbs, LIMBS256);
+	// Select full_r - n if there was a carry or if there was no borrow.
+	limbSelect(r, temp, &(full_r[LIMBS256]), (uint32_t)(-(int32_t)(high_carry | (borrow ^ 1))));
+}
+
+/** Multiplies (r = op1 x op2 x 2 ^ -256 modulo #n) two 32 byte
+  * multi-precision numbers. See the byte-oriented version of
+  * bigMultiplyMontgomery() for more details.
+  * \param r The 32 byte result will be written into here.
+  * \param op1 The first 32 byte operand to multiply. This may alias r.
+  * \param op2 The second 32 byte operand to multiply. This may alias r or
+  *            op1.
+  * \warning op1 x op2 must be < #n x 2 ^ 256; this is true if either
+  *          operand is < #n.
+  */
+void bigMultiplyMontgomery(BigNum256 r, BigNum256 op1, BigNum256 op2)
+{
+	uint32_t op1_limbs[LIMBS256];
+	uint32_t op2_limbs[LIMBS256];
+	uint32_t full_r[2 * LIMBS256];
+
+	bytesToLimbs(op1_limbs, op1, 32);
+	bytesToLimbs(op2_limbs, op2, 32);
+	limbMultiplyNoModulo(full_r, op1_limbs, LIMBS256, op2_limbs, LIMBS256);
+	limbMontgomeryReduce(op1_limbs, full_r);
+	limbsToBig(r, op1_limbs);
+}
+
+/** Squares (r = op1 x op1 x 2 ^ -256 modulo #n) a 32 byte multi-precision
+  * number. This gives the same result as bigMultiplyMontgomery(r, op1, op1),
+  * but is faster.
+  * \param r The 32 byte result will be written into here.
+  * \param op1 The 32 byte operand to square. This may alias r.
+  * \warning op1 must be < #n.
+  */
+void bigSquareMontgomery(BigNum256 r, BigNum256 op1)
+{
+	uint32_t op1_limbs[LIMBS256];
+	uint32_t full_r[2 * LIMBS256];
+
+	bytesToLimbs(op1_limbs, op1, 32);
+	limbSquareNoModulo(full_r, op1_limbs, LIMBS256);
+	limbMontgomeryReduce(op1_limbs, full_r);
+	limbsToBig(r, op1_limbs);
+}
+
+/** Convert (r = op1 x 2 ^ -256 modulo #n) a 32 byte multi-precision number
+  * out of the Montgomery domain.
+  * \param r The 32 byte result will be written into here.
+  * \param op1 The 32 byte operand to convert. This may alias r.
+  */
+void bigFromMontgomery(BigNum256 r, BigNum256 op1)
+{
+	uint32_t full_r[2 * LIMBS256];
+
+	bytesToLimbs(full_r, op1, 32);
+	memset(&(full_r[LIMBS256]), 0, LIMBS256 * sizeof(uint32_t));
+	limbMontgomeryReduce(full_r, full_r);
+	limbsToBig(r, full_r);
+}
+
+#endif // #ifdef BIGNUM256_32BIT_LIMBS
+
+/** Convert (r = op1 x 2 ^ 256 modulo #n) a 32 byte multi-precision number
+  * into the Montgomery domain. op1 doesn't need to be fully reduced.
+  * \param r The 32 byte result will be written into here.
+  * \param op1 The 32 byte operand to convert. This may alias r.
+  * \warning bigSetMontgomery() must have been called first.
+  */
+void bigToMontgomery(BigNum256 r, BigNum256 op1)
+{
+	bigMultiplyMontgomery(r, op1, montgomery_r_squared);
+}
+
+/** Square (r = op1 ^ (2 ^ count) modulo p) a 32 byte multi-precision
+  * number repeatedly, where p is secp256k1's field prime.
+  * \param r The 32 byte result will be written into here.
+  * \param op1 The 32 byte operand to square. This may alias r.
+  * \param count The number of times to square op1. This must be > 0.
+  */
+static void bigSquareModPRepeatedly(BigNum256 r, BigNum256 op1, uint8_t count)
+{
+	uint8_t i;
+
+	bigSquareModP(r, op1);
+	for (i = 1; i < count; i++)
+	{
+		bigSquareModP(r, r);
+	}
+}
+
+/** Compute op1 ^ (2 ^ k - 1) modulo p for k = 2, 22 and 223, where p is
+  * secp256k1's field prime. These are the common start of the fixed
+  * addition chains used by bigInvertModP() and bigSqrtModP(), both of which
+  * take advantage of the long runs of 1s in the binary representation of
+  * their exponents. In the comments below, xk denotes op1 ^ (2 ^ k - 1)
+  * (i.e. op1 raised to a power which has k 1s in its binary
+  * representation). The chain needs 222 squarings and 11 multiplications.
+  * \param x2 op1 ^ 3 will be written here.
+  * \param x22 op1 ^ (2 ^ 22 - 1) will be written here.
+  * \param x223 op1 ^ (2 ^ 223 - 1) will be written here.
+  * \param op1 The 32 byte operand. This must not alias any of the outputs.
+  */
+static void powerChainModP(BigNum256 x2, BigNum256 x22, BigNum256 x223, BigNum256 op1)
+{
+	uint8_t x3[32];
+	uint8_t x44[32];
+	uint8_t temp[32];
+	uint8_t t[32];
+
+	bigSquareModP(t, op1);
+	bigMultiplyModP(x2, t, op1);
+	bigSquareModP(t, x2);
+	bigMultiplyModP(x3, t, op1);
+	bigSquareModPRepeatedly(t, x3, 3);
+	bigMultiplyModP(t, t, x3); // t = x6
+	bigSquareModPRepeatedly(t, t, 3);
+	bigMultiplyModP(t, t, x3); // t = x9
+	bigSquareModPRepeatedly(t, t, 2);
+	bigMultiplyModP(temp, t, x2); // temp = x11
+	bigSquareModPRepeatedly(t, temp, 11);
+	bigMultiplyModP(x22, t, temp);
+	bigSquareModPRepeatedly(t, x22, 22);
+	bigMultiplyModP(x44, t, x22);
+	bigSquareModPRepeatedly(t, x44, 44);
+	bigMultiplyModP(temp, t, x44); // temp = x88
+	bigSquareModPRepeatedly(t, temp, 88);
+	bigMultiplyModP(t, t, temp); // t = x176
+	bigSquareModPRepeatedly(t, t, 44);
+	bigMultiplyModP(t, t, x44); // t = x220
+	bigSquareModPRepeatedly(t, t, 3);
+	bigMultiplyModP(x223, t, x3);
+}
+
+/** Compute the modular inverse of a 32 byte multi-precision number modulo
+  * p, where p is secp256k1's field prime 2 ^ 256 - 2 ^ 32 - 977 (i.e. find
+  * r such that (r x op1) modulo p = 1). This gives the same result as
+  * bigInvert() does when the field has been set to p, but it's about twice
+  * as fast.
+  *
+  * Like bigInvert(), this computes op1 ^ (p - 2). However, instead of
+  * going through the exponent one bit at a time, it uses a fixed addition
+  * chain (see powerChainModP()). The chain needs 255 squarings and only 15
+  * multiplications. The sequence of operations doesn't depend on op1, so
+  * this is constant time.
+  *
+  * This doesn't depend on the current prime finite field, so it can be used
+  * even if bigSetField() hasn't been called.
+  * \param r The 32 byte result will be written into here.
+  * \param op1 The 32 byte operand to find the inverse of. This may alias r.
+  */
+void bigInvertModP(BigNum256 r, BigNum256 op1)
+{
+	uint8_t x2[32];
+	uint8_t x22[32];
+	uint8_t t[32];
+
+	// r isn't written to until the end, so op1 can be used directly.
+	powerChainModP(x2, x22, t, op1);
+	// p - 2 = 2 ^ 256 - 2 ^ 32 - 979. Its binary representation is 223 1s,
+	// followed by a 0, then 22 1s, then 0000101101.
+	bigSquareModPRepeatedly(t, t, 23);
+	bigMultiplyModP(t, t, x22);
+	bigSquareModPRepeatedly(t, t, 5);
+	bigMultiplyModP(t, t, op1);
+	bigSquareModPRepeatedly(t, t, 3);
+	bigMultiplyModP(t, t, x2);
+	bigSquareModPRepeatedly(t, t, 2);
+	bigMultiplyModP(r, t, op1);
+}
+
+/** Compute a square root of a 32 byte multi-precision number modulo p,
+  * where p is secp256k1's field prime (i.e. find r such that
+  * (r x r) modulo p = op1). Because p = 3 (mod 4), this is just
+  * op1 ^ ((p + 1) / 4). That is computed with the same kind of fixed
+  * addition chain as bigInvertModP(), which needs 253 squarings and 13
+  * multiplications, instead of one squaring and (usually) one
+  * multiplication per bit of the exponent. The sequence of operations
+  * doesn't depend on op1, so this is constant time.
+  *
+  * This doesn't depend on the current prime finite field, so it can be used
+  * even if bigSetField() hasn't been called.
+  * \param r The 32 byte result will be written into here.
+  * \param op1 The 32 byte operand to find the square root of. This may
+  *            alias r.
+  * \warning If op1 is not a quadratic residue modulo p, it doesn't have a
+  *          square root, and r will be garbage. The caller must check this
+  *          by squaring r.
+  */
+void bigSqrtModP(BigNum256 r, BigNum256 op1)
+{
+	uint8_t x2[32];
+	uint8_t x22[32];
+	uint8_t t[32];
+
+	powerChainModP(x2, x22, t, op1);
+	// (p + 1) / 4 = 2 ^ 254 - 2 ^ 30 - 244. Its binary representation is
+	// 223 1s, followed by a 0, then 22 1s, then 00001100.
+	bigSquareModPRepeatedly(t, t, 23);
+	bigMultiplyModP(t, t, x22);
+	bigSquareModPRepeatedly(t, t, 6);
+	bigMultiplyModP(t, t, x2);
+	bigSquareModPRepeatedly(r, t, 2);
+}
+
+/** The 2s complement of secp256k1's field prime p, i.e. 2 ^ 32 + 977. */
+static const uint8_t complement_p[5] = {0xd1, 0x03, 0x00, 0x00, 0x01};
+
+/** Add or subtract (r = r +/- (2 ^ 32 + 977)), but only if mask is 0xff.
+  * If mask is 0, this does nothing. Since secp256k1's field prime p is
+  * 2 ^ 256 - (2 ^ 32 + 977), adding or subtracting 2 ^ 32 + 977 is how a
+  * carry or borrow out of the most significant byte is folded back in
+  * modulo p. The same amount of work is done regardless of the value of
+  * mask.
+  * \param r The number to add to or subtract from. The result will also be
+  *          written into here.
+  * \param size The size, in number of bytes, of r. This must be >= 5. Any
+  *             carry or borrow out of the most significant byte is
+  *             returned.
+  * \param mask 0xff to add or subtract, 0 to do nothing.
+  * \param do_subtract 0 to add, 1 to subtract.
+  * \return The carry or borrow out of the most significant byte.
+  */
+static uint8_t foldCarryModP(uint8_t *r, uint8_t size, uint8_t mask, uint8_t do_subtract)
+{
+	uint16_t partial;
+	uint8_t carry;
+	uint8_t i;
+
+	carry = 0;
+	for (i = 0; i < 5; i++)
+	{
+		if (do_subtract)
+		{
+			partial = (uint16_t)((uint16_t)r[i] - (uint16_t)(complement_p[i] & mask) - (uint16_t)carry);
+			carry = (uint8_t)((uint8_t)(partial >> 8) & 1);
+		}
+		else
+		{
+			partial = (uint16_t)((uint16_t)r[i] + (uint16_t)(complement_p[i] & mask) + (uint16_t)carry);
+			carry = (uint8_t)(partial >> 8);
+		}
+		r[i] = (uint8_t)partial;
+	}
+	// Above byte 4, only the carry or borrow needs to be propagated.
+	for (i = 5; i < size; i++)
+	{
+		if (do_subtract)
+		{
+			partial = (uint16_t)((uint16_t)r[i] - (uint16_t)carry);
+			carry = (uint8_t)((uint8_t)(partial >> 8) & 1);
+		}
+		else
+		{
+			partial = (uint16_t)((uint16_t)r[i] + (uint16_t)carry);
+			carry = (uint8_t)(partial >> 8);
+		}
+		r[i] = (uint8_t)partial;
+	}
+	return carry;
+}
+
+/** Add (r = (op1 + op2) modulo p) two 32 byte multi-precision numbers,
+  * where p is secp256k1's field prime, with relaxed reduction. Unlike
+  * bigAdd(), the operands and the result only need to be < 2 ^ 256; they
+  * don't need to be < p. This saves the comparison with p, so it's a bit
+  * faster. The result is suitable as an operand to all the relaxed
+  * functions, bigMultiplyModP() and bigSquareModP(). Use bigReduceModP()
+  * before comparing the result with anything.
+  * This doesn't depend on the current prime finite field.
+  * \param r The 32 byte result will be written into here.
+  * \param op1 The first 32 byte operand to add. This may alias r.
+  * \param op2 The second 32 byte operand to add. This may alias r or op1.
+  */
+void bigAddModPRelaxed(BigNum256 r, BigNum256 op1, BigNum256 op2)
+{
+	uint8_t carry;
+
+	// 2 ^ 256 = 2 ^ 32 + 977 modulo p, so a carry out of the addition
+	// can be replaced by adding 2 ^ 32 + 977. That may carry again, but
+	// only if the sum was very close to 2 ^ 257. In that case, the value
+	// left in r is tiny, so the second fold can't carry.
+	carry = bigAddVariableSizeNoModulo(r, op1, op2, 32);
+	carry = foldCarryModP(r, 32, (uint8_t)(-(int)carry), 0);
+	// If there was a second carry, r is now < 2 ^ 32 + 977, so the second
+	// fold can't carry beyond byte 4.
+	foldCarryModP(r, 5, (uint8_t)(-(int)carry), 0);
+}
+
+/** Subtract (r = (op1 - op2) modulo p) two 32 byte multi-precision numbers,
+  * where p is secp256k1's field prime, with relaxed reduction. See
+  * bigAddModPRelaxed() for what "relaxed" means.
+  * This doesn't depend on the current prime finite field.
+  * \param r The 32 byte result will be written into here.
+  * \param op1 The 32 byte operand to subtract from. This may alias r.
+  * \param op2 The 32 byte operand to subtract off op1. This may alias r or
+  *            op1.
+  */
+void bigSubtractModPRelaxed(BigNum256 r, BigNum256 op1, BigNum256 op2)
+{
+	uint8_t borrow;
+
+	// This is the same as bigAddModPRelaxed(), except that a borrow is
+	// folded in by subtracting 2 ^ 32 + 977.
+	borrow = bigSubtractNoModulo(r, op1, op2);
+	borrow = foldCarryModP(r, 32, (uint8_t)(-(int)borrow), 1);
+	// If there was a second borrow, r is now >= 2 ^ 256 - (2 ^ 32 + 977),
+	// so all bits above bit 32 are set and the second fold can't borrow
+	// beyond byte 5.
+	foldCarryModP(r, 6, (uint8_t)(-(int)borrow), 1);
+}
+
+/** Fully reduce (r = op1 modulo p) a 32 byte multi-precision number, where
+  * p is secp256k1's field prime. This is used to turn the result of
+  * bigAddModPRelaxed() or bigSubtractModPRelaxed() into a number < p. This
+  * gives the same result as bigModulo() does when the field has been set
+  * to p, but it doesn't depend on the current prime finite field.
+  * \param r The 32 byte result will be written into here.
+  * \param op1 The 32 byte operand to reduce. This may alias r.
+  */
+void bigReduceModP(BigNum256 r, BigNum256 op1)
+{
+	uint8_t sum[32];
+	uint8_t mask;
+	uint8_t i;
+
+	// op1 >= p if and only if adding 2 ^ 32 + 977 to it overflows, in
+	// which case the discarded carry performs the subtraction of p. Since
+	// 2 ^ 256 < 2p, one subtraction is always enough.
+	bigAssign(sum, op1);
+	mask = (uint8_t)(-(int)foldCarryModP(sum, 32, 0xff, 0));
+	for (i = 0; i < 32; i++)
+	{
+		r[i] = (uint8_t)((sum[i] & mask) | (op1[i] & ~mask));
 	}
 }
 
@@ -554,6 +1973,16 @@ static const uint8_t secp256k1_complement_n[17] = {
 0xc4, 0x5f, 0xb7, 0x50, 0x19, 0x23, 0x51, 0x45,
 0x01};
 
+/** 2 ^ 512 modulo #secp256k1_n. */
+static const uint8_t secp256k1_n_r_squared[32] = {
+0x40, 0xd1, 0xd7, 0x67, 0x14, 0xf2, 0x6c, 0x89,
+0x78, 0xf8, 0x7c, 0x0e, 0xc2, 0x96, 0x14, 0x74,
+0xc6, 0x07, 0xcd, 0x5b, 0xe4, 0xf5, 0x97, 0xe6,
+0xc5, 0x9b, 0xc6, 0x81, 0xd5, 0x1c, 0x67, 0x9d};
+
+/** -(#secp256k1_n ^ -1) modulo 2 ^ 32. */
+#define SECP256K1_N_PRIME	0x5588b13fUL
+
 /** Storage for test numbers. */
 static uint8_t test_cases[TOTAL_CASES][32];
 
@@ -660,6 +2089,8 @@ int main(void)
 	mp_limb_t mpn_divisor[8];
 	mp_limb_t mpn_quotient[9];
 	mp_limb_t mpn_remainder[8];
+	uint64_t k;
+	uint64_t k_squared;
 
 	if (sizeof(mp_limb_t) != 4)
 	{
@@ -873,6 +2304,393 @@ int main(void)
 		}
 	}
 
+	// Test bigLoadBigEndian() and bigStoreBigEndian(). Loading should give
+	// the same result as swapEndian256(), both into a separate buffer and
+	// in place, and storing should undo loading.
+	for (i = 0; i < TOTAL_CASES; i++)
+	{
+		bigAssign(op1, test_cases[i]);
+		bigAssign(result_compare, op1);
+		swapEndian256(result_compare);
+		bigLoadBigEndian(result, op1);
+		bigLoadBigEndian(op2, op1);
+		bigLoadBigEndian(op1, op1);
+		bigStoreBigEndian(&(result[32]), op1);
+		if (memcmp(result, result_compare, 32)
+			|| memcmp(op1, result_compare, 32)
+			|| memcmp(op2, result_compare, 32)
+			|| memcmp(&(result[32]), test_cases[i], 32))
+		{
+			printf("Test failed (big-endian load/store)\n");
+			reportFailure();
+		}
+		else
+		{
+			reportSuccess();
+		}
+	}
+
+	// Test bigSquareVariableSizeNoModulo().
+	for (i = 0; i < TOTAL_CASES; i++)
+	{
+		bigAssign(op1, test_cases[i]);
+		bigSquareVariableSizeNoModulo(result, op1, 32);
+		byteToMpn(mpn_op1, op1, 8);
+		mpn_mul_n(mpn_result, mpn_op1, mpn_op1, 8);
+		mpnToByte(result_compare, mpn_result, 16);
+		if (memcmp(result, result_compare, 64))
+		{
+			printf("Test failed (internal squaring)\n");
+			printf("op1: ");
+			printLittleEndian32(op1);
+			printf("\nExpected: ");
+			printLittleEndian32(&(result_compare[32]));
+			printLittleEndian32(result_compare);
+			printf("\nGot: ");
+			printLittleEndian32(&(result[32]));
+			printLittleEndian32(result);
+			printf("\n");
+			reportFailure();
+		}
+		else
+		{
+			reportSuccess();
+		}
+	}
+
+	// Test modular multiplication of numbers which are slightly less than
+	// the modulus. For k < 2 ^ 32, (p - k) ^ 2 = k ^ 2 (mod p) and k ^ 2 is
+	// already fully reduced. Squaring these numbers produces wide products
+	// whose reduction carries out of the lower 256 bits, which the edge
+	// cases in generateTestCases() are too close to p to exercise.
+	bigSetField(secp256k1_p, secp256k1_complement_p, sizeof(secp256k1_complement_p));
+	for (i = 0; i < 1000; i++)
+	{
+		k = (uint64_t)(i + 1) * 4000037;
+		k_squared = k * k;
+		bigSetZero(op1);
+		writeU32LittleEndian(op1, (uint32_t)k);
+		writeU32LittleEndian(&(op1[4]), (uint32_t)(k >> 32));
+		bigSubtractNoModulo(op1, secp256k1_p, op1);
+		bigMultiply(result, op1, op1);
+		bigMultiplyModP(op2, op1, op1);
+		bigSetZero(result_compare);
+		writeU32LittleEndian(result_compare, (uint32_t)k_squared);
+		writeU32LittleEndian(&(result_compare[4]), (uint32_t)(k_squared >> 32));
+		if ((bigCompare(result, result_compare) != BIGCMP_EQUAL)
+			|| (bigCompare(op2, result_compare) != BIGCMP_EQUAL))
+		{
+			printf("Test failed (modular multiplication near p)\n");
+			printf("op1: ");
+			printLittleEndian32(op1);
+			printf("\nExpected: ");
+			printLittleEndian32(result_compare);
+			printf("\nGot: ");
+			printLittleEndian32(result);
+			printf("\nGot (bigMultiplyModP()): ");
+			printLittleEndian32(op2);
+			printf("\n");
+			reportFailure();
+		}
+		else
+		{
+			reportSuccess();
+		}
+		bigSquare(result, op1);
+		bigSquareModP(op2, op1);
+		if ((bigCompare(result, result_compare) != BIGCMP_EQUAL)
+			|| (bigCompare(op2, result_compare) != BIGCMP_EQUAL))
+		{
+			printf("Test failed (modular squaring near p)\n");
+			printf("op1: ");
+			printLittleEndian32(op1);
+			printf("\nExpected: ");
+			printLittleEndian32(result_compare);
+			printf("\nGot: ");
+			printLittleEndian32(result);
+			printf("\nGot (bigSquareModP()): ");
+			printLittleEndian32(op2);
+			printf("\n");
+			reportFailure();
+		}
+		else
+		{
+			reportSuccess();
+		}
+	}
+
+	// Test bigMultiplyModP(). Its results should be identical to those of
+	// bigMultiply() when the field is set to p, and bigMultiply() is checked
+	// against GMP below.
+	generateTestCases(secp256k1_p);
+	bigSetField(secp256k1_p, secp256k1_complement_p, sizeof(secp256k1_complement_p));
+	for (i = 0; i < TOTAL_CASES; i++)
+	{
+		for (j = 0; j < TOTAL_CASES; j++)
+		{
+			bigAssign(op1, test_cases[i]);
+			bigAssign(op2, test_cases[j]);
+			bigMultiply(result_compare, op1, op2);
+			bigMultiplyModP(result, op1, op2);
+			if (bigCompare(result, result_compare) != BIGCMP_EQUAL)
+			{
+				printf("Test failed (bigMultiplyModP())\n");
+				printf("op1: ");
+				printLittleEndian32(op1);
+				printf("\nop2: ");
+				printLittleEndian32(op2);
+				printf("\nExpected: ");
+				printLittleEndian32(result_compare);
+				printf("\nGot: ");
+				printLittleEndian32(result);
+				printf("\n");
+				reportFailure();
+			}
+			else
+			{
+				reportSuccess();
+			}
+		}
+	}
+
+	// Test the Montgomery multiplication functions. Converting both operands
+	// into the Montgomery domain, multiplying them there and converting the
+	// product back should give the same result as bigMultiply() when the
+	// field is set to n. bigMultiply() is checked against GMP below.
+	generateTestCases(secp256k1_n);
+	bigSetField(secp256k1_n, secp256k1_complement_n, sizeof(secp256k1_complement_n));
+	bigSetMontgomery(secp256k1_n_r_squared, SECP256K1_N_PRIME);
+	for (i = 0; i < TOTAL_CASES; i++)
+	{
+		for (j = 0; j < TOTAL_CASES; j++)
+		{
+			bigAssign(op1, test_cases[i]);
+			bigAssign(op2, test_cases[j]);
+			bigMultiply(result_compare, op1, op2);
+			bigToMontgomery(op1, op1);
+			bigToMontgomery(op2, op2);
+			bigMultiplyMontgomery(result, op1, op2);
+			bigFromMontgomery(result, result);
+			if (bigCompare(result, result_compare) != BIGCMP_EQUAL)
+			{
+				printf("Test failed (bigMultiplyMontgomery())\n");
+				printf("op1: ");
+				printLittleEndian32(test_cases[i]);
+				printf("\nop2: ");
+				printLittleEndian32(test_cases[j]);
+				printf("\nExpected: ");
+				printLittleEndian32(result_compare);
+				printf("\nGot: ");
+				printLittleEndian32(result);
+				printf("\n");
+				reportFailure();
+			}
+			else
+			{
+				reportSuccess();
+			}
+		}
+		// bigSquareMontgomery() should match bigMultiplyMontgomery() with
+		// both operands the same.
+		bigMultiplyMontgomery(result_compare, op1, op1);
+		bigSquareMontgomery(op1, op1);
+		if (bigCompare(op1, result_compare) != BIGCMP_EQUAL)
+		{
+			printf("Test failed (bigSquareMontgomery())\n");
+			reportFailure();
+		}
+		else
+		{
+			reportSuccess();
+		}
+	}
+
+	// Test bigSquare() and bigSquareModP(). Their results should be
+	// identical to those of bigMultiply() and bigMultiplyModP() with both
+	// operands the same. bigSquare() is tested against both p and n.
+	for (divisor_select = 0; divisor_select < 2; divisor_select++)
+	{
+		if (divisor_select == 0)
+		{
+			generateTestCases(secp256k1_p);
+			bigSetField(secp256k1_p, secp256k1_complement_p, sizeof(secp256k1_complement_p));
+		}
+		else
+		{
+			generateTestCases(secp256k1_n);
+			bigSetField(secp256k1_n, secp256k1_complement_n, sizeof(secp256k1_complement_n));
+		}
+		for (i = 0; i < TOTAL_CASES; i++)
+		{
+			bigAssign(op1, test_cases[i]);
+			bigMultiply(result_compare, op1, op1);
+			bigSquare(result, op1);
+			if (divisor_select == 0)
+			{
+				bigMultiplyModP(op2, op1, op1);
+			}
+			else
+			{
+				bigAssign(op2, result_compare);
+			}
+			if ((bigCompare(result, result_compare) != BIGCMP_EQUAL)
+				|| (bigCompare(op2, result_compare) != BIGCMP_EQUAL))
+			{
+				printf("Test failed (modular squaring)\n");
+				printf("op1: ");
+				printLittleEndian32(op1);
+				printf("\nExpected: ");
+				printLittleEndian32(result_compare);
+				printf("\nGot: ");
+				printLittleEndian32(result);
+				printf("\n");
+				reportFailure();
+			}
+			else
+			{
+				reportSuccess();
+			}
+			// Aliasing r and op1 should also work.
+			if (divisor_select == 0)
+			{
+				bigMultiplyModP(result_compare, op1, op1);
+				bigSquareModP(op1, op1);
+			}
+			else
+			{
+				bigSquare(op1, op1);
+			}
+			if (bigCompare(op1, result_compare) != BIGCMP_EQUAL)
+			{
+				printf("Test failed (modular squaring, r aliases op1)\n");
+				reportFailure();
+			}
+			else
+			{
+				reportSuccess();
+			}
+		}
+	}
+
+	// Test bigInvertModP(). Its results should be identical to those of
+	// bigInvert() when the field is set to p.
+	generateTestCases(secp256k1_p);
+	bigSetField(secp256k1_p, secp256k1_complement_p, sizeof(secp256k1_complement_p));
+	for (i = 0; i < TOTAL_CASES; i++)
+	{
+		bigAssign(op1, test_cases[i]);
+		bigInvert(result_compare, op1);
+		bigInvertModP(result, op1);
+		bigInvertModP(op1, op1);
+		if ((bigCompare(result, result_compare) != BIGCMP_EQUAL)
+			|| (bigCompare(op1, result_compare) != BIGCMP_EQUAL))
+		{
+			printf("Test failed (bigInvertModP())\n");
+			printf("op1: ");
+			printLittleEndian32(test_cases[i]);
+			printf("\nExpected: ");
+			printLittleEndian32(result_compare);
+			printf("\nGot: ");
+			printLittleEndian32(result);
+			printf("\n");
+			reportFailure();
+		}
+		else
+		{
+			reportSuccess();
+		}
+	}
+
+	// Test bigSqrtModP(). Every square has a square root, which is either
+	// the original number or its negation, so squaring the square root
+	// should give back the square.
+	generateTestCases(secp256k1_p);
+	for (i = 0; i < TOTAL_CASES; i++)
+	{
+		bigSquareModP(op1, test_cases[i]);
+		bigSqrtModP(result, op1);
+		bigSquareModP(result_compare, result);
+		bigSquareModP(op2, test_cases[i]);
+		// Aliasing r and op1 should also work.
+		bigSqrtModP(op1, op1);
+		if ((bigCompare(result_compare, op2) != BIGCMP_EQUAL)
+			|| (bigCompare(op1, result) != BIGCMP_EQUAL))
+		{
+			printf("Test failed (bigSqrtModP())\n");
+			printf("op1: ");
+			printLittleEndian32(test_cases[i]);
+			printf("\nGot: ");
+			printLittleEndian32(result);
+			printf("\n");
+			reportFailure();
+		}
+		else
+		{
+			reportSuccess();
+		}
+	}
+
+	// Test bigAddModPRelaxed(), bigSubtractModPRelaxed() and
+	// bigReduceModP(). Their inputs can be anything < 2 ^ 256. Once fully
+	// reduced, their results should be identical to those of bigAdd() and
+	// bigSubtract() (which need fully reduced inputs) when the field is set
+	// to p.
+	generateTestCases(zero);
+	bigSetField(secp256k1_p, secp256k1_complement_p, sizeof(secp256k1_complement_p));
+	for (operation = 0; operation < 2; operation++)
+	{
+		for (i = 0; i < TOTAL_CASES; i++)
+		{
+			for (j = 0; j < TOTAL_CASES; j += 7)
+			{
+				if (operation == 0)
+				{
+					bigAddModPRelaxed(result, test_cases[i], test_cases[j]);
+				}
+				else
+				{
+					bigSubtractModPRelaxed(result, test_cases[i], test_cases[j]);
+				}
+				bigReduceModP(result, result);
+				bigModulo(op1, test_cases[i]);
+				bigModulo(op2, test_cases[j]);
+				if (operation == 0)
+				{
+					bigAdd(result_compare, op1, op2);
+				}
+				else
+				{
+					bigSubtract(result_compare, op1, op2);
+				}
+				if (bigCompare(result, result_compare) != BIGCMP_EQUAL)
+				{
+					if (operation == 0)
+					{
+						printf("Test failed (bigAddModPRelaxed())\n");
+					}
+					else
+					{
+						printf("Test failed (bigSubtractModPRelaxed())\n");
+					}
+					printf("op1: ");
+					printLittleEndian32(test_cases[i]);
+					printf("\nop2: ");
+					printLittleEndian32(test_cases[j]);
+					printf("\nExpected: ");
+					printLittleEndian32(result_compare);
+					printf("\nGot: ");
+					printLittleEndian32(result);
+					printf("\n");
+					reportFailure();
+				}
+				else
+				{
+					reportSuccess();
+				}
+			}
+		}
+	}
+
 	// Test non-internal functions, which do modular reduction. The modular
 	// reduction is tested against both p and n.
 	for (divisor_select = 0; divisor_select < 2; divisor_select++)
@@ -1047,3 +2865,78 @@ int main(void)
 }
 
 #endif // #ifdef TEST_BIGNUM256
+
+#ifdef BENCH_BIGNUM256
+
+/** First operand for the benchmarks. */
+static uint8_t bench_op1[32];
+/** Second operand for the benchmarks. */
+static uint8_t bench_op2[32];
+
+/** Multiply modulo n (this uses the generic field code). */
+static void benchMultiplyModN(void)
+{
+	uint8_t r[32];
+
+	bigMultiply(r, bench_op1, bench_op2);
+}
+
+/** Montgomery multiply modulo n. */
+static void benchMultiplyMontgomery(void)
+{
+	uint8_t r[32];
+
+	bigMultiplyMontgomery(r, bench_op1, bench_op2);
+}
+
+/** Invert modulo n. */
+static void benchInvertModN(void)
+{
+	uint8_t r[32];
+
+	bigInvert(r, bench_op1);
+}
+
+/** Multiply modulo p. */
+static void benchMultiplyModP(void)
+{
+	uint8_t r[32];
+
+	bigMultiplyModP(r, bench_op1, bench_op2);
+}
+
+/** Square modulo p. */
+static void benchSquareModP(void)
+{
+	uint8_t r[32];
+
+	bigSquareModP(r, bench_op1);
+}
+
+/** Invert modulo p. */
+static void benchInvertModP(void)
+{
+	uint8_t r[32];
+
+	bigInvertModP(r, bench_op1);
+}
+
+int main(void)
+{
+	initBenchmarks(__FILE__);
+	fillWithRandom(bench_op1, sizeof(bench_op1));
+	fillWithRandom(bench_op2, sizeof(bench_op2));
+	// Make sure both operands are less than n (and therefore p).
+	bench_op1[31] &= 0x7f;
+	bench_op2[31] &= 0x7f;
+	setFieldToN();
+	runHostBenchmark("multiply_mod_n", &benchMultiplyModN, 32);
+	runHostBenchmark("multiply_montgomery_n", &benchMultiplyMontgomery, 32);
+	runHostBenchmark("invert_mod_n", &benchInvertModN, 32);
+	runHostBenchmark("multiply_mod_p", &benchMultiplyModP, 32);
+	runHostBenchmark("square_mod_p", &benchSquareModP, 32);
+	runHostBenchmark("invert_mod_p", &benchInvertModP, 32);
+	exit(0);
+}
+
+#endif // #ifdef BENCH_BIGNUM256
@@ -48,7 +48,10 @@ extern uint8_t bigIsZeroVariableSize(uint8_t *op1, uint8_t size);
 extern void bigSetZero(BigNum256 r);
 extern void bigAssign(BigNum256 r, BigNum256 op1);
 extern void swapEndian256(BigNum256 buffer);
+extern void bigLoadBigEndian(BigNum256 r, const uint8_t *in);
+extern void bigStoreBigEndian(uint8_t *out, const BigNum256 op1);
 extern void bigSetField(const uint8_t *in_n, const uint8_t *in_complement_n, const uint8_t in_size_complement_n);
+extern void bigSetMontgomery(const uint8_t *in_r_squared, const uint32_t in_n_prime);
 extern void bigModulo(BigNum256 r, BigNum256 op1);
 extern uint8_t bigAddVariableSizeNoModulo(uint8_t *r, uint8_t *op1, uint8_t *op2, uint8_t op_size);
 extern uint8_t bigSubtractVariableSizeNoModulo(uint8_t *r, uint8_t *op1, uint8_t *op2, uint8_t size);
@@ -57,7 +60,20 @@ extern void bigAdd(BigNum256 r, BigNum256 op1, BigNum256 op2);
 extern void bigSubtract(BigNum256 r, BigNum256 op1, BigNum256 op2);
 extern void bigShiftRightNoModulo(BigNum256 r, const BigNum256 op1);
 extern void bigMultiplyVariableSizeNoModulo(uint8_t *r, uint8_t *op1, uint8_t op1_size, uint8_t *op2, uint8_t op2_size);
+extern void bigSquareVariableSizeNoModulo(uint8_t *r, uint8_t *op1, uint8_t op1_size);
 extern void bigMultiply(BigNum256 r, BigNum256 op1, BigNum256 op2);
+extern void bigSquare(BigNum256 r, BigNum256 op1);
+extern void bigMultiplyModP(BigNum256 r, BigNum256 op1, BigNum256 op2);
+extern void bigSquareModP(BigNum256 r, BigNum256 op1);
 extern void bigInvert(BigNum256 r, BigNum256 op1);
+extern void bigInvertModP(BigNum256 r, BigNum256 op1);
+extern void bigSqrtModP(BigNum256 r, BigNum256 op1);
+extern void bigAddModPRelaxed(BigNum256 r, BigNum256 op1, BigNum256 op2);
+extern void bigSubtractModPRelaxed(BigNum256 r, BigNum256 op1, BigNum256 op2);
+extern void bigReduceModP(BigNum256 r, BigNum256 op1);
+extern void bigToMontgomery(BigNum256 r, BigNum256 op1);
+extern void bigFromMontgomery(BigNum256 r, BigNum256 op1);
+extern void bigMultiplyMontgomery(BigNum256 r, BigNum256 op1, BigNum256 op2);
+extern void bigSquareMontgomery(BigNum256 r, BigNum256 op1);
 
 #endif // #ifndef BIGNUM256_H_INCLUDED
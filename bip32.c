@@ -23,6 +23,104 @@
 #include "endian.h"
 #include "ecdsa.h"
 #include "hwinterface.h"
+#include "hash160.h"
+
+/** An intermediate node remembered by bip32DerivePrivate(). */
+struct BIP32CacheEntry
+{
+	/** Number of steps from the master node to #node. 0 means this entry is
+	  * unused. */
+	uint8_t depth;
+	/** The first #depth steps of the path to #node. */
+	uint32_t path[BIP32_CACHE_MAX_DEPTH];
+	/** The node itself, in the same format as the master node. */
+	uint8_t node[NODE_LENGTH];
+	/** Whether #public_key is valid. */
+	bool has_public_key;
+	/** Compressed public key of #node. This is only needed (and so only
+	  * calculated) for non-hardened derivation from #node, which is where
+	  * all the point multiplication happens. */
+	uint8_t public_key[33];
+};
+
+/** The master node which every entry in #bip32_cache was derived from. */
+static THREAD_LOCAL uint8_t cache_master_node[NODE_LENGTH];
+/** Intermediate nodes which were previously derived by
+  * bip32DerivePrivate(). */
+static THREAD_LOCAL struct BIP32CacheEntry bip32_cache[BIP32_CACHE_ENTRIES];
+/** Index into #bip32_cache of the entry which will be replaced next. */
+static THREAD_LOCAL uint8_t bip32_cache_next;
+
+/** Clear the cache of intermediate nodes used by bip32DerivePrivate(). Since
+  * the cache contains private keys, this should be called whenever the
+  * wallet which the master node belongs to is unloaded.
+  */
+void bip32ClearCache(void)
+{
+	memset(cache_master_node, 0xff, sizeof(cache_master_node)); // just to be sure
+	memset(cache_master_node, 0, sizeof(cache_master_node));
+	memset(bip32_cache, 0xff, sizeof(bip32_cache)); // just to be sure
+	memset(bip32_cache, 0, sizeof(bip32_cache));
+	bip32_cache_next = 0;
+}
+
+/** Find the deepest entry of #bip32_cache which is on a path, clearing the
+  * cache if it belongs to a different master node.
+  * \param master_node See bip32DerivePrivate().
+  * \param path See bip32DerivePrivate().
+  * \param path_length See bip32DerivePrivate().
+  * \return A pointer to the entry, or NULL if there are no suitable entries.
+  */
+static struct BIP32CacheEntry *bip32CacheLookup(const uint8_t *master_node, const uint32_t *path, const unsigned int path_length)
+{
+	struct BIP32CacheEntry *best;
+	struct BIP32CacheEntry *entry;
+	uint8_t i;
+
+	if (memcmp(cache_master_node, master_node, sizeof(cache_master_node)))
+	{
+		bip32ClearCache();
+		memcpy(cache_master_node, master_node, sizeof(cache_master_node));
+		return NULL;
+	}
+	best = NULL;
+	for (i = 0; i < BIP32_CACHE_ENTRIES; i++)
+	{
+		entry = &(bip32_cache[i]);
+		if ((entry->depth != 0)
+			&& (entry->depth <= path_length)
+			&& ((best == NULL) || (entry->depth > best->depth))
+			&& !memcmp(entry->path, path, entry->depth * sizeof(uint32_t)))
+		{
+			best = entry;
+		}
+	}
+	return best;
+}
+
+/** Remember a node in #bip32_cache, replacing the oldest entry.
+  * \param node The node to remember.
+  * \param path Path from the master node to the node.
+  * \param depth Number of steps in path. This must be between 1 and
+  *              #BIP32_CACHE_MAX_DEPTH inclusive.
+  * \return A pointer to the new entry.
+  */
+static struct BIP32CacheEntry *bip32CacheStore(const uint8_t *node, const uint32_t *path, const uint8_t depth)
+{
+	struct BIP32CacheEntry *entry;
+
+	entry = &(bip32_cache[bip32_cache_next]);
+	bip32_cache_next++;
+	if (bip32_cache_next >= BIP32_CACHE_ENTRIES)
+	{
+		bip32_cache_next = 0;
+	}
+	entry->depth = depth;
+	memcpy(entry->path, path, depth * sizeof(uint32_t));
+	memcpy(entry->node, node, NODE_LENGTH);
+	entry->has_public_key = false;
+	return entry;
+}
 
 /** Convert a master seed into a master node (an extended private key), as
   * described by the BIP32 specification.
@@ -36,32 +134,85 @@ void bip32SeedToNode(uint8_t *master_node, const uint8_t *seed, const unsigned i
 	hmacSha512(master_node, (const uint8_t *)"Bitcoin seed", 12, seed, seed_length);
 }
 
-/** Deterministically derive private key from a BIP32 node (a.k.a. extended
-  * private key), as described by the BIP32 specification.
-  * \param out The derived private key will be written here upon success. The
-  *            private key will be written as a little-endian 256 bit
-  *            multi-precision integer, suitable for input into a function
-  *            such as ecdsaSign().
+/** Calculate the compressed, serialised public key of a BIP32 node.
+  * \param out The public key will be written here. This must be a byte array
+  *            with space for 33 bytes.
+  * \param node The node, whose first 32 bytes are a big-endian private key.
+  * \return false on success, true on error.
+  */
+static bool nodeToPublicKey(uint8_t *out, const uint8_t *node)
+{
+	uint8_t temp[32];
+	uint8_t serialised[ECDSA_MAX_SERIALISE_SIZE];
+	PointAffine p;
+
+	bigLoadBigEndian(temp, node);
+	pointMultiplyBase(&p, temp);
+	memset(temp, 0, sizeof(temp));
+	if (ecdsaSerialise(serialised, &p, true) != 33)
+	{
+		// Compressed public keys should always be 33 bytes; this should never
+		// happen.
+		fatalError();
+		return true;
+	}
+	memcpy(out, serialised, 33);
+	return false;
+}
+
+/** Deterministically derive a BIP32 node (a.k.a. extended private key) from
+  * the master node, as described by the BIP32 specification.
+  * \param out_node The derived node will be written here upon success. This
+  *                 must be a byte array with space for #NODE_LENGTH bytes.
+  *                 It will be in the same format as the master node.
   * \param master_node The master node (a.k.a. extended private key) to derive
-  *                    the private key from.
+  *                    the node from.
   * \param path Path through the derivation tree. See BIP32 specification for
   *             more details.
   * \param path_length Number of steps through derivation tree. This may be 0.
   * \return false on success, true on error.
+  *
+  * The parent of the derived node (or for long paths, its ancestor at depth
+  * #BIP32_CACHE_MAX_DEPTH) is remembered, along with its public key once
+  * that's needed. So if the next call has the same master node and shares
+  * that path prefix, only the remaining steps need to be done.
   */
-bool bip32DerivePrivate(BigNum256 out, const uint8_t *master_node, const uint32_t *path, const unsigned int path_length)
+static bool bip32DeriveNode(uint8_t *out_node, const uint8_t *master_node, const uint32_t *path, const unsigned int path_length)
 {
 	uint8_t current_node[NODE_LENGTH];
 	uint8_t temp[NODE_LENGTH];
 	uint8_t hmac_data[37]; // 1 for prefix + 32 for public/private key + 4 for "i"
-	uint8_t serialised[ECDSA_MAX_SERIALISE_SIZE];
-	uint8_t serialised_size;
 	unsigned int i;
-	PointAffine p;
+	unsigned int store_depth;
+	struct BIP32CacheEntry *entry;
 
-	memcpy(current_node, master_node, sizeof(current_node));
-	for (i = 0; i < path_length; i++)
+	// entry always refers to either NULL or a cached copy of current_node.
+	entry = bip32CacheLookup(master_node, path, path_length);
+	if (entry != NULL)
+	{
+		memcpy(current_node, entry->node, sizeof(current_node));
+		i = entry->depth;
+	}
+	else
+	{
+		memcpy(current_node, master_node, sizeof(current_node));
+		i = 0;
+	}
+	store_depth = 0;
+	if (path_length > 1)
+	{
+		store_depth = path_length - 1;
+		if (store_depth > BIP32_CACHE_MAX_DEPTH)
+		{
+			store_depth = BIP32_CACHE_MAX_DEPTH;
+		}
+	}
+	for (; i < path_length; i++)
 	{
+		if ((i == store_depth) && (entry == NULL))
+		{
+			entry = bip32CacheStore(current_node, path, (uint8_t)i);
+		}
 		if ((path[i] & 0x80000000) != 0)
 		{
 			// Hardened derivation.
@@ -71,20 +222,22 @@ bool bip32DerivePrivate(BigNum256 out, const uint8_t *master_node, const uint32_
 		else
 		{
 			// Non-hardened derivation.
-			setToG(&p);
-			memcpy(temp, current_node, 32);
-			swapEndian256(temp); // big-endian -> little-endian
-			pointMultiply(&p, temp);
-			// TODO: cache point multiply results so that repeated key derivation is faster
-			serialised_size = ecdsaSerialise(serialised, &p, true);
-			if (serialised_size != 33)
+			if ((entry != NULL) && entry->has_public_key)
 			{
-				// Compressed public keys should always be 33 bytes; this should never
-				// happen.
-				fatalError();
-				return true;
+				memcpy(hmac_data, entry->public_key, 33);
+			}
+			else
+			{
+				if (nodeToPublicKey(hmac_data, current_node))
+				{
+					return true;
+				}
+				if (entry != NULL)
+				{
+					memcpy(entry->public_key, hmac_data, 33);
+					entry->has_public_key = true;
+				}
 			}
-			memcpy(hmac_data, serialised, 33);
 		}
 		writeU32BigEndian(&(hmac_data[33]), path[i]);
 		// Need to write to temp here (instead of current_node) because part of
@@ -93,8 +246,8 @@ bool bip32DerivePrivate(BigNum256 out, const uint8_t *master_node, const uint32_
 		// First 32 bytes of temp = I_L, last 32 bytes = I_R = derived chain code
 		// I_L must be interpreted as a big-endian 256 bit integer. However,
 		// bignum256.c works with little-endian integers.
-		swapEndian256(current_node); // big-endian -> little-endian
-		swapEndian256(temp); // big-endian -> little-endian
+		bigLoadBigEndian(current_node, current_node);
+		bigLoadBigEndian(temp, temp);
 		if (bigCompare(temp, (BigNum256)secp256k1_n) != BIGCMP_LESS)
 		{
 			return true; // I_L >= n
@@ -105,11 +258,97 @@ bool bip32DerivePrivate(BigNum256 out, const uint8_t *master_node, const uint32_
 		{
 			return true; // k_i == 0
 		}
-		swapEndian256(temp); // little-endian -> big-endian (for next step)
-		memcpy(current_node, temp, sizeof(current_node));
+		bigStoreBigEndian(current_node, temp);
+		memcpy(&(current_node[32]), &(temp[32]), 32);
+		entry = NULL;
+	}
+	memcpy(out_node, current_node, sizeof(current_node));
+	return false; // success
+}
+
+/** Deterministically derive private key from a BIP32 node (a.k.a. extended
+  * private key), as described by the BIP32 specification.
+  * \param out The derived private key will be written here upon success. The
+  *            private key will be written as a little-endian 256 bit
+  *            multi-precision integer, suitable for input into a function
+  *            such as ecdsaSign().
+  * \param master_node The master node (a.k.a. extended private key) to derive
+  *                    the private key from.
+  * \param path Path through the derivation tree. See BIP32 specification for
+  *             more details.
+  * \param path_length Number of steps through derivation tree. This may be 0.
+  * \return false on success, true on error.
+  */
+bool bip32DerivePrivate(BigNum256 out, const uint8_t *master_node, const uint32_t *path, const unsigned int path_length)
+{
+	uint8_t node[NODE_LENGTH];
+
+	if (bip32DeriveNode(node, master_node, path, path_length))
+	{
+		return true;
+	}
+	bigLoadBigEndian(out, node);
+	memset(node, 0, sizeof(node));
+	return false; // success
+}
+
+/** Derive the extended public key of a BIP32 node, serialised as described
+  * in the "Serialization format" section of the BIP32 specification. The
+  * serialisation doesn't include the checksum or base58 encoding; those are
+  * left to the host.
+  * \param out The serialised extended public key will be written here upon
+  *            success. This must be a byte array with space for
+  *            #BIP32_XPUB_LENGTH bytes.
+  * \param master_node The master node (a.k.a. extended private key) to derive
+  *                    from.
+  * \param path Path through the derivation tree. This may contain hardened
+  *             steps, since the master node is an extended private key.
+  * \param path_length Number of steps through derivation tree. This may be 0,
+  *                    but must be less than 256.
+  * \return false on success, true on error.
+  */
+bool bip32GetExtendedPublicKey(uint8_t *out, const uint8_t *master_node, const uint32_t *path, const unsigned int path_length)
+{
+	uint8_t node[NODE_LENGTH];
+	uint8_t buffer[33];
+
+	if (path_length > 255)
+	{
+		return true; // depth doesn't fit in serialisation
+	}
+	writeU32BigEndian(&(out[0]), BIP32_XPUB_VERSION);
+	out[4] = (uint8_t)path_length;
+	if (path_length == 0)
+	{
+		memset(&(out[5]), 0, 8); // master node has no parent or child number
+	}
+	else
+	{
+		// Parent fingerprint is the first 4 bytes of HASH160 of the parent's
+		// public key.
+		if (bip32DeriveNode(node, master_node, path, path_length - 1))
+		{
+			return true;
+		}
+		if (nodeToPublicKey(buffer, node))
+		{
+			return true;
+		}
+		hash160(buffer, buffer, 33);
+		memcpy(&(out[5]), buffer, 4);
+		writeU32BigEndian(&(out[9]), path[path_length - 1]);
+	}
+	// Most of the path is in the cache now, so this doesn't cost much.
+	if (bip32DeriveNode(node, master_node, path, path_length))
+	{
+		return true;
+	}
+	memcpy(&(out[13]), &(node[32]), 32); // chain code
+	if (nodeToPublicKey(&(out[45]), node))
+	{
+		return true;
 	}
-	memcpy(out, current_node, 32);
-	swapEndian256(out); // big-endian -> little-endian for result
+	memset(node, 0, sizeof(node));
 	return false; // success
 }
 
@@ -369,10 +608,21 @@ int main(void)
 	uint8_t master_node[NODE_LENGTH];
 	uint8_t canary[CANARY_LENGTH];
 	uint8_t out[32 + CANARY_LENGTH];
+	uint8_t uncached_out[32];
+	uint8_t xpub[BIP32_XPUB_LENGTH];
+	uint8_t expected_xpub[BIP32_XPUB_LENGTH];
+	uint32_t path[5];
+	PointAffine p;
 	unsigned int i;
+	unsigned int j;
+	unsigned int pass;
 
 	initTests(__FILE__);
 
+	// Go through the test vectors twice, so that the second time, the
+	// cache is filled with nodes from the first time.
+	for (pass = 0; pass < 2; pass++)
+	{
 	for (i = 0; i < (sizeof(test_vectors) / sizeof(struct BIP32TestVector)); i++)
 	{
 		bip32SeedToNode(master_node, test_vectors[i].master, test_vectors[i].master_length);
@@ -408,6 +658,83 @@ int main(void)
 			}
 		}
 	}
+	}
+
+	// Derive account-style keys (m/44'/0'/0'/c/i), alternating between the
+	// receive (c = 0) and change (c = 1) chains, and check that the results
+	// are the same with and without the cache.
+	bip32SeedToNode(master_node, test_vectors[0].master, test_vectors[0].master_length);
+	path[0] = 0x8000002c;
+	path[1] = 0x80000000;
+	path[2] = 0x80000000;
+	for (i = 0; i < 20; i++)
+	{
+		path[3] = i & 1;
+		path[4] = i >> 1;
+		if (bip32DerivePrivate(out, master_node, path, 5))
+		{
+			printf("Account key %u failed to derive\n", i);
+			reportFailure();
+			continue;
+		}
+		bip32ClearCache();
+		if (bip32DerivePrivate(uncached_out, master_node, path, 5))
+		{
+			printf("Account key %u failed to derive without cache\n", i);
+			reportFailure();
+			continue;
+		}
+		if (memcmp(out, uncached_out, 32) != 0)
+		{
+			printf("Account key %u differs with cache\n", i);
+			reportFailure();
+		}
+		else
+		{
+			reportSuccess();
+		}
+		// Warm up the cache again, for the next iteration.
+		path[3] = (i + 1) & 1;
+		bip32DerivePrivate(out, master_node, path, 5);
+		path[3] = i & 1;
+		bip32DerivePrivate(out, master_node, path, 5);
+	}
+
+	// Check extended public keys. Apart from the version bytes and the key,
+	// they should be identical to the extended private keys in the test
+	// vectors.
+	for (i = 0; i < (sizeof(test_vectors) / sizeof(struct BIP32TestVector)); i++)
+	{
+		bip32SeedToNode(master_node, test_vectors[i].master, test_vectors[i].master_length);
+		if (bip32GetExtendedPublicKey(xpub, master_node, test_vectors[i].path, test_vectors[i].path_length))
+		{
+			printf("Test vector %u failed to derive extended public key\n", i);
+			reportFailure();
+			continue;
+		}
+		// base58Decode() writes a little-endian number; the serialisation
+		// (minus the 4 byte checksum) is big-endian.
+		base58Decode(expected_bytes, test_vectors[i].base58_private, (unsigned int)strlen(test_vectors[i].base58_private));
+		for (j = 0; j < BIP32_XPUB_LENGTH; j++)
+		{
+			expected_xpub[j] = expected_bytes[SERIALISED_BIP32_KEY_LENGTH - 1 - j];
+		}
+		writeU32BigEndian(expected_xpub, BIP32_XPUB_VERSION);
+		memcpy(out, &(expected_xpub[46]), 32); // big-endian private key
+		swapEndian256(out);
+		setToG(&p);
+		pointMultiply(&p, out);
+		ecdsaSerialise(&(expected_xpub[45]), &p, true);
+		if (memcmp(xpub, expected_xpub, BIP32_XPUB_LENGTH) != 0)
+		{
+			printf("Test vector %u extended public key mismatch\n", i);
+			reportFailure();
+		}
+		else
+		{
+			reportSuccess();
+		}
+	}
 
 	finishTests();
 	exit(0);
@@ -15,7 +15,31 @@
   * key. */
 #define NODE_LENGTH		64
 
+/** Length (in number of bytes) of a serialised extended public key, as
+  * written by bip32GetExtendedPublicKey(). This doesn't include the
+  * checksum. */
+#define BIP32_XPUB_LENGTH	78
+/** Version bytes of a serialised extended public key (mainnet "xpub"). */
+#define BIP32_XPUB_VERSION	0x0488B21E
+
+#ifndef BIP32_CACHE_ENTRIES
+/** Number of intermediate nodes which bip32DerivePrivate() remembers, so
+  * that deriving many keys which share a path prefix (e.g. the addresses of
+  * one account, m/44'/0'/0'/0/i) only costs one derivation step per key.
+  * Each entry costs about 120 bytes of RAM. This can be overridden by
+  * defining BIP32_CACHE_ENTRIES in the platform's build settings.
+  * \warning This must be at least 1 and < 256.
+  */
+#define BIP32_CACHE_ENTRIES		2
+#endif // #ifndef BIP32_CACHE_ENTRIES
+
+/** Maximum depth (number of steps from the master node) of a node which
+  * bip32DerivePrivate() will remember. 4 is enough for BIP 44 chains. */
+#define BIP32_CACHE_MAX_DEPTH	4
+
 extern void bip32SeedToNode(uint8_t *master_node, const uint8_t *seed, const unsigned int seed_length);
 extern bool bip32DerivePrivate(BigNum256 out, const uint8_t *master_node, const uint32_t *path, const unsigned int path_length);
+extern bool bip32GetExtendedPublicKey(uint8_t *out, const uint8_t *master_node, const uint32_t *path, const unsigned int path_length);
+extern void bip32ClearCache(void);
 
 #endif // #ifndef BIP32_H_INCLUDED
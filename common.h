@@ -91,16 +91,57 @@ typedef enum BoolEnum
 #define NOINLINE
 #endif // #if defined(__GNUC__)
 
+/** Marks a small, speed-critical function which should be executed from RAM
+  * instead of from flash, so that it isn't slowed down by flash wait states.
+  * This only does anything if ENABLE_RAM_FUNCTIONS is defined in the
+  * platform's build settings; otherwise functions marked with RAM_FUNCTION
+  * stay in flash, as usual. The startup code copies RAM functions out of
+  * flash, along with initialised data.
+  *
+  * RAM functions are called with long calls, because flash and RAM are too
+  * far apart for an ordinary call instruction. Calls out of a RAM function
+  * are not long calls, so RAM_FUNCTION should only be used on leaf functions
+  * (functions which don't call anything else). RAM is also scarce, so it
+  * should only be used on the innermost loops of the hashing and bignum
+  * code. */
+#if defined(ENABLE_RAM_FUNCTIONS) && defined(__XC32)
+#define RAM_FUNCTION __attribute__((ramfunc, long_call, noinline))
+#elif defined(ENABLE_RAM_FUNCTIONS) && defined(__GNUC__) && defined(__arm__)
+#define RAM_FUNCTION __attribute__((section(".ramfunc"), long_call, noinline))
+#else
+#define RAM_FUNCTION
+#endif // #if defined(ENABLE_RAM_FUNCTIONS) && defined(__XC32)
+
+/** Marks a function in which speed matters much more than size: the hash
+  * block functions, AES and the field arithmetic behind point
+  * multiplication. Everything else (user interface, USB, protocol handling,
+  * error paths) is cold, and size matters more there.
+  *
+  * For the PIC32 port, this allows a split build profile: tick "Generate
+  * 16-bit code" for the whole project, so that cold code is compiled as
+  * MIPS16e, and define PIC32_SPLIT_ISA in the project's preprocessor macros.
+  * Functions marked with HOT_FUNCTION are then compiled as MIPS32 at -O3,
+  * instead of as MIPS16e at the project's optimisation level. Functions
+  * which use inline assembly or are interrupt handlers are already marked
+  * nomips16, so they don't need HOT_FUNCTION. Without PIC32_SPLIT_ISA,
+  * HOT_FUNCTION does nothing. */
+#if defined(PIC32_SPLIT_ISA) && defined(__XC32)
+#define HOT_FUNCTION __attribute__((nomips16, optimize("O3")))
+#else
+#define HOT_FUNCTION
+#endif // #if defined(PIC32_SPLIT_ISA) && defined(__XC32)
+
 /** On certain platforms, unchanging, read-only data (eg. lookup tables) needs
   * to be marked and accessed in a way that is different to read/write data.
   * Marking this data with PROGMEM saves valuable RAM space. However, any data
   * marked with PROGMEM needs to be accessed using
-  * the #LOOKUP_BYTE and #LOOKUP_DWORD macros. */
+  * the #LOOKUP_BYTE, #LOOKUP_DWORD and #LOOKUP_BLOCK macros. */
 #if defined(AVR) && defined(__GNUC__)
 #include <avr/io.h>
 #include <avr/pgmspace.h>
 #define LOOKUP_DWORD(x)		(pgm_read_dword_near(&(x)))
 #define LOOKUP_BYTE(x)		(pgm_read_byte_near(&(x)))
+#define LOOKUP_BLOCK(dest, src, length)	(memcpy_P((dest), (src), (length)))
 #else
 #define PROGMEM
 /** Use this to access #PROGMEM lookup tables which have dword (32 bit)
@@ -111,6 +152,42 @@ typedef enum BoolEnum
   * entries. For example, normally you would use `r = byte_table[i];` but
   * for a #PROGMEM table, use `r = LOOKUP_BYTE(byte_table[i]);`. */
 #define LOOKUP_BYTE(x)		(x)
+/** Use this to copy a run of bytes out of a #PROGMEM lookup table. This is
+  * much faster than a loop of #LOOKUP_BYTE on AVR, since the program memory
+  * address only has to be set up once. For example, normally you would use
+  * `memcpy(buffer, &(table[i]), 32);` but for a #PROGMEM table, use
+  * `LOOKUP_BLOCK(buffer, &(table[i]), 32);`. */
+#define LOOKUP_BLOCK(dest, src, length)	(memcpy((dest), (src), (length)))
 #endif // #if defined(AVR) && defined(__GNUC__)
 
+#ifndef CONSTANT_RAM_BUDGET
+/** Number of bytes of RAM which may be spent on keeping copies of the most
+  * frequently used #PROGMEM lookup tables in RAM, where they are faster to
+  * access. Tables are given RAM in this order, each only if it fits within
+  * what is left of the budget: the base point G (64 bytes, see ecdsa.c), then
+  * the SHA-256 round constants (256 bytes, see sha256.c). Tables which are
+  * given RAM are copied there at startup, along with all other initialised
+  * data. This only matters on platforms where #PROGMEM does something. This
+  * can be overridden by defining CONSTANT_RAM_BUDGET in the platform's build
+  * settings. */
+#define CONSTANT_RAM_BUDGET		0
+#endif // #ifndef CONSTANT_RAM_BUDGET
+
+/** Storage class for state which the platform-independent code keeps
+  * between calls (for example, the field selected in bignum256.c, or the
+  * transaction parser's hash states). On the device there is only one
+  * thread, so this does nothing. When the code is built as a host library
+  * (see hostlib.c), each thread gets its own copy of that state, so that
+  * several threads can use the library at once. Other host programs which
+  * run the platform-independent code in several threads (for example, the
+  * offline mode of the statistics testers) can define THREAD_LOCAL in their
+  * build settings. */
+#ifndef THREAD_LOCAL
+#if defined(HOSTLIB) && defined(__GNUC__)
+#define THREAD_LOCAL __thread
+#else
+#define THREAD_LOCAL
+#endif // #if defined(HOSTLIB) && defined(__GNUC__)
+#endif // #ifndef THREAD_LOCAL
+
 #endif // #ifndef COMMON_H_INCLUDED
@@ -0,0 +1,906 @@
+/** \file diagnostics.c
+  *
+  * \brief Records how long the device takes to handle each request.
+  *
+  * For each packet type which processPacket() handles, this keeps a count of
+  * packets plus the minimum, maximum and total time taken to handle them.
+  * It also splits the time taken to handle all requests into phases (see
+  * #DiagnosticsPhaseEnum): receiving, computing, waiting for the user and
+  * sending. The host can retrieve these figures using a GetDiagnostics
+  * packet, which allows performance problems on devices in the field to be
+  * diagnosed.
+  *
+  * It also keeps statistics for the platform's non-volatile storage
+  * implementation: how often it is read, written and erased, how well its
+  * write cache (if it has one) works and how long nonVolatileFlush() takes.
+  * The platform reports these using diagnosticsNVEvent(),
+  * diagnosticsSetNVEraseCount(), diagnosticsBeginNVFlush()
+  * and diagnosticsEndNVFlush(). Apart from the erase counts, which the
+  * platform may persist, they are since the device was last reset.
+  *
+  * If the platform calls diagnosticsPaintStack() at boot, it also measures
+  * stack usage, by filling the unused part of the stack with a known value
+  * and later looking for the lowest address which doesn't have that value
+  * any more. The stack is measured and then filled again at the end of each
+  * request, so that the peak usage of each packet type can be recorded,
+  * along with the peak usage since boot. Stack used by interrupt handlers
+  * counts towards whichever request it happened in.
+  *
+  * Platforms with USB can report per-endpoint traffic using
+  * diagnosticsUSBPacket(), diagnosticsUSBEvent() and
+  * diagnosticsUSBFIFODepth(). These may be called from interrupt handlers,
+  * but each counter should only be updated from one context, so that no
+  * increments are lost.
+  *
+  * The platform can also time the steps of its boot sequence, by calling
+  * diagnosticsBeginBoot() as early as possible and diagnosticsEndBootStep()
+  * after each step. What the steps are is up to the platform.
+  *
+  * The timing comes from the platform-dependent getCycleCount() function.
+  * Time spent waiting for the header of a request isn't counted, since that
+  * is just idle time. A phase which lasts for longer than the wrap period of
+  * the cycle counter (eg. a very slow user) will be under-counted.
+  *
+  * Unlike benchmark.c, this doesn't allow the host to do anything it
+  * couldn't already do, so it's suitable for production builds. It is only
+  * compiled in if ENABLE_DIAGNOSTICS is defined.
+  *
+  * This file is licensed as described by the file LICENCE.
+  */
+
+#ifdef TEST_DIAGNOSTICS
+#include <stdio.h>
+#include <stdlib.h>
+#include "test_helpers.h"
+#endif // #ifdef TEST_DIAGNOSTICS
+
+#include "common.h"
+#include "diagnostics.h"
+#include "hwinterface.h"
+
+#ifdef ENABLE_DIAGNOSTICS
+
+/** Statistics for each packet type, indexed by packet type. */
+static CommandDiagnostics command_diagnostics[DIAGNOSTICS_NUM_PACKET_TYPES];
+/** Total time spent in each phase, indexed by #DiagnosticsPhase. */
+static uint64_t phase_ticks[DIAGNOSTICS_NUMBER_OF_PHASES];
+/** Whether a request is being handled (i.e. whether time is being
+  * recorded). */
+static bool recording;
+/** The current phase. */
+static DiagnosticsPhase current_phase;
+/** Value of getCycleCount() when the current request began. */
+static uint32_t packet_start;
+/** Value of getCycleCount() when the current phase began. */
+static uint32_t phase_start;
+/** Statistics for non-volatile storage. */
+static NVDiagnostics nv_diagnostics;
+/** Whether a call to nonVolatileFlush() is being timed. */
+static bool nv_flushing;
+/** Value of getCycleCount() when the current call to nonVolatileFlush()
+  * began. */
+static uint32_t nv_flush_start;
+/** Lowest word of the stack (see getStackBounds()), or NULL if
+  * diagnosticsPaintStack() hasn't been called. */
+static uint32_t *stack_bottom;
+/** One past the highest word of the stack. */
+static uint32_t *stack_top;
+/** Most stack space used since boot, in bytes. */
+static uint32_t peak_stack_bytes;
+/** Value of getCycleCount() when the current boot step began. */
+static uint32_t boot_step_start;
+/** Time taken by each boot step which has finished. */
+static uint32_t boot_step_ticks[DIAGNOSTICS_BOOT_STEPS];
+/** Number of entries in #boot_step_ticks which are valid. */
+static unsigned int boot_steps;
+/** Statistics for each USB endpoint, indexed by endpoint number. */
+static USBEndpointDiagnostics usb_diagnostics[DIAGNOSTICS_USB_ENDPOINTS];
+
+/** Value which unused stack words are filled with. */
+#define STACK_PAINT						0xccccccccu
+
+#ifndef DIAGNOSTICS_STACK_MARGIN
+/** Number of bytes below the current stack pointer which paintStack()
+  * leaves alone, to allow for the stack frame of paintStack() itself and for
+  * anything (eg. a red zone) that the compiler may keep just below the
+  * stack pointer. This can be overridden by
+  * defining DIAGNOSTICS_STACK_MARGIN in the platform's build settings. */
+#define DIAGNOSTICS_STACK_MARGIN		256
+#endif // #ifndef DIAGNOSTICS_STACK_MARGIN
+
+/** Fill the unused part of the stack with #STACK_PAINT. Everything from the
+  * bottom of the stack up to #DIAGNOSTICS_STACK_MARGIN bytes below the
+  * current stack pointer is filled. The stack is assumed to grow downwards.
+  * This doesn't call anything while filling, since the stack frame of
+  * anything it called would be in the area being filled. */
+static NOINLINE void paintStack(void)
+{
+	volatile uint32_t *p;
+	uint32_t *end;
+	uint8_t here;
+
+	end = stack_top;
+	if (((uint8_t *)stack_bottom <= &here) && (&here < (uint8_t *)stack_top))
+	{
+		end = (uint32_t *)(((uintptr_t)&here - DIAGNOSTICS_STACK_MARGIN) & ~(uintptr_t)3);
+	}
+	for (p = stack_bottom; p < end; p++)
+	{
+		*p = STACK_PAINT;
+	}
+}
+
+/** Find out how much of the stack has been used since paintStack() was last
+  * called.
+  * \return The number of bytes between the lowest word which doesn't
+  *         contain #STACK_PAINT and the top of the stack.
+  */
+static uint32_t measureStack(void)
+{
+	const uint32_t *p;
+
+	for (p = stack_bottom; (p < stack_top) && (*p == STACK_PAINT); p++)
+	{
+		// do nothing
+	}
+	return (uint32_t)((uintptr_t)stack_top - (uintptr_t)p);
+}
+
+/** Start measuring stack usage. This should be called by the platform once,
+  * as early as possible after boot. Until this is called, no stack
+  * statistics are recorded. It uses getStackBounds() to find the stack. */
+void diagnosticsPaintStack(void)
+{
+	uint8_t *bottom;
+	uint8_t *top;
+
+	getStackBounds(&bottom, &top);
+	// Only look at whole, aligned words.
+	stack_bottom = (uint32_t *)(((uintptr_t)bottom + 3) & ~(uintptr_t)3);
+	stack_top = (uint32_t *)((uintptr_t)top & ~(uintptr_t)3);
+	if ((bottom == NULL) || (stack_top <= stack_bottom))
+	{
+		stack_bottom = NULL;
+		return;
+	}
+	paintStack();
+}
+
+/** Get the size of the stack, as reported by the platform.
+  * \return The size of the stack in bytes, or 0 if stack usage isn't being
+  *         measured.
+  */
+uint32_t getStackSize(void)
+{
+	if (stack_bottom == NULL)
+	{
+		return 0;
+	}
+	return (uint32_t)((uintptr_t)stack_top - (uintptr_t)stack_bottom);
+}
+
+/** Get the most stack space used since boot. This doesn't include the
+  * current request.
+  * \return The peak stack usage in bytes, or 0 if stack usage isn't being
+  *         measured.
+  */
+uint32_t getPeakStackUsage(void)
+{
+	return peak_stack_bytes;
+}
+
+/** Start timing the boot sequence. This should be called by the platform
+  * once, as early as possible after reset, but after anything which
+  * getCycleCount() depends on. The first boot step begins now. */
+void diagnosticsBeginBoot(void)
+{
+	boot_steps = 0;
+	boot_step_start = getCycleCount();
+}
+
+/** Record how long the current boot step took, and begin the next one.
+  * Steps after the first #DIAGNOSTICS_BOOT_STEPS are ignored. */
+void diagnosticsEndBootStep(void)
+{
+	uint32_t now;
+
+	now = getCycleCount();
+	if (boot_steps < DIAGNOSTICS_BOOT_STEPS)
+	{
+		boot_step_ticks[boot_steps] = now - boot_step_start;
+		boot_steps++;
+	}
+	boot_step_start = now;
+}
+
+/** Get the time taken by each boot step, in getCycleCount() ticks.
+  * \param out_count Will be set to the number of boot steps which were
+  *                  recorded. This is 0 if the platform doesn't time its
+  *                  boot sequence.
+  * \return An array of *out_count tick counts, in the order the steps
+  *         happened.
+  */
+const uint32_t *getBootStepTicks(unsigned int *out_count)
+{
+	*out_count = boot_steps;
+	return boot_step_ticks;
+}
+
+/** Start timing a request. This should be called once its packet header
+  * has been received. The request begins in the compute phase. */
+void diagnosticsBeginPacket(void)
+{
+	packet_start = getCycleCount();
+	phase_start = packet_start;
+	current_phase = DIAGNOSTICS_PHASE_COMPUTE;
+	recording = true;
+}
+
+/** Stop timing a request and record how long it took.
+  * \param packet_type The type of the request's packet. If this is not less
+  *                    than #DIAGNOSTICS_NUM_PACKET_TYPES, the time still
+  *                    counts towards the phase totals, but isn't recorded
+  *                    against any packet type.
+  */
+void diagnosticsEndPacket(uint16_t packet_type)
+{
+	uint32_t now;
+	uint32_t ticks;
+	uint32_t stack_bytes;
+	CommandDiagnostics *entry;
+
+	if (!recording)
+	{
+		return;
+	}
+	now = getCycleCount();
+	phase_ticks[current_phase] += now - phase_start;
+	recording = false;
+	stack_bytes = 0;
+	if (stack_bottom != NULL)
+	{
+		// This is done after the time is recorded, so that measuring and
+		// refilling the stack doesn't count towards the request.
+		stack_bytes = measureStack();
+		if (stack_bytes > peak_stack_bytes)
+		{
+			peak_stack_bytes = stack_bytes;
+		}
+		paintStack();
+	}
+	if (packet_type >= DIAGNOSTICS_NUM_PACKET_TYPES)
+	{
+		return;
+	}
+	ticks = now - packet_start;
+	entry = &(command_diagnostics[packet_type]);
+	if (stack_bytes > entry->max_stack_bytes)
+	{
+		entry->max_stack_bytes = stack_bytes;
+	}
+	if ((entry->count == 0) || (ticks < entry->min_ticks))
+	{
+		entry->min_ticks = ticks;
+	}
+	if (ticks > entry->max_ticks)
+	{
+		entry->max_ticks = ticks;
+	}
+	entry->total_ticks += ticks;
+	entry->count++;
+}
+
+/** Change the current phase. Time up until now is counted towards the
+  * previous phase. While the device is waiting for the user, changes to
+  * #DIAGNOSTICS_PHASE_RECEIVE or #DIAGNOSTICS_PHASE_SEND are ignored, since
+  * any communication which happens during the wait (eg. receiving the reply
+  * to a ButtonRequest) is part of the wait. To end a wait, change the phase
+  * to #DIAGNOSTICS_PHASE_COMPUTE.
+  * \param phase The new phase.
+  * \return The previous phase. This can be passed to a later call to
+  *         restore the previous phase.
+  */
+DiagnosticsPhase diagnosticsSetPhase(DiagnosticsPhase phase)
+{
+	DiagnosticsPhase previous_phase;
+	uint32_t now;
+
+	previous_phase = current_phase;
+	if ((current_phase == DIAGNOSTICS_PHASE_USER_WAIT)
+		&& ((phase == DIAGNOSTICS_PHASE_RECEIVE) || (phase == DIAGNOSTICS_PHASE_SEND)))
+	{
+		return previous_phase;
+	}
+	if (recording)
+	{
+		now = getCycleCount();
+		phase_ticks[current_phase] += now - phase_start;
+		phase_start = now;
+	}
+	current_phase = phase;
+	return previous_phase;
+}
+
+/** Get the statistics for one packet type.
+  * \param packet_type The packet type to get statistics for.
+  * \return The statistics, or NULL if packet_type is not less
+  *         than #DIAGNOSTICS_NUM_PACKET_TYPES.
+  */
+const CommandDiagnostics *getCommandDiagnostics(uint16_t packet_type)
+{
+	if (packet_type >= DIAGNOSTICS_NUM_PACKET_TYPES)
+	{
+		return NULL;
+	}
+	return &(command_diagnostics[packet_type]);
+}
+
+/** Get the total time spent in one phase. This doesn't include any time
+  * spent in the current request so far.
+  * \param phase The phase; one of #DiagnosticsPhaseEnum.
+  * \return The total time, in getCycleCount() ticks.
+  */
+uint64_t getPhaseTicks(DiagnosticsPhase phase)
+{
+	if (phase >= DIAGNOSTICS_NUMBER_OF_PHASES)
+	{
+		return 0;
+	}
+	return phase_ticks[phase];
+}
+
+/** Count a non-volatile storage event.
+  * \param event The event; one of #DiagnosticsNVEventEnum.
+  */
+void diagnosticsNVEvent(DiagnosticsNVEvent event)
+{
+	if (event < DIAGNOSTICS_NV_NUMBER_OF_EVENTS)
+	{
+		nv_diagnostics.events[event]++;
+	}
+}
+
+/** Record the number of times a sector of non-volatile storage has been
+  * erased. Platforms which keep track of this (eg. in a reserved area of
+  * each sector) should call this when the count is loaded and whenever it
+  * changes. Each erase should also be counted using diagnosticsNVEvent().
+  * \param sector The index of the sector. What this refers to is up to the
+  *               platform. Sectors which are not less
+  *               than #DIAGNOSTICS_NV_SECTORS are ignored.
+  * \param erase_count The number of times the sector has been erased.
+  */
+void diagnosticsSetNVEraseCount(unsigned int sector, uint32_t erase_count)
+{
+	if (sector < DIAGNOSTICS_NV_SECTORS)
+	{
+		nv_diagnostics.sector_erase_counts[sector] = erase_count;
+	}
+}
+
+/** Start timing a call to nonVolatileFlush(). Nested calls (eg. if a flush
+  * triggers another flush) are ignored; only the outermost one is timed. */
+void diagnosticsBeginNVFlush(void)
+{
+	if (!nv_flushing)
+	{
+		nv_flush_start = getCycleCount();
+		nv_flushing = true;
+	}
+}
+
+/** Stop timing a call to nonVolatileFlush() and record how long it took. */
+void diagnosticsEndNVFlush(void)
+{
+	uint32_t ticks;
+	uint32_t remaining;
+	unsigned int bucket;
+
+	if (!nv_flushing)
+	{
+		return;
+	}
+	ticks = getCycleCount() - nv_flush_start;
+	nv_flushing = false;
+	nv_diagnostics.flushes++;
+	if (ticks > nv_diagnostics.max_flush_ticks)
+	{
+		nv_diagnostics.max_flush_ticks = ticks;
+	}
+	bucket = 0;
+	for (remaining = ticks; (remaining >= 4) && (bucket < (DIAGNOSTICS_NV_FLUSH_BUCKETS - 1)); remaining >>= 2)
+	{
+		bucket++;
+	}
+	nv_diagnostics.flush_histogram[bucket]++;
+}
+
+/** Get the statistics for non-volatile storage.
+  * \return The statistics.
+  */
+const NVDiagnostics *getNVDiagnostics(void)
+{
+	return &nv_diagnostics;
+}
+
+/** Count a completed USB transaction.
+  * \param endpoint The endpoint number. Endpoints which are not less
+  *                 than #DIAGNOSTICS_USB_ENDPOINTS are ignored.
+  * \param length The number of bytes transferred.
+  */
+void diagnosticsUSBPacket(unsigned int endpoint, uint32_t length)
+{
+	if (endpoint < DIAGNOSTICS_USB_ENDPOINTS)
+	{
+		usb_diagnostics[endpoint].packets++;
+		usb_diagnostics[endpoint].bytes += length;
+	}
+}
+
+/** Count a USB endpoint event.
+  * \param endpoint The endpoint number. Endpoints which are not less
+  *                 than #DIAGNOSTICS_USB_ENDPOINTS are ignored.
+  * \param event The event; one of #DiagnosticsUSBEventEnum.
+  */
+void diagnosticsUSBEvent(unsigned int endpoint, DiagnosticsUSBEvent event)
+{
+	if ((endpoint < DIAGNOSTICS_USB_ENDPOINTS) && (event < DIAGNOSTICS_USB_NUMBER_OF_EVENTS))
+	{
+		usb_diagnostics[endpoint].events[event]++;
+	}
+}
+
+/** Record how full the FIFO behind a USB endpoint is. Only the maximum is
+  * kept, so this only needs to be called after bytes are added to the FIFO.
+  * \param endpoint The endpoint number. Endpoints which are not less
+  *                 than #DIAGNOSTICS_USB_ENDPOINTS are ignored.
+  * \param depth The number of bytes in the FIFO.
+  */
+void diagnosticsUSBFIFODepth(unsigned int endpoint, uint32_t depth)
+{
+	if ((endpoint < DIAGNOSTICS_USB_ENDPOINTS) && (depth > usb_diagnostics[endpoint].max_fifo_depth))
+	{
+		usb_diagnostics[endpoint].max_fifo_depth = depth;
+	}
+}
+
+/** Get the statistics for one USB endpoint.
+  * \param endpoint The endpoint number.
+  * \return The statistics, or NULL if endpoint is out of range.
+  */
+const USBEndpointDiagnostics *getUSBDiagnostics(unsigned int endpoint)
+{
+	if (endpoint >= DIAGNOSTICS_USB_ENDPOINTS)
+	{
+		return NULL;
+	}
+	return &(usb_diagnostics[endpoint]);
+}
+
+#endif // #ifdef ENABLE_DIAGNOSTICS
+
+#if defined(TEST) && defined(ENABLE_DIAGNOSTICS) && !defined(TEST_DIAGNOSTICS)
+
+/** Stand-in for the platform's stack bounds. The other unit tests don't
+  * measure stack usage, so this reports an empty stack.
+  * \param out_bottom Will be set to NULL.
+  * \param out_top Will be set to NULL.
+  */
+void getStackBounds(uint8_t **out_bottom, uint8_t **out_top)
+{
+	*out_bottom = NULL;
+	*out_top = NULL;
+}
+
+#endif // #if defined(TEST) && defined(ENABLE_DIAGNOSTICS) && !defined(TEST_DIAGNOSTICS)
+
+#ifdef TEST_DIAGNOSTICS
+
+/** The value which getCycleCount() will return. The tests advance this
+  * manually, so that timings are predictable. */
+static uint32_t fake_cycle_count;
+
+/** Number of words in #fake_stack. */
+#define FAKE_STACK_WORDS	64
+
+/** Area which the tests pretend is the stack. Since this isn't where the
+  * stack pointer is, diagnosticsPaintStack() will fill all of it. */
+static uint32_t fake_stack[FAKE_STACK_WORDS];
+
+/** Stand-in for the platform's stack bounds.
+  * \param out_bottom Will be set to the start of #fake_stack.
+  * \param out_top Will be set to the end of #fake_stack.
+  */
+void getStackBounds(uint8_t **out_bottom, uint8_t **out_top)
+{
+	*out_bottom = (uint8_t *)fake_stack;
+	*out_top = (uint8_t *)&(fake_stack[FAKE_STACK_WORDS]);
+}
+
+/** Pretend to use the top of the stack.
+  * \param words The number of words at the top of #fake_stack to overwrite.
+  */
+static void useFakeStack(unsigned int words)
+{
+	unsigned int i;
+
+	for (i = FAKE_STACK_WORDS - words; i < FAKE_STACK_WORDS; i++)
+	{
+		fake_stack[i] = i;
+	}
+}
+
+/** Check the stack usage statistics.
+  * \param packet_type The packet type to check the maximum usage of.
+  * \param max_stack_bytes Expected maximum usage for that packet type.
+  * \param peak Expected peak usage since boot.
+  * \param name Name of the test, for reporting failures.
+  */
+static void checkStack(uint16_t packet_type, uint32_t max_stack_bytes, uint32_t peak, const char *name)
+{
+	if ((getCommandDiagnostics(packet_type)->max_stack_bytes == max_stack_bytes)
+		&& (getPeakStackUsage() == peak))
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("Wrong stack usage for %s\n", name);
+		reportFailure();
+	}
+}
+
+/** Stand-in for the platform's cycle counter.
+  * \return The value of #fake_cycle_count.
+  */
+uint32_t getCycleCount(void)
+{
+	return fake_cycle_count;
+}
+
+/** Check the statistics for one packet type.
+  * \param packet_type The packet type to check.
+  * \param count Expected number of packets.
+  * \param min_ticks Expected minimum time.
+  * \param max_ticks Expected maximum time.
+  * \param total_ticks Expected total time.
+  * \param name Name of the test, for reporting failures.
+  */
+static void checkCommand(uint16_t packet_type, uint32_t count, uint32_t min_ticks, uint32_t max_ticks, uint64_t total_ticks, const char *name)
+{
+	const CommandDiagnostics *entry;
+
+	entry = getCommandDiagnostics(packet_type);
+	if ((entry != NULL) && (entry->count == count) && (entry->min_ticks == min_ticks)
+		&& (entry->max_ticks == max_ticks) && (entry->total_ticks == total_ticks))
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("Wrong statistics for %s\n", name);
+		reportFailure();
+	}
+}
+
+/** Check the total time spent in each phase.
+  * \param compute Expected time spent in #DIAGNOSTICS_PHASE_COMPUTE.
+  * \param receive Expected time spent in #DIAGNOSTICS_PHASE_RECEIVE.
+  * \param user_wait Expected time spent in #DIAGNOSTICS_PHASE_USER_WAIT.
+  * \param send Expected time spent in #DIAGNOSTICS_PHASE_SEND.
+  * \param name Name of the test, for reporting failures.
+  */
+static void checkPhases(uint64_t compute, uint64_t receive, uint64_t user_wait, uint64_t send, const char *name)
+{
+	if ((getPhaseTicks(DIAGNOSTICS_PHASE_COMPUTE) == compute)
+		&& (getPhaseTicks(DIAGNOSTICS_PHASE_RECEIVE) == receive)
+		&& (getPhaseTicks(DIAGNOSTICS_PHASE_USER_WAIT) == user_wait)
+		&& (getPhaseTicks(DIAGNOSTICS_PHASE_SEND) == send))
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("Wrong phase totals for %s\n", name);
+		reportFailure();
+	}
+}
+
+/** Time one (fake) call to nonVolatileFlush().
+  * \param ticks How long the call should take.
+  */
+static void timeFlush(uint32_t ticks)
+{
+	diagnosticsBeginNVFlush();
+	fake_cycle_count += ticks;
+	diagnosticsEndNVFlush();
+}
+
+int main(void)
+{
+	DiagnosticsPhase previous_phase;
+	const NVDiagnostics *nv;
+	const uint32_t *boot_ticks;
+	unsigned int boot_count;
+	unsigned int i;
+	bool wrong;
+
+	initTests(__FILE__);
+
+	// Nothing should be recorded before the first request.
+	checkCommand(0, 0, 0, 0, 0, "initial state");
+	checkPhases(0, 0, 0, 0, "initial state");
+	if (getCommandDiagnostics(DIAGNOSTICS_NUM_PACKET_TYPES) == NULL)
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("getCommandDiagnostics() accepts out of range packet type\n");
+		reportFailure();
+	}
+
+	// Phase changes outside a request shouldn't count towards anything.
+	fake_cycle_count = 1000;
+	diagnosticsSetPhase(DIAGNOSTICS_PHASE_RECEIVE);
+	fake_cycle_count = 2000;
+	diagnosticsSetPhase(DIAGNOSTICS_PHASE_COMPUTE);
+	checkPhases(0, 0, 0, 0, "idle receive");
+
+	// A request with: 10 ticks receive, 20 ticks compute, 30 ticks send.
+	diagnosticsBeginPacket();
+	previous_phase = diagnosticsSetPhase(DIAGNOSTICS_PHASE_RECEIVE);
+	fake_cycle_count += 10;
+	diagnosticsSetPhase(previous_phase);
+	fake_cycle_count += 20;
+	previous_phase = diagnosticsSetPhase(DIAGNOSTICS_PHASE_SEND);
+	fake_cycle_count += 30;
+	diagnosticsSetPhase(previous_phase);
+	diagnosticsEndPacket(0x05);
+	checkCommand(0x05, 1, 60, 60, 60, "first request");
+	checkPhases(20, 10, 0, 30, "first request");
+
+	// A request of the same type with a user wait in it. Communication
+	// during the wait should count as waiting.
+	diagnosticsBeginPacket();
+	fake_cycle_count += 5;
+	diagnosticsSetPhase(DIAGNOSTICS_PHASE_USER_WAIT);
+	fake_cycle_count += 100;
+	previous_phase = diagnosticsSetPhase(DIAGNOSTICS_PHASE_RECEIVE);
+	fake_cycle_count += 7;
+	diagnosticsSetPhase(previous_phase);
+	fake_cycle_count += 3;
+	diagnosticsSetPhase(DIAGNOSTICS_PHASE_COMPUTE);
+	fake_cycle_count += 15;
+	diagnosticsEndPacket(0x05);
+	checkCommand(0x05, 2, 60, 130, 190, "second request");
+	checkPhases(40, 10, 110, 30, "second request");
+
+	// A short request of the same type, which should become the minimum.
+	// The cycle counter wraps around during this one.
+	fake_cycle_count = 0xfffffffe;
+	diagnosticsBeginPacket();
+	fake_cycle_count += 4;
+	diagnosticsEndPacket(0x05);
+	checkCommand(0x05, 3, 4, 130, 194, "short request");
+	checkPhases(44, 10, 110, 30, "short request");
+
+	// Other packet types shouldn't be affected.
+	checkCommand(0x06, 0, 0, 0, 0, "unused packet type");
+
+	// A packet type which is too large should still count towards the
+	// phase totals.
+	diagnosticsBeginPacket();
+	fake_cycle_count += 8;
+	diagnosticsEndPacket(DIAGNOSTICS_NUM_PACKET_TYPES);
+	checkPhases(52, 10, 110, 30, "out of range packet type");
+
+	// Ending a request twice shouldn't record it twice.
+	diagnosticsEndPacket(0x05);
+	checkCommand(0x05, 3, 4, 130, 194, "ended twice");
+
+	// Non-volatile storage events should be counted separately.
+	nv = getNVDiagnostics();
+	diagnosticsNVEvent(DIAGNOSTICS_NV_READ);
+	diagnosticsNVEvent(DIAGNOSTICS_NV_READ);
+	diagnosticsNVEvent(DIAGNOSTICS_NV_WRITE);
+	diagnosticsNVEvent(DIAGNOSTICS_NV_CACHE_MISS);
+	diagnosticsNVEvent(DIAGNOSTICS_NV_NUMBER_OF_EVENTS); // should be ignored
+	if ((nv->events[DIAGNOSTICS_NV_READ] == 2) && (nv->events[DIAGNOSTICS_NV_WRITE] == 1)
+		&& (nv->events[DIAGNOSTICS_NV_ERASE] == 0) && (nv->events[DIAGNOSTICS_NV_CACHE_HIT] == 0)
+		&& (nv->events[DIAGNOSTICS_NV_CACHE_MISS] == 1))
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("Wrong non-volatile storage event counts\n");
+		reportFailure();
+	}
+
+	// Check the boundaries of the flush histogram buckets.
+	timeFlush(0);
+	timeFlush(3);
+	timeFlush(4);
+	timeFlush(15);
+	timeFlush(16);
+	timeFlush(0x3fffffff);
+	timeFlush(0x40000000);
+	timeFlush(0xffffffff);
+	wrong = false;
+	for (i = 0; i < DIAGNOSTICS_NV_FLUSH_BUCKETS; i++)
+	{
+		if (((i == 0) || (i == 1)) && (nv->flush_histogram[i] != 2))
+		{
+			wrong = true;
+		}
+		else if (((i == 2) || (i == 14)) && (nv->flush_histogram[i] != 1))
+		{
+			wrong = true;
+		}
+		else if ((i == 15) && (nv->flush_histogram[i] != 2))
+		{
+			wrong = true;
+		}
+		else if ((i > 2) && (i < 14) && (nv->flush_histogram[i] != 0))
+		{
+			wrong = true;
+		}
+	}
+	if (!wrong && (nv->flushes == 8) && (nv->max_flush_ticks == 0xffffffff))
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("Wrong flush statistics\n");
+		reportFailure();
+	}
+
+	// A nested flush shouldn't be timed separately.
+	diagnosticsBeginNVFlush();
+	fake_cycle_count += 10;
+	timeFlush(20);
+	diagnosticsEndNVFlush();
+	if ((nv->flushes == 9) && (nv->flush_histogram[2] == 2))
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("Nested flush timed separately\n");
+		reportFailure();
+	}
+
+	// Erase counts are set, not incremented, and out of range sectors are
+	// ignored.
+	diagnosticsSetNVEraseCount(0, 42);
+	diagnosticsSetNVEraseCount(DIAGNOSTICS_NV_SECTORS - 1, 7);
+	diagnosticsSetNVEraseCount(DIAGNOSTICS_NV_SECTORS - 1, 8);
+	diagnosticsSetNVEraseCount(DIAGNOSTICS_NV_SECTORS, 99);
+	if ((nv->sector_erase_counts[0] == 42) && (nv->sector_erase_counts[1] == 0)
+		&& (nv->sector_erase_counts[DIAGNOSTICS_NV_SECTORS - 1] == 8))
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("Wrong sector erase counts\n");
+		reportFailure();
+	}
+
+	// Nothing should be measured before the stack is painted.
+	diagnosticsBeginPacket();
+	useFakeStack(10);
+	diagnosticsEndPacket(0x07);
+	checkStack(0x07, 0, 0, "unpainted stack");
+	if (getStackSize() == 0)
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("Stack size reported before painting\n");
+		reportFailure();
+	}
+
+	// Each request should be measured separately, since the stack is
+	// painted again after each one.
+	diagnosticsPaintStack();
+	if (getStackSize() == sizeof(fake_stack))
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("Wrong stack size\n");
+		reportFailure();
+	}
+	diagnosticsBeginPacket();
+	useFakeStack(20);
+	diagnosticsEndPacket(0x07);
+	checkStack(0x07, 80, 80, "first measured request");
+	diagnosticsBeginPacket();
+	useFakeStack(5);
+	diagnosticsEndPacket(0x08);
+	checkStack(0x08, 20, 80, "smaller request");
+	diagnosticsBeginPacket();
+	useFakeStack(FAKE_STACK_WORDS);
+	diagnosticsEndPacket(0x07);
+	checkStack(0x07, sizeof(fake_stack), sizeof(fake_stack), "whole stack used");
+	checkStack(0x08, 20, sizeof(fake_stack), "other packet type unaffected");
+
+	// Each boot step should be timed from the end of the previous one, and
+	// steps which don't fit should be dropped.
+	getBootStepTicks(&i);
+	if (i == 0)
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("Boot steps recorded before boot began\n");
+		reportFailure();
+	}
+	diagnosticsBeginBoot();
+	for (i = 0; i < (DIAGNOSTICS_BOOT_STEPS + 2); i++)
+	{
+		fake_cycle_count += 100 + i;
+		diagnosticsEndBootStep();
+	}
+	boot_ticks = getBootStepTicks(&boot_count);
+	wrong = (boot_count != DIAGNOSTICS_BOOT_STEPS);
+	for (i = 0; i < boot_count; i++)
+	{
+		if (boot_ticks[i] != (100 + i))
+		{
+			wrong = true;
+		}
+	}
+	if (!wrong)
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("Boot steps timed incorrectly\n");
+		reportFailure();
+	}
+
+	// USB statistics should be kept separately for each endpoint, and out
+	// of range endpoints and events should be ignored.
+	diagnosticsUSBPacket(2, 64);
+	diagnosticsUSBPacket(2, 10);
+	diagnosticsUSBPacket(1, 0);
+	diagnosticsUSBPacket(DIAGNOSTICS_USB_ENDPOINTS, 64);
+	diagnosticsUSBEvent(2, DIAGNOSTICS_USB_FIFO_FULL);
+	diagnosticsUSBEvent(1, DIAGNOSTICS_USB_FIFO_EMPTY);
+	diagnosticsUSBEvent(1, DIAGNOSTICS_USB_FIFO_EMPTY);
+	diagnosticsUSBEvent(0, DIAGNOSTICS_USB_STALL);
+	diagnosticsUSBEvent(0, DIAGNOSTICS_USB_NUMBER_OF_EVENTS);
+	diagnosticsUSBEvent(DIAGNOSTICS_USB_ENDPOINTS, DIAGNOSTICS_USB_STALL);
+	diagnosticsUSBFIFODepth(2, 100);
+	diagnosticsUSBFIFODepth(2, 50);
+	diagnosticsUSBFIFODepth(DIAGNOSTICS_USB_ENDPOINTS, 200);
+	if ((getUSBDiagnostics(2)->packets == 2) && (getUSBDiagnostics(2)->bytes == 74)
+		&& (getUSBDiagnostics(2)->events[DIAGNOSTICS_USB_FIFO_FULL] == 1)
+		&& (getUSBDiagnostics(2)->max_fifo_depth == 100)
+		&& (getUSBDiagnostics(1)->packets == 1) && (getUSBDiagnostics(1)->bytes == 0)
+		&& (getUSBDiagnostics(1)->events[DIAGNOSTICS_USB_FIFO_EMPTY] == 2)
+		&& (getUSBDiagnostics(1)->max_fifo_depth == 0)
+		&& (getUSBDiagnostics(0)->packets == 0)
+		&& (getUSBDiagnostics(0)->events[DIAGNOSTICS_USB_STALL] == 1)
+		&& (getUSBDiagnostics(DIAGNOSTICS_USB_ENDPOINTS) == NULL))
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("Wrong USB statistics\n");
+		reportFailure();
+	}
+
+	finishTests();
+	exit(0);
+}
+
+#endif // #ifdef TEST_DIAGNOSTICS
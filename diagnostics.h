@@ -0,0 +1,199 @@
+/** \file diagnostics.h
+  *
+  * \brief Describes functions and types exported by diagnostics.c.
+  *
+  * This file is licensed as described by the file LICENCE.
+  */
+
+#ifndef DIAGNOSTICS_H_INCLUDED
+#define DIAGNOSTICS_H_INCLUDED
+
+#include "common.h"
+
+#ifndef DIAGNOSTICS_NUM_PACKET_TYPES
+/** Statistics are kept for packet types (see stream_comm.h) 0 to
+  * DIAGNOSTICS_NUM_PACKET_TYPES - 1; this should cover every request which
+  * processPacket() handles. Packets with other types aren't recorded. This
+  * can be overridden by defining DIAGNOSTICS_NUM_PACKET_TYPES in the
+  * platform's build settings. */
+#define DIAGNOSTICS_NUM_PACKET_TYPES	0x21
+#endif // #ifndef DIAGNOSTICS_NUM_PACKET_TYPES
+
+#ifndef DIAGNOSTICS_NV_SECTORS
+/** Erase counts are kept for non-volatile storage sectors 0 to
+  * DIAGNOSTICS_NV_SECTORS - 1. What a "sector" is depends on the platform;
+  * see diagnosticsSetNVEraseCount(). This can be overridden by
+  * defining DIAGNOSTICS_NV_SECTORS in the platform's build settings. */
+#define DIAGNOSTICS_NV_SECTORS			16
+#endif // #ifndef DIAGNOSTICS_NV_SECTORS
+
+#ifndef DIAGNOSTICS_BOOT_STEPS
+/** Maximum number of boot steps which are timed (see
+  * diagnosticsEndBootStep()). Further steps aren't recorded. This can be
+  * overridden by defining DIAGNOSTICS_BOOT_STEPS in the platform's build
+  * settings. */
+#define DIAGNOSTICS_BOOT_STEPS			8
+#endif // #ifndef DIAGNOSTICS_BOOT_STEPS
+
+#ifndef DIAGNOSTICS_USB_ENDPOINTS
+/** Statistics are kept for USB endpoints 0 to
+  * DIAGNOSTICS_USB_ENDPOINTS - 1 (see diagnosticsUSBPacket()). Other
+  * endpoints are ignored. This can be overridden by
+  * defining DIAGNOSTICS_USB_ENDPOINTS in the platform's build settings. */
+#define DIAGNOSTICS_USB_ENDPOINTS		5
+#endif // #ifndef DIAGNOSTICS_USB_ENDPOINTS
+
+/** Number of buckets in the histogram of nonVolatileFlush() times. Bucket 0
+  * counts flushes which took less than 4 ticks and bucket i (for i > 0)
+  * counts flushes which took at least 4 ^ i ticks but less
+  * than 4 ^ (i + 1) ticks, so 16 buckets cover every 32 bit tick count. */
+#define DIAGNOSTICS_NV_FLUSH_BUCKETS	16
+
+/** What the device is spending time on while handling a request (see
+  * diagnosticsSetPhase()). */
+typedef enum DiagnosticsPhaseEnum
+{
+	/** Doing anything other than the things below. */
+	DIAGNOSTICS_PHASE_COMPUTE		=	0,
+	/** Reading from the stream. */
+	DIAGNOSTICS_PHASE_RECEIVE		=	1,
+	/** Waiting for the user, or for the host to get a response from the
+	  * user (eg. a password). */
+	DIAGNOSTICS_PHASE_USER_WAIT		=	2,
+	/** Writing to the stream. */
+	DIAGNOSTICS_PHASE_SEND			=	3,
+	/** Number of phases; this must be last. */
+	DIAGNOSTICS_NUMBER_OF_PHASES	=	4
+} DiagnosticsPhase;
+
+/** Statistics for one packet type. All times are in getCycleCount()
+  * ticks. */
+typedef struct CommandDiagnosticsStruct
+{
+	/** Number of packets of this type which have been handled. */
+	uint32_t count;
+	/** Shortest time taken to handle one packet. */
+	uint32_t min_ticks;
+	/** Longest time taken to handle one packet. */
+	uint32_t max_ticks;
+	/** Total time taken to handle all packets. */
+	uint64_t total_ticks;
+	/** Most stack space used while handling one packet, in bytes. This is
+	  * only recorded if the platform called diagnosticsPaintStack(). */
+	uint32_t max_stack_bytes;
+} CommandDiagnostics;
+
+/** Non-volatile storage events which are counted
+  * (see diagnosticsNVEvent()). */
+typedef enum DiagnosticsNVEventEnum
+{
+	/** A successful call to nonVolatileRead(). */
+	DIAGNOSTICS_NV_READ				=	0,
+	/** A successful call to nonVolatileWrite() or nonVolatileFill(). */
+	DIAGNOSTICS_NV_WRITE			=	1,
+	/** An erase of a sector (or page) of the underlying memory. */
+	DIAGNOSTICS_NV_ERASE			=	2,
+	/** A write which found its block already in the platform's write
+	  * cache. */
+	DIAGNOSTICS_NV_CACHE_HIT		=	3,
+	/** A write which had to load its block into the platform's write
+	  * cache. */
+	DIAGNOSTICS_NV_CACHE_MISS		=	4,
+	/** Number of events; this must be last. */
+	DIAGNOSTICS_NV_NUMBER_OF_EVENTS	=	5
+} DiagnosticsNVEvent;
+
+/** Statistics for non-volatile storage. Times are in getCycleCount()
+  * ticks. */
+typedef struct NVDiagnosticsStruct
+{
+	/** Number of times each event happened, indexed
+	  * by #DiagnosticsNVEvent. */
+	uint32_t events[DIAGNOSTICS_NV_NUMBER_OF_EVENTS];
+	/** Number of calls to nonVolatileFlush(). */
+	uint32_t flushes;
+	/** Longest time taken by one call to nonVolatileFlush(). */
+	uint32_t max_flush_ticks;
+	/** Histogram of the time taken by each call to nonVolatileFlush(). See
+	  * #DIAGNOSTICS_NV_FLUSH_BUCKETS for what each bucket covers. */
+	uint32_t flush_histogram[DIAGNOSTICS_NV_FLUSH_BUCKETS];
+	/** Number of times each sector has been erased over the lifetime of the
+	  * device, as far as the platform knows. */
+	uint32_t sector_erase_counts[DIAGNOSTICS_NV_SECTORS];
+} NVDiagnostics;
+
+/** USB endpoint events which are counted (see diagnosticsUSBEvent()). The
+  * FIFO is the stream FIFO behind the endpoint: the receive FIFO for OUT
+  * endpoints and the transmit FIFO for IN endpoints. */
+typedef enum DiagnosticsUSBEventEnum
+{
+	/** The endpoint was stalled. */
+	DIAGNOSTICS_USB_STALL			=	0,
+	/** The FIFO was full, so traffic stopped until the other side caught
+	  * up. For an OUT endpoint, this means no receive could be queued, so
+	  * the host is NAKed until the device reads from the FIFO. */
+	DIAGNOSTICS_USB_FIFO_FULL		=	1,
+	/** The FIFO was empty when the endpoint finished a transaction, so
+	  * nothing more could be queued and the host is NAKed. */
+	DIAGNOSTICS_USB_FIFO_EMPTY		=	2,
+	/** Number of events; this must be last. */
+	DIAGNOSTICS_USB_NUMBER_OF_EVENTS	=	3
+} DiagnosticsUSBEvent;
+
+/** Statistics for one USB endpoint. */
+typedef struct USBEndpointDiagnosticsStruct
+{
+	/** Number of transactions (in either direction) which completed. */
+	uint32_t packets;
+	/** Number of bytes transferred by those transactions. */
+	uint32_t bytes;
+	/** Number of times each event happened, indexed
+	  * by #DiagnosticsUSBEvent. */
+	uint32_t events[DIAGNOSTICS_USB_NUMBER_OF_EVENTS];
+	/** Most bytes that the FIFO behind the endpoint has held. */
+	uint32_t max_fifo_depth;
+} USBEndpointDiagnostics;
+
+#ifdef ENABLE_DIAGNOSTICS
+
+extern void diagnosticsBeginPacket(void);
+extern void diagnosticsEndPacket(uint16_t packet_type);
+extern DiagnosticsPhase diagnosticsSetPhase(DiagnosticsPhase phase);
+extern const CommandDiagnostics *getCommandDiagnostics(uint16_t packet_type);
+extern uint64_t getPhaseTicks(DiagnosticsPhase phase);
+extern void diagnosticsNVEvent(DiagnosticsNVEvent event);
+extern void diagnosticsSetNVEraseCount(unsigned int sector, uint32_t erase_count);
+extern void diagnosticsBeginNVFlush(void);
+extern void diagnosticsEndNVFlush(void);
+extern const NVDiagnostics *getNVDiagnostics(void);
+extern void diagnosticsPaintStack(void);
+extern uint32_t getStackSize(void);
+extern uint32_t getPeakStackUsage(void);
+extern void diagnosticsBeginBoot(void);
+extern void diagnosticsEndBootStep(void);
+extern const uint32_t *getBootStepTicks(unsigned int *out_count);
+extern void diagnosticsUSBPacket(unsigned int endpoint, uint32_t length);
+extern void diagnosticsUSBEvent(unsigned int endpoint, DiagnosticsUSBEvent event);
+extern void diagnosticsUSBFIFODepth(unsigned int endpoint, uint32_t depth);
+extern const USBEndpointDiagnostics *getUSBDiagnostics(unsigned int endpoint);
+
+#else
+
+// Without ENABLE_DIAGNOSTICS, nothing is recorded.
+#define diagnosticsBeginPacket()
+#define diagnosticsEndPacket(packet_type)
+#define diagnosticsSetPhase(phase)
+#define diagnosticsNVEvent(event)
+#define diagnosticsSetNVEraseCount(sector, erase_count)
+#define diagnosticsBeginNVFlush()
+#define diagnosticsEndNVFlush()
+#define diagnosticsPaintStack()
+#define diagnosticsBeginBoot()
+#define diagnosticsEndBootStep()
+#define diagnosticsUSBPacket(endpoint, length)
+#define diagnosticsUSBEvent(endpoint, event)
+#define diagnosticsUSBFIFODepth(endpoint, depth)
+
+#endif // #ifdef ENABLE_DIAGNOSTICS
+
+#endif // #ifndef DIAGNOSTICS_H_INCLUDED
@@ -4,7 +4,9 @@
   *
   * Functions relevant to ECDSA signing include those which perform group
   * operations on points of an elliptic curve (eg. pointAdd() and
-  * pointDouble()) and the actual signing function, ecdsaSign().
+  * pointDouble()) and the actual signing function, ecdsaSign(). There is
+  * also a verification function, ecdsaVerify(), which can be used to check
+  * signatures before they are released.
   *
   * The elliptic curve used is secp256k1, from the document
   * "SEC 2: Recommended Elliptic Curve Domain Parameters" by Certicom
@@ -22,9 +24,19 @@
   * There are some data-dependent branches in here, but they're expected to
   * only make a difference (in timing) in exceptional cases.
   *
+  * If ECDSA_USE_ENDOMORPHISM is defined, pointMultiply() uses the
+  * efficiently computable endomorphism of secp256k1 (the GLV method) to
+  * halve the number of point doublings it does. This is optional because it
+  * adds some code and complexity; the default is the plain fixed window
+  * method.
+  *
   * This file is licensed as described by the file LICENCE.
   */
 
+#ifdef TEST
+#include <assert.h>
+#endif // #ifdef TEST
+
 #ifdef TEST_ECDSA
 #include <stdlib.h>
 #include <stdio.h>
@@ -32,11 +44,19 @@
 #include "test_helpers.h"
 #endif // #ifdef TEST_ECDSA
 
+#ifdef BENCH_ECDSA
+#include <stdlib.h>
+#include "test_helpers.h"
+#endif // #ifdef BENCH_ECDSA
+
 #include "common.h"
 #include "bignum256.h"
 #include "ecdsa.h"
 #include "endian.h"
 #include "hmac_drbg.h"
+#include "hwinterface.h"
+#include "scratch.h"
+#include "ecdsa_comb_table.h"
 
 /** A point on the elliptic curve, in Jacobian coordinates. The
   * Jacobian coordinates (x, y, z) are related to affine coordinates
@@ -84,20 +104,103 @@ static const uint8_t secp256k1_complement_n[17] = {
 0xc4, 0x5f, 0xb7, 0x50, 0x19, 0x23, 0x51, 0x45,
 0x01};
 
+/** The curve parameter b of secp256k1. The other parameter, a, is zero. */
+static const uint8_t secp256k1_b[32] = {
+0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+
+/** 2 ^ 512 modulo #secp256k1_n. This is used to convert numbers into the
+  * Montgomery domain (see bigToMontgomery()). */
+static const uint8_t secp256k1_n_r_squared[32] = {
+0x40, 0xd1, 0xd7, 0x67, 0x14, 0xf2, 0x6c, 0x89,
+0x78, 0xf8, 0x7c, 0x0e, 0xc2, 0x96, 0x14, 0x74,
+0xc6, 0x07, 0xcd, 0x5b, 0xe4, 0xf5, 0x97, 0xe6,
+0xc5, 0x9b, 0xc6, 0x81, 0xd5, 0x1c, 0x67, 0x9d};
+
+/** -(#secp256k1_n ^ -1) modulo 2 ^ 32, for Montgomery reduction. */
+#define SECP256K1_N_PRIME	0x5588b13fUL
+
+#if CONSTANT_RAM_BUDGET >= 64
+/** Storage attribute for G. There's enough of #CONSTANT_RAM_BUDGET for G, so
+  * it goes in RAM. */
+#define G_STORAGE
+/** Copy one component of G. */
+#define LOOKUP_G(dest, src)	(memcpy((dest), (src), 32))
+#else
+/** Storage attribute for G. */
+#define G_STORAGE			PROGMEM
+/** Copy one component of G. */
+#define LOOKUP_G(dest, src)	(LOOKUP_BLOCK((dest), (src), 32))
+#endif // #if CONSTANT_RAM_BUDGET >= 64
+
 /** The x component of the base point G used in secp256k1. */
-static const uint8_t secp256k1_Gx[32] PROGMEM = {
+static const uint8_t secp256k1_Gx[32] G_STORAGE = {
 0x98, 0x17, 0xf8, 0x16, 0x5b, 0x81, 0xf2, 0x59,
 0xd9, 0x28, 0xce, 0x2d, 0xdb, 0xfc, 0x9b, 0x02,
 0x07, 0x0b, 0x87, 0xce, 0x95, 0x62, 0xa0, 0x55,
 0xac, 0xbb, 0xdc, 0xf9, 0x7e, 0x66, 0xbe, 0x79};
 
 /** The y component of the base point G used in secp256k1. */
-static const uint8_t secp256k1_Gy[32] PROGMEM = {
+static const uint8_t secp256k1_Gy[32] G_STORAGE = {
 0xb8, 0xd4, 0x10, 0xfb, 0x8f, 0xd0, 0x47, 0x9c,
 0x19, 0x54, 0x85, 0xa6, 0x48, 0xb4, 0x17, 0xfd,
 0xa8, 0x08, 0x11, 0x0e, 0xfc, 0xfb, 0xa4, 0x5d,
 0x65, 0xc4, 0xa3, 0x26, 0x77, 0xda, 0x3a, 0x48};
 
+#ifdef ECDSA_USE_ENDOMORPHISM
+
+/** A cube root of unity modulo #secp256k1_p. If (x, y) is a point on
+  * secp256k1, then (beta x x, y) = lambda x (x, y), where lambda is
+  * #secp256k1_lambda. */
+static const uint8_t secp256k1_beta[32] = {
+0xee, 0x01, 0x95, 0x71, 0x28, 0x6c, 0x39, 0xc1,
+0x95, 0x89, 0xf5, 0x12, 0x75, 0x49, 0xf0, 0x9c,
+0xe9, 0x34, 0x34, 0xac, 0x9e, 0x47, 0x64, 0x6e,
+0x10, 0x07, 0x7c, 0x65, 0x2b, 0x6a, 0xe9, 0x7a};
+
+/** A cube root of unity modulo #secp256k1_n, which corresponds to
+  * #secp256k1_beta. */
+static const uint8_t secp256k1_lambda[32] = {
+0x72, 0xbd, 0x23, 0x1b, 0x7c, 0x96, 0x02, 0xdf,
+0x78, 0x66, 0x81, 0x20, 0xea, 0x22, 0x2e, 0x12,
+0x5a, 0x64, 0x12, 0x88, 0x02, 0x1c, 0x26, 0xa5,
+0xe0, 0x30, 0x5c, 0xc0, 0x4c, 0xad, 0x63, 0x53};
+
+/** The lattice basis used by splitScalar() is (a1, b1), (a2, b2). This is
+  * -b1 (modulo #secp256k1_n). */
+static const uint8_t glv_minus_b1[32] = {
+0xc3, 0xe4, 0xbf, 0x0a, 0xa9, 0x7f, 0x54, 0x6f,
+0x28, 0x88, 0x0e, 0x01, 0xd6, 0x7e, 0x43, 0xe4,
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+
+/** -b2 (modulo #secp256k1_n). See #glv_minus_b1. */
+static const uint8_t glv_minus_b2[32] = {
+0x2c, 0x56, 0xb1, 0x3d, 0xa8, 0xcd, 0x65, 0xd7,
+0x6d, 0x34, 0x74, 0x07, 0xc5, 0x0a, 0x28, 0x8a,
+0xfe, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
+
+/** round(2 ^ 384 x b2 / n), where n is #secp256k1_n. See
+  * #glv_minus_b1. */
+static const uint8_t glv_g1[32] = {
+0x31, 0xb0, 0xdb, 0x45, 0x9a, 0x20, 0x93, 0xe8,
+0x7f, 0xca, 0xe8, 0x71, 0x14, 0x8a, 0xaa, 0x3d,
+0x15, 0xeb, 0x84, 0x92, 0xe4, 0x90, 0x6c, 0xe8,
+0xcd, 0x6b, 0xd4, 0xa7, 0x21, 0xd2, 0x86, 0x30};
+
+/** round(2 ^ 384 x -b1 / n), where n is #secp256k1_n. See
+  * #glv_minus_b1. */
+static const uint8_t glv_g2[32] = {
+0x71, 0x7f, 0xc4, 0x8a, 0xae, 0xb4, 0x71, 0x15,
+0xc6, 0x06, 0xf5, 0x9d, 0xac, 0x08, 0x12, 0x22,
+0xc4, 0xe4, 0xbf, 0x0a, 0xa9, 0x7f, 0x54, 0x6f,
+0x28, 0x88, 0x0e, 0x01, 0xd6, 0x7e, 0x43, 0xe4};
+
+#endif // #ifdef ECDSA_USE_ENDOMORPHISM
+
 /** Convert a point from affine coordinates to Jacobian coordinates. This
   * is very fast.
   * \param out The destination point (in Jacobian coordinates).
@@ -127,13 +230,13 @@ static NOINLINE void jacobianToAffine(PointAffine *out, PointJacobian *in)
 	out->is_point_at_infinity = in->is_point_at_infinity;
 	// If out->is_point_at_infinity != 0, the rest of this function consists
 	// of dummy operations.
-	bigMultiply(s, in->z, in->z);
-	bigMultiply(t, s, in->z);
+	bigSquareModP(s, in->z);
+	bigMultiplyModP(t, s, in->z);
 	// Now s = z ^ 2 and t = z ^ 3.
-	bigInvert(s, s);
-	bigInvert(t, t);
-	bigMultiply(out->x, in->x, s);
-	bigMultiply(out->y, in->y, t);
+	bigInvertModP(s, s);
+	bigInvertModP(t, t);
+	bigMultiplyModP(out->x, in->x, s);
+	bigMultiplyModP(out->y, in->y, t);
 }
 
 /** Double (p = 2 x p) the point p (which is in Jacobian coordinates), placing
@@ -146,7 +249,7 @@ static NOINLINE void jacobianToAffine(PointAffine *out, PointJacobian *in)
   * from section 4 of that article.
   * \param p The point (in Jacobian coordinates) to double.
   */
-static NOINLINE void pointDouble(PointJacobian *p)
+static NOINLINE HOT_FUNCTION void pointDouble(PointJacobian *p)
 {
 	uint8_t t[32];
 	uint8_t u[32];
@@ -160,31 +263,36 @@ static NOINLINE void pointDouble(PointJacobian *p)
 	// function will consist of dummy operations.
 	p->is_point_at_infinity |= bigIsZero(p->y);
 
-	bigMultiply(p->z, p->z, p->y);
+	// Intermediate values which only feed into multiplications or other
+	// relaxed additions/subtractions are only partially reduced (see
+	// bigAddModPRelaxed()). The coordinates of p are fully reduced at the
+	// end, since pointAdd() compares them and bigIsZero() is used on y.
+	bigMultiplyModP(p->z, p->z, p->y);
 	bigAdd(p->z, p->z, p->z);
-	bigMultiply(p->y, p->y, p->y);
-	bigMultiply(t, p->y, p->x);
-	bigAdd(t, t, t);
-	bigAdd(t, t, t);
+	bigSquareModP(p->y, p->y);
+	bigMultiplyModP(t, p->y, p->x);
+	bigAddModPRelaxed(t, t, t);
+	bigAddModPRelaxed(t, t, t);
 	// t is now 4.0 * p->x * p->y ^ 2.
-	bigMultiply(p->x, p->x, p->x);
-	bigAssign(u, p->x);
-	bigAdd(u, u, u);
-	bigAdd(u, u, p->x);
+	bigSquareModP(p->x, p->x);
+	bigAddModPRelaxed(u, p->x, p->x);
+	bigAddModPRelaxed(u, u, p->x);
 	// u is now 3.0 * p->x ^ 2.
 	// For curves with a != 0, a * p->z ^ 4 needs to be added to u.
 	// But since a == 0 in secp256k1, we save 2 squarings and 1
 	// multiplication.
-	bigMultiply(p->x, u, u);
-	bigSubtract(p->x, p->x, t);
-	bigSubtract(p->x, p->x, t);
-	bigSubtract(t, t, p->x);
-	bigMultiply(t, t, u);
-	bigMultiply(p->y, p->y, p->y);
-	bigAdd(p->y, p->y, p->y);
-	bigAdd(p->y, p->y, p->y);
-	bigAdd(p->y, p->y, p->y);
-	bigSubtract(p->y, t, p->y);
+	bigSquareModP(p->x, u);
+	bigSubtractModPRelaxed(p->x, p->x, t);
+	bigSubtractModPRelaxed(p->x, p->x, t);
+	bigReduceModP(p->x, p->x);
+	bigSubtractModPRelaxed(t, t, p->x);
+	bigMultiplyModP(t, t, u);
+	bigSquareModP(p->y, p->y);
+	bigAddModPRelaxed(p->y, p->y, p->y);
+	bigAddModPRelaxed(p->y, p->y, p->y);
+	bigAddModPRelaxed(p->y, p->y, p->y);
+	bigSubtractModPRelaxed(p->y, t, p->y);
+	bigReduceModP(p->y, p->y);
 }
 
 /** Add (p1 = p1 + p2) the point p2 to the point p1, storing the result back
@@ -200,18 +308,24 @@ static NOINLINE void pointDouble(PointJacobian *p)
   * \param junk Pointer to a dummy variable which may receive dummy writes.
   * \param p2 The point (in affine coordinates) to add to p1.
   */
-static NOINLINE void pointAdd(PointJacobian *p1, PointJacobian *junk, PointAffine *p2)
+static NOINLINE HOT_FUNCTION void pointAdd(PointJacobian *p1, PointJacobian *junk, PointAffine *p2)
 {
-	uint8_t s[32];
-	uint8_t t[32];
-	uint8_t u[32];
-	uint8_t v[32];
+	ScratchMark mark;
+	uint8_t *s;
+	uint8_t *t;
+	uint8_t *u;
+	uint8_t *v;
 	uint8_t is_O;
 	uint8_t is_O2;
 	uint8_t cmp_xs;
 	uint8_t cmp_yt;
 	PointJacobian *lookup[2];
 
+	mark = scratchMark();
+	s = scratchAllocate(128);
+	t = &(s[32]);
+	u = &(s[64]);
+	v = &(s[96]);
 	lookup[0] = p1;
 	lookup[1] = junk;
 
@@ -232,44 +346,53 @@ static NOINLINE void pointAdd(PointJacobian *p1, PointJacobian *junk, PointAffin
 	p1 = lookup[is_O2];
 	lookup[0] = p1; // p1 might have changed
 
-	bigMultiply(s, p1->z, p1->z);
-	bigMultiply(t, s, p1->z);
-	bigMultiply(t, t, p2->y);
-	bigMultiply(s, s, p2->x);
+	bigSquareModP(s, p1->z);
+	bigMultiplyModP(t, s, p1->z);
+	bigMultiplyModP(t, t, p2->y);
+	bigMultiplyModP(s, s, p2->x);
 	// The following two lines do: "cmp_xs = bigCompare(p1->x, s) == BIGCMP_EQUAL ? 0 : 0xff;".
 	cmp_xs = (uint8_t)(bigCompare(p1->x, s) ^ BIGCMP_EQUAL);
 	cmp_xs = (uint8_t)(((uint16_t)(-(int)cmp_xs)) >> 8);
 	// The following two lines do: "cmp_yt = bigCompare(p1->y, t) == BIGCMP_EQUAL ? 0 : 0xff;".
 	cmp_yt = (uint8_t)(bigCompare(p1->y, t) ^ BIGCMP_EQUAL);
 	cmp_yt = (uint8_t)(((uint16_t)(-(int)cmp_yt)) >> 8);
-	// The following branch can never be taken when calling pointMultiply(),
-	// so its existence doesn't compromise timing regularity.
+	// The following branch can never be taken when calling pointMultiply()
+	// (unless ECDSA_USE_ENDOMORPHISM is defined), and is astronomically
+	// unlikely to be taken when calling pointMultiplyBase() or the
+	// endomorphism version of pointMultiply(), so its existence doesn't
+	// compromise timing regularity.
 	if ((cmp_xs | cmp_yt | is_O | is_O2) == 0)
 	{
 		// Points are actually the same; use point doubling.
 		pointDouble(p1);
+		scratchRelease(mark);
 		return;
 	}
 	// p2 == -p1 when p1->x == s and p1->y != t.
 	// If p1->is_point_at_infinity is set, then all subsequent operations in
 	// this function become dummy operations.
 	p1->is_point_at_infinity = (uint8_t)(p1->is_point_at_infinity | (~cmp_xs & cmp_yt & 1));
-	bigSubtract(s, s, p1->x);
+	// As in pointDouble(), intermediate values are only partially reduced,
+	// but the coordinates of p1 are fully reduced at the end.
+	bigSubtractModPRelaxed(s, s, p1->x);
 	// s now contains p2->x * p1->z ^ 2 - p1->x.
-	bigSubtract(t, t, p1->y);
+	bigSubtractModPRelaxed(t, t, p1->y);
 	// t now contains p2->y * p1->z ^ 3 - p1->y.
-	bigMultiply(p1->z, p1->z, s);
-	bigMultiply(v, s, s);
-	bigMultiply(u, v, p1->x);
-	bigMultiply(p1->x, t, t);
-	bigMultiply(s, s, v);
-	bigSubtract(p1->x, p1->x, s);
-	bigSubtract(p1->x, p1->x, u);
-	bigSubtract(p1->x, p1->x, u);
-	bigSubtract(u, u, p1->x);
-	bigMultiply(u, u, t);
-	bigMultiply(s, s, p1->y);
-	bigSubtract(p1->y, u, s);
+	bigMultiplyModP(p1->z, p1->z, s);
+	bigSquareModP(v, s);
+	bigMultiplyModP(u, v, p1->x);
+	bigSquareModP(p1->x, t);
+	bigMultiplyModP(s, s, v);
+	bigSubtractModPRelaxed(p1->x, p1->x, s);
+	bigSubtractModPRelaxed(p1->x, p1->x, u);
+	bigSubtractModPRelaxed(p1->x, p1->x, u);
+	bigReduceModP(p1->x, p1->x);
+	bigSubtractModPRelaxed(u, u, p1->x);
+	bigMultiplyModP(u, u, t);
+	bigMultiplyModP(s, s, p1->y);
+	bigSubtractModPRelaxed(p1->y, u, s);
+	bigReduceModP(p1->y, p1->y);
+	scratchRelease(mark);
 }
 
 /** Set field parameters to be those defined by the prime number p which
@@ -280,17 +403,397 @@ static void setFieldToP(void)
 }
 
 /** Set field parameters to be those defined by the prime number n which
-  * is used in secp256k1. */
+  * is used in secp256k1. This also sets the Montgomery parameters, so that
+  * multiplyModN() and the Montgomery functions in bignum256.c can be used. */
 void setFieldToN(void)
 {
 	bigSetField(secp256k1_n, secp256k1_complement_n, sizeof(secp256k1_complement_n));
+	bigSetMontgomery(secp256k1_n_r_squared, SECP256K1_N_PRIME);
+}
+
+/** Multiplies (r = (op1 x op2) modulo #secp256k1_n) two 32 byte
+  * multi-precision numbers. This gives the same result as bigMultiply(), but
+  * it uses Montgomery multiplication, so the cost of the reduction doesn't
+  * depend on how many passes the complement of n needs. op2 is converted
+  * into the Montgomery domain; multiplying that by op1 (which is not in the
+  * Montgomery domain) gives a result which is also not in the Montgomery
+  * domain.
+  * \param r The 32 byte result will be written into here.
+  * \param op1 The first 32 byte operand to multiply. This may alias r. This
+  *            doesn't need to be fully reduced.
+  * \param op2 The second 32 byte operand to multiply. This may alias r or
+  *            op1. This doesn't need to be fully reduced.
+  * \warning The field must have been set to n using setFieldToN().
+  */
+void multiplyModN(BigNum256 r, BigNum256 op1, BigNum256 op2)
+{
+	uint8_t temp[32];
+
+	bigToMontgomery(temp, op2);
+	bigMultiplyMontgomery(r, op1, temp);
+}
+
+/** Number of precomputed powers used by invertModN(). */
+#define INVERT_N_POWERS		9
+
+/** The tail of the addition chain which invertModN() uses to compute
+  * op1 ^ (n - 2), where n is #secp256k1_n. Each entry is one step: the
+  * accumulator is squared (first byte) times, then multiplied by the
+  * precomputed power with index (second byte). The precomputed powers
+  * are op1 raised to (in order of index): 1, 11b, 101b, 111b, 1001b, 1011b,
+  * 1101b, 111111b and 11111111b. This chain is the one used in libsecp256k1.
+  * It needs 253 squarings and 37 multiplications in total, compared to 256
+  * of each for the generic bigInvert(). */
+static const uint8_t invert_n_chain[24][2] PROGMEM = {
+{3, 2}, {4, 3}, {4, 2}, {5, 5}, {4, 5}, {4, 3}, {5, 3}, {6, 6},
+{4, 2}, {3, 3}, {5, 4}, {6, 2}, {10, 3}, {4, 3}, {9, 8}, {5, 4},
+{6, 5}, {4, 6}, {5, 1}, {6, 6}, {10, 6}, {4, 4}, {6, 0}, {8, 7}};
+
+/** Square a 32 byte multi-precision number in the Montgomery domain
+  * repeatedly (see bigSquareMontgomery()).
+  * \param r The 32 byte result will be written into here.
+  * \param op1 The 32 byte operand to square. This may alias r.
+  * \param count The number of times to square op1. This must be > 0.
+  */
+static void squareMontgomeryRepeatedly(BigNum256 r, BigNum256 op1, uint8_t count)
+{
+	uint8_t i;
+
+	bigSquareMontgomery(r, op1);
+	for (i = 1; i < count; i++)
+	{
+		bigSquareMontgomery(r, r);
+	}
 }
 
+/** Compute the modular inverse of a 32 byte multi-precision number modulo
+  * #secp256k1_n. This gives the same result as bigInvert(), but uses a fixed
+  * addition chain for n - 2 instead of going through the exponent one bit
+  * at a time, so it's almost twice as fast. The chain is evaluated in the
+  * Montgomery domain, so op1 is converted into it at the start and the
+  * result is converted out of it at the end. The sequence of operations
+  * doesn't depend on op1, so this is constant time.
+  * \param r The 32 byte result will be written into here.
+  * \param op1 The 32 byte operand to find the inverse of. This may alias r.
+  * \warning The field must have been set to n using setFieldToN().
+  */
+static NOINLINE void invertModN(BigNum256 r, BigNum256 op1)
+{
+	uint8_t powers[INVERT_N_POWERS][32];
+	uint8_t x14[32];
+	uint8_t temp[32];
+	uint8_t t[32];
+	uint8_t i;
+
+	// In the comments below, xk denotes op1 ^ (2 ^ k - 1) (i.e. op1 raised
+	// to a power which has k 1s in its binary representation).
+	// All the intermediate values are kept in the Montgomery domain.
+	bigToMontgomery(powers[0], op1);
+	bigSquareMontgomery(t, powers[0]);
+	// powers[i] = op1 ^ (2 x i + 1) for i = 1 to 6; those are the
+	// exponents 11b, 101b, 111b, 1001b, 1011b and 1101b.
+	for (i = 1; i < 7; i++)
+	{
+		bigMultiplyMontgomery(powers[i], powers[i - 1], t);
+	}
+	squareMontgomeryRepeatedly(t, powers[6], 2);
+	bigMultiplyMontgomery(powers[7], t, powers[5]); // 1101b x 4 + 1011b, i.e. x6
+	squareMontgomeryRepeatedly(t, powers[7], 2);
+	bigMultiplyMontgomery(powers[8], t, powers[1]); // x8
+	squareMontgomeryRepeatedly(t, powers[8], 6);
+	bigMultiplyMontgomery(x14, t, powers[7]);
+	squareMontgomeryRepeatedly(t, x14, 14);
+	bigMultiplyMontgomery(temp, t, x14); // temp = x28
+	squareMontgomeryRepeatedly(t, temp, 28);
+	bigMultiplyMontgomery(temp, t, temp); // temp = x56
+	squareMontgomeryRepeatedly(t, temp, 56);
+	bigMultiplyMontgomery(t, t, temp); // t = x112
+	squareMontgomeryRepeatedly(t, t, 14);
+	bigMultiplyMontgomery(t, t, x14); // t = x126
+	for (i = 0; i < (uint8_t)(sizeof(invert_n_chain) / sizeof(invert_n_chain[0])); i++)
+	{
+		squareMontgomeryRepeatedly(t, t, LOOKUP_BYTE(invert_n_chain[i][0]));
+		bigMultiplyMontgomery(t, t, powers[LOOKUP_BYTE(invert_n_chain[i][1])]);
+	}
+	bigFromMontgomery(r, t);
+}
+
+#if (ECDSA_WINDOW_BITS != 1) && (ECDSA_WINDOW_BITS != 2) && (ECDSA_WINDOW_BITS != 4)
+#error "ECDSA_WINDOW_BITS must be 1, 2 or 4."
+#endif
+
+/** Number of entries in the per-call table of multiples built by
+  * pointMultiply(). */
+#define WINDOW_ENTRIES		((1 << ECDSA_WINDOW_BITS) - 1)
+
+/** Get the z component of a point in Jacobian coordinates, substituting 1
+  * if the point is the point at infinity. This is done in constant time.
+  * \param out The z component (or 1) will be written here.
+  * \param in The point (in Jacobian coordinates) to get the z component of.
+  */
+static void selectZ(BigNum256 out, PointJacobian *in)
+{
+	uint8_t mask;
+	uint8_t i;
+
+	// The following line does: "mask = in->is_point_at_infinity ? 0xff : 0;".
+	mask = (uint8_t)(((uint16_t)(-(int)in->is_point_at_infinity)) >> 8);
+	for (i = 0; i < 32; i++)
+	{
+		out[i] = (uint8_t)(in->z[i] & ~mask);
+	}
+	out[0] = (uint8_t)(out[0] | (mask & 1));
+}
+
+/** Convert an array of points from Jacobian coordinates to affine
+  * coordinates. This gives the same results as calling jacobianToAffine()
+  * on each point, but it uses Montgomery's simultaneous inversion trick, so
+  * that only one inversion is needed for the whole array. Since inversion
+  * is much slower than multiplication, this is a lot faster than
+  * converting the points one at a time.
+  * \param out The destination array of count points (in affine
+  *            coordinates). This cannot alias in.
+  * \param in The source array of count points (in Jacobian coordinates).
+  *           The z components of points at infinity are treated as if
+  *           they were 1, so that a point at infinity (which may have a z
+  *           component of 0) doesn't spoil the conversion of the other
+  *           points.
+  * \param count The number of points to convert. This must be at least 1.
+  */
+static NOINLINE void batchJacobianToAffine(PointAffine *out, PointJacobian *in, uint8_t count)
+{
+	uint8_t inverse[32];
+	uint8_t z_inverse[32];
+	uint8_t temp[32];
+	uint8_t i;
+
+	// out[i].y is used as temporary storage for the z component of in[i]
+	// (or 1, if in[i] is the point at infinity) and out[i].x is used as
+	// temporary storage for the product of those values for in[0] to in[i]
+	// (inclusive).
+	for (i = 0; i < count; i++)
+	{
+		selectZ(out[i].y, &(in[i]));
+		if (i == 0)
+		{
+			bigAssign(out[0].x, out[0].y);
+		}
+		else
+		{
+			bigMultiplyModP(out[i].x, out[i - 1].x, out[i].y);
+		}
+	}
+	bigInvertModP(inverse, out[count - 1].x);
+	for (i = (uint8_t)(count - 1); i < count; i--)
+	{
+		// At this point, inverse = 1 / (product of z components of in[0] to
+		// in[i]).
+		if (i != 0)
+		{
+			bigMultiplyModP(z_inverse, inverse, out[i - 1].x);
+			bigMultiplyModP(inverse, inverse, out[i].y);
+		}
+		else
+		{
+			bigAssign(z_inverse, inverse);
+		}
+		// Now z_inverse = 1 / (z component of in[i]).
+		out[i].is_point_at_infinity = in[i].is_point_at_infinity;
+		bigSquareModP(temp, z_inverse);
+		bigMultiplyModP(out[i].x, in[i].x, temp);
+		bigMultiplyModP(temp, temp, z_inverse);
+		bigMultiplyModP(out[i].y, in[i].y, temp);
+	}
+}
+
+/** Look up an entry in a table of points in RAM, such as the table of
+  * multiples built by pointMultiply() or a #PointCombTable. To avoid leaking
+  * the index through memory access patterns, every entry of the table is
+  * read, and all but the desired one are masked out.
+  * \param out The point (in affine coordinates) will be written to here.
+  * \param table The table of points to look up.
+  * \param num_entries The number of points in table.
+  * \param digit The index of the point to look up. 0 corresponds to the point
+  *              at infinity, while 1 corresponds to the first entry in
+  *              table.
+  */
+static void lookupWindowEntry(PointAffine *out, const PointAffine *table, uint8_t num_entries, uint8_t digit)
+{
+	uint8_t entry;
+	uint8_t mask;
+	uint8_t i;
+
+	memset(out, 0, sizeof(PointAffine));
+	for (entry = 0; entry < num_entries; entry++)
+	{
+		// The following two lines do: "mask = (entry + 1 == digit) ? 0xff : 0;".
+		mask = (uint8_t)((entry + 1) ^ digit);
+		mask = (uint8_t)(((uint16_t)(mask - 1)) >> 8);
+		for (i = 0; i < 32; i++)
+		{
+			out->x[i] |= (uint8_t)(table[entry].x[i] & mask);
+			out->y[i] |= (uint8_t)(table[entry].y[i] & mask);
+		}
+		out->is_point_at_infinity |= (uint8_t)(table[entry].is_point_at_infinity & mask);
+	}
+	// The following line does: "if (digit == 0) out->is_point_at_infinity = 1;".
+	out->is_point_at_infinity |= (uint8_t)((((uint16_t)(digit - 1)) >> 8) & 1);
+}
+
+/** Build a table of the multiples 1 x p, 2 x p, ...,
+  * (2 ^ #ECDSA_WINDOW_BITS - 1) x p, for use by pointMultiply() and
+  * ecdsaVerify(). The multiples are calculated in Jacobian coordinates and
+  * then converted, all at once, to affine coordinates so that pointAdd() can
+  * use them. This is a separate function so that the Jacobian multiples
+  * don't stay on the stack during the main loop of its callers. The field
+  * must already be set to the one specified by #secp256k1_p.
+  * \param table The #WINDOW_ENTRIES multiples will be written here;
+  *              table[i] = (i + 1) x p.
+  * \param p The point (in affine coordinates) to build the table of.
+  */
+static NOINLINE void buildWindowTable(PointAffine *table, PointAffine *p)
+{
+#if ECDSA_WINDOW_BITS > 1
+	PointJacobian multiples[WINDOW_ENTRIES - 1];
+	PointJacobian junk;
+	uint8_t i;
+#endif // #if ECDSA_WINDOW_BITS > 1
+
+	memcpy(&(table[0]), p, sizeof(PointAffine));
+#if ECDSA_WINDOW_BITS > 1
+	memset(&junk, 0, sizeof(PointJacobian));
+	affineToJacobian(&(multiples[0]), p);
+	pointDouble(&(multiples[0]));
+	for (i = 1; i < (WINDOW_ENTRIES - 1); i++)
+	{
+		memcpy(&(multiples[i]), &(multiples[i - 1]), sizeof(PointJacobian));
+		pointAdd(&(multiples[i]), &junk, p);
+	}
+	batchJacobianToAffine(&(table[1]), multiples, WINDOW_ENTRIES - 1);
+#endif // #if ECDSA_WINDOW_BITS > 1
+}
+
+#ifdef ECDSA_USE_ENDOMORPHISM
+
+/** Compute round(product / 2 ^ 384), where product is a 64 byte
+  * multi-precision number. This is done in constant time.
+  * \param r The 32 byte result will be written into here.
+  * \param product The 64 byte number to divide.
+  */
+static void roundedHighPart(BigNum256 r, uint8_t *product)
+{
+	uint8_t round[32];
+
+	bigSetZero(r);
+	memcpy(r, &(product[48]), 16);
+	bigSetZero(round);
+	round[0] = (uint8_t)(product[47] >> 7);
+	bigAddVariableSizeNoModulo(r, r, round, 32);
+}
+
+/** Replace a scalar by its negation modulo #secp256k1_n if it is greater
+  * than n / 2. This is done in constant time.
+  * \param k The 32 byte scalar to (maybe) negate. The result will be
+  *          written back here.
+  * \return 0xff if k was negated, 0 if it wasn't.
+  */
+static uint8_t makeScalarSmall(BigNum256 k)
+{
+	uint8_t temp[32];
+	uint8_t mask;
+	uint8_t i;
+
+	bigShiftRightNoModulo(temp, (BigNum256)secp256k1_n);
+	// The following two lines do: "mask = (k > n / 2) ? 0xff : 0;".
+	mask = (uint8_t)(bigCompare(k, temp) ^ BIGCMP_GREATER);
+	mask = (uint8_t)(((uint16_t)(mask - 1)) >> 8);
+	bigSubtractNoModulo(temp, (BigNum256)secp256k1_n, k);
+	for (i = 0; i < 32; i++)
+	{
+		k[i] = (uint8_t)((temp[i] & mask) | (k[i] & ~mask));
+	}
+	return mask;
+}
+
+/** Split a scalar k into two half-size scalars k1 and k2 such that
+  * k = s1 x k1 + s2 x k2 x lambda (modulo #secp256k1_n), where lambda is
+  * #secp256k1_lambda and s1, s2 are +1 or -1. k1 and k2 are both < 2 ^ 128.
+  * This uses the method (and the precomputed lattice basis) described in
+  * section 3.5 of "Guide to Elliptic Curve Cryptography" by Hankerson,
+  * Menezes and Vanstone, with the rounding trick from libsecp256k1 so that
+  * no division is needed. Everything is done in constant time.
+  * \param k1 The first 32 byte half-size scalar will be written here. Only
+  *           the lower 16 bytes can be non-zero.
+  * \param k2 The second 32 byte half-size scalar will be written here. Only
+  *           the lower 16 bytes can be non-zero.
+  * \param negate_mask An array of 2 bytes. negate_mask[0] will be 0xff if s1
+  *                    is -1, 0 if s1 is +1. negate_mask[1] is the same, but
+  *                    for s2.
+  * \param k The 32 byte scalar to split. This doesn't need to be < n.
+  * \warning This changes the current prime finite field to n.
+  */
+static NOINLINE void splitScalar(BigNum256 k1, BigNum256 k2, uint8_t *negate_mask, BigNum256 k)
+{
+	uint8_t product[64];
+	uint8_t c1[32];
+	uint8_t c2[32];
+
+	setFieldToN();
+	// c1 = round(k x b2 / n) and c2 = round(k x -b1 / n).
+	bigMultiplyVariableSizeNoModulo(product, k, 32, (BigNum256)glv_g1, 32);
+	roundedHighPart(c1, product);
+	bigMultiplyVariableSizeNoModulo(product, k, 32, (BigNum256)glv_g2, 32);
+	roundedHighPart(c2, product);
+	// k2 = -(c1 x b1 + c2 x b2) and k1 = k - k2 x lambda.
+	multiplyModN(c1, c1, (BigNum256)glv_minus_b1);
+	multiplyModN(c2, c2, (BigNum256)glv_minus_b2);
+	bigAdd(k2, c1, c2);
+	multiplyModN(c1, k2, (BigNum256)secp256k1_lambda);
+	bigModulo(k1, k);
+	bigSubtract(k1, k1, c1);
+	negate_mask[0] = makeScalarSmall(k1);
+	negate_mask[1] = makeScalarSmall(k2);
+#ifdef TEST
+	assert(bigIsZeroVariableSize(&(k1[16]), 16));
+	assert(bigIsZeroVariableSize(&(k2[16]), 16));
+#endif // #ifdef TEST
+}
+
+/** Negate (y = -y) the y component of a point, but only if mask is 0xff.
+  * If mask is 0, the point is left alone. This is done in constant time.
+  * \param point The point (in affine coordinates) to (maybe) negate.
+  * \param mask 0xff to negate, 0 to do nothing.
+  */
+static void conditionalNegate(PointAffine *point, uint8_t mask)
+{
+	uint8_t negated[32];
+	uint8_t i;
+
+	bigSetZero(negated);
+	bigSubtract(negated, negated, point->y);
+	for (i = 0; i < 32; i++)
+	{
+		point->y[i] = (uint8_t)((negated[i] & mask) | (point->y[i] & ~mask));
+	}
+}
+
+#endif // #ifdef ECDSA_USE_ENDOMORPHISM
+
 /** Perform scalar multiplication (p = k x p) of the point p by the scalar k.
   * The result will be stored back into p. The multiplication is
-  * accomplished by repeated point doubling and adding of the
-  * original point. All multi-precision integer operations are done under
-  * the prime finite field specified by #secp256k1_p.
+  * accomplished by repeated point doubling and adding of multiples of the
+  * original point. The scalar is processed #ECDSA_WINDOW_BITS bits at a
+  * time (fixed window method), using a table of the multiples
+  * 1 x p, 2 x p, ..., (2 ^ #ECDSA_WINDOW_BITS - 1) x p which is built at
+  * the start of every call. All multi-precision integer operations are
+  * done under the prime finite field specified by #secp256k1_p.
+  *
+  * If ECDSA_USE_ENDOMORPHISM is defined, k is first split into two 128 bit
+  * scalars k1 and k2 (see splitScalar()), so that
+  * k x p = k1 x p + k2 x (lambda x p). Both products are computed at the
+  * same time, using the same table, since lambda x (x, y) is just
+  * (beta x x, y). That needs only 128 point doublings, instead of 256.
+  * The number of point additions stays the same.
   * \param p The point (in affine coordinates) to multiply.
   * \param k The 32 byte multi-precision scalar to multiply p by.
   */
@@ -298,21 +801,32 @@ void pointMultiply(PointAffine *p, BigNum256 k)
 {
 	PointJacobian accumulator;
 	PointJacobian junk;
-	PointAffine always_point_at_infinity; // for dummy operations
+	PointAffine table[WINDOW_ENTRIES];
+	PointAffine entry;
+#ifdef ECDSA_USE_ENDOMORPHISM
+	uint8_t k1[32];
+	uint8_t k2[32];
+	uint8_t negate_mask[2];
+	uint8_t other_byte;
+#endif // #ifdef ECDSA_USE_ENDOMORPHISM
 	uint8_t i;
 	uint8_t j;
+	uint8_t l;
 	uint8_t one_byte;
-	uint8_t one_bit;
-	PointAffine *lookup_affine[2];
+	uint8_t digit;
 
 	memset(&accumulator, 0, sizeof(PointJacobian));
 	memset(&junk, 0, sizeof(PointJacobian));
-	memset(&always_point_at_infinity, 0, sizeof(PointAffine));
+#ifdef ECDSA_USE_ENDOMORPHISM
+	splitScalar(k1, k2, negate_mask, k);
+#endif // #ifdef ECDSA_USE_ENDOMORPHISM
 	setFieldToP();
+	buildWindowTable(table, p);
 	// The Montgomery ladder method can't be used here because it requires
 	// point addition to be done in pure Jacobian coordinates. Point addition
 	// in pure Jacobian coordinates would make point multiplication about
-	// 26% slower. Instead, dummy operations are used to make point
+	// 26% slower. Instead, dummy operations (additions of the point at
+	// infinity when a window of k is zero) are used to make point
 	// multiplication a constant time operation. However, the use of dummy
 	// operations does make this code more susceptible to fault analysis -
 	// by introducing faults where dummy operations may occur, an attacker
@@ -320,20 +834,49 @@ void pointMultiply(PointAffine *p, BigNum256 k)
 	// So the use of this code is not appropriate in situations where fault
 	// analysis can occur.
 	accumulator.is_point_at_infinity = 1;
-	always_point_at_infinity.is_point_at_infinity = 1;
-	lookup_affine[1] = p;
-	lookup_affine[0] = &always_point_at_infinity;
+#ifdef ECDSA_USE_ENDOMORPHISM
+	for (i = 15; i < 16; i--)
+	{
+		one_byte = k1[i];
+		other_byte = k2[i];
+		for (j = 0; j < 8; j = (uint8_t)(j + ECDSA_WINDOW_BITS))
+		{
+			for (l = 0; l < ECDSA_WINDOW_BITS; l++)
+			{
+				pointDouble(&accumulator);
+			}
+			// Add s1 x digit x p.
+			digit = (uint8_t)(one_byte >> (8 - ECDSA_WINDOW_BITS));
+			lookupWindowEntry(&entry, table, WINDOW_ENTRIES, digit);
+			conditionalNegate(&entry, negate_mask[0]);
+			pointAdd(&accumulator, &junk, &entry);
+			one_byte = (uint8_t)(one_byte << ECDSA_WINDOW_BITS);
+			// Add s2 x digit x (lambda x p).
+			digit = (uint8_t)(other_byte >> (8 - ECDSA_WINDOW_BITS));
+			lookupWindowEntry(&entry, table, WINDOW_ENTRIES, digit);
+			bigMultiplyModP(entry.x, entry.x, (BigNum256)secp256k1_beta);
+			conditionalNegate(&entry, negate_mask[1]);
+			pointAdd(&accumulator, &junk, &entry);
+			other_byte = (uint8_t)(other_byte << ECDSA_WINDOW_BITS);
+		}
+	}
+#else
 	for (i = 31; i < 32; i--)
 	{
 		one_byte = k[i];
-		for (j = 0; j < 8; j++)
+		for (j = 0; j < 8; j = (uint8_t)(j + ECDSA_WINDOW_BITS))
 		{
-			pointDouble(&accumulator);
-			one_bit = (uint8_t)((one_byte & 0x80) >> 7);
-			pointAdd(&accumulator, &junk, lookup_affine[one_bit]);
-			one_byte = (uint8_t)(one_byte << 1);
+			for (l = 0; l < ECDSA_WINDOW_BITS; l++)
+			{
+				pointDouble(&accumulator);
+			}
+			digit = (uint8_t)(one_byte >> (8 - ECDSA_WINDOW_BITS));
+			lookupWindowEntry(&entry, table, WINDOW_ENTRIES, digit);
+			pointAdd(&accumulator, &junk, &entry);
+			one_byte = (uint8_t)(one_byte << ECDSA_WINDOW_BITS);
 		}
 	}
+#endif // #ifdef ECDSA_USE_ENDOMORPHISM
 	jacobianToAffine(p, &accumulator);
 }
 
@@ -342,20 +885,227 @@ void pointMultiply(PointAffine *p, BigNum256 k)
   */
 void setToG(PointAffine *p)
 {
+	p->is_point_at_infinity = 0;
+	LOOKUP_G(p->x, secp256k1_Gx);
+	LOOKUP_G(p->y, secp256k1_Gy);
+}
+
+/** Number of columns in the fixed-base comb used by pointMultiplyBase().
+  * This is also the number of point doublings and additions it does. */
+#define COMB_COLUMNS		(256 / ECDSA_COMB_TEETH)
+/** Number of entries in #secp256k1_comb_table. */
+#define COMB_ENTRIES		((1 << ECDSA_COMB_TEETH) - 1)
+
+/** Look up an entry in the fixed-base comb table #secp256k1_comb_table. To
+  * avoid leaking the index through memory access patterns, every entry of
+  * the table is read, and all but the desired one are masked out.
+  * \param out The point (in affine coordinates) will be written to here.
+  * \param digit The index of the point to look up. 0 corresponds to the point
+  *              at infinity, while 1 corresponds to the first entry in
+  *              #secp256k1_comb_table.
+  */
+static void lookupCombEntry(PointAffine *out, uint8_t digit)
+{
+	uint16_t entry;
+	uint8_t mask;
+	uint8_t i;
 	uint8_t buffer[32];
+
+	memset(out, 0, sizeof(PointAffine));
+	for (entry = 0; entry < COMB_ENTRIES; entry++)
+	{
+		// The following two lines do: "mask = (entry + 1 == digit) ? 0xff : 0;".
+		mask = (uint8_t)((entry + 1) ^ digit);
+		mask = (uint8_t)(((uint16_t)(mask - 1)) >> 8);
+		LOOKUP_BLOCK(buffer, &(secp256k1_comb_table[entry][0]), 32);
+		for (i = 0; i < 32; i++)
+		{
+			out->x[i] |= (uint8_t)(buffer[i] & mask);
+		}
+		LOOKUP_BLOCK(buffer, &(secp256k1_comb_table[entry][32]), 32);
+		for (i = 0; i < 32; i++)
+		{
+			out->y[i] |= (uint8_t)(buffer[i] & mask);
+		}
+	}
+	// The following line does: "out->is_point_at_infinity = (digit == 0) ? 1 : 0;".
+	out->is_point_at_infinity = (uint8_t)((((uint16_t)(digit - 1)) >> 8) & 1);
+}
+
+/** Perform scalar multiplication (p = k x b) of a fixed point b by the
+  * scalar k, leaving the result in Jacobian coordinates. This uses the
+  * fixed-base comb method with a precomputed table of multiples of b. The
+  * scalar is viewed as a matrix with #ECDSA_COMB_TEETH rows and
+  * #COMB_COLUMNS columns. Each column selects one entry from the table, so
+  * only #COMB_COLUMNS point doublings and additions are needed. The field
+  * must already be set to the one specified by #secp256k1_p.
+  * \param p The result (in Jacobian coordinates) will be written to here.
+  * \param table The comb table of b, as built by buildPointCombTable(). If
+  *              this is NULL, b is the base point G of secp256k1 and the
+  *              precomputed table #secp256k1_comb_table is used.
+  * \param k The 32 byte multi-precision scalar to multiply b by.
+  */
+static NOINLINE void pointMultiplyCombJacobian(PointJacobian *p, const PointCombTable *table, BigNum256 k)
+{
+	PointJacobian junk;
+	PointAffine entry;
+	uint16_t bit_index;
+	uint8_t column;
+	uint8_t tooth;
+	uint8_t digit;
+
+	memset(p, 0, sizeof(PointJacobian));
+	memset(&junk, 0, sizeof(PointJacobian));
+	// Like pointMultiply(), this uses dummy operations (a digit of 0 selects
+	// the point at infinity) to make point multiplication a constant time
+	// operation. See pointMultiply() for some caveats.
+	p->is_point_at_infinity = 1;
+	for (column = COMB_COLUMNS - 1; column < COMB_COLUMNS; column--)
+	{
+		pointDouble(p);
+		// Gather bit (tooth * COMB_COLUMNS + column) of k for every tooth.
+		digit = 0;
+		for (tooth = 0; tooth < ECDSA_COMB_TEETH; tooth++)
+		{
+			bit_index = (uint16_t)(tooth * COMB_COLUMNS + column);
+			digit = (uint8_t)(digit | (((k[bit_index >> 3] >> (bit_index & 7)) & 1) << tooth));
+		}
+		if (table == NULL)
+		{
+			lookupCombEntry(&entry, digit);
+		}
+		else
+		{
+			lookupWindowEntry(&entry, table->entry, COMB_ENTRIES, digit);
+		}
+		pointAdd(p, &junk, &entry);
+	}
+}
+
+/** Perform scalar multiplication (p = k x G) of the base point G of
+  * secp256k1 by the scalar k. This gives the same result as calling
+  * setToG() followed by pointMultiply(), but it is much faster, as it uses
+  * the fixed-base comb method (see pointMultiplyCombJacobian()). As with
+  * pointMultiply(), all multi-precision integer operations are done under
+  * the prime finite field specified by #secp256k1_p.
+  * \param p The result (in affine coordinates) will be written to here.
+  * \param k The 32 byte multi-precision scalar to multiply G by.
+  */
+void pointMultiplyBase(PointAffine *p, BigNum256 k)
+{
+	PointJacobian accumulator;
+
+	setFieldToP();
+	pointMultiplyCombJacobian(&accumulator, NULL, k);
+	jacobianToAffine(p, &accumulator);
+}
+
+/** Perform scalar multiplication (out[i] = k_i x G) of the base point G of
+  * secp256k1 by several scalars at once. This gives the same results as
+  * calling pointMultiplyBase() for each scalar, but the results are kept in
+  * Jacobian coordinates until they are all available, so that they can be
+  * converted to affine coordinates using only one inversion. This makes it
+  * faster to derive a range of public keys.
+  * \param out The results (in affine coordinates) will be written to here.
+  *            This must have space for count points.
+  * \param k The scalars, as count consecutive 32 byte multi-precision
+  *          numbers.
+  * \param count The number of scalars. This must be between 1 and
+  *              #ECDSA_MAX_BATCH (inclusive).
+  */
+void pointMultiplyBaseBatch(PointAffine *out, uint8_t *k, uint8_t count)
+{
+	PointJacobian results[ECDSA_MAX_BATCH];
 	uint8_t i;
 
-	p->is_point_at_infinity = 0;
-	for (i = 0; i < 32; i++)
+#ifdef TEST
+	assert((count >= 1) && (count <= ECDSA_MAX_BATCH));
+#endif // #ifdef TEST
+	setFieldToP();
+	for (i = 0; i < count; i++)
 	{
-		buffer[i] = LOOKUP_BYTE(secp256k1_Gx[i]);
+		pointMultiplyCombJacobian(&(results[i]), NULL, &(k[i * 32]));
 	}
-	bigAssign(p->x, (BigNum256)buffer);
-	for (i = 0; i < 32; i++)
+	batchJacobianToAffine(out, results, count);
+}
+
+/** Build a fixed-base comb table for a point, so that pointMultiplyComb()
+  * can multiply that point as quickly as pointMultiplyBase() multiplies G.
+  * Building the table costs about as much as one pointMultiply(), so this
+  * is only worthwhile if the same point will be multiplied several times.
+  * Entry d - 1 of the table is the sum of 2 ^ (t x #COMB_COLUMNS) x p over
+  * every bit t which is set in d; this is the same layout as
+  * #secp256k1_comb_table.
+  * \param table The table will be written here.
+  * \param p The point (in affine coordinates) to build the table of. This
+  *          must not be the point at infinity.
+  */
+void buildPointCombTable(PointCombTable *table, PointAffine *p)
+{
+	PointJacobian teeth[ECDSA_COMB_TEETH];
+	PointAffine teeth_affine[ECDSA_COMB_TEETH];
+	PointJacobian sums[ECDSA_MAX_BATCH];
+	PointJacobian junk;
+	uint16_t i;
+	uint16_t tooth_entry;
+	uint16_t first;
+	uint8_t tooth;
+	uint8_t count;
+
+	setFieldToP();
+	memset(&junk, 0, sizeof(PointJacobian));
+	// The single-tooth entries (entry 2 ^ t - 1 is 2 ^ (t x COMB_COLUMNS) x p)
+	// come from repeated doubling.
+	affineToJacobian(&(teeth[0]), p);
+	for (tooth = 1; tooth < ECDSA_COMB_TEETH; tooth++)
+	{
+		memcpy(&(teeth[tooth]), &(teeth[tooth - 1]), sizeof(PointJacobian));
+		for (i = 0; i < COMB_COLUMNS; i++)
+		{
+			pointDouble(&(teeth[tooth]));
+		}
+	}
+	batchJacobianToAffine(teeth_affine, teeth, ECDSA_COMB_TEETH);
+	for (tooth = 0; tooth < ECDSA_COMB_TEETH; tooth++)
 	{
-		buffer[i] = LOOKUP_BYTE(secp256k1_Gy[i]);
+		memcpy(&(table->entry[(1 << tooth) - 1]), &(teeth_affine[tooth]), sizeof(PointAffine));
 	}
-	bigAssign(p->y, (BigNum256)buffer);
+	// Every other entry is an entry with fewer teeth plus the entry for its
+	// highest tooth. Those are converted to affine coordinates up to
+	// #ECDSA_MAX_BATCH at a time, to bound the stack space used.
+	for (tooth = 1; tooth < ECDSA_COMB_TEETH; tooth++)
+	{
+		tooth_entry = (uint16_t)((1 << tooth) - 1);
+		for (first = 1; first < (1 << tooth); first = (uint16_t)(first + count))
+		{
+			count = (uint8_t)MIN(ECDSA_MAX_BATCH, (1 << tooth) - first);
+			for (i = 0; i < count; i++)
+			{
+				affineToJacobian(&(sums[i]), &(table->entry[first + i - 1]));
+				pointAdd(&(sums[i]), &junk, &(table->entry[tooth_entry]));
+			}
+			batchJacobianToAffine(&(table->entry[tooth_entry + first]), sums, count);
+		}
+	}
+}
+
+/** Perform scalar multiplication (p = k x b) of a point b by the scalar k,
+  * using a comb table of b which was built by buildPointCombTable(). This
+  * gives the same result as pointMultiply(), but it only needs
+  * #COMB_COLUMNS point doublings and additions, like pointMultiplyBase().
+  * As with pointMultiply(), all multi-precision integer operations are done
+  * under the prime finite field specified by #secp256k1_p.
+  * \param p The result (in affine coordinates) will be written to here.
+  * \param table The comb table of b.
+  * \param k The 32 byte multi-precision scalar to multiply b by.
+  */
+void pointMultiplyComb(PointAffine *p, const PointCombTable *table, BigNum256 k)
+{
+	PointJacobian accumulator;
+
+	setFieldToP();
+	pointMultiplyCombJacobian(&accumulator, table, k);
+	jacobianToAffine(p, &accumulator);
 }
 
 /** Create a deterministic ECDSA signature of a given message (digest) and
@@ -377,24 +1127,31 @@ void setToG(PointAffine *p)
 void ecdsaSign(BigNum256 r, BigNum256 s, const BigNum256 hash, const BigNum256 private_key)
 {
 	PointAffine big_r;
-	uint8_t k[32];
-	uint8_t seed_material[32 + SHA256_HASH_LENGTH];
-	HMACDRBGState state;
+	ScratchMark mark;
+	uint8_t *k;
+	uint8_t *seed_material;
+	HMACDRBGState *state;
+
+	performanceBurstBegin();
+	// k, the seed material and the DRBG state are all secret, so they're
+	// allocated from the scratch arena, which is cleared on release.
+	mark = scratchMark();
+	k = scratchAllocate(32);
+	seed_material = scratchAllocate(32 + SHA256_HASH_LENGTH);
+	state = scratchAllocate(sizeof(HMACDRBGState));
 
 	// From RFC 6979, section 3.3a:
 	// seed_material = int2octets(private_key) || bits2octets(hash)
 	// int2octets and bits2octets both interpret the number as big-endian.
 	// However, both the private_key and hash parameters are BigNum256, which
 	// is little-endian.
-	bigAssign(seed_material, private_key);
-	swapEndian256(seed_material); // little-endian -> big-endian
-	bigAssign(&(seed_material[32]), hash);
-	swapEndian256(&(seed_material[32])); // little-endian -> big-endian
-	drbgInstantiate(&state, seed_material, sizeof(seed_material));
+	bigStoreBigEndian(seed_material, private_key);
+	bigStoreBigEndian(&(seed_material[32]), hash);
+	drbgInstantiate(state, seed_material, 32 + SHA256_HASH_LENGTH);
 
 	while (true)
 	{
-		drbgGenerate(k, &state, 32, NULL, 0);
+		drbgGenerate(k, state, 32, NULL, 0);
 		// From RFC 6979, section 3.3b, the output of the DRBG is run through
 		// the bits2int function, which interprets the output as a big-endian
 		// integer. However, functions in bignum256.c expect a little-endian
@@ -414,8 +1171,7 @@ void ecdsaSign(BigNum256 r, BigNum256 s, const BigNum256 hash, const BigNum256 p
 		}
 
 		// Compute ephemeral elliptic curve key pair (k, big_r).
-		setToG(&big_r);
-		pointMultiply(&big_r, k);
+		pointMultiplyBase(&big_r, k);
 		// big_r now contains k * G.
 		setFieldToN();
 		bigModulo(r, big_r.x);
@@ -424,11 +1180,11 @@ void ecdsaSign(BigNum256 r, BigNum256 s, const BigNum256 hash, const BigNum256 p
 		{
 			continue;
 		}
-		bigMultiply(s, r, private_key);
+		multiplyModN(s, r, private_key);
 		bigModulo(big_r.y, hash); // use big_r.y as temporary
 		bigAdd(s, s, big_r.y);
-		bigInvert(big_r.y, k);
-		bigMultiply(s, s, big_r.y);
+		invertModN(big_r.y, k);
+		multiplyModN(s, s, big_r.y);
 		// s now contains (hash + (r * private_key)) / k (mod n).
 		if (bigIsZero(s))
 		{
@@ -444,6 +1200,116 @@ void ecdsaSign(BigNum256 r, BigNum256 s, const BigNum256 hash, const BigNum256 p
 		}
 		break;
 	}
+	scratchRelease(mark);
+	performanceBurstEnd();
+}
+
+/** Verify an ECDSA signature of a given message (digest) against a public
+  * key.
+  * This is an implementation of the algorithm described in section 4.1.4
+  * ("Verifying Operation") of the SEC 1 document referenced in ecdsaSign().
+  * The point u1 x G + u2 x public_key is computed using Shamir's trick:
+  * both products share a single chain of 256 point doublings, with the
+  * multiples of each point added in from a table (see buildWindowTable()).
+  * This costs 256 doublings and 2 x 256 / #ECDSA_WINDOW_BITS additions,
+  * which is much cheaper than doing two separate point multiplications.
+  *
+  * The intended use is to check a freshly generated signature before it is
+  * released, since a fault injected during signing (see the caveats in
+  * pointMultiply()) would most likely produce an invalid signature. Like
+  * pointMultiply(), this uses dummy operations to run in (mostly) constant
+  * time.
+  * \param r The "r" component of the signature, as a 32 byte
+  *          multi-precision number.
+  * \param s The "s" component of the signature, as a 32 byte
+  *          multi-precision number.
+  * \param hash The message digest of the message which was signed,
+  *             represented as a 32 byte multi-precision number.
+  * \param public_key The public key (in affine coordinates) to verify the
+  *                   signature against. This must be a point on the curve;
+  *                   this function doesn't check that.
+  * \return false if the signature is valid, true if it is not.
+  */
+bool ecdsaVerify(const BigNum256 r, const BigNum256 s, const BigNum256 hash, PointAffine *public_key)
+{
+	PointJacobian accumulator;
+	PointJacobian junk;
+	PointAffine table_g[WINDOW_ENTRIES];
+	PointAffine table_q[WINDOW_ENTRIES];
+	PointAffine entry;
+	uint8_t u1[32];
+	uint8_t u2[32];
+	uint8_t i;
+	uint8_t j;
+	uint8_t l;
+	uint8_t u1_byte;
+	uint8_t u2_byte;
+	uint8_t digit;
+
+	// r and s must both be in [1, n - 1].
+	if (bigIsZero(r) || bigIsZero(s))
+	{
+		return true;
+	}
+	if ((bigCompare(r, (BigNum256)secp256k1_n) != BIGCMP_LESS)
+		|| (bigCompare(s, (BigNum256)secp256k1_n) != BIGCMP_LESS))
+	{
+		return true;
+	}
+	if (public_key->is_point_at_infinity)
+	{
+		return true;
+	}
+
+	setFieldToN();
+	invertModN(u2, s);
+	bigModulo(u1, hash);
+	multiplyModN(u1, u1, u2);
+	multiplyModN(u2, r, u2);
+	// u1 now contains hash / s (mod n) and u2 contains r / s (mod n).
+
+	setFieldToP();
+	setToG(&entry);
+	buildWindowTable(table_g, &entry);
+	buildWindowTable(table_q, public_key);
+	memset(&accumulator, 0, sizeof(PointJacobian));
+	memset(&junk, 0, sizeof(PointJacobian));
+	accumulator.is_point_at_infinity = 1;
+	for (i = 31; i < 32; i--)
+	{
+		u1_byte = u1[i];
+		u2_byte = u2[i];
+		for (j = 0; j < 8; j = (uint8_t)(j + ECDSA_WINDOW_BITS))
+		{
+			for (l = 0; l < ECDSA_WINDOW_BITS; l++)
+			{
+				pointDouble(&accumulator);
+			}
+			digit = (uint8_t)(u1_byte >> (8 - ECDSA_WINDOW_BITS));
+			lookupWindowEntry(&entry, table_g, WINDOW_ENTRIES, digit);
+			pointAdd(&accumulator, &junk, &entry);
+			u1_byte = (uint8_t)(u1_byte << ECDSA_WINDOW_BITS);
+			digit = (uint8_t)(u2_byte >> (8 - ECDSA_WINDOW_BITS));
+			lookupWindowEntry(&entry, table_q, WINDOW_ENTRIES, digit);
+			pointAdd(&accumulator, &junk, &entry);
+			u2_byte = (uint8_t)(u2_byte << ECDSA_WINDOW_BITS);
+		}
+	}
+	jacobianToAffine(&entry, &accumulator);
+
+	// The signature is valid if and only if the x component of
+	// u1 x G + u2 x public_key is r (mod n).
+	if (entry.is_point_at_infinity)
+	{
+		return true;
+	}
+	setFieldToN();
+	bigModulo(entry.x, entry.x);
+	if (bigCompare(entry.x, r) != BIGCMP_EQUAL)
+	{
+		return true;
+	}
+	return false;
 }
 
 /** Serialise an elliptic curve point in a manner which is Bitcoin-compatible.
@@ -468,10 +1334,7 @@ void ecdsaSign(BigNum256 r, BigNum256 s, const BigNum256 hash, const BigNum256 p
   */
 uint8_t ecdsaSerialise(uint8_t *out, const PointAffine *point, const bool do_compress)
 {
-	PointAffine temp;
-
-	memcpy(&temp, point, sizeof(temp)); // need temp for endian reversing
-	if (temp.is_point_at_infinity)
+	if (point->is_point_at_infinity)
 	{
 		// Special case for point at infinity.
 		out[0] = 0x00;
@@ -481,16 +1344,14 @@ uint8_t ecdsaSerialise(uint8_t *out, const PointAffine *point, const bool do_com
 	{
 		// Uncompressed point.
 		out[0] = 0x04;
-		swapEndian256(temp.x);
-		swapEndian256(temp.y);
-		memcpy(&(out[1]), temp.x, 32);
-		memcpy(&(out[33]), temp.y, 32);
+		bigStoreBigEndian(&(out[1]), (BigNum256)point->x);
+		bigStoreBigEndian(&(out[33]), (BigNum256)point->y);
 		return 65;
 	}
 	else
 	{
 		// Compressed point.
-		if ((temp.y[0] & 1) != 0)
+		if ((point->y[0] & 1) != 0)
 		{
 			out[0] = 0x03; // is odd
 		}
@@ -498,28 +1359,130 @@ uint8_t ecdsaSerialise(uint8_t *out, const PointAffine *point, const bool do_com
 		{
 			out[0] = 0x02; // is not odd
 		}
-		swapEndian256(temp.x);
-		memcpy(&(out[1]), temp.x, 32);
+		bigStoreBigEndian(&(out[1]), (BigNum256)point->x);
 		return 33;
 	}
 }
 
-#ifdef TEST_ECDSA
 
-/** The curve parameter b of secp256k1. The other parameter, a, is zero. */
-static const uint8_t secp256k1_b[32] = {
-0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+/** Compute (r = x ^ 3 + b modulo #secp256k1_p) the right hand side of the
+  * secp256k1 curve equation y ^ 2 = x ^ 3 + b.
+  * \param r The 32 byte result will be written into here.
+  * \param x The 32 byte x component. This must be < #secp256k1_p.
+  * \warning This changes the current prime finite field to p.
+  */
+static void curveRightHandSide(BigNum256 r, BigNum256 x)
+{
+	setFieldToP();
+	bigSquareModP(r, x);
+	bigMultiplyModP(r, r, x);
+	bigAdd(r, r, (BigNum256)secp256k1_b);
+}
 
-/** This is #secp256k1_p plus 1, then divided by 4. It is a constant used for
-  * decompressing elliptic curve points. */
-static const uint8_t secp256k1_p_plus1over4[32] = {
-0x0c, 0xff, 0xff, 0xbf, 0xff, 0xff, 0xff, 0xff,
-0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
-0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
-0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x3f};
+/** Decompress an elliptic curve point - that is, given only the x value of
+  * a point, this will calculate the y value. This means that only the x value
+  * needs to be stored, which decreases memory use at the expense of time.
+  * The square root is computed using bigSqrtModP(), so this takes about the
+  * same time as one inversion modulo p.
+  * \param point The point to decompress. Only the x field needs to be filled
+  *              in - the y field will be ignored and overwritten.
+  * \param is_odd For any x value, there are two valid y values - one odd and
+  *               one even. This parameter instructs the function to pick
+  *               one of them. Use 0 to pick the even one, 1 to pick the odd
+  *               one.
+  * \return false on success, true if point could not be decompressed.
+  * \warning This changes the current prime finite field to p.
+  */
+bool ecdsaPointDecompress(PointAffine *point, uint8_t is_odd)
+{
+	uint8_t temp[32];
+	uint8_t sqrt_y_squared[32];
+	uint8_t x_cubed_plus_b[32];
+	uint8_t is_sqrt_y_squared_odd;
+	uint8_t supposed_to_be_odd;
+	BigNum256 lookup[2];
+
+	if (bigCompare(point->x, (BigNum256)secp256k1_p) != BIGCMP_LESS)
+	{
+		return true; // x is not a field element
+	}
+	point->is_point_at_infinity = 0;
+	curveRightHandSide(x_cubed_plus_b, point->x); // x_cubed_plus_b = x^3 + b = y^2
+	// Since y^2 = x^3 + b in secp256k1, y = sqrt(x^3 + b). Because
+	// p = 3 (mod 4), the square root is (x^3 + b) ^ ((p + 1) / 4). For more
+	// information see:
+	// http://point-at-infinity.org/ecc/Algorithm_of_Shanks_&_Tonelli.html
+	bigSqrtModP(sqrt_y_squared, x_cubed_plus_b);
+	// sqrt(y^2) has two solutions ("positive" and "negative"). One of the
+	// solutions is odd and the other even. The is_odd parameter controls
+	// which one is picked.
+	bigSubtractNoModulo(temp, (BigNum256)secp256k1_p, sqrt_y_squared); // temp = -sqrt_y_squared
+	is_sqrt_y_squared_odd = (uint8_t)(sqrt_y_squared[0] & 1);
+	supposed_to_be_odd = (uint8_t)(is_odd & 1);
+	lookup[0] = sqrt_y_squared; // sqrt_y_squared has correct least significant bit
+	lookup[1] = temp; // sqrt_y_squared has incorrect least significant bit; use -sqrt_y_squared
+	memcpy(point->y, lookup[is_sqrt_y_squared_odd ^ supposed_to_be_odd], sizeof(point->y));
+
+	// Check that y^2 does actually equal x^3 + b (i.e. the point is on the
+	// curve). This fails if x^3 + b is not a quadratic residue.
+	bigSquareModP(temp, point->y);
+	if (bigCompare(temp, x_cubed_plus_b) == BIGCMP_EQUAL)
+	{
+		return false; // success
+	}
+	else
+	{
+		return true; // could not decompress (resulting point is not on curve)
+	}
+}
+
+/** Parse a public key which was serialised as described in section 2.3.3
+  * ("Elliptic-Curve-Point-to-Octet-String Conversion") of the SEC 1
+  * document referenced in ecdsaSerialise(). This is the inverse of
+  * ecdsaSerialise(). Both compressed (33 byte) and uncompressed (65 byte)
+  * public keys are accepted; compressed public keys are decompressed using
+  * ecdsaPointDecompress(). The point at infinity is not accepted, since it
+  * is never a valid public key.
+  * \param out The parsed public key (in affine coordinates) will be written
+  *            here.
+  * \param in The serialised public key.
+  * \param length The length, in number of bytes, of in.
+  * \return false on success, true if in is not a valid serialised public key
+  *         (eg. it has the wrong length or prefix, or isn't on the curve).
+  * \warning This changes the current prime finite field to p.
+  */
+bool ecdsaParsePublicKey(PointAffine *out, const uint8_t *in, uint8_t length)
+{
+	uint8_t y_squared[32];
+	uint8_t x_cubed_plus_b[32];
+
+	if ((length == 33) && ((in[0] == 0x02) || (in[0] == 0x03)))
+	{
+		bigLoadBigEndian(out->x, &(in[1]));
+		return ecdsaPointDecompress(out, (uint8_t)(in[0] & 1));
+	}
+	else if ((length == 65) && (in[0] == 0x04))
+	{
+		bigLoadBigEndian(out->x, &(in[1]));
+		bigLoadBigEndian(out->y, &(in[33]));
+		out->is_point_at_infinity = 0;
+		if ((bigCompare(out->x, (BigNum256)secp256k1_p) != BIGCMP_LESS)
+			|| (bigCompare(out->y, (BigNum256)secp256k1_p) != BIGCMP_LESS))
+		{
+			return true; // x or y is not a field element
+		}
+		curveRightHandSide(x_cubed_plus_b, out->x);
+		bigSquareModP(y_squared, out->y);
+		if (bigCompare(y_squared, x_cubed_plus_b) != BIGCMP_EQUAL)
+		{
+			return true; // not on curve
+		}
+		return false; // success
+	}
+	return true; // unrecognised length or prefix
+}
+
+#ifdef TEST_ECDSA
 
 /** Test vector generated using https://brainwallet.github.io/, which is a
   * convenient way to generate serialised public keys. */
@@ -830,8 +1793,8 @@ static void checkPointIsOnCurve(PointAffine *p)
 		reportSuccess();
 		return;
 	}
-	bigMultiply(y_squared, p->y, p->y);
-	bigMultiply(x_cubed, p->x, p->x);
+	bigSquare(y_squared, p->y);
+	bigSquare(x_cubed, p->x);
 	bigMultiply(x_cubed, x_cubed, p->x);
 	bigAdd(x_cubed, x_cubed, (BigNum256)secp256k1_b);
 	if (bigCompare(y_squared, x_cubed) != BIGCMP_EQUAL)
@@ -851,77 +1814,6 @@ static void checkPointIsOnCurve(PointAffine *p)
 	}
 }
 
-/** Decompress an elliptic curve point - that is, given only the x value of
-  * a point, this will calculate the y value. This means that only the x value
-  * needs to be stored, which decreases memory use at the expense of time.
-  * \param point The point to decompress. Only the x field needs to be filled
-  *              in - the y field will be ignored and overwritten.
-  * \param is_odd For any x value, there are two valid y values - one odd and
-  *               one even. This parameter instructs the function to pick
-  *               one of them. Use 0 to pick the even one, 1 to pick the odd
-  *               one.
-  * \return false on success, true if point could not be decompressed.
-  */
-static bool ecdsaPointDecompress(PointAffine *point, uint8_t is_odd)
-{
-	uint8_t temp[32];
-	uint8_t sqrt_y_squared[32];
-	uint8_t x_cubed_plus_b[32];
-	uint8_t is_sqrt_y_squared_odd;
-	uint8_t supposed_to_be_odd;
-	BigNum256 lookup[2];
-	unsigned int i;
-	unsigned int byte_num;
-	unsigned int bit_num;
-
-	setFieldToP();
-	bigMultiply(x_cubed_plus_b, point->x, point->x);
-	bigMultiply(x_cubed_plus_b, x_cubed_plus_b, point->x);
-	bigAdd(x_cubed_plus_b, x_cubed_plus_b, (BigNum256)secp256k1_b); // x_cubed_plus_b = x^3 + b = y^2
-	// Since y^2 = x^3 + b in secp256k1, y = sqrt(x^3 + b). The square
-	// root can be performed using the Tonelli-Shanks algorithm. Here, a special
-	// case is used, which only works for p = 3 (mod 4) - this is satisfied for
-	// the secp256k1 curve. For more information see:
-	// http://point-at-infinity.org/ecc/Algorithm_of_Shanks_&_Tonelli.html
-	// Exponentiation is done by a standard binary square-and-multiply
-	// algorithm.
-	bigSetZero(sqrt_y_squared);
-	sqrt_y_squared[0] = 1;
-	for (i = 255; i < 256; i--)
-	{
-		bigMultiply(sqrt_y_squared, sqrt_y_squared, sqrt_y_squared);
-		byte_num = i >> 3;
-		bit_num = i & 7;
-		// Yes, this is a data-dependent branch, but it is based on
-		// secp256k1_p_plus1over4, which is a (public) constant.
-		if (((secp256k1_p_plus1over4[byte_num] >> bit_num) & 1) != 0)
-		{
-			bigMultiply(sqrt_y_squared, sqrt_y_squared, x_cubed_plus_b);
-		}
-	}
-	// sqrt(y^2) has two solutions ("positive" and "negative"). One of the
-	// solutions is odd and the other even. The is_odd parameter controls
-	// which one is picked.
-	bigSubtractNoModulo(temp, (BigNum256)secp256k1_p, sqrt_y_squared); // temp = -sqrt_y_squared
-	is_sqrt_y_squared_odd = (uint8_t)(sqrt_y_squared[0] & 1);
-	supposed_to_be_odd = (uint8_t)(is_odd & 1);
-	lookup[0] = sqrt_y_squared; // sqrt_y_squared has correct least significant bit
-	lookup[1] = temp; // sqrt_y_squared has incorrect least significant bit; use -sqrt_y_squared
-	memcpy(point->y, lookup[is_sqrt_y_squared_odd ^ supposed_to_be_odd], sizeof(point->y));
-
-	// Check that y^2 does actually equal x^3 + b (i.e. the point is on the
-	// curve).
-	bigMultiply(temp, point->y, point->y);
-	if (bigCompare(temp, x_cubed_plus_b) == BIGCMP_EQUAL)
-	{
-		return false; // success
-	}
-	else
-	{
-		return true; // could not decompress (resulting point is not on curve)
-	}
-}
-
 /** Read hex string containing a little-endian 256 bit integer from a file.
   * \param r Where the number will be stored into after it is read. This must
   *          be a byte array with space for 32 bytes.
@@ -965,7 +1857,7 @@ static int crappyVerifySignature(BigNum256 r, BigNum256 s, BigNum256 hash, BigNu
 
 	setFieldToN();
 	bigModulo(temp1, hash);
-	bigInvert(temp2, s);
+	invertModN(temp2, s);
 	bigMultiply(k1, temp2, temp1);
 	bigMultiply(k2, temp2, r);
 	setFieldToP();
@@ -998,6 +1890,10 @@ int main(void)
 	PointJacobian p2;
 	PointJacobian junk;
 	PointAffine compare;
+	PointAffine batch[ECDSA_MAX_BATCH];
+	uint8_t batch_k[ECDSA_MAX_BATCH * 32];
+	PointCombTable comb_table;
+	PointAffine comb_base;
 	uint8_t temp[32];
 	uint8_t r[32];
 	uint8_t s[32];
@@ -1011,6 +1907,7 @@ int main(void)
 	uint8_t serialised_sentinel[10]; // used to detect writes beyond serialised[ECDSA_MAX_SERIALISE_SIZE]
 	uint8_t serialised_size;
 	uint8_t is_odd;
+	uint8_t count;
 	int fail_count;
 	int i;
 	unsigned int j;
@@ -1019,6 +1916,131 @@ int main(void)
 
 	initTests(__FILE__);
 
+	// Check that invertModN() gives the same results as bigInvert().
+	setFieldToN();
+	for (i = 0; i < 200; i++)
+	{
+		for (j = 0; j < 32; j++)
+		{
+			temp[j] = (uint8_t)((unsigned int)i * 37 + j * ((unsigned int)i + 11));
+		}
+		if (i == 0)
+		{
+			// Edge case: n - 1.
+			bigAssign(temp, (BigNum256)secp256k1_n);
+			temp[0]--;
+		}
+		bigModulo(temp, temp);
+		bigInvert(r, temp);
+		invertModN(s, temp);
+		invertModN(temp, temp);
+		if ((bigCompare(r, s) != BIGCMP_EQUAL) || (bigCompare(r, temp) != BIGCMP_EQUAL))
+		{
+			printf("invertModN() doesn't match bigInvert() for i = %d\n", i);
+			reportFailure();
+		}
+		else
+		{
+			reportSuccess();
+		}
+	}
+
+	// Check that multiplyModN() gives the same results as bigMultiply().
+	// multiplyModN() should also accept operands which aren't fully reduced.
+	setFieldToN();
+	for (i = 0; i < 200; i++)
+	{
+		for (j = 0; j < 32; j++)
+		{
+			r[j] = (uint8_t)((unsigned int)i * 53 + j * ((unsigned int)i + 3));
+			s[j] = (uint8_t)((unsigned int)i * 29 + j * ((unsigned int)i + 7));
+		}
+		if (i == 0)
+		{
+			// Edge case: (n - 1) x (n - 1).
+			bigAssign(r, (BigNum256)secp256k1_n);
+			r[0]--;
+			bigAssign(s, r);
+		}
+		else if (i == 1)
+		{
+			// Edge case: (2 ^ 256 - 1) x (2 ^ 256 - 1).
+			memset(r, 0xff, sizeof(r));
+			memset(s, 0xff, sizeof(s));
+		}
+		bigModulo(r_again, r);
+		bigModulo(s_again, s);
+		bigMultiply(temp, r_again, s_again);
+		multiplyModN(r_again, r, s);
+		multiplyModN(s, r, s);
+		if ((bigCompare(r_again, temp) != BIGCMP_EQUAL) || (bigCompare(s, temp) != BIGCMP_EQUAL))
+		{
+			printf("multiplyModN() doesn't match bigMultiply() for i = %d\n", i);
+			reportFailure();
+		}
+		else
+		{
+			reportSuccess();
+		}
+	}
+
+#ifdef ECDSA_USE_ENDOMORPHISM
+	// Check that splitScalar() produces half-size scalars which recombine
+	// to give the original scalar.
+	for (i = 0; i < 200; i++)
+	{
+		for (j = 0; j < 32; j++)
+		{
+			temp[j] = (uint8_t)((unsigned int)i * 53 + j * ((unsigned int)i + 7));
+		}
+		if (i == 0)
+		{
+			bigAssign(temp, (BigNum256)secp256k1_n);
+			temp[0]--;
+		}
+		else if (i == 1)
+		{
+			bigSetZero(temp);
+		}
+		else if (i == 2)
+		{
+			memset(temp, 0xff, 32);
+		}
+		splitScalar(r, s, serialised, temp);
+		fail_count = 0;
+		if (!bigIsZeroVariableSize(&(r[16]), 16) || !bigIsZeroVariableSize(&(s[16]), 16))
+		{
+			fail_count++;
+		}
+		// Compute r_again = s1 x k1 + s2 x k2 x lambda.
+		bigSetZero(r_again);
+		if (serialised[0])
+		{
+			bigSubtract(r, r_again, r);
+		}
+		if (serialised[1])
+		{
+			bigSubtract(s, r_again, s);
+		}
+		bigMultiply(s, s, (BigNum256)secp256k1_lambda);
+		bigAdd(r_again, r, s);
+		bigModulo(temp, temp);
+		if (bigCompare(r_again, temp) != BIGCMP_EQUAL)
+		{
+			fail_count++;
+		}
+		if (fail_count != 0)
+		{
+			printf("splitScalar() failed for i = %d\n", i);
+			reportFailure();
+		}
+		else
+		{
+			reportSuccess();
+		}
+	}
+#endif // #ifdef ECDSA_USE_ENDOMORPHISM
+
 	setFieldToP();
 
 	// Check that G is on the curve.
@@ -1144,6 +2166,20 @@ int main(void)
 		reportSuccess();
 	}
 
+	// Test that pointMultiply of O gives O.
+	p.is_point_at_infinity = 1;
+	fillWithRandom(temp, sizeof(temp));
+	pointMultiply(&p, temp);
+	if (!p.is_point_at_infinity)
+	{
+		printf("pointMultiply of O doesn't give O\n");
+		reportFailure();
+	}
+	else
+	{
+		reportSuccess();
+	}
+
 	// Test that pointMultiply by 1 gives P back.
 	setToG(&p);
 	bigSetZero(temp);
@@ -1250,6 +2286,154 @@ int main(void)
 		reportSuccess();
 	}
 
+	// Test that pointMultiplyBase() by 0 and by n gives O.
+	bigSetZero(temp);
+	pointMultiplyBase(&p, temp);
+	if (!p.is_point_at_infinity)
+	{
+		printf("pointMultiplyBase not starting at O\n");
+		reportFailure();
+	}
+	else
+	{
+		reportSuccess();
+	}
+	pointMultiplyBase(&p, (BigNum256)secp256k1_n);
+	if (!p.is_point_at_infinity)
+	{
+		printf("pointMultiplyBase n * G != O\n");
+		reportFailure();
+	}
+	else
+	{
+		reportSuccess();
+	}
+
+	// Test that pointMultiplyBase() gives the same results as setToG()
+	// followed by pointMultiply(). The first COMB_ENTRIES scalars each select
+	// one entry of secp256k1_comb_table (in the lowest column), so this also
+	// checks the contents of the table.
+	for (i = 0; i < COMB_ENTRIES + 100; i++)
+	{
+		bigSetZero(temp);
+		if (i < COMB_ENTRIES)
+		{
+			for (j = 0; j < ECDSA_COMB_TEETH; j++)
+			{
+				if ((((unsigned int)i + 1) & (1U << j)) != 0)
+				{
+					temp[(j * COMB_COLUMNS) >> 3] |= (uint8_t)(1 << ((j * COMB_COLUMNS) & 7));
+				}
+			}
+		}
+		else
+		{
+			fillWithRandom(temp, sizeof(temp));
+		}
+		setToG(&compare);
+		pointMultiply(&compare, temp);
+		pointMultiplyBase(&p, temp);
+		if ((p.is_point_at_infinity != compare.is_point_at_infinity)
+			|| (bigCompare(p.x, compare.x) != BIGCMP_EQUAL)
+			|| (bigCompare(p.y, compare.y) != BIGCMP_EQUAL))
+		{
+			printf("pointMultiplyBase() doesn't match pointMultiply() for scalar %d\n", i);
+			reportFailure();
+		}
+		else
+		{
+			reportSuccess();
+		}
+	}
+
+	// Test that pointMultiplyBaseBatch() gives the same results as
+	// pointMultiplyBase(), for every batch size. Some batches include a
+	// scalar of 0, to check that a point at infinity in the batch doesn't
+	// affect the other points.
+	for (i = 0; i < 4 * ECDSA_MAX_BATCH; i++)
+	{
+		count = (uint8_t)((i % ECDSA_MAX_BATCH) + 1);
+		fillWithRandom(batch_k, sizeof(batch_k));
+		if (i >= 2 * ECDSA_MAX_BATCH)
+		{
+			memset(&(batch_k[(i % count) * 32]), 0, 32);
+		}
+		pointMultiplyBaseBatch(batch, batch_k, count);
+		for (j = 0; j < count; j++)
+		{
+			pointMultiplyBase(&compare, &(batch_k[j * 32]));
+			if ((batch[j].is_point_at_infinity != compare.is_point_at_infinity)
+				|| (!compare.is_point_at_infinity && (bigCompare(batch[j].x, compare.x) != BIGCMP_EQUAL))
+				|| (!compare.is_point_at_infinity && (bigCompare(batch[j].y, compare.y) != BIGCMP_EQUAL)))
+			{
+				printf("pointMultiplyBaseBatch() doesn't match pointMultiplyBase(), batch %d, entry %u\n", i, j);
+				reportFailure();
+			}
+			else
+			{
+				reportSuccess();
+			}
+		}
+	}
+
+	// Test that pointMultiplyComb() gives the same results as
+	// pointMultiply(), for a table built from a random point. As above, the
+	// first COMB_ENTRIES scalars each select one entry of the table.
+	fillWithRandom(temp, sizeof(temp));
+	pointMultiplyBase(&comb_base, temp);
+	buildPointCombTable(&comb_table, &comb_base);
+	for (i = 0; i < COMB_ENTRIES + 100; i++)
+	{
+		bigSetZero(temp);
+		if (i < COMB_ENTRIES)
+		{
+			for (j = 0; j < ECDSA_COMB_TEETH; j++)
+			{
+				if ((((unsigned int)i + 1) & (1U << j)) != 0)
+				{
+					temp[(j * COMB_COLUMNS) >> 3] |= (uint8_t)(1 << ((j * COMB_COLUMNS) & 7));
+				}
+			}
+		}
+		else
+		{
+			fillWithRandom(temp, sizeof(temp));
+		}
+		memcpy(&compare, &comb_base, sizeof(PointAffine));
+		pointMultiply(&compare, temp);
+		pointMultiplyComb(&p, &comb_table, temp);
+		if ((p.is_point_at_infinity != compare.is_point_at_infinity)
+			|| (bigCompare(p.x, compare.x) != BIGCMP_EQUAL)
+			|| (bigCompare(p.y, compare.y) != BIGCMP_EQUAL))
+		{
+			printf("pointMultiplyComb() doesn't match pointMultiply() for scalar %d\n", i);
+			reportFailure();
+		}
+		else
+		{
+			reportSuccess();
+		}
+	}
+
+	// A comb table built from G should be the same as secp256k1_comb_table.
+	setToG(&comb_base);
+	buildPointCombTable(&comb_table, &comb_base);
+	for (i = 0; i < COMB_ENTRIES; i++)
+	{
+		lookupCombEntry(&compare, (uint8_t)(i + 1));
+		if ((bigCompare(comb_table.entry[i].x, compare.x) != BIGCMP_EQUAL)
+			|| (bigCompare(comb_table.entry[i].y, compare.y) != BIGCMP_EQUAL)
+			|| comb_table.entry[i].is_point_at_infinity)
+		{
+			printf("buildPointCombTable() of G doesn't match secp256k1_comb_table at entry %d\n", i);
+			reportFailure();
+		}
+		else
+		{
+			reportSuccess();
+		}
+	}
+
 	// Test that ecdsaPointDecompress() doesn't always succeed.
 	fail_count = 0;
 	for (i = 0; i < 100; i++)
@@ -1273,6 +2457,65 @@ int main(void)
 		reportSuccess();
 	}
 
+	// Test that ecdsaParsePublicKey() is the inverse of ecdsaSerialise(), for
+	// both compressed and uncompressed public keys.
+	for (i = 1; i < 100; i++)
+	{
+		bigSetZero(temp);
+		temp[0] = (uint8_t)(i * 7);
+		temp[31] = (uint8_t)i;
+		pointMultiplyBase(&p, temp);
+		for (is_odd = 0; is_odd < 2; is_odd++)
+		{
+			serialised_size = ecdsaSerialise(serialised, &p, is_odd != 0);
+			memset(&compare, 42, sizeof(compare));
+			if (ecdsaParsePublicKey(&compare, serialised, serialised_size))
+			{
+				printf("ecdsaParsePublicKey() failed to parse public key %d\n", i);
+				reportFailure();
+			}
+			else if (memcmp(&compare, &p, sizeof(compare)) != 0)
+			{
+				printf("Parsed public key %d does not match original\n", i);
+				reportFailure();
+			}
+			else
+			{
+				reportSuccess();
+			}
+		}
+	}
+
+	// ecdsaParsePublicKey() should reject anything which isn't a valid
+	// serialised public key.
+	fail_count = 0;
+	serialised_size = ecdsaSerialise(serialised, &p, true);
+	fail_count += ecdsaParsePublicKey(&compare, serialised, 32) ? 0 : 1;
+	fail_count += ecdsaParsePublicKey(&compare, serialised, 65) ? 0 : 1;
+	serialised[0] = 0x04;
+	fail_count += ecdsaParsePublicKey(&compare, serialised, 33) ? 0 : 1;
+	serialised[0] = 0x00;
+	fail_count += ecdsaParsePublicKey(&compare, serialised, 1) ? 0 : 1;
+	memset(&(serialised[1]), 0xff, 32); // x >= p
+	serialised[0] = 0x02;
+	fail_count += ecdsaParsePublicKey(&compare, serialised, 33) ? 0 : 1;
+	serialised_size = ecdsaSerialise(serialised, &p, false);
+	fail_count += ecdsaParsePublicKey(&compare, serialised, 33) ? 0 : 1;
+	serialised[0] = 0x06;
+	fail_count += ecdsaParsePublicKey(&compare, serialised, 65) ? 0 : 1;
+	serialised[0] = 0x04;
+	serialised[64] ^= 1; // no longer on curve
+	fail_count += ecdsaParsePublicKey(&compare, serialised, 65) ? 0 : 1;
+	if (fail_count != 0)
+	{
+		printf("ecdsaParsePublicKey() accepted an invalid public key\n");
+		reportFailure();
+	}
+	else
+	{
+		reportSuccess();
+	}
+
 	// Test against some point multiplication test vectors.
 	// It's hard to find such test vectors for secp256k1. But they can be
 	// generated using OpenSSL. Using the command:
@@ -1310,6 +2553,7 @@ int main(void)
 		skipWhiteSpace(f);
 		bigFRead(compare.y, f);
 		skipWhiteSpace(f);
+		compare.is_point_at_infinity = 0;
 		setToG(&p);
 		pointMultiply(&p, temp);
 		checkPointIsOnCurve(&p);
@@ -1392,9 +2636,76 @@ int main(void)
 		{
 			reportSuccess();
 		}
+
+		// ecdsaVerify() should accept the signature, and also the other
+		// (non-canonical) signature with -s instead of s.
+		compare.is_point_at_infinity = 0;
+		bigAssign(compare.x, public_key_x);
+		bigAssign(compare.y, public_key_y);
+		bigSubtractNoModulo(s_again, (BigNum256)secp256k1_n, s);
+		if (ecdsaVerify(r, s, hash, &compare) || ecdsaVerify(r, s_again, hash, &compare))
+		{
+			printf("ecdsaVerify() rejected valid signature %d\n", i);
+			reportFailure();
+		}
+		else
+		{
+			reportSuccess();
+		}
+		// It should reject the signature if anything is changed.
+		if (i < 30)
+		{
+			fail_count = 0;
+			hash[i] ^= 0x10;
+			fail_count += ecdsaVerify(r, s, hash, &compare) ? 0 : 1;
+			hash[i] ^= 0x10;
+			bigAssign(r_again, r);
+			r_again[0] ^= 1;
+			fail_count += ecdsaVerify(r_again, s, hash, &compare) ? 0 : 1;
+			bigAssign(s_again, s);
+			s_again[31 - i] ^= 0x40;
+			fail_count += ecdsaVerify(r, s_again, hash, &compare) ? 0 : 1;
+			setToG(&compare);
+			fail_count += ecdsaVerify(r, s, hash, &compare) ? 0 : 1;
+			if (fail_count != 0)
+			{
+				printf("ecdsaVerify() accepted invalid signature %d\n", i);
+				reportFailure();
+			}
+			else
+			{
+				reportSuccess();
+			}
+		}
 	}
 	fclose(f);
 
+	// ecdsaVerify() should reject r or s outside [1, n - 1] and the point at
+	// infinity as a public key, without doing any point arithmetic.
+	setToG(&compare);
+	bigSetZero(temp);
+	temp[0] = 1;
+	fail_count = 0;
+	bigSetZero(r_again);
+	fail_count += ecdsaVerify(r_again, temp, temp, &compare) ? 0 : 1;
+	fail_count += ecdsaVerify(temp, r_again, temp, &compare) ? 0 : 1;
+	bigAssign(r_again, (BigNum256)secp256k1_n);
+	fail_count += ecdsaVerify(r_again, temp, temp, &compare) ? 0 : 1;
+	fail_count += ecdsaVerify(temp, r_again, temp, &compare) ? 0 : 1;
+	memset(r_again, 0xff, sizeof(r_again));
+	fail_count += ecdsaVerify(temp, r_again, temp, &compare) ? 0 : 1;
+	compare.is_point_at_infinity = 1;
+	fail_count += ecdsaVerify(temp, temp, temp, &compare) ? 0 : 1;
+	if (fail_count != 0)
+	{
+		printf("ecdsaVerify() doesn't range check its inputs properly\n");
+		reportFailure();
+	}
+	else
+	{
+		reportSuccess();
+	}
+
 	// Test serialisation/decompression against vectors in pointMultiply test
 	// (the ones generated by OpenSSL).
 	srand(42);
@@ -1633,3 +2944,85 @@ int main(void)
 
 #endif // #ifdef TEST_ECDSA
 
+#ifdef BENCH_ECDSA
+
+/** Private key/scalar for the benchmarks. */
+static uint8_t bench_scalar[32];
+/** Message hash to sign/verify. */
+static uint8_t bench_hash[32];
+/** Public key corresponding to #bench_scalar. */
+static PointAffine bench_public_key;
+/** Signature (r) of #bench_hash. */
+static uint8_t bench_r[32];
+/** Signature (s) of #bench_hash. */
+static uint8_t bench_s[32];
+
+/** Multiply G by a scalar using the generic point multiplication. */
+static void benchPointMultiply(void)
+{
+	PointAffine p;
+
+	setToG(&p);
+	pointMultiply(&p, bench_scalar);
+}
+
+/** Multiply G by a scalar using the precomputed table. */
+static void benchPointMultiplyBase(void)
+{
+	PointAffine p;
+
+	pointMultiplyBase(&p, bench_scalar);
+}
+
+/** Comb table of #bench_public_key, for benchPointMultiplyComb(). */
+static PointCombTable bench_comb_table;
+
+/** Multiply a public key by a scalar using a comb table which was built
+  * beforehand. */
+static void benchPointMultiplyComb(void)
+{
+	PointAffine p;
+
+	pointMultiplyComb(&p, &bench_comb_table, bench_scalar);
+}
+
+/** Build a comb table for a public key. */
+static void benchBuildPointCombTable(void)
+{
+	buildPointCombTable(&bench_comb_table, &bench_public_key);
+}
+
+/** Sign a hash. */
+static void benchEcdsaSign(void)
+{
+	uint8_t r[32];
+	uint8_t s[32];
+
+	ecdsaSign(r, s, bench_hash, bench_scalar);
+}
+
+/** Verify a signature. */
+static void benchEcdsaVerify(void)
+{
+	ecdsaVerify(bench_r, bench_s, bench_hash, &bench_public_key);
+}
+
+int main(void)
+{
+	initBenchmarks(__FILE__);
+	fillWithRandom(bench_scalar, sizeof(bench_scalar));
+	fillWithRandom(bench_hash, sizeof(bench_hash));
+	bench_scalar[31] &= 0x7f; // make sure it's less than n
+	pointMultiplyBase(&bench_public_key, bench_scalar);
+	ecdsaSign(bench_r, bench_s, bench_hash, bench_scalar);
+	runHostBenchmark("point_multiply", &benchPointMultiply, 0);
+	runHostBenchmark("point_multiply_base", &benchPointMultiplyBase, 0);
+	buildPointCombTable(&bench_comb_table, &bench_public_key);
+	runHostBenchmark("point_multiply_comb", &benchPointMultiplyComb, 0);
+	runHostBenchmark("build_point_comb_table", &benchBuildPointCombTable, 0);
+	runHostBenchmark("ecdsa_sign", &benchEcdsaSign, 0);
+	runHostBenchmark("ecdsa_verify", &benchEcdsaVerify, 0);
+	exit(0);
+}
+
+#endif // #ifdef BENCH_ECDSA
@@ -16,6 +16,44 @@
   * written by ecdsaSerialise(). */
 #define ECDSA_MAX_SERIALISE_SIZE	65
 
+#ifndef ECDSA_COMB_TEETH
+/** Number of teeth in the fixed-base comb used by pointMultiplyBase(). This
+  * must be 2, 4 or 8. More teeth means fewer point operations, at the cost
+  * of a larger lookup table (which is stored in program memory):
+  * - 2 teeth: 128 doublings and 128 additions, 192 byte table.
+  * - 4 teeth: 64 doublings and 64 additions, 960 byte table.
+  * - 8 teeth: 32 doublings and 32 additions, 16320 byte table.
+  *
+  * Every addition does a constant time scan of the whole table, so the
+  * savings from using 8 teeth are reduced on slow platforms. This can be
+  * overridden by defining ECDSA_COMB_TEETH in the platform's build
+  * settings. */
+#define ECDSA_COMB_TEETH			4
+#endif // #ifndef ECDSA_COMB_TEETH
+
+#ifndef ECDSA_WINDOW_BITS
+/** Number of scalar bits processed at a time by pointMultiply(). This must
+  * be 1, 2 or 4. pointMultiply() always does 256 point doublings, but it
+  * only does 256 / ECDSA_WINDOW_BITS point additions. The cost is a table
+  * of 2 ^ ECDSA_WINDOW_BITS - 1 points, which is built on the stack at the
+  * start of every call:
+  * - 1 bit: 256 additions, and the table is just the point itself.
+  * - 2 bits: 128 additions, about 400 bytes of extra stack space.
+  * - 4 bits: 64 additions, about 2300 bytes of extra stack space.
+  *
+  * This can be overridden by defining ECDSA_WINDOW_BITS in the platform's
+  * build settings. */
+#define ECDSA_WINDOW_BITS			4
+#endif // #ifndef ECDSA_WINDOW_BITS
+
+#ifndef ECDSA_MAX_BATCH
+/** Maximum number of scalars that pointMultiplyBaseBatch() can handle in
+  * one call. Each one costs about 100 bytes of stack space. This can be
+  * overridden by defining ECDSA_MAX_BATCH in the platform's build
+  * settings. */
+#define ECDSA_MAX_BATCH				8
+#endif // #ifndef ECDSA_MAX_BATCH
+
 /** A point on the elliptic curve, in affine coordinates. Affine
   * coordinates are the (x, y) that satisfy the elliptic curve
   * equation y ^ 2 = x ^ 3 + a * x + b.
@@ -32,12 +70,31 @@ typedef struct PointAffineStruct
 	uint8_t is_point_at_infinity;
 } PointAffine;
 
+/** A fixed-base comb table for an arbitrary point, as built by
+  * buildPointCombTable(). It lets pointMultiplyComb() multiply that point
+  * as quickly as pointMultiplyBase() multiplies G, at the cost of
+  * 2 ^ #ECDSA_COMB_TEETH - 1 points of RAM (about 1 kilobyte with 4 teeth).
+  */
+typedef struct PointCombTableStruct
+{
+	/** The multiples of the point; see buildPointCombTable(). */
+	PointAffine entry[(1 << ECDSA_COMB_TEETH) - 1];
+} PointCombTable;
+
 extern const uint8_t secp256k1_n[];
 
 extern void setFieldToN(void);
+extern void multiplyModN(BigNum256 r, BigNum256 op1, BigNum256 op2);
 extern void setToG(PointAffine *p);
 extern void pointMultiply(PointAffine *p, BigNum256 k);
+extern void pointMultiplyBase(PointAffine *p, BigNum256 k);
+extern void pointMultiplyBaseBatch(PointAffine *out, uint8_t *k, uint8_t count);
+extern void buildPointCombTable(PointCombTable *table, PointAffine *p);
+extern void pointMultiplyComb(PointAffine *p, const PointCombTable *table, BigNum256 k);
 extern void ecdsaSign(BigNum256 r, BigNum256 s, const BigNum256 hash, const BigNum256 privatekey);
+extern bool ecdsaVerify(const BigNum256 r, const BigNum256 s, const BigNum256 hash, PointAffine *public_key);
 extern uint8_t ecdsaSerialise(uint8_t *out, const PointAffine *point, const bool do_compress);
+extern bool ecdsaPointDecompress(PointAffine *point, uint8_t is_odd);
+extern bool ecdsaParsePublicKey(PointAffine *out, const uint8_t *in, uint8_t length);
 
 #endif // #ifndef ECDSA_H_INCLUDED
@@ -0,0 +1,1406 @@
+/** \file ecdsa_comb_table.h
+  *
+  * \brief Contains the fixed-base comb lookup table used by
+  *        pointMultiplyBase().
+  *
+  * The table consists of multiples of the secp256k1 base point G. Its size
+  * is selected at compile time by #ECDSA_COMB_TEETH; see ecdsa.h for the
+  * trade-offs. The tables were generated using gen_comb; the format of each
+  * entry is described in gen_comb.c.
+  *
+  * This file should only be included by ecdsa.c.
+  *
+  * This file is licensed as described by the file LICENCE.
+  */
+
+#ifndef ECDSA_COMB_TABLE_H_INCLUDED
+#define ECDSA_COMB_TABLE_H_INCLUDED
+
+#include "common.h"
+#include "ecdsa.h"
+
+#if ECDSA_COMB_TEETH == 2
+// Table generated using gen_comb.
+// Teeth: 2.
+static const uint8_t secp256k1_comb_table[3][64] PROGMEM = {
+{
+0x98, 0x17, 0xf8, 0x16, 0x5b, 0x81, 0xf2, 0x59, 0xd9, 0x28, 0xce, 0x2d, 0xdb, 0xfc, 0x9b, 0x02,
+0x07, 0x0b, 0x87, 0xce, 0x95, 0x62, 0xa0, 0x55, 0xac, 0xbb, 0xdc, 0xf9, 0x7e, 0x66, 0xbe, 0x79,
+0xb8, 0xd4, 0x10, 0xfb, 0x8f, 0xd0, 0x47, 0x9c, 0x19, 0x54, 0x85, 0xa6, 0x48, 0xb4, 0x17, 0xfd,
+0xa8, 0x08, 0x11, 0x0e, 0xfc, 0xfb, 0xa4, 0x5d, 0x65, 0xc4, 0xa3, 0x26, 0x77, 0xda, 0x3a, 0x48},
+{
+0xda, 0xc0, 0xc4, 0x9e, 0x4c, 0x44, 0x7b, 0x1b, 0x35, 0xa3, 0x3e, 0x72, 0x78, 0x56, 0x8c, 0xe8,
+0x2e, 0x16, 0x1f, 0x98, 0xad, 0xc1, 0x39, 0x92, 0x33, 0x5f, 0x3b, 0xf6, 0xd2, 0xb9, 0x68, 0x8f,
+0x82, 0xff, 0x1f, 0x50, 0x79, 0xbf, 0x3c, 0xf2, 0xfd, 0x0b, 0x51, 0x95, 0xfe, 0x2c, 0xea, 0xbb,
+0x5d, 0x21, 0xbe, 0xb6, 0xc2, 0x90, 0x1d, 0xde, 0x86, 0x39, 0x06, 0xba, 0x2d, 0x9f, 0x2a, 0x66},
+{
+0x09, 0xbf, 0x4c, 0x11, 0x85, 0xe8, 0xc5, 0x63, 0x3e, 0x7e, 0xe7, 0x7b, 0x93, 0xce, 0x27, 0x2f,
+0x33, 0x3e, 0x4a, 0xf5, 0x2d, 0xd1, 0xa6, 0xda, 0x2c, 0x87, 0xff, 0x3e, 0x51, 0x0e, 0x30, 0x8b,
+0x39, 0x0a, 0xb1, 0xb3, 0x28, 0xff, 0xc6, 0x26, 0x69, 0x71, 0xaf, 0x9a, 0xaa, 0xa7, 0xf6, 0x08,
+0xea, 0x38, 0x82, 0x6b, 0x46, 0x0d, 0x6f, 0x44, 0xcc, 0xc0, 0x43, 0x7f, 0x67, 0x30, 0xec, 0x1c}
+};
+#elif ECDSA_COMB_TEETH == 4
+// Table generated using gen_comb.
+// Teeth: 4.
+static const uint8_t secp256k1_comb_table[15][64] PROGMEM = {
+{
+0x98, 0x17, 0xf8, 0x16, 0x5b, 0x81, 0xf2, 0x59, 0xd9, 0x28, 0xce, 0x2d, 0xdb, 0xfc, 0x9b, 0x02,
+0x07, 0x0b, 0x87, 0xce, 0x95, 0x62, 0xa0, 0x55, 0xac, 0xbb, 0xdc, 0xf9, 0x7e, 0x66, 0xbe, 0x79,
+0xb8, 0xd4, 0x10, 0xfb, 0x8f, 0xd0, 0x47, 0x9c, 0x19, 0x54, 0x85, 0xa6, 0x48, 0xb4, 0x17, 0xfd,
+0xa8, 0x08, 0x11, 0x0e, 0xfc, 0xfb, 0xa4, 0x5d, 0x65, 0xc4, 0xa3, 0x26, 0x77, 0xda, 0x3a, 0x48},
+{
+0xbd, 0xe6, 0xd0, 0x42, 0xe7, 0xe0, 0xb7, 0x13, 0x53, 0x5e, 0x0f, 0xdb, 0x63, 0xd1, 0x74, 0xf7,
+0xcb, 0x6e, 0x4d, 0x10, 0x7c, 0x14, 0xa2, 0x82, 0x25, 0x4e, 0x3c, 0x24, 0x01, 0xd4, 0x22, 0x33,
+0xa0, 0xb2, 0x28, 0x6c, 0xe9, 0xa2, 0xf3, 0x24, 0xf6, 0x3a, 0x87, 0xa2, 0x3e, 0xf6, 0x05, 0x28,
+0xb7, 0xf9, 0xda, 0x4d, 0xbc, 0x19, 0xb0, 0xbf, 0xf5, 0x4e, 0x66, 0xe9, 0x97, 0x07, 0xe7, 0x56},
+{
+0x2a, 0x12, 0x9d, 0x82, 0x27, 0x11, 0xa8, 0xdc, 0x49, 0x95, 0xe9, 0x67, 0x14, 0xf3, 0x17, 0x8f,
+0x73, 0x9e, 0x8a, 0x6a, 0x85, 0x90, 0x88, 0x9b, 0x9d, 0xd9, 0x6d, 0x84, 0xd9, 0xdf, 0x3f, 0x58,
+0xc4, 0xea, 0xc4, 0x63, 0x9e, 0x71, 0xc7, 0xf3, 0x7a, 0xb3, 0x34, 0xb7, 0xa3, 0x85, 0x46, 0xb4,
+0xa6, 0x47, 0x2a, 0x57, 0xd6, 0xd2, 0x92, 0x9f, 0x81, 0x7d, 0xf5, 0x2f, 0x2f, 0x23, 0xc6, 0xab},
+{
+0xda, 0xc0, 0xc4, 0x9e, 0x4c, 0x44, 0x7b, 0x1b, 0x35, 0xa3, 0x3e, 0x72, 0x78, 0x56, 0x8c, 0xe8,
+0x2e, 0x16, 0x1f, 0x98, 0xad, 0xc1, 0x39, 0x92, 0x33, 0x5f, 0x3b, 0xf6, 0xd2, 0xb9, 0x68, 0x8f,
+0x82, 0xff, 0x1f, 0x50, 0x79, 0xbf, 0x3c, 0xf2, 0xfd, 0x0b, 0x51, 0x95, 0xfe, 0x2c, 0xea, 0xbb,
+0x5d, 0x21, 0xbe, 0xb6, 0xc2, 0x90, 0x1d, 0xde, 0x86, 0x39, 0x06, 0xba, 0x2d, 0x9f, 0x2a, 0x66},
+{
+0x09, 0xbf, 0x4c, 0x11, 0x85, 0xe8, 0xc5, 0x63, 0x3e, 0x7e, 0xe7, 0x7b, 0x93, 0xce, 0x27, 0x2f,
+0x33, 0x3e, 0x4a, 0xf5, 0x2d, 0xd1, 0xa6, 0xda, 0x2c, 0x87, 0xff, 0x3e, 0x51, 0x0e, 0x30, 0x8b,
+0x39, 0x0a, 0xb1, 0xb3, 0x28, 0xff, 0xc6, 0x26, 0x69, 0x71, 0xaf, 0x9a, 0xaa, 0xa7, 0xf6, 0x08,
+0xea, 0x38, 0x82, 0x6b, 0x46, 0x0d, 0x6f, 0x44, 0xcc, 0xc0, 0x43, 0x7f, 0x67, 0x30, 0xec, 0x1c},
+{
+0x70, 0x90, 0x5e, 0x07, 0x6a, 0xce, 0x16, 0xba, 0x37, 0xfe, 0x5c, 0x9b, 0x3d, 0x89, 0x26, 0xbc,
+0x74, 0x07, 0x51, 0x9c, 0xfe, 0xad, 0xdd, 0xe1, 0xf4, 0xe2, 0x3a, 0xfe, 0x88, 0x2d, 0x92, 0x90,
+0x4a, 0x82, 0x08, 0x5c, 0xcc, 0x43, 0x39, 0x65, 0xbc, 0xf4, 0xe8, 0xfc, 0x75, 0x44, 0xd7, 0x06,
+0x5d, 0x61, 0x3c, 0x53, 0xa7, 0x1f, 0x10, 0x8d, 0xa9, 0x08, 0x21, 0x74, 0xf6, 0x03, 0x19, 0x7b},
+{
+0x6c, 0xc9, 0xbd, 0x6e, 0x5c, 0xa4, 0xcf, 0x1b, 0xba, 0x84, 0x75, 0x1c, 0x04, 0xbc, 0x00, 0xe4,
+0x1f, 0x53, 0xcf, 0x74, 0x0e, 0xe2, 0x95, 0x63, 0x30, 0x1b, 0x13, 0xc5, 0xb1, 0x0b, 0xdd, 0x1e,
+0x9e, 0xcf, 0x58, 0xe3, 0x1b, 0x16, 0x17, 0xa1, 0x1c, 0xd1, 0x24, 0x27, 0xf0, 0xd6, 0x90, 0xe4,
+0xc9, 0xd8, 0x6d, 0xee, 0xf6, 0x62, 0x50, 0xf7, 0xe4, 0x73, 0xa3, 0xfb, 0x2b, 0x3b, 0xe0, 0x31},
+{
+0xb3, 0xe2, 0x20, 0x21, 0xfa, 0x58, 0x3b, 0x7f, 0xaa, 0xf9, 0x47, 0x7f, 0xce, 0xfd, 0x58, 0x7a,
+0x21, 0xe5, 0xe6, 0x4c, 0xe3, 0x4a, 0xbe, 0xe7, 0xba, 0xbd, 0x51, 0x1f, 0xf2, 0x49, 0xa6, 0xea,
+0x3d, 0xd9, 0x5a, 0xba, 0x05, 0x53, 0x7a, 0xd4, 0x59, 0x7e, 0x3f, 0xf1, 0x65, 0xb9, 0xa6, 0x01,
+0x5a, 0xaa, 0x79, 0x98, 0xf8, 0x80, 0x9a, 0xc6, 0x3a, 0xb0, 0xbb, 0x5b, 0xed, 0x79, 0x32, 0xbe},
+{
+0x71, 0x4d, 0xbb, 0x27, 0x33, 0x1a, 0x29, 0xcf, 0x32, 0x48, 0x52, 0x33, 0x6b, 0x7d, 0xaf, 0x6c,
+0xee, 0x84, 0x65, 0x76, 0x31, 0xe1, 0x0e, 0x6e, 0x89, 0xc5, 0x64, 0xd0, 0xf6, 0xb0, 0x0c, 0x16,
+0x8d, 0x6e, 0x13, 0x17, 0x54, 0xe5, 0x5d, 0x9d, 0x0e, 0x72, 0xab, 0x1a, 0x68, 0xd4, 0xf2, 0xe3,
+0xc2, 0x5c, 0xf7, 0xcc, 0x49, 0x8b, 0x37, 0xd1, 0xe1, 0x16, 0xff, 0xc4, 0x75, 0xc3, 0x20, 0x69},
+{
+0x11, 0xe6, 0x9e, 0x1a, 0x96, 0x9e, 0xef, 0x3e, 0xaf, 0x7f, 0xc3, 0x9c, 0xf3, 0x7b, 0x4d, 0xfe,
+0x65, 0xd9, 0x21, 0xb3, 0xb3, 0xa9, 0x2a, 0x46, 0xc5, 0x36, 0x87, 0x20, 0x3e, 0xda, 0x02, 0x17,
+0xeb, 0x5c, 0x54, 0x3a, 0xbf, 0x7b, 0xa5, 0xfb, 0xf5, 0x58, 0xa8, 0x7e, 0x66, 0xd7, 0xbc, 0x6d,
+0xf1, 0x92, 0x0d, 0x68, 0x7c, 0x89, 0x8e, 0x08, 0x80, 0x6c, 0x62, 0xbc, 0xd8, 0x1f, 0x8c, 0x46},
+{
+0x0a, 0x66, 0x88, 0xb1, 0xc7, 0x85, 0x0f, 0xb4, 0x36, 0x3c, 0xbc, 0x99, 0x19, 0x3c, 0x87, 0xc5,
+0x4c, 0xb5, 0x33, 0x7f, 0x41, 0x45, 0x7b, 0x3c, 0xf8, 0x9b, 0x8c, 0x1f, 0x3c, 0xa9, 0xd3, 0x4c,
+0xb0, 0x9c, 0x09, 0x33, 0x80, 0xe3, 0xdc, 0xf8, 0x33, 0x2f, 0xdd, 0x2e, 0xd6, 0x7d, 0x16, 0x7a,
+0xb7, 0x35, 0xfe, 0x0f, 0x87, 0x89, 0x6d, 0x57, 0x5c, 0xce, 0x8a, 0xc6, 0x86, 0x03, 0xde, 0xd2},
+{
+0x08, 0xbb, 0x58, 0x66, 0x72, 0x0a, 0x9e, 0x9a, 0x7b, 0x60, 0x89, 0xc5, 0x2a, 0x5f, 0x3c, 0xe2,
+0xc8, 0xb4, 0xbf, 0xf2, 0x14, 0xca, 0x48, 0xa0, 0x91, 0x22, 0x2c, 0xc6, 0x89, 0x0f, 0x9a, 0x4d,
+0x94, 0x72, 0x82, 0x0f, 0x31, 0x5f, 0x7b, 0x42, 0xcd, 0x35, 0x2c, 0x9f, 0xb5, 0xa8, 0xa7, 0x1e,
+0x0f, 0xc0, 0xa3, 0x85, 0x56, 0x2e, 0x44, 0x95, 0x5a, 0x97, 0x57, 0x9b, 0x21, 0x31, 0xb8, 0x8c},
+{
+0x67, 0xcf, 0xf5, 0x51, 0xda, 0xf0, 0x33, 0x43, 0xcb, 0xd3, 0xf0, 0xf4, 0x7c, 0xa4, 0x3e, 0x6d,
+0x1f, 0x83, 0x5a, 0xa0, 0x14, 0xda, 0x2f, 0x44, 0x81, 0x3e, 0x6d, 0x01, 0x13, 0x60, 0x49, 0x6a,
+0x48, 0x0f, 0x2e, 0xe5, 0x8c, 0x31, 0x47, 0xf6, 0xf1, 0x5f, 0x0d, 0x4a, 0x6e, 0xa6, 0xf3, 0x5f,
+0xa8, 0x9b, 0x19, 0x61, 0x1a, 0xd8, 0x6e, 0x04, 0x3a, 0xc2, 0x79, 0x3e, 0x08, 0xdf, 0x8e, 0x57},
+{
+0xa7, 0x1e, 0xa0, 0x3e, 0xf8, 0x96, 0xf9, 0xb8, 0x15, 0xbb, 0x97, 0x74, 0x33, 0x5d, 0x04, 0xc0,
+0x7c, 0x64, 0x05, 0x62, 0xc9, 0x9d, 0x74, 0xc4, 0xc9, 0x22, 0xfd, 0x0e, 0x54, 0x60, 0x94, 0xd8,
+0xd5, 0x4a, 0x77, 0x12, 0x09, 0xcb, 0x2d, 0x06, 0x3a, 0x6e, 0xe0, 0x8b, 0x10, 0xf3, 0x13, 0xcb,
+0xa9, 0xe1, 0x5d, 0x23, 0x35, 0x1d, 0x28, 0xca, 0x5c, 0x64, 0xc3, 0x69, 0x12, 0x74, 0x8a, 0xaf},
+{
+0xe2, 0xb1, 0xb8, 0xbe, 0x5f, 0xca, 0x08, 0x88, 0x76, 0xda, 0x0d, 0xea, 0x04, 0xb2, 0x62, 0x02,
+0x6b, 0x35, 0xeb, 0xdd, 0xfc, 0xff, 0xff, 0xb6, 0x70, 0x38, 0xb8, 0xfb, 0x3a, 0x25, 0xde, 0x52,
+0xea, 0x21, 0x8d, 0x8f, 0xc0, 0x40, 0x1f, 0x96, 0xed, 0x03, 0x2f, 0x00, 0x78, 0x62, 0x68, 0x89,
+0xea, 0x21, 0xe4, 0x38, 0xd7, 0x34, 0xf8, 0x0f, 0xdb, 0xb8, 0x6f, 0xd3, 0x6f, 0x0d, 0x27, 0x3a}
+};
+#elif ECDSA_COMB_TEETH == 8
+// Table generated using gen_comb.
+// Teeth: 8.
+static const uint8_t secp256k1_comb_table[255][64] PROGMEM = {
+{
+0x98, 0x17, 0xf8, 0x16, 0x5b, 0x81, 0xf2, 0x59, 0xd9, 0x28, 0xce, 0x2d, 0xdb, 0xfc, 0x9b, 0x02,
+0x07, 0x0b, 0x87, 0xce, 0x95, 0x62, 0xa0, 0x55, 0xac, 0xbb, 0xdc, 0xf9, 0x7e, 0x66, 0xbe, 0x79,
+0xb8, 0xd4, 0x10, 0xfb, 0x8f, 0xd0, 0x47, 0x9c, 0x19, 0x54, 0x85, 0xa6, 0x48, 0xb4, 0x17, 0xfd,
+0xa8, 0x08, 0x11, 0x0e, 0xfc, 0xfb, 0xa4, 0x5d, 0x65, 0xc4, 0xa3, 0x26, 0x77, 0xda, 0x3a, 0x48},
+{
+0xb0, 0x8d, 0xa4, 0x39, 0x5b, 0x83, 0xd7, 0xef, 0xbf, 0x03, 0x3c, 0x9b, 0xa2, 0x15, 0x12, 0x9f,
+0x45, 0xde, 0x7b, 0x9b, 0xa0, 0xd0, 0x91, 0x27, 0x67, 0x71, 0x6e, 0x69, 0xda, 0x44, 0x0f, 0x10,
+0x09, 0x5a, 0xc6, 0x2b, 0xd6, 0x5c, 0xbd, 0x0f, 0xac, 0x95, 0x51, 0xff, 0x18, 0x4a, 0xff, 0xb7,
+0x66, 0x06, 0x09, 0x0c, 0x30, 0xf3, 0xc8, 0x2e, 0x77, 0x0b, 0xa0, 0x92, 0x31, 0xe1, 0xd9, 0xcd},
+{
+0x81, 0x1f, 0x34, 0x9f, 0xbd, 0xfc, 0x50, 0xab, 0xcc, 0x6e, 0xf0, 0xe9, 0x30, 0xba, 0x05, 0x19,
+0xae, 0xa3, 0xe4, 0x35, 0xf4, 0xe5, 0x4a, 0x16, 0x27, 0xfd, 0xb4, 0x4c, 0xde, 0xff, 0xd7, 0x0e,
+0xa8, 0x05, 0xb2, 0xb8, 0xdf, 0x7e, 0x88, 0x7f, 0xdd, 0xb2, 0x12, 0x0e, 0x40, 0x3a, 0xcf, 0xfd,
+0xff, 0x1a, 0x97, 0xd9, 0x0d, 0xb2, 0xc4, 0x26, 0x26, 0x13, 0x45, 0x90, 0x54, 0x74, 0x1e, 0x73},
+{
+0xbd, 0xe6, 0xd0, 0x42, 0xe7, 0xe0, 0xb7, 0x13, 0x53, 0x5e, 0x0f, 0xdb, 0x63, 0xd1, 0x74, 0xf7,
+0xcb, 0x6e, 0x4d, 0x10, 0x7c, 0x14, 0xa2, 0x82, 0x25, 0x4e, 0x3c, 0x24, 0x01, 0xd4, 0x22, 0x33,
+0xa0, 0xb2, 0x28, 0x6c, 0xe9, 0xa2, 0xf3, 0x24, 0xf6, 0x3a, 0x87, 0xa2, 0x3e, 0xf6, 0x05, 0x28,
+0xb7, 0xf9, 0xda, 0x4d, 0xbc, 0x19, 0xb0, 0xbf, 0xf5, 0x4e, 0x66, 0xe9, 0x97, 0x07, 0xe7, 0x56},
+{
+0x2a, 0x12, 0x9d, 0x82, 0x27, 0x11, 0xa8, 0xdc, 0x49, 0x95, 0xe9, 0x67, 0x14, 0xf3, 0x17, 0x8f,
+0x73, 0x9e, 0x8a, 0x6a, 0x85, 0x90, 0x88, 0x9b, 0x9d, 0xd9, 0x6d, 0x84, 0xd9, 0xdf, 0x3f, 0x58,
+0xc4, 0xea, 0xc4, 0x63, 0x9e, 0x71, 0xc7, 0xf3, 0x7a, 0xb3, 0x34, 0xb7, 0xa3, 0x85, 0x46, 0xb4,
+0xa6, 0x47, 0x2a, 0x57, 0xd6, 0xd2, 0x92, 0x9f, 0x81, 0x7d, 0xf5, 0x2f, 0x2f, 0x23, 0xc6, 0xab},
+{
+0x4b, 0x02, 0xf2, 0xed, 0x26, 0x79, 0xf8, 0x3b, 0xdd, 0xc9, 0x61, 0x99, 0x54, 0x7c, 0x94, 0xba,
+0x94, 0x8e, 0x69, 0xbb, 0x3a, 0xd6, 0x1c, 0xc2, 0x57, 0xeb, 0x9b, 0x44, 0xe8, 0x66, 0x82, 0xaa,
+0x11, 0xd0, 0x3a, 0x3e, 0x06, 0x56, 0x23, 0xa1, 0x00, 0x76, 0x2c, 0x4b, 0xa7, 0x30, 0x4e, 0x14,
+0x45, 0x90, 0xb8, 0x51, 0xa5, 0x1d, 0x31, 0x39, 0xf6, 0xa4, 0xb6, 0x0e, 0xd4, 0x26, 0xeb, 0xf4},
+{
+0x85, 0xed, 0x8c, 0x84, 0x16, 0x01, 0x27, 0xbb, 0x3b, 0x55, 0xef, 0x2f, 0xc6, 0x92, 0xc8, 0xd6,
+0xce, 0x1f, 0x25, 0x2b, 0x64, 0x37, 0x99, 0x58, 0x96, 0xf9, 0xff, 0xae, 0xc3, 0x7a, 0xfb, 0x8b,
+0x04, 0x32, 0x6c, 0x6e, 0x60, 0x31, 0x52, 0xfb, 0xb1, 0x45, 0x52, 0x9b, 0x0f, 0x21, 0xb8, 0xe3,
+0xb6, 0x79, 0x70, 0x91, 0x8c, 0x08, 0xe8, 0xc5, 0x68, 0xca, 0x81, 0x50, 0x2c, 0x86, 0x4e, 0xa8},
+{
+0xb6, 0x27, 0xfb, 0x40, 0x28, 0x7e, 0x42, 0x32, 0x76, 0x05, 0x43, 0xbe, 0xb2, 0x3d, 0x6e, 0xc7,
+0xa5, 0x6a, 0x68, 0x61, 0xad, 0x38, 0xf2, 0x10, 0x1b, 0x8b, 0x77, 0xbe, 0x3d, 0x4e, 0xa7, 0xfe,
+0x6f, 0xb9, 0x3c, 0xf2, 0xb7, 0x3d, 0x1d, 0x70, 0x77, 0x7b, 0x3f, 0x97, 0x6b, 0x59, 0x6b, 0x12,
+0x93, 0xaf, 0xb6, 0xcc, 0xde, 0x74, 0xf6, 0x7c, 0x29, 0x13, 0x0b, 0x9b, 0xdb, 0x68, 0x05, 0x6e},
+{
+0xa3, 0xe7, 0x9d, 0x97, 0xaa, 0x3d, 0xd0, 0xd1, 0x40, 0x14, 0x83, 0xe7, 0x05, 0xb9, 0xf7, 0x00,
+0x96, 0x5b, 0xfd, 0x4d, 0xed, 0x29, 0x32, 0x70, 0x7f, 0x6d, 0x7e, 0xd6, 0x5a, 0x63, 0x7c, 0x30,
+0x23, 0xf9, 0xa2, 0x3a, 0x23, 0xf0, 0x7e, 0xa1, 0x89, 0xbf, 0x51, 0x72, 0x5a, 0xbc, 0xc0, 0x33,
+0x93, 0xdc, 0x15, 0xc8, 0xcc, 0xdb, 0x48, 0x1d, 0x09, 0xcc, 0x8c, 0x82, 0xb1, 0xcb, 0xe5, 0x90},
+{
+0xbc, 0x18, 0x81, 0x2c, 0x54, 0x51, 0xac, 0x6c, 0x98, 0xdd, 0x9d, 0x39, 0x34, 0x4b, 0xbd, 0x19,
+0x49, 0x89, 0x9c, 0x2e, 0x8d, 0x8a, 0x24, 0x47, 0xb1, 0xa3, 0xef, 0x2c, 0xa8, 0xb6, 0x4c, 0x73,
+0xd5, 0x0f, 0x41, 0x1e, 0xad, 0x40, 0xb3, 0xf1, 0x39, 0x35, 0x87, 0xc4, 0xee, 0x2b, 0x98, 0xa2,
+0x30, 0x45, 0xde, 0xd4, 0xa4, 0x3e, 0x5a, 0x7b, 0x74, 0x25, 0x20, 0x42, 0x0e, 0xe1, 0x46, 0xae},
+{
+0x75, 0xd3, 0xae, 0xd2, 0xe1, 0x90, 0x7b, 0x01, 0x01, 0x62, 0x21, 0x2d, 0x2b, 0xfd, 0xac, 0x18,
+0x74, 0xe7, 0x42, 0xa9, 0xd9, 0xf8, 0x53, 0xf0, 0x83, 0x15, 0xa2, 0x1c, 0x01, 0xa1, 0x98, 0x6a,
+0x7a, 0xd7, 0x17, 0x3b, 0xc6, 0xf5, 0xf4, 0x6a, 0x09, 0xdf, 0x2f, 0x2e, 0xee, 0x81, 0xea, 0x62,
+0x3b, 0x65, 0xc6, 0xe8, 0x44, 0xaa, 0xcf, 0xd4, 0x8a, 0xea, 0x75, 0xd6, 0x05, 0x8b, 0x28, 0x6c},
+{
+0x4d, 0x9c, 0x16, 0xd2, 0x94, 0xaa, 0x07, 0x32, 0x94, 0x46, 0x33, 0xf4, 0x8e, 0xe3, 0xca, 0xb6,
+0x86, 0x83, 0x5c, 0x92, 0x8a, 0xdc, 0xc9, 0xae, 0x0c, 0x5a, 0xad, 0xe4, 0x6d, 0xea, 0x6a, 0x86,
+0xef, 0x4a, 0x0e, 0x10, 0x99, 0xf3, 0xff, 0x6f, 0xd5, 0xe7, 0xf5, 0x20, 0xf9, 0xea, 0x26, 0x77,
+0xea, 0x84, 0x05, 0x9a, 0x12, 0x7c, 0x1c, 0xb4, 0xe6, 0x8a, 0xac, 0x5f, 0xed, 0x23, 0x3a, 0x4b},
+{
+0x80, 0xc7, 0x3a, 0x78, 0xbb, 0xd6, 0x54, 0x55, 0xdf, 0xc6, 0x9c, 0x3c, 0x3b, 0xf9, 0xd5, 0xdf,
+0x78, 0xfc, 0x97, 0x32, 0x78, 0xfb, 0x99, 0x95, 0x72, 0xb7, 0x41, 0x0b, 0x4b, 0xe9, 0x44, 0x5b,
+0x5f, 0xfc, 0x93, 0xca, 0xff, 0x3f, 0xd5, 0x36, 0xf2, 0xe4, 0x1b, 0xe8, 0x7d, 0xf1, 0xd7, 0xd1,
+0xe5, 0xc1, 0xc2, 0x2d, 0x02, 0x6d, 0x21, 0x1a, 0xc8, 0x13, 0xd7, 0xdf, 0x6d, 0x6f, 0x2b, 0x2b},
+{
+0xd3, 0x03, 0x3a, 0x8b, 0x4a, 0xd1, 0x53, 0xaf, 0x83, 0x8d, 0x56, 0xcc, 0xfd, 0xdc, 0x81, 0x47,
+0x24, 0xfd, 0x41, 0xa2, 0x78, 0xd8, 0xfb, 0xf1, 0xfa, 0xe6, 0x90, 0x81, 0x0e, 0xbb, 0x53, 0x73,
+0x32, 0x91, 0x68, 0x13, 0x17, 0x78, 0xdf, 0x4a, 0x2a, 0x99, 0x3e, 0x6b, 0xe8, 0x2d, 0x3a, 0x9b,
+0x5e, 0x03, 0x03, 0x63, 0x19, 0x88, 0x54, 0xb1, 0x03, 0xd9, 0x06, 0x47, 0xbd, 0xb3, 0x94, 0x3a},
+{
+0x57, 0x42, 0x25, 0x55, 0x3a, 0xb1, 0x36, 0x58, 0x9c, 0x62, 0xce, 0xbb, 0x6f, 0x54, 0xc8, 0x3e,
+0x4e, 0x44, 0x54, 0x64, 0xb7, 0xfa, 0xa5, 0xf0, 0xfb, 0xbc, 0x1a, 0x4a, 0xcf, 0x64, 0xdf, 0x1b,
+0x18, 0xd9, 0x90, 0x60, 0xfa, 0xbf, 0x53, 0xf8, 0x14, 0x2f, 0xd5, 0xd7, 0x6f, 0xf6, 0xe3, 0x30,
+0xc9, 0x80, 0xc8, 0xe6, 0xae, 0xf2, 0x56, 0x5b, 0xab, 0x07, 0xe3, 0x53, 0x91, 0x25, 0x31, 0xdb},
+{
+0xda, 0xc0, 0xc4, 0x9e, 0x4c, 0x44, 0x7b, 0x1b, 0x35, 0xa3, 0x3e, 0x72, 0x78, 0x56, 0x8c, 0xe8,
+0x2e, 0x16, 0x1f, 0x98, 0xad, 0xc1, 0x39, 0x92, 0x33, 0x5f, 0x3b, 0xf6, 0xd2, 0xb9, 0x68, 0x8f,
+0x82, 0xff, 0x1f, 0x50, 0x79, 0xbf, 0x3c, 0xf2, 0xfd, 0x0b, 0x51, 0x95, 0xfe, 0x2c, 0xea, 0xbb,
+0x5d, 0x21, 0xbe, 0xb6, 0xc2, 0x90, 0x1d, 0xde, 0x86, 0x39, 0x06, 0xba, 0x2d, 0x9f, 0x2a, 0x66},
+{
+0x09, 0xbf, 0x4c, 0x11, 0x85, 0xe8, 0xc5, 0x63, 0x3e, 0x7e, 0xe7, 0x7b, 0x93, 0xce, 0x27, 0x2f,
+0x33, 0x3e, 0x4a, 0xf5, 0x2d, 0xd1, 0xa6, 0xda, 0x2c, 0x87, 0xff, 0x3e, 0x51, 0x0e, 0x30, 0x8b,
+0x39, 0x0a, 0xb1, 0xb3, 0x28, 0xff, 0xc6, 0x26, 0x69, 0x71, 0xaf, 0x9a, 0xaa, 0xa7, 0xf6, 0x08,
+0xea, 0x38, 0x82, 0x6b, 0x46, 0x0d, 0x6f, 0x44, 0xcc, 0xc0, 0x43, 0x7f, 0x67, 0x30, 0xec, 0x1c},
+{
+0xa3, 0x75, 0xae, 0x95, 0xb7, 0x48, 0x87, 0xf4, 0x47, 0x24, 0x1d, 0x52, 0xaa, 0xa7, 0xa5, 0x5d,
+0xf8, 0x4a, 0x46, 0x64, 0x56, 0x0d, 0x5d, 0xa5, 0xd5, 0x25, 0x54, 0x62, 0xe1, 0x7d, 0x0a, 0xe1,
+0xf6, 0xb4, 0xef, 0x94, 0x5e, 0xd8, 0x6f, 0xb4, 0xce, 0x31, 0xee, 0x07, 0xd4, 0xd9, 0x19, 0x60,
+0xc0, 0x1e, 0x24, 0xd8, 0x53, 0x73, 0x66, 0x3f, 0x3e, 0x16, 0x54, 0x5b, 0x93, 0x71, 0x0d, 0xf2},
+{
+0x00, 0x10, 0x8e, 0x7c, 0xbf, 0x1b, 0x94, 0xa6, 0xb4, 0xaf, 0x00, 0xb8, 0xd5, 0xfa, 0x1a, 0x60,
+0xb0, 0xf8, 0x75, 0x8e, 0xe8, 0x76, 0xb1, 0xbd, 0xf5, 0xe3, 0xff, 0xb5, 0xd2, 0x35, 0x3d, 0x52,
+0x52, 0x78, 0xeb, 0x6c, 0xdd, 0xb2, 0x38, 0xf4, 0x3e, 0xfa, 0x25, 0xbf, 0x9d, 0x8a, 0xb3, 0x5d,
+0x8c, 0x1c, 0x8d, 0x69, 0x68, 0x11, 0x88, 0x61, 0xff, 0xf2, 0x84, 0x3f, 0x70, 0x98, 0x6e, 0x00},
+{
+0x70, 0x90, 0x5e, 0x07, 0x6a, 0xce, 0x16, 0xba, 0x37, 0xfe, 0x5c, 0x9b, 0x3d, 0x89, 0x26, 0xbc,
+0x74, 0x07, 0x51, 0x9c, 0xfe, 0xad, 0xdd, 0xe1, 0xf4, 0xe2, 0x3a, 0xfe, 0x88, 0x2d, 0x92, 0x90,
+0x4a, 0x82, 0x08, 0x5c, 0xcc, 0x43, 0x39, 0x65, 0xbc, 0xf4, 0xe8, 0xfc, 0x75, 0x44, 0xd7, 0x06,
+0x5d, 0x61, 0x3c, 0x53, 0xa7, 0x1f, 0x10, 0x8d, 0xa9, 0x08, 0x21, 0x74, 0xf6, 0x03, 0x19, 0x7b},
+{
+0x6c, 0xc9, 0xbd, 0x6e, 0x5c, 0xa4, 0xcf, 0x1b, 0xba, 0x84, 0x75, 0x1c, 0x04, 0xbc, 0x00, 0xe4,
+0x1f, 0x53, 0xcf, 0x74, 0x0e, 0xe2, 0x95, 0x63, 0x30, 0x1b, 0x13, 0xc5, 0xb1, 0x0b, 0xdd, 0x1e,
+0x9e, 0xcf, 0x58, 0xe3, 0x1b, 0x16, 0x17, 0xa1, 0x1c, 0xd1, 0x24, 0x27, 0xf0, 0xd6, 0x90, 0xe4,
+0xc9, 0xd8, 0x6d, 0xee, 0xf6, 0x62, 0x50, 0xf7, 0xe4, 0x73, 0xa3, 0xfb, 0x2b, 0x3b, 0xe0, 0x31},
+{
+0xef, 0xdb, 0x55, 0x27, 0x73, 0x58, 0xd7, 0x6c, 0xef, 0xb5, 0x6c, 0xe7, 0xa0, 0x2d, 0x94, 0xab,
+0x47, 0xc6, 0xe2, 0xd4, 0xd4, 0x52, 0xe2, 0xb3, 0xba, 0xe5, 0xc4, 0xfb, 0x69, 0x54, 0x1d, 0x5a,
+0x5e, 0xa4, 0x68, 0xde, 0xb5, 0x61, 0x4d, 0xe1, 0xbd, 0x1e, 0x62, 0x93, 0x5e, 0xc3, 0x89, 0x82,
+0x61, 0xf2, 0xcc, 0x92, 0xf3, 0xa6, 0x42, 0x99, 0xf3, 0x6f, 0x63, 0x16, 0x69, 0x1f, 0x69, 0xd2},
+{
+0xa7, 0x5e, 0xf0, 0x94, 0x42, 0x83, 0x24, 0x3b, 0xde, 0x90, 0x65, 0x11, 0x85, 0x80, 0xc3, 0xa6,
+0x89, 0xb4, 0xc8, 0xa1, 0x3e, 0x97, 0x53, 0x6d, 0xe6, 0xc0, 0x1c, 0xf7, 0x4f, 0xed, 0xf9, 0xd0,
+0x56, 0x06, 0xf3, 0x23, 0xae, 0x36, 0x19, 0xf8, 0xde, 0xfc, 0xa7, 0x4f, 0xe6, 0xa1, 0xb8, 0xca,
+0xf0, 0xdc, 0x17, 0xec, 0x58, 0x59, 0x73, 0x15, 0x81, 0x02, 0x94, 0x20, 0x7b, 0xfc, 0x97, 0x55},
+{
+0x6d, 0x85, 0x8a, 0x70, 0x17, 0xe9, 0x52, 0xa0, 0x5a, 0xa3, 0xf5, 0x10, 0x7f, 0xca, 0x00, 0x80,
+0x61, 0xfc, 0x9a, 0x85, 0x11, 0x95, 0x0f, 0x35, 0xce, 0x2b, 0x8e, 0x7c, 0x90, 0xad, 0xde, 0x2e,
+0x11, 0x7e, 0x17, 0xdf, 0xdf, 0xc7, 0x37, 0x13, 0x5f, 0x95, 0x22, 0x7a, 0xea, 0xbd, 0xeb, 0x7a,
+0xe4, 0x46, 0x5d, 0x3a, 0xca, 0xfb, 0x43, 0xf9, 0x5d, 0x27, 0x1f, 0x0b, 0x0c, 0x83, 0xcb, 0x9b},
+{
+0xdf, 0x5c, 0x3e, 0xca, 0x4d, 0x51, 0x52, 0x77, 0x04, 0x91, 0xb3, 0x29, 0x09, 0x75, 0x2a, 0x52,
+0x18, 0xef, 0xe8, 0x32, 0xc9, 0xd0, 0x20, 0x06, 0x54, 0x6e, 0xc6, 0xc5, 0x4f, 0xb9, 0xe5, 0x91,
+0x67, 0x04, 0x6f, 0x16, 0xa4, 0x63, 0xd0, 0xeb, 0xb3, 0x8c, 0xb8, 0xf6, 0xbe, 0x5e, 0xc4, 0x35,
+0x45, 0xa5, 0x59, 0xbb, 0x8a, 0x95, 0xe1, 0x06, 0x1d, 0x46, 0xd3, 0x67, 0x78, 0xa7, 0xf9, 0x10},
+{
+0xb9, 0x7a, 0x1b, 0xad, 0x2d, 0x77, 0x7a, 0x2c, 0x4b, 0x7b, 0x22, 0x8f, 0xfa, 0x0f, 0x85, 0xee,
+0x3e, 0xc2, 0xd1, 0xa8, 0xb8, 0xfc, 0x08, 0x24, 0x34, 0x25, 0x9a, 0xb9, 0x00, 0x23, 0xcb, 0xe1,
+0x83, 0xb2, 0xf8, 0xd0, 0x4e, 0x43, 0xa2, 0x39, 0x52, 0xd9, 0xfb, 0x97, 0xeb, 0x62, 0xa8, 0x19,
+0xb8, 0x11, 0x83, 0x71, 0x17, 0x1f, 0xd2, 0x89, 0x4f, 0x5c, 0x82, 0xaf, 0x15, 0x43, 0x6c, 0x85},
+{
+0xa6, 0x3f, 0xdb, 0x40, 0x25, 0x0e, 0x31, 0xfc, 0x98, 0xc4, 0x5e, 0x40, 0xce, 0xd6, 0xa7, 0x0b,
+0xab, 0xe7, 0x45, 0x54, 0xfb, 0x2d, 0x7e, 0x08, 0x5a, 0x3b, 0xb5, 0xa4, 0x18, 0xe5, 0x95, 0xf5,
+0x70, 0x72, 0xeb, 0x3b, 0x35, 0xd6, 0x96, 0xc9, 0xe8, 0x06, 0x63, 0x2b, 0x96, 0xf2, 0x07, 0x62,
+0xe6, 0x77, 0x49, 0x56, 0x1e, 0xdc, 0x6f, 0x8e, 0x1c, 0xd5, 0xa1, 0x29, 0xd5, 0x31, 0xa5, 0xba},
+{
+0x46, 0xa7, 0x5b, 0xf5, 0xe8, 0x36, 0xe3, 0xab, 0xf1, 0xab, 0xeb, 0xc1, 0x12, 0xe4, 0x3e, 0x48,
+0x2b, 0xa9, 0xf0, 0xb2, 0xe8, 0x71, 0x8d, 0x44, 0xee, 0xe6, 0x23, 0x5b, 0x7d, 0x69, 0x08, 0x23,
+0x4f, 0x72, 0xf3, 0x9f, 0xa0, 0x50, 0xa7, 0x02, 0xb3, 0x55, 0x9b, 0x2e, 0x15, 0xde, 0x31, 0x23,
+0x6b, 0x87, 0xeb, 0xc9, 0x0e, 0xd0, 0xb4, 0xdc, 0x22, 0x78, 0xc8, 0x61, 0x9c, 0xc5, 0xbc, 0x1c},
+{
+0x70, 0x73, 0xf1, 0x10, 0x92, 0x19, 0x5f, 0x7a, 0x67, 0x31, 0x82, 0x06, 0xb5, 0x3f, 0x6c, 0xf5,
+0xff, 0x3d, 0xb8, 0x5a, 0x9a, 0xfa, 0x4b, 0x26, 0x1f, 0xb0, 0x9c, 0xa5, 0x96, 0xd9, 0xb8, 0xc5,
+0x5f, 0xc8, 0xad, 0xba, 0x2c, 0x58, 0xc5, 0x41, 0x2d, 0xf4, 0x2a, 0x9e, 0x21, 0xcb, 0xc9, 0x43,
+0xcb, 0x32, 0x94, 0x1d, 0x5f, 0x9e, 0x0c, 0x12, 0x6e, 0x0f, 0xe4, 0x5a, 0xa4, 0x04, 0xf8, 0xc1},
+{
+0x3a, 0x5c, 0x5b, 0xa5, 0x14, 0xd3, 0x82, 0xf7, 0xe7, 0xca, 0x48, 0x67, 0xff, 0xa4, 0xaf, 0xda,
+0x31, 0x5d, 0x17, 0x2e, 0xf5, 0x45, 0x1a, 0x7b, 0x8f, 0x7f, 0xec, 0x32, 0x4c, 0x7e, 0x99, 0xd4,
+0x4a, 0x07, 0xd7, 0x18, 0x97, 0x0a, 0x5d, 0x8b, 0xd7, 0xcd, 0x60, 0xf6, 0x3f, 0xaa, 0xd5, 0x9b,
+0x17, 0x2b, 0x14, 0x13, 0xb8, 0xdd, 0xae, 0x01, 0xf8, 0x43, 0xe0, 0xc2, 0x58, 0x1c, 0xc0, 0x92},
+{
+0xd2, 0xdb, 0xa3, 0x61, 0x38, 0x15, 0x1f, 0xf6, 0x78, 0x32, 0x63, 0xe2, 0x75, 0x3b, 0x44, 0x91,
+0x1e, 0x3d, 0x16, 0x02, 0xb9, 0x6c, 0x17, 0xfe, 0x0e, 0x93, 0x55, 0xec, 0x67, 0xca, 0xaa, 0x37,
+0x36, 0xf0, 0x18, 0xe4, 0x89, 0xc2, 0xe0, 0x0c, 0xd5, 0xbb, 0x87, 0x76, 0xa9, 0xfc, 0xb1, 0x19,
+0x6d, 0x87, 0x72, 0x7d, 0x52, 0x38, 0x17, 0x2c, 0x12, 0xe4, 0x8f, 0x10, 0xed, 0x90, 0xe8, 0x75},
+{
+0xcd, 0x98, 0x1f, 0xac, 0xc8, 0x99, 0xfc, 0xcb, 0x08, 0x03, 0x7f, 0x4d, 0x05, 0x89, 0x34, 0x52,
+0x21, 0x60, 0xc6, 0x1c, 0x9c, 0x8a, 0xed, 0xfa, 0x70, 0x48, 0x47, 0x4a, 0xa8, 0x19, 0x39, 0x9c,
+0x9d, 0x59, 0xfc, 0xd4, 0x03, 0x5e, 0x7e, 0xbe, 0xe6, 0xc8, 0x64, 0x6c, 0xf7, 0x26, 0x53, 0x90,
+0x41, 0xe6, 0x60, 0xf2, 0x4b, 0x04, 0x4f, 0x58, 0x57, 0xdd, 0x4d, 0x4a, 0x0f, 0x4f, 0xb8, 0xdd},
+{
+0x12, 0x2a, 0xbf, 0x7e, 0x4d, 0x64, 0x50, 0xe5, 0xc5, 0xfa, 0x91, 0xc3, 0x51, 0xc9, 0xbc, 0x34,
+0xf7, 0x65, 0xec, 0x4f, 0x15, 0x17, 0x79, 0x57, 0x2e, 0x7e, 0x70, 0x73, 0x67, 0x57, 0xe0, 0xb4,
+0x2a, 0xcb, 0xc5, 0xc8, 0x79, 0xe4, 0x10, 0x1b, 0x41, 0x75, 0xa3, 0x33, 0xcc, 0xf7, 0x20, 0xc0,
+0xfe, 0xfa, 0xd8, 0xf5, 0xb5, 0x47, 0x98, 0x52, 0x58, 0x88, 0x3b, 0x7d, 0xbb, 0x56, 0xe0, 0x54},
+{
+0xed, 0xeb, 0x7c, 0xed, 0xa8, 0xca, 0xaa, 0xc4, 0x4e, 0x42, 0xae, 0x4f, 0xce, 0x2d, 0x5d, 0xb7,
+0x5e, 0x73, 0x20, 0xba, 0xa2, 0x85, 0x15, 0xa0, 0x99, 0x23, 0x12, 0xba, 0x4b, 0xf2, 0x75, 0x3d,
+0xce, 0x0d, 0x57, 0xd5, 0x6f, 0x60, 0xe4, 0xcb, 0xc2, 0x92, 0xa1, 0x2d, 0xd7, 0xbf, 0x00, 0x9d,
+0x65, 0x72, 0x7b, 0xa5, 0x6b, 0xe8, 0x3c, 0x9c, 0x5e, 0xdf, 0x4e, 0xec, 0xf1, 0x22, 0x7a, 0x98},
+{
+0x76, 0x31, 0xaa, 0xdc, 0x3b, 0xca, 0x75, 0x51, 0x28, 0xf6, 0x3a, 0x52, 0x2b, 0xea, 0x73, 0x31,
+0xc8, 0xbf, 0x01, 0x40, 0xd2, 0x6c, 0xec, 0x7b, 0x34, 0x0e, 0x79, 0x35, 0x2e, 0xd9, 0x62, 0x61,
+0x5b, 0x21, 0xe7, 0x10, 0x4d, 0x19, 0x65, 0x75, 0xaa, 0xe8, 0x22, 0xa4, 0x6e, 0xa3, 0x31, 0x4e,
+0xb1, 0xea, 0xeb, 0xf8, 0xda, 0xb2, 0x18, 0x74, 0x59, 0x0f, 0xf1, 0x03, 0x22, 0x73, 0x77, 0xed},
+{
+0xe1, 0xe4, 0x24, 0x5a, 0xbe, 0x7d, 0xc1, 0x30, 0x12, 0xab, 0x07, 0x75, 0x60, 0x5d, 0x91, 0x66,
+0xf1, 0x7e, 0x9d, 0x1d, 0x08, 0xe4, 0xd8, 0x61, 0x54, 0xe5, 0xae, 0xa7, 0x73, 0xa4, 0x3d, 0x71,
+0xd3, 0x9e, 0xce, 0x68, 0xc9, 0xf4, 0x7d, 0xb5, 0x17, 0x0a, 0xbe, 0x76, 0xed, 0xe7, 0x02, 0x6a,
+0xf0, 0x13, 0xe7, 0x37, 0x95, 0x9a, 0x45, 0xc5, 0x90, 0x8a, 0x37, 0x10, 0x2f, 0x61, 0x6b, 0x04},
+{
+0x49, 0x7d, 0xe5, 0x0c, 0x49, 0xcb, 0xa9, 0x60, 0x0b, 0x80, 0x89, 0x66, 0xfd, 0x26, 0xde, 0x1e,
+0xba, 0x48, 0x4b, 0x31, 0x30, 0x44, 0xe5, 0x3d, 0xfd, 0x0b, 0x9a, 0xae, 0x18, 0xbe, 0x17, 0xe6,
+0xd3, 0xad, 0x25, 0xac, 0x10, 0x5c, 0x60, 0x3d, 0x25, 0x93, 0x60, 0xa7, 0xc2, 0xe1, 0x53, 0x94,
+0xec, 0xea, 0xfa, 0x18, 0x86, 0xba, 0x80, 0x03, 0xc1, 0x90, 0x6a, 0x31, 0x7b, 0x69, 0x89, 0x4c},
+{
+0x24, 0xf2, 0xb1, 0x3c, 0x2a, 0xaa, 0x4b, 0x4b, 0xee, 0xad, 0xeb, 0x0c, 0x87, 0x7f, 0x13, 0x9b,
+0x17, 0x9f, 0x54, 0x4a, 0xb7, 0x8e, 0xa7, 0xab, 0x36, 0x2d, 0x5c, 0xb6, 0x54, 0xa2, 0x33, 0xbf,
+0x66, 0x79, 0x45, 0xe3, 0x9b, 0xfb, 0xbe, 0xd2, 0xe7, 0xbd, 0x9a, 0x71, 0xb5, 0x61, 0xc7, 0x23,
+0x91, 0xfc, 0x54, 0x9b, 0x19, 0x79, 0x52, 0xff, 0x8e, 0x11, 0xac, 0x16, 0xbd, 0x44, 0x6d, 0xe0},
+{
+0xd8, 0x15, 0x6c, 0x1e, 0xe4, 0x7e, 0x1f, 0x97, 0x5d, 0x1f, 0x4d, 0xfc, 0xff, 0x56, 0x47, 0x95,
+0x27, 0x96, 0x11, 0xd8, 0xbd, 0xe4, 0x5a, 0xdc, 0x56, 0xa0, 0xb2, 0xf1, 0x0e, 0x67, 0x96, 0x7c,
+0x5a, 0xdb, 0x3b, 0x39, 0x5c, 0x8e, 0xa0, 0x59, 0xc5, 0xcb, 0x58, 0xd2, 0x4c, 0xef, 0x7a, 0xe9,
+0x5c, 0x40, 0x28, 0x96, 0xde, 0xa4, 0xb2, 0xb9, 0xd8, 0xf9, 0x38, 0x2c, 0x17, 0x68, 0x88, 0x80},
+{
+0x65, 0x06, 0xea, 0x73, 0x15, 0x97, 0x1b, 0x21, 0xbb, 0xab, 0xa1, 0xf3, 0xd4, 0x85, 0xf4, 0x86,
+0x0e, 0x6f, 0x07, 0xcd, 0xd8, 0x42, 0xd2, 0xab, 0x88, 0xdc, 0xa5, 0x0b, 0xab, 0x32, 0x23, 0x86,
+0x11, 0x49, 0x78, 0x7b, 0x5c, 0x50, 0xaf, 0x09, 0xe7, 0xfa, 0xf4, 0xca, 0xe8, 0x44, 0x95, 0xc8,
+0xeb, 0x32, 0x9a, 0xae, 0xf6, 0x25, 0x66, 0x25, 0x3f, 0x1a, 0x6d, 0x60, 0x72, 0x2b, 0x53, 0xe2},
+{
+0x71, 0xd2, 0x5e, 0xa2, 0x61, 0x80, 0xaa, 0x2a, 0x4d, 0x32, 0x2c, 0x6e, 0xdd, 0x0e, 0x4d, 0xc6,
+0x1b, 0x31, 0x1a, 0x4f, 0x1b, 0x8b, 0xc0, 0x6a, 0x29, 0x98, 0x97, 0x64, 0x2b, 0x9b, 0x58, 0x7b,
+0xe3, 0xee, 0xe4, 0x3d, 0xa6, 0xdb, 0x8d, 0x3c, 0x58, 0x46, 0x81, 0xd4, 0xea, 0x00, 0x93, 0xa4,
+0xb3, 0xad, 0x6b, 0x57, 0x89, 0x55, 0xa0, 0xcb, 0x03, 0x5a, 0x8b, 0x10, 0xb1, 0x27, 0x87, 0xea},
+{
+0x85, 0xf8, 0xea, 0x0d, 0x13, 0xf3, 0xe9, 0x79, 0xc9, 0x21, 0xdf, 0x46, 0x6e, 0xf7, 0x8f, 0x93,
+0x2c, 0xbb, 0x53, 0xa9, 0xfb, 0xf5, 0x68, 0x19, 0x27, 0x5f, 0x15, 0x29, 0xbf, 0x38, 0xf5, 0xdf,
+0x20, 0xd0, 0xd5, 0x31, 0xb1, 0xe0, 0xba, 0xf7, 0x8d, 0x6a, 0x67, 0x1a, 0x87, 0xc7, 0xfd, 0x5a,
+0xff, 0x53, 0x9d, 0xfa, 0x32, 0xf0, 0xb4, 0x11, 0x67, 0x91, 0x95, 0xc5, 0x3e, 0x43, 0xba, 0x86},
+{
+0xc1, 0xed, 0x4d, 0xc0, 0x28, 0x12, 0x31, 0x22, 0x9a, 0x48, 0x2b, 0xbc, 0xf4, 0x71, 0x18, 0x9c,
+0x0f, 0xa7, 0x03, 0x48, 0xaf, 0x23, 0x7b, 0x6e, 0x4e, 0xda, 0xcc, 0x39, 0x0c, 0xad, 0xb9, 0x06,
+0x33, 0x8b, 0x11, 0xe6, 0x07, 0xe8, 0x28, 0xf2, 0xdb, 0x86, 0x62, 0x06, 0x0f, 0xac, 0xa8, 0x69,
+0x75, 0x22, 0x46, 0x35, 0xbb, 0x20, 0xbc, 0xb6, 0xe3, 0x89, 0xe0, 0x4e, 0x52, 0xea, 0x9d, 0x91},
+{
+0x9f, 0xf5, 0x6e, 0x91, 0x76, 0x15, 0xa7, 0x5d, 0xba, 0x0a, 0x7f, 0x8c, 0xef, 0x01, 0x9b, 0x11,
+0x75, 0x3d, 0xb8, 0x8f, 0x92, 0x3d, 0x6b, 0x4d, 0xf7, 0xee, 0x94, 0xd1, 0x5c, 0x8c, 0x8a, 0x94,
+0x15, 0x23, 0x64, 0x89, 0xb6, 0x89, 0xcb, 0x27, 0x67, 0xdb, 0x85, 0xba, 0xdc, 0xc6, 0xf2, 0x00,
+0xa5, 0x19, 0x9a, 0x5b, 0xe5, 0x9a, 0xa4, 0x59, 0xb4, 0x36, 0x91, 0xf9, 0x12, 0x4c, 0xaf, 0xc0},
+{
+0xb9, 0x09, 0x5a, 0x92, 0xe3, 0x49, 0xb9, 0x56, 0x73, 0xb3, 0x8b, 0xe5, 0x2a, 0x19, 0xec, 0x8f,
+0xe8, 0x25, 0xae, 0xbe, 0xd8, 0x86, 0x02, 0x86, 0xf4, 0x9c, 0x64, 0xce, 0x97, 0x7b, 0x13, 0xcf,
+0x6d, 0x59, 0x72, 0x09, 0x3f, 0x88, 0x34, 0x0f, 0xa3, 0x27, 0x5f, 0x1a, 0x8e, 0xf5, 0x7a, 0x36,
+0x8d, 0xcb, 0x5e, 0xcd, 0xd9, 0x83, 0x14, 0xa4, 0x30, 0xd0, 0xf7, 0xd8, 0x20, 0x9d, 0xb4, 0xaf},
+{
+0x45, 0xdf, 0x9f, 0xd5, 0x9e, 0x91, 0xdf, 0x37, 0xc5, 0x53, 0xaa, 0xed, 0x00, 0xe3, 0xcb, 0x69,
+0x66, 0x36, 0xe9, 0xca, 0x9a, 0x61, 0x9b, 0x6f, 0x06, 0x20, 0x02, 0xf4, 0x57, 0x30, 0xab, 0x65,
+0xe4, 0x16, 0x1b, 0xa5, 0x1a, 0x1e, 0x8c, 0x40, 0x47, 0x62, 0x32, 0x88, 0x88, 0x6b, 0x4d, 0x4f,
+0xa1, 0x19, 0x1c, 0x18, 0x94, 0x95, 0x4c, 0x25, 0xc9, 0xa6, 0xe7, 0xcf, 0x64, 0xcd, 0xe2, 0x86},
+{
+0x3c, 0xd6, 0x26, 0x01, 0xd8, 0x56, 0xb1, 0x9e, 0x73, 0x87, 0x57, 0xd2, 0x3c, 0xff, 0xb2, 0x4e,
+0xa5, 0x4f, 0x89, 0x30, 0xf7, 0xce, 0xf6, 0xa7, 0x00, 0xca, 0x84, 0xa6, 0x8e, 0x14, 0x2e, 0x66,
+0x23, 0xc6, 0x31, 0xfa, 0x96, 0x53, 0x99, 0xe1, 0xc6, 0x22, 0xb5, 0x1b, 0xec, 0x10, 0x35, 0x18,
+0x1d, 0x66, 0x2c, 0x57, 0x6b, 0x0f, 0x16, 0x44, 0x96, 0x6c, 0x46, 0x6e, 0x25, 0xb4, 0x03, 0x53},
+{
+0x79, 0x1c, 0x81, 0xf4, 0xa8, 0x5e, 0xed, 0x57, 0x14, 0x27, 0xa3, 0xcb, 0xc8, 0x94, 0x8a, 0x69,
+0xc5, 0x7d, 0xa1, 0x9d, 0x77, 0x67, 0x0c, 0x82, 0xca, 0x05, 0xde, 0x4b, 0x87, 0x6d, 0x87, 0xdb,
+0xf6, 0x30, 0xde, 0xf2, 0x74, 0x05, 0x93, 0x6f, 0x23, 0x1d, 0xf2, 0xcb, 0xdd, 0x14, 0x5f, 0x95,
+0x1a, 0xb8, 0xff, 0xdc, 0x81, 0xd9, 0x94, 0x68, 0x5a, 0xb5, 0xcd, 0x7e, 0xf5, 0xaf, 0x52, 0x6f},
+{
+0xbe, 0xaf, 0x7f, 0x88, 0x0d, 0xf5, 0x41, 0xd3, 0xa9, 0xf6, 0xe9, 0x12, 0x65, 0xa8, 0xd0, 0xfd,
+0x63, 0x4a, 0x2e, 0xeb, 0x8d, 0x7d, 0xc5, 0x32, 0x66, 0xba, 0x77, 0x01, 0x0d, 0xf0, 0x46, 0x10,
+0x6d, 0x06, 0x12, 0xf8, 0x2e, 0x96, 0xbf, 0xa1, 0x5e, 0x55, 0xc7, 0x56, 0x70, 0x0e, 0xe6, 0x35,
+0xd1, 0x46, 0xfc, 0x2f, 0xb6, 0x13, 0xec, 0x96, 0x38, 0x23, 0x5b, 0xf3, 0x26, 0x61, 0xfc, 0x57},
+{
+0xc3, 0x01, 0xf4, 0x7d, 0xe6, 0x5c, 0xd5, 0x52, 0xa6, 0xf7, 0x9d, 0x28, 0xc8, 0x77, 0x29, 0x0d,
+0xf3, 0xcf, 0xd8, 0xdf, 0xcc, 0xeb, 0x27, 0x5d, 0x38, 0x97, 0x18, 0x99, 0xe3, 0xc9, 0xd5, 0xc7,
+0x06, 0xb2, 0xb9, 0x51, 0xd4, 0x17, 0xc3, 0xdc, 0xb0, 0xb6, 0x21, 0x9b, 0x9d, 0x13, 0xcb, 0xc1,
+0x37, 0xb7, 0xa0, 0xa9, 0x51, 0x80, 0x36, 0x8e, 0x02, 0x37, 0xe1, 0xef, 0x65, 0x3e, 0xf9, 0x77},
+{
+0x26, 0xb4, 0x85, 0xca, 0x39, 0x52, 0xec, 0x4f, 0x12, 0x70, 0x02, 0xf5, 0x95, 0x57, 0xc5, 0x59,
+0xca, 0x32, 0x1a, 0x01, 0xfe, 0x23, 0x92, 0x97, 0xe3, 0xe4, 0x6e, 0x8d, 0xc5, 0x98, 0xe5, 0x21,
+0x5c, 0x22, 0x2a, 0xd3, 0x96, 0x14, 0xd0, 0x86, 0xd8, 0x89, 0xf7, 0x29, 0x1f, 0xaa, 0x17, 0x7a,
+0x2e, 0x60, 0x3b, 0x8a, 0x8b, 0x9a, 0x86, 0x44, 0x27, 0x3d, 0x6b, 0x23, 0x86, 0xca, 0x1d, 0x85},
+{
+0xf7, 0x6a, 0xd7, 0x98, 0xde, 0xfb, 0x38, 0x89, 0xc1, 0xe5, 0x39, 0x36, 0x07, 0x09, 0x74, 0xcc,
+0x16, 0xf2, 0xb7, 0x30, 0xb5, 0xd1, 0x7a, 0xb0, 0xaa, 0x34, 0x84, 0x90, 0x25, 0x76, 0xea, 0x56,
+0x68, 0xaf, 0xd1, 0xa9, 0xb5, 0x27, 0x02, 0x10, 0x9a, 0xed, 0x61, 0xe7, 0x3f, 0x38, 0xd5, 0xb7,
+0xd6, 0x43, 0xca, 0xc1, 0x3c, 0xe2, 0xa5, 0x38, 0x3d, 0x56, 0xd7, 0xa4, 0xfa, 0x71, 0x02, 0x13},
+{
+0x31, 0x54, 0x85, 0x97, 0x6e, 0xe5, 0x2f, 0xfe, 0xb2, 0xa8, 0x9d, 0xc7, 0x01, 0xf3, 0x37, 0xe5,
+0x07, 0x1a, 0x1f, 0x96, 0xa4, 0x32, 0x7b, 0xd3, 0xa8, 0x1c, 0x0b, 0xbe, 0x7c, 0x2f, 0xb4, 0x1a,
+0x21, 0x41, 0xcf, 0xfb, 0xd4, 0x2f, 0x54, 0xb6, 0x92, 0xfe, 0xfd, 0x5d, 0x9f, 0x27, 0x7c, 0x9c,
+0x5b, 0x87, 0xee, 0xcd, 0xa3, 0xda, 0x20, 0x98, 0x7a, 0xcf, 0x7e, 0x2b, 0x88, 0xa4, 0x7f, 0x5f},
+{
+0x60, 0x8a, 0xe3, 0x86, 0xf3, 0x12, 0x0d, 0x0e, 0x63, 0xe9, 0x25, 0x94, 0x7d, 0x74, 0x5e, 0xfb,
+0x99, 0x9b, 0x80, 0x0b, 0x62, 0x54, 0xc3, 0xb3, 0xc1, 0x0c, 0x4f, 0xea, 0xf3, 0xf7, 0xa2, 0xc5,
+0x0a, 0x44, 0xb7, 0xac, 0xff, 0x5a, 0x78, 0x0b, 0xbd, 0x08, 0x14, 0x95, 0x02, 0x11, 0x97, 0x90,
+0xf8, 0x62, 0xd0, 0x7f, 0xbe, 0xed, 0x74, 0x4b, 0x66, 0xa3, 0x1c, 0xb2, 0x8b, 0x47, 0xd7, 0xca},
+{
+0x5e, 0x15, 0x99, 0xb7, 0xa6, 0x8f, 0xb4, 0x05, 0x10, 0xeb, 0x83, 0xe6, 0x80, 0x27, 0xe3, 0x14,
+0xbd, 0xe2, 0xf4, 0xfc, 0x7f, 0x22, 0xf0, 0xf8, 0x4d, 0xc6, 0x21, 0xf4, 0x8a, 0x12, 0xb7, 0x00,
+0x9f, 0x10, 0xdd, 0xe2, 0xa4, 0xaa, 0xa9, 0x42, 0xcb, 0x0d, 0x19, 0x05, 0x89, 0xd9, 0x75, 0xe9,
+0x4c, 0x5a, 0xb5, 0x79, 0x3f, 0x97, 0xc9, 0xac, 0xde, 0xfa, 0xd7, 0xc1, 0xc0, 0x02, 0x9b, 0x6e},
+{
+0xaf, 0x69, 0xff, 0xd4, 0x95, 0xd3, 0x71, 0x89, 0xcc, 0xd0, 0x4f, 0x1d, 0x10, 0x7c, 0xf2, 0x44,
+0xbf, 0x9a, 0xc6, 0x28, 0xee, 0xd0, 0x25, 0x1b, 0x32, 0xa3, 0x62, 0x52, 0x33, 0x47, 0x88, 0x9a,
+0x47, 0xfc, 0xe3, 0x2f, 0xd6, 0x87, 0xa8, 0x3a, 0xf3, 0x7c, 0x57, 0xaa, 0xbe, 0x5e, 0xf5, 0x53,
+0xb8, 0xdd, 0x80, 0x04, 0xf6, 0x1b, 0x64, 0x5a, 0x67, 0x08, 0x9a, 0x97, 0x80, 0x1a, 0xa4, 0x81},
+{
+0xb8, 0xde, 0x7a, 0xe8, 0x81, 0x92, 0xcd, 0x43, 0x90, 0x57, 0x7d, 0x09, 0x00, 0xff, 0x30, 0xa7,
+0x81, 0xbf, 0x32, 0x9f, 0xeb, 0x81, 0xe8, 0x1e, 0xa2, 0x1f, 0xf0, 0xed, 0x41, 0x3c, 0x52, 0x1c,
+0x20, 0xc1, 0xa9, 0x52, 0x01, 0x41, 0x3f, 0x83, 0xcb, 0xf1, 0x06, 0xca, 0x58, 0xde, 0x14, 0x9b,
+0xf9, 0xa2, 0x0e, 0xf2, 0x7e, 0xbd, 0x11, 0xd1, 0x44, 0x0c, 0xc0, 0xc5, 0x7b, 0x77, 0x86, 0x69},
+{
+0xee, 0xf6, 0xde, 0x48, 0x9d, 0x1b, 0x06, 0x27, 0xcd, 0x97, 0x84, 0x8c, 0x0f, 0xfe, 0x05, 0xea,
+0xfa, 0x23, 0xf0, 0x25, 0xa1, 0x74, 0x63, 0x5f, 0x11, 0x56, 0xbf, 0xaa, 0xa7, 0xd2, 0x36, 0xa3,
+0xd1, 0x2a, 0x04, 0x44, 0xab, 0xf3, 0xf2, 0x65, 0x09, 0xaa, 0x02, 0xff, 0xe2, 0x02, 0x7c, 0xd0,
+0x10, 0x67, 0x4e, 0x2a, 0x72, 0xc0, 0x99, 0xb3, 0x52, 0xd8, 0xbf, 0x87, 0x55, 0xc2, 0x81, 0xfd},
+{
+0xd1, 0xd9, 0x92, 0xb5, 0xb9, 0x22, 0x1d, 0xf1, 0xc0, 0xa9, 0x88, 0x97, 0x24, 0xeb, 0x98, 0xd4,
+0x09, 0x2c, 0xec, 0x4a, 0x56, 0xfa, 0xb9, 0x71, 0x87, 0x4f, 0xe6, 0x88, 0x79, 0xfd, 0x0b, 0xb6,
+0x7c, 0xed, 0x70, 0x41, 0x84, 0x97, 0xc0, 0x0d, 0xf4, 0x73, 0x3e, 0xd2, 0xe5, 0x0c, 0x82, 0xc4,
+0x48, 0x86, 0x97, 0x28, 0x2e, 0xb9, 0x47, 0x96, 0x6d, 0xa2, 0x6a, 0x0a, 0x02, 0xea, 0x41, 0x16},
+{
+0xcc, 0xc1, 0xbd, 0x92, 0x4a, 0x39, 0x5d, 0xce, 0x18, 0xbb, 0x8f, 0x1d, 0xdb, 0x99, 0x97, 0x21,
+0x06, 0xdb, 0x11, 0x3d, 0x1b, 0xc0, 0x82, 0xee, 0xd4, 0xaa, 0xa2, 0xbf, 0xbd, 0x7e, 0x25, 0xaa,
+0x23, 0xf3, 0xe9, 0x38, 0xd8, 0xc8, 0xbe, 0x97, 0xc9, 0xfc, 0x79, 0xb2, 0x72, 0x3a, 0x07, 0xfe,
+0xc6, 0x16, 0x24, 0xe6, 0x55, 0x6a, 0x91, 0x9b, 0xe7, 0x08, 0x3f, 0x5b, 0xb6, 0x27, 0x61, 0xb9},
+{
+0x79, 0x56, 0xba, 0xc3, 0xb8, 0xb1, 0x95, 0xa4, 0xf6, 0x85, 0x62, 0x9f, 0xdd, 0xbd, 0x0c, 0xb7,
+0x83, 0x41, 0xb7, 0x94, 0xc6, 0x1a, 0xa2, 0x3f, 0x47, 0xb3, 0x57, 0x97, 0xaa, 0x15, 0x24, 0x40,
+0xfa, 0xcb, 0xad, 0x8f, 0x4f, 0x0b, 0xd9, 0xf4, 0x59, 0x3e, 0x63, 0x65, 0x11, 0x11, 0x1a, 0x4e,
+0xfa, 0xdb, 0x8e, 0x63, 0x49, 0xe1, 0x69, 0x83, 0x2e, 0x90, 0x1f, 0x3b, 0xa2, 0x49, 0x1f, 0xcc},
+{
+0x4c, 0xcd, 0x91, 0x73, 0xc8, 0xdd, 0x05, 0x70, 0x6c, 0xc1, 0x00, 0xa7, 0x6f, 0x9e, 0x11, 0x35,
+0xd7, 0x8d, 0xf3, 0xc9, 0xc0, 0x68, 0xa1, 0x3f, 0x4a, 0x19, 0xa5, 0x8e, 0xd5, 0x25, 0x54, 0xbe,
+0x7a, 0xb6, 0x79, 0x17, 0xba, 0x30, 0xe8, 0xd4, 0x87, 0x48, 0x1c, 0x25, 0x7f, 0x6e, 0x4a, 0x2f,
+0x5e, 0x7c, 0x5c, 0x52, 0x7d, 0x8e, 0xed, 0x83, 0xe7, 0x5e, 0xfc, 0xec, 0xb5, 0x66, 0x6a, 0xee},
+{
+0x63, 0x17, 0x41, 0x9b, 0x86, 0xc8, 0x78, 0xee, 0x84, 0xb4, 0x4a, 0x61, 0xa1, 0x6c, 0x93, 0xda,
+0x7a, 0xa6, 0xef, 0x4a, 0x50, 0x88, 0xbf, 0xce, 0xc3, 0x46, 0xff, 0x0a, 0xde, 0xf7, 0x1d, 0xe9,
+0x66, 0x56, 0x62, 0x43, 0xa4, 0x30, 0x7b, 0x77, 0x1c, 0xe1, 0xa5, 0xca, 0xcc, 0x4a, 0x3d, 0xe9,
+0x6a, 0x74, 0x54, 0xd3, 0x70, 0x3d, 0xef, 0x9e, 0xbb, 0x1b, 0x10, 0xee, 0xc0, 0x11, 0xcd, 0x0c},
+{
+0xb3, 0xe2, 0x20, 0x21, 0xfa, 0x58, 0x3b, 0x7f, 0xaa, 0xf9, 0x47, 0x7f, 0xce, 0xfd, 0x58, 0x7a,
+0x21, 0xe5, 0xe6, 0x4c, 0xe3, 0x4a, 0xbe, 0xe7, 0xba, 0xbd, 0x51, 0x1f, 0xf2, 0x49, 0xa6, 0xea,
+0x3d, 0xd9, 0x5a, 0xba, 0x05, 0x53, 0x7a, 0xd4, 0x59, 0x7e, 0x3f, 0xf1, 0x65, 0xb9, 0xa6, 0x01,
+0x5a, 0xaa, 0x79, 0x98, 0xf8, 0x80, 0x9a, 0xc6, 0x3a, 0xb0, 0xbb, 0x5b, 0xed, 0x79, 0x32, 0xbe},
+{
+0x71, 0x4d, 0xbb, 0x27, 0x33, 0x1a, 0x29, 0xcf, 0x32, 0x48, 0x52, 0x33, 0x6b, 0x7d, 0xaf, 0x6c,
+0xee, 0x84, 0x65, 0x76, 0x31, 0xe1, 0x0e, 0x6e, 0x89, 0xc5, 0x64, 0xd0, 0xf6, 0xb0, 0x0c, 0x16,
+0x8d, 0x6e, 0x13, 0x17, 0x54, 0xe5, 0x5d, 0x9d, 0x0e, 0x72, 0xab, 0x1a, 0x68, 0xd4, 0xf2, 0xe3,
+0xc2, 0x5c, 0xf7, 0xcc, 0x49, 0x8b, 0x37, 0xd1, 0xe1, 0x16, 0xff, 0xc4, 0x75, 0xc3, 0x20, 0x69},
+{
+0xe5, 0x66, 0x51, 0x90, 0x5d, 0x91, 0x28, 0x26, 0x69, 0x1a, 0xd7, 0xcf, 0xba, 0x5d, 0x24, 0xe3,
+0xe7, 0x8f, 0xc1, 0x0a, 0x04, 0x60, 0x6a, 0xd7, 0x4c, 0x13, 0x97, 0xf5, 0xf5, 0xf7, 0xba, 0xca,
+0x27, 0x60, 0xb5, 0xae, 0xa8, 0x65, 0x30, 0x07, 0x86, 0x80, 0x93, 0x89, 0xe1, 0x9a, 0xc8, 0x3e,
+0x1d, 0x54, 0x72, 0x93, 0xc7, 0xcb, 0xcb, 0x2a, 0x22, 0x2d, 0x0f, 0x93, 0x1c, 0xf6, 0xb8, 0x1b},
+{
+0xb2, 0x64, 0x1a, 0x73, 0x19, 0xb1, 0xb1, 0x4a, 0xbb, 0x7c, 0x64, 0x45, 0x09, 0x14, 0xd3, 0x59,
+0x95, 0x61, 0x57, 0x38, 0x5f, 0x34, 0xbe, 0x99, 0xb3, 0x01, 0x20, 0xa8, 0x19, 0x23, 0x72, 0x88,
+0xc5, 0x65, 0xf4, 0x23, 0xec, 0x2b, 0x1b, 0xd5, 0x4b, 0xb5, 0x31, 0xd4, 0xe0, 0x4b, 0x54, 0x4a,
+0x11, 0x40, 0xd7, 0x7d, 0xbd, 0xe3, 0x7d, 0xa5, 0x5b, 0x91, 0x5b, 0x2d, 0x1b, 0xef, 0x34, 0xd6},
+{
+0x11, 0xe6, 0x9e, 0x1a, 0x96, 0x9e, 0xef, 0x3e, 0xaf, 0x7f, 0xc3, 0x9c, 0xf3, 0x7b, 0x4d, 0xfe,
+0x65, 0xd9, 0x21, 0xb3, 0xb3, 0xa9, 0x2a, 0x46, 0xc5, 0x36, 0x87, 0x20, 0x3e, 0xda, 0x02, 0x17,
+0xeb, 0x5c, 0x54, 0x3a, 0xbf, 0x7b, 0xa5, 0xfb, 0xf5, 0x58, 0xa8, 0x7e, 0x66, 0xd7, 0xbc, 0x6d,
+0xf1, 0x92, 0x0d, 0x68, 0x7c, 0x89, 0x8e, 0x08, 0x80, 0x6c, 0x62, 0xbc, 0xd8, 0x1f, 0x8c, 0x46},
+{
+0x0a, 0x66, 0x88, 0xb1, 0xc7, 0x85, 0x0f, 0xb4, 0x36, 0x3c, 0xbc, 0x99, 0x19, 0x3c, 0x87, 0xc5,
+0x4c, 0xb5, 0x33, 0x7f, 0x41, 0x45, 0x7b, 0x3c, 0xf8, 0x9b, 0x8c, 0x1f, 0x3c, 0xa9, 0xd3, 0x4c,
+0xb0, 0x9c, 0x09, 0x33, 0x80, 0xe3, 0xdc, 0xf8, 0x33, 0x2f, 0xdd, 0x2e, 0xd6, 0x7d, 0x16, 0x7a,
+0xb7, 0x35, 0xfe, 0x0f, 0x87, 0x89, 0x6d, 0x57, 0x5c, 0xce, 0x8a, 0xc6, 0x86, 0x03, 0xde, 0xd2},
+{
+0xdb, 0x50, 0x28, 0x23, 0xc0, 0x10, 0x29, 0x90, 0xa8, 0xbc, 0xce, 0x24, 0x8a, 0x1d, 0x38, 0xe5,
+0xac, 0xcb, 0xa3, 0x95, 0xba, 0xeb, 0x8a, 0x8d, 0x4f, 0x95, 0x79, 0xb3, 0x94, 0x33, 0xa9, 0xc6,
+0x1d, 0x11, 0x36, 0x8f, 0x6f, 0xc6, 0x8a, 0x83, 0xc6, 0xba, 0xda, 0x49, 0x8f, 0x6f, 0x83, 0x7c,
+0xb4, 0xc1, 0x03, 0xb9, 0xf2, 0xc8, 0x88, 0xaa, 0x7d, 0x73, 0x41, 0xaa, 0x72, 0x68, 0x7f, 0xb5},
+{
+0xb5, 0x77, 0x45, 0x2f, 0x16, 0x0a, 0x90, 0xfe, 0x0b, 0xfc, 0xc9, 0x85, 0x66, 0x21, 0x12, 0x0e,
+0xf5, 0xbd, 0x60, 0xf8, 0xe8, 0xef, 0x4f, 0x12, 0xeb, 0xcf, 0x4c, 0xc7, 0x0f, 0x11, 0xab, 0xfb,
+0xc5, 0x78, 0x54, 0x32, 0xeb, 0x6b, 0x9e, 0x70, 0xe6, 0x85, 0x2f, 0x46, 0xf0, 0xae, 0xb4, 0x2c,
+0x73, 0xbe, 0x11, 0x1b, 0x79, 0xa1, 0x88, 0xbb, 0x5b, 0x85, 0x7f, 0x29, 0xdb, 0xa5, 0xc3, 0xb7},
+{
+0xf4, 0xe3, 0x32, 0xe1, 0xe2, 0x0e, 0xe7, 0x94, 0x3f, 0xf5, 0x28, 0xe0, 0x5f, 0x2f, 0xfc, 0x9d,
+0xc4, 0x67, 0xad, 0xf2, 0x16, 0x64, 0xab, 0xae, 0xd0, 0x95, 0x10, 0x1f, 0x09, 0x10, 0x9d, 0xd4,
+0x5e, 0xec, 0xe2, 0xa4, 0x12, 0x8e, 0x0c, 0xc2, 0x1a, 0xa2, 0x94, 0x4c, 0x73, 0xbc, 0x42, 0x38,
+0xa7, 0x30, 0xca, 0x71, 0xf6, 0x53, 0xbf, 0x59, 0x35, 0xc1, 0x35, 0x7a, 0x96, 0xc7, 0x87, 0xe0},
+{
+0x2f, 0x95, 0xdb, 0x69, 0x39, 0x1c, 0xa2, 0x20, 0x0f, 0x33, 0x2d, 0x98, 0x90, 0xe5, 0x55, 0x07,
+0x4e, 0x6b, 0xf7, 0x41, 0x0f, 0x26, 0xac, 0x93, 0xd0, 0x6d, 0x60, 0x80, 0x68, 0x41, 0x6f, 0x40,
+0x00, 0xc8, 0x44, 0xc7, 0xe2, 0x94, 0x2e, 0x79, 0x37, 0x8c, 0x61, 0x74, 0xa0, 0x07, 0xb1, 0xb5,
+0xd5, 0xe3, 0x65, 0xbe, 0x89, 0x4e, 0xbb, 0x00, 0x4c, 0xd8, 0xf0, 0xd4, 0xda, 0xa6, 0x48, 0x39},
+{
+0xf9, 0x11, 0xca, 0xe3, 0xc7, 0x3a, 0x3f, 0x10, 0x24, 0x8d, 0xef, 0xc8, 0x5f, 0x2f, 0xb7, 0x19,
+0x94, 0xca, 0x87, 0x88, 0x12, 0x59, 0x2e, 0xa1, 0x17, 0x96, 0x2d, 0x15, 0xdc, 0xd8, 0x69, 0x5f,
+0x8d, 0x0f, 0xa8, 0x59, 0xde, 0x22, 0xba, 0x82, 0x41, 0x99, 0x11, 0x90, 0x41, 0x10, 0xe5, 0x87,
+0xd5, 0x39, 0xc6, 0xd4, 0x57, 0x3c, 0x0d, 0xc6, 0x33, 0x82, 0x87, 0x3d, 0x2c, 0x02, 0x67, 0xf8},
+{
+0x04, 0x99, 0x67, 0x30, 0xbc, 0xfb, 0x2a, 0xb2, 0x25, 0x38, 0x32, 0xff, 0x46, 0x0d, 0xc1, 0x20,
+0x1a, 0x3e, 0x54, 0x9d, 0x02, 0x49, 0xa1, 0x1a, 0xd9, 0xcc, 0x7d, 0x76, 0x3a, 0x5f, 0xc1, 0x83,
+0x5a, 0xab, 0x5b, 0x67, 0x68, 0x2b, 0xa7, 0xcc, 0x24, 0xba, 0x7d, 0xc6, 0xcd, 0x3c, 0x79, 0x2e,
+0x79, 0x19, 0x57, 0x51, 0x13, 0x55, 0x2f, 0x58, 0xc9, 0x13, 0x6a, 0x63, 0xfb, 0xbe, 0xaa, 0xb8},
+{
+0x7a, 0x9f, 0x2e, 0xfe, 0x99, 0xc7, 0x4f, 0xd7, 0x77, 0x8e, 0x56, 0xb9, 0x29, 0x45, 0xa6, 0x45,
+0xd9, 0x92, 0x1c, 0x30, 0x0b, 0xd8, 0x81, 0xdf, 0x53, 0xdc, 0x70, 0xe5, 0xf6, 0xf4, 0x2f, 0x65,
+0xe9, 0x93, 0x85, 0x17, 0x00, 0xd3, 0x6f, 0xee, 0x75, 0x3d, 0x60, 0xf3, 0xe2, 0xde, 0x4e, 0xfa,
+0x37, 0xb5, 0xc5, 0xc3, 0x5c, 0x24, 0x5a, 0xb1, 0x06, 0x80, 0x29, 0xc2, 0xd3, 0x9e, 0x3a, 0xd0},
+{
+0xf4, 0x8b, 0x90, 0x8d, 0xae, 0xcf, 0xd1, 0x33, 0x43, 0xff, 0x21, 0x2b, 0x49, 0xbc, 0xda, 0xfa,
+0xc1, 0xf4, 0x90, 0xdf, 0x5e, 0xff, 0xa2, 0xdd, 0x7c, 0xc3, 0x69, 0x70, 0x2e, 0x0c, 0xa8, 0x8c,
+0x1c, 0x21, 0x78, 0x3a, 0x40, 0xd7, 0x7a, 0xa4, 0x7d, 0x1d, 0xe2, 0x0c, 0x26, 0xd7, 0x6e, 0x8c,
+0x1b, 0xa0, 0xec, 0xc2, 0x3c, 0xc6, 0x73, 0xd5, 0x9a, 0x59, 0xc3, 0x34, 0xfc, 0x42, 0x22, 0x9b},
+{
+0xea, 0xef, 0x3c, 0x91, 0xe2, 0x61, 0x3c, 0x5a, 0x1c, 0x54, 0xe3, 0xb4, 0x40, 0xde, 0x05, 0x33,
+0x98, 0xf8, 0x44, 0xba, 0xd8, 0x6f, 0xa2, 0x9c, 0x3d, 0xdf, 0x0c, 0xf6, 0xfe, 0x08, 0x62, 0x2c,
+0x3d, 0xd3, 0xbf, 0xd6, 0x64, 0x1f, 0xa8, 0xf4, 0xbd, 0x1f, 0xd9, 0x7e, 0xeb, 0x0b, 0xfc, 0xcc,
+0xb6, 0x3c, 0xde, 0x06, 0x2e, 0x54, 0x41, 0x45, 0x1d, 0xdf, 0x76, 0xce, 0xca, 0xd5, 0xfd, 0xb7},
+{
+0xf7, 0x7e, 0x1c, 0xca, 0x2b, 0x03, 0xbb, 0xb0, 0x60, 0x94, 0x69, 0x3c, 0xa7, 0x6b, 0x6f, 0x27,
+0x29, 0x1e, 0x96, 0x7b, 0xb1, 0x5c, 0x67, 0xe9, 0xb1, 0xf5, 0xaa, 0xc5, 0xc2, 0x6d, 0xbd, 0x96,
+0xb1, 0x1a, 0xe9, 0xcb, 0x11, 0x2c, 0xb9, 0xfd, 0xe8, 0x27, 0x4e, 0x68, 0xc5, 0xdd, 0x1f, 0x5b,
+0xb7, 0x49, 0x83, 0xed, 0xf2, 0x46, 0x9b, 0x3a, 0x63, 0xa3, 0xc7, 0xd3, 0xa7, 0x38, 0x4e, 0xab},
+{
+0x08, 0xbb, 0x58, 0x66, 0x72, 0x0a, 0x9e, 0x9a, 0x7b, 0x60, 0x89, 0xc5, 0x2a, 0x5f, 0x3c, 0xe2,
+0xc8, 0xb4, 0xbf, 0xf2, 0x14, 0xca, 0x48, 0xa0, 0x91, 0x22, 0x2c, 0xc6, 0x89, 0x0f, 0x9a, 0x4d,
+0x94, 0x72, 0x82, 0x0f, 0x31, 0x5f, 0x7b, 0x42, 0xcd, 0x35, 0x2c, 0x9f, 0xb5, 0xa8, 0xa7, 0x1e,
+0x0f, 0xc0, 0xa3, 0x85, 0x56, 0x2e, 0x44, 0x95, 0x5a, 0x97, 0x57, 0x9b, 0x21, 0x31, 0xb8, 0x8c},
+{
+0x67, 0xcf, 0xf5, 0x51, 0xda, 0xf0, 0x33, 0x43, 0xcb, 0xd3, 0xf0, 0xf4, 0x7c, 0xa4, 0x3e, 0x6d,
+0x1f, 0x83, 0x5a, 0xa0, 0x14, 0xda, 0x2f, 0x44, 0x81, 0x3e, 0x6d, 0x01, 0x13, 0x60, 0x49, 0x6a,
+0x48, 0x0f, 0x2e, 0xe5, 0x8c, 0x31, 0x47, 0xf6, 0xf1, 0x5f, 0x0d, 0x4a, 0x6e, 0xa6, 0xf3, 0x5f,
+0xa8, 0x9b, 0x19, 0x61, 0x1a, 0xd8, 0x6e, 0x04, 0x3a, 0xc2, 0x79, 0x3e, 0x08, 0xdf, 0x8e, 0x57},
+{
+0x7b, 0xf3, 0xc6, 0x86, 0xa0, 0xb8, 0x7d, 0x69, 0x6d, 0x66, 0xc6, 0xb2, 0x88, 0x8f, 0x20, 0x8b,
+0xaa, 0xe3, 0x19, 0xc5, 0xb5, 0x5a, 0x72, 0xd1, 0xc2, 0xcb, 0x26, 0xfe, 0xb9, 0x2a, 0x63, 0xc1,
+0xaa, 0x31, 0xca, 0x43, 0xf8, 0x48, 0x40, 0xcc, 0x4d, 0x0a, 0x3c, 0x6d, 0x20, 0x4e, 0xeb, 0xf4,
+0xf6, 0x2d, 0xd7, 0xcd, 0xdf, 0x1b, 0xb4, 0x82, 0xf1, 0x01, 0x64, 0x7d, 0x2a, 0x74, 0xb5, 0x78},
+{
+0xa3, 0x45, 0x80, 0xee, 0xa5, 0xc2, 0xba, 0x94, 0x6b, 0x07, 0xd1, 0x9f, 0x95, 0x82, 0x49, 0xa4,
+0x59, 0x79, 0x51, 0x4b, 0x9b, 0x99, 0xe3, 0xa0, 0x9c, 0x71, 0x31, 0x83, 0x86, 0x7f, 0xe8, 0xab,
+0x5b, 0x6c, 0xf5, 0x96, 0x37, 0xe0, 0x44, 0x6b, 0x84, 0x1e, 0xfe, 0x9d, 0xad, 0x40, 0xed, 0x9b,
+0x0e, 0xe8, 0xe8, 0x6f, 0x04, 0xb9, 0x1a, 0x79, 0x5c, 0xf1, 0x96, 0xdb, 0xae, 0xa9, 0x5b, 0x50},
+{
+0xa7, 0x1e, 0xa0, 0x3e, 0xf8, 0x96, 0xf9, 0xb8, 0x15, 0xbb, 0x97, 0x74, 0x33, 0x5d, 0x04, 0xc0,
+0x7c, 0x64, 0x05, 0x62, 0xc9, 0x9d, 0x74, 0xc4, 0xc9, 0x22, 0xfd, 0x0e, 0x54, 0x60, 0x94, 0xd8,
+0xd5, 0x4a, 0x77, 0x12, 0x09, 0xcb, 0x2d, 0x06, 0x3a, 0x6e, 0xe0, 0x8b, 0x10, 0xf3, 0x13, 0xcb,
+0xa9, 0xe1, 0x5d, 0x23, 0x35, 0x1d, 0x28, 0xca, 0x5c, 0x64, 0xc3, 0x69, 0x12, 0x74, 0x8a, 0xaf},
+{
+0xe2, 0xb1, 0xb8, 0xbe, 0x5f, 0xca, 0x08, 0x88, 0x76, 0xda, 0x0d, 0xea, 0x04, 0xb2, 0x62, 0x02,
+0x6b, 0x35, 0xeb, 0xdd, 0xfc, 0xff, 0xff, 0xb6, 0x70, 0x38, 0xb8, 0xfb, 0x3a, 0x25, 0xde, 0x52,
+0xea, 0x21, 0x8d, 0x8f, 0xc0, 0x40, 0x1f, 0x96, 0xed, 0x03, 0x2f, 0x00, 0x78, 0x62, 0x68, 0x89,
+0xea, 0x21, 0xe4, 0x38, 0xd7, 0x34, 0xf8, 0x0f, 0xdb, 0xb8, 0x6f, 0xd3, 0x6f, 0x0d, 0x27, 0x3a},
+{
+0x3d, 0x42, 0xb8, 0xb7, 0xb1, 0x0c, 0x97, 0x86, 0x82, 0xe8, 0x9e, 0xd0, 0xf0, 0x8a, 0x55, 0x70,
+0x50, 0x09, 0xb5, 0x20, 0x5f, 0xa4, 0xa7, 0xaf, 0x26, 0x52, 0x2c, 0x45, 0xb7, 0x86, 0xbb, 0xf2,
+0xc0, 0xc9, 0xad, 0xc6, 0x12, 0x90, 0x8d, 0x88, 0x33, 0x62, 0x3f, 0x5e, 0x16, 0xc1, 0x33, 0xff,
+0x92, 0xea, 0x08, 0x5d, 0xaf, 0xd7, 0xae, 0x17, 0x4e, 0x9b, 0xe0, 0x81, 0x1e, 0x28, 0xb0, 0x12},
+{
+0x37, 0x1d, 0x6e, 0x08, 0x91, 0x1a, 0x1e, 0x28, 0x3e, 0xdf, 0x76, 0xae, 0x5a, 0xd7, 0xad, 0x12,
+0x0f, 0xd4, 0x49, 0x72, 0x5e, 0x94, 0x01, 0x92, 0x28, 0xbb, 0xe9, 0xd8, 0x01, 0x44, 0xdb, 0x11,
+0x0e, 0x42, 0x42, 0x5b, 0xc6, 0x1f, 0x09, 0x44, 0xd1, 0x5b, 0x5b, 0x73, 0x61, 0xa7, 0xe0, 0x3f,
+0xdd, 0x9d, 0xe8, 0x16, 0x69, 0x68, 0x7c, 0x29, 0x3d, 0xed, 0xe6, 0x06, 0x11, 0x55, 0x1a, 0xa0},
+{
+0xcd, 0x37, 0xa3, 0x39, 0x2f, 0x3d, 0x91, 0xd0, 0x22, 0xe2, 0x6f, 0x14, 0xa3, 0x65, 0x9e, 0x61,
+0x44, 0xaa, 0x81, 0xdd, 0x17, 0xa2, 0xc6, 0xb9, 0xc7, 0x09, 0xb9, 0xd0, 0x37, 0x28, 0x16, 0xaf,
+0x2f, 0x24, 0xdf, 0xb3, 0xfa, 0xf0, 0xbd, 0x57, 0xca, 0xab, 0x0e, 0xb4, 0x73, 0xab, 0xf6, 0x02,
+0xc5, 0xea, 0x2e, 0x36, 0xfb, 0xc9, 0x0a, 0xff, 0x47, 0x0f, 0xf1, 0x34, 0xb6, 0x65, 0x4b, 0x49},
+{
+0xe3, 0xd6, 0xdc, 0x90, 0x17, 0x4d, 0xc9, 0xe9, 0x0c, 0x8c, 0x26, 0x81, 0xd4, 0xe2, 0xb9, 0x1d,
+0xa7, 0x96, 0xed, 0x56, 0x15, 0x5d, 0x64, 0x80, 0xbb, 0x47, 0xda, 0x55, 0x4f, 0x4f, 0x17, 0x02,
+0xc1, 0x6d, 0xfd, 0x5d, 0xce, 0x52, 0xb3, 0xf6, 0xf8, 0x0e, 0xbf, 0x65, 0x4a, 0x44, 0x35, 0x3c,
+0x62, 0x35, 0x33, 0xff, 0x40, 0x4c, 0x16, 0x26, 0x2f, 0x3d, 0xd6, 0xe9, 0x7b, 0x32, 0xb1, 0x07},
+{
+0xf8, 0x34, 0x74, 0xd4, 0x38, 0xcc, 0xa9, 0x9c, 0x89, 0x2a, 0xdb, 0xca, 0x19, 0x09, 0x30, 0x68,
+0x44, 0xbb, 0xba, 0x05, 0xb8, 0xbb, 0x93, 0x69, 0xa1, 0x81, 0xa3, 0xeb, 0x60, 0x6a, 0x4e, 0xb3,
+0x50, 0x80, 0x05, 0xf4, 0xea, 0xe2, 0x32, 0x92, 0x24, 0x16, 0x6a, 0xd5, 0x66, 0x7a, 0x8d, 0x86,
+0x81, 0x7e, 0xd1, 0xca, 0xb5, 0x61, 0x66, 0x96, 0x03, 0xf0, 0xa6, 0xaa, 0x68, 0x1c, 0xc6, 0xa1},
+{
+0x61, 0x63, 0x3c, 0x27, 0x72, 0xe9, 0x6f, 0xa3, 0x22, 0x70, 0xf1, 0xa8, 0xc7, 0x8d, 0x56, 0xed,
+0xae, 0xd8, 0xd9, 0x8e, 0x2d, 0x72, 0x8e, 0xdf, 0x1b, 0xe1, 0x19, 0x0b, 0xee, 0x0f, 0x9c, 0x25,
+0x1a, 0x30, 0x4d, 0x6d, 0x81, 0x17, 0xbc, 0x0b, 0x0a, 0xee, 0x18, 0x72, 0xd0, 0x8b, 0x2b, 0x84,
+0xfe, 0xcb, 0xeb, 0x4f, 0x43, 0xff, 0xe3, 0x6b, 0xe4, 0x57, 0x52, 0x17, 0x9d, 0x32, 0x6d, 0xb7},
+{
+0xe0, 0x3b, 0x80, 0x5b, 0xd0, 0xa9, 0xdd, 0xd0, 0x9f, 0xa7, 0xe5, 0xd8, 0xb7, 0xee, 0xd9, 0x0a,
+0x35, 0xfd, 0xdf, 0x05, 0x64, 0xc3, 0x21, 0x2e, 0xe7, 0x27, 0x61, 0x4e, 0x93, 0x6c, 0x59, 0x52,
+0x68, 0xf9, 0x4b, 0x0d, 0xb1, 0x64, 0x69, 0x22, 0xf4, 0x5b, 0xdd, 0xd9, 0x89, 0x7a, 0xb4, 0xd0,
+0xe3, 0x5a, 0x81, 0x47, 0xa5, 0x63, 0x72, 0xff, 0x2b, 0x6e, 0xa3, 0xa9, 0xb1, 0x82, 0xdb, 0x57},
+{
+0x11, 0xc9, 0x3c, 0xa6, 0x8e, 0x57, 0x9e, 0xd8, 0xc0, 0xf7, 0x9b, 0xbc, 0x24, 0x80, 0x6e, 0x8b,
+0x51, 0xb9, 0x70, 0x28, 0x37, 0x46, 0x8d, 0xe3, 0x1d, 0x67, 0x0f, 0x39, 0x44, 0x9a, 0xe5, 0xcb,
+0x65, 0x8f, 0xea, 0x58, 0x00, 0x10, 0x61, 0x87, 0xea, 0x9d, 0x5c, 0xe6, 0x57, 0x78, 0xd2, 0x94,
+0xfb, 0x78, 0xd4, 0xc3, 0x0a, 0xfc, 0xa6, 0xd9, 0x6a, 0x65, 0xf8, 0xc5, 0x0a, 0x4a, 0xf6, 0xe5},
+{
+0x22, 0xba, 0x25, 0xd2, 0x08, 0xa3, 0x0c, 0xe0, 0x3b, 0x96, 0x8b, 0x8b, 0xf2, 0x4c, 0x28, 0x40,
+0xbf, 0xd1, 0x56, 0x23, 0xeb, 0x07, 0xc4, 0xf7, 0x56, 0xe5, 0x17, 0xcb, 0x80, 0x93, 0xa2, 0xb4,
+0xf7, 0xe0, 0x51, 0xb0, 0x65, 0xe2, 0xe5, 0x26, 0x13, 0x58, 0x2f, 0x2f, 0xbc, 0x3f, 0x98, 0x7e,
+0x70, 0xbf, 0xda, 0x91, 0xc2, 0xf6, 0x95, 0x98, 0xd3, 0xd4, 0x90, 0xf0, 0x71, 0x10, 0xd8, 0x02},
+{
+0x7e, 0xab, 0x84, 0x6e, 0x28, 0x87, 0xbc, 0x7d, 0xc3, 0xc7, 0x97, 0x8f, 0x7f, 0x8b, 0x5e, 0x07,
+0x05, 0x51, 0x2d, 0x79, 0xee, 0x5b, 0x4d, 0xc1, 0x69, 0x46, 0x52, 0xa9, 0x7f, 0x8d, 0xfb, 0xb5,
+0x77, 0xf2, 0x1f, 0x9e, 0xf0, 0x70, 0x0f, 0x29, 0x71, 0x50, 0x07, 0xc4, 0x1b, 0x60, 0xb4, 0x9c,
+0x32, 0x06, 0x10, 0xdc, 0x8f, 0x9b, 0xfd, 0x15, 0x0e, 0xbb, 0xf2, 0x3a, 0x7c, 0x93, 0x1a, 0x81},
+{
+0x47, 0x59, 0xb7, 0xc1, 0xa8, 0x9c, 0x00, 0x9e, 0xf4, 0x5b, 0x73, 0x62, 0x73, 0x8f, 0x30, 0xe4,
+0xb3, 0x0b, 0x92, 0x5f, 0xc5, 0xd4, 0xa6, 0x26, 0xe3, 0x96, 0x16, 0xd7, 0x52, 0xb1, 0x32, 0xe5,
+0x02, 0xaf, 0xd4, 0xaa, 0x69, 0xef, 0x1b, 0xa5, 0x67, 0x95, 0x28, 0xeb, 0xbe, 0x5a, 0xa5, 0x84,
+0xc9, 0x87, 0xe9, 0xe2, 0xfc, 0xb0, 0x6e, 0xfa, 0xdc, 0x6b, 0xf6, 0x14, 0xa0, 0x65, 0x8d, 0xad},
+{
+0x64, 0x3b, 0x65, 0x3b, 0x16, 0xc2, 0xf7, 0x2f, 0x80, 0x9f, 0x8f, 0x8e, 0xb8, 0x22, 0xa7, 0x4a,
+0xc6, 0x5c, 0xd4, 0x2f, 0x84, 0xd0, 0x67, 0x5e, 0x73, 0x33, 0x37, 0x8b, 0xf5, 0x6b, 0x8c, 0x58,
+0x15, 0x24, 0xbf, 0x7e, 0x67, 0x3c, 0xb5, 0xe0, 0x0f, 0xe8, 0x97, 0xd9, 0xae, 0x7f, 0x6c, 0x5e,
+0x57, 0x4d, 0x03, 0xa8, 0xfc, 0x01, 0x15, 0xae, 0xf9, 0x74, 0x6c, 0x87, 0xdd, 0x9a, 0x22, 0xaa},
+{
+0x46, 0xdd, 0x61, 0x6f, 0xf9, 0x09, 0xa0, 0x5e, 0x29, 0x02, 0x76, 0x5d, 0x70, 0x3f, 0x8c, 0xec,
+0x58, 0x42, 0x0c, 0x88, 0xbd, 0x96, 0x9f, 0x13, 0xa8, 0x7e, 0xad, 0xc2, 0x75, 0x66, 0x61, 0x83,
+0x30, 0x76, 0x10, 0x85, 0x39, 0xfc, 0x34, 0xcb, 0x88, 0x44, 0x73, 0x88, 0x1a, 0x62, 0x0d, 0xf1,
+0x57, 0xb4, 0x2f, 0x51, 0x45, 0x88, 0xa5, 0x6b, 0x02, 0xe4, 0xd6, 0x3e, 0xa5, 0x51, 0x54, 0xc2},
+{
+0xce, 0xd8, 0x6a, 0xca, 0xbb, 0x63, 0x9b, 0x47, 0x47, 0x42, 0xa3, 0x1e, 0x0f, 0xaf, 0x96, 0x47,
+0x06, 0xfc, 0xc9, 0x76, 0x7a, 0xb4, 0xd3, 0xa9, 0xf7, 0x5e, 0xf7, 0xf5, 0xa6, 0x8b, 0xce, 0xd7,
+0x64, 0x7a, 0xe7, 0x80, 0x0c, 0xeb, 0x48, 0x55, 0x96, 0x57, 0xee, 0x83, 0x2e, 0xb9, 0x2a, 0xcd,
+0x50, 0x93, 0x93, 0xcf, 0x69, 0xd7, 0x59, 0x5e, 0x18, 0xf2, 0x4a, 0x42, 0x53, 0x2a, 0x4c, 0x5e},
+{
+0xcf, 0x63, 0x89, 0x1c, 0x9e, 0x06, 0x06, 0xcd, 0xe9, 0x47, 0xe5, 0x6f, 0x5b, 0xc1, 0x82, 0x7a,
+0x91, 0x13, 0xb3, 0x6e, 0x0b, 0x03, 0x1d, 0xf8, 0x81, 0x8b, 0x94, 0x08, 0x04, 0x09, 0x94, 0x8c,
+0x06, 0x22, 0x92, 0x06, 0x41, 0x0c, 0x9d, 0x5a, 0x2f, 0xa4, 0x56, 0xcf, 0x1b, 0x16, 0xaf, 0x85,
+0x00, 0x64, 0x78, 0x0f, 0x2a, 0xc9, 0xe5, 0x5d, 0xf5, 0x49, 0x0b, 0x7c, 0x84, 0x14, 0x1f, 0x6a},
+{
+0x0f, 0x73, 0xcf, 0x6d, 0xdc, 0x19, 0x3d, 0x07, 0x22, 0x70, 0x0c, 0xad, 0x1f, 0x25, 0xfb, 0xd8,
+0xd1, 0xe1, 0x19, 0x52, 0x65, 0x65, 0x33, 0x69, 0x32, 0xe3, 0xdd, 0xfb, 0x28, 0x10, 0x9b, 0x0d,
+0x61, 0x16, 0x50, 0x5e, 0x11, 0x48, 0xa6, 0x95, 0xd8, 0x6f, 0x42, 0x12, 0xb0, 0x2d, 0x8d, 0x4d,
+0x4a, 0xeb, 0x62, 0x17, 0x24, 0x3b, 0x14, 0xe0, 0x8d, 0x17, 0x24, 0x2c, 0xe1, 0xb9, 0x15, 0xb6},
+{
+0x86, 0x3c, 0x70, 0x79, 0xdb, 0xa5, 0xd5, 0xed, 0xc3, 0xe5, 0x84, 0xfc, 0xa6, 0x3d, 0xb0, 0x34,
+0x24, 0x7c, 0xe6, 0x71, 0x5b, 0x63, 0x2c, 0x7e, 0x15, 0xce, 0x3b, 0xac, 0xf5, 0xb9, 0x57, 0xd3,
+0x21, 0x67, 0x40, 0x4a, 0x05, 0xfa, 0x89, 0xa3, 0x6c, 0xae, 0x9e, 0xdb, 0x5d, 0x16, 0x4c, 0x03,
+0x66, 0xf4, 0x97, 0x2a, 0x2f, 0x41, 0x9f, 0xb0, 0x90, 0xb4, 0x6d, 0xb0, 0x8a, 0xe2, 0x50, 0x7c},
+{
+0x12, 0x7b, 0xf8, 0x23, 0x62, 0xad, 0xec, 0xfc, 0x23, 0x08, 0xda, 0x68, 0x1e, 0x04, 0x3a, 0x23,
+0xad, 0xde, 0x72, 0x40, 0x52, 0x54, 0x18, 0x25, 0x56, 0xa6, 0x4d, 0x42, 0xbe, 0xb7, 0xfd, 0xfb,
+0xcf, 0x4f, 0x31, 0x65, 0x2a, 0x0d, 0x66, 0xb9, 0x7d, 0x6d, 0x5f, 0x54, 0x58, 0xd3, 0xb3, 0x2c,
+0x94, 0x6a, 0xae, 0xc7, 0xd8, 0x65, 0xbb, 0x2c, 0x67, 0x09, 0x22, 0xbd, 0xd4, 0x31, 0xa7, 0xf7},
+{
+0xce, 0x80, 0xb1, 0xc2, 0x95, 0x05, 0x09, 0xbe, 0x13, 0xd9, 0x32, 0x83, 0x76, 0xbd, 0x60, 0x4c,
+0x49, 0x6f, 0xac, 0xe8, 0x1d, 0x57, 0xa8, 0x52, 0xb4, 0xbb, 0x85, 0xda, 0x3b, 0x61, 0xf2, 0xc4,
+0x2e, 0x58, 0x81, 0xab, 0x74, 0x31, 0xdd, 0x70, 0xe4, 0xe9, 0x81, 0x33, 0xe6, 0xa5, 0xcb, 0xb2,
+0x37, 0x08, 0x77, 0xa6, 0x2d, 0x74, 0x22, 0x05, 0x93, 0x25, 0x82, 0x0f, 0x0e, 0xbb, 0x63, 0x5b},
+{
+0x2c, 0x55, 0x0c, 0x51, 0x89, 0x8e, 0xee, 0x7d, 0x1e, 0x0b, 0xba, 0xdc, 0xc4, 0xe3, 0x46, 0x21,
+0x89, 0x41, 0x87, 0x37, 0xbb, 0x33, 0xed, 0x14, 0xe8, 0x1b, 0x65, 0x2e, 0x40, 0x4e, 0x5a, 0x50,
+0x5e, 0x42, 0x4d, 0x0a, 0xe3, 0x00, 0xd4, 0x76, 0x83, 0x1f, 0xd4, 0xda, 0x3f, 0xbc, 0x5e, 0x81,
+0xc2, 0x1c, 0x0b, 0x2e, 0x5c, 0x7b, 0xf0, 0x3a, 0xe6, 0xb0, 0xad, 0x84, 0x10, 0xed, 0xce, 0x61},
+{
+0xdc, 0x04, 0xa2, 0x47, 0xdb, 0x9b, 0xdd, 0x4f, 0x2d, 0x93, 0xdc, 0xb1, 0x96, 0x4d, 0xd8, 0x15,
+0x5f, 0xb4, 0x9c, 0x8c, 0x75, 0x39, 0x04, 0xa6, 0xca, 0xda, 0x5d, 0xba, 0x8e, 0x76, 0xa1, 0xd1,
+0xba, 0x2d, 0x92, 0x56, 0x84, 0xc4, 0x58, 0x26, 0xb1, 0x97, 0x45, 0xa7, 0x76, 0x29, 0x04, 0x2f,
+0x51, 0x06, 0x84, 0xe8, 0xd3, 0x1c, 0xf2, 0x06, 0x7e, 0x14, 0xf0, 0xc7, 0x08, 0x46, 0x07, 0x0d},
+{
+0x8f, 0x26, 0x11, 0xbf, 0x21, 0x64, 0xd8, 0xf1, 0xb2, 0x5c, 0x1e, 0x62, 0x52, 0x0a, 0xc1, 0xe5,
+0xd5, 0xd1, 0xf0, 0x4e, 0x3e, 0x93, 0xbf, 0x68, 0x96, 0xd3, 0x2a, 0x2d, 0x40, 0x0e, 0xdb, 0x74,
+0x82, 0xf2, 0xc3, 0xb2, 0x7b, 0x52, 0xb2, 0x41, 0x25, 0xb2, 0x84, 0xc3, 0xcc, 0xed, 0x5e, 0x0e,
+0x09, 0xb9, 0xe7, 0x7e, 0x84, 0xb7, 0xf7, 0x22, 0x03, 0x9e, 0x2e, 0x40, 0x32, 0x96, 0x6d, 0x1a},
+{
+0x19, 0xf1, 0x4d, 0xe7, 0x15, 0x21, 0x02, 0x5e, 0x3a, 0x90, 0xd9, 0x61, 0x5e, 0x6c, 0xdc, 0x65,
+0xa7, 0x12, 0x41, 0xff, 0xf0, 0xac, 0x40, 0x56, 0x19, 0xda, 0x72, 0x02, 0x91, 0x0c, 0xde, 0x11,
+0xbc, 0xc4, 0x22, 0xa2, 0x0a, 0x81, 0x3b, 0x9d, 0x4b, 0xf2, 0x5f, 0x11, 0x44, 0xb7, 0xb0, 0x6a,
+0xdb, 0xe2, 0xe1, 0x98, 0x88, 0xef, 0x4d, 0x11, 0xce, 0x8e, 0xc3, 0x59, 0xcf, 0x86, 0xf1, 0xfe},
+{
+0xeb, 0x56, 0xf9, 0xf7, 0x89, 0xa3, 0xef, 0x84, 0xe8, 0xc3, 0x40, 0xeb, 0xf3, 0xb8, 0xb8, 0xe1,
+0x8d, 0x68, 0xb4, 0xc2, 0xd6, 0x47, 0x2f, 0x22, 0x16, 0x04, 0x78, 0x13, 0xf8, 0xab, 0x24, 0x86,
+0x04, 0xf0, 0x78, 0x70, 0x87, 0xc1, 0xf8, 0x3e, 0x7f, 0x57, 0x93, 0xcb, 0xdb, 0xf2, 0x7c, 0xad,
+0x4d, 0x34, 0x3f, 0x57, 0xed, 0x7e, 0xbf, 0x44, 0x1b, 0x6b, 0x9f, 0xec, 0x49, 0x87, 0x26, 0x34},
+{
+0xe0, 0x47, 0x4b, 0x3c, 0x74, 0x34, 0x23, 0xa8, 0x5b, 0x93, 0x38, 0x84, 0xf5, 0x02, 0x15, 0x84,
+0xcf, 0x91, 0x58, 0x59, 0x63, 0xe3, 0x93, 0x67, 0x31, 0xf4, 0x66, 0x27, 0x61, 0x19, 0x56, 0x5a,
+0x26, 0x27, 0xfa, 0xa2, 0x70, 0xae, 0xa1, 0xae, 0xd8, 0xec, 0xa7, 0xa8, 0xf8, 0x2b, 0x96, 0xf1,
+0x3a, 0x6a, 0xd2, 0x03, 0x30, 0x06, 0x0d, 0xac, 0xc1, 0x3b, 0x3b, 0x4c, 0xe8, 0xd6, 0x06, 0xa5},
+{
+0x22, 0x2b, 0xc8, 0x3a, 0x1e, 0xa8, 0xde, 0x62, 0x53, 0xa0, 0xfc, 0x8e, 0x81, 0xcf, 0x70, 0xfc,
+0x43, 0xe8, 0x65, 0x31, 0x8d, 0xab, 0xce, 0x7c, 0x23, 0xe3, 0x76, 0x91, 0xb7, 0x10, 0x28, 0xa3,
+0x9d, 0x54, 0x3d, 0xb6, 0x8b, 0xb4, 0x37, 0x45, 0xf6, 0x3f, 0xb0, 0x4d, 0x18, 0x0e, 0x96, 0x73,
+0xf5, 0xe6, 0x25, 0x09, 0xa6, 0x55, 0xeb, 0x2d, 0xd1, 0x75, 0x65, 0x62, 0x6b, 0xb3, 0x6b, 0x45},
+{
+0x68, 0x34, 0x3e, 0x76, 0xe8, 0x99, 0x50, 0x2e, 0x29, 0x5e, 0x90, 0x78, 0xbd, 0xde, 0xdb, 0xde,
+0x55, 0x8f, 0xf2, 0xe6, 0x4e, 0xdb, 0xc9, 0xed, 0xeb, 0xd9, 0x5c, 0x48, 0x8a, 0x7b, 0x06, 0xb8,
+0x55, 0x4d, 0x9c, 0xc6, 0x36, 0xf3, 0xa9, 0xc8, 0xaa, 0x28, 0xbc, 0x5f, 0xac, 0xe0, 0xd9, 0x5f,
+0xfa, 0xb9, 0x82, 0xd4, 0xfc, 0x26, 0xe8, 0x56, 0x65, 0xd2, 0xcd, 0x05, 0xc1, 0xd1, 0x9a, 0x67},
+{
+0x1c, 0x38, 0x85, 0x82, 0x3c, 0x39, 0xb7, 0xa8, 0xc6, 0x6a, 0x59, 0x60, 0x32, 0x27, 0xfe, 0xf1,
+0x52, 0xd1, 0x7c, 0x38, 0xe4, 0x0e, 0xdc, 0x9f, 0xe0, 0x95, 0x05, 0xc1, 0x6b, 0x03, 0x14, 0x6c,
+0x6c, 0x81, 0x53, 0xbb, 0xe4, 0x63, 0x03, 0x13, 0xd1, 0x38, 0x7e, 0x0c, 0x26, 0x25, 0x02, 0x12,
+0x14, 0x42, 0xef, 0x9b, 0x1b, 0x55, 0xe5, 0x92, 0xa9, 0xf4, 0xe1, 0xa7, 0x9c, 0xf1, 0xe8, 0x65},
+{
+0x34, 0xb6, 0x22, 0x7e, 0xd5, 0xb8, 0xf4, 0x91, 0x4d, 0x36, 0xad, 0x02, 0xe9, 0x5c, 0x59, 0xeb,
+0xdc, 0xe4, 0xaf, 0x17, 0xf4, 0x27, 0x40, 0x7f, 0xef, 0x9b, 0x6b, 0x0b, 0xd8, 0x51, 0xf3, 0x19,
+0x83, 0x93, 0x94, 0xdc, 0x28, 0xc2, 0x9f, 0x4d, 0x22, 0x88, 0xc4, 0xb7, 0x34, 0x16, 0x2f, 0xa1,
+0xe9, 0xcd, 0x43, 0x17, 0xcb, 0x25, 0x24, 0x34, 0x5f, 0x62, 0x10, 0x0c, 0x10, 0x18, 0x1e, 0x52},
+{
+0x90, 0x42, 0x1c, 0xb5, 0x50, 0x60, 0xfa, 0xe1, 0xd3, 0xd3, 0x19, 0x2b, 0x20, 0x73, 0xad, 0x5f,
+0xfb, 0x47, 0x3e, 0x91, 0xb8, 0x4c, 0x70, 0x4c, 0xfb, 0x33, 0xc3, 0x86, 0x05, 0xa9, 0x7a, 0xd5,
+0xd2, 0x99, 0x2c, 0x59, 0xca, 0x2d, 0x6c, 0xe2, 0x08, 0x8a, 0x25, 0x4f, 0xe5, 0xa5, 0x8d, 0x77,
+0x26, 0x09, 0x83, 0xbb, 0x46, 0x08, 0xb0, 0x31, 0x11, 0x9c, 0xd5, 0xf1, 0xd8, 0x3e, 0xff, 0xd4},
+{
+0xdf, 0x97, 0xbf, 0x76, 0x80, 0xb9, 0x59, 0xd4, 0x0e, 0xc6, 0x15, 0xb2, 0x52, 0x64, 0x66, 0xe1,
+0xef, 0x77, 0xc7, 0xac, 0xcb, 0x8c, 0xa3, 0xed, 0x53, 0x58, 0x10, 0xca, 0xce, 0xfe, 0xac, 0x30,
+0xbb, 0x67, 0x70, 0x3a, 0x5c, 0xe2, 0x70, 0x21, 0x01, 0xec, 0x71, 0xf0, 0xe4, 0xdc, 0x65, 0xdd,
+0xb1, 0xfa, 0x6e, 0xfd, 0x16, 0x46, 0xb0, 0xab, 0xc8, 0x23, 0x24, 0xb0, 0x9c, 0x08, 0x3b, 0xdc},
+{
+0x6c, 0x54, 0x37, 0xd6, 0x32, 0xe2, 0xa5, 0x4e, 0x08, 0x0b, 0xe5, 0x19, 0x6c, 0x88, 0xeb, 0xaf,
+0x19, 0x9e, 0x15, 0xed, 0x50, 0x0e, 0xc2, 0x8d, 0x05, 0xb6, 0x9c, 0x95, 0x0c, 0xf8, 0xcb, 0x28,
+0xa7, 0x92, 0xf8, 0xf6, 0x88, 0xfd, 0x3b, 0x3b, 0x88, 0xdb, 0x79, 0x40, 0x8b, 0xb6, 0x9c, 0x29,
+0xf7, 0xa0, 0x3c, 0xa4, 0x22, 0x7b, 0xfd, 0x42, 0xc1, 0x49, 0x18, 0xe5, 0xea, 0x4e, 0xe6, 0xd2},
+{
+0x7b, 0x2c, 0xb0, 0x17, 0xa2, 0x3d, 0xa0, 0xb9, 0x17, 0x89, 0x1b, 0x4d, 0x36, 0x5b, 0x92, 0x97,
+0x0a, 0xbb, 0xd4, 0x1b, 0x07, 0xb8, 0x20, 0x67, 0xad, 0xd8, 0xfe, 0x62, 0xc2, 0x72, 0xb8, 0xdf,
+0xf3, 0x97, 0xed, 0x52, 0xf2, 0xd7, 0x47, 0x20, 0xff, 0xe7, 0x04, 0x55, 0x2a, 0x14, 0x98, 0xc3,
+0xe8, 0x1b, 0x2a, 0xb5, 0xd2, 0x40, 0x96, 0x9e, 0x47, 0x2e, 0x40, 0xc3, 0x7f, 0xe3, 0x59, 0x73},
+{
+0xfc, 0xe4, 0x03, 0x04, 0xdd, 0x41, 0xbe, 0xea, 0x1b, 0x92, 0x23, 0xf4, 0xb2, 0x4f, 0xd6, 0xfd,
+0xa8, 0x9a, 0x64, 0xdc, 0x44, 0x09, 0x31, 0x0d, 0x99, 0xbb, 0x52, 0xe6, 0xab, 0xf1, 0x9b, 0xc3,
+0x48, 0xe4, 0x74, 0x71, 0x3f, 0x84, 0x42, 0xe6, 0xc6, 0x30, 0x4d, 0x23, 0x0f, 0x98, 0xb5, 0x15,
+0x1c, 0xb2, 0x12, 0xae, 0xd4, 0xa6, 0xd1, 0x22, 0x4a, 0xc0, 0xb3, 0x37, 0xc8, 0x2b, 0xc2, 0x2e},
+{
+0xe8, 0x65, 0x04, 0xd5, 0xdf, 0xa4, 0xae, 0xeb, 0xe9, 0x7f, 0xca, 0x5f, 0x50, 0x73, 0x25, 0x3a,
+0xc0, 0x62, 0x6d, 0xa8, 0xf3, 0xab, 0xe2, 0xd2, 0x8f, 0xc9, 0x15, 0x3c, 0xb4, 0x51, 0x0b, 0x8f,
+0x14, 0x7d, 0xf4, 0xc2, 0x9c, 0xd4, 0xea, 0x0b, 0xd4, 0xa6, 0xd0, 0x2f, 0x53, 0x8e, 0x8f, 0xf0,
+0x53, 0x9d, 0xbb, 0x13, 0xe9, 0x5d, 0x0b, 0xb1, 0x9a, 0x00, 0x79, 0x71, 0xdc, 0xcd, 0x85, 0x54},
+{
+0x8d, 0x60, 0xf1, 0x18, 0xbc, 0x49, 0xe4, 0xa4, 0xf1, 0xe2, 0x32, 0x58, 0x5a, 0xd1, 0x33, 0x26,
+0xae, 0x6d, 0x50, 0xda, 0xe9, 0xf7, 0x33, 0xb1, 0x81, 0xe7, 0xf7, 0x40, 0xc3, 0xc2, 0x4c, 0xa3,
+0x58, 0x5d, 0x82, 0x1e, 0xc9, 0xb3, 0x38, 0x05, 0xd9, 0x23, 0x22, 0x20, 0x96, 0x93, 0x62, 0x48,
+0xbf, 0x0d, 0x8e, 0x62, 0xe3, 0xac, 0x75, 0x73, 0x25, 0x13, 0xff, 0xc9, 0x65, 0x55, 0x08, 0xb9},
+{
+0x54, 0x80, 0x56, 0x7d, 0xa5, 0xd3, 0x2d, 0x8a, 0x3d, 0xd4, 0x41, 0xdb, 0xba, 0xb4, 0xf3, 0x54,
+0x81, 0xd5, 0xed, 0xb8, 0xde, 0x75, 0x71, 0x3f, 0x46, 0xe6, 0xc2, 0x1a, 0x63, 0xd9, 0xfe, 0x7a,
+0x75, 0x91, 0x51, 0x78, 0xbf, 0x1a, 0xfc, 0x29, 0x90, 0x5c, 0xb4, 0x5e, 0x2a, 0x63, 0xc5, 0xa3,
+0x67, 0x74, 0xd4, 0xa7, 0xee, 0x0a, 0xf5, 0x33, 0xb6, 0x38, 0x55, 0x14, 0xb9, 0x84, 0xd9, 0xe0},
+{
+0xf7, 0x41, 0x05, 0x64, 0x80, 0x7c, 0xd3, 0x23, 0x8e, 0xd9, 0x02, 0x31, 0xda, 0x51, 0x95, 0x40,
+0xf0, 0xae, 0xb1, 0xe0, 0xa7, 0x5a, 0xe5, 0xb2, 0x60, 0x14, 0x6f, 0xdb, 0x40, 0x02, 0xf2, 0xf5,
+0x9e, 0x17, 0xe2, 0xfc, 0x46, 0xdf, 0x8c, 0xa0, 0xaa, 0x72, 0x40, 0xc6, 0x63, 0x29, 0x74, 0x61,
+0xb0, 0xa4, 0xbe, 0xe9, 0xe4, 0x30, 0x07, 0xac, 0xa8, 0x51, 0x36, 0xa4, 0x35, 0x9b, 0xaa, 0xf6},
+{
+0x63, 0x5b, 0x06, 0x48, 0x46, 0x67, 0xe0, 0x98, 0xf4, 0x3d, 0xb8, 0x72, 0x5f, 0xd5, 0x90, 0x87,
+0xe2, 0xc3, 0xce, 0x60, 0x03, 0x4e, 0x91, 0x0d, 0x2c, 0x60, 0x93, 0xeb, 0xa4, 0x2c, 0xd8, 0x77,
+0x07, 0xc3, 0xe8, 0x3a, 0x7e, 0x5d, 0xd6, 0x32, 0xa9, 0x37, 0xe5, 0x4a, 0xc0, 0x4d, 0xe1, 0xef,
+0x4e, 0xe6, 0x2c, 0x27, 0x1b, 0xd5, 0xa9, 0xdb, 0x40, 0x89, 0x72, 0x16, 0x2c, 0xab, 0xba, 0xc2},
+{
+0xf3, 0x26, 0x88, 0xdd, 0x96, 0xea, 0x4e, 0xae, 0x40, 0xde, 0xa7, 0xa7, 0xb9, 0x6e, 0x79, 0x22,
+0xc6, 0x35, 0xb9, 0x7c, 0xfd, 0x20, 0x78, 0x92, 0x6b, 0xbb, 0xb1, 0x36, 0xba, 0xfb, 0x49, 0xa4,
+0xe6, 0xb2, 0x6c, 0x5a, 0x7f, 0xf4, 0x18, 0xbf, 0xc0, 0x73, 0xd8, 0x66, 0x2e, 0x47, 0xde, 0x31,
+0x07, 0xd7, 0xd9, 0x2a, 0x2b, 0xf2, 0x98, 0xb7, 0xe0, 0xb4, 0x22, 0x63, 0x26, 0x02, 0xe5, 0x5b},
+{
+0xed, 0x45, 0xad, 0x26, 0xd0, 0x18, 0x45, 0x80, 0x58, 0xd5, 0x5c, 0x21, 0x87, 0x5d, 0x4e, 0x27,
+0x4e, 0x3f, 0x3d, 0x3a, 0x0a, 0xbc, 0x73, 0x24, 0x72, 0x13, 0x3f, 0xc8, 0x20, 0x7b, 0xca, 0x2e,
+0x28, 0x5e, 0xcf, 0x96, 0x56, 0x13, 0x9f, 0x5e, 0x01, 0x03, 0x12, 0xd7, 0xe0, 0x3c, 0x6d, 0x30,
+0xe2, 0x33, 0x7e, 0xa2, 0x1e, 0xf8, 0xfc, 0xd6, 0x20, 0x7b, 0x6a, 0xb9, 0x5f, 0xc9, 0x09, 0xec},
+{
+0x7b, 0x86, 0x44, 0xdf, 0xc4, 0x7b, 0x39, 0x3a, 0x36, 0x80, 0x2d, 0x9f, 0xe0, 0x52, 0x22, 0x8e,
+0x45, 0x41, 0xc6, 0xa7, 0x8b, 0x8a, 0x29, 0xf1, 0xad, 0xba, 0x2c, 0x3e, 0x68, 0x22, 0x93, 0x3b,
+0x97, 0xca, 0xa4, 0x77, 0x6c, 0x2f, 0x24, 0x62, 0x47, 0x3e, 0x69, 0x46, 0xd9, 0xd0, 0x67, 0x08,
+0x80, 0x57, 0x17, 0x8e, 0x4b, 0x96, 0xce, 0x06, 0x39, 0xa5, 0x81, 0x1a, 0x7e, 0xf5, 0x16, 0x7a},
+{
+0xba, 0xb7, 0x75, 0x94, 0xf0, 0xdf, 0x4f, 0x88, 0x3d, 0x8b, 0x91, 0xe4, 0x30, 0xe7, 0x39, 0xe0,
+0xdb, 0x8c, 0x01, 0xf5, 0xed, 0x57, 0x3e, 0x3d, 0x5c, 0x78, 0x43, 0x19, 0x98, 0x96, 0x93, 0x95,
+0xfd, 0xf2, 0x24, 0x75, 0xf8, 0xab, 0xb8, 0xe9, 0x85, 0x93, 0x70, 0xc8, 0x64, 0x3f, 0x65, 0x9c,
+0x84, 0xd6, 0x9c, 0x4b, 0x6a, 0x38, 0xa0, 0x8b, 0xdd, 0x31, 0xc3, 0x88, 0x28, 0x55, 0x7e, 0x2e},
+{
+0x63, 0x1d, 0x17, 0xad, 0xff, 0xb0, 0x7f, 0xdf, 0x54, 0x78, 0xef, 0xa6, 0xb1, 0x79, 0x53, 0x0c,
+0x14, 0x50, 0xe3, 0xa6, 0x65, 0x29, 0x43, 0x30, 0xa0, 0x34, 0xce, 0x18, 0x17, 0x3a, 0xbc, 0xee,
+0xbc, 0x56, 0x10, 0xeb, 0xcf, 0xd2, 0x48, 0x38, 0xaa, 0xf4, 0x67, 0x8d, 0x02, 0xac, 0x38, 0xac,
+0xbe, 0x27, 0x14, 0x23, 0x8a, 0xa2, 0xf1, 0x21, 0x87, 0x42, 0xc7, 0x4d, 0x33, 0x39, 0x3e, 0x29},
+{
+0xe5, 0x79, 0xfe, 0xee, 0x53, 0xef, 0x0b, 0x94, 0xf3, 0x87, 0x9b, 0xbe, 0x86, 0xd2, 0x18, 0xc5,
+0x2c, 0x04, 0x33, 0x78, 0x76, 0x7c, 0x0c, 0x9e, 0x52, 0xe1, 0xfb, 0x11, 0xb5, 0x2c, 0x4e, 0x10,
+0x83, 0xec, 0xbb, 0x50, 0x0f, 0x5e, 0xd3, 0xc0, 0xcc, 0x0f, 0xcd, 0x4a, 0xbe, 0x79, 0x48, 0xee,
+0xee, 0x85, 0x60, 0x00, 0x5d, 0x0f, 0xd8, 0xc8, 0xc1, 0x1a, 0xfe, 0x72, 0x1c, 0xbc, 0x51, 0x3c},
+{
+0xdc, 0xdf, 0x28, 0xcf, 0x8c, 0xd7, 0xb8, 0x27, 0x65, 0x42, 0xf3, 0x23, 0x40, 0xf3, 0x39, 0x3c,
+0x64, 0x51, 0x3c, 0x2e, 0x10, 0xe7, 0x5f, 0xb6, 0xd8, 0x9e, 0x4c, 0xa4, 0x53, 0x49, 0xf7, 0xbb,
+0x56, 0x6f, 0x30, 0xd3, 0xdb, 0x5a, 0x67, 0x1f, 0xa8, 0xb3, 0xa7, 0x18, 0x9c, 0xbf, 0x78, 0x81,
+0x0c, 0xf5, 0x19, 0x7b, 0x35, 0x53, 0x0c, 0x35, 0xd1, 0x87, 0x28, 0x5f, 0xec, 0x59, 0xaa, 0x49},
+{
+0xf6, 0x49, 0xd3, 0x3c, 0x89, 0x82, 0x65, 0x30, 0x30, 0xe9, 0x40, 0x94, 0x45, 0x31, 0x36, 0xb5,
+0xda, 0xb3, 0xb7, 0x25, 0xac, 0x6e, 0x98, 0xf6, 0xd5, 0xdb, 0x8e, 0x2b, 0xf5, 0xad, 0x3a, 0x97,
+0x2d, 0x53, 0x6f, 0x8c, 0xa4, 0xd5, 0x29, 0x44, 0x6b, 0x3d, 0x70, 0x17, 0x50, 0x34, 0x59, 0xbb,
+0xe3, 0xa7, 0x36, 0xc5, 0x54, 0xd4, 0x15, 0xa8, 0x61, 0xd4, 0xbb, 0x63, 0x26, 0x61, 0x4b, 0x6f},
+{
+0x12, 0xcf, 0x57, 0x74, 0xe3, 0x74, 0x41, 0x77, 0x70, 0x9f, 0x84, 0xdd, 0xde, 0xcc, 0x9d, 0x14,
+0xb4, 0xfc, 0x9a, 0xcc, 0xad, 0x7c, 0x34, 0xe2, 0xa3, 0xae, 0x6b, 0xce, 0xe6, 0x59, 0xc8, 0x87,
+0x9d, 0x68, 0x22, 0x69, 0x6e, 0x98, 0x6d, 0x4c, 0x87, 0x18, 0x97, 0xf4, 0x63, 0x5e, 0x1e, 0x7f,
+0x6a, 0xab, 0x27, 0xe3, 0x10, 0xc5, 0xbe, 0x57, 0x66, 0xea, 0xd6, 0x48, 0x7d, 0x3f, 0x35, 0x4b},
+{
+0xd8, 0x6a, 0xef, 0xa8, 0xe2, 0x70, 0xc5, 0xdf, 0x1f, 0xa1, 0x4d, 0x03, 0xd8, 0xb0, 0x57, 0xac,
+0x81, 0x03, 0xe1, 0x02, 0x3d, 0xae, 0x81, 0x2d, 0x73, 0xee, 0x7c, 0x45, 0x86, 0x08, 0x0b, 0x54,
+0xc3, 0x9b, 0x3b, 0xad, 0xe5, 0x20, 0x58, 0xfa, 0x2f, 0x85, 0x2d, 0x37, 0xa6, 0x03, 0xce, 0x71,
+0x7e, 0xcf, 0x63, 0xbc, 0xd6, 0x7a, 0x4a, 0x1f, 0x0a, 0x0f, 0xfe, 0xac, 0x66, 0x4a, 0x3c, 0xef},
+{
+0xac, 0x84, 0x5f, 0xb3, 0x1d, 0x49, 0x12, 0x0b, 0xf4, 0x48, 0xb7, 0x83, 0x4c, 0xb0, 0x43, 0xa7,
+0xaa, 0x99, 0xfe, 0x34, 0xc9, 0xb5, 0x06, 0x6d, 0x02, 0x62, 0x42, 0x30, 0xf7, 0x64, 0xbb, 0x82,
+0x57, 0xcf, 0x97, 0x75, 0x84, 0x98, 0xb2, 0xe8, 0x09, 0xff, 0xd9, 0x64, 0x52, 0xa3, 0x68, 0x19,
+0x41, 0x62, 0x10, 0xae, 0x8e, 0x9e, 0x1d, 0x15, 0xa3, 0x18, 0x37, 0xfc, 0x78, 0x20, 0x5e, 0x4a},
+{
+0x6e, 0x97, 0xde, 0xb2, 0x61, 0x7f, 0x18, 0x06, 0xb6, 0xb4, 0xe4, 0xf5, 0x18, 0x9e, 0x86, 0x52,
+0xca, 0x32, 0xd3, 0x38, 0xcd, 0xfa, 0xd4, 0x74, 0xd9, 0xf8, 0xa2, 0xb3, 0xb4, 0x90, 0x1c, 0x5c,
+0x93, 0x78, 0xa3, 0xda, 0x09, 0x4d, 0x64, 0x98, 0x18, 0x98, 0xe3, 0xab, 0xa8, 0x35, 0x24, 0x68,
+0xa0, 0x53, 0x9c, 0x46, 0x17, 0x66, 0xe4, 0x17, 0x64, 0x2e, 0xdc, 0x77, 0x32, 0x96, 0x2f, 0x64},
+{
+0xf8, 0x0e, 0xad, 0x31, 0x54, 0x22, 0x5d, 0xc3, 0x77, 0x0d, 0x6e, 0x5b, 0x3e, 0x6d, 0xbc, 0xd7,
+0xcc, 0xbe, 0xa8, 0x76, 0xec, 0x69, 0xfc, 0x2a, 0x2a, 0xec, 0x12, 0xd0, 0x36, 0x87, 0x2c, 0x68,
+0x6e, 0xcf, 0xcb, 0xb5, 0x46, 0xe9, 0x5f, 0xdd, 0x01, 0xd4, 0xa3, 0x4e, 0xa9, 0xd6, 0x82, 0x27,
+0x2c, 0x5b, 0xa5, 0x9a, 0x29, 0x31, 0xe5, 0x37, 0x0e, 0xd5, 0x0d, 0xf5, 0xde, 0x8f, 0x4e, 0xdb},
+{
+0x54, 0x6c, 0x2f, 0x22, 0xc5, 0x01, 0x21, 0xad, 0x5e, 0x78, 0x74, 0xfa, 0x58, 0x7a, 0x5c, 0xb0,
+0xaf, 0xcd, 0x9b, 0x48, 0x79, 0xfa, 0x55, 0xce, 0x54, 0x8d, 0xe8, 0xff, 0xfd, 0x20, 0xf9, 0xc1,
+0x90, 0xe4, 0x65, 0x90, 0xb0, 0x3a, 0x55, 0x32, 0x74, 0x9f, 0x32, 0x35, 0xaf, 0xb9, 0x11, 0x76,
+0xc0, 0x24, 0x7b, 0xab, 0xef, 0x19, 0xdf, 0x57, 0x47, 0xc4, 0x81, 0x61, 0x49, 0x87, 0xa7, 0xb9},
+{
+0x03, 0x3e, 0x88, 0xa6, 0xad, 0x7f, 0x94, 0x04, 0x2b, 0xfc, 0x19, 0xa6, 0xba, 0x78, 0x1d, 0x7b,
+0xd7, 0xc2, 0x0f, 0x01, 0x6a, 0x5b, 0x1b, 0xe1, 0xfe, 0x7d, 0x91, 0xff, 0xbe, 0x78, 0x44, 0x63,
+0xb4, 0x99, 0xc0, 0xd8, 0x8d, 0x39, 0xe9, 0xd0, 0x90, 0x64, 0xec, 0x8d, 0xa5, 0xe6, 0x43, 0x08,
+0x97, 0x5f, 0xa4, 0x98, 0x19, 0xac, 0xf8, 0xfb, 0x94, 0x0a, 0xb9, 0x18, 0xdb, 0xb1, 0xa2, 0x3d},
+{
+0x57, 0xef, 0x2d, 0x41, 0xc1, 0x22, 0x08, 0xfc, 0x65, 0x5f, 0x5c, 0xf3, 0x61, 0x4b, 0xe2, 0xe8,
+0x34, 0x73, 0xaf, 0x34, 0x64, 0xae, 0xe7, 0x24, 0x4f, 0x89, 0x94, 0x0d, 0x07, 0x6e, 0xbe, 0x34,
+0xe8, 0xf6, 0x98, 0x9d, 0x18, 0x99, 0xaf, 0xe7, 0x51, 0xf0, 0x62, 0xe5, 0xac, 0x48, 0x81, 0xc4,
+0x31, 0x38, 0x6c, 0xa3, 0x6f, 0x9c, 0x57, 0x40, 0xaa, 0xb1, 0x6e, 0x3e, 0xca, 0x97, 0x67, 0xa0},
+{
+0x07, 0xf9, 0x30, 0x24, 0x0c, 0x3b, 0x27, 0x77, 0x18, 0x96, 0x33, 0x0a, 0xff, 0xcc, 0xd3, 0xaf,
+0xa3, 0x89, 0x5a, 0xcc, 0x24, 0x0c, 0xdc, 0x4b, 0x95, 0xcb, 0xd3, 0x17, 0x2a, 0x14, 0xa5, 0x3a,
+0x13, 0x98, 0x1d, 0x53, 0x94, 0x59, 0xad, 0x67, 0x50, 0x72, 0x5b, 0x21, 0x9c, 0xb0, 0x62, 0x68,
+0x18, 0x19, 0x0d, 0xae, 0x3e, 0x6a, 0x7c, 0x5e, 0x66, 0xac, 0xf2, 0x67, 0x33, 0xe4, 0xd9, 0x9a},
+{
+0x19, 0x8d, 0x69, 0x42, 0xe4, 0x04, 0xe2, 0xb7, 0x8c, 0x61, 0x20, 0x72, 0x86, 0x93, 0x98, 0x85,
+0x46, 0x91, 0x78, 0xeb, 0x5b, 0x7f, 0x95, 0x4c, 0xdf, 0xcd, 0x95, 0xc3, 0xb1, 0x8c, 0xdd, 0xcb,
+0xda, 0xd7, 0xbf, 0x12, 0xf8, 0x81, 0x47, 0xd9, 0xaa, 0x20, 0xf0, 0x8d, 0x11, 0xd2, 0x57, 0x6f,
+0x08, 0x13, 0x04, 0xa3, 0xf2, 0x0c, 0x13, 0x47, 0x4f, 0x60, 0x39, 0xf6, 0x95, 0x44, 0xeb, 0xd1},
+{
+0xf6, 0x19, 0x38, 0xd2, 0x16, 0xdc, 0x77, 0x48, 0xec, 0xc0, 0x4c, 0x69, 0xdf, 0xc1, 0xb9, 0x62,
+0x48, 0xb0, 0x18, 0x25, 0x1a, 0xac, 0x19, 0x38, 0x96, 0xb5, 0x55, 0xf3, 0x7b, 0xcf, 0x12, 0xb4,
+0xde, 0x96, 0xdb, 0xb6, 0xc1, 0xe8, 0x71, 0x01, 0xda, 0x2d, 0x4f, 0x9b, 0x06, 0x9d, 0x35, 0xe7,
+0x8d, 0x5e, 0xd5, 0x2c, 0x29, 0x0b, 0x12, 0x55, 0xc9, 0x13, 0x15, 0xbf, 0xd3, 0x50, 0xbb, 0xc6},
+{
+0x2a, 0x3e, 0x36, 0xeb, 0x65, 0xe3, 0x97, 0x94, 0x38, 0xf8, 0x44, 0x83, 0xdb, 0xe6, 0x8d, 0x19,
+0x2b, 0xe9, 0x79, 0xad, 0xae, 0xb4, 0x23, 0x8f, 0xfc, 0x93, 0x46, 0xf5, 0x0b, 0x74, 0x20, 0x41,
+0x4d, 0x5b, 0x1c, 0xe4, 0x13, 0x16, 0x40, 0x5b, 0x19, 0x0b, 0x2a, 0xf6, 0x56, 0x30, 0x81, 0x48,
+0x90, 0x82, 0xa6, 0xf0, 0x10, 0xd5, 0x7e, 0xf0, 0x98, 0xcf, 0x2a, 0xd5, 0x19, 0x51, 0x71, 0x83},
+{
+0xd7, 0x6f, 0xf9, 0x94, 0xd3, 0x45, 0x0b, 0xbe, 0x85, 0x71, 0x9e, 0x70, 0x66, 0xce, 0xf7, 0xde,
+0x02, 0x31, 0x6b, 0xd1, 0x08, 0x02, 0x16, 0x26, 0xe8, 0xf4, 0x3b, 0xb6, 0x22, 0xed, 0xd7, 0x2f,
+0xaa, 0xda, 0x4c, 0x23, 0x48, 0x28, 0x64, 0xa2, 0x83, 0x5e, 0x89, 0x3d, 0xb6, 0x01, 0x54, 0xd6,
+0x58, 0xeb, 0x87, 0x1d, 0x56, 0x9c, 0x39, 0x97, 0x48, 0x22, 0x3f, 0x8a, 0x64, 0x92, 0x70, 0x6d},
+{
+0x30, 0xb7, 0x54, 0x30, 0x7f, 0x7f, 0xe0, 0x8a, 0x20, 0x72, 0xeb, 0x51, 0x1f, 0x39, 0x8a, 0x15,
+0x2b, 0x17, 0x7a, 0x83, 0x7e, 0x86, 0xd4, 0xbe, 0x10, 0xa9, 0x44, 0x46, 0xa9, 0xb8, 0x11, 0x1f,
+0x26, 0x93, 0xce, 0x36, 0x3c, 0x93, 0x81, 0x4b, 0xf2, 0x06, 0x7b, 0x77, 0xb4, 0x97, 0xb2, 0x40,
+0xf1, 0xcb, 0x7e, 0x39, 0xac, 0x2f, 0x86, 0x94, 0x47, 0x66, 0xc6, 0xf3, 0x23, 0x96, 0x8a, 0x10},
+{
+0x17, 0xff, 0xcf, 0x29, 0xa0, 0x12, 0x2c, 0x04, 0x15, 0x43, 0xa8, 0x43, 0x51, 0x66, 0xcb, 0x90,
+0x91, 0x3e, 0xe2, 0xcb, 0x2d, 0xc4, 0x8b, 0xb6, 0x75, 0x49, 0x21, 0x28, 0x7d, 0x29, 0xa3, 0x43,
+0xdc, 0x14, 0x3f, 0xfb, 0x7b, 0x00, 0x35, 0x88, 0xe7, 0x27, 0x5e, 0x68, 0xc2, 0x33, 0x28, 0x15,
+0x51, 0x35, 0xa4, 0x6b, 0xeb, 0x2c, 0xa9, 0xe9, 0x4b, 0x02, 0x43, 0xb3, 0x1e, 0xa9, 0xf0, 0xd5},
+{
+0x7e, 0x43, 0x7f, 0xd3, 0x5a, 0x93, 0x8c, 0xeb, 0xe4, 0x1c, 0xd4, 0x25, 0x84, 0xa9, 0xc2, 0x52,
+0x65, 0x1f, 0x3a, 0xeb, 0xef, 0x31, 0xfe, 0xa1, 0x90, 0xc6, 0x8c, 0xb9, 0x69, 0xae, 0x06, 0xd7,
+0x9d, 0xd7, 0x7c, 0x61, 0x54, 0x37, 0xfc, 0x51, 0x67, 0x91, 0x99, 0x39, 0x3d, 0x8d, 0xbe, 0x0d,
+0x6a, 0x4c, 0x8a, 0x16, 0x61, 0x2e, 0xa0, 0xf1, 0xd5, 0xe4, 0x27, 0xfd, 0x9a, 0xa6, 0x8f, 0x26},
+{
+0xb5, 0x1a, 0x9e, 0x05, 0xf1, 0xaa, 0x21, 0xde, 0xc8, 0x2d, 0x13, 0x72, 0x15, 0x40, 0x66, 0x50,
+0x1e, 0xa2, 0xb4, 0xc4, 0xcb, 0x85, 0xdf, 0x20, 0x65, 0xed, 0x5e, 0xd8, 0xc1, 0x79, 0x73, 0x49,
+0x94, 0x04, 0x03, 0x9f, 0x65, 0x6f, 0xa8, 0x79, 0xb4, 0xec, 0xee, 0x64, 0xa4, 0x1a, 0x29, 0x21,
+0x3b, 0x7c, 0x43, 0xde, 0xc0, 0x23, 0x1d, 0x5a, 0x14, 0x8c, 0x50, 0x2c, 0xcb, 0x35, 0x59, 0xc2},
+{
+0x94, 0xb0, 0x28, 0x00, 0x7a, 0xcc, 0xce, 0x58, 0x54, 0xbc, 0xdd, 0x17, 0x87, 0x0b, 0xb2, 0x85,
+0x0c, 0x7a, 0xd8, 0xfa, 0x56, 0xa0, 0x7f, 0x3a, 0x60, 0xce, 0x66, 0xcc, 0x2c, 0xa9, 0x69, 0x1f,
+0x6c, 0x80, 0x76, 0x7b, 0x21, 0x65, 0x4f, 0x49, 0x06, 0x5f, 0xeb, 0x67, 0x8e, 0xca, 0xc5, 0x1e,
+0x14, 0x0d, 0x05, 0xaf, 0x9a, 0x04, 0x95, 0x15, 0x00, 0x9e, 0x83, 0x5a, 0x56, 0xe9, 0xab, 0x92},
+{
+0x0b, 0xdf, 0x66, 0x5a, 0xcc, 0xf2, 0xc4, 0xcf, 0xaa, 0xa1, 0x6e, 0x9c, 0x39, 0xb3, 0x6b, 0x2a,
+0xa7, 0x00, 0xcd, 0x33, 0x19, 0x12, 0x4b, 0xf9, 0x39, 0xee, 0xdf, 0xa6, 0x1b, 0xb5, 0xff, 0x7f,
+0x97, 0x87, 0xaf, 0xde, 0x9d, 0x28, 0xf6, 0xc2, 0xb2, 0xd5, 0x08, 0x35, 0x6d, 0x77, 0x42, 0x44,
+0xff, 0x9b, 0xf7, 0x2e, 0xcf, 0x3c, 0xe2, 0x8b, 0x46, 0x23, 0x30, 0xd2, 0x01, 0x1b, 0xa2, 0xf4},
+{
+0x03, 0x5a, 0x9f, 0xa3, 0x04, 0xd3, 0x4c, 0xee, 0x78, 0x08, 0x37, 0xbf, 0x9f, 0xe3, 0x77, 0x60,
+0xa7, 0xbb, 0x8c, 0xe7, 0xef, 0x57, 0xf8, 0xdd, 0x46, 0x2a, 0xb1, 0x06, 0x9f, 0xc6, 0xc2, 0xae,
+0xc2, 0x82, 0xb3, 0x74, 0x82, 0x31, 0xfa, 0x4b, 0xfc, 0x68, 0xfb, 0xb6, 0xad, 0x11, 0xc1, 0x83,
+0x4d, 0xa8, 0x97, 0x25, 0xc6, 0xff, 0xed, 0x19, 0x4e, 0x3b, 0xd9, 0x72, 0xa7, 0xba, 0x29, 0xe1},
+{
+0xc0, 0x48, 0x15, 0x76, 0xc0, 0xcd, 0x7f, 0x80, 0x2e, 0x48, 0xc0, 0xe0, 0xef, 0xe4, 0xf5, 0x0b,
+0x43, 0x6e, 0x7c, 0x79, 0x98, 0xff, 0x3f, 0x0f, 0xb5, 0x2c, 0x55, 0x6f, 0xc9, 0x68, 0x4c, 0x1e,
+0x56, 0x6e, 0x7d, 0x42, 0xad, 0x48, 0xa4, 0x54, 0x39, 0xe5, 0x61, 0x3d, 0xbc, 0x0b, 0x93, 0x5b,
+0x36, 0x6b, 0x66, 0x02, 0x84, 0x1c, 0x8a, 0x4e, 0x69, 0x9a, 0x1a, 0xd7, 0x88, 0xd5, 0xf8, 0x23},
+{
+0x0a, 0xde, 0x54, 0x00, 0x7e, 0x97, 0x79, 0x7a, 0x0a, 0x95, 0x83, 0xfc, 0xe5, 0x38, 0x74, 0x22,
+0x3e, 0x17, 0xe2, 0xbc, 0x81, 0xbc, 0x89, 0x39, 0xbf, 0xce, 0x5a, 0xa6, 0x49, 0x8a, 0x59, 0x14,
+0x71, 0x51, 0xa3, 0xa7, 0xa4, 0x04, 0x16, 0x02, 0x6c, 0x78, 0x47, 0x0a, 0x2d, 0x57, 0xac, 0xe6,
+0xb0, 0x9e, 0xf5, 0xd5, 0x5b, 0x3c, 0xc4, 0x2d, 0x9e, 0x74, 0xc8, 0xaa, 0xc9, 0x02, 0x5d, 0xbb},
+{
+0xc4, 0x9e, 0x8b, 0x0c, 0xec, 0xc6, 0xd2, 0xa5, 0x30, 0x0d, 0x42, 0x4a, 0xaf, 0x24, 0x5c, 0xc0,
+0x8d, 0xb6, 0x3a, 0x41, 0x74, 0x9f, 0x1f, 0x44, 0xef, 0x86, 0x05, 0xa9, 0x17, 0x34, 0x1f, 0xbb,
+0xe7, 0x43, 0x4d, 0xc6, 0x53, 0xe7, 0xc0, 0x01, 0xf7, 0xea, 0xc8, 0xdc, 0xac, 0x34, 0x57, 0xcc,
+0xb5, 0x89, 0xb0, 0x89, 0x71, 0x7c, 0x8f, 0xe2, 0x42, 0x16, 0xeb, 0x95, 0xc8, 0x56, 0xe3, 0xdf},
+{
+0xfc, 0xa0, 0xa0, 0x4a, 0x2b, 0x62, 0x63, 0x9a, 0xb4, 0xd0, 0xab, 0x61, 0xa7, 0x5d, 0xfd, 0x00,
+0x52, 0x2c, 0xa1, 0xc6, 0x0f, 0x27, 0x55, 0xd1, 0x03, 0x70, 0x41, 0xb2, 0xe9, 0x8d, 0xe0, 0xa2,
+0x8c, 0x77, 0xdb, 0x75, 0xdd, 0xa2, 0x50, 0x86, 0xbb, 0x8a, 0x41, 0x87, 0x9c, 0x96, 0x83, 0x89,
+0x85, 0x6b, 0x51, 0xc9, 0x15, 0xf5, 0xee, 0x06, 0xb8, 0x27, 0xc9, 0x2b, 0x77, 0xdf, 0x7d, 0xb4},
+{
+0x66, 0xce, 0x21, 0x3a, 0x01, 0x98, 0xf1, 0x7a, 0xd4, 0xae, 0x58, 0xd2, 0x21, 0x52, 0x9c, 0x38,
+0xb8, 0x25, 0xf8, 0x56, 0x2f, 0xeb, 0xcf, 0x64, 0x6f, 0xec, 0xa3, 0xbe, 0x27, 0x7d, 0xc8, 0x6b,
+0x71, 0x32, 0x94, 0xb7, 0x9f, 0x64, 0x26, 0x89, 0xba, 0x48, 0xe7, 0xa6, 0x3d, 0xdc, 0xa8, 0xa6,
+0x61, 0x76, 0xf9, 0x4d, 0x41, 0x27, 0xc4, 0x41, 0x13, 0x94, 0x75, 0x04, 0xa0, 0xe8, 0xbb, 0x10},
+{
+0xf7, 0x40, 0x92, 0xa7, 0x2d, 0x69, 0x27, 0x52, 0xdc, 0xf7, 0x0a, 0x77, 0x24, 0xf7, 0x04, 0x1f,
+0xee, 0x75, 0x83, 0x1a, 0x48, 0xa5, 0xfd, 0xac, 0x8a, 0x76, 0x0c, 0x4b, 0xb0, 0x25, 0xda, 0x35,
+0x4b, 0xc8, 0x3f, 0xc9, 0xa8, 0xdf, 0x18, 0xfd, 0xce, 0x85, 0xe2, 0xed, 0x01, 0xdf, 0x8a, 0xd3,
+0x3c, 0xa9, 0x4b, 0x96, 0xf9, 0x90, 0x41, 0x1f, 0x5a, 0xff, 0x99, 0x72, 0x14, 0x04, 0x12, 0xe4},
+{
+0xe4, 0x48, 0x2f, 0x07, 0xdc, 0xea, 0xa5, 0x61, 0x30, 0xda, 0xc3, 0x94, 0x3b, 0x1e, 0xbe, 0xbe,
+0x46, 0x79, 0x43, 0xed, 0x25, 0x11, 0x2b, 0x98, 0x80, 0x2d, 0xa3, 0x6d, 0x6d, 0x43, 0x8e, 0x7e,
+0xb4, 0x02, 0x98, 0xe9, 0xa5, 0x6d, 0xc1, 0x2a, 0x1b, 0x8d, 0xcd, 0xca, 0x73, 0xe2, 0xd4, 0x6d,
+0x7f, 0xbc, 0x4a, 0xa4, 0x25, 0xc8, 0x8e, 0xf2, 0x3f, 0xbe, 0x01, 0x5d, 0x8d, 0xc2, 0x2e, 0xe0},
+{
+0xa8, 0x7e, 0x0b, 0xa8, 0x6f, 0x15, 0x2f, 0x39, 0xbf, 0xa8, 0xe4, 0x8a, 0xa0, 0x7c, 0xab, 0x57,
+0x78, 0xb1, 0xc4, 0x50, 0x47, 0x07, 0x32, 0xac, 0xeb, 0x1f, 0x78, 0x0e, 0xb9, 0x41, 0x60, 0x14,
+0xb2, 0x79, 0x52, 0x84, 0x75, 0xf0, 0x43, 0xd3, 0xa5, 0xaf, 0x87, 0x73, 0x57, 0xe7, 0x4f, 0x2d,
+0x39, 0x3c, 0x2f, 0xa7, 0x48, 0x09, 0x1e, 0x15, 0x68, 0xa1, 0x0d, 0x55, 0x4e, 0xd5, 0xa6, 0x41},
+{
+0x61, 0x39, 0x1e, 0x21, 0xd4, 0xce, 0xb8, 0x25, 0x46, 0x60, 0x7c, 0xa4, 0x26, 0x71, 0xf7, 0x9a,
+0x6c, 0x45, 0x13, 0xd1, 0x7c, 0x0a, 0x0f, 0x02, 0xf3, 0xe9, 0x34, 0xec, 0xa5, 0xb2, 0x62, 0x71,
+0x2a, 0x8f, 0x2b, 0xad, 0x96, 0x0d, 0x3f, 0x25, 0x79, 0x86, 0xb9, 0x0c, 0x1f, 0x07, 0x39, 0x11,
+0x43, 0x32, 0xfe, 0xb8, 0xfe, 0xd5, 0xba, 0xd8, 0xab, 0x9f, 0x7f, 0xf1, 0x26, 0xdd, 0xef, 0x11},
+{
+0x10, 0x00, 0x5a, 0x07, 0xd3, 0x4e, 0x13, 0xb3, 0x23, 0x3e, 0xe9, 0x7a, 0x4b, 0x6f, 0xa7, 0x9f,
+0xaa, 0xda, 0xb4, 0x7b, 0x6f, 0x25, 0xdb, 0xc0, 0xa3, 0xd8, 0x4d, 0x46, 0x27, 0xdc, 0x68, 0x76,
+0x77, 0xa9, 0x5d, 0x9f, 0xf5, 0x63, 0x00, 0x15, 0x00, 0xce, 0xef, 0x05, 0xc8, 0xc5, 0xca, 0x3a,
+0xfe, 0x93, 0x44, 0x88, 0xfc, 0x2f, 0xe1, 0xc8, 0xd2, 0x6b, 0xf0, 0x88, 0xd8, 0x36, 0xb9, 0x4a},
+{
+0x78, 0x7f, 0xc1, 0x8f, 0x32, 0x81, 0x57, 0x2a, 0x04, 0x3e, 0xf8, 0xb2, 0xbf, 0x27, 0x98, 0x53,
+0x84, 0xd9, 0x2a, 0x1f, 0x1d, 0xc4, 0xca, 0xb2, 0x24, 0xb6, 0x80, 0x98, 0x1e, 0xd7, 0x35, 0x6c,
+0x65, 0xfe, 0xa3, 0x2b, 0x84, 0xf7, 0xad, 0xc1, 0xfd, 0x11, 0xe7, 0xfe, 0x02, 0xd0, 0xd4, 0xdd,
+0x05, 0x30, 0x64, 0xc3, 0xa9, 0x16, 0x2a, 0x12, 0xa9, 0x00, 0x9f, 0x3f, 0xfd, 0x89, 0xb8, 0x21},
+{
+0xc1, 0x6f, 0xec, 0x7f, 0x0d, 0xa3, 0x5f, 0xb2, 0x6d, 0x29, 0xcf, 0xe9, 0x45, 0xc5, 0x16, 0xb7,
+0xfc, 0xd8, 0x43, 0x3a, 0xc5, 0x46, 0x1e, 0x40, 0xb4, 0x1f, 0x1d, 0xc9, 0x35, 0xea, 0x89, 0x17,
+0xc5, 0x0a, 0x3e, 0x53, 0xa0, 0x97, 0x8a, 0xf6, 0x29, 0x80, 0x8b, 0xa4, 0x57, 0xc7, 0x16, 0x08,
+0x71, 0x22, 0xe0, 0x0d, 0x34, 0xf9, 0x8b, 0x04, 0xc9, 0xdc, 0x22, 0x3d, 0x0c, 0x41, 0x0d, 0xf0},
+{
+0x34, 0x81, 0x8c, 0x73, 0xf5, 0xc0, 0x41, 0x03, 0xe7, 0x64, 0x4e, 0xfb, 0xbf, 0x90, 0x20, 0xd0,
+0x84, 0x06, 0x5f, 0xc5, 0xd6, 0x11, 0x7b, 0x1f, 0x74, 0x36, 0xef, 0x95, 0x04, 0x24, 0x9a, 0xb3,
+0x53, 0xac, 0xfe, 0x6e, 0x2c, 0x22, 0x0d, 0xa9, 0x0f, 0x09, 0x8b, 0x78, 0x31, 0xbd, 0xc3, 0x8e,
+0x88, 0x8c, 0x60, 0x9e, 0x43, 0xdf, 0x2c, 0xa0, 0xa6, 0xe3, 0x93, 0x39, 0xfc, 0xd2, 0x7c, 0x4b},
+{
+0x7a, 0x0c, 0x9f, 0xf9, 0x51, 0x62, 0x2d, 0xee, 0x12, 0x73, 0xbc, 0x02, 0x15, 0xb5, 0x86, 0x41,
+0xbc, 0x0d, 0x0b, 0xb4, 0xee, 0x97, 0xfe, 0x02, 0x31, 0x71, 0xa7, 0xdd, 0xdf, 0xd8, 0xe4, 0xcc,
+0x2f, 0x86, 0xf1, 0x15, 0x65, 0x6b, 0x10, 0xfb, 0xde, 0xca, 0xf8, 0x76, 0x10, 0xdc, 0x49, 0xac,
+0x37, 0xb6, 0xfe, 0x23, 0x6e, 0x01, 0x49, 0xb1, 0x02, 0xbf, 0x63, 0x40, 0x5a, 0x53, 0x52, 0xc6},
+{
+0xf1, 0xfc, 0x2f, 0xbf, 0x52, 0xe5, 0xe3, 0x7d, 0xcb, 0xee, 0xb3, 0x93, 0xb3, 0x96, 0x9e, 0xe0,
+0x13, 0x17, 0x7d, 0x6c, 0xf9, 0xac, 0xbc, 0x21, 0x91, 0x1a, 0xa7, 0xee, 0xac, 0x5c, 0xae, 0x1f,
+0x13, 0x9a, 0x39, 0x44, 0x46, 0x2a, 0x1e, 0x1b, 0xc2, 0x2f, 0x2b, 0x81, 0x8c, 0xd9, 0x8f, 0x5a,
+0xea, 0x3d, 0xfd, 0xfd, 0x7e, 0x77, 0x95, 0xae, 0xd6, 0xb3, 0x39, 0x58, 0x1b, 0xe0, 0x6d, 0x70},
+{
+0x98, 0xea, 0x09, 0x5d, 0x77, 0xde, 0x6f, 0x99, 0x58, 0xda, 0x45, 0x41, 0x12, 0xf5, 0xdd, 0x16,
+0x25, 0xb2, 0x2f, 0xdc, 0xa8, 0x6c, 0x7a, 0xa9, 0x5a, 0xdf, 0xdc, 0xfb, 0x30, 0x1f, 0x33, 0xc7,
+0x52, 0x6e, 0xa8, 0x86, 0xe0, 0x99, 0x8f, 0x83, 0xdd, 0x5e, 0x79, 0x77, 0x29, 0x9b, 0xd3, 0x68,
+0xaa, 0x2a, 0x41, 0x9f, 0x7e, 0xf9, 0xe4, 0xe4, 0x52, 0x53, 0xd2, 0x30, 0x0a, 0x2c, 0xcc, 0xe5},
+{
+0xd2, 0x5d, 0x76, 0xb5, 0x4c, 0x95, 0x45, 0x1f, 0xfb, 0x9b, 0x9f, 0x49, 0x2f, 0x2a, 0xd8, 0x54,
+0x64, 0x67, 0x4c, 0x75, 0x15, 0x9d, 0x3c, 0x8c, 0x16, 0x6e, 0xec, 0x32, 0x6a, 0x58, 0x0b, 0x34,
+0x49, 0x1e, 0x08, 0xd7, 0x19, 0x2d, 0xda, 0xa9, 0xa5, 0xe1, 0xfb, 0x59, 0xf0, 0xde, 0xd5, 0x55,
+0xfa, 0x73, 0x17, 0xb3, 0xd1, 0x57, 0xdd, 0xc9, 0x16, 0x2f, 0xc4, 0x4a, 0xc7, 0x5a, 0xfd, 0x7f},
+{
+0x71, 0xff, 0x21, 0x9c, 0x50, 0x86, 0xd6, 0xb3, 0x84, 0x38, 0xbe, 0xdd, 0x9d, 0x58, 0xe7, 0x11,
+0x67, 0xac, 0x3b, 0x42, 0x55, 0x40, 0xfd, 0x7e, 0x25, 0x74, 0x95, 0x46, 0x93, 0x72, 0x7a, 0x58,
+0xc6, 0x8f, 0x5a, 0x8f, 0x2e, 0xdc, 0x0a, 0x36, 0x2e, 0xf1, 0x69, 0xbd, 0xfb, 0xba, 0x8b, 0x6f,
+0x4d, 0x3b, 0x3f, 0x0a, 0x23, 0xf4, 0x71, 0xf6, 0xc3, 0x2d, 0x94, 0x59, 0x47, 0xcb, 0x9a, 0xb4},
+{
+0x14, 0x19, 0xdc, 0x7a, 0xbf, 0xc6, 0x22, 0xa2, 0x0a, 0xae, 0xc0, 0x9a, 0x9d, 0x4f, 0x73, 0xf5,
+0xa5, 0x48, 0x59, 0xe6, 0x80, 0x2f, 0x85, 0xc7, 0x97, 0xd2, 0xbf, 0xbb, 0x53, 0xa8, 0x9c, 0xac,
+0xc8, 0xfe, 0x38, 0xc4, 0x0d, 0xb9, 0x2c, 0xc2, 0x58, 0x82, 0x42, 0x10, 0x2d, 0xe8, 0x6d, 0x10,
+0x1b, 0xcd, 0xd6, 0xa2, 0x6b, 0x14, 0x19, 0x04, 0xaf, 0x7f, 0x66, 0x38, 0x89, 0x46, 0x28, 0x68},
+{
+0x5d, 0xd2, 0xb5, 0xa8, 0x4c, 0xf2, 0x75, 0xdd, 0x72, 0x09, 0x49, 0x43, 0xe6, 0xca, 0x0c, 0xd5,
+0x48, 0x94, 0x46, 0x27, 0x65, 0x46, 0x74, 0xff, 0xfc, 0x2b, 0x25, 0x05, 0x0e, 0x60, 0x19, 0xdd,
+0xb1, 0x39, 0x5c, 0x24, 0x30, 0x79, 0xdf, 0x86, 0x4d, 0x21, 0xc3, 0x07, 0x20, 0xd8, 0xe2, 0xdf,
+0xc3, 0x43, 0x31, 0x39, 0xca, 0xe3, 0x70, 0x37, 0x1d, 0xdb, 0x62, 0x6d, 0x55, 0x5b, 0x47, 0x2a},
+{
+0xd7, 0x71, 0xa4, 0xf5, 0x47, 0x19, 0xb3, 0xaf, 0x39, 0xf7, 0x00, 0xf2, 0x17, 0x52, 0xfd, 0x05,
+0xfe, 0xcb, 0x55, 0xd4, 0x18, 0x20, 0x80, 0xf2, 0x56, 0x76, 0x19, 0xe7, 0x88, 0xb6, 0x78, 0xb9,
+0x1b, 0x33, 0xa6, 0x64, 0x33, 0xb2, 0x68, 0xaf, 0xc5, 0xf2, 0x50, 0xef, 0xdc, 0x6f, 0x7b, 0x63,
+0xe2, 0xa0, 0x2b, 0x71, 0x82, 0x73, 0x86, 0x36, 0x70, 0x66, 0x59, 0x99, 0xf3, 0x20, 0xab, 0x19},
+{
+0x2d, 0xa6, 0x69, 0xc9, 0x6e, 0x57, 0x6c, 0xb4, 0x0a, 0xfe, 0x0d, 0xad, 0x04, 0x07, 0xe9, 0xac,
+0x76, 0x51, 0xc1, 0xd2, 0xa2, 0xd3, 0x24, 0x87, 0x40, 0x2e, 0x53, 0xec, 0x8b, 0x0b, 0xb7, 0xaf,
+0x96, 0xfd, 0xf0, 0xdc, 0xc0, 0xda, 0x65, 0xe9, 0x74, 0x57, 0x7b, 0xc4, 0xca, 0xe0, 0x84, 0x32,
+0x52, 0x66, 0xad, 0xb1, 0xf0, 0x10, 0x2f, 0x66, 0x05, 0xbc, 0xd8, 0x3a, 0xd3, 0x7d, 0xbb, 0x86},
+{
+0x7b, 0xaa, 0x29, 0x6f, 0xc5, 0xbf, 0x50, 0xfa, 0x08, 0x7a, 0x22, 0xb5, 0x9e, 0xa7, 0x13, 0xb7,
+0x5e, 0x67, 0x2e, 0xb9, 0x4f, 0xe1, 0xb4, 0xb1, 0xd9, 0x1e, 0x65, 0xfc, 0x98, 0x97, 0x55, 0xac,
+0x24, 0x47, 0xf2, 0xe6, 0x1c, 0xce, 0x2d, 0xad, 0xa7, 0x8c, 0x5f, 0x42, 0x98, 0xbd, 0xe9, 0x6c,
+0x48, 0x18, 0xc5, 0x91, 0xc2, 0xbe, 0x03, 0x0b, 0x2c, 0xa9, 0x77, 0x59, 0xa7, 0xcd, 0xf2, 0x25},
+{
+0x28, 0x00, 0x6b, 0xf1, 0xcb, 0x26, 0x83, 0xe3, 0x83, 0x64, 0xdc, 0xe2, 0x35, 0x37, 0x19, 0x6d,
+0xe8, 0x72, 0x3a, 0x23, 0xa7, 0xec, 0x13, 0x73, 0x76, 0x80, 0xc3, 0x04, 0x81, 0x02, 0x18, 0xe0,
+0x65, 0x8b, 0xfd, 0x08, 0x7a, 0x4f, 0x94, 0x0e, 0x62, 0xb5, 0x0b, 0x94, 0x4d, 0xd1, 0x73, 0xda,
+0xac, 0xbf, 0x1a, 0xeb, 0x4c, 0xa2, 0xf0, 0xc2, 0xba, 0x85, 0xc9, 0xc3, 0x78, 0xc0, 0x64, 0x47},
+{
+0xc7, 0x5d, 0x4f, 0x25, 0xcd, 0xa3, 0xc2, 0x67, 0xfa, 0x64, 0xa4, 0xce, 0xa7, 0x5c, 0xed, 0xd1,
+0xc6, 0x8d, 0xc2, 0x2f, 0x46, 0x91, 0x4f, 0x73, 0x5f, 0xb0, 0xc8, 0x6f, 0x00, 0xf9, 0x7a, 0x8e,
+0xbb, 0x26, 0xfe, 0x92, 0xc7, 0xe5, 0xa6, 0xcf, 0xc0, 0x13, 0x51, 0xcb, 0x7e, 0x81, 0x15, 0xbc,
+0x01, 0x3c, 0x11, 0xca, 0x58, 0x7b, 0x88, 0x86, 0xfa, 0xe8, 0x38, 0x5d, 0x65, 0xd5, 0x55, 0x54},
+{
+0xad, 0x05, 0x9f, 0x75, 0x0e, 0xa7, 0x07, 0x57, 0x0e, 0x7f, 0xd5, 0xf2, 0x06, 0x8a, 0xec, 0x6f,
+0x81, 0x8f, 0xd3, 0x52, 0xe1, 0x1d, 0x1e, 0x7b, 0x93, 0xe1, 0xb5, 0x8d, 0xa2, 0x68, 0x1f, 0x95,
+0x49, 0x36, 0x7b, 0x5a, 0xe9, 0x11, 0x6a, 0x06, 0x3d, 0x40, 0x12, 0x7f, 0x20, 0x9a, 0xe2, 0x8c,
+0x15, 0xb2, 0x42, 0x97, 0xce, 0x83, 0x1c, 0x77, 0x47, 0x00, 0x0a, 0xe0, 0xca, 0x19, 0xad, 0xda},
+{
+0x1e, 0xc2, 0xe0, 0xf8, 0x00, 0x6f, 0xb0, 0x0d, 0x69, 0x9a, 0xe3, 0x05, 0x39, 0x7f, 0x73, 0x49,
+0x09, 0x68, 0x55, 0xa0, 0x4a, 0x1c, 0x98, 0xc2, 0x3d, 0x3c, 0x9c, 0x73, 0xae, 0x26, 0x78, 0xfc,
+0xb2, 0x2b, 0x9f, 0x67, 0x0e, 0x72, 0x08, 0x07, 0x4a, 0xfb, 0xa8, 0x70, 0x6b, 0xd0, 0x29, 0x6a,
+0x52, 0x31, 0x50, 0xcb, 0xdc, 0x3f, 0xf0, 0x2d, 0x8c, 0x8b, 0x36, 0xbd, 0x3b, 0xb1, 0x12, 0xfb},
+{
+0xe1, 0xcb, 0xdd, 0x33, 0xd6, 0xa6, 0xbf, 0x3d, 0xd0, 0xa6, 0x68, 0xfe, 0x15, 0xd5, 0x0e, 0xbf,
+0x2b, 0x17, 0xfc, 0x48, 0x32, 0xa8, 0x3e, 0xd4, 0x11, 0x2d, 0x6b, 0xc0, 0x59, 0x1c, 0x46, 0xe5,
+0x10, 0x03, 0x65, 0xff, 0x15, 0xd8, 0xc0, 0x03, 0xe0, 0x22, 0xe2, 0x92, 0x17, 0xd5, 0x17, 0xf4,
+0x1e, 0x94, 0x57, 0xec, 0xed, 0xdc, 0xff, 0x87, 0x59, 0xa9, 0x93, 0x43, 0xbf, 0x82, 0x6c, 0xc1},
+{
+0x6e, 0x0d, 0x14, 0x3a, 0x03, 0x60, 0x0a, 0x92, 0x05, 0x88, 0x25, 0x15, 0x8c, 0xc8, 0x63, 0x43,
+0x8e, 0x06, 0x9c, 0xf7, 0xc4, 0xe9, 0xd9, 0xc2, 0x82, 0x4e, 0x2e, 0x7d, 0xae, 0xcb, 0x88, 0x6c,
+0xcf, 0xdb, 0xc6, 0xde, 0x68, 0x90, 0xe4, 0xbb, 0x85, 0x9b, 0xf9, 0x42, 0x0e, 0x4d, 0xc6, 0x7c,
+0x7f, 0x4c, 0xc3, 0x85, 0x55, 0x04, 0x3f, 0x72, 0xab, 0x82, 0x23, 0x89, 0xd9, 0x30, 0x27, 0xed},
+{
+0xa7, 0x2b, 0x6c, 0xfc, 0x7d, 0x37, 0x9e, 0x7d, 0x91, 0xdc, 0x4c, 0x2c, 0x20, 0x33, 0x33, 0x03,
+0xaa, 0x41, 0x20, 0xee, 0x97, 0x1f, 0x6a, 0xd5, 0x89, 0x30, 0x82, 0x4d, 0xdc, 0x61, 0x2a, 0xe1,
+0x85, 0xad, 0x77, 0x32, 0x25, 0x14, 0x67, 0xc6, 0x3f, 0xba, 0xc1, 0x2c, 0x25, 0x17, 0x42, 0x7b,
+0x0a, 0xec, 0xf5, 0x0f, 0x03, 0x8a, 0xbc, 0x30, 0xab, 0x23, 0xc4, 0x04, 0x0b, 0x3d, 0xbf, 0x7d},
+{
+0x2d, 0x81, 0x7a, 0x87, 0xaf, 0x8e, 0x0a, 0xed, 0xa1, 0xb2, 0x39, 0x91, 0xc5, 0xf9, 0x18, 0x68,
+0x2a, 0x1c, 0x42, 0x2f, 0x3f, 0x4e, 0x5f, 0x41, 0x36, 0x12, 0xc4, 0xe7, 0xd3, 0x03, 0x0c, 0xba,
+0x9d, 0x36, 0x60, 0xf5, 0x9b, 0x8b, 0xa0, 0xe9, 0x92, 0x7b, 0x0d, 0x09, 0xfb, 0xa2, 0xa1, 0x65,
+0x59, 0xef, 0xb8, 0xab, 0xd1, 0x2b, 0x9d, 0x59, 0x35, 0xde, 0x30, 0xc7, 0xe3, 0xb9, 0xc3, 0x81},
+{
+0xfd, 0xac, 0x4a, 0x63, 0x72, 0x14, 0x00, 0x42, 0xcf, 0x32, 0x6a, 0x11, 0x24, 0x48, 0xed, 0xcc,
+0xd3, 0x54, 0x60, 0x26, 0x5e, 0x24, 0x9a, 0xef, 0xdc, 0x46, 0x74, 0x8b, 0xce, 0xdb, 0xfc, 0x6a,
+0xb5, 0x8c, 0x46, 0xf0, 0x26, 0x4e, 0x6d, 0x6b, 0x12, 0xf7, 0x50, 0x53, 0x84, 0x40, 0x47, 0xf2,
+0x5c, 0x46, 0x63, 0x94, 0x03, 0x3f, 0x17, 0xf1, 0x56, 0x27, 0xc7, 0x44, 0x18, 0x2a, 0x58, 0xac},
+{
+0x74, 0x4f, 0x02, 0x50, 0x16, 0xdf, 0xc5, 0x98, 0xa0, 0xfe, 0xa7, 0x97, 0x61, 0x30, 0xd8, 0x2f,
+0xe6, 0xea, 0xa4, 0xbf, 0xa2, 0x5d, 0x35, 0x5c, 0xd7, 0xe9, 0x86, 0x1a, 0x9c, 0x39, 0xf1, 0x68,
+0x2f, 0xef, 0x61, 0xdf, 0x7b, 0xf9, 0xc8, 0xce, 0x4b, 0x62, 0x26, 0xf6, 0x29, 0xea, 0xfb, 0xdb,
+0xd4, 0xff, 0xaf, 0x1b, 0xb7, 0xd0, 0x3c, 0xba, 0x09, 0x3b, 0xf1, 0x1e, 0x56, 0x8e, 0x11, 0xc4},
+{
+0x90, 0x59, 0x47, 0x2f, 0xff, 0x9b, 0xc0, 0xb4, 0x8e, 0xc2, 0xe3, 0x57, 0x9e, 0x96, 0xd9, 0x27,
+0x3b, 0x8f, 0x54, 0x40, 0x0a, 0x7e, 0x75, 0x4b, 0x68, 0x47, 0xbd, 0x70, 0x4d, 0xaf, 0x71, 0xd6,
+0xea, 0x01, 0xb5, 0x70, 0x66, 0x72, 0x66, 0x33, 0x9e, 0x52, 0xd6, 0xf6, 0x58, 0x3a, 0xd0, 0x5a,
+0x5b, 0xc2, 0x15, 0x65, 0x6c, 0x3c, 0x72, 0x2d, 0x89, 0xf8, 0x62, 0xd7, 0xcd, 0x24, 0xd3, 0x56},
+{
+0x22, 0xdc, 0xae, 0x2c, 0x0e, 0xa5, 0xcd, 0x89, 0x10, 0x81, 0x5b, 0xbd, 0xdb, 0xcc, 0xf0, 0xf3,
+0xe2, 0xf4, 0x81, 0x4c, 0x3e, 0xeb, 0xee, 0x75, 0x10, 0xce, 0xa0, 0x50, 0x5e, 0xe0, 0x86, 0xcc,
+0x2a, 0x00, 0x22, 0xcc, 0x18, 0xb8, 0xc1, 0xfc, 0xb4, 0x6f, 0xe8, 0xf2, 0x2f, 0x10, 0x01, 0x8b,
+0x48, 0xa1, 0xd6, 0x6a, 0x53, 0x8b, 0x4c, 0x82, 0x12, 0xc6, 0xfa, 0x1e, 0x45, 0x27, 0xb3, 0x3a},
+{
+0x5e, 0xff, 0x97, 0xe0, 0x73, 0xf1, 0x05, 0xb6, 0x5b, 0x45, 0x8e, 0x8b, 0x34, 0x4d, 0x2b, 0x29,
+0x2d, 0xc5, 0x1c, 0x39, 0x2b, 0x04, 0xd8, 0x4c, 0x6c, 0x8a, 0x62, 0x68, 0xab, 0x2a, 0x36, 0x21,
+0xbb, 0x96, 0x2a, 0xf7, 0x53, 0xa6, 0xf4, 0xad, 0x55, 0x8d, 0x24, 0x13, 0x6d, 0x64, 0x1d, 0x41,
+0xf5, 0x0b, 0x1a, 0xc2, 0x85, 0x81, 0x09, 0x97, 0x81, 0xd2, 0x5e, 0x0f, 0xe1, 0x15, 0x6d, 0xb4},
+{
+0x5f, 0x2b, 0x0f, 0x99, 0xa5, 0xe3, 0x9a, 0xff, 0xf4, 0xc7, 0xfc, 0xfb, 0x1d, 0x58, 0x4f, 0x5e,
+0x4a, 0xde, 0xf7, 0x9d, 0x9a, 0xe8, 0x43, 0x06, 0x0b, 0x9b, 0x30, 0xc1, 0xd4, 0xc5, 0x95, 0xb1,
+0x46, 0xff, 0x8a, 0xb6, 0xdd, 0xd0, 0x13, 0xfe, 0x0a, 0xe4, 0xa2, 0x60, 0x52, 0xa3, 0x4d, 0xd4,
+0x2b, 0x2b, 0x15, 0xd0, 0x32, 0x4d, 0x1d, 0x96, 0xdd, 0x27, 0x0d, 0x0f, 0xee, 0xc1, 0xe7, 0x62},
+{
+0x5c, 0x35, 0xdd, 0x81, 0x3c, 0xa8, 0x14, 0xa4, 0xd4, 0x58, 0xbc, 0x3b, 0xb3, 0xb2, 0x73, 0x79,
+0xb9, 0x7e, 0x90, 0xd7, 0x47, 0x23, 0x53, 0xc3, 0xad, 0xb2, 0xfa, 0xc1, 0x4c, 0x51, 0xe9, 0x68,
+0x5d, 0x27, 0x42, 0x64, 0x1d, 0x3d, 0x36, 0xd1, 0x16, 0x1e, 0x9a, 0x51, 0xb0, 0x58, 0x7f, 0x21,
+0xe4, 0x32, 0xa7, 0xd7, 0x5c, 0x0c, 0xf3, 0xd4, 0x83, 0xda, 0x51, 0xef, 0x57, 0x8d, 0xf2, 0xfb},
+{
+0x95, 0x35, 0xd8, 0x48, 0xbc, 0xf2, 0x30, 0x73, 0x6f, 0xca, 0x6d, 0xf6, 0x4c, 0xeb, 0x2b, 0xd2,
+0x23, 0x69, 0x8c, 0x6b, 0x6b, 0xbc, 0x29, 0x8e, 0x79, 0xb5, 0xb1, 0x26, 0x28, 0x72, 0x58, 0x76,
+0x23, 0x2b, 0x2e, 0xbb, 0x2b, 0xf0, 0xb2, 0xe5, 0xd3, 0xe1, 0x4d, 0x34, 0xd7, 0xbd, 0x4f, 0xca,
+0x4b, 0xc6, 0x81, 0x9d, 0x4b, 0x28, 0xed, 0x39, 0x5c, 0x51, 0x13, 0x01, 0x14, 0xe7, 0xaa, 0x73},
+{
+0xe0, 0xfc, 0xa5, 0xb8, 0xd2, 0x8d, 0x2c, 0x8e, 0xfb, 0x18, 0xce, 0x85, 0x17, 0xcd, 0x91, 0x7d,
+0x1e, 0x50, 0xff, 0x1a, 0x67, 0xcb, 0xbb, 0x8e, 0xf5, 0xe8, 0x25, 0xe1, 0xb3, 0xc5, 0xa4, 0xcc,
+0xcc, 0xe4, 0xc5, 0x35, 0x76, 0x84, 0xee, 0x40, 0x8c, 0x3e, 0xbb, 0xcb, 0x13, 0x15, 0x42, 0x74,
+0xb9, 0x2f, 0x62, 0x8c, 0x93, 0xdb, 0xbf, 0x20, 0xde, 0x67, 0xa2, 0xd4, 0x5f, 0x23, 0xe8, 0xca},
+{
+0xc5, 0x9f, 0x47, 0xbe, 0xb4, 0x4c, 0x36, 0xf0, 0x39, 0xb4, 0xc9, 0xf3, 0x29, 0x72, 0x9d, 0xba,
+0x8c, 0xe2, 0xbd, 0x0e, 0x5a, 0xed, 0xb9, 0x4a, 0x14, 0x46, 0x04, 0x1a, 0xe6, 0xcb, 0x3e, 0x93,
+0x5a, 0xc1, 0x85, 0xde, 0x44, 0x88, 0x55, 0x1f, 0x22, 0x63, 0x65, 0x6d, 0x4f, 0xc0, 0xc6, 0xf6,
+0xb0, 0x19, 0x2a, 0xc0, 0xbc, 0xc3, 0x4e, 0x13, 0xbc, 0xee, 0xa0, 0x4c, 0x72, 0x92, 0x55, 0x8a},
+{
+0x2d, 0x7e, 0xea, 0x9f, 0x66, 0x5c, 0x02, 0x6e, 0x51, 0x9d, 0x98, 0x70, 0xd4, 0xb1, 0x4f, 0xc4,
+0x89, 0xa1, 0xbb, 0xc2, 0x18, 0xdb, 0x5f, 0x5b, 0xcb, 0x31, 0x14, 0x47, 0x35, 0xc8, 0x04, 0xe8,
+0xa0, 0xc0, 0xb1, 0xb2, 0xf7, 0x38, 0xd3, 0x8e, 0xd0, 0x5c, 0xf6, 0x0b, 0x91, 0xc5, 0x4f, 0xdf,
+0xfe, 0x74, 0xa0, 0x9f, 0xb8, 0xcd, 0x5d, 0x58, 0x31, 0x94, 0xa8, 0xf4, 0x3b, 0x78, 0xe1, 0x3e},
+{
+0x59, 0xc3, 0x9b, 0x60, 0xc4, 0x61, 0x5f, 0xe0, 0x3c, 0x82, 0x36, 0x42, 0x9c, 0xb4, 0xe9, 0x15,
+0x6c, 0x33, 0x23, 0x6a, 0xc8, 0xc1, 0x2a, 0xc6, 0x41, 0x38, 0xff, 0x63, 0xf7, 0x71, 0xb1, 0xd7,
+0x34, 0x85, 0x46, 0x3c, 0x18, 0xd1, 0x39, 0xd2, 0x4d, 0x19, 0xe1, 0x2a, 0x60, 0xc6, 0xe6, 0x94,
+0x69, 0xa0, 0xf4, 0xbe, 0xe3, 0x5b, 0x61, 0x4c, 0xb7, 0xc8, 0xbd, 0xc9, 0xf6, 0x05, 0x0c, 0x0f},
+{
+0x7b, 0x69, 0x13, 0xd3, 0x58, 0x79, 0xd9, 0xf8, 0xfc, 0x1a, 0xd0, 0x04, 0xa0, 0x2a, 0x44, 0x7b,
+0x0c, 0x31, 0x53, 0xa9, 0x29, 0xb0, 0x9f, 0xdd, 0xe9, 0x15, 0x0e, 0x0b, 0x18, 0x15, 0x78, 0x43,
+0x87, 0xd3, 0x89, 0xdb, 0x63, 0xe0, 0x9c, 0x33, 0x6a, 0xc3, 0x78, 0x37, 0xfe, 0xc0, 0x29, 0xd2,
+0x35, 0xd8, 0xcf, 0x88, 0x29, 0x0d, 0x41, 0x50, 0xd1, 0xc9, 0x97, 0xb8, 0xed, 0x10, 0x34, 0x39},
+{
+0xf0, 0x63, 0xba, 0x18, 0x97, 0xc7, 0x25, 0x4d, 0xc8, 0x5b, 0xd8, 0x35, 0xed, 0xd2, 0xa5, 0xaa,
+0xb6, 0x04, 0x3f, 0xb3, 0x49, 0xea, 0x5f, 0x5a, 0x24, 0x85, 0x83, 0x63, 0xf0, 0x5c, 0x4e, 0x2e,
+0xdf, 0xd3, 0x67, 0xbb, 0x8f, 0x24, 0xf7, 0x75, 0xe4, 0x1a, 0x70, 0x6c, 0xc5, 0x3d, 0xe5, 0xf6,
+0x61, 0xb9, 0xc7, 0x28, 0x97, 0xbb, 0x00, 0xcb, 0x04, 0xb7, 0x4d, 0x4a, 0x62, 0x72, 0x8c, 0xe7},
+{
+0xcf, 0x77, 0xda, 0x3e, 0x6d, 0x1d, 0x0d, 0xb1, 0x5a, 0x1f, 0xc5, 0x32, 0x45, 0x60, 0x9d, 0x42,
+0x11, 0x4f, 0x8f, 0x41, 0x30, 0x24, 0x9f, 0xab, 0x1c, 0x47, 0x91, 0xe1, 0x43, 0xd2, 0x37, 0x29,
+0x18, 0x0d, 0x8e, 0x2a, 0xea, 0xfc, 0xd5, 0x37, 0xb2, 0x7e, 0x9f, 0x68, 0xdf, 0x51, 0x2d, 0xa6,
+0xf7, 0xc5, 0x8c, 0xa4, 0x81, 0xc5, 0x79, 0xf6, 0x73, 0x16, 0xc0, 0xd7, 0xcb, 0xd6, 0xda, 0xa1},
+{
+0xef, 0xbc, 0x52, 0xda, 0x20, 0x08, 0x4d, 0xde, 0xcb, 0xc9, 0xbf, 0xab, 0x3d, 0x86, 0x70, 0x67,
+0xdb, 0x85, 0x7a, 0xbc, 0x5f, 0x09, 0x84, 0x57, 0xc2, 0x54, 0x0f, 0x50, 0x1c, 0xe5, 0xed, 0x04,
+0x37, 0xc1, 0x0e, 0x7d, 0x2d, 0xfb, 0x7e, 0xbc, 0x6b, 0x73, 0x8b, 0xfc, 0x92, 0xbd, 0x74, 0x22,
+0x84, 0xa6, 0x5d, 0x6c, 0x9d, 0x81, 0xe6, 0xac, 0x80, 0x91, 0x2a, 0x1b, 0x44, 0xb3, 0x52, 0x55},
+{
+0x70, 0x33, 0xec, 0x38, 0x8d, 0x66, 0x1b, 0x22, 0x26, 0x34, 0x63, 0x7f, 0x35, 0xab, 0xb3, 0x5a,
+0xb0, 0xdb, 0x0d, 0x7f, 0xee, 0x3e, 0xab, 0x69, 0x05, 0x8d, 0xeb, 0x08, 0xdc, 0xc5, 0xb1, 0xef,
+0xf7, 0xea, 0x08, 0x37, 0x69, 0x44, 0xa3, 0x4c, 0xaf, 0xff, 0x7e, 0xb4, 0xda, 0xd5, 0x7a, 0x77,
+0xff, 0x39, 0x06, 0x26, 0x4a, 0x77, 0x2c, 0xac, 0x44, 0xdd, 0x09, 0x37, 0xc7, 0x21, 0x74, 0x3d},
+{
+0x4b, 0x78, 0x0d, 0x85, 0xfc, 0xb0, 0x0b, 0x08, 0xa6, 0x21, 0xe6, 0xc2, 0x52, 0x2e, 0x45, 0x11,
+0xa4, 0xc0, 0x06, 0x7f, 0x65, 0x05, 0x7a, 0xb7, 0x07, 0x63, 0x52, 0x81, 0xc0, 0x4a, 0x0b, 0xe5,
+0xb2, 0xc4, 0x30, 0x2a, 0x6d, 0x46, 0x6c, 0x25, 0x6f, 0xe9, 0x05, 0x8e, 0xb2, 0xde, 0x9b, 0x4a,
+0xd0, 0x4d, 0xa7, 0xf4, 0xd8, 0x00, 0x9b, 0x05, 0x19, 0xc7, 0x72, 0x7a, 0x35, 0xcf, 0x7f, 0x34},
+{
+0x87, 0xd9, 0x69, 0x97, 0x8e, 0xd3, 0x25, 0x3a, 0xe1, 0x84, 0x7e, 0x99, 0x4e, 0x63, 0xd2, 0x4f,
+0xc5, 0x00, 0xa1, 0x47, 0x1e, 0xc9, 0xe2, 0xb5, 0xee, 0xda, 0x3c, 0x6e, 0x1b, 0xac, 0xfc, 0x44,
+0xc4, 0x66, 0xf2, 0xe3, 0x92, 0x16, 0xa9, 0x01, 0x66, 0x52, 0x19, 0x21, 0x8b, 0xe5, 0xb9, 0xd5,
+0x7b, 0x5b, 0x3f, 0x2a, 0xc1, 0xfd, 0x6d, 0xff, 0x2d, 0x1e, 0x1c, 0xc8, 0xbf, 0x8a, 0xf3, 0x83},
+{
+0x66, 0x75, 0xed, 0x32, 0xb9, 0xf4, 0xd8, 0xd6, 0x47, 0xb2, 0x22, 0x98, 0x21, 0x95, 0xa4, 0x2c,
+0xdd, 0xa8, 0x55, 0x2b, 0x55, 0xef, 0x90, 0x2a, 0x87, 0xb4, 0x88, 0x58, 0x28, 0x0c, 0x5b, 0x0e,
+0x0b, 0x6c, 0x89, 0x61, 0x22, 0x6c, 0x35, 0x15, 0x90, 0x35, 0x8c, 0xf9, 0x8b, 0x25, 0x1d, 0x74,
+0xe8, 0xb5, 0xb1, 0x19, 0x08, 0x6c, 0x11, 0x5d, 0x49, 0x64, 0xce, 0xf8, 0xae, 0x92, 0xc9, 0x2d},
+{
+0x17, 0xe0, 0x75, 0x9c, 0xca, 0xdd, 0x8b, 0x12, 0x99, 0x89, 0xd7, 0x1a, 0xd5, 0xf2, 0xa8, 0x37,
+0x85, 0x00, 0xbf, 0x9f, 0x99, 0xbf, 0xb9, 0x84, 0x84, 0x05, 0xba, 0xf4, 0xf4, 0x8c, 0xb2, 0x40,
+0xb0, 0xb8, 0x13, 0xed, 0x8f, 0xaf, 0x86, 0x5f, 0xb9, 0xe6, 0xc6, 0x2d, 0xb2, 0xa2, 0x07, 0xc7,
+0xcd, 0x9a, 0xc8, 0xa1, 0x39, 0x9c, 0x6e, 0x94, 0x15, 0x2e, 0xe3, 0xf8, 0x02, 0xe6, 0x3b, 0x9e},
+{
+0x3b, 0x0d, 0xd6, 0x8e, 0xba, 0x4e, 0x7e, 0x9f, 0x43, 0x47, 0xe6, 0xa1, 0x0b, 0xf8, 0x9e, 0x82,
+0x50, 0xf6, 0x8e, 0xa1, 0x07, 0x9b, 0xae, 0xe1, 0x85, 0xb0, 0x41, 0x9a, 0x29, 0x58, 0xe0, 0x40,
+0x53, 0x19, 0x80, 0x56, 0xb3, 0x2b, 0x3b, 0xec, 0x42, 0x51, 0xac, 0xfb, 0x4b, 0xe7, 0x3f, 0x3a,
+0xab, 0xd2, 0x63, 0xfb, 0x50, 0x81, 0xb6, 0x56, 0x00, 0x91, 0xb9, 0x98, 0xfc, 0xe5, 0x6a, 0xab},
+{
+0x3e, 0xea, 0x5e, 0x5f, 0xba, 0xb6, 0x0f, 0x3c, 0x1d, 0x01, 0x2e, 0xec, 0x4c, 0x86, 0x91, 0xe6,
+0xad, 0xbf, 0x10, 0xce, 0xc6, 0x84, 0xe7, 0xd5, 0xef, 0xe8, 0x36, 0x2a, 0x14, 0xfc, 0xb4, 0x7a,
+0xa8, 0x23, 0xa2, 0x92, 0xca, 0xe0, 0xc0, 0xc5, 0x04, 0x14, 0xf1, 0x05, 0x6f, 0xfb, 0x62, 0xd6,
+0x47, 0x3b, 0x08, 0x06, 0x47, 0x0f, 0xb3, 0x4e, 0xdf, 0x7b, 0xb7, 0xef, 0xc9, 0xd4, 0x17, 0xed},
+{
+0x6a, 0xb7, 0xda, 0x31, 0xa1, 0xbb, 0x23, 0xbd, 0x3b, 0xea, 0xea, 0x60, 0x81, 0x62, 0xc1, 0xa6,
+0xbe, 0xa9, 0x56, 0xfd, 0x51, 0xc9, 0x68, 0xfb, 0x82, 0xcd, 0xa4, 0xe2, 0xf7, 0x50, 0x3f, 0x97,
+0xb1, 0x15, 0x29, 0x45, 0xaf, 0x91, 0x4b, 0xa3, 0x25, 0x74, 0x6f, 0x25, 0x9b, 0x99, 0x61, 0xf8,
+0x85, 0x16, 0xd7, 0x90, 0xbe, 0xbe, 0x64, 0xf9, 0x66, 0x97, 0xd1, 0x31, 0x8b, 0x04, 0xcf, 0xe8},
+{
+0xac, 0xb4, 0x04, 0x10, 0xed, 0xb6, 0x33, 0x66, 0xb5, 0xdc, 0xb6, 0x3d, 0xb6, 0x75, 0x49, 0x78,
+0x10, 0x5c, 0x97, 0x22, 0x24, 0x44, 0x5f, 0x96, 0x9e, 0x96, 0x1a, 0x20, 0xac, 0x3c, 0x8d, 0x15,
+0x1b, 0xe1, 0xbf, 0x68, 0x8b, 0x15, 0x5c, 0x67, 0xa4, 0x8e, 0xbf, 0xe0, 0x12, 0x77, 0x17, 0x67,
+0xb4, 0x19, 0x39, 0xb2, 0x88, 0xe6, 0x00, 0xb6, 0x74, 0xef, 0xec, 0xb6, 0x4c, 0x86, 0xb9, 0x53},
+{
+0xed, 0x9b, 0x52, 0x99, 0xc9, 0x12, 0x3c, 0x12, 0x59, 0xae, 0x37, 0x02, 0x5d, 0x46, 0xf8, 0xbb,
+0xbc, 0x77, 0xd1, 0x88, 0x2b, 0x65, 0x4f, 0xf3, 0x08, 0x38, 0x32, 0x12, 0xbb, 0x6b, 0xb6, 0x3e,
+0x06, 0x78, 0x2f, 0xbe, 0x4f, 0x62, 0x37, 0x79, 0xc1, 0x9a, 0x36, 0x22, 0xc3, 0xe7, 0x44, 0x17,
+0x43, 0x51, 0x5e, 0x12, 0x99, 0x45, 0x0b, 0xfa, 0x8b, 0xee, 0x5a, 0x64, 0xfc, 0xb0, 0x89, 0x3e},
+{
+0xfc, 0xbb, 0xd6, 0xf2, 0x51, 0x11, 0x7e, 0x91, 0x51, 0xf7, 0x79, 0x06, 0x33, 0x7e, 0xa5, 0x7d,
+0x17, 0x95, 0x65, 0x85, 0x49, 0xa1, 0xe3, 0xd3, 0xa1, 0x6c, 0x81, 0xea, 0x83, 0xb2, 0xe3, 0xe4,
+0x80, 0xe9, 0xb9, 0xd4, 0xad, 0x49, 0xed, 0x48, 0xad, 0x1e, 0x3f, 0x0a, 0x3d, 0x4e, 0x03, 0x79,
+0x70, 0x95, 0xc6, 0x0e, 0x3a, 0xbe, 0x9a, 0xf9, 0xbb, 0x22, 0xdd, 0xeb, 0x36, 0x28, 0xbf, 0x5e},
+{
+0x78, 0x35, 0x11, 0xe4, 0x6a, 0xb4, 0x72, 0x16, 0x77, 0x04, 0x3d, 0x9e, 0x63, 0x87, 0x98, 0x7a,
+0xfc, 0x7c, 0xc8, 0xc0, 0xc3, 0x72, 0xcd, 0x2a, 0x1f, 0x02, 0xcd, 0xc5, 0xf9, 0xc5, 0x5e, 0x61,
+0x9d, 0x83, 0xa5, 0x8d, 0xcd, 0xdb, 0xec, 0x50, 0xee, 0x02, 0xab, 0x3c, 0xbe, 0x36, 0xf5, 0x8b,
+0xf9, 0xc2, 0x99, 0x29, 0x3e, 0x8e, 0x1b, 0x73, 0x22, 0x07, 0x7d, 0x36, 0x0b, 0xc8, 0xb9, 0xe0},
+{
+0xb1, 0xc8, 0x18, 0x94, 0x09, 0x0e, 0x73, 0x71, 0x16, 0x73, 0xf8, 0x62, 0x13, 0x36, 0x9e, 0x4a,
+0x77, 0x01, 0x21, 0xdb, 0xc1, 0x91, 0x7a, 0xfe, 0xde, 0xc7, 0x97, 0x09, 0xed, 0x57, 0x4e, 0x66,
+0x21, 0xd0, 0x19, 0xd0, 0xe0, 0x70, 0x8d, 0x25, 0x99, 0x68, 0x3e, 0xa6, 0x08, 0xff, 0x81, 0x90,
+0x95, 0x53, 0x53, 0x5b, 0x42, 0xee, 0xc6, 0x7a, 0xff, 0x55, 0xbe, 0x89, 0x69, 0x85, 0x5a, 0x1e},
+{
+0x7b, 0x9e, 0x67, 0x45, 0xd2, 0xc4, 0xd7, 0x59, 0xe2, 0x26, 0x4b, 0x47, 0x7c, 0xb2, 0xf3, 0x0d,
+0xf6, 0xf3, 0x5b, 0x3e, 0x6b, 0xe8, 0xfc, 0x7c, 0x29, 0x6d, 0x26, 0xd8, 0x36, 0xd0, 0x77, 0x08,
+0xa6, 0x50, 0x43, 0xe7, 0x12, 0xab, 0xf8, 0x68, 0xa4, 0xe8, 0x24, 0x64, 0xc5, 0xb7, 0x23, 0x42,
+0x43, 0x4d, 0xf1, 0x3a, 0xb4, 0xcd, 0x96, 0xba, 0x57, 0xcb, 0xce, 0xe4, 0x2d, 0x32, 0xb4, 0xdc},
+{
+0x4c, 0x36, 0x53, 0x70, 0x6c, 0x59, 0x41, 0x68, 0xed, 0x1f, 0x17, 0x8d, 0x77, 0x56, 0x99, 0x82,
+0x78, 0xfe, 0x11, 0x30, 0xab, 0xbd, 0x93, 0x68, 0xe8, 0x99, 0x00, 0x85, 0xdc, 0xf2, 0x88, 0xc8,
+0x58, 0x71, 0x0a, 0x61, 0xe3, 0x87, 0x11, 0xd0, 0x6c, 0x4c, 0x53, 0x00, 0xaf, 0xee, 0x02, 0x9b,
+0x95, 0x02, 0x31, 0xb9, 0x48, 0xd6, 0x0b, 0x44, 0x1b, 0xc4, 0x93, 0x70, 0x7e, 0xf0, 0xca, 0xd5},
+{
+0x8b, 0x9b, 0xa2, 0x26, 0x09, 0xaa, 0xd0, 0x3b, 0x39, 0xcb, 0x83, 0x5e, 0x8e, 0xa7, 0x4b, 0xf5,
+0x5a, 0x12, 0x6f, 0xc9, 0x57, 0xd4, 0x39, 0xc1, 0xdc, 0x43, 0xbf, 0xa9, 0x90, 0x26, 0x6a, 0x4e,
+0x14, 0xfb, 0x32, 0x01, 0x17, 0x88, 0x5b, 0xa0, 0xad, 0x7c, 0x0d, 0x95, 0x09, 0x68, 0x91, 0x9f,
+0x2c, 0x86, 0xef, 0xfb, 0x43, 0xa4, 0xc9, 0x4c, 0x6d, 0x30, 0x31, 0xd8, 0x7d, 0xf9, 0x38, 0x25},
+{
+0x34, 0x15, 0x64, 0x94, 0x18, 0x92, 0xf4, 0x70, 0xcc, 0xee, 0x93, 0x43, 0x5e, 0xd7, 0x37, 0x25,
+0xae, 0x24, 0x83, 0x5a, 0x06, 0x50, 0x4e, 0x57, 0x91, 0xd1, 0x42, 0xa5, 0x8e, 0xd7, 0x95, 0xe8,
+0xd1, 0xa8, 0xd9, 0x92, 0x3a, 0xa7, 0x83, 0x60, 0x7b, 0x4f, 0x40, 0x20, 0xc8, 0x02, 0xb3, 0x48,
+0x65, 0x27, 0x85, 0xaa, 0x06, 0xaa, 0x1a, 0x66, 0x40, 0x4b, 0x60, 0x04, 0x28, 0x15, 0xb3, 0x73},
+{
+0xb1, 0x77, 0xbd, 0x9e, 0xd2, 0x5e, 0x9b, 0x3f, 0xbe, 0xaa, 0xf8, 0x07, 0x7a, 0x9b, 0x06, 0xe1,
+0xce, 0x40, 0xc0, 0xc0, 0xe3, 0x7b, 0xb4, 0xe4, 0x8b, 0xd4, 0x6c, 0x96, 0xec, 0x30, 0xc8, 0x59,
+0xe4, 0x3e, 0x3d, 0x08, 0x5a, 0x26, 0x21, 0xa2, 0x3d, 0x2c, 0x78, 0x5d, 0x3c, 0xc0, 0x99, 0x19,
+0x0d, 0x1b, 0xae, 0x12, 0x89, 0x59, 0xf7, 0xda, 0x61, 0x23, 0x2d, 0x00, 0x43, 0x39, 0x16, 0x09},
+{
+0x97, 0x69, 0xda, 0xa4, 0x0f, 0x7e, 0x74, 0xc4, 0x09, 0x8b, 0x79, 0x5e, 0x60, 0x9d, 0xda, 0x23,
+0xf9, 0xad, 0x69, 0xa0, 0xc0, 0x75, 0x31, 0x56, 0x1f, 0xf0, 0xc0, 0x18, 0x3c, 0x5d, 0x92, 0xf8,
+0x31, 0x9a, 0xc6, 0x37, 0x85, 0xee, 0xa5, 0x47, 0xdf, 0xde, 0xc9, 0x7b, 0x0e, 0x46, 0x13, 0x03,
+0x8d, 0x15, 0x8e, 0x41, 0x89, 0xd4, 0x57, 0x9d, 0x1a, 0xa7, 0x0f, 0x69, 0xe2, 0xff, 0xe4, 0x53},
+{
+0xed, 0x36, 0x2b, 0x67, 0x8c, 0x44, 0xcd, 0xb8, 0x1c, 0xe9, 0x42, 0x3f, 0x8a, 0xd6, 0x12, 0x33,
+0x0a, 0x6c, 0x6d, 0xae, 0x60, 0x6b, 0x6f, 0x9c, 0x19, 0xdb, 0x53, 0x91, 0x75, 0x0e, 0xb1, 0xf7,
+0xbf, 0x4c, 0xa9, 0xf3, 0x57, 0x55, 0xf1, 0x43, 0x8c, 0xad, 0x90, 0x17, 0xb4, 0xf9, 0x35, 0xa1,
+0xd4, 0x3a, 0x2d, 0x2d, 0xec, 0xca, 0x2f, 0x12, 0x67, 0xa0, 0xab, 0x29, 0x6f, 0xc7, 0xca, 0x72},
+{
+0x3c, 0x37, 0x78, 0xd8, 0x06, 0x57, 0x08, 0xa0, 0xf7, 0xa2, 0xc3, 0x5a, 0xaf, 0x72, 0xd1, 0x2c,
+0xc0, 0x99, 0x59, 0x4d, 0xf9, 0x41, 0x05, 0xd1, 0x5b, 0x20, 0x05, 0x32, 0x30, 0x3a, 0x03, 0x3d,
+0x7d, 0xb0, 0x45, 0x17, 0x91, 0x33, 0x5d, 0xe5, 0x47, 0xe7, 0x37, 0x5d, 0x89, 0x9c, 0xab, 0x79,
+0x1c, 0xd2, 0x10, 0x40, 0x07, 0x59, 0x3f, 0x66, 0x1b, 0x7c, 0x5c, 0xfd, 0xe2, 0xc1, 0xf8, 0x71},
+{
+0x0b, 0x14, 0xec, 0x54, 0x87, 0xda, 0x62, 0x2d, 0x25, 0x9b, 0xf3, 0x14, 0x33, 0x60, 0x3e, 0xaf,
+0x8e, 0x54, 0xd8, 0x70, 0xc4, 0xbf, 0x13, 0x6b, 0x0d, 0xbe, 0xb2, 0x09, 0xa1, 0x8b, 0x84, 0x8a,
+0xb0, 0xe4, 0xa4, 0x48, 0x95, 0x59, 0x1a, 0xb8, 0x7b, 0x64, 0xd9, 0x57, 0xc0, 0xe2, 0xf3, 0xeb,
+0x13, 0x5c, 0x36, 0x08, 0x7d, 0x24, 0x71, 0x3c, 0x9e, 0x61, 0xc7, 0xfa, 0xf2, 0xf7, 0x88, 0xa0},
+{
+0xeb, 0xce, 0x2a, 0x43, 0x0f, 0x34, 0xd9, 0x25, 0xd6, 0x65, 0x8f, 0xf7, 0x74, 0xbd, 0xf8, 0x1f,
+0x5d, 0x95, 0x2b, 0xf5, 0x43, 0x73, 0x6a, 0xc4, 0xcd, 0x2a, 0x26, 0x69, 0x15, 0x6c, 0xb4, 0xae,
+0x43, 0xda, 0x1b, 0x14, 0xe0, 0x66, 0x6a, 0xed, 0xa4, 0xda, 0xef, 0xf3, 0x1b, 0x1d, 0xd6, 0x29,
+0x94, 0x3e, 0x5b, 0x19, 0xcb, 0xaf, 0xa3, 0x2f, 0x3e, 0x40, 0xea, 0x3c, 0x46, 0xc2, 0xe4, 0xd2},
+{
+0x45, 0x2d, 0xbd, 0x3f, 0xab, 0x9f, 0xc4, 0xae, 0xc1, 0xba, 0x69, 0x4f, 0x3a, 0x46, 0x52, 0x08,
+0xfe, 0xb9, 0xf5, 0xde, 0xa6, 0x8f, 0xcb, 0x0e, 0xb3, 0xb9, 0x42, 0xbc, 0x04, 0x6d, 0x42, 0xd0,
+0xa9, 0xe7, 0xe2, 0xe1, 0xdf, 0x35, 0x95, 0x4f, 0x76, 0x1e, 0xfb, 0xfc, 0x9b, 0xfa, 0x43, 0x12,
+0xa2, 0x3e, 0xbd, 0xe8, 0x3d, 0x50, 0xf6, 0x11, 0x29, 0xb1, 0xda, 0x7d, 0x65, 0x51, 0x99, 0x2a},
+{
+0xe9, 0x89, 0x4a, 0x83, 0x67, 0xfc, 0x83, 0x9a, 0x06, 0x5e, 0xaa, 0x5e, 0xbf, 0xa2, 0x4d, 0x5b,
+0x3d, 0x8e, 0xe7, 0x01, 0xa0, 0x49, 0xc8, 0x41, 0x44, 0xf9, 0x58, 0xe0, 0xd2, 0xa8, 0x8a, 0x67,
+0x96, 0x4a, 0x37, 0xaf, 0xad, 0x45, 0x8c, 0x95, 0x49, 0xf4, 0xdf, 0x2a, 0x6c, 0x3d, 0x3d, 0x98,
+0xa4, 0xc2, 0x99, 0x96, 0x5f, 0xa1, 0xc0, 0xd8, 0x36, 0xc9, 0xc9, 0x17, 0xf9, 0xee, 0xea, 0xce},
+{
+0x7b, 0x0b, 0x95, 0xc1, 0xbe, 0x73, 0x46, 0x81, 0x43, 0x7b, 0xd4, 0xed, 0x3f, 0x04, 0x0c, 0xff,
+0xbd, 0x12, 0xfd, 0xd6, 0xbe, 0x04, 0x0c, 0x42, 0x51, 0x84, 0x89, 0xfa, 0xc5, 0x74, 0x70, 0x2c,
+0x90, 0x86, 0x21, 0xfb, 0x7b, 0x3a, 0xdc, 0x72, 0xb3, 0x63, 0xc4, 0x2c, 0xe1, 0xdb, 0x06, 0x1f,
+0x3e, 0x5d, 0xb3, 0xdb, 0x85, 0x85, 0x1b, 0x9b, 0xdb, 0x7e, 0x6c, 0x76, 0x11, 0x1c, 0x18, 0xb7},
+{
+0x39, 0x0c, 0x56, 0x99, 0x44, 0x29, 0xce, 0x0f, 0x21, 0x62, 0x89, 0x41, 0x31, 0x5f, 0x1e, 0xe4,
+0x14, 0xda, 0xe4, 0x3b, 0x5e, 0xd9, 0x03, 0x54, 0xf8, 0x09, 0xcb, 0x5e, 0x34, 0x82, 0x66, 0xd8,
+0x35, 0xcc, 0xcf, 0xc7, 0xeb, 0x61, 0xe1, 0x81, 0x5b, 0x9e, 0xa9, 0x3a, 0x52, 0x3a, 0xde, 0xbb,
+0xde, 0x7a, 0x2b, 0x5b, 0xf3, 0x8b, 0x01, 0xcb, 0x6a, 0xf2, 0xaf, 0x0a, 0x64, 0xd5, 0xa2, 0x1c},
+{
+0x83, 0xf1, 0x3f, 0x5a, 0x81, 0xfe, 0x5f, 0xcc, 0x59, 0xf8, 0x81, 0x00, 0x36, 0x64, 0xb7, 0x65,
+0xc8, 0xd9, 0xe5, 0x2f, 0x69, 0xda, 0xef, 0x21, 0xc4, 0x4f, 0x02, 0x18, 0xf0, 0xe9, 0xa6, 0x86,
+0xc0, 0x7d, 0x43, 0x61, 0xed, 0xb8, 0x48, 0xbd, 0xe0, 0x90, 0x35, 0xa2, 0x35, 0x4c, 0x0b, 0x50,
+0x48, 0x40, 0x76, 0x42, 0x22, 0xd6, 0x48, 0x1d, 0x38, 0xdb, 0x5e, 0x3b, 0x8f, 0x54, 0x3f, 0x42},
+{
+0xa2, 0xe0, 0xfa, 0x2c, 0xcf, 0x63, 0xb0, 0x3c, 0xd0, 0x15, 0xf9, 0xd5, 0xb3, 0x8f, 0xaf, 0x4d,
+0xb6, 0x52, 0x6c, 0x63, 0x97, 0xa0, 0x90, 0x32, 0x26, 0x03, 0x91, 0x86, 0x32, 0x9f, 0x70, 0xfc,
+0xde, 0xdd, 0x73, 0x61, 0x4e, 0x23, 0xa8, 0x58, 0x72, 0x0a, 0x76, 0x5a, 0x40, 0x75, 0xd8, 0x51,
+0x3f, 0x1f, 0x64, 0x75, 0x1b, 0x56, 0xff, 0xfb, 0x3b, 0xfa, 0x7d, 0x86, 0x32, 0xb2, 0x73, 0x2a},
+{
+0xed, 0xea, 0x18, 0x48, 0xe0, 0xb3, 0x4b, 0xf1, 0x75, 0x10, 0x79, 0x7d, 0x1c, 0x25, 0x66, 0xd6,
+0xa3, 0x2a, 0xe8, 0xec, 0x3f, 0x81, 0x71, 0x5d, 0x53, 0x8b, 0x6f, 0x59, 0xed, 0x23, 0x0c, 0xd2,
+0x8d, 0xdb, 0x72, 0xf3, 0x4f, 0x6d, 0xa2, 0x21, 0x02, 0x70, 0xb2, 0x8e, 0x61, 0xb1, 0x3a, 0xed,
+0xd0, 0x60, 0x0c, 0x2f, 0x38, 0x30, 0x76, 0x0b, 0x71, 0x37, 0x3e, 0x6d, 0xea, 0xa7, 0xa1, 0x69},
+{
+0xf8, 0xb7, 0x06, 0x11, 0x02, 0xa4, 0x9b, 0x88, 0xa7, 0x1d, 0x9c, 0xd3, 0x49, 0x18, 0x2a, 0x5b,
+0x31, 0x5f, 0x04, 0x11, 0x15, 0xb6, 0x1f, 0x30, 0x00, 0x49, 0x08, 0xbc, 0x87, 0x86, 0x0c, 0x0d,
+0x07, 0xae, 0x04, 0xf9, 0xb3, 0x7f, 0x66, 0x84, 0xef, 0x27, 0xf1, 0x96, 0xd2, 0x24, 0x54, 0xd4,
+0xe6, 0xb1, 0xa9, 0xb1, 0x74, 0x9a, 0x54, 0xd6, 0xe4, 0x6d, 0x5d, 0xdf, 0xf7, 0xfb, 0xff, 0x75},
+{
+0x24, 0xc7, 0x34, 0x12, 0x0b, 0x06, 0x35, 0x01, 0x36, 0xd8, 0xe0, 0x09, 0xf5, 0xfd, 0xb6, 0x6c,
+0x34, 0x39, 0x6e, 0x68, 0x8e, 0x79, 0x9a, 0xb2, 0xfb, 0x4f, 0xdf, 0x71, 0x7b, 0x89, 0x63, 0x66,
+0x69, 0xfd, 0xa7, 0x22, 0xee, 0xf8, 0xbe, 0xc8, 0x97, 0x23, 0x54, 0xe9, 0x9f, 0xb5, 0xc2, 0xa8,
+0xa1, 0x99, 0xa6, 0xf1, 0xc6, 0xc9, 0xc0, 0x81, 0x33, 0xf6, 0xbd, 0xcd, 0xf8, 0x18, 0x57, 0x5c},
+{
+0xc3, 0xd5, 0xc4, 0x3d, 0xf9, 0x3b, 0x04, 0x8d, 0x66, 0x80, 0x08, 0x20, 0x7b, 0x96, 0xa4, 0xda,
+0x4a, 0xac, 0xc4, 0xa9, 0x10, 0xa2, 0xc1, 0xef, 0xda, 0x80, 0xf2, 0xfa, 0xc6, 0x14, 0xf2, 0x4d,
+0xe0, 0xc2, 0x75, 0xfa, 0x73, 0xb0, 0x07, 0xcd, 0x2f, 0xbd, 0x5e, 0xbd, 0x74, 0x1a, 0xb3, 0x77,
+0xfa, 0xfa, 0x0c, 0x80, 0xd5, 0x4c, 0x04, 0x5d, 0xe4, 0xc2, 0x12, 0xe8, 0xab, 0xb0, 0xd3, 0xc6},
+{
+0xcf, 0xac, 0x99, 0xce, 0x1c, 0xd1, 0xeb, 0x28, 0x0f, 0xb1, 0x95, 0x84, 0xa6, 0x29, 0x4b, 0x3e,
+0x44, 0x1a, 0x34, 0x46, 0x7f, 0x5d, 0x4a, 0xec, 0x8c, 0x2a, 0x11, 0x3e, 0x4a, 0x25, 0x66, 0x3e,
+0xdd, 0x02, 0xaa, 0x6e, 0x14, 0x52, 0xbd, 0x78, 0x3e, 0x85, 0x1b, 0x42, 0xb9, 0x4e, 0x82, 0xed,
+0xa8, 0x2a, 0x19, 0xd7, 0xfd, 0xb5, 0xe1, 0xc9, 0x8c, 0x7e, 0x6a, 0x99, 0x9b, 0x2e, 0xa1, 0x7b},
+{
+0xd6, 0x5b, 0x57, 0x88, 0x1c, 0x7d, 0xbc, 0xa2, 0x36, 0x44, 0x28, 0x0c, 0xc1, 0x82, 0xd8, 0x16,
+0x85, 0x75, 0xa4, 0x22, 0x42, 0x92, 0x45, 0xfa, 0x15, 0xbf, 0x7a, 0x6b, 0x58, 0x70, 0x33, 0xfe,
+0x8d, 0x31, 0xe0, 0x46, 0x6c, 0x50, 0x46, 0x90, 0xe8, 0x0a, 0xba, 0x7c, 0x51, 0x68, 0x0f, 0x4e,
+0x81, 0x05, 0x16, 0xea, 0xd2, 0x1b, 0xa1, 0xd3, 0x63, 0x94, 0xca, 0xe5, 0x38, 0x80, 0x47, 0xc7},
+{
+0x90, 0x34, 0xcf, 0x9a, 0xd4, 0xb7, 0x23, 0x5d, 0x5f, 0x14, 0xac, 0x6e, 0x4d, 0x4b, 0x27, 0x73,
+0x94, 0x32, 0x9a, 0xc1, 0x8e, 0xed, 0x27, 0x10, 0x8f, 0xfa, 0x16, 0x4b, 0x93, 0xe5, 0xc3, 0x6b,
+0x1e, 0x5f, 0x05, 0xeb, 0x6e, 0x1b, 0x01, 0xd0, 0xf7, 0x11, 0x9f, 0xd8, 0x2b, 0x19, 0x79, 0xdb,
+0xd5, 0x01, 0x8a, 0xc9, 0xbd, 0xbf, 0x1a, 0x91, 0xb8, 0x96, 0x55, 0xa3, 0xe9, 0x3f, 0x1e, 0x69},
+{
+0x67, 0x7e, 0x17, 0x71, 0x2b, 0xdc, 0x12, 0x61, 0x53, 0x86, 0xb3, 0xec, 0x5a, 0xae, 0x19, 0xbf,
+0x34, 0x42, 0x34, 0x27, 0x74, 0x23, 0xd0, 0x59, 0x75, 0xaf, 0xa7, 0x7a, 0x2b, 0x8e, 0x47, 0x2e,
+0xe2, 0xee, 0x20, 0xd9, 0x02, 0xeb, 0x2e, 0xa9, 0x0b, 0x91, 0x9f, 0x2c, 0x94, 0x88, 0x61, 0x03,
+0x98, 0xb4, 0x52, 0x96, 0xfa, 0xbf, 0xd9, 0x9b, 0xfe, 0x73, 0x70, 0x30, 0x79, 0xc0, 0xa5, 0xb3},
+{
+0xe5, 0x0c, 0x41, 0x3c, 0xdb, 0x3b, 0x8d, 0x08, 0x22, 0xaa, 0x8f, 0x50, 0x5d, 0x6c, 0xbc, 0xa1,
+0x88, 0x18, 0xad, 0xf4, 0x29, 0x64, 0xd9, 0x58, 0x4d, 0x45, 0xce, 0x23, 0x6e, 0xd7, 0x26, 0xd5,
+0x2d, 0x33, 0x00, 0xfe, 0x17, 0xa9, 0xa8, 0x0d, 0xb9, 0x7f, 0xef, 0x95, 0x16, 0x97, 0x22, 0x04,
+0xd4, 0x09, 0xf5, 0x01, 0xc6, 0x57, 0xcf, 0x44, 0xbc, 0xe2, 0x23, 0xef, 0x3f, 0xaa, 0xf1, 0x2f},
+{
+0xb2, 0xd1, 0x34, 0x24, 0xa7, 0xb0, 0xce, 0x22, 0xa4, 0xb9, 0x30, 0x1c, 0x32, 0x3d, 0x7f, 0x0b,
+0x5f, 0x7d, 0xc3, 0xed, 0xf8, 0x33, 0x48, 0x42, 0x8c, 0x1f, 0xff, 0x06, 0x6f, 0xb4, 0x4d, 0x8b,
+0x9c, 0xea, 0xc4, 0xb8, 0xc6, 0x92, 0xa5, 0x12, 0x80, 0x69, 0x75, 0x71, 0x10, 0xbd, 0x11, 0xa5,
+0x11, 0x94, 0xbe, 0x0e, 0x0c, 0x4d, 0x85, 0x06, 0x12, 0x1f, 0x65, 0x46, 0xcf, 0x06, 0x95, 0xb8},
+{
+0x0d, 0xab, 0x8c, 0xab, 0xe3, 0x40, 0xcd, 0x1d, 0x50, 0x15, 0xd8, 0x49, 0xdd, 0xb8, 0xf8, 0x93,
+0xad, 0x2d, 0xe2, 0x38, 0xfa, 0xfe, 0x5e, 0x43, 0xb5, 0xf7, 0xe1, 0x7e, 0x9e, 0x28, 0x42, 0x19,
+0xd5, 0xa7, 0x6b, 0xc8, 0x18, 0xd0, 0x05, 0xf8, 0xc4, 0xbc, 0x76, 0xe9, 0x01, 0x98, 0x11, 0x75,
+0x98, 0xae, 0x72, 0x79, 0x26, 0xa4, 0x97, 0x3b, 0xca, 0x42, 0x3a, 0xcc, 0x08, 0x43, 0xc6, 0x17},
+{
+0x2a, 0xbc, 0x1e, 0xc8, 0x7f, 0xbb, 0xae, 0x69, 0x47, 0x84, 0x80, 0x3b, 0xbf, 0x5b, 0x92, 0x34,
+0xa1, 0xa8, 0x9c, 0x49, 0x29, 0xc2, 0x2c, 0x40, 0xae, 0xe6, 0xba, 0xb6, 0x19, 0x0d, 0xf5, 0x66,
+0xb6, 0x3b, 0x9b, 0x20, 0x29, 0xf1, 0x7b, 0x93, 0x45, 0x54, 0x4c, 0x97, 0xb8, 0x56, 0x3b, 0x70,
+0x7a, 0xed, 0xec, 0x7a, 0x50, 0x54, 0x8e, 0xa3, 0x00, 0x8f, 0x2b, 0x25, 0x7b, 0x5c, 0xdc, 0x5f},
+{
+0x89, 0x62, 0x1e, 0xd1, 0x1e, 0xa3, 0xb0, 0xfe, 0x7a, 0x66, 0x41, 0x82, 0x53, 0xa2, 0xc2, 0xce,
+0xa5, 0x4d, 0x84, 0xed, 0x6f, 0x09, 0x89, 0x61, 0xee, 0x91, 0x12, 0xf0, 0xfd, 0x36, 0x4c, 0xde,
+0x41, 0x56, 0x60, 0xa9, 0xc9, 0x0a, 0xbf, 0x21, 0x60, 0xab, 0x46, 0x17, 0x14, 0xd9, 0xbe, 0x7c,
+0xb9, 0x25, 0xa9, 0xc3, 0xe2, 0x4a, 0xd9, 0x35, 0x04, 0x56, 0x48, 0x97, 0x5d, 0xb7, 0xe7, 0x1d},
+{
+0x39, 0xc4, 0x1e, 0x5a, 0xdf, 0x26, 0xf9, 0x58, 0xe2, 0x76, 0x8d, 0xc1, 0xdc, 0x9f, 0x44, 0x77,
+0xad, 0x52, 0x23, 0x1f, 0x8c, 0x38, 0x48, 0x50, 0xd5, 0xce, 0xe9, 0xe4, 0xca, 0xe2, 0x46, 0x74,
+0x00, 0xfa, 0x64, 0x45, 0xeb, 0xc2, 0x09, 0x89, 0x5c, 0x51, 0x6e, 0x56, 0x6b, 0x67, 0x88, 0x74,
+0x60, 0x65, 0xaf, 0x31, 0xdc, 0xad, 0x91, 0xcc, 0x04, 0x2a, 0xe6, 0x7b, 0xb7, 0x4b, 0xe0, 0x74},
+{
+0x93, 0xdc, 0xf9, 0xfd, 0xae, 0xd5, 0x5d, 0x1f, 0xda, 0x0f, 0x7f, 0xcc, 0xbf, 0x8f, 0x16, 0x88,
+0x57, 0x04, 0x8b, 0x0b, 0x44, 0xf3, 0xfd, 0x5e, 0x8e, 0xce, 0x33, 0x84, 0xd0, 0x4f, 0x89, 0x39,
+0x5a, 0x0e, 0x5f, 0xc6, 0x1b, 0x95, 0xc0, 0xdc, 0xcb, 0xb1, 0x10, 0xbb, 0x17, 0xe5, 0x0e, 0x15,
+0x96, 0x3d, 0xa4, 0x5a, 0xc9, 0x0a, 0x1a, 0xf8, 0x9d, 0x1a, 0x20, 0xcd, 0x99, 0xbb, 0x82, 0x67},
+{
+0xd9, 0x1a, 0x92, 0x08, 0x05, 0x34, 0x7e, 0x14, 0x05, 0x0f, 0x13, 0xc8, 0xb9, 0x5c, 0x18, 0xf6,
+0x3e, 0x25, 0x81, 0x60, 0xfa, 0x08, 0x64, 0x79, 0x6a, 0x64, 0x17, 0x99, 0x79, 0x1f, 0xdd, 0x97,
+0xa4, 0x94, 0xa2, 0x7c, 0x99, 0x88, 0xd2, 0xe3, 0x58, 0x9a, 0xdd, 0x0f, 0x7a, 0x1a, 0xb3, 0x3a,
+0x63, 0x18, 0xf5, 0xfc, 0xa2, 0x10, 0xea, 0x57, 0x10, 0x67, 0xea, 0x37, 0x70, 0x16, 0x09, 0x98},
+{
+0xe9, 0x64, 0x39, 0xdb, 0x39, 0xf6, 0xce, 0x72, 0x12, 0xa4, 0x7c, 0x97, 0x9e, 0xe6, 0x51, 0x3c,
+0x34, 0x27, 0xe8, 0x4a, 0x30, 0xa2, 0x7e, 0x9f, 0x40, 0x89, 0x2b, 0xc6, 0xa6, 0x5c, 0x5c, 0xc9,
+0x44, 0xad, 0x66, 0xe0, 0x82, 0x83, 0x6d, 0x5c, 0x7b, 0x55, 0x53, 0x33, 0x76, 0xff, 0x5a, 0x09,
+0xbe, 0x4b, 0xdb, 0x9d, 0xbe, 0x19, 0x1b, 0xc2, 0x9e, 0x62, 0x89, 0xc5, 0x88, 0x82, 0xc3, 0x4b},
+{
+0x76, 0x21, 0x8a, 0xc4, 0x0c, 0x9d, 0x65, 0xb4, 0x49, 0xf8, 0x05, 0xb2, 0x67, 0xef, 0xa0, 0x21,
+0xe7, 0xd0, 0x87, 0xd9, 0xef, 0xd2, 0x6e, 0x78, 0xbb, 0xf7, 0x85, 0x82, 0x8a, 0x42, 0x22, 0x4b,
+0x5d, 0x2c, 0x72, 0x2b, 0x56, 0x48, 0x33, 0xc2, 0xf6, 0x25, 0x40, 0x6b, 0x58, 0x70, 0x5a, 0x45,
+0xf5, 0x1d, 0x24, 0x90, 0x72, 0xb5, 0xfc, 0x62, 0x11, 0x4f, 0x8b, 0xf0, 0xd8, 0xf8, 0xa2, 0xd2},
+{
+0xe1, 0x20, 0xc6, 0xaf, 0xe5, 0x84, 0x2e, 0xac, 0x17, 0xfd, 0x97, 0xfe, 0xdd, 0x47, 0xf4, 0x4e,
+0x60, 0xaa, 0x7f, 0x2f, 0xc1, 0x72, 0x4c, 0x61, 0xb8, 0xca, 0x43, 0x2e, 0x31, 0x29, 0x41, 0xe4,
+0x9a, 0x0d, 0x9f, 0x02, 0x6d, 0xe0, 0xc8, 0x9f, 0xe2, 0xdb, 0x6f, 0x58, 0x91, 0xf8, 0xef, 0x1f,
+0xcd, 0xf9, 0x75, 0x76, 0xf3, 0x00, 0x07, 0x77, 0x7e, 0x02, 0x57, 0x22, 0x66, 0xc4, 0x0a, 0x58},
+{
+0x81, 0x3d, 0x2f, 0x1c, 0x4a, 0xb5, 0xf7, 0xba, 0x39, 0xe1, 0xba, 0x49, 0xa0, 0x5b, 0xe9, 0x60,
+0x50, 0xb7, 0x44, 0xdd, 0x9e, 0xbf, 0xf9, 0xb0, 0x1f, 0x83, 0x57, 0x30, 0x84, 0x2a, 0xcb, 0x82,
+0x64, 0x7f, 0x24, 0xc7, 0xc4, 0x16, 0xf6, 0xde, 0x3d, 0xf6, 0x74, 0x37, 0x61, 0x00, 0xb6, 0x3d,
+0xa9, 0x08, 0xfe, 0x57, 0x08, 0x17, 0x0e, 0x94, 0xa7, 0x66, 0xd3, 0x2f, 0x99, 0x67, 0x41, 0xb2},
+{
+0xea, 0xfc, 0xc9, 0x8f, 0xdd, 0xd0, 0xec, 0xb0, 0x94, 0x83, 0xff, 0x11, 0x41, 0x59, 0x01, 0x89,
+0x19, 0x9c, 0xc6, 0xf9, 0x27, 0xfc, 0x7a, 0xe7, 0x8e, 0x00, 0x12, 0xa5, 0xe3, 0x74, 0xc1, 0x46,
+0x47, 0x3d, 0xce, 0xd3, 0xf5, 0x23, 0x6d, 0xe3, 0x1e, 0xab, 0x28, 0x3d, 0x60, 0x99, 0x90, 0x1d,
+0x9f, 0x67, 0x42, 0x29, 0xac, 0x5b, 0x86, 0x0e, 0xe8, 0x6e, 0x6f, 0x9d, 0x65, 0xad, 0x45, 0x49},
+{
+0x9e, 0xc0, 0xf8, 0xb7, 0xad, 0x9b, 0xb5, 0xb5, 0xf9, 0xfb, 0x05, 0xbc, 0xf1, 0x2e, 0x29, 0xc9,
+0x39, 0xd2, 0x1e, 0x95, 0xf7, 0xaa, 0x46, 0x80, 0xd6, 0x5e, 0xd2, 0xaf, 0x90, 0xf8, 0xaf, 0x4b,
+0x2e, 0x8d, 0xc7, 0x0d, 0xd2, 0xd8, 0xb7, 0x69, 0xac, 0x70, 0x53, 0xa9, 0x03, 0x18, 0xc6, 0xe2,
+0xd3, 0x8c, 0x74, 0x61, 0x54, 0xdc, 0xd1, 0x19, 0x7a, 0x6c, 0x66, 0xeb, 0x18, 0x6a, 0x64, 0x3b},
+{
+0x92, 0xb6, 0x12, 0xf5, 0xb1, 0x6f, 0x24, 0xd7, 0x36, 0xb9, 0x5a, 0x48, 0x9e, 0x05, 0x4b, 0x43,
+0xad, 0xc0, 0xfa, 0xef, 0x5b, 0x2d, 0x4c, 0x3b, 0xa5, 0x49, 0x0b, 0xd4, 0x99, 0x22, 0xf2, 0xf6,
+0xe3, 0x21, 0xc8, 0x7e, 0x53, 0x0d, 0xeb, 0x1b, 0x30, 0x1e, 0xc8, 0x8e, 0x8c, 0xde, 0x06, 0xa8,
+0x84, 0x0c, 0xc3, 0x79, 0xbc, 0x5d, 0xb1, 0x2d, 0x00, 0x79, 0xf9, 0xe4, 0x72, 0xb3, 0xc9, 0xd3},
+{
+0x02, 0x71, 0x6d, 0x88, 0x86, 0x9f, 0xf1, 0x88, 0xfd, 0xf7, 0x6e, 0xf7, 0x13, 0xb2, 0x3e, 0xe8,
+0x48, 0x9a, 0x6e, 0x1e, 0xe1, 0x11, 0xdc, 0x80, 0x31, 0x3a, 0xfb, 0xe6, 0x02, 0xfe, 0x10, 0x06,
+0xe3, 0x23, 0x53, 0x00, 0x20, 0xc3, 0x3b, 0xa3, 0x17, 0x6a, 0x00, 0xf1, 0xa2, 0x8f, 0x73, 0x50,
+0x47, 0xab, 0x88, 0x4e, 0x55, 0x11, 0x46, 0x79, 0x89, 0x3b, 0x43, 0x22, 0xab, 0xf5, 0x15, 0xec},
+{
+0x9a, 0xd9, 0x61, 0x02, 0x72, 0x1f, 0x2d, 0x87, 0xb0, 0x6a, 0xa7, 0xbe, 0x0b, 0xa9, 0xca, 0x17,
+0xb6, 0x18, 0x2e, 0x78, 0x01, 0x57, 0xfb, 0xd1, 0x51, 0x42, 0xf1, 0x69, 0x7b, 0xff, 0xa6, 0xbc,
+0xa7, 0x9a, 0x73, 0x12, 0x99, 0x20, 0x0d, 0xa6, 0x26, 0x96, 0xfa, 0xf7, 0xdf, 0xea, 0x0c, 0x5a,
+0x21, 0xd1, 0x53, 0x00, 0x1d, 0xc5, 0xf7, 0x7f, 0xa1, 0xb1, 0x64, 0x4b, 0x92, 0xce, 0xd0, 0x0e},
+{
+0x77, 0x23, 0xc7, 0x37, 0x2a, 0x25, 0x8d, 0xa7, 0x19, 0x33, 0x19, 0x7c, 0x55, 0x77, 0xca, 0xbd,
+0xae, 0x37, 0xb5, 0x47, 0x48, 0x5f, 0x1d, 0xe0, 0x7c, 0x35, 0xca, 0x70, 0xc0, 0x22, 0xa8, 0xf3,
+0x6f, 0x7e, 0x6f, 0x22, 0x66, 0xf4, 0x7b, 0x9c, 0x9f, 0xc8, 0xdb, 0xb6, 0xa0, 0xac, 0xd0, 0xab,
+0x3a, 0x53, 0x3c, 0x40, 0x69, 0x2c, 0x6e, 0x95, 0x48, 0xcb, 0xff, 0x8f, 0x4a, 0x3f, 0x88, 0x28},
+{
+0x5b, 0x13, 0x57, 0xc6, 0x82, 0x5a, 0x6d, 0xf8, 0x66, 0x93, 0xcf, 0x1a, 0xb1, 0x4c, 0xdc, 0x06,
+0xc6, 0xb5, 0x0e, 0x67, 0xa3, 0x62, 0x1a, 0xaf, 0x0d, 0x70, 0xef, 0x1d, 0x01, 0xbe, 0x98, 0xd7,
+0x5a, 0x3f, 0x29, 0x07, 0x98, 0xa3, 0x24, 0x74, 0xd5, 0x54, 0x15, 0x7c, 0x25, 0x58, 0x6b, 0x66,
+0x77, 0x8f, 0xf7, 0xf9, 0x2a, 0x15, 0xda, 0x72, 0x4c, 0x57, 0x08, 0xfc, 0xae, 0x65, 0x3e, 0x4d}
+};
+#else
+#error "ECDSA_COMB_TEETH must be 2, 4 or 8. Use gen_comb to generate other tables."
+#endif // #if ECDSA_COMB_TEETH == 2
+
+#endif // #ifndef ECDSA_COMB_TABLE_H_INCLUDED
@@ -0,0 +1,456 @@
+/** \file main.c
+  *
+  * \brief Entry point for the host-side device emulator.
+  *
+  * The emulator runs the platform-independent firmware (processPacket() and
+  * everything it calls) as an ordinary host process. It listens on a TCP
+  * port or a UNIX-domain socket, and serves one connection at a time; the
+  * bytes on the connection are exactly the packets described in PROTOCOL.
+  * When the host disconnects, the emulator waits for the next connection.
+  * Non-volatile storage is kept in a file (see nv_file.c) and the user is
+  * emulated (see user_interface.c).
+  *
+  * With -r, the packets which the host sends are also written to a capture
+  * file (see packet_capture.c). With -R, the emulator doesn't listen at all;
+  * instead, it replays a capture file as if a host had sent it and reports
+  * how long each processPacket() call took. This turns real workloads into
+  * repeatable performance regression tests. Replay from a copy of the
+  * non-volatile storage file as it was when the capture started, so that
+  * the requests see the same wallets.
+  *
+  * This is meant for testing and load-testing host software and for
+  * measuring protocol throughput. It is not a secure wallet: keys are kept in
+  * ordinary process memory and the storage file is not protected.
+  *
+  * This file is licensed as described by the file LICENCE.
+  */
+
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+#include "../common.h"
+#include "../diagnostics.h"
+#include "../hwinterface.h"
+#include "../stream_comm.h"
+#include "nv_file.h"
+#include "packet_capture.h"
+#include "socket_stream.h"
+#include "user_interface.h"
+
+/** Default TCP port to listen on. */
+#define DEFAULT_TCP_PORT		5000
+/** Default name of the file which holds non-volatile storage. */
+#define DEFAULT_NV_FILENAME		"emulator_nv.bin"
+/** How much of the process's stack, below main(), to measure the usage of
+  * (see getStackBounds()). This is much more than the firmware needs, but
+  * much less than the usual host stack size limit. */
+#define MEASURED_STACK_SIZE		(128 * 1024)
+
+/** Where streamDisconnected() goes back to. */
+static jmp_buf disconnect_jump;
+/** Address of a local variable in main(), which is treated as the top of the
+  * stack. */
+static uint8_t *main_stack_top;
+
+/** Called by socket_stream.c when the connection to the host is lost. This
+  * abandons whatever processPacket() was doing, just as unplugging a real
+  * device would. */
+void streamDisconnected(void)
+{
+	longjmp(disconnect_jump, 1);
+}
+
+/** This will be called whenever something very unexpected occurs. This
+  * function must not return. */
+void fatalError(void)
+{
+	fprintf(stderr, "Fatal error\n");
+	exit(1);
+}
+
+/** PBKDF2 is used to derive encryption keys. This returns the same number
+  * of iterations as the LPC11Uxx port, so that key derivation is compatible
+  * with it.
+  * \return Number of iterations to use in PBKDF2 algorithm.
+  */
+uint32_t getPBKDF2Iterations(void)
+{
+	return 128;
+}
+
+/** Number of bytes returned by successful calls to
+  * hardwareRandom32Bytes(). */
+static uint32_t bytes_delivered;
+
+/** Fill buffer with 32 random bytes from the host's random number
+  * generator.
+  * \param buffer The buffer to fill. This should have enough space for 32
+  *               bytes.
+  * \return The number of bits of entropy in the buffer (256) on success, or
+  *         a negative number if the host's random number generator couldn't
+  *         be read.
+  */
+int hardwareRandom32Bytes(uint8_t *buffer)
+{
+	int fd;
+	ssize_t r;
+
+	fd = open("/dev/urandom", O_RDONLY);
+	if (fd < 0)
+	{
+		return -1;
+	}
+	r = read(fd, buffer, 32);
+	close(fd);
+	if (r != 32)
+	{
+		return -1;
+	}
+	bytes_delivered += 32;
+	return 256;
+}
+
+/** Get health and throughput statistics for the HWRNG. The host's random
+  * number generator isn't tested, so only the number of bytes delivered is
+  * reported.
+  * \param out_health The statistics will be written here.
+  *                   See #HWRNGHealthStruct.
+  */
+void getHWRNGHealth(HWRNGHealth *out_health)
+{
+	memset(out_health, 0, sizeof(*out_health));
+	out_health->bytes_delivered = bytes_delivered;
+}
+
+/** Overwrite anything in RAM which could contain sensitive data. This does
+  * nothing, since the emulator makes no attempt to protect its memory. */
+void sanitiseRam(void)
+{
+}
+
+#ifdef ENABLE_KEEP_UNLOCKED
+/** Get the number of seconds since some arbitrary fixed point in time.
+  * \return The number of seconds, modulo 2 ^ 32.
+  */
+uint32_t getSecondsCounter(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint32_t)now.tv_sec;
+}
+#endif // #ifdef ENABLE_KEEP_UNLOCKED
+
+#if defined(ENABLE_BENCHMARK) || defined(ENABLE_DIAGNOSTICS)
+/** Get the current value of a free-running counter which counts
+  * nanoseconds, modulo 2 ^ 32.
+  * \return The current value of the counter.
+  */
+uint32_t getCycleCount(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint32_t)now.tv_sec * 1000000000u + (uint32_t)now.tv_nsec;
+}
+#endif // #if defined(ENABLE_BENCHMARK) || defined(ENABLE_DIAGNOSTICS)
+
+#ifdef ENABLE_DIAGNOSTICS
+/** Get the region of the stack to measure the usage of. The host's stack
+  * has no fixed size, so this is the #MEASURED_STACK_SIZE bytes
+  * below main().
+  * \param out_bottom Will be set to the lowest address of the region.
+  * \param out_top Will be set to one past the highest address of the region.
+  */
+void getStackBounds(uint8_t **out_bottom, uint8_t **out_top)
+{
+	*out_bottom = main_stack_top - MEASURED_STACK_SIZE;
+	*out_top = main_stack_top;
+}
+#endif // #ifdef ENABLE_DIAGNOSTICS
+
+/** Create a socket which listens for connections.
+  * \param unix_path If this is not NULL, the socket will be a UNIX-domain
+  *                  socket with this path. Otherwise, it will be a TCP
+  *                  socket.
+  * \param port The TCP port to listen on (on the loopback interface only).
+  *             This is ignored if unix_path is not NULL.
+  * \return The listening socket, or -1 if it couldn't be created.
+  */
+static int createListeningSocket(const char *unix_path, unsigned int port)
+{
+	int fd;
+	int one;
+	struct sockaddr_un un_address;
+	struct sockaddr_in in_address;
+
+	if (unix_path != NULL)
+	{
+		if (strlen(unix_path) >= sizeof(un_address.sun_path))
+		{
+			return -1;
+		}
+		fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (fd < 0)
+		{
+			return -1;
+		}
+		memset(&un_address, 0, sizeof(un_address));
+		un_address.sun_family = AF_UNIX;
+		strcpy(un_address.sun_path, unix_path);
+		unlink(unix_path);
+		if (bind(fd, (struct sockaddr *)&un_address, sizeof(un_address)) != 0)
+		{
+			close(fd);
+			return -1;
+		}
+	}
+	else
+	{
+		fd = socket(AF_INET, SOCK_STREAM, 0);
+		if (fd < 0)
+		{
+			return -1;
+		}
+		one = 1;
+		setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+		memset(&in_address, 0, sizeof(in_address));
+		in_address.sin_family = AF_INET;
+		in_address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		in_address.sin_port = htons((uint16_t)port);
+		if (bind(fd, (struct sockaddr *)&in_address, sizeof(in_address)) != 0)
+		{
+			close(fd);
+			return -1;
+		}
+	}
+	if (listen(fd, 1) != 0)
+	{
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+/** Handle packets from a connected host until it disconnects.
+  * \param fd The connected socket.
+  */
+static void serveConnection(int fd)
+{
+	setStreamConnection(fd);
+	if (setjmp(disconnect_jump) == 0)
+	{
+		while (true)
+		{
+			processPacket();
+			streamFlush();
+		}
+	}
+}
+
+/** Replay a capture file (see packet_capture.c), as if a host had sent it,
+  * and print how long each processPacket() call took, followed by a summary
+  * for each packet type. Everything the emulator sends is discarded.
+  * \param filename The name of the capture file.
+  * \return false on success, true if the capture file could not be opened.
+  */
+static bool replayCapture(const char *filename)
+{
+	int fd;
+	uint8_t header[4];
+	unsigned int packet_type;
+	// These are volatile because they are used after a longjmp() back to
+	// the setjmp() below (if the capture ends in the middle of a packet).
+	volatile unsigned int packet_number;
+	volatile uint64_t total_elapsed;
+	uint64_t elapsed;
+	struct timespec start;
+	struct timespec end;
+	uint32_t counts[256];
+	uint64_t sums[256];
+	uint64_t maximums[256];
+	unsigned int i;
+
+	fd = open(filename, O_RDONLY);
+	if (fd < 0)
+	{
+		return true;
+	}
+	memset(counts, 0, sizeof(counts));
+	memset(sums, 0, sizeof(sums));
+	memset(maximums, 0, sizeof(maximums));
+	total_elapsed = 0;
+	packet_number = 0;
+	setStreamReplay(fd);
+	printf("packet\ttype\tmicroseconds\n");
+	if (setjmp(disconnect_jump) == 0)
+	{
+		// The type of the packet which starts each processPacket() call is
+		// what it's reported under. Any interjection responses (eg.
+		// ButtonAck) are part of the same call.
+		while (!streamPeekBytes(header, sizeof(header)))
+		{
+			packet_type = header[3];
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			processPacket();
+			streamFlush();
+			clock_gettime(CLOCK_MONOTONIC, &end);
+			elapsed = (uint64_t)(end.tv_sec - start.tv_sec) * 1000000000u + (uint64_t)end.tv_nsec - (uint64_t)start.tv_nsec;
+			printf("%u\t0x%02x\t%llu\n", packet_number, packet_type, (unsigned long long)(elapsed / 1000));
+			counts[packet_type]++;
+			sums[packet_type] += elapsed;
+			maximums[packet_type] = MAX(maximums[packet_type], elapsed);
+			total_elapsed += elapsed;
+			packet_number++;
+		}
+	}
+	close(fd);
+
+	printf("\ntype\tcount\tmean us\tmax us\n");
+	for (i = 0; i < 256; i++)
+	{
+		if (counts[i] != 0)
+		{
+			printf("0x%02x\t%u\t%llu\t%llu\n", i, (unsigned int)counts[i], (unsigned long long)(sums[i] / counts[i] / 1000), (unsigned long long)(maximums[i] / 1000));
+		}
+	}
+	printf("Total: %u packets in %llu us\n", packet_number, (unsigned long long)(total_elapsed / 1000));
+	return false;
+}
+
+/** Print command-line usage information.
+  * \param program_name The name of the emulator executable.
+  */
+static void printUsage(const char *program_name)
+{
+	fprintf(stderr, "Usage: %s [-p port | -u socket_path | -R capture_file] [-f nv_file] [-r capture_file] [-d] [-q]\n", program_name);
+	fprintf(stderr, "  -p port         Listen on this TCP port on 127.0.0.1 (default: %d)\n", DEFAULT_TCP_PORT);
+	fprintf(stderr, "  -u socket_path  Listen on this UNIX-domain socket instead\n");
+	fprintf(stderr, "  -R capture_file Replay this capture instead of listening, and time each packet\n");
+	fprintf(stderr, "  -f nv_file      Keep non-volatile storage in this file (default: %s)\n", DEFAULT_NV_FILENAME);
+	fprintf(stderr, "  -r capture_file Record what the host sends to this file, with secrets redacted\n");
+	fprintf(stderr, "  -d              Deny every request which needs user approval\n");
+	fprintf(stderr, "  -q              Don't print what a real device would display\n");
+}
+
+/** Entry point for the emulator. See printUsage() for the arguments.
+  * \param argc Number of command-line arguments.
+  * \param argv Command-line arguments.
+  * \return Only returns if something went wrong while starting up (with a
+  *         non-zero exit status) or after replaying a capture.
+  */
+int main(int argc, char **argv)
+{
+	int option;
+	unsigned int port;
+	const char *unix_path;
+	const char *nv_filename;
+	const char *capture_filename;
+	const char *replay_filename;
+	bool always_deny;
+	bool quiet;
+	int listen_fd;
+	int connection_fd;
+	int one;
+
+	main_stack_top = (uint8_t *)&option;
+	diagnosticsPaintStack();
+
+	port = DEFAULT_TCP_PORT;
+	unix_path = NULL;
+	nv_filename = DEFAULT_NV_FILENAME;
+	capture_filename = NULL;
+	replay_filename = NULL;
+	always_deny = false;
+	quiet = false;
+	while ((option = getopt(argc, argv, "p:u:f:r:R:dq")) != -1)
+	{
+		switch (option)
+		{
+		case 'p':
+			port = (unsigned int)atoi(optarg);
+			break;
+		case 'u':
+			unix_path = optarg;
+			break;
+		case 'f':
+			nv_filename = optarg;
+			break;
+		case 'r':
+			capture_filename = optarg;
+			break;
+		case 'R':
+			replay_filename = optarg;
+			break;
+		case 'd':
+			always_deny = true;
+			break;
+		case 'q':
+			quiet = true;
+			break;
+		default:
+			printUsage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (openNVFile(nv_filename))
+	{
+		fprintf(stderr, "Could not open \"%s\"\n", nv_filename);
+		return 1;
+	}
+	initUserInterface(always_deny, quiet);
+	if (replay_filename != NULL)
+	{
+		if (replayCapture(replay_filename))
+		{
+			fprintf(stderr, "Could not open \"%s\"\n", replay_filename);
+			return 1;
+		}
+		return 0;
+	}
+	if ((capture_filename != NULL) && openCaptureFile(capture_filename))
+	{
+		fprintf(stderr, "Could not open \"%s\"\n", capture_filename);
+		return 1;
+	}
+	listen_fd = createListeningSocket(unix_path, port);
+	if (listen_fd < 0)
+	{
+		fprintf(stderr, "Could not listen for connections\n");
+		return 1;
+	}
+
+	while (true)
+	{
+		connection_fd = accept(listen_fd, NULL, NULL);
+		if (connection_fd < 0)
+		{
+			continue;
+		}
+		if (unix_path == NULL)
+		{
+			// Packets are small and the host usually waits for each
+			// response, so don't let Nagle's algorithm delay them.
+			one = 1;
+			setsockopt(connection_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+		}
+		if (!quiet)
+		{
+			fprintf(stderr, "Host connected\n");
+		}
+		serveConnection(connection_fd);
+		close(connection_fd);
+		if (!quiet)
+		{
+			fprintf(stderr, "Host disconnected\n");
+		}
+	}
+}
@@ -0,0 +1,233 @@
+/** \file nv_file.c
+  *
+  * \brief Implements non-volatile storage using a file.
+  *
+  * The global partition is stored at the start of the file, followed by the
+  * accounts partition. The file persists between runs of the emulator, so
+  * wallets survive restarts, just like they would on a real device. A new
+  * file is filled with 0xff, which is what erased flash memory reads as.
+  *
+  * Unlike real flash memory, writes can set bits from 0 to 1. That doesn't
+  * matter to platform-independent code, which never relies on writes
+  * failing to do so.
+  *
+  * This file is licensed as described by the file LICENCE.
+  */
+
+#include <stdio.h>
+#include "../common.h"
+#include "../hwinterface.h"
+#include "../diagnostics.h"
+#include "../trace.h"
+#include "nv_file.h"
+
+#ifndef NV_GLOBAL_PARTITION_SIZE
+/** Size of global partition, in bytes. This is the same as the PIC32 port's,
+  * and can be overridden by defining NV_GLOBAL_PARTITION_SIZE. */
+#define NV_GLOBAL_PARTITION_SIZE	1024
+#endif // #ifndef NV_GLOBAL_PARTITION_SIZE
+
+#ifndef NV_ACCOUNTS_PARTITION_SIZE
+/** Size of accounts partition, in bytes. This is much larger than the real
+  * devices', so that load tests can create lots of wallets. It can be
+  * overridden by defining NV_ACCOUNTS_PARTITION_SIZE. */
+#define NV_ACCOUNTS_PARTITION_SIZE	65536
+#endif // #ifndef NV_ACCOUNTS_PARTITION_SIZE
+
+/** The file which holds the contents of non-volatile storage. */
+static FILE *nv_file;
+
+/** Open (creating it if necessary) the file which will hold the contents
+  * of non-volatile storage. If the file is shorter than the total size of
+  * all partitions, it is extended with 0xff bytes.
+  * \param filename The name of the file.
+  * \return false on success, true if the file could not be opened or
+  *         extended.
+  */
+bool openNVFile(const char *filename)
+{
+	long size;
+
+	nv_file = fopen(filename, "r+b");
+	if (nv_file == NULL)
+	{
+		nv_file = fopen(filename, "w+b");
+		if (nv_file == NULL)
+		{
+			return true;
+		}
+	}
+	if (fseek(nv_file, 0, SEEK_END) != 0)
+	{
+		return true;
+	}
+	size = ftell(nv_file);
+	if (size < 0)
+	{
+		return true;
+	}
+	for (; size < (NV_GLOBAL_PARTITION_SIZE + NV_ACCOUNTS_PARTITION_SIZE); size++)
+	{
+		if (fputc(0xff, nv_file) == EOF)
+		{
+			return true;
+		}
+	}
+	return fflush(nv_file) != 0;
+}
+
+/** Get size of a partition.
+  * \param out_size On success, the size of the partition (in number of bytes)
+  *                 will be written here.
+  * \param partition Partition to query. Must be one of #NVPartitions.
+  * \return See #NonVolatileReturnEnum for return values.
+  */
+NonVolatileReturn nonVolatileGetSize(uint32_t *out_size, NVPartitions partition)
+{
+	if (partition == PARTITION_GLOBAL)
+	{
+		*out_size = NV_GLOBAL_PARTITION_SIZE;
+		return NV_NO_ERROR;
+	}
+	else if (partition == PARTITION_ACCOUNTS)
+	{
+		*out_size = NV_ACCOUNTS_PARTITION_SIZE;
+		return NV_NO_ERROR;
+	}
+	else
+	{
+		return NV_INVALID_ADDRESS;
+	}
+}
+
+/** Check that an area lies within a partition, and seek to the start of it.
+  * \param partition The partition the area is in. Must be one
+  *                  of #NVPartitions.
+  * \param address Byte offset of the start of the area, within the
+  *                partition.
+  * \param length The size of the area, in bytes.
+  * \return See #NonVolatileReturnEnum for return values.
+  */
+static NonVolatileReturn seekToArea(NVPartitions partition, uint32_t address, uint32_t length)
+{
+	uint32_t size;
+	long offset;
+	NonVolatileReturn r;
+
+	r = nonVolatileGetSize(&size, partition);
+	if (r != NV_NO_ERROR)
+	{
+		return r;
+	}
+	if ((address > size) || (length > (size - address)))
+	{
+		return NV_INVALID_ADDRESS;
+	}
+	offset = (long)address;
+	if (partition == PARTITION_ACCOUNTS)
+	{
+		offset += NV_GLOBAL_PARTITION_SIZE;
+	}
+	if (fseek(nv_file, offset, SEEK_SET) != 0)
+	{
+		return NV_IO_ERROR;
+	}
+	return NV_NO_ERROR;
+}
+
+/** Write to non-volatile storage.
+  * \param data A pointer to the data to be written.
+  * \param partition The partition to write to. Must be one of #NVPartitions.
+  * \param address Byte offset specifying where in the partition to
+  *                start writing to.
+  * \param length The number of bytes to write.
+  * \return See #NonVolatileReturnEnum for return values.
+  */
+NonVolatileReturn nonVolatileWrite(uint8_t *data, NVPartitions partition, uint32_t address, uint32_t length)
+{
+	NonVolatileReturn r;
+
+	r = seekToArea(partition, address, length);
+	if (r != NV_NO_ERROR)
+	{
+		return r;
+	}
+	if (fwrite(data, 1, (size_t)length, nv_file) != (size_t)length)
+	{
+		return NV_IO_ERROR;
+	}
+	diagnosticsNVEvent(DIAGNOSTICS_NV_WRITE);
+	return NV_NO_ERROR;
+}
+
+/** Fill an area of non-volatile storage with a single byte value.
+  * \param partition The partition to fill. Must be one of #NVPartitions.
+  * \param address Byte offset specifying where in the partition to
+  *                start filling.
+  * \param length The number of bytes to fill.
+  * \param value The byte value to fill the area with.
+  * \return See #NonVolatileReturnEnum for return values.
+  */
+NonVolatileReturn nonVolatileFill(NVPartitions partition, uint32_t address, uint32_t length, uint8_t value)
+{
+	NonVolatileReturn r;
+
+	r = seekToArea(partition, address, length);
+	if (r != NV_NO_ERROR)
+	{
+		return r;
+	}
+	for (; length > 0; length--)
+	{
+		if (fputc(value, nv_file) == EOF)
+		{
+			return NV_IO_ERROR;
+		}
+	}
+	diagnosticsNVEvent(DIAGNOSTICS_NV_WRITE);
+	return NV_NO_ERROR;
+}
+
+/** Read from non-volatile storage.
+  * \param data A pointer to the buffer which will receive the data.
+  * \param partition The partition to read from. Must be one of #NVPartitions.
+  * \param address Byte offset specifying where in the partition to
+  *                start reading from.
+  * \param length The number of bytes to read.
+  * \return See #NonVolatileReturnEnum for return values.
+  */
+NonVolatileReturn nonVolatileRead(uint8_t *data, NVPartitions partition, uint32_t address, uint32_t length)
+{
+	NonVolatileReturn r;
+
+	r = seekToArea(partition, address, length);
+	if (r != NV_NO_ERROR)
+	{
+		return r;
+	}
+	if (fread(data, 1, (size_t)length, nv_file) != (size_t)length)
+	{
+		return NV_IO_ERROR;
+	}
+	diagnosticsNVEvent(DIAGNOSTICS_NV_READ);
+	return NV_NO_ERROR;
+}
+
+/** Ensure that all buffered writes are committed to the file.
+  * \return See #NonVolatileReturnEnum for return values.
+  */
+NonVolatileReturn nonVolatileFlush(void)
+{
+	NonVolatileReturn r;
+
+	r = NV_NO_ERROR;
+	diagnosticsBeginNVFlush();
+	traceEvent(TRACE_NV_FLUSH_BEGIN, 0);
+	if (fflush(nv_file) != 0)
+	{
+		r = NV_IO_ERROR;
+	}
+	traceEvent(TRACE_NV_FLUSH_END, r);
+	diagnosticsEndNVFlush();
+	return r;
+}
@@ -0,0 +1,13 @@
+/** \file nv_file.h
+  *
+  * \brief Describes functions exported by nv_file.c.
+  *
+  * This file is licensed as described by the file LICENCE.
+  */
+
+#ifndef EMULATOR_NV_FILE_H_INCLUDED
+#define EMULATOR_NV_FILE_H_INCLUDED
+
+extern bool openNVFile(const char *filename);
+
+#endif // #ifndef EMULATOR_NV_FILE_H_INCLUDED
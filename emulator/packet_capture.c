@@ -0,0 +1,278 @@
+/** \file packet_capture.c
+  *
+  * \brief Records the packets which the host sends, so that they can be
+  *        replayed later.
+  *
+  * If capturing is enabled (see openCaptureFile()), everything the host
+  * sends is written to the capture file, packet by packet. The capture file
+  * is in the same format as the stream itself (see PROTOCOL), like the .bin
+  * files in pic32/testers, so it can be replayed by the emulator's replay
+  * mode (see main.c) or sent to a real device.
+  *
+  * Fields which contain secrets (passwords, seeds and the initial entropy
+  * pool) are redacted: every byte of their contents is replaced with
+  * #REDACTED_BYTE. Lengths are kept, and the same secret is always redacted
+  * the same way, so a capture still replays the same way as the original
+  * session, as long as that session didn't depend on anything which
+  * existed before the capture started (for example, a wallet which was
+  * created with a password before the capture started can't be loaded
+  * during replay, but one created during the capture can).
+  *
+  * This file is licensed as described by the file LICENCE.
+  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "../common.h"
+#include "../stream_comm.h"
+#include "packet_capture.h"
+
+/** Length, in bytes, of a packet header. */
+#define PACKET_HEADER_LENGTH	8
+/** What each byte of a secret is replaced with. */
+#define REDACTED_BYTE			'x'
+/** Maximum payload length, in bytes, of a packet which contains a secret.
+  * Those packets have to be buffered until they are complete, so that they
+  * can be redacted. If one is longer than this, its whole payload is
+  * redacted. */
+#define MAX_SECRET_PAYLOAD		4096
+
+/** The file which packets are written to, or NULL if capturing is
+  * disabled. */
+static FILE *capture_file;
+/** Header of the packet currently being received. */
+static uint8_t header[PACKET_HEADER_LENGTH];
+/** Number of bytes of #header which have been received. */
+static unsigned int header_received;
+/** Payload length of the packet currently being received, from its
+  * header. */
+static uint32_t payload_length;
+/** Number of bytes of the payload of the packet currently being received
+  * which have been received. */
+static uint32_t payload_received;
+/** Field number of the secret in the packet currently being received, or
+  * 0 if it doesn't contain a secret. */
+static uint32_t secret_field;
+/** Buffer for the payload of the packet currently being received, if it
+  * contains a secret. */
+static uint8_t secret_payload[MAX_SECRET_PAYLOAD];
+
+/** Open the capture file and start capturing. If the file already exists,
+  * it is overwritten.
+  * \param filename The name of the file.
+  * \return false on success, true if the file could not be opened.
+  */
+bool openCaptureFile(const char *filename)
+{
+	capture_file = fopen(filename, "wb");
+	if (capture_file == NULL)
+	{
+		return true;
+	}
+	header_received = 0;
+	return false;
+}
+
+/** Find out which field of a packet contains a secret.
+  * \param packet_type The type of the packet (see #PacketTypes).
+  * \return The field number of the secret (see messages.proto), or 0 if
+  *         that type of packet doesn't contain a secret.
+  */
+static uint32_t getSecretField(uint16_t packet_type)
+{
+	switch (packet_type)
+	{
+	case PACKET_TYPE_PIN_ACK:
+		return 1; // password
+	case PACKET_TYPE_NEW_WALLET:
+		return 2; // password
+	case PACKET_TYPE_LOAD_WALLET:
+		return 2; // password
+	case PACKET_TYPE_CHANGE_KEY:
+		return 1; // password
+	case PACKET_TYPE_RESTORE_WALLET:
+		return 2; // seed
+	case PACKET_TYPE_FORMAT:
+		return 1; // initial_entropy_pool
+	case PACKET_TYPE_GET_WALLET_SNAPSHOT:
+		return 8; // password
+	default:
+		return 0;
+	}
+}
+
+/** Read a protocol buffer varint.
+  * \param buffer The buffer to read from.
+  * \param length The length of buffer, in bytes.
+  * \param position The index into buffer to read from. This will be
+  *                 advanced past the varint.
+  * \param out_value The value of the varint will be written here. Only the
+  *                  least significant 32 bits are kept.
+  * \return false on success, true if the varint is truncated.
+  */
+static bool readVarint(const uint8_t *buffer, uint32_t length, uint32_t *position, uint32_t *out_value)
+{
+	unsigned int shift;
+	uint8_t one_byte;
+
+	*out_value = 0;
+	shift = 0;
+	do
+	{
+		if (*position >= length)
+		{
+			return true;
+		}
+		one_byte = buffer[*position];
+		(*position)++;
+		if (shift < 32)
+		{
+			*out_value |= (uint32_t)(one_byte & 0x7f) << shift;
+		}
+		shift += 7;
+	} while ((one_byte & 0x80) != 0);
+	return false;
+}
+
+/** Replace the contents of every occurrence of a length-delimited field in
+  * a message with #REDACTED_BYTE. Parsing stops at the first thing which
+  * doesn't look like a valid field; the device would reject such a message
+  * anyway.
+  * \param payload The message (packet payload).
+  * \param length The length of the message, in bytes.
+  * \param field The field number of the field to redact.
+  */
+static void redactField(uint8_t *payload, uint32_t length, uint32_t field)
+{
+	uint32_t position;
+	uint32_t key;
+	uint32_t value;
+
+	position = 0;
+	while (position < length)
+	{
+		if (readVarint(payload, length, &position, &key))
+		{
+			return;
+		}
+		switch (key & 7)
+		{
+		case 0: // varint
+			if (readVarint(payload, length, &position, &value))
+			{
+				return;
+			}
+			break;
+		case 1: // 64 bit
+			position += 8;
+			break;
+		case 2: // length-delimited
+			if (readVarint(payload, length, &position, &value))
+			{
+				return;
+			}
+			value = MIN(value, length - position);
+			if ((key >> 3) == field)
+			{
+				memset(&(payload[position]), REDACTED_BYTE, value);
+			}
+			position += value;
+			break;
+		case 5: // 32 bit
+			position += 4;
+			break;
+		default:
+			return;
+		}
+	}
+}
+
+/** Write everything which has been buffered for a packet which contains a
+  * secret, with the secret redacted. */
+static void writeSecretPacket(void)
+{
+	if (payload_length > MAX_SECRET_PAYLOAD)
+	{
+		memset(secret_payload, REDACTED_BYTE, sizeof(secret_payload));
+	}
+	else
+	{
+		redactField(secret_payload, payload_length, secret_field);
+	}
+	fwrite(header, 1, sizeof(header), capture_file);
+	// Anything past #MAX_SECRET_PAYLOAD is written by captureBytes().
+	fwrite(secret_payload, 1, MIN(payload_length, MAX_SECRET_PAYLOAD), capture_file);
+}
+
+/** Record bytes which were received from the host. This does nothing if
+  * capturing is disabled.
+  * \param buffer The received bytes.
+  * \param length The number of bytes in buffer.
+  */
+void captureBytes(const uint8_t *buffer, size_t length)
+{
+	size_t i;
+	uint32_t count;
+
+	if (capture_file == NULL)
+	{
+		return;
+	}
+	i = 0;
+	while (i < length)
+	{
+		if (header_received < PACKET_HEADER_LENGTH)
+		{
+			header[header_received] = buffer[i];
+			header_received++;
+			i++;
+			if (header_received == PACKET_HEADER_LENGTH)
+			{
+				payload_length = ((uint32_t)header[4] << 24) | ((uint32_t)header[5] << 16)
+					| ((uint32_t)header[6] << 8) | (uint32_t)header[7];
+				payload_received = 0;
+				secret_field = getSecretField((uint16_t)(((uint16_t)header[2] << 8) | header[3]));
+				if (secret_field == 0)
+				{
+					fwrite(header, 1, sizeof(header), capture_file);
+				}
+				else if (payload_length == 0)
+				{
+					writeSecretPacket();
+				}
+			}
+		}
+		else
+		{
+			count = (uint32_t)MIN(length - i, payload_length - payload_received);
+			if (secret_field == 0)
+			{
+				fwrite(&(buffer[i]), 1, count, capture_file);
+			}
+			else if (payload_received >= MAX_SECRET_PAYLOAD)
+			{
+				// The packet is too long to be redacted properly, so the
+				// rest of it is redacted too.
+				count = MIN(count, MAX_SECRET_PAYLOAD);
+				memset(secret_payload, REDACTED_BYTE, count);
+				fwrite(secret_payload, 1, count, capture_file);
+			}
+			else
+			{
+				count = MIN(count, MAX_SECRET_PAYLOAD - payload_received);
+				memcpy(&(secret_payload[payload_received]), &(buffer[i]), count);
+				if ((payload_received + count) == MIN(payload_length, MAX_SECRET_PAYLOAD))
+				{
+					writeSecretPacket();
+				}
+			}
+			payload_received += count;
+			i += count;
+		}
+		if ((header_received == PACKET_HEADER_LENGTH) && (payload_received == payload_length))
+		{
+			header_received = 0; // on to the next packet
+		}
+	}
+	fflush(capture_file);
+}
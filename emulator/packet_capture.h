@@ -0,0 +1,16 @@
+/** \file packet_capture.h
+  *
+  * \brief Describes functions exported by packet_capture.c.
+  *
+  * This file is licensed as described by the file LICENCE.
+  */
+
+#ifndef EMULATOR_PACKET_CAPTURE_H_INCLUDED
+#define EMULATOR_PACKET_CAPTURE_H_INCLUDED
+
+#include <stddef.h>
+
+extern bool openCaptureFile(const char *filename);
+extern void captureBytes(const uint8_t *buffer, size_t length);
+
+#endif // #ifndef EMULATOR_PACKET_CAPTURE_H_INCLUDED
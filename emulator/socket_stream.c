@@ -0,0 +1,274 @@
+/** \file socket_stream.c
+  *
+  * \brief Implements the communication stream on top of a connected socket.
+  *
+  * The socket can be a TCP or UNIX-domain stream socket; main.c sets it up
+  * and passes the connected descriptor to setStreamConnection(). Both
+  * directions are buffered, so that a packet costs a few system calls
+  * instead of one per streamGetOneByte()/streamPutOneByte(). Buffered
+  * output is sent whenever the emulator is about to wait for input (so that
+  * interjections like ButtonRequest reach the host before the emulator
+  * waits for the host's reply) and by streamFlush().
+  *
+  * There is no flow control or error detection here, because the
+  * socket already does all that.
+  *
+  * Everything received is passed to captureBytes() (see packet_capture.c).
+  * For replaying a capture, the connection can also be a file, in which
+  * case everything sent is discarded (see setStreamReplay()).
+  *
+  * This file is licensed as described by the file LICENCE.
+  */
+
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include "../common.h"
+#include "../hwinterface.h"
+#include "packet_capture.h"
+#include "socket_stream.h"
+
+/** Size, in bytes, of the receive and transmit buffers. */
+#define SOCKET_BUFFER_SIZE		4096
+
+/** The connected socket, or -1 if there is no connection. */
+static int connection_fd = -1;
+/** Bytes which have been received but not yet read. */
+static uint8_t receive_buffer[SOCKET_BUFFER_SIZE];
+/** Index into #receive_buffer of the next byte to read. */
+static size_t receive_start;
+/** Number of valid bytes in #receive_buffer. */
+static size_t receive_end;
+/** Bytes which have been written but not yet sent. */
+static uint8_t transmit_buffer[SOCKET_BUFFER_SIZE];
+/** Number of valid bytes in #transmit_buffer. */
+static size_t transmit_length;
+/** Whether the connection is a capture file being replayed. */
+static bool replaying;
+
+/** Use a new connection for all subsequent stream I/O. Anything left over
+  * from the previous connection is discarded.
+  * \param fd The connected socket.
+  */
+void setStreamConnection(int fd)
+{
+	connection_fd = fd;
+	receive_start = 0;
+	receive_end = 0;
+	transmit_length = 0;
+	replaying = false;
+}
+
+/** Use a capture file (see packet_capture.c) as the host, for all
+  * subsequent stream I/O. Everything sent is discarded.
+  * \param fd The open capture file.
+  */
+void setStreamReplay(int fd)
+{
+	setStreamConnection(fd);
+	replaying = true;
+}
+
+/** Send everything in #transmit_buffer to the host. */
+void streamFlush(void)
+{
+	size_t sent;
+	ssize_t r;
+
+	if (replaying)
+	{
+		transmit_length = 0;
+		return;
+	}
+	sent = 0;
+	while (sent < transmit_length)
+	{
+		r = send(connection_fd, &(transmit_buffer[sent]), transmit_length - sent, MSG_NOSIGNAL);
+		if (r < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			transmit_length = 0;
+			streamDisconnected();
+		}
+		sent += (size_t)r;
+	}
+	transmit_length = 0;
+}
+
+/** Receive more bytes into #receive_buffer, after whatever is already
+  * there. This waits until at least one byte has been received.
+  * \return false on success, true if the connection was closed or a read
+  *         failed.
+  */
+static bool receiveMore(void)
+{
+	ssize_t r;
+
+	// read() instead of recv(), so that this also works on capture files.
+	do
+	{
+		r = read(connection_fd, &(receive_buffer[receive_end]), sizeof(receive_buffer) - receive_end);
+	} while ((r < 0) && (errno == EINTR));
+	if (r <= 0)
+	{
+		return true;
+	}
+	captureBytes(&(receive_buffer[receive_end]), (size_t)r);
+	receive_end += (size_t)r;
+	return false;
+}
+
+/** Wait until #receive_buffer contains at least one byte. */
+static void fillReceiveBuffer(void)
+{
+	if (receive_start < receive_end)
+	{
+		return;
+	}
+	// The host may be waiting for a response before it sends anything else.
+	streamFlush();
+	receive_start = 0;
+	receive_end = 0;
+	if (receiveMore())
+	{
+		streamDisconnected();
+	}
+}
+
+/** Look at the next few bytes from the communication stream, without
+  * removing them from it. This will wait until enough bytes are available.
+  * \param buffer The bytes will be written here. This must have space for
+  *               length bytes.
+  * \param length The number of bytes to look at. This must be less than
+  *               #SOCKET_BUFFER_SIZE.
+  * \return false on success, true if the connection was closed before
+  *         length bytes could be received.
+  */
+bool streamPeekBytes(uint8_t *buffer, size_t length)
+{
+	if ((receive_end - receive_start) < length)
+	{
+		streamFlush();
+		memmove(receive_buffer, &(receive_buffer[receive_start]), receive_end - receive_start);
+		receive_end -= receive_start;
+		receive_start = 0;
+		while (receive_end < length)
+		{
+			if (receiveMore())
+			{
+				return true;
+			}
+		}
+	}
+	memcpy(buffer, &(receive_buffer[receive_start]), length);
+	return false;
+}
+
+/** Grab one byte from the communication stream. This will wait until a byte
+  * is available.
+  * \return The received byte.
+  */
+uint8_t streamGetOneByte(void)
+{
+	fillReceiveBuffer();
+	return receive_buffer[receive_start++];
+}
+
+/** Grab a number of bytes from the communication stream. This behaves
+  * exactly like calling streamGetOneByte() length times.
+  * \param buffer The received bytes will be written here. This must have
+  *               space for length bytes.
+  * \param length The number of bytes to receive.
+  */
+void streamGetBytes(uint8_t *buffer, uint32_t length)
+{
+	size_t count;
+
+	while (length > 0)
+	{
+		fillReceiveBuffer();
+		count = MIN(length, receive_end - receive_start);
+		memcpy(buffer, &(receive_buffer[receive_start]), count);
+		receive_start += count;
+		buffer += count;
+		length -= (uint32_t)count;
+	}
+}
+
+/** Throw away a number of bytes from the communication stream. This behaves
+  * exactly like streamGetBytes(), but whatever has been received is dropped
+  * without being copied anywhere.
+  * \param length The number of bytes to throw away.
+  */
+void streamDiscardBytes(uint32_t length)
+{
+	size_t count;
+
+	while (length > 0)
+	{
+		fillReceiveBuffer();
+		count = MIN(length, receive_end - receive_start);
+		receive_start += count;
+		length -= (uint32_t)count;
+	}
+}
+
+/** Send one byte to the communication stream.
+  * \param one_byte The byte to send.
+  */
+void streamPutOneByte(uint8_t one_byte)
+{
+	if (transmit_length == sizeof(transmit_buffer))
+	{
+		streamFlush();
+	}
+	transmit_buffer[transmit_length++] = one_byte;
+}
+
+/** Send a number of bytes to the communication stream. This behaves
+  * exactly like calling streamPutOneByte() length times.
+  * \param buffer The bytes to send.
+  * \param length The number of bytes to send.
+  */
+void streamPutBytes(const uint8_t *buffer, uint32_t length)
+{
+	size_t count;
+
+	while (length > 0)
+	{
+		if (transmit_length == sizeof(transmit_buffer))
+		{
+			streamFlush();
+		}
+		count = MIN(length, sizeof(transmit_buffer) - transmit_length);
+		memcpy(&(transmit_buffer[transmit_length]), buffer, count);
+		transmit_length += count;
+		buffer += count;
+		length -= (uint32_t)count;
+	}
+}
+
+/** Check whether streamGetOneByte() would return without waiting. This does
+  * not block.
+  * \return true if a byte can be read without waiting, false otherwise.
+  */
+bool streamIsByteAvailable(void)
+{
+	struct pollfd pfd;
+
+	if (receive_start < receive_end)
+	{
+		return true;
+	}
+	pfd.fd = connection_fd;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+	// If the host has disconnected, this will say a byte is available, and
+	// then streamGetOneByte() will find out about the disconnection.
+	return poll(&pfd, 1, 0) > 0;
+}
@@ -0,0 +1,22 @@
+/** \file socket_stream.h
+  *
+  * \brief Describes functions exported by socket_stream.c.
+  *
+  * This file is licensed as described by the file LICENCE.
+  */
+
+#ifndef EMULATOR_SOCKET_STREAM_H_INCLUDED
+#define EMULATOR_SOCKET_STREAM_H_INCLUDED
+
+#include <stddef.h>
+
+extern void setStreamConnection(int fd);
+extern void setStreamReplay(int fd);
+extern void streamFlush(void);
+extern bool streamPeekBytes(uint8_t *buffer, size_t length);
+/** This is called by socket_stream.c when the host closes the connection,
+  * or when a read or write on the connection fails. It must not return,
+  * since streamGetOneByte() and friends have no way to report errors. */
+extern void streamDisconnected(void);
+
+#endif // #ifndef EMULATOR_SOCKET_STREAM_H_INCLUDED
@@ -0,0 +1,144 @@
+/** \file user_interface.c
+  *
+  * \brief Implements a user interface which needs no user.
+  *
+  * Everything the firmware would display is printed to stderr (unless the
+  * emulator was started in quiet mode), and every question is answered
+  * straight away, the same way each time. This lets host software be tested
+  * without anyone pressing buttons. The one-time passwords which a real
+  * device would display are printed too, so that a test harness which wants
+  * to get past the OTP check can read them from stderr.
+  *
+  * This file is licensed as described by the file LICENCE.
+  */
+
+#include <stdio.h>
+#include "../common.h"
+#include "../hwinterface.h"
+#include "../prandom.h"
+#include "user_interface.h"
+
+/** Whether userDenied() denies everything (true) or accepts
+  * everything (false). */
+static bool deny_everything;
+/** Whether to print nothing to stderr. */
+static bool is_quiet;
+
+/** Set how the emulated user behaves.
+  * \param always_deny Use true to make userDenied() deny every request, use
+  *                    false to make it accept every request.
+  * \param quiet Use true to stop anything from being printed to stderr.
+  */
+void initUserInterface(bool always_deny, bool quiet)
+{
+	deny_everything = always_deny;
+	is_quiet = quiet;
+}
+
+/** Notify the user interface that the transaction parser has seen a new
+  * Bitcoin amount/address pair.
+  * \param text_amount The output amount, as a null-terminated text string
+  *                    such as "0.01".
+  * \param text_address The output address, as a null-terminated text string
+  *                     such as "1RaTTuSEN7jJUDiW1EGogHwtek7g9BiEn".
+  * \return false if no error occurred, true if there was not enough space to
+  *         store the amount/address pair.
+  */
+bool newOutputSeen(char *text_amount, char *text_address)
+{
+	if (!is_quiet)
+	{
+		fprintf(stderr, "Output: %s BTC to %s\n", text_amount, text_address);
+	}
+	return false;
+}
+
+/** Notify the user interface that the transaction parser has seen the
+  * transaction fee.
+  * \param text_amount The transaction fee, as a null-terminated text string
+  *                    such as "0.01".
+  */
+void setTransactionFee(char *text_amount)
+{
+	if (!is_quiet)
+	{
+		fprintf(stderr, "Fee: %s BTC\n", text_amount);
+	}
+}
+
+/** Notify the user interface that the list of Bitcoin amount/address pairs
+  * should be cleared. */
+void clearOutputsSeen(void)
+{
+}
+
+/** Inform the user that an address has been generated.
+  * \param address The output address, as a null-terminated text string
+  *                such as "1RaTTuSEN7jJUDiW1EGogHwtek7g9BiEn".
+  * \param num_sigs The number of required signatures to redeem Bitcoins from
+  *                 the address.
+  * \param num_pubkeys The number of public keys involved in the address.
+  */
+void displayAddress(char *address, uint8_t num_sigs, uint8_t num_pubkeys)
+{
+	if (!is_quiet)
+	{
+		fprintf(stderr, "Address (%u of %u): %s\n", (unsigned int)num_sigs, (unsigned int)num_pubkeys, address);
+	}
+}
+
+/** Ask user if they want to allow some action. The answer is always the
+  * same; see initUserInterface().
+  * \param command The action to ask the user about. See #AskUserCommandEnum.
+  * \return false if the user accepted, true if the user denied.
+  */
+bool userDenied(AskUserCommand command)
+{
+	if (!is_quiet)
+	{
+		fprintf(stderr, "%s action %d\n", deny_everything ? "Denying" : "Approving", (int)command);
+	}
+	return deny_everything;
+}
+
+/** Display a short one-time password for the user to see.
+  * \param command The action to ask the user about. See #AskUserCommandEnum.
+  * \param otp The one-time password to display. This will be a
+  *            null-terminated string.
+  */
+void displayOTP(AskUserCommand command, char *otp)
+{
+	if (!is_quiet)
+	{
+		fprintf(stderr, "OTP for action %d: %s\n", (int)command, otp);
+	}
+}
+
+/** Clear the OTP (one-time password) shown by displayOTP(). */
+void clearOTP(void)
+{
+}
+
+/** Write backup seed to stderr, as a hexadecimal string.
+  * \param seed A byte array of length #SEED_LENGTH bytes which contains the
+  *             backup seed.
+  * \param is_encrypted Specifies whether the seed has been encrypted.
+  * \param destination_device Ignored.
+  * \return false on success, true if the backup seed could not be written
+  *         to the destination device.
+  */
+bool writeBackupSeed(uint8_t *seed, bool is_encrypted, uint32_t destination_device)
+{
+	unsigned int i;
+
+	if (!is_quiet)
+	{
+		fprintf(stderr, "Backup seed (%s): ", is_encrypted ? "encrypted" : "unencrypted");
+		for (i = 0; i < SEED_LENGTH; i++)
+		{
+			fprintf(stderr, "%02x", (unsigned int)seed[i]);
+		}
+		fprintf(stderr, "\n");
+	}
+	return false;
+}
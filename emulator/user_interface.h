@@ -0,0 +1,13 @@
+/** \file user_interface.h
+  *
+  * \brief Describes functions exported by user_interface.c.
+  *
+  * This file is licensed as described by the file LICENCE.
+  */
+
+#ifndef EMULATOR_USER_INTERFACE_H_INCLUDED
+#define EMULATOR_USER_INTERFACE_H_INCLUDED
+
+extern void initUserInterface(bool always_deny, bool quiet);
+
+#endif // #ifndef EMULATOR_USER_INTERFACE_H_INCLUDED
@@ -11,8 +11,8 @@
   *   embedded systems it's much faster, results in smaller code and is more
   *   reliable (don't have to worry about potentially buggy floating-point
   *   emulation).
-  * - The FFT size is fixed by #FFT_SIZE. If the FFT size is changed, some
-  *   parts of this file will also need to be modified.
+  * - The FFT size is fixed at compile time by #FFT_SIZE. Twiddle factor
+  *   tables for the supported sizes are in fft_twiddle_table.h.
   * - The use of lookup tables is minimised, resulting in smaller code at
   *   the expense of slightly slower speed.
   * - The aim was for the code to be fast enough so that the LPC11Uxx (running
@@ -20,6 +20,10 @@
   *   on a 22050 Hz bandwidth signal in real-time.
   * - Another aim was to have code size (including required fixed-point
   *   functions) be below 2 kilobytes on ARM Cortex-M0 microcontrollers.
+  * - fft() uses mostly radix-4 stages. If FFT_RADIX2 is defined, it uses
+  *   only radix-2 stages instead; that code is slower but smaller, and
+  *   building the firmware both ways lets the fft_tester programs compare
+  *   the accuracy and speed of the two.
   *
   * This file is licensed as described by the file LICENCE.
   */
@@ -27,6 +31,7 @@
 #include "common.h"
 #include "fix16.h"
 #include "fft.h"
+#include "fft_twiddle_table.h"
 
 /** 3rd level of #R_DEF0 definition. */
 #define R_DEF3(x)	x,			x + 8
@@ -44,41 +49,19 @@
 static const uint8_t bit_reverse_lookup[16] =
 {R_DEF0(0)};
 
-#if FFT_SIZE != 256
-#error "You may need to update twiddle_factor_lookup using gen_twiddle."
+#if FFT_SIZE == 64
+/** log2(#FFT_SIZE); the number of bits in an index into the fft() data
+  * array. */
+#define FFT_SIZE_LOG2	6
+#elif FFT_SIZE == 128
+#define FFT_SIZE_LOG2	7
+#elif FFT_SIZE == 256
+#define FFT_SIZE_LOG2	8
+#elif FFT_SIZE == 512
+#define FFT_SIZE_LOG2	9
+#else
+#error "Unsupported FFT_SIZE; you may need to add a table to fft_twiddle_table.h."
 #endif
-/** Lookup table of twiddle factors (complex roots of unity). This table is
-  * just sin(phi), where phi is in [0, pi / 2). A full lookup table of twiddle
-  * factors would need both sines and cosines for phi in [0, pi), needing 4
-  * times as much space as this table. To recover the other values,
-  * getTwiddleFactor() exploits various symmetries of the sine and cosine
-  * functions.
-  *
-  * The sin(phi) values are multiplied by 65536 and rounded to the nearest
-  * integer. This process assumes that the underlying fixed-point format
-  * is Q16.16.
-  *
-  * Table generated using gen_twiddle.
-  * FFT size: 512.
-  */
-const uint16_t twiddle_factor_lookup[128] = {
-0x0000, 0x0324, 0x0648, 0x096c, 0x0c90, 0x0fb3, 0x12d5, 0x15f7,
-0x1918, 0x1c38, 0x1f56, 0x2274, 0x2590, 0x28ab, 0x2bc4, 0x2edc,
-0x31f1, 0x3505, 0x3817, 0x3b27, 0x3e34, 0x413f, 0x4447, 0x474d,
-0x4a50, 0x4d50, 0x504d, 0x5348, 0x563e, 0x5932, 0x5c22, 0x5f0f,
-0x61f8, 0x64dd, 0x67be, 0x6a9b, 0x6d74, 0x7049, 0x731a, 0x75e6,
-0x78ad, 0x7b70, 0x7e2f, 0x80e8, 0x839c, 0x864c, 0x88f6, 0x8b9a,
-0x8e3a, 0x90d4, 0x9368, 0x95f7, 0x9880, 0x9b03, 0x9d80, 0x9ff7,
-0xa268, 0xa4d2, 0xa736, 0xa994, 0xabeb, 0xae3c, 0xb086, 0xb2c9,
-0xb505, 0xb73a, 0xb968, 0xbb8f, 0xbdaf, 0xbfc7, 0xc1d8, 0xc3e2,
-0xc5e4, 0xc7de, 0xc9d1, 0xcbbc, 0xcd9f, 0xcf7a, 0xd14d, 0xd318,
-0xd4db, 0xd696, 0xd848, 0xd9f2, 0xdb94, 0xdd2d, 0xdebe, 0xe046,
-0xe1c6, 0xe33c, 0xe4aa, 0xe610, 0xe76c, 0xe8bf, 0xea0a, 0xeb4b,
-0xec83, 0xedb3, 0xeed9, 0xeff5, 0xf109, 0xf213, 0xf314, 0xf40c,
-0xf4fa, 0xf5df, 0xf6ba, 0xf78c, 0xf854, 0xf913, 0xf9c8, 0xfa73,
-0xfb15, 0xfbad, 0xfc3b, 0xfcc0, 0xfd3b, 0xfdac, 0xfe13, 0xfe71,
-0xfec4, 0xff0e, 0xff4e, 0xff85, 0xffb1, 0xffd4, 0xffec, 0xfffb
-};
 
 /** Add two complex numbers.
   * \param op1 The first operand.
@@ -135,36 +118,36 @@ static ComplexFixed complexFixedConjugate(ComplexFixed op1)
 	return r;
 }
 
-/** Reverse the bits in an integer. For example, 0x59 (0b01011001) becomes
-  * 0x9A (0b10011010).
-  * \param op1 The integer to reverse.
+/** Reverse the lowest #FFT_SIZE_LOG2 bits in an integer. For example, if
+  * #FFT_SIZE_LOG2 is 8, 0x59 (0b01011001) becomes 0x9A (0b10011010).
+  * \param op1 The integer to reverse. This must be less than #FFT_SIZE.
   * \return The integer, with bits reversed.
-  * \warning The implementation of this function depends on #FFT_SIZE.
-  *          If #FFT_SIZE is changed, the code for this function will also
-  *          need to be changed.
   */
 static uint32_t reverseBits(uint32_t op1)
 {
-#if FFT_SIZE != 256
-#error "You may need to update reverseBits()."
-#endif
-	return ((bit_reverse_lookup[op1 & 15] << 4)
-		+ bit_reverse_lookup[(op1 >> 4) & 15]);
+	uint32_t r;
+
+	r = ((uint32_t)bit_reverse_lookup[op1 & 15] << 12)
+		| ((uint32_t)bit_reverse_lookup[(op1 >> 4) & 15] << 8)
+		| ((uint32_t)bit_reverse_lookup[(op1 >> 8) & 15] << 4)
+		| (uint32_t)bit_reverse_lookup[(op1 >> 12) & 15];
+	return r >> (16 - FFT_SIZE_LOG2);
 }
 
 /** Get the complex twiddle factor (complex root of unity) for a given angle.
   * This function uses the lookup table #twiddle_factor_lookup and complements
   * it with trigonometric symmetries.
-  * \param tf_index The angle, in radian * FFT_SIZE / (2 * pi). This parameter
-  *                 is range-checked.
+  * \param tf_index The angle, in radian * FFT_SIZE / pi. This parameter
+  *                 is range-checked; it must be less than 2 * #FFT_SIZE.
   * \return The complex twiddle factor.
   */
 static ComplexFixed getTwiddleFactor(uint32_t tf_index)
 {
 	ComplexFixed r;
 	uint32_t first_quadrant_tf_index;
+	bool is_negated;
 
-	if (tf_index > FFT_SIZE)
+	if (tf_index >= (2 * FFT_SIZE))
 	{
 		// tf_index too large.
 		r.real = fix16_zero;
@@ -172,6 +155,13 @@ static ComplexFixed getTwiddleFactor(uint32_t tf_index)
 		fix16_error_occurred = true;
 		return r;
 	}
+	is_negated = false;
+	if (tf_index > FFT_SIZE)
+	{
+		// cos(phi + pi) = -cos(phi) and sin(phi + pi) = -sin(phi).
+		tf_index -= FFT_SIZE;
+		is_negated = true;
+	}
 	// tf_index must now be in [0, FFT_SIZE].
 	first_quadrant_tf_index = tf_index;
 	if (tf_index > (FFT_SIZE / 2))
@@ -201,11 +191,60 @@ static ComplexFixed getTwiddleFactor(uint32_t tf_index)
 		// cos(pi - phi) = -cos(phi).
 		r.real = fix16_sub(fix16_zero, r.real);
 	}
+	if (is_negated)
+	{
+		r.real = fix16_sub(fix16_zero, r.real);
+		r.imag = fix16_sub(fix16_zero, r.imag);
+	}
 
 	return r;
 }
 
-/** Perform a complex, in-place Fast Fourier Transform using the radix-2
+#ifndef FFT_RADIX2
+/** Multiply a complex number by -i (for a forward FFT) or i (for an inverse
+  * FFT). This is needed by the radix-4 butterflies in fft(). It only
+  * requires swapping and negating components, so no multiplications
+  * are done.
+  * \param op1 The operand.
+  * \param is_inverse If false, multiply by -i. If true, multiply by i.
+  * \return op1 times -i or i.
+  */
+static ComplexFixed complexFixedRotate(ComplexFixed op1, bool is_inverse)
+{
+	ComplexFixed r;
+
+	if (is_inverse)
+	{
+		r.real = fix16_sub(fix16_zero, op1.imag);
+		r.imag = op1.real;
+	}
+	else
+	{
+		r.real = op1.imag;
+		r.imag = fix16_sub(fix16_zero, op1.real);
+	}
+	return r;
+}
+#endif // #ifndef FFT_RADIX2
+
+/** Get a twiddle factor for fft(), conjugating it if this is a forward FFT.
+  * \param tf_index See getTwiddleFactor().
+  * \param is_inverse Whether the twiddle factor is for an inverse FFT.
+  * \return The complex twiddle factor.
+  */
+static ComplexFixed getFFTTwiddleFactor(uint32_t tf_index, bool is_inverse)
+{
+	ComplexFixed r;
+
+	r = getTwiddleFactor(tf_index);
+	if (!is_inverse)
+	{
+		r = complexFixedConjugate(r);
+	}
+	return r;
+}
+
+/** Perform a complex, in-place Fast Fourier Transform using the
   * Cooley-Tukey algorithm.
   * This does a complex FFT of size #FFT_SIZE. If the input data is purely
   * real, this can do a real FFT of size #FFT_SIZE * 2, but that requires
@@ -220,6 +259,13 @@ static ComplexFixed getTwiddleFactor(uint32_t tf_index)
   * - If the twiddle factor is 1, no multiplication is done. For a size
   *   512 complex FFT, this removes 12.5% of the multiplications, at little
   *   space cost.
+  * - Unless FFT_RADIX2 is defined, pairs of radix-2 stages are merged into
+  *   radix-4 stages. A radix-4 butterfly needs 3 complex multiplications
+  *   instead of the 4 needed by two radix-2 stages, and the fourth root of
+  *   unity (-i or i) is applied by swapping components. For a size 256
+  *   complex FFT, this removes about a third of the remaining
+  *   multiplications, with similar rounding error. If log2(#FFT_SIZE) is
+  *   odd, one radix-2 stage (which has no multiplications) is done first.
   *
   * \param data The input data array. The output of the FFT will also be
   *             written here. This must be an array of size #FFT_SIZE.
@@ -234,12 +280,26 @@ bool fft(ComplexFixed *data, bool is_inverse)
 	uint32_t j;
 	uint32_t pair;
 	uint32_t jump;
-	uint32_t match;
 	uint32_t tf_index; // twiddle factor index
 	uint32_t tf_step; // twiddle factor index increment
+	ComplexFixed temp;
+#ifdef FFT_RADIX2
+	uint32_t match;
 	ComplexFixed factor; // twiddle factor
 	ComplexFixed product;
-	ComplexFixed temp;
+#else
+	ComplexFixed factor1; // twiddle factor for second quarter
+	ComplexFixed factor2; // twiddle factor for third quarter
+	ComplexFixed factor3; // twiddle factor for fourth quarter
+	ComplexFixed a;
+	ComplexFixed b;
+	ComplexFixed c;
+	ComplexFixed d;
+	ComplexFixed sum_ab;
+	ComplexFixed diff_ab;
+	ComplexFixed sum_cd;
+	ComplexFixed diff_cd;
+#endif // #ifdef FFT_RADIX2
 
 	fix16_error_occurred = false;
 
@@ -256,6 +316,7 @@ bool fft(ComplexFixed *data, bool is_inverse)
 	}
 
 	// Perform the actual FFT calculation.
+#ifdef FFT_RADIX2
 	tf_step = FFT_SIZE;
 	for (i = 1; i < FFT_SIZE; i <<= 1)
 	{
@@ -263,11 +324,7 @@ bool fft(ComplexFixed *data, bool is_inverse)
 		tf_index = 0;
 		for (j = 0; j < i; j++)
 		{
-			factor = getTwiddleFactor(tf_index);
-			if (!is_inverse)
-			{
-				factor = complexFixedConjugate(factor);
-			}
+			factor = getFFTTwiddleFactor(tf_index, is_inverse);
 			for (pair = j; pair < FFT_SIZE; pair += jump)
 			{
 				match = pair + i;
@@ -287,6 +344,64 @@ bool fft(ComplexFixed *data, bool is_inverse)
 		}
 		tf_step >>= 1;
 	} // end for (i = 1; i < FFT_SIZE; i <<= 1)
+#else
+#if (FFT_SIZE_LOG2 & 1) != 0
+	// An odd number of radix-2 stages are needed, so do the first one
+	// separately. All of its twiddle factors are 1.
+	for (pair = 0; pair < FFT_SIZE; pair += 2)
+	{
+		temp = data[pair + 1];
+		data[pair + 1] = complexFixedSubtract(data[pair], temp);
+		data[pair] = complexFixedAdd(data[pair], temp);
+	}
+	i = 2;
+#else
+	i = 1;
+#endif // #if (FFT_SIZE_LOG2 & 1) != 0
+	// i is the size of each quarter of a radix-4 butterfly. A butterfly
+	// combines 4 transforms of size i into one transform of size 4 * i.
+	for (; i < FFT_SIZE; i <<= 2)
+	{
+		jump = i << 2;
+		// Twiddle factors are exp(-2 * pi * i * j / jump) (conjugated for an
+		// inverse FFT), which have an angle of 2 * j * FFT_SIZE / jump in the
+		// units used by getTwiddleFactor().
+		tf_step = FFT_SIZE / (i << 1);
+		tf_index = 0;
+		for (j = 0; j < i; j++)
+		{
+			factor1 = getFFTTwiddleFactor(tf_index, is_inverse);
+			factor2 = getFFTTwiddleFactor(2 * tf_index, is_inverse);
+			factor3 = getFFTTwiddleFactor(3 * tf_index, is_inverse);
+			for (pair = j; pair < FFT_SIZE; pair += jump)
+			{
+				a = data[pair];
+				b = data[pair + i];
+				c = data[pair + 2 * i];
+				d = data[pair + 3 * i];
+				// Because of the bit reversal, a, b, c and d are transforms
+				// of the input samples whose indices are congruent to 0, 2,
+				// 1 and 3 (modulo 4) respectively.
+				if (tf_index != 0)
+				{
+					// Save multiplications when all factors are 1.0.
+					b = complexFixedMultiply(factor2, b);
+					c = complexFixedMultiply(factor1, c);
+					d = complexFixedMultiply(factor3, d);
+				}
+				sum_ab = complexFixedAdd(a, b);
+				diff_ab = complexFixedSubtract(a, b);
+				sum_cd = complexFixedAdd(c, d);
+				diff_cd = complexFixedRotate(complexFixedSubtract(c, d), is_inverse);
+				data[pair] = complexFixedAdd(sum_ab, sum_cd);
+				data[pair + i] = complexFixedAdd(diff_ab, diff_cd);
+				data[pair + 2 * i] = complexFixedSubtract(sum_ab, sum_cd);
+				data[pair + 3 * i] = complexFixedSubtract(diff_ab, diff_cd);
+			}
+			tf_index += tf_step;
+		}
+	} // end for (; i < FFT_SIZE; i <<= 2)
+#endif // #ifdef FFT_RADIX2
 
 	if (is_inverse)
 	{
@@ -386,4 +501,59 @@ bool fftPostProcessReal(ComplexFixed *data, bool is_inverse)
 	return fix16_error_occurred;
 }
 
+/** Post-process the results of an inverse complex FFT to get the results of
+  * an inverse real FFT of twice the size, in the special case where the real
+  * input is even-symmetric (input[k] == input[2 * #FFT_SIZE - k]). The
+  * input should be packed as described in fftPostProcessReal(), and fft()
+  * must have been called with is_inverse set.
+  *
+  * The output of such a transform is real (and also even-symmetric), so this
+  * only calculates the real components; the imaginary components are set to
+  * 0. Compared to fftPostProcessReal(), that halves the number of
+  * multiplications. The output is the same as what fftPostProcessReal() would
+  * produce, apart from rounding.
+  * \param data The data array which fft() has operated on. This must be an
+  *             array of size #FFT_SIZE + 1.
+  * \return false for success, true if an arithmetic error (eg. overflow)
+  *         occurred.
+  */
+bool fftPostProcessRealEven(ComplexFixed *data)
+{
+	uint32_t i;
+	uint32_t j;
+	fix16_t real_sum;
+	fix16_t twiddled_imag;
+	fix16_t temp;
+	ComplexFixed twiddle_factor;
+
+	fix16_error_occurred = false;
 
+	// This is the loop in fftPostProcessReal(), with the two halvings (one
+	// to split the spectra, one for the inverse transform) combined and with
+	// only the real part of each result calculated.
+	i = FFT_SIZE / 2;
+	j = FFT_SIZE / 2;
+	while (i != 0)
+	{
+		real_sum = fix16_add(data[i].real, data[j].real);
+		twiddle_factor = getTwiddleFactor(i);
+		twiddled_imag = fix16_add(
+			fix16_mul(fix16_sub(data[i].real, data[j].real), twiddle_factor.imag),
+			fix16_mul(fix16_add(data[i].imag, data[j].imag), twiddle_factor.real));
+		data[i].real = fix16_mul(fix16_add(real_sum, twiddled_imag), FIX16_RECIPROCAL_OF(4));
+		data[i].imag = fix16_zero;
+		data[j].real = fix16_mul(fix16_sub(real_sum, twiddled_imag), FIX16_RECIPROCAL_OF(4));
+		data[j].imag = fix16_zero;
+		i--;
+		j++;
+	}
+
+	// Fix up DC and Nyquist bins.
+	temp = data[0].real;
+	data[0].real = fix16_mul(fix16_add(temp, data[0].imag), FIX16_RECIPROCAL_OF(2));
+	data[FFT_SIZE].real = fix16_mul(fix16_sub(temp, data[0].imag), FIX16_RECIPROCAL_OF(2));
+	data[0].imag = fix16_zero;
+	data[FFT_SIZE].imag = fix16_zero;
+
+	return fix16_error_occurred;
+}
@@ -11,9 +11,10 @@
 #include "common.h"
 #include "fix16.h"
 
-/** The size of the FFT that fft() processes. If this value is changed, then
-  * many things in fft.c need to be changed (those places are marked with
-  * preprocessor checks).
+#ifndef FFT_SIZE
+/** The size of the FFT that fft() processes. This can be overridden at
+  * compile time, but the rest of the firmware (eg. the HWRNG sample buffers)
+  * must be compatible with the new size.
   *
   * Since fft() does a complex FFT, this size refers to the size of the
   * FFT when the input is complex-valued. If the input is real-valued, then
@@ -21,10 +22,12 @@
   * real-valued FFT of twice this size, some post-processing is necessary;
   * see fftPostProcessReal() for more information.
   *
-  * \warning This must be a power of 2, since fft.c uses a radix-2 FFT
-  *          algorithm.
+  * \warning This must be 64, 128, 256 or 512, since those are the sizes
+  *          which fft_twiddle_table.h has twiddle factor tables for. Use
+  *          gen_twiddle to generate tables for other powers of 2.
   */
 #define FFT_SIZE	256
+#endif // #ifndef FFT_SIZE
 
 /** A complex number, in Cartesian coordinates. Numbers are stored in
   * fixed-point format; see #fix16_t for details. */
@@ -38,5 +41,6 @@ typedef struct ComplexFixed_struct
 
 extern bool fft(ComplexFixed *data, bool is_inverse);
 extern bool fftPostProcessReal(ComplexFixed *data, bool is_inverse);
+extern bool fftPostProcessRealEven(ComplexFixed *data);
 
 #endif // #ifndef FFT_H_INCLUDED
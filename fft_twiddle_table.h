@@ -0,0 +1,115 @@
+/** \file fft_twiddle_table.h
+  *
+  * \brief Contains the twiddle factor lookup table used by fft.c.
+  *
+  * The table is just sin(phi), where phi is in [0, pi / 2). A full lookup
+  * table of twiddle factors would need both sines and cosines for phi in
+  * [0, 2 * pi), needing 8 times as much space as this table. To recover the
+  * other values, getTwiddleFactor() exploits various symmetries of the sine
+  * and cosine functions.
+  *
+  * The sin(phi) values are multiplied by 65536 and rounded to the nearest
+  * integer. This process assumes that the underlying fixed-point format
+  * is Q16.16.
+  *
+  * The table size is selected at compile time by #FFT_SIZE. Because
+  * fftPostProcessReal() needs twiddle factors for a FFT of twice the size,
+  * each table was generated by running gen_twiddle with a size of
+  * 2 * #FFT_SIZE.
+  *
+  * This file should only be included by fft.c.
+  *
+  * This file is licensed as described by the file LICENCE.
+  */
+
+#ifndef FFT_TWIDDLE_TABLE_H_INCLUDED
+#define FFT_TWIDDLE_TABLE_H_INCLUDED
+
+#include "common.h"
+#include "fft.h"
+
+#if FFT_SIZE == 64
+// Table generated using gen_twiddle.
+// FFT size: 128.
+static const uint16_t twiddle_factor_lookup[32] = {
+0x0000, 0x0c90, 0x1918, 0x2590, 0x31f1, 0x3e34, 0x4a50, 0x563e,
+0x61f8, 0x6d74, 0x78ad, 0x839c, 0x8e3a, 0x9880, 0xa268, 0xabeb,
+0xb505, 0xbdaf, 0xc5e4, 0xcd9f, 0xd4db, 0xdb94, 0xe1c6, 0xe76c,
+0xec83, 0xf109, 0xf4fa, 0xf854, 0xfb15, 0xfd3b, 0xfec4, 0xffb1
+};
+#elif FFT_SIZE == 128
+// Table generated using gen_twiddle.
+// FFT size: 256.
+static const uint16_t twiddle_factor_lookup[64] = {
+0x0000, 0x0648, 0x0c90, 0x12d5, 0x1918, 0x1f56, 0x2590, 0x2bc4,
+0x31f1, 0x3817, 0x3e34, 0x4447, 0x4a50, 0x504d, 0x563e, 0x5c22,
+0x61f8, 0x67be, 0x6d74, 0x731a, 0x78ad, 0x7e2f, 0x839c, 0x88f6,
+0x8e3a, 0x9368, 0x9880, 0x9d80, 0xa268, 0xa736, 0xabeb, 0xb086,
+0xb505, 0xb968, 0xbdaf, 0xc1d8, 0xc5e4, 0xc9d1, 0xcd9f, 0xd14d,
+0xd4db, 0xd848, 0xdb94, 0xdebe, 0xe1c6, 0xe4aa, 0xe76c, 0xea0a,
+0xec83, 0xeed9, 0xf109, 0xf314, 0xf4fa, 0xf6ba, 0xf854, 0xf9c8,
+0xfb15, 0xfc3b, 0xfd3b, 0xfe13, 0xfec4, 0xff4e, 0xffb1, 0xffec
+};
+#elif FFT_SIZE == 256
+// Table generated using gen_twiddle.
+// FFT size: 512.
+static const uint16_t twiddle_factor_lookup[128] = {
+0x0000, 0x0324, 0x0648, 0x096c, 0x0c90, 0x0fb3, 0x12d5, 0x15f7,
+0x1918, 0x1c38, 0x1f56, 0x2274, 0x2590, 0x28ab, 0x2bc4, 0x2edc,
+0x31f1, 0x3505, 0x3817, 0x3b27, 0x3e34, 0x413f, 0x4447, 0x474d,
+0x4a50, 0x4d50, 0x504d, 0x5348, 0x563e, 0x5932, 0x5c22, 0x5f0f,
+0x61f8, 0x64dd, 0x67be, 0x6a9b, 0x6d74, 0x7049, 0x731a, 0x75e6,
+0x78ad, 0x7b70, 0x7e2f, 0x80e8, 0x839c, 0x864c, 0x88f6, 0x8b9a,
+0x8e3a, 0x90d4, 0x9368, 0x95f7, 0x9880, 0x9b03, 0x9d80, 0x9ff7,
+0xa268, 0xa4d2, 0xa736, 0xa994, 0xabeb, 0xae3c, 0xb086, 0xb2c9,
+0xb505, 0xb73a, 0xb968, 0xbb8f, 0xbdaf, 0xbfc7, 0xc1d8, 0xc3e2,
+0xc5e4, 0xc7de, 0xc9d1, 0xcbbc, 0xcd9f, 0xcf7a, 0xd14d, 0xd318,
+0xd4db, 0xd696, 0xd848, 0xd9f2, 0xdb94, 0xdd2d, 0xdebe, 0xe046,
+0xe1c6, 0xe33c, 0xe4aa, 0xe610, 0xe76c, 0xe8bf, 0xea0a, 0xeb4b,
+0xec83, 0xedb3, 0xeed9, 0xeff5, 0xf109, 0xf213, 0xf314, 0xf40c,
+0xf4fa, 0xf5df, 0xf6ba, 0xf78c, 0xf854, 0xf913, 0xf9c8, 0xfa73,
+0xfb15, 0xfbad, 0xfc3b, 0xfcc0, 0xfd3b, 0xfdac, 0xfe13, 0xfe71,
+0xfec4, 0xff0e, 0xff4e, 0xff85, 0xffb1, 0xffd4, 0xffec, 0xfffb
+};
+#elif FFT_SIZE == 512
+// Table generated using gen_twiddle.
+// FFT size: 1024.
+static const uint16_t twiddle_factor_lookup[256] = {
+0x0000, 0x0192, 0x0324, 0x04b6, 0x0648, 0x07da, 0x096c, 0x0afe,
+0x0c90, 0x0e21, 0x0fb3, 0x1144, 0x12d5, 0x1466, 0x15f7, 0x1787,
+0x1918, 0x1aa8, 0x1c38, 0x1dc7, 0x1f56, 0x20e5, 0x2274, 0x2402,
+0x2590, 0x271e, 0x28ab, 0x2a38, 0x2bc4, 0x2d50, 0x2edc, 0x3067,
+0x31f1, 0x337c, 0x3505, 0x368e, 0x3817, 0x399f, 0x3b27, 0x3cae,
+0x3e34, 0x3fba, 0x413f, 0x42c3, 0x4447, 0x45cb, 0x474d, 0x48cf,
+0x4a50, 0x4bd1, 0x4d50, 0x4ecf, 0x504d, 0x51cb, 0x5348, 0x54c3,
+0x563e, 0x57b9, 0x5932, 0x5aaa, 0x5c22, 0x5d99, 0x5f0f, 0x6084,
+0x61f8, 0x636b, 0x64dd, 0x664e, 0x67be, 0x692d, 0x6a9b, 0x6c08,
+0x6d74, 0x6edf, 0x7049, 0x71b2, 0x731a, 0x7480, 0x75e6, 0x774a,
+0x78ad, 0x7a10, 0x7b70, 0x7cd0, 0x7e2f, 0x7f8c, 0x80e8, 0x8243,
+0x839c, 0x84f5, 0x864c, 0x87a1, 0x88f6, 0x8a49, 0x8b9a, 0x8ceb,
+0x8e3a, 0x8f88, 0x90d4, 0x921f, 0x9368, 0x94b0, 0x95f7, 0x973c,
+0x9880, 0x99c2, 0x9b03, 0x9c42, 0x9d80, 0x9ebc, 0x9ff7, 0xa130,
+0xa268, 0xa39e, 0xa4d2, 0xa605, 0xa736, 0xa866, 0xa994, 0xaac1,
+0xabeb, 0xad14, 0xae3c, 0xaf62, 0xb086, 0xb1a8, 0xb2c9, 0xb3e8,
+0xb505, 0xb620, 0xb73a, 0xb852, 0xb968, 0xba7d, 0xbb8f, 0xbca0,
+0xbdaf, 0xbebc, 0xbfc7, 0xc0d1, 0xc1d8, 0xc2de, 0xc3e2, 0xc4e4,
+0xc5e4, 0xc6e2, 0xc7de, 0xc8d9, 0xc9d1, 0xcac7, 0xcbbc, 0xccae,
+0xcd9f, 0xce8e, 0xcf7a, 0xd065, 0xd14d, 0xd234, 0xd318, 0xd3fb,
+0xd4db, 0xd5ba, 0xd696, 0xd770, 0xd848, 0xd91e, 0xd9f2, 0xdac4,
+0xdb94, 0xdc62, 0xdd2d, 0xddf7, 0xdebe, 0xdf83, 0xe046, 0xe107,
+0xe1c6, 0xe282, 0xe33c, 0xe3f4, 0xe4aa, 0xe55e, 0xe610, 0xe6bf,
+0xe76c, 0xe817, 0xe8bf, 0xe966, 0xea0a, 0xeaab, 0xeb4b, 0xebe8,
+0xec83, 0xed1c, 0xedb3, 0xee47, 0xeed9, 0xef68, 0xeff5, 0xf080,
+0xf109, 0xf18f, 0xf213, 0xf295, 0xf314, 0xf391, 0xf40c, 0xf484,
+0xf4fa, 0xf56e, 0xf5df, 0xf64e, 0xf6ba, 0xf724, 0xf78c, 0xf7f1,
+0xf854, 0xf8b4, 0xf913, 0xf96e, 0xf9c8, 0xfa1f, 0xfa73, 0xfac5,
+0xfb15, 0xfb62, 0xfbad, 0xfbf5, 0xfc3b, 0xfc7f, 0xfcc0, 0xfcfe,
+0xfd3b, 0xfd74, 0xfdac, 0xfde1, 0xfe13, 0xfe43, 0xfe71, 0xfe9c,
+0xfec4, 0xfeeb, 0xff0e, 0xff30, 0xff4e, 0xff6b, 0xff85, 0xff9c,
+0xffb1, 0xffc4, 0xffd4, 0xffe1, 0xffec, 0xfff5, 0xfffb, 0xffff
+};
+#else
+#error "FFT_SIZE must be 64, 128, 256 or 512. Use gen_twiddle to generate other tables."
+#endif // #if FFT_SIZE == 64
+
+#endif // #ifndef FFT_TWIDDLE_TABLE_H_INCLUDED
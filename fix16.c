@@ -13,6 +13,8 @@
   *   returning #fix16_overflow.
   * - Moved fix16_log2() into fix16.c.
   * - Changed fix16_log2() to avoid division.
+  * - Added a fix16_mul() implementation which works on the high and low
+  *   words of a 32*32 -> 64 bit product (see FIXMATH_HI_LO_MULTIPLY).
   *
   * The rest of the file was written mainly by the libfixmath contributors.
   * A list of contributors can be retrieved from
@@ -32,7 +34,7 @@
   * something unexpected occurred (eg. arithmetic overflow) and the result
   * should be considered invalid.
   */
-bool fix16_error_occurred;
+THREAD_LOCAL bool fix16_error_occurred;
 
 /* Subtraction and addition with overflow detection.
 */
@@ -74,13 +76,77 @@ fix16_t fix16_sub(fix16_t a, fix16_t b)
 	return diff;
 }
 
+#if defined(__mips__) && defined(__GNUC__) && !defined(FIXMATH_OPTIMIZE_8BIT)
+/** Use the hi/lo implementation of fix16_mul() on MIPS (eg. PIC32), because
+  * the MULT instruction leaves the 64 bit product in the HI and LO registers.
+  * That implementation works on those two words directly, so it avoids the
+  * 64 bit shifts and comparisons of the 64-bit implementation. This can also
+  * be defined on other platforms to test that implementation. */
+#define FIXMATH_HI_LO_MULTIPLY
+#endif // #if defined(__mips__) && defined(__GNUC__) && !defined(FIXMATH_OPTIMIZE_8BIT)
+
+/* Hi/lo implementation of fix16_mul. Fastest on processors which have a
+ * 32*32 -> 64 bit multiply instruction that writes the product into two 32 bit
+ * registers, e.g. MIPS32. The rounding and overflow detection give exactly the
+ * same results as the 64-bit implementation below.
+ *
+ * There is deliberately no Cortex-M0 version: ARMv6-M has no long multiply
+ * instruction, so the 32-bit implementation (four 16*16 -> 32 bit MULS) is
+ * already what the core can do best.
+ */
+#if defined(FIXMATH_HI_LO_MULTIPLY)
+fix16_t fix16_mul(fix16_t inArg0, fix16_t inArg1)
+{
+	int32_t product_hi;
+	uint32_t product_lo;
+	fix16_t result;
+
+#if defined(__mips__) && defined(__GNUC__)
+	asm("mult %2, %3\n\tmfhi %0\n\tmflo %1"
+		: "=r"(product_hi), "=r"(product_lo)
+		: "r"(inArg0), "r"(inArg1)
+		: "hi", "lo");
+#else
+	int64_t product = (int64_t)inArg0 * inArg1;
+	product_hi = (int32_t)(product >> 32);
+	product_lo = (uint32_t)product;
+#endif
+
+#ifndef FIXMATH_NO_OVERFLOW
+	// The upper 17 bits should all be the same (the sign).
+	if (product_hi >> 31 != product_hi >> 15)
+	{
+		fix16_error_occurred = true;
+		return fix16_overflow;
+	}
+#endif
+
+#ifndef FIXMATH_NO_ROUNDING
+	if (product_hi < 0)
+	{
+		// This adjustment is required in order to round -1/2 correctly.
+		// It's a 64 bit decrement of product_hi:product_lo.
+		if (product_lo == 0)
+			product_hi--;
+		product_lo--;
+	}
+#endif
+
+	result = (fix16_t)(((uint32_t)product_hi << 16) | (product_lo >> 16));
+#ifndef FIXMATH_NO_ROUNDING
+	result += (product_lo & 0x8000) >> 15;
+#endif
+	return result;
+}
+#endif
+
 /* 64-bit implementation for fix16_mul. Fastest version for e.g. ARM Cortex M3.
  * Performs a 32*32 -> 64bit multiplication. The middle 32 bits are the result,
  * bottom 16 bits are used for rounding, and upper 16 bits are used for overflow
  * detection.
  */
  
-#if !defined(FIXMATH_NO_64BIT) && !defined(FIXMATH_OPTIMIZE_8BIT)
+#if !defined(FIXMATH_NO_64BIT) && !defined(FIXMATH_OPTIMIZE_8BIT) && !defined(FIXMATH_HI_LO_MULTIPLY)
 fix16_t fix16_mul(fix16_t inArg0, fix16_t inArg1)
 {
 	int64_t product = (int64_t)inArg0 * inArg1;
@@ -131,7 +197,7 @@ fix16_t fix16_mul(fix16_t inArg0, fix16_t inArg1)
  * and this is a relatively good compromise for compilers that do not support
  * uint64_t. Uses 16*16->32bit multiplications.
  */
-#if defined(FIXMATH_NO_64BIT) && !defined(FIXMATH_OPTIMIZE_8BIT)
+#if defined(FIXMATH_NO_64BIT) && !defined(FIXMATH_OPTIMIZE_8BIT) && !defined(FIXMATH_HI_LO_MULTIPLY)
 fix16_t fix16_mul(fix16_t inArg0, fix16_t inArg1)
 {
 	uint32_t product_lo_tmp;
@@ -0,0 +1,189 @@
+/** \file fix16_tester.c
+  *
+  * \brief Compares a fix16_mul() implementation against a reference.
+  *
+  * This checks the accuracy and measures the throughput of whichever
+  * fix16_mul() implementation fix16.c was compiled with. The reference is
+  * the exact product, rounded and overflow-checked the same way as the
+  * 64-bit implementation in fix16.c. The 64-bit, 32-bit and hi/lo
+  * implementations of fix16_mul() in fix16.c are supposed to give identical
+  * results (including #fix16_error_occurred), so any mismatch is reported as
+  * a failure.
+  *
+  * The operands are a set of edge cases (values near 0, +/-0.5, +/-1 and
+  * the overflow boundaries) and a large number of pseudo-random values of
+  * various magnitudes. The throughput measurement is only meaningful on the
+  * host; use benchmark.c for timing on real hardware.
+  *
+  * This file is licensed as described by the file LICENCE.
+  */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include "../common.h"
+#include "../fix16.h"
+
+/** Number of pseudo-random operand pairs to test. */
+#define RANDOM_TESTS		10000000
+/** Number of multiplications to time when measuring throughput. */
+#define TIMING_ITERATIONS	100000000
+
+/** Edge case operands. Every pair of these is tested. */
+static const fix16_t edge_cases[] = {
+0x00000000, 0x00000001, 0x00007fff, 0x00008000, 0x00008001, 0x0000ffff,
+0x00010000, 0x00010001, 0x00018000, 0x00b504f3, 0x00b504f4, 0x00ffffff,
+0x01000000, 0x7fffffff, (fix16_t)0xffffffff, (fix16_t)0xffff8001,
+(fix16_t)0xffff8000, (fix16_t)0xffff7fff, (fix16_t)0xffff0000,
+(fix16_t)0xff4afb0d, (fix16_t)0xff4afb0c, (fix16_t)0xff000000,
+(fix16_t)0x80000001, (fix16_t)0x80000000};
+
+/** fix16_mul() is declared with FIXMATH_FUNC_ATTRS, which tells the compiler
+  * that it has no side effects. But it does have one: it sets
+  * #fix16_error_occurred on overflow. Calling it through this pointer stops
+  * the compiler from moving the call across reads of #fix16_error_occurred.
+  */
+static fix16_t (*volatile multiply)(fix16_t, fix16_t) = fix16_mul;
+
+/** Maximum number of mismatches to print. */
+#define MAX_REPORTED_FAILURES	10
+
+/** Number of mismatches found so far. */
+static unsigned int failures;
+
+/** State of the pseudo-random number generator used to generate operands. */
+static uint32_t prng_state = 1;
+
+/** Get a pseudo-random 32 bit integer, using xorshift32.
+  * \return A pseudo-random integer.
+  */
+static uint32_t nextRandom(void)
+{
+	prng_state ^= prng_state << 13;
+	prng_state ^= prng_state >> 17;
+	prng_state ^= prng_state << 5;
+	return prng_state;
+}
+
+/** Get a pseudo-random fix16_t with a random magnitude, so that small
+  * operands (which are typical in FFTs) are tested as well as large ones.
+  * \return A pseudo-random fix16_t.
+  */
+static fix16_t randomOperand(void)
+{
+	uint32_t r;
+
+	r = nextRandom();
+	return (fix16_t)((int32_t)r >> (nextRandom() & 31));
+}
+
+/** Reference fixed-point multiplication.
+  * \param a The first operand.
+  * \param b The second operand.
+  * \param out_overflow Will be set to true if the product overflowed,
+  *                     false otherwise.
+  * \return The rounded product of a and b, or #fix16_overflow on overflow.
+  */
+static fix16_t referenceMultiply(fix16_t a, fix16_t b, bool *out_overflow)
+{
+	int64_t product;
+
+	product = (int64_t)a * b;
+	*out_overflow = false;
+	if ((product >= ((int64_t)1 << 47)) || (product < -((int64_t)1 << 47)))
+	{
+		*out_overflow = true;
+		return fix16_overflow;
+	}
+	if (product < 0)
+	{
+		product--; // round -1/2 away from zero, like fix16.c
+	}
+	return (fix16_t)((uint32_t)(product >> 16) + (uint32_t)((product & 0x8000) >> 15));
+}
+
+/** Compare fix16_mul() against referenceMultiply() for one pair of
+  * operands.
+  * \param a The first operand.
+  * \param b The second operand.
+  * \return false if the results match, true if they don't.
+  */
+static bool checkMultiply(fix16_t a, fix16_t b)
+{
+	fix16_t expected;
+	fix16_t result;
+	bool expected_overflow;
+
+	expected = referenceMultiply(a, b, &expected_overflow);
+	fix16_error_occurred = false;
+	result = multiply(a, b);
+	if ((fix16_error_occurred != expected_overflow)
+		|| (!expected_overflow && (result != expected)))
+	{
+		if (failures < MAX_REPORTED_FAILURES)
+		{
+			printf("Mismatch: %08x * %08x = %08x (overflow = %d), expected %08x (overflow = %d)\n",
+				(unsigned int)a, (unsigned int)b, (unsigned int)result, (int)fix16_error_occurred,
+				(unsigned int)expected, (int)expected_overflow);
+		}
+		return true;
+	}
+	return false;
+}
+
+int main(void)
+{
+	unsigned int i;
+	unsigned int j;
+	unsigned int tests;
+	fix16_t accumulator;
+	fix16_t multiplier;
+	clock_t start;
+	double seconds;
+
+	failures = 0;
+	tests = 0;
+	for (i = 0; i < (sizeof(edge_cases) / sizeof(edge_cases[0])); i++)
+	{
+		for (j = 0; j < (sizeof(edge_cases) / sizeof(edge_cases[0])); j++)
+		{
+			if (checkMultiply(edge_cases[i], edge_cases[j]))
+			{
+				failures++;
+			}
+			tests++;
+		}
+	}
+	for (i = 0; i < RANDOM_TESTS; i++)
+	{
+		if (checkMultiply(randomOperand(), randomOperand()))
+		{
+			failures++;
+		}
+		tests++;
+	}
+	printf("Accuracy: %u mismatches out of %u multiplications\n", failures, tests);
+
+	// Chain the multiplications so that the compiler can't hoist them out of
+	// the loop. The multiplier is slightly less than 1 so that the
+	// accumulator decays instead of overflowing.
+	accumulator = fix16_one;
+	multiplier = 0x0000ffff;
+	start = clock();
+	for (i = 0; i < TIMING_ITERATIONS; i++)
+	{
+		accumulator = multiply(accumulator, multiplier);
+		if (accumulator == 0)
+		{
+			accumulator = (fix16_t)(fix16_one + i);
+		}
+	}
+	seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+	printf("Throughput: %.1f million multiplications per second (%08x)\n", (double)TIMING_ITERATIONS / seconds / 1e6, (unsigned int)accumulator);
+
+	if (failures != 0)
+	{
+		exit(1);
+	}
+	exit(0);
+}
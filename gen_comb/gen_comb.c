@@ -0,0 +1,122 @@
+/** \file gen_comb.c
+  *
+  * \brief Generates fixed-base comb lookup table.
+  *
+  * This generates the lookup table of multiples of the secp256k1 base point
+  * G for use in pointMultiplyBase() (see ecdsa.c). This outputs the table as
+  * C source, suitable for pasting into ecdsa_comb_table.h.
+  *
+  * For a comb with t teeth, the 256 bit scalar is divided into t rows of
+  * d = 256 / t bits each. Entry j - 1 of the table (for j in [1, 2 ^ t)) is
+  * the point:
+  * (sum over every bit i which is set in j of 2 ^ (i * d)) x G,
+  * in affine coordinates. The point at infinity (j = 0) is not stored.
+  * Each entry consists of the x coordinate followed by the y coordinate,
+  * both as little-endian 32 byte multi-precision numbers.
+  *
+  * The point multiplications are done using pointMultiply(), so this must be
+  * linked with ecdsa.c and its dependencies (including scratch.c, which
+  * needs the fatalError() below).
+  *
+  * This file is licensed as described by the file LICENCE.
+  */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include "../common.h"
+#include "../bignum256.h"
+#include "../ecdsa.h"
+#include "../hwinterface.h"
+
+/** Number of bytes per line in C source output. */
+#define VALUES_PER_LINE		16
+
+/** This is called by scratch.c if its arena is misused. The generator has
+  * no way of recovering from that, so it just gives up. */
+void fatalError(void)
+{
+	printf("Fatal error\n");
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	int i;
+	int j;
+	int teeth;
+	int columns;
+	int table_size;
+	int bit_index;
+	uint8_t k[32];
+	PointAffine p;
+
+	if (argc != 2)
+	{
+		printf("Usage: %s <teeth>\n", argv[0]);
+		printf("  <teeth>: number of teeth in comb; must be 2, 4 or 8\n");
+		printf("\n");
+		exit(1);
+	}
+	if (sscanf(argv[1], "%d", &teeth) != 1)
+	{
+		printf("Error: Invalid number of teeth\n");
+		exit(1);
+	}
+	if ((teeth != 2) && (teeth != 4) && (teeth != 8))
+	{
+		printf("Error: Invalid number of teeth\n");
+		exit(1);
+	}
+
+	columns = 256 / teeth;
+	table_size = (1 << teeth) - 1;
+	printf("// Table generated using gen_comb.\n");
+	printf("// Teeth: %d.\n", teeth);
+	printf("static const uint8_t secp256k1_comb_table[%d][64] PROGMEM = {\n", table_size);
+	for (i = 0; i < table_size; i++)
+	{
+		bigSetZero(k);
+		for (j = 0; j < teeth; j++)
+		{
+			if (((i + 1) & (1 << j)) != 0)
+			{
+				bit_index = j * columns;
+				k[bit_index >> 3] = (uint8_t)(k[bit_index >> 3] | (1 << (bit_index & 7)));
+			}
+		}
+		setToG(&p);
+		pointMultiply(&p, k);
+		printf("{");
+		for (j = 0; j < 64; j++)
+		{
+			if ((j % VALUES_PER_LINE) == 0)
+			{
+				printf("\n");
+			}
+			if (j < 32)
+			{
+				printf("0x%02x", p.x[j]);
+			}
+			else
+			{
+				printf("0x%02x", p.y[j - 32]);
+			}
+			if (j != 63)
+			{
+				printf(",");
+				if ((j % VALUES_PER_LINE) != (VALUES_PER_LINE - 1))
+				{
+					printf(" ");
+				}
+			}
+		}
+		printf("}");
+		if (i != (table_size - 1))
+		{
+			printf(",");
+		}
+		printf("\n");
+	}
+	printf("};\n");
+	exit(0);
+}
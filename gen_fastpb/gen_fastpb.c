@@ -0,0 +1,841 @@
+/** \file gen_fastpb.c
+  *
+  * \brief Generates specialised protocol buffer encoders and decoders.
+  *
+  * nanopb encodes and decodes every message by walking its field
+  * description table (the *_fields arrays in messages.pb.c) and calling a
+  * function pointer per field. That's fine for most messages, but a few
+  * (for example, Address and GetAddressAndPublicKey) are sent so often that
+  * the table walk is a noticeable part of handling them. For the messages
+  * listed in #encode_messages and #decode_messages, this outputs
+  * straight-line C code which does the same thing as nanopb, suitable for
+  * pasting into messages_fast.h.
+  *
+  * The fields of each message are read from messages.proto, because the
+  * field description tables don't contain field names. Each field is then
+  * checked against the field description table (which this must be linked
+  * with), so that the generated code can't silently disagree with
+  * messages.pb.c. Only required and optional uint32, bool and bytes fields
+  * are supported; anything else (callbacks, repeated fields, submessages
+  * etc.) should be left to nanopb.
+  *
+  * This file is licensed as described by the file LICENCE.
+  */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "../common.h"
+#include "../pb.h"
+#include "../messages.pb.h"
+
+/** Maximum number of fields in a message which can be handled. */
+#define MAX_FIELDS			8
+/** Maximum length of a message or field name, including the terminator. */
+#define MAX_NAME_LENGTH		64
+/** Maximum length of a line in messages.proto. */
+#define MAX_LINE_LENGTH		256
+
+/** Types of field which the generated code can handle. */
+typedef enum FieldTypeEnum
+{
+	/** uint32, encoded as a varint. */
+	FIELD_UINT32,
+	/** bool, encoded as a varint. */
+	FIELD_BOOL,
+	/** bytes with a maximum size, encoded as a length-delimited field. */
+	FIELD_BYTES
+} FieldType;
+
+/** One field of a message, as declared in messages.proto. */
+typedef struct FieldStruct
+{
+	/** Name of the field. */
+	char name[MAX_NAME_LENGTH];
+	/** Field number (tag). */
+	unsigned int tag;
+	/** Type of the field. */
+	FieldType type;
+	/** Whether the field is optional (as opposed to required). */
+	bool optional;
+	/** Maximum size of a #FIELD_BYTES field, in bytes. */
+	unsigned int max_size;
+	/** Default value of an optional #FIELD_UINT32 or #FIELD_BOOL field. */
+	uint32_t default_value;
+} Field;
+
+/** A message to generate code for. */
+typedef struct MessageSpecStruct
+{
+	/** Name of the message. */
+	const char *name;
+	/** Field description table from messages.pb.c. */
+	const pb_field_t *fields;
+} MessageSpec;
+
+/** Messages which the device sends often, and which get an encoder. */
+static const MessageSpec encode_messages[] = {
+	{"Address", Address_fields},
+	{"Signature", Signature_fields},
+	{"NumberOfAddresses", NumberOfAddresses_fields}
+};
+
+/** Messages which the device receives often, and which get a decoder. */
+static const MessageSpec decode_messages[] = {
+	{"GetAddressAndPublicKey", GetAddressAndPublicKey_fields},
+	{"GetNumberOfAddresses", GetNumberOfAddresses_fields},
+	{"NewAddress", NewAddress_fields},
+	{"ButtonAck", ButtonAck_fields}
+};
+
+/** Name of the .proto file which was read. */
+static const char *proto_filename;
+
+/** Print an error message and quit.
+  * \param message The error message.
+  * \param name The message or field which the error is about.
+  */
+static void fail(const char *message, const char *name)
+{
+	fprintf(stderr, "Error: %s (%s)\n", message, name);
+	exit(1);
+}
+
+/** Read the fields of a message from messages.proto.
+  * \param message_name The name of the message.
+  * \param fields The fields will be written here, in the order in which
+  *               they are declared. This must have space for #MAX_FIELDS
+  *               fields.
+  * \return The number of fields.
+  */
+static unsigned int readProtoMessage(const char *message_name, Field *fields)
+{
+	FILE *f;
+	char line[MAX_LINE_LENGTH];
+	char label[MAX_NAME_LENGTH];
+	char type[MAX_NAME_LENGTH];
+	char name[MAX_NAME_LENGTH];
+	const char *option;
+	unsigned int tag;
+	unsigned int num_fields;
+	bool in_message;
+
+	f = fopen(proto_filename, "r");
+	if (f == NULL)
+	{
+		fail("Could not open .proto file", proto_filename);
+	}
+	num_fields = 0;
+	in_message = false;
+	while (fgets(line, sizeof(line), f) != NULL)
+	{
+		if (!in_message)
+		{
+			if ((sscanf(line, "message %63s", name) == 1) && !strcmp(name, message_name))
+			{
+				in_message = true;
+			}
+			continue;
+		}
+		if (strchr(line, '}') != NULL)
+		{
+			fclose(f);
+			return num_fields;
+		}
+		if (sscanf(line, " %63s %63s %63s = %u", label, type, name, &tag) != 4)
+		{
+			continue; // comment, brace or blank line
+		}
+		if (num_fields >= MAX_FIELDS)
+		{
+			fail("Too many fields", message_name);
+		}
+		strcpy(fields[num_fields].name, name);
+		fields[num_fields].tag = tag;
+		fields[num_fields].max_size = 0;
+		fields[num_fields].default_value = 0;
+		if (!strcmp(label, "required"))
+		{
+			fields[num_fields].optional = false;
+		}
+		else if (!strcmp(label, "optional"))
+		{
+			fields[num_fields].optional = true;
+		}
+		else
+		{
+			fail("Unsupported field label", name);
+		}
+		if (!strcmp(type, "uint32"))
+		{
+			fields[num_fields].type = FIELD_UINT32;
+		}
+		else if (!strcmp(type, "bool"))
+		{
+			fields[num_fields].type = FIELD_BOOL;
+		}
+		else if (!strcmp(type, "bytes"))
+		{
+			fields[num_fields].type = FIELD_BYTES;
+			option = strstr(line, "max_size =");
+			if ((option == NULL) || (sscanf(option, "max_size = %u", &(fields[num_fields].max_size)) != 1))
+			{
+				fail("bytes field without max_size", name);
+			}
+		}
+		else
+		{
+			fail("Unsupported field type", name);
+		}
+		num_fields++;
+	}
+	fail("Message not found", message_name);
+	return 0;
+}
+
+/** Check the fields of a message against its field description table, and
+  * fill in default values.
+  * \param spec The message.
+  * \param fields The fields, as returned by readProtoMessage().
+  * \param num_fields The number of fields.
+  */
+static void checkFields(const MessageSpec *spec, Field *fields, unsigned int num_fields)
+{
+	const pb_field_t *table_field;
+	unsigned int i;
+	unsigned int num_table_fields;
+	pb_type_t expected_type;
+
+	num_table_fields = 0;
+	for (table_field = spec->fields; table_field->tag != 0; table_field++)
+	{
+		num_table_fields++;
+	}
+	if (num_table_fields != num_fields)
+	{
+		fail("Number of fields doesn't match messages.pb.c", spec->name);
+	}
+	for (i = 0; i < num_fields; i++)
+	{
+		for (table_field = spec->fields; table_field->tag != 0; table_field++)
+		{
+			if (table_field->tag == fields[i].tag)
+			{
+				break;
+			}
+		}
+		if (table_field->tag == 0)
+		{
+			fail("Field not in messages.pb.c", fields[i].name);
+		}
+		if (fields[i].type == FIELD_BYTES)
+		{
+			expected_type = PB_LTYPE_BYTES;
+		}
+		else
+		{
+			expected_type = PB_LTYPE_VARINT;
+		}
+		if (fields[i].optional)
+		{
+			expected_type |= PB_HTYPE_OPTIONAL;
+		}
+		else
+		{
+			expected_type |= PB_HTYPE_REQUIRED;
+		}
+		expected_type |= PB_ATYPE_STATIC;
+		if (table_field->type != expected_type)
+		{
+			fail("Field type doesn't match messages.pb.c", fields[i].name);
+		}
+		if ((fields[i].type == FIELD_UINT32) && (table_field->data_size != sizeof(uint32_t)))
+		{
+			fail("Field size doesn't match messages.pb.c", fields[i].name);
+		}
+		if ((fields[i].type == FIELD_BOOL) && (table_field->data_size != sizeof(bool)))
+		{
+			fail("Field size doesn't match messages.pb.c", fields[i].name);
+		}
+		if ((fields[i].type == FIELD_BYTES)
+			&& ((table_field->data_size - offsetof(pb_bytes_array_t, bytes)) < fields[i].max_size))
+		{
+			fail("Field size doesn't match messages.pb.c", fields[i].name);
+		}
+		if (fields[i].optional && (table_field->ptr != NULL))
+		{
+			if (fields[i].type == FIELD_UINT32)
+			{
+				fields[i].default_value = *(const uint32_t *)table_field->ptr;
+			}
+			else if (fields[i].type == FIELD_BOOL)
+			{
+				fields[i].default_value = *(const bool *)table_field->ptr;
+			}
+		}
+	}
+}
+
+/** Calculate the size of a varint.
+  * \param value The value which would be encoded.
+  * \return The size, in bytes.
+  */
+static unsigned int varintSize(uint32_t value)
+{
+	unsigned int size;
+
+	size = 1;
+	while (value >= 0x80)
+	{
+		value >>= 7;
+		size++;
+	}
+	return size;
+}
+
+/** Calculate the maximum encoded size of a message.
+  * \param fields The fields of the message.
+  * \param num_fields The number of fields.
+  * \return The maximum size, in bytes.
+  */
+static unsigned int maximumSize(const Field *fields, unsigned int num_fields)
+{
+	unsigned int i;
+	unsigned int size;
+
+	size = 0;
+	for (i = 0; i < num_fields; i++)
+	{
+		size += varintSize(fields[i].tag << 3);
+		if (fields[i].type == FIELD_UINT32)
+		{
+			size += 5;
+		}
+		else if (fields[i].type == FIELD_BOOL)
+		{
+			size += 1;
+		}
+		else
+		{
+			size += varintSize(fields[i].max_size) + fields[i].max_size;
+		}
+	}
+	return size;
+}
+
+/** Get the key (tag and wire type) of a field.
+  * \param field The field.
+  * \return The key.
+  */
+static uint32_t fieldKey(const Field *field)
+{
+	if (field->type == FIELD_BYTES)
+	{
+		return (field->tag << 3) | 2;
+	}
+	else
+	{
+		return field->tag << 3;
+	}
+}
+
+/** Output code which writes the key of a field.
+  * \param field The field.
+  * \param indent Indentation to put before each line.
+  */
+static void printWriteKey(const Field *field, const char *indent)
+{
+	uint32_t key;
+
+	key = fieldKey(field);
+	while (key >= 0x80)
+	{
+		printf("%sbuffer[length++] = 0x%02x;\n", indent, (unsigned int)((key & 0x7f) | 0x80));
+		key >>= 7;
+	}
+	printf("%sbuffer[length++] = 0x%02x; // %s\n", indent, (unsigned int)key, field->name);
+}
+
+/** Output an encoder for a message.
+  * \param name The name of the message.
+  * \param fields The fields of the message.
+  * \param num_fields The number of fields.
+  */
+static void printEncoder(const char *name, const Field *fields, unsigned int num_fields)
+{
+	unsigned int i;
+	const char *indent;
+
+	printf("/** Encode a %s message. See fastEncode(). */\n", name);
+	printf("static bool fastEncode%s(const %s *message, uint8_t *buffer, size_t *out_length)\n", name, name);
+	printf("{\n");
+	printf("\tsize_t length;\n");
+	printf("\n");
+	printf("\tlength = 0;\n");
+	for (i = 0; i < num_fields; i++)
+	{
+		indent = "\t";
+		if (fields[i].optional)
+		{
+			printf("\tif (message->has_%s)\n", fields[i].name);
+			printf("\t{\n");
+			indent = "\t\t";
+		}
+		if (fields[i].type == FIELD_BYTES)
+		{
+			printf("%sif (message->%s.size > sizeof(message->%s.bytes))\n", indent, fields[i].name, fields[i].name);
+			printf("%s{\n", indent);
+			printf("%s\treturn true;\n", indent);
+			printf("%s}\n", indent);
+		}
+		printWriteKey(&(fields[i]), indent);
+		if (fields[i].type == FIELD_UINT32)
+		{
+			printf("%slength += fastWriteVarint(&(buffer[length]), message->%s);\n", indent, fields[i].name);
+		}
+		else if (fields[i].type == FIELD_BOOL)
+		{
+			printf("%sbuffer[length++] = (uint8_t)message->%s;\n", indent, fields[i].name);
+		}
+		else
+		{
+			printf("%slength += fastWriteVarint(&(buffer[length]), (uint32_t)message->%s.size);\n", indent, fields[i].name);
+			printf("%smemcpy(&(buffer[length]), message->%s.bytes, message->%s.size);\n", indent, fields[i].name, fields[i].name);
+			printf("%slength += message->%s.size;\n", indent, fields[i].name);
+		}
+		if (fields[i].optional)
+		{
+			printf("\t}\n");
+		}
+	}
+	printf("\t*out_length = length;\n");
+	printf("\treturn false;\n");
+	printf("}\n");
+	printf("\n");
+}
+
+/** Output a decoder for a message.
+  * \param name The name of the message.
+  * \param fields The fields of the message.
+  * \param num_fields The number of fields.
+  */
+static void printDecoder(const char *name, const Field *fields, unsigned int num_fields)
+{
+	unsigned int i;
+	bool has_required;
+	const char *separator;
+
+	has_required = false;
+	for (i = 0; i < num_fields; i++)
+	{
+		if (!fields[i].optional)
+		{
+			has_required = true;
+		}
+	}
+	printf("/** Decode a %s message. See fastDecode(). */\n", name);
+	printf("static bool fastDecode%s(const uint8_t *buffer, size_t length, %s *message)\n", name, name);
+	printf("{\n");
+	printf("\tsize_t position;\n");
+	printf("\tuint32_t key;\n");
+	for (i = 0; i < num_fields; i++)
+	{
+		if (!fields[i].optional)
+		{
+			printf("\tbool has_%s;\n", fields[i].name);
+		}
+	}
+	printf("\n");
+	for (i = 0; i < num_fields; i++)
+	{
+		if (fields[i].optional)
+		{
+			printf("\tmessage->has_%s = false;\n", fields[i].name);
+		}
+		else
+		{
+			printf("\thas_%s = false;\n", fields[i].name);
+		}
+		if (fields[i].type == FIELD_UINT32)
+		{
+			printf("\tmessage->%s = %u;\n", fields[i].name, (unsigned int)fields[i].default_value);
+		}
+		else if (fields[i].type == FIELD_BOOL)
+		{
+			printf("\tmessage->%s = %s;\n", fields[i].name, fields[i].default_value ? "true" : "false");
+		}
+		else
+		{
+			printf("\tmessage->%s.size = 0;\n", fields[i].name);
+		}
+	}
+	printf("\tposition = 0;\n");
+	printf("\twhile (position < length)\n");
+	printf("\t{\n");
+	printf("\t\tif (fastReadVarint(buffer, length, &position, &key))\n");
+	printf("\t\t{\n");
+	printf("\t\t\treturn true;\n");
+	printf("\t\t}\n");
+	printf("\t\tswitch (key)\n");
+	printf("\t\t{\n");
+	for (i = 0; i < num_fields; i++)
+	{
+		printf("\t\tcase 0x%02x: // %s\n", (unsigned int)fieldKey(&(fields[i])), fields[i].name);
+		if (fields[i].type == FIELD_UINT32)
+		{
+			printf("\t\t\tif (fastReadVarint(buffer, length, &position, &(message->%s)))\n", fields[i].name);
+			printf("\t\t\t{\n");
+			printf("\t\t\t\treturn true;\n");
+			printf("\t\t\t}\n");
+		}
+		else if (fields[i].type == FIELD_BOOL)
+		{
+			printf("\t\t\tif (fastReadVarint(buffer, length, &position, &key))\n");
+			printf("\t\t\t{\n");
+			printf("\t\t\t\treturn true;\n");
+			printf("\t\t\t}\n");
+			printf("\t\t\tmessage->%s = ((key & 0xff) != 0);\n", fields[i].name);
+		}
+		else
+		{
+			printf("\t\t\tif (fastReadVarint(buffer, length, &position, &key)\n");
+			printf("\t\t\t\t|| (key > sizeof(message->%s.bytes)) || (key > (length - position)))\n", fields[i].name);
+			printf("\t\t\t{\n");
+			printf("\t\t\t\treturn true;\n");
+			printf("\t\t\t}\n");
+			printf("\t\t\tmessage->%s.size = key;\n", fields[i].name);
+			printf("\t\t\tmemcpy(message->%s.bytes, &(buffer[position]), key);\n", fields[i].name);
+			printf("\t\t\tposition += key;\n");
+		}
+		if (fields[i].optional)
+		{
+			printf("\t\t\tmessage->has_%s = true;\n", fields[i].name);
+		}
+		else
+		{
+			printf("\t\t\thas_%s = true;\n", fields[i].name);
+		}
+		printf("\t\t\tbreak;\n");
+	}
+	printf("\t\tdefault:\n");
+	printf("\t\t\tif (fastSkipField(buffer, length, &position, key))\n");
+	printf("\t\t\t{\n");
+	printf("\t\t\t\treturn true;\n");
+	printf("\t\t\t}\n");
+	printf("\t\t\tbreak;\n");
+	printf("\t\t}\n");
+	printf("\t}\n");
+	if (has_required)
+	{
+		// Like pb_decode(), fail if a required field is missing.
+		printf("\treturn");
+		separator = " ";
+		for (i = 0; i < num_fields; i++)
+		{
+			if (!fields[i].optional)
+			{
+				printf("%s!has_%s", separator, fields[i].name);
+				separator = " || ";
+			}
+		}
+		printf(";\n");
+	}
+	else
+	{
+		printf("\treturn false;\n");
+	}
+	printf("}\n");
+	printf("\n");
+}
+
+/** Output the helper functions which the encoders and decoders use. */
+static void printHelpers(void)
+{
+	printf("/** Write a varint.\n");
+	printf("  * \\param buffer Where to write the varint. This must have space for 5\n");
+	printf("  *               bytes.\n");
+	printf("  * \\param value The value to write.\n");
+	printf("  * \\return The number of bytes written.\n");
+	printf("  */\n");
+	printf("static size_t fastWriteVarint(uint8_t *buffer, uint32_t value)\n");
+	printf("{\n");
+	printf("\tsize_t length;\n");
+	printf("\n");
+	printf("\tlength = 0;\n");
+	printf("\twhile (value >= 0x80)\n");
+	printf("\t{\n");
+	printf("\t\tbuffer[length++] = (uint8_t)(value | 0x80);\n");
+	printf("\t\tvalue >>= 7;\n");
+	printf("\t}\n");
+	printf("\tbuffer[length++] = (uint8_t)value;\n");
+	printf("\treturn length;\n");
+	printf("}\n");
+	printf("\n");
+	printf("/** Read a varint. Like nanopb, this accepts varints of up to 64 bits, but\n");
+	printf("  * only keeps the least significant 32 bits.\n");
+	printf("  * \\param buffer The buffer to read from.\n");
+	printf("  * \\param length The length of buffer, in bytes.\n");
+	printf("  * \\param position The index into buffer to read from. This will be\n");
+	printf("  *                 advanced past the varint.\n");
+	printf("  * \\param out_value The value of the varint will be written here.\n");
+	printf("  * \\return false on success, true if the varint is truncated or too long.\n");
+	printf("  */\n");
+	printf("static bool fastReadVarint(const uint8_t *buffer, size_t length, size_t *position, uint32_t *out_value)\n");
+	printf("{\n");
+	printf("\tuint8_t one_byte;\n");
+	printf("\tuint8_t shift;\n");
+	printf("\tuint32_t value;\n");
+	printf("\n");
+	printf("\tvalue = 0;\n");
+	printf("\tshift = 0;\n");
+	printf("\tdo\n");
+	printf("\t{\n");
+	printf("\t\tif ((*position >= length) || (shift >= 64))\n");
+	printf("\t\t{\n");
+	printf("\t\t\treturn true;\n");
+	printf("\t\t}\n");
+	printf("\t\tone_byte = buffer[*position];\n");
+	printf("\t\t(*position)++;\n");
+	printf("\t\tif (shift < 32)\n");
+	printf("\t\t{\n");
+	printf("\t\t\tvalue |= (uint32_t)(one_byte & 0x7f) << shift;\n");
+	printf("\t\t}\n");
+	printf("\t\tshift = (uint8_t)(shift + 7);\n");
+	printf("\t} while ((one_byte & 0x80) != 0);\n");
+	printf("\t*out_value = value;\n");
+	printf("\treturn false;\n");
+	printf("}\n");
+	printf("\n");
+	printf("/** Skip over the value of a field which the decoder doesn't know about.\n");
+	printf("  * \\param buffer The buffer to read from.\n");
+	printf("  * \\param length The length of buffer, in bytes.\n");
+	printf("  * \\param position The index into buffer of the field's value. This will\n");
+	printf("  *                 be advanced past the value.\n");
+	printf("  * \\param key The key (tag and wire type) of the field.\n");
+	printf("  * \\return false on success, true if the value is truncated or the wire\n");
+	printf("  *         type is invalid.\n");
+	printf("  */\n");
+	printf("static bool fastSkipField(const uint8_t *buffer, size_t length, size_t *position, uint32_t key)\n");
+	printf("{\n");
+	printf("\tuint32_t value;\n");
+	printf("\tsize_t value_length;\n");
+	printf("\n");
+	printf("\tswitch (key & 7)\n");
+	printf("\t{\n");
+	printf("\tcase 0: // varint\n");
+	printf("\t\treturn fastReadVarint(buffer, length, position, &value);\n");
+	printf("\tcase 1: // 64 bit\n");
+	printf("\t\tvalue_length = 8;\n");
+	printf("\t\tbreak;\n");
+	printf("\tcase 2: // length-delimited\n");
+	printf("\t\tif (fastReadVarint(buffer, length, position, &value))\n");
+	printf("\t\t{\n");
+	printf("\t\t\treturn true;\n");
+	printf("\t\t}\n");
+	printf("\t\tvalue_length = value;\n");
+	printf("\t\tbreak;\n");
+	printf("\tcase 5: // 32 bit\n");
+	printf("\t\tvalue_length = 4;\n");
+	printf("\t\tbreak;\n");
+	printf("\tdefault:\n");
+	printf("\t\treturn true;\n");
+	printf("\t}\n");
+	printf("\tif (value_length > (length - *position))\n");
+	printf("\t{\n");
+	printf("\t\treturn true;\n");
+	printf("\t}\n");
+	printf("\t*position += value_length;\n");
+	printf("\treturn false;\n");
+	printf("}\n");
+	printf("\n");
+	printf("/** Decode a message which has no fields, by checking that everything in\n");
+	printf("  * it can be skipped. See fastDecode(). */\n");
+	printf("static bool fastDecodeEmpty(const uint8_t *buffer, size_t length)\n");
+	printf("{\n");
+	printf("\tsize_t position;\n");
+	printf("\tuint32_t key;\n");
+	printf("\n");
+	printf("\tposition = 0;\n");
+	printf("\twhile (position < length)\n");
+	printf("\t{\n");
+	printf("\t\tif (fastReadVarint(buffer, length, &position, &key)\n");
+	printf("\t\t\t|| fastSkipField(buffer, length, &position, key))\n");
+	printf("\t\t{\n");
+	printf("\t\t\treturn true;\n");
+	printf("\t\t}\n");
+	printf("\t}\n");
+	printf("\treturn false;\n");
+	printf("}\n");
+	printf("\n");
+}
+
+/** Output the functions which choose an encoder or decoder from a field
+  * description table.
+  * \param decode_field_counts The number of fields in each message in
+  *                            #decode_messages.
+  */
+static void printDispatchers(const unsigned int *decode_field_counts)
+{
+	unsigned int i;
+	unsigned int count;
+	bool first;
+
+	count = sizeof(encode_messages) / sizeof(encode_messages[0]);
+	printf("/** Check whether fastEncode() can encode a message.\n");
+	printf("  * \\param fields Field description array of the message.\n");
+	printf("  * \\return Whether there is a specialised encoder for the message.\n");
+	printf("  */\n");
+	printf("static bool canFastEncode(const pb_field_t fields[])\n");
+	printf("{\n");
+	for (i = 0; i < count; i++)
+	{
+		printf("\t%s (fields == %s_fields)%s\n", (i == 0) ? "return" : "\t||", encode_messages[i].name, (i == (count - 1)) ? ";" : "");
+	}
+	printf("}\n");
+	printf("\n");
+	printf("/** Encode a message using its specialised encoder. This produces exactly\n");
+	printf("  * the same bytes as pb_encode().\n");
+	printf("  * \\param fields Field description array of the message. canFastEncode()\n");
+	printf("  *               must have returned true for it.\n");
+	printf("  * \\param src_struct Field data which will be encoded.\n");
+	printf("  * \\param buffer Where the encoded message will be written. This must have\n");
+	printf("  *               space for #FAST_ENCODE_MAX_SIZE bytes.\n");
+	printf("  * \\param out_length The length of the encoded message, in bytes, will be\n");
+	printf("  *                   written here.\n");
+	printf("  * \\return false on success, true if a bytes field was too long.\n");
+	printf("  */\n");
+	printf("static bool fastEncode(const pb_field_t fields[], const void *src_struct, uint8_t *buffer, size_t *out_length)\n");
+	printf("{\n");
+	for (i = 0; i < count; i++)
+	{
+		printf("\t%sif (fields == %s_fields)\n", (i == 0) ? "" : "else ", encode_messages[i].name);
+		printf("\t{\n");
+		printf("\t\treturn fastEncode%s((const %s *)src_struct, buffer, out_length);\n", encode_messages[i].name, encode_messages[i].name);
+		printf("\t}\n");
+	}
+	printf("\telse\n");
+	printf("\t{\n");
+	printf("\t\tfatalError(); // canFastEncode() should have been checked\n");
+	printf("\t\treturn true;\n");
+	printf("\t}\n");
+	printf("}\n");
+	printf("\n");
+
+	count = sizeof(decode_messages) / sizeof(decode_messages[0]);
+	printf("/** Check whether fastDecode() can decode a message.\n");
+	printf("  * \\param fields Field description array of the message.\n");
+	printf("  * \\return Whether there is a specialised decoder for the message.\n");
+	printf("  */\n");
+	printf("static bool canFastDecode(const pb_field_t fields[])\n");
+	printf("{\n");
+	for (i = 0; i < count; i++)
+	{
+		printf("\t%s (fields == %s_fields)%s\n", (i == 0) ? "return" : "\t||", decode_messages[i].name, (i == (count - 1)) ? ";" : "");
+	}
+	printf("}\n");
+	printf("\n");
+	printf("/** Decode a message using its specialised decoder. This accepts the same\n");
+	printf("  * messages as pb_decode() does (including ones with unknown fields, which\n");
+	printf("  * are skipped), except that it is stricter about the wire type of known\n");
+	printf("  * fields.\n");
+	printf("  * \\param fields Field description array of the message. canFastDecode()\n");
+	printf("  *               must have returned true for it.\n");
+	printf("  * \\param buffer The encoded message.\n");
+	printf("  * \\param length The length of the encoded message, in bytes.\n");
+	printf("  * \\param dest_struct Where field data will be stored.\n");
+	printf("  * \\return false on success, true if a parse error occurred.\n");
+	printf("  */\n");
+	printf("static bool fastDecode(const pb_field_t fields[], const uint8_t *buffer, size_t length, void *dest_struct)\n");
+	printf("{\n");
+	first = true;
+	for (i = 0; i < count; i++)
+	{
+		if (decode_field_counts[i] != 0)
+		{
+			printf("\t%sif (fields == %s_fields)\n", first ? "" : "else ", decode_messages[i].name);
+			printf("\t{\n");
+			printf("\t\treturn fastDecode%s(buffer, length, (%s *)dest_struct);\n", decode_messages[i].name, decode_messages[i].name);
+			printf("\t}\n");
+			first = false;
+		}
+	}
+	// Messages without fields don't need their own decoder.
+	if (first)
+	{
+		printf("\treturn fastDecodeEmpty(buffer, length);\n");
+	}
+	else
+	{
+		printf("\telse\n");
+		printf("\t{\n");
+		printf("\t\treturn fastDecodeEmpty(buffer, length);\n");
+		printf("\t}\n");
+	}
+	printf("}\n");
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int i;
+	unsigned int num_fields;
+	unsigned int size;
+	unsigned int encode_max_size;
+	unsigned int decode_max_size;
+	Field fields[sizeof(encode_messages) / sizeof(encode_messages[0]) + sizeof(decode_messages) / sizeof(decode_messages[0])][MAX_FIELDS];
+	unsigned int field_counts[sizeof(fields) / sizeof(fields[0])];
+	unsigned int num_encode;
+	unsigned int num_decode;
+
+	if (argc != 2)
+	{
+		printf("Usage: %s <proto>\n", argv[0]);
+		printf("  <proto>: path to messages.proto\n");
+		printf("\n");
+		exit(1);
+	}
+	proto_filename = argv[1];
+
+	num_encode = sizeof(encode_messages) / sizeof(encode_messages[0]);
+	num_decode = sizeof(decode_messages) / sizeof(decode_messages[0]);
+	encode_max_size = 1;
+	decode_max_size = 1;
+	for (i = 0; i < num_encode; i++)
+	{
+		field_counts[i] = readProtoMessage(encode_messages[i].name, fields[i]);
+		checkFields(&(encode_messages[i]), fields[i], field_counts[i]);
+		size = maximumSize(fields[i], field_counts[i]);
+		encode_max_size = MAX(encode_max_size, size);
+	}
+	for (i = 0; i < num_decode; i++)
+	{
+		num_fields = readProtoMessage(decode_messages[i].name, fields[num_encode + i]);
+		field_counts[num_encode + i] = num_fields;
+		checkFields(&(decode_messages[i]), fields[num_encode + i], num_fields);
+		size = maximumSize(fields[num_encode + i], num_fields);
+		decode_max_size = MAX(decode_max_size, size);
+	}
+
+	printf("// Code generated using gen_fastpb.\n");
+	printf("\n");
+	printf("/** Maximum encoded size, in bytes, of any message which fastEncode() can\n");
+	printf("  * encode. */\n");
+	printf("#define FAST_ENCODE_MAX_SIZE\t%u\n", encode_max_size);
+	printf("/** Maximum encoded size, in bytes, of any message which fastDecode() can\n");
+	printf("  * decode, not counting unknown fields. */\n");
+	printf("#define FAST_DECODE_MAX_SIZE\t%u\n", decode_max_size);
+	printf("\n");
+	printHelpers();
+	for (i = 0; i < num_encode; i++)
+	{
+		printEncoder(encode_messages[i].name, fields[i], field_counts[i]);
+	}
+	for (i = 0; i < num_decode; i++)
+	{
+		if (field_counts[num_encode + i] != 0)
+		{
+			printDecoder(decode_messages[i].name, fields[num_encode + i], field_counts[num_encode + i]);
+		}
+	}
+	printDispatchers(&(field_counts[num_encode]));
+	return 0;
+}
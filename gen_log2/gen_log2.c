@@ -0,0 +1,73 @@
+/** \file gen_log2.c
+  *
+  * \brief Generates fixed-point base 2 logarithm lookup table.
+  *
+  * This generates the lookup table in statistics_log2_table.h, for use in
+  * statistics.c. This outputs the table as C source, with integer constants
+  * representing log2(1 + i / size) in 16.16 fixed-point format, for i in
+  * [0, size). statistics.c linearly interpolates between entries, and uses
+  * log2(2) = 1 as the entry after the last one.
+  *
+  * Only the fractional part of log2(1 + i / size) is outputted, since it is
+  * in [0, 1).
+  *
+  * This file is licensed as described by the file LICENCE.
+  */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+/** Number of constants per line in C source output. */
+#define VALUES_PER_LINE		8
+
+int main(int argc, char **argv)
+{
+	int i;
+	int table_size;
+	unsigned int out; // C spec guarantees unsigned int can hold [0, 65535]
+
+	if (argc != 2)
+	{
+		printf("Usage: %s <size>\n", argv[0]);
+		printf("  <size>: number of table entries; must be a power of 2\n");
+		printf("\n");
+		exit(1);
+	}
+	if (sscanf(argv[1], "%d", &table_size) != 1)
+	{
+		printf("Error: Invalid size\n");
+		exit(1);
+	}
+	if ((table_size < 2) || ((table_size & (table_size - 1)) != 0))
+	{
+		printf("Error: Invalid size\n");
+		exit(1);
+	}
+
+	printf("// Table generated using gen_log2.\n");
+	printf("// Table size: %d.\n", table_size);
+	printf("static const uint16_t log2_lookup[%d] = {\n", table_size);
+	for (i = 0; i < table_size; i++)
+	{
+		// The "* (double)0x00010000" is to convert to 16.16 fixed-point.
+		// The "+ 0.5" is to get the (unsigned int) cast to round instead of
+		// truncating.
+		out = (unsigned int)(log2(1.0 + (double)i / (double)table_size) * (double)0x00010000 + 0.5);
+		printf("0x%04x", out);
+		if (i == (table_size - 1))
+		{
+			printf("\n");
+		}
+		else if ((i % VALUES_PER_LINE) == (VALUES_PER_LINE - 1))
+		{
+			printf(",\n");
+		}
+		else
+		{
+			printf(", ");
+		}
+	}
+	printf("};\n");
+	exit(0);
+}
@@ -2,9 +2,11 @@
   *
   * \brief Generates fixed-point twiddle factor lookup table.
   *
-  * This generates the twiddle factor lookup table for use in fft.c. This
-  * outputs the table as C source, with integer constants representing
-  * sin(phi) in 16.16 fixed-point format.
+  * This generates the twiddle factor lookup tables in fft_twiddle_table.h,
+  * for use in fft.c. This outputs a table as C source, with integer constants
+  * representing sin(phi) in 16.16 fixed-point format. fft.c needs the table
+  * for a FFT of size 2 * #FFT_SIZE, since fftPostProcessReal() uses twiddle
+  * factors of that size.
   *
   * There are a couple of space optimisations:
   * - Only sin(phi) values for the first quadrant; phi in [0, pi / 2); are
@@ -38,7 +40,7 @@ int main(int argc, char **argv)
 	if (argc != 2)
 	{
 		printf("Usage: %s <size>\n", argv[0]);
-		printf("  <size>: size of (complex) FFT\n");
+		printf("  <size>: size of (complex) FFT; must be a power of 2\n");
 		printf("\n");
 		exit(1);
 	}
@@ -47,7 +49,7 @@ int main(int argc, char **argv)
 		printf("Error: Invalid size\n");
 		exit(1);
 	}
-	if (fft_size <= 0)
+	if ((fft_size < 4) || ((fft_size & (fft_size - 1)) != 0))
 	{
 		printf("Error: Invalid size\n");
 		exit(1);
@@ -59,7 +61,7 @@ int main(int argc, char **argv)
 	table_size = (fft_size / 4);
 	printf("// Table generated using gen_twiddle.\n");
 	printf("// FFT size: %d.\n", fft_size);
-	printf("const uint16_t twiddle_factor_lookup[%d] = {\n", table_size);
+	printf("static const uint16_t twiddle_factor_lookup[%d] = {\n", table_size);
 	for (i = 0; i < table_size; i++)
 	{
 		// The "* (double)0x00010000" is to convert to 16.16 fixed-point.
@@ -67,13 +69,17 @@ int main(int argc, char **argv)
 		// truncating.
 		out = (unsigned int)(sin(i * (2.0 * PI / (double)fft_size)) * (double)0x00010000 + 0.5);
 		printf("0x%04x", out);
-		if (i != (table_size - 1))
+		if (i == (table_size - 1))
 		{
-			printf(", ");
+			printf("\n");
 		}
-		if ((i % VALUES_PER_LINE) == (VALUES_PER_LINE - 1))
+		else if ((i % VALUES_PER_LINE) == (VALUES_PER_LINE - 1))
 		{
-			printf("\n");
+			printf(",\n");
+		}
+		else
+		{
+			printf(", ");
 		}
 	}
 	printf("};\n");
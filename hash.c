@@ -70,15 +70,104 @@ void hashWriteByte(HashState *hs, uint8_t byte)
 	}
 }
 
+/** Add an array of bytes to the message buffer, calling HashState#hashBlock()
+  * whenever the message buffer is full. This gives the same result as
+  * calling hashWriteByte() for each byte, but it is much faster for long
+  * arrays, since whole (32 bit) words are written into HashState#m at once
+  * whenever the message buffer is word-aligned.
+  * \param hs The hash state to act on.
+  * \param bytes The bytes to add.
+  * \param length The number of bytes to add.
+  */
+void hashWriteBytes(HashState *hs, const uint8_t *bytes, uint32_t length)
+{
+	// Write bytes one at a time until the message buffer is word-aligned.
+	while ((length > 0) && (hs->byte_position_m != 0))
+	{
+		hashWriteByte(hs, *bytes);
+		bytes++;
+		length--;
+	}
+	// Write whole words.
+	while (length >= 4)
+	{
+		if (hs->is_big_endian)
+		{
+			hs->m[hs->index_m] = readU32BigEndian(bytes);
+		}
+		else
+		{
+			hs->m[hs->index_m] = readU32LittleEndian(bytes);
+		}
+		hs->index_m++;
+		hs->message_length += 4;
+		if (hs->index_m == 16)
+		{
+			hs->hashBlock(hs);
+			clearM(hs);
+		}
+		bytes += 4;
+		length -= 4;
+	}
+	// Write any remaining bytes.
+	while (length > 0)
+	{
+		hashWriteByte(hs, *bytes);
+		bytes++;
+		length--;
+	}
+}
+
+/** Swap the endianness of the hash value, if the hash function is a
+  * little-endian one. This is the last step of hashFinish() and
+  * hashShortMessage().
+  * \param hs The hash state to act on.
+  */
+static void fixHashEndianness(HashState *hs)
+{
+	uint8_t i;
+
+	if (!hs->is_big_endian)
+	{
+		for	(i = 0; i < 8; i++)
+		{
+			swapEndian(&(hs->h[i]));
+		}
+	}
+}
+
+/** Write the message length (in bits) into the last two words of the
+  * message buffer, in the order the hash function expects. The rest of
+  * the message buffer must already be filled.
+  * \param hs The hash state to act on.
+  * \param length_bits The length of the message, in bits.
+  */
+static void writeLengthWords(HashState *hs, uint32_t length_bits)
+{
+	if (hs->is_big_endian)
+	{
+		hs->m[14] = 0;
+		hs->m[15] = length_bits;
+	}
+	else
+	{
+		hs->m[14] = length_bits;
+		hs->m[15] = 0;
+	}
+}
+
 /** Finalise the hashing of a message by writing appropriate padding and
   * length bytes.
+  *
+  * Only the 0x80 byte which begins the padding goes through hashWriteByte().
+  * The rest of the padding is zeroes, which hashWriteByte() and
+  * hashWriteBytes() have already left in every unused word of the message
+  * buffer, so the length words can be written directly.
   * \param hs The hash state to act on.
   */
 void hashFinish(HashState *hs)
 {
 	uint32_t length_bits;
-	uint8_t i;
-	uint8_t buffer[8];
 
 	// Subsequent calls to hashWriteByte() will keep incrementing
 	// message_length, so the calculation of length (in bits) must be
@@ -86,34 +175,87 @@ void hashFinish(HashState *hs)
 	length_bits = hs->message_length << 3;
 
 	// Pad using a 1 bit followed by enough 0 bits to get the message buffer
-	// to exactly 448 bits full.
+	// to exactly 448 bits full. If the length words don't fit in the current
+	// block, it is hashed as is and the length goes into the next one.
 	hashWriteByte(hs, (uint8_t)0x80);
-	while ((hs->index_m != 14) || (hs->byte_position_m != 0))
+	if (hs->byte_position_m != 0)
 	{
-		hashWriteByte(hs, 0);
-	}
-	// Write 64 bit length (in bits).
-	memset(buffer, 0, 8);
-	if (hs->is_big_endian)
-	{
-		writeU32BigEndian(&(buffer[4]), length_bits);
+		hs->index_m++;
+		hs->byte_position_m = 0;
 	}
-	else
+	if (hs->index_m > 14)
 	{
-		writeU32LittleEndian(&(buffer[0]), length_bits);
+		hs->hashBlock(hs);
+		clearM(hs);
 	}
-	for (i = 0; i < 8; i++)
+	// Write 64 bit length (in bits).
+	writeLengthWords(hs, length_bits);
+	hs->hashBlock(hs);
+	clearM(hs);
+	fixHashEndianness(hs);
+}
+
+/** Calculate the hash of a message which fits in a single block, including
+  * padding. This gives the same result as calling hashWriteBytes() then
+  * hashFinish(), but the message buffer is filled in directly, so the hash
+  * function's block function is called exactly once.
+  * \param hs The hash state to act on. This must have just been initialised
+  *           by the hash function's Begin function (eg. sha256Begin()).
+  * \param message The message to hash.
+  * \param length The length of the message, in bytes. This must be no more
+  *               than #HASH_SHORT_MESSAGE_MAX.
+  */
+void hashShortMessage(HashState *hs, const uint8_t *message, uint8_t length)
+{
+	uint8_t full_words;
+	uint8_t i;
+	uint8_t shift;
+	uint32_t word;
+
+	full_words = (uint8_t)(length >> 2);
+	for (i = 0; i < full_words; i++)
 	{
-		hashWriteByte(hs, buffer[i]);
+		if (hs->is_big_endian)
+		{
+			hs->m[i] = readU32BigEndian(&(message[i * 4]));
+		}
+		else
+		{
+			hs->m[i] = readU32LittleEndian(&(message[i * 4]));
+		}
 	}
-	// Swap endianness if necessary.
-	if (!hs->is_big_endian)
+	// The last partial word (which may have no message bytes in it) gets the
+	// 0x80 byte which begins the padding.
+	word = 0;
+	for (i = (uint8_t)(full_words * 4); i <= length; i++)
 	{
-		for	(i = 0; i < 8; i++)
+		if (hs->is_big_endian)
 		{
-			swapEndian(&(hs->h[i]));
+			shift = (uint8_t)(24 - 8 * (i & 3));
+		}
+		else
+		{
+			shift = (uint8_t)(8 * (i & 3));
+		}
+		if (i < length)
+		{
+			word |= (uint32_t)message[i] << shift;
 		}
+		else
+		{
+			word |= (uint32_t)0x80 << shift;
+		}
+	}
+	hs->m[full_words] = word;
+	for (i = (uint8_t)(full_words + 1); i < 14; i++)
+	{
+		hs->m[i] = 0;
 	}
+	writeLengthWords(hs, (uint32_t)length << 3);
+	hs->message_length = length;
+	hs->hashBlock(hs);
+	clearM(hs);
+	fixHashEndianness(hs);
 }
 
 /** Write the hash value into a byte array, respecting endianness.
@@ -10,6 +10,11 @@
 
 #include "common.h"
 
+/** Maximum length, in bytes, of a message which can be passed to
+  * hashShortMessage(). This is the size of a message block, minus 1 byte for
+  * the start of the padding and 8 bytes for the message length. */
+#define HASH_SHORT_MESSAGE_MAX		55
+
 /** Container for common hash state. */
 typedef struct HashStateStruct
 {
@@ -37,7 +42,9 @@ typedef struct HashStateStruct
 
 extern void clearM(HashState *hs);
 extern void hashWriteByte(HashState *hs, uint8_t byte);
+extern void hashWriteBytes(HashState *hs, const uint8_t *bytes, uint32_t length);
 extern void hashFinish(HashState *hs);
+extern void hashShortMessage(HashState *hs, const uint8_t *message, uint8_t length);
 extern void writeHashToByteArray(uint8_t *out, HashState *hs, bool do_write_big_endian);
 
 #endif // #ifndef HASH_H_INCLUDED
@@ -0,0 +1,457 @@
+/** \file hash160.c
+  *
+  * \brief Calculates HASH160 (RIPEMD-160 of SHA-256) of short messages.
+  *
+  * HASH160 is what turns a serialised public key into an address, and it
+  * is also used for BIP32 key fingerprints. Calculating it the obvious way
+  * involves writing the SHA-256 hash out to a byte array, then feeding it
+  * back into RIPEMD-160 one byte at a time. Since the SHA-256 hash is
+  * always exactly 32 bytes, the RIPEMD-160 message block can be built
+  * directly from the SHA-256 hash state words instead, along with the
+  * padding, so that RIPEMD-160 needs just one call to its block function.
+  *
+  * Serialised public keys are always 33 (compressed) or 65 (uncompressed)
+  * bytes long, so the SHA-256 message blocks (including padding) for those
+  * lengths are built directly too, without going through hashWriteByte().
+  * hash160Batch() uses this to hash several public keys at once with
+  * sha256BlockMulti(), which is much faster on hosts built with
+  * SHA256_MULTI_BUFFER defined.
+  *
+  * This file is licensed as described by the file LICENCE.
+  */
+
+#ifdef TEST_HASH160
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "test_helpers.h"
+#endif // #ifdef TEST_HASH160
+
+#ifdef BENCH_HASH160
+#include <stdlib.h>
+#include "test_helpers.h"
+#endif // #ifdef BENCH_HASH160
+
+#include "common.h"
+#include "endian.h"
+#include "hash.h"
+#include "sha256.h"
+#include "ripemd160.h"
+#include "hash160.h"
+
+/** Fill in a SHA-256 message block directly from 64 bytes of a message.
+  * \param hs The hash state whose message buffer will be filled in.
+  * \param data The 64 bytes of the message.
+  */
+static void fillFullBlock(HashState *hs, const uint8_t *data)
+{
+	uint8_t i;
+
+	for (i = 0; i < 16; i++)
+	{
+		hs->m[i] = readU32BigEndian(&(data[i * 4]));
+	}
+}
+
+/** Fill in the final SHA-256 message block of a 33 or 65 byte message. Both
+  * lengths leave exactly one byte in the final block, so it always fits in
+  * the same place.
+  * \param hs The hash state whose message buffer will be filled in.
+  * \param data The whole message. This must be a byte array of the size
+  *             specified by length.
+  * \param length The length of the message, in bytes. This must be 33 or
+  *               65.
+  */
+static void fillPublicKeyFinalBlock(HashState *hs, const uint8_t *data, uint32_t length)
+{
+	uint8_t i;
+	uint8_t last;
+
+	// The final block contains the rest of the message (1 or 33 bytes),
+	// then 0x80, then zeroes, then the length in bits.
+	data += length & ~(uint32_t)63;
+	last = (uint8_t)((length & 63) >> 2);
+	for (i = 0; i < last; i++)
+	{
+		hs->m[i] = readU32BigEndian(&(data[i * 4]));
+	}
+	hs->m[last] = ((uint32_t)data[last * 4] << 24) | 0x00800000;
+	for (i = (uint8_t)(last + 1); i < 15; i++)
+	{
+		hs->m[i] = 0;
+	}
+	hs->m[15] = length << 3;
+}
+
+/** Calculate SHA-256 of a 33 or 65 byte message, by filling in the message
+  * blocks directly.
+  * \param hs The hash state to use. This must have just been initialised
+  *           using sha256Begin(). When this returns, the hash will be in
+  *           HashState#h.
+  * \param data The message. This must be a byte array of the size
+  *             specified by length.
+  * \param length The length of the message, in bytes. This must be 33 or
+  *               65.
+  */
+static void sha256PublicKey(HashState *hs, const uint8_t *data, uint32_t length)
+{
+	if (length == 65)
+	{
+		fillFullBlock(hs, data);
+		hs->hashBlock(hs);
+	}
+	fillPublicKeyFinalBlock(hs, data, length);
+	hs->hashBlock(hs);
+}
+
+/** Calculate RIPEMD-160 of a SHA-256 hash.
+  * \param out The 20 byte hash will be written here. See hash160().
+  * \param hs A hash state which holds a finished SHA-256 hash in
+  *           HashState#h. It will be reused for the RIPEMD-160 calculation.
+  */
+static void ripemd160OfSha256(uint8_t *out, HashState *hs)
+{
+	uint32_t sha256_hash[8];
+	uint8_t i;
+
+	for (i = 0; i < 8; i++)
+	{
+		sha256_hash[i] = hs->h[i];
+	}
+
+	// SHA-256 words are big-endian, but RIPEMD-160 loads its message words
+	// in a little-endian manner, so each word needs to be byte-swapped.
+	ripemd160Begin(hs);
+	for (i = 0; i < 8; i++)
+	{
+		hs->m[i] = sha256_hash[i];
+		swapEndian(&(hs->m[i]));
+	}
+	hs->m[8] = 0x00000080;
+	for (i = 9; i < 16; i++)
+	{
+		hs->m[i] = 0;
+	}
+	hs->m[14] = 256; // length in bits
+	hs->hashBlock(hs);
+	for (i = 0; i < 5; i++)
+	{
+		writeU32LittleEndian(&(out[i * 4]), hs->h[i]);
+	}
+}
+
+/** Calculate RIPEMD-160 of SHA-256 of a message.
+  * \param out The 20 byte hash will be written here, in the same order
+  *            as the bytes written by writeHashToByteArray() (with
+  *            do_write_big_endian set) after a byte-by-byte calculation.
+  *            This must be a byte array with space for 20 bytes. It may
+  *            overlap data, since it is only written to at the end.
+  * \param data The message. This must be a byte array of the size
+  *             specified by length.
+  * \param length The length of the message, in bytes. Messages which are
+  *               33 or 65 bytes long (serialised public keys) are faster.
+  */
+void hash160(uint8_t *out, const uint8_t *data, uint32_t length)
+{
+	HashState hs;
+
+	sha256Begin(&hs);
+	if ((length == 33) || (length == 65))
+	{
+		sha256PublicKey(&hs, data, length);
+	}
+	else
+	{
+		sha256WriteBytes(&hs, data, length);
+		sha256Finish(&hs);
+	}
+	ripemd160OfSha256(out, &hs);
+}
+
+/** Calculate RIPEMD-160 of SHA-256 of several messages of the same length.
+  * The result is the same as calling hash160() on each message, but for
+  * 33 or 65 byte messages (serialised public keys), the SHA-256 part is done
+  * #HASH160_BATCH_SIZE messages at a time using sha256BlockMulti().
+  * \param out The hashes will be written here, one after the other. This
+  *            must be a byte array with space for count * 20 bytes. It must
+  *            not overlap data.
+  * \param data The messages, one after the other. This must be a byte array
+  *             of count * length bytes.
+  * \param length The length of each message, in bytes.
+  * \param count The number of messages.
+  */
+void hash160Batch(uint8_t *out, const uint8_t *data, uint32_t length, uint32_t count)
+{
+	HashState hs[HASH160_BATCH_SIZE];
+	HashState *states[HASH160_BATCH_SIZE];
+	uint32_t n;
+	uint8_t i;
+
+	if ((length != 33) && (length != 65))
+	{
+		for (; count > 0; count--)
+		{
+			hash160(out, data, length);
+			out += 20;
+			data += length;
+		}
+		return;
+	}
+	while (count > 0)
+	{
+		n = MIN(count, HASH160_BATCH_SIZE);
+		for (i = 0; i < n; i++)
+		{
+			sha256Begin(&(hs[i]));
+			states[i] = &(hs[i]);
+		}
+		if (length == 65)
+		{
+			for (i = 0; i < n; i++)
+			{
+				fillFullBlock(&(hs[i]), &(data[i * length]));
+			}
+			sha256BlockMulti(states, (uint8_t)n);
+		}
+		for (i = 0; i < n; i++)
+		{
+			fillPublicKeyFinalBlock(&(hs[i]), &(data[i * length]), length);
+		}
+		sha256BlockMulti(states, (uint8_t)n);
+		for (i = 0; i < n; i++)
+		{
+			ripemd160OfSha256(&(out[i * 20]), &(hs[i]));
+		}
+		out += n * 20;
+		data += n * length;
+		count -= n;
+	}
+}
+
+#if defined(TEST_HASH160) || defined(BENCH_HASH160)
+
+/** Calculate RIPEMD-160 of SHA-256 of a message the obvious way, one byte
+  * at a time.
+  * \param out See hash160().
+  * \param data See hash160().
+  * \param length See hash160().
+  */
+static void referenceHash160(uint8_t *out, const uint8_t *data, uint32_t length)
+{
+	HashState hs;
+	uint8_t buffer[32];
+	uint32_t i;
+
+	sha256Begin(&hs);
+	for (i = 0; i < length; i++)
+	{
+		sha256WriteByte(&hs, data[i]);
+	}
+	sha256Finish(&hs);
+	writeHashToByteArray(buffer, &hs, true);
+	ripemd160Begin(&hs);
+	for (i = 0; i < 32; i++)
+	{
+		ripemd160WriteByte(&hs, buffer[i]);
+	}
+	ripemd160Finish(&hs);
+	writeHashToByteArray(buffer, &hs, true);
+	memcpy(out, buffer, 20);
+}
+
+#endif // #if defined(TEST_HASH160) || defined(BENCH_HASH160)
+
+#ifdef TEST_HASH160
+
+/** Compressed public key for private key 1. */
+static const uint8_t test_compressed_key[33] = {
+0x02, 0x79, 0xbe, 0x66, 0x7e, 0xf9, 0xdc, 0xbb,
+0xac, 0x55, 0xa0, 0x62, 0x95, 0xce, 0x87, 0x0b,
+0x07, 0x02, 0x9b, 0xfc, 0xdb, 0x2d, 0xce, 0x28,
+0xd9, 0x59, 0xf2, 0x81, 0x5b, 0x16, 0xf8, 0x17,
+0x98};
+
+/** HASH160 of #test_compressed_key. */
+static const uint8_t test_compressed_hash[20] = {
+0x75, 0x1e, 0x76, 0xe8, 0x19, 0x91, 0x96, 0xd4,
+0x54, 0x94, 0x1c, 0x45, 0xd1, 0xb3, 0xa3, 0x23,
+0xf1, 0x43, 0x3b, 0xd6};
+
+/** Uncompressed public key for private key 1. */
+static const uint8_t test_uncompressed_key[65] = {
+0x04, 0x79, 0xbe, 0x66, 0x7e, 0xf9, 0xdc, 0xbb,
+0xac, 0x55, 0xa0, 0x62, 0x95, 0xce, 0x87, 0x0b,
+0x07, 0x02, 0x9b, 0xfc, 0xdb, 0x2d, 0xce, 0x28,
+0xd9, 0x59, 0xf2, 0x81, 0x5b, 0x16, 0xf8, 0x17,
+0x98, 0x48, 0x3a, 0xda, 0x77, 0x26, 0xa3, 0xc4,
+0x65, 0x5d, 0xa4, 0xfb, 0xfc, 0x0e, 0x11, 0x08,
+0xa8, 0xfd, 0x17, 0xb4, 0x48, 0xa6, 0x85, 0x54,
+0x19, 0x9c, 0x47, 0xd0, 0x8f, 0xfb, 0x10, 0xd4,
+0xb8};
+
+/** HASH160 of #test_uncompressed_key. */
+static const uint8_t test_uncompressed_hash[20] = {
+0x91, 0xb2, 0x4b, 0xf9, 0xf5, 0x28, 0x85, 0x32,
+0x96, 0x0a, 0xc6, 0x87, 0xab, 0xb0, 0x35, 0x12,
+0x7b, 0x1d, 0x28, 0xa5};
+
+/** Number of random messages of each length to test. */
+#define RANDOM_TESTS_PER_LENGTH		50
+
+/** Maximum number of messages to give hash160Batch() in each test. This is
+  * more than #HASH160_BATCH_SIZE so that a partly filled final batch is
+  * covered. */
+#define TEST_BATCH_COUNT			21
+
+/** Message lengths to give hash160Batch(). Public key lengths are hashed
+  * several at a time; other lengths aren't. */
+static const uint32_t batch_lengths[3] = {32, 33, 65};
+
+/** Check hash160() against a known hash.
+  * \param data The message.
+  * \param length The length of the message, in bytes.
+  * \param expected The expected hash, which must be 20 bytes long.
+  * \param name Description of the test, printed on failure.
+  */
+static void checkKnownHash(const uint8_t *data, uint32_t length, const uint8_t *expected, const char *name)
+{
+	uint8_t out[20];
+
+	hash160(out, data, length);
+	if (!memcmp(out, expected, 20))
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("Known hash test failed for %s\n", name);
+		reportFailure();
+	}
+}
+
+int main(void)
+{
+	uint8_t data[130];
+	uint8_t out[20];
+	uint8_t compare_out[20];
+	uint8_t batch_data[TEST_BATCH_COUNT * 65];
+	uint8_t batch_out[TEST_BATCH_COUNT * 20];
+	uint32_t length;
+	uint32_t count;
+	uint32_t j;
+	int i;
+
+	initTests(__FILE__);
+
+	checkKnownHash(test_compressed_key, sizeof(test_compressed_key), test_compressed_hash, "compressed key");
+	checkKnownHash(test_uncompressed_key, sizeof(test_uncompressed_key), test_uncompressed_hash, "uncompressed key");
+
+	// Compare against the byte-by-byte calculation for every length up to
+	// a little over two SHA-256 blocks, so that both the public key fast
+	// paths and the general path are covered.
+	for (length = 0; length <= sizeof(data); length++)
+	{
+		for (i = 0; i < RANDOM_TESTS_PER_LENGTH; i++)
+		{
+			fillWithRandom(data, length);
+			hash160(out, data, length);
+			referenceHash160(compare_out, data, length);
+			if (!memcmp(out, compare_out, 20))
+			{
+				reportSuccess();
+			}
+			else
+			{
+				printf("Mismatch for length %u, test %d\n", length, i);
+				reportFailure();
+			}
+		}
+	}
+
+	// hash160Batch() should give the same results as hash160() on each
+	// message.
+	for (i = 0; i < (int)(sizeof(batch_lengths) / sizeof(batch_lengths[0])); i++)
+	{
+		length = batch_lengths[i];
+		for (count = 0; count <= TEST_BATCH_COUNT; count++)
+		{
+			fillWithRandom(batch_data, count * length);
+			hash160Batch(batch_out, batch_data, length, count);
+			for (j = 0; j < count; j++)
+			{
+				hash160(out, &(batch_data[j * length]), length);
+				if (memcmp(out, &(batch_out[j * 20]), 20))
+				{
+					break;
+				}
+			}
+			if (j == count)
+			{
+				reportSuccess();
+			}
+			else
+			{
+				printf("hash160Batch() mismatch for length %u, count %u, message %u\n", length, count, j);
+				reportFailure();
+			}
+		}
+	}
+
+	finishTests();
+	exit(0);
+}
+
+#endif // #ifdef TEST_HASH160
+
+#ifdef BENCH_HASH160
+
+/** Input for the HASH160 benchmarks. */
+static uint8_t bench_input[65];
+/** Output for the HASH160 benchmarks. */
+static uint8_t bench_output[20];
+
+/** Hash a compressed public key using hash160(). */
+static void benchHash160Compressed(void)
+{
+	hash160(bench_output, bench_input, 33);
+}
+
+/** Hash an uncompressed public key using hash160(). */
+static void benchHash160Uncompressed(void)
+{
+	hash160(bench_output, bench_input, 65);
+}
+
+/** Number of compressed public keys hashed by benchHash160Batch(). */
+#define BENCH_BATCH_COUNT			64
+
+/** Input for the hash160Batch() benchmark. */
+static uint8_t bench_batch_input[BENCH_BATCH_COUNT * 33];
+/** Output for the hash160Batch() benchmark. */
+static uint8_t bench_batch_output[BENCH_BATCH_COUNT * 20];
+
+/** Hash #BENCH_BATCH_COUNT compressed public keys using hash160Batch(). */
+static void benchHash160Batch(void)
+{
+	hash160Batch(bench_batch_output, bench_batch_input, 33, BENCH_BATCH_COUNT);
+}
+
+/** Hash a compressed public key the obvious way, for comparison. */
+static void benchHash160Reference(void)
+{
+	referenceHash160(bench_output, bench_input, 33);
+}
+
+int main(void)
+{
+	initBenchmarks(__FILE__);
+	fillWithRandom(bench_input, sizeof(bench_input));
+	fillWithRandom(bench_batch_input, sizeof(bench_batch_input));
+	runHostBenchmark("hash160_33", &benchHash160Compressed, 33);
+	runHostBenchmark("hash160_33_batch", &benchHash160Batch, sizeof(bench_batch_input));
+	runHostBenchmark("hash160_65", &benchHash160Uncompressed, 65);
+	runHostBenchmark("hash160_33_bytewise", &benchHash160Reference, 33);
+	exit(0);
+}
+
+#endif // #ifdef BENCH_HASH160
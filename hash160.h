@@ -0,0 +1,24 @@
+/** \file hash160.h
+  *
+  * \brief Describes functions exported by hash160.c.
+  *
+  * This file is licensed as described by the file LICENCE.
+  */
+
+#ifndef HASH160_H_INCLUDED
+#define HASH160_H_INCLUDED
+
+#include "common.h"
+
+#ifndef HASH160_BATCH_SIZE
+/** Maximum number of messages which hash160Batch() hashes at once. Each one
+  * needs a #HashState on the stack. This can be overridden by defining
+  * HASH160_BATCH_SIZE in the platform's build settings.
+  */
+#define HASH160_BATCH_SIZE		8
+#endif // #ifndef HASH160_BATCH_SIZE
+
+extern void hash160(uint8_t *out, const uint8_t *data, uint32_t length);
+extern void hash160Batch(uint8_t *out, const uint8_t *data, uint32_t length, uint32_t count);
+
+#endif // #ifndef HASH160_H_INCLUDED
@@ -54,10 +54,64 @@
 #include "test_helpers.h"
 #endif // #ifdef TEST_HMAC_DRBG
 
-/** Calculate a 32 byte HMAC of an arbitrary message and key using SHA-256 as
-  * the hash function.
+/** A HMAC-SHA256 key which has been prepared using hmacSha256Begin(). This
+  * holds the SHA-256 states after hashing the inner and outer padded key
+  * blocks, so that the key doesn't need to be hashed again for every
+  * message. */
+typedef struct HmacSha256ContextStruct
+{
+	/** SHA-256 state after hashing (K_0 XOR ipad). */
+	HashState inner;
+	/** SHA-256 state after hashing (K_0 XOR opad). */
+	HashState outer;
+} HmacSha256Context;
+
+/** Prepare a HMAC-SHA256 context for a given key, so that the context can
+  * then be used (with hmacSha256Compute()) to calculate the HMAC of any
+  * number of messages without having to hash the key again.
   * The code in here is based on the description in section 5
   * ("HMAC SPECIFICATION") of FIPS PUB 198.
+  * \param ctx The HMAC-SHA256 context to initialise.
+  * \param key A byte array containing the key to use in the HMAC-SHA256
+  *            calculation. The key can be of any length.
+  * \param key_length The length, in bytes, of the key.
+  */
+static void hmacSha256Begin(HmacSha256Context *ctx, const uint8_t *key, const unsigned int key_length)
+{
+	unsigned int i;
+	uint8_t padded_key[64];
+
+	// Determine key.
+	memset(padded_key, 0, sizeof(padded_key));
+	if (key_length <= sizeof(padded_key))
+	{
+		memcpy(padded_key, key, key_length);
+	}
+	else
+	{
+		sha256Begin(&(ctx->inner));
+		sha256WriteBytes(&(ctx->inner), key, key_length);
+		sha256Finish(&(ctx->inner));
+		writeHashToByteArray(padded_key, &(ctx->inner), true);
+	}
+	// Hash K_0 XOR ipad, which begins H((K_0 XOR ipad) || text).
+	sha256Begin(&(ctx->inner));
+	for (i = 0; i < sizeof(padded_key); i++)
+	{
+		sha256WriteByte(&(ctx->inner), (uint8_t)(padded_key[i] ^ 0x36));
+	}
+	// Hash K_0 XOR opad, which begins H((K_0 XOR opad) || hash).
+	sha256Begin(&(ctx->outer));
+	for (i = 0; i < sizeof(padded_key); i++)
+	{
+		sha256WriteByte(&(ctx->outer), (uint8_t)(padded_key[i] ^ 0x5c));
+	}
+	memset(padded_key, 0, sizeof(padded_key));
+}
+
+/** Calculate a 32 byte HMAC of an arbitrary message using a HMAC-SHA256
+  * context which was previously prepared by hmacSha256Begin(). The context
+  * is not modified, so it can be re-used for other messages.
   *
   * The message can be split up into two separate parts, (denoted by the
   * parameters text1 and text2). This is done because the HMAC_DRBG update
@@ -67,9 +121,7 @@
   * contiguous buffer.
   * \param out A byte array where the HMAC-SHA256 hash value will be written.
   *            This must have space for #SHA256_HASH_LENGTH bytes.
-  * \param key A byte array containing the key to use in the HMAC-SHA256
-  *            calculation. The key can be of any length.
-  * \param key_length The length, in bytes, of the key.
+  * \param ctx The prepared HMAC-SHA256 context, which determines the key.
   * \param text1 A byte array containing the first part of the message to use
   *              in the HMAC-SHA256 calculation. The message can be of any
   *              length.
@@ -82,66 +134,56 @@
   * \param text2_length The length, in bytes, of the second part of the
   *                     message.
   */
-static void hmacSha256(uint8_t *out, const uint8_t *key, const unsigned int key_length, const uint8_t *text1, const unsigned int text1_length, const uint8_t *text2, const unsigned int text2_length)
+static void hmacSha256Compute(uint8_t *out, const HmacSha256Context *ctx, const uint8_t *text1, const unsigned int text1_length, const uint8_t *text2, const unsigned int text2_length)
 {
-	unsigned int i;
 	uint8_t hash[SHA256_HASH_LENGTH];
-	uint8_t padded_key[64];
 	HashState hs;
 
-	// Determine key.
-	memset(padded_key, 0, sizeof(padded_key));
-	if (key_length <= sizeof(padded_key))
-	{
-		memcpy(padded_key, key, key_length);
-	}
-	else
-	{
-		sha256Begin(&hs);
-		for (i = 0; i < key_length; i++)
-		{
-			sha256WriteByte(&hs, key[i]);
-		}
-		sha256Finish(&hs);
-		writeHashToByteArray(padded_key, &hs, true);
-	}
 	// Calculate hash = H((K_0 XOR ipad) || text).
-	sha256Begin(&hs);
-	for (i = 0; i < sizeof(padded_key); i++)
-	{
-		sha256WriteByte(&hs, (uint8_t)(padded_key[i] ^ 0x36));
-	}
+	memcpy(&hs, &(ctx->inner), sizeof(hs));
 	// Note that text = text1 || text2.
 	if (text1 != NULL)
 	{
-		for (i = 0; i < text1_length; i++)
-		{
-			sha256WriteByte(&hs, text1[i]);
-		}
+		sha256WriteBytes(&hs, text1, text1_length);
 	}
 	if (text2 != NULL)
 	{
-		for (i = 0; i < text2_length; i++)
-		{
-			sha256WriteByte(&hs, text2[i]);
-		}
+		sha256WriteBytes(&hs, text2, text2_length);
 	}
 	sha256Finish(&hs);
 	writeHashToByteArray(hash, &hs, true);
 	// Calculate H((K_0 XOR opad) || hash).
-	sha256Begin(&hs);
-	for (i = 0; i < sizeof(padded_key); i++)
-	{
-		sha256WriteByte(&hs, (uint8_t)(padded_key[i] ^ 0x5c));
-	}
-	for (i = 0; i < sizeof(hash); i++)
-	{
-		sha256WriteByte(&hs, hash[i]);
-	}
+	memcpy(&hs, &(ctx->outer), sizeof(hs));
+	sha256WriteBytes(&hs, hash, sizeof(hash));
 	sha256Finish(&hs);
 	writeHashToByteArray(out, &hs, true);
 }
 
+/** Calculate a 32 byte HMAC of an arbitrary message and key using SHA-256 as
+  * the hash function. See hmacSha256Compute() for a description of how the
+  * message is split into two parts.
+  * \param out A byte array where the HMAC-SHA256 hash value will be written.
+  *            This must have space for #SHA256_HASH_LENGTH bytes.
+  * \param key A byte array containing the key to use in the HMAC-SHA256
+  *            calculation. The key can be of any length.
+  * \param key_length The length, in bytes, of the key.
+  * \param text1 A byte array containing the first part of the message.
+  * \param text1_length The length, in bytes, of the first part of the
+  *                     message.
+  * \param text2 A byte array containing the second part of the message. This
+  *              parameter is optional; it can be NULL.
+  * \param text2_length The length, in bytes, of the second part of the
+  *                     message.
+  */
+static void hmacSha256(uint8_t *out, const uint8_t *key, const unsigned int key_length, const uint8_t *text1, const unsigned int text1_length, const uint8_t *text2, const unsigned int text2_length)
+{
+	HmacSha256Context ctx;
+
+	hmacSha256Begin(&ctx, key, key_length);
+	hmacSha256Compute(out, &ctx, text1, text1_length, text2, text2_length);
+	memset(&ctx, 0, sizeof(ctx));
+}
+
 /** HMAC_DRBG update function. This is a function common to all HMAC_DRBG
   * operations. This function updates the internal state of the DRBG, mixing
   * in some (optional) provided data.
@@ -234,20 +276,24 @@ void drbgGenerate(uint8_t *out, HMACDRBGState *state, const unsigned int request
 {
 	unsigned int bytes;
 	unsigned int copy_size;
+	HmacSha256Context ctx;
 
 	if (additional_input != NULL)
 	{
 		drbgUpdate(state, additional_input, additional_input_length);
 	}
+	// Key doesn't change within the loop, so prepare it once.
+	hmacSha256Begin(&ctx, state->key, sizeof(state->key));
 	bytes = 0;
 	while (bytes < requested_bytes)
 	{
 		// V = HMAC (Key, V).
-		hmacSha256(state->v, state->key, sizeof(state->key), state->v, sizeof(state->v), NULL, 0);
+		hmacSha256Compute(state->v, &ctx, state->v, sizeof(state->v), NULL, 0);
 		copy_size = MIN(requested_bytes - bytes, sizeof(state->v));
 		memcpy(&(out[bytes]), state->v, copy_size);
 		bytes += copy_size;
 	}
+	memset(&ctx, 0, sizeof(ctx));
 	drbgUpdate(state, additional_input, additional_input_length);
 }
 
@@ -14,6 +14,18 @@
   * hash.c cannot be re-used here, despite the essentially identical structure
   * of SHA-256 and SHA-512.
   *
+  * On 32 bit platforms, compilers implement 64 bit rotates and additions
+  * with generic helper sequences. Define SHA512_32BIT to use an alternative
+  * sha512Block() which works on explicit 32 bit high and low halves, with
+  * each rotate written out as shifts of the two halves, and a 16 word
+  * rolling message schedule (like SHA256_UNROLLED in sha256.c). It is about
+  * 3 times larger.
+  *
+  * hmacSha512ComputeMulti() calculates the HMACs of several messages with
+  * the same key. On hosts, define SHA512_MULTI_BUFFER so that it hashes
+  * #SHA512_LANES messages at once, one per lane of a vector register, using
+  * GCC's generic vector extensions (see SHA256_MULTI_BUFFER in sha256.c).
+  *
   * This file is licensed as described by the file LICENCE.
   */
 
@@ -24,9 +36,15 @@
 #include "test_helpers.h"
 #endif // #ifdef TEST_HMAC_SHA512
 
+#ifdef BENCH_HMAC_SHA512
+#include <stdlib.h>
+#include "test_helpers.h"
+#endif // #ifdef BENCH_HMAC_SHA512
+
 #include "common.h"
 #include "endian.h"
 #include "hmac_sha512.h"
+#include "scratch.h"
 
 #if defined(AVR) && defined(__GNUC__)
 #define LOOKUP_QWORD(x)		(my_pgm_read_qword_near(&(x)))
@@ -51,21 +69,21 @@ static uint64_t my_pgm_read_qword_near(const void *address)
 #define LOOKUP_QWORD(x)		(x)
 #endif // #if defined(AVR) && defined(__GNUC__)
 
-/** Container for 64 bit hash state. */
-typedef struct HashState64Struct
-{
-	/** Where final hash value will be placed. */
-	uint64_t h[8];
-	/** Current index into HashState64#m, ranges from 0 to 15. */
-	uint8_t index_m;
-	/** Current byte within (64 bit) double word of HashState64#m. 0 = most
-	  * significant byte, 7 = least significant byte. */
-	uint8_t byte_position_m;
-	/** 1024 bit message buffer. */
-	uint64_t m[16];
-	/** Total length of message; updated as bytes are written. */
-	uint32_t message_length;
-} HashState64;
+/** Length, in bytes, of the padded key K_0 in FIPS PUB 198. This is the
+  * SHA-512 block size. */
+#define PADDED_KEY_LENGTH		128
+
+#if defined(SHA512_MULTI_BUFFER) && !defined(__GNUC__)
+#error "SHA512_MULTI_BUFFER needs GCC's vector extensions"
+#endif // #if defined(SHA512_MULTI_BUFFER) && !defined(__GNUC__)
+
+#ifndef SHA512_LANES
+/** Number of message blocks which sha512BlockMulti() hashes at once, if
+  * SHA512_MULTI_BUFFER is defined. 2 fills a 128 bit vector register
+  * (SSE2, NEON); 4 fills a 256 bit one (AVX2). This can be overridden by
+  * defining SHA512_LANES in the platform's build settings. */
+#define SHA512_LANES			2
+#endif // #ifndef SHA512_LANES
 
 /** Constants for SHA-512. See section 4.2.3 of FIPS PUB 180-4. */
 static const uint64_t k[80] PROGMEM = {
@@ -90,6 +108,168 @@ static const uint64_t k[80] PROGMEM = {
 0x28db77f523047d84, 0x32caab7b40c72493, 0x3c9ebe0a15c9bebc, 0x431d67c49c100d4c,
 0x4cc5d4becb3e42b6, 0x597f299cfc657e2a, 0x5fcb6fab3ad6faec, 0x6c44198c4a475817};
 
+#ifdef SHA512_32BIT
+
+// In these macros, each 64 bit quantity is a pair of 32 bit variables: a
+// high half and a low half. Rotating right by n < 32 moves the low n bits
+// of each half into the top of the other half; rotating right by n > 32 is
+// the same as swapping the halves, then rotating right by n - 32.
+
+/** r = x rotated right by n, where 0 < n < 32. */
+#define ROTR_HI(xh, xl, n)	(((xh) >> (n)) | ((xl) << (32 - (n))))
+/** Low half of ROTR_HI(). */
+#define ROTR_LO(xh, xl, n)	(((xl) >> (n)) | ((xh) << (32 - (n))))
+
+/** (rh, rl) = Function defined as (4.10) in section 4.1.3 of FIPS PUB
+  * 180-4, applied to (xh, xl). The rotates are by 28, 34 and 39. */
+#define BIG_SIGMA0(rh, rl, xh, xl) \
+	rh = ROTR_HI(xh, xl, 28) ^ ROTR_LO(xh, xl, 2) ^ ROTR_LO(xh, xl, 7); \
+	rl = ROTR_LO(xh, xl, 28) ^ ROTR_HI(xh, xl, 2) ^ ROTR_HI(xh, xl, 7)
+
+/** (rh, rl) = Function defined as (4.11) in section 4.1.3 of FIPS PUB
+  * 180-4, applied to (xh, xl). The rotates are by 14, 18 and 41. */
+#define BIG_SIGMA1(rh, rl, xh, xl) \
+	rh = ROTR_HI(xh, xl, 14) ^ ROTR_HI(xh, xl, 18) ^ ROTR_LO(xh, xl, 9); \
+	rl = ROTR_LO(xh, xl, 14) ^ ROTR_LO(xh, xl, 18) ^ ROTR_HI(xh, xl, 9)
+
+/** (rh, rl) = Function defined as (4.12) in section 4.1.3 of FIPS PUB
+  * 180-4, applied to (xh, xl). The rotates are by 1 and 8, and the shift
+  * is by 7. */
+#define LITTLE_SIGMA0(rh, rl, xh, xl) \
+	rh = ROTR_HI(xh, xl, 1) ^ ROTR_HI(xh, xl, 8) ^ ((xh) >> 7); \
+	rl = ROTR_LO(xh, xl, 1) ^ ROTR_LO(xh, xl, 8) ^ ROTR_LO(xh, xl, 7)
+
+/** (rh, rl) = Function defined as (4.13) in section 4.1.3 of FIPS PUB
+  * 180-4, applied to (xh, xl). The rotates are by 19 and 61, and the shift
+  * is by 6. */
+#define LITTLE_SIGMA1(rh, rl, xh, xl) \
+	rh = ROTR_HI(xh, xl, 19) ^ ROTR_LO(xh, xl, 29) ^ ((xh) >> 6); \
+	rl = ROTR_LO(xh, xl, 19) ^ ROTR_HI(xh, xl, 29) ^ ROTR_LO(xh, xl, 6)
+
+/** Function defined as (4.8) in section 4.1.3 of FIPS PUB 180-4. This is
+  * bitwise, so it is applied to each half separately. */
+#define CH(x, y, z)			((z) ^ ((x) & ((y) ^ (z))))
+/** Function defined as (4.9) in section 4.1.3 of FIPS PUB 180-4. This is
+  * bitwise, so it is applied to each half separately. */
+#define MAJ(x, y, z)		(((x) & (y)) | ((z) & ((x) | (y))))
+
+/** (rh, rl) += (xh, xl), modulo 2 ^ 64. */
+#define ADD64(rh, rl, xh, xl) \
+	rl += (xl); \
+	rh += (xh) + (uint32_t)(rl < (xl))
+
+/** Calculate the next message schedule word, in place, in the 16 word
+  * rolling message schedule (w_hi, w_lo). */
+#define SCHEDULE(i) \
+	LITTLE_SIGMA1(s_hi, s_lo, w_hi[((i) + 14) & 15], w_lo[((i) + 14) & 15]); \
+	ADD64(w_hi[i], w_lo[i], s_hi, s_lo); \
+	ADD64(w_hi[i], w_lo[i], w_hi[((i) + 9) & 15], w_lo[((i) + 9) & 15]); \
+	LITTLE_SIGMA0(s_hi, s_lo, w_hi[((i) + 1) & 15], w_lo[((i) + 1) & 15]); \
+	ADD64(w_hi[i], w_lo[i], s_hi, s_lo)
+
+/** One round of SHA-512. Instead of shuffling the working variables at the
+  * end of every round, the caller rotates the argument list. Each argument
+  * names a pair of variables, with the suffixes _hi and _lo. */
+#define ROUND(a, b, c, d, e, f, g, h, i) \
+	k_t = LOOKUP_QWORD(k[t + (i)]); \
+	t1_hi = h ## _hi; \
+	t1_lo = h ## _lo; \
+	ADD64(t1_hi, t1_lo, (uint32_t)(k_t >> 32), (uint32_t)k_t); \
+	ADD64(t1_hi, t1_lo, w_hi[i], w_lo[i]); \
+	ADD64(t1_hi, t1_lo, CH(e ## _hi, f ## _hi, g ## _hi), CH(e ## _lo, f ## _lo, g ## _lo)); \
+	BIG_SIGMA1(s_hi, s_lo, e ## _hi, e ## _lo); \
+	ADD64(t1_hi, t1_lo, s_hi, s_lo); \
+	ADD64(d ## _hi, d ## _lo, t1_hi, t1_lo); \
+	BIG_SIGMA0(s_hi, s_lo, a ## _hi, a ## _lo); \
+	ADD64(t1_hi, t1_lo, s_hi, s_lo); \
+	h ## _hi = t1_hi; \
+	h ## _lo = t1_lo; \
+	ADD64(h ## _hi, h ## _lo, MAJ(a ## _hi, b ## _hi, c ## _hi), MAJ(a ## _lo, b ## _lo, c ## _lo))
+
+/** Sixteen rounds of SHA-512, which use every word of the rolling
+  * message schedule once. */
+#define SIXTEEN_ROUNDS() \
+	ROUND(a, b, c, d, e, f, g, h, 0); \
+	ROUND(h, a, b, c, d, e, f, g, 1); \
+	ROUND(g, h, a, b, c, d, e, f, 2); \
+	ROUND(f, g, h, a, b, c, d, e, 3); \
+	ROUND(e, f, g, h, a, b, c, d, 4); \
+	ROUND(d, e, f, g, h, a, b, c, 5); \
+	ROUND(c, d, e, f, g, h, a, b, 6); \
+	ROUND(b, c, d, e, f, g, h, a, 7); \
+	ROUND(a, b, c, d, e, f, g, h, 8); \
+	ROUND(h, a, b, c, d, e, f, g, 9); \
+	ROUND(g, h, a, b, c, d, e, f, 10); \
+	ROUND(f, g, h, a, b, c, d, e, 11); \
+	ROUND(e, f, g, h, a, b, c, d, 12); \
+	ROUND(d, e, f, g, h, a, b, c, 13); \
+	ROUND(c, d, e, f, g, h, a, b, 14); \
+	ROUND(b, c, d, e, f, g, h, a, 15)
+
+/** Load one 64 bit hash value word into a pair of working variables. */
+#define LOAD_STATE(x, i) \
+	x ## _hi = (uint32_t)(hs64->h[i] >> 32); \
+	x ## _lo = (uint32_t)hs64->h[i]
+
+/** Add a pair of working variables into one 64 bit hash value word. */
+#define STORE_STATE(x, i) \
+	hs64->h[i] += ((uint64_t)x ## _hi << 32) | (uint64_t)x ## _lo
+
+/** Update hash value based on the contents of a full message buffer.
+  * This implements the pseudo-code in section 6.4.2 of FIPS PUB 180-4, but
+  * every 64 bit word is held as two 32 bit halves, the rounds are unrolled
+  * (16 at a time) and only the most recent 16 words of the message schedule
+  * are kept. Since everything here is a macro, this doesn't call any other
+  * functions, so it can be a #RAM_FUNCTION.
+  * \param hs64 The 64 bit hash state to update.
+  */
+static RAM_FUNCTION HOT_FUNCTION void sha512Block(HashState64 *hs64)
+{
+	uint32_t a_hi, a_lo, b_hi, b_lo, c_hi, c_lo, d_hi, d_lo;
+	uint32_t e_hi, e_lo, f_hi, f_lo, g_hi, g_lo, h_hi, h_lo;
+	uint32_t t1_hi, t1_lo;
+	uint32_t s_hi, s_lo;
+	uint64_t k_t;
+	uint8_t t;
+	uint8_t i;
+	uint32_t w_hi[16];
+	uint32_t w_lo[16];
+
+	for (i = 0; i < 16; i++)
+	{
+		w_hi[i] = (uint32_t)(hs64->m[i] >> 32);
+		w_lo[i] = (uint32_t)hs64->m[i];
+	}
+	LOAD_STATE(a, 0);
+	LOAD_STATE(b, 1);
+	LOAD_STATE(c, 2);
+	LOAD_STATE(d, 3);
+	LOAD_STATE(e, 4);
+	LOAD_STATE(f, 5);
+	LOAD_STATE(g, 6);
+	LOAD_STATE(h, 7);
+	t = 0;
+	SIXTEEN_ROUNDS();
+	for (t = 16; t < 80; t = (uint8_t)(t + 16))
+	{
+		for (i = 0; i < 16; i++)
+		{
+			SCHEDULE(i);
+		}
+		SIXTEEN_ROUNDS();
+	}
+	STORE_STATE(a, 0);
+	STORE_STATE(b, 1);
+	STORE_STATE(c, 2);
+	STORE_STATE(d, 3);
+	STORE_STATE(e, 4);
+	STORE_STATE(f, 5);
+	STORE_STATE(g, 6);
+	STORE_STATE(h, 7);
+}
+
+#else
+
 /** 64 bit rotate right.
   * \param x The integer to rotate right.
   * \param n Number of times to rotate right.
@@ -162,7 +342,7 @@ static uint64_t littleSigma1(const uint64_t x)
   * This implements the pseudo-code in section 6.4.2 of FIPS PUB 180-4.
   * \param hs64 The 64 bit hash state to update.
   */
-static void sha512Block(HashState64 *hs64)
+static HOT_FUNCTION void sha512Block(HashState64 *hs64)
 {
 	uint64_t a, b, c, d, e, f, g, h;
 	uint64_t t1, t2;
@@ -208,6 +388,8 @@ static void sha512Block(HashState64 *hs64)
 	hs64->h[7] += h;
 }
 
+#endif // #ifdef SHA512_32BIT
+
 /** Clear the message buffer.
   * \param hs64 The 64 bit hash state to act on.
   */
@@ -263,6 +445,63 @@ static void sha512WriteByte(HashState64 *hs64, const uint8_t byte)
 	}
 }
 
+/** Add an array of bytes to the message buffer, calling sha512Block()
+  * whenever the message buffer is full. This gives the same result as
+  * calling sha512WriteByte() for each byte, but it is much faster for long
+  * arrays, since whole (64 bit) double words are written into
+  * HashState64#m at once whenever the message buffer is aligned.
+  * \param hs64 The 64 bit hash state to act on.
+  * \param bytes The bytes to add.
+  * \param length The number of bytes to add.
+  */
+static void sha512WriteBytes(HashState64 *hs64, const uint8_t *bytes, unsigned int length)
+{
+	// Write bytes one at a time until the message buffer is aligned.
+	while ((length > 0) && (hs64->byte_position_m != 0))
+	{
+		sha512WriteByte(hs64, *bytes);
+		bytes++;
+		length--;
+	}
+	// Write whole double words.
+	while (length >= 8)
+	{
+		hs64->m[hs64->index_m] = ((uint64_t)readU32BigEndian(bytes) << 32)
+			| (uint64_t)readU32BigEndian(&(bytes[4]));
+		hs64->index_m++;
+		hs64->message_length += 8;
+		if (hs64->index_m == 16)
+		{
+			sha512Block(hs64);
+			clearM(hs64);
+		}
+		bytes += 8;
+		length -= 8;
+	}
+	// Write any remaining bytes.
+	while (length > 0)
+	{
+		sha512WriteByte(hs64, *bytes);
+		bytes++;
+		length--;
+	}
+}
+
+/** Write the hash value of a 64 bit hash state into a byte array.
+  * \param out A byte array with space for #SHA512_HASH_LENGTH bytes.
+  * \param hs64 The 64 bit hash state to read.
+  */
+static void writeHash64(uint8_t *out, const HashState64 *hs64)
+{
+	uint8_t i;
+
+	for (i = 0; i < 8; i++)
+	{
+		writeU32BigEndian(&(out[i * 8]), (uint32_t)(hs64->h[i] >> 32));
+		writeU32BigEndian(&(out[i * 8 + 4]), (uint32_t)hs64->h[i]);
+	}
+}
+
 /** Finalise the hashing of a message by writing appropriate padding and
   * length bytes, then write the hash value into a byte array.
   * \param out A byte array where the final SHA-512 hash value will be written
@@ -294,70 +533,341 @@ static void sha512Finish(uint8_t *out, HashState64 *hs64)
 	{
 		sha512WriteByte(hs64, buffer[i]);
 	}
-	for (i = 0; i < 8; i++)
+	writeHash64(out, hs64);
+}
+
+#ifdef SHA512_MULTI_BUFFER
+
+/** A vector with one 64 bit double word for each lane. */
+typedef uint64_t Sha512Vector __attribute__((vector_size(SHA512_LANES * 8)));
+
+// These are the same as the functions used by the 64 bit sha512Block(),
+// except that they are macros, so that they work on #Sha512Vector.
+/** Rotate right each lane of a vector. */
+#define VROTR(x, n)			(((x) >> (n)) | ((x) << (64 - (n))))
+/** SHA-512 Ch function. */
+#define VCH(x, y, z)		((z) ^ ((x) & ((y) ^ (z))))
+/** SHA-512 Maj function. */
+#define VMAJ(x, y, z)		(((x) & (y)) | ((z) & ((x) | (y))))
+/** SHA-512 Sigma0 function (the one with a capital Sigma). */
+#define VBIG_SIGMA0(x)		(VROTR(x, 28) ^ VROTR(x, 34) ^ VROTR(x, 39))
+/** SHA-512 Sigma1 function (the one with a capital Sigma). */
+#define VBIG_SIGMA1(x)		(VROTR(x, 14) ^ VROTR(x, 18) ^ VROTR(x, 41))
+/** SHA-512 sigma0 function (the one with a small sigma). */
+#define VLITTLE_SIGMA0(x)	(VROTR(x, 1) ^ VROTR(x, 8) ^ ((x) >> 7))
+/** SHA-512 sigma1 function (the one with a small sigma). */
+#define VLITTLE_SIGMA1(x)	(VROTR(x, 19) ^ VROTR(x, 61) ^ ((x) >> 6))
+
+/** Update up to #SHA512_LANES hash states at once, one per vector lane.
+  * This uses a 16 word rolling message schedule.
+  * \param states The hash states to update. Each one must have a full
+  *               message buffer.
+  * \param count The number of hash states in states. This must be between 1
+  *              and #SHA512_LANES inclusive. Unused lanes duplicate the
+  *              first hash state, and their results are thrown away.
+  */
+static void sha512BlockLanes(HashState64 **states, uint8_t count)
+{
+	Sha512Vector v[8];
+	Sha512Vector w[16];
+	Sha512Vector t1, t2;
+	HashState64 *hs64;
+	uint8_t t;
+	uint8_t i;
+	uint8_t lane;
+
+	for (lane = 0; lane < SHA512_LANES; lane++)
 	{
-		writeU32BigEndian(&(out[i * 8]), (uint32_t)(hs64->h[i] >> 32));
-		writeU32BigEndian(&(out[i * 8 + 4]), (uint32_t)hs64->h[i]);
+		hs64 = states[(lane < count) ? lane : 0];
+		for (i = 0; i < 16; i++)
+		{
+			w[i][lane] = hs64->m[i];
+		}
+		for (i = 0; i < 8; i++)
+		{
+			v[i][lane] = hs64->h[i];
+		}
+	}
+	// v[0] to v[7] are a to h.
+	for (t = 0; t < 80; t++)
+	{
+		if (t >= 16)
+		{
+			w[t & 15] += VLITTLE_SIGMA1(w[(t - 2) & 15]) + w[(t - 7) & 15] + VLITTLE_SIGMA0(w[(t - 15) & 15]);
+		}
+		t1 = v[7] + VBIG_SIGMA1(v[4]) + VCH(v[4], v[5], v[6]) + LOOKUP_QWORD(k[t]) + w[t & 15];
+		t2 = VBIG_SIGMA0(v[0]) + VMAJ(v[0], v[1], v[2]);
+		v[7] = v[6];
+		v[6] = v[5];
+		v[5] = v[4];
+		v[4] = v[3] + t1;
+		v[3] = v[2];
+		v[2] = v[1];
+		v[1] = v[0];
+		v[0] = t1 + t2;
+	}
+	for (lane = 0; lane < count; lane++)
+	{
+		hs64 = states[lane];
+		for (i = 0; i < 8; i++)
+		{
+			hs64->h[i] += v[i][lane];
+		}
 	}
 }
 
-/** Calculate a 64 byte HMAC of an arbitrary message and key using SHA-512 as
-  * the hash function.
+#endif // #ifdef SHA512_MULTI_BUFFER
+
+/** Update several independent hash states, each of which has a full message
+  * buffer, as if sha512Block() was called on each one. If
+  * SHA512_MULTI_BUFFER is defined, #SHA512_LANES blocks are hashed at once.
+  * \param states The hash states to update.
+  * \param count The number of hash states in states.
+  */
+static void sha512BlockMulti(HashState64 **states, uint8_t count)
+{
+#ifdef SHA512_MULTI_BUFFER
+	uint8_t n;
+
+	while (count > 0)
+	{
+		n = (uint8_t)MIN(count, SHA512_LANES);
+		sha512BlockLanes(states, n);
+		states += n;
+		count = (uint8_t)(count - n);
+	}
+#else
+	uint8_t i;
+
+	for (i = 0; i < count; i++)
+	{
+		sha512Block(states[i]);
+	}
+#endif // #ifdef SHA512_MULTI_BUFFER
+}
+
+/** Fill the message buffer with one block of a padded message, as
+  * sha512WriteBytes() followed by sha512Finish() would have done. This lets
+  * the blocks of several messages be filled in before any of them are
+  * hashed.
+  * \param hs64 The 64 bit hash state whose message buffer will be filled
+  *             in. Everything which was written to it before text must have
+  *             been a whole number of blocks (for example, a HMAC padded
+  *             key).
+  * \param text The message. This must be a byte array of the size specified
+  *             by text_length.
+  * \param text_length The length of the message, in bytes.
+  * \param block Which block of the padded message to fill in, starting from
+  *              0.
+  */
+static void fillPaddedBlock(HashState64 *hs64, const uint8_t *text, const unsigned int text_length, const unsigned int block)
+{
+	unsigned int padded_length;
+	unsigned int pos;
+	uint32_t length_bits;
+	uint8_t byte;
+	uint8_t i;
+
+	// The padded message is the message, 0x80, then zeroes, then a 128 bit
+	// length (in bits), rounded up to a whole number of blocks.
+	padded_length = ((text_length + 17 + PADDED_KEY_LENGTH - 1) / PADDED_KEY_LENGTH) * PADDED_KEY_LENGTH;
+	length_bits = (hs64->message_length + text_length) << 3;
+	pos = block * PADDED_KEY_LENGTH;
+	for (i = 0; i < 16; i++)
+	{
+		if ((pos + 8) <= text_length)
+		{
+			// Fast path for whole double words of the message.
+			hs64->m[i] = ((uint64_t)readU32BigEndian(&(text[pos])) << 32)
+				| (uint64_t)readU32BigEndian(&(text[pos + 4]));
+			pos += 8;
+			continue;
+		}
+		hs64->m[i] = 0;
+		do
+		{
+			if (pos < text_length)
+			{
+				byte = text[pos];
+			}
+			else if (pos == text_length)
+			{
+				byte = 0x80;
+			}
+			else if (pos >= (padded_length - 4))
+			{
+				byte = (uint8_t)(length_bits >> ((padded_length - 1 - pos) << 3));
+			}
+			else
+			{
+				byte = 0;
+			}
+			hs64->m[i] = (hs64->m[i] << 8) | byte;
+			pos++;
+		} while ((pos & 7) != 0);
+	}
+}
+
+/** Prepare a HMAC-SHA512 context for a given key. This hashes the padded
+  * key blocks, so that the context can then be used (with
+  * hmacSha512Compute()) to calculate the HMAC of any number of messages
+  * without having to hash the key again.
   * The code in here is based on the description in section 5
   * ("HMAC SPECIFICATION") of FIPS PUB 198.
-  * \param out A byte array where the HMAC-SHA512 hash value will be written.
-  *            This must have space for #SHA512_HASH_LENGTH bytes.
+  * \param ctx The HMAC-SHA512 context to initialise.
   * \param key A byte array containing the key to use in the HMAC-SHA512
   *            calculation. The key can be of any length.
   * \param key_length The length, in bytes, of the key.
-  * \param text A byte array containing the message to use in the HMAC-SHA512
-  *             calculation. The message can be of any length.
-  * \param text_length The length, in bytes, of the message.
+  * \warning The context is key-equivalent, so it should be cleared after
+  *          use if the key is secret.
   */
-void hmacSha512(uint8_t *out, const uint8_t *key, const unsigned int key_length, const uint8_t *text, const unsigned int text_length)
+void hmacSha512Begin(HmacSha512Context *ctx, const uint8_t *key, const unsigned int key_length)
 {
 	unsigned int i;
-	uint8_t hash[SHA512_HASH_LENGTH];
-	uint8_t padded_key[128];
-	HashState64 hs64;
+	ScratchMark mark;
+	uint8_t *padded_key;
 
+	mark = scratchMark();
+	padded_key = scratchAllocate(PADDED_KEY_LENGTH);
 	// Determine key.
-	memset(padded_key, 0, sizeof(padded_key));
-	if (key_length <= sizeof(padded_key))
+	memset(padded_key, 0, PADDED_KEY_LENGTH);
+	if (key_length <= PADDED_KEY_LENGTH)
 	{
 		memcpy(padded_key, key, key_length);
 	}
 	else
 	{
-		sha512Begin(&hs64);
-		for (i = 0; i < key_length; i++)
-		{
-			sha512WriteByte(&hs64, key[i]);
-		}
-		sha512Finish(padded_key, &hs64);
+		sha512Begin(&(ctx->inner));
+		sha512WriteBytes(&(ctx->inner), key, key_length);
+		sha512Finish(padded_key, &(ctx->inner));
 	}
-	// Calculate hash = H((K_0 XOR ipad) || text).
-	sha512Begin(&hs64);
-	for (i = 0; i < sizeof(padded_key); i++)
+	// Hash K_0 XOR ipad, which begins H((K_0 XOR ipad) || text).
+	sha512Begin(&(ctx->inner));
+	for (i = 0; i < PADDED_KEY_LENGTH; i++)
 	{
-		sha512WriteByte(&hs64, (uint8_t)(padded_key[i] ^ 0x36));
+		sha512WriteByte(&(ctx->inner), (uint8_t)(padded_key[i] ^ 0x36));
 	}
-	for (i = 0; i < text_length; i++)
+	// Hash K_0 XOR opad, which begins H((K_0 XOR opad) || hash).
+	sha512Begin(&(ctx->outer));
+	for (i = 0; i < PADDED_KEY_LENGTH; i++)
 	{
-		sha512WriteByte(&hs64, text[i]);
+		sha512WriteByte(&(ctx->outer), (uint8_t)(padded_key[i] ^ 0x5c));
 	}
+	scratchRelease(mark); // clears padded_key
+}
+
+/** Calculate a 64 byte HMAC of an arbitrary message using a HMAC-SHA512
+  * context which was previously prepared by hmacSha512Begin(). The context
+  * is not modified, so it can be re-used for other messages.
+  * \param out A byte array where the HMAC-SHA512 hash value will be written.
+  *            This must have space for #SHA512_HASH_LENGTH bytes.
+  * \param ctx The prepared HMAC-SHA512 context, which determines the key.
+  * \param text A byte array containing the message to use in the HMAC-SHA512
+  *             calculation. The message can be of any length.
+  * \param text_length The length, in bytes, of the message.
+  */
+void hmacSha512Compute(uint8_t *out, const HmacSha512Context *ctx, const uint8_t *text, const unsigned int text_length)
+{
+	ScratchMark mark;
+	uint8_t *hash;
+	HashState64 hs64;
+
+	mark = scratchMark();
+	hash = scratchAllocate(SHA512_HASH_LENGTH);
+	// Calculate hash = H((K_0 XOR ipad) || text).
+	memcpy(&hs64, &(ctx->inner), sizeof(hs64));
+	sha512WriteBytes(&hs64, text, text_length);
 	sha512Finish(hash, &hs64);
 	// Calculate H((K_0 XOR opad) || hash).
-	sha512Begin(&hs64);
-	for (i = 0; i < sizeof(padded_key); i++)
-	{
-		sha512WriteByte(&hs64, (uint8_t)(padded_key[i] ^ 0x5c));
-	}
-	for (i = 0; i < sizeof(hash); i++)
+	memcpy(&hs64, &(ctx->outer), sizeof(hs64));
+	sha512WriteBytes(&hs64, hash, SHA512_HASH_LENGTH);
+	sha512Finish(out, &hs64);
+	scratchRelease(mark);
+}
+
+/** Calculate a 64 byte HMAC of an arbitrary message and key using SHA-512 as
+  * the hash function. If many messages need to be authenticated using the
+  * same key, it's faster to use hmacSha512Begin() once and then
+  * hmacSha512Compute() for each message.
+  * \param out A byte array where the HMAC-SHA512 hash value will be written.
+  *            This must have space for #SHA512_HASH_LENGTH bytes.
+  * \param key A byte array containing the key to use in the HMAC-SHA512
+  *            calculation. The key can be of any length.
+  * \param key_length The length, in bytes, of the key.
+  * \param text A byte array containing the message to use in the HMAC-SHA512
+  *             calculation. The message can be of any length.
+  * \param text_length The length, in bytes, of the message.
+  */
+void hmacSha512(uint8_t *out, const uint8_t *key, const unsigned int key_length, const uint8_t *text, const unsigned int text_length)
+{
+	HmacSha512Context ctx;
+
+	hmacSha512Begin(&ctx, key, key_length);
+	hmacSha512Compute(out, &ctx, text, text_length);
+	memset(&ctx, 0, sizeof(ctx));
+}
+
+/** Calculate the 64 byte HMACs of several messages of the same length,
+  * all using the same HMAC-SHA512 context. The results are the same as
+  * calling hmacSha512Compute() for each message, but if SHA512_MULTI_BUFFER
+  * is defined, #SHA512_LANES messages are hashed at once. BIP 0032
+  * derivation of a range of child keys from the same parent (see
+  * generateDeterministicPublicKeys()) looks like this.
+  * \param out The HMAC-SHA512 hash values will be written here, one after
+  *            the other. This must have space for
+  *            count * #SHA512_HASH_LENGTH bytes.
+  * \param ctx The prepared HMAC-SHA512 context, which determines the key.
+  * \param texts The messages, one after the other. This must be a byte
+  *              array of count * text_length bytes.
+  * \param text_length The length, in bytes, of each message.
+  * \param count The number of messages.
+  */
+void hmacSha512ComputeMulti(uint8_t *out, const HmacSha512Context *ctx, const uint8_t *texts, const unsigned int text_length, unsigned int count)
+{
+	HashState64 hs[HMAC_SHA512_BATCH_SIZE];
+	HashState64 *states[HMAC_SHA512_BATCH_SIZE];
+	uint8_t hash[SHA512_HASH_LENGTH];
+	unsigned int blocks;
+	unsigned int block;
+	uint8_t n;
+	uint8_t i;
+
+	blocks = (text_length + 17 + PADDED_KEY_LENGTH - 1) / PADDED_KEY_LENGTH;
+	while (count > 0)
 	{
-		sha512WriteByte(&hs64, hash[i]);
+		n = (uint8_t)MIN(count, HMAC_SHA512_BATCH_SIZE);
+		// Calculate H((K_0 XOR ipad) || text) for each message.
+		for (i = 0; i < n; i++)
+		{
+			memcpy(&(hs[i]), &(ctx->inner), sizeof(hs[i]));
+			states[i] = &(hs[i]);
+		}
+		for (block = 0; block < blocks; block++)
+		{
+			for (i = 0; i < n; i++)
+			{
+				fillPaddedBlock(&(hs[i]), &(texts[i * text_length]), text_length, block);
+			}
+			sha512BlockMulti(states, n);
+		}
+		// Calculate H((K_0 XOR opad) || hash) for each message. The hash is
+		// short enough that this is always one block.
+		for (i = 0; i < n; i++)
+		{
+			writeHash64(hash, &(hs[i]));
+			memcpy(&(hs[i]), &(ctx->outer), sizeof(hs[i]));
+			fillPaddedBlock(&(hs[i]), hash, SHA512_HASH_LENGTH, 0);
+		}
+		sha512BlockMulti(states, n);
+		for (i = 0; i < n; i++)
+		{
+			writeHash64(&(out[i * SHA512_HASH_LENGTH]), &(hs[i]));
+		}
+		out += n * SHA512_HASH_LENGTH;
+		texts += n * text_length;
+		count -= n;
 	}
-	sha512Finish(out, &hs64);
+	memset(hash, 0, sizeof(hash));
 }
 
 #ifdef TEST_HMAC_SHA512
@@ -382,6 +892,8 @@ static void scanTestVectors(char *filename)
 	uint8_t *message;
 	uint8_t *expected_result;
 	uint8_t actual_result[SHA512_HASH_LENGTH];
+	uint8_t context_result[SHA512_HASH_LENGTH];
+	HmacSha512Context ctx;
 	char buffer[2048];
 
 	f = fopen(filename, "r");
@@ -475,6 +987,20 @@ http://csrc.nist.gov/groups/STM/cavp/index.html#07", filename);
 			printf("Test number %d failed (key len = %u, result len = %u)\n", test_number, key_length, result_length);
 			reportFailure();
 		}
+		// A prepared context should give the same result, even after it
+		// has already been used for another message.
+		hmacSha512Begin(&ctx, key, key_length);
+		hmacSha512Compute(context_result, &ctx, key, key_length);
+		hmacSha512Compute(context_result, &ctx, message, message_length);
+		if (!memcmp(context_result, expected_result, compare_length))
+		{
+			reportSuccess();
+		}
+		else
+		{
+			printf("Test number %d failed with re-used context\n", test_number);
+			reportFailure();
+		}
 		free(key);
 		free(message);
 		free(expected_result);
@@ -483,12 +1009,133 @@ http://csrc.nist.gov/groups/STM/cavp/index.html#07", filename);
 	fclose(f);
 }
 
+/** Maximum number of messages to give hmacSha512ComputeMulti() in
+  * testComputeMulti(). This is more than #HMAC_SHA512_BATCH_SIZE so that a
+  * partly filled final batch is covered. */
+#define TEST_MULTI_COUNT			19
+
+/** Check that hmacSha512ComputeMulti() gives the same results as
+  * hmacSha512Compute() on each message, for message lengths around each
+  * place where the padding spills into another block.
+  */
+static void testComputeMulti(void)
+{
+	uint8_t key[32];
+	uint8_t texts[TEST_MULTI_COUNT * 260];
+	uint8_t out[TEST_MULTI_COUNT * SHA512_HASH_LENGTH];
+	uint8_t compare_out[SHA512_HASH_LENGTH];
+	HmacSha512Context ctx;
+	unsigned int length;
+	unsigned int count;
+	unsigned int i;
+
+	fillWithRandom(key, sizeof(key));
+	hmacSha512Begin(&ctx, key, sizeof(key));
+	for (length = 0; length <= 260; length++)
+	{
+		count = (length % TEST_MULTI_COUNT) + 1;
+		fillWithRandom(texts, count * length);
+		hmacSha512ComputeMulti(out, &ctx, texts, length, count);
+		for (i = 0; i < count; i++)
+		{
+			hmacSha512Compute(compare_out, &ctx, &(texts[i * length]), length);
+			if (memcmp(compare_out, &(out[i * SHA512_HASH_LENGTH]), SHA512_HASH_LENGTH))
+			{
+				break;
+			}
+		}
+		if (i == count)
+		{
+			reportSuccess();
+		}
+		else
+		{
+			printf("hmacSha512ComputeMulti() mismatch, length = %u, count = %u, message %u\n", length, count, i);
+			reportFailure();
+		}
+	}
+}
+
 int main(void)
 {
 	initTests(__FILE__);
 	scanTestVectors("HMAC.rsp");
+	testComputeMulti();
 	finishTests();
 	exit(0);
 }
 
 #endif // #ifdef TEST_HMAC_SHA512
+
+#ifdef BENCH_HMAC_SHA512
+
+/** Key for the HMAC-SHA512 benchmarks. */
+static uint8_t bench_key[32];
+/** Message for the HMAC-SHA512 benchmarks. */
+static uint8_t bench_text[128];
+/** Precomputed context for benchHmacSha512Compute(). */
+static HmacSha512Context bench_context;
+
+/** Number of messages hashed by benchHmacSha512ComputeMulti(). */
+#define BENCH_MULTI_COUNT			32
+
+/** Length of each message hashed by benchHmacSha512ComputeMulti(). This is
+  * the length of a BIP 0032 public child key derivation message. */
+#define BENCH_MULTI_LENGTH			69
+
+/** Messages for benchHmacSha512ComputeMulti(). */
+static uint8_t bench_multi_texts[BENCH_MULTI_COUNT * BENCH_MULTI_LENGTH];
+/** Output for benchHmacSha512ComputeMulti(). */
+static uint8_t bench_multi_out[BENCH_MULTI_COUNT * SHA512_HASH_LENGTH];
+
+/** Compute HMAC-SHA512 from scratch. */
+static void benchHmacSha512(void)
+{
+	uint8_t out[64];
+
+	hmacSha512(out, bench_key, sizeof(bench_key), bench_text, sizeof(bench_text));
+}
+
+/** Compute HMAC-SHA512 using a precomputed key context, like pbkdf2()
+  * does. */
+static void benchHmacSha512Compute(void)
+{
+	uint8_t out[64];
+
+	hmacSha512Compute(out, &bench_context, bench_text, sizeof(bench_text));
+}
+
+/** Compute HMAC-SHA512 of several messages at once using a precomputed key
+  * context, like generateDeterministicPublicKeys() does. */
+static void benchHmacSha512ComputeMulti(void)
+{
+	hmacSha512ComputeMulti(bench_multi_out, &bench_context, bench_multi_texts, BENCH_MULTI_LENGTH, BENCH_MULTI_COUNT);
+}
+
+/** Compute HMAC-SHA512 of the same messages as
+  * benchHmacSha512ComputeMulti(), one at a time, for comparison. */
+static void benchHmacSha512ComputeSingle(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < BENCH_MULTI_COUNT; i++)
+	{
+		hmacSha512Compute(&(bench_multi_out[i * SHA512_HASH_LENGTH]), &bench_context, &(bench_multi_texts[i * BENCH_MULTI_LENGTH]), BENCH_MULTI_LENGTH);
+	}
+}
+
+int main(void)
+{
+	initBenchmarks(__FILE__);
+	fillWithRandom(bench_key, sizeof(bench_key));
+	fillWithRandom(bench_text, sizeof(bench_text));
+	hmacSha512Begin(&bench_context, bench_key, sizeof(bench_key));
+	runHostBenchmark("hmac_sha512_128", &benchHmacSha512, sizeof(bench_text));
+	runHostBenchmark("hmac_sha512_compute_128", &benchHmacSha512Compute, sizeof(bench_text));
+	fillWithRandom(bench_multi_texts, sizeof(bench_multi_texts));
+	runHostBenchmark("hmac_sha512_compute_69x32", &benchHmacSha512ComputeSingle, sizeof(bench_multi_texts));
+	runHostBenchmark("hmac_sha512_compute_multi_69x32", &benchHmacSha512ComputeMulti, sizeof(bench_multi_texts));
+	exit(0);
+}
+
+#endif // #ifdef BENCH_HMAC_SHA512
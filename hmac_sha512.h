@@ -13,6 +13,45 @@
 /** Number of bytes a SHA-512 hash requires. */
 #define SHA512_HASH_LENGTH		64
 
+#ifndef HMAC_SHA512_BATCH_SIZE
+/** Maximum number of messages which hmacSha512ComputeMulti() hashes at
+  * once. Each one needs a #HashState64 on the stack. This can be overridden
+  * by defining HMAC_SHA512_BATCH_SIZE in the platform's build settings.
+  */
+#define HMAC_SHA512_BATCH_SIZE	8
+#endif // #ifndef HMAC_SHA512_BATCH_SIZE
+
+/** Container for 64 bit hash state. */
+typedef struct HashState64Struct
+{
+	/** Where final hash value will be placed. */
+	uint64_t h[8];
+	/** Current index into HashState64#m, ranges from 0 to 15. */
+	uint8_t index_m;
+	/** Current byte within (64 bit) double word of HashState64#m. 0 = most
+	  * significant byte, 7 = least significant byte. */
+	uint8_t byte_position_m;
+	/** 1024 bit message buffer. */
+	uint64_t m[16];
+	/** Total length of message; updated as bytes are written. */
+	uint32_t message_length;
+} HashState64;
+
+/** A HMAC-SHA512 key which has been prepared using hmacSha512Begin(). This
+  * holds the SHA-512 states after hashing the inner and outer padded key
+  * blocks, so that the key doesn't need to be hashed again for every
+  * message. */
+typedef struct HmacSha512ContextStruct
+{
+	/** SHA-512 state after hashing (K_0 XOR ipad). */
+	HashState64 inner;
+	/** SHA-512 state after hashing (K_0 XOR opad). */
+	HashState64 outer;
+} HmacSha512Context;
+
+extern void hmacSha512Begin(HmacSha512Context *ctx, const uint8_t *key, const unsigned int key_length);
+extern void hmacSha512Compute(uint8_t *out, const HmacSha512Context *ctx, const uint8_t *text, const unsigned int text_length);
+extern void hmacSha512ComputeMulti(uint8_t *out, const HmacSha512Context *ctx, const uint8_t *texts, const unsigned int text_length, unsigned int count);
 extern void hmacSha512(uint8_t *out, const uint8_t *key, const unsigned int key_length, const uint8_t *text, const unsigned int text_length);
 
 #endif // #ifndef HMAC_SHA512_H_INCLUDED
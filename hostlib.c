@@ -0,0 +1,801 @@
+/** \file hostlib.c
+  *
+  * \brief Host-side library interface to the portable core.
+  *
+  * The platform-independent modules (bignum256.c, ecdsa.c, prandom.c,
+  * transaction.c etc.) can be built into a library for a host computer
+  * ("make lib"), so that host software can calculate exactly what the
+  * device would: the addresses of a wallet, given only its master public
+  * key, and the outputs, fee and hashes of a transaction, before it is sent
+  * to the device to be signed. This file provides the library's interface
+  * (see hostlib.h), along with the few functions from hwinterface.h that
+  * those modules need. The transaction parser reads from an in-memory
+  * buffer instead of a stream, and non-volatile storage and the hardware
+  * random number generator are unavailable.
+  *
+  * The state which the portable core keeps between calls is declared
+  * #THREAD_LOCAL, so each thread which uses the library gets its own copy,
+  * and several threads can derive addresses and parse transactions at once.
+  * hostDeriveAddressesParallel() relies on this to split a large range of
+  * addresses between worker threads.
+  * The transaction parser's cache of input transaction outputs (see
+  * #TRANSACTION_PREVOUT_CACHE_ENTRIES) is shared between calls to
+  * hostParseTransaction() made by the same thread, just as it is shared
+  * between signing requests on the device.
+  *
+  * This file is licensed as described by the file LICENCE.
+  */
+
+#ifdef TEST_HOSTLIB
+#include <stdio.h>
+#include "test_helpers.h"
+#endif // #ifdef TEST_HOSTLIB
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "common.h"
+#include "bignum256.h"
+#include "ecdsa.h"
+#include "hash160.h"
+#include "prandom.h"
+#include "baseconv.h"
+#include "transaction.h"
+#include "wallet.h"
+#include "hwinterface.h"
+#include "hostlib.h"
+
+#ifndef DEFER_OUTPUT_FORMATTING
+#error "The host library must be built with DEFER_OUTPUT_FORMATTING defined"
+#endif // #ifndef DEFER_OUTPUT_FORMATTING
+
+/** The transaction which hostParseTransaction() is parsing. */
+static THREAD_LOCAL const uint8_t *parse_buffer;
+/** Length, in number of bytes, of #parse_buffer. */
+static THREAD_LOCAL uint32_t parse_buffer_length;
+/** Index into #parse_buffer of the next byte to be read. */
+static THREAD_LOCAL uint32_t parse_buffer_index;
+/** Where newOutputSeen() and setTransactionFee() put what they are
+  * told about. This is NULL when no transaction is being parsed. */
+static THREAD_LOCAL HostTransactionSummary *current_summary;
+
+/** The part of a hostDeriveAddressesParallel() call which one worker thread
+  * does. The fields are the parameters of hostDeriveAddresses(). */
+typedef struct DeriveWorkStruct
+{
+	/** Where this part's addresses go. */
+	uint8_t *out_addresses;
+	/** Where this part's public keys go, or NULL. */
+	uint8_t *out_public_keys;
+	/** The wallet's serialised master public key. */
+	const uint8_t *master_public_key;
+	/** The length of master_public_key, in number of bytes. */
+	uint8_t master_public_key_length;
+	/** The wallet's chain code. */
+	const uint8_t *chain_code;
+	/** The address handle of the first address in this part. */
+	uint32_t start_ah;
+	/** The number of addresses in this part. */
+	uint32_t count;
+	/** What hostDeriveAddresses() returned for this part. */
+	bool failed;
+} DeriveWork;
+
+/** Get the version of the library's interface. Host software can compare
+  * this against #HOSTLIB_API_VERSION to check that it was built against the
+  * same interface as the library it is using.
+  * \return #HOSTLIB_API_VERSION.
+  */
+uint32_t hostGetAPIVersion(void)
+{
+	return HOSTLIB_API_VERSION;
+}
+
+/** Calculate the addresses and public keys of a contiguous range of address
+  * handles of a wallet, using only the wallet's master public key and chain
+  * code (as sent in a MasterPublicKey packet). The results are the same as
+  * those the device returns for GetAddressAndPublicKey or GetAddressRange.
+  * \param out_addresses The addresses will be written here, one after the
+  *                      other. This must be a byte array with space for
+  *                      count * 20 bytes.
+  * \param out_public_keys The public keys will be written here, one after the
+  *                        other, each in compressed form. This must be a byte
+  *                        array with space for
+  *                        count * #HOSTLIB_PUBLIC_KEY_LENGTH bytes. This may
+  *                        be NULL if the public keys aren't wanted.
+  * \param master_public_key The wallet's serialised master public key. This
+  *                          may be compressed or uncompressed.
+  * \param master_public_key_length The length of master_public_key, in
+  *                                 number of bytes.
+  * \param chain_code The wallet's chain code. This must be a byte array of
+  *                   32 bytes.
+  * \param start_ah The address handle of the first address to calculate.
+  * \param count The number of addresses to calculate.
+  * \return false on success, true if the master public key is invalid or if
+  *         the range includes an invalid address handle (0 or
+  *         #BAD_ADDRESS_HANDLE).
+  */
+bool hostDeriveAddresses(uint8_t *out_addresses, uint8_t *out_public_keys, const uint8_t *master_public_key, uint8_t master_public_key_length, const uint8_t *chain_code, uint32_t start_ah, uint32_t count)
+{
+	PointAffine parent_public_key;
+	PointAffine public_keys[HASH160_BATCH_SIZE];
+	uint8_t serialised[ECDSA_MAX_SERIALISE_SIZE];
+	uint8_t serialised_size;
+	uint8_t batch[HASH160_BATCH_SIZE * HOSTLIB_PUBLIC_KEY_LENGTH];
+	uint32_t i;
+	uint32_t j;
+	uint32_t n;
+
+	if ((start_ah == 0) || (count > (BAD_ADDRESS_HANDLE - start_ah)))
+	{
+		return true; // invalid address handle in range
+	}
+	if (ecdsaParsePublicKey(&parent_public_key, master_public_key, master_public_key_length))
+	{
+		return true; // invalid master public key
+	}
+	// Public keys are derived and hashed #HASH160_BATCH_SIZE at a time, so
+	// that generateDeterministicPublicKeys() can use multi-buffer
+	// HMAC-SHA512 and hash160Batch() can use multi-buffer SHA-256.
+	for (i = 0; i < count; i += n)
+	{
+		n = MIN(count - i, HASH160_BATCH_SIZE);
+		generateDeterministicPublicKeys(public_keys, &parent_public_key, chain_code, start_ah + i, n);
+		for (j = 0; j < n; j++)
+		{
+			serialised_size = ecdsaSerialise(serialised, &(public_keys[j]), true);
+			if (serialised_size != HOSTLIB_PUBLIC_KEY_LENGTH)
+			{
+				return true; // public key is the point at infinity
+			}
+			memcpy(&(batch[j * HOSTLIB_PUBLIC_KEY_LENGTH]), serialised, HOSTLIB_PUBLIC_KEY_LENGTH);
+		}
+		hash160Batch(&(out_addresses[i * 20]), batch, HOSTLIB_PUBLIC_KEY_LENGTH, n);
+		if (out_public_keys != NULL)
+		{
+			memcpy(&(out_public_keys[i * HOSTLIB_PUBLIC_KEY_LENGTH]), batch, n * HOSTLIB_PUBLIC_KEY_LENGTH);
+		}
+	}
+	return false;
+}
+
+/** Thread function for hostDeriveAddressesParallel().
+  * \param arg Points to the #DeriveWork to do.
+  * \return NULL.
+  */
+static void *deriveWorker(void *arg)
+{
+	DeriveWork *work;
+
+	work = (DeriveWork *)arg;
+	work->failed = hostDeriveAddresses(work->out_addresses, work->out_public_keys, work->master_public_key, work->master_public_key_length, work->chain_code, work->start_ah, work->count);
+	return NULL;
+}
+
+/** Like hostDeriveAddresses(), but split the range of address handles into
+  * contiguous parts, and derive each part in its own thread. This is for
+  * host software which needs many addresses at once, for example when
+  * rescanning a wallet. The results are the same as those of
+  * hostDeriveAddresses().
+  * \param out_addresses See hostDeriveAddresses().
+  * \param out_public_keys See hostDeriveAddresses().
+  * \param master_public_key See hostDeriveAddresses().
+  * \param master_public_key_length See hostDeriveAddresses().
+  * \param chain_code See hostDeriveAddresses().
+  * \param start_ah See hostDeriveAddresses().
+  * \param count See hostDeriveAddresses().
+  * \param num_threads The number of threads to use, including the calling
+  *                    thread. If this is 0, one thread is used for each
+  *                    online CPU. At most #HOSTLIB_MAX_THREADS threads are
+  *                    used, and never more than count. If a thread can't be
+  *                    created, its part is done by the calling thread
+  *                    instead.
+  * \return See hostDeriveAddresses().
+  */
+bool hostDeriveAddressesParallel(uint8_t *out_addresses, uint8_t *out_public_keys, const uint8_t *master_public_key, uint8_t master_public_key_length, const uint8_t *chain_code, uint32_t start_ah, uint32_t count, uint32_t num_threads)
+{
+	pthread_t threads[HOSTLIB_MAX_THREADS];
+	bool started[HOSTLIB_MAX_THREADS];
+	DeriveWork work[HOSTLIB_MAX_THREADS];
+	uint32_t offset;
+	uint32_t i;
+	long online_cpus;
+	bool failed;
+
+	if ((start_ah == 0) || (count > (BAD_ADDRESS_HANDLE - start_ah)))
+	{
+		return true; // invalid address handle in range
+	}
+	if (num_threads == 0)
+	{
+		online_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		num_threads = (online_cpus > 0) ? (uint32_t)online_cpus : 1;
+	}
+	num_threads = MIN(num_threads, HOSTLIB_MAX_THREADS);
+	num_threads = MIN(num_threads, count);
+	if (num_threads <= 1)
+	{
+		return hostDeriveAddresses(out_addresses, out_public_keys, master_public_key, master_public_key_length, chain_code, start_ah, count);
+	}
+
+	// The first (count % num_threads) parts get one extra address each.
+	offset = 0;
+	for (i = 0; i < num_threads; i++)
+	{
+		work[i].out_addresses = &(out_addresses[offset * 20]);
+		if (out_public_keys != NULL)
+		{
+			work[i].out_public_keys = &(out_public_keys[offset * HOSTLIB_PUBLIC_KEY_LENGTH]);
+		}
+		else
+		{
+			work[i].out_public_keys = NULL;
+		}
+		work[i].master_public_key = master_public_key;
+		work[i].master_public_key_length = master_public_key_length;
+		work[i].chain_code = chain_code;
+		work[i].start_ah = start_ah + offset;
+		work[i].count = (count / num_threads) + ((i < (count % num_threads)) ? 1 : 0);
+		work[i].failed = true;
+		offset += work[i].count;
+	}
+	// The calling thread does the first part itself.
+	for (i = 1; i < num_threads; i++)
+	{
+		started[i] = !pthread_create(&(threads[i]), NULL, &deriveWorker, &(work[i]));
+	}
+	deriveWorker(&(work[0]));
+	failed = work[0].failed;
+	for (i = 1; i < num_threads; i++)
+	{
+		if (started[i])
+		{
+			pthread_join(threads[i], NULL);
+		}
+		else
+		{
+			deriveWorker(&(work[i]));
+		}
+		failed = failed || work[i].failed;
+	}
+	return failed;
+}
+
+/** Parse a transaction and summarise everything the device would show the
+  * user about it, without needing a device.
+  * \param out_summary The summary will be written here. Its contents are
+  *                    only meaningful if this returns #TRANSACTION_NO_ERROR.
+  * \param transaction The transaction, in the form the device expects in a
+  *                    SignTransaction packet (input transactions or cached
+  *                    input references, then the main transaction).
+  * \param length The length of the transaction, in number of bytes.
+  * \return One of the values in #TransactionErrorsEnum.
+  */
+TransactionErrors hostParseTransaction(HostTransactionSummary *out_summary, const uint8_t *transaction, uint32_t length)
+{
+	TransactionErrors r;
+
+	memset(out_summary, 0, sizeof(*out_summary));
+	parse_buffer = transaction;
+	parse_buffer_length = length;
+	parse_buffer_index = 0;
+	current_summary = out_summary;
+	r = parseTransaction(out_summary->sig_hash, out_summary->transaction_hash, length);
+	current_summary = NULL;
+	parse_buffer = NULL;
+	parse_buffer_length = 0;
+	return r;
+}
+
+/** Get the next byte of the transaction being parsed by
+  * hostParseTransaction(). Reading past the end of the transaction returns
+  * zeroes, although the transaction parser never does that.
+  * \return The next byte.
+  */
+uint8_t streamGetOneByte(void)
+{
+	if ((parse_buffer == NULL) || (parse_buffer_index >= parse_buffer_length))
+	{
+		return 0;
+	}
+	return parse_buffer[parse_buffer_index++];
+}
+
+/** Get some bytes of the transaction being parsed by
+  * hostParseTransaction(). See streamGetOneByte().
+  * \param buffer The bytes will be written here. This must have space for
+  *               length bytes.
+  * \param length The number of bytes to get.
+  */
+void streamGetBytes(uint8_t *buffer, uint32_t length)
+{
+	uint32_t i;
+
+	for (i = 0; i < length; i++)
+	{
+		buffer[i] = streamGetOneByte();
+	}
+}
+
+/** Skip some bytes of the transaction being parsed by
+  * hostParseTransaction(). See streamGetOneByte().
+  * \param length The number of bytes to skip.
+  */
+void streamDiscardBytes(uint32_t length)
+{
+	if ((parse_buffer == NULL) || (parse_buffer_index >= parse_buffer_length))
+	{
+		return;
+	}
+	parse_buffer_index += MIN(length, parse_buffer_length - parse_buffer_index);
+}
+
+/** Add a transaction output to the summary being filled in by
+  * hostParseTransaction().
+  * \param output The transaction output.
+  * \return false if no error occurred, true if there was not enough space to
+  *         store the output.
+  */
+bool newOutputSeen(OutputDescriptor *output)
+{
+	if ((current_summary == NULL) || (current_summary->num_outputs >= HOSTLIB_MAX_OUTPUTS))
+	{
+		return true; // not enough space
+	}
+	memcpy(&(current_summary->outputs[current_summary->num_outputs]), output, sizeof(OutputDescriptor));
+	current_summary->num_outputs++;
+	return false;
+}
+
+/** Record the transaction fee in the summary being filled in by
+  * hostParseTransaction().
+  * \param amount The transaction fee, as a 64 bit, unsigned, little-endian
+  *               integer.
+  */
+void setTransactionFee(uint8_t *amount)
+{
+	if (current_summary != NULL)
+	{
+		current_summary->has_fee = true;
+		memcpy(current_summary->fee, amount, sizeof(current_summary->fee));
+	}
+}
+
+/** Clear the outputs in the summary being filled in by
+  * hostParseTransaction(). */
+void clearOutputsSeen(void)
+{
+	if (current_summary != NULL)
+	{
+		current_summary->num_outputs = 0;
+	}
+}
+
+/** The library has no hardware random number generator. Nothing in the
+  * library's interface needs random numbers, so this just reports a failure.
+  * \param buffer Will be filled with zeroes.
+  * \return A negative value, to indicate failure.
+  */
+int hardwareRandom32Bytes(uint8_t *buffer)
+{
+	memset(buffer, 0, 32);
+	return -1;
+}
+
+/** The library has no non-volatile storage.
+  * \param data Ignored.
+  * \param partition Ignored.
+  * \param address Ignored.
+  * \param length Ignored.
+  * \return #NV_INVALID_ADDRESS always.
+  */
+NonVolatileReturn nonVolatileRead(uint8_t *data, NVPartitions partition, uint32_t address, uint32_t length)
+{
+	return NV_INVALID_ADDRESS;
+}
+
+/** The library has no non-volatile storage.
+  * \param data Ignored.
+  * \param partition Ignored.
+  * \param address Ignored.
+  * \param length Ignored.
+  * \return #NV_INVALID_ADDRESS always.
+  */
+NonVolatileReturn nonVolatileWrite(uint8_t *data, NVPartitions partition, uint32_t address, uint32_t length)
+{
+	return NV_INVALID_ADDRESS;
+}
+
+/** The library has no non-volatile storage, so there is nothing to flush.
+  * \return #NV_NO_ERROR always.
+  */
+NonVolatileReturn nonVolatileFlush(void)
+{
+	return NV_NO_ERROR;
+}
+
+/** Something that should never happen happened. There's no way to recover
+  * from that, so abort the host program. */
+void fatalError(void)
+{
+	abort();
+}
+
+#ifdef TEST_HOSTLIB
+
+/** A known good transaction, copied from #good_full_transaction in
+  * transaction.c: one input transaction, whose output 1 (10.33 BTC) is
+  * spent by a main transaction with two outputs (6 BTC and
+  * 0.01234567 BTC). */
+static const uint8_t test_transaction[] = {
+0x01, // is_ref = 1 (input)
+0x01, 0x00, 0x00, 0x00, // output number to examine
+0x01, 0x00, 0x00, 0x00, // version
+0x01, // number of inputs
+0xdf, 0x08, 0xf9, 0xa3, 0x7c, 0x6d, 0x71, 0x3c, // previous output
+0x6a, 0x99, 0x2e, 0x88, 0x29, 0x8e, 0x0b, 0x4c,
+0x8f, 0xb5, 0xf9, 0x0e, 0x11, 0xf0, 0x2c, 0xa7,
+0x36, 0x72, 0xeb, 0x58, 0xb3, 0x04, 0xef, 0xc0,
+0x01, 0x00, 0x00, 0x00, // number in previous output
+0x8a, // script length
+0x47, // 71 bytes of data follows
+0x30, 0x44, 0x02, 0x20, 0x1b, 0xf4, 0xef, 0x3c, 0x34, 0x96, 0x02, 0x9b, 0x1a,
+0xb1, 0xc8, 0x49, 0xbf, 0x18, 0x55, 0xcc, 0x16, 0xbc, 0x52, 0x6d, 0xcc, 0x20,
+0xfb, 0x7c, 0x0a, 0x1d, 0x48, 0xd6, 0xe9, 0xbd, 0xd7, 0xb1, 0x02, 0x20, 0x53,
+0xb1, 0xa3, 0xaa, 0xbf, 0xd3, 0x87, 0x84, 0xdc, 0xf3, 0x10, 0xe5, 0xd2, 0x09,
+0xa4, 0xba, 0xb0, 0x01, 0x62, 0xe5, 0xbc, 0x09, 0x75, 0x9d, 0x4f, 0x74, 0x2c,
+0xb4, 0x6b, 0x32, 0x37, 0x2c, 0x01,
+0x41, // 65 bytes of data follows
+0x04, 0x05, 0x4d, 0xb5, 0xe0, 0x8e, 0x2a, 0x33, 0x89, 0x2c, 0xf3, 0x4b, 0x7e,
+0xbc, 0x18, 0x3b, 0xa5, 0xf5, 0x54, 0xc6, 0x9d, 0x6d, 0x21, 0x65, 0x60, 0x89,
+0xf5, 0x5e, 0x2d, 0x0f, 0x3a, 0x68, 0x08, 0x23, 0x83, 0x19, 0xcd, 0x89, 0xba,
+0xda, 0x09, 0x9b, 0xc6, 0xef, 0x3f, 0xdc, 0x80, 0xd8, 0x7a, 0xb2, 0xbf, 0x2b,
+0x37, 0x18, 0xdd, 0x4a, 0x4e, 0x36, 0x09, 0x60, 0x28, 0x6e, 0x2e, 0x77, 0x57,
+0xFF, 0xFF, 0xFF, 0xFF, // sequence
+0x02, // number of outputs
+0xc0, 0xa4, 0x70, 0x57, 0x00, 0x00, 0x00, 0x00, // 14.67 BTC
+0x19, // script length
+0x76, 0xA9, 0x14, // OP_DUP, OP_HASH160, 20 bytes of data follows
+0xfd, 0x55, 0x49, 0x20, 0x22, 0xa0, 0x3f, 0xf7, 0x7a, 0x9d,
+0xe0, 0x0d, 0xa2, 0x18, 0x08, 0x0c, 0xa9, 0x51, 0xde, 0xef,
+0x88, 0xAC, // OP_EQUALVERIFY, OP_CHECKSIG
+0x40, 0x54, 0x92, 0x3d, 0x00, 0x00, 0x00, 0x00, // 10.33 BTC
+0x19, // script length
+0x76, 0xA9, 0x14, // OP_DUP, OP_HASH160, 20 bytes of data follows
+0x39, 0x53, 0x75, 0x46, 0x88, 0x84, 0x3d, 0xe5, 0x50, 0x0b,
+0x79, 0x91, 0x33, 0x7f, 0x96, 0xf5, 0x41, 0x71, 0x48, 0xa1,
+0x88, 0xAC, // OP_EQUALVERIFY, OP_CHECKSIG
+0x00, 0x00, 0x00, 0x00, // locktime
+0x00, // is_ref = 0 (main)
+0x01, 0x00, 0x00, 0x00, // version
+0x01, // number of inputs
+0xee, 0xce, 0xae, 0x86, 0xf5, 0x70, 0x4d, 0x76, // previous output
+0xb8, 0x54, 0x5e, 0x6d, 0xcf, 0x21, 0xf1, 0x75,
+0x35, 0x7f, 0x83, 0xbd, 0xa4, 0x96, 0x43, 0x83,
+0xd6, 0xdd, 0x7e, 0x41, 0x68, 0x1b, 0x5e, 0x1a,
+0x01, 0x00, 0x00, 0x00, // number in previous output
+0x19, // script length
+0x76, 0xA9, 0x14, // OP_DUP, OP_HASH160, 20 bytes of data follows
+0xde, 0xad, 0xbe, 0xef, 0xc0, 0xff, 0xee, 0xee, 0x00, 0x00,
+0xde, 0xad, 0xbe, 0xef, 0xc0, 0xff, 0xee, 0xee, 0x00, 0x00,
+0x88, 0xAC, // OP_EQUALVERIFY, OP_CHECKSIG
+0xFF, 0xFF, 0xFF, 0xFF, // sequence
+0x02, // number of outputs
+0x00, 0x46, 0xc3, 0x23, 0x00, 0x00, 0x00, 0x00, // 6 BTC
+0x19, // script length
+0x76, 0xA9, 0x14, // OP_DUP, OP_HASH160, 20 bytes of data follows
+0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99,
+0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff, 0x00, 0x11, 0x22, 0x33,
+0x88, 0xAC, // OP_EQUALVERIFY, OP_CHECKSIG
+0x87, 0xd6, 0x12, 0x00, 0x00, 0x00, 0x00, 0x00, // 0.01234567 BTC
+0x19, // script length
+0x76, 0xA9, 0x14, // OP_DUP, OP_HASH160, 20 bytes of data follows
+0x01, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99,
+0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff, 0x00, 0x11, 0x22, 0x33,
+0x88, 0xAC, // OP_EQUALVERIFY, OP_CHECKSIG
+0x00, 0x00, 0x00, 0x00, // locktime
+0x01, 0x00, 0x00, 0x00 // hashtype
+};
+
+/** Fee of #test_transaction (10.33 - 6 - 0.01234567 BTC), as a 64 bit,
+  * little-endian integer. */
+static const uint8_t test_transaction_fee[8] = {
+0xb9, 0x37, 0xbc, 0x19, 0x00, 0x00, 0x00, 0x00};
+
+/** Number of address handles to check in each hostDeriveAddresses() test.
+  * This isn't a multiple of #HASH160_BATCH_SIZE, so that both full and
+  * partly filled batches are covered. */
+#define TEST_ADDRESS_COUNT		11
+
+/** Check hostDeriveAddresses() against the private key derivation which the
+  * device uses, for a random seed.
+  * \param do_compress Whether to give hostDeriveAddresses() the master public
+  *                    key in compressed form.
+  */
+static void checkDeriveAddresses(bool do_compress)
+{
+	uint8_t seed[64];
+	uint8_t master_private_key[32];
+	uint8_t private_key[32];
+	PointAffine public_key;
+	uint8_t serialised[ECDSA_MAX_SERIALISE_SIZE];
+	uint8_t serialised_size;
+	uint8_t compare_address[20];
+	uint8_t addresses[TEST_ADDRESS_COUNT * 20];
+	uint8_t public_keys[TEST_ADDRESS_COUNT * HOSTLIB_PUBLIC_KEY_LENGTH];
+	uint32_t i;
+
+	fillWithRandom(seed, sizeof(seed));
+	bigLoadBigEndian(master_private_key, seed);
+	setFieldToN();
+	bigModulo(master_private_key, master_private_key);
+	pointMultiplyBase(&public_key, master_private_key);
+	serialised_size = ecdsaSerialise(serialised, &public_key, do_compress);
+	if (hostDeriveAddresses(addresses, public_keys, serialised, serialised_size, &(seed[32]), 1, TEST_ADDRESS_COUNT))
+	{
+		printf("hostDeriveAddresses() failed\n");
+		reportFailure();
+		return;
+	}
+	clearParentPublicKeyCache();
+	for (i = 0; i < TEST_ADDRESS_COUNT; i++)
+	{
+		generateDeterministic256(private_key, seed, i + 1);
+		pointMultiplyBase(&public_key, private_key);
+		serialised_size = ecdsaSerialise(serialised, &public_key, true);
+		hash160(compare_address, serialised, serialised_size);
+		if (!memcmp(&(addresses[i * 20]), compare_address, 20)
+			&& !memcmp(&(public_keys[i * HOSTLIB_PUBLIC_KEY_LENGTH]), serialised, HOSTLIB_PUBLIC_KEY_LENGTH))
+		{
+			reportSuccess();
+		}
+		else
+		{
+			printf("Address handle %u doesn't match private key derivation\n", (unsigned int)(i + 1));
+			reportFailure();
+		}
+	}
+	clearParentPublicKeyCache();
+}
+
+/** Number of address handles to check in the hostDeriveAddressesParallel()
+  * test. This isn't a multiple of any of the thread counts used there, so
+  * that the parts are uneven. */
+#define TEST_PARALLEL_COUNT		37
+
+/** Check that hostDeriveAddressesParallel() gives the same results as
+  * hostDeriveAddresses(), for several numbers of threads. */
+static void checkDeriveAddressesParallel(void)
+{
+	uint8_t private_key[32];
+	uint8_t chain_code[32];
+	PointAffine public_key;
+	uint8_t serialised[ECDSA_MAX_SERIALISE_SIZE];
+	uint8_t serialised_size;
+	uint8_t addresses[TEST_PARALLEL_COUNT * 20];
+	uint8_t public_keys[TEST_PARALLEL_COUNT * HOSTLIB_PUBLIC_KEY_LENGTH];
+	uint8_t compare_addresses[TEST_PARALLEL_COUNT * 20];
+	uint8_t compare_public_keys[TEST_PARALLEL_COUNT * HOSTLIB_PUBLIC_KEY_LENGTH];
+	static const uint32_t thread_counts[5] = {0, 1, 3, 8, 100};
+	int i;
+
+	fillWithRandom(private_key, sizeof(private_key));
+	fillWithRandom(chain_code, sizeof(chain_code));
+	setFieldToN();
+	bigModulo(private_key, private_key);
+	pointMultiplyBase(&public_key, private_key);
+	serialised_size = ecdsaSerialise(serialised, &public_key, true);
+	hostDeriveAddresses(compare_addresses, compare_public_keys, serialised, serialised_size, chain_code, 7, TEST_PARALLEL_COUNT);
+	for (i = 0; i < (int)(sizeof(thread_counts) / sizeof(thread_counts[0])); i++)
+	{
+		memset(addresses, 0, sizeof(addresses));
+		memset(public_keys, 0, sizeof(public_keys));
+		if (!hostDeriveAddressesParallel(addresses, public_keys, serialised, serialised_size, chain_code, 7, TEST_PARALLEL_COUNT, thread_counts[i])
+			&& !memcmp(addresses, compare_addresses, sizeof(addresses))
+			&& !memcmp(public_keys, compare_public_keys, sizeof(public_keys)))
+		{
+			reportSuccess();
+		}
+		else
+		{
+			printf("hostDeriveAddressesParallel() mismatch with %u threads\n", (unsigned int)thread_counts[i]);
+			reportFailure();
+		}
+	}
+	if (hostDeriveAddressesParallel(addresses, NULL, serialised, serialised_size, chain_code, 0, TEST_PARALLEL_COUNT, 4))
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("hostDeriveAddressesParallel() accepts address handle 0\n");
+		reportFailure();
+	}
+}
+
+/** Number of threads to run at once in the multi-threaded test. */
+#define TEST_THREADS			4
+/** Number of times each thread in the multi-threaded test derives
+  * addresses and parses #test_transaction. */
+#define TEST_THREAD_ITERATIONS	20
+
+/** Serialised master public key used by the multi-threaded test. */
+static uint8_t thread_master_public_key[ECDSA_MAX_SERIALISE_SIZE];
+/** Length of #thread_master_public_key. */
+static uint8_t thread_master_public_key_length;
+/** Chain code used by the multi-threaded test. */
+static uint8_t thread_chain_code[32];
+/** Addresses which every thread in the multi-threaded test should get. */
+static uint8_t thread_expected_addresses[TEST_ADDRESS_COUNT * 20];
+/** Summary which every thread in the multi-threaded test should get. */
+static HostTransactionSummary thread_expected_summary;
+
+/** Thread function for the multi-threaded test. This repeatedly derives
+  * addresses and parses #test_transaction, while other threads are doing
+  * the same, and checks that the results are always the same as those
+  * calculated with only one thread running.
+  * \param arg Points to a bool, which will be set to true if any result was
+  *            wrong.
+  * \return NULL.
+  */
+static void *testThread(void *arg)
+{
+	bool *failed;
+	uint8_t addresses[TEST_ADDRESS_COUNT * 20];
+	HostTransactionSummary summary;
+	int i;
+
+	failed = (bool *)arg;
+	*failed = false;
+	for (i = 0; i < TEST_THREAD_ITERATIONS; i++)
+	{
+		if (hostDeriveAddresses(addresses, NULL, thread_master_public_key, thread_master_public_key_length, thread_chain_code, 1, TEST_ADDRESS_COUNT)
+			|| memcmp(addresses, thread_expected_addresses, sizeof(addresses)))
+		{
+			*failed = true;
+		}
+		if ((hostParseTransaction(&summary, test_transaction, sizeof(test_transaction)) != TRANSACTION_NO_ERROR)
+			|| memcmp(&summary, &thread_expected_summary, sizeof(summary)))
+		{
+			*failed = true;
+		}
+	}
+	return NULL;
+}
+
+/** Run several threads which use the library at the same time, and check
+  * that they don't interfere with each other. */
+static void checkThreads(void)
+{
+	pthread_t threads[TEST_THREADS];
+	bool failed[TEST_THREADS];
+	PointAffine public_key;
+	uint8_t private_key[32];
+	int i;
+
+	fillWithRandom(private_key, sizeof(private_key));
+	fillWithRandom(thread_chain_code, sizeof(thread_chain_code));
+	setFieldToN();
+	bigModulo(private_key, private_key);
+	pointMultiplyBase(&public_key, private_key);
+	thread_master_public_key_length = ecdsaSerialise(thread_master_public_key, &public_key, true);
+	hostDeriveAddresses(thread_expected_addresses, NULL, thread_master_public_key, thread_master_public_key_length, thread_chain_code, 1, TEST_ADDRESS_COUNT);
+	hostParseTransaction(&thread_expected_summary, test_transaction, sizeof(test_transaction));
+
+	for (i = 0; i < TEST_THREADS; i++)
+	{
+		if (pthread_create(&(threads[i]), NULL, &testThread, &(failed[i])))
+		{
+			printf("Couldn't create thread %d\n", i);
+			reportFailure();
+			return;
+		}
+	}
+	for (i = 0; i < TEST_THREADS; i++)
+	{
+		pthread_join(threads[i], NULL);
+		if (!failed[i])
+		{
+			reportSuccess();
+		}
+		else
+		{
+			printf("Thread %d got wrong results\n", i);
+			reportFailure();
+		}
+	}
+}
+
+int main(void)
+{
+	HostTransactionSummary summary;
+	uint8_t address[20];
+	uint8_t bad_key[33];
+	char text_amount[TEXT_AMOUNT_LENGTH];
+	char text_address[TEXT_ADDRESS_LENGTH];
+	int i;
+
+	initTests(__FILE__);
+
+	if (hostGetAPIVersion() == HOSTLIB_API_VERSION)
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("hostGetAPIVersion() doesn't match header\n");
+		reportFailure();
+	}
+
+	for (i = 0; i < 10; i++)
+	{
+		checkDeriveAddresses(false);
+		checkDeriveAddresses(true);
+	}
+
+	// Invalid master public keys and address handles must be rejected.
+	memset(bad_key, 0, sizeof(bad_key));
+	bad_key[0] = 0x05;
+	if (hostDeriveAddresses(address, NULL, bad_key, sizeof(bad_key), bad_key, 1, 1))
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("hostDeriveAddresses() accepts invalid master public key\n");
+		reportFailure();
+	}
+	if (hostDeriveAddresses(address, NULL, bad_key, sizeof(bad_key), bad_key, 0, 1))
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("hostDeriveAddresses() accepts address handle 0\n");
+		reportFailure();
+	}
+
+	// Parse a known good transaction.
+	if ((hostParseTransaction(&summary, test_transaction, sizeof(test_transaction)) == TRANSACTION_NO_ERROR)
+		&& (summary.num_outputs == 2)
+		&& summary.has_fee
+		&& !memcmp(summary.fee, test_transaction_fee, 8))
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("hostParseTransaction() didn't summarise good transaction\n");
+		reportFailure();
+	}
+	outputDescriptorToText(text_amount, text_address, &(summary.outputs[1]));
+	if (!strcmp(text_amount, "0.01234567") && !strcmp(text_address, "16eCeyy63xi5yde9VrX4XCcRrCKZwtUZK"))
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("Second output of good transaction is wrong: %s to %s\n", text_amount, text_address);
+		reportFailure();
+	}
+
+	// A truncated transaction must be rejected.
+	if (hostParseTransaction(&summary, test_transaction, sizeof(test_transaction) - 1) != TRANSACTION_NO_ERROR)
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("hostParseTransaction() accepts truncated transaction\n");
+		reportFailure();
+	}
+
+	checkThreads();
+	checkDeriveAddressesParallel();
+
+	finishTests();
+	exit(0);
+}
+
+#endif // #ifdef TEST_HOSTLIB
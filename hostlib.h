@@ -0,0 +1,74 @@
+/** \file hostlib.h
+  *
+  * \brief Describes the interface of the host library (see hostlib.c).
+  *
+  * This is the only header which users of the host library need to include.
+  * Everything declared here is part of the library's stable interface; if
+  * any of it changes incompatibly, #HOSTLIB_API_VERSION will be increased.
+  *
+  * This file is licensed as described by the file LICENCE.
+  */
+
+#ifndef HOSTLIB_H_INCLUDED
+#define HOSTLIB_H_INCLUDED
+
+#include "common.h"
+#include "baseconv.h"
+#include "transaction.h"
+
+/** Version of the interface described by this file. This is what
+  * hostGetAPIVersion() returns. */
+#define HOSTLIB_API_VERSION		1
+
+#ifndef HOSTLIB_MAX_OUTPUTS
+/** Maximum number of outputs which a #HostTransactionSummary can hold.
+  * Transactions with more outputs than this are rejected with
+  * #TRANSACTION_TOO_MANY_OUTPUTS. This can be overridden by defining
+  * HOSTLIB_MAX_OUTPUTS when building the library (and everything which
+  * uses it).
+  */
+#define HOSTLIB_MAX_OUTPUTS		64
+#endif // #ifndef HOSTLIB_MAX_OUTPUTS
+
+#ifndef HOSTLIB_MAX_THREADS
+/** Maximum number of threads which hostDeriveAddressesParallel() uses.
+  * This can be overridden by defining HOSTLIB_MAX_THREADS when building the
+  * library. */
+#define HOSTLIB_MAX_THREADS		64
+#endif // #ifndef HOSTLIB_MAX_THREADS
+
+/** Length, in number of bytes, of each public key written by
+  * hostDeriveAddresses(). Public keys are always compressed. */
+#define HOSTLIB_PUBLIC_KEY_LENGTH	33
+
+/** Everything the device would show the user (and sign) for a
+  * transaction, as calculated by hostParseTransaction(). */
+typedef struct HostTransactionSummaryStruct
+{
+	/** The signature hash, as a little-endian 256 bit number. This is the
+	  * hash which the device signs. */
+	uint8_t sig_hash[32];
+	/** The transaction hash, as a little-endian 256 bit number. This is
+	  * what the device uses to decide whether the user has already
+	  * approved the transaction. */
+	uint8_t transaction_hash[32];
+	/** Number of entries in outputs. */
+	uint32_t num_outputs;
+	/** The outputs of the transaction, in the order they appear in it. Use
+	  * outputDescriptorToText() to get the text that the device would
+	  * display. */
+	OutputDescriptor outputs[HOSTLIB_MAX_OUTPUTS];
+	/** Whether the transaction pays a fee. If this is false, fee is
+	  * zero. */
+	bool has_fee;
+	/** The transaction fee, in 10 ^ -8 BTC, as a 64 bit, unsigned,
+	  * little-endian integer. */
+	uint8_t fee[8];
+} HostTransactionSummary;
+
+extern uint32_t hostGetAPIVersion(void);
+extern bool hostDeriveAddresses(uint8_t *out_addresses, uint8_t *out_public_keys, const uint8_t *master_public_key, uint8_t master_public_key_length, const uint8_t *chain_code, uint32_t start_ah, uint32_t count);
+extern bool hostDeriveAddressesParallel(uint8_t *out_addresses, uint8_t *out_public_keys, const uint8_t *master_public_key, uint8_t master_public_key_length, const uint8_t *chain_code, uint32_t start_ah, uint32_t count, uint32_t num_threads);
+extern TransactionErrors hostParseTransaction(HostTransactionSummary *out_summary, const uint8_t *transaction, uint32_t length);
+
+#endif // #ifndef HOSTLIB_H_INCLUDED
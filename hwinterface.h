@@ -13,6 +13,7 @@
 #define HWINTERFACE_H_INCLUDED
 
 #include "common.h"
+#include "baseconv.h"
 
 /** Return values for non-volatile storage I/O functions. */
 typedef enum NonVolatileReturnEnum
@@ -63,7 +64,9 @@ typedef enum AskUserCommandEnum
 	/** Do you want to give the host access to the master public key? */
 	ASKUSER_GET_MASTER_KEY		=	9,
 	/** Do you want to delete an existing wallet? */
-	ASKUSER_DELETE_WALLET		=	10
+	ASKUSER_DELETE_WALLET		=	10,
+	/** Do you want the new wallet to stay unlocked across sessions? */
+	ASKUSER_KEEP_UNLOCKED		=	11
 } AskUserCommand;
 
 /** Values for getString() function which specify which set of strings
@@ -107,6 +110,62 @@ typedef enum MiscStringsEnum
 	MISCSTR_CONFIG					=	8
 } MiscStrings;
 
+/** Health and throughput statistics for the hardware random number
+  * generator (HWRNG); see getHWRNGHealth(). Statistical properties are
+  * those of the most recent array of samples which was tested, and are in
+  * the same units and Q16.16 fixed-point representation as the platform's
+  * statistical tests use (see statistics.c). Counts are since the device was
+  * last reset; rates can be obtained by reading them twice. Platforms which
+  * don't calculate something should report 0 for it. */
+typedef struct HWRNGHealthStruct
+{
+	/** Whether any array of samples has been tested yet. If this is false,
+	  * the statistical properties below are meaningless. */
+	bool has_statistics;
+	/** Mean of the most recent array of samples. */
+	int32_t mean;
+	/** Variance of the most recent array of samples. */
+	int32_t variance;
+	/** Third cumulant (non-standardised skewness) of the most recent array
+	  * of samples. */
+	int32_t kappa3;
+	/** Fourth cumulant (non-standardised kurtosis) of the most recent array
+	  * of samples. */
+	int32_t kappa4;
+	/** Peak of the power spectrum of the most recent array of samples, in
+	  * FFT bins. */
+	int32_t max_bin;
+	/** Estimated bandwidth of the most recent array of samples, in FFT
+	  * bins. */
+	int32_t bandwidth;
+	/** Largest autocorrelation amplitude of the most recent array of
+	  * samples. */
+	int32_t max_autocorrelation;
+	/** Estimated entropy per sample of the most recent array of samples, in
+	  * bits. */
+	int32_t entropy_estimate;
+	/** Bit field of the statistical tests which the most recent array of
+	  * samples failed, or 0 if it passed every test. */
+	uint32_t last_failed_tests;
+	/** Number of arrays of samples which have been tested. */
+	uint32_t arrays_tested;
+	/** Number of arrays of samples which failed at least one test. */
+	uint32_t arrays_failed;
+	/** Number of samples which have been tested. */
+	uint32_t samples_tested;
+	/** Number of bytes returned by successful calls to
+	  * hardwareRandom32Bytes(). */
+	uint32_t bytes_delivered;
+	/** Number of calls to hardwareRandom32Bytes() which had to wait for
+	  * samples. */
+	uint32_t blocked_calls;
+	/** Total time spent waiting for samples, in getCycleCount() ticks. */
+	uint64_t blocked_ticks;
+	/** Longest time spent waiting for samples in one call, in
+	  * getCycleCount() ticks. */
+	uint32_t max_blocked_ticks;
+} HWRNGHealth;
+
 /** Obtain one character from one of the device's strings.
   * \param set Specifies which set of strings to use; should be
   *            one of #StringSetEnum.
@@ -127,6 +186,22 @@ extern char getString(StringSet set, uint8_t spec, uint16_t pos);
   * \return The length of the string, in number of characters.
   */
 extern uint16_t getStringLength(StringSet set, uint8_t spec);
+/** Get one of the device's strings, all at once. This is faster than calling
+  * getString() for each character, since the string only needs to be looked
+  * up once.
+  * On AVR, the string is in program memory (see #PROGMEM), so it must be
+  * read using #LOOKUP_BYTE.
+  * \param set Specifies which set of strings to use; should be
+  *            one of #StringSetEnum.
+  * \param spec Specifies which string to get. The interpretation of this
+  *             depends on the value of set; see #StringSetEnum for
+  *             clarification.
+  * \param out_length The length of the string, in number of characters, will
+  *                   be written here.
+  * \return A pointer to the first character of the string. The string is not
+  *         necessarily null-terminated.
+  */
+extern const char *getStringSpan(StringSet set, uint8_t spec, uint16_t *out_length);
 
 /** Grab one byte from the communication stream. There is no way for this
   * function to indicate a read error. This is intentional; it
@@ -163,7 +238,68 @@ extern uint8_t streamGetOneByte(void);
   * \param one_byte The byte to send.
   */
 extern void streamPutOneByte(uint8_t one_byte);
+/** Grab a number of bytes from the communication stream. This must behave
+  * exactly like calling streamGetOneByte() length times, but
+  * implementations can use it to move bytes in bulk (for example, with
+  * one critical section per chunk instead of one per byte). Like
+  * streamGetOneByte(), this should only return once all the bytes have been
+  * received free of read errors.
+  * \param buffer The received bytes will be written here. This must have
+  *               space for length bytes.
+  * \param length The number of bytes to receive.
+  */
+extern void streamGetBytes(uint8_t *buffer, uint32_t length);
+/** Throw away a number of bytes from the communication stream. This must
+  * behave exactly like calling streamGetBytes() with a buffer that is never
+  * looked at, but implementations should drop whole spans of their receive
+  * buffer at once and make room for the next receive straight away, so
+  * that an unwanted payload (for example, the rest of a rejected packet)
+  * is drained as fast as the link can deliver it.
+  * \param length The number of bytes to throw away.
+  */
+extern void streamDiscardBytes(uint32_t length);
+/** Send a number of bytes to the communication stream. This must behave
+  * exactly like calling streamPutOneByte() length times, but
+  * implementations can use it to move bytes in bulk. Like
+  * streamPutOneByte(), this should only return once all the bytes have been
+  * sent free of write errors.
+  * \param buffer The bytes to send.
+  * \param length The number of bytes to send.
+  */
+extern void streamPutBytes(const uint8_t *buffer, uint32_t length);
+/** Check whether there is at least one byte waiting in the communication
+  * stream's receive buffer, i.e. whether streamGetOneByte() would return
+  * without waiting. This is used during long-running operations to see
+  * whether the host has sent anything (see longOperationYield()), so it must
+  * not block.
+  * \return true if a byte can be read without waiting, false otherwise.
+  */
+extern bool streamIsByteAvailable(void);
 
+#ifdef DEFER_OUTPUT_FORMATTING
+/** Notify the user interface that the transaction parser has seen a new
+  * transaction output. If DEFER_OUTPUT_FORMATTING is defined, outputs are
+  * passed in binary form, so that the conversion to text (which is slow) is
+  * only done for the outputs which the user interface actually displays. Use
+  * outputDescriptorToText() to do the conversion. The user interface can
+  * use isOwnAddress() to recognise outputs which pay back to the wallet
+  * (change), and leave them out of what it asks the user to approve.
+  * \param output The transaction output. The user interface must make a
+  *               copy of this if it wants to keep it, since the object may
+  *               be overwritten after this returns.
+  * \return false if no error occurred, true if there was not enough space to
+  *         store the output.
+  */
+extern bool newOutputSeen(OutputDescriptor *output);
+/** Notify the user interface that the transaction parser has seen the
+  * transaction fee. If there is no transaction fee, the transaction parser
+  * will not call this.
+  * \param amount The transaction fee, in 10 ^ -8 BTC, as a 64 bit, unsigned,
+  *               little-endian integer. Use amountToText() to convert it to
+  *               text.
+  */
+extern void setTransactionFee(uint8_t *amount);
+#else // #ifdef DEFER_OUTPUT_FORMATTING
 /** Notify the user interface that the transaction parser has seen a new
   * Bitcoin amount/address pair.
   * \param text_amount The output amount, as a null-terminated text string
@@ -181,6 +317,7 @@ extern bool newOutputSeen(char *text_amount, char *text_address);
   *                    such as "0.01".
   */
 extern void setTransactionFee(char *text_amount);
+#endif // #ifdef DEFER_OUTPUT_FORMATTING
 /** Notify the user interface that the list of Bitcoin amount/address pairs
   * should be cleared. */
 extern void clearOutputsSeen(void);
@@ -222,6 +359,14 @@ extern void clearOTP(void);
   *         should continue to call this until it returns a non-zero value.
   */
 extern int hardwareRandom32Bytes(uint8_t *buffer);
+/** Get health and throughput statistics for the hardware random number
+  * generator (HWRNG), so that a slow or degrading noise source can be
+  * spotted in the field. This must always be available, not just in test
+  * builds.
+  * \param out_health The statistics will be written here.
+  *                   See #HWRNGHealthStruct.
+  */
+extern void getHWRNGHealth(HWRNGHealth *out_health);
 
 /** Get size of a partition.
   * \param out_size On success, the size of the partition (in number of bytes)
@@ -245,6 +390,22 @@ extern NonVolatileReturn nonVolatileGetSize(uint32_t *out_size, NVPartitions par
   *          data is actually written to non-volatile storage.
   */
 extern NonVolatileReturn nonVolatileWrite(uint8_t *data, NVPartitions partition, uint32_t address, uint32_t length);
+/** Fill an area of non-volatile storage with a single byte value. This has
+  * the same effect as calling nonVolatileWrite() with a buffer filled
+  * with value, but lets the platform use a native operation (for example,
+  * an erase or a pattern program command) instead of copying data in. This
+  * is used by sanitiseNonVolatileStorage() for its constant pattern passes.
+  * \param partition The partition to fill. Must be one of #NVPartitions.
+  * \param address Byte offset specifying where in the partition to
+  *                start filling.
+  * \param length The number of bytes to fill.
+  * \param value The byte value to fill the area with.
+  * \return See #NonVolatileReturnEnum for return values.
+  * \warning Like nonVolatileWrite(), this may be buffered; use
+  *          nonVolatileFlush() to be sure that the area is actually
+  *          overwritten.
+  */
+extern NonVolatileReturn nonVolatileFill(NVPartitions partition, uint32_t address, uint32_t length, uint8_t value);
 /** Read from non-volatile storage.
   * \param data A pointer to the buffer which will receive the data.
   * \param partition The partition to read from. Must be one of #NVPartitions.
@@ -295,8 +456,66 @@ extern bool writeBackupSeed(uint8_t *seed, bool is_encrypted, uint32_t destinati
   * this should be a power of 2. That way, an implementation can use
   * successively greater powers of 2 until the correct number of iterations is
   * found.
+  *
+  * This is only a default; if the platform defines PBKDF2_TARGET_CYCLES,
+  * the number of iterations is measured on the device when the wallet area
+  * is formatted (see calibrateKeyDerivation()), and that is used instead.
   * \return Number of iterations to use in PBKDF2 algorithm.
   */
 extern uint32_t getPBKDF2Iterations(void);
 
+#ifdef ENABLE_KEEP_UNLOCKED
+/** Get the number of seconds since some fixed point in time (eg. when the
+  * device was powered on). This is used to lock wallets which are allowed
+  * to stay unlocked across sessions once they haven't been used for a while
+  * (see expireWalletContexts()), so it only needs to be accurate to within
+  * a few percent. Only the difference between two values is meaningful.
+  * \return The current value of the seconds counter.
+  */
+extern uint32_t getSecondsCounter(void);
+#endif // #ifdef ENABLE_KEEP_UNLOCKED
+
+#if defined(ENABLE_BENCHMARK) || defined(ENABLE_DIAGNOSTICS)
+/** Get the current value of a free-running cycle counter. This is only used
+  * to time things, so only the difference between two values is
+  * meaningful. The counter should wrap around modulo 2 ^ 32. The tick rate
+  * is platform-dependent, but should be some fixed multiple or fraction of
+  * the CPU clock rate.
+  * \return The current value of the cycle counter.
+  */
+extern uint32_t getCycleCount(void);
+#endif // #if defined(ENABLE_BENCHMARK) || defined(ENABLE_DIAGNOSTICS)
+
+#ifdef ENABLE_DIAGNOSTICS
+/** Get the region of RAM which is reserved for the stack, so that its usage
+  * can be measured (see diagnosticsPaintStack()). The stack must grow
+  * downwards. Nothing else should live in the region, since everything in
+  * it which is below the current stack pointer may be overwritten.
+  * \param out_bottom Will be set to the lowest address of the region. Set
+  *                   this to NULL if stack usage can't be measured.
+  * \param out_top Will be set to one past the highest address of the region.
+  */
+extern void getStackBounds(uint8_t **out_bottom, uint8_t **out_top);
+#endif // #ifdef ENABLE_DIAGNOSTICS
+
+#ifdef ENABLE_PERFORMANCE_GOVERNOR
+/** Tell the platform that a burst of heavy computation (eg. key derivation,
+  * signing or transaction parsing) is about to start, so that it can switch
+  * to whatever configuration gives the most throughput. Bursts may be
+  * nested; the platform should stay in that configuration until every call
+  * to this has been matched by a call to performanceBurstEnd().
+  */
+extern void performanceBurstBegin(void);
+/** Tell the platform that a burst of heavy computation which was started
+  * by performanceBurstBegin() is over. Once the outermost burst is over,
+  * the platform can go back to a low-power configuration.
+  */
+extern void performanceBurstEnd(void);
+#else
+// Without ENABLE_PERFORMANCE_GOVERNOR, the platform always runs in the same
+// configuration.
+#define performanceBurstBegin()
+#define performanceBurstEnd()
+#endif // #ifdef ENABLE_PERFORMANCE_GOVERNOR
+
 #endif // #ifndef HWINTERFACE_H_INCLUDED
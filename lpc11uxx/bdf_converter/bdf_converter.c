@@ -8,22 +8,22 @@
   * 8-July-2012.
   *
   * The main tasks of this program are to parse the BDF file, convert the
-  * bitmaps into vertical bitmaps and then output a packed font table as C
-  * source.
+  * bitmaps into vertical bitmaps and then output a page-aligned font table
+  * as C source.
   * The parser knows only a small subset of BDF, can only handle fixed-width
   * fonts and will probably choke on many BDF files. It was written with the
   * Terminus font family (see http://terminus-font.sourceforge.net/) in mind,
   * and it seems to successfully parse those BDF files.
   *
-  * ssd1306.c requires the font table to be a packed vertical bitmap. The
-  * packed vertical bitmap can be interpreted as follows: imagine the font
-  * table as a single large little-endian multi-precision integer. Start
-  * with the least significant bit and move to more significant bits. The
-  * least significant bit represents the top-left pixel of the first glyph.
-  * For each increment in bit significance, move down to the next pixel. If
-  * you get to the bottom, move to the top of the next (towards the right)
-  * column. If you get to the bottom of the last column, move to the top-left
-  * pixel of the next glyph.
+  * ssd1306.c requires the font table to be a page-aligned vertical bitmap,
+  * which matches the layout of the SSD1306's GDDRAM. Each glyph is stored
+  * as a sequence of columns, starting with the leftmost column. Each column
+  * is stored as (height + 7) / 8 bytes, starting with the topmost byte. Each
+  * byte represents 8 vertically adjacent pixels, with the least significant
+  * bit being the topmost pixel. If the height is not a multiple of 8, the
+  * last byte of each column is padded with 0 bits. Thus every glyph
+  * occupies width * ((height + 7) / 8) bytes and every (page of a) column can
+  * be copied straight into GDDRAM.
   *
   * This file is licensed as described by the file LICENCE.
   */
@@ -188,7 +188,8 @@ int main(int argc, char **argv)
 	int *current_bitmap;
 	int output_byte;
 	int mask;
-	int bits_shifted;
+	int pages; // number of bytes per column
+	int page;
 	FILE *bdf;
 
 	if (argc != 2)
@@ -235,10 +236,9 @@ int main(int argc, char **argv)
 	}
 	fclose(bdf);
 
-	// Convert horizontal bitmaps into packed vertical bitmaps.
-	output_byte = 0;
+	// Convert horizontal bitmaps into page-aligned vertical bitmaps.
 	null_bitmap = calloc(bytes_per_row * height, sizeof(int));
-	bits_shifted = 0;
+	pages = (height + 7) >> 3; // round up
 	values_on_output_line = 0;
 	for (i = ENCODING_START; i < ENCODING_END; i++)
 	{
@@ -254,35 +254,30 @@ int main(int argc, char **argv)
 		}
 		for (j = 0; j < width; j++)
 		{
-			for (k = 0; k < height; k++)
+			mask = 0x80 >> (j & 7);
+			for (page = 0; page < pages; page++)
 			{
-				output_byte >>= 1;
-				mask = 0x80 >> (j & 7);
-				// Inspect pixel of glyph with encoding value i, at column
-				// j and row k.
-				if (current_bitmap[k * bytes_per_row + (j >> 3)] & mask)
+				output_byte = 0;
+				for (k = 0; k < 8; k++)
 				{
-					output_byte |= 0x80;
-				}
-				bits_shifted++;
-				if (bits_shifted == 8)
-				{
-					outputTableByte(output_byte, 0);
-					output_byte = 0;
-					bits_shifted = 0;
+					// Inspect pixel of glyph with encoding value i, at column
+					// j and row (page * 8 + k). Rows past the bottom of the
+					// glyph are padding.
+					if (((page * 8 + k) < height)
+						&& (current_bitmap[(page * 8 + k) * bytes_per_row + (j >> 3)] & mask))
+					{
+						output_byte |= 1 << k;
+					}
 				}
+				outputTableByte(output_byte,
+					(i == (ENCODING_END - 1)) && (j == (width - 1)) && (page == (pages - 1)));
 			}
 		} // end for (j = 0; j < width; j++)
 	} // end for (i = ENCODING_START; i < ENCODING_END; i++)
-
-	// Take care of incomplete byte (if there is one).
-	if (bits_shifted != 0)
+	if (values_on_output_line != 0)
 	{
-		output_byte >>= (8 - bits_shifted);
-		outputTableByte(output_byte, 0);
+		printf("\n");
 	}
-	// Finish off table with extra 00, as needed by ssd1306.c.
-	outputTableByte(0, 1);
 	printf("};\n");
 
 	exit(0);
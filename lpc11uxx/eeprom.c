@@ -6,11 +6,21 @@
   * LPC11Uxx's EEPROM. The in application programming (IAP) interface is
   * used to access the EEPROM.
   *
+  * Every IAP "Write EEPROM" call erases and programs whole EEPROM pages and
+  * is slow, even if only a few bytes are written. To avoid paying for a page
+  * cycle on every small write, writes are accumulated in a RAM buffer of
+  * one #EEPROM_PAGE_SIZE byte page. The buffered page is only written to the
+  * EEPROM (with one IAP call) when a write touches a different page or when
+  * nonVolatileFlush() is called. This matches the contract of the PIC32's
+  * nvmem_manager.c: writes may be buffered and nonVolatileFlush() commits
+  * them.
+  *
   * This file is licensed as described by the file LICENCE.
   */
 
 #include "../common.h"
 #include "../hwinterface.h"
+#include "../diagnostics.h"
 
 /** In application programming entry point. The 0th bit is set to force
   * the instruction mode to Thumb mode. */
@@ -32,26 +42,124 @@ static uint32_t iap_result[5];
   * \warning This is set for LPC11Uxx microcontrollers with 4K of
   *          EEPROM. This will need to be adjusted if that's not the case.
   */
-#define EEPROM_SIZE		4032
+#define EEPROM_SIZE				4032
+/** Size, in bytes, of an EEPROM page. Writes are combined into pages of this
+  * size.
+  * \warning This must be a divisor of #EEPROM_SIZE.
+  */
+#define EEPROM_PAGE_SIZE		64
+/** Size of global partition, in bytes. */
+#define GLOBAL_PARTITION_SIZE	512
+/** Size of accounts partition, in bytes. This is
+  * just #EEPROM_SIZE - #GLOBAL_PARTITION_SIZE. */
+#define ACCOUNTS_PARTITION_SIZE	3520
 
-/** Write to non-volatile storage.
-  * \param data A pointer to the data to be written.
-  * \param address Byte offset specifying where in non-volatile storage to
-  *                start writing to.
-  * \param length The number of bytes to write.
+/** EEPROM address of the page in #page_buffer. This is only well-defined
+  * if #page_buffer_valid is true. */
+static uint32_t page_buffer_address;
+/** Whether #page_buffer holds a copy of an EEPROM page. */
+static bool page_buffer_valid;
+/** Whether #page_buffer has been written to since it was last written to
+  * the EEPROM. */
+static bool page_buffer_dirty;
+/** Contents of the EEPROM page at #page_buffer_address, including any
+  * writes which haven't been committed yet. */
+static uint8_t page_buffer[EEPROM_PAGE_SIZE];
+
+/** Get size of a partition.
+  * \param out_size On success, the size of the partition (in number of bytes)
+  *                 will be written here.
+  * \param partition Partition to query. Must be one of #NVPartitions.
   * \return See #NonVolatileReturnEnum for return values.
-  * \warning Writes may be buffered; use nonVolatileFlush() to be sure that
-  *          data is actually written to non-volatile storage.
+  * \warning The size of each partition must be a multiple of 4.
   */
-NonVolatileReturn nonVolatileWrite(uint8_t *data, uint32_t address, uint32_t length)
+NonVolatileReturn nonVolatileGetSize(uint32_t *out_size, NVPartitions partition)
 {
+	if (partition == PARTITION_GLOBAL)
+	{
+		*out_size = GLOBAL_PARTITION_SIZE;
+		return NV_NO_ERROR;
+	}
+	else if (partition == PARTITION_ACCOUNTS)
+	{
+		*out_size = ACCOUNTS_PARTITION_SIZE;
+		return NV_NO_ERROR;
+	}
+	else
+	{
+		return NV_INVALID_ADDRESS;
+	}
+}
+
+/** Check that an address range lies entirely within a partition, and tweak
+  * the address to convert from partition offset to EEPROM address.
+  * \param address Address (offset) within a partition.
+  * \param partition The partition to check against. Must be one
+  *                  of #NVPartitions.
+  * \param length The number of bytes in the address range.
+  * \return See #NonVolatileReturnEnum for return values.
+  */
+static NonVolatileReturn checkAndTweakAddress(uint32_t *address, NVPartitions partition, uint32_t length)
+{
+	uint32_t size;
+	NonVolatileReturn r;
+
 	// Since EEPROM_SIZE is much smaller than 2 ^ 32, address + length cannot
 	// overflow.
-	if ((address > EEPROM_SIZE) || (length > EEPROM_SIZE)
-		|| ((address + length) > EEPROM_SIZE))
+	if ((*address > EEPROM_SIZE) || (length > EEPROM_SIZE)
+		|| ((*address + length) > EEPROM_SIZE))
 	{
 		return NV_INVALID_ADDRESS;
 	}
+	r = nonVolatileGetSize(&size, partition);
+	if (r != NV_NO_ERROR)
+	{
+		return r;
+	}
+	if ((*address + length) > size)
+	{
+		return NV_INVALID_ADDRESS;
+	}
+	if (partition == PARTITION_ACCOUNTS)
+	{
+		*address += GLOBAL_PARTITION_SIZE;
+	}
+	return NV_NO_ERROR;
+}
+
+/** Read directly from the EEPROM using the IAP "Read EEPROM" command,
+  * ignoring #page_buffer.
+  * \param data A pointer to the buffer which will receive the data.
+  * \param address EEPROM address to start reading from.
+  * \param length The number of bytes to read.
+  * \return See #NonVolatileReturnEnum for return values.
+  */
+static NonVolatileReturn iapReadEEPROM(uint8_t *data, uint32_t address, uint32_t length)
+{
+	iap_command[0] = 62; // IAP command code for "Read EEPROM"
+	iap_command[1] = address; // EEPROM address
+	iap_command[2] = (uint32_t)data; // RAM address
+	iap_command[3] = length; // number of bytes to be read
+	iap_command[4] = 48000; // system clock frequency in kHz
+	iapEntry(iap_command, iap_result);
+	if (iap_result[0] == 0)
+	{
+		return NV_NO_ERROR;
+	}
+	else
+	{
+		return NV_IO_ERROR;
+	}
+}
+
+/** Write directly to the EEPROM using the IAP "Write EEPROM" command.
+  * \param data A pointer to the data to be written.
+  * \param address EEPROM address to start writing to.
+  * \param length The number of bytes to write.
+  * \return See #NonVolatileReturnEnum for return values.
+  */
+static NonVolatileReturn iapWriteEEPROM(uint8_t *data, uint32_t address, uint32_t length)
+{
 	iap_command[0] = 61; // IAP command code for "Write EEPROM"
 	iap_command[1] = address; // EEPROM address
 	iap_command[2] = (uint32_t)data; // RAM address
@@ -68,36 +176,163 @@ NonVolatileReturn nonVolatileWrite(uint8_t *data, uint32_t address, uint32_t len
 	}
 }
 
+/** Make #page_buffer hold the EEPROM page which contains an address,
+  * writing back the page which was previously buffered if it was modified.
+  * \param address The EEPROM address. It doesn't need to be page-aligned.
+  * \return See #NonVolatileReturnEnum for return values.
+  */
+static NonVolatileReturn loadPageBuffer(uint32_t address)
+{
+	NonVolatileReturn r;
+
+	address -= address % EEPROM_PAGE_SIZE;
+	if (page_buffer_valid && (page_buffer_address == address))
+	{
+		diagnosticsNVEvent(DIAGNOSTICS_NV_CACHE_HIT);
+		return NV_NO_ERROR;
+	}
+	diagnosticsNVEvent(DIAGNOSTICS_NV_CACHE_MISS);
+	r = nonVolatileFlush();
+	if (r != NV_NO_ERROR)
+	{
+		return r;
+	}
+	page_buffer_valid = false;
+	r = iapReadEEPROM(page_buffer, address, EEPROM_PAGE_SIZE);
+	if (r != NV_NO_ERROR)
+	{
+		return r;
+	}
+	page_buffer_address = address;
+	page_buffer_valid = true;
+	return NV_NO_ERROR;
+}
+
+/** Write to non-volatile storage. All platform-independent code assumes that
+  * non-volatile memory acts like NOR flash/EEPROM: arbitrary bits may be
+  * reset from 1 to 0 ("programmed") in any order, but setting bits
+  * from 0 to 1 ("erasing") is very expensive.
+  * \param data A pointer to the data to be written.
+  * \param partition The partition to write to. Must be one of #NVPartitions.
+  * \param address Byte offset specifying where in the partition to
+  *                start writing to.
+  * \param length The number of bytes to write.
+  * \return See #NonVolatileReturnEnum for return values.
+  * \warning Writes may be buffered; use nonVolatileFlush() to be sure that
+  *          data is actually written to non-volatile storage.
+  */
+NonVolatileReturn nonVolatileWrite(uint8_t *data, NVPartitions partition, uint32_t address, uint32_t length)
+{
+	uint32_t offset;
+	uint32_t chunk_length;
+	NonVolatileReturn r;
+
+	r = checkAndTweakAddress(&address, partition, length);
+	if (r != NV_NO_ERROR)
+	{
+		return r;
+	}
+	while (length > 0)
+	{
+		r = loadPageBuffer(address);
+		if (r != NV_NO_ERROR)
+		{
+			return r;
+		}
+		offset = address % EEPROM_PAGE_SIZE;
+		chunk_length = MIN(EEPROM_PAGE_SIZE - offset, length);
+		memcpy(&(page_buffer[offset]), data, chunk_length);
+		page_buffer_dirty = true;
+		data += chunk_length;
+		address += chunk_length;
+		length -= chunk_length;
+	}
+	diagnosticsNVEvent(DIAGNOSTICS_NV_WRITE);
+	return NV_NO_ERROR;
+}
+
+/** Fill an area of non-volatile storage with a single byte value. This has
+  * the same effect as calling nonVolatileWrite() with a buffer filled
+  * with value.
+  * \param partition The partition to fill. Must be one of #NVPartitions.
+  * \param address Byte offset specifying where in the partition to
+  *                start filling.
+  * \param length The number of bytes to fill.
+  * \param value The byte value to fill the area with.
+  * \return See #NonVolatileReturnEnum for return values.
+  * \warning Like nonVolatileWrite(), this is buffered; use
+  *          nonVolatileFlush() to be sure that the area is actually
+  *          overwritten.
+  */
+NonVolatileReturn nonVolatileFill(NVPartitions partition, uint32_t address, uint32_t length, uint8_t value)
+{
+	uint32_t offset;
+	uint32_t chunk_length;
+	NonVolatileReturn r;
+
+	r = checkAndTweakAddress(&address, partition, length);
+	if (r != NV_NO_ERROR)
+	{
+		return r;
+	}
+	while (length > 0)
+	{
+		r = loadPageBuffer(address);
+		if (r != NV_NO_ERROR)
+		{
+			return r;
+		}
+		offset = address % EEPROM_PAGE_SIZE;
+		chunk_length = MIN(EEPROM_PAGE_SIZE - offset, length);
+		memset(&(page_buffer[offset]), value, chunk_length);
+		page_buffer_dirty = true;
+		address += chunk_length;
+		length -= chunk_length;
+	}
+	diagnosticsNVEvent(DIAGNOSTICS_NV_WRITE);
+	return NV_NO_ERROR;
+}
+
 /** Read from non-volatile storage.
   * \param data A pointer to the buffer which will receive the data.
-  * \param address Byte offset specifying where in non-volatile storage to
+  * \param partition The partition to read from. Must be one of #NVPartitions.
+  * \param address Byte offset specifying where in the partition to
   *                start reading from.
   * \param length The number of bytes to read.
   * \return See #NonVolatileReturnEnum for return values.
   */
-NonVolatileReturn nonVolatileRead(uint8_t *data, uint32_t address, uint32_t length)
+NonVolatileReturn nonVolatileRead(uint8_t *data, NVPartitions partition, uint32_t address, uint32_t length)
 {
-	// Since EEPROM_SIZE is much smaller than 2 ^ 32, address + length cannot
-	// overflow.
-	if ((address > EEPROM_SIZE) || (length > EEPROM_SIZE)
-		|| ((address + length) > EEPROM_SIZE))
+	uint32_t start;
+	uint32_t end; // exclusive
+	NonVolatileReturn r;
+
+	r = checkAndTweakAddress(&address, partition, length);
+	if (r != NV_NO_ERROR)
 	{
-		return NV_INVALID_ADDRESS;
+		return r;
 	}
-	iap_command[0] = 62; // IAP command code for "Read EEPROM"
-	iap_command[1] = address; // EEPROM address
-	iap_command[2] = (uint32_t)data; // RAM address
-	iap_command[3] = length; // number of bytes to be read
-	iap_command[4] = 48000; // system clock frequency in kHz
-	iapEntry(iap_command, iap_result);
-	if (iap_result[0] == 0)
+	if (length == 0)
 	{
 		return NV_NO_ERROR;
 	}
-	else
+	r = iapReadEEPROM(data, address, length);
+	if (r != NV_NO_ERROR)
 	{
-		return NV_IO_ERROR;
+		return r;
 	}
+	// Uncommitted writes in the page buffer override what's in the EEPROM.
+	if (page_buffer_valid)
+	{
+		start = MAX(address, page_buffer_address);
+		end = MIN(address + length, page_buffer_address + EEPROM_PAGE_SIZE);
+		if (start < end)
+		{
+			memcpy(&(data[start - address]), &(page_buffer[start - page_buffer_address]), end - start);
+		}
+	}
+	diagnosticsNVEvent(DIAGNOSTICS_NV_READ);
+	return NV_NO_ERROR;
 }
 
 /** Ensure that all buffered writes are committed to non-volatile storage.
@@ -105,6 +340,20 @@ NonVolatileReturn nonVolatileRead(uint8_t *data, uint32_t address, uint32_t leng
   */
 NonVolatileReturn nonVolatileFlush(void)
 {
-	// Nothing to do; writes are never buffered.
-	return NV_NO_ERROR;
+	NonVolatileReturn r;
+
+	r = NV_NO_ERROR;
+	diagnosticsBeginNVFlush();
+	if (page_buffer_valid && page_buffer_dirty)
+	{
+		// Each IAP "Write EEPROM" call erases and programs the page.
+		diagnosticsNVEvent(DIAGNOSTICS_NV_ERASE);
+		r = iapWriteEEPROM(page_buffer, page_buffer_address, EEPROM_PAGE_SIZE);
+		if (r == NV_NO_ERROR)
+		{
+			page_buffer_dirty = false;
+		}
+	}
+	diagnosticsEndNVFlush();
+	return r;
 }
@@ -14,12 +14,19 @@
 // This also shows how much time (in clock cycles) each FFT required; this
 // is useful for benchmarking.
 //
+// If run with "batch" (see the usage message), this instead tests thousands
+// of pseudo-random vectors whose expected results are calculated on the host,
+// and reports the distribution of errors. This is the quickest way to
+// qualify a change to fft.c.
+//
 // This file is licensed as described by the file LICENCE.
 
 #include <stdlib.h>
 #include <stdio.h>
 #include <math.h>
 #include <string.h>
+#include <time.h>
+#include <pthread.h>
 
 #include <unistd.h>
 #include <fcntl.h>
@@ -360,7 +367,9 @@ static double getStandardDeviation(Complex *array, uint32_t size, int is_imag)
 // each value, and also checks the total relative error.
 // Returns 1 if all tests pass ("they are equal within error tolerance"), 0 if
 // at least one test failed ("they are not equal within error tolerance").
-int complexArraysEqualWithinTolerance(Complex *target, Complex *value, uint32_t size)
+// If verbose is non-zero, this also prints the first mismatch and the total
+// relative error.
+int complexArraysEqualWithinTolerance(Complex *target, Complex *value, uint32_t size, int verbose)
 {
 	uint32_t i;
 	double error_sum;
@@ -376,12 +385,18 @@ int complexArraysEqualWithinTolerance(Complex *target, Complex *value, uint32_t
 	{
 		if (!equalWithinTolerance(target[i].real, value[i].real, target_stdev_real * ERROR_FACTOR))
 		{
-			printf("%d.real mismatch: target = %g, value = %g ", i, target[i].real, value[i].real);
+			if (verbose)
+			{
+				printf("%d.real mismatch: target = %g, value = %g ", i, target[i].real, value[i].real);
+			}
 			return 0;
 		}
 		if (!equalWithinTolerance(target[i].imag, value[i].imag, target_stdev_imag * ERROR_FACTOR))
 		{
-			printf("%d.imag mismatch: target = %g, value = %g ", i, target[i].imag, value[i].imag);
+			if (verbose)
+			{
+				printf("%d.imag mismatch: target = %g, value = %g ", i, target[i].imag, value[i].imag);
+			}
 			return 0;
 		}
 		error_sum += fabs(target[i].real - value[i].real);
@@ -393,7 +408,10 @@ int complexArraysEqualWithinTolerance(Complex *target, Complex *value, uint32_t
 	{
 		error_sum /= target_size;
 	}
-	printf("err: %lg ", error_sum);
+	if (verbose)
+	{
+		printf("err: %lg ", error_sum);
+	}
 	if (error_sum > SUM_ERROR_THRESHOLD)
 	{
 		return 0;
@@ -404,6 +422,688 @@ int complexArraysEqualWithinTolerance(Complex *target, Complex *value, uint32_t
 	}
 }
 
+// Batch regression mode. Instead of reading test vectors from
+// fft_test_vectors.txt, this generates pseudo-random vectors (like the
+// "pseudo-random" ones at the end of generate_test_vectors.m) and computes
+// their expected results on the host, using a double-precision reference
+// FFT. Worker threads prepare upcoming vectors and check returned results
+// while the main thread is busy talking to the device, so the device never
+// waits for the host. At the end, the distribution of errors is reported for
+// each of the 4 kinds of FFT the device does.
+
+// Default number of worker threads used in batch mode.
+#define DEFAULT_BATCH_THREADS		4
+// Number of vectors which can be in flight (being prepared, waiting to be
+// sent, in the device or being checked) at once in batch mode.
+#define BATCH_QUEUE_SIZE			64
+// Number of buckets in the histogram of relative RMS errors. The first
+// bucket counts errors below 1e-7, each following bucket covers one decade
+// and the last bucket counts errors of 0.1 or more.
+#define ERROR_HISTOGRAM_BUCKETS		8
+
+// States of an entry in batch_slots.
+typedef enum BatchSlotStateEnum
+{
+	// Free for a worker to prepare the next vector in.
+	SLOT_EMPTY,
+	// A worker is generating the vector and its expected result.
+	SLOT_PREPARING,
+	// Waiting for the main thread to send the vector to the device.
+	SLOT_READY,
+	// The main thread is exchanging the vector with the device.
+	SLOT_IN_DEVICE,
+	// The device's output has been received; waiting for a worker to check it.
+	SLOT_RECEIVED,
+	// A worker is comparing the device's output with the expected result.
+	SLOT_CHECKING
+} BatchSlotState;
+
+// One vector in batch mode. The kind of FFT is determined by index, because
+// the device always cycles through forward normal-sized, inverse
+// normal-sized, forward double-sized and inverse double-sized FFTs.
+typedef struct BatchSlot_struct
+{
+	// Which vector (counting from 0) this is.
+	uint32_t index;
+	// What is happening to this vector.
+	BatchSlotState state;
+	// Input for normal-sized FFTs.
+	Complex input_normal[FFT_SIZE];
+	// Input for double-sized FFTs.
+	double input_double[FFT_SIZE * 2];
+	// Expected output (only the first FFT_SIZE entries are used for
+	// normal-sized FFTs).
+	Complex expected[FFT_SIZE + 1];
+	// Output received from the device.
+	Complex output[FFT_SIZE + 1];
+	// Number of cycles the device took.
+	uint32_t cycles;
+} BatchSlot;
+
+// Accumulated results for one of the 4 kinds of FFT in batch mode.
+typedef struct BatchStatistics_struct
+{
+	// Number of vectors tested.
+	uint32_t count;
+	// Number of vectors which failed (including device errors).
+	uint32_t failed;
+	// Number of vectors for which the device reported an arithmetic error.
+	uint32_t device_errors;
+	// Sum of cycle counts, for calculating the mean.
+	double cycles_sum;
+	// Largest total relative error (see complexArraysEqualWithinTolerance()).
+	double worst_total_error;
+	// Vector which had the largest total relative error.
+	uint32_t worst_total_error_index;
+	// Sum of squares of total relative errors.
+	double total_error_square_sum;
+	// Largest relative RMS error, where relative RMS error is the RMS of
+	// the error divided by the RMS of the expected output.
+	double worst_rms_error;
+	// Sum of squares of relative RMS errors.
+	double rms_error_square_sum;
+	// Largest absolute error of any single value.
+	double worst_absolute_error;
+	// Histogram of relative RMS errors (see ERROR_HISTOGRAM_BUCKETS).
+	uint32_t histogram[ERROR_HISTOGRAM_BUCKETS];
+} BatchStatistics;
+
+// Names of the 4 kinds of FFT, in the order the device does them.
+static const char *batch_type_names[4] = {
+	"forward, normal-sized",
+	"inverse, normal-sized",
+	"forward, double-sized",
+	"inverse, double-sized"};
+
+// Twiddle factors for referenceFFT(). Those for the stage which combines
+// transforms of size half are at [half, 2 * half), so that the inner loop of
+// referenceFFT() reads them (and the data) sequentially, which lets the
+// compiler vectorise it.
+static double twiddle_real[FFT_SIZE * 2];
+static double twiddle_imag[FFT_SIZE * 2];
+
+// Vectors in flight; vector n uses batch_slots[n % BATCH_QUEUE_SIZE].
+static BatchSlot batch_slots[BATCH_QUEUE_SIZE];
+// Total number of vectors to test in batch mode.
+static uint32_t batch_count;
+// Seed for the pseudo-random vectors.
+static uint32_t batch_seed;
+// Next vector for a worker to prepare.
+static uint32_t next_prepare;
+// Next vector for a worker to check.
+static uint32_t next_check;
+// Results so far, for each of the 4 kinds of FFT.
+static BatchStatistics batch_statistics[4];
+// Protects everything above except the contents of slots which are being
+// prepared, exchanged with the device or checked.
+static pthread_mutex_t batch_mutex = PTHREAD_MUTEX_INITIALIZER;
+// Signalled whenever the state of a slot changes.
+static pthread_cond_t batch_cond = PTHREAD_COND_INITIALIZER;
+
+// Fill the twiddle factor tables used by referenceFFT().
+static void initReferenceFFT(void)
+{
+	uint32_t half;
+	uint32_t j;
+
+	for (half = 1; half < (FFT_SIZE * 2); half <<= 1)
+	{
+		for (j = 0; j < half; j++)
+		{
+			twiddle_real[half + j] = cos(-M_PI * (double)j / (double)half);
+			twiddle_imag[half + j] = sin(-M_PI * (double)j / (double)half);
+		}
+	}
+}
+
+// Compute, in double precision, the FFT of the size complex numbers whose
+// real and imaginary components are in the arrays real and imag. size must
+// be a power of 2 no larger than FFT_SIZE * 2. Like GNU Octave's ifft(), the
+// inverse FFT is scaled by 1 / size.
+static void referenceFFT(double *real, double *imag, uint32_t size, int is_inverse)
+{
+	uint32_t i;
+	uint32_t j;
+	uint32_t k;
+	uint32_t bit;
+	uint32_t half;
+	double sign;
+	double temp;
+	double product_real;
+	double product_imag;
+	double scale;
+	double *restrict a_real;
+	double *restrict a_imag;
+	double *restrict b_real;
+	double *restrict b_imag;
+	const double *restrict w_real;
+	const double *restrict w_imag;
+
+	// Bit-reversal permutation.
+	j = 0;
+	for (i = 1; i < size; i++)
+	{
+		for (bit = size >> 1; j & bit; bit >>= 1)
+		{
+			j ^= bit;
+		}
+		j ^= bit;
+		if (i < j)
+		{
+			temp = real[i];
+			real[i] = real[j];
+			real[j] = temp;
+			temp = imag[i];
+			imag[i] = imag[j];
+			imag[j] = temp;
+		}
+	}
+
+	// Radix-2 butterflies.
+	sign = is_inverse ? -1.0 : 1.0;
+	for (half = 1; half < size; half <<= 1)
+	{
+		w_real = &(twiddle_real[half]);
+		w_imag = &(twiddle_imag[half]);
+		for (k = 0; k < size; k += (half * 2))
+		{
+			a_real = &(real[k]);
+			a_imag = &(imag[k]);
+			b_real = &(real[k + half]);
+			b_imag = &(imag[k + half]);
+			for (j = 0; j < half; j++)
+			{
+				product_real = b_real[j] * w_real[j] - b_imag[j] * sign * w_imag[j];
+				product_imag = b_real[j] * sign * w_imag[j] + b_imag[j] * w_real[j];
+				b_real[j] = a_real[j] - product_real;
+				b_imag[j] = a_imag[j] - product_imag;
+				a_real[j] += product_real;
+				a_imag[j] += product_imag;
+			}
+		}
+	}
+
+	if (is_inverse)
+	{
+		scale = 1.0 / (double)size;
+		for (i = 0; i < size; i++)
+		{
+			real[i] *= scale;
+			imag[i] *= scale;
+		}
+	}
+}
+
+// Get the next output of a xorshift64* generator. Each vector has its own
+// generator, so that the vectors don't depend on which thread prepared them.
+static uint64_t nextRandom(uint64_t *state)
+{
+	uint64_t x;
+
+	x = *state;
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	*state = x;
+	return x * 2685821657736338717ULL;
+}
+
+// Get a pseudo-random number uniformly distributed in (0, 1).
+static double uniformRandom(uint64_t *state)
+{
+	return ((double)(nextRandom(state) >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+}
+
+// Get a pseudo-random number from a standard normal distribution.
+static double gaussianRandom(uint64_t *state)
+{
+	double u1;
+	double u2;
+
+	u1 = uniformRandom(state);
+	u2 = uniformRandom(state);
+	return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+// Round value to the nearest fix16_t, so that the reference FFT sees exactly
+// what the device sees.
+static double quantise(double value)
+{
+	return fix16_to_dbl(fix16_from_dbl(value));
+}
+
+// Generate vector number index and its expected result in slot. The
+// amplitude of the noise is chosen log-uniformly from the same range
+// (0.01 to 25) that generate_test_vectors.m sweeps.
+static void prepareVector(BatchSlot *slot, uint32_t index)
+{
+	uint64_t state;
+	uint32_t i;
+	uint32_t type;
+	double stdev;
+	double scale;
+	double real[FFT_SIZE * 2];
+	double imag[FFT_SIZE * 2];
+
+	// splitmix64 finaliser, to spread the seed and index over all bits.
+	state = ((uint64_t)batch_seed << 32) | index;
+	state = (state ^ (state >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	state = (state ^ (state >> 27)) * 0x94d049bb133111ebULL;
+	state ^= state >> 31;
+	if (state == 0)
+	{
+		state = 1;
+	}
+
+	slot->index = index;
+	type = index & 3;
+	stdev = 0.01 * pow(2500.0, uniformRandom(&state));
+	if (type < 2)
+	{
+		for (i = 0; i < FFT_SIZE; i++)
+		{
+			real[i] = gaussianRandom(&state) * stdev;
+			imag[i] = gaussianRandom(&state) * stdev;
+		}
+		if (type == 1)
+		{
+			// Like generate_test_vectors.m, the input to the inverse FFT
+			// is the spectrum of noise.
+			referenceFFT(real, imag, FFT_SIZE, 0);
+		}
+		for (i = 0; i < FFT_SIZE; i++)
+		{
+			real[i] = quantise(real[i]);
+			imag[i] = quantise(imag[i]);
+			slot->input_normal[i].real = real[i];
+			slot->input_normal[i].imag = imag[i];
+		}
+		referenceFFT(real, imag, FFT_SIZE, type == 1);
+		for (i = 0; i < FFT_SIZE; i++)
+		{
+			slot->expected[i].real = real[i];
+			slot->expected[i].imag = imag[i];
+		}
+	}
+	else
+	{
+		if (type == 2)
+		{
+			scale = stdev;
+		}
+		else
+		{
+			// Don't let the input get too large or overflow will occur.
+			scale = stdev * 50.0;
+			if (scale > 250.0)
+			{
+				scale = 250.0;
+			}
+		}
+		for (i = 0; i < (FFT_SIZE * 2); i++)
+		{
+			real[i] = quantise(gaussianRandom(&state) * scale);
+			imag[i] = 0.0;
+			slot->input_double[i] = real[i];
+		}
+		referenceFFT(real, imag, FFT_SIZE * 2, type == 3);
+		for (i = 0; i < (FFT_SIZE + 1); i++)
+		{
+			slot->expected[i].real = real[i];
+			slot->expected[i].imag = imag[i];
+		}
+	}
+}
+
+// Compare the device's output in slot with the expected result and add the
+// outcome to statistics. statistics must not be shared with other threads
+// while this is running.
+static void checkVector(BatchSlot *slot, BatchStatistics *statistics)
+{
+	uint32_t i;
+	uint32_t size;
+	int bucket;
+	double error_real;
+	double error_imag;
+	double error_sum;
+	double error_square_sum;
+	double target_sum;
+	double target_square_sum;
+	double total_error;
+	double rms_error;
+
+	size = ((slot->index & 3) < 2) ? FFT_SIZE : (FFT_SIZE + 1);
+	statistics->count++;
+	statistics->cycles_sum += (double)slot->cycles;
+	if (isComplexArrayError(slot->output, size))
+	{
+		statistics->failed++;
+		statistics->device_errors++;
+		return;
+	}
+	if (!complexArraysEqualWithinTolerance(slot->expected, slot->output, size, 0))
+	{
+		statistics->failed++;
+	}
+
+	error_sum = 0.0;
+	error_square_sum = 0.0;
+	target_sum = 0.0;
+	target_square_sum = 0.0;
+	for (i = 0; i < size; i++)
+	{
+		error_real = fabs(slot->expected[i].real - slot->output[i].real);
+		error_imag = fabs(slot->expected[i].imag - slot->output[i].imag);
+		if (error_real > statistics->worst_absolute_error)
+		{
+			statistics->worst_absolute_error = error_real;
+		}
+		if (error_imag > statistics->worst_absolute_error)
+		{
+			statistics->worst_absolute_error = error_imag;
+		}
+		error_sum += error_real + error_imag;
+		error_square_sum += error_real * error_real + error_imag * error_imag;
+		target_sum += fabs(slot->expected[i].real) + fabs(slot->expected[i].imag);
+		target_square_sum += slot->expected[i].real * slot->expected[i].real
+			+ slot->expected[i].imag * slot->expected[i].imag;
+	}
+	total_error = (target_sum != 0.0) ? (error_sum / target_sum) : error_sum;
+	rms_error = (target_square_sum != 0.0) ? sqrt(error_square_sum / target_square_sum) : sqrt(error_square_sum);
+
+	if (total_error > statistics->worst_total_error)
+	{
+		statistics->worst_total_error = total_error;
+		statistics->worst_total_error_index = slot->index;
+	}
+	statistics->total_error_square_sum += total_error * total_error;
+	if (rms_error > statistics->worst_rms_error)
+	{
+		statistics->worst_rms_error = rms_error;
+	}
+	statistics->rms_error_square_sum += rms_error * rms_error;
+	if (rms_error < 1e-7)
+	{
+		bucket = 0;
+	}
+	else
+	{
+		bucket = (int)floor(log10(rms_error)) + 8;
+		if (bucket >= ERROR_HISTOGRAM_BUCKETS)
+		{
+			bucket = ERROR_HISTOGRAM_BUCKETS - 1;
+		}
+	}
+	statistics->histogram[bucket]++;
+}
+
+// Add the results in from to the results in to.
+static void mergeStatistics(BatchStatistics *to, BatchStatistics *from)
+{
+	int i;
+
+	to->count += from->count;
+	to->failed += from->failed;
+	to->device_errors += from->device_errors;
+	to->cycles_sum += from->cycles_sum;
+	if (from->worst_total_error > to->worst_total_error)
+	{
+		to->worst_total_error = from->worst_total_error;
+		to->worst_total_error_index = from->worst_total_error_index;
+	}
+	to->total_error_square_sum += from->total_error_square_sum;
+	if (from->worst_rms_error > to->worst_rms_error)
+	{
+		to->worst_rms_error = from->worst_rms_error;
+	}
+	to->rms_error_square_sum += from->rms_error_square_sum;
+	if (from->worst_absolute_error > to->worst_absolute_error)
+	{
+		to->worst_absolute_error = from->worst_absolute_error;
+	}
+	for (i = 0; i < ERROR_HISTOGRAM_BUCKETS; i++)
+	{
+		to->histogram[i] += from->histogram[i];
+	}
+}
+
+// Worker thread for batch mode. This checks received vectors in preference
+// to preparing new ones, so that slots are recycled as soon as possible.
+static void *batchWorker(void *arg)
+{
+	BatchSlot *slot;
+	BatchStatistics result;
+	uint32_t index;
+
+	pthread_mutex_lock(&batch_mutex);
+	while (next_check < batch_count)
+	{
+		slot = &(batch_slots[next_check % BATCH_QUEUE_SIZE]);
+		if (slot->state == SLOT_RECEIVED)
+		{
+			slot->state = SLOT_CHECKING;
+			next_check++;
+			pthread_mutex_unlock(&batch_mutex);
+			memset(&result, 0, sizeof(result));
+			checkVector(slot, &result);
+			pthread_mutex_lock(&batch_mutex);
+			mergeStatistics(&(batch_statistics[slot->index & 3]), &result);
+			slot->state = SLOT_EMPTY;
+			pthread_cond_broadcast(&batch_cond);
+			continue;
+		}
+		slot = &(batch_slots[next_prepare % BATCH_QUEUE_SIZE]);
+		if ((next_prepare < batch_count) && (slot->state == SLOT_EMPTY))
+		{
+			slot->state = SLOT_PREPARING;
+			index = next_prepare;
+			next_prepare++;
+			pthread_mutex_unlock(&batch_mutex);
+			prepareVector(slot, index);
+			pthread_mutex_lock(&batch_mutex);
+			slot->state = SLOT_READY;
+			pthread_cond_broadcast(&batch_cond);
+			continue;
+		}
+		pthread_cond_wait(&batch_cond, &batch_mutex);
+	}
+	pthread_mutex_unlock(&batch_mutex);
+	return NULL;
+}
+
+// Print the results of batch mode.
+static void printBatchReport(uint32_t num_threads, double seconds)
+{
+	int i;
+	int type;
+	uint32_t failed;
+	BatchStatistics *s;
+
+	failed = 0;
+	for (type = 0; type < 4; type++)
+	{
+		s = &(batch_statistics[type]);
+		failed += s->failed;
+		printf("%s:\n", batch_type_names[type]);
+		printf("    vectors = %u, failed = %u, device errors = %u\n", s->count, s->failed, s->device_errors);
+		if (s->count == 0)
+		{
+			continue;
+		}
+		printf("    mean cycles = %.0f\n", s->cycles_sum / (double)s->count);
+		if (s->count == s->device_errors)
+		{
+			continue;
+		}
+		printf("    total relative error: worst = %lg (vector %u), RMS = %lg\n",
+			s->worst_total_error, s->worst_total_error_index,
+			sqrt(s->total_error_square_sum / (double)(s->count - s->device_errors)));
+		printf("    relative RMS error: worst = %lg, RMS = %lg\n",
+			s->worst_rms_error,
+			sqrt(s->rms_error_square_sum / (double)(s->count - s->device_errors)));
+		printf("    worst absolute error = %lg\n", s->worst_absolute_error);
+		printf("    relative RMS error histogram:");
+		for (i = 0; i < ERROR_HISTOGRAM_BUCKETS; i++)
+		{
+			if (i == 0)
+			{
+				printf(" <1e-7: %u", s->histogram[i]);
+			}
+			else if (i == (ERROR_HISTOGRAM_BUCKETS - 1))
+			{
+				printf(", >=1e-1: %u", s->histogram[i]);
+			}
+			else
+			{
+				printf(", 1e-%d to 1e-%d: %u", 8 - i, 7 - i, s->histogram[i]);
+			}
+		}
+		printf("\n");
+	}
+	printf("Tested %u vectors in %.1f seconds using %u threads (seed %u)\n", batch_count, seconds, num_threads, batch_seed);
+	printf("Tests which succeeded: %u\n", batch_count - failed);
+	printf("Tests which failed: %u\n", failed);
+}
+
+// Test count pseudo-random vectors (rounded up to a multiple of 4, so that
+// the device finishes in the same state it started in) using num_threads
+// worker threads. Returns 0 if every vector passed, 1 otherwise.
+static int runBatch(uint32_t count, uint32_t num_threads, uint32_t seed)
+{
+	uint32_t i;
+	uint32_t n;
+	uint32_t size;
+	uint32_t started;
+	uint32_t failed;
+	uint8_t cycles_buffer[4];
+	BatchSlot *slot;
+	pthread_t *threads;
+	struct timespec start_time;
+	struct timespec end_time;
+
+	batch_count = (count + 3) & ~3u;
+	batch_seed = seed;
+	initReferenceFFT();
+	threads = malloc(num_threads * sizeof(pthread_t));
+	if (threads == NULL)
+	{
+		printf("Could not allocate memory for threads\n");
+		exit(1);
+	}
+	started = 0;
+	for (i = 0; i < num_threads; i++)
+	{
+		if (pthread_create(&(threads[started]), NULL, &batchWorker, NULL) == 0)
+		{
+			started++;
+		}
+	}
+	if (started == 0)
+	{
+		printf("Could not start any worker threads\n");
+		exit(1);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start_time);
+	for (n = 0; n < batch_count; n++)
+	{
+		slot = &(batch_slots[n % BATCH_QUEUE_SIZE]);
+		pthread_mutex_lock(&batch_mutex);
+		while (slot->state != SLOT_READY)
+		{
+			pthread_cond_wait(&batch_cond, &batch_mutex);
+		}
+		slot->state = SLOT_IN_DEVICE;
+		pthread_mutex_unlock(&batch_mutex);
+
+		if ((n & 3) < 2)
+		{
+			size = FFT_SIZE;
+			sendComplexArray(slot->input_normal, FFT_SIZE);
+		}
+		else
+		{
+			size = FFT_SIZE + 1;
+			sendRealArray(slot->input_double, FFT_SIZE * 2);
+		}
+		receiveComplexArray(slot->output, size);
+		for (i = 0; i < 4; i++)
+		{
+			cycles_buffer[i] = receiveByte();
+		}
+		slot->cycles = readU32LittleEndian(cycles_buffer);
+
+		pthread_mutex_lock(&batch_mutex);
+		slot->state = SLOT_RECEIVED;
+		pthread_cond_broadcast(&batch_cond);
+		pthread_mutex_unlock(&batch_mutex);
+		if (((n + 1) % 1000) == 0)
+		{
+			fprintf(stderr, "%u/%u vectors\r", n + 1, batch_count);
+		}
+	}
+	if (batch_count >= 1000)
+	{
+		fprintf(stderr, "\n");
+	}
+	for (i = 0; i < started; i++)
+	{
+		pthread_join(threads[i], NULL);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end_time);
+	free(threads);
+
+	printBatchReport(started, (double)(end_time.tv_sec - start_time.tv_sec)
+		+ (double)(end_time.tv_nsec - start_time.tv_nsec) * 1e-9);
+	failed = 0;
+	for (i = 0; i < 4; i++)
+	{
+		failed += batch_statistics[i].failed;
+	}
+	return (failed != 0) ? 1 : 0;
+}
+
+// Parse one number from the command line into out. Returns 0 on success,
+// 1 if arg isn't a number or is out of range.
+static int parseBatchNumber(char *arg, uint32_t min, uint32_t *out)
+{
+	char *end;
+	unsigned long value;
+
+	value = strtoul(arg, &end, 10);
+	if ((*arg == '\0') || (*end != '\0') || (value < min) || (value > 0xffffffffUL))
+	{
+		return 1;
+	}
+	*out = (uint32_t)value;
+	return 0;
+}
+
+// Parse the arguments which follow "batch", which are
+// <count> [<threads>] [<seed>]. Returns 0 on success, 1 if they are invalid.
+static int parseBatchArguments(int num_args, char **args, uint32_t *out_count, uint32_t *out_threads, uint32_t *out_seed)
+{
+	*out_threads = DEFAULT_BATCH_THREADS;
+	*out_seed = 1;
+	if ((num_args < 1) || (num_args > 3))
+	{
+		return 1;
+	}
+	if (parseBatchNumber(args[0], 1, out_count))
+	{
+		return 1;
+	}
+	if ((num_args >= 2) && parseBatchNumber(args[1], 1, out_threads))
+	{
+		return 1;
+	}
+	if ((num_args >= 3) && parseBatchNumber(args[2], 0, out_seed))
+	{
+		return 1;
+	}
+	return 0;
+}
+
 int main(int argc, char **argv)
 {
 	int i;
@@ -422,14 +1122,20 @@ int main(int argc, char **argv)
 	Complex expected_double[FFT_SIZE + 1]; // expected output (double-sized)
 	Complex output_double[FFT_SIZE + 1]; // actual output (double-sized)
 	FILE *f_vectors; // file containing test vectors
+	uint32_t batch_vectors;
+	uint32_t batch_threads;
+	uint32_t seed;
+	int result;
 	struct termios options;
 	struct termios old_options;
 
-	if (argc != 2)
+	if ((argc < 2) || ((argc > 2) && ((strcmp(argv[2], "batch") != 0)
+		|| parseBatchArguments(argc - 3, &(argv[3]), &batch_vectors, &batch_threads, &seed))))
 	{
-		printf("Usage: %s <serial device>\n", argv[0]);
+		printf("Usage: %s <serial device> [batch <vectors> [<threads>] [<seed>]]\n", argv[0]);
 		printf("\n");
 		printf("Example: %s /dev/ttyUSB0\n", argv[0]);
+		printf("Example of batch mode: %s /dev/ttyUSB0 batch 10000 4\n", argv[0]);
 		exit(1);
 	}
 
@@ -462,6 +1168,14 @@ int main(int argc, char **argv)
 	rx_bytes_to_ack = DEFAULT_ACKNOWLEDGE_INTERVAL;
 	tx_bytes_to_ack = DEFAULT_ACKNOWLEDGE_INTERVAL;
 
+	if (argc > 2)
+	{
+		result = runBatch(batch_vectors, batch_threads, seed);
+		tcsetattr(fd_serial, TCSANOW, &old_options); // restore configuration
+		close(fd_serial);
+		exit(result);
+	}
+
 	// Attempt to open file containing test vectors.
 	f_vectors = fopen("fft_test_vectors.txt", "r");
 	if (f_vectors == NULL)
@@ -512,7 +1226,7 @@ int main(int argc, char **argv)
 				}
 				else
 				{
-					matches = complexArraysEqualWithinTolerance(expected_normal, output_normal, FFT_SIZE);
+					matches = complexArraysEqualWithinTolerance(expected_normal, output_normal, FFT_SIZE, 1);
 				}
 			}
 			else
@@ -529,7 +1243,7 @@ int main(int argc, char **argv)
 				}
 				else
 				{
-					matches = complexArraysEqualWithinTolerance(expected_double, output_double, FFT_SIZE + 1);
+					matches = complexArraysEqualWithinTolerance(expected_double, output_double, FFT_SIZE + 1, 1);
 				}
 			}
 			// Get number of cycles required to do FFT.
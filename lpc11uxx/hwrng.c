@@ -27,26 +27,16 @@
 #include "hwrng_limits.h"
 #include "adc.h"
 
+#include "../hwinterface.h"
+
 #ifdef TEST_STATISTICS
 #include "ssd1306.h"
 #include "../endian.h"
-#include "../hwinterface.h"
 #include "LPC11Uxx.h"
 
 static void reportStatistics(uint32_t tests_failed);
 static void reportFftResults(ComplexFixed *fft_buffer);
 
-// These are copies of some variables in histogramTestsFailed() and
-// fftTestsFailed() which are reported by reportStatistics().
-static fix16_t most_recent_mean;
-static fix16_t most_recent_variance;
-static fix16_t most_recent_kappa3;
-static fix16_t most_recent_kappa4;
-static int most_recent_max_bin;
-static int most_recent_bandwidth;
-static fix16_t most_recent_max_autocorrelation;
-static fix16_t most_recent_entropy_estimate;
-
 /** Set to non-zero to send statistical properties to stream. 1 = moment-based
   * statistical properties, 2 = power spectral density estimate, 3 = bandwidth
   * estimate, 4 = autocorrelation results, 5 = maximum autocorrelation value
@@ -64,6 +54,9 @@ static bool is_not_first_in_histogram;
 /** Number of samples in the sample buffer that hardwareRandom32Bytes() has
   * used up. */
 static uint32_t sample_buffer_consumed;
+/** Health and throughput statistics, as returned by getHWRNGHealth(). The
+  * statistical tests write their results directly into this. */
+static HWRNGHealth health;
 
 /** Obtains an estimate of the bandwidth of the HWRNG, based on the power
   * spectrum density estimate (see #psd_accumulator).
@@ -192,27 +185,22 @@ static NOINLINE uint32_t histogramTestsFailed(fix16_t *variance)
 	fix16_t entropy_estimate;
 
 	fix16_error_occurred = false;
-	mean = calculateCentralMoment(fix16_zero, 1);
-	*variance = calculateCentralMoment(mean, 2);
-	kappa3 = calculateCentralMoment(mean, 3);
-	kappa4 = calculateCentralMoment(mean, 4);
+	calculateMoments(&mean, variance, &kappa3, &kappa4);
 	moment_error_occurred = fix16_error_occurred;
 	fix16_error_occurred = false;
 	entropy_estimate = estimateEntropy();
 	entropy_error_occurred = fix16_error_occurred;
 
-#ifdef TEST_STATISTICS
-	most_recent_mean = mean;
-	most_recent_variance = *variance;
-	most_recent_kappa3 = kappa3;
-	most_recent_kappa4 = kappa4;
-	most_recent_entropy_estimate = entropy_estimate;
-#endif // #ifdef TEST_STATISTICS
+	health.mean = mean;
+	health.variance = *variance;
+	health.kappa3 = kappa3;
+	health.kappa4 = kappa4;
+	health.entropy_estimate = entropy_estimate;
 
 	tests_failed = 0;
 	// STATTEST_MIN_MEAN and STATTEST_MAX_MEAN are in ADC output numbers.
 	// To be comparable to mean, they need to be scaled and offset, just
-	// as samples are in updateIteratorCache().
+	// as samples are in scaleSample().
 	if (mean <= F16((STATTEST_MIN_MEAN - (HISTOGRAM_NUM_BINS / 2)) / SAMPLE_SCALE_DOWN))
 	{
 		tests_failed |= 1; // mean below minimum
@@ -298,10 +286,10 @@ static NOINLINE uint32_t fftTestsFailed(fix16_t variance)
 		// Report autocorrelation results.
 		reportFftResults(fft_buffer);
 	}
-	most_recent_max_bin = max_bin;
-	most_recent_bandwidth = bandwidth;
-	most_recent_max_autocorrelation = max_autocorrelation;
 #endif // #ifdef TEST_STATISTICS
+	health.max_bin = max_bin;
+	health.bandwidth = bandwidth;
+	health.max_autocorrelation = max_autocorrelation;
 
 	tests_failed = 0;
 	if (fix16_from_int(max_bin) < F16(PSD_MIN_PEAK * 2.0 * FFT_SIZE))
@@ -331,11 +319,46 @@ static NOINLINE uint32_t fftTestsFailed(fix16_t variance)
 	return tests_failed;
 }
 
+/** Work out how much entropy to credit for each sample of the series which
+  * was just tested, from its measured min-entropy (see
+  * estimateMinEntropy()) and bandwidth. This must be called after
+  * histogramTestsFailed() and fftTestsFailed(), while the histogram still
+  * describes that series. The result is limited to at most
+  * #MAX_ENTROPY_BITS_PER_SAMPLE, but it is never raised; if it's below
+  * #MIN_ENTROPY_BITS_PER_SAMPLE, the caller treats the series as failed.
+  * \return Entropy per sample, in bits.
+  */
+static fix16_t calculateEntropyPerSample(void)
+{
+	fix16_t entropy;
+
+	// The min-entropy is at most log2(SAMPLE_COUNT) bits and the bandwidth
+	// is at most FFT_SIZE bins (the Nyquist frequency), so this can't
+	// overflow.
+	entropy = (estimateMinEntropy() * health.bandwidth) / (FFT_SIZE * ENTROPY_DERATING_FACTOR);
+	if (entropy > F16(MAX_ENTROPY_BITS_PER_SAMPLE))
+	{
+		entropy = F16(MAX_ENTROPY_BITS_PER_SAMPLE);
+	}
+	return entropy;
+}
+
 /** Fill buffer with 32 random bytes from a hardware random number generator.
   * \param buffer The buffer to fill. This should have enough space for 32
   *               bytes.
+  *
+  * Samples are tested in series of #SAMPLE_COUNT, but each call only uses
+  * 16 of them. Samples are only credited once the series they belong to
+  * has passed every statistical test, so the call which completes a series
+  * is credited with the entropy measured for the whole series (see
+  * calculateEntropyPerSample()) and every other call is credited with
+  * nothing.
   * \return An estimate of the total number of bits (not bytes) of entropy in
-  *         the buffer.
+  *         the buffer, or a negative number if the statistical tests failed.
+  *         This may also return 0 to tell the caller that more samples are
+  *         needed in order to do any meaningful statistical testing. If this
+  *         returns 0, the caller should continue to call this until it
+  *         returns a non-zero value.
   */
 int hardwareRandom32Bytes(uint8_t *buffer)
 {
@@ -343,6 +366,11 @@ int hardwareRandom32Bytes(uint8_t *buffer)
 	uint32_t sample;
 	uint32_t tests_failed;
 	fix16_t variance;
+	fix16_t entropy_per_sample;
+#if defined(ENABLE_BENCHMARK) || defined(ENABLE_DIAGNOSTICS)
+	uint32_t wait_start;
+	uint32_t wait_ticks;
+#endif // #if defined(ENABLE_BENCHMARK) || defined(ENABLE_DIAGNOSTICS)
 
 	if (!is_not_first_in_histogram)
 	{
@@ -362,9 +390,24 @@ int hardwareRandom32Bytes(uint8_t *buffer)
 	if (sample_buffer_consumed == 0)
 	{
 		// Need to wait until next sample buffer has been filled.
-		while (!sample_buffer_full)
+		if (!sample_buffer_full)
 		{
-			// do nothing
+			health.blocked_calls++;
+#if defined(ENABLE_BENCHMARK) || defined(ENABLE_DIAGNOSTICS)
+			wait_start = getCycleCount();
+#endif // #if defined(ENABLE_BENCHMARK) || defined(ENABLE_DIAGNOSTICS)
+			while (!sample_buffer_full)
+			{
+				// do nothing
+			}
+#if defined(ENABLE_BENCHMARK) || defined(ENABLE_DIAGNOSTICS)
+			wait_ticks = getCycleCount() - wait_start;
+			health.blocked_ticks += wait_ticks;
+			if (wait_ticks > health.max_blocked_ticks)
+			{
+				health.max_blocked_ticks = wait_ticks;
+			}
+#endif // #if defined(ENABLE_BENCHMARK) || defined(ENABLE_DIAGNOSTICS)
 		}
 	}
 	// From here on, code can assume that a full, current sample buffer is
@@ -405,29 +448,49 @@ int hardwareRandom32Bytes(uint8_t *buffer)
 		is_not_first_in_histogram = false;
 		tests_failed = histogramTestsFailed(&variance);
 		tests_failed |= fftTestsFailed(variance);
+		entropy_per_sample = calculateEntropyPerSample();
+		if (entropy_per_sample < F16(MIN_ENTROPY_BITS_PER_SAMPLE))
+		{
+			tests_failed |= 128; // entropy per sample below minimum
+		}
+		health.has_statistics = true;
+		health.last_failed_tests = tests_failed;
+		health.arrays_tested++;
+		health.samples_tested += SAMPLE_COUNT;
 #ifdef TEST_STATISTICS
 		reportStatistics(tests_failed);
 #endif // #ifdef TEST_STATISTICS
 		if (tests_failed != 0)
 		{
+			health.arrays_failed++;
 			return -1; // statistical tests indicate HWRNG failure
 		}
-		// Why return 512 (bits)? This ensures that hardwareRandom32Bytes()
-		// will be called a minimum number of times per getRandom256() call,
-		// assuming an entropy safety factor of 2 in prandom.c.
-		// This is extremely conservative, given any reasonable value of
-		// SAMPLE_COUNT. For example, for a SAMPLE_COUNT of 4096, this
-		// probably underestimates the usable entropy by a factor of about 50.
-		return 512;
+		health.bytes_delivered += 32;
+		// Every sample in the series has now been tested, so all of them can
+		// be credited. Round down, so that a fraction of a bit is never
+		// overstated. At most #MAX_ENTROPY_BITS_PER_SAMPLE * #SAMPLE_COUNT
+		// bits are returned, which is well within what getRandom256() can
+		// add up.
+		return (int)((SAMPLE_COUNT * entropy_per_sample) >> 16);
 	}
 	else
 	{
 		// Indicate to caller that more samples are needed in order to do
 		// statistical tests.
+		health.bytes_delivered += 32;
 		return 0;
 	}
 }
 
+/** Get health and throughput statistics for the HWRNG.
+  * \param out_health The statistics will be written here.
+  *                   See #HWRNGHealthStruct.
+  */
+void getHWRNGHealth(HWRNGHealth *out_health)
+{
+	*out_health = health;
+}
+
 #ifdef TEST_STATISTICS
 
 /** Quick and dirty conversion of fix16 to string.
@@ -546,7 +609,7 @@ static void reportStatistics(uint32_t tests_failed)
 	if ((report_to_stream == 2) || (report_to_stream == 1) || (report_to_stream == 0))
 	{
 		// Report moment-based properties.
-		sprintFix16(buffer, most_recent_mean);
+		sprintFix16(buffer, health.mean);
 		writeStringToDisplay(buffer);
 		if (report_to_stream == 1)
 		{
@@ -554,7 +617,7 @@ static void reportStatistics(uint32_t tests_failed)
 			sendString(", ");
 		}
 		nextLine();
-		sprintFix16(buffer, most_recent_variance);
+		sprintFix16(buffer, health.variance);
 		writeStringToDisplay(buffer);
 		if (report_to_stream == 1)
 		{
@@ -562,7 +625,7 @@ static void reportStatistics(uint32_t tests_failed)
 			sendString(", ");
 		}
 		nextLine();
-		sprintFix16(buffer, most_recent_kappa3);
+		sprintFix16(buffer, health.kappa3);
 		writeStringToDisplay(buffer);
 		if (report_to_stream == 1)
 		{
@@ -570,7 +633,7 @@ static void reportStatistics(uint32_t tests_failed)
 			sendString(", ");
 		}
 		nextLine();
-		sprintFix16(buffer, most_recent_kappa4);
+		sprintFix16(buffer, health.kappa4);
 		writeStringToDisplay(buffer);
 		if (report_to_stream == 1)
 		{
@@ -595,12 +658,12 @@ static void reportStatistics(uint32_t tests_failed)
 	if (report_to_stream == 3)
 	{
 		// Report peak frequency and signal bandwidth estimate.
-		sprintFix16(buffer, fix16_from_int(most_recent_max_bin));
+		sprintFix16(buffer, fix16_from_int(health.max_bin));
 		writeStringToDisplay(buffer);
 		sendString(buffer);
 		sendString(", ");
 		nextLine();
-		sprintFix16(buffer, fix16_from_int(most_recent_bandwidth));
+		sprintFix16(buffer, fix16_from_int(health.bandwidth));
 		writeStringToDisplay(buffer);
 		sendString(buffer);
 		nextLine();
@@ -609,10 +672,10 @@ static void reportStatistics(uint32_t tests_failed)
 	if ((report_to_stream == 4) || (report_to_stream == 5))
 	{
 		// Report maximum autocorrelation value and entropy estimate.
-		sprintFix16(buffer, most_recent_variance);
+		sprintFix16(buffer, health.variance);
 		writeStringToDisplay(buffer);
 		nextLine();
-		sprintFix16(buffer, most_recent_max_autocorrelation);
+		sprintFix16(buffer, health.max_autocorrelation);
 		writeStringToDisplay(buffer);
 		if (report_to_stream == 5)
 		{
@@ -620,7 +683,7 @@ static void reportStatistics(uint32_t tests_failed)
 			sendString(", ");
 		}
 		nextLine();
-		sprintFix16(buffer, most_recent_entropy_estimate);
+		sprintFix16(buffer, health.entropy_estimate);
 		writeStringToDisplay(buffer);
 		if (report_to_stream == 5)
 		{
@@ -756,10 +819,7 @@ void testStatistics(void)
 			SysTick->LOAD = 0x00FFFFFF; // set timer reload to max
 			SysTick->CTRL = 5; // enable system tick timer, frequency = CPU
 
-			mean = calculateCentralMoment(fix16_zero, 1);
-			variance = calculateCentralMoment(mean, 2);
-			kappa3 = calculateCentralMoment(mean, 3);
-			kappa4 = calculateCentralMoment(mean, 4);
+			calculateMoments(&mean, &variance, &kappa3, &kappa4);
 			entropy_estimate = estimateEntropy();
 
 			cycles = SysTick->VAL; // read as soon as possible
@@ -9,12 +9,14 @@
 #include <stdbool.h>
 #include "LPC11Uxx.h"
 #include "usart.h"
+#include "usb_hid_stream.h"
 #include "serial_fifo.h"
 #include "ssd1306.h"
 #include "user_interface.h"
 #include "adc.h"
 #include "../hwinterface.h"
 #include "../stream_comm.h"
+#include "../diagnostics.h"
 
 #ifdef TEST_FFT
 #include "test_fft.h"
@@ -77,12 +79,70 @@ uint32_t getPBKDF2Iterations(void)
 	return 128;
 }
 
-#ifdef CHECK_STACK_USAGE
-#include "../endian.h"
+#if defined(ENABLE_BENCHMARK) || defined(ENABLE_DIAGNOSTICS)
+/** Number of times the system tick timer has wrapped around, multiplied
+  * by 2 ^ 24 (the period of the system tick timer). */
+static volatile uint32_t systick_wraps;
+
+/** Interrupt handler for the system tick timer, which is called whenever the
+  * timer wraps around. This extends the 24 bit system tick timer to the
+  * 32 bit counter that getCycleCount() returns. */
+void SysTick_Handler(void)
+{
+	systick_wraps += 0x01000000;
+}
+
+/** Start the system tick timer, so that getCycleCount() can be used. */
+static void initCycleCounter(void)
+{
+	SysTick->CTRL = 4; // disable system tick timer, frequency = CPU
+	SysTick->VAL = 0; // clear system tick timer
+	SysTick->LOAD = 0x00FFFFFF; // set timer reload to max
+	SysTick->CTRL = 7; // enable system tick timer and its interrupt
+}
+
+/** Get the number of CPU cycles since initCycleCounter() was called, modulo
+  * 2 ^ 32. This requires interrupts to be enabled.
+  * \return The current value of the cycle counter.
+  */
+uint32_t getCycleCount(void)
+{
+	uint32_t wraps;
+	uint32_t ticks;
+
+	// The system tick timer counts down. If it wraps around while it's
+	// being read, systick_wraps will change, so try again.
+	do
+	{
+		wraps = systick_wraps;
+		ticks = 0x00FFFFFF - SysTick->VAL;
+	} while (wraps != systick_wraps);
+	return wraps + ticks;
+}
+#endif // #if defined(ENABLE_BENCHMARK) || defined(ENABLE_DIAGNOSTICS)
+
+#if defined(CHECK_STACK_USAGE) || defined(ENABLE_DIAGNOSTICS)
 extern void *__stack_start;
 extern void *__stack_end;
+#endif // #if defined(CHECK_STACK_USAGE) || defined(ENABLE_DIAGNOSTICS)
+
+#ifdef CHECK_STACK_USAGE
+#include "../endian.h"
 #endif // #ifdef CHECK_STACK_USAGE
 
+#ifdef ENABLE_DIAGNOSTICS
+/** Get the region of RAM which is reserved for the stack. This is the .stack
+  * section in the linker script.
+  * \param out_bottom Will be set to the lowest address of the stack.
+  * \param out_top Will be set to one past the highest address of the stack.
+  */
+void getStackBounds(uint8_t **out_bottom, uint8_t **out_top)
+{
+	*out_bottom = (uint8_t *)&__stack_start;
+	*out_top = (uint8_t *)&__stack_end;
+}
+#endif // #ifdef ENABLE_DIAGNOSTICS
+
 /** Entry point. This is the first thing which is called after startup code.
   * This never returns. */
 int main(void)
@@ -98,12 +158,21 @@ int main(void)
 		*((uint8_t *)i) = 0xcc;
 	}
 #endif // #ifdef CHECK_STACK_USAGE
+	diagnosticsPaintStack();
 	initSystemClock();
+#ifdef USB_HID_TRANSPORT
+	initSerialFIFO();
+	initUSBHIDStream();
+#else
 	initUsart();
 	initSerialFIFO();
+#endif // #ifdef USB_HID_TRANSPORT
 	initSSD1306();
 	initUserInterface();
 	initADC();
+#if defined(ENABLE_BENCHMARK) || defined(ENABLE_DIAGNOSTICS)
+	initCycleCounter();
+#endif // #if defined(ENABLE_BENCHMARK) || defined(ENABLE_DIAGNOSTICS)
 
 	__enable_irq();
 
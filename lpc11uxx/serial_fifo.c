@@ -12,6 +12,12 @@
   * since storage is implemented as a circular queue. Instead, when a buffer
   * overflow is detected, streamError() is called.
   *
+  * The FIFO buffers are lock-free: the producer only ever modifies
+  * CircularBuffer#head and the consumer only ever modifies
+  * CircularBuffer#tail, so neither side needs to disable interrupts. If
+  * there are producers (or consumers) in more than one context, it's up to
+  * the caller to make sure they don't run at the same time.
+  *
   * The functions in this file don't actually interface with any
   * communications hardware. The interface of circular buffers to hardware
   * must be handled elsewhere.
@@ -27,34 +33,15 @@
 #include "../hwinterface.h"
 #include "../endian.h"
 
-/** Size of transmit buffer, in number of bytes. There isn't much to be
-  * gained from making this significantly larger.
-  * \warning This must be a power of 2.
-  * \warning This must be >= 16.
-  */
-#define TRANSMIT_BUFFER_SIZE	32
-/** Size of receive buffer, in number of bytes. There isn't much to be
-  * gained from making this significantly larger.
-  * \warning This must be a power of 2.
-  * \warning This must be >= 16.
-  */
-#define RECEIVE_BUFFER_SIZE		128
+#ifndef USB_HID_TRANSPORT
 /** Initial value for acknowledge counters. */
 #define INITIAL_ACKNOWLEDGE		16
-
-/** End address of USB RAM. Transmit and receive buffers are stored in
-  * USB RAM (instead of main RAM) to conserve main RAM. There is no security
-  * risk (even in the case of a severe hardware or software bug which allows
-  * the host to access USB RAM arbitrarily) in storing the buffers in USB RAM,
-  * since everything that goes in the transmit/receive buffers also travels
-  * over the USB link.
-  */
-#define USBRAM_END			((volatile uint8_t *)0x20004800)
+#endif // #ifndef USB_HID_TRANSPORT
 
 /** Storage for the transmit buffer.
   * \warning This is stored in USB RAM. See #USBRAM_END for more details.
   */
-static volatile uint8_t *transmit_buffer_storage = USBRAM_END - RECEIVE_BUFFER_SIZE - TRANSMIT_BUFFER_SIZE;
+static volatile uint8_t *transmit_buffer_storage = USBRAM_FIFO_START;
 /** Storage for the receive buffer.
   * \warning This is stored in USB RAM. See #USBRAM_END for more details.
   */
@@ -64,12 +51,14 @@ volatile CircularBuffer transmit_buffer;
 /** The receive buffer. */
 volatile CircularBuffer receive_buffer;
 
+#ifndef USB_HID_TRANSPORT
 /** Number of bytes which can be received until the next acknowledgement must
   * be sent. */
 static uint32_t receive_acknowledge;
 /** Number of bytes which can be sent before waiting for the next
   * acknowledgement to be received. */
 static uint32_t transmit_acknowledge;
+#endif // #ifndef USB_HID_TRANSPORT
 
 /** Initialise #transmit_buffer and #receive_buffer.
   * \warning This must be called after sanitising RAM, otherwise the storage
@@ -83,20 +72,28 @@ void initSerialFIFO(void)
 	memset((void *)receive_buffer_storage, 0xff, RECEIVE_BUFFER_SIZE); // just to be sure
 	memset((void *)transmit_buffer_storage, 0, TRANSMIT_BUFFER_SIZE);
 	memset((void *)receive_buffer_storage, 0, RECEIVE_BUFFER_SIZE);
-	transmit_buffer.next = 0;
-	transmit_buffer.remaining = 0;
+	transmit_buffer.head = 0;
+	transmit_buffer.tail = 0;
 	transmit_buffer.size = TRANSMIT_BUFFER_SIZE;
 	transmit_buffer.error_occurred = 0;
 	transmit_buffer.storage = transmit_buffer_storage;
-	receive_buffer.next = 0;
-	receive_buffer.remaining = 0;
+	receive_buffer.head = 0;
+	receive_buffer.tail = 0;
 	receive_buffer.size = RECEIVE_BUFFER_SIZE;
 	receive_buffer.error_occurred = 0;
 	receive_buffer.storage = receive_buffer_storage;
+#ifndef USB_HID_TRANSPORT
 	receive_acknowledge = INITIAL_ACKNOWLEDGE;
 	transmit_acknowledge = INITIAL_ACKNOWLEDGE;
+#endif // #ifndef USB_HID_TRANSPORT
 }
 
+/** Stop the compiler from moving memory accesses across this point. This is
+  * used to make sure that bytes are copied into or out of a buffer's storage
+  * before the new head or tail is published. No hardware barrier is needed,
+  * since the producer and consumer run on the same core. */
+#define COMPILER_BARRIER()	__asm__ __volatile__("" ::: "memory")
+
 /** Enter LPC11Uxx sleep mode to conserve power. */
 static void enterSleepMode(void)
 {
@@ -111,7 +108,7 @@ static void enterSleepMode(void)
   */
 bool isCircularBufferEmpty(volatile CircularBuffer *buffer)
 {
-	if (buffer->remaining == 0)
+	if (buffer->head == buffer->tail)
 	{
 		return true;
 	}
@@ -133,7 +130,9 @@ void circularBufferSignalError(volatile CircularBuffer *buffer)
   * read.
   * \param buffer The circular buffer to read from.
   * \param is_irq Use true if calling this from an interrupt
-  *               request handler, otherwise use false.
+  *               request handler, otherwise use false. Since reads are
+  *               lock-free, this doesn't actually change anything, but it's
+  *               kept so that callers document which context they're in.
   * \return The byte that was read from the buffer.
   */
 uint8_t circularBufferRead(volatile CircularBuffer *buffer, bool is_irq)
@@ -153,17 +152,8 @@ uint8_t circularBufferRead(volatile CircularBuffer *buffer, bool is_irq)
 			// do nothing
 		}
 	}
-	if (!is_irq)
-	{
-		__disable_irq();
-	}
-	r = buffer->storage[buffer->next];
-	buffer->remaining--;
-	buffer->next = (buffer->next + 1) & (buffer->size - 1);
-	if (!is_irq)
-	{
-		__enable_irq();
-	}
+	r = buffer->storage[buffer->tail & (buffer->size - 1)];
+	buffer->tail++;
 	return r;
 }
 
@@ -178,8 +168,6 @@ uint8_t circularBufferRead(volatile CircularBuffer *buffer, bool is_irq)
   */
 void circularBufferWrite(volatile CircularBuffer *buffer, uint8_t data, bool is_irq)
 {
-	uint32_t index;
-
 	if (!is_irq)
 	{
 		if (buffer->error_occurred)
@@ -192,7 +180,7 @@ void circularBufferWrite(volatile CircularBuffer *buffer, uint8_t data, bool is_
 			}
 		}
 	}
-	if (buffer->remaining == buffer->size)
+	if ((buffer->head - buffer->tail) == buffer->size)
 	{
 		// Buffer is full.
 		if (is_irq)
@@ -204,23 +192,160 @@ void circularBufferWrite(volatile CircularBuffer *buffer, uint8_t data, bool is_
 		}
 		else
 		{
-			while (buffer->remaining == buffer->size)
+			while ((buffer->head - buffer->tail) == buffer->size)
 			{
 				enterSleepMode();
 			}
 		}
 	}
-	if (!is_irq)
+	buffer->storage[buffer->head & (buffer->size - 1)] = data;
+	buffer->head++;
+}
+
+/** Read up to length bytes from a circular buffer. This will block until at
+  * least one byte can be read, then read as many bytes as are available (up
+  * to length). The bytes are copied out of the buffer's storage as (at most)
+  * two contiguous regions.
+  * \param buffer The circular buffer to read from.
+  * \param data The bytes that were read will be written here. This must
+  *             have space for length bytes.
+  * \param length The maximum number of bytes to read. This must be
+  *               non-zero.
+  * \return The number of bytes that were read from the buffer.
+  */
+uint32_t circularBufferReadBytes(volatile CircularBuffer *buffer, uint8_t *data, uint32_t length)
+{
+	uint32_t index;
+	uint32_t first;
+
+	while(isCircularBufferEmpty(buffer))
 	{
+		enterSleepMode();
+	}
+	if (buffer->error_occurred)
+	{
+		streamError();
 		__disable_irq();
+		while (true)
+		{
+			// do nothing
+		}
 	}
-	index = (buffer->next + buffer->remaining) & (buffer->size - 1);
-	buffer->storage[index] = data;
-	buffer->remaining++;
-	if (!is_irq)
+	length = MIN(length, buffer->head - buffer->tail);
+	index = buffer->tail & (buffer->size - 1);
+	first = MIN(length, buffer->size - index);
+	memcpy(data, (const void *)&(buffer->storage[index]), first);
+	memcpy(&(data[first]), (const void *)buffer->storage, length - first);
+	COMPILER_BARRIER();
+	buffer->tail += length;
+	return length;
+}
+
+/** Throw away up to length bytes from a circular buffer. This behaves like
+  * circularBufferReadBytes(), except that nothing is copied out of the
+  * buffer's storage; only the tail moves.
+  * \param buffer The circular buffer to discard bytes from.
+  * \param length The maximum number of bytes to discard. This must be
+  *               non-zero.
+  * \return The number of bytes that were discarded from the buffer.
+  */
+uint32_t circularBufferDiscardBytes(volatile CircularBuffer *buffer, uint32_t length)
+{
+	while(isCircularBufferEmpty(buffer))
+	{
+		enterSleepMode();
+	}
+	if (buffer->error_occurred)
+	{
+		streamError();
+		__disable_irq();
+		while (true)
+		{
+			// do nothing
+		}
+	}
+	length = MIN(length, buffer->head - buffer->tail);
+	COMPILER_BARRIER();
+	buffer->tail += length;
+	return length;
+}
+
+/** Write up to length bytes to a circular buffer. This will block until
+  * there is space for at least one byte, then write as many bytes as there
+  * is space for (up to length). The bytes are copied into the buffer's
+  * storage as (at most) two contiguous regions. Unlike
+  * circularBufferWrite(), this can't be called from an interrupt request
+  * handler.
+  * \param buffer The circular buffer to write to.
+  * \param data The bytes to write to the buffer.
+  * \param length The maximum number of bytes to write. This must be
+  *               non-zero.
+  * \return The number of bytes that were written to the buffer.
+  */
+uint32_t circularBufferWriteBytes(volatile CircularBuffer *buffer, const uint8_t *data, uint32_t length)
+{
+	uint32_t index;
+	uint32_t first;
+
+	if (buffer->error_occurred)
+	{
+		streamError();
+		__disable_irq();
+		while (true)
+		{
+			// do nothing
+		}
+	}
+	while ((buffer->head - buffer->tail) == buffer->size)
 	{
-		__enable_irq();
+		enterSleepMode();
 	}
+	length = MIN(length, buffer->size - (buffer->head - buffer->tail));
+	index = buffer->head & (buffer->size - 1);
+	first = MIN(length, buffer->size - index);
+	memcpy((void *)&(buffer->storage[index]), data, first);
+	memcpy((void *)buffer->storage, &(data[first]), length - first);
+	COMPILER_BARRIER();
+	buffer->head += length;
+	return length;
+}
+
+#ifndef USB_HID_TRANSPORT
+
+/** Send an acknowledgement to the other side, which says that it can send
+  * another #RECEIVE_BUFFER_SIZE bytes. This also resets
+  * #receive_acknowledge. */
+static void sendReceiveAcknowledge(void)
+{
+	uint8_t buffer[4];
+	uint32_t i;
+
+	receive_acknowledge = RECEIVE_BUFFER_SIZE;
+	writeU32LittleEndian(buffer, receive_acknowledge);
+	circularBufferWrite(&transmit_buffer, 0xff, false);
+	for (i = 0; i < 4; i++)
+	{
+		circularBufferWrite(&transmit_buffer, buffer[i], false);
+	}
+	serialSendNotify();
+}
+
+/** Wait for an acknowledgement from the other side, and use it to reset
+  * #transmit_acknowledge. */
+static void waitForTransmitAcknowledge(void)
+{
+	uint8_t buffer[4];
+	uint32_t i;
+
+	do
+	{
+		// do nothing
+	} while (circularBufferRead(&receive_buffer, false) != 0xff);
+	for (i = 0; i < 4; i++)
+	{
+		buffer[i] = circularBufferRead(&receive_buffer, false);
+	}
+	transmit_acknowledge = readU32LittleEndian(buffer);
 }
 
 /** Grab one byte from the communication stream. There is no way for this
@@ -249,22 +374,12 @@ void circularBufferWrite(volatile CircularBuffer *buffer, uint8_t data, bool is_
 uint8_t streamGetOneByte(void)
 {
 	uint8_t one_byte;
-	uint8_t buffer[4];
-	uint32_t i;
 
 	one_byte = circularBufferRead(&receive_buffer, false);
 	receive_acknowledge--;
 	if (receive_acknowledge == 0)
 	{
-		// Send acknowledgement to other side.
-		receive_acknowledge = RECEIVE_BUFFER_SIZE;
-		writeU32LittleEndian(buffer, receive_acknowledge);
-		circularBufferWrite(&transmit_buffer, 0xff, false);
-		for (i = 0; i < 4; i++)
-		{
-			circularBufferWrite(&transmit_buffer, buffer[i], false);
-		}
-		serialSendNotify();
+		sendReceiveAcknowledge();
 	}
 	return one_byte;
 }
@@ -281,27 +396,103 @@ uint8_t streamGetOneByte(void)
   */
 void streamPutOneByte(uint8_t one_byte)
 {
-	uint8_t buffer[4];
-	uint32_t i;
-
 	circularBufferWrite(&transmit_buffer, one_byte, false);
 	serialSendNotify();
 	transmit_acknowledge--;
 	if (transmit_acknowledge == 0)
 	{
 		// Need to wait for acknowledgement from other side.
-		do
+		waitForTransmitAcknowledge();
+	}
+}
+
+/** Grab a number of bytes from the communication stream. This behaves
+  * exactly like calling streamGetOneByte() length times, but bytes are
+  * removed from the receive buffer in chunks. Chunks never cross an
+  * acknowledgement boundary, so acknowledgements are sent at exactly the
+  * same points in the stream.
+  * \param buffer The received bytes will be written here. This must have
+  *               space for length bytes.
+  * \param length The number of bytes to receive.
+  */
+void streamGetBytes(uint8_t *buffer, uint32_t length)
+{
+	uint32_t count;
+
+	while (length > 0)
+	{
+		count = circularBufferReadBytes(&receive_buffer, buffer, MIN(length, receive_acknowledge));
+		buffer += count;
+		length -= count;
+		receive_acknowledge -= count;
+		if (receive_acknowledge == 0)
 		{
-			// do nothing
-		} while (circularBufferRead(&receive_buffer, false) != 0xff);
-		for (i = 0; i < 4; i++)
+			sendReceiveAcknowledge();
+		}
+	}
+}
+
+/** Throw away a number of bytes from the communication stream. This behaves
+  * exactly like streamGetBytes(), but bytes are dropped from the receive
+  * buffer without being copied anywhere. As in streamGetBytes(), spans
+  * never cross an acknowledgement boundary, so the other side is told
+  * there is room again as soon as it would be for real reads.
+  * \param length The number of bytes to throw away.
+  */
+void streamDiscardBytes(uint32_t length)
+{
+	uint32_t count;
+
+	while (length > 0)
+	{
+		count = circularBufferDiscardBytes(&receive_buffer, MIN(length, receive_acknowledge));
+		length -= count;
+		receive_acknowledge -= count;
+		if (receive_acknowledge == 0)
+		{
+			sendReceiveAcknowledge();
+		}
+	}
+}
+
+/** Send a number of bytes to the communication stream. This behaves exactly
+  * like calling streamPutOneByte() length times, but bytes are added to the
+  * transmit buffer in chunks. Chunks never cross an acknowledgement
+  * boundary, so flow control works in exactly the same way.
+  * \param buffer The bytes to send.
+  * \param length The number of bytes to send.
+  */
+void streamPutBytes(const uint8_t *buffer, uint32_t length)
+{
+	uint32_t count;
+
+	while (length > 0)
+	{
+		count = circularBufferWriteBytes(&transmit_buffer, buffer, MIN(length, transmit_acknowledge));
+		serialSendNotify();
+		buffer += count;
+		length -= count;
+		transmit_acknowledge -= count;
+		if (transmit_acknowledge == 0)
 		{
-			buffer[i] = circularBufferRead(&receive_buffer, false);
+			// Need to wait for acknowledgement from other side.
+			waitForTransmitAcknowledge();
 		}
-		transmit_acknowledge = readU32LittleEndian(buffer);
 	}
 }
 
+#endif // #ifndef USB_HID_TRANSPORT
+
+/** Check whether there is at least one byte in the receive buffer. Both
+  * transports fill #receive_buffer, so this works for either.
+  * \return true if streamGetOneByte() would return without waiting, false
+  *         otherwise.
+  */
+bool streamIsByteAvailable(void)
+{
+	return !isCircularBufferEmpty(&receive_buffer);
+}
+
 /** Beginning of BSS (zero-initialised) section. */
 extern void *__bss_start;
 
@@ -342,8 +533,10 @@ static NOINLINE void sanitiseRamInternal(void)
   */
 void sanitiseRam(void)
 {
+#ifndef USB_HID_TRANSPORT
 	uint32_t saved_receive_acknowledge;
 	uint32_t saved_transmit_acknowledge;
+#endif // #ifndef USB_HID_TRANSPORT
 
 	// Wait until transmit buffer is empty.
 	while (!isCircularBufferEmpty(&transmit_buffer))
@@ -354,10 +547,20 @@ void sanitiseRam(void)
 	// was called as a result of a "unload wallet" packet, since the host
 	// isn't supposed to send anything until it receives a response from
 	// here.
+	// eeprom.c buffers writes in RAM, so commit them before RAM is cleared.
+	// There's nothing useful to do if this fails.
+	nonVolatileFlush();
+#ifdef USB_HID_TRANSPORT
+	// The USB driver's state is in USB RAM, which isn't cleared, so the
+	// connection to the host survives this.
+	sanitiseRamInternal();
+	initSerialFIFO();
+#else
 	saved_receive_acknowledge = receive_acknowledge;
 	saved_transmit_acknowledge = transmit_acknowledge;
 	sanitiseRamInternal();
 	initSerialFIFO();
 	receive_acknowledge = saved_receive_acknowledge;
 	transmit_acknowledge = saved_transmit_acknowledge;
+#endif // #ifdef USB_HID_TRANSPORT
 }
@@ -10,13 +10,44 @@
 
 #include <stdbool.h>
 
+/** Size of transmit buffer, in number of bytes. There isn't much to be
+  * gained from making this significantly larger.
+  * \warning This must be a power of 2.
+  * \warning This must be >= 16.
+  */
+#define TRANSMIT_BUFFER_SIZE	32
+/** Size of receive buffer, in number of bytes. There isn't much to be
+  * gained from making this significantly larger.
+  * \warning This must be a power of 2.
+  * \warning This must be >= 16.
+  * \warning If USB_HID_TRANSPORT is defined, this must be >= 64, so that
+  *          a whole report can be received.
+  */
+#define RECEIVE_BUFFER_SIZE		128
+
+/** End address of USB RAM. Transmit and receive buffers are stored in
+  * USB RAM (instead of main RAM) to conserve main RAM. There is no security
+  * risk (even in the case of a severe hardware or software bug which allows
+  * the host to access USB RAM arbitrarily) in storing the buffers in USB RAM,
+  * since everything that goes in the transmit/receive buffers also travels
+  * over the USB link.
+  */
+#define USBRAM_END			((volatile uint8_t *)0x20004800)
+/** Start address of the part of USB RAM used for the transmit and receive
+  * buffers. USB RAM below this address is free for other uses (see
+  * usb_hid_stream.c). */
+#define USBRAM_FIFO_START	(USBRAM_END - RECEIVE_BUFFER_SIZE - TRANSMIT_BUFFER_SIZE)
+
 /** A circular buffer. */
 typedef struct CircularBufferStruct
 {
-	/** Index of the next element to remove. */
-	volatile uint32_t next;
-	/** Number of elements remaining in buffer. */
-	volatile uint32_t remaining;
+	/** Total number of elements ever written to the buffer (modulo 2 ^ 32).
+	  * Only the producer modifies this. */
+	volatile uint32_t head;
+	/** Total number of elements ever read from the buffer (modulo 2 ^ 32).
+	  * Only the consumer modifies this. The number of elements in the buffer
+	  * is head - tail. */
+	volatile uint32_t tail;
 	/** The maximum number of elements the buffer can store.
 	  * \warning This must be a power of 2.
 	  */
@@ -37,5 +68,8 @@ extern bool isCircularBufferEmpty(volatile CircularBuffer *buffer);
 extern void circularBufferSignalError(volatile CircularBuffer *buffer);
 extern uint8_t circularBufferRead(volatile CircularBuffer *buffer, bool is_irq);
 extern void circularBufferWrite(volatile CircularBuffer *buffer, uint8_t data, bool is_irq);
+extern uint32_t circularBufferReadBytes(volatile CircularBuffer *buffer, uint8_t *data, uint32_t length);
+extern uint32_t circularBufferDiscardBytes(volatile CircularBuffer *buffer, uint32_t length);
+extern uint32_t circularBufferWriteBytes(volatile CircularBuffer *buffer, const uint8_t *data, uint32_t length);
 
 #endif // #ifndef SERIAL_FIFO_H_INCLUDED
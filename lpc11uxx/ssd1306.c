@@ -39,9 +39,11 @@
 /** Maximum number of lines on screen. */
 #define NUMBER_OF_LINES		4
 
-/** Number of bits (or equivalently, total pixels) in #font_table that each
-  * character occupies. */
-#define CHARACTER_BITS	(CHARACTER_WIDTH * CHARACTER_HEIGHT)
+/** Number of bytes (pages) in #font_table that each column of a character
+  * occupies. */
+#define PAGES_PER_CHARACTER	((CHARACTER_HEIGHT + 7) / 8)
+/** Number of bytes in #font_table that each character occupies. */
+#define CHARACTER_BYTES		(CHARACTER_WIDTH * PAGES_PER_CHARACTER)
 
 /** The character encoding value that the font table begins at. Setting this
   * to a non-zero value saves space by not having to store the bitmaps for
@@ -50,19 +52,15 @@
 /** The character encoding value for a blank (all-zero bitmap) character. */
 #define FONT_BLANK			32
 
-/** Packed, vertical, monochrome bitmaps for each character.
+/** Page-aligned, vertical, monochrome bitmaps for each character.
   *
-  * The packed vertical bitmap can be interpreted as follows: imagine the font
-  * table as a single large little-endian multi-precision integer. Start
-  * with the least significant bit and move to more significant bits. The
-  * least significant bit represents the top-left pixel of the first glyph.
-  * For each increment in bit significance, move down to the next pixel. If
-  * you get to the bottom, move to the top of the next (towards the right)
-  * column. If you get to the bottom of the last column, move to the top-left
-  * pixel of the next glyph.
-  *
-  * Because of the way lookupFontTable() works, this table should have at
-  * least one extra 0 byte appended.
+  * Each character occupies #CHARACTER_BYTES bytes. Those bytes are organised
+  * as #CHARACTER_WIDTH columns (leftmost first), each of which has
+  * #PAGES_PER_CHARACTER bytes (topmost first). Within a byte, the least
+  * significant bit represents the topmost pixel. This matches the layout of
+  * SSD1306 GDDRAM, so that bytes can be copied straight to the display. If
+  * #CHARACTER_HEIGHT is not a multiple of 8, the last byte of every column
+  * is padded with 0 bits.
   *
   * Table generated from file "ter-u16b.bdf" using bdf_converter.
   * Font name: "-xos4-Terminus-Bold-R-Normal--16-160-72-72-C-80-ISO10646-1".
@@ -163,14 +161,19 @@ const uint8_t font_table[] = {
 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xfc, 0x0f, 0xfc, 0x0f, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
 0x00, 0x00, 0x04, 0x08, 0x04, 0x08, 0xbc, 0x0f, 0xf8, 0x07, 0x40, 0x00, 0x00, 0x00, 0x00, 0x00,
 0x0c, 0x00, 0x0e, 0x00, 0x02, 0x00, 0x06, 0x00, 0x0c, 0x00, 0x08, 0x00, 0x0e, 0x00, 0x06, 0x00,
-0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-0x00};
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
 
 /** Character buffer, in row-major order, starting from the top-left.
   * Characters should have their ASCII values written here.
   * renderDisplay() will render the contents of this buffer to the display.
   */
 static uint8_t text_buffer[CHARACTERS_PER_LINE * NUMBER_OF_LINES];
+/** What #text_buffer contained when it was last rendered, i.e. what is
+  * currently being shown on the display. renderDisplay() compares this
+  * with #text_buffer so that only character cells which have changed need to
+  * be re-rendered and sent to the display.
+  */
+static uint8_t rendered_buffer[CHARACTERS_PER_LINE * NUMBER_OF_LINES];
 /** The line where the (hidden) cursor is at. 0 = topmost. This is also the
   * line within #text_buffer that writeStringToDisplay() will write to next.
   */
@@ -302,49 +305,40 @@ static void resetSSD1306(void)
 	writeSPI1Byte(false, 0x01); // memory addressing mode = vertical
 }
 
-/** Clear the display and all associated buffers. */
-void clearDisplay(void)
-{
-	uint32_t i;
-
-	for (i = 0; i < 1024; i++)
-	{
-		writeSPI1Byte(true, 0);
-	}
-	cursor_line = 0;
-	cursor_pos = 0;
-	memset(text_buffer, FONT_BLANK, sizeof(text_buffer));
-}
-
-/** Set up everything so that the display is ready to start having text
-  * rendered on it. */
-void initSSD1306(void)
+/** Set the region of display GDDRAM that subsequent data bytes will be
+  * written to. Since the memory addressing mode is vertical (see
+  * resetSSD1306()), data bytes fill the region page by page, moving to the
+  * next column when the last page is reached.
+  * \param first_column First column of the region (0 = leftmost).
+  * \param last_column Last column of the region (inclusive).
+  * \param first_page First page (8 pixel high row) of the region
+  *                   (0 = topmost).
+  * \param last_page Last page of the region (inclusive).
+  */
+static void setAddressWindow(uint8_t first_column, uint8_t last_column, uint8_t first_page, uint8_t last_page)
 {
-	configurePeripheralsForSSD1306();
-	resetSSD1306();
-	clearDisplay();
+	writeSPI1Byte(false, 0x21); // set column address
+	writeSPI1Byte(false, first_column);
+	writeSPI1Byte(false, last_column);
+	writeSPI1Byte(false, 0x22); // set page address
+	writeSPI1Byte(false, first_page);
+	writeSPI1Byte(false, last_page);
 }
 
-/** Font table byte lookup function which has bit granularity. Alternatively,
-  * this can be thought of as treating the font table as a giant little-endian
-  * multi-precision integer, shifting it to the right bit_offset times and
-  * returning the least significant byte.
-  * This does range checking of bit_offset.
-  * \param bit_offset The font table offset, in bits, to grab a byte from.
-  * \return A byte from within the font table.
+/** Clear all of the display's GDDRAM, regardless of what #rendered_buffer
+  * says is on the display. This is needed after a reset, when GDDRAM
+  * contains undefined junk.
   */
-static uint8_t lookupFontTable(uint32_t bit_offset)
+static void clearGDDRAM(void)
 {
-	uint32_t index;
-	uint32_t data;
+	uint32_t i;
 
-	index = bit_offset >> 3;
-	if (index >= (sizeof(font_table) - 1))
+	setAddressWindow(0, DISPLAY_WIDTH - 1, 0, (DISPLAY_HEIGHT / 8) - 1);
+	for (i = 0; i < (DISPLAY_WIDTH * DISPLAY_HEIGHT / 8); i++)
 	{
-		return 0; // empty character
+		writeSPI1Byte(true, 0);
 	}
-	data = font_table[index] | (font_table[index + 1] << 8);
-	return (uint8_t)(data >> (bit_offset & 7));
+	memset(rendered_buffer, FONT_BLANK, sizeof(rendered_buffer));
 }
 
 /** Text buffer query function. As well as obtaining a character from
@@ -376,94 +370,182 @@ static uint8_t lookupTextBuffer(uint32_t char_x, uint32_t char_y)
 	}
 }
 
-/** Using the contents of the text buffer (#text_buffer) and the font
-  * in #font_table, this outputs a series of data bytes to the SSD1306
-  * display.
-  *
-  * Since the SSD1306 memory addressing mode is set to "vertical" by
-  * resetSSD1306(), this function renders in columns, 8 pixels at a time.
-  * The rendering loop starts at the top-left, moves downwards and when it
-  * hits the bottom of the current column, moves right to start at the top
-  * of the next column. Column-based rendering is done because the SSD1306's
-  * GDDRAM is column-based (each byte of data corresponds to an 8 pixel high
-  * column).
+/** Get the bitmap of a character from the font table. This does range
+  * checking, so that characters which aren't in the font table are
+  * rendered as blank characters.
+  * \param char_x x location (0 = leftmost) of character to fetch.
+  * \param char_y y location (0 = topmost) of character to fetch.
+  * \return A pointer to the #CHARACTER_BYTES bytes of the character's bitmap,
+  *         within #font_table.
+  */
+static const uint8_t *lookupGlyph(uint32_t char_x, uint32_t char_y)
+{
+	uint32_t index;
+
+	index = lookupTextBuffer(char_x, char_y);
+	if (index >= (sizeof(font_table) / CHARACTER_BYTES))
+	{
+		index = FONT_BLANK - FONT_TABLE_START;
+	}
+	return &(font_table[index * CHARACTER_BYTES]);
+}
+
+/** Get 8 vertically adjacent pixels from one column of a character's bitmap.
+  * When row_offset is a multiple of 8 (which is always the case if
+  * #CHARACTER_HEIGHT is a multiple of 8), this is just a copy of one byte
+  * from the font table.
+  * \param glyph The character's bitmap, as returned by lookupGlyph().
+  * \param column The column (0 = leftmost) within the character.
+  * \param row_offset The row (0 = topmost) within the character of the
+  *                   first pixel to get.
+  * \return The 8 pixels, with the least significant bit being the topmost.
+  *         Pixels below the bottom of the character will be 0.
+  */
+static uint8_t getGlyphColumn(const uint8_t *glyph, uint32_t column, uint32_t row_offset)
+{
+	uint32_t index;
+	uint32_t data;
+
+	index = column * PAGES_PER_CHARACTER + (row_offset >> 3);
+	data = glyph[index];
+	if ((row_offset & 7) != 0)
+	{
+		if (((row_offset >> 3) + 1) < PAGES_PER_CHARACTER)
+		{
+			data |= (uint32_t)glyph[index + 1] << 8;
+		}
+		data >>= (row_offset & 7);
+	}
+	return (uint8_t)data;
+}
+
+/** Render one byte (8 pixel high column) of the display.
   *
   * In order for the renderer to work
   * correctly, #DISPLAY_WIDTH, #DISPLAY_HEIGHT, #CHARACTER_WIDTH
   * and #CHARACTER_HEIGHT must be set correctly.
   * The renderer only supports monochrome, fixed-width fonts.
   * However, the renderer can deal with fonts with a height which is not a
-  * multiple of 8.
+  * multiple of 8; in that case, a byte may be the OR of pixels from two
+  * vertically adjacent characters.
+  * \param glyphs Bitmaps (see lookupGlyph()) of every character in the
+  *               column of characters which contains the byte, plus one
+  *               blank character below the bottom line.
+  * \param column x offset (0 = leftmost) of the byte within the character.
+  * \param page y location of the byte, in pages (0 = top edge, 1 = 8 pixels
+  *             below that etc.).
+  * \return The rendered byte, in the format expected by SSD1306 GDDRAM.
+  */
+static uint8_t renderByte(const uint8_t * const *glyphs, uint32_t column, uint32_t page)
+{
+	uint32_t char_y; // 0 = topmost character, 1 = the one below that etc.
+	uint32_t char_y_offset; // y offset within character
+	uint8_t data;
+
+	char_y = (page * 8) / CHARACTER_HEIGHT;
+	char_y_offset = (page * 8) % CHARACTER_HEIGHT;
+	data = getGlyphColumn(glyphs[char_y], column, char_y_offset);
+	if ((char_y_offset + 8) > CHARACTER_HEIGHT)
+	{
+		// Byte goes across character height boundary, so need to fetch
+		// partial character column from next (i.e. one below) character.
+		data |= (uint8_t)(getGlyphColumn(glyphs[char_y + 1], column, 0) << (CHARACTER_HEIGHT - char_y_offset));
+	}
+	return data;
+}
+
+/** Update the display so that it shows the contents of the text buffer
+  * (#text_buffer).
+  *
+  * Only character cells which differ from what was last rendered (see
+  * #rendered_buffer) are rendered and sent. For each column of characters,
+  * the pages spanned by the changed cells in that column are found, and
+  * setAddressWindow() is used to restrict GDDRAM writes to just those pages
+  * of just that column of characters. Since the SSD1306 memory addressing
+  * mode is set to "vertical" by resetSSD1306(), the window is filled in
+  * columns, 8 pixels at a time. Column-based rendering is done because the
+  * SSD1306's GDDRAM is column-based (each byte of data corresponds to an 8
+  * pixel high column).
   *
-  * This renderer isn't very fast. But it doesn't need to be. With the SPI bus
-  * running at a bit rate of 1 Mhz, the renderer only needs to be able to
-  * write one byte every 384 cycles, which is a long time.
+  * Typical updates, like appending a line of text or replacing one screen
+  * of text with another which shares some characters, therefore send much
+  * less than the full 1024 bytes of GDDRAM.
   */
 static void renderDisplay(void)
 {
-	uint32_t x; // 0 = left edge, positive = right
-	uint32_t y; // 0 = top edge, positive = down
 	uint32_t char_x; // 0 = leftmost character, 1 = the one to the right of that etc.
 	uint32_t char_y; // 0 = topmost character, 1 = the one below that etc.
-	uint32_t char_x_offset; // x offset within character
-	uint32_t char_y_offset; // y offset within character
-	uint32_t amount; // number of bits to use
-	uint8_t current_character;
-	uint8_t next_character;
-	uint8_t data;
-	uint8_t temp_data;
+	uint32_t index;
+	uint32_t x; // 0 = left edge, positive = right
+	uint32_t page; // 0 = top edge, positive = down
+	uint32_t first_page;
+	uint32_t last_page;
+	bool dirty;
+	const uint8_t *glyphs[NUMBER_OF_LINES + 1];
 
-	char_x = 0;
-	char_x_offset = 0;
-	for (x = 0; x < DISPLAY_WIDTH; x++)
+	for (char_x = 0; char_x < CHARACTERS_PER_LINE; char_x++)
 	{
-		// Render a column.
-		char_y = 0;
-		char_y_offset = 0;
-		// The next (i.e. one below) character needs to be fetched in advance
-		// because the next 8 pixels may go across the current's character
-		// height boundary.
-		current_character = lookupTextBuffer(char_x, char_y);
-		next_character = lookupTextBuffer(char_x, char_y + 1);
-		for (y = 0; y < DISPLAY_HEIGHT; y += 8)
+		// Find range of pages which need to be updated.
+		dirty = false;
+		first_page = 0;
+		last_page = 0;
+		for (char_y = 0; char_y < NUMBER_OF_LINES; char_y++)
 		{
-			if ((char_y_offset + 8) > CHARACTER_HEIGHT)
+			index = CHARACTERS_PER_LINE * char_y + char_x;
+			if (text_buffer[index] != rendered_buffer[index])
 			{
-				// Byte goes across character height boundary.
-				amount = CHARACTER_HEIGHT - char_y_offset;
+				if (!dirty)
+				{
+					first_page = (char_y * CHARACTER_HEIGHT) / 8;
+					dirty = true;
+				}
+				last_page = ((char_y + 1) * CHARACTER_HEIGHT - 1) / 8;
+				rendered_buffer[index] = text_buffer[index];
 			}
-			else
-			{
-				// Next byte resides entirely within current character.
-				amount = 8;
-			}
-			data = lookupFontTable(current_character * CHARACTER_BITS + char_y_offset + char_x_offset * CHARACTER_HEIGHT);
-			data &= (1 << amount) - 1;
-			if ((char_y_offset + 8) > CHARACTER_HEIGHT)
+		}
+		if (last_page >= (DISPLAY_HEIGHT / 8))
+		{
+			last_page = (DISPLAY_HEIGHT / 8) - 1;
+		}
+
+		if (dirty)
+		{
+			// Look up every character in this column of characters once,
+			// instead of once per byte.
+			for (char_y = 0; char_y < (NUMBER_OF_LINES + 1); char_y++)
 			{
-				// Need to fetch partial character column from next character.
-				temp_data = lookupFontTable(next_character * CHARACTER_BITS + char_x_offset * CHARACTER_HEIGHT);
-				data |= temp_data << amount;
+				glyphs[char_y] = lookupGlyph(char_x, char_y);
 			}
-			writeSPI1Byte(true, data);
-			// Prepare for next byte.
-			char_y_offset += 8;
-			if (char_y_offset >= CHARACTER_HEIGHT)
+			x = char_x * CHARACTER_WIDTH;
+			setAddressWindow((uint8_t)x, (uint8_t)(x + CHARACTER_WIDTH - 1), (uint8_t)first_page, (uint8_t)last_page);
+			for (; x < ((char_x + 1) * CHARACTER_WIDTH); x++)
 			{
-				char_y_offset -= CHARACTER_HEIGHT;
-				char_y++;
-				current_character = next_character;
-				next_character = lookupTextBuffer(char_x, char_y + 1);
+				for (page = first_page; page <= last_page; page++)
+				{
+					writeSPI1Byte(true, renderByte(glyphs, x - char_x * CHARACTER_WIDTH, page));
+				}
 			}
-		} // end for (y = 0; y < DISPLAY_HEIGHT; y += 8)
-		// Prepare for next column.
-		char_x_offset++;
-		if (char_x_offset >= CHARACTER_WIDTH)
-		{
-			char_x_offset = 0;
-			char_x++;
 		}
-	} // end for (x = 0; x < DISPLAY_WIDTH; x++)
+	} // end for (char_x = 0; char_x < CHARACTERS_PER_LINE; char_x++)
+}
+
+/** Clear the display and all associated buffers. */
+void clearDisplay(void)
+{
+	cursor_line = 0;
+	cursor_pos = 0;
+	memset(text_buffer, FONT_BLANK, sizeof(text_buffer));
+	renderDisplay();
+}
+
+/** Set up everything so that the display is ready to start having text
+  * rendered on it. */
+void initSSD1306(void)
+{
+	configurePeripheralsForSSD1306();
+	resetSSD1306();
+	clearGDDRAM();
+	clearDisplay();
 }
 
 /** Move cursor to the start of the next line, but only if the cursor is not
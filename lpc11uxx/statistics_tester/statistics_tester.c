@@ -9,6 +9,10 @@
 // generate_test_vectors.m is a GNU Octave script which can
 // be used to generate those test vectors.
 //
+// If the first argument is "offline", this instead runs the same tests as
+// the device on a capture file of samples, without needing a device; see
+// analyseCaptureFile().
+//
 // This also shows how much time (in clock cycles) was required to calculate
 // the statistics of a histogram with SAMPLE_COUNT samples. This is useful
 // for benchmarking.
@@ -23,9 +27,13 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <termios.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "../../fix16.h"
 #include "../../statistics.h" // include for SAMPLE_COUNT
+#include "../hwrng_limits.h"
 
 // Number of real-valued outputs which the device will send.
 #define OUTPUTS_TO_CHECK				5
@@ -258,6 +266,453 @@ int realArraysEqualWithinTolerance(double *target, double *value, uint32_t size)
 	return 1;
 }
 
+// Offline analysis of capture files
+// ---------------------------------
+//
+// Instead of sending test vectors to a device, the tests which the device
+// runs on each array of SAMPLE_COUNT HWRNG samples can be run on a capture
+// file. The file is memory-mapped, split into batches of SAMPLE_COUNT
+// samples, and the batches are tested in parallel threads, using the same
+// fixed-point code (statistics.c, fft.c and fix16.c) and limits
+// (hwrng_limits.h) as the device. That code keeps its state in
+// THREAD_LOCAL variables, so this program must be compiled with
+// -DTHREAD_LOCAL=__thread.
+//
+// A capture file is a sequence of little-endian 16-bit samples, as the
+// statistical tests see them (i.e. after filtering and decimation), with
+// no header. Any partial batch at the end of the file is ignored.
+
+// Number of threads to use if none is specified on the command line.
+#define DEFAULT_OFFLINE_THREADS			4
+
+// Results of the tests on one batch of samples.
+typedef struct BatchResultStruct
+{
+	// Which tests failed, using the same bits as hwrng.c. 1 = mean,
+	// 2 = variance, 4 = skewness, 8 = kurtosis, 16 = power spectrum peak,
+	// 32 = bandwidth, 64 = autocorrelation, 128 = entropy.
+	uint32_t tests_failed;
+	// The outputs of the tests, as the device would report them.
+	fix16_t mean;
+	fix16_t variance;
+	fix16_t kappa3;
+	fix16_t kappa4;
+	fix16_t entropy_estimate;
+	fix16_t min_entropy_estimate;
+	int max_bin;
+	int bandwidth;
+	fix16_t max_autocorrelation;
+} BatchResult;
+
+// The memory-mapped capture file.
+static const uint8_t *capture_data;
+// Number of complete batches in capture_data.
+static uint32_t capture_batches;
+// Results for each batch, filled in by the worker threads.
+static BatchResult *batch_results;
+// Index of the next batch which a worker thread should test.
+static uint32_t next_batch;
+// Protects next_batch.
+static pthread_mutex_t next_batch_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// This is a copy of estimateBandwidth() in hwrng.c.
+static int estimateBandwidth(int *out_max_bin)
+{
+	int i;
+	fix16_t threshold;
+	int max_bin;
+	int left_bin;
+	int right_bin;
+	int below_counter;
+
+	threshold = fix16_zero;
+	max_bin = 0;
+	for (i = 0; i < (FFT_SIZE + 1); i++)
+	{
+		if (psd_accumulator[i] > threshold)
+		{
+			threshold = psd_accumulator[i];
+			max_bin = i;
+		}
+	}
+	threshold = fix16_mul(threshold, F16(PSD_BANDWIDTH_THRESHOLD));
+
+	// Search for left edge.
+	below_counter = 0;
+	left_bin = 0;
+	for (i = max_bin; i >= 0; i--)
+	{
+		if (psd_accumulator[i] < threshold)
+		{
+			below_counter++;
+		}
+		else
+		{
+			below_counter = 0;
+		}
+		if (below_counter >= PSD_THRESHOLD_REPETITIONS)
+		{
+			left_bin = i + PSD_THRESHOLD_REPETITIONS;
+			break;
+		}
+	}
+	// Search for right edge.
+	below_counter = 0;
+	right_bin = FFT_SIZE;
+	for (i = max_bin; i < (FFT_SIZE + 1); i++)
+	{
+		if (psd_accumulator[i] < threshold)
+		{
+			below_counter++;
+		}
+		else
+		{
+			below_counter = 0;
+		}
+		if (below_counter >= PSD_THRESHOLD_REPETITIONS)
+		{
+			right_bin = i - PSD_THRESHOLD_REPETITIONS;
+			break;
+		}
+	}
+	*out_max_bin = max_bin;
+	return right_bin - left_bin;
+}
+
+// This is a copy of findMaximumAutoCorrelation() in hwrng.c.
+static fix16_t findMaximumAutoCorrelation(ComplexFixed *fft_buffer)
+{
+	fix16_t max;
+	fix16_t sample;
+	uint32_t i;
+
+	max = fix16_zero;
+	for (i = AUTOCORR_START_LAG; i < (FFT_SIZE + 1); i++)
+	{
+		sample = fft_buffer[i].real;
+		if (sample < fix16_zero)
+		{
+			sample = -sample;
+		}
+		if (sample > max)
+		{
+			max = sample;
+		}
+	}
+	return max;
+}
+
+// Run the histogram-based and FFT-based tests on one batch of samples, the
+// same way histogramTestsFailed() and fftTestsFailed() in hwrng.c do.
+static void testBatch(BatchResult *result, volatile uint16_t *samples)
+{
+	uint32_t i;
+	uint32_t tests_failed;
+	bool moment_error_occurred;
+	bool entropy_error_occurred;
+	bool autocorrelation_error_occurred;
+	fix16_t variance;
+	fix16_t variance_squared;
+	fix16_t three_times_variance_squared;
+	fix16_t variance_cubed;
+	fix16_t kappa3_squared;
+	fix16_t term1;
+	ComplexFixed fft_buffer[FFT_SIZE + 1];
+
+	clearHistogram();
+	clearPowerSpectralDensity();
+	for (i = 0; i < SAMPLE_COUNT; i++)
+	{
+		incrementHistogram(samples[i]);
+	}
+	for (i = 0; i < SAMPLE_COUNT; i += (FFT_SIZE * 2))
+	{
+		accumulatePowerSpectralDensity(&(samples[i]));
+	}
+
+	// Histogram-based tests.
+	fix16_error_occurred = false;
+	calculateMoments(&(result->mean), &variance, &(result->kappa3), &(result->kappa4));
+	moment_error_occurred = fix16_error_occurred;
+	result->variance = variance;
+	fix16_error_occurred = false;
+	result->entropy_estimate = estimateEntropy();
+	result->min_entropy_estimate = estimateMinEntropy();
+	entropy_error_occurred = fix16_error_occurred;
+	tests_failed = 0;
+	if (result->mean <= F16((STATTEST_MIN_MEAN - (HISTOGRAM_NUM_BINS / 2)) / SAMPLE_SCALE_DOWN))
+	{
+		tests_failed |= 1; // mean below minimum
+	}
+	if (result->mean >= F16((STATTEST_MAX_MEAN - (HISTOGRAM_NUM_BINS / 2)) / SAMPLE_SCALE_DOWN))
+	{
+		tests_failed |= 1; // mean above maximum
+	}
+	if (variance <= F16((STATTEST_MIN_VARIANCE / SAMPLE_SCALE_DOWN) / SAMPLE_SCALE_DOWN))
+	{
+		tests_failed |= 2; // variance below minimum
+	}
+	if (variance >= F16((STATTEST_MAX_VARIANCE / SAMPLE_SCALE_DOWN) / SAMPLE_SCALE_DOWN))
+	{
+		tests_failed |= 2; // variance above maximum
+	}
+	variance_squared = fix16_mul(variance, variance);
+	variance_cubed = fix16_mul(variance_squared, variance);
+	kappa3_squared = fix16_mul(result->kappa3, result->kappa3);
+	if (kappa3_squared >= fix16_mul(variance_cubed, F16(STATTEST_MAX_SKEWNESS * STATTEST_MAX_SKEWNESS)))
+	{
+		tests_failed |= 4; // skewness out of bounds
+	}
+	three_times_variance_squared = fix16_mul(fix16_from_int(3), variance_squared);
+	term1 = fix16_mul(F16(STATTEST_MIN_KURTOSIS), variance_squared);
+	if (result->kappa4 <= fix16_add(term1, three_times_variance_squared))
+	{
+		tests_failed |= 8; // kurtosis below minimum
+	}
+	term1 = fix16_mul(F16(STATTEST_MAX_KURTOSIS), variance_squared);
+	if (result->kappa4 >= fix16_add(term1, three_times_variance_squared))
+	{
+		tests_failed |= 8; // kurtosis above maximum
+	}
+	if (moment_error_occurred || histogram_overflow_occurred)
+	{
+		tests_failed |= 15; // arithmetic error (probably overflow)
+	}
+	if ((result->entropy_estimate < F16(STATTEST_MIN_ENTROPY)) || entropy_error_occurred)
+	{
+		tests_failed |= 128; // entropy per sample below minimum
+	}
+
+	// FFT-based tests.
+	result->bandwidth = estimateBandwidth(&(result->max_bin));
+	fix16_error_occurred = false;
+	autocorrelation_error_occurred = calculateAutoCorrelation(fft_buffer);
+	result->max_autocorrelation = findMaximumAutoCorrelation(fft_buffer);
+	if (fix16_from_int(result->max_bin) < F16(PSD_MIN_PEAK * 2.0 * FFT_SIZE))
+	{
+		tests_failed |= 16; // peak in power spectrum is below minimum frequency
+	}
+	if (fix16_from_int(result->max_bin) > F16(PSD_MAX_PEAK * 2.0 * FFT_SIZE))
+	{
+		tests_failed |= 16; // peak in power spectrum is above maximum frequency
+	}
+	if (fix16_from_int(result->bandwidth) < F16(PSD_MIN_BANDWIDTH * 2.0 * FFT_SIZE))
+	{
+		tests_failed |= 32; // bandwidth of HWRNG below minimum
+	}
+	if (psd_accumulator_error_occurred)
+	{
+		tests_failed |= 48; // arithmetic error (probably overflow)
+	}
+	if ((result->max_autocorrelation > fix16_mul(variance, F16(AUTOCORR_THRESHOLD)))
+		|| autocorrelation_error_occurred)
+	{
+		tests_failed |= 64; // maximum autocorrelation amplitude above maximum
+	}
+	result->tests_failed = tests_failed;
+}
+
+// Worker thread for analyseCaptureFile(). Each thread repeatedly takes the
+// next untested batch and tests it, until there are none left.
+static void *offlineWorker(void *arg)
+{
+	uint32_t batch;
+	uint32_t i;
+	const uint8_t *p;
+	uint16_t samples[SAMPLE_COUNT];
+
+	while (1)
+	{
+		pthread_mutex_lock(&next_batch_mutex);
+		batch = next_batch;
+		if (next_batch < capture_batches)
+		{
+			next_batch++;
+		}
+		pthread_mutex_unlock(&next_batch_mutex);
+		if (batch >= capture_batches)
+		{
+			break;
+		}
+		p = &(capture_data[(size_t)batch * SAMPLE_COUNT * 2]);
+		for (i = 0; i < SAMPLE_COUNT; i++)
+		{
+			samples[i] = (uint16_t)(p[i * 2] | (p[i * 2 + 1] << 8));
+		}
+		testBatch(&(batch_results[batch]), samples);
+	}
+	return NULL;
+}
+
+// Write the results of every batch as CSV, one line per batch. Mean and
+// variance are converted back to ADC output numbers, and kappa3 and kappa4
+// are standardised (into skewness and excess kurtosis), so that they can be
+// compared directly with the limits in hwrng_limits.h.
+static void writeResultsCSV(FILE *f)
+{
+	uint32_t i;
+	BatchResult *r;
+	double variance;
+
+	fprintf(f, "batch,first_sample,tests_failed,mean,variance,skewness,kurtosis,entropy,min_entropy,max_bin,bandwidth,max_autocorrelation\n");
+	for (i = 0; i < capture_batches; i++)
+	{
+		r = &(batch_results[i]);
+		variance = fix16_to_dbl(r->variance);
+		fprintf(f, "%u,%lu,%u,%g,%g,%g,%g,%g,%g,%d,%d,%g\n",
+			i, (unsigned long)i * SAMPLE_COUNT, r->tests_failed,
+			fix16_to_dbl(r->mean) * SAMPLE_SCALE_DOWN + (HISTOGRAM_NUM_BINS / 2),
+			variance * SAMPLE_SCALE_DOWN * SAMPLE_SCALE_DOWN,
+			(variance > 0.0) ? (fix16_to_dbl(r->kappa3) / pow(variance, 1.5)) : 0.0,
+			(variance > 0.0) ? (fix16_to_dbl(r->kappa4) / (variance * variance) - 3.0) : 0.0,
+			fix16_to_dbl(r->entropy_estimate),
+			fix16_to_dbl(r->min_entropy_estimate),
+			r->max_bin, r->bandwidth,
+			(variance > 0.0) ? (fix16_to_dbl(r->max_autocorrelation) / variance) : 0.0);
+	}
+}
+
+// Test every batch in a capture file, writing per-batch results as CSV
+// (see writeResultsCSV()) to csv_filename (or stdout, if csv_filename is
+// NULL) and a summary to stderr.
+// Returns 0 if every batch passed, 1 if any failed, 2 on error.
+static int analyseCaptureFile(const char *filename, unsigned int num_threads, const char *csv_filename)
+{
+	int fd;
+	struct stat st;
+	void *mapped;
+	pthread_t *threads;
+	unsigned int started;
+	unsigned int i;
+	uint32_t j;
+	uint32_t failed;
+	uint32_t failed_per_test[8];
+	FILE *f_csv;
+
+	fd = open(filename, O_RDONLY);
+	if (fd == -1)
+	{
+		fprintf(stderr, "Could not open \"%s\" for reading\n", filename);
+		return 2;
+	}
+	if (fstat(fd, &st) != 0)
+	{
+		fprintf(stderr, "Could not get size of \"%s\"\n", filename);
+		close(fd);
+		return 2;
+	}
+	capture_batches = (uint32_t)((uint64_t)st.st_size / (SAMPLE_COUNT * 2));
+	if (capture_batches == 0)
+	{
+		fprintf(stderr, "\"%s\" doesn't contain a whole batch of %d samples\n", filename, SAMPLE_COUNT);
+		close(fd);
+		return 2;
+	}
+	mapped = mmap(NULL, (size_t)capture_batches * SAMPLE_COUNT * 2, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd); // the mapping stays valid
+	if (mapped == MAP_FAILED)
+	{
+		fprintf(stderr, "Could not memory-map \"%s\"\n", filename);
+		return 2;
+	}
+	capture_data = (const uint8_t *)mapped;
+	madvise(mapped, (size_t)capture_batches * SAMPLE_COUNT * 2, MADV_SEQUENTIAL);
+	batch_results = calloc(capture_batches, sizeof(BatchResult));
+	threads = calloc(num_threads, sizeof(pthread_t));
+	if ((batch_results == NULL) || (threads == NULL))
+	{
+		fprintf(stderr, "Out of memory\n");
+		exit(2);
+	}
+
+	next_batch = 0;
+	started = 0;
+	for (i = 0; i < num_threads; i++)
+	{
+		if (pthread_create(&(threads[started]), NULL, &offlineWorker, NULL) == 0)
+		{
+			started++;
+		}
+	}
+	if (started == 0)
+	{
+		// Couldn't create any threads; do all the work in this one.
+		offlineWorker(NULL);
+	}
+	for (i = 0; i < started; i++)
+	{
+		pthread_join(threads[i], NULL);
+	}
+
+	if (csv_filename != NULL)
+	{
+		f_csv = fopen(csv_filename, "w");
+		if (f_csv == NULL)
+		{
+			fprintf(stderr, "Could not open \"%s\" for writing\n", csv_filename);
+			exit(2);
+		}
+	}
+	else
+	{
+		f_csv = stdout;
+	}
+	writeResultsCSV(f_csv);
+	if (f_csv != stdout)
+	{
+		fclose(f_csv);
+	}
+
+	failed = 0;
+	memset(failed_per_test, 0, sizeof(failed_per_test));
+	for (j = 0; j < capture_batches; j++)
+	{
+		if (batch_results[j].tests_failed != 0)
+		{
+			failed++;
+		}
+		for (i = 0; i < 8; i++)
+		{
+			if ((batch_results[j].tests_failed & (1u << i)) != 0)
+			{
+				failed_per_test[i]++;
+			}
+		}
+	}
+	fprintf(stderr, "Batches tested: %u (using %u threads)\n", capture_batches, (started > 0) ? started : 1);
+	fprintf(stderr, "Batches which failed: %u\n", failed);
+	fprintf(stderr, "Failures per test: mean %u, variance %u, skewness %u, kurtosis %u, peak %u, bandwidth %u, autocorrelation %u, entropy %u\n",
+		failed_per_test[0], failed_per_test[1], failed_per_test[2], failed_per_test[3],
+		failed_per_test[4], failed_per_test[5], failed_per_test[6], failed_per_test[7]);
+
+	free(threads);
+	free(batch_results);
+	munmap(mapped, (size_t)capture_batches * SAMPLE_COUNT * 2);
+	return (failed != 0) ? 1 : 0;
+}
+
+// Handle "statistics_tester offline <capture file> [<threads>] [<CSV file>]".
+static int offlineMain(int argc, char **argv)
+{
+	int num_threads;
+
+	if ((argc < 3) || (argc > 5))
+	{
+		printf("Usage: %s offline <capture file> [<threads>] [<CSV file>]\n", argv[0]);
+		exit(2);
+	}
+	num_threads = DEFAULT_OFFLINE_THREADS;
+	if (argc >= 4)
+	{
+		num_threads = atoi(argv[3]);
+		if (num_threads < 1)
+		{
+			printf("Invalid number of threads: %s\n", argv[3]);
+			exit(2);
+		}
+	}
+	return analyseCaptureFile(argv[2], (unsigned int)num_threads, (argc >= 5) ? argv[4] : NULL);
+}
 
 int main(int argc, char **argv)
 {
@@ -275,9 +730,15 @@ int main(int argc, char **argv)
 	struct termios old_options;
 	uint8_t cycles_buffer[4];
 
+	if ((argc >= 2) && !strcmp(argv[1], "offline"))
+	{
+		exit(offlineMain(argc, argv));
+	}
+
 	if (argc != 2)
 	{
 		printf("Usage: %s <serial device>\n", argv[0]);
+		printf("   or: %s offline <capture file> [<threads>] [<CSV file>]\n", argv[0]);
 		printf("\n");
 		printf("Example: %s /dev/ttyUSB0\n", argv[0]);
 		exit(1);
@@ -46,13 +46,15 @@ static const char str_WALLET_NOT_LOADED[] = "Wallet not loaded";
 /** String for #WALLET_INVALID_HANDLE wallet error. */
 static const char str_WALLET_INVALID_HANDLE[] = "Invalid address handle";
 /** String for #WALLET_BACKUP_ERROR wallet error. */
-static const char str_WALLET_BACKUP_ERROR[] = "Seed could not be written to specified device";
+static const char str_WALLET_BACKUP_ERROR[] = "Seed could not be written to specified device, or backup is corrupt";
 /** String for #WALLET_RNG_FAILURE wallet error. */
 static const char str_WALLET_RNG_FAILURE[] = "Failure in random number generation system";
 /** String for #WALLET_INVALID_WALLET_NUM wallet error. */
 static const char str_WALLET_INVALID_WALLET_NUM[] = "Invalid wallet number";
 /** String for #WALLET_INVALID_OPERATION wallet error. */
 static const char str_WALLET_INVALID_OPERATION[] = "Operation not allowed";
+/** String for #WALLET_CANCELLED wallet error. */
+static const char str_WALLET_CANCELLED[] = "Operation cancelled by host";
 /** String for #TRANSACTION_INVALID_FORMAT transaction parser error. */
 static const char str_TRANSACTION_INVALID_FORMAT[] = "Format of transaction is unknown or invalid";
 /** String for #TRANSACTION_TOO_MANY_INPUTS transaction parser error. */
@@ -67,56 +69,64 @@ static const char str_TRANSACTION_NON_STANDARD[] = "Transaction is non-standard"
 static const char str_TRANSACTION_INVALID_AMOUNT[] = "Invalid output amount in transaction";
 /** String for #TRANSACTION_INVALID_REFERENCE transaction parser error. */
 static const char str_TRANSACTION_INVALID_REFERENCE[] = "Invalid transaction reference";
+/** String for #TRANSACTION_PREVOUT_NOT_CACHED transaction parser error. */
+static const char str_TRANSACTION_PREVOUT_NOT_CACHED[] = "Input transaction not cached";
 /** String for unknown error. */
 static const char str_UNKNOWN[] = "Unknown error";
 /**@}*/
 
-/** Obtain one character from one of the device's strings.
+/** Get one of the device's strings. This is faster than calling getString()
+  * for each character, since the string only needs to be looked up once.
   * \param set Specifies which set of strings to use; should be
   *            one of #StringSetEnum.
-  * \param spec Specifies which string to get the character from. The
-  *             interpretation of this depends on the value of set;
-  *             see #StringSetEnum for clarification.
-  * \param pos The position of the character within the string; 0 means first,
-  *            1 means second etc.
-  * \return The character from the specified string.
+  * \param spec Specifies which string to get. The interpretation of this
+  *             depends on the value of set; see #StringSetEnum for
+  *             clarification.
+  * \param out_length The length of the string, in number of characters, will
+  *                   be written here.
+  * \return A pointer to the first character of the string. The string is not
+  *         necessarily null-terminated.
   */
-char getString(StringSet set, uint8_t spec, uint16_t pos)
+const char *getStringSpan(StringSet set, uint8_t spec, uint16_t *out_length)
 {
 	const char *str;
+	size_t length;
 
-	if (pos >= getStringLength(set, spec))
-	{
-		// Attempting to read beyond end of string.
-		return 0;
-	}
 	if (set == STRINGSET_MISC)
 	{
 		switch (spec)
 		{
 		case MISCSTR_VERSION:
 			str = str_MISCSTR_VERSION;
+			length = sizeof(str_MISCSTR_VERSION);
 			break;
 		case MISCSTR_PERMISSION_DENIED_USER:
 			str = str_MISCSTR_PERMISSION_DENIED_USER;
+			length = sizeof(str_MISCSTR_PERMISSION_DENIED_USER);
 			break;
 		case MISCSTR_INVALID_PACKET:
 			str = str_MISCSTR_INVALID_PACKET;
+			length = sizeof(str_MISCSTR_INVALID_PACKET);
 			break;
 		case MISCSTR_PARAM_TOO_LARGE:
 			str = str_MISCSTR_PARAM_TOO_LARGE;
+			length = sizeof(str_MISCSTR_PARAM_TOO_LARGE);
 			break;
 		case MISCSTR_PERMISSION_DENIED_HOST:
 			str = str_MISCSTR_PERMISSION_DENIED_HOST;
+			length = sizeof(str_MISCSTR_PERMISSION_DENIED_HOST);
 			break;
 		case MISCSTR_UNEXPECTED_PACKET:
 			str = str_MISCSTR_UNEXPECTED_PACKET;
+			length = sizeof(str_MISCSTR_UNEXPECTED_PACKET);
 			break;
 		case MISCSTR_OTP_MISMATCH:
 			str = str_MISCSTR_OTP_MISMATCH;
+			length = sizeof(str_MISCSTR_OTP_MISMATCH);
 			break;
 		default:
 			str = str_UNKNOWN;
+			length = sizeof(str_UNKNOWN);
 			break;
 		}
 	}
@@ -126,42 +136,59 @@ char getString(StringSet set, uint8_t spec, uint16_t pos)
 		{
 		case WALLET_FULL:
 			str = str_WALLET_FULL;
+			length = sizeof(str_WALLET_FULL);
 			break;
 		case WALLET_EMPTY:
 			str = str_WALLET_EMPTY;
+			length = sizeof(str_WALLET_EMPTY);
 			break;
 		case WALLET_READ_ERROR:
 			str = str_WALLET_READ_ERROR;
+			length = sizeof(str_WALLET_READ_ERROR);
 			break;
 		case WALLET_WRITE_ERROR:
 			str = str_WALLET_WRITE_ERROR;
+			length = sizeof(str_WALLET_WRITE_ERROR);
 			break;
 		case WALLET_ADDRESS_NOT_FOUND:
 			str = str_WALLET_ADDRESS_NOT_FOUND;
+			length = sizeof(str_WALLET_ADDRESS_NOT_FOUND);
 			break;
 		case WALLET_NOT_THERE:
 			str = str_WALLET_NOT_THERE;
+			length = sizeof(str_WALLET_NOT_THERE);
 			break;
 		case WALLET_NOT_LOADED:
 			str = str_WALLET_NOT_LOADED;
+			length = sizeof(str_WALLET_NOT_LOADED);
 			break;
 		case WALLET_INVALID_HANDLE:
 			str = str_WALLET_INVALID_HANDLE;
+			length = sizeof(str_WALLET_INVALID_HANDLE);
 			break;
 		case WALLET_BACKUP_ERROR:
 			str = str_WALLET_BACKUP_ERROR;
+			length = sizeof(str_WALLET_BACKUP_ERROR);
 			break;
 		case WALLET_RNG_FAILURE:
 			str = str_WALLET_RNG_FAILURE;
+			length = sizeof(str_WALLET_RNG_FAILURE);
 			break;
 		case WALLET_INVALID_WALLET_NUM:
 			str = str_WALLET_INVALID_WALLET_NUM;
+			length = sizeof(str_WALLET_INVALID_WALLET_NUM);
 			break;
 		case WALLET_INVALID_OPERATION:
 			str = str_WALLET_INVALID_OPERATION;
+			length = sizeof(str_WALLET_INVALID_OPERATION);
+			break;
+		case WALLET_CANCELLED:
+			str = str_WALLET_CANCELLED;
+			length = sizeof(str_WALLET_CANCELLED);
 			break;
 		default:
 			str = str_UNKNOWN;
+			length = sizeof(str_UNKNOWN);
 			break;
 		}
 	}
@@ -171,33 +198,71 @@ char getString(StringSet set, uint8_t spec, uint16_t pos)
 		{
 		case TRANSACTION_INVALID_FORMAT:
 			str = str_TRANSACTION_INVALID_FORMAT;
+			length = sizeof(str_TRANSACTION_INVALID_FORMAT);
 			break;
 		case TRANSACTION_TOO_MANY_INPUTS:
 			str = str_TRANSACTION_TOO_MANY_INPUTS;
+			length = sizeof(str_TRANSACTION_TOO_MANY_INPUTS);
 			break;
 		case TRANSACTION_TOO_MANY_OUTPUTS:
 			str = str_TRANSACTION_TOO_MANY_OUTPUTS;
+			length = sizeof(str_TRANSACTION_TOO_MANY_OUTPUTS);
 			break;
 		case TRANSACTION_TOO_LARGE:
 			str = str_TRANSACTION_TOO_LARGE;
+			length = sizeof(str_TRANSACTION_TOO_LARGE);
 			break;
 		case TRANSACTION_NON_STANDARD:
 			str = str_TRANSACTION_NON_STANDARD;
+			length = sizeof(str_TRANSACTION_NON_STANDARD);
 			break;
 		case TRANSACTION_INVALID_AMOUNT:
 			str = str_TRANSACTION_INVALID_AMOUNT;
+			length = sizeof(str_TRANSACTION_INVALID_AMOUNT);
 			break;
 		case TRANSACTION_INVALID_REFERENCE:
 			str = str_TRANSACTION_INVALID_REFERENCE;
+			length = sizeof(str_TRANSACTION_INVALID_REFERENCE);
+			break;
+		case TRANSACTION_PREVOUT_NOT_CACHED:
+			str = str_TRANSACTION_PREVOUT_NOT_CACHED;
+			length = sizeof(str_TRANSACTION_PREVOUT_NOT_CACHED);
 			break;
 		default:
 			str = str_UNKNOWN;
+			length = sizeof(str_UNKNOWN);
 			break;
 		}
 	}
 	else
 	{
 		str = str_UNKNOWN;
+		length = sizeof(str_UNKNOWN);
+	}
+	*out_length = (uint16_t)(length - 1);
+	return str;
+}
+
+/** Obtain one character from one of the device's strings.
+  * \param set Specifies which set of strings to use; should be
+  *            one of #StringSetEnum.
+  * \param spec Specifies which string to get the character from. The
+  *             interpretation of this depends on the value of set;
+  *             see #StringSetEnum for clarification.
+  * \param pos The position of the character within the string; 0 means first,
+  *            1 means second etc.
+  * \return The character from the specified string.
+  */
+char getString(StringSet set, uint8_t spec, uint16_t pos)
+{
+	const char *str;
+	uint16_t length;
+
+	str = getStringSpan(set, spec, &length);
+	if (pos >= length)
+	{
+		// Attempting to read beyond end of string.
+		return 0;
 	}
 	return str[pos];
 }
@@ -212,114 +277,9 @@ char getString(StringSet set, uint8_t spec, uint16_t pos)
   */
 uint16_t getStringLength(StringSet set, uint8_t spec)
 {
-	if (set == STRINGSET_MISC)
-	{
-		switch (spec)
-		{
-		case MISCSTR_VERSION:
-			return (uint16_t)(sizeof(str_MISCSTR_VERSION) - 1);
-			break;
-		case MISCSTR_PERMISSION_DENIED_USER:
-			return (uint16_t)(sizeof(str_MISCSTR_PERMISSION_DENIED_USER) - 1);
-			break;
-		case MISCSTR_INVALID_PACKET:
-			return (uint16_t)(sizeof(str_MISCSTR_INVALID_PACKET) - 1);
-			break;
-		case MISCSTR_PARAM_TOO_LARGE:
-			return (uint16_t)(sizeof(str_MISCSTR_PARAM_TOO_LARGE) - 1);
-			break;
-		case MISCSTR_PERMISSION_DENIED_HOST:
-			return (uint16_t)(sizeof(str_MISCSTR_PERMISSION_DENIED_HOST) - 1);
-			break;
-		case MISCSTR_UNEXPECTED_PACKET:
-			return (uint16_t)(sizeof(str_MISCSTR_UNEXPECTED_PACKET) - 1);
-			break;
-		case MISCSTR_OTP_MISMATCH:
-			return (uint16_t)(sizeof(str_MISCSTR_OTP_MISMATCH) - 1);
-			break;
-		default:
-			return (uint16_t)(sizeof(str_UNKNOWN) - 1);
-			break;
-		}
-	}
-	else if (set == STRINGSET_WALLET)
-	{
-		switch (spec)
-		{
-		case WALLET_FULL:
-			return (uint16_t)(sizeof(str_WALLET_FULL) - 1);
-			break;
-		case WALLET_EMPTY:
-			return (uint16_t)(sizeof(str_WALLET_EMPTY) - 1);
-			break;
-		case WALLET_READ_ERROR:
-			return (uint16_t)(sizeof(str_WALLET_READ_ERROR) - 1);
-			break;
-		case WALLET_WRITE_ERROR:
-			return (uint16_t)(sizeof(str_WALLET_WRITE_ERROR) - 1);
-			break;
-		case WALLET_ADDRESS_NOT_FOUND:
-			return (uint16_t)(sizeof(str_WALLET_ADDRESS_NOT_FOUND) - 1);
-			break;
-		case WALLET_NOT_THERE:
-			return (uint16_t)(sizeof(str_WALLET_NOT_THERE) - 1);
-			break;
-		case WALLET_NOT_LOADED:
-			return (uint16_t)(sizeof(str_WALLET_NOT_LOADED) - 1);
-			break;
-		case WALLET_INVALID_HANDLE:
-			return (uint16_t)(sizeof(str_WALLET_INVALID_HANDLE) - 1);
-			break;
-		case WALLET_BACKUP_ERROR:
-			return (uint16_t)(sizeof(str_WALLET_BACKUP_ERROR) - 1);
-			break;
-		case WALLET_RNG_FAILURE:
-			return (uint16_t)(sizeof(str_WALLET_RNG_FAILURE) - 1);
-			break;
-		case WALLET_INVALID_WALLET_NUM:
-			return (uint16_t)(sizeof(str_WALLET_INVALID_WALLET_NUM) - 1);
-			break;
-		case WALLET_INVALID_OPERATION:
-			return (uint16_t)(sizeof(str_WALLET_INVALID_OPERATION) - 1);
-			break;
-		default:
-			return (uint16_t)(sizeof(str_UNKNOWN) - 1);
-			break;
-		}
-	}
-	else if (set == STRINGSET_TRANSACTION)
-	{
-		switch (spec)
-		{
-		case TRANSACTION_INVALID_FORMAT:
-			return (uint16_t)(sizeof(str_TRANSACTION_INVALID_FORMAT) - 1);
-			break;
-		case TRANSACTION_TOO_MANY_INPUTS:
-			return (uint16_t)(sizeof(str_TRANSACTION_TOO_MANY_INPUTS) - 1);
-			break;
-		case TRANSACTION_TOO_MANY_OUTPUTS:
-			return (uint16_t)(sizeof(str_TRANSACTION_TOO_MANY_OUTPUTS) - 1);
-			break;
-		case TRANSACTION_TOO_LARGE:
-			return (uint16_t)(sizeof(str_TRANSACTION_TOO_LARGE) - 1);
-			break;
-		case TRANSACTION_NON_STANDARD:
-			return (uint16_t)(sizeof(str_TRANSACTION_NON_STANDARD) - 1);
-			break;
-		case TRANSACTION_INVALID_AMOUNT:
-			return (uint16_t)(sizeof(str_TRANSACTION_INVALID_AMOUNT) - 1);
-			break;
-		case TRANSACTION_INVALID_REFERENCE:
-			return (uint16_t)(sizeof(str_TRANSACTION_INVALID_REFERENCE) - 1);
-			break;
-		default:
-			return (uint16_t)(sizeof(str_UNKNOWN) - 1);
-			break;
-		}
-	}
-	else
-	{
-		return (uint16_t)(sizeof(str_UNKNOWN) - 1);
-	}
+	uint16_t length;
+
+	getStringSpan(set, spec, &length);
+	return length;
 }
 
@@ -8,35 +8,139 @@
   * with the wallet over a USB connection.
   * See initUsart() for serial communication parameters.
   *
-  * This file is only intended to be used for early development. Later
-  * versions will probably use LPC11Uxx's USB controller for communication
-  * with the host.
+  * By default, the receive FIFO interrupts on every character and the
+  * transmit FIFO is fed one byte at a time. If USART_BLOCK_MODE is defined,
+  * the receive FIFO only interrupts once it is half full (or when the line
+  * has gone quiet; see UART_IRQHandler()), the transmit FIFO is filled
+  * completely whenever it empties, and auto RTS/CTS flow control is
+  * enabled. That cuts the number of interrupts per byte by about an order
+  * of magnitude, so the link can run at several Mbaud (see
+  * #USART_BAUD_RATE) without the hardware receive FIFO overflowing.
+  *
+  * This file is only intended to be used for early development. If
+  * USB_HID_TRANSPORT is defined, the LPC11Uxx's USB controller is used for
+  * communication with the host instead (see usb_hid_stream.c) and this file
+  * is not compiled.
   *
   * This file is licensed as described by the file LICENCE.
   */
 
+#ifndef USB_HID_TRANSPORT
+
 #include "LPC11Uxx.h"
 #include "../common.h"
 #include "usart.h"
 #include "serial_fifo.h"
 
-/** Initialise USART at 57600 baud, 8 data bits, no parity and 1 stop bit. */
+#ifndef USART_BAUD_RATE
+/** Baud rate of the serial link, in bits per second. This can be overridden
+  * by defining USART_BAUD_RATE in the platform's build settings. Rates
+  * above 115200 need a host-side bridge which can keep up; rates above
+  * about 1 Mbaud should only be used with USART_BLOCK_MODE, since without
+  * flow control the receive interrupt can't keep up. */
+#define USART_BAUD_RATE			57600
+#endif // #ifndef USART_BAUD_RATE
+
+/** Frequency of UART_CLK, in Hz. This is the main clock (see
+  * initSystemClock()) divided by UARTCLKDIV. */
+#define USART_CLOCK_FREQUENCY	48000000
+
+/** Depth of the transmit and receive hardware FIFOs, in bytes. */
+#define USART_FIFO_DEPTH		16
+
+/** Set the baud rate. The divisor latch, fractional divider and
+  * oversampling ratio are found by exhaustive search, so that any baud rate
+  * up to UART_CLK / 8 can be used. Among equally good settings, the one
+  * with the highest oversampling ratio (which is the most tolerant of
+  * noise) wins.
+  * \param baud_rate The desired baud rate, in bits per second.
+  */
+static void setBaudRate(uint32_t baud_rate)
+{
+	uint32_t oversample;
+	uint32_t mul;
+	uint32_t divadd;
+	uint32_t lowest_divisor;
+	uint32_t divisor;
+	uint32_t actual;
+	uint32_t error;
+	uint32_t best_error;
+	uint32_t best_oversample;
+	uint32_t best_mul;
+	uint32_t best_divadd;
+	uint32_t best_divisor;
+
+	// The baud rate is
+	// UART_CLK / (oversample * divisor * (1 + divadd / mul)).
+	best_error = 0xffffffff;
+	best_oversample = 16;
+	best_mul = 1;
+	best_divadd = 0;
+	best_divisor = 1;
+	for (oversample = 16; oversample >= 8; oversample--)
+	{
+		for (mul = 1; mul <= 15; mul++)
+		{
+			for (divadd = 0; divadd < mul; divadd++)
+			{
+				// The ideal divisor is usually not an integer, so try the
+				// integers on either side of it.
+				lowest_divisor = (USART_CLOCK_FREQUENCY * mul) / (oversample * baud_rate * (mul + divadd));
+				for (divisor = lowest_divisor; divisor <= (lowest_divisor + 1); divisor++)
+				{
+					// The fractional divider only works if the divisor is
+					// at least 3.
+					if ((divisor == 0) || (divisor > 0xffff) || ((divadd != 0) && (divisor < 3)))
+					{
+						continue;
+					}
+					actual = (USART_CLOCK_FREQUENCY * mul) / (oversample * divisor * (mul + divadd));
+					if (actual > baud_rate)
+					{
+						error = actual - baud_rate;
+					}
+					else
+					{
+						error = baud_rate - actual;
+					}
+					if (error < best_error)
+					{
+						best_error = error;
+						best_oversample = oversample;
+						best_mul = mul;
+						best_divadd = divadd;
+						best_divisor = divisor;
+					}
+				}
+			}
+		}
+	}
+
+	LPC_USART->LCR |= 0x80; // enable access to divisor latches
+	LPC_USART->FDR = (best_mul << 4) | best_divadd; // fractional divider = 1 + divadd / mul
+	LPC_USART->DLL = best_divisor & 0xff; // set least significant 8 bits of divisor latch
+	LPC_USART->DLM = best_divisor >> 8; // set most significant 8 bits of divisor latch
+	LPC_USART->OSR = (best_oversample - 1) << 4; // integer oversampling ratio
+	LPC_USART->LCR &= ~0x80; // disable access to divisor latches
+}
+
+/** Initialise USART at #USART_BAUD_RATE baud, 8 data bits, no parity and 1
+  * stop bit. If USART_BLOCK_MODE is defined, auto RTS/CTS flow control is
+  * also enabled, using PIO0_17 as RTS and PIO0_7 as CTS. */
 void initUsart(void)
 {
 	LPC_SYSCON->SYSAHBCLKCTRL |= 0x11000; // enable clock to IOCON and USART
 	LPC_IOCON->PIO0_18 = 0x91; // set RXD pin, pull-up enabled
 	LPC_IOCON->PIO0_19 = 0x91; // set TXD pin, pull-up enabled
+#ifdef USART_BLOCK_MODE
+	LPC_IOCON->PIO0_17 = 0x91; // set RTS pin, pull-up enabled
+	LPC_IOCON->PIO0_7 = 0x91; // set CTS pin, pull-up enabled
+#endif // #ifdef USART_BLOCK_MODE
 	LPC_SYSCON->UARTCLKDIV = 1; // UART_CLK divider = 1
 
-	// Set baud rate to 57600. The divisors were found by exhaustive search.
-	// The resulting baud rate is 48000000 / (16 * 27 * (1 + 13 / 14)),
-	// which differs from 57600 by 0.02%.
-	LPC_USART->LCR |= 0x80; // enable access to divisor latches
-	LPC_USART->FDR = 0xed; // fractional divider = 1 + 13 / 14
-	LPC_USART->DLL = 27; // set least significant 8 bits of divisor latch to 27
-	LPC_USART->DLM = 0; // set most significant 8 bits of divisor latch to 0
-	LPC_USART->OSR = 0xf0; // oversampling ratio = 16
-	LPC_USART->LCR &= ~0x80; // disable access to divisor latches
+	// For the default of 57600 baud, this picks an oversampling ratio of 15,
+	// a divisor of 50 and a fractional divider of 1 + 1 / 9, which is exact.
+	setBaudRate(USART_BAUD_RATE);
 	// Disable stuff that isn't used.
 	LPC_USART->ACR = 0; // no auto-baud
 	LPC_USART->ICR = 0; // disable IrDA mode
@@ -46,27 +150,65 @@ void initUsart(void)
 	LPC_USART->SYNCCTRL = 0; // disable synchronous mode
 	// Set other USART parameters.
 	LPC_USART->LCR = 0x03; // no parity, 8 data bits, 1 stop bit
-	LPC_USART->MCR = 0; // disable hardware flow control
 	LPC_USART->FCR = 1; // enable access to other bits of FCR
+#ifdef USART_BLOCK_MODE
+	// RTS is deasserted whenever the receive FIFO reaches the trigger level,
+	// and nothing is transmitted while CTS is deasserted.
+	LPC_USART->MCR = 0xc0; // enable auto RTS and auto CTS
+	LPC_USART->FCR = 0x87; // clear receive and transmit FIFOs, trigger level = 8 characters
+#else
+	LPC_USART->MCR = 0; // disable hardware flow control
 	LPC_USART->FCR = 7; // clear receive and transmit FIFOs, trigger level = 1 character
+#endif // #ifdef USART_BLOCK_MODE
 	LPC_USART->TER = 0x80; // enable transmit
 	LPC_USART->IER = 7; // enable receive, transmit and error interrupts
 	NVIC_EnableIRQ(21); // 21 = USART interrupt
 }
 
-/** Interrupt request handler for USART. This is invoked in 3 situations:
-  * - whenever a byte is received,
-  * - another byte can be shoved into the transmit FIFO,
+/** Move bytes from the transmit buffer into the transmit FIFO. This must
+  * only be called when THR is empty, and with interrupts disabled or from
+  * UART_IRQHandler().
+  * \param is_irq Use true if calling this from an interrupt
+  *               request handler, otherwise use false.
+  */
+static void fillTransmitFIFO(bool is_irq)
+{
+#ifdef USART_BLOCK_MODE
+	unsigned int i;
+
+	// THRE means the whole transmit FIFO is empty, so it can take a full
+	// FIFO's worth.
+	for (i = 0; (i < USART_FIFO_DEPTH) && !isCircularBufferEmpty(&transmit_buffer); i++)
+	{
+		LPC_USART->THR = circularBufferRead(&transmit_buffer, is_irq);
+	}
+#else
+	if (!isCircularBufferEmpty(&transmit_buffer))
+	{
+		LPC_USART->THR = circularBufferRead(&transmit_buffer, is_irq);
+	}
+#endif // #ifdef USART_BLOCK_MODE
+}
+
+/** Interrupt request handler for USART. This is invoked in 4 situations:
+  * - whenever the receive FIFO reaches its trigger level,
+  * - no byte has been received for 3.5 to 4.5 character times, but the
+  *   receive FIFO is not empty (character timeout),
+  * - the transmit FIFO has emptied, so more bytes can be shoved into it,
   * - a receive error occurs.
+  *
+  * The receive FIFO is drained completely each time. Without
+  * USART_BLOCK_MODE, the trigger level is 1 character, so character
+  * timeouts are rare.
   */
 void UART_IRQHandler(void)
 {
 	uint32_t source;
 
 	source = ((uint32_t)LPC_USART->IIR >> 1) & 7;
-	if (source == 2)
+	if ((source == 2) || (source == 6))
 	{
-		// Receive data available interrupt.
+		// Receive data available or character timeout interrupt.
 		// Move bytes from RBR into circular buffer until hardware FIFO is empty.
 		while (LPC_USART->LSR & 0x01)
 		{
@@ -76,10 +218,10 @@ void UART_IRQHandler(void)
 	else if (source == 1)
 	{
 		// THRE (Transmit Holding Register Empty) interrupt.
-		if (!isCircularBufferEmpty(&transmit_buffer) && (LPC_USART->LSR & 0x20))
+		if (LPC_USART->LSR & 0x20)
 		{
-			// There's data to send and THR is empty.
-			LPC_USART->THR = circularBufferRead(&transmit_buffer, true);
+			// THR is empty.
+			fillTransmitFIFO(true);
 		}
 	}
 	else
@@ -93,19 +235,21 @@ void UART_IRQHandler(void)
 /** This must be called whenever the transmit buffer transitions from empty
   * to non-empty, in order to initiate the transmission of the contents of the
   * transmit buffer.
-  * This function may directly handle the transmission of the first byte (the
-  * interrupt handler UART_IRQHandler() will handle the rest).
+  * This function may directly handle the transmission of the first byte (or
+  * the first FIFO's worth, if USART_BLOCK_MODE is defined); the interrupt
+  * handler UART_IRQHandler() will handle the rest.
   */
 void serialSendNotify(void)
 {
 	// Need to disable interrupts otherwise the transmit buffer might be
 	// emptied between the check and use.
 	__disable_irq();
-	if (!isCircularBufferEmpty(&transmit_buffer) && (LPC_USART->LSR & 0x20))
+	if (LPC_USART->LSR & 0x20)
 	{
-		// There's data to send and THR is empty.
-		LPC_USART->THR = circularBufferRead(&transmit_buffer, false);
-		// Warning: circularBufferRead() enables interrupts.
+		// THR is empty.
+		fillTransmitFIFO(false);
 	}
 	__enable_irq();
 }
+
+#endif // #ifndef USB_HID_TRANSPORT
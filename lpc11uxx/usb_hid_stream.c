@@ -0,0 +1,566 @@
+/** \file usb_hid_stream.c
+  *
+  * \brief Interfaces circular buffers to the LPC11Uxx's USB controller.
+  *
+  * This is an alternative to usart.c which is used if USB_HID_TRANSPORT is
+  * defined. It uses the USB device stack in the LPC11Uxx's ROM to present a
+  * HID device which transfers data in the same way as pic32/usb_hid_stream.c
+  * does: the stream is broken up into chunks of up to 63 bytes, and those
+  * chunks are sent as HID reports where the report ID is the chunk size.
+  * Thus the same host software can talk to either device.
+  *
+  * Unlike the serial link, USB has its own flow control: the controller
+  * NAKs the host while an Interrupt OUT report is waiting to be read. So the
+  * acknowledgement scheme in serial_fifo.c isn't used; received reports are
+  * only read out of the controller when there is space for them in the
+  * receive buffer. The circular buffers themselves are still the ones in
+  * serial_fifo.c.
+  *
+  * The control endpoint "Set Report" request is supported, because the
+  * hidraw driver on Linux kernels earlier than 2.6.35 uses it to send
+  * reports. The "Get Report" request is not supported; hosts should read
+  * reports from the Interrupt IN endpoint.
+  *
+  * This needs the headers which describe the USB ROM driver API; see the
+  * README. All references to the "LPC11Uxx user manual" refer to UM10462,
+  * revision 4.
+  *
+  * This file is licensed as described by the file LICENCE.
+  */
+
+#ifdef USB_HID_TRANSPORT
+
+#include "LPC11Uxx.h"
+#include "mw_usbd_rom_api.h"
+#include "../common.h"
+#include "../hwinterface.h"
+#include "serial_fifo.h"
+#include "usb_hid_stream.h"
+#include "../pic32/usb_defs.h"
+
+// The report descriptor is shared with the PIC32 port, so that the reports
+// look exactly the same to the host.
+#define ONLY_INCLUDE_REPORT_DESCRIPTOR
+#include "../pic32/usb_descriptors.h"
+
+/** Address of the pointer to the table of ROM drivers. The first entry in
+  * that table points to the USB driver API. See the LPC11Uxx user manual,
+  * section 10.4. */
+#define ROM_DRIVER_TABLE_LOCATION	0x1fff1ff8
+/** Start address of USB RAM. The USB ROM driver needs its memory to be
+  * aligned to 2048 bytes, and this is. */
+#define USBRAM_START				((volatile uint8_t *)0x20004000)
+/** The Interrupt IN endpoint address (endpoint 1, IN). */
+#define HID_ENDPOINT_IN				0x81
+/** The Interrupt OUT endpoint address (endpoint 1, OUT). */
+#define HID_ENDPOINT_OUT			0x01
+/** Maximum packet size of the Interrupt endpoints, in bytes. A report is
+  * one report ID byte followed by up to (#HID_PACKET_SIZE - 1) data bytes. */
+#define HID_PACKET_SIZE				64
+
+/** Index of manufacturer string descriptor. */
+#define MANUFACTURER_STRING_INDEX	1
+/** Index of product string descriptor. */
+#define PRODUCT_STRING_INDEX		2
+/** Index of serial number string descriptor. */
+#define SERIAL_NO_STRING_INDEX		3
+
+/** State which must survive sanitiseRam(). */
+typedef struct USBStreamStateStruct
+{
+	/** Handle given by the USB ROM driver, which identifies the device. */
+	USBD_HANDLE_T usb_handle;
+	/** Whether the host has configured the device. */
+	volatile bool configured;
+	/** Whether a report is being transmitted on the Interrupt IN
+	  * endpoint. */
+	volatile bool transmit_busy;
+	/** Whether a report has been received on the Interrupt OUT endpoint,
+	  * but is still waiting for space in the receive buffer. */
+	volatile bool receive_pending;
+} USBStreamState;
+
+/** State of the USB stream.
+  * \warning This is stored in USB RAM, just below the circular buffers,
+  *          because sanitiseRam() clears everything in main RAM. Since this
+  *          pointer is initialised, it's not in the BSS section, so
+  *          sanitiseRam() doesn't clear it either.
+  */
+static volatile USBStreamState *usb_state = ((volatile USBStreamState *)USBRAM_FIFO_START) - 1;
+
+/** Device descriptor. See section 9.6.1 of the USB specification for
+  * details on the format. This is the same as the PIC32's, so that host
+  * software finds the device in the same way.
+  * \showinitializer
+  */
+static const uint8_t device_descriptor[] __attribute__((aligned(4))) = {
+0x12, // length of this descriptor in bytes
+DESCRIPTOR_DEVICE, // descriptor type
+0x00, 0x02, // USB version number in little-endian BCD (v2.00)
+0x00, // device class (0 = refer to interface)
+0x00, // device subclass (0 = refer to interface)
+0x00, // device protocol (0 = refer to interface)
+0x40, // maximum packet size for control endpoint (endpoint 0)
+0xf3, 0x04, // vendor ID (little-endian)
+0x10, 0x02, // product ID (little-endian)
+0x90, 0x22, // device release number in little-endian BCD
+MANUFACTURER_STRING_INDEX, // index of string descriptor describing manufacturer
+PRODUCT_STRING_INDEX, // index of string descriptor describing product
+SERIAL_NO_STRING_INDEX, // index of string descriptor describing serial number
+0x01 // number of configurations
+};
+
+/** Configuration descriptor, followed by the interface, HID and endpoint
+  * descriptors, as a "Get Descriptor" request for the configuration needs
+  * to return all of them (see section 9.4.3 of the USB specification). The
+  * USB ROM driver needs this to be word-aligned.
+  * \showinitializer
+  */
+static const uint8_t configuration_descriptor[] __attribute__((aligned(4))) = {
+// Configuration descriptor:
+0x09, // length of this descriptor in bytes
+DESCRIPTOR_CONFIGURATION, // descriptor type
+0x29, 0x00, // total length of all included descriptors in bytes (little-endian)
+0x01, // number of interfaces supported by this configuration
+0x01, // configuration value
+0x00, // index of string descriptor describing configuration (0 = none)
+0x80, // attributes (0x80 = not self-powered, no remote wakeup)
+0x32, // maximum current consumption in 2 mA units (0x32 = 100 mA)
+// Interface descriptor:
+0x09, // length of this descriptor in bytes
+DESCRIPTOR_INTERFACE, // descriptor type
+0x00, // number of this interface (0 = first)
+0x00, // alternate setting (0 = default)
+0x02, // number of endpoints used by this interface, not including control endpoint
+0x03, // interface class (3 = HID)
+0x00, // interface subclass (0 = no subclass)
+0x00, // interface protocol (0 = none)
+0x00, // index of string descriptor describing interface (0 = none)
+// HID descriptor:
+0x09, // length of this descriptor in bytes
+DESCRIPTOR_HID, // descriptor type
+0x11, 0x01, // HID version number in little-endian BCD (v1.11)
+0x00, // country code (0 = not supported)
+0x01, // number of report descriptors
+DESCRIPTOR_REPORT, // descriptor type of report descriptor
+0x03, 0x03, // total size of report descriptors in bytes (little-endian)
+// Endpoint 1 IN descriptor:
+0x07, // length of this descriptor in bytes
+DESCRIPTOR_ENDPOINT, // descriptor type
+HID_ENDPOINT_IN, // endpoint number; bit 7 set means IN, endpoint 1
+0x03, // attributes (3 = interrupt transfers)
+0x40, 0x00, // maximum packet size of this endpoint in bytes (little-endian)
+0x0a, // polling interval, in millisecond
+// Endpoint 1 OUT descriptor:
+0x07, // length of this descriptor in bytes
+DESCRIPTOR_ENDPOINT, // descriptor type
+HID_ENDPOINT_OUT, // endpoint number; bit 7 clear means OUT, endpoint 1
+0x03, // attributes (3 = interrupt transfers)
+0x40, 0x00, // maximum packet size of this endpoint in bytes (little-endian)
+0x01, // polling interval, in millisecond
+};
+
+/** All string descriptors, one after the other, in the order of their
+  * indices. The USB ROM driver finds each one by walking through the
+  * lengths. The first one is the list of supported languages.
+  * \showinitializer
+  */
+static const uint8_t string_descriptors[] __attribute__((aligned(4))) = {
+// Language list:
+0x04, // length of this descriptor in bytes
+DESCRIPTOR_STRING, // descriptor type
+0x09, 0x04, // English (United States)
+// Manufacturer (index 1):
+0x18, // length of this descriptor in bytes
+DESCRIPTOR_STRING,
+'H', 0, 'e', 0, 'l', 0, 'l', 0, 'o', 0, ' ', 0, 'w', 0, 'o', 0,
+'r', 0, 'l', 0, 'd', 0,
+// Product (index 2):
+0x30, // length of this descriptor in bytes
+DESCRIPTOR_STRING,
+'H', 0, 'a', 0, 'r', 0, 'd', 0, 'w', 0, 'a', 0, 'r', 0, 'e', 0,
+' ', 0, 'B', 0, 'i', 0, 't', 0, 'c', 0, 'o', 0, 'i', 0, 'n', 0,
+' ', 0, 'w', 0, 'a', 0, 'l', 0, 'l', 0, 'e', 0, 't', 0,
+// Serial number (index 3):
+0x0c, // length of this descriptor in bytes
+DESCRIPTOR_STRING,
+'1', 0, '2', 0, '3', 0, '4', 0, '5', 0};
+
+/** Get the USB ROM driver API. This is looked up every time instead of being
+  * remembered in a variable, because sanitiseRam() clears variables.
+  * \return A pointer to the USB ROM driver API.
+  */
+static const USBD_API_T *getUSBDriver(void)
+{
+	return **((const USBD_API_T ***)ROM_DRIVER_TABLE_LOCATION);
+}
+
+/** Check whether there is enough space in the receive buffer to read a
+  * whole report out of the Interrupt OUT endpoint.
+  * \return true if there is enough space, false if not.
+  */
+static bool isSpaceForReport(void)
+{
+	if ((receive_buffer.size - (receive_buffer.head - receive_buffer.tail)) >= (HID_PACKET_SIZE - 1))
+	{
+		return true;
+	}
+	else
+	{
+		return false;
+	}
+}
+
+/** Copy the data of a received report into the receive buffer. If the
+  * report is malformed, an error is signalled in the receive buffer.
+  * \param report The report. The first byte is the report ID, which is also
+  *               the number of data bytes.
+  * \param length The length of the report (including the report ID byte), in
+  *               bytes.
+  * \warning The caller must check that there is space (see
+  *          isSpaceForReport()).
+  */
+static void transferReport(const uint8_t *report, uint32_t length)
+{
+	uint32_t count;
+	uint32_t i;
+
+	if (length == 0)
+	{
+		return;
+	}
+	count = report[0];
+	if ((count > (length - 1)) || (count > (HID_PACKET_SIZE - 1)))
+	{
+		circularBufferSignalError(&receive_buffer);
+		return;
+	}
+	for (i = 0; i < count; i++)
+	{
+		circularBufferWrite(&receive_buffer, report[i + 1], true);
+	}
+}
+
+/** Read the report which is waiting in the Interrupt OUT endpoint into the
+  * receive buffer. Reading it lets the controller accept the next one.
+  * \warning This must be called with interrupts disabled (or from an
+  *          interrupt context).
+  */
+static void readPendingReport(void)
+{
+	uint8_t report[HID_PACKET_SIZE];
+	uint32_t length;
+
+	length = getUSBDriver()->hw->ReadEP(usb_state->usb_handle, HID_ENDPOINT_OUT, report);
+	usb_state->receive_pending = false;
+	transferReport(report, length);
+}
+
+/** Take up to (#HID_PACKET_SIZE - 1) bytes from the transmit buffer and
+  * send them as a report on the Interrupt IN endpoint, if the endpoint is
+  * idle and there is something to send.
+  * \warning This must be called with interrupts disabled (or from an
+  *          interrupt context).
+  */
+static void transmitNextReport(void)
+{
+	uint8_t report[HID_PACKET_SIZE];
+	uint32_t count;
+
+	if (!usb_state->configured || usb_state->transmit_busy
+		|| isCircularBufferEmpty(&transmit_buffer))
+	{
+		return;
+	}
+	count = 0;
+	while ((count < (HID_PACKET_SIZE - 1)) && !isCircularBufferEmpty(&transmit_buffer))
+	{
+		report[count + 1] = circularBufferRead(&transmit_buffer, true);
+		count++;
+	}
+	report[0] = (uint8_t)count;
+	usb_state->transmit_busy = true;
+	getUSBDriver()->hw->WriteEP(usb_state->usb_handle, HID_ENDPOINT_IN, report, count + 1);
+}
+
+/** Called by the USB ROM driver whenever the Interrupt IN endpoint has
+  * finished transmitting a report.
+  * \param usb_handle The device's handle.
+  * \param data Unused.
+  * \param event The endpoint event.
+  * \return LPC_OK if the event was handled, ERR_USBD_UNHANDLED otherwise.
+  */
+static ErrorCode_t hidEndpointIn(USBD_HANDLE_T usb_handle, void *data, uint32_t event)
+{
+	if (event != USB_EVT_IN)
+	{
+		return ERR_USBD_UNHANDLED;
+	}
+	usb_state->transmit_busy = false;
+	transmitNextReport();
+	return LPC_OK;
+}
+
+/** Called by the USB ROM driver whenever a report has been received on the
+  * Interrupt OUT endpoint. If there isn't space for it yet, it's left in
+  * the endpoint (so that the host is NAKed) until streamGetOneByte() or
+  * streamGetBytes() makes space.
+  * \param usb_handle The device's handle.
+  * \param data Unused.
+  * \param event The endpoint event.
+  * \return LPC_OK if the event was handled, ERR_USBD_UNHANDLED otherwise.
+  */
+static ErrorCode_t hidEndpointOut(USBD_HANDLE_T usb_handle, void *data, uint32_t event)
+{
+	if (event != USB_EVT_OUT)
+	{
+		return ERR_USBD_UNHANDLED;
+	}
+	usb_state->receive_pending = true;
+	if (isSpaceForReport())
+	{
+		readPendingReport();
+	}
+	return LPC_OK;
+}
+
+/** Called by the USB ROM driver when the host sends a "Set Report" request
+  * through the control endpoint.
+  * \param hid_handle The HID class handle.
+  * \param setup The setup packet of the request.
+  * \param buffer Points to a pointer to the received report.
+  * \param length The length of the received report, in bytes.
+  * \return LPC_OK if the report was accepted, ERR_USBD_STALL otherwise.
+  */
+static ErrorCode_t hidSetReport(USBD_HANDLE_T hid_handle, USB_SETUP_PACKET *setup, uint8_t **buffer, uint16_t length)
+{
+	if ((setup->wValue.WB.H != REPORT_TYPE_OUTPUT) || !isSpaceForReport())
+	{
+		// There's no way to NAK a control transfer's data stage from here,
+		// so a report which doesn't fit has to be refused.
+		return ERR_USBD_STALL;
+	}
+	transferReport(*buffer, length);
+	return LPC_OK;
+}
+
+/** Called by the USB ROM driver when the host sends a "Get Report" request
+  * through the control endpoint. This isn't supported.
+  * \param hid_handle The HID class handle.
+  * \param setup The setup packet of the request.
+  * \param buffer Unused.
+  * \param length Unused.
+  * \return Always ERR_USBD_STALL.
+  */
+static ErrorCode_t hidGetReport(USBD_HANDLE_T hid_handle, USB_SETUP_PACKET *setup, uint8_t **buffer, uint16_t *length)
+{
+	return ERR_USBD_STALL;
+}
+
+/** Called by the USB ROM driver when the host configures the device.
+  * \param usb_handle The device's handle.
+  * \return Always LPC_OK.
+  */
+static ErrorCode_t usbConfigureEvent(USBD_HANDLE_T usb_handle)
+{
+	usb_state->configured = true;
+	usb_state->transmit_busy = false;
+	transmitNextReport();
+	return LPC_OK;
+}
+
+/** Called by the USB ROM driver when the bus is reset.
+  * \param usb_handle The device's handle.
+  * \return Always LPC_OK.
+  */
+static ErrorCode_t usbResetEvent(USBD_HANDLE_T usb_handle)
+{
+	usb_state->configured = false;
+	usb_state->transmit_busy = false;
+	usb_state->receive_pending = false;
+	return LPC_OK;
+}
+
+/** Initialise the LPC11Uxx's USB controller and the USB ROM driver, then
+  * connect to the host. This must be called after the system clock has
+  * been set up (the USB controller is clocked from the 48 MHz main
+  * clock) and after initSerialFIFO().
+  */
+void initUSBHIDStream(void)
+{
+	const USBD_API_T *usbd;
+	USBD_API_INIT_PARAM_T usb_param;
+	USBD_HID_INIT_PARAM_T hid_param;
+	USB_CORE_DESCS_T descriptors;
+	USB_HID_REPORT_T report_info;
+
+	LPC_SYSCON->SYSAHBCLKCTRL |= 0x08014000; // enable clock to USB, USBRAM and IOCON
+	LPC_SYSCON->PDRUNCFG &= ~0x400; // power up USB transceiver
+	LPC_SYSCON->USBCLKSEL = 1; // USB clock source is main clock
+	LPC_SYSCON->USBCLKUEN = 0; // toggle USB clock source update enable
+	LPC_SYSCON->USBCLKUEN = 1;
+	LPC_SYSCON->USBCLKDIV = 1; // USB clock divider = 1
+	LPC_IOCON->PIO0_3 = 0x01; // set USB_VBUS pin
+	LPC_IOCON->PIO0_6 = 0x01; // set USB_CONNECT pin
+
+	usb_state->configured = false;
+	usb_state->transmit_busy = false;
+	usb_state->receive_pending = false;
+
+	usbd = getUSBDriver();
+	memset(&usb_param, 0, sizeof(usb_param));
+	usb_param.usb_reg_base = LPC_USB_BASE;
+	usb_param.mem_base = (uint32_t)USBRAM_START;
+	usb_param.mem_size = (uint32_t)usb_state - (uint32_t)USBRAM_START;
+	usb_param.max_num_ep = 2; // control endpoint and endpoint 1
+	usb_param.USB_Configure_Event = usbConfigureEvent;
+	usb_param.USB_Reset_Event = usbResetEvent;
+	descriptors.device_desc = (uint8_t *)device_descriptor;
+	descriptors.string_desc = (uint8_t *)string_descriptors;
+	descriptors.full_speed_desc = (uint8_t *)configuration_descriptor;
+	descriptors.high_speed_desc = (uint8_t *)configuration_descriptor;
+	descriptors.device_qualifier = NULL;
+	if (usbd->hw->Init((USBD_HANDLE_T *)&(usb_state->usb_handle), &descriptors, &usb_param) != LPC_OK)
+	{
+		fatalError();
+	}
+
+	// Init() advances mem_base and mem_size past the memory it used.
+	memset(&hid_param, 0, sizeof(hid_param));
+	hid_param.mem_base = usb_param.mem_base;
+	hid_param.mem_size = usb_param.mem_size;
+	hid_param.max_reports = 1;
+	hid_param.intf_desc = (uint8_t *)&(configuration_descriptor[9]);
+	report_info.len = sizeof(report_descriptor);
+	report_info.idle_time = 0;
+	report_info.desc = (uint8_t *)report_descriptor;
+	hid_param.report_data = &report_info;
+	hid_param.HID_GetReport = hidGetReport;
+	hid_param.HID_SetReport = hidSetReport;
+	hid_param.HID_EpIn_Hdlr = hidEndpointIn;
+	hid_param.HID_EpOut_Hdlr = hidEndpointOut;
+	if (usbd->hid->init(usb_state->usb_handle, &hid_param) != LPC_OK)
+	{
+		fatalError();
+	}
+
+	NVIC_EnableIRQ(USB_IRQn);
+	usbd->hw->Connect(usb_state->usb_handle, 1);
+}
+
+/** Interrupt request handler for the USB controller. Everything is passed on
+  * to the USB ROM driver, which calls the event handlers in this file. */
+void USB_IRQHandler(void)
+{
+	getUSBDriver()->hw->ISR(usb_state->usb_handle);
+}
+
+/** If a received report is waiting for space in the receive buffer and
+  * there now is space, read it. */
+static void checkPendingReport(void)
+{
+	__disable_irq();
+	if (usb_state->receive_pending && isSpaceForReport())
+	{
+		readPendingReport();
+	}
+	__enable_irq();
+}
+
+/** Start transmitting the contents of the transmit buffer, if the Interrupt
+  * IN endpoint is idle. */
+static void usbSendNotify(void)
+{
+	__disable_irq();
+	transmitNextReport();
+	__enable_irq();
+}
+
+/** Grab one byte from the communication stream. There is no way for this
+  * function to indicate a read error. This is intentional; it
+  * makes program flow simpler (no need to put checks everywhere). As a
+  * consequence, this function should only return if the received byte is
+  * free of read errors. See the serial_fifo.c version of this function for
+  * more justification.
+  * \return The received byte.
+  */
+uint8_t streamGetOneByte(void)
+{
+	uint8_t one_byte;
+
+	one_byte = circularBufferRead(&receive_buffer, false);
+	checkPendingReport();
+	return one_byte;
+}
+
+/** Send one byte to the communication stream. There is no way for this
+  * function to indicate a write error. This is intentional; it
+  * makes program flow simpler (no need to put checks everywhere). As a
+  * consequence, this function should only return if the byte was sent
+  * free of write errors.
+  * \param one_byte The byte to send.
+  */
+void streamPutOneByte(uint8_t one_byte)
+{
+	circularBufferWrite(&transmit_buffer, one_byte, false);
+	usbSendNotify();
+}
+
+/** Grab a number of bytes from the communication stream. This behaves
+  * exactly like calling streamGetOneByte() length times, but bytes are
+  * removed from the receive buffer in chunks.
+  * \param buffer The received bytes will be written here. This must have
+  *               space for length bytes.
+  * \param length The number of bytes to receive.
+  */
+void streamGetBytes(uint8_t *buffer, uint32_t length)
+{
+	uint32_t count;
+
+	while (length > 0)
+	{
+		count = circularBufferReadBytes(&receive_buffer, buffer, length);
+		checkPendingReport();
+		buffer += count;
+		length -= count;
+	}
+}
+
+/** Throw away a number of bytes from the communication stream. This behaves
+  * exactly like streamGetBytes(), but whatever is in the receive buffer is
+  * dropped in one go, so that a report waiting for space can be read
+  * straight away.
+  * \param length The number of bytes to throw away.
+  */
+void streamDiscardBytes(uint32_t length)
+{
+	uint32_t count;
+
+	while (length > 0)
+	{
+		count = circularBufferDiscardBytes(&receive_buffer, length);
+		checkPendingReport();
+		length -= count;
+	}
+}
+
+/** Send a number of bytes to the communication stream. This behaves exactly
+  * like calling streamPutOneByte() length times, but bytes are added to the
+  * transmit buffer in chunks, so that they can go out in full reports.
+  * \param buffer The bytes to send.
+  * \param length The number of bytes to send.
+  */
+void streamPutBytes(const uint8_t *buffer, uint32_t length)
+{
+	uint32_t count;
+
+	while (length > 0)
+	{
+		count = circularBufferWriteBytes(&transmit_buffer, buffer, length);
+		usbSendNotify();
+		buffer += count;
+		length -= count;
+	}
+}
+
+#endif // #ifdef USB_HID_TRANSPORT
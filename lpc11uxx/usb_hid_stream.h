@@ -0,0 +1,15 @@
+/** \file usb_hid_stream.h
+  *
+  * \brief Describes functions exported by usb_hid_stream.c.
+  *
+  * This file is licensed as described by the file LICENCE.
+  */
+
+#ifndef LPC11UXX_USB_HID_STREAM_H_INCLUDED
+#define LPC11UXX_USB_HID_STREAM_H_INCLUDED
+
+#include "../common.h"
+
+extern void initUSBHIDStream(void);
+
+#endif // #ifndef LPC11UXX_USB_HID_STREAM_H_INCLUDED
@@ -6,17 +6,25 @@
 const uint32_t DeleteWallet_wallet_handle_default = 0;
 const uint32_t NewWallet_wallet_number_default = 0;
 const bool NewWallet_is_hidden_default = false;
+const bool NewWallet_keep_unlocked_default = false;
+const bool SignTransactionBatch_use_bip143_default = false;
 const uint32_t LoadWallet_wallet_number_default = 0;
 const bool BackupWallet_is_encrypted_default = false;
 const uint32_t BackupWallet_device_default = 0;
+const bool BackupWallet_to_host_default = false;
+const bool GetAddressRange_omit_addresses_default = false;
+const uint32_t GetWalletSnapshot_wallet_number_default = 0;
 
 
-const pb_field_t Initialize_fields[2] = {
+const pb_field_t Initialize_fields[5] = {
     PB_FIELD2(  1, BYTES   , REQUIRED, STATIC, FIRST, Initialize, session_id, session_id, 0),
+    PB_FIELD2(  2, BOOL    , OPTIONAL, STATIC, OTHER, Initialize, use_tagged_packets, session_id, 0),
+    PB_FIELD2(  3, BOOL    , OPTIONAL, STATIC, OTHER, Initialize, lock_wallets, use_tagged_packets, 0),
+    PB_FIELD2(  4, BOOL    , OPTIONAL, STATIC, OTHER, Initialize, implicit_button_ack, lock_wallets, 0),
     PB_LAST_FIELD
 };
 
-const pb_field_t Features_fields[11] = {
+const pb_field_t Features_fields[13] = {
     PB_FIELD2(  1, BYTES   , REQUIRED, STATIC, FIRST, Features, echoed_session_id, echoed_session_id, 0),
     PB_FIELD2(  2, STRING  , OPTIONAL, CALLBACK, OTHER, Features, vendor, echoed_session_id, 0),
     PB_FIELD2(  3, UINT32  , OPTIONAL, STATIC, OTHER, Features, major_version, vendor, 0),
@@ -27,6 +35,8 @@ const pb_field_t Features_fields[11] = {
     PB_FIELD2(  8, BOOL    , OPTIONAL, STATIC, OTHER, Features, spv, pin, 0),
     PB_FIELD2(  9, ENUM    , REPEATED, STATIC, OTHER, Features, algo, spv, 0),
     PB_FIELD2( 10, BOOL    , OPTIONAL, STATIC, OTHER, Features, debug_link, algo, 0),
+    PB_FIELD2( 11, UINT32  , OPTIONAL, STATIC, OTHER, Features, max_outstanding_requests, debug_link, 0),
+    PB_FIELD2( 12, BOOL    , OPTIONAL, STATIC, OTHER, Features, implicit_button_ack, max_outstanding_requests, 0),
     PB_LAST_FIELD
 };
 
@@ -94,11 +104,12 @@ const pb_field_t DeleteWallet_fields[2] = {
     PB_LAST_FIELD
 };
 
-const pb_field_t NewWallet_fields[5] = {
+const pb_field_t NewWallet_fields[6] = {
     PB_FIELD2(  1, UINT32  , OPTIONAL, STATIC, FIRST, NewWallet, wallet_number, wallet_number, &NewWallet_wallet_number_default),
     PB_FIELD2(  2, BYTES   , OPTIONAL, CALLBACK, OTHER, NewWallet, password, wallet_number, 0),
     PB_FIELD2(  3, BYTES   , OPTIONAL, STATIC, OTHER, NewWallet, wallet_name, password, 0),
     PB_FIELD2(  4, BOOL    , OPTIONAL, STATIC, OTHER, NewWallet, is_hidden, wallet_name, &NewWallet_is_hidden_default),
+    PB_FIELD2(  5, BOOL    , OPTIONAL, STATIC, OTHER, NewWallet, keep_unlocked, is_hidden, &NewWallet_keep_unlocked_default),
     PB_LAST_FIELD
 };
 
@@ -109,7 +120,7 @@ const pb_field_t NewAddress_fields[1] = {
 const pb_field_t Address_fields[4] = {
     PB_FIELD2(  1, UINT32  , REQUIRED, STATIC, FIRST, Address, address_handle, address_handle, 0),
     PB_FIELD2(  2, BYTES   , REQUIRED, STATIC, OTHER, Address, public_key, address_handle, 0),
-    PB_FIELD2(  3, BYTES   , REQUIRED, STATIC, OTHER, Address, address, public_key, 0),
+    PB_FIELD2(  3, BYTES   , OPTIONAL, STATIC, OTHER, Address, address, public_key, 0),
     PB_LAST_FIELD
 };
 
@@ -138,8 +149,22 @@ const pb_field_t Signature_fields[2] = {
     PB_LAST_FIELD
 };
 
-const pb_field_t LoadWallet_fields[2] = {
+const pb_field_t SignTransactionBatch_fields[5] = {
+    PB_FIELD2(  1, UINT32  , REPEATED, STATIC, FIRST, SignTransactionBatch, address_handle, address_handle, 0),
+    PB_FIELD2(  2, UINT32  , REPEATED, STATIC, OTHER, SignTransactionBatch, input_index, address_handle, 0),
+    PB_FIELD2(  3, BOOL    , OPTIONAL, STATIC, OTHER, SignTransactionBatch, use_bip143, input_index, &SignTransactionBatch_use_bip143_default),
+    PB_FIELD2(  4, BYTES   , REQUIRED, CALLBACK, OTHER, SignTransactionBatch, transaction_data, use_bip143, 0),
+    PB_LAST_FIELD
+};
+
+const pb_field_t Signatures_fields[2] = {
+    PB_FIELD2(  1, MESSAGE , REPEATED, CALLBACK, FIRST, Signatures, signature, signature, &Signature_fields),
+    PB_LAST_FIELD
+};
+
+const pb_field_t LoadWallet_fields[3] = {
     PB_FIELD2(  1, UINT32  , OPTIONAL, STATIC, FIRST, LoadWallet, wallet_number, wallet_number, &LoadWallet_wallet_number_default),
+    PB_FIELD2(  2, BYTES   , OPTIONAL, CALLBACK, OTHER, LoadWallet, password, wallet_number, 0),
     PB_LAST_FIELD
 };
 
@@ -158,7 +183,10 @@ const pb_field_t ChangeWalletName_fields[2] = {
     PB_LAST_FIELD
 };
 
-const pb_field_t ListWallets_fields[1] = {
+const pb_field_t ListWallets_fields[4] = {
+    PB_FIELD2(  1, UINT32  , OPTIONAL, STATIC, FIRST, ListWallets, start_wallet_number, start_wallet_number, 0),
+    PB_FIELD2(  2, UINT32  , OPTIONAL, STATIC, OTHER, ListWallets, number_of_wallets, start_wallet_number, 0),
+    PB_FIELD2(  3, UINT32  , OPTIONAL, STATIC, OTHER, ListWallets, changed_since, number_of_wallets, 0),
     PB_LAST_FIELD
 };
 
@@ -169,20 +197,33 @@ const pb_field_t WalletInfo_fields[4] = {
     PB_LAST_FIELD
 };
 
-const pb_field_t Wallets_fields[2] = {
+const pb_field_t Wallets_fields[5] = {
     PB_FIELD2(  1, MESSAGE , REPEATED, CALLBACK, FIRST, Wallets, wallet_info, wallet_info, &WalletInfo_fields),
+    PB_FIELD2(  2, UINT32  , OPTIONAL, STATIC, OTHER, Wallets, generation, wallet_info, 0),
+    PB_FIELD2(  3, UINT32  , OPTIONAL, STATIC, OTHER, Wallets, next_wallet_number, generation, 0),
+    PB_FIELD2(  4, BOOL    , OPTIONAL, STATIC, OTHER, Wallets, unchanged, next_wallet_number, 0),
     PB_LAST_FIELD
 };
 
-const pb_field_t BackupWallet_fields[3] = {
+const pb_field_t BackupWallet_fields[4] = {
     PB_FIELD2(  1, BOOL    , OPTIONAL, STATIC, FIRST, BackupWallet, is_encrypted, is_encrypted, &BackupWallet_is_encrypted_default),
     PB_FIELD2(  2, UINT32  , OPTIONAL, STATIC, OTHER, BackupWallet, device, is_encrypted, &BackupWallet_device_default),
+    PB_FIELD2(  3, BOOL    , OPTIONAL, STATIC, OTHER, BackupWallet, to_host, device, &BackupWallet_to_host_default),
+    PB_LAST_FIELD
+};
+
+const pb_field_t WalletBackup_fields[4] = {
+    PB_FIELD2(  1, BYTES   , REQUIRED, STATIC, FIRST, WalletBackup, wallet_uuid, wallet_uuid, 0),
+    PB_FIELD2(  2, BYTES   , REQUIRED, STATIC, OTHER, WalletBackup, encrypted_seed, wallet_uuid, 0),
+    PB_FIELD2(  3, BYTES   , REQUIRED, STATIC, OTHER, WalletBackup, digest, encrypted_seed, 0),
     PB_LAST_FIELD
 };
 
-const pb_field_t RestoreWallet_fields[3] = {
+const pb_field_t RestoreWallet_fields[5] = {
     PB_FIELD2(  1, MESSAGE , REQUIRED, STATIC, FIRST, RestoreWallet, new_wallet, new_wallet, &NewWallet_fields),
     PB_FIELD2(  2, BYTES   , REQUIRED, STATIC, OTHER, RestoreWallet, seed, new_wallet, 0),
+    PB_FIELD2(  3, BYTES   , OPTIONAL, STATIC, OTHER, RestoreWallet, wallet_uuid, seed, 0),
+    PB_FIELD2(  4, BYTES   , OPTIONAL, STATIC, OTHER, RestoreWallet, digest, wallet_uuid, 0),
     PB_LAST_FIELD
 };
 
@@ -195,13 +236,18 @@ const pb_field_t DeviceUUID_fields[2] = {
     PB_LAST_FIELD
 };
 
-const pb_field_t GetEntropy_fields[2] = {
+const pb_field_t GetEntropy_fields[4] = {
     PB_FIELD2(  1, UINT32  , REQUIRED, STATIC, FIRST, GetEntropy, number_of_bytes, number_of_bytes, 0),
+    PB_FIELD2(  2, BOOL    , OPTIONAL, STATIC, OTHER, GetEntropy, bulk, number_of_bytes, 0),
+    PB_FIELD2(  3, BOOL    , OPTIONAL, STATIC, OTHER, GetEntropy, streamed, bulk, 0),
     PB_LAST_FIELD
 };
 
-const pb_field_t Entropy_fields[2] = {
+const pb_field_t Entropy_fields[5] = {
     PB_FIELD2(  1, BYTES   , REQUIRED, CALLBACK, FIRST, Entropy, entropy, entropy, 0),
+    PB_FIELD2(  2, UINT32  , OPTIONAL, STATIC, OTHER, Entropy, sequence_number, entropy, 0),
+    PB_FIELD2(  3, BOOL    , OPTIONAL, STATIC, OTHER, Entropy, end_of_stream, sequence_number, 0),
+    PB_FIELD2(  4, BYTES   , OPTIONAL, STATIC, OTHER, Entropy, digest, end_of_stream, 0),
     PB_LAST_FIELD
 };
 
@@ -215,13 +261,179 @@ const pb_field_t MasterPublicKey_fields[3] = {
     PB_LAST_FIELD
 };
 
+const pb_field_t GetAddressRange_fields[4] = {
+    PB_FIELD2(  1, UINT32  , REQUIRED, STATIC, FIRST, GetAddressRange, start_address_handle, start_address_handle, 0),
+    PB_FIELD2(  2, UINT32  , REQUIRED, STATIC, OTHER, GetAddressRange, number_of_addresses, start_address_handle, 0),
+    PB_FIELD2(  3, BOOL    , OPTIONAL, STATIC, OTHER, GetAddressRange, omit_addresses, number_of_addresses, &GetAddressRange_omit_addresses_default),
+    PB_LAST_FIELD
+};
+
+const pb_field_t Addresses_fields[2] = {
+    PB_FIELD2(  1, MESSAGE , REPEATED, CALLBACK, FIRST, Addresses, address, address, &Address_fields),
+    PB_LAST_FIELD
+};
+
+const pb_field_t Benchmark_fields[3] = {
+    PB_FIELD2(  1, UINT32  , REQUIRED, STATIC, FIRST, Benchmark, primitive, primitive, 0),
+    PB_FIELD2(  2, UINT32  , REQUIRED, STATIC, OTHER, Benchmark, iterations, primitive, 0),
+    PB_LAST_FIELD
+};
+
+const pb_field_t BenchmarkResult_fields[4] = {
+    PB_FIELD2(  1, UINT32  , REQUIRED, STATIC, FIRST, BenchmarkResult, primitive, primitive, 0),
+    PB_FIELD2(  2, UINT32  , REQUIRED, STATIC, OTHER, BenchmarkResult, iterations, primitive, 0),
+    PB_FIELD2(  3, UINT32  , REQUIRED, STATIC, OTHER, BenchmarkResult, ticks, iterations, 0),
+    PB_LAST_FIELD
+};
+
+const pb_field_t GetExtendedPublicKey_fields[2] = {
+    PB_FIELD2(  1, UINT32  , REPEATED, STATIC, FIRST, GetExtendedPublicKey, path, path, 0),
+    PB_LAST_FIELD
+};
+
+const pb_field_t ExtendedPublicKey_fields[2] = {
+    PB_FIELD2(  1, BYTES   , REQUIRED, STATIC, FIRST, ExtendedPublicKey, xpub, xpub, 0),
+    PB_LAST_FIELD
+};
+
+const pb_field_t GetProgress_fields[1] = {
+    PB_LAST_FIELD
+};
+
+const pb_field_t Progress_fields[4] = {
+    PB_FIELD2(  1, UINT32  , REQUIRED, STATIC, FIRST, Progress, operation, operation, 0),
+    PB_FIELD2(  2, UINT32  , REQUIRED, STATIC, OTHER, Progress, completed, operation, 0),
+    PB_FIELD2(  3, UINT32  , REQUIRED, STATIC, OTHER, Progress, total, completed, 0),
+    PB_LAST_FIELD
+};
+
+const pb_field_t CancelOperation_fields[1] = {
+    PB_LAST_FIELD
+};
+
+const pb_field_t GetDiagnostics_fields[1] = {
+    PB_LAST_FIELD
+};
+
+const pb_field_t PacketStatistics_fields[7] = {
+    PB_FIELD2(  1, UINT32  , REQUIRED, STATIC, FIRST, PacketStatistics, packet_type, packet_type, 0),
+    PB_FIELD2(  2, UINT32  , REQUIRED, STATIC, OTHER, PacketStatistics, count, packet_type, 0),
+    PB_FIELD2(  3, UINT32  , REQUIRED, STATIC, OTHER, PacketStatistics, min_ticks, count, 0),
+    PB_FIELD2(  4, UINT32  , REQUIRED, STATIC, OTHER, PacketStatistics, max_ticks, min_ticks, 0),
+    PB_FIELD2(  5, UINT64  , REQUIRED, STATIC, OTHER, PacketStatistics, total_ticks, max_ticks, 0),
+    PB_FIELD2(  6, UINT32  , REQUIRED, STATIC, OTHER, PacketStatistics, max_stack_bytes, total_ticks, 0),
+    PB_LAST_FIELD
+};
+
+const pb_field_t NVStatistics_fields[10] = {
+    PB_FIELD2(  1, UINT32  , REQUIRED, STATIC, FIRST, NVStatistics, reads, reads, 0),
+    PB_FIELD2(  2, UINT32  , REQUIRED, STATIC, OTHER, NVStatistics, writes, reads, 0),
+    PB_FIELD2(  3, UINT32  , REQUIRED, STATIC, OTHER, NVStatistics, flushes, writes, 0),
+    PB_FIELD2(  4, UINT32  , REQUIRED, STATIC, OTHER, NVStatistics, erases, flushes, 0),
+    PB_FIELD2(  5, UINT32  , REQUIRED, STATIC, OTHER, NVStatistics, cache_hits, erases, 0),
+    PB_FIELD2(  6, UINT32  , REQUIRED, STATIC, OTHER, NVStatistics, cache_misses, cache_hits, 0),
+    PB_FIELD2(  7, UINT32  , REQUIRED, STATIC, OTHER, NVStatistics, max_flush_ticks, cache_misses, 0),
+    PB_FIELD2(  8, UINT32  , REPEATED, CALLBACK, OTHER, NVStatistics, flush_histogram, max_flush_ticks, 0),
+    PB_FIELD2(  9, UINT32  , REPEATED, CALLBACK, OTHER, NVStatistics, sector_erase_counts, flush_histogram, 0),
+    PB_LAST_FIELD
+};
+
+const pb_field_t USBEndpointStatistics_fields[8] = {
+    PB_FIELD2(  1, UINT32  , REQUIRED, STATIC, FIRST, USBEndpointStatistics, endpoint, endpoint, 0),
+    PB_FIELD2(  2, UINT32  , REQUIRED, STATIC, OTHER, USBEndpointStatistics, packets, endpoint, 0),
+    PB_FIELD2(  3, UINT32  , REQUIRED, STATIC, OTHER, USBEndpointStatistics, bytes, packets, 0),
+    PB_FIELD2(  4, UINT32  , REQUIRED, STATIC, OTHER, USBEndpointStatistics, stalls, bytes, 0),
+    PB_FIELD2(  5, UINT32  , REQUIRED, STATIC, OTHER, USBEndpointStatistics, fifo_full, stalls, 0),
+    PB_FIELD2(  6, UINT32  , REQUIRED, STATIC, OTHER, USBEndpointStatistics, fifo_empty, fifo_full, 0),
+    PB_FIELD2(  7, UINT32  , REQUIRED, STATIC, OTHER, USBEndpointStatistics, max_fifo_depth, fifo_empty, 0),
+    PB_LAST_FIELD
+};
+
+const pb_field_t Diagnostics_fields[11] = {
+    PB_FIELD2(  1, MESSAGE , REPEATED, CALLBACK, FIRST, Diagnostics, packet_statistics, packet_statistics, &PacketStatistics_fields),
+    PB_FIELD2(  2, UINT64  , REQUIRED, STATIC, OTHER, Diagnostics, compute_ticks, packet_statistics, 0),
+    PB_FIELD2(  3, UINT64  , REQUIRED, STATIC, OTHER, Diagnostics, receive_ticks, compute_ticks, 0),
+    PB_FIELD2(  4, UINT64  , REQUIRED, STATIC, OTHER, Diagnostics, user_wait_ticks, receive_ticks, 0),
+    PB_FIELD2(  5, UINT64  , REQUIRED, STATIC, OTHER, Diagnostics, send_ticks, user_wait_ticks, 0),
+    PB_FIELD2(  6, MESSAGE , REQUIRED, STATIC, OTHER, Diagnostics, nv_statistics, send_ticks, &NVStatistics_fields),
+    PB_FIELD2(  7, UINT32  , REQUIRED, STATIC, OTHER, Diagnostics, stack_size, nv_statistics, 0),
+    PB_FIELD2(  8, UINT32  , REQUIRED, STATIC, OTHER, Diagnostics, max_stack_bytes, stack_size, 0),
+    PB_FIELD2(  9, UINT32  , REPEATED, CALLBACK, OTHER, Diagnostics, boot_step_ticks, max_stack_bytes, 0),
+    PB_FIELD2( 10, MESSAGE , REPEATED, CALLBACK, OTHER, Diagnostics, usb_endpoints, boot_step_ticks, &USBEndpointStatistics_fields),
+    PB_LAST_FIELD
+};
+
+const pb_field_t GetRNGHealth_fields[1] = {
+    PB_LAST_FIELD
+};
+
+const pb_field_t RNGHealth_fields[18] = {
+    PB_FIELD2(  1, BOOL    , REQUIRED, STATIC, FIRST, RNGHealth, has_statistics, has_statistics, 0),
+    PB_FIELD2(  2, SINT32  , REQUIRED, STATIC, OTHER, RNGHealth, mean, has_statistics, 0),
+    PB_FIELD2(  3, SINT32  , REQUIRED, STATIC, OTHER, RNGHealth, variance, mean, 0),
+    PB_FIELD2(  4, SINT32  , REQUIRED, STATIC, OTHER, RNGHealth, kappa3, variance, 0),
+    PB_FIELD2(  5, SINT32  , REQUIRED, STATIC, OTHER, RNGHealth, kappa4, kappa3, 0),
+    PB_FIELD2(  6, SINT32  , REQUIRED, STATIC, OTHER, RNGHealth, max_bin, kappa4, 0),
+    PB_FIELD2(  7, SINT32  , REQUIRED, STATIC, OTHER, RNGHealth, bandwidth, max_bin, 0),
+    PB_FIELD2(  8, SINT32  , REQUIRED, STATIC, OTHER, RNGHealth, max_autocorrelation, bandwidth, 0),
+    PB_FIELD2(  9, SINT32  , REQUIRED, STATIC, OTHER, RNGHealth, entropy_estimate, max_autocorrelation, 0),
+    PB_FIELD2( 10, UINT32  , REQUIRED, STATIC, OTHER, RNGHealth, last_failed_tests, entropy_estimate, 0),
+    PB_FIELD2( 11, UINT32  , REQUIRED, STATIC, OTHER, RNGHealth, arrays_tested, last_failed_tests, 0),
+    PB_FIELD2( 12, UINT32  , REQUIRED, STATIC, OTHER, RNGHealth, arrays_failed, arrays_tested, 0),
+    PB_FIELD2( 13, UINT32  , REQUIRED, STATIC, OTHER, RNGHealth, samples_tested, arrays_failed, 0),
+    PB_FIELD2( 14, UINT32  , REQUIRED, STATIC, OTHER, RNGHealth, bytes_delivered, samples_tested, 0),
+    PB_FIELD2( 15, UINT32  , REQUIRED, STATIC, OTHER, RNGHealth, blocked_calls, bytes_delivered, 0),
+    PB_FIELD2( 16, UINT64  , REQUIRED, STATIC, OTHER, RNGHealth, blocked_ticks, blocked_calls, 0),
+    PB_FIELD2( 17, UINT32  , REQUIRED, STATIC, OTHER, RNGHealth, max_blocked_ticks, blocked_ticks, 0),
+    PB_LAST_FIELD
+};
+
+const pb_field_t GetTrace_fields[2] = {
+    PB_FIELD2(  1, BOOL    , OPTIONAL, STATIC, FIRST, GetTrace, clear, clear, 0),
+    PB_LAST_FIELD
+};
+
+const pb_field_t TraceEntry_fields[4] = {
+    PB_FIELD2(  1, UINT32  , REQUIRED, STATIC, FIRST, TraceEntry, timestamp, timestamp, 0),
+    PB_FIELD2(  2, UINT32  , REQUIRED, STATIC, OTHER, TraceEntry, event, timestamp, 0),
+    PB_FIELD2(  3, UINT32  , REQUIRED, STATIC, OTHER, TraceEntry, arg, event, 0),
+    PB_LAST_FIELD
+};
+
+const pb_field_t Trace_fields[3] = {
+    PB_FIELD2(  1, MESSAGE , REPEATED, CALLBACK, FIRST, Trace, entries, entries, &TraceEntry_fields),
+    PB_FIELD2(  2, UINT32  , REQUIRED, STATIC, OTHER, Trace, total_events, entries, 0),
+    PB_LAST_FIELD
+};
+
+const pb_field_t GetWalletSnapshot_fields[9] = {
+    PB_FIELD2(  1, BYTES   , REQUIRED, STATIC, FIRST, GetWalletSnapshot, session_id, session_id, 0),
+    PB_FIELD2(  2, BOOL    , OPTIONAL, STATIC, OTHER, GetWalletSnapshot, use_tagged_packets, session_id, 0),
+    PB_FIELD2(  3, BOOL    , OPTIONAL, STATIC, OTHER, GetWalletSnapshot, lock_wallets, use_tagged_packets, 0),
+    PB_FIELD2(  4, UINT32  , OPTIONAL, STATIC, OTHER, GetWalletSnapshot, wallet_number, lock_wallets, &GetWalletSnapshot_wallet_number_default),
+    PB_FIELD2(  5, BOOL    , OPTIONAL, STATIC, OTHER, GetWalletSnapshot, include_master_public_key, wallet_number, 0),
+    PB_FIELD2(  6, UINT32  , OPTIONAL, STATIC, OTHER, GetWalletSnapshot, number_of_recent_addresses, include_master_public_key, 0),
+    PB_FIELD2(  7, BOOL    , OPTIONAL, STATIC, OTHER, GetWalletSnapshot, implicit_button_ack, number_of_recent_addresses, 0),
+    PB_FIELD2(  8, BYTES   , OPTIONAL, CALLBACK, OTHER, GetWalletSnapshot, password, implicit_button_ack, 0),
+    PB_LAST_FIELD
+};
+
+const pb_field_t WalletSnapshot_fields[6] = {
+    PB_FIELD2(  1, MESSAGE , REQUIRED, STATIC, FIRST, WalletSnapshot, features, features, &Features_fields),
+    PB_FIELD2(  2, MESSAGE , REQUIRED, STATIC, OTHER, WalletSnapshot, wallet_info, features, &WalletInfo_fields),
+    PB_FIELD2(  3, UINT32  , REQUIRED, STATIC, OTHER, WalletSnapshot, number_of_addresses, wallet_info, 0),
+    PB_FIELD2(  4, MESSAGE , OPTIONAL, STATIC, OTHER, WalletSnapshot, master_public_key, number_of_addresses, &MasterPublicKey_fields),
+    PB_FIELD2(  5, MESSAGE , REPEATED, CALLBACK, OTHER, WalletSnapshot, address, master_public_key, &Address_fields),
+    PB_LAST_FIELD
+};
+
 
 /* Check that field information fits in pb_field_t */
 #if !defined(PB_FIELD_16BIT) && !defined(PB_FIELD_32BIT)
-STATIC_ASSERT((pb_membersize(Wallets, wallet_info) < 256 && pb_membersize(RestoreWallet, new_wallet) < 256), YOU_MUST_DEFINE_PB_FIELD_16BIT_FOR_MESSAGES_Initialize_Features_Ping_PingResponse_Success_Failure_ButtonRequest_ButtonAck_ButtonCancel_PinRequest_PinAck_PinCancel_OtpRequest_OtpAck_OtpCancel_DeleteWallet_NewWallet_NewAddress_Address_GetNumberOfAddresses_NumberOfAddresses_GetAddressAndPublicKey_SignTransaction_Signature_LoadWallet_FormatWalletArea_ChangeEncryptionKey_ChangeWalletName_ListWallets_WalletInfo_Wallets_BackupWallet_RestoreWallet_GetDeviceUUID_DeviceUUID_GetEntropy_Entropy_GetMasterPublicKey_MasterPublicKey)
+STATIC_ASSERT((pb_membersize(Wallets, wallet_info) < 256 && pb_membersize(RestoreWallet, new_wallet) < 256 && pb_membersize(Signatures, signature) < 256 && pb_membersize(Addresses, address) < 256 && pb_membersize(Diagnostics, packet_statistics) < 256 && pb_membersize(Diagnostics, nv_statistics) < 256 && pb_membersize(WalletSnapshot, features) < 256 && pb_membersize(WalletSnapshot, wallet_info) < 256 && pb_membersize(WalletSnapshot, master_public_key) < 256), YOU_MUST_DEFINE_PB_FIELD_16BIT_FOR_MESSAGES_Initialize_Features_Ping_PingResponse_Success_Failure_ButtonRequest_ButtonAck_ButtonCancel_PinRequest_PinAck_PinCancel_OtpRequest_OtpAck_OtpCancel_DeleteWallet_NewWallet_NewAddress_Address_GetNumberOfAddresses_NumberOfAddresses_GetAddressAndPublicKey_SignTransaction_Signature_SignTransactionBatch_Signatures_LoadWallet_FormatWalletArea_ChangeEncryptionKey_ChangeWalletName_ListWallets_WalletInfo_Wallets_BackupWallet_WalletBackup_RestoreWallet_GetDeviceUUID_DeviceUUID_GetEntropy_Entropy_GetMasterPublicKey_MasterPublicKey_GetAddressRange_Addresses_Benchmark_BenchmarkResult_GetExtendedPublicKey_ExtendedPublicKey_GetProgress_Progress_CancelOperation_GetDiagnostics_PacketStatistics_NVStatistics_USBEndpointStatistics_Diagnostics_GetRNGHealth_RNGHealth_GetTrace_TraceEntry_Trace_GetWalletSnapshot_WalletSnapshot)
 #endif
 
 #if !defined(PB_FIELD_32BIT)
-STATIC_ASSERT((pb_membersize(Wallets, wallet_info) < 65536 && pb_membersize(RestoreWallet, new_wallet) < 65536), YOU_MUST_DEFINE_PB_FIELD_32BIT_FOR_MESSAGES_Initialize_Features_Ping_PingResponse_Success_Failure_ButtonRequest_ButtonAck_ButtonCancel_PinRequest_PinAck_PinCancel_OtpRequest_OtpAck_OtpCancel_DeleteWallet_NewWallet_NewAddress_Address_GetNumberOfAddresses_NumberOfAddresses_GetAddressAndPublicKey_SignTransaction_Signature_LoadWallet_FormatWalletArea_ChangeEncryptionKey_ChangeWalletName_ListWallets_WalletInfo_Wallets_BackupWallet_RestoreWallet_GetDeviceUUID_DeviceUUID_GetEntropy_Entropy_GetMasterPublicKey_MasterPublicKey)
+STATIC_ASSERT((pb_membersize(Wallets, wallet_info) < 65536 && pb_membersize(RestoreWallet, new_wallet) < 65536 && pb_membersize(Signatures, signature) < 65536 && pb_membersize(Addresses, address) < 65536 && pb_membersize(Diagnostics, packet_statistics) < 65536 && pb_membersize(Diagnostics, nv_statistics) < 65536 && pb_membersize(WalletSnapshot, features) < 65536 && pb_membersize(WalletSnapshot, wallet_info) < 65536 && pb_membersize(WalletSnapshot, master_public_key) < 65536), YOU_MUST_DEFINE_PB_FIELD_32BIT_FOR_MESSAGES_Initialize_Features_Ping_PingResponse_Success_Failure_ButtonRequest_ButtonAck_ButtonCancel_PinRequest_PinAck_PinCancel_OtpRequest_OtpAck_OtpCancel_DeleteWallet_NewWallet_NewAddress_Address_GetNumberOfAddresses_NumberOfAddresses_GetAddressAndPublicKey_SignTransaction_Signature_SignTransactionBatch_Signatures_LoadWallet_FormatWalletArea_ChangeEncryptionKey_ChangeWalletName_ListWallets_WalletInfo_Wallets_BackupWallet_WalletBackup_RestoreWallet_GetDeviceUUID_DeviceUUID_GetEntropy_Entropy_GetMasterPublicKey_MasterPublicKey_GetAddressRange_Addresses_Benchmark_BenchmarkResult_GetExtendedPublicKey_ExtendedPublicKey_GetProgress_Progress_CancelOperation_GetDiagnostics_PacketStatistics_NVStatistics_USBEndpointStatistics_Diagnostics_GetRNGHealth_RNGHealth_GetTrace_TraceEntry_Trace_GetWalletSnapshot_WalletSnapshot)
 #endif
 
@@ -28,10 +28,18 @@ typedef struct _ButtonRequest {
     uint8_t dummy_field;
 } ButtonRequest;
 
+typedef struct _CancelOperation {
+    uint8_t dummy_field;
+} CancelOperation;
+
 typedef struct _GetDeviceUUID {
     uint8_t dummy_field;
 } GetDeviceUUID;
 
+typedef struct _GetDiagnostics {
+    uint8_t dummy_field;
+} GetDiagnostics;
+
 typedef struct _GetMasterPublicKey {
     uint8_t dummy_field;
 } GetMasterPublicKey;
@@ -40,8 +48,21 @@ typedef struct _GetNumberOfAddresses {
     uint8_t dummy_field;
 } GetNumberOfAddresses;
 
-typedef struct _ListWallets {
+typedef struct _GetProgress {
+    uint8_t dummy_field;
+} GetProgress;
+
+typedef struct _GetRNGHealth {
     uint8_t dummy_field;
+} GetRNGHealth;
+
+typedef struct _ListWallets {
+    bool has_start_wallet_number;
+    uint32_t start_wallet_number;
+    bool has_number_of_wallets;
+    uint32_t number_of_wallets;
+    bool has_changed_since;
+    uint32_t changed_since;
 } ListWallets;
 
 typedef struct _NewAddress {
@@ -81,16 +102,34 @@ typedef struct {
 typedef struct _Address {
     uint32_t address_handle;
     Address_public_key_t public_key;
+    bool has_address;
     Address_address_t address;
 } Address;
 
+typedef struct _Addresses {
+    pb_callback_t address;
+} Addresses;
+
 typedef struct _BackupWallet {
     bool has_is_encrypted;
     bool is_encrypted;
     bool has_device;
     uint32_t device;
+    bool has_to_host;
+    bool to_host;
 } BackupWallet;
 
+typedef struct _Benchmark {
+    uint32_t primitive;
+    uint32_t iterations;
+} Benchmark;
+
+typedef struct _BenchmarkResult {
+    uint32_t primitive;
+    uint32_t iterations;
+    uint32_t ticks;
+} BenchmarkResult;
+
 typedef struct _ChangeEncryptionKey {
     pb_callback_t password;
 } ChangeEncryptionKey;
@@ -118,10 +157,55 @@ typedef struct _DeviceUUID {
     DeviceUUID_device_uuid_t device_uuid;
 } DeviceUUID;
 
+typedef struct _NVStatistics {
+    uint32_t reads;
+    uint32_t writes;
+    uint32_t flushes;
+    uint32_t erases;
+    uint32_t cache_hits;
+    uint32_t cache_misses;
+    uint32_t max_flush_ticks;
+    pb_callback_t flush_histogram;
+    pb_callback_t sector_erase_counts;
+} NVStatistics;
+
+typedef struct _Diagnostics {
+    pb_callback_t packet_statistics;
+    uint64_t compute_ticks;
+    uint64_t receive_ticks;
+    uint64_t user_wait_ticks;
+    uint64_t send_ticks;
+    NVStatistics nv_statistics;
+    uint32_t stack_size;
+    uint32_t max_stack_bytes;
+    pb_callback_t boot_step_ticks;
+    pb_callback_t usb_endpoints;
+} Diagnostics;
+
+typedef struct {
+    size_t size;
+    uint8_t bytes[32];
+} Entropy_digest_t;
+
 typedef struct _Entropy {
     pb_callback_t entropy;
+    bool has_sequence_number;
+    uint32_t sequence_number;
+    bool has_end_of_stream;
+    bool end_of_stream;
+    bool has_digest;
+    Entropy_digest_t digest;
 } Entropy;
 
+typedef struct {
+    size_t size;
+    uint8_t bytes[78];
+} ExtendedPublicKey_xpub_t;
+
+typedef struct _ExtendedPublicKey {
+    ExtendedPublicKey_xpub_t xpub;
+} ExtendedPublicKey;
+
 typedef struct _Failure {
     uint32_t error_code;
     pb_callback_t error_message;
@@ -150,6 +234,10 @@ typedef struct _Features {
     Algorithm algo[2];
     bool has_debug_link;
     bool debug_link;
+    bool has_max_outstanding_requests;
+    uint32_t max_outstanding_requests;
+    bool has_implicit_button_ack;
+    bool implicit_button_ack;
 } Features;
 
 typedef struct {
@@ -165,10 +253,31 @@ typedef struct _GetAddressAndPublicKey {
     uint32_t address_handle;
 } GetAddressAndPublicKey;
 
+typedef struct _GetAddressRange {
+    uint32_t start_address_handle;
+    uint32_t number_of_addresses;
+    bool has_omit_addresses;
+    bool omit_addresses;
+} GetAddressRange;
+
 typedef struct _GetEntropy {
     uint32_t number_of_bytes;
+    bool has_bulk;
+    bool bulk;
+    bool has_streamed;
+    bool streamed;
 } GetEntropy;
 
+typedef struct _GetExtendedPublicKey {
+    size_t path_count;
+    uint32_t path[8];
+} GetExtendedPublicKey;
+
+typedef struct _GetTrace {
+    bool has_clear;
+    bool clear;
+} GetTrace;
+
 typedef struct {
     size_t size;
     uint8_t bytes[64];
@@ -176,11 +285,18 @@ typedef struct {
 
 typedef struct _Initialize {
     Initialize_session_id_t session_id;
+    bool has_use_tagged_packets;
+    bool use_tagged_packets;
+    bool has_lock_wallets;
+    bool lock_wallets;
+    bool has_implicit_button_ack;
+    bool implicit_button_ack;
 } Initialize;
 
 typedef struct _LoadWallet {
     bool has_wallet_number;
     uint32_t wallet_number;
+    pb_callback_t password;
 } LoadWallet;
 
 typedef struct {
@@ -211,6 +327,8 @@ typedef struct _NewWallet {
     NewWallet_wallet_name_t wallet_name;
     bool has_is_hidden;
     bool is_hidden;
+    bool has_keep_unlocked;
+    bool keep_unlocked;
 } NewWallet;
 
 typedef struct _NumberOfAddresses {
@@ -221,6 +339,15 @@ typedef struct _OtpAck {
     char otp[16];
 } OtpAck;
 
+typedef struct _PacketStatistics {
+    uint32_t packet_type;
+    uint32_t count;
+    uint32_t min_ticks;
+    uint32_t max_ticks;
+    uint64_t total_ticks;
+    uint32_t max_stack_bytes;
+} PacketStatistics;
+
 typedef struct _PinAck {
     pb_callback_t password;
 } PinAck;
@@ -241,6 +368,32 @@ typedef struct _PingResponse {
     PingResponse_echoed_session_id_t echoed_session_id;
 } PingResponse;
 
+typedef struct _Progress {
+    uint32_t operation;
+    uint32_t completed;
+    uint32_t total;
+} Progress;
+
+typedef struct _RNGHealth {
+    bool has_statistics;
+    int32_t mean;
+    int32_t variance;
+    int32_t kappa3;
+    int32_t kappa4;
+    int32_t max_bin;
+    int32_t bandwidth;
+    int32_t max_autocorrelation;
+    int32_t entropy_estimate;
+    uint32_t last_failed_tests;
+    uint32_t arrays_tested;
+    uint32_t arrays_failed;
+    uint32_t samples_tested;
+    uint32_t bytes_delivered;
+    uint32_t blocked_calls;
+    uint64_t blocked_ticks;
+    uint32_t max_blocked_ticks;
+} RNGHealth;
+
 typedef struct _SignTransaction {
     uint32_t address_handle;
     pb_callback_t transaction_data;
@@ -255,6 +408,62 @@ typedef struct _Signature {
     Signature_signature_data_t signature_data;
 } Signature;
 
+typedef struct _SignTransactionBatch {
+    size_t address_handle_count;
+    uint32_t address_handle[8];
+    size_t input_index_count;
+    uint32_t input_index[8];
+    bool has_use_bip143;
+    bool use_bip143;
+    pb_callback_t transaction_data;
+} SignTransactionBatch;
+
+typedef struct _Signatures {
+    pb_callback_t signature;
+} Signatures;
+
+typedef struct _TraceEntry {
+    uint32_t timestamp;
+    uint32_t event;
+    uint32_t arg;
+} TraceEntry;
+
+typedef struct _Trace {
+    pb_callback_t entries;
+    uint32_t total_events;
+} Trace;
+
+typedef struct _USBEndpointStatistics {
+    uint32_t endpoint;
+    uint32_t packets;
+    uint32_t bytes;
+    uint32_t stalls;
+    uint32_t fifo_full;
+    uint32_t fifo_empty;
+    uint32_t max_fifo_depth;
+} USBEndpointStatistics;
+
+typedef struct {
+    size_t size;
+    uint8_t bytes[16];
+} WalletBackup_wallet_uuid_t;
+
+typedef struct {
+    size_t size;
+    uint8_t bytes[64];
+} WalletBackup_encrypted_seed_t;
+
+typedef struct {
+    size_t size;
+    uint8_t bytes[32];
+} WalletBackup_digest_t;
+
+typedef struct _WalletBackup {
+    WalletBackup_wallet_uuid_t wallet_uuid;
+    WalletBackup_encrypted_seed_t encrypted_seed;
+    WalletBackup_digest_t digest;
+} WalletBackup;
+
 typedef struct {
     size_t size;
     uint8_t bytes[40];
@@ -273,6 +482,12 @@ typedef struct _WalletInfo {
 
 typedef struct _Wallets {
     pb_callback_t wallet_info;
+    bool has_generation;
+    uint32_t generation;
+    bool has_next_wallet_number;
+    uint32_t next_wallet_number;
+    bool has_unchanged;
+    bool unchanged;
 } Wallets;
 
 typedef struct {
@@ -280,30 +495,101 @@ typedef struct {
     uint8_t bytes[64];
 } RestoreWallet_seed_t;
 
+typedef struct {
+    size_t size;
+    uint8_t bytes[16];
+} RestoreWallet_wallet_uuid_t;
+
+typedef struct {
+    size_t size;
+    uint8_t bytes[32];
+} RestoreWallet_digest_t;
+
 typedef struct _RestoreWallet {
     NewWallet new_wallet;
     RestoreWallet_seed_t seed;
+    bool has_wallet_uuid;
+    RestoreWallet_wallet_uuid_t wallet_uuid;
+    bool has_digest;
+    RestoreWallet_digest_t digest;
 } RestoreWallet;
 
+typedef struct {
+    size_t size;
+    uint8_t bytes[64];
+} GetWalletSnapshot_session_id_t;
+
+typedef struct _GetWalletSnapshot {
+    GetWalletSnapshot_session_id_t session_id;
+    bool has_use_tagged_packets;
+    bool use_tagged_packets;
+    bool has_lock_wallets;
+    bool lock_wallets;
+    bool has_wallet_number;
+    uint32_t wallet_number;
+    bool has_include_master_public_key;
+    bool include_master_public_key;
+    bool has_number_of_recent_addresses;
+    uint32_t number_of_recent_addresses;
+    bool has_implicit_button_ack;
+    bool implicit_button_ack;
+    pb_callback_t password;
+} GetWalletSnapshot;
+
+typedef struct _WalletSnapshot {
+    Features features;
+    WalletInfo wallet_info;
+    uint32_t number_of_addresses;
+    bool has_master_public_key;
+    MasterPublicKey master_public_key;
+    pb_callback_t address;
+} WalletSnapshot;
+
 /* Default values for struct fields */
 extern const uint32_t DeleteWallet_wallet_handle_default;
 extern const uint32_t NewWallet_wallet_number_default;
 extern const bool NewWallet_is_hidden_default;
+extern const bool NewWallet_keep_unlocked_default;
+extern const bool SignTransactionBatch_use_bip143_default;
 extern const uint32_t LoadWallet_wallet_number_default;
 extern const bool BackupWallet_is_encrypted_default;
 extern const uint32_t BackupWallet_device_default;
+extern const bool BackupWallet_to_host_default;
+extern const bool GetAddressRange_omit_addresses_default;
+extern const uint32_t GetWalletSnapshot_wallet_number_default;
 
 /* Field tags (for use in manual encoding/decoding) */
 #define Address_address_handle_tag               1
 #define Address_public_key_tag                   2
 #define Address_address_tag                      3
+#define Addresses_address_tag                    1
 #define BackupWallet_is_encrypted_tag            1
 #define BackupWallet_device_tag                  2
+#define BackupWallet_to_host_tag                 3
+#define Benchmark_primitive_tag                  1
+#define Benchmark_iterations_tag                 2
+#define BenchmarkResult_primitive_tag            1
+#define BenchmarkResult_iterations_tag           2
+#define BenchmarkResult_ticks_tag                3
 #define ChangeEncryptionKey_password_tag         1
 #define ChangeWalletName_wallet_name_tag         1
 #define DeleteWallet_wallet_handle_tag           1
 #define DeviceUUID_device_uuid_tag               1
+#define Diagnostics_packet_statistics_tag        1
+#define Diagnostics_compute_ticks_tag            2
+#define Diagnostics_receive_ticks_tag            3
+#define Diagnostics_user_wait_ticks_tag          4
+#define Diagnostics_send_ticks_tag               5
+#define Diagnostics_nv_statistics_tag            6
+#define Diagnostics_stack_size_tag               7
+#define Diagnostics_max_stack_bytes_tag          8
+#define Diagnostics_boot_step_ticks_tag          9
+#define Diagnostics_usb_endpoints_tag            10
 #define Entropy_entropy_tag                      1
+#define Entropy_sequence_number_tag              2
+#define Entropy_end_of_stream_tag                3
+#define Entropy_digest_tag                       4
+#define ExtendedPublicKey_xpub_tag               1
 #define Failure_error_code_tag                   1
 #define Failure_error_message_tag                2
 #define Features_echoed_session_id_tag           1
@@ -316,36 +602,126 @@ extern const uint32_t BackupWallet_device_default;
 #define Features_spv_tag                         8
 #define Features_algo_tag                        9
 #define Features_debug_link_tag                  10
+#define Features_max_outstanding_requests_tag    11
+#define Features_implicit_button_ack_tag         12
 #define FormatWalletArea_initial_entropy_pool_tag 1
 #define GetAddressAndPublicKey_address_handle_tag 1
+#define GetAddressRange_start_address_handle_tag 1
+#define GetAddressRange_number_of_addresses_tag  2
+#define GetAddressRange_omit_addresses_tag       3
 #define GetEntropy_number_of_bytes_tag           1
+#define GetEntropy_bulk_tag                      2
+#define GetEntropy_streamed_tag                  3
+#define GetExtendedPublicKey_path_tag            1
+#define GetTrace_clear_tag                       1
+#define GetWalletSnapshot_session_id_tag         1
+#define GetWalletSnapshot_use_tagged_packets_tag 2
+#define GetWalletSnapshot_lock_wallets_tag       3
+#define GetWalletSnapshot_wallet_number_tag      4
+#define GetWalletSnapshot_include_master_public_key_tag 5
+#define GetWalletSnapshot_number_of_recent_addresses_tag 6
+#define GetWalletSnapshot_implicit_button_ack_tag 7
+#define GetWalletSnapshot_password_tag           8
 #define Initialize_session_id_tag                1
+#define Initialize_use_tagged_packets_tag        2
+#define Initialize_lock_wallets_tag              3
+#define Initialize_implicit_button_ack_tag       4
+#define ListWallets_start_wallet_number_tag      1
+#define ListWallets_number_of_wallets_tag        2
+#define ListWallets_changed_since_tag            3
 #define LoadWallet_wallet_number_tag             1
+#define LoadWallet_password_tag                  2
 #define MasterPublicKey_public_key_tag           1
 #define MasterPublicKey_chain_code_tag           2
 #define NewWallet_wallet_number_tag              1
 #define NewWallet_password_tag                   2
 #define NewWallet_wallet_name_tag                3
 #define NewWallet_is_hidden_tag                  4
+#define NewWallet_keep_unlocked_tag              5
 #define NumberOfAddresses_number_of_addresses_tag 1
+#define NVStatistics_reads_tag                   1
+#define NVStatistics_writes_tag                  2
+#define NVStatistics_flushes_tag                 3
+#define NVStatistics_erases_tag                  4
+#define NVStatistics_cache_hits_tag              5
+#define NVStatistics_cache_misses_tag            6
+#define NVStatistics_max_flush_ticks_tag         7
+#define NVStatistics_flush_histogram_tag         8
+#define NVStatistics_sector_erase_counts_tag     9
 #define OtpAck_otp_tag                           1
+#define PacketStatistics_packet_type_tag         1
+#define PacketStatistics_count_tag               2
+#define PacketStatistics_min_ticks_tag           3
+#define PacketStatistics_max_ticks_tag           4
+#define PacketStatistics_total_ticks_tag         5
+#define PacketStatistics_max_stack_bytes_tag     6
 #define PinAck_password_tag                      1
 #define Ping_greeting_tag                        1
 #define PingResponse_echoed_greeting_tag         1
 #define PingResponse_echoed_session_id_tag       2
+#define Progress_operation_tag                   1
+#define Progress_completed_tag                   2
+#define Progress_total_tag                       3
 #define SignTransaction_address_handle_tag       1
 #define SignTransaction_transaction_data_tag     2
 #define Signature_signature_data_tag             1
+#define SignTransactionBatch_address_handle_tag  1
+#define SignTransactionBatch_input_index_tag     2
+#define SignTransactionBatch_use_bip143_tag      3
+#define SignTransactionBatch_transaction_data_tag 4
+#define Signatures_signature_tag                 1
+#define TraceEntry_timestamp_tag                 1
+#define TraceEntry_event_tag                     2
+#define TraceEntry_arg_tag                       3
+#define Trace_entries_tag                        1
+#define Trace_total_events_tag                   2
+#define USBEndpointStatistics_endpoint_tag       1
+#define USBEndpointStatistics_packets_tag        2
+#define USBEndpointStatistics_bytes_tag          3
+#define USBEndpointStatistics_stalls_tag         4
+#define USBEndpointStatistics_fifo_full_tag      5
+#define USBEndpointStatistics_fifo_empty_tag     6
+#define USBEndpointStatistics_max_fifo_depth_tag 7
+#define WalletBackup_wallet_uuid_tag             1
+#define WalletBackup_encrypted_seed_tag          2
+#define WalletBackup_digest_tag                  3
 #define WalletInfo_wallet_number_tag             1
 #define WalletInfo_wallet_name_tag               2
 #define WalletInfo_wallet_uuid_tag               3
+#define WalletSnapshot_features_tag              1
+#define WalletSnapshot_wallet_info_tag           2
+#define WalletSnapshot_number_of_addresses_tag   3
+#define WalletSnapshot_master_public_key_tag     4
+#define WalletSnapshot_address_tag               5
 #define Wallets_wallet_info_tag                  1
+#define Wallets_generation_tag                   2
+#define Wallets_next_wallet_number_tag           3
+#define Wallets_unchanged_tag                    4
+#define RNGHealth_has_statistics_tag             1
+#define RNGHealth_mean_tag                       2
+#define RNGHealth_variance_tag                   3
+#define RNGHealth_kappa3_tag                     4
+#define RNGHealth_kappa4_tag                     5
+#define RNGHealth_max_bin_tag                    6
+#define RNGHealth_bandwidth_tag                  7
+#define RNGHealth_max_autocorrelation_tag        8
+#define RNGHealth_entropy_estimate_tag           9
+#define RNGHealth_last_failed_tests_tag          10
+#define RNGHealth_arrays_tested_tag              11
+#define RNGHealth_arrays_failed_tag              12
+#define RNGHealth_samples_tested_tag             13
+#define RNGHealth_bytes_delivered_tag            14
+#define RNGHealth_blocked_calls_tag              15
+#define RNGHealth_blocked_ticks_tag              16
+#define RNGHealth_max_blocked_ticks_tag          17
 #define RestoreWallet_new_wallet_tag             1
 #define RestoreWallet_seed_tag                   2
+#define RestoreWallet_wallet_uuid_tag            3
+#define RestoreWallet_digest_tag                 4
 
 /* Struct field encoding specification for nanopb */
-extern const pb_field_t Initialize_fields[2];
-extern const pb_field_t Features_fields[11];
+extern const pb_field_t Initialize_fields[5];
+extern const pb_field_t Features_fields[13];
 extern const pb_field_t Ping_fields[2];
 extern const pb_field_t PingResponse_fields[3];
 extern const pb_field_t Success_fields[1];
@@ -360,7 +736,7 @@ extern const pb_field_t OtpRequest_fields[1];
 extern const pb_field_t OtpAck_fields[2];
 extern const pb_field_t OtpCancel_fields[1];
 extern const pb_field_t DeleteWallet_fields[2];
-extern const pb_field_t NewWallet_fields[5];
+extern const pb_field_t NewWallet_fields[6];
 extern const pb_field_t NewAddress_fields[1];
 extern const pb_field_t Address_fields[4];
 extern const pb_field_t GetNumberOfAddresses_fields[1];
@@ -368,24 +744,48 @@ extern const pb_field_t NumberOfAddresses_fields[2];
 extern const pb_field_t GetAddressAndPublicKey_fields[2];
 extern const pb_field_t SignTransaction_fields[3];
 extern const pb_field_t Signature_fields[2];
-extern const pb_field_t LoadWallet_fields[2];
+extern const pb_field_t SignTransactionBatch_fields[5];
+extern const pb_field_t Signatures_fields[2];
+extern const pb_field_t LoadWallet_fields[3];
 extern const pb_field_t FormatWalletArea_fields[2];
 extern const pb_field_t ChangeEncryptionKey_fields[2];
 extern const pb_field_t ChangeWalletName_fields[2];
-extern const pb_field_t ListWallets_fields[1];
+extern const pb_field_t ListWallets_fields[4];
 extern const pb_field_t WalletInfo_fields[4];
-extern const pb_field_t Wallets_fields[2];
-extern const pb_field_t BackupWallet_fields[3];
-extern const pb_field_t RestoreWallet_fields[3];
+extern const pb_field_t Wallets_fields[5];
+extern const pb_field_t BackupWallet_fields[4];
+extern const pb_field_t WalletBackup_fields[4];
+extern const pb_field_t RestoreWallet_fields[5];
 extern const pb_field_t GetDeviceUUID_fields[1];
 extern const pb_field_t DeviceUUID_fields[2];
-extern const pb_field_t GetEntropy_fields[2];
-extern const pb_field_t Entropy_fields[2];
+extern const pb_field_t GetEntropy_fields[4];
+extern const pb_field_t Entropy_fields[5];
 extern const pb_field_t GetMasterPublicKey_fields[1];
 extern const pb_field_t MasterPublicKey_fields[3];
+extern const pb_field_t GetAddressRange_fields[4];
+extern const pb_field_t Addresses_fields[2];
+extern const pb_field_t Benchmark_fields[3];
+extern const pb_field_t BenchmarkResult_fields[4];
+extern const pb_field_t GetExtendedPublicKey_fields[2];
+extern const pb_field_t ExtendedPublicKey_fields[2];
+extern const pb_field_t GetProgress_fields[1];
+extern const pb_field_t Progress_fields[4];
+extern const pb_field_t CancelOperation_fields[1];
+extern const pb_field_t GetDiagnostics_fields[1];
+extern const pb_field_t PacketStatistics_fields[7];
+extern const pb_field_t NVStatistics_fields[10];
+extern const pb_field_t USBEndpointStatistics_fields[8];
+extern const pb_field_t Diagnostics_fields[11];
+extern const pb_field_t GetRNGHealth_fields[1];
+extern const pb_field_t RNGHealth_fields[18];
+extern const pb_field_t GetTrace_fields[2];
+extern const pb_field_t TraceEntry_fields[4];
+extern const pb_field_t Trace_fields[3];
+extern const pb_field_t GetWalletSnapshot_fields[9];
+extern const pb_field_t WalletSnapshot_fields[6];
 
 /* Maximum encoded size of messages (where known) */
-#define Initialize_size                          66
+#define Initialize_size                          72
 #define Ping_size                                66
 #define PingResponse_size                        132
 #define Success_size                             0
@@ -404,17 +804,32 @@ extern const pb_field_t MasterPublicKey_fields[3];
 #define NumberOfAddresses_size                   6
 #define GetAddressAndPublicKey_size              6
 #define Signature_size                           75
-#define LoadWallet_size                          6
 #define FormatWalletArea_size                    34
 #define ChangeWalletName_size                    42
-#define ListWallets_size                         0
+#define ListWallets_size                         18
 #define WalletInfo_size                          66
-#define BackupWallet_size                        8
+#define BackupWallet_size                        10
+#define WalletBackup_size                        118
 #define GetDeviceUUID_size                       0
 #define DeviceUUID_size                          18
-#define GetEntropy_size                          6
+#define GetEntropy_size                          10
 #define GetMasterPublicKey_size                  0
 #define MasterPublicKey_size                     101
+#define GetAddressRange_size                     14
+#define Benchmark_size                           12
+#define BenchmarkResult_size                     18
+#define GetExtendedPublicKey_size                48
+#define ExtendedPublicKey_size                   80
+#define GetProgress_size                         0
+#define Progress_size                            18
+#define CancelOperation_size                     0
+#define GetDiagnostics_size                      0
+#define PacketStatistics_size                    41
+#define USBEndpointStatistics_size               42
+#define GetRNGHealth_size                        0
+#define RNGHealth_size                           105
+#define GetTrace_size                            2
+#define TraceEntry_size                          18
 
 #ifdef __cplusplus
 } /* extern "C" */
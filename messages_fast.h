@@ -0,0 +1,331 @@
+/** \file messages_fast.h
+  *
+  * \brief Contains specialised encoders and decoders for the protocol buffer
+  *        messages which are sent and received most often.
+  *
+  * nanopb's pb_encode() and pb_decode() interpret a message's field
+  * description table, calling a function per field. The functions here do
+  * the same thing for a few frequently used messages (for example, Address
+  * and GetAddressAndPublicKey), but in straight-line code. Every other
+  * message is still handled by nanopb.
+  *
+  * The code was generated using gen_fastpb, from messages.proto and the
+  * field description tables in messages.pb.c; see gen_fastpb.c for the list
+  * of messages and for what is supported. If any of those messages change,
+  * this must be regenerated.
+  *
+  * This file should only be included by stream_comm.c.
+  *
+  * This file is licensed as described by the file LICENCE.
+  */
+
+#ifndef MESSAGES_FAST_H_INCLUDED
+#define MESSAGES_FAST_H_INCLUDED
+
+#include <string.h>
+#include "common.h"
+#include "hwinterface.h"
+#include "pb.h"
+#include "messages.pb.h"
+
+// Code generated using gen_fastpb.
+
+/** Maximum encoded size, in bytes, of any message which fastEncode() can
+  * encode. */
+#define FAST_ENCODE_MAX_SIZE	95
+/** Maximum encoded size, in bytes, of any message which fastDecode() can
+  * decode, not counting unknown fields. */
+#define FAST_DECODE_MAX_SIZE	6
+
+/** Write a varint.
+  * \param buffer Where to write the varint. This must have space for 5
+  *               bytes.
+  * \param value The value to write.
+  * \return The number of bytes written.
+  */
+static size_t fastWriteVarint(uint8_t *buffer, uint32_t value)
+{
+	size_t length;
+
+	length = 0;
+	while (value >= 0x80)
+	{
+		buffer[length++] = (uint8_t)(value | 0x80);
+		value >>= 7;
+	}
+	buffer[length++] = (uint8_t)value;
+	return length;
+}
+
+/** Read a varint. Like nanopb, this accepts varints of up to 64 bits, but
+  * only keeps the least significant 32 bits.
+  * \param buffer The buffer to read from.
+  * \param length The length of buffer, in bytes.
+  * \param position The index into buffer to read from. This will be
+  *                 advanced past the varint.
+  * \param out_value The value of the varint will be written here.
+  * \return false on success, true if the varint is truncated or too long.
+  */
+static bool fastReadVarint(const uint8_t *buffer, size_t length, size_t *position, uint32_t *out_value)
+{
+	uint8_t one_byte;
+	uint8_t shift;
+	uint32_t value;
+
+	value = 0;
+	shift = 0;
+	do
+	{
+		if ((*position >= length) || (shift >= 64))
+		{
+			return true;
+		}
+		one_byte = buffer[*position];
+		(*position)++;
+		if (shift < 32)
+		{
+			value |= (uint32_t)(one_byte & 0x7f) << shift;
+		}
+		shift = (uint8_t)(shift + 7);
+	} while ((one_byte & 0x80) != 0);
+	*out_value = value;
+	return false;
+}
+
+/** Skip over the value of a field which the decoder doesn't know about.
+  * \param buffer The buffer to read from.
+  * \param length The length of buffer, in bytes.
+  * \param position The index into buffer of the field's value. This will
+  *                 be advanced past the value.
+  * \param key The key (tag and wire type) of the field.
+  * \return false on success, true if the value is truncated or the wire
+  *         type is invalid.
+  */
+static bool fastSkipField(const uint8_t *buffer, size_t length, size_t *position, uint32_t key)
+{
+	uint32_t value;
+	size_t value_length;
+
+	switch (key & 7)
+	{
+	case 0: // varint
+		return fastReadVarint(buffer, length, position, &value);
+	case 1: // 64 bit
+		value_length = 8;
+		break;
+	case 2: // length-delimited
+		if (fastReadVarint(buffer, length, position, &value))
+		{
+			return true;
+		}
+		value_length = value;
+		break;
+	case 5: // 32 bit
+		value_length = 4;
+		break;
+	default:
+		return true;
+	}
+	if (value_length > (length - *position))
+	{
+		return true;
+	}
+	*position += value_length;
+	return false;
+}
+
+/** Decode a message which has no fields, by checking that everything in
+  * it can be skipped. See fastDecode(). */
+static bool fastDecodeEmpty(const uint8_t *buffer, size_t length)
+{
+	size_t position;
+	uint32_t key;
+
+	position = 0;
+	while (position < length)
+	{
+		if (fastReadVarint(buffer, length, &position, &key)
+			|| fastSkipField(buffer, length, &position, key))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+/** Encode a Address message. See fastEncode(). */
+static bool fastEncodeAddress(const Address *message, uint8_t *buffer, size_t *out_length)
+{
+	size_t length;
+
+	length = 0;
+	buffer[length++] = 0x08; // address_handle
+	length += fastWriteVarint(&(buffer[length]), message->address_handle);
+	if (message->public_key.size > sizeof(message->public_key.bytes))
+	{
+		return true;
+	}
+	buffer[length++] = 0x12; // public_key
+	length += fastWriteVarint(&(buffer[length]), (uint32_t)message->public_key.size);
+	memcpy(&(buffer[length]), message->public_key.bytes, message->public_key.size);
+	length += message->public_key.size;
+	if (message->has_address)
+	{
+		if (message->address.size > sizeof(message->address.bytes))
+		{
+			return true;
+		}
+		buffer[length++] = 0x1a; // address
+		length += fastWriteVarint(&(buffer[length]), (uint32_t)message->address.size);
+		memcpy(&(buffer[length]), message->address.bytes, message->address.size);
+		length += message->address.size;
+	}
+	*out_length = length;
+	return false;
+}
+
+/** Encode a Signature message. See fastEncode(). */
+static bool fastEncodeSignature(const Signature *message, uint8_t *buffer, size_t *out_length)
+{
+	size_t length;
+
+	length = 0;
+	if (message->signature_data.size > sizeof(message->signature_data.bytes))
+	{
+		return true;
+	}
+	buffer[length++] = 0x0a; // signature_data
+	length += fastWriteVarint(&(buffer[length]), (uint32_t)message->signature_data.size);
+	memcpy(&(buffer[length]), message->signature_data.bytes, message->signature_data.size);
+	length += message->signature_data.size;
+	*out_length = length;
+	return false;
+}
+
+/** Encode a NumberOfAddresses message. See fastEncode(). */
+static bool fastEncodeNumberOfAddresses(const NumberOfAddresses *message, uint8_t *buffer, size_t *out_length)
+{
+	size_t length;
+
+	length = 0;
+	buffer[length++] = 0x08; // number_of_addresses
+	length += fastWriteVarint(&(buffer[length]), message->number_of_addresses);
+	*out_length = length;
+	return false;
+}
+
+/** Decode a GetAddressAndPublicKey message. See fastDecode(). */
+static bool fastDecodeGetAddressAndPublicKey(const uint8_t *buffer, size_t length, GetAddressAndPublicKey *message)
+{
+	size_t position;
+	uint32_t key;
+	bool has_address_handle;
+
+	has_address_handle = false;
+	message->address_handle = 0;
+	position = 0;
+	while (position < length)
+	{
+		if (fastReadVarint(buffer, length, &position, &key))
+		{
+			return true;
+		}
+		switch (key)
+		{
+		case 0x08: // address_handle
+			if (fastReadVarint(buffer, length, &position, &(message->address_handle)))
+			{
+				return true;
+			}
+			has_address_handle = true;
+			break;
+		default:
+			if (fastSkipField(buffer, length, &position, key))
+			{
+				return true;
+			}
+			break;
+		}
+	}
+	return !has_address_handle;
+}
+
+/** Check whether fastEncode() can encode a message.
+  * \param fields Field description array of the message.
+  * \return Whether there is a specialised encoder for the message.
+  */
+static bool canFastEncode(const pb_field_t fields[])
+{
+	return (fields == Address_fields)
+		|| (fields == Signature_fields)
+		|| (fields == NumberOfAddresses_fields);
+}
+
+/** Encode a message using its specialised encoder. This produces exactly
+  * the same bytes as pb_encode().
+  * \param fields Field description array of the message. canFastEncode()
+  *               must have returned true for it.
+  * \param src_struct Field data which will be encoded.
+  * \param buffer Where the encoded message will be written. This must have
+  *               space for #FAST_ENCODE_MAX_SIZE bytes.
+  * \param out_length The length of the encoded message, in bytes, will be
+  *                   written here.
+  * \return false on success, true if a bytes field was too long.
+  */
+static bool fastEncode(const pb_field_t fields[], const void *src_struct, uint8_t *buffer, size_t *out_length)
+{
+	if (fields == Address_fields)
+	{
+		return fastEncodeAddress((const Address *)src_struct, buffer, out_length);
+	}
+	else if (fields == Signature_fields)
+	{
+		return fastEncodeSignature((const Signature *)src_struct, buffer, out_length);
+	}
+	else if (fields == NumberOfAddresses_fields)
+	{
+		return fastEncodeNumberOfAddresses((const NumberOfAddresses *)src_struct, buffer, out_length);
+	}
+	else
+	{
+		fatalError(); // canFastEncode() should have been checked
+		return true;
+	}
+}
+
+/** Check whether fastDecode() can decode a message.
+  * \param fields Field description array of the message.
+  * \return Whether there is a specialised decoder for the message.
+  */
+static bool canFastDecode(const pb_field_t fields[])
+{
+	return (fields == GetAddressAndPublicKey_fields)
+		|| (fields == GetNumberOfAddresses_fields)
+		|| (fields == NewAddress_fields)
+		|| (fields == ButtonAck_fields);
+}
+
+/** Decode a message using its specialised decoder. This accepts the same
+  * messages as pb_decode() does (including ones with unknown fields, which
+  * are skipped), except that it is stricter about the wire type of known
+  * fields.
+  * \param fields Field description array of the message. canFastDecode()
+  *               must have returned true for it.
+  * \param buffer The encoded message.
+  * \param length The length of the encoded message, in bytes.
+  * \param dest_struct Where field data will be stored.
+  * \return false on success, true if a parse error occurred.
+  */
+static bool fastDecode(const pb_field_t fields[], const uint8_t *buffer, size_t length, void *dest_struct)
+{
+	if (fields == GetAddressAndPublicKey_fields)
+	{
+		return fastDecodeGetAddressAndPublicKey(buffer, length, (GetAddressAndPublicKey *)dest_struct);
+	}
+	else
+	{
+		return fastDecodeEmpty(buffer, length);
+	}
+}
+
+#endif // #ifndef MESSAGES_FAST_H_INCLUDED
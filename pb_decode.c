@@ -124,6 +124,44 @@ bool checkreturn pb_read(pb_istream_t *stream, uint8_t *buf, size_t count)
     return true;
 }
 
+/* Memory-backed streams (see pb_istream_from_buffer()) can be decoded
+ * straight from the buffer, instead of going through pb_read() once per
+ * byte. */
+#ifndef PB_BUFFER_ONLY
+#define IS_BUFFER_STREAM(stream) ((stream)->callback == &buf_read)
+#else
+#define IS_BUFFER_STREAM(stream) true
+#endif
+
+/* Fast path of pb_decode_varint() and pb_decode_varint32() for memory-backed
+ * streams. Values wider than maxbits are rejected, like the slow path. */
+static bool checkreturn buf_decode_varint(pb_istream_t *stream, uint64_t *dest, uint8_t maxbits)
+{
+    uint8_t *source = (uint8_t*)stream->state;
+    size_t count = 0;
+    uint8_t bitpos = 0;
+    uint64_t result = 0;
+    uint8_t byte;
+    
+    do
+    {
+        if (bitpos >= maxbits)
+            PB_RETURN_ERROR(stream, "varint overflow");
+        
+        if (count >= stream->bytes_left)
+            PB_RETURN_ERROR(stream, "end-of-stream");
+        
+        byte = source[count++];
+        result |= (uint64_t)(byte & 0x7F) << bitpos;
+        bitpos = (uint8_t)(bitpos + 7);
+    } while (byte & 0x80);
+    
+    stream->state = source + count;
+    stream->bytes_left -= count;
+    *dest = result;
+    return true;
+}
+
 pb_istream_t pb_istream_from_buffer(uint8_t *buf, size_t bufsize)
 {
     pb_istream_t stream;
@@ -149,6 +187,16 @@ static bool checkreturn pb_decode_varint32(pb_istream_t *stream, uint32_t *dest)
     uint8_t byte;
     uint32_t result;
     
+    if (IS_BUFFER_STREAM(stream))
+    {
+        uint64_t value;
+        if (!buf_decode_varint(stream, &value, 32))
+            return false;
+        
+        *dest = (uint32_t)value;
+        return true;
+    }
+    
     if (!pb_read(stream, &byte, 1))
         return false;
     
@@ -186,6 +234,9 @@ bool checkreturn pb_decode_varint(pb_istream_t *stream, uint64_t *dest)
     uint8_t bitpos = 0;
     uint64_t result = 0;
     
+    if (IS_BUFFER_STREAM(stream))
+        return buf_decode_varint(stream, dest, 64);
+    
     do
     {
         if (bitpos >= 64)
@@ -205,6 +256,23 @@ bool checkreturn pb_decode_varint(pb_istream_t *stream, uint64_t *dest)
 bool checkreturn pb_skip_varint(pb_istream_t *stream)
 {
     uint8_t byte;
+    
+    if (IS_BUFFER_STREAM(stream))
+    {
+        uint8_t *source = (uint8_t*)stream->state;
+        size_t count = 0;
+        do
+        {
+            if (count >= stream->bytes_left)
+                PB_RETURN_ERROR(stream, "end-of-stream");
+            byte = source[count++];
+        } while (byte & 0x80);
+        
+        stream->state = source + count;
+        stream->bytes_left -= count;
+        return true;
+    }
+    
     do
     {
         if (!pb_read(stream, &byte, 1))
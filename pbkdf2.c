@@ -4,7 +4,8 @@
   *
   * PBKDF2 can be used to derive encryption keys from a password. The
   * number of iterations is controlled by the platform-dependent
-  * getPBKDF2Iterations() function. Using PBKDF2 provides more resistance
+  * getPBKDF2Iterations() function, unless it has been measured on the
+  * device using calibratePBKDF2Iterations(). Using PBKDF2 provides more resistance
   * against online and offline brute-force attacks, as compared to using
   * a hash function once.
   *
@@ -20,14 +21,22 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 #include "test_helpers.h"
 #endif // #ifdef TEST_PBKDF2
 
+#ifdef BENCH_PBKDF2
+#include <stdlib.h>
+#include "test_helpers.h"
+#endif // #ifdef BENCH_PBKDF2
+
 #include "common.h"
 #include "hmac_sha512.h"
 #include "endian.h"
 #include "hwinterface.h"
+#include "stream_comm.h"
 #include "pbkdf2.h"
+#include "scratch.h"
 
 /** Derive a key using the specified password and salt, using HMAC-SHA512 as
   * the underlying pseudo-random function. The derived key length is fixed
@@ -43,47 +52,137 @@
   * \param password_length The length (in bytes) of the password.
   * \param salt Byte array specifying the salt to use in PBKDF2.
   * \param salt_length The length (in bytes) of the salt.
+  * \param num_iterations The number of iterations. This should be a power
+  *                       of 2 (see getPBKDF2Iterations()).
+  * \return false on success, true if the host cancelled key derivation (see
+  *         longOperationYield()). If key derivation was cancelled, out will
+  *         be cleared.
   * \warning salt cannot be too long; salt_length must be less than or equal
   *          to #SHA512_HASH_LENGTH - 4.
   */
-void pbkdf2(uint8_t *out, const uint8_t *password, const unsigned int password_length, const uint8_t *salt, const unsigned int salt_length)
+bool pbkdf2WithIterations(uint8_t *out, const uint8_t *password, const unsigned int password_length, const uint8_t *salt, const unsigned int salt_length, uint32_t num_iterations)
 {
-	uint8_t u[SHA512_HASH_LENGTH];
-	uint8_t hmac_result[SHA512_HASH_LENGTH];
+	ScratchMark mark;
+	uint8_t *u;
+	uint8_t *hmac_result;
+	HmacSha512Context ctx;
 	unsigned int u_length;
-	uint32_t num_iterations;
 	uint32_t i;
 	unsigned int j;
+	bool cancelled;
 
 	memset(out, 0, SHA512_HASH_LENGTH);
-	memset(u, 0, sizeof(u));
 	if (salt_length > (SHA512_HASH_LENGTH - 4))
 	{
 		// Salt too long.
 		fatalError();
-		return;
+		return false;
 	}
 	else
 	{
 		u_length = salt_length;
 	}
+	mark = scratchMark();
+	u = scratchAllocate(SHA512_HASH_LENGTH);
+	hmac_result = scratchAllocate(SHA512_HASH_LENGTH);
+	memset(u, 0, SHA512_HASH_LENGTH);
 	memcpy(u, salt, u_length);
 	writeU32BigEndian(&(u[u_length]), 1);
 	u_length += 4;
 
-	num_iterations = getPBKDF2Iterations();
+	performanceBurstBegin();
+	// The password is the HMAC key for every iteration, so the padded key
+	// blocks only need to be hashed once.
+	hmacSha512Begin(&ctx, password, password_length);
+	cancelled = false;
 	for (i = 0; i < num_iterations; i++)
 	{
-		hmacSha512(hmac_result, password, password_length, u, u_length);
-		memcpy(u, hmac_result, sizeof(u));
+		if (longOperationYield(LONG_OPERATION_DERIVE_KEY, i, num_iterations))
+		{
+			cancelled = true;
+			memset(out, 0, SHA512_HASH_LENGTH);
+			break;
+		}
+		hmacSha512Compute(hmac_result, &ctx, u, u_length);
+		memcpy(u, hmac_result, SHA512_HASH_LENGTH);
 		u_length = SHA512_HASH_LENGTH;
 		for (j = 0; j < SHA512_HASH_LENGTH; j++)
 		{
 			out[j] ^= u[j];
 		}
 	}
+	memset(&ctx, 0, sizeof(ctx));
+	performanceBurstEnd();
+	scratchRelease(mark); // clears u and hmac_result
+	return cancelled;
+}
+
+/** Derive a key using pbkdf2WithIterations(), with the number of iterations
+  * returned by getPBKDF2Iterations(). See pbkdf2WithIterations() for
+  * parameters and return value.
+  */
+bool pbkdf2(uint8_t *out, const uint8_t *password, const unsigned int password_length, const uint8_t *salt, const unsigned int salt_length)
+{
+	return pbkdf2WithIterations(out, password, password_length, salt, salt_length, getPBKDF2Iterations());
+}
+
+#if defined(ENABLE_BENCHMARK) || defined(ENABLE_DIAGNOSTICS)
+
+/** Measure how fast HMAC-SHA512 is on this device and choose the number of
+  * PBKDF2 iterations which fits in a time budget. Since clocks and
+  * compiler settings change between board revisions, this gives a better
+  * answer than a hard-coded constant. The answer is a power of 2 (see
+  * getPBKDF2Iterations()), rounded down, and is clamped to the range
+  * #PBKDF2_MIN_ITERATIONS to #PBKDF2_MAX_ITERATIONS (inclusive).
+  * \param target_cycles The time budget for one key derivation, in
+  *                      getCycleCount() ticks.
+  * \return The chosen number of iterations.
+  */
+uint32_t calibratePBKDF2Iterations(uint32_t target_cycles)
+{
+	ScratchMark mark;
+	uint8_t *u;
+	uint8_t *hmac_result;
+	HmacSha512Context ctx;
+	uint32_t start;
+	uint32_t cycles_per_iteration;
+	uint32_t num_iterations;
+	unsigned int i;
+
+	mark = scratchMark();
+	u = scratchAllocate(SHA512_HASH_LENGTH);
+	hmac_result = scratchAllocate(SHA512_HASH_LENGTH);
+	memset(u, 0, SHA512_HASH_LENGTH);
+	hmacSha512Begin(&ctx, u, 8);
+	// Time the same operation as the inner loop of pbkdf2WithIterations().
+	start = getCycleCount();
+	for (i = 0; i < PBKDF2_CALIBRATION_ROUNDS; i++)
+	{
+		hmacSha512Compute(hmac_result, &ctx, u, SHA512_HASH_LENGTH);
+		memcpy(u, hmac_result, SHA512_HASH_LENGTH);
+	}
+	cycles_per_iteration = (getCycleCount() - start + PBKDF2_CALIBRATION_ROUNDS - 1) / PBKDF2_CALIBRATION_ROUNDS;
+	memset(&ctx, 0, sizeof(ctx));
+	scratchRelease(mark);
+	if (cycles_per_iteration == 0)
+	{
+		cycles_per_iteration = 1; // cycle counter is too coarse
+	}
+
+	// Double the number of iterations for as long as it stays in budget.
+	// Dividing the budget (rather than multiplying the cost) avoids
+	// overflow.
+	num_iterations = PBKDF2_MIN_ITERATIONS;
+	while ((num_iterations < PBKDF2_MAX_ITERATIONS)
+		&& ((num_iterations * 2) <= (target_cycles / cycles_per_iteration)))
+	{
+		num_iterations *= 2;
+	}
+	return num_iterations;
 }
 
+#endif // #if defined(ENABLE_BENCHMARK) || defined(ENABLE_DIAGNOSTICS)
+
 #ifdef TEST
 
 /** PBKDF2 is used to derive encryption keys. In order to make brute-force
@@ -290,8 +389,63 @@ int main(void)
 		}
 	}
 
+	// The number of iterations should make a difference.
+	pbkdf2WithIterations(out, (const uint8_t *)"1", 1, (const uint8_t *)"2", 1, getPBKDF2Iterations() / 2);
+	if (memcmp(out, pbkdf2_test_vectors[0].expected_result, SHA512_HASH_LENGTH))
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("Number of iterations is ignored\n");
+		reportFailure();
+	}
+
+	// Calibration should give a power of 2 within the limits, and a bigger
+	// budget shouldn't give fewer iterations.
+	if ((calibratePBKDF2Iterations(0) == PBKDF2_MIN_ITERATIONS)
+		&& (calibratePBKDF2Iterations(0xffffffff) == PBKDF2_MAX_ITERATIONS))
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("Calibration doesn't respect limits\n");
+		reportFailure();
+	}
+	i = (unsigned int)calibratePBKDF2Iterations(CLOCKS_PER_SEC / 10);
+	if ((i >= PBKDF2_MIN_ITERATIONS) && (i <= PBKDF2_MAX_ITERATIONS) && ((i & (i - 1)) == 0))
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("Calibration gave %u iterations\n", i);
+		reportFailure();
+	}
+	printf("Iterations for 100 ms: %u\n", i);
+
 	finishTests();
 	exit(0);
 }
 
 #endif // #ifdef TEST_PBKDF2
+
+#ifdef BENCH_PBKDF2
+
+/** Derive a key, using getPBKDF2Iterations() iterations. */
+static void benchPbkdf2(void)
+{
+	uint8_t out[SHA512_HASH_LENGTH];
+
+	pbkdf2(out, (const uint8_t *)"password", 8, (const uint8_t *)"saltsalt", 8);
+}
+
+int main(void)
+{
+	initBenchmarks(__FILE__);
+	runHostBenchmark("pbkdf2", &benchPbkdf2, 0);
+	exit(0);
+}
+
+#endif // #ifdef BENCH_PBKDF2
@@ -10,6 +10,38 @@
 
 #include "common.h"
 
-extern void pbkdf2(uint8_t *out, const uint8_t *password, const unsigned int password_length, const uint8_t *salt, const unsigned int salt_length);
+#ifndef PBKDF2_MIN_ITERATIONS
+/** Smallest number of iterations which calibratePBKDF2Iterations() will
+  * choose, however slow the device is. This must be a power of 2. This can
+  * be overridden by defining PBKDF2_MIN_ITERATIONS in the platform's build
+  * settings. */
+#define PBKDF2_MIN_ITERATIONS		64
+#endif // #ifndef PBKDF2_MIN_ITERATIONS
+
+#ifndef PBKDF2_MAX_ITERATIONS
+/** Largest number of iterations which calibratePBKDF2Iterations() will
+  * choose. This must be a power of 2, and is also the largest stored number
+  * of iterations which is accepted as valid. This can be overridden by
+  * defining PBKDF2_MAX_ITERATIONS in the platform's build settings. */
+#define PBKDF2_MAX_ITERATIONS		0x100000
+#endif // #ifndef PBKDF2_MAX_ITERATIONS
+
+// If PBKDF2_TARGET_CYCLES is defined (in the platform's build settings), it
+// is the time budget for key derivation, in getCycleCount() ticks, and
+// calibrateKeyDerivation() uses it to choose the number of iterations when
+// the wallet area is formatted.
+#if defined(PBKDF2_TARGET_CYCLES) && !defined(ENABLE_BENCHMARK) && !defined(ENABLE_DIAGNOSTICS)
+#error "PBKDF2_TARGET_CYCLES needs getCycleCount(); define ENABLE_DIAGNOSTICS as well"
+#endif
+
+/** Number of HMAC-SHA512 operations which calibratePBKDF2Iterations() times.
+  * More gives a more accurate answer, but takes longer. */
+#define PBKDF2_CALIBRATION_ROUNDS	32
+
+extern bool pbkdf2WithIterations(uint8_t *out, const uint8_t *password, const unsigned int password_length, const uint8_t *salt, const unsigned int salt_length, uint32_t num_iterations);
+extern bool pbkdf2(uint8_t *out, const uint8_t *password, const unsigned int password_length, const uint8_t *salt, const unsigned int salt_length);
+#if defined(ENABLE_BENCHMARK) || defined(ENABLE_DIAGNOSTICS)
+extern uint32_t calibratePBKDF2Iterations(uint32_t target_cycles);
+#endif // #if defined(ENABLE_BENCHMARK) || defined(ENABLE_DIAGNOSTICS)
 
 #endif // #ifndef PBKDF2_H_INCLUDED
@@ -11,11 +11,14 @@
   * meaningful.
   *
   * The results of conversions are written into #adc_sample_buffer using DMA
-  * transfers. To begin a series of conversions, call beginFillingADCBuffer(),
-  * then wait until isADCBufferFull() returns
-  * true. #adc_sample_buffer will then contain #ADC_SAMPLE_BUFFER_SIZE
-  * samples. This interface allows one buffer of samples to be collected while
-  * the previous one is processed, which speeds up entropy collection.
+  * transfers. There are #ADC_BUFFER_COUNT buffers, which are filled in turn.
+  * To begin a series of conversions, call startADCSampling(). Each time
+  * getFullADCBuffer() returns a non-NULL pointer, that buffer contains
+  * #ADC_SAMPLE_BUFFER_SIZE samples; call releaseADCBuffer() once the
+  * samples are no longer needed. This interface allows one buffer of samples
+  * to be collected while the previous one is processed, which speeds up
+  * entropy collection. If every buffer is full, collection stops until one
+  * is released.
   *
   * For details on hardware interfacing requirements, see initADC().
   *
@@ -28,14 +31,23 @@
   */
 
 #include <stdint.h>
+#include <stdlib.h> // for definition of NULL
 #include <p32xxxx.h>
 #include "adc.h"
 #include "pic32_system.h"
 
-/** A place to store samples from the ADC. When isADCBufferFull() returns
-  * true, every entry in this array will be filled with ADC samples
+/** A place to store samples from the ADC. When getFullADCBuffer() returns
+  * one of these buffers, every entry in it will be filled with ADC samples
   * taken periodically. */
-volatile uint16_t adc_sample_buffer[ADC_SAMPLE_BUFFER_SIZE];
+volatile uint16_t adc_sample_buffer[ADC_BUFFER_COUNT][ADC_SAMPLE_BUFFER_SIZE];
+/** Index into #adc_sample_buffer of the buffer which the DMA channel is
+  * filling, or will fill next if it isn't running. */
+static volatile unsigned int fill_index;
+/** Number of buffers which are full and haven't been released yet. The
+  * oldest of them is the one that getFullADCBuffer() returns. */
+static volatile unsigned int full_count;
+/** Whether the DMA channel is currently filling a buffer. */
+static volatile bool is_dma_running;
 
 /** Set up the PIC32 ADC to sample from AN2 periodically using Timer3 as the
   * trigger. DMA is used to move the ADC result into #adc_sample_buffer. */
@@ -58,6 +70,12 @@ void initADC(void)
 	DCH0ECONbits.CHSIRQ = _ADC_IRQ; // start transfer on ADC interrupt
 	DCH0ECONbits.SIRQEN = 1; // start cell transfer on IRQ
 	DCH0INTCLR = 0x00ff00ff; // clear existing events, disable all interrupts
+	// The interrupt is only used to move on to the next buffer, so it can
+	// be higher priority than the USB interrupt; this reduces the gap
+	// between buffers.
+	IPC9bits.DMA0IP = 3; // priority level = 3
+	IPC9bits.DMA0IS = 0; // sub-priority level = 0
+	IEC1bits.DMA0IE = 1; // enable DMA channel 0 interrupt
 
 	// Initialise ADC module.
 	AD1CON1bits.ON = 0; // turn ADC module off
@@ -104,21 +122,11 @@ void initADC(void)
 	T3CONbits.ON = 1; // turn timer on
 }
 
-/** Begin collecting #ADC_SAMPLE_BUFFER_SIZE samples, filling
-  * up #adc_sample_buffer. This will return before all the samples have been
-  * collected, allowing the caller to do something else while samples are
-  * collected in the background. isADCBufferFull() can be used to determine
-  * when #adc_sample_buffer is full.
-  *
-  * It is okay to call this while the sample buffer is still being filled up.
-  * In that case, calling this will abort the current fill and commence
-  * filling from the start.
+/** Start the DMA channel filling the buffer at #fill_index. This must be
+  * called with interrupts disabled (or from an interrupt service handler).
   */
-void beginFillingADCBuffer(void)
+static void startDMATransfer(void)
 {
-	uint32_t status;
-
-	status = disableInterrupts();
 	DCH0CONbits.CHEN = 0; // disable channel
 	asm("nop"); // just to be safe
 	DCH0ECONbits.CABORT = 1; // abort any existing transfer and reset pointers
@@ -135,25 +143,96 @@ void beginFillingADCBuffer(void)
 	DCH0ECONbits.CABORT = 0;
 	DCH0INTCLR = 0x00ff00ff; // clear existing events, disable all interrupts
 	DCH0SSA = VIRTUAL_TO_PHYSICAL(&ADC1BUF0); // transfer source physical address
-	DCH0DSA = VIRTUAL_TO_PHYSICAL(&adc_sample_buffer); // transfer destination physical address
+	DCH0DSA = VIRTUAL_TO_PHYSICAL(&(adc_sample_buffer[fill_index])); // transfer destination physical address
 	DCH0SSIZ = sizeof(uint16_t); // source size
-	DCH0DSIZ = sizeof(adc_sample_buffer); // destination size
+	DCH0DSIZ = sizeof(adc_sample_buffer[0]); // destination size
 	DCH0CSIZ = sizeof(uint16_t); // cell size (bytes transferred per event)
+	DCH0INTbits.CHBCIE = 1; // interrupt on block transfer complete
 	DCH0CONbits.CHEN = 1; // enable channel
+	is_dma_running = true;
+	// Entering/exiting idle mode causes a lot of interference, so don't do
+	// that while samples are being collected.
+	suppressIdleMode(true);
+}
+
+/** Interrupt service handler for DMA channel 0. This is called whenever a
+  * buffer in #adc_sample_buffer has been filled. It will start filling the
+  * next buffer, if there is a free one. */
+void __attribute__((vector(_DMA_0_VECTOR), interrupt(ipl3), nomips16)) _DMA0Handler(void)
+{
+	DCH0INTCLR = 0x000000ff; // clear all channel event flags
+	IFS1bits.DMA0IF = 0; // clear interrupt flag
+	is_dma_running = false;
+	full_count++;
+	fill_index = (fill_index + 1) % ADC_BUFFER_COUNT;
+	if (full_count < ADC_BUFFER_COUNT)
+	{
+		startDMATransfer();
+	}
+	else
+	{
+		suppressIdleMode(false);
+	}
+}
+
+/** Begin collecting samples into #adc_sample_buffer. This will return
+  * before any samples have been collected, allowing the caller to do
+  * something else while samples are collected in the background.
+  * getFullADCBuffer() can be used to determine when a buffer is full.
+  *
+  * It is okay to call this while samples are already being collected; in
+  * that case this does nothing.
+  */
+void startADCSampling(void)
+{
+	uint32_t status;
+
+	status = disableInterrupts();
+	if (!is_dma_running && (full_count < ADC_BUFFER_COUNT))
+	{
+		startDMATransfer();
+	}
 	restoreInterrupts(status);
 }
 
-/** Check whether ADC buffer (#adc_sample_buffer) is full.
-  * \return false if ADC buffer is not full, true if it is.
+/** Get the oldest full buffer in #adc_sample_buffer. The buffer will not be
+  * overwritten until releaseADCBuffer() is called.
+  * \return A pointer to the buffer, which contains #ADC_SAMPLE_BUFFER_SIZE
+  *         samples, or NULL if no buffer is full yet.
   */
-bool isADCBufferFull(void)
+volatile uint16_t *getFullADCBuffer(void)
 {
-	if (DCH0INTbits.CHBCIF != 0)
+	uint32_t status;
+	unsigned int index;
+	unsigned int count;
+
+	status = disableInterrupts();
+	index = fill_index;
+	count = full_count;
+	restoreInterrupts(status);
+	if (count == 0)
 	{
-		return true;
+		return NULL;
 	}
-	else
+	index = (index + ADC_BUFFER_COUNT - count) % ADC_BUFFER_COUNT;
+	return adc_sample_buffer[index];
+}
+
+/** Release the buffer returned by getFullADCBuffer(), so that it can be
+  * filled again. If sample collection had stopped because every buffer was
+  * full, this will restart it. */
+void releaseADCBuffer(void)
+{
+	uint32_t status;
+
+	status = disableInterrupts();
+	if (full_count > 0)
 	{
-		return false;
+		full_count--;
+		if (!is_dma_running)
+		{
+			startDMATransfer();
+		}
 	}
+	restoreInterrupts(status);
 }
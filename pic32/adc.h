@@ -16,11 +16,15 @@
   *          will attempt to read past the end of the sample buffer.
   */
 #define ADC_SAMPLE_BUFFER_SIZE	(FFT_SIZE * 4)
+/** Number of buffers in #adc_sample_buffer. With 2, one buffer can be
+  * filled while the other is processed. */
+#define ADC_BUFFER_COUNT		2
 
-extern volatile uint16_t adc_sample_buffer[ADC_SAMPLE_BUFFER_SIZE];
+extern volatile uint16_t adc_sample_buffer[ADC_BUFFER_COUNT][ADC_SAMPLE_BUFFER_SIZE];
 
 extern void initADC(void);
-extern void beginFillingADCBuffer(void);
-extern bool isADCBufferFull(void);
+extern void startADCSampling(void);
+extern volatile uint16_t *getFullADCBuffer(void);
+extern void releaseADCBuffer(void);
 
 #endif // #ifndef PIC32_ADC_H_INCLUDED
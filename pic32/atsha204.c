@@ -30,6 +30,7 @@
 #include "../common.h"
 #include "pic32_system.h"
 #include "atsha204.h"
+#include "atsha204_crc.h"
 
 /** Token which represents a one bit. It is sent least-significant bit
   * first. */
@@ -311,43 +312,6 @@ static void sendWakeToken(void)
 	delayCycles(3 * CYCLES_PER_MILLISECOND); // 3 ms
 }
 
-/** Calculate the CRC16 of a stream of bits, using the generator polynomial
-  * 0x8005 (as the ATSHA204 does).
-  * \param buffer Array of bytes containing the bits to calculate the CRC16 of.
-  *               The bits will be read least-significant bit first.
-  * \param length_bits The length, in bytes, of the stream.
-  * \return The CRC16 of the stream of bits.
-  */
-static uint16_t calculateCRC16(uint8_t *buffer, uint32_t length)
-{
-	uint32_t i;
-	uint16_t remainder;
-	unsigned int bit_counter;
-	uint8_t one_byte;
-	unsigned int one_bit;
-
-	remainder = 0;
-	bit_counter = 0;
-	one_byte = 0;
-	for (i = 0; i < (length * 8); i++)
-	{
-		if (bit_counter == 0)
-		{
-			one_byte = *buffer;
-			buffer++;
-		}
-		bit_counter = (bit_counter + 1) & 7;
-		one_bit = ((remainder >> 15) ^ one_byte) & 1;
-		remainder <<= 1;
-		if (one_bit == 1)
-		{
-			remainder ^= 0x8005; // generator polynomial
-		}
-		one_byte >>= 1;
-	}
-	return remainder;
-}
-
 /** Calculate the CRC16 of a byte array and append that CRC16 to the array.
   * \param buffer Array of bytes containing the data to calculate the CRC16
   *               of. The CRC16 will be appended to the end of the array, hence
@@ -0,0 +1,205 @@
+/** \file atsha204_crc.c
+  *
+  * \brief Calculates the CRC16 which protects ATSHA204 I/O blocks.
+  *
+  * Every block sent to or received from the ATSHA204 ends with a CRC16
+  * using the generator polynomial 0x8005, where the bits of each byte are
+  * fed in least-significant bit first (see section 8.1.4 of the ATSHA204
+  * datasheet). Calculating that one bit at a time costs a few hundred
+  * cycles per byte, which adds up over the many blocks involved in
+  * gathering entropy. This does it one byte at a time, using a 512 byte
+  * table of remainders and a 16 byte table for reversing the order of bits.
+  * Both tables are const, so they live in flash.
+  *
+  * This file doesn't touch any hardware, so its unit test can run on a
+  * host. Compile it with something like:
+  * gcc -DTEST -DTEST_ATSHA204_CRC -I.. -o test_atsha204_crc atsha204_crc.c ../test_helpers.c
+  * The test checks the table-driven implementation against the original
+  * bit-at-a-time implementation.
+  *
+  * This file is licensed as described by the file LICENCE.
+  */
+
+#ifdef TEST_ATSHA204_CRC
+#include <stdio.h>
+#include <stdlib.h>
+#include "test_helpers.h"
+#endif // #ifdef TEST_ATSHA204_CRC
+
+#include <stdint.h>
+#include "../common.h"
+#include "atsha204_crc.h"
+
+/** Remainders (modulo the generator polynomial 0x8005) of each possible
+  * byte, where the byte is fed in most-significant bit first. */
+static const uint16_t crc16_table[256] = {
+	0x0000, 0x8005, 0x800f, 0x000a, 0x801b, 0x001e, 0x0014, 0x8011,
+	0x8033, 0x0036, 0x003c, 0x8039, 0x0028, 0x802d, 0x8027, 0x0022,
+	0x8063, 0x0066, 0x006c, 0x8069, 0x0078, 0x807d, 0x8077, 0x0072,
+	0x0050, 0x8055, 0x805f, 0x005a, 0x804b, 0x004e, 0x0044, 0x8041,
+	0x80c3, 0x00c6, 0x00cc, 0x80c9, 0x00d8, 0x80dd, 0x80d7, 0x00d2,
+	0x00f0, 0x80f5, 0x80ff, 0x00fa, 0x80eb, 0x00ee, 0x00e4, 0x80e1,
+	0x00a0, 0x80a5, 0x80af, 0x00aa, 0x80bb, 0x00be, 0x00b4, 0x80b1,
+	0x8093, 0x0096, 0x009c, 0x8099, 0x0088, 0x808d, 0x8087, 0x0082,
+	0x8183, 0x0186, 0x018c, 0x8189, 0x0198, 0x819d, 0x8197, 0x0192,
+	0x01b0, 0x81b5, 0x81bf, 0x01ba, 0x81ab, 0x01ae, 0x01a4, 0x81a1,
+	0x01e0, 0x81e5, 0x81ef, 0x01ea, 0x81fb, 0x01fe, 0x01f4, 0x81f1,
+	0x81d3, 0x01d6, 0x01dc, 0x81d9, 0x01c8, 0x81cd, 0x81c7, 0x01c2,
+	0x0140, 0x8145, 0x814f, 0x014a, 0x815b, 0x015e, 0x0154, 0x8151,
+	0x8173, 0x0176, 0x017c, 0x8179, 0x0168, 0x816d, 0x8167, 0x0162,
+	0x8123, 0x0126, 0x012c, 0x8129, 0x0138, 0x813d, 0x8137, 0x0132,
+	0x0110, 0x8115, 0x811f, 0x011a, 0x810b, 0x010e, 0x0104, 0x8101,
+	0x8303, 0x0306, 0x030c, 0x8309, 0x0318, 0x831d, 0x8317, 0x0312,
+	0x0330, 0x8335, 0x833f, 0x033a, 0x832b, 0x032e, 0x0324, 0x8321,
+	0x0360, 0x8365, 0x836f, 0x036a, 0x837b, 0x037e, 0x0374, 0x8371,
+	0x8353, 0x0356, 0x035c, 0x8359, 0x0348, 0x834d, 0x8347, 0x0342,
+	0x03c0, 0x83c5, 0x83cf, 0x03ca, 0x83db, 0x03de, 0x03d4, 0x83d1,
+	0x83f3, 0x03f6, 0x03fc, 0x83f9, 0x03e8, 0x83ed, 0x83e7, 0x03e2,
+	0x83a3, 0x03a6, 0x03ac, 0x83a9, 0x03b8, 0x83bd, 0x83b7, 0x03b2,
+	0x0390, 0x8395, 0x839f, 0x039a, 0x838b, 0x038e, 0x0384, 0x8381,
+	0x0280, 0x8285, 0x828f, 0x028a, 0x829b, 0x029e, 0x0294, 0x8291,
+	0x82b3, 0x02b6, 0x02bc, 0x82b9, 0x02a8, 0x82ad, 0x82a7, 0x02a2,
+	0x82e3, 0x02e6, 0x02ec, 0x82e9, 0x02f8, 0x82fd, 0x82f7, 0x02f2,
+	0x02d0, 0x82d5, 0x82df, 0x02da, 0x82cb, 0x02ce, 0x02c4, 0x82c1,
+	0x8243, 0x0246, 0x024c, 0x8249, 0x0258, 0x825d, 0x8257, 0x0252,
+	0x0270, 0x8275, 0x827f, 0x027a, 0x826b, 0x026e, 0x0264, 0x8261,
+	0x0220, 0x8225, 0x822f, 0x022a, 0x823b, 0x023e, 0x0234, 0x8231,
+	0x8213, 0x0216, 0x021c, 0x8219, 0x0208, 0x820d, 0x8207, 0x0202
+};
+
+/** Reverses the order of the bits in a nibble. */
+static const uint8_t reverse_nibble[16] = {
+	0x0, 0x8, 0x4, 0xc, 0x2, 0xa, 0x6, 0xe,
+	0x1, 0x9, 0x5, 0xd, 0x3, 0xb, 0x7, 0xf
+};
+
+/** Calculate the CRC16 of a stream of bits, using the generator polynomial
+  * 0x8005 (as the ATSHA204 does).
+  * \param buffer Array of bytes containing the bits to calculate the CRC16 of.
+  *               The bits will be read least-significant bit first.
+  * \param length The length, in bytes, of the stream.
+  * \return The CRC16 of the stream of bits.
+  */
+uint16_t calculateCRC16(const uint8_t *buffer, uint32_t length)
+{
+	uint32_t i;
+	uint16_t remainder;
+	uint8_t reflected;
+
+	remainder = 0;
+	for (i = 0; i < length; i++)
+	{
+		// The table is for most-significant bit first, so flip the byte
+		// around first.
+		reflected = (uint8_t)((reverse_nibble[buffer[i] & 0xf] << 4)
+			| reverse_nibble[buffer[i] >> 4]);
+		remainder = (uint16_t)((remainder << 8)
+			^ crc16_table[(uint8_t)(remainder >> 8) ^ reflected]);
+	}
+	return remainder;
+}
+
+#ifdef TEST_ATSHA204_CRC
+
+/** The original bit-at-a-time implementation of calculateCRC16(), which
+  * the table-driven one is tested against.
+  * \param buffer Array of bytes containing the bits to calculate the CRC16 of.
+  *               The bits will be read least-significant bit first.
+  * \param length The length, in bytes, of the stream.
+  * \return The CRC16 of the stream of bits.
+  */
+static uint16_t calculateCRC16Bitwise(const uint8_t *buffer, uint32_t length)
+{
+	uint32_t i;
+	uint16_t remainder;
+	unsigned int bit_counter;
+	uint8_t one_byte;
+	unsigned int one_bit;
+
+	remainder = 0;
+	bit_counter = 0;
+	one_byte = 0;
+	for (i = 0; i < (length * 8); i++)
+	{
+		if (bit_counter == 0)
+		{
+			one_byte = *buffer;
+			buffer++;
+		}
+		bit_counter = (bit_counter + 1) & 7;
+		one_bit = ((remainder >> 15) ^ one_byte) & 1;
+		remainder = (uint16_t)(remainder << 1);
+		if (one_bit == 1)
+		{
+			remainder ^= 0x8005; // generator polynomial
+		}
+		one_byte >>= 1;
+	}
+	return remainder;
+}
+
+/** Largest block to test, in bytes. */
+#define MAX_TEST_LENGTH		128
+
+int main(void)
+{
+	uint8_t buffer[MAX_TEST_LENGTH];
+	uint8_t wake_response[4] = {0x04, 0x11, 0x33, 0x43};
+	uint16_t crc16;
+	unsigned int i;
+	unsigned int j;
+	uint32_t length;
+
+	initTests(__FILE__);
+
+	// The response to a wake token, from section 8.1.6 of the ATSHA204
+	// datasheet, ends with the CRC16 of the first two bytes.
+	crc16 = calculateCRC16(wake_response, 2);
+	if ((crc16 == 0x4333) && (calculateCRC16Bitwise(wake_response, 2) == 0x4333))
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("Wrong CRC16 for wake response: %04x\n", crc16);
+		reportFailure();
+	}
+
+	// Every single-byte input exercises every table entry.
+	for (i = 0; i < 256; i++)
+	{
+		buffer[0] = (uint8_t)i;
+		if (calculateCRC16(buffer, 1) == calculateCRC16Bitwise(buffer, 1))
+		{
+			reportSuccess();
+		}
+		else
+		{
+			printf("CRC16 mismatch for byte %02x\n", i);
+			reportFailure();
+		}
+	}
+
+	// Random blocks of every length up to MAX_TEST_LENGTH, including 0.
+	for (j = 0; j < 100; j++)
+	{
+		for (length = 0; length <= MAX_TEST_LENGTH; length++)
+		{
+			fillWithRandom(buffer, length);
+			if (calculateCRC16(buffer, length) == calculateCRC16Bitwise(buffer, length))
+			{
+				reportSuccess();
+			}
+			else
+			{
+				printf("CRC16 mismatch for random block of length %u\n", (unsigned int)length);
+				reportFailure();
+			}
+		}
+	}
+
+	finishTests();
+	exit(0);
+}
+
+#endif // #ifdef TEST_ATSHA204_CRC
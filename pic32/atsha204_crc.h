@@ -0,0 +1,15 @@
+/** \file atsha204_crc.h
+  *
+  * \brief Describes functions exported by atsha204_crc.c
+  *
+  * This file is licensed as described by the file LICENCE.
+  */
+
+#ifndef ATSHA204_CRC_H_INCLUDED
+#define	ATSHA204_CRC_H_INCLUDED
+
+#include <stdint.h>
+
+extern uint16_t calculateCRC16(const uint8_t *buffer, uint32_t length);
+
+#endif	// #ifndef ATSHA204_CRC_H_INCLUDED
@@ -16,11 +16,21 @@
   * here is that the HWRNG is a white Gaussian noise source.
   * The statistical limits for each test are defined in hwrng_limits.h.
   *
+  * Samples are collected, filtered and tested in the background (see
+  * serviceHWRNG()), so that a tested array of samples is usually ready by
+  * the time hardwareRandom32Bytes() needs one.
+  *
+  * The ATSHA204 (see atsha204.c) also has a hardware random number
+  * generator. Its output can't be tested like the ADC samples can, so it is
+  * only ever mixed into (never substituted for) tested ADC samples, and no
+  * entropy is credited for it; see collectATSHA204Random().
+  *
   * This file is licensed as described by the file LICENCE.
   */
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 #include <p32xxxx.h>
 #include "../fix16.h"
 #include "../fft.h"
@@ -28,26 +38,18 @@
 #include "hwrng_limits.h"
 #include "adc.h"
 #include "pic32_system.h"
+#include "atsha204.h"
+#include "hwrng.h"
+
+#include "../hwinterface.h"
 
 #ifdef TEST_STATISTICS
 #include "ssd1306.h"
 #include "../endian.h"
-#include "../hwinterface.h"
 
 static void reportStatistics(uint32_t tests_failed);
 static void reportFftResults(ComplexFixed *fft_buffer);
 
-// These are copies of some variables in histogramTestsFailed() and
-// fftTestsFailed() which are reported by reportStatistics().
-static fix16_t most_recent_mean;
-static fix16_t most_recent_variance;
-static fix16_t most_recent_kappa3;
-static fix16_t most_recent_kappa4;
-static int most_recent_max_bin;
-static int most_recent_bandwidth;
-static fix16_t most_recent_max_autocorrelation;
-static fix16_t most_recent_entropy_estimate;
-
 /** Set to non-zero to send statistical properties to stream. 1 = moment-based
   * statistical properties, 2 = power spectral density estimate, 3 = bandwidth
   * estimate, 4 = autocorrelation results, 5 = maximum autocorrelation value
@@ -69,20 +71,99 @@ static int report_to_stream;
   * means higher quality and more computation time. To adjust this,
   * see #FILTER_HALF_ORDER. */
 #define FILTER_ORDER					(2 * FILTER_HALF_ORDER + 1)
+/** Index of the first decimated sample whose filter taps don't wrap around
+  * the start of the ADC buffer. See decimateADCBuffer(). */
+#define FIRST_LINEAR_OUTPUT				((FILTER_HALF_ORDER + OVERSAMPLE_RATIO - 1) / OVERSAMPLE_RATIO)
+/** Index of the decimated sample after the last one whose filter taps don't
+  * wrap around the end of the ADC buffer. See decimateADCBuffer(). */
+#define END_LINEAR_OUTPUT				(((ADC_SAMPLE_BUFFER_SIZE - 1 - FILTER_HALF_ORDER) / OVERSAMPLE_RATIO) + 1)
 /** FIR filter coefficients, calculated using calculate_fir_coefficients.m
-  * and expressed in Q16.16 fixed-point representation. */
+  * and expressed in Q16.16 fixed-point representation. The filter is a
+  * linear-phase (windowed sinc) filter, so the coefficients are symmetric;
+  * firFilterLinear() relies on this. */
 static const int32_t fir_lowpass_coefficients[FILTER_ORDER] = {
 -123, 202, 711, 0, -2681, -2929, 5309, 19161,
 26236,
 19161, 5309, -2929, -2681, 0, 711, 202, -123};
 
-/** Array of samples which have passed statistical tests. #SAMPLE_COUNT samples
-  * need to be stored because hardwareRandom32Bytes() cannot start returning
-  * samples from this array until all statistical tests have passed. */
-static volatile uint16_t samples[SAMPLE_COUNT];
-/** Number of samples in #samples that hardwareRandom32Bytes() has
-  * used up. */
-static uint32_t samples_consumed;
+/** Arrays of samples. #SAMPLE_COUNT samples need to be stored because
+  * hardwareRandom32Bytes() cannot start returning samples from an array
+  * until all statistical tests have passed. The array at #ready_array has
+  * been tested and is used by hardwareRandom32Bytes(); the other array is
+  * filled and tested by serviceHWRNG(). */
+static volatile uint16_t samples[2][SAMPLE_COUNT];
+/** Index into #samples of the tested array. */
+static unsigned int ready_array;
+/** Number of samples in the tested array that hardwareRandom32Bytes() has
+  * used up. It starts off as #SAMPLE_COUNT because there is no tested
+  * array at first. */
+static uint32_t samples_consumed = SAMPLE_COUNT;
+/** Number of samples in the other (not tested) array that serviceHWRNG()
+  * has filled in so far. */
+static uint32_t samples_filled;
+/** Whether the other array has been filled and tested, in which case it is
+  * waiting for hardwareRandom32Bytes() to swap it with the tested array. */
+static bool is_next_array_tested;
+/** Whether any statistical test failed for the other array. Only valid
+  * if #is_next_array_tested is true. */
+static bool next_array_failed;
+/** Entropy (in bits) credited for each sample in the tested array; see
+  * calculateEntropyPerSample(). */
+static fix16_t ready_array_entropy;
+/** Entropy (in bits) which will be credited for each sample in the other
+  * array. Only valid if #is_next_array_tested is true and
+  * #next_array_failed is false. */
+static fix16_t next_array_entropy;
+/** Whether beginHWRNGSampling() has been called. */
+static bool is_sampling_started;
+/** Health and throughput statistics, as returned by getHWRNGHealth(). The
+  * statistical tests write their results directly into this. */
+static HWRNGHealth health;
+
+#if !defined(TEST_STATISTICS) && !defined(DISABLE_ATSHA204_ENTROPY)
+/** Whether to mix ATSHA204 random output into the output of
+  * hardwareRandom32Bytes(). This is off in statistical test modes, since
+  * they are supposed to examine the ADC samples alone. It can also be turned
+  * off by defining DISABLE_ATSHA204_ENTROPY. */
+#define USE_ATSHA204_ENTROPY
+#endif // #if !defined(TEST_STATISTICS) && !defined(DISABLE_ATSHA204_ENTROPY)
+
+#ifdef USE_ATSHA204_ENTROPY
+
+/** Random bytes from the ATSHA204 which haven't been mixed into the output
+  * of hardwareRandom32Bytes() yet. Only valid if #is_atsha204_ready is
+  * true. */
+static uint8_t atsha204_bytes[32];
+/** Whether #atsha204_bytes contains unused random bytes. */
+static bool is_atsha204_ready;
+
+/** Fetch 32 random bytes from the ATSHA204 into #atsha204_bytes, unless
+  * there are some unused ones there already. The ATSHA204 takes tens of
+  * milliseconds to execute its "Random" command, but ADC samples are
+  * transferred by DMA, so they keep accumulating while this waits.
+  * hardwareRandom32Bytes() calls this only when it would otherwise be
+  * waiting for ADC samples, so the ATSHA204's latency is hidden.
+  *
+  * Failures are ignored (and #atsha204_bytes left unused), since the ADC
+  * samples are the primary entropy source.
+  */
+static void collectATSHA204Random(void)
+{
+	if (is_atsha204_ready)
+	{
+		return;
+	}
+	if (!atsha204Wake())
+	{
+		if (!atsha204Random(atsha204_bytes))
+		{
+			is_atsha204_ready = true;
+		}
+	}
+	atsha204Sleep();
+}
+
+#endif // #ifdef USE_ATSHA204_ENTROPY
 
 /** Obtains an estimate of the bandwidth of the HWRNG, based on the power
   * spectrum density estimate (see #psd_accumulator).
@@ -211,27 +292,22 @@ static NOINLINE uint32_t histogramTestsFailed(fix16_t *variance)
 	fix16_t entropy_estimate;
 
 	fix16_error_occurred = false;
-	mean = calculateCentralMoment(fix16_zero, 1);
-	*variance = calculateCentralMoment(mean, 2);
-	kappa3 = calculateCentralMoment(mean, 3);
-	kappa4 = calculateCentralMoment(mean, 4);
+	calculateMoments(&mean, variance, &kappa3, &kappa4);
 	moment_error_occurred = fix16_error_occurred;
 	fix16_error_occurred = false;
 	entropy_estimate = estimateEntropy();
 	entropy_error_occurred = fix16_error_occurred;
 
-#ifdef TEST_STATISTICS
-	most_recent_mean = mean;
-	most_recent_variance = *variance;
-	most_recent_kappa3 = kappa3;
-	most_recent_kappa4 = kappa4;
-	most_recent_entropy_estimate = entropy_estimate;
-#endif // #ifdef TEST_STATISTICS
+	health.mean = mean;
+	health.variance = *variance;
+	health.kappa3 = kappa3;
+	health.kappa4 = kappa4;
+	health.entropy_estimate = entropy_estimate;
 
 	tests_failed = 0;
 	// STATTEST_MIN_MEAN and STATTEST_MAX_MEAN are in ADC output numbers.
 	// To be comparable to mean, they need to be scaled and offset, just
-	// as samples are in updateIteratorCache().
+	// as samples are in scaleSample().
 	if (mean <= F16((STATTEST_MIN_MEAN - (HISTOGRAM_NUM_BINS / 2)) / SAMPLE_SCALE_DOWN))
 	{
 		tests_failed |= 1; // mean below minimum
@@ -317,10 +393,10 @@ static NOINLINE uint32_t fftTestsFailed(fix16_t variance)
 		// Report autocorrelation results.
 		reportFftResults(fft_buffer);
 	}
-	most_recent_max_bin = max_bin;
-	most_recent_bandwidth = bandwidth;
-	most_recent_max_autocorrelation = max_autocorrelation;
 #endif // #ifdef TEST_STATISTICS
+	health.max_bin = max_bin;
+	health.bandwidth = bandwidth;
+	health.max_autocorrelation = max_autocorrelation;
 
 	tests_failed = 0;
 	if (fix16_from_int(max_bin) < F16(PSD_MIN_PEAK * 2.0 * FFT_SIZE))
@@ -350,6 +426,30 @@ static NOINLINE uint32_t fftTestsFailed(fix16_t variance)
 	return tests_failed;
 }
 
+/** Work out how much entropy to credit for each sample of the array which
+  * was just tested, from its measured min-entropy (see
+  * estimateMinEntropy()) and bandwidth. This must be called after
+  * histogramTestsFailed() and fftTestsFailed(), while the histogram still
+  * describes that array. The result is limited to at most
+  * #MAX_ENTROPY_BITS_PER_SAMPLE, but it is never raised; if it's below
+  * #MIN_ENTROPY_BITS_PER_SAMPLE, the caller treats the array as failed.
+  * \return Entropy per sample, in bits.
+  */
+static fix16_t calculateEntropyPerSample(void)
+{
+	fix16_t entropy;
+
+	// The min-entropy is at most log2(SAMPLE_COUNT) bits and the bandwidth
+	// is at most FFT_SIZE bins (the Nyquist frequency), so this can't
+	// overflow.
+	entropy = (estimateMinEntropy() * health.bandwidth) / (FFT_SIZE * ENTROPY_DERATING_FACTOR);
+	if (entropy > F16(MAX_ENTROPY_BITS_PER_SAMPLE))
+	{
+		entropy = F16(MAX_ENTROPY_BITS_PER_SAMPLE);
+	}
+	return entropy;
+}
+
 /** Apply FIR filter to samples.
   * \param samples Array of input samples. It must
   *                contain #ADC_SAMPLE_BUFFER_SIZE samples.
@@ -379,70 +479,90 @@ static int32_t firFilter(const volatile uint16_t *samples, const unsigned int ba
 	return (sum >> 16) + ((sum >> 15) & 1); // round result
 }
 
-/** Gather #SAMPLE_COUNT ADC samples into #samples and run statistical tests
-  * on the sample array.
-  * \return false on success, true if any statistical test failed.
+/** Apply the FIR low-pass filter to samples which don't wrap around the end
+  * of the ADC buffer. This gives exactly the same result as firFilter()
+  * with #fir_lowpass_coefficients, but is faster because:
+  * - There is no need to mask every index.
+  * - The coefficients are symmetric, so pairs of samples which share a
+  *   coefficient can be added before multiplying, almost halving the number
+  *   of multiplications.
+  * - The sum is 64 bits wide, which lets the compiler use the MIPS32 HI/LO
+  *   accumulator (MADD) instead of separate multiply and add instructions.
+  * \param samples Pointer to the first of the #FILTER_ORDER input samples.
+  * \return The output sample.
   */
-static bool fillAndTestSamplesArray(void)
+static int32_t firFilterLinear(const volatile uint16_t *samples)
 {
+	int64_t sum; // Q16.16 fixed-point representation
 	unsigned int i;
-	unsigned int j;
-	unsigned int base_index;
-	int32_t filtered_sample;
-	uint32_t tests_failed;
-	fix16_t variance;
-
-	clearHistogram();
-	clearPowerSpectralDensity();
-	samples_consumed = 0;
 
-	// Fill samples array.
-	// The following loop assumes that #SAMPLE_COUNT is a multiple
-	// of #DECIMATED_SAMPLE_BUFFER_SIZE.
-#if ((SAMPLE_COUNT % DECIMATED_SAMPLE_BUFFER_SIZE) != 0)
-#error "SAMPLE_COUNT not a multiple of DECIMATED_SAMPLE_BUFFER_SIZE"
-#endif // #if ((SAMPLE_COUNT % DECIMATED_SAMPLE_BUFFER_SIZE) != 0)
-	for (i = 0; i < SAMPLE_COUNT; i += DECIMATED_SAMPLE_BUFFER_SIZE)
+	sum = (int64_t)((int32_t)samples[FILTER_HALF_ORDER]) * fir_lowpass_coefficients[FILTER_HALF_ORDER];
+	for (i = 0; i < FILTER_HALF_ORDER; i++)
 	{
-		suppressIdleMode(true); // start suppressing CPU idle mode
-		beginFillingADCBuffer();
-		while (!isADCBufferFull())
-		{
-			// do nothing
-		}
-		suppressIdleMode(false); // stop suppressing CPU idle mode
-		// Filter ADC samples, placing result into samples array.
-		for (j = 0; j < DECIMATED_SAMPLE_BUFFER_SIZE; j++)
-		{
-			// The "- FILTER_HALF_ORDER" is there to account for the
-			// delay of the low-pass filter.
-			base_index = ((j * OVERSAMPLE_RATIO) - FILTER_HALF_ORDER) & (ADC_SAMPLE_BUFFER_SIZE - 1);
-			filtered_sample = firFilter(adc_sample_buffer, base_index, fir_lowpass_coefficients, FILTER_ORDER);
-			samples[i + j] = filtered_sample;
-		}
+		sum += (int64_t)((int32_t)samples[i] + (int32_t)samples[FILTER_ORDER - 1 - i]) * fir_lowpass_coefficients[i];
 	}
+	return (int32_t)((sum >> 16) + ((sum >> 15) & 1)); // round result
+}
 
-	// Run statistical tests on samples array.
-	for (i = 0; i < SAMPLE_COUNT; i++)
+/** Filter and decimate one buffer of ADC samples.
+  * Only the decimated outputs are calculated. For almost all of them, the
+  * filter taps lie within one linear segment of the ADC buffer, so they can
+  * use firFilterLinear(). Only the few outputs near each end of the buffer,
+  * where the circular convolution wraps around, use firFilter().
+  * \param destination Where the #DECIMATED_SAMPLE_BUFFER_SIZE filtered
+  *                    samples will be written.
+  * \param adc_buffer The #ADC_SAMPLE_BUFFER_SIZE ADC samples to filter.
+  */
+static void decimateADCBuffer(volatile uint16_t *destination, const volatile uint16_t *adc_buffer)
+{
+	unsigned int j;
+
+	// The "- FILTER_HALF_ORDER"s are there to account for the delay of the
+	// low-pass filter.
+	for (j = 0; j < FIRST_LINEAR_OUTPUT; j++)
+	{
+		destination[j] = firFilter(adc_buffer, ((j * OVERSAMPLE_RATIO) - FILTER_HALF_ORDER) & (ADC_SAMPLE_BUFFER_SIZE - 1), fir_lowpass_coefficients, FILTER_ORDER);
+	}
+	for (; j < END_LINEAR_OUTPUT; j++)
 	{
-		incrementHistogram(samples[i]);
+		destination[j] = firFilterLinear(&(adc_buffer[(j * OVERSAMPLE_RATIO) - FILTER_HALF_ORDER]));
 	}
-	// The following loop assumes that #SAMPLE_COUNT is a multiple
-	// of #FFT_SIZE * 2.
-#if ((SAMPLE_COUNT % (FFT_SIZE * 2)) != 0)
-#error "SAMPLE_COUNT not a multiple of FFT_SIZE * 2"
-#endif // #if ((SAMPLE_COUNT % (FFT_SIZE * 2)) != 0)
-	for (i = 0; i < SAMPLE_COUNT; i += (FFT_SIZE * 2))
+	for (; j < DECIMATED_SAMPLE_BUFFER_SIZE; j++)
 	{
-		accumulatePowerSpectralDensity(&(samples[i]));
+		destination[j] = firFilter(adc_buffer, ((j * OVERSAMPLE_RATIO) - FILTER_HALF_ORDER) & (ADC_SAMPLE_BUFFER_SIZE - 1), fir_lowpass_coefficients, FILTER_ORDER);
 	}
+}
+
+/** Run statistical tests on the full (but not yet tested) array
+  * in #samples. The histogram and power spectral density accumulator must
+  * have already been updated with every sample in that array; see
+  * processADCBuffer().
+  * \return false on success, true if any statistical test failed.
+  */
+static bool samplesArrayTestsFailed(void)
+{
+	uint32_t tests_failed;
+	fix16_t variance;
+
+	performanceBurstBegin();
 	tests_failed = histogramTestsFailed(&variance);
 	tests_failed |= fftTestsFailed(variance);
+	performanceBurstEnd();
+	next_array_entropy = calculateEntropyPerSample();
+	if (next_array_entropy < F16(MIN_ENTROPY_BITS_PER_SAMPLE))
+	{
+		tests_failed |= 128; // entropy per sample below minimum
+	}
+	health.has_statistics = true;
+	health.last_failed_tests = tests_failed;
+	health.arrays_tested++;
+	health.samples_tested += SAMPLE_COUNT;
 #ifdef TEST_STATISTICS
 	reportStatistics(tests_failed);
 #endif // #ifdef TEST_STATISTICS
 	if (tests_failed != 0)
 	{
+		health.arrays_failed++;
 #ifdef IGNORE_HWRNG_FAILURE
 		PORTDSET = 0x10; // turn on red LED
 		delayCycles(CYCLES_PER_MILLISECOND * 100);
@@ -454,9 +574,109 @@ static bool fillAndTestSamplesArray(void)
 	return false;
 }
 
+/** If there is a full ADC buffer, filter it into the not yet tested array
+  * in #samples and accumulate statistics for it. Once that array is full,
+  * run the statistical tests on it. This does nothing if the array has
+  * already been tested, so that the array isn't overwritten before
+  * hardwareRandom32Bytes() uses it.
+  */
+static void processADCBuffer(void)
+{
+	volatile uint16_t *adc_buffer;
+	volatile uint16_t *destination;
+	unsigned int j;
+
+	if (is_next_array_tested)
+	{
+		return;
+	}
+	adc_buffer = getFullADCBuffer();
+	if (adc_buffer == NULL)
+	{
+		return;
+	}
+	if (samples_filled == 0)
+	{
+		clearHistogram();
+		clearPowerSpectralDensity();
+	}
+	// The following code assumes that #SAMPLE_COUNT is a multiple
+	// of #DECIMATED_SAMPLE_BUFFER_SIZE.
+#if ((SAMPLE_COUNT % DECIMATED_SAMPLE_BUFFER_SIZE) != 0)
+#error "SAMPLE_COUNT not a multiple of DECIMATED_SAMPLE_BUFFER_SIZE"
+#endif // #if ((SAMPLE_COUNT % DECIMATED_SAMPLE_BUFFER_SIZE) != 0)
+	destination = &(samples[ready_array ^ 1][samples_filled]);
+	// Filter ADC samples, placing result into samples array.
+	decimateADCBuffer(destination, adc_buffer);
+	// The ADC buffer can be refilled while the statistics are accumulated.
+	releaseADCBuffer();
+
+	for (j = 0; j < DECIMATED_SAMPLE_BUFFER_SIZE; j++)
+	{
+		incrementHistogram(destination[j]);
+	}
+	// The following loop assumes that #DECIMATED_SAMPLE_BUFFER_SIZE is a
+	// multiple of #FFT_SIZE * 2.
+#if ((DECIMATED_SAMPLE_BUFFER_SIZE % (FFT_SIZE * 2)) != 0)
+#error "DECIMATED_SAMPLE_BUFFER_SIZE not a multiple of FFT_SIZE * 2"
+#endif // #if ((DECIMATED_SAMPLE_BUFFER_SIZE % (FFT_SIZE * 2)) != 0)
+	for (j = 0; j < DECIMATED_SAMPLE_BUFFER_SIZE; j += (FFT_SIZE * 2))
+	{
+		accumulatePowerSpectralDensity(&(destination[j]));
+	}
+	samples_filled += DECIMATED_SAMPLE_BUFFER_SIZE;
+
+	if (samples_filled == SAMPLE_COUNT)
+	{
+		next_array_failed = samplesArrayTestsFailed();
+		is_next_array_tested = true;
+	}
+}
+
+/** Start collecting and testing HWRNG samples in the background. This can be
+  * called early (eg. at startup) so that a tested array of samples is ready
+  * by the time hardwareRandom32Bytes() is first called. If it isn't called,
+  * hardwareRandom32Bytes() will call it. */
+void beginHWRNGSampling(void)
+{
+	is_sampling_started = true;
+	startADCSampling();
+}
+
+/** Do some of the background work of collecting and testing HWRNG samples.
+  * This is registered as a background task (see runBackgroundTasks()), so
+  * it gets called whenever the CPU would otherwise be waiting for something
+  * (see enterIdleMode()) and during long-running operations. Each call processes at most one ADC
+  * buffer, so it doesn't take long. It does nothing if beginHWRNGSampling()
+  * hasn't been called yet.
+  *
+  * If TEST_STATISTICS is defined, this does nothing, because then the
+  * statistical tests write to the stream and so must not be run from
+  * inside a stream wait loop. hardwareRandom32Bytes() still does the work
+  * itself when it needs to.
+  */
+void serviceHWRNG(void)
+{
+#ifndef TEST_STATISTICS
+	if (is_sampling_started)
+	{
+		processADCBuffer();
+	}
+#endif // #ifndef TEST_STATISTICS
+}
+
 /** Fill buffer with 32 random bytes from a hardware random number generator.
   * \param buffer The buffer to fill. This should have enough space for 32
   *               bytes.
+  * If ATSHA204 random output is available (see collectATSHA204Random()), it
+  * is XORed into the ADC samples. Since the two sources are independent,
+  * this can't reduce the entropy of the result, which then gets mixed into
+  * the entropy pool by the caller (see getRandom256Internal()). The
+  * ATSHA204's generator is a black box which can't be tested here, so no
+  * entropy is credited for its output.
+  * The entropy credited for the ADC samples depends on what was measured
+  * for the array they came from (see calculateEntropyPerSample()), so the
+  * better the noise source, the fewer samples each getRandom256() uses.
   * \return An estimate of the total number of bits (not bytes) of entropy in
   *         the buffer on success, or a negative number if the hardware random
   *         number generator failed in any way. This may also return 0 to tell
@@ -469,15 +689,57 @@ int hardwareRandom32Bytes(uint8_t *buffer)
 	unsigned int i;
 	uint32_t sample;
 	bool tests_failed;
+	int entropy;
+#if defined(ENABLE_BENCHMARK) || defined(ENABLE_DIAGNOSTICS)
+	uint32_t wait_start;
+	uint32_t wait_ticks;
+#endif // #if defined(ENABLE_BENCHMARK) || defined(ENABLE_DIAGNOSTICS)
 
 	tests_failed = false;
-	if ((samples_consumed == 0) || (samples_consumed >= SAMPLE_COUNT))
+	if (samples_consumed >= SAMPLE_COUNT)
 	{
-		if (fillAndTestSamplesArray())
+		if (!is_sampling_started)
+		{
+			beginHWRNGSampling();
+		}
+		// Usually the next array has already been tested in the background,
+		// so this won't need to wait.
+		if (!is_next_array_tested)
+		{
+			health.blocked_calls++;
+#if defined(ENABLE_BENCHMARK) || defined(ENABLE_DIAGNOSTICS)
+			wait_start = getCycleCount();
+#endif // #if defined(ENABLE_BENCHMARK) || defined(ENABLE_DIAGNOSTICS)
+#ifdef USE_ATSHA204_ENTROPY
+			// Make use of the wait by getting the ATSHA204's contribution.
+			collectATSHA204Random();
+#endif // #ifdef USE_ATSHA204_ENTROPY
+			while (!is_next_array_tested)
+			{
+				processADCBuffer();
+			}
+#if defined(ENABLE_BENCHMARK) || defined(ENABLE_DIAGNOSTICS)
+			wait_ticks = getCycleCount() - wait_start;
+			health.blocked_ticks += wait_ticks;
+			if (wait_ticks > health.max_blocked_ticks)
+			{
+				health.max_blocked_ticks = wait_ticks;
+			}
+#endif // #if defined(ENABLE_BENCHMARK) || defined(ENABLE_DIAGNOSTICS)
+		}
+		ready_array ^= 1;
+		ready_array_entropy = next_array_entropy;
+		samples_consumed = 0;
+		samples_filled = 0;
+		is_next_array_tested = false;
+		if (next_array_failed)
 		{
 #ifdef TEST_STATISTICS
 			tests_failed = true;
 #else
+			// Discard the array, so that the next call will wait for a
+			// freshly tested one.
+			samples_consumed = SAMPLE_COUNT;
 			return -1; // statistical tests indicate HWRNG failure
 #endif // #ifdef TEST_STATISTICS
 		}
@@ -491,7 +753,7 @@ int hardwareRandom32Bytes(uint8_t *buffer)
 #endif // #if ((DECIMATED_SAMPLE_BUFFER_SIZE % 16) != 0)
 	for (i = 0; i < 16; i++)
 	{
-		sample = samples[samples_consumed];
+		sample = samples[ready_array][samples_consumed];
 		buffer[i * 2] = (uint8_t)sample;
 		buffer[i * 2 + 1] = (uint8_t)(sample >> 8);
 		samples_consumed++;
@@ -502,10 +764,33 @@ int hardwareRandom32Bytes(uint8_t *buffer)
 	}
 	else
 	{
-		return (int)(16.0 * ENTROPY_BITS_PER_SAMPLE);
+		// Round down, so that a fraction of a bit is never overstated.
+		entropy = (int)((16 * ready_array_entropy) >> 16);
+#ifdef USE_ATSHA204_ENTROPY
+		if (is_atsha204_ready)
+		{
+			for (i = 0; i < 32; i++)
+			{
+				buffer[i] ^= atsha204_bytes[i];
+			}
+			memset(atsha204_bytes, 0, sizeof(atsha204_bytes));
+			is_atsha204_ready = false;
+		}
+#endif // #ifdef USE_ATSHA204_ENTROPY
+		health.bytes_delivered += 32;
+		return entropy;
 	}
 }
 
+/** Get health and throughput statistics for the HWRNG.
+  * \param out_health The statistics will be written here.
+  *                   See #HWRNGHealthStruct.
+  */
+void getHWRNGHealth(HWRNGHealth *out_health)
+{
+	*out_health = health;
+}
+
 #ifdef TEST_STATISTICS
 
 /** Quick and dirty conversion of fix16 to string.
@@ -624,7 +909,7 @@ static void reportStatistics(uint32_t tests_failed)
 	if ((report_to_stream == 2) || (report_to_stream == 1) || (report_to_stream == 0))
 	{
 		// Report moment-based properties.
-		sprintFix16(buffer, most_recent_mean);
+		sprintFix16(buffer, health.mean);
 		writeStringToDisplay(buffer);
 		if (report_to_stream == 1)
 		{
@@ -632,7 +917,7 @@ static void reportStatistics(uint32_t tests_failed)
 			sendString(", ");
 		}
 		nextLine();
-		sprintFix16(buffer, most_recent_variance);
+		sprintFix16(buffer, health.variance);
 		writeStringToDisplay(buffer);
 		if (report_to_stream == 1)
 		{
@@ -640,7 +925,7 @@ static void reportStatistics(uint32_t tests_failed)
 			sendString(", ");
 		}
 		nextLine();
-		sprintFix16(buffer, most_recent_kappa3);
+		sprintFix16(buffer, health.kappa3);
 		writeStringToDisplay(buffer);
 		if (report_to_stream == 1)
 		{
@@ -648,7 +933,7 @@ static void reportStatistics(uint32_t tests_failed)
 			sendString(", ");
 		}
 		nextLine();
-		sprintFix16(buffer, most_recent_kappa4);
+		sprintFix16(buffer, health.kappa4);
 		writeStringToDisplay(buffer);
 		if (report_to_stream == 1)
 		{
@@ -673,12 +958,12 @@ static void reportStatistics(uint32_t tests_failed)
 	if (report_to_stream == 3)
 	{
 		// Report peak frequency and signal bandwidth estimate.
-		sprintFix16(buffer, fix16_from_int(most_recent_max_bin));
+		sprintFix16(buffer, fix16_from_int(health.max_bin));
 		writeStringToDisplay(buffer);
 		sendString(buffer);
 		sendString(", ");
 		nextLine();
-		sprintFix16(buffer, fix16_from_int(most_recent_bandwidth));
+		sprintFix16(buffer, fix16_from_int(health.bandwidth));
 		writeStringToDisplay(buffer);
 		sendString(buffer);
 		nextLine();
@@ -687,7 +972,7 @@ static void reportStatistics(uint32_t tests_failed)
 	if ((report_to_stream == 4) || (report_to_stream == 5))
 	{
 		// Report maximum autocorrelation value and entropy estimate.
-		sprintFix16(buffer, most_recent_variance);
+		sprintFix16(buffer, health.variance);
 		writeStringToDisplay(buffer);
 		if (report_to_stream == 5)
 		{
@@ -695,7 +980,7 @@ static void reportStatistics(uint32_t tests_failed)
 			sendString(", ");
 		}
 		nextLine();
-		sprintFix16(buffer, most_recent_max_autocorrelation);
+		sprintFix16(buffer, health.max_autocorrelation);
 		writeStringToDisplay(buffer);
 		if (report_to_stream == 5)
 		{
@@ -703,7 +988,7 @@ static void reportStatistics(uint32_t tests_failed)
 			sendString(", ");
 		}
 		nextLine();
-		sprintFix16(buffer, most_recent_entropy_estimate);
+		sprintFix16(buffer, health.entropy_estimate);
 		writeStringToDisplay(buffer);
 		if (report_to_stream == 5)
 		{
@@ -838,10 +1123,7 @@ void __attribute__ ((nomips16)) testStatistics(void)
 
 			asm volatile("mfc0 %0, $9" : "=r"(start_count));
 
-			mean = calculateCentralMoment(fix16_zero, 1);
-			variance = calculateCentralMoment(mean, 2);
-			kappa3 = calculateCentralMoment(mean, 3);
-			kappa4 = calculateCentralMoment(mean, 4);
+			calculateMoments(&mean, &variance, &kappa3, &kappa4);
 			entropy_estimate = estimateEntropy();
 
 			asm volatile("mfc0 %0, $9" : "=r"(end_count)); // read as soon as possible
@@ -8,6 +8,9 @@
 #ifndef PIC32_HWRNG_H_INCLUDED
 #define PIC32_HWRNG_H_INCLUDED
 
+extern void beginHWRNGSampling(void);
+extern void serviceHWRNG(void);
+
 #ifdef TEST_STATISTICS
 extern void __attribute__ ((nomips16)) testStatistics(void);
 #endif // #ifdef TEST_STATISTICS
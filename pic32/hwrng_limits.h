@@ -158,11 +158,24 @@
   * deviation of 20. This was calculated using Monte Carlo simulation.
   */
 #define STATTEST_MIN_ENTROPY		6.21
-/** Assumed entropy estimate (in buts) per sample. This is lower
-  * than #STATTEST_MIN_ENTROPY because the bandwidth of the HWRNG signal is
-  * smaller than the Nyquist frequency (see #PSD_MIN_BANDWIDTH) by a factor
-  * of about 3. An additional safety factor of 2 has also been incorporated.
-  */
-#define ENTROPY_BITS_PER_SAMPLE		1.0
+/** Safety factor which the entropy credited for each sample is divided by
+  * (see calculateEntropyPerSample()). The credit starts from the measured
+  * min-entropy per sample, which is already lower than the Shannon entropy
+  * tested against #STATTEST_MIN_ENTROPY, scaled by the fraction of the
+  * Nyquist frequency which the measured bandwidth covers, since samples of
+  * a band-limited signal aren't independent.
+  */
+#define ENTROPY_DERATING_FACTOR		2
+/** Minimum entropy (in bits) which must be measured for each sample (see
+  * calculateEntropyPerSample()). An array whose measured entropy is below
+  * this fails, just as if it failed a statistical test; the credit is never
+  * raised to make up the difference.
+  */
+#define MIN_ENTROPY_BITS_PER_SAMPLE	0.5
+/** Maximum entropy (in bits) credited for each sample, however good the
+  * measurements look. The statistical tests can't detect every kind of
+  * failure, so this limits how much a wrong measurement can overstate.
+  */
+#define MAX_ENTROPY_BITS_PER_SAMPLE	2.0
 
 #endif // #ifndef PIC32_HWRNG_LIMITS_H_INCLUDED
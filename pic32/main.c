@@ -20,14 +20,22 @@
 #include "adc.h"
 #include "pushbuttons.h"
 #include "sst25x.h"
+#include "nvmem_manager.h"
 #include "hwrng.h"
 #include "../hwinterface.h"
 #include "../endian.h"
 #include "../stream_comm.h"
+#include "../wallet.h"
+#include "../prandom.h"
+#include "../tasks.h"
+#include "../diagnostics.h"
 
 #ifdef TEST_FFT
 #include "test_fft.h"
 #endif // #ifdef TEST_FFT
+#ifdef TEST_MODE
+#include "../xex.h"
+#endif // #ifdef TEST_MODE
 
 /** This will be called whenever an unrecoverable error occurs. This should
   * not return. */
@@ -65,6 +73,21 @@ uint32_t getPBKDF2Iterations(void)
 	return 128;
 }
 
+#ifdef TEST_MODE
+/** Read the core timer. This is used to time non-volatile memory operations
+  * in the non-volatile I/O test mode.
+  * \return The current value of the core timer, which is incremented every 2
+  *         CPU cycles.
+  */
+static uint32_t __attribute__((nomips16)) readCoreTimer(void)
+{
+	uint32_t count;
+
+	asm volatile("mfc0 %0, $9" : "=r"(count));
+	return count;
+}
+#endif // #ifdef TEST_MODE
+
 /** Entry point. This is the first thing which is called after startup code.
   * This never returns. */
 int main(void)
@@ -74,9 +97,18 @@ int main(void)
 	uint8_t counter;
 	char string_buffer[2];
 	unsigned int i;
+	NonVolatileReturn nv_status;
+	uint32_t nv_cycles;
 #endif // #ifdef TEST_MODE
 
 	disableInterrupts();
+	// This is done first, so that stack used by initialisation is counted.
+	diagnosticsPaintStack();
+	// The boot steps timed below are:
+	// 0: JTAG, system, push button and ADC initialisation.
+	// 1: USB initialisation, up to usbConnect().
+	// 2: Initialisation of everything else.
+	diagnosticsBeginBoot();
 
 	// The BitSafe development board has the Vdd/2 reference connected to
 	// a pin which shares the JTAG TMS function. By default, JTAG is enabled
@@ -89,11 +121,9 @@ int main(void)
 	DDPCONbits.JTAGEN = 0;
 
 	pic32SystemInit();
-	initSSD1306();
 	initPushButtons();
-	initSST25x();
-	initATSHA204();
 	initADC();
+	diagnosticsEndBootStep();
 	usbInit();
 	usbHIDStreamInit();
 	usbDisconnect(); // just in case
@@ -110,6 +140,41 @@ int main(void)
 	// All USB-related modules should be initialised before
 	// calling usbConnect().
 	usbConnect();
+	diagnosticsEndBootStep();
+
+#if !defined(TEST_MODE) && !defined(TEST_FFT) && !defined(TEST_STATISTICS)
+	// Start collecting HWRNG samples now, so that they're ready by the time
+	// they're needed. The samples are tested in the background, whenever
+	// the CPU is idle or a long-running operation yields.
+	addBackgroundTask(&serviceHWRNG);
+	beginHWRNGSampling();
+#endif // #if !defined(TEST_MODE) && !defined(TEST_FFT) && !defined(TEST_STATISTICS)
+#ifdef ENABLE_KEEP_UNLOCKED
+	// Wallets which stay unlocked across sessions must still be locked once
+	// they time out, even if no more packets arrive.
+	addBackgroundTask(&expireWalletContexts);
+#endif // #ifdef ENABLE_KEEP_UNLOCKED
+	// The next few addresses of the loaded wallet are calculated while idle,
+	// so that NewAddress requests don't have to wait for a point
+	// multiplication.
+	addBackgroundTask(&prederiveAddresses);
+	// Flash sectors are erased while idle, so that flushes usually don't
+	// have to wait for an erase.
+	addBackgroundTask(&prepareSpareSectors);
+	// The entropy pool is only written every few getRandom256() calls, so
+	// write the rest while idle, in case the device is unplugged.
+	addBackgroundTask(&flushEntropyPoolWhenIdle);
+
+	// Enumeration is handled by the USB interrupt handler, so the rest of the
+	// peripherals are initialised while the host enumerates the device. None
+	// of them are used by the USB interrupt handler. Any packets which arrive
+	// in the meantime wait in the stream FIFO until processPacket() is
+	// called. initSSD1306() is cheap; the display itself is only started
+	// when it's first used (see startSSD1306()).
+	initSSD1306();
+	initSST25x();
+	initATSHA204();
+	diagnosticsEndBootStep();
 
 #ifdef TEST_MODE
 	mode = streamGetOneByte();
@@ -118,6 +183,8 @@ int main(void)
 		displayOn();
 	}
 	counter = 0;
+	nv_status = NV_NO_ERROR;
+	nv_cycles = 0;
 	while (true)
 	{
 		if ((mode == 'g') || (mode == 'i') || (mode == 'j'))
@@ -170,15 +237,25 @@ int main(void)
 		}
 		else if (mode == 'n')
 		{
-			// Non-volatile I/O test.
+			// Non-volatile I/O test. Every read, write and flush is timed,
+			// so that nvm_test can also benchmark non-volatile memory access.
+			// Operations are:
+			// 0x00 = read, 0x01 = write, 0x02 = flush,
+			// 0x03 = encrypted read, 0x04 = encrypted write,
+			// 0x05 = set encryption key, 0x06 = get partition size,
+			// 0x07 = get status and cycle count of last read, write or flush.
 			uint8_t nv_operation;
 			uint8_t buffer[16384];
+			NVPartitions partition;
 			uint32_t address;
 			uint32_t length;
+			uint32_t start_count;
 
 			nv_operation = streamGetOneByte();
-			if ((nv_operation == 0x00) || (nv_operation == 0x01))
+			if ((nv_operation == 0x00) || (nv_operation == 0x01)
+				|| (nv_operation == 0x03) || (nv_operation == 0x04))
 			{
+				partition = (NVPartitions)streamGetOneByte();
 				for (i = 0; i < 4; i++)
 				{
 					buffer[i] = streamGetOneByte();
@@ -196,9 +273,18 @@ int main(void)
 				}
 				else
 				{
-					if (nv_operation == 0x00)
+					if ((nv_operation == 0x00) || (nv_operation == 0x03))
 					{
-						nonVolatileRead(buffer, address, length);
+						start_count = readCoreTimer();
+						if (nv_operation == 0x00)
+						{
+							nv_status = nonVolatileRead(buffer, partition, address, length);
+						}
+						else
+						{
+							nv_status = encryptedNonVolatileRead(buffer, partition, address, length);
+						}
+						nv_cycles = (readCoreTimer() - start_count) * 2;
 						for (i = 0; i < length; i++)
 						{
 							streamPutOneByte(buffer[i]);
@@ -210,13 +296,54 @@ int main(void)
 						{
 							buffer[i] = streamGetOneByte();
 						}
-						nonVolatileWrite(buffer, address, length);
+						start_count = readCoreTimer();
+						if (nv_operation == 0x01)
+						{
+							nv_status = nonVolatileWrite(buffer, partition, address, length);
+						}
+						else
+						{
+							nv_status = encryptedNonVolatileWrite(buffer, partition, address, length);
+						}
+						nv_cycles = (readCoreTimer() - start_count) * 2;
 					}
 				}
-			} // end if ((nv_operation == 0x00) || (nv_operation == 0x01))
+			} // end if ((nv_operation == 0x00) || (nv_operation == 0x01) || ...)
 			else if (nv_operation == 0x02)
 			{
-				nonVolatileFlush();
+				start_count = readCoreTimer();
+				nv_status = nonVolatileFlush();
+				nv_cycles = (readCoreTimer() - start_count) * 2;
+			}
+			else if (nv_operation == 0x05)
+			{
+				for (i = 0; i < WALLET_ENCRYPTION_KEY_LENGTH; i++)
+				{
+					buffer[i] = streamGetOneByte();
+				}
+				setEncryptionKey(buffer);
+			}
+			else if (nv_operation == 0x06)
+			{
+				partition = (NVPartitions)streamGetOneByte();
+				if (nonVolatileGetSize(&length, partition) != NV_NO_ERROR)
+				{
+					length = 0;
+				}
+				writeU32LittleEndian(buffer, length);
+				for (i = 0; i < 4; i++)
+				{
+					streamPutOneByte(buffer[i]);
+				}
+			}
+			else if (nv_operation == 0x07)
+			{
+				streamPutOneByte((uint8_t)nv_status);
+				writeU32LittleEndian(buffer, nv_cycles);
+				for (i = 0; i < 4; i++)
+				{
+					streamPutOneByte(buffer[i]);
+				}
 			}
 			else
 			{
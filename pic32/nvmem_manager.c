@@ -2,38 +2,176 @@
   *
   * \brief Translates non-volatile memory operations into flash access.
   *
-  * Flash memory can be read with byte granularity but writes can only be
-  * done with sector granularity. This is a problem: the platform-dependent
+  * Flash memory can be read with byte granularity but can only be erased
+  * with sector granularity. This is a problem: the platform-dependent
   * code treats non-volatile memory as something which can be written to
-  * with byte granularity. Honouring every write could cause the flash memory
-  * to wear out much more quickly.
+  * with byte granularity. Honouring every write by erasing and reprogramming
+  * a sector in place could cause the flash memory to wear out much more
+  * quickly.
   *
   * To deal with this problem, the functions in this file implement a
-  * translation layer which uses a cache to accumulate writes within a sector.
-  * nonVolatileFlush() can then be used to actually write the sector to
-  * flash memory.
+  * log-structured translation layer. Non-volatile memory (as seen by the
+  * platform-independent code) is divided into blocks of #LOG_BLOCK_SIZE
+  * bytes. Whenever a block is written, a new copy of it is appended to a log
+  * which occupies #NVMEM_LOG_SECTORS sectors of the flash memory, and a
+  * table in RAM (#block_map) is updated to point to the newest copy. Writing
+  * a small field (for example, the number of addresses in a wallet) thus
+  * costs one small append instead of erasing and programming a whole sector.
+  * When the log runs out of free sectors, the oldest sector is compacted:
+  * its live copies are appended to the log and then it is erased. Since the
+  * log cycles through all its sectors, erases are spread evenly across
+  * them.
+  *
+  * The log format is:
+  * - Each log sector begins with a #SECTOR_HEADER_SIZE byte header containing
+  *   #LOG_MAGIC and a sequence number (both little-endian). The sequence
+  *   number is incremented every time a sector is added to the log, so it
+  *   determines the order of sectors in the log. Sectors without a valid
+  *   header are free.
+  * - The rest of the sector consists of #RECORDS_PER_SECTOR records. Each
+  *   record is a 2 byte block number, the ones' complement of that block
+  *   number and then #LOG_BLOCK_SIZE bytes of block contents. Records are
+  *   appended in order; the block contents are programmed before the block
+  *   number so that a record which was interrupted by a power failure is
+  *   ignored.
+  * - The last #SECTOR_TRAILER_SIZE bytes of each sector hold the number of
+  *   times the sector has been erased (little-endian). This is programmed
+  *   straight after the sector is erased, so it survives while the sector is
+  *   free. It is only used for diagnostics (see diagnostics.c); a power
+  *   failure between the erase and the program will reset it.
+  * The table in RAM is rebuilt by scanning the log the first time
+  * non-volatile memory is accessed. Blocks which have never been written
+  * read as 0xff, like erased flash memory.
+  *
+  * Writes are also accumulated in a cache of #NVMEM_CACHE_WAYS blocks, so
+  * that many small writes to the same block result in only one append.
+  * nonVolatileFlush() can then be used to actually append the blocks to the
+  * log. When a block needs to be loaded into the cache and the cache is
+  * full, the least recently used block is appended to make room.
+  *
+  * Erasing a sector is by far the slowest flash operation, so it is kept
+  * off the request path where possible. prepareSpareSectors() is a
+  * background task (see tasks.c) which, while the firmware is idle, erases
+  * free log sectors and compacts the oldest sector early, so that
+  * #NVMEM_SPARE_SECTORS free sectors are ready when the head sector fills
+  * up. A flush then only has to program records; it only erases a sector
+  * itself if the background task hasn't kept up.
+  *
+  * Older copies of a block stay in flash memory until their sector is
+  * compacted and erased. This means that overwriting something (for example, in
+  * sanitiseNonVolatileStorage()) doesn't immediately destroy all copies of
+  * it. Compaction of every log sector happens after at most
+  * #NVMEM_LOG_SECTORS * #RECORDS_PER_SECTOR block writes.
   *
   * This file is licensed as described by the file LICENCE.
   */
 
+#ifdef TEST_NVMEM_MANAGER
+#include <stdio.h>
+#include <stdlib.h>
+#include "../test_helpers.h"
+#endif // #ifdef TEST_NVMEM_MANAGER
+
 #include <stdint.h>
 #include <string.h>
 #include "../hwinterface.h"
+#include "../endian.h"
+#include "../diagnostics.h"
+#include "../trace.h"
 #include "sst25x.h"
+#include "nvmem_manager.h"
+
+/** Size, in bytes, of the blocks that non-volatile memory is divided into.
+  * This must be a divisor of #NV_MEMORY_SIZE. Smaller blocks make small
+  * writes cheaper, but make the table in RAM bigger. */
+#define LOG_BLOCK_SIZE			64
+/** Number of blocks that non-volatile memory is divided into. */
+#define NUM_LOGICAL_BLOCKS		(NV_MEMORY_SIZE / LOG_BLOCK_SIZE)
+/** Size, in bytes, of the header at the start of each log sector. */
+#define SECTOR_HEADER_SIZE		8
+/** Size, in bytes, of the erase count at the end of each log sector. */
+#define SECTOR_TRAILER_SIZE		4
+/** Size, in bytes, of the header at the start of each record. */
+#define RECORD_HEADER_SIZE		4
+/** Size, in bytes, of each record (including its header). */
+#define RECORD_SIZE				(RECORD_HEADER_SIZE + LOG_BLOCK_SIZE)
+/** Number of records that fit in one log sector. */
+#define RECORDS_PER_SECTOR		((SECTOR_SIZE - SECTOR_HEADER_SIZE - SECTOR_TRAILER_SIZE) / RECORD_SIZE)
+/** Value in the header of every valid log sector. */
+#define LOG_MAGIC				0x31474f4c
+/** Value of #block_map entries for blocks which have never been written. */
+#define BLOCK_UNMAPPED			0xffffffff
+
+#ifndef NVMEM_LOG_FIRST_SECTOR
+/** Index (address divided by #SECTOR_SIZE) of the first flash sector used
+  * for the log. Sector 0 is where non-volatile memory was stored directly
+  * before the log existed; see migrateLegacySector(). */
+#define NVMEM_LOG_FIRST_SECTOR	1
+#endif // #ifndef NVMEM_LOG_FIRST_SECTOR
 
-/** Whether write cache is valid. */
-static bool write_cache_valid;
-/** Sector address of current contents of write cache. This is only
-  * well-defined if #write_cache_valid is true. */
-static uint32_t write_cache_tag;
-/** Current contents of write cache. This is only well-defined
-  * if #write_cache_valid is true. */
-static uint8_t write_cache[SECTOR_SIZE];
+#ifndef NVMEM_LOG_SECTORS
+/** Number of flash sectors used for the log. This must be at least 3, and
+  * (NVMEM_LOG_SECTORS - 2) * #RECORDS_PER_SECTOR must be comfortably larger
+  * than #NUM_LOGICAL_BLOCKS, so that compaction always frees some space.
+  * More sectors means less wear on each one. The default uses 64 KiB of the
+  * SST25VF080B's 1 MiB. */
+#define NVMEM_LOG_SECTORS		16
+#endif // #ifndef NVMEM_LOG_SECTORS
 
-/** Bitmask applied to addresses to get the sector address. */
-#define SECTOR_TAG_MASK			(~(SECTOR_SIZE - 1))
-/** Bitmask applied to addresses to get the offset within a sector. */
-#define SECTOR_OFFSET_MASK		(SECTOR_SIZE - 1)
+#ifndef NVMEM_SPARE_SECTORS
+/** Number of free, erased log sectors which prepareSpareSectors() tries to
+  * keep ready, in addition to the one which is always kept in reserve for
+  * compaction. More spare sectors let longer bursts of writes go by without
+  * an erase, but leave fewer sectors for the log, so that blocks are copied
+  * by compaction more often. This must be less than
+  * #NVMEM_LOG_SECTORS - 2. */
+#define NVMEM_SPARE_SECTORS		2
+#endif // #ifndef NVMEM_SPARE_SECTORS
+
+#ifndef NVMEM_CACHE_WAYS
+/** Number of blocks which can be held in the write cache. Each one uses
+  * #LOG_BLOCK_SIZE bytes of RAM. This must be at least 1. */
+#define NVMEM_CACHE_WAYS		16
+#endif // #ifndef NVMEM_CACHE_WAYS
+
+/** Whether the log has been scanned and #block_map is valid. */
+static bool log_ready;
+/** Flash address of the contents of the newest copy of each block, or
+  * #BLOCK_UNMAPPED if the block has never been written. */
+static uint32_t block_map[NUM_LOGICAL_BLOCKS];
+/** Sequence number of each log sector, or 0 if the sector is free. */
+static uint32_t sector_sequence[NVMEM_LOG_SECTORS];
+/** Number of times each log sector has been erased. */
+static uint32_t sector_erase_count[NVMEM_LOG_SECTORS];
+/** Whether each log sector is free and known to be erased, so that it can
+  * be added to the log without erasing it first. */
+static bool sector_erased[NVMEM_LOG_SECTORS];
+/** Sequence number that will be given to the next sector added to the
+  * log. */
+static uint32_t next_sequence;
+/** Whether #head_sector refers to a sector that can be appended to. */
+static bool head_valid;
+/** Index of the log sector which records are appended to. */
+static unsigned int head_sector;
+/** Index of the next free record in #head_sector. */
+static unsigned int head_record;
+
+/** Whether each entry of the write cache is valid. */
+static bool write_cache_valid[NVMEM_CACHE_WAYS];
+/** Block number of current contents of each write cache entry. This is
+  * only well-defined if the corresponding entry in #write_cache_valid is
+  * true. */
+static uint32_t write_cache_tag[NVMEM_CACHE_WAYS];
+/** Value of #write_cache_clock when each write cache entry was last used.
+  * This is used to find the least recently used entry. */
+static uint32_t write_cache_last_used[NVMEM_CACHE_WAYS];
+/** Incremented every time a write cache entry is used. */
+static uint32_t write_cache_clock;
+/** Current contents of each write cache entry. This is only well-defined
+  * if the corresponding entry in #write_cache_valid is true. */
+static uint8_t write_cache[NVMEM_CACHE_WAYS][LOG_BLOCK_SIZE];
+/** Buffer used to verify program operations and to move records around. */
+static uint8_t record_buffer[RECORD_SIZE];
 
 /** Get size of a partition.
   * \param out_size On success, the size of the partition (in number of bytes)
@@ -101,6 +239,631 @@ static NonVolatileReturn checkAndTweakAddress(uint32_t *address, NVPartitions pa
     return NV_NO_ERROR;
 }
 
+
+/** Get the flash address of a log sector.
+  * \param sector Index of the log sector, from 0 to #NVMEM_LOG_SECTORS - 1.
+  * \return The flash address of the start of that sector.
+  */
+static uint32_t logSectorAddress(unsigned int sector)
+{
+	return (NVMEM_LOG_FIRST_SECTOR + sector) * SECTOR_SIZE;
+}
+
+/** Get the flash address of a record in the log.
+  * \param sector Index of the log sector which contains the record.
+  * \param record Index of the record within that sector.
+  * \return The flash address of the start of the record's header.
+  */
+static uint32_t recordAddress(unsigned int sector, unsigned int record)
+{
+	return logSectorAddress(sector) + SECTOR_HEADER_SIZE + record * RECORD_SIZE;
+}
+
+/** Check whether a buffer is entirely in the erased state.
+  * \param buffer The buffer to check.
+  * \param length Length of the buffer, in bytes.
+  * \return true if every byte is 0xff, false otherwise.
+  */
+static bool isErased(const uint8_t *buffer, unsigned int length)
+{
+	unsigned int i;
+
+	for (i = 0; i < length; i++)
+	{
+		if (buffer[i] != 0xff)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/** Program some bytes and check that they were programmed correctly.
+  * \param data The data to program.
+  * \param address The flash address to begin programming at.
+  * \param length The number of bytes to program. This must not be larger
+  *               than #RECORD_SIZE.
+  * \return See #NonVolatileReturnEnum for return values.
+  */
+static NonVolatileReturn programAndVerify(const uint8_t *data, uint32_t address, uint32_t length)
+{
+	sst25xProgram(data, address, length);
+	sst25xRead(record_buffer, address, length);
+	if (memcmp(record_buffer, data, length))
+	{
+		return NV_IO_ERROR; // program did not complete properly
+	}
+	return NV_NO_ERROR;
+}
+
+/** Get the flash address of the erase count of a log sector.
+  * \param sector Index of the log sector.
+  * \return The flash address of the erase count.
+  */
+static uint32_t trailerAddress(unsigned int sector)
+{
+	return logSectorAddress(sector) + SECTOR_SIZE - SECTOR_TRAILER_SIZE;
+}
+
+/** Check whether a log sector is in the erased state. The erase count at
+  * the end of the sector is ignored, since it is programmed as soon as the
+  * sector is erased.
+  * \param sector Index of the log sector to check.
+  * \return true if the sector is erased, false otherwise.
+  */
+static bool isSectorErased(unsigned int sector)
+{
+	uint32_t address;
+	uint32_t offset;
+	uint32_t length;
+
+	address = logSectorAddress(sector);
+	for (offset = 0; offset < (SECTOR_SIZE - SECTOR_TRAILER_SIZE); offset += RECORD_SIZE)
+	{
+		// Don't read past the end of the sector; the last sector of the log
+		// could be the last sector of the flash memory.
+		length = MIN(RECORD_SIZE, SECTOR_SIZE - SECTOR_TRAILER_SIZE - offset);
+		sst25xRead(record_buffer, address + offset, length);
+		if (!isErased(record_buffer, length))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/** Erase a log sector and check that it was erased correctly. This also
+  * marks the sector as free and updates its erase count.
+  * \param sector Index of the log sector to erase.
+  * \return See #NonVolatileReturnEnum for return values.
+  */
+static NonVolatileReturn eraseLogSector(unsigned int sector)
+{
+	uint8_t trailer[SECTOR_TRAILER_SIZE];
+	NonVolatileReturn r;
+
+	sector_sequence[sector] = 0;
+	sector_erased[sector] = false;
+	traceEvent(TRACE_NV_ERASE, sector);
+	sst25xEraseSector(logSectorAddress(sector));
+	sst25xRead(trailer, trailerAddress(sector), sizeof(trailer));
+	if (!isSectorErased(sector) || !isErased(trailer, sizeof(trailer)))
+	{
+		return NV_IO_ERROR; // erase did not complete properly
+	}
+	sector_erase_count[sector]++;
+	diagnosticsSetNVEraseCount(sector, sector_erase_count[sector]);
+	writeU32LittleEndian(trailer, sector_erase_count[sector]);
+	r = programAndVerify(trailer, trailerAddress(sector), sizeof(trailer));
+	if (r == NV_NO_ERROR)
+	{
+		sector_erased[sector] = true;
+	}
+	return r;
+}
+
+/** Count the number of free log sectors.
+  * \return The number of free log sectors.
+  */
+static unsigned int countFreeSectors(void)
+{
+	unsigned int i;
+	unsigned int count;
+
+	count = 0;
+	for (i = 0; i < NVMEM_LOG_SECTORS; i++)
+	{
+		if (sector_sequence[i] == 0)
+		{
+			count++;
+		}
+	}
+	return count;
+}
+
+/** Add a free sector to the end of the log, so that records can be appended
+  * to it. Free sectors are chosen in a round-robin fashion, so that erases
+  * are spread across all log sectors, except that sectors which are already
+  * erased (see prepareSpareSectors()) are preferred.
+  * \return See #NonVolatileReturnEnum for return values.
+  */
+static NonVolatileReturn openLogSector(void)
+{
+	unsigned int i;
+	unsigned int candidate;
+	unsigned int sector;
+	uint8_t header[SECTOR_HEADER_SIZE];
+	NonVolatileReturn r;
+
+	sector = NVMEM_LOG_SECTORS;
+	candidate = head_valid ? head_sector : (NVMEM_LOG_SECTORS - 1);
+	for (i = 0; i < NVMEM_LOG_SECTORS; i++)
+	{
+		candidate = (candidate + 1) % NVMEM_LOG_SECTORS;
+		if (sector_sequence[candidate] == 0)
+		{
+			if (sector_erased[candidate])
+			{
+				sector = candidate;
+				break;
+			}
+			if (sector == NVMEM_LOG_SECTORS)
+			{
+				sector = candidate;
+			}
+		}
+	}
+	if (sector == NVMEM_LOG_SECTORS)
+	{
+		return NV_IO_ERROR; // no free sectors; this should never happen
+	}
+	// Free sectors may contain an interrupted header or record, or stale
+	// copies left by compactLog(), so they need to be erased before use,
+	// unless they are known to be erased already.
+	if (!sector_erased[sector] && !isSectorErased(sector))
+	{
+		r = eraseLogSector(sector);
+		if (r != NV_NO_ERROR)
+		{
+			return r;
+		}
+	}
+	sector_erased[sector] = false;
+	writeU32LittleEndian(header, LOG_MAGIC);
+	writeU32LittleEndian(&(header[4]), next_sequence);
+	r = programAndVerify(header, logSectorAddress(sector), sizeof(header));
+	if (r != NV_NO_ERROR)
+	{
+		return r;
+	}
+	sector_sequence[sector] = next_sequence;
+	next_sequence++;
+	head_valid = true;
+	head_sector = sector;
+	head_record = 0;
+	return NV_NO_ERROR;
+}
+
+/** Write a record to the next free record in the head sector of the log.
+  * \param block The block number of the record.
+  * \param data The #LOG_BLOCK_SIZE bytes of block contents.
+  * \return See #NonVolatileReturnEnum for return values.
+  */
+static NonVolatileReturn programRecord(uint32_t block, const uint8_t *data)
+{
+	uint32_t address;
+	uint8_t header[RECORD_HEADER_SIZE];
+	NonVolatileReturn r;
+
+	if (!head_valid || (head_record >= RECORDS_PER_SECTOR))
+	{
+		return NV_IO_ERROR; // no space; this should never happen
+	}
+	address = recordAddress(head_sector, head_record);
+	// The record is used up even if programming fails, since it may now be
+	// partially programmed.
+	head_record++;
+	// Program the contents before the header, so that an interrupted
+	// record is never mistaken for a valid one.
+	r = programAndVerify(data, address + RECORD_HEADER_SIZE, LOG_BLOCK_SIZE);
+	if (r != NV_NO_ERROR)
+	{
+		return r;
+	}
+	writeU32LittleEndian(header, block | ((block ^ 0xffff) << 16));
+	r = programAndVerify(header, address, sizeof(header));
+	if (r != NV_NO_ERROR)
+	{
+		return r;
+	}
+	block_map[block] = address + RECORD_HEADER_SIZE;
+	return NV_NO_ERROR;
+}
+
+/** Find the oldest sector in the log, apart from the head sector.
+  * \return The index of the oldest sector, or #NVMEM_LOG_SECTORS if the head
+  *         sector is the only sector in the log.
+  */
+static unsigned int findOldestSector(void)
+{
+	unsigned int i;
+	unsigned int oldest;
+
+	oldest = NVMEM_LOG_SECTORS;
+	for (i = 0; i < NVMEM_LOG_SECTORS; i++)
+	{
+		if ((i != head_sector) && (sector_sequence[i] != 0))
+		{
+			if ((oldest == NVMEM_LOG_SECTORS) || (sector_sequence[i] < sector_sequence[oldest]))
+			{
+				oldest = i;
+			}
+		}
+	}
+	return oldest;
+}
+
+/** Check whether the newest copy of a block is in a log sector.
+  * \param block The block number.
+  * \param sector Index of the log sector.
+  * \return true if the newest copy of the block is in the sector, false
+  *         otherwise.
+  */
+static bool isLiveIn(uint32_t block, unsigned int sector)
+{
+	uint32_t start;
+
+	start = logSectorAddress(sector);
+	return (block_map[block] != BLOCK_UNMAPPED)
+		&& (block_map[block] >= start) && (block_map[block] < (start + SECTOR_SIZE));
+}
+
+/** Compact the oldest sector in the log, by appending its live copies to
+  * the log and then marking it as free. Always compacting the oldest sector
+  * (rather than, say, the one with the fewest live copies) makes the log
+  * circular, so that every log sector is erased equally often, even if some
+  * blocks are hardly ever written. The sector isn't erased here; that's
+  * left to prepareSpareSectors() or openLogSector(). Instead, its header is
+  * programmed to all zeroes (which doesn't need an erase), so that it stays
+  * free across a reset. The head sector must have enough space for the
+  * copies, which is always the case if it was just opened.
+  * \return See #NonVolatileReturnEnum for return values.
+  */
+static NonVolatileReturn compactLog(void)
+{
+	unsigned int victim;
+	uint32_t block;
+	uint8_t data[LOG_BLOCK_SIZE];
+	uint8_t header[SECTOR_HEADER_SIZE];
+	NonVolatileReturn r;
+
+	victim = findOldestSector();
+	if (victim == NVMEM_LOG_SECTORS)
+	{
+		return NV_IO_ERROR; // nothing to compact; this should never happen
+	}
+	for (block = 0; block < NUM_LOGICAL_BLOCKS; block++)
+	{
+		if (isLiveIn(block, victim))
+		{
+			sst25xRead(data, block_map[block], LOG_BLOCK_SIZE);
+			r = programRecord(block, data);
+			if (r != NV_NO_ERROR)
+			{
+				return r;
+			}
+		}
+	}
+	sector_sequence[victim] = 0;
+	sector_erased[victim] = false;
+	memset(header, 0, sizeof(header));
+	return programAndVerify(header, logSectorAddress(victim), sizeof(header));
+}
+
+/** Append a new copy of a block to the log, compacting the log if
+  * necessary.
+  * \param block The block number.
+  * \param data The #LOG_BLOCK_SIZE bytes of block contents.
+  * \return See #NonVolatileReturnEnum for return values.
+  */
+static NonVolatileReturn appendRecord(uint32_t block, const uint8_t *data)
+{
+	NonVolatileReturn r;
+
+	// This is a loop because compaction can fill the sector which was just
+	// opened (if every record in the compacted sector was live), in which
+	// case another sector is needed.
+	while (!head_valid || (head_record >= RECORDS_PER_SECTOR))
+	{
+		r = openLogSector();
+		if (r != NV_NO_ERROR)
+		{
+			return r;
+		}
+		// Always keep a free sector in reserve, so that the next
+		// openLogSector() will succeed.
+		while (countFreeSectors() == 0)
+		{
+			r = compactLog();
+			if (r != NV_NO_ERROR)
+			{
+				return r;
+			}
+		}
+	}
+	return programRecord(block, data);
+}
+
+/** Scan one log sector, updating #block_map with the records in it.
+  * Sectors must be scanned in the order of their sequence numbers, so that
+  * newer copies of a block override older ones.
+  * \param sector Index of the log sector to scan.
+  * \return The number of records in the sector which are in use.
+  */
+static unsigned int scanLogSector(unsigned int sector)
+{
+	unsigned int record;
+	uint32_t address;
+	uint32_t header;
+	uint32_t block;
+
+	for (record = 0; record < RECORDS_PER_SECTOR; record++)
+	{
+		address = recordAddress(sector, record);
+		sst25xRead(record_buffer, address, RECORD_SIZE);
+		if (isErased(record_buffer, RECORD_SIZE))
+		{
+			break; // reached end of log in this sector
+		}
+		header = readU32LittleEndian(record_buffer);
+		block = header & 0xffff;
+		if (((header >> 16) == (block ^ 0xffff)) && (block < NUM_LOGICAL_BLOCKS))
+		{
+			block_map[block] = address + RECORD_HEADER_SIZE;
+		}
+		// else: interrupted record; skip it
+	}
+	return record;
+}
+
+/** Copy non-volatile memory contents from sector 0, where they were stored
+  * before the log existed, into the log. Nothing is done if sector 0 is
+  * erased. This is called if the log is empty.
+  * \return See #NonVolatileReturnEnum for return values.
+  */
+static NonVolatileReturn migrateLegacySector(void)
+{
+	uint32_t block;
+	uint32_t i;
+	uint8_t data[LOG_BLOCK_SIZE];
+	bool found_data;
+	NonVolatileReturn r;
+
+	found_data = false;
+	for (block = 0; block < NUM_LOGICAL_BLOCKS; block++)
+	{
+		sst25xRead(data, block * LOG_BLOCK_SIZE, LOG_BLOCK_SIZE);
+		if (!isErased(data, LOG_BLOCK_SIZE))
+		{
+			found_data = true;
+			r = appendRecord(block, data);
+			if (r != NV_NO_ERROR)
+			{
+				return r;
+			}
+		}
+	}
+	if (found_data)
+	{
+		// Don't leave a second copy of everything lying around.
+		sst25xEraseSector(0);
+		for (i = 0; i < NV_MEMORY_SIZE; i += LOG_BLOCK_SIZE)
+		{
+			sst25xRead(data, i, LOG_BLOCK_SIZE);
+			if (!isErased(data, LOG_BLOCK_SIZE))
+			{
+				return NV_IO_ERROR; // erase did not complete properly
+			}
+		}
+	}
+	return NV_NO_ERROR;
+}
+
+/** Scan the log to rebuild #block_map, if that hasn't already been done.
+  * This must be called before accessing #block_map.
+  * \return See #NonVolatileReturnEnum for return values.
+  */
+static NonVolatileReturn initLog(void)
+{
+	unsigned int i;
+	unsigned int next;
+	unsigned int used;
+	uint32_t previous;
+	uint8_t header[SECTOR_HEADER_SIZE];
+	uint8_t trailer[SECTOR_TRAILER_SIZE];
+	NonVolatileReturn r;
+
+	if (log_ready)
+	{
+		return NV_NO_ERROR;
+	}
+	for (i = 0; i < NUM_LOGICAL_BLOCKS; i++)
+	{
+		block_map[i] = BLOCK_UNMAPPED;
+	}
+	for (i = 0; i < NVMEM_LOG_SECTORS; i++)
+	{
+		sst25xRead(header, logSectorAddress(i), sizeof(header));
+		sector_sequence[i] = 0;
+		sector_erased[i] = false; // prepareSpareSectors() will find out
+		if (readU32LittleEndian(header) == LOG_MAGIC)
+		{
+			sector_sequence[i] = readU32LittleEndian(&(header[4]));
+			if (sector_sequence[i] == 0xffffffff)
+			{
+				sector_sequence[i] = 0; // interrupted header
+			}
+		}
+		sst25xRead(trailer, trailerAddress(i), sizeof(trailer));
+		sector_erase_count[i] = readU32LittleEndian(trailer);
+		if (sector_erase_count[i] == 0xffffffff)
+		{
+			sector_erase_count[i] = 0; // never counted
+		}
+		diagnosticsSetNVEraseCount(i, sector_erase_count[i]);
+	}
+
+	// Visit sectors in order of increasing sequence number.
+	head_valid = false;
+	next_sequence = 1;
+	previous = 0;
+	do
+	{
+		next = NVMEM_LOG_SECTORS;
+		for (i = 0; i < NVMEM_LOG_SECTORS; i++)
+		{
+			if ((sector_sequence[i] > previous)
+				&& ((next == NVMEM_LOG_SECTORS) || (sector_sequence[i] < sector_sequence[next])))
+			{
+				next = i;
+			}
+		}
+		if (next != NVMEM_LOG_SECTORS)
+		{
+			used = scanLogSector(next);
+			head_valid = true;
+			head_sector = next;
+			head_record = used;
+			previous = sector_sequence[next];
+			next_sequence = previous + 1;
+		}
+	} while (next != NVMEM_LOG_SECTORS);
+	log_ready = true;
+
+	if (!head_valid)
+	{
+		r = migrateLegacySector();
+		if (r != NV_NO_ERROR)
+		{
+			return r;
+		}
+	}
+	return NV_NO_ERROR;
+}
+
+/** Read the current contents of a block, ignoring the write cache.
+  * \param out The #LOG_BLOCK_SIZE bytes of block contents will be written
+  *            here.
+  * \param block The block number.
+  */
+static void readBlock(uint8_t *out, uint32_t block)
+{
+	if (block_map[block] == BLOCK_UNMAPPED)
+	{
+		memset(out, 0xff, LOG_BLOCK_SIZE);
+	}
+	else
+	{
+		sst25xRead(out, block_map[block], LOG_BLOCK_SIZE);
+	}
+}
+
+/** Find which write cache entry (if any) holds a block.
+  * \param block Block number to look for.
+  * \return The index of the write cache entry which holds the block, or
+  *         #NVMEM_CACHE_WAYS if the block is not in the write cache.
+  */
+static unsigned int findCacheEntry(uint32_t block)
+{
+	unsigned int i;
+
+	for (i = 0; i < NVMEM_CACHE_WAYS; i++)
+	{
+		if (write_cache_valid[i] && (write_cache_tag[i] == block))
+		{
+			return i;
+		}
+	}
+	return NVMEM_CACHE_WAYS;
+}
+
+/** Append one write cache entry to the log, then invalidate it. This
+  * does nothing if the entry isn't valid. Entries whose contents are the
+  * same as what's already in the log aren't appended, to save wear.
+  * \param index The index of the write cache entry to write.
+  * \return See #NonVolatileReturnEnum for return values.
+  */
+static NonVolatileReturn flushCacheEntry(unsigned int index)
+{
+	uint8_t current[LOG_BLOCK_SIZE];
+	NonVolatileReturn r;
+
+	if (write_cache_valid[index])
+	{
+		if (write_cache_tag[index] >= NUM_LOGICAL_BLOCKS)
+		{
+			return NV_INVALID_ADDRESS;
+		}
+		readBlock(current, write_cache_tag[index]);
+		if (memcmp(current, write_cache[index], LOG_BLOCK_SIZE))
+		{
+			r = appendRecord(write_cache_tag[index], write_cache[index]);
+			if (r != NV_NO_ERROR)
+			{
+				return r;
+			}
+		}
+		write_cache_valid[index] = false;
+		write_cache_tag[index] = 0;
+		memset(write_cache[index], 0, LOG_BLOCK_SIZE);
+	}
+	return NV_NO_ERROR;
+}
+
+/** Load a block into the write cache, evicting (and appending to the log)
+  * the least recently used valid entry if there are no free entries.
+  * \param out_index On success, the index of the write cache entry which
+  *                  now holds the block will be written here.
+  * \param block Block number of the block to load.
+  * \param read_contents Whether to read the current contents of the block
+  *                      into the entry. This can be false if the caller is
+  *                      about to overwrite the whole block anyway.
+  * \return See #NonVolatileReturnEnum for return values.
+  */
+static NonVolatileReturn loadCacheEntry(unsigned int *out_index, uint32_t block, bool read_contents)
+{
+	unsigned int i;
+	unsigned int victim;
+	NonVolatileReturn r;
+
+	victim = 0;
+	for (i = 0; i < NVMEM_CACHE_WAYS; i++)
+	{
+		if (!write_cache_valid[i])
+		{
+			victim = i;
+			break;
+		}
+		if ((write_cache_clock - write_cache_last_used[i]) > (write_cache_clock - write_cache_last_used[victim]))
+		{
+			victim = i;
+		}
+	}
+	r = flushCacheEntry(victim);
+	if (r != NV_NO_ERROR)
+	{
+		return r;
+	}
+	write_cache_valid[victim] = true;
+	write_cache_tag[victim] = block;
+	if (read_contents)
+	{
+		readBlock(write_cache[victim], block);
+	}
+	*out_index = victim;
+	return NV_NO_ERROR;
+}
+
 /** Write to non-volatile storage. All platform-independent code assumes that
   * non-volatile memory acts like NOR flash/EEPROM: arbitrary bits may be
   * reset from 1 to 0 ("programmed") in any order, but setting bits
@@ -116,9 +879,12 @@ static NonVolatileReturn checkAndTweakAddress(uint32_t *address, NVPartitions pa
   */
 extern NonVolatileReturn nonVolatileWrite(uint8_t *data, NVPartitions partition, uint32_t address, uint32_t length)
 {
-	uint32_t address_tag;
+	uint32_t block;
+	uint32_t offset;
 	uint32_t end; // exclusive
 	uint32_t data_index;
+	uint32_t chunk_length;
+	unsigned int index;
 	NonVolatileReturn r;
 
     r = checkAndTweakAddress(&address, partition, length);
@@ -126,32 +892,107 @@ extern NonVolatileReturn nonVolatileWrite(uint8_t *data, NVPartitions partition,
     {
         return r;
     }
+	r = initLog();
+	if (r != NV_NO_ERROR)
+	{
+		return r;
+	}
 
 	end = address + length;
 	data_index = 0;
 	while (address < end)
 	{
-		address_tag = address & SECTOR_TAG_MASK;
-		if (!write_cache_valid || (address_tag != write_cache_tag))
+		block = address / LOG_BLOCK_SIZE;
+		offset = address % LOG_BLOCK_SIZE;
+		index = findCacheEntry(block);
+		if (index == NVMEM_CACHE_WAYS)
 		{
-			// Address is not in cache; load sector into cache.
-			if (write_cache_valid)
+			// Address is not in cache; load block into cache.
+			diagnosticsNVEvent(DIAGNOSTICS_NV_CACHE_MISS);
+			r = loadCacheEntry(&index, block, true);
+			if (r != NV_NO_ERROR)
 			{
-				r = nonVolatileFlush();
-				if (r != NV_NO_ERROR)
-				{
-					return r;
-				}
+				return r;
 			}
-			write_cache_valid = true;
-			write_cache_tag = address_tag;
-			sst25xRead(write_cache, address_tag, SECTOR_SIZE);
 		}
-		// Address is guaranteed to be in cache; write to the cache.
-		write_cache[address & SECTOR_OFFSET_MASK] = data[data_index];
-		address++;
-		data_index++;
+		else
+		{
+			diagnosticsNVEvent(DIAGNOSTICS_NV_CACHE_HIT);
+		}
+		write_cache_clock++;
+		write_cache_last_used[index] = write_cache_clock;
+		// Address is guaranteed to be in cache; write to the rest of the
+		// block (or as much of the data as is left) in one go.
+		chunk_length = MIN(LOG_BLOCK_SIZE - offset, end - address);
+		memcpy(&(write_cache[index][offset]), &(data[data_index]), chunk_length);
+		address += chunk_length;
+		data_index += chunk_length;
 	}
+	diagnosticsNVEvent(DIAGNOSTICS_NV_WRITE);
+	return NV_NO_ERROR;
+}
+
+/** Fill an area of non-volatile storage with a single byte value. This has
+  * the same effect as calling nonVolatileWrite() with a buffer filled
+  * with value, but blocks which are entirely covered by the area are
+  * filled in the write cache directly, without reading their old contents
+  * from flash memory first.
+  * \param partition The partition to fill. Must be one of #NVPartitions.
+  * \param address Byte offset specifying where in the partition to
+  *                start filling.
+  * \param length The number of bytes to fill.
+  * \param value The byte value to fill the area with.
+  * \return See #NonVolatileReturnEnum for return values.
+  * \warning Like nonVolatileWrite(), this is buffered; use
+  *          nonVolatileFlush() to be sure that the area is actually
+  *          overwritten.
+  */
+extern NonVolatileReturn nonVolatileFill(NVPartitions partition, uint32_t address, uint32_t length, uint8_t value)
+{
+	uint32_t block;
+	uint32_t offset;
+	uint32_t end; // exclusive
+	uint32_t chunk_length;
+	unsigned int index;
+	NonVolatileReturn r;
+
+	r = checkAndTweakAddress(&address, partition, length);
+	if (r != NV_NO_ERROR)
+	{
+		return r;
+	}
+	r = initLog();
+	if (r != NV_NO_ERROR)
+	{
+		return r;
+	}
+
+	end = address + length;
+	while (address < end)
+	{
+		block = address / LOG_BLOCK_SIZE;
+		offset = address % LOG_BLOCK_SIZE;
+		chunk_length = MIN(LOG_BLOCK_SIZE - offset, end - address);
+		index = findCacheEntry(block);
+		if (index == NVMEM_CACHE_WAYS)
+		{
+			diagnosticsNVEvent(DIAGNOSTICS_NV_CACHE_MISS);
+			r = loadCacheEntry(&index, block, (chunk_length != LOG_BLOCK_SIZE));
+			if (r != NV_NO_ERROR)
+			{
+				return r;
+			}
+		}
+		else
+		{
+			diagnosticsNVEvent(DIAGNOSTICS_NV_CACHE_HIT);
+		}
+		write_cache_clock++;
+		write_cache_last_used[index] = write_cache_clock;
+		memset(&(write_cache[index][offset]), value, chunk_length);
+		address += chunk_length;
+	}
+	diagnosticsNVEvent(DIAGNOSTICS_NV_WRITE);
 	return NV_NO_ERROR;
 }
 
@@ -165,10 +1006,12 @@ extern NonVolatileReturn nonVolatileWrite(uint8_t *data, NVPartitions partition,
   */
 extern NonVolatileReturn nonVolatileRead(uint8_t *data, NVPartitions partition, uint32_t address, uint32_t length)
 {
-	uint32_t address_tag;
+	uint32_t block;
+	uint32_t offset;
 	uint32_t end; // exclusive
-	uint32_t nv_read_length; // length of contiguous non-volatile read
 	uint32_t data_index;
+	uint32_t chunk_length;
+	unsigned int index;
     NonVolatileReturn r;
 
 	r = checkAndTweakAddress(&address, partition, length);
@@ -176,46 +1019,83 @@ extern NonVolatileReturn nonVolatileRead(uint8_t *data, NVPartitions partition,
     {
         return r;
     }
+	r = initLog();
+	if (r != NV_NO_ERROR)
+	{
+		return r;
+	}
 
 	end = address + length;
-	nv_read_length = 0;
 	data_index = 0;
-	// The code below attempts to group non-volatile reads together. It is
-	// possible (and simpler) to read one byte at a time, but that is much less
-	// efficient. For example, in SST25x serial flash memory chips, reading a
+	// Each block is contiguous in flash memory, so read as much of each block
+	// as possible in one go. In SST25x serial flash memory chips, reading a
 	// byte at a time is about 5 times slower (per byte) than reading a large
 	// array of bytes in a single command.
-	// Since reads are expected to occur much more frequently than writes,
-	// inefficient reading will incur a significant performance penalty.
 	while (address < end)
 	{
-		address_tag = address & SECTOR_TAG_MASK;
-		if (write_cache_valid && (address_tag == write_cache_tag))
+		block = address / LOG_BLOCK_SIZE;
+		offset = address % LOG_BLOCK_SIZE;
+		chunk_length = MIN(LOG_BLOCK_SIZE - offset, end - address);
+		index = findCacheEntry(block);
+		if (index != NVMEM_CACHE_WAYS)
 		{
-			if (nv_read_length > 0)
-			{
-				// Beginning of write cache; end of contiguous non-volatile
-				// read.
-				sst25xRead(&(data[data_index]), address - nv_read_length, nv_read_length);
-				data_index += nv_read_length;
-				nv_read_length = 0;
-			}
-			// Address is in cache; read from the cache.
-			data[data_index] = write_cache[address & SECTOR_OFFSET_MASK];
-			data_index++;
+			// Block is in cache; read from the cache.
+			memcpy(&(data[data_index]), &(write_cache[index][offset]), chunk_length);
+		}
+		else if (block_map[block] == BLOCK_UNMAPPED)
+		{
+			// Block has never been written.
+			memset(&(data[data_index]), 0xff, chunk_length);
 		}
 		else
 		{
-			// Don't read just yet; queue it up and do all the reads together.
-			nv_read_length++;
+			sst25xRead(&(data[data_index]), block_map[block] + offset, chunk_length);
 		}
-		address++;
+		address += chunk_length;
+		data_index += chunk_length;
 	}
-	if (nv_read_length > 0)
+	diagnosticsNVEvent(DIAGNOSTICS_NV_READ);
+	return NV_NO_ERROR;
+}
+
+/** Append every valid write cache entry to the log.
+  * \return See #NonVolatileReturnEnum for return values.
+  */
+static NonVolatileReturn flushAllCacheEntries(void)
+{
+	unsigned int i;
+	unsigned int lowest;
+	NonVolatileReturn r;
+
+	r = initLog();
+	if (r != NV_NO_ERROR)
 	{
-		// End of contiguous non-volatile read.
-		sst25xRead(&(data[data_index]), address - nv_read_length, nv_read_length);
+		return r;
 	}
+	// Append blocks in order of address, so that the log is easier to
+	// inspect.
+	do
+	{
+		lowest = NVMEM_CACHE_WAYS;
+		for (i = 0; i < NVMEM_CACHE_WAYS; i++)
+		{
+			if (write_cache_valid[i])
+			{
+				if ((lowest == NVMEM_CACHE_WAYS) || (write_cache_tag[i] < write_cache_tag[lowest]))
+				{
+					lowest = i;
+				}
+			}
+		}
+		if (lowest != NVMEM_CACHE_WAYS)
+		{
+			r = flushCacheEntry(lowest);
+			if (r != NV_NO_ERROR)
+			{
+				return r;
+			}
+		}
+	} while (lowest != NVMEM_CACHE_WAYS);
 	return NV_NO_ERROR;
 }
 
@@ -223,39 +1103,302 @@ extern NonVolatileReturn nonVolatileRead(uint8_t *data, NVPartitions partition,
   * \return See #NonVolatileReturnEnum for return values.
   */
 NonVolatileReturn nonVolatileFlush(void)
+{
+	NonVolatileReturn r;
+
+	diagnosticsBeginNVFlush();
+	traceEvent(TRACE_NV_FLUSH_BEGIN, 0);
+	r = flushAllCacheEntries();
+	traceEvent(TRACE_NV_FLUSH_END, r);
+	diagnosticsEndNVFlush();
+	return r;
+}
+
+/** Background task (see addBackgroundTask()) which moves erases off the
+  * request path. Each call does at most one slow operation: it erases one
+  * free log sector which isn't known to be erased, or, if there are fewer
+  * than #NVMEM_SPARE_SECTORS + 1 free sectors, compacts the oldest sector
+  * early, as long as its live copies fit in what's left of the head sector.
+  * Errors are ignored here; they will happen again, and be reported, when
+  * the sector is actually needed by openLogSector() or appendRecord().
+  */
+void prepareSpareSectors(void)
 {
 	unsigned int i;
-	uint8_t read_buffer[SECTOR_SIZE];
+	unsigned int victim;
+	unsigned int live;
+	uint32_t block;
 
-	if (write_cache_valid)
+	if (!log_ready)
+	{
+		return; // the first access to non-volatile memory will scan the log
+	}
+	for (i = 0; i < NVMEM_LOG_SECTORS; i++)
 	{
-		if (write_cache_tag >= NV_MEMORY_SIZE)
+		if ((sector_sequence[i] == 0) && !sector_erased[i])
 		{
-			return NV_INVALID_ADDRESS;
+			if (isSectorErased(i))
+			{
+				sector_erased[i] = true;
+			}
+			else
+			{
+				eraseLogSector(i);
+			}
+			return;
 		}
-
-		// Erase sector and verify erase.
-		sst25xEraseSector(write_cache_tag);
-		sst25xRead(read_buffer, write_cache_tag, SECTOR_SIZE);
-		for (i = 0; i < SECTOR_SIZE; i++)
+	}
+	if (head_valid && (countFreeSectors() < (NVMEM_SPARE_SECTORS + 1)))
+	{
+		victim = findOldestSector();
+		if (victim == NVMEM_LOG_SECTORS)
+		{
+			return;
+		}
+		live = 0;
+		for (block = 0; block < NUM_LOGICAL_BLOCKS; block++)
 		{
-			if (read_buffer[i] != 0xff)
+			if (isLiveIn(block, victim))
 			{
-				return NV_IO_ERROR; // erase did not complete properly
+				live++;
 			}
 		}
+		if (live <= (RECORDS_PER_SECTOR - head_record))
+		{
+			compactLog();
+		}
+	}
+}
+
+#ifdef TEST_NVMEM_MANAGER
+
+/** Size, in bytes, of the fake flash memory: the legacy sector 0 plus the
+  * log. */
+#define FAKE_FLASH_SIZE		((NVMEM_LOG_FIRST_SECTOR + NVMEM_LOG_SECTORS) * SECTOR_SIZE)
 
-		// Program sector and verify program.
-		sst25xProgramSector(write_cache, write_cache_tag);
-		sst25xRead(read_buffer, write_cache_tag, SECTOR_SIZE);
-		if (memcmp(read_buffer, write_cache, SECTOR_SIZE))
+/** Contents of the fake flash memory which the sst25x*() functions below
+  * operate on. */
+static uint8_t fake_flash[FAKE_FLASH_SIZE];
+/** What non-volatile memory should contain, indexed by non-volatile memory
+  * offset (i.e. the global partition followed by the accounts partition). */
+static uint8_t expected_contents[NV_MEMORY_SIZE];
+
+/** Read from the fake flash memory.
+  * \param data The bytes will be written here.
+  * \param address The flash address to start reading from.
+  * \param length The number of bytes to read.
+  */
+void sst25xRead(uint8_t *data, uint32_t address, uint32_t length)
+{
+	if ((address > FAKE_FLASH_SIZE) || (length > (FAKE_FLASH_SIZE - address)))
+	{
+		printf("Read past end of flash memory\n");
+		exit(1);
+	}
+	memcpy(data, &(fake_flash[address]), length);
+}
+
+/** Erase a sector of the fake flash memory.
+  * \param address The flash address of anywhere in the sector.
+  */
+void sst25xEraseSector(uint32_t address)
+{
+	address &= ~(uint32_t)(SECTOR_SIZE - 1);
+	if (address >= FAKE_FLASH_SIZE)
+	{
+		printf("Erase past end of flash memory\n");
+		exit(1);
+	}
+	memset(&(fake_flash[address]), 0xff, SECTOR_SIZE);
+}
+
+/** Program the fake flash memory. Like the real thing, this can only clear
+  * bits.
+  * \param data The bytes to program.
+  * \param address The flash address to start programming at.
+  * \param length The number of bytes to program.
+  */
+void sst25xProgram(const uint8_t *data, uint32_t address, uint32_t length)
+{
+	uint32_t i;
+
+	if ((address > FAKE_FLASH_SIZE) || (length > (FAKE_FLASH_SIZE - address)))
+	{
+		printf("Program past end of flash memory\n");
+		exit(1);
+	}
+	for (i = 0; i < length; i++)
+	{
+		fake_flash[address + i] &= data[i];
+	}
+}
+
+/** Forget everything which is kept in RAM, as if the device was reset. The
+  * write cache must have been flushed first if its contents are meant to
+  * survive. */
+static void simulateReset(void)
+{
+	log_ready = false;
+	head_valid = false;
+	memset(write_cache_valid, 0, sizeof(write_cache_valid));
+	memset(write_cache_tag, 0, sizeof(write_cache_tag));
+	memset(write_cache_last_used, 0, sizeof(write_cache_last_used));
+	write_cache_clock = 0;
+}
+
+/** Write to non-volatile memory (and #expected_contents), given a
+  * non-volatile memory offset instead of a partition and address.
+  * \param data The bytes to write.
+  * \param address Non-volatile memory offset to start writing at.
+  * \param length The number of bytes to write. The write must not cross
+  *               the boundary between the partitions.
+  * \return See #NonVolatileReturnEnum for return values.
+  */
+static NonVolatileReturn writeBoth(uint8_t *data, uint32_t address, uint32_t length)
+{
+	memcpy(&(expected_contents[address]), data, length);
+	if (address < GLOBAL_PARTITION_SIZE)
+	{
+		return nonVolatileWrite(data, PARTITION_GLOBAL, address, length);
+	}
+	else
+	{
+		return nonVolatileWrite(data, PARTITION_ACCOUNTS, address - GLOBAL_PARTITION_SIZE, length);
+	}
+}
+
+/** Check that everything read from non-volatile memory matches
+  * #expected_contents.
+  * \param name Name of the test, which is displayed if it fails.
+  */
+static void checkContents(const char *name)
+{
+	uint8_t buffer[NV_MEMORY_SIZE];
+
+	if ((nonVolatileRead(buffer, PARTITION_GLOBAL, 0, GLOBAL_PARTITION_SIZE) != NV_NO_ERROR)
+		|| (nonVolatileRead(&(buffer[GLOBAL_PARTITION_SIZE]), PARTITION_ACCOUNTS, 0, ACCOUNTS_PARTITION_SIZE) != NV_NO_ERROR))
+	{
+		printf("Read failed in test \"%s\"\n", name);
+		reportFailure();
+	}
+	else if (memcmp(buffer, expected_contents, sizeof(buffer)))
+	{
+		printf("Contents mismatch in test \"%s\"\n", name);
+		reportFailure();
+	}
+	else
+	{
+		reportSuccess();
+	}
+}
+
+/** Migrate a completely full legacy sector into the log, so that the first
+  * log sector holds #RECORDS_PER_SECTOR live records. Then rewrite one
+  * block until the log has gone all the way round, so that sector is
+  * compacted while every record in it is still live. */
+static void testCompactFullyLiveSector(void)
+{
+	uint32_t i;
+	uint8_t value;
+	NonVolatileReturn r;
+
+	memset(fake_flash, 0xff, sizeof(fake_flash));
+	for (i = 0; i < NV_MEMORY_SIZE; i++)
+	{
+		expected_contents[i] = (uint8_t)(i ^ (i >> 8));
+		if (expected_contents[i] == 0xff)
+		{
+			expected_contents[i] = 0; // no block may look erased
+		}
+	}
+	memcpy(fake_flash, expected_contents, NV_MEMORY_SIZE);
+	simulateReset();
+	checkContents("migrate");
+	for (i = 0; i < (2 * NVMEM_LOG_SECTORS * RECORDS_PER_SECTOR); i++)
+	{
+		value = (uint8_t)i;
+		r = writeBoth(&value, NV_MEMORY_SIZE - 1, 1);
+		if (r == NV_NO_ERROR)
+		{
+			r = nonVolatileFlush();
+		}
+		if (r != NV_NO_ERROR)
 		{
-			return NV_IO_ERROR; // program did not complete properly
+			printf("Write %u failed with %d\n", (unsigned int)i, (int)r);
+			reportFailure();
+			return;
 		}
+	}
+	checkContents("compact fully live");
+	simulateReset();
+	checkContents("compact fully live after reset");
+}
 
-		write_cache_valid = false;
-		write_cache_tag = 0;
-		memset(write_cache, 0, sizeof(write_cache));
+/** Do lots of random writes, with the occasional flush and reset, and check
+  * that non-volatile memory always contains what was written. */
+static void testRandomWrites(void)
+{
+	unsigned int i;
+	uint32_t address;
+	uint32_t length;
+	uint8_t data[200];
+	NonVolatileReturn r;
+
+	memset(fake_flash, 0xff, sizeof(fake_flash));
+	memset(expected_contents, 0xff, sizeof(expected_contents));
+	simulateReset();
+	srand(42);
+	for (i = 0; i < 20000; i++)
+	{
+		address = (uint32_t)rand() % NV_MEMORY_SIZE;
+		length = 1 + (uint32_t)rand() % sizeof(data);
+		// Don't cross the boundary between the partitions.
+		if (address < GLOBAL_PARTITION_SIZE)
+		{
+			length = MIN(length, GLOBAL_PARTITION_SIZE - address);
+		}
+		else
+		{
+			length = MIN(length, NV_MEMORY_SIZE - address);
+		}
+		fillWithRandom(data, length);
+		r = writeBoth(data, address, length);
+		if ((r == NV_NO_ERROR) && ((rand() & 7) == 0))
+		{
+			r = nonVolatileFlush();
+		}
+		if (r != NV_NO_ERROR)
+		{
+			printf("Random write %u failed with %d\n", i, (int)r);
+			reportFailure();
+			return;
+		}
+		if ((rand() & 255) == 0)
+		{
+			prepareSpareSectors();
+		}
+		if ((i % 1000) == 999)
+		{
+			checkContents("random writes");
+			if (nonVolatileFlush() != NV_NO_ERROR)
+			{
+				printf("Flush failed after random write %u\n", i);
+				reportFailure();
+				return;
+			}
+			simulateReset();
+			checkContents("random writes after reset");
+		}
 	}
-	return NV_NO_ERROR;
 }
+
+int main(void)
+{
+	initTests(__FILE__);
+	testCompactFullyLiveSector();
+	testRandomWrites();
+	finishTests();
+	exit(0);
+}
+
+#endif // #ifdef TEST_NVMEM_MANAGER
@@ -0,0 +1,17 @@
+/** \file nvmem_manager.h
+  *
+  * \brief Describes functions exported by nvmem_manager.c.
+  *
+  * The non-volatile storage functions in nvmem_manager.c are declared in
+  * ../hwinterface.h, since they are part of the platform-independent
+  * interface. This only declares the PIC32-specific extras.
+  *
+  * This file is licensed as described by the file LICENCE.
+  */
+
+#ifndef PIC32_NVMEM_MANAGER_H_INCLUDED
+#define PIC32_NVMEM_MANAGER_H_INCLUDED
+
+extern void prepareSpareSectors(void);
+
+#endif // #ifndef PIC32_NVMEM_MANAGER_H_INCLUDED
@@ -12,6 +12,8 @@
 #include <stdbool.h>
 #include <p32xxxx.h>
 #include "pic32_system.h"
+#include "../hwinterface.h"
+#include "../tasks.h"
 
 // This series of #pragma declarations set the device configuration bits.
 // TODO: Implemented these in a less Microchip toolchain-specific way.
@@ -40,10 +42,25 @@
 /** Counter which counts down number of flashes of USB activity LED. */
 static volatile unsigned int usb_activity_counter;
 
+/** Value of the Timer2 period register. */
+#define TIMER2_PERIOD					141
+/** Number of times _Timer2Handler() is called per second. Timer2 runs
+  * from the peripheral bus clock (which is the same as the CPU clock) with
+  * a 1:256 prescaler. */
+#define TIMER2_INTERRUPTS_PER_SECOND	(CYCLES_PER_SECOND / ((TIMER2_PERIOD + 1) * 256))
+
 /** Counter which counts _Timer2Handler() calls in order to blink an LED at
   * a reasonable rate. */
 static uint32_t timer2_interrupt_counter;
 
+#ifdef ENABLE_KEEP_UNLOCKED
+/** Counter which counts _Timer2Handler() calls, up to
+  * #TIMER2_INTERRUPTS_PER_SECOND, in order to update #seconds_counter. */
+static uint32_t timer2_second_counter;
+/** Number of seconds since Timer2 was started; see getSecondsCounter(). */
+static volatile uint32_t seconds_counter;
+#endif // #ifdef ENABLE_KEEP_UNLOCKED
+
 /** This is true if the CPU should not enter idle mode. This is false if
   * the CPU is allowed to enter idle mode. */
 static bool idle_mode_suppressed;
@@ -106,14 +123,45 @@ void __attribute__((nomips16)) delayCyclesAndIdle(uint32_t num_cycles)
 	asm volatile("mfc0 %0, $9" : "=r"(start_count));
 	do
 	{
-		if (!idle_mode_suppressed)
-		{
-			enterIdleMode();
-		}
+		enterIdleMode();
 		asm volatile("mfc0 %0, $9" : "=r"(current_count));
 	} while ((current_count - start_count) < num_cycles);
 }
 
+#if defined(ENABLE_BENCHMARK) || defined(ENABLE_DIAGNOSTICS)
+/** Get the current value of the core timer (the Count CP0 register). This
+  * is incremented every 2 CPU cycles.
+  * \return The current value of the core timer.
+  */
+uint32_t __attribute__((nomips16)) getCycleCount(void)
+{
+	uint32_t count;
+
+	asm volatile("mfc0 %0, $9" : "=r"(count));
+	return count;
+}
+#endif // #if defined(ENABLE_BENCHMARK) || defined(ENABLE_DIAGNOSTICS)
+
+#ifdef ENABLE_DIAGNOSTICS
+/** Lowest address of the stack. This is generated by the linker, which
+  * gives the stack whatever RAM is left over (but at
+  * least _min_stack_size bytes). */
+extern uint8_t _splim[];
+/** Initial value of the stack pointer; the stack grows downwards from here.
+  * This is generated by the linker. */
+extern uint8_t _stack[];
+
+/** Get the region of RAM which is reserved for the stack.
+  * \param out_bottom Will be set to the lowest address of the stack.
+  * \param out_top Will be set to one past the highest address of the stack.
+  */
+void getStackBounds(uint8_t **out_bottom, uint8_t **out_top)
+{
+	*out_bottom = _splim;
+	*out_top = _stack;
+}
+#endif // #ifdef ENABLE_DIAGNOSTICS
+
 /** Initialise caching module and set up CPU for instruction caching. */
 static void __attribute__ ((nomips16)) prefetchInit(void)
 {
@@ -121,10 +169,16 @@ static void __attribute__ ((nomips16)) prefetchInit(void)
 
 	// Set 2 wait states. This is okay for CPU operation from 0 to 90 MHz.
 	CHECONbits.PFMWS = 2;
+#ifdef ENABLE_PERFORMANCE_GOVERNOR
+	// Prefetching is turned on for heavy computation only; see
+	// performanceBurstBegin().
+	CHECONbits.PREFEN = 0;
+#else
 	// Enable predictive caching for cacheable regions only.
 	// This eliminates flash wait states for sequential code.
 	// TODO: Maybe don't do this because of that CPU cache errata?
 	CHECONbits.PREFEN = 1;
+#endif // #ifdef ENABLE_PERFORMANCE_GOVERNOR
 	// Disable data caching.
 	CHECONbits.DCSZ = 0;
 	// Enable cacheability of kseg0 (it's turned off by default).
@@ -138,6 +192,59 @@ static void __attribute__ ((nomips16)) prefetchInit(void)
 	asm volatile("mtc0 %0, $16, 0" : : "r"(config1));
 }
 
+#ifdef ENABLE_PERFORMANCE_GOVERNOR
+/** Number of performanceBurstBegin() calls which haven't been matched by a
+  * call to performanceBurstEnd() yet. */
+static uint32_t burst_nesting;
+
+/** Switch the prefetch cache module to its high-throughput configuration:
+  * predictive prefetch for every region and data caching of flash
+  * constants (eg. the comb table in ecdsa_comb_table.h and the SHA-2 round
+  * constants), which are otherwise fetched with 2 wait states every time.
+  *
+  * The system clock, peripheral bus divider and flash wait states stay
+  * where pic32SystemInit() and prefetchInit() left them. The peripheral bus
+  * clock (see FPBDIV above) is the same as the system clock and the ADC, UART,
+  * Timer2 and Timer4 are all set up for that rate, as is
+  * #CYCLES_PER_MICROSECOND, so changing the system clock would disturb the
+  * HWRNG sample rate and serial link in the middle of a burst. 72 MHz
+  * already needs the full 2 wait states.
+  *
+  * Writing DCSZ invalidates every data cache line, so nothing which was
+  * cached before a flash write (see nonVolatileWrite()) can survive into
+  * the next burst.
+  */
+void __attribute__((nomips16)) performanceBurstBegin(void)
+{
+	if (burst_nesting == 0)
+	{
+		CHECONbits.PREFEN = 3;
+		CHECONbits.DCSZ = 3;
+	}
+	burst_nesting++;
+}
+
+/** Switch the prefetch cache module back to its low-power configuration
+  * once the outermost burst is over. Then the instruction cache (through
+  * kseg0) is all that remains; speculative prefetching is turned off, since
+  * between bursts the CPU spends most of its time in idle mode and the
+  * extra flash reads would be wasted. */
+void __attribute__((nomips16)) performanceBurstEnd(void)
+{
+	if (burst_nesting == 0)
+	{
+		fatalError(); // unmatched call
+		return;
+	}
+	burst_nesting--;
+	if (burst_nesting == 0)
+	{
+		CHECONbits.DCSZ = 0;
+		CHECONbits.PREFEN = 0;
+	}
+}
+#endif // #ifdef ENABLE_PERFORMANCE_GOVERNOR
+
 /** Enter PIC32 idle mode to conserve power. The CPU will leave idle mode when
   * an interrupt occurs.
   * There is the possibility of a race condition. Say, for example, the caller
@@ -146,9 +253,13 @@ static void __attribute__ ((nomips16)) prefetchInit(void)
   * calls this function to wait. However, the receive interrupt may occur
   * after the FIFO check but before the call to this function, in which case
   * the receive interrupt will not bring the CPU out of idle mode.
+  *
+  * Since the caller is waiting anyway, this is also where background tasks
+  * (eg. HWRNG work, see serviceHWRNG()) get a turn; see runBackgroundTasks().
   */
 void __attribute__((nomips16)) enterIdleMode(void)
 {
+	runBackgroundTasks();
 	if (!idle_mode_suppressed)
 	{
 		asm volatile("wait");
@@ -178,7 +289,26 @@ void __attribute__((vector(_TIMER_2_VECTOR), interrupt(ipl2), nomips16)) _Timer2
 		timer2_interrupt_counter = 0;
 		PORTDINV = 4; // blink green LED
 	}
+#ifdef ENABLE_KEEP_UNLOCKED
+	timer2_second_counter++;
+	if (timer2_second_counter == TIMER2_INTERRUPTS_PER_SECOND)
+	{
+		timer2_second_counter = 0;
+		seconds_counter++;
+	}
+#endif // #ifdef ENABLE_KEEP_UNLOCKED
+}
+
+#ifdef ENABLE_KEEP_UNLOCKED
+/** Get the number of seconds since pic32SystemInit() was called. This is
+  * derived from Timer2, so it's accurate to within about 0.1%.
+  * \return The number of seconds.
+  */
+uint32_t getSecondsCounter(void)
+{
+	return seconds_counter;
 }
+#endif // #ifdef ENABLE_KEEP_UNLOCKED
 
 /** Interrupt service handler for Timer4, used to flash USB activity LED. */
 void __attribute__((vector(_TIMER_4_VECTOR), interrupt(ipl2), nomips16)) _Timer4Handler(void)
@@ -232,7 +362,7 @@ void pic32SystemInit(void)
 	T2CONbits.TGATE = 0; // disable gated time accumulation
 	T2CONbits.SIDL = 0; // continue in idle mode
 	TMR2 = 0; // clear count
-	PR2 = 141; // frequency = about 2 kHz
+	PR2 = TIMER2_PERIOD; // frequency = about 2 kHz
 	T2CONbits.ON = 1; // turn timer on
 	IPC2bits.T2IP = 2; // priority level = 2
 	IPC2bits.T2IS = 0; // sub-priority level = 0
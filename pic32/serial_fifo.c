@@ -4,8 +4,12 @@
   *
   * Each FIFO buffer is intended to be used in a producer-consumer process,
   * with the producer existing in a non-IRH (Interrupt Request Handler) context
-  * and the consumer existing in an IRH context, or vice versa. Synchronisation
-  * is handled using critical sections.
+  * and the consumer existing in an IRH context, or vice versa. The buffers
+  * are lock-free: the producer only ever modifies CircularBuffer#head and
+  * the consumer only ever modifies CircularBuffer#tail, so neither side
+  * needs to disable interrupts. If there are producers (or consumers) in
+  * more than one context, it's up to the caller to make sure they don't
+  * run at the same time.
   * The functions in this file don't actually interface with any
   * communications hardware. The interface of circular buffers to hardware
   * must be handled elsewhere.
@@ -22,6 +26,12 @@
 #include "../common.h"
 #include "../hwinterface.h"
 
+/** Stop the compiler from moving memory accesses across this point. This is
+  * used to make sure that bytes are copied into or out of a buffer's storage
+  * before the new head or tail is published. No hardware barrier is needed,
+  * since the producer and consumer run on the same core. */
+#define COMPILER_BARRIER()	__asm__ __volatile__("" ::: "memory")
+
 /** Clear and initialise contents of circular buffer.
   * \param buffer The circular buffer to initialise and clear.
   * \param storage Storage array for buffer contents. This must be large enough
@@ -32,8 +42,8 @@ void initCircularBuffer(volatile CircularBuffer *buffer, volatile uint8_t *stora
 {
 	memset((void *)storage, 0xff, size); // just to be sure
 	memset((void *)storage, 0, size);
-	buffer->next = 0;
-	buffer->remaining = 0;
+	buffer->head = 0;
+	buffer->tail = 0;
 	buffer->size = size;
 	buffer->storage = storage;
 }
@@ -44,7 +54,7 @@ void initCircularBuffer(volatile CircularBuffer *buffer, volatile uint8_t *stora
   */
 bool isCircularBufferEmpty(volatile CircularBuffer *buffer)
 {
-	if (buffer->remaining == 0)
+	if (buffer->head == buffer->tail)
 	{
 		return true;
 	}
@@ -60,7 +70,7 @@ bool isCircularBufferEmpty(volatile CircularBuffer *buffer)
   */
 bool isCircularBufferFull(volatile CircularBuffer *buffer)
 {
-	if (buffer->remaining == buffer->size)
+	if ((buffer->head - buffer->tail) == buffer->size)
 	{
 		return true;
 	}
@@ -78,9 +88,19 @@ bool isCircularBufferFull(volatile CircularBuffer *buffer)
   */
 uint32_t circularBufferSpaceRemaining(volatile CircularBuffer *buffer)
 {
-	// No need to put this in a critical section since (outside of init),
-	// nothing else touches size.
-	return buffer->size - buffer->remaining;
+	// If the consumer reads in between the reads of head and tail, the
+	// returned value will be an underestimate, which is harmless.
+	return buffer->size - (buffer->head - buffer->tail);
+}
+
+/** Obtain the number of bytes in a circular buffer.
+  * \param buffer The circular buffer to check.
+  * \return The number of bytes which have been written to the circular
+  *         buffer but not yet read.
+  */
+uint32_t circularBufferBytesUsed(volatile CircularBuffer *buffer)
+{
+	return buffer->head - buffer->tail;
 }
 
 /** Read a byte from a circular buffer. This will block until a byte is
@@ -92,7 +112,6 @@ uint32_t circularBufferSpaceRemaining(volatile CircularBuffer *buffer)
   */
 uint8_t circularBufferRead(volatile CircularBuffer *buffer, bool is_irq)
 {
-	uint32_t status;
 	uint8_t r;
 
 	while(isCircularBufferEmpty(buffer))
@@ -108,11 +127,8 @@ uint8_t circularBufferRead(volatile CircularBuffer *buffer, bool is_irq)
 		enterIdleMode();
 	}
 
-	status = disableInterrupts();
-	r = buffer->storage[buffer->next];
-	buffer->remaining--;
-	buffer->next = (buffer->next + 1) & (buffer->size - 1);
-	restoreInterrupts(status);
+	r = buffer->storage[buffer->tail & (buffer->size - 1)];
+	buffer->tail++;
 	return r;
 }
 
@@ -125,9 +141,6 @@ uint8_t circularBufferRead(volatile CircularBuffer *buffer, bool is_irq)
   */
 void circularBufferWrite(volatile CircularBuffer *buffer, uint8_t data, bool is_irq)
 {
-	uint32_t status;
-	uint32_t index;
-
 	while (isCircularBufferFull(buffer))
 	{
 		// Buffer is full.
@@ -141,9 +154,112 @@ void circularBufferWrite(volatile CircularBuffer *buffer, uint8_t data, bool is_
 		enterIdleMode();
 	}
 
-	status = disableInterrupts();
-	index = (buffer->next + buffer->remaining) & (buffer->size - 1);
-	buffer->storage[index] = data;
-	buffer->remaining++;
-	restoreInterrupts(status);
+	buffer->storage[buffer->head & (buffer->size - 1)] = data;
+	buffer->head++;
+}
+
+/** Read up to length bytes from a circular buffer. This will block until at
+  * least one byte can be read, then read as many bytes as are available (up
+  * to length). The bytes are copied out of the buffer's storage as (at most)
+  * two contiguous regions.
+  * \param buffer The circular buffer to read from.
+  * \param data The bytes that were read will be written here. This must
+  *             have space for length bytes.
+  * \param length The maximum number of bytes to read. This must be
+  *               non-zero.
+  * \param is_irq Use true if calling this from an interrupt
+  *               request handler, otherwise use false.
+  * \return The number of bytes that were read from the buffer.
+  */
+uint32_t circularBufferReadBytes(volatile CircularBuffer *buffer, uint8_t *data, uint32_t length, bool is_irq)
+{
+	uint32_t index;
+	uint32_t first;
+
+	while(isCircularBufferEmpty(buffer))
+	{
+		if (is_irq)
+		{
+			// See circularBufferRead() for why this is fatal.
+			usbFatalError();
+			return 0;
+		}
+		enterIdleMode();
+	}
+
+	length = MIN(length, buffer->head - buffer->tail);
+	index = buffer->tail & (buffer->size - 1);
+	first = MIN(length, buffer->size - index);
+	memcpy(data, (const void *)&(buffer->storage[index]), first);
+	memcpy(&(data[first]), (const void *)buffer->storage, length - first);
+	COMPILER_BARRIER();
+	buffer->tail += length;
+	return length;
+}
+
+/** Throw away up to length bytes from a circular buffer. This behaves like
+  * circularBufferReadBytes(), except that nothing is copied out of the
+  * buffer's storage; only the tail moves.
+  * \param buffer The circular buffer to discard bytes from.
+  * \param length The maximum number of bytes to discard. This must be
+  *               non-zero.
+  * \param is_irq Use true if calling this from an interrupt
+  *               request handler, otherwise use false.
+  * \return The number of bytes that were discarded from the buffer.
+  */
+uint32_t circularBufferDiscardBytes(volatile CircularBuffer *buffer, uint32_t length, bool is_irq)
+{
+	while(isCircularBufferEmpty(buffer))
+	{
+		if (is_irq)
+		{
+			// See circularBufferRead() for why this is fatal.
+			usbFatalError();
+			return 0;
+		}
+		enterIdleMode();
+	}
+
+	length = MIN(length, buffer->head - buffer->tail);
+	COMPILER_BARRIER();
+	buffer->tail += length;
+	return length;
+}
+
+/** Write up to length bytes to a circular buffer. This will block until
+  * there is space for at least one byte, then write as many bytes as there
+  * is space for (up to length). The bytes are copied into the buffer's
+  * storage as (at most) two contiguous regions.
+  * \param buffer The circular buffer to write to.
+  * \param data The bytes to write to the buffer.
+  * \param length The maximum number of bytes to write. This must be
+  *               non-zero.
+  * \param is_irq Use true if calling this from an interrupt
+  *               request handler, otherwise use false.
+  * \return The number of bytes that were written to the buffer.
+  */
+uint32_t circularBufferWriteBytes(volatile CircularBuffer *buffer, const uint8_t *data, uint32_t length, bool is_irq)
+{
+	uint32_t index;
+	uint32_t first;
+
+	while (isCircularBufferFull(buffer))
+	{
+		if (is_irq)
+		{
+			// See circularBufferWrite() for why this is fatal.
+			usbFatalError();
+			return 0;
+		}
+		enterIdleMode();
+	}
+
+	length = MIN(length, circularBufferSpaceRemaining(buffer));
+	index = buffer->head & (buffer->size - 1);
+	first = MIN(length, buffer->size - index);
+	memcpy((void *)&(buffer->storage[index]), data, first);
+	memcpy((void *)buffer->storage, &(data[first]), length - first);
+	COMPILER_BARRIER();
+	buffer->head += length;
+	return length;
 }
@@ -13,10 +13,13 @@
 /** A circular buffer. */
 typedef struct CircularBufferStruct
 {
-	/** Index of the next element to remove. */
-	volatile uint32_t next;
-	/** Number of elements remaining in buffer. */
-	volatile uint32_t remaining;
+	/** Total number of elements ever written to the buffer (modulo 2 ^ 32).
+	  * Only the producer modifies this. */
+	volatile uint32_t head;
+	/** Total number of elements ever read from the buffer (modulo 2 ^ 32).
+	  * Only the consumer modifies this. The number of elements in the buffer
+	  * is head - tail. */
+	volatile uint32_t tail;
 	/** The maximum number of elements the buffer can store.
 	  * \warning This must be a power of 2.
 	  */
@@ -29,7 +32,11 @@ extern void initCircularBuffer(volatile CircularBuffer *buffer, volatile uint8_t
 extern bool isCircularBufferEmpty(volatile CircularBuffer *buffer);
 extern bool isCircularBufferFull(volatile CircularBuffer *buffer);
 extern uint32_t circularBufferSpaceRemaining(volatile CircularBuffer *buffer);
+extern uint32_t circularBufferBytesUsed(volatile CircularBuffer *buffer);
 extern uint8_t circularBufferRead(volatile CircularBuffer *buffer, bool is_irq);
 extern void circularBufferWrite(volatile CircularBuffer *buffer, uint8_t data, bool is_irq);
+extern uint32_t circularBufferReadBytes(volatile CircularBuffer *buffer, uint8_t *data, uint32_t length, bool is_irq);
+extern uint32_t circularBufferDiscardBytes(volatile CircularBuffer *buffer, uint32_t length, bool is_irq);
+extern uint32_t circularBufferWriteBytes(volatile CircularBuffer *buffer, const uint8_t *data, uint32_t length, bool is_irq);
 
 #endif // #ifndef SERIAL_FIFO_H_INCLUDED
@@ -14,6 +14,17 @@
   * to change the state of the display. Note that nothing will be displayed
   * until the display is turned on using displayOn().
   *
+  * Resetting the SSD1306 and clearing its GDDRAM takes a while, and nothing
+  * needs the display during boot, so initSSD1306() only holds the SSD1306
+  * in reset. The reset and clear are done by startSSD1306() when the display
+  * is first used.
+  *
+  * By default, the display is driven by bit-banging GPIO (see
+  * ssd1306_bitbang.S). If SSD1306_SPI_DMA is defined, the PIC32's SPI3
+  * module and DMA channel 3 are used instead, so that the display can be
+  * updated while the CPU goes on to do other things. See
+  * configurePeripheralsForSSD1306() for the different wiring this requires.
+  *
   * A lot of the interface requirements were obtained from the SSD1306
   * datasheet, obtained from http://www.adafruit.com/datasheets/SSD1306.pdf
   * on 30-Apr-2012.
@@ -38,6 +49,12 @@
 /** Bit which specifies which pin (1 = RD0, 2 = RD1, 4 = RD2 etc.) on port D
   * the OLED controller's serial clock line is connected to. */
 #define OLED_SCLK		(1 << 1)
+#ifdef SSD1306_SPI_DMA
+/** Bit which specifies which pin (1 = RD0, 2 = RD1, 4 = RD2 etc.) on port D
+  * the OLED controller's data/command select (D/C#) line is connected to.
+  * This is only used in "4-wire SPI" mode. */
+#define OLED_DC			(1 << 7)
+#endif // #ifdef SSD1306_SPI_DMA
 
 /** Width of the display, in number of pixels. */
 #define DISPLAY_WIDTH		128
@@ -57,9 +74,11 @@
 /** Maximum number of lines on screen. */
 #define NUMBER_OF_LINES		4
 
-/** Number of bits (or equivalently, total pixels) in #font_table that each
-  * character occupies. */
-#define CHARACTER_BITS	(CHARACTER_WIDTH * CHARACTER_HEIGHT)
+/** Number of bytes (pages) in #font_table that each column of a character
+  * occupies. */
+#define PAGES_PER_CHARACTER	((CHARACTER_HEIGHT + 7) / 8)
+/** Number of bytes in #font_table that each character occupies. */
+#define CHARACTER_BYTES		(CHARACTER_WIDTH * PAGES_PER_CHARACTER)
 
 /** The character encoding value that the font table begins at. Setting this
   * to a non-zero value saves space by not having to store the bitmaps for
@@ -68,19 +87,15 @@
 /** The character encoding value for a blank (all-zero bitmap) character. */
 #define FONT_BLANK			32
 
-/** Packed, vertical, monochrome bitmaps for each character.
+/** Page-aligned, vertical, monochrome bitmaps for each character.
   *
-  * The packed vertical bitmap can be interpreted as follows: imagine the font
-  * table as a single large little-endian multi-precision integer. Start
-  * with the least significant bit and move to more significant bits. The
-  * least significant bit represents the top-left pixel of the first glyph.
-  * For each increment in bit significance, move down to the next pixel. If
-  * you get to the bottom, move to the top of the next (towards the right)
-  * column. If you get to the bottom of the last column, move to the top-left
-  * pixel of the next glyph.
-  *
-  * Because of the way lookupFontTable() works, this table should have at
-  * least one extra 0 byte appended.
+  * Each character occupies #CHARACTER_BYTES bytes. Those bytes are organised
+  * as #CHARACTER_WIDTH columns (leftmost first), each of which has
+  * #PAGES_PER_CHARACTER bytes (topmost first). Within a byte, the least
+  * significant bit represents the topmost pixel. This matches the layout of
+  * SSD1306 GDDRAM, so that bytes can be copied straight to the display. If
+  * #CHARACTER_HEIGHT is not a multiple of 8, the last byte of every column
+  * is padded with 0 bits.
   *
   * Table generated from file "ter-u16b.bdf" using bdf_converter.
   * Font name: "-xos4-Terminus-Bold-R-Normal--16-160-72-72-C-80-ISO10646-1".
@@ -181,14 +196,19 @@ const uint8_t font_table[] = {
 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xfc, 0x0f, 0xfc, 0x0f, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
 0x00, 0x00, 0x04, 0x08, 0x04, 0x08, 0xbc, 0x0f, 0xf8, 0x07, 0x40, 0x00, 0x00, 0x00, 0x00, 0x00,
 0x0c, 0x00, 0x0e, 0x00, 0x02, 0x00, 0x06, 0x00, 0x0c, 0x00, 0x08, 0x00, 0x0e, 0x00, 0x06, 0x00,
-0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-0x00};
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
 
 /** Character buffer, in row-major order, starting from the top-left.
   * Characters should have their ASCII values written here.
   * renderDisplay() will render the contents of this buffer to the display.
   */
 static uint8_t text_buffer[CHARACTERS_PER_LINE * NUMBER_OF_LINES];
+/** What #text_buffer contained when it was last rendered, i.e. what is
+  * currently being shown on the display. renderDisplay() compares this
+  * with #text_buffer so that only character cells which have changed need to
+  * be re-rendered and sent to the display.
+  */
+static uint8_t rendered_buffer[CHARACTERS_PER_LINE * NUMBER_OF_LINES];
 /** The line where the (hidden) cursor is at. 0 = topmost. This is also the
   * line within #text_buffer that writeStringToDisplay() will write to next.
   */
@@ -198,9 +218,159 @@ static uint32_t cursor_line;
   * writeStringToDisplay() will write to next.
   */
 static uint32_t cursor_pos;
-
+/** Whether startSSD1306() has reset the SSD1306 and cleared its GDDRAM. */
+static bool is_ssd1306_started;
+
+#ifdef SSD1306_SPI_DMA
+/** Rendered display data, which DMA channel 3 transfers to the SSD1306.
+  * This must not be modified while a transfer is in progress; see
+  * waitForSSD1306Idle(). */
+static uint8_t render_buffer[DISPLAY_WIDTH * DISPLAY_HEIGHT / 8];
+/** Whether a DMA transfer of #render_buffer was started and may not have
+  * finished yet. */
+static volatile bool dma_in_progress;
+#else
 /** See ssd1306_bitbang.S. */
 extern void ssd1306BitBangOneFrame(volatile uint32_t *port, uint32_t frame_data, uint32_t sclk_pin, uint32_t sdin_pin);
+#endif // #ifdef SSD1306_SPI_DMA
+
+#ifdef SSD1306_SPI_DMA
+
+/** Configures PIC32 ports, SPI3 and DMA channel 3 to interface with SSD1306.
+  * The SPI3 serial clock (SCK3) should be connected to the SSD1306's serial
+  * clock (D0) and SPI3 serial data out (SDO3) should be connected to the
+  * SSD1306's serial data in (D1). The chip select (CS#) line should be
+  * connected to the port specified by #OLED_CS. Likewise for the reset
+  * (RES#) with #OLED_RES and data/command select (D/C#) with #OLED_DC.
+  *
+  * The SSD1306 should have BS0, BS1 and BS2 tied low. This selects "4-wire
+  * SPI" mode on the SSD1306, which is needed because the PIC32's SPI
+  * module can't send the 9 bit wide frames of "3-wire SPI" mode. All other
+  * input pins should be connected as directed on section 8.1 ("MCU
+  * Interface selection") of the SSD1306 datasheet.
+  *
+  * The SSD1306 is the only device on SPI3, so chip select is left asserted.
+  */
+static void configurePeripheralsForSSD1306(void)
+{
+	uint32_t junk;
+
+	TRISDCLR = OLED_CS | OLED_RES | OLED_DC;
+	PORTDSET = OLED_RES | OLED_DC;
+	PORTDCLR = OLED_CS;
+
+	SPI3CONbits.ON = 0; // stop and reset SPI module
+	while (SPI3STATbits.SPIRBE == 0)
+	{
+		junk = SPI3BUF; // flush receive FIFO
+	}
+	SPI3CONbits.ENHBUF = 1; // enable enhanced buffer mode (i.e. enable FIFOs)
+	// Section 13 ("AC Characteristics") of the SSD1306 datasheet specifies
+	// a minimum serial clock cycle time of 100 ns.
+	SPI3BRG = 3; // set baud rate for 9 MHz operation
+	SPI3STATbits.SPIROV = 0;
+	SPI3CONbits.MSTEN = 1; // PIC32 is SPI master
+	SPI3CONbits.CKP = 1; // idle high, active low
+	SPI3CONbits.CKE = 0; // output transition on idle -> active
+	SPI3CONbits.SMP = 0; // sample input in middle of data output time
+	SPI3CONbits.MODE16 = 0; // 8 bit mode
+	SPI3CONbits.MODE32 = 0; // 8 bit mode
+	SPI3CONbits.DISSDO = 0; // enable SDO
+	SPI3CONbits.SIDL = 0; // continue operation in idle mode
+	SPI3CONbits.FRMEN = 0; // disable framed mode
+	SPI3CONbits.MSSEN = 0; // disable slave select (that's controlled manually)
+	// The SPI3 transmit interrupt flag is used as a DMA trigger; the
+	// interrupt itself stays disabled.
+	SPI3CONbits.STXISEL = 3; // TX event when transmit buffer is not full
+	IEC0bits.SPI3TXIE = 0;
+	IEC0bits.SPI3RXIE = 0;
+	IEC0bits.SPI3EIE = 0;
+	SPI3CONbits.ON = 1; // start SPI module
+
+	DMACONbits.ON = 1; // enable DMA controller
+	DMACONbits.SUSPEND = 0; // disable DMA suspend
+	IEC1bits.DMA3IE = 0; // disable DMA channel 3 interrupt
+	DCH3CON = 0;
+	DCH3CONbits.CHPRI = 0; // priority = lowest
+	DCH3ECON = 0;
+	DCH3ECONbits.CHSIRQ = _SPI3_TX_IRQ; // start cell transfer on SPI3 TX event
+	DCH3ECONbits.SIRQEN = 1;
+	DCH3INTCLR = 0x00ff00ff; // clear existing events, disable all interrupts
+	dma_in_progress = false;
+}
+
+/** Wait until everything that was written to the SSD1306 has been shifted
+  * out, including any DMA transfer started by writeSPIDataUsingDMA(). This
+  * needs to be done before D/C# is changed and before #render_buffer is
+  * modified.
+  */
+static void waitForSSD1306Idle(void)
+{
+	if (dma_in_progress)
+	{
+		while (DCH3INTbits.CHBCIF == 0)
+		{
+			// do nothing
+		}
+		DCH3CONbits.CHEN = 0;
+		dma_in_progress = false;
+	}
+	while ((SPI3STATbits.SPITBE == 0) || (SPI3STATbits.SPIBUSY != 0))
+	{
+		// do nothing
+	}
+	// Nothing reads received bytes, so the receive FIFO will have
+	// overflowed. In master mode, that doesn't stop transmission; the
+	// overflow flag is cleared just to keep the module in a clean state.
+	SPI3STATbits.SPIROV = 0;
+}
+
+/** Write an 8 bit command or data to the SSD1306 via. SPI3. This will wait
+  * for any previous writes (including DMA transfers) to finish.
+  * \param is_data This should be true if value is data, false if value
+  *                is a command.
+  * \param value The command or data to write.
+  */
+static void writeSPIByte(bool is_data, uint8_t value)
+{
+	waitForSSD1306Idle();
+	if (is_data)
+	{
+		PORTDSET = OLED_DC;
+	}
+	else
+	{
+		PORTDCLR = OLED_DC;
+	}
+	SPI3BUF = value;
+}
+
+/** Start a DMA transfer of data bytes to the SSD1306. This doesn't wait for
+  * the transfer to finish, so that the caller can do other things while the
+  * display is updated. The next call to writeSPIByte() or
+  * waitForSSD1306Idle() will wait for it to finish.
+  * \param buffer The data bytes to write. This must stay unmodified until
+  *               the transfer has finished.
+  * \param length The number of bytes to write. This must be at least 1.
+  */
+static void writeSPIDataUsingDMA(const uint8_t *buffer, uint32_t length)
+{
+	waitForSSD1306Idle();
+	PORTDSET = OLED_DC;
+	DCH3INTCLR = 0x000000ff; // clear all channel event flags
+	DCH3SSA = VIRTUAL_TO_PHYSICAL(buffer); // transfer source physical address
+	DCH3DSA = VIRTUAL_TO_PHYSICAL(&SPI3BUF); // transfer destination physical address
+	DCH3SSIZ = length; // source size
+	DCH3DSIZ = 1; // destination size
+	DCH3CSIZ = 1; // cell size (bytes transferred per event)
+	dma_in_progress = true;
+	IFS0bits.SPI3TXIF = 0; // clear stale trigger event
+	DCH3CONbits.CHEN = 1;
+	// Since the transmit FIFO is empty, the SPI3 TX event will fire right
+	// away and the transfer will start.
+}
+
+#else
 
 /** Configures PIC32 ports to interface with SSD1306. The chip select (CS#)
   * line should be connected to the port specified by #OLED_CS. Likewise for
@@ -239,10 +409,15 @@ static void writeSPIByte(bool is_data, uint8_t value)
 	PORTDSET = OLED_CS;
 }
 
+#endif // #ifdef SSD1306_SPI_DMA
+
+static void startSSD1306(void);
+
 /** Turn display on. This must be called in order to have anything appear
   * on the screen. */
 void displayOn(void)
 {
+	startSSD1306();
 	writeSPIByte(false, 0xaf); // display on
 }
 
@@ -250,7 +425,12 @@ void displayOn(void)
   * low power state. */
 void displayOff(void)
 {
-	writeSPIByte(false, 0xae); // display off
+	// If the SSD1306 hasn't been started, it's still being held in reset,
+	// which means it's already off.
+	if (is_ssd1306_started)
+	{
+		writeSPIByte(false, 0xae); // display off
+	}
 }
 
 /** Reset and initialise the SSD1306 display controller. This mostly follows
@@ -268,7 +448,7 @@ static void resetSSD1306(void)
 	// RES# needs to be low for at least 3 microseconds.
 	delayCycles(50 * CYCLES_PER_MICROSECOND); // 50 microseconds just to be sure
 	PORTDSET = OLED_RES;
-	displayOff();
+	writeSPIByte(false, 0xae); // display off
 	writeSPIByte(false, 0xa8); // set multiplex ratio
 	writeSPIByte(false, 0x3f); // multiplex ratio = 64MUX
 	writeSPIByte(false, 0xd3); // set display offset
@@ -290,50 +470,40 @@ static void resetSSD1306(void)
 	writeSPIByte(false, 0x01); // memory addressing mode = vertical
 }
 
-/** Clear the display and all associated buffers. */
-void clearDisplay(void)
-{
-	uint32_t i;
-
-	for (i = 0; i < 1024; i++)
-	{
-		writeSPIByte(true, 0);
-	}
-	cursor_line = 0;
-	cursor_pos = 0;
-	memset(text_buffer, FONT_BLANK, sizeof(text_buffer));
-}
-
-/** Set up everything so that the display is ready to start having text
-  * rendered on it. By default, this will not turn on the display; use
-  * displayOn() to do that. */
-void initSSD1306(void)
+/** Set the region of display GDDRAM that subsequent data bytes will be
+  * written to. Since the memory addressing mode is vertical (see
+  * resetSSD1306()), data bytes fill the region page by page, moving to the
+  * next column when the last page is reached.
+  * \param first_column First column of the region (0 = leftmost).
+  * \param last_column Last column of the region (inclusive).
+  * \param first_page First page (8 pixel high row) of the region
+  *                   (0 = topmost).
+  * \param last_page Last page of the region (inclusive).
+  */
+static void setAddressWindow(uint8_t first_column, uint8_t last_column, uint8_t first_page, uint8_t last_page)
 {
-	configurePeripheralsForSSD1306();
-	resetSSD1306();
-	clearDisplay();
+	writeSPIByte(false, 0x21); // set column address
+	writeSPIByte(false, first_column);
+	writeSPIByte(false, last_column);
+	writeSPIByte(false, 0x22); // set page address
+	writeSPIByte(false, first_page);
+	writeSPIByte(false, last_page);
 }
 
-/** Font table byte lookup function which has bit granularity. Alternatively,
-  * this can be thought of as treating the font table as a giant little-endian
-  * multi-precision integer, shifting it to the right bit_offset times and
-  * returning the least significant byte.
-  * This does range checking of bit_offset.
-  * \param bit_offset The font table offset, in bits, to grab a byte from.
-  * \return A byte from within the font table.
+/** Clear all of the display's GDDRAM, regardless of what #rendered_buffer
+  * says is on the display. This is needed after a reset, when GDDRAM
+  * contains undefined junk.
   */
-static uint8_t lookupFontTable(uint32_t bit_offset)
+static void clearGDDRAM(void)
 {
-	uint32_t index;
-	uint32_t data;
+	uint32_t i;
 
-	index = bit_offset >> 3;
-	if (index >= (sizeof(font_table) - 1))
+	setAddressWindow(0, DISPLAY_WIDTH - 1, 0, (DISPLAY_HEIGHT / 8) - 1);
+	for (i = 0; i < (DISPLAY_WIDTH * DISPLAY_HEIGHT / 8); i++)
 	{
-		return 0; // empty character
+		writeSPIByte(true, 0);
 	}
-	data = font_table[index] | (font_table[index + 1] << 8);
-	return (uint8_t)(data >> (bit_offset & 7));
+	memset(rendered_buffer, FONT_BLANK, sizeof(rendered_buffer));
 }
 
 /** Text buffer query function. As well as obtaining a character from
@@ -365,94 +535,273 @@ static uint8_t lookupTextBuffer(uint32_t char_x, uint32_t char_y)
 	}
 }
 
-/** Using the contents of the text buffer (#text_buffer) and the font
-  * in #font_table, this outputs a series of data bytes to the SSD1306
-  * display.
-  *
-  * Since the SSD1306 memory addressing mode is set to "vertical" by
-  * resetSSD1306(), this function renders in columns, 8 pixels at a time.
-  * The rendering loop starts at the top-left, moves downwards and when it
-  * hits the bottom of the current column, moves right to start at the top
-  * of the next column. Column-based rendering is done because the SSD1306's
-  * GDDRAM is column-based (each byte of data corresponds to an 8 pixel high
-  * column).
+/** Get the bitmap of a character from the font table. This does range
+  * checking, so that characters which aren't in the font table are
+  * rendered as blank characters.
+  * \param char_x x location (0 = leftmost) of character to fetch.
+  * \param char_y y location (0 = topmost) of character to fetch.
+  * \return A pointer to the #CHARACTER_BYTES bytes of the character's bitmap,
+  *         within #font_table.
+  */
+static const uint8_t *lookupGlyph(uint32_t char_x, uint32_t char_y)
+{
+	uint32_t index;
+
+	index = lookupTextBuffer(char_x, char_y);
+	if (index >= (sizeof(font_table) / CHARACTER_BYTES))
+	{
+		index = FONT_BLANK - FONT_TABLE_START;
+	}
+	return &(font_table[index * CHARACTER_BYTES]);
+}
+
+/** Get 8 vertically adjacent pixels from one column of a character's bitmap.
+  * When row_offset is a multiple of 8 (which is always the case if
+  * #CHARACTER_HEIGHT is a multiple of 8), this is just a copy of one byte
+  * from the font table.
+  * \param glyph The character's bitmap, as returned by lookupGlyph().
+  * \param column The column (0 = leftmost) within the character.
+  * \param row_offset The row (0 = topmost) within the character of the
+  *                   first pixel to get.
+  * \return The 8 pixels, with the least significant bit being the topmost.
+  *         Pixels below the bottom of the character will be 0.
+  */
+static uint8_t getGlyphColumn(const uint8_t *glyph, uint32_t column, uint32_t row_offset)
+{
+	uint32_t index;
+	uint32_t data;
+
+	index = column * PAGES_PER_CHARACTER + (row_offset >> 3);
+	data = glyph[index];
+	if ((row_offset & 7) != 0)
+	{
+		if (((row_offset >> 3) + 1) < PAGES_PER_CHARACTER)
+		{
+			data |= (uint32_t)glyph[index + 1] << 8;
+		}
+		data >>= (row_offset & 7);
+	}
+	return (uint8_t)data;
+}
+
+/** Render one byte (8 pixel high column) of the display.
   *
   * In order for the renderer to work
   * correctly, #DISPLAY_WIDTH, #DISPLAY_HEIGHT, #CHARACTER_WIDTH
   * and #CHARACTER_HEIGHT must be set correctly.
   * The renderer only supports monochrome, fixed-width fonts.
   * However, the renderer can deal with fonts with a height which is not a
-  * multiple of 8.
-  *
-  * This renderer isn't very fast. But it doesn't need to be. With the SPI bus
-  * running at a bit rate of 1 Mhz, the renderer only needs to be able to
-  * write one byte every 384 cycles, which is a long time.
+  * multiple of 8; in that case, a byte may be the OR of pixels from two
+  * vertically adjacent characters.
+  * \param glyphs Bitmaps (see lookupGlyph()) of every character in the
+  *               column of characters which contains the byte, plus one
+  *               blank character below the bottom line.
+  * \param column x offset (0 = leftmost) of the byte within the character.
+  * \param page y location of the byte, in pages (0 = top edge, 1 = 8 pixels
+  *             below that etc.).
+  * \return The rendered byte, in the format expected by SSD1306 GDDRAM.
   */
-static void renderDisplay(void)
+static uint8_t renderByte(const uint8_t * const *glyphs, uint32_t column, uint32_t page)
 {
-	uint32_t x; // 0 = left edge, positive = right
-	uint32_t y; // 0 = top edge, positive = down
-	uint32_t char_x; // 0 = leftmost character, 1 = the one to the right of that etc.
 	uint32_t char_y; // 0 = topmost character, 1 = the one below that etc.
-	uint32_t char_x_offset; // x offset within character
 	uint32_t char_y_offset; // y offset within character
-	uint32_t amount; // number of bits to use
-	uint8_t current_character;
-	uint8_t next_character;
 	uint8_t data;
-	uint8_t temp_data;
 
-	char_x = 0;
-	char_x_offset = 0;
-	for (x = 0; x < DISPLAY_WIDTH; x++)
+	char_y = (page * 8) / CHARACTER_HEIGHT;
+	char_y_offset = (page * 8) % CHARACTER_HEIGHT;
+	data = getGlyphColumn(glyphs[char_y], column, char_y_offset);
+	if ((char_y_offset + 8) > CHARACTER_HEIGHT)
+	{
+		// Byte goes across character height boundary, so need to fetch
+		// partial character column from next (i.e. one below) character.
+		data |= (uint8_t)(getGlyphColumn(glyphs[char_y + 1], column, 0) << (CHARACTER_HEIGHT - char_y_offset));
+	}
+	return data;
+}
+
+/** Render a rectangular region of the display and send it to the SSD1306.
+  * The region covers whole characters horizontally and whole pages
+  * vertically.
+  * \param first_char_x Leftmost column of characters to render.
+  * \param last_char_x Rightmost column of characters to render (inclusive).
+  * \param first_page Topmost page to render.
+  * \param last_page Bottommost page to render (inclusive).
+  */
+static void renderWindow(uint32_t first_char_x, uint32_t last_char_x, uint32_t first_page, uint32_t last_page)
+{
+	uint32_t char_x; // 0 = leftmost character, 1 = the one to the right of that etc.
+	uint32_t char_y; // 0 = topmost character, 1 = the one below that etc.
+	uint32_t char_x_offset; // x offset within character
+	uint32_t page; // 0 = top edge, positive = down
+	const uint8_t *glyphs[NUMBER_OF_LINES + 1];
+#ifdef SSD1306_SPI_DMA
+	uint32_t length;
+#endif // #ifdef SSD1306_SPI_DMA
+
+	// This also waits for any previous DMA transfer to finish, so
+	// render_buffer can be written to afterwards.
+	setAddressWindow((uint8_t)(first_char_x * CHARACTER_WIDTH), (uint8_t)((last_char_x + 1) * CHARACTER_WIDTH - 1), (uint8_t)first_page, (uint8_t)last_page);
+#ifdef SSD1306_SPI_DMA
+	length = 0;
+#endif // #ifdef SSD1306_SPI_DMA
+	for (char_x = first_char_x; char_x <= last_char_x; char_x++)
 	{
-		// Render a column.
-		char_y = 0;
-		char_y_offset = 0;
-		// The next (i.e. one below) character needs to be fetched in advance
-		// because the next 8 pixels may go across the current's character
-		// height boundary.
-		current_character = lookupTextBuffer(char_x, char_y);
-		next_character = lookupTextBuffer(char_x, char_y + 1);
-		for (y = 0; y < DISPLAY_HEIGHT; y += 8)
+		// Look up every character in this column of characters once,
+		// instead of once per byte.
+		for (char_y = 0; char_y < (NUMBER_OF_LINES + 1); char_y++)
 		{
-			if ((char_y_offset + 8) > CHARACTER_HEIGHT)
+			glyphs[char_y] = lookupGlyph(char_x, char_y);
+		}
+		for (char_x_offset = 0; char_x_offset < CHARACTER_WIDTH; char_x_offset++)
+		{
+			for (page = first_page; page <= last_page; page++)
 			{
-				// Byte goes across character height boundary.
-				amount = CHARACTER_HEIGHT - char_y_offset;
+#ifdef SSD1306_SPI_DMA
+				render_buffer[length] = renderByte(glyphs, char_x_offset, page);
+				length++;
+#else
+				writeSPIByte(true, renderByte(glyphs, char_x_offset, page));
+#endif // #ifdef SSD1306_SPI_DMA
 			}
-			else
+		}
+	}
+#ifdef SSD1306_SPI_DMA
+	writeSPIDataUsingDMA(render_buffer, length);
+#endif // #ifdef SSD1306_SPI_DMA
+}
+
+/** Update the display so that it shows the contents of the text buffer
+  * (#text_buffer).
+  *
+  * Only character cells which differ from what was last rendered (see
+  * #rendered_buffer) are rendered and sent. For each column of characters,
+  * the pages spanned by the changed cells in that column are found.
+  * setAddressWindow() is used to restrict GDDRAM writes to just those pages
+  * of just that column of characters. If SSD1306_SPI_DMA is defined, a
+  * single window which bounds every changed cell is used instead, since
+  * then the whole update can be done with one DMA transfer. Since the
+  * SSD1306 memory addressing mode is set to "vertical" by resetSSD1306(),
+  * windows are filled in columns, 8 pixels at a time. Column-based rendering
+  * is done because the SSD1306's GDDRAM is column-based (each byte of data
+  * corresponds to an 8 pixel high column).
+  *
+  * Typical updates, like appending a line of text or replacing one screen
+  * of text with another which shares some characters, therefore send much
+  * less than the full 1024 bytes of GDDRAM.
+  */
+static void renderDisplay(void)
+{
+	uint32_t char_x; // 0 = leftmost character, 1 = the one to the right of that etc.
+	uint32_t char_y; // 0 = topmost character, 1 = the one below that etc.
+	uint32_t index;
+	uint32_t first_page;
+	uint32_t last_page;
+	bool dirty;
+#ifdef SSD1306_SPI_DMA
+	bool any_dirty;
+	uint32_t first_dirty_char_x;
+	uint32_t last_dirty_char_x;
+	uint32_t window_first_page;
+	uint32_t window_last_page;
+
+	any_dirty = false;
+	first_dirty_char_x = 0;
+	last_dirty_char_x = 0;
+	window_first_page = DISPLAY_HEIGHT / 8;
+	window_last_page = 0;
+#endif // #ifdef SSD1306_SPI_DMA
+
+	startSSD1306();
+	for (char_x = 0; char_x < CHARACTERS_PER_LINE; char_x++)
+	{
+		// Find range of pages which need to be updated.
+		dirty = false;
+		first_page = 0;
+		last_page = 0;
+		for (char_y = 0; char_y < NUMBER_OF_LINES; char_y++)
+		{
+			index = CHARACTERS_PER_LINE * char_y + char_x;
+			if (text_buffer[index] != rendered_buffer[index])
 			{
-				// Next byte resides entirely within current character.
-				amount = 8;
+				if (!dirty)
+				{
+					first_page = (char_y * CHARACTER_HEIGHT) / 8;
+					dirty = true;
+				}
+				last_page = ((char_y + 1) * CHARACTER_HEIGHT - 1) / 8;
+				rendered_buffer[index] = text_buffer[index];
 			}
-			data = lookupFontTable(current_character * CHARACTER_BITS + char_y_offset + char_x_offset * CHARACTER_HEIGHT);
-			data &= (1 << amount) - 1;
-			if ((char_y_offset + 8) > CHARACTER_HEIGHT)
+		}
+		if (last_page >= (DISPLAY_HEIGHT / 8))
+		{
+			last_page = (DISPLAY_HEIGHT / 8) - 1;
+		}
+
+		if (dirty)
+		{
+#ifdef SSD1306_SPI_DMA
+			if (!any_dirty)
 			{
-				// Need to fetch partial character column from next character.
-				temp_data = lookupFontTable(next_character * CHARACTER_BITS + char_x_offset * CHARACTER_HEIGHT);
-				data |= temp_data << amount;
+				first_dirty_char_x = char_x;
+				any_dirty = true;
 			}
-			writeSPIByte(true, data);
-			// Prepare for next byte.
-			char_y_offset += 8;
-			if (char_y_offset >= CHARACTER_HEIGHT)
+			last_dirty_char_x = char_x;
+			if (first_page < window_first_page)
 			{
-				char_y_offset -= CHARACTER_HEIGHT;
-				char_y++;
-				current_character = next_character;
-				next_character = lookupTextBuffer(char_x, char_y + 1);
+				window_first_page = first_page;
 			}
-		} // end for (y = 0; y < DISPLAY_HEIGHT; y += 8)
-		// Prepare for next column.
-		char_x_offset++;
-		if (char_x_offset >= CHARACTER_WIDTH)
-		{
-			char_x_offset = 0;
-			char_x++;
+			if (last_page > window_last_page)
+			{
+				window_last_page = last_page;
+			}
+#else
+			renderWindow(char_x, char_x, first_page, last_page);
+#endif // #ifdef SSD1306_SPI_DMA
 		}
-	} // end for (x = 0; x < DISPLAY_WIDTH; x++)
+	} // end for (char_x = 0; char_x < CHARACTERS_PER_LINE; char_x++)
+#ifdef SSD1306_SPI_DMA
+	if (any_dirty)
+	{
+		renderWindow(first_dirty_char_x, last_dirty_char_x, window_first_page, window_last_page);
+	}
+#endif // #ifdef SSD1306_SPI_DMA
+}
+
+/** Clear the display and all associated buffers. */
+void clearDisplay(void)
+{
+	cursor_line = 0;
+	cursor_pos = 0;
+	memset(text_buffer, FONT_BLANK, sizeof(text_buffer));
+	renderDisplay();
+}
+
+/** Reset the SSD1306 and clear its GDDRAM, if that hasn't been done
+  * already. This is called whenever something is about to be sent to the
+  * SSD1306. It doesn't turn the display on. */
+static void startSSD1306(void)
+{
+	if (!is_ssd1306_started)
+	{
+		is_ssd1306_started = true;
+		resetSSD1306();
+		clearGDDRAM();
+	}
+}
+
+/** Set up everything so that the display is ready to start having text
+  * rendered on it. By default, this will not turn on the display; use
+  * displayOn() to do that. This only configures the interface pins and
+  * holds the SSD1306 in reset, so it's quick; the SSD1306 itself is
+  * started when the display is first used. */
+void initSSD1306(void)
+{
+	configurePeripheralsForSSD1306();
+	PORTDCLR = OLED_RES;
+	is_ssd1306_started = false;
+	cursor_line = 0;
+	cursor_pos = 0;
+	memset(text_buffer, FONT_BLANK, sizeof(text_buffer));
 }
 
 /** Move cursor to the start of the next line, but only if the cursor is not
@@ -9,15 +9,23 @@
   * cost-per-kilobyte basis) than internal memory.
   *
   * The functions in this file provide low-level, raw access to the flash
-  * memory. Here "low-level" means that erase and program operations must occur
+  * memory. Here "low-level" means that erase operations must occur
   * with sector granularity (see #SECTOR_SIZE) and no wear-levelling is
-  * performed. Before calling any other function, initSST25x() must be called.
+  * performed (see nvmem_manager.c for that). Programming can be done with
+  * sector granularity (sst25xProgramSector()) or byte granularity
+  * (sst25xProgram()). Before calling any other function, initSST25x() must
+  * be called.
   *
   * While the code here is written for the SST25x series, other serial flash
   * memory chips (eg. from Winbond) have very similar interfaces. Thus the
   * code can probably be adapted to other serial flash memory chips relatively
   * easily.
   *
+  * By default, sst25xProgramSector() uses hardware end-of-write detection,
+  * which requires the SST25x's SO pin to be readable as a GPIO (see
+  * #SST25X_SO_PIN). Define SST25X_SOFTWARE_END_OF_WRITE to use software
+  * end-of-write detection (status register polling) instead.
+  *
   * For hardware interfacing requirements, see initSST25x(). All references
   * to the "PIC32 family reference manual" refer to Section 23 (Serial
   * Peripheral Interface), revision G, obtained from
@@ -33,8 +41,30 @@
 #include <p32xxxx.h>
 #include <stdint.h>
 #include "pic32_system.h"
+#include "../diagnostics.h"
 #include "sst25x.h"
 
+/** Read the level of the SST25x's SO pin, which is connected to SDI4 (RF4).
+  * The PORT register reflects the pin level even while SPI4 is using it. */
+#define SST25X_SO_PIN		PORTFbits.RF4
+
+#ifndef SST25X_DMA_THRESHOLD
+/** Read stages of spiCommand() which are at least this many bytes long are
+  * done using DMA channels 1 and 2 instead of moving every byte with the
+  * CPU. Short reads (like status register reads) aren't worth the DMA
+  * channel setup time. Set this to 0 to never use DMA.
+  * This can be overridden by defining SST25X_DMA_THRESHOLD in the
+  * platform's build settings.
+  */
+#define SST25X_DMA_THRESHOLD	16
+#endif // #ifndef SST25X_DMA_THRESHOLD
+
+#if SST25X_DMA_THRESHOLD > 0
+/** Maximum number of bytes in one DMA block transfer. This is limited by the
+  * width of the DCHxSSIZ and DCHxDSIZ registers. */
+#define SST25X_DMA_MAX_BLOCK	65535
+#endif // #if SST25X_DMA_THRESHOLD > 0
+
 /** One byte command op codes, taken from Table 5 of the SST25VF080B
   * datasheet. */
 typedef enum SST25xOpCodesEnum
@@ -121,7 +151,39 @@ void initSST25x(void)
 	SPI4CONbits.SIDL = 0; // continue operation in idle mode
 	SPI4CONbits.FRMEN = 0; // disable framed mode
 	SPI4CONbits.MSSEN = 0; // disable slave select (that's controlled manually)
+#if SST25X_DMA_THRESHOLD > 0
+	// The SPI4 interrupt flags are used as DMA triggers; the interrupts
+	// themselves stay disabled.
+	SPI4CONbits.STXISEL = 3; // TX event when transmit buffer is not full
+	SPI4CONbits.SRXISEL = 1; // RX event when receive buffer is not empty
+	IEC1bits.SPI4TXIE = 0;
+	IEC1bits.SPI4RXIE = 0;
+	IEC1bits.SPI4EIE = 0;
+#endif // #if SST25X_DMA_THRESHOLD > 0
 	SPI4CONbits.ON = 1; // start SPI module
+#if SST25X_DMA_THRESHOLD > 0
+	// Initialise DMA channels 1 (receive) and 2 (transmit). Channel 0
+	// belongs to adc.c, which also sets DMACONbits.ON, but this may be
+	// called before initADC().
+	DMACONbits.ON = 1; // enable DMA controller
+	DMACONbits.SUSPEND = 0; // disable DMA suspend
+	IEC1bits.DMA1IE = 0; // disable DMA channel 1 interrupt
+	IEC1bits.DMA2IE = 0; // disable DMA channel 2 interrupt
+	DCH1CON = 0;
+	// The receive channel has higher priority than the transmit channel, so
+	// that the receive FIFO is always drained before it can overflow.
+	DCH1CONbits.CHPRI = 2;
+	DCH1ECON = 0;
+	DCH1ECONbits.CHSIRQ = _SPI4_RX_IRQ; // start cell transfer on SPI4 RX event
+	DCH1ECONbits.SIRQEN = 1;
+	DCH1INTCLR = 0x00ff00ff; // clear existing events, disable all interrupts
+	DCH2CON = 0;
+	DCH2CONbits.CHPRI = 1;
+	DCH2ECON = 0;
+	DCH2ECONbits.CHSIRQ = _SPI4_TX_IRQ; // start cell transfer on SPI4 TX event
+	DCH2ECONbits.SIRQEN = 1;
+	DCH2INTCLR = 0x00ff00ff; // clear existing events, disable all interrupts
+#endif // #if SST25X_DMA_THRESHOLD > 0
 	restoreInterrupts(status);
 
 	// Disable block level write protection. See Table 3 of the SST25VF080B
@@ -163,6 +225,50 @@ static uint8_t readSPI(void)
 	return (uint8_t)SPI4BUF;
 }
 
+#if SST25X_DMA_THRESHOLD > 0
+
+/** Receive a block of bytes from SPI4 using DMA. Channel 2 clocks out the
+  * contents of the buffer itself as dummy bytes (the SST25x ignores its
+  * input while it is outputting data) and channel 1 writes the received
+  * bytes over them. Byte i is always transmitted before it is received, so
+  * it is never overwritten before it has been sent.
+  * Slave select must already be low and the SPI4 FIFOs must be empty.
+  * \param read_buffer Received bytes will be written into this array.
+  * \param read_length Number of bytes to receive. This must be at least 1
+  *                    and no more than #SST25X_DMA_MAX_BLOCK.
+  */
+static void readSPIUsingDMA(uint8_t *read_buffer, unsigned int read_length)
+{
+	DCH1CONbits.CHEN = 0; // disable channels
+	DCH2CONbits.CHEN = 0;
+	DCH1INTCLR = 0x000000ff; // clear all channel event flags
+	DCH2INTCLR = 0x000000ff;
+	DCH1SSA = VIRTUAL_TO_PHYSICAL(&SPI4BUF); // transfer source physical address
+	DCH1DSA = VIRTUAL_TO_PHYSICAL(read_buffer); // transfer destination physical address
+	DCH1SSIZ = 1; // source size
+	DCH1DSIZ = read_length; // destination size
+	DCH1CSIZ = 1; // cell size (bytes transferred per event)
+	DCH2SSA = VIRTUAL_TO_PHYSICAL(read_buffer);
+	DCH2DSA = VIRTUAL_TO_PHYSICAL(&SPI4BUF);
+	DCH2SSIZ = read_length;
+	DCH2DSIZ = 1;
+	DCH2CSIZ = 1;
+	IFS1bits.SPI4RXIF = 0; // clear stale trigger events
+	IFS1bits.SPI4TXIF = 0;
+	DCH1CONbits.CHEN = 1; // enable receive channel first
+	DCH2CONbits.CHEN = 1;
+	// Every transmitted byte is eventually received, so once the receive
+	// channel has finished, so has the transmit channel.
+	while (DCH1INTbits.CHBCIF == 0)
+	{
+		// do nothing
+	}
+	DCH1CONbits.CHEN = 0;
+	DCH2CONbits.CHEN = 0;
+}
+
+#endif // #if SST25X_DMA_THRESHOLD > 0
+
 /** Issue a command via. SPI4. Commands are used to read, write and configure
   * the SST25x serial flash. A command consists of a bunch of bytes to transmit
   * followed by a bunch of bytes to receive.
@@ -175,6 +281,9 @@ static void spiCommand(const uint8_t *command_buffer, unsigned int command_lengt
 {
 	unsigned int i;
 	uint8_t dummy;
+#if SST25X_DMA_THRESHOLD > 0
+	unsigned int chunk_length;
+#endif // #if SST25X_DMA_THRESHOLD > 0
 
 	// Why is slave select controlled manually? When slave select is under
 	// automatic control, it will be set high whenever the transmit buffer
@@ -195,6 +304,24 @@ static void spiCommand(const uint8_t *command_buffer, unsigned int command_lengt
 		writeSPI(command_buffer[i]);
 		dummy = readSPI();
 	}
+#if SST25X_DMA_THRESHOLD > 0
+	if (read_length >= SST25X_DMA_THRESHOLD)
+	{
+		// Read stage using DMA. Interrupt handlers can still run while this
+		// is happening, and won't disturb the transfer.
+		while (read_length > 0)
+		{
+			chunk_length = read_length;
+			if (chunk_length > SST25X_DMA_MAX_BLOCK)
+			{
+				chunk_length = SST25X_DMA_MAX_BLOCK;
+			}
+			readSPIUsingDMA(read_buffer, chunk_length);
+			read_buffer += chunk_length;
+			read_length -= chunk_length;
+		}
+	}
+#endif // #if SST25X_DMA_THRESHOLD > 0
 	// Read stage: write dummy values, reading values into the read buffer.
 	for (i = 0; i < read_length; i++)
 	{
@@ -266,6 +393,10 @@ static void sst25xWriteDisable(void)
 /** Wait until the SST25x serial flash is ready for another write (program or
   * erase) operation. This should be called after every write operation. It
   * does not need to be called after read operations.
+  *
+  * This uses software end-of-write detection, which needs a status register
+  * read command for every poll. During auto-address increment programming,
+  * sst25xWaitUntilSONotBusy() is much quicker.
   */
 static void sst25xWaitUntilNotBusy(void)
 {
@@ -276,6 +407,29 @@ static void sst25xWaitUntilNotBusy(void)
 	} while ((sst25x_status_register & 0x01) != 0);
 }
 
+#ifndef SST25X_SOFTWARE_END_OF_WRITE
+
+/** Wait until the SST25x serial flash has finished programming a word in
+  * auto-address increment mode, using hardware end-of-write detection.
+  * While chip enable is low, the SO pin is low when the flash is busy and
+  * high when it is ready, so no command needs to be sent. This follows
+  * Figure 12 of the SST25VF080B datasheet.
+  * \warning This only works if the SO busy indicator has been enabled using
+  *          #SST25X_EBSY.
+  */
+static void sst25xWaitUntilSONotBusy(void)
+{
+	PORTBbits.RB8 = 0; // set slave select low
+	asm("nop"); // delay just to be sure
+	while (SST25X_SO_PIN == 0)
+	{
+		// do nothing
+	}
+	PORTBbits.RB8 = 1; // set slave select high
+}
+
+#endif // #ifndef SST25X_SOFTWARE_END_OF_WRITE
+
 /** Read from SST25x serial flash. There are no restrictions on address
   * alignment or length. However, attempting to read beyond the end of the
   * flash will cause wraparound behaviour.
@@ -314,6 +468,7 @@ void sst25xEraseSector(uint32_t address)
 	spiCommand(command_buffer, 4, read_buffer, 0);
 	sst25xWaitUntilNotBusy();
 	sst25xWriteDisable(); // just to be safe
+	diagnosticsNVEvent(DIAGNOSTICS_NV_ERASE);
 }
 
 /** Program an entire sector (#SECTOR_SIZE bytes) of the SST25x serial flash.
@@ -332,6 +487,7 @@ void sst25xProgramSector(uint8_t *data, uint32_t address)
 	uint8_t read_buffer[1];
 
 	address &= (0xffffffff ^ (SECTOR_SIZE - 1)); // align to multiple of SECTOR_SIZE
+#ifdef SST25X_SOFTWARE_END_OF_WRITE
 	// Use auto-address increment mode with software end-of-write detection.
 	// This follows Figure 11 of the SST25VF080B datasheet.
 	sst25xWriteEnable();
@@ -352,5 +508,64 @@ void sst25xProgramSector(uint8_t *data, uint32_t address)
 		sst25xWaitUntilNotBusy();
 	}
 	sst25xWriteDisable(); // exit AAI mode
+#else
+	// Use auto-address increment mode with hardware end-of-write detection.
+	// This follows Figure 12 of the SST25VF080B datasheet. Checking the SO
+	// pin doesn't need a command, so each word only costs one 3 byte
+	// command instead of also needing status register reads.
+	command_buffer[0] = SST25X_EBSY;
+	spiCommand(command_buffer, 1, read_buffer, 0);
+	sst25xWriteEnable();
+	command_buffer[0] = SST25X_AAI_WORD_PROGRAM;
+	command_buffer[1] = (uint8_t)(address >> 16);
+	command_buffer[2] = (uint8_t)(address >> 8);
+	command_buffer[3] = (uint8_t)(address);
+	command_buffer[4] = data[0];
+	command_buffer[5] = data[1];
+	spiCommand(command_buffer, 6, read_buffer, 0);
+	sst25xWaitUntilSONotBusy();
+	command_buffer[0] = SST25X_AAI_WORD_PROGRAM;
+	for (i = 2; i < SECTOR_SIZE; i += 2)
+	{
+		command_buffer[1] = data[i];
+		command_buffer[2] = data[i + 1];
+		spiCommand(command_buffer, 3, read_buffer, 0);
+		sst25xWaitUntilSONotBusy();
+	}
+	sst25xWriteDisable(); // exit AAI mode
+	command_buffer[0] = SST25X_DBSY;
+	spiCommand(command_buffer, 1, read_buffer, 0);
+#endif // #ifdef SST25X_SOFTWARE_END_OF_WRITE
 	sst25xWaitUntilNotBusy(); // just to be safe
 }
+
+/** Program an arbitrary range of bytes of the SST25x serial flash. Unlike
+  * sst25xProgramSector(), there are no restrictions on address alignment or
+  * length, but this is slower per byte, since it programs one byte at a time.
+  * Programming can only change bits from 1 to 0, so the range should be in
+  * an erased state (use sst25xEraseSector() to do that).
+  * \param data The data to program the range with.
+  * \param address The flash memory address to begin programming at.
+  * \param length The number of bytes to program.
+  */
+void sst25xProgram(const uint8_t *data, uint32_t address, uint32_t length)
+{
+	uint32_t i;
+	uint8_t command_buffer[5];
+	uint8_t read_buffer[1];
+
+	// Use byte program mode. This follows Figure 10 of the SST25VF080B
+	// datasheet.
+	for (i = 0; i < length; i++)
+	{
+		sst25xWriteEnable();
+		command_buffer[0] = SST25X_BYTE_PROGRAM;
+		command_buffer[1] = (uint8_t)((address + i) >> 16);
+		command_buffer[2] = (uint8_t)((address + i) >> 8);
+		command_buffer[3] = (uint8_t)(address + i);
+		command_buffer[4] = data[i];
+		spiCommand(command_buffer, 5, read_buffer, 0);
+		sst25xWaitUntilNotBusy();
+	}
+	sst25xWriteDisable(); // just to be safe
+}
@@ -17,9 +17,8 @@
   */
 #define SECTOR_SIZE             4096
 /** Total number of bytes in non-volatile storage.
-  * This has been temporarily reduced to the size of the wallet storage area.
-  * It will be increased back to the real value when storage partitioning is
-  * implemented.
+  * This is the size of the logical storage area which nvmem_manager.c
+  * presents; the physical flash memory is much larger.
   * \warning This must be much smaller than 2 ^ 32 or some overflow checks
   *          in nvmem_manager.c won't work.
   */
@@ -38,5 +37,6 @@ extern void sst25xWriteStatusRegister(uint8_t sst25x_status_register);
 extern void sst25xRead(uint8_t *data, uint32_t address, uint32_t length);
 extern void sst25xEraseSector(uint32_t address);
 extern void sst25xProgramSector(uint8_t *data, uint32_t address);
+extern void sst25xProgram(const uint8_t *data, uint32_t address, uint32_t length);
 
 #endif	// #ifndef PIC32_SST25X_H
@@ -0,0 +1,753 @@
+// ***********************************************************************
+// load_tester.c
+// ***********************************************************************
+//
+// Load tester which replays a script of packets against several hardware
+// Bitcoin wallets at once, one thread per device, and reports per-command
+// latency percentiles and aggregate throughput. Devices can be USB HID
+// devices (using the same stream-based HID protocol as hwb_tester.c) or
+// instances of the emulator in the emulator/ subdirectory, connected to
+// over TCP or a UNIX-domain socket.
+//
+// A script is a text file which lists packet files (like the .bin files in
+// this subdirectory), one per line. Blank lines and lines beginning with '#'
+// are ignored. For each line, the tester sends the packet and waits for one
+// response packet; the time between the two is recorded against the
+// command of the sent packet. Interjections work the same way as they do
+// in hwb_tester.c: if a request causes (say) a ButtonRequest, the next line
+// of the script should be button_ack.bin.
+//
+// This uses HIDAPI and POSIX threads. If HIDAPI isn't available, compile
+// with -DNO_HIDAPI to only support emulator instances.
+//
+// This file is licensed as described by the file LICENCE.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <netdb.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#ifndef NO_HIDAPI
+#include "hidapi/hidapi.h"
+#endif // #ifndef NO_HIDAPI
+
+// Vendor ID of target device. This must match the vendor ID in the
+// device's device descriptor.
+#define TARGET_VID				0x04f3
+// Product ID of target device. This must match the product ID in the
+// device's device descriptor.
+#define TARGET_PID				0x0210
+// Maximum packet length to accept before program suspects the packet is
+// garbled.
+#define PACKET_LENGTH_LIMIT		1000000
+// Maximum number of devices which can be tested at once.
+#define MAX_DEVICES				64
+// Number of different command numbers (see packetCommandToText()).
+#define NUM_COMMANDS			65536
+
+// Types of connection to a device.
+typedef enum ConnectionTypeEnum
+{
+	CONNECTION_HID,
+	CONNECTION_SOCKET
+} ConnectionType;
+
+// One device being tested, along with everything its thread measures.
+typedef struct DeviceStruct
+{
+	// Human-readable description of the device, for reports.
+	char name[256];
+	ConnectionType type;
+#ifndef NO_HIDAPI
+	// HIDAPI path of the device (if type is CONNECTION_HID).
+	char *hid_path;
+	hid_device *hid;
+#endif // #ifndef NO_HIDAPI
+	// TCP "host:port" or UNIX-domain socket path (if type is
+	// CONNECTION_SOCKET).
+	char *address;
+	int fd;
+	// Latencies in microseconds, in the order they were measured.
+	double *latencies;
+	// Command number of the request which each entry of latencies is for.
+	uint16_t *commands;
+	unsigned int num_latencies;
+	// Number of responses which were Failure packets.
+	unsigned int num_failures;
+	// Non-zero if the thread gave up because of an I/O error.
+	int failed;
+	pthread_t thread;
+} Device;
+
+// One packet from the script.
+typedef struct ScriptEntryStruct
+{
+	uint8_t *data;
+	uint32_t length;
+	uint16_t command;
+} ScriptEntry;
+
+static Device devices[MAX_DEVICES];
+static unsigned int num_devices;
+static ScriptEntry *script;
+static unsigned int script_length;
+// Number of times each thread will run through the script.
+static unsigned int iterations = 1;
+
+// Read a 32-bit unsigned integer from the byte array specified by in.
+// The bytes will be read in a big-endian format.
+static uint32_t readU32BigEndian(uint8_t *in)
+{
+	return ((uint32_t)in[0] << 24)
+		| ((uint32_t)in[1] << 16)
+		| ((uint32_t)in[2] << 8)
+		| ((uint32_t)in[3]);
+}
+
+// Convert command number into text string
+static char *packetCommandToText(int command)
+{
+	switch (command)
+	{
+	case 0x00:
+		return "Ping";
+	case 0x04:
+		return "NewWallet";
+	case 0x05:
+		return "NewAddress";
+	case 0x06:
+		return "GetNumberOfAddresses";
+	case 0x09:
+		return "GetAddressAndPublicKey";
+	case 0x0a:
+		return "SignTransaction";
+	case 0x0b:
+		return "LoadWallet";
+	case 0x0d:
+		return "FormatWalletArea";
+	case 0x0e:
+		return "ChangeEncryptionKey";
+	case 0x0f:
+		return "ChangeWalletName";
+	case 0x10:
+		return "ListWallets";
+	case 0x11:
+		return "BackupWallet";
+	case 0x12:
+		return "RestoreWallet";
+	case 0x13:
+		return "GetDeviceUUID";
+	case 0x14:
+		return "GetEntropy";
+	case 0x15:
+		return "GetMasterPublicKey";
+	case 0x16:
+		return "DeleteWallet";
+	case 0x17:
+		return "Initialize";
+	case 0x51:
+		return "ButtonAck";
+	case 0x52:
+		return "ButtonCancel";
+	case 0x54:
+		return "PinAck";
+	case 0x55:
+		return "PinCancel";
+	case 0x57:
+		return "OtpAck";
+	case 0x58:
+		return "OtpCancel";
+	default:
+		return "unknown";
+	}
+}
+
+// Get the current time, in microseconds.
+static double getMicroseconds(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)now.tv_sec * 1000000.0 + (double)now.tv_nsec / 1000.0;
+}
+
+// Connect to an emulator instance. address is either "host:port" (for TCP)
+// or a path containing a '/' (for a UNIX-domain socket). Returns the
+// connected socket, or -1 on error.
+static int connectSocket(char *address)
+{
+	struct sockaddr_un un_address;
+	struct addrinfo hints;
+	struct addrinfo *result;
+	char host[256];
+	char *colon;
+	int fd;
+	int one;
+
+	if (strchr(address, '/') != NULL)
+	{
+		if (strlen(address) >= sizeof(un_address.sun_path))
+		{
+			return -1;
+		}
+		fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (fd < 0)
+		{
+			return -1;
+		}
+		memset(&un_address, 0, sizeof(un_address));
+		un_address.sun_family = AF_UNIX;
+		strcpy(un_address.sun_path, address);
+		if (connect(fd, (struct sockaddr *)&un_address, sizeof(un_address)) != 0)
+		{
+			close(fd);
+			return -1;
+		}
+		return fd;
+	}
+
+	colon = strrchr(address, ':');
+	if ((colon == NULL) || ((size_t)(colon - address) >= sizeof(host)))
+	{
+		return -1;
+	}
+	memcpy(host, address, colon - address);
+	host[colon - address] = '\0';
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	if (getaddrinfo(host, colon + 1, &hints, &result) != 0)
+	{
+		return -1;
+	}
+	fd = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
+	if ((fd >= 0) && (connect(fd, result->ai_addr, result->ai_addrlen) != 0))
+	{
+		close(fd);
+		fd = -1;
+	}
+	freeaddrinfo(result);
+	if (fd >= 0)
+	{
+		one = 1;
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	}
+	return fd;
+}
+
+// Send the byte array specified by buffer (which is length bytes long) to
+// a device. Returns 0 on success, non-zero on error.
+static int sendBytes(Device *device, uint8_t *buffer, unsigned int length)
+{
+	ssize_t r;
+#ifndef NO_HIDAPI
+	uint8_t packet_buffer[64];
+	unsigned int data_size;
+
+	if (device->type == CONNECTION_HID)
+	{
+		// Split the bytes into HID reports, like hwb_tester.c does.
+		while (length > 0)
+		{
+			data_size = length;
+			if (data_size > 63)
+			{
+				data_size = 63;
+			}
+			packet_buffer[0] = (uint8_t)data_size; // report ID
+			memcpy(&(packet_buffer[1]), buffer, data_size);
+			if (hid_write(device->hid, packet_buffer, data_size + 1) < 0)
+			{
+				return 1;
+			}
+			buffer += data_size;
+			length -= data_size;
+		}
+		return 0;
+	}
+#endif // #ifndef NO_HIDAPI
+	while (length > 0)
+	{
+		r = send(device->fd, buffer, length, MSG_NOSIGNAL);
+		if (r < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			return 1;
+		}
+		buffer += r;
+		length -= (unsigned int)r;
+	}
+	return 0;
+}
+
+// Receive up to max_length bytes from a device, waiting until at least one
+// byte is available. Returns the number of bytes received, or -1 on error.
+static int receiveSomeBytes(Device *device, uint8_t *buffer, unsigned int max_length)
+{
+	ssize_t r;
+#ifndef NO_HIDAPI
+	uint8_t packet_buffer[64];
+	unsigned int data_size;
+
+	if (device->type == CONNECTION_HID)
+	{
+		// Every report is received whole, so max_length must be at least
+		// 63 (see receivePacket()).
+		do
+		{
+			if (hid_read(device->hid, packet_buffer, sizeof(packet_buffer)) < 0)
+			{
+				return -1;
+			}
+			data_size = packet_buffer[0]; // report ID
+		} while (data_size == 0);
+		if ((data_size > 63) || (data_size > max_length))
+		{
+			return -1;
+		}
+		memcpy(buffer, &(packet_buffer[1]), data_size);
+		return (int)data_size;
+	}
+#endif // #ifndef NO_HIDAPI
+	do
+	{
+		r = recv(device->fd, buffer, max_length, 0);
+	} while ((r < 0) && (errno == EINTR));
+	if (r <= 0)
+	{
+		return -1;
+	}
+	return (int)r;
+}
+
+// Receive one packet from a device. The packet header is checked, but
+// the payload is thrown away. Returns the packet's command number, or -1
+// on error.
+static int receivePacket(Device *device)
+{
+	uint8_t buffer[4096];
+	uint8_t header[8];
+	uint32_t header_bytes;
+	uint32_t received_bytes;
+	uint32_t target_length;
+	uint32_t wanted;
+	uint32_t from_buffer;
+	int r;
+
+	header_bytes = 0;
+	received_bytes = 0;
+	target_length = PACKET_LENGTH_LIMIT;
+	while (received_bytes < target_length)
+	{
+		// HID reports can't be split, so always ask for at least one
+		// report's worth; sockets aren't asked for more than the rest of
+		// the packet (so that pipelined responses wouldn't get mixed up).
+		wanted = target_length - received_bytes;
+		if ((device->type == CONNECTION_HID) && (wanted < 63))
+		{
+			wanted = 63;
+		}
+		if (wanted > sizeof(buffer))
+		{
+			wanted = sizeof(buffer);
+		}
+		r = receiveSomeBytes(device, buffer, wanted);
+		if (r < 0)
+		{
+			return -1;
+		}
+		if ((received_bytes + (uint32_t)r) > target_length)
+		{
+			fprintf(stderr, "%s: received more bytes than the packet length\n", device->name);
+			return -1;
+		}
+		if (header_bytes < 8)
+		{
+			from_buffer = 8 - header_bytes;
+			if (from_buffer > (uint32_t)r)
+			{
+				from_buffer = (uint32_t)r;
+			}
+			memcpy(&(header[header_bytes]), buffer, from_buffer);
+			header_bytes += from_buffer;
+			if (header_bytes == 8)
+			{
+				if ((header[0] != '#') || (header[1] != '#'))
+				{
+					fprintf(stderr, "%s: got bad magic bytes: %02x%02x\n", device->name, header[0], header[1]);
+					return -1;
+				}
+				target_length = readU32BigEndian(&(header[4])) + 8;
+				if (target_length > PACKET_LENGTH_LIMIT)
+				{
+					fprintf(stderr, "%s: got absurdly large packet length of %u\n", device->name, target_length);
+					return -1;
+				}
+			}
+		}
+		received_bytes += (uint32_t)r;
+	}
+	return (int)(((uint16_t)header[2] << 8) | ((uint16_t)header[3]));
+}
+
+// Thread which runs the script against one device.
+static void *deviceThread(void *arg)
+{
+	Device *device;
+	unsigned int i;
+	unsigned int j;
+	double start;
+	int response;
+
+	device = (Device *)arg;
+	device->latencies = malloc(iterations * script_length * sizeof(double));
+	device->commands = malloc(iterations * script_length * sizeof(uint16_t));
+	if ((device->latencies == NULL) || (device->commands == NULL))
+	{
+		device->failed = 1;
+		return NULL;
+	}
+	for (i = 0; i < iterations; i++)
+	{
+		for (j = 0; j < script_length; j++)
+		{
+			start = getMicroseconds();
+			if (sendBytes(device, script[j].data, script[j].length))
+			{
+				fprintf(stderr, "%s: send failed\n", device->name);
+				device->failed = 1;
+				return NULL;
+			}
+			response = receivePacket(device);
+			if (response < 0)
+			{
+				fprintf(stderr, "%s: receive failed\n", device->name);
+				device->failed = 1;
+				return NULL;
+			}
+			device->latencies[device->num_latencies] = getMicroseconds() - start;
+			device->commands[device->num_latencies] = script[j].command;
+			device->num_latencies++;
+			if (response == 0x35) // Failure
+			{
+				device->num_failures++;
+			}
+		}
+	}
+	return NULL;
+}
+
+// Load a script and every packet file it refers to. Returns 0 on success,
+// non-zero on error.
+static int loadScript(char *filename)
+{
+	FILE *script_file;
+	FILE *packet_file;
+	char line[512];
+	char *end;
+	long int size;
+	ScriptEntry *entry;
+
+	script_file = fopen(filename, "r");
+	if (script_file == NULL)
+	{
+		fprintf(stderr, "Couldn't open script \"%s\"\n", filename);
+		return 1;
+	}
+	while (fgets(line, sizeof(line), script_file) != NULL)
+	{
+		end = line + strlen(line);
+		while ((end > line) && ((end[-1] == '\n') || (end[-1] == '\r') || (end[-1] == ' ')))
+		{
+			end--;
+		}
+		*end = '\0';
+		if ((line[0] == '\0') || (line[0] == '#'))
+		{
+			continue;
+		}
+		packet_file = fopen(line, "rb");
+		if (packet_file == NULL)
+		{
+			fprintf(stderr, "Couldn't open packet file \"%s\"\n", line);
+			fclose(script_file);
+			return 1;
+		}
+		script = realloc(script, (script_length + 1) * sizeof(ScriptEntry));
+		entry = &(script[script_length]);
+		fseek(packet_file, 0, SEEK_END);
+		size = ftell(packet_file);
+		fseek(packet_file, 0, SEEK_SET);
+		if (size < 8)
+		{
+			fprintf(stderr, "Packet file \"%s\" is too short\n", line);
+			fclose(packet_file);
+			fclose(script_file);
+			return 1;
+		}
+		entry->data = malloc(size);
+		fread(entry->data, size, 1, packet_file);
+		fclose(packet_file);
+		entry->length = (uint32_t)size;
+		entry->command = (uint16_t)(((uint16_t)entry->data[2] << 8) | ((uint16_t)entry->data[3]));
+		script_length++;
+	}
+	fclose(script_file);
+	if (script_length == 0)
+	{
+		fprintf(stderr, "Script \"%s\" has no packets in it\n", filename);
+		return 1;
+	}
+	return 0;
+}
+
+// Comparison function for qsort(), which sorts doubles in ascending order.
+static int compareDoubles(const void *a, const void *b)
+{
+	double x = *(const double *)a;
+	double y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+// Get a percentile (0 to 100) of a sorted array of count latencies.
+static double percentile(double *sorted, unsigned int count, double p)
+{
+	unsigned int index;
+
+	index = (unsigned int)((p / 100.0) * (double)(count - 1) + 0.5);
+	return sorted[index];
+}
+
+// Print latency percentiles for each command, and throughput for each
+// device and for all devices together.
+static void printReport(double elapsed)
+{
+	static unsigned int seen[NUM_COMMANDS];
+	double *sorted;
+	unsigned int total;
+	unsigned int count;
+	unsigned int command;
+	unsigned int i;
+	unsigned int j;
+
+	total = 0;
+	for (i = 0; i < num_devices; i++)
+	{
+		total += devices[i].num_latencies;
+	}
+	sorted = malloc((total + 1) * sizeof(double));
+
+	printf("%-24s %8s %10s %10s %10s %10s\n", "Command", "Count", "p50 (us)", "p90 (us)", "p99 (us)", "max (us)");
+	for (i = 0; i < script_length; i++)
+	{
+		command = script[i].command;
+		if (seen[command])
+		{
+			continue;
+		}
+		seen[command] = 1;
+		count = 0;
+		for (j = 0; j < num_devices; j++)
+		{
+			unsigned int k;
+
+			for (k = 0; k < devices[j].num_latencies; k++)
+			{
+				if (devices[j].commands[k] == command)
+				{
+					sorted[count++] = devices[j].latencies[k];
+				}
+			}
+		}
+		if (count == 0)
+		{
+			continue;
+		}
+		qsort(sorted, count, sizeof(double), compareDoubles);
+		printf("%-24s %8u %10.0f %10.0f %10.0f %10.0f\n", packetCommandToText(command), count,
+			percentile(sorted, count, 50.0), percentile(sorted, count, 90.0),
+			percentile(sorted, count, 99.0), sorted[count - 1]);
+	}
+	free(sorted);
+
+	printf("\n");
+	for (i = 0; i < num_devices; i++)
+	{
+		printf("%s: %u requests, %u failures%s\n", devices[i].name, devices[i].num_latencies,
+			devices[i].num_failures, devices[i].failed ? " (stopped early because of an error)" : "");
+	}
+	printf("Total: %u requests in %.3f s (%.1f requests/s)\n", total, elapsed / 1000000.0,
+		(double)total / (elapsed / 1000000.0));
+}
+
+// Print command-line usage information.
+static void printUsage(char *program_name)
+{
+	fprintf(stderr, "Usage: %s [-n iterations] [-s address]... [-h count] script\n", program_name);
+	fprintf(stderr, "  -n iterations  Run through the script this many times per device (default: 1)\n");
+	fprintf(stderr, "  -s address     Test an emulator instance at \"host:port\" or a UNIX socket path\n");
+#ifndef NO_HIDAPI
+	fprintf(stderr, "  -h count       Test up to this many USB HID devices (0 means all of them)\n");
+#endif // #ifndef NO_HIDAPI
+}
+
+int main(int argc, char **argv)
+{
+	int option;
+	unsigned int i;
+	double start;
+	Device *device;
+#ifndef NO_HIDAPI
+	int use_hid;
+	unsigned int max_hid_devices;
+	struct hid_device_info *hid_devices;
+	struct hid_device_info *current;
+	unsigned int hid_count;
+#endif // #ifndef NO_HIDAPI
+
+#ifndef NO_HIDAPI
+	use_hid = 0;
+	max_hid_devices = 0;
+#endif // #ifndef NO_HIDAPI
+	while ((option = getopt(argc, argv, "n:s:h:")) != -1)
+	{
+		switch (option)
+		{
+		case 'n':
+			iterations = (unsigned int)atoi(optarg);
+			break;
+		case 's':
+			if (num_devices >= MAX_DEVICES)
+			{
+				fprintf(stderr, "Too many devices\n");
+				exit(1);
+			}
+			device = &(devices[num_devices++]);
+			device->type = CONNECTION_SOCKET;
+			device->address = optarg;
+			snprintf(device->name, sizeof(device->name), "emulator %s", optarg);
+			break;
+#ifndef NO_HIDAPI
+		case 'h':
+			use_hid = 1;
+			max_hid_devices = (unsigned int)atoi(optarg);
+			break;
+#endif // #ifndef NO_HIDAPI
+		default:
+			printUsage(argv[0]);
+			exit(1);
+		}
+	}
+	if (optind != (argc - 1))
+	{
+		printUsage(argv[0]);
+		exit(1);
+	}
+	if (loadScript(argv[optind]))
+	{
+		exit(1);
+	}
+
+#ifndef NO_HIDAPI
+	if (use_hid)
+	{
+		if (hid_init())
+		{
+			fprintf(stderr, "hid_init() failed\n");
+			exit(1);
+		}
+		hid_devices = hid_enumerate(TARGET_VID, TARGET_PID);
+		hid_count = 0;
+		for (current = hid_devices; current != NULL; current = current->next)
+		{
+			if ((num_devices >= MAX_DEVICES) || ((max_hid_devices != 0) && (hid_count >= max_hid_devices)))
+			{
+				break;
+			}
+			device = &(devices[num_devices++]);
+			device->type = CONNECTION_HID;
+			device->hid_path = strdup(current->path);
+			snprintf(device->name, sizeof(device->name), "HID %s", current->path);
+			hid_count++;
+		}
+		hid_free_enumeration(hid_devices);
+	}
+#endif // #ifndef NO_HIDAPI
+	if (num_devices == 0)
+	{
+		fprintf(stderr, "No devices to test\n");
+		exit(1);
+	}
+
+	// Open everything before starting any threads, so that connection
+	// setup isn't included in the timing.
+	for (i = 0; i < num_devices; i++)
+	{
+		device = &(devices[i]);
+#ifndef NO_HIDAPI
+		if (device->type == CONNECTION_HID)
+		{
+			device->hid = hid_open_path(device->hid_path);
+			if (device->hid == NULL)
+			{
+				fprintf(stderr, "Unable to open %s (are you running this as root?)\n", device->name);
+				exit(1);
+			}
+			continue;
+		}
+#endif // #ifndef NO_HIDAPI
+		device->fd = connectSocket(device->address);
+		if (device->fd < 0)
+		{
+			fprintf(stderr, "Unable to connect to %s\n", device->name);
+			exit(1);
+		}
+	}
+
+	start = getMicroseconds();
+	for (i = 0; i < num_devices; i++)
+	{
+		if (pthread_create(&(devices[i].thread), NULL, deviceThread, &(devices[i])) != 0)
+		{
+			fprintf(stderr, "Unable to create thread for %s\n", devices[i].name);
+			exit(1);
+		}
+	}
+	for (i = 0; i < num_devices; i++)
+	{
+		pthread_join(devices[i].thread, NULL);
+	}
+	printReport(getMicroseconds() - start);
+
+	for (i = 0; i < num_devices; i++)
+	{
+#ifndef NO_HIDAPI
+		if (devices[i].type == CONNECTION_HID)
+		{
+			hid_close(devices[i].hid);
+			continue;
+		}
+#endif // #ifndef NO_HIDAPI
+		close(devices[i].fd);
+	}
+#ifndef NO_HIDAPI
+	if (use_hid)
+	{
+		// Free static HIDAPI objects.
+		hid_exit();
+	}
+#endif // #ifndef NO_HIDAPI
+	exit(0);
+}
@@ -7,6 +7,13 @@
 // The tests will take about half an hour and will stress the flash with on
 // the order of 1000 erase-program cycles.
 //
+// If run with "bench" (see the usage message), this instead benchmarks
+// sequential and random reads and writes, writes which straddle block
+// boundaries, flush-heavy workloads and encrypted (XEX) access. The device
+// times each operation itself, so the reported throughput and latency
+// percentiles don't include USB overhead. This is useful for comparing
+// changes to nvmem_manager.c and sst25x.c on real boards.
+//
 // Based on hidtest.cpp by Alan Ott (Signal 11 Software).
 //
 // This file is licensed as described by the file LICENCE.
@@ -15,6 +22,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <time.h>
 #include "hidapi/hidapi.h"
 
 // Vendor ID of target device. This must match the vendor ID in the
@@ -23,11 +31,22 @@
 // Product ID of target device. This must match the product ID in the
 // device's device descriptor.
 #define TARGET_PID			0x0210
-// Area in non-volatile storage to test. This is lower than the actual size
-// so that testing is faster.
+// Largest area in non-volatile storage to test. The area actually tested is
+// the smaller of this and the size of TEST_PARTITION.
 #define NV_MEMORY_SIZE		131072
 // Maximum length of any read/write.
 #define MAX_LENGTH			16384
+// Partition to test. This must match one of the values of NVPartitions in
+// ../../hwinterface.h; 1 is PARTITION_ACCOUNTS, the largest partition.
+#define TEST_PARTITION		1
+// Clock frequency of the device, in Hz. This must match CYCLES_PER_SECOND in
+// ../pic32_system.h.
+#define CPU_FREQUENCY		72000000.0
+// Default number of operations per pattern in benchmark mode.
+#define DEFAULT_BENCH_OPERATIONS	1000
+// Size, in bytes, of the blocks that nvmem_manager.c divides non-volatile
+// memory into. This must match LOG_BLOCK_SIZE in ../nvmem_manager.c.
+#define BLOCK_SIZE			64
 
 // Handle to HID device, so that it doesn't have to be passed as a parameter
 // all the time.
@@ -35,6 +54,8 @@ static hid_device *handle;
 
 // What this program thinks are the contents of non-volatile memory.
 static uint8_t nv_mem_contents[NV_MEMORY_SIZE];
+// Size of the area being tested.
+static uint32_t test_size;
 
 // Send the byte array specified by buffer (which is length bytes long) by
 // splitting it into HID reports and sending those reports.
@@ -108,27 +129,40 @@ static void writeU32LittleEndian(uint8_t *out, uint32_t in)
 	out[3] = (uint8_t)(in >> 24);
 }
 
+// Read 32 bit unsigned integer from a byte array in little-endian format.
+static uint32_t readU32LittleEndian(uint8_t *in)
+{
+	return ((uint32_t)in[0])
+		| ((uint32_t)in[1] << 8)
+		| ((uint32_t)in[2] << 16)
+		| ((uint32_t)in[3] << 24);
+}
+
+// Send the header of a read or write operation to the DUT. operation is 0x00
+// for nonVolatileRead(), 0x01 for nonVolatileWrite(), 0x03 for
+// encryptedNonVolatileRead() or 0x04 for encryptedNonVolatileWrite().
+static void sendOperationHeader(uint8_t operation, uint32_t address, uint32_t length)
+{
+	uint8_t buffer[10];
+
+	buffer[0] = operation;
+	buffer[1] = TEST_PARTITION;
+	writeU32LittleEndian(&(buffer[2]), address);
+	writeU32LittleEndian(&(buffer[6]), length);
+	sendBytes(buffer, 10);
+}
+
 // Tell DUT to call nonVolatileWrite().
 static void nonVolatileWrite(uint8_t *data, uint32_t address, uint32_t length)
 {
-	uint8_t buffer[4];
-
-	buffer[0] = 0x01; // write
-	writeU32LittleEndian(&(buffer[1]), address);
-	writeU32LittleEndian(&(buffer[5]), length);
-	sendBytes(buffer, 9);
+	sendOperationHeader(0x01, address, length);
 	sendBytes(data, length);
 }
 
 // Tell DUT to call nonVolatileRead().
 static void nonVolatileRead(uint8_t *data, uint32_t address, uint32_t length)
 {
-	uint8_t buffer[4];
-
-	buffer[0] = 0x00; // read
-	writeU32LittleEndian(&(buffer[1]), address);
-	writeU32LittleEndian(&(buffer[5]), length);
-	sendBytes(buffer, 9);
+	sendOperationHeader(0x00, address, length);
 	receiveBytes(data, length);
 }
 
@@ -141,6 +175,70 @@ static void nonVolatileFlush(void)
 	sendBytes(buffer, 1);
 }
 
+// Tell DUT to call encryptedNonVolatileWrite().
+static void encryptedNonVolatileWrite(uint8_t *data, uint32_t address, uint32_t length)
+{
+	sendOperationHeader(0x04, address, length);
+	sendBytes(data, length);
+}
+
+// Tell DUT to call encryptedNonVolatileRead().
+static void encryptedNonVolatileRead(uint8_t *data, uint32_t address, uint32_t length)
+{
+	sendOperationHeader(0x03, address, length);
+	receiveBytes(data, length);
+}
+
+// Tell DUT to call setEncryptionKey() with a 32 byte key.
+static void setEncryptionKey(uint8_t *key)
+{
+	uint8_t buffer[33];
+
+	buffer[0] = 0x05; // set encryption key
+	memcpy(&(buffer[1]), key, 32);
+	sendBytes(buffer, 33);
+}
+
+// Ask DUT for the size of TEST_PARTITION. Returns 0 if the DUT doesn't
+// know about that partition.
+static uint32_t getPartitionSize(void)
+{
+	uint8_t buffer[4];
+
+	buffer[0] = 0x06; // get partition size
+	buffer[1] = TEST_PARTITION;
+	sendBytes(buffer, 2);
+	receiveBytes(buffer, 4);
+	return readU32LittleEndian(buffer);
+}
+
+// Ask DUT for the result of the most recent read, write or flush. The
+// return value (a NonVolatileReturn; 0 means success) is written to
+// out_status and the number of CPU cycles it took is written to out_cycles.
+static void getLastResult(uint8_t *out_status, uint32_t *out_cycles)
+{
+	uint8_t buffer[5];
+
+	buffer[0] = 0x07; // get status and cycle count
+	sendBytes(buffer, 1);
+	receiveBytes(buffer, 5);
+	*out_status = buffer[0];
+	*out_cycles = readU32LittleEndian(&(buffer[1]));
+}
+
+// Check that the most recent read, write or flush succeeded.
+static void checkLastResult(const char *operation, uint32_t address, uint32_t length)
+{
+	uint8_t status;
+	uint32_t cycles;
+
+	getLastResult(&status, &cycles);
+	if (status != 0)
+	{
+		printf("%s failed (%u), address = %u, length = %u\n", operation, (unsigned int)status, address, length);
+	}
+}
+
 // Write specified area with random test data, updating nv_mem_contents
 // as well.
 static void testNonVolatileWrite(uint32_t address, uint32_t length)
@@ -158,6 +256,7 @@ static void testNonVolatileWrite(uint32_t address, uint32_t length)
 		data[i] = (uint8_t)rand();
 	}
 	nonVolatileWrite(data, address, length);
+	checkLastResult("Write", address, length);
 	memcpy(&(nv_mem_contents[address]), data, length);
 }
 
@@ -172,6 +271,7 @@ static void testNonVolatileRead(uint32_t address, uint32_t length)
 		exit(1);
 	}
 	nonVolatileRead(data, address, length);
+	checkLastResult("Read", address, length);
 	if (memcmp(&(nv_mem_contents[address]), data, length))
 	{
 		printf("Memory contents mismatch, address = %u, length = %u", address, length);
@@ -182,20 +282,266 @@ static void testNonVolatileRead(uint32_t address, uint32_t length)
 // This tests read, write and flush for the specified address/length.
 static void writeAndReadCycle(uint32_t address, uint32_t length)
 {
+	if ((address + length) > test_size)
+	{
+		printf("Skipping test at address = %u, length = %u; it doesn't fit in the partition\n", address, length);
+		return;
+	}
 	testNonVolatileWrite(address, length);
 	testNonVolatileRead(address, length);
 	testNonVolatileWrite(address, length);
 	nonVolatileFlush();
+	checkLastResult("Flush", address, length);
 	testNonVolatileRead(address, length);
 }
 
-int main(void)
+// Kinds of operation which can be benchmarked.
+typedef enum BenchKindEnum
+{
+	// nonVolatileRead().
+	BENCH_READ,
+	// nonVolatileWrite().
+	BENCH_WRITE,
+	// nonVolatileWrite() then nonVolatileFlush(), timed together.
+	BENCH_WRITE_FLUSH,
+	// encryptedNonVolatileRead().
+	BENCH_ENCRYPTED_READ,
+	// encryptedNonVolatileWrite().
+	BENCH_ENCRYPTED_WRITE
+} BenchKind;
+
+// How addresses are chosen for a benchmark pattern.
+typedef enum BenchAddressingEnum
+{
+	// One operation after another, wrapping around at the end of the area.
+	ADDRESS_SEQUENTIAL,
+	// Random, aligned to the operation length.
+	ADDRESS_RANDOM,
+	// Random, but always straddling a BLOCK_SIZE boundary.
+	ADDRESS_CROSSING
+} BenchAddressing;
+
+// A benchmark pattern.
+typedef struct BenchPattern_struct
+{
+	// Name, as it appears in the report.
+	const char *name;
+	// What kind of operation to do.
+	BenchKind kind;
+	// How addresses are chosen.
+	BenchAddressing addressing;
+	// Number of bytes read or written by each operation.
+	uint32_t length;
+} BenchPattern;
+
+// The patterns which benchmark mode runs, in order. Writes are always
+// followed by a flush (which is included in the throughput, but is not an
+// operation), so that buffered writes aren't counted as free.
+static const BenchPattern bench_patterns[] = {
+	{"sequential read 16", BENCH_READ, ADDRESS_SEQUENTIAL, 16},
+	{"sequential read 1024", BENCH_READ, ADDRESS_SEQUENTIAL, 1024},
+	{"random read 16", BENCH_READ, ADDRESS_RANDOM, 16},
+	{"sequential write 16", BENCH_WRITE, ADDRESS_SEQUENTIAL, 16},
+	{"sequential write 1024", BENCH_WRITE, ADDRESS_SEQUENTIAL, 1024},
+	{"random write 16", BENCH_WRITE, ADDRESS_RANDOM, 16},
+	{"block-crossing write 16", BENCH_WRITE, ADDRESS_CROSSING, 16},
+	{"random write+flush 16", BENCH_WRITE_FLUSH, ADDRESS_RANDOM, 16},
+	{"encrypted read 32", BENCH_ENCRYPTED_READ, ADDRESS_RANDOM, 32},
+	{"encrypted write 32", BENCH_ENCRYPTED_WRITE, ADDRESS_RANDOM, 32}};
+
+// Comparison function for qsort(), which sorts doubles in ascending order.
+static int compareDoubles(const void *a, const void *b)
+{
+	double x = *(const double *)a;
+	double y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+// Get a percentile (0 to 100) of a sorted array of count latencies.
+static double percentile(double *sorted, unsigned int count, double p)
+{
+	unsigned int index;
+
+	index = (unsigned int)((p / 100.0) * (double)(count - 1) + 0.5);
+	return sorted[index];
+}
+
+// Choose the address for operation number i of pattern.
+static uint32_t benchAddress(const BenchPattern *pattern, unsigned int i)
+{
+	uint32_t slots;
+
+	if (pattern->addressing == ADDRESS_SEQUENTIAL)
+	{
+		slots = test_size / pattern->length;
+		return (i % slots) * pattern->length;
+	}
+	else if (pattern->addressing == ADDRESS_RANDOM)
+	{
+		slots = test_size / pattern->length;
+		return ((uint32_t)rand() % slots) * pattern->length;
+	}
+	else
+	{
+		// Pick one of the block boundaries after the first, then start half
+		// of the operation before it.
+		slots = test_size / BLOCK_SIZE - 1;
+		return (((uint32_t)rand() % slots) + 1) * BLOCK_SIZE - pattern->length / 2;
+	}
+}
+
+// Do one operation of pattern at address, returning the number of CPU
+// cycles the device took. Increments *errors if the device reported a
+// failure.
+static uint32_t benchOperation(const BenchPattern *pattern, uint8_t *data, uint32_t address, unsigned int *errors)
+{
+	uint8_t status;
+	uint32_t cycles;
+	uint32_t flush_cycles;
+
+	switch (pattern->kind)
+	{
+	case BENCH_READ:
+		nonVolatileRead(data, address, pattern->length);
+		break;
+	case BENCH_WRITE:
+	case BENCH_WRITE_FLUSH:
+		nonVolatileWrite(data, address, pattern->length);
+		break;
+	case BENCH_ENCRYPTED_READ:
+		encryptedNonVolatileRead(data, address, pattern->length);
+		break;
+	default:
+		encryptedNonVolatileWrite(data, address, pattern->length);
+		break;
+	}
+	getLastResult(&status, &cycles);
+	if (status != 0)
+	{
+		(*errors)++;
+	}
+	if (pattern->kind == BENCH_WRITE_FLUSH)
+	{
+		nonVolatileFlush();
+		getLastResult(&status, &flush_cycles);
+		if (status != 0)
+		{
+			(*errors)++;
+		}
+		cycles += flush_cycles;
+	}
+	return cycles;
+}
+
+// Run every pattern in bench_patterns, doing operations operations of each,
+// and print the throughput and latency percentiles of each. The contents of
+// the tested area are destroyed.
+static void runBenchmark(unsigned int operations)
+{
+	const BenchPattern *pattern;
+	double *latencies;
+	double total_cycles;
+	double seconds;
+	uint8_t status;
+	uint8_t data[1024];
+	uint8_t key[32];
+	uint32_t cycles;
+	unsigned int errors;
+	unsigned int p;
+	unsigned int i;
+
+	latencies = malloc(operations * sizeof(double));
+	if (latencies == NULL)
+	{
+		printf("Could not allocate memory for latencies\n");
+		exit(1);
+	}
+	for (i = 0; i < sizeof(data); i++)
+	{
+		data[i] = (uint8_t)rand();
+	}
+	for (i = 0; i < sizeof(key); i++)
+	{
+		key[i] = (uint8_t)rand();
+	}
+	setEncryptionKey(key);
+
+	printf("Benchmarking %u bytes, %u operations per pattern\n", test_size, operations);
+	printf("%-24s %8s %8s %10s %10s %10s %10s\n", "Pattern", "Errors", "MB/s", "p50 (us)", "p90 (us)", "p99 (us)", "max (us)");
+	for (p = 0; p < (sizeof(bench_patterns) / sizeof(bench_patterns[0])); p++)
+	{
+		pattern = &(bench_patterns[p]);
+		if ((pattern->length > sizeof(data)) || ((pattern->length * 2) > test_size)
+			|| ((pattern->addressing == ADDRESS_CROSSING) && (test_size < (BLOCK_SIZE * 2))))
+		{
+			printf("%-24s skipped; the tested area is too small\n", pattern->name);
+			continue;
+		}
+		errors = 0;
+		total_cycles = 0.0;
+		for (i = 0; i < operations; i++)
+		{
+			cycles = benchOperation(pattern, data, benchAddress(pattern, i), &errors);
+			latencies[i] = (double)cycles * 1000000.0 / CPU_FREQUENCY;
+			total_cycles += (double)cycles;
+		}
+		if ((pattern->kind == BENCH_WRITE) || (pattern->kind == BENCH_ENCRYPTED_WRITE))
+		{
+			// Include the cost of committing the buffered writes.
+			nonVolatileFlush();
+			getLastResult(&status, &cycles);
+			if (status != 0)
+			{
+				errors++;
+			}
+			total_cycles += (double)cycles;
+		}
+		seconds = total_cycles / CPU_FREQUENCY;
+		qsort(latencies, operations, sizeof(double), compareDoubles);
+		printf("%-24s %8u %8.3f %10.1f %10.1f %10.1f %10.1f\n", pattern->name, errors,
+			(seconds > 0.0) ? ((double)operations * (double)pattern->length / seconds / 1000000.0) : 0.0,
+			percentile(latencies, operations, 50.0), percentile(latencies, operations, 90.0),
+			percentile(latencies, operations, 99.0), latencies[operations - 1]);
+	}
+	free(latencies);
+}
+
+int main(int argc, char **argv)
 {
 	uint8_t buffer[1];
 	unsigned int i;
 	int mode;
 	uint32_t address;
 	uint32_t length;
+	uint32_t max_length;
+	unsigned long operations;
+	char *end;
+
+	operations = 0;
+	if (argc > 1)
+	{
+		if (argc == 3)
+		{
+			operations = strtoul(argv[2], &end, 10);
+			if ((*end != '\0') || (operations > 10000000))
+			{
+				operations = 0;
+			}
+		}
+		else if (argc == 2)
+		{
+			operations = DEFAULT_BENCH_OPERATIONS;
+		}
+		if ((strcmp(argv[1], "bench") != 0) || (operations == 0))
+		{
+			printf("Usage: %s [bench [<operations per pattern>]]\n", argv[0]);
+			printf("\n");
+			printf("Without arguments, the correctness tests are run.\n");
+			printf("Example of benchmark mode: %s bench 1000\n", argv[0]);
+			exit(1);
+		}
+	}
 
 	srand(42);
 	if (hid_init())
@@ -216,11 +562,40 @@ int main(void)
 	buffer[0] = 'n';
 	sendBytes(buffer, 1);
 
+	test_size = getPartitionSize();
+	if (test_size == 0)
+	{
+		printf("Device doesn't know about partition %d\n", TEST_PARTITION);
+		exit(1);
+	}
+	if (test_size > NV_MEMORY_SIZE)
+	{
+		test_size = NV_MEMORY_SIZE;
+	}
+	max_length = test_size;
+	if (max_length > MAX_LENGTH)
+	{
+		max_length = MAX_LENGTH;
+	}
+
+	if (operations != 0)
+	{
+		runBenchmark((unsigned int)operations);
+		hid_close(handle);
+		hid_exit();
+		exit(0);
+	}
+
 	// Synchronise nv_mem_contents with actual contents.
 	printf("Reading contents of non-volatile memory...");
-	for (i = 0; i < NV_MEMORY_SIZE; i += 4096)
+	for (i = 0; i < test_size; i += length)
 	{
-		nonVolatileRead(&(nv_mem_contents[i]), i, 4096);
+		length = test_size - i;
+		if (length > 4096)
+		{
+			length = 4096;
+		}
+		nonVolatileRead(&(nv_mem_contents[i]), i, length);
 	}
 	printf("done\n");
 
@@ -258,9 +633,9 @@ int main(void)
 	writeAndReadCycle(0, 0);
 
 	// Maximum length tests.
-	writeAndReadCycle(4096, MAX_LENGTH);
-	writeAndReadCycle(0, MAX_LENGTH);
-	writeAndReadCycle(1, MAX_LENGTH);
+	writeAndReadCycle(4096, max_length);
+	writeAndReadCycle(0, max_length);
+	writeAndReadCycle(1, max_length - 1);
 
 	// Monte Carlo tests. These are supposed to expose any issues related
 	// to write/read cycles which don't use the same address/length. The
@@ -271,9 +646,9 @@ int main(void)
 		mode = rand() % 3;
 		do
 		{
-			address = rand() % NV_MEMORY_SIZE;
-			length = (rand() % MAX_LENGTH) + 1;
-		} while ((address + length) > NV_MEMORY_SIZE);
+			address = rand() % test_size;
+			length = (rand() % max_length) + 1;
+		} while ((address + length) > test_size);
 		if (mode == 0)
 		{
 			testNonVolatileRead(address, length);
@@ -5,6 +5,12 @@
 // This will use both control and interrupt transfers to receive/send reports.
 // The format of reports is described in pic32/usb_hid_stream.c.
 //
+// Test mode "b" benchmarks the transport instead: it measures round trip
+// latency (for a range of message sizes) and loopback bandwidth (for a
+// range of report sizes) through every combination of Interrupt and control
+// ("Get Report"/"Set Report") endpoints, and through the Bulk endpoints if
+// the firmware was built with USB_VENDOR_BULK.
+//
 // This file is licensed as described by the file LICENCE.
 
 #include <stdio.h>
@@ -12,6 +18,7 @@
 #include <string.h>
 #include <stdint.h>
 #include <time.h>
+#include <pthread.h>
 #include <libusb.h>
 
 // Vendor ID of target device. This must match the vendor ID in the
@@ -294,8 +301,11 @@ static void loopbackTests(int num_tests)
 		{
 			// First exhaust all combinations of sending/receiving via.
 			// control endpoint/interrupt endpoint. For the last pass,
-			// randomly choose combinations, checking that the device reacts
-			// to the changes appropriately.
+			// randomly choose how to send, checking that the device reacts
+			// to the changes appropriately. Once the device has seen a "Get
+			// Report" request, it only transmits through the control
+			// endpoint (see pic32/usb_hid_stream.c), so the passes which
+			// receive from the Interrupt IN endpoint must come first.
 			if (pass < 4)
 			{
 				send_to_control = pass & 1;
@@ -304,7 +314,7 @@ static void loopbackTests(int num_tests)
 			else
 			{
 				send_to_control = (unsigned int)rand() & 1;
-				receive_from_control = (unsigned int)rand() & 1;
+				receive_from_control = 1;
 			}
 			// First group of tests exhausts all possible report IDs. After that,
 			// just use random report IDs. Using random report IDs reflects
@@ -485,15 +495,17 @@ static void receiveTests(int num_tests, int do_benchmark)
 		for (i = 1; i < num_tests; i++)
 		{
 			// The first 2 passes exclusively test the use of interrupt and
-			// control endpoints. The last pass switches between them in an
-			// attempt to trigger some race conditions.
+			// control endpoints. The first "Get Report" request switches the
+			// device over to the control endpoint for good (see
+			// pic32/usb_hid_stream.c), so the last pass can't switch between
+			// them any more; it just repeats the control endpoint tests.
 			if (pass < 2)
 			{
 				receive_from_control = pass;
 			}
 			else
 			{
-				receive_from_control = (unsigned int)rand() & 1;
+				receive_from_control = 1;
 			}
 			// First group of tests exhausts all possible report IDs. After that,
 			// just use random report IDs. Using random report IDs reflects
@@ -580,6 +592,453 @@ static void receiveTests(int num_tests, int do_benchmark)
 	} // end for (pass = 0; pass < 3; pass++)
 }
 
+// A combination of endpoints used to get data to and from the device in
+// benchmark mode.
+typedef struct Transport_struct
+{
+	// Name, as it appears in the report.
+	const char *name;
+	// Non-zero = send using "Set Report", zero = send to Interrupt OUT
+	// endpoint (ignored if bulk is non-zero).
+	unsigned int send_to_control;
+	// Non-zero = receive using "Get Report", zero = receive from Interrupt IN
+	// endpoint (ignored if bulk is non-zero).
+	unsigned int receive_from_control;
+	// Non-zero = use the Bulk OUT and Bulk IN endpoints of the
+	// vendor-specific interface.
+	unsigned int bulk;
+} Transport;
+
+// The transports which benchmark mode tests, in order. The "Get Report" ones
+// must come after the "Int IN" ones and Bulk must be last, because once the
+// device has seen a "Get Report" request, it only transmits through the
+// control endpoint, and once it has received something on the Bulk OUT
+// endpoint, it only transmits on the Bulk IN endpoint (see
+// pic32/usb_hid_stream.c).
+static const Transport transports[] = {
+	{"Int OUT / Int IN", 0, 0, 0},
+	{"Set Report / Int IN", 1, 0, 0},
+	{"Int OUT / Get Report", 0, 1, 0},
+	{"Set Report / Get Report", 1, 1, 0},
+	{"Bulk OUT / Bulk IN", 0, 0, 1}};
+
+// Message sizes (in bytes) for the latency benchmark. These must all be
+// small enough to fit in the device's FIFOs, because the whole message is
+// sent before the echo is received.
+static const int latency_sizes[] = {1, 8, 32, 63, 128};
+
+// Chunk sizes (in bytes) for the bandwidth benchmark. Each chunk is sent as
+// one report (or bulk packet); chunks bigger than a transport can handle are
+// skipped.
+static const int bandwidth_sizes[] = {8, 32, 63, 64};
+
+// Number of round trips for each latency measurement.
+#define LATENCY_ROUNDS		200
+// Number of bytes to stream for each bandwidth measurement.
+#define BANDWIDTH_BYTES		65536
+
+// Arguments for bandwidthSender().
+typedef struct BandwidthJob_struct
+{
+	// How to send.
+	const Transport *transport;
+	// Size of each chunk.
+	int chunk_size;
+	// Set to a libusb error code if sending failed.
+	int result;
+} BandwidthJob;
+
+// Get the number of microseconds between two times.
+static double elapsedMicroseconds(struct timespec *start, struct timespec *end)
+{
+	return (double)(end->tv_sec - start->tv_sec) * 1000000.0
+		+ (double)(end->tv_nsec - start->tv_nsec) / 1000.0;
+}
+
+// Comparison function for qsort(), which sorts doubles in ascending order.
+static int compareDoubles(const void *a, const void *b)
+{
+	double x = *(const double *)a;
+	double y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+// Get a percentile (0 to 100) of a sorted array of count latencies.
+static double percentile(double *sorted, unsigned int count, double p)
+{
+	unsigned int index;
+
+	index = (unsigned int)((p / 100.0) * (double)(count - 1) + 0.5);
+	return sorted[index];
+}
+
+// Largest number of bytes which can be sent or received in one report or
+// packet using transport.
+static int maximumChunkSize(const Transport *transport)
+{
+	return transport->bulk ? 64 : 63;
+}
+
+// Send length bytes to the device using transport, splitting them into
+// chunks of at most chunk_size bytes. This is persistent: it will keep trying
+// even if a timeout occurs.
+// Return values: non-negative = success, negative = failure.
+static int sendMessage(const Transport *transport, uint8_t *buffer, int length, int chunk_size)
+{
+	int size;
+	int actual_length;
+	int r;
+
+	while (length > 0)
+	{
+		size = (length < chunk_size) ? length : chunk_size;
+		if (transport->bulk)
+		{
+			do
+			{
+				r = libusb_bulk_transfer(device_handle, 0x04, buffer, size, &actual_length, TIMEOUT);
+			} while (r == LIBUSB_ERROR_TIMEOUT);
+			if ((r >= 0) && (actual_length != size))
+			{
+				printf("Bulk send length mismatch: desired: %d, actual: %d\n", size, actual_length);
+				r = LIBUSB_ERROR_OTHER;
+			}
+		}
+		else
+		{
+			r = sendBytes(buffer, size, transport->send_to_control);
+		}
+		if (r < 0)
+		{
+			return r;
+		}
+		buffer += size;
+		length -= size;
+	}
+	return 0;
+}
+
+// Do one receive from the device using transport, receiving at most
+// max_length bytes. "Get Report" requests ask for exactly
+// min(max_length, chunk_size) bytes; on the Interrupt IN and Bulk IN
+// endpoints, the device chooses how many bytes to send. This is persistent:
+// it will keep trying even if a timeout occurs.
+// actual_length: number of bytes received will be written here.
+// Return values: non-negative = success, negative = failure.
+static int receiveSome(const Transport *transport, uint8_t *buffer, int max_length, int chunk_size, int *actual_length)
+{
+	uint8_t packet_buffer[64];
+	int r;
+
+	*actual_length = 0;
+	if (transport->bulk)
+	{
+		do
+		{
+			r = libusb_bulk_transfer(device_handle, 0x83, packet_buffer, sizeof(packet_buffer), actual_length, TIMEOUT);
+		} while ((r == LIBUSB_ERROR_TIMEOUT) || ((r >= 0) && (*actual_length == 0)));
+		if ((r >= 0) && (*actual_length > max_length))
+		{
+			printf("Bulk packet will overrun buffer.\n");
+			r = LIBUSB_ERROR_OTHER;
+		}
+		if (r >= 0)
+		{
+			memcpy(buffer, packet_buffer, *actual_length);
+		}
+	}
+	else if (transport->receive_from_control)
+	{
+		r = receiveBytes(buffer, (max_length < chunk_size) ? max_length : chunk_size, actual_length, 0, 1);
+	}
+	else
+	{
+		r = receiveBytes(buffer, max_length, actual_length, 1, 0);
+	}
+	return r;
+}
+
+// Receive exactly length bytes from the device using transport (see
+// receiveSome()).
+// Return values: non-negative = success, negative = failure.
+static int receiveMessage(const Transport *transport, uint8_t *buffer, int length, int chunk_size)
+{
+	int actual_length;
+	int r;
+
+	while (length > 0)
+	{
+		r = receiveSome(transport, buffer, length, chunk_size, &actual_length);
+		if (r < 0)
+		{
+			return r;
+		}
+		buffer += actual_length;
+		length -= actual_length;
+	}
+	return 0;
+}
+
+// Ping-pong latency benchmark: send a message, wait for the device to echo
+// it back and time the round trip. This is done LATENCY_ROUNDS times for each
+// message size.
+static void latencyBenchmark(const Transport *transport)
+{
+	uint8_t message[128];
+	uint8_t echo[128];
+	double latencies[LATENCY_ROUNDS];
+	double total;
+	struct timespec start;
+	struct timespec end;
+	unsigned int s;
+	int size;
+	int i;
+	int j;
+	int r;
+
+	for (s = 0; s < (sizeof(latency_sizes) / sizeof(latency_sizes[0])); s++)
+	{
+		size = latency_sizes[s];
+		total = 0.0;
+		for (i = 0; i < LATENCY_ROUNDS; i++)
+		{
+			for (j = 0; j < size; j++)
+			{
+				message[j] = (uint8_t)rand();
+			}
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			r = sendMessage(transport, message, size, maximumChunkSize(transport));
+			if (r >= 0)
+			{
+				r = receiveMessage(transport, echo, size, maximumChunkSize(transport));
+			}
+			clock_gettime(CLOCK_MONOTONIC, &end);
+			if (r < 0)
+			{
+				printf("Error during latency benchmark, %s, size = %d, r = %s\n", transport->name, size, libusb_error_name(r));
+				tests_failed++;
+				return;
+			}
+			if (memcmp(message, echo, size))
+			{
+				printf("Loopback data mismatch during latency benchmark, %s, size = %d\n", transport->name, size);
+				tests_failed++;
+				return;
+			}
+			latencies[i] = elapsedMicroseconds(&start, &end);
+			total += latencies[i];
+		}
+		tests_succeeded++;
+		qsort(latencies, LATENCY_ROUNDS, sizeof(double), compareDoubles);
+		printf("%-24s %5d %10.0f %10.0f %10.0f %10.0f %12.0f\n", transport->name, size,
+			percentile(latencies, LATENCY_ROUNDS, 50.0), percentile(latencies, LATENCY_ROUNDS, 90.0),
+			percentile(latencies, LATENCY_ROUNDS, 99.0), latencies[LATENCY_ROUNDS - 1],
+			(double)size * LATENCY_ROUNDS / (total / 1000000.0));
+	}
+}
+
+// Thread which streams BANDWIDTH_BYTES of an incrementing sequence to the
+// device, while the main thread receives the echo.
+static void *bandwidthSender(void *arg)
+{
+	BandwidthJob *job;
+	uint8_t chunk[64];
+	uint8_t counter;
+	int sent;
+	int size;
+	int j;
+
+	job = (BandwidthJob *)arg;
+	counter = 0;
+	job->result = 0;
+	for (sent = 0; sent < BANDWIDTH_BYTES; sent += size)
+	{
+		size = BANDWIDTH_BYTES - sent;
+		if (size > job->chunk_size)
+		{
+			size = job->chunk_size;
+		}
+		for (j = 0; j < size; j++)
+		{
+			chunk[j] = counter++;
+		}
+		job->result = sendMessage(job->transport, chunk, size, job->chunk_size);
+		if (job->result < 0)
+		{
+			break;
+		}
+	}
+	return NULL;
+}
+
+// Bandwidth benchmark: stream BANDWIDTH_BYTES through the device's loopback
+// and measure how long it takes. Sending happens on a separate thread, so
+// that the device can be sending and receiving at the same time, and the
+// echo is received in whatever sizes the device chooses. The
+// exception is when both directions use the control endpoint; a pending
+// "Get Report" would hold up the "Set Report" it's waiting for, so there the
+// chunks are sent and received alternately.
+static void bandwidthBenchmark(const Transport *transport)
+{
+	uint8_t chunk[64];
+	uint8_t received_data[64];
+	uint8_t expected;
+	BandwidthJob job;
+	pthread_t sender;
+	struct timespec start;
+	struct timespec end;
+	unsigned int s;
+	int half_duplex;
+	int received;
+	int size;
+	int actual_length;
+	int j;
+	int r;
+
+	half_duplex = transport->send_to_control && transport->receive_from_control && !transport->bulk;
+	for (s = 0; s < (sizeof(bandwidth_sizes) / sizeof(bandwidth_sizes[0])); s++)
+	{
+		if (bandwidth_sizes[s] > maximumChunkSize(transport))
+		{
+			continue;
+		}
+		job.transport = transport;
+		job.chunk_size = bandwidth_sizes[s];
+		job.result = 0;
+		expected = 0;
+		r = 0;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		if (!half_duplex)
+		{
+			if (pthread_create(&sender, NULL, &bandwidthSender, &job) != 0)
+			{
+				printf("Could not create sender thread\n");
+				exit(1);
+			}
+		}
+		for (received = 0; received < BANDWIDTH_BYTES; received += actual_length)
+		{
+			size = BANDWIDTH_BYTES - received;
+			if (size > (int)sizeof(received_data))
+			{
+				size = sizeof(received_data);
+			}
+			if (half_duplex)
+			{
+				if (size > job.chunk_size)
+				{
+					size = job.chunk_size;
+				}
+				for (j = 0; j < size; j++)
+				{
+					chunk[j] = (uint8_t)(expected + j);
+				}
+				r = sendMessage(transport, chunk, size, job.chunk_size);
+				if (r < 0)
+				{
+					break;
+				}
+			}
+			r = receiveSome(transport, received_data, size, job.chunk_size, &actual_length);
+			if (r < 0)
+			{
+				break;
+			}
+			for (j = 0; j < actual_length; j++)
+			{
+				if (received_data[j] != expected++)
+				{
+					r = LIBUSB_ERROR_OTHER;
+				}
+			}
+			if (r < 0)
+			{
+				printf("Out of order data during bandwidth benchmark, %s, size = %d\n", transport->name, job.chunk_size);
+				break;
+			}
+		}
+		if (!half_duplex)
+		{
+			if (r < 0)
+			{
+				// The sender thread may be stuck waiting for the device, and
+				// there's no way to recover from here.
+				printf("Error during bandwidth benchmark, %s, size = %d, r = %s\n", transport->name, job.chunk_size, libusb_error_name(r));
+				tests_failed++;
+				return;
+			}
+			pthread_join(sender, NULL);
+			r = job.result;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		if (r < 0)
+		{
+			printf("Error during bandwidth benchmark, %s, size = %d, r = %s\n", transport->name, job.chunk_size, libusb_error_name(r));
+			tests_failed++;
+			return;
+		}
+		tests_succeeded++;
+		printf("%-24s %5d %12.0f%s\n", transport->name, job.chunk_size,
+			(double)BANDWIDTH_BYTES / (elapsedMicroseconds(&start, &end) / 1000000.0),
+			half_duplex ? " (half duplex)" : "");
+	}
+}
+
+// Latency and bandwidth benchmarks for every transport. The device must be
+// in stream loopback mode.
+static void benchmarkTests(void)
+{
+	unsigned int t;
+	unsigned int num_transports;
+
+	num_transports = sizeof(transports) / sizeof(transports[0]);
+	if (libusb_claim_interface(device_handle, 1) != 0)
+	{
+		printf("Device has no vendor-specific interface (firmware wasn't built with\n");
+		printf("USB_VENDOR_BULK), so the bulk endpoints won't be benchmarked.\n");
+		num_transports--;
+	}
+
+	printf("Round trip latency:\n");
+	printf("%-24s %5s %10s %10s %10s %10s %12s\n", "Transport", "Size", "p50 (us)", "p90 (us)", "p99 (us)", "max (us)", "bytes/sec");
+	for (t = 0; t < num_transports; t++)
+	{
+		if (transports[t].bulk)
+		{
+			// Switching to bulk is permanent (until reset), so do it last.
+			break;
+		}
+		latencyBenchmark(&(transports[t]));
+		// Need a delay in between transports, to avoid rapid switching
+		// between endpoints (which could confuse the device).
+		delay();
+	}
+	printf("\nLoopback bandwidth:\n");
+	printf("%-24s %5s %12s\n", "Transport", "Chunk", "bytes/sec");
+	for (t = 0; t < num_transports; t++)
+	{
+		if (transports[t].bulk)
+		{
+			break;
+		}
+		bandwidthBenchmark(&(transports[t]));
+		delay();
+	}
+	for (t = 0; t < num_transports; t++)
+	{
+		if (transports[t].bulk)
+		{
+			printf("\nBulk round trip latency:\n");
+			printf("%-24s %5s %10s %10s %10s %10s %12s\n", "Transport", "Size", "p50 (us)", "p90 (us)", "p99 (us)", "max (us)", "bytes/sec");
+			latencyBenchmark(&(transports[t]));
+			printf("\nBulk loopback bandwidth:\n");
+			printf("%-24s %5s %12s\n", "Transport", "Chunk", "bytes/sec");
+			bandwidthBenchmark(&(transports[t]));
+		}
+	}
+}
+
 int main(void)
 {
 	int r;
@@ -597,6 +1056,7 @@ int main(void)
 	printf("  p: get bytes from device\n");
 	printf("  t: get bytes from device slowly\n");
 	printf("  x: get bytes from device very slowly\n");
+	printf("  b: latency and bandwidth benchmark (uses stream loopback)\n");
 	printf("Note that tests marked \"very slowly\" will run very slowly!\n");
 	printf("?:");
 	mode = getchar();
@@ -616,7 +1076,14 @@ int main(void)
 	libusb_set_configuration(device_handle, 1);
 	libusb_claim_interface(device_handle, 0);
 	buffer[0] = 1;
-	buffer[1] = (uint8_t)mode;
+	if (mode == 'b')
+	{
+		buffer[1] = 'r';
+	}
+	else
+	{
+		buffer[1] = (uint8_t)mode;
+	}
 	r = libusb_interrupt_transfer(device_handle, 0x02, buffer, sizeof(buffer), &actual_length, TIMEOUT);
 	if ((r != 0) || (actual_length != sizeof(buffer)))
 	{
@@ -630,6 +1097,10 @@ int main(void)
 	{
 		loopbackTests(LOOPBACK_TESTS);
 	}
+	else if (mode == 'b')
+	{
+		benchmarkTests();
+	}
 	else if (mode == 'g')
 	{
 		sendTests(SEND_TESTS_FAST, 1);
@@ -13,6 +13,12 @@
   *   enumeration will probably fail.
   * - Are all multi-byte numbers little-endian?
   *
+  * If USB_VENDOR_BULK is defined, the configuration also contains a second,
+  * vendor-specific interface with a Bulk IN/OUT endpoint pair. That interface
+  * carries the same byte stream as the HID interface, but without the
+  * report ID prefix byte and with the much higher bandwidth of bulk
+  * transfers. See usb_hid_stream.c for how the stream is routed.
+  *
   * All references to the "USB specification" refer to revision 2.0, obtained
   * from http://www.usb.org/developers/docs/usb_20_110512.zip (see usb_20.pdf)
   * on 26 March 2012. All references to the "HID specification" refer to
@@ -78,18 +84,29 @@ SERIAL_NO_STRING_INDEX, // index of string descriptor describing serial number
   * 6.2.1 of the HID specification for details on the format of the HID
   * descriptor. Section 7.1 of the HID specification describes the ordering
   * of descriptors (configuration, then interface, then HID, then endpoint).
+  * The optional vendor-specific interface (see USB_VENDOR_BULK) comes after
+  * all the HID interface's descriptors.
   * \showinitializer
   */
 static const uint8_t configuration_descriptor[] = {
 // Configuration descriptor:
 0x09, // length of this descriptor in bytes
 DESCRIPTOR_CONFIGURATION, // descriptor type
+#ifdef USB_VENDOR_BULK
+#ifdef NO_INTERRUPT_OUT
+0x39, 0x00, // total length of all included descriptors in bytes (little-endian)
+#else
+0x40, 0x00, // total length of all included descriptors in bytes (little-endian)
+#endif // #ifdef NO_INTERRUPT_OUT
+0x02, // number of interfaces supported by this configuration
+#else
 #ifdef NO_INTERRUPT_OUT
 0x22, 0x00, // total length of all included descriptors in bytes (little-endian)
 #else
 0x29, 0x00, // total length of all included descriptors in bytes (little-endian)
 #endif // #ifdef NO_INTERRUPT_OUT
 0x01, // number of interfaces supported by this configuration
+#endif // #ifdef USB_VENDOR_BULK
 0x01, // configuration value (must be 1, usb_standard_requests.c assumes this)
 0x00, // index of string descriptor describing configuration (0 = none)
 0x80, // attributes (0x80 = not self-powered, no remote wakeup)
@@ -130,8 +147,34 @@ DESCRIPTOR_ENDPOINT, // descriptor type
 0x02, // endpoint number; bit 7 clear means OUT, endpoint 2
 0x03, // attributes (3 = interrupt transfers)
 0x40, 0x00, // maximum packet size of this endpoint in bytes (little-endian)
-0x01 // polling interval, in millisecond
+0x01, // polling interval, in millisecond
 #endif // #ifndef NO_INTERRUPT_OUT
+#ifdef USB_VENDOR_BULK
+// Vendor-specific interface descriptor:
+0x09, // length of this descriptor in bytes
+DESCRIPTOR_INTERFACE, // descriptor type
+0x01, // number of this interface (1 = second)
+0x00, // alternate setting (0 = default)
+0x02, // number of endpoints used by this interface, not including control endpoint
+0xff, // interface class (0xff = vendor-specific)
+0x00, // interface subclass (0 = no subclass)
+0x00, // interface protocol (0 = none)
+0x00, // index of string descriptor describing interface (0 = none)
+// Endpoint 3 descriptor:
+0x07, // length of this descriptor in bytes
+DESCRIPTOR_ENDPOINT, // descriptor type
+0x83, // endpoint number; bit 7 set means IN, endpoint 3
+0x02, // attributes (2 = bulk transfers)
+0x40, 0x00, // maximum packet size of this endpoint in bytes (little-endian)
+0x00, // polling interval (ignored for bulk endpoints)
+// Endpoint 4 descriptor:
+0x07, // length of this descriptor in bytes
+DESCRIPTOR_ENDPOINT, // descriptor type
+0x04, // endpoint number; bit 7 clear means OUT, endpoint 4
+0x02, // attributes (2 = bulk transfers)
+0x40, 0x00, // maximum packet size of this endpoint in bytes (little-endian)
+0x00 // polling interval (ignored for bulk endpoints)
+#endif // #ifdef USB_VENDOR_BULK
 };
 
 /** Section 9.6.7 of the USB specification states that if a device returns
@@ -4,10 +4,18 @@
   *
   * This file provides an abstract interface for USB operations on the PIC32
   * USB module. It is quite simple and doesn't support many features.
-  * The PIC32 USB module supports "ping-pong buffering" (double buffering),
-  * but this implementation does not use this feature, as throughput is not
-  * expected to be a concern. Furthermore, this doesn't support USB suspend or
-  * resume.
+  * It does use the PIC32 USB module's "ping-pong buffering" (double
+  * buffering): each endpoint and direction has an even and an odd buffer
+  * descriptor, so up to #MAX_QUEUED_PACKETS packets can be queued at once.
+  * That way, the next packet is already waiting when the host asks for it,
+  * instead of being NAKed until the interrupt service handler gets around to
+  * queueing it. This doesn't support USB suspend or resume.
+  *
+  * The USB module keeps an internal even/odd pointer for each endpoint and
+  * direction, which only advances when a transaction completes. This file
+  * mirrors that pointer in #next_pp. Packets are always queued in the
+  * descriptor after the ones already queued, so they are transacted in the
+  * order they were queued.
   *
   * From a device's perspective, USB transactions are asynchronous. That is
   * because the host tells the device when it can transmit or receive.
@@ -34,6 +42,7 @@
 #include "usb_callbacks.h"
 #include "usb_standard_requests.h" // for usbResetSeen() callback
 #include "pic32_system.h"
+#include "../diagnostics.h"
 
 /** Each endpoint has 4 buffer descriptor entries: even receive, odd receive,
   * even transmit and odd transmit. The even/odd buffers allow for double
@@ -121,22 +130,76 @@ static USBBufferDescriptor bdt_table[NUM_ENDPOINTS * 4] __attribute__((aligned(5
   * the interrupt service routine whenever a successful transaction occurs. */
 static EndpointState *endpoint_states[NUM_ENDPOINTS];
 
+/** For each endpoint and direction (#BDT_RX or #BDT_TX), the buffer
+  * descriptor (#BDT_EVEN or #BDT_ODD) which the USB module will use for
+  * its next transaction. */
+static uint8_t next_pp[NUM_ENDPOINTS][2];
+/** For each endpoint and direction (#BDT_RX or #BDT_TX), the number of
+  * buffer descriptors which have been handed to the USB module but haven't
+  * been transacted yet. This will be between 0 and #MAX_QUEUED_PACKETS
+  * inclusive. */
+static uint8_t queued_count[NUM_ENDPOINTS][2];
+
+/** Get the index (into #bdt_table) of the buffer descriptor which should be
+  * used for the next packet queued on an endpoint. This is the descriptor
+  * after any which are already queued.
+  * \param endpoint The device endpoint number.
+  * \param dir Use #BDT_RX for receive or #BDT_TX for transmit.
+  * \return The index of the buffer descriptor to fill in.
+  */
+static unsigned int getQueueIndex(unsigned int endpoint, unsigned int dir)
+{
+	return BDT_IDX(endpoint, dir, next_pp[endpoint][dir] ^ (queued_count[endpoint][dir] & 1));
+}
+
+/** Take both of the buffer descriptors of an endpoint and direction back from
+  * the USB module, discarding any packets queued in them.
+  * \param endpoint The device endpoint number.
+  * \param dir Use #BDT_RX for receive or #BDT_TX for transmit.
+  * \warning This must only be called when the USB module cannot be using the
+  *          descriptors, otherwise a packet could be half-transacted.
+  */
+static void unqueueAll(unsigned int endpoint, unsigned int dir)
+{
+	bdt_table[BDT_IDX(endpoint, dir, BDT_EVEN)].CTRL.UOWN = 0;
+	bdt_table[BDT_IDX(endpoint, dir, BDT_ODD)].CTRL.UOWN = 0;
+	queued_count[endpoint][dir] = 0;
+}
+
 /** Resets the USB HAL state. This doesn't reset as much as usbInit(), but
   * resets everything appropriate to a USB protocol reset (as defined in
   * section 7.1.7.5 of the USB specification). */
 static void usbHALReset(void)
 {
 	unsigned int endpoint;
+	unsigned int receives_queued;
+	unsigned int i;
 
 	U1ADDRbits.DEVADDR = 0; // default to device address = 0
-	// Reset all data sequence bits.
+	// The USB module's ping-pong pointers are reset to EVEN, so the buffer
+	// descriptors have to be handed back and re-queued from EVEN, otherwise
+	// #next_pp would get out of sync. Pending transmits are thrown away,
+	// but receives are re-queued so that enabled endpoints stay ready to
+	// receive.
+	U1CONbits.PPBRST = 1; // reset ping-pong buffer pointers to EVEN
 	for (endpoint = 0; endpoint < NUM_ENDPOINTS; endpoint++)
 	{
+		receives_queued = queued_count[endpoint][BDT_RX];
+		unqueueAll(endpoint, BDT_RX);
+		unqueueAll(endpoint, BDT_TX);
+		next_pp[endpoint][BDT_RX] = BDT_EVEN;
+		next_pp[endpoint][BDT_TX] = BDT_EVEN;
 		if (endpoint_states[endpoint] != NULL)
 		{
+			// Reset data sequence bit.
 			endpoint_states[endpoint]->data_sequence = 0;
+			for (i = 0; i < receives_queued; i++)
+			{
+				usbQueueReceivePacket(endpoint);
+			}
 		}
 	}
+	U1CONbits.PPBRST = 0;
 	usbResetSeen();
 }
 
@@ -148,6 +211,8 @@ void usbInit(void)
 
 	// Initialise buffer descriptor table.
 	memset(bdt_table, 0, sizeof(bdt_table));
+	memset(next_pp, 0, sizeof(next_pp));
+	memset(queued_count, 0, sizeof(queued_count));
 	// Enable power to module.
 	while (U1PWRCbits.USBBUSY != 0)
 	{
@@ -178,6 +243,7 @@ void usbInit(void)
 	U1CONbits.HOSTEN = 0; // device mode
 	U1CONbits.RESUME = 0; // don't send RESUME signal
 	U1CONbits.PPBRST = 1; // reset ping-pong buffer pointers to EVEN
+	U1CONbits.PPBRST = 0; // let the pointers toggle from now on
 	U1ADDRbits.LSPDEN = 0; // full-speed mode
 	U1ADDRbits.DEVADDR = 0; // default to device address = 0
 	U1CNFG1 = 0; // disable USB test mode features
@@ -208,6 +274,9 @@ void usbDisconnect(void)
 /** Handoff receive buffer of the appropriate endpoint state to the USB
   * module, so that it is ready to receive another packet. This must be called
   * after receiving a packet, otherwise subsequent packets will be NAKed.
+  * This can be called twice in a row (without receiving a packet in between),
+  * so that a second packet can be received while the first is waiting to be
+  * processed; at most #MAX_QUEUED_PACKETS receives can be queued at once.
   * \param endpoint The device endpoint number.
   */
 void usbQueueReceivePacket(unsigned int endpoint)
@@ -228,15 +297,23 @@ void usbQueueReceivePacket(unsigned int endpoint)
 		usbFatalError();
 		return;
 	}
-	index = BDT_IDX(endpoint, BDT_RX, BDT_EVEN);
+	if (queued_count[endpoint][BDT_RX] >= MAX_QUEUED_PACKETS)
+	{
+		// Both receive buffer descriptors are already queued.
+		usbFatalError();
+		return;
+	}
+	index = getQueueIndex(endpoint, BDT_RX);
 	if (bdt_table[index].CTRL.UOWN != 0)
 	{
 		// Attempting to overwrite another queued receive.
 		usbFatalError();
 		return;
 	}
-	packet_buffer = endpoint_states[endpoint]->receive_buffer;
-	length = sizeof(endpoint_states[endpoint]->receive_buffer);
+	// Each buffer descriptor has its own packet buffer, so that one packet
+	// can be received while the other is still being processed.
+	packet_buffer = endpoint_states[endpoint]->receive_buffer[index & 1];
+	length = sizeof(endpoint_states[endpoint]->receive_buffer[0]);
 	// Set buffer parameters.
 	bdt_table[index].CTRL.BSTALL = 0;
 	// Data sequence checking is done in software. This is because SETUP
@@ -247,6 +324,7 @@ void usbQueueReceivePacket(unsigned int endpoint)
 	bdt_table[index].CTRL.DATA0_1 = endpoint_states[endpoint]->data_sequence;
 	bdt_table[index].CTRL.BYTE_COUNT = length;
 	bdt_table[index].CTRL.BUFFER_ADDRESS = VIRTUAL_TO_PHYSICAL(packet_buffer);
+	queued_count[endpoint][BDT_RX]++;
 	// Tell USB module to process buffer.
 	bdt_table[index].CTRL.UOWN = 1;
 }
@@ -256,6 +334,7 @@ void __attribute__((vector(_USB_1_VECTOR), interrupt(ipl2), nomips16)) _USBHandl
 {
 	unsigned int endpoint;
 	unsigned int direction;
+	unsigned int pp;
 	bool is_setup;
 	bool is_extended;
 	EndpointState *state;
@@ -264,7 +343,6 @@ void __attribute__((vector(_USB_1_VECTOR), interrupt(ipl2), nomips16)) _USBHandl
 	uint32_t transmitted_bytes;
 
 	usbActivityLED();
-	U1CONbits.PPBRST = 1; // reset ping-pong buffer pointers to EVEN
 	// Determine cause of interrupt.
 	if (U1IRbits.TRNIF != 0)
 	{
@@ -280,6 +358,7 @@ void __attribute__((vector(_USB_1_VECTOR), interrupt(ipl2), nomips16)) _USBHandl
 			return;
 		}
 		direction = U1STATbits.DIR;
+		pp = U1STATbits.PPBI; // which of the even/odd descriptors was used
 		// TRNIF needs to be cleared before the next transaction, otherwise
 		// an interrupt could be missed. Fourtunately, the minimum time for a
 		// valid 0-length data transaction is 32 + 3 + 32 + 3 + 16 + 3 bit
@@ -295,10 +374,23 @@ void __attribute__((vector(_USB_1_VECTOR), interrupt(ipl2), nomips16)) _USBHandl
 			usbFatalError();
 			return;
 		}
-		if (direction == 0)
+		// The USB module has now moved on to the other descriptor. This must
+		// be recorded before calling any callbacks, since they may queue
+		// more packets.
+		direction = (direction == 0) ? BDT_RX : BDT_TX;
+		if (queued_count[endpoint][direction] == 0)
+		{
+			// Transaction completed on a descriptor which wasn't queued.
+			usbFatalError();
+			return;
+		}
+		queued_count[endpoint][direction]--;
+		next_pp[endpoint][direction] = (uint8_t)(pp ^ 1);
+		index = BDT_IDX(endpoint, direction, pp);
+		diagnosticsUSBPacket(endpoint, bdt_table[index].STATUS.BYTE_COUNT);
+		if (direction == BDT_RX)
 		{
 			// Last transaction was receive.
-			index = BDT_IDX(endpoint, BDT_RX, BDT_EVEN);
 			length = bdt_table[index].STATUS.BYTE_COUNT;
 			is_setup = false;
 			if (bdt_table[index].STATUS.PID == USBPID_SETUP)
@@ -315,7 +407,7 @@ void __attribute__((vector(_USB_1_VECTOR), interrupt(ipl2), nomips16)) _USBHandl
 			if (bdt_table[index].STATUS.DATA0_1 == state->data_sequence)
 			{
 				state->data_sequence ^= 1;
-				state->receiveCallback(state->receive_buffer, length, is_setup);
+				state->receiveCallback(state->receive_buffer[pp], length, is_setup);
 			}
 			else
 			{
@@ -337,7 +429,6 @@ void __attribute__((vector(_USB_1_VECTOR), interrupt(ipl2), nomips16)) _USBHandl
 			state->data_sequence ^= 1;
 			if (state->is_extended_transmit)
 			{
-				index = BDT_IDX(endpoint, BDT_TX, BDT_EVEN);
 				transmitted_bytes = bdt_table[index].STATUS.BYTE_COUNT;
 				// Advance transmission by transmitted_bytes bytes.
 				if (state->transmit_remaining < transmitted_bytes)
@@ -449,7 +540,6 @@ static volatile uint32_t *getEndpointControlRegister(unsigned int endpoint)
   */
 void usbDisableEndpoint(unsigned int endpoint)
 {
-	uint32_t index;
 	volatile uint32_t *reg;
 
 	// Disable transmit/receive for the endpoint.
@@ -468,11 +558,11 @@ void usbDisableEndpoint(unsigned int endpoint)
 	delayCycles(100 * CYCLES_PER_MICROSECOND);
 	// It's now safe to modify endpoint_states and bdt_table without worrying
 	// about screwing up the interrupt service handler.
+	// #next_pp is left alone, since the USB module's ping-pong pointers
+	// only move when a transaction completes.
 	endpoint_states[endpoint] = NULL;
-	index = BDT_IDX(endpoint, BDT_RX, BDT_EVEN);
-	bdt_table[index].CTRL.UOWN = 0;
-	index = BDT_IDX(endpoint, BDT_TX, BDT_EVEN);
-	bdt_table[index].CTRL.UOWN = 0;
+	unqueueAll(endpoint, BDT_RX);
+	unqueueAll(endpoint, BDT_TX);
 }
 
 /** Enable endpoint, so that it can begin transmitting and/or receiving.
@@ -562,6 +652,10 @@ bool usbIsEndpointEnabled(unsigned int endpoint)
   *                    transmit or not, ask the question: is this for the Data
   *                    stage of a control transfer? If not, you probably don't
   *                    need to do an extended transmit.
+  * \warning Up to #MAX_QUEUED_PACKETS non-extended packets can be queued at
+  *          once, but an extended transmit can only be queued when no other
+  *          transmit is queued on the endpoint, and nothing else can be
+  *          queued until it has finished.
   * \warning Since this is non-blocking, the data specified by packet_buffer
   *          must persist until the transmitCallback function is called.
   */
@@ -575,16 +669,30 @@ void usbQueueTransmitPacket(const uint8_t *packet_buffer, uint32_t length, unsig
 		usbFatalError();
 		return;
 	}
-	index = BDT_IDX(endpoint, BDT_TX, BDT_EVEN);
-	if (bdt_table[index].CTRL.UOWN != 0)
+	if (endpoint_states[endpoint] == NULL)
 	{
-		// Attempting to overwrite another queued transmission.
+		// Attempting to transmit from a disabled endpoint.
 		usbFatalError();
 		return;
 	}
-	if (endpoint_states[endpoint] == NULL)
+	if (queued_count[endpoint][BDT_TX] >= MAX_QUEUED_PACKETS)
 	{
-		// Attempting to transmit from a disabled endpoint.
+		// Both transmit buffer descriptors are already queued.
+		usbFatalError();
+		return;
+	}
+	if ((queued_count[endpoint][BDT_TX] != 0)
+		&& (endpoint_states[endpoint]->is_extended_transmit || is_extended))
+	{
+		// Extended transmits keep track of their progress in the endpoint
+		// state, so they can't share the endpoint with other packets.
+		usbFatalError();
+		return;
+	}
+	index = getQueueIndex(endpoint, BDT_TX);
+	if (bdt_table[index].CTRL.UOWN != 0)
+	{
+		// Attempting to overwrite another queued transmission.
 		usbFatalError();
 		return;
 	}
@@ -624,15 +732,19 @@ void usbQueueTransmitPacket(const uint8_t *packet_buffer, uint32_t length, unsig
 	bdt_table[index].CTRL.DTS = 0;
 	bdt_table[index].CTRL.NINC = 0;
 	bdt_table[index].CTRL.KEEP = 0;
-	bdt_table[index].CTRL.DATA0_1 = endpoint_states[endpoint]->data_sequence;
+	// data_sequence is toggled as each packet is transmitted, so if there's
+	// already a packet queued ahead of this one, this packet will be sent
+	// with the opposite value.
+	bdt_table[index].CTRL.DATA0_1 = endpoint_states[endpoint]->data_sequence ^ (queued_count[endpoint][BDT_TX] & 1);
 	bdt_table[index].CTRL.BYTE_COUNT = length;
 	bdt_table[index].CTRL.BUFFER_ADDRESS = VIRTUAL_TO_PHYSICAL(packet_buffer);
+	queued_count[endpoint][BDT_TX]++;
 	// Tell USB module to process buffer.
 	bdt_table[index].CTRL.UOWN = 1;
 }
 
-/** Cancel a queued transmission.
-  * \param endpoint The endpoint number of the transmission to cancel.
+/** Cancel all queued transmissions of an endpoint.
+  * \param endpoint The endpoint number of the transmissions to cancel.
   * \warning It is almost always unsafe to call this, because the USB module
   *          operates asynchronously and independently of the CPU. There is
   *          only one time when it is safe: during the Setup stage of a
@@ -640,8 +752,6 @@ void usbQueueTransmitPacket(const uint8_t *packet_buffer, uint32_t length, unsig
   */
 void usbCancelTransmit(unsigned int endpoint)
 {
-	unsigned int index;
-
 	if (U1CONbits.PKTDIS == 0)
 	{
 		// Unsafe situation; the transmit could be in progress.
@@ -653,13 +763,15 @@ void usbCancelTransmit(unsigned int endpoint)
 		usbFatalError();
 		return;
 	}
-	index = BDT_IDX(endpoint, BDT_TX, BDT_EVEN);
-	if (bdt_table[index].CTRL.UOWN == 0)
+	if (queued_count[endpoint][BDT_TX] == 0)
 	{
 		// Try to cancel non-existent transmit.
 		usbFatalError();
 	}
-	bdt_table[index].CTRL.UOWN = 0;
+	// Since the cancelled packets were never transacted, the USB module's
+	// ping-pong pointer hasn't moved, so the next packet queued will go in
+	// the same descriptor as the first cancelled one.
+	unqueueAll(endpoint, BDT_TX);
 }
 
 /** Stall an endpoint. If the host tries to transact with a stalled endpoint,
@@ -680,6 +792,7 @@ void usbStallEndpoint(unsigned int endpoint)
 	}
 	reg = getEndpointControlRegister(endpoint);
 	*reg |= 0x02; // set EPSTALL bit
+	diagnosticsUSBEvent(endpoint, DIAGNOSTICS_USB_STALL);
 }
 
 /** Unstall an endpoint. This will clear the stall status of an endpoint
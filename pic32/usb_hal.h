@@ -24,6 +24,16 @@
   */
 #define NUM_ENDPOINTS				16
 
+/** Maximum number of packets which can be queued for transmission (or
+  * queued for reception) on one endpoint at the same time. The USB module
+  * has an even and an odd buffer descriptor for each endpoint and direction
+  * ("ping-pong buffering"), so while it is transacting one packet, the next
+  * one can already be waiting.
+  * \warning This must be 2, because it corresponds to the even/odd buffer
+  *          descriptors of the USB module.
+  */
+#define MAX_QUEUED_PACKETS			2
+
 /** Endpoint types, to pass to enableEndpoint(). */
 typedef enum EndpointTypeEnum
 {
@@ -39,9 +49,10 @@ typedef enum EndpointTypeEnum
   * packets can be received and transmitted asynchronously. */
 typedef struct EndpointStateStruct
 {
-	/** Buffer for received packets. It needs to be persistent because packets
+	/** Buffers for received packets, one for each of the even and odd
+	  * receive buffer descriptors. They need to be persistent because packets
 	  * can be received at any time. */
-	uint8_t receive_buffer[MAX_PACKET_SIZE];
+	uint8_t receive_buffer[MAX_QUEUED_PACKETS][MAX_PACKET_SIZE];
 	/** Callback which is called whenever a packet is received.
 	  * \param packet_buffer The contents of the packet are placed here.
 	  * \param length The length (in bytes) of the received packet.
@@ -58,7 +69,8 @@ typedef struct EndpointStateStruct
 	void (*receiveCallback)(uint8_t *packet_buffer, uint32_t length, bool is_setup);
 	/** Callback which is called whenever a packet is transmitted. For
 	  * extended packets, this will only be called after the last packet is
-	  * successfully transmitted. */
+	  * successfully transmitted. If two packets were queued, this is called
+	  * once for each of them, in the order they were queued. */
 	void (*transmitCallback)(void);
 	/** Current value of the data toggle synchronisation counter. This should
 	  * be 0 or 1 and is used to handle cases where ACKs are dropped. See
@@ -10,7 +10,8 @@
   * done this way to allow "driverless" operation on Windows systems.
   *
   * Here's a high-level overview of what's provided in this file. There is
-  * an implementation of streamGetOneByte() and streamPutOneByte(), which
+  * an implementation of streamGetOneByte() and streamPutOneByte() (and their
+  * bulk equivalents streamGetBytes() and streamPutBytes()), which
   * read from or write to FIFOs. The interface to USB happens mainly through
   * callbacks, because USB is fundamentally asynchronous from a device's point
   * of view. The nature of asynchronous I/O means that care must be taken to
@@ -24,13 +25,36 @@
   *   can occur in an interrupt context. The assumption is made that there
   *   is only one interrupt context (i.e. USB interrupts cannot interrupt
   *   USB interrupts).
-  * - If the host decides to get/send reports through an Interrupt endpoint
-  *   and the control endpoint simultaneously, the order of reports is
-  *   undefined (so don't do that!).
+  * - If the host decides to send reports through the Interrupt OUT
+  *   endpoint and the control endpoint simultaneously, the order of reports
+  *   is undefined (so don't do that!).
+  * - Some hosts' HID stacks can only use the control endpoint. The first
+  *   "Get Report" request (see getReport()) switches transmission over to
+  *   the control endpoint, until the device is unconfigured or reset. From
+  *   then on, each "Get Report" request is filled straight from the
+  *   transmit FIFO (see fillTransmitReport()), and nothing is queued on the
+  *   Interrupt IN endpoint. Anything which was already queued there is sent
+  *   in the first reports instead, so no bytes are lost or reordered.
   * - It is necessary to support the "Set Report" control request
   *   (see setReport()) because the hidraw driver on Linux kernels
   *   earlier than 2.6.35 use it, even if the device provides a perfectly
   *   working Interrupt OUT endpoint.
+  * - If USB_VENDOR_BULK is defined, there is also a vendor-specific
+  *   interface with a Bulk IN/OUT endpoint pair (see usb_descriptors.h).
+  *   Bulk packets carry up to 64 bytes of stream data each, with no report
+  *   ID prefix. Data received on either interface goes into the same receive
+  *   FIFO. Once the host sends anything to the Bulk OUT endpoint, the
+  *   transmit FIFO is drained through the Bulk IN endpoint instead of the
+  *   Interrupt IN endpoint, until the device is unconfigured or reset. So
+  *   the host selects the transport simply by writing to it; it should do
+  *   that before starting a conversation, otherwise the first part of a
+  *   response may end up on the wrong interface.
+  * - Both FIFOs use watermarks. Bytes written to the transmit FIFO are held
+  *   back until there are enough for a full report
+  *   (see #TRANSMIT_HIGH_WATERMARK), or until the device is about to wait
+  *   for the host, and receives are only re-armed once the receive FIFO has
+  *   drained to #RECEIVE_LOW_WATERMARK. The FIFO sizes and watermarks can be
+  *   set in the platform's build settings.
   *
   * All references to the "USB specification" refer to revision 2.0, obtained
   * from http://www.usb.org/developers/docs/usb_20_110512.zip (see usb_20.pdf)
@@ -44,6 +68,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 #include "usb_hal.h"
 #include "usb_callbacks.h"
 #include "usb_defs.h"
@@ -51,6 +76,8 @@
 #include "../common.h"
 #include "serial_fifo.h"
 #include "pic32_system.h"
+#include "../diagnostics.h"
+#include "../trace.h"
 
 /** Only include the report descriptor when including the descriptors
   * in usb_descriptors.h. */
@@ -63,28 +90,97 @@
 /** The endpoint number for reception (Interrupt OUT). It's OUT because
   * from the host's perspective, data is flowing out of it. */
 #define RECEIVE_ENDPOINT_NUMBER		2
+#ifdef USB_VENDOR_BULK
+/** The endpoint number for bulk transmission (Bulk IN). */
+#define BULK_TRANSMIT_ENDPOINT_NUMBER	3
+/** The endpoint number for bulk reception (Bulk OUT). */
+#define BULK_RECEIVE_ENDPOINT_NUMBER	4
+#endif // #ifdef USB_VENDOR_BULK
 
-/** Size of transmit FIFO buffer, in number of bytes. There isn't much to be
-  * gained from making this significantly larger.
+#ifndef TRANSMIT_FIFO_SIZE
+/** Size of transmit FIFO buffer, in number of bytes. A larger FIFO lets the
+  * device get further ahead of the host, which helps when sending large
+  * responses over the Bulk IN endpoint. This can be overridden by defining
+  * TRANSMIT_FIFO_SIZE in the platform's build settings, on parts which have
+  * RAM to spare.
   * \warning This must be a power of 2.
+  * \warning This must be >= #TRANSMIT_HIGH_WATERMARK.
   */
+#ifdef USB_VENDOR_BULK
+#define TRANSMIT_FIFO_SIZE			256
+#else
 #define TRANSMIT_FIFO_SIZE			64
-/** Size of receive FIFO buffer, in number of bytes. There isn't much to be
-  * gained from making this significantly larger.
+#endif // #ifdef USB_VENDOR_BULK
+#endif // #ifndef TRANSMIT_FIFO_SIZE
+#ifndef RECEIVE_FIFO_SIZE
+/** Size of receive FIFO buffer, in number of bytes. A larger FIFO lets the
+  * host get further ahead of the device, so that a slow consumer doesn't
+  * block the host as often. This can be overridden by defining
+  * RECEIVE_FIFO_SIZE in the platform's build settings, on parts which have
+  * RAM to spare.
   * \warning This must be a power of 2.
   * \warning This must be >= #RECEIVE_HEADROOM, to handle the (unlikely)
   *          cases where the host does simultaneous writes to the
-  *          Interrupt OUT endpoint and control endpoint.
+  *          Interrupt OUT endpoint and control endpoint. It should also be
+  *          at least #MAX_PACKET_SIZE bytes larger than that, otherwise
+  *          there will never be room for a second Interrupt OUT receive.
+  *          If USB_VENDOR_BULK is defined, the Bulk OUT receives need
+  *          room too, so it is made bigger.
   */
+#ifdef USB_VENDOR_BULK
+#define RECEIVE_FIFO_SIZE			512
+#else
 #define RECEIVE_FIFO_SIZE			256
+#endif // #ifdef USB_VENDOR_BULK
+#endif // #ifndef RECEIVE_FIFO_SIZE
 
 /** Minimum number of bytes which must be available (free) in the receive
   * FIFO before a receive will be queued. This is not just #MAX_PACKET_SIZE
   * because the host may do simultaneous writes to the Interrupt OUT endpoint
   * and control endpoint, in which case two packets will be received in
-  * quick succession. */
+  * quick succession. Each Interrupt OUT (or Bulk OUT) receive which is
+  * already queued needs another #MAX_PACKET_SIZE bytes on top of this; see
+  * isSpaceForAnotherReceive(). */
 #define RECEIVE_HEADROOM			(2 * MAX_PACKET_SIZE)
 
+#ifndef RECEIVE_LOW_WATERMARK
+/** Receives are only re-armed (see queueReceiveIfSpaceAvailable()) once the
+  * receive FIFO holds this many bytes or fewer. Above this, reading from the
+  * FIFO doesn't touch the USB module at all, so reading a packet doesn't
+  * mean a critical section for every byte. The default is the most the FIFO
+  * can hold while there is still room for one receive, so that receives are
+  * re-armed as soon as possible. Defining RECEIVE_LOW_WATERMARK to a smaller
+  * value in the platform's build settings re-arms less often, but with more
+  * receives at a time.
+  * \warning This must be <= #RECEIVE_FIFO_SIZE - #RECEIVE_HEADROOM
+  *          - #MAX_PACKET_SIZE, otherwise no receive would ever be queued.
+  */
+#define RECEIVE_LOW_WATERMARK		(RECEIVE_FIFO_SIZE - RECEIVE_HEADROOM - MAX_PACKET_SIZE)
+#endif // #ifndef RECEIVE_LOW_WATERMARK
+
+#ifndef TRANSMIT_HIGH_WATERMARK
+/** Bytes written to the transmit FIFO are held back until it contains at
+  * least this many, so that they go out in full reports instead of a report
+  * for every write. Anything left over is sent whenever the device is about
+  * to wait for the host (see flushTransmitFIFO()). This can be overridden by
+  * defining TRANSMIT_HIGH_WATERMARK in the platform's build settings;
+  * defining it as 1 sends everything straight away.
+  * \warning This must be between 1 and #TRANSMIT_FIFO_SIZE, otherwise the
+  *          FIFO could fill up without anything being sent.
+  */
+#define TRANSMIT_HIGH_WATERMARK		MAX_PACKET_SIZE
+#endif // #ifndef TRANSMIT_HIGH_WATERMARK
+
+#if ((TRANSMIT_FIFO_SIZE & (TRANSMIT_FIFO_SIZE - 1)) != 0) || ((RECEIVE_FIFO_SIZE & (RECEIVE_FIFO_SIZE - 1)) != 0)
+#error "TRANSMIT_FIFO_SIZE and RECEIVE_FIFO_SIZE must be powers of 2"
+#endif
+#if (RECEIVE_LOW_WATERMARK < 0) || (RECEIVE_LOW_WATERMARK > (RECEIVE_FIFO_SIZE - RECEIVE_HEADROOM - MAX_PACKET_SIZE))
+#error "RECEIVE_LOW_WATERMARK leaves no room for a receive; check RECEIVE_FIFO_SIZE"
+#endif
+#if (TRANSMIT_HIGH_WATERMARK < 1) || (TRANSMIT_HIGH_WATERMARK > TRANSMIT_FIFO_SIZE)
+#error "TRANSMIT_HIGH_WATERMARK must be between 1 and TRANSMIT_FIFO_SIZE"
+#endif
+
 /** The transmit FIFO buffer. */
 volatile CircularBuffer transmit_fifo;
 /** The receive FIFO buffer. */
@@ -95,22 +191,61 @@ static volatile uint8_t transmit_fifo_storage[TRANSMIT_FIFO_SIZE];
 /** Storage for the receive FIFO buffer. */
 static volatile uint8_t receive_fifo_storage[RECEIVE_FIFO_SIZE];
 
-/** Flag which when true, indicates that a
-  * packet has been queued for transmission on the Interrupt IN endpoint. */
-static volatile bool interrupt_transmit_queued;
-/** Flag which when true, indicates that a
-  * packet has been queued for reception on the Interrupt OUT endpoint. */
-static volatile bool interrupt_receive_queued;
+/** Flag which, when true, indicates that everything in the transmit FIFO
+  * should be sent, even if it's less than #TRANSMIT_HIGH_WATERMARK bytes.
+  * This is cleared once the transmit FIFO is empty. */
+static volatile bool transmit_flush_requested;
+/** Number of packets (0 to #MAX_QUEUED_PACKETS) which have been queued for
+  * transmission on the Interrupt IN endpoint but not yet transmitted. */
+static volatile uint32_t interrupt_transmits_queued;
+/** Number of receives (0 to #MAX_QUEUED_PACKETS) which have been queued on
+  * the Interrupt OUT endpoint but not yet received. */
+static volatile uint32_t interrupt_receives_queued;
+/** Index into #interrupt_packet_buffer of the packet which will be
+  * transmitted next on the Interrupt IN endpoint. If two packets are queued,
+  * the other one is transmitted after this one. */
+static volatile uint32_t oldest_interrupt_packet;
 
-/** Persistent packet buffer for packets sent from the Interrupt IN endpoint
-  * (see #TRANSMIT_ENDPOINT_NUMBER). */
-static uint8_t interrupt_packet_buffer[MAX_PACKET_SIZE];
+/** Persistent packet buffers for packets sent from the Interrupt IN endpoint
+  * (see #TRANSMIT_ENDPOINT_NUMBER). There are two, so that one packet can be
+  * filled and queued while the other is being transmitted. */
+static uint8_t interrupt_packet_buffer[MAX_QUEUED_PACKETS][MAX_PACKET_SIZE];
 /** Persistent packet buffer for packets sent from the control endpoint. This
   * needs to be separate from #interrupt_packet_buffer because both the
   * Interrupt IN endpoint and control endpoint can be transmitting
   * simultaneously. */
 static uint8_t get_report_packet_buffer[MAX_PACKET_SIZE];
 
+#ifdef USB_VENDOR_BULK
+/** Flag which, when true, indicates that the host has selected the
+  * vendor-specific bulk interface (by sending something to the Bulk OUT
+  * endpoint), so the transmit FIFO should be drained through the Bulk IN
+  * endpoint. */
+static volatile bool use_bulk_transport;
+/** Number of packets (0 to #MAX_QUEUED_PACKETS) which have been queued for
+  * transmission on the Bulk IN endpoint but not yet transmitted. */
+static volatile uint32_t bulk_transmits_queued;
+/** Number of receives (0 to #MAX_QUEUED_PACKETS) which have been queued on
+  * the Bulk OUT endpoint but not yet received. */
+static volatile uint32_t bulk_receives_queued;
+/** Index into #bulk_packet_buffer of the packet which will be transmitted
+  * next on the Bulk IN endpoint. */
+static volatile uint32_t oldest_bulk_packet;
+/** Flag which, when true, indicates that the last packet queued on the
+  * Bulk IN endpoint was a full (#MAX_PACKET_SIZE) packet. If the transmit
+  * FIFO runs dry after that, a zero-length packet needs to be sent so that
+  * the host knows the transfer is over (see section 5.8.3 of the USB
+  * specification). */
+static volatile bool bulk_transfer_unterminated;
+/** Persistent packet buffers for packets sent from the Bulk IN endpoint
+  * (see #BULK_TRANSMIT_ENDPOINT_NUMBER). */
+static uint8_t bulk_packet_buffer[MAX_QUEUED_PACKETS][MAX_PACKET_SIZE];
+/** Persistent endpoint state for the Bulk IN endpoint. */
+static EndpointState bulk_transmit_endpoint_state;
+/** Persistent endpoint state for the Bulk OUT endpoint. */
+static EndpointState bulk_receive_endpoint_state;
+#endif // #ifdef USB_VENDOR_BULK
+
 /** Persistent endpoint state for the transmit endpoint (with endpoint
   * number #TRANSMIT_ENDPOINT_NUMBER. */
 static EndpointState transmit_endpoint_state;
@@ -140,11 +275,20 @@ static volatile bool expect_control_report;
   * is only valid when #expect_control_report is true. */
 static uint8_t expected_control_report_id;
 
-/** Flag which, when true, indicates that
-  * streamPutOneByte() should redirect bytes into #get_report_packet_buffer,
-  * where they will be transmitted through the control endpoint (instead of
-  * the Interrupt IN endpoint). This is used to handle the "Get Report"
-  * request. */
+/** Flag which, when true, indicates that the host has used the "Get Report"
+  * request, so the transmit FIFO should be drained through the control
+  * endpoint (see fillTransmitReport()) instead of the Interrupt IN
+  * endpoint. */
+static volatile bool use_control_transport;
+/** Number of bytes at the start of the oldest packet in
+  * #interrupt_packet_buffer which have already been moved into a "Get
+  * Report" report. This is only used for packets which were queued on the
+  * Interrupt IN endpoint before #use_control_transport was set. */
+static uint32_t interrupt_packet_offset;
+
+/** Flag which, when true, indicates that a "Get Report" request is waiting
+  * for #get_report_packet_buffer to be filled, after which it will be
+  * transmitted through the control endpoint. */
 static volatile bool do_build_transmit_report;
 /** Desired size (as given in the "Get Report" request), in bytes, of the
   * report to send through the control endpoint. This includes the report ID
@@ -155,39 +299,183 @@ static uint32_t desired_transmit_report_length;
   * when #do_build_transmit_report is true. */
 static uint32_t current_transmit_report_length;
 
-/** Fill up transmit packet buffer with bytes obtained from the transmit
-  * FIFO buffer, then queue the packet for transmission, if necessary.
+/** Queue the next filled-in packet buffer (the one after any already
+  * queued) for transmission on the Interrupt IN endpoint. Since the packets
+  * are transmitted in the order they were queued, this means the packet
+  * buffers are used alternately.
+  * \warning This must be called with interrupts disabled (or from an
+  *          interrupt context).
+  */
+static void queueNextInterruptPacket(void)
+{
+	uint8_t *packet;
+
+	packet = interrupt_packet_buffer[oldest_interrupt_packet ^ interrupt_transmits_queued];
+	// Increment interrupt_transmits_queued before queueing transmit to avoid
+	// race condition where packet is transmitted just after
+	// usbQueueTransmitPacket() call.
+	interrupt_transmits_queued++;
+	usbQueueTransmitPacket(packet, packet[0] + 1, TRANSMIT_ENDPOINT_NUMBER, false);
+}
+
+/** Check whether there is enough in the transmit FIFO to be worth sending
+  * (see #TRANSMIT_HIGH_WATERMARK).
+  * \return true if the transmit FIFO is not empty and either a flush has
+  *         been requested or it holds at least #TRANSMIT_HIGH_WATERMARK
+  *         bytes, false otherwise.
+  */
+static bool isTransmitWorthwhile(void)
+{
+	if (isCircularBufferEmpty(&transmit_fifo))
+	{
+		return false;
+	}
+	if (transmit_flush_requested || (circularBufferBytesUsed(&transmit_fifo) >= TRANSMIT_HIGH_WATERMARK))
+	{
+		return true;
+	}
+	else
+	{
+		return false;
+	}
+}
+
+#ifdef USB_VENDOR_BULK
+/** Bulk IN equivalent of the Interrupt IN part of
+  * fillTransmitPacketBufferAndTransmit(). Bulk packets don't have a report
+  * ID prefix, so each one can carry #MAX_PACKET_SIZE bytes of stream data.
+  * \warning This must be called with interrupts disabled (or from an
+  *          interrupt context).
+  */
+static void fillBulkPacketBuffersAndTransmit(void)
+{
+	uint8_t *packet;
+	uint32_t count;
+
+	while ((bulk_transmits_queued < MAX_QUEUED_PACKETS)
+		&& (isTransmitWorthwhile() || (transmit_flush_requested && bulk_transfer_unterminated)))
+	{
+		packet = bulk_packet_buffer[oldest_bulk_packet ^ bulk_transmits_queued];
+		count = 0;
+		if (!isCircularBufferEmpty(&transmit_fifo))
+		{
+			count = circularBufferReadBytes(&transmit_fifo, packet, MAX_PACKET_SIZE, true);
+		}
+		// A zero-length packet (count == 0) terminates the transfer; a
+		// full packet means the host will wait for more.
+		if (count == MAX_PACKET_SIZE)
+		{
+			bulk_transfer_unterminated = true;
+		}
+		else
+		{
+			bulk_transfer_unterminated = false;
+		}
+		bulk_transmits_queued++;
+		usbQueueTransmitPacket(packet, count, BULK_TRANSMIT_ENDPOINT_NUMBER, false);
+	}
+	if (isCircularBufferEmpty(&transmit_fifo) && !bulk_transfer_unterminated)
+	{
+		transmit_flush_requested = false;
+	}
+}
+#endif // #ifdef USB_VENDOR_BULK
+
+/** Add as many bytes as are available to the report which is being built
+  * for a "Get Report" request. Bytes come first from any packets which were
+  * queued on the Interrupt IN endpoint before the host switched to the
+  * control endpoint (see getReport()), since those were written first, then
+  * from the transmit FIFO. If that completes the report, it is transmitted
+  * and #do_build_transmit_report is cleared.
+  * \warning This must be called with interrupts disabled (or from an
+  *          interrupt context).
+  */
+static void fillTransmitReport(void)
+{
+	uint8_t *packet;
+	uint32_t count;
+
+	while (do_build_transmit_report && (interrupt_transmits_queued > 0)
+		&& (current_transmit_report_length < desired_transmit_report_length))
+	{
+		packet = interrupt_packet_buffer[oldest_interrupt_packet];
+		count = MIN(desired_transmit_report_length - current_transmit_report_length, packet[0] - interrupt_packet_offset);
+		memcpy(&(get_report_packet_buffer[current_transmit_report_length]), &(packet[1 + interrupt_packet_offset]), count);
+		current_transmit_report_length += count;
+		interrupt_packet_offset += count;
+		if (interrupt_packet_offset == packet[0])
+		{
+			// Oldest packet is now empty, so drop it.
+			oldest_interrupt_packet ^= 1;
+			interrupt_transmits_queued--;
+			interrupt_packet_offset = 0;
+		}
+	}
+	if (do_build_transmit_report
+		&& (current_transmit_report_length < desired_transmit_report_length)
+		&& !isCircularBufferEmpty(&transmit_fifo))
+	{
+		current_transmit_report_length += circularBufferReadBytes(&transmit_fifo, &(get_report_packet_buffer[current_transmit_report_length]), desired_transmit_report_length - current_transmit_report_length, true);
+	}
+	if (do_build_transmit_report && (current_transmit_report_length == desired_transmit_report_length))
+	{
+		// Got desired size, send it.
+		usbQueueTransmitPacket(get_report_packet_buffer, desired_transmit_report_length, CONTROL_ENDPOINT_NUMBER, false);
+		do_build_transmit_report = false;
+	}
+}
+
+/** Fill up transmit packet buffers with bytes obtained from the transmit
+  * FIFO buffer, then queue the packets for transmission, if necessary. Up to
+  * #MAX_QUEUED_PACKETS packets are kept queued, so that the USB module
+  * always has the next packet ready when the host polls the Interrupt IN
+  * endpoint. Unless a flush has been requested, bytes are left in the FIFO
+  * while there are fewer than #TRANSMIT_HIGH_WATERMARK of them.
+  *
+  * If the host has switched to the control endpoint, this instead tops up
+  * the report for a pending "Get Report" request (if there is one). The
+  * host chooses the size of those, so the watermark doesn't apply.
   */
 static void fillTransmitPacketBufferAndTransmit(void)
 {
 	uint32_t status;
 	uint32_t count;
-	uint32_t i;
+	uint8_t *packet;
 
 	// Put everything in a critical section so that bytes are either in
 	// the transmit FIFO or in interrupt_packet_buffer.
 	status = disableInterrupts();
-	i = 1;
-	while ((i < sizeof(interrupt_packet_buffer)) && !isCircularBufferEmpty(&transmit_fifo))
+#ifdef USB_VENDOR_BULK
+	if (use_bulk_transport)
 	{
-		// Note that is_irq is set because interrupts are disabled; that's
-		// equivalent to an interrupt request handler context.
-		interrupt_packet_buffer[i] = circularBufferRead(&transmit_fifo, true);
-		i++;
+		fillBulkPacketBuffersAndTransmit();
+		restoreInterrupts(status);
+		return;
 	}
-	count = i - 1;
-	interrupt_packet_buffer[0] = (uint8_t)count;
-	if (count > 0)
+#endif // #ifdef USB_VENDOR_BULK
+	if (use_control_transport)
 	{
-		// Set transmit_queued before queueing transmit to avoid race
-		// condition where packet is transmitted just after
-		// usbQueueTransmitPacket() call.
-		interrupt_transmit_queued = true;
-		usbQueueTransmitPacket(interrupt_packet_buffer, count + 1, TRANSMIT_ENDPOINT_NUMBER, false);
+		fillTransmitReport();
+		if (isCircularBufferEmpty(&transmit_fifo))
+		{
+			transmit_flush_requested = false;
+		}
+		restoreInterrupts(status);
+		return;
 	}
-	else
+	while ((interrupt_transmits_queued < MAX_QUEUED_PACKETS)
+		&& isTransmitWorthwhile())
 	{
-		interrupt_transmit_queued = false;
+		packet = interrupt_packet_buffer[oldest_interrupt_packet ^ interrupt_transmits_queued];
+		// Note that is_irq is set because interrupts are disabled; that's
+		// equivalent to an interrupt request handler context.
+		count = circularBufferReadBytes(&transmit_fifo, &(packet[1]), MAX_PACKET_SIZE - 1, true);
+		packet[0] = (uint8_t)count;
+		queueNextInterruptPacket();
+	}
+	if (isCircularBufferEmpty(&transmit_fifo))
+	{
+		transmit_flush_requested = false;
 	}
 	restoreInterrupts(status);
 }
@@ -199,92 +487,63 @@ static void fillTransmitPacketBufferAndTransmit(void)
   */
 static void transferIntoReceiveFIFO(uint8_t *buffer, uint32_t length)
 {
-	uint32_t i;
-
 	if (circularBufferSpaceRemaining(&receive_fifo) < length)
 	{
 		// This should never happen.
 		usbFatalError();
 	}
-	for (i = 0; i < length; i++)
+	if (length > 0)
 	{
-		circularBufferWrite(&receive_fifo, buffer[i], true);
+		circularBufferWriteBytes(&receive_fifo, buffer, length, true);
 	}
 }
 
-/** Remove a byte from the existing queued packet which was intended to be
-  * sent out the Interrupt IN endpoint.
-  *
-  * This is a hack necessary to have the "Get Report" request work
-  * intuitively. Bytes sent using streamPutOneByte() will, by default, end up
-  * being queued for transmission via. the Interrupt IN endpoint. But if the
-  * host exclusively uses "Get Report" requests (which use the control
-  * endpoint), it will never see bytes queued for transmission via. the
-  * Interrupt IN endpoint. Therefore, there needs to be some way to obtain
-  * bytes from a queued Interrupt IN transmission.
-  * \return The byte that was removed.
-  * \warning This should only be called if there is actually a queued packet.
-  */
-static uint8_t stealByteFromInterruptReport(void)
+/** Check whether there is enough space in the receive FIFO to queue another
+  * receive (on either the control endpoint or the Interrupt OUT endpoint).
+  * Every receive which is already queued on the Interrupt OUT endpoint could
+  * complete before the new one, so space has to be reserved for those too.
+  * \return true if there is enough space, false if not.
+  */
+static bool isSpaceForAnotherReceive(void)
 {
-	uint8_t one_byte;
-	uint32_t count;
-	uint32_t i;
+	uint32_t receives_queued;
 
-	// Unqueue current transmit request.
-	if (!interrupt_transmit_queued)
+	receives_queued = interrupt_receives_queued;
+#ifdef USB_VENDOR_BULK
+	receives_queued += bulk_receives_queued;
+#endif // #ifdef USB_VENDOR_BULK
+	if (circularBufferSpaceRemaining(&receive_fifo) >= (RECEIVE_HEADROOM + receives_queued * MAX_PACKET_SIZE))
 	{
-		// This should never happen.
-		usbFatalError();
-	}
-	usbCancelTransmit(TRANSMIT_ENDPOINT_NUMBER);
-	interrupt_transmit_queued = false;
-	// Remove first report data byte from packet, shifting the rest of the
-	// data to fill the space.
-	count = interrupt_packet_buffer[0];
-	if ((count < 1) || (count > (sizeof(interrupt_packet_buffer) - 1)))
-	{
-		// Bad packet ID; this should never happen.
-		usbFatalError();
+		return true;
 	}
-	one_byte = interrupt_packet_buffer[1];
-	for (i = 1; i < count; i++)
-	{
-		interrupt_packet_buffer[i] = interrupt_packet_buffer[i + 1];
-	}
-	count--;
-	interrupt_packet_buffer[0] = (uint8_t)count;
-	// Queue updated transmit packet (if necessary).
-	if (count > 0)
+	else
 	{
-		interrupt_transmit_queued = true;
-		usbQueueTransmitPacket(interrupt_packet_buffer, count + 1, TRANSMIT_ENDPOINT_NUMBER, false);
+		return false;
 	}
-	return one_byte;
 }
 
-/** Incrementally build a report to send via. the control endpoint. This is
-  * used to handle the "Get Report" request. If the added byte completes
-  * the report, it will be transmitted; #do_build_transmit_report will be
-  * cleared to false if that happens.
-  * \param one_byte The byte to add to the report.
+/** Queue as many receives on the Interrupt OUT endpoint as there is space
+  * for in the receive FIFO, up to #MAX_QUEUED_PACKETS. If USB_VENDOR_BULK is
+  * defined, Bulk OUT receives are topped up first, since that's the faster
+  * way for the host to send data.
+  * \warning This must be called with interrupts disabled (or from an
+  *          interrupt context).
   */
-static void buildTransmitReport(uint8_t one_byte)
+static void queueInterruptReceives(void)
 {
-	if ((current_transmit_report_length >= desired_transmit_report_length)
-		|| (current_transmit_report_length >= sizeof(get_report_packet_buffer))
-		|| (!do_build_transmit_report))
+#ifdef USB_VENDOR_BULK
+	while ((bulk_receives_queued < MAX_QUEUED_PACKETS)
+		&& isSpaceForAnotherReceive())
 	{
-		// This should never happen.
-		usbFatalError();
+		bulk_receives_queued++;
+		usbQueueReceivePacket(BULK_RECEIVE_ENDPOINT_NUMBER);
 	}
-	get_report_packet_buffer[current_transmit_report_length] = one_byte;
-	current_transmit_report_length++;
-	if (current_transmit_report_length == desired_transmit_report_length)
+#endif // #ifdef USB_VENDOR_BULK
+	while ((interrupt_receives_queued < MAX_QUEUED_PACKETS)
+		&& isSpaceForAnotherReceive())
 	{
-		// Got desired size, send it.
-		usbQueueTransmitPacket(get_report_packet_buffer, desired_transmit_report_length, CONTROL_ENDPOINT_NUMBER, false);
-		do_build_transmit_report = false;
+		interrupt_receives_queued++;
+		usbQueueReceivePacket(RECEIVE_ENDPOINT_NUMBER);
 	}
 }
 
@@ -305,7 +564,21 @@ void ep1ReceiveCallback(uint8_t *packet_buffer, uint32_t length, bool is_setup)
   * IN endpoint (endpoint number #TRANSMIT_ENDPOINT_NUMBER). */
 void ep1TransmitCallback(void)
 {
+	if (interrupt_transmits_queued == 0)
+	{
+		// This should never happen.
+		usbFatalError();
+		return;
+	}
+	// The oldest packet has been transmitted, so its buffer is free.
+	interrupt_transmits_queued--;
+	oldest_interrupt_packet ^= 1;
 	fillTransmitPacketBufferAndTransmit();
+	if ((interrupt_transmits_queued == 0) && isCircularBufferEmpty(&transmit_fifo))
+	{
+		// Nothing left to send, so the host will be NAKed.
+		diagnosticsUSBEvent(TRANSMIT_ENDPOINT_NUMBER, DIAGNOSTICS_USB_FIFO_EMPTY);
+	}
 }
 
 /** Callback which is called whenever a packet is received on the Interrupt
@@ -338,20 +611,23 @@ void ep2ReceiveCallback(uint8_t *packet_buffer, uint32_t length, bool is_setup)
 	}
 	else
 	{
+		if (interrupt_receives_queued == 0)
+		{
+			// This should never happen.
+			usbFatalError();
+		}
+		interrupt_receives_queued--;
 		transferIntoReceiveFIFO(&(packet_buffer[1]), length - 1);
+		diagnosticsUSBFIFODepth(RECEIVE_ENDPOINT_NUMBER, circularBufferBytesUsed(&receive_fifo));
 		// What happens if there isn't enough space in the receive buffer?
 		// Then a receive isn't queued up. This will cause subsequent OUT
 		// transactions to be NAKed, blocking the host. Each
 		// streamGetOneByte() call frees up space in the receive FIFO,
 		// until eventually there is enough space to queue a receive.
-		if (circularBufferSpaceRemaining(&receive_fifo) >= RECEIVE_HEADROOM)
-		{
-			interrupt_receive_queued = true;
-			usbQueueReceivePacket(RECEIVE_ENDPOINT_NUMBER);
-		}
-		else
+		queueInterruptReceives();
+		if (interrupt_receives_queued == 0)
 		{
-			interrupt_receive_queued = false;
+			diagnosticsUSBEvent(RECEIVE_ENDPOINT_NUMBER, DIAGNOSTICS_USB_FIFO_FULL);
 		}
 	}
 }
@@ -364,6 +640,84 @@ void ep2TransmitCallback(void)
 	usbFatalError();
 }
 
+#ifdef USB_VENDOR_BULK
+
+/** Callback which is called whenever a packet is received on the Bulk
+  * IN endpoint (endpoint number #BULK_TRANSMIT_ENDPOINT_NUMBER).
+  * \param packet_buffer The contents of the packet.
+  * \param length The length (in bytes) of the received packet.
+  * \param is_setup Will be true if a SETUP token was received, will
+  *                 be false if a OUT or IN token was received.
+  */
+void ep3ReceiveCallback(uint8_t *packet_buffer, uint32_t length, bool is_setup)
+{
+	// Since this is an IN endpoint, this callback should never be called.
+	usbFatalError();
+}
+
+/** Callback which is called whenever a packet is transmitted on the Bulk
+  * IN endpoint (endpoint number #BULK_TRANSMIT_ENDPOINT_NUMBER). */
+void ep3TransmitCallback(void)
+{
+	if (bulk_transmits_queued == 0)
+	{
+		// This should never happen.
+		usbFatalError();
+		return;
+	}
+	bulk_transmits_queued--;
+	oldest_bulk_packet ^= 1;
+	fillTransmitPacketBufferAndTransmit();
+	if ((bulk_transmits_queued == 0) && isCircularBufferEmpty(&transmit_fifo))
+	{
+		// Nothing left to send, so the host will be NAKed.
+		diagnosticsUSBEvent(BULK_TRANSMIT_ENDPOINT_NUMBER, DIAGNOSTICS_USB_FIFO_EMPTY);
+	}
+}
+
+/** Callback which is called whenever a packet is received on the Bulk
+  * OUT endpoint (endpoint number #BULK_RECEIVE_ENDPOINT_NUMBER). Receiving
+  * anything here switches transmission over to the Bulk IN endpoint.
+  * \param packet_buffer The contents of the packet.
+  * \param length The length (in bytes) of the received packet.
+  * \param is_setup Will be true if a SETUP token was received, will
+  *                 be false if a OUT or IN token was received.
+  * \warning This assumes that there is enough space in the receive FIFO for
+  *          the received packet. There should always be enough space, since
+  *          a receive is never queued unless there is enough space.
+  */
+void ep4ReceiveCallback(uint8_t *packet_buffer, uint32_t length, bool is_setup)
+{
+	if (is_setup || (bulk_receives_queued == 0))
+	{
+		// This should never happen.
+		usbFatalError();
+	}
+	bulk_receives_queued--;
+	use_bulk_transport = true;
+	transferIntoReceiveFIFO(packet_buffer, length);
+	diagnosticsUSBFIFODepth(BULK_RECEIVE_ENDPOINT_NUMBER, circularBufferBytesUsed(&receive_fifo));
+	queueInterruptReceives();
+	if (bulk_receives_queued == 0)
+	{
+		// See ep2ReceiveCallback().
+		diagnosticsUSBEvent(BULK_RECEIVE_ENDPOINT_NUMBER, DIAGNOSTICS_USB_FIFO_FULL);
+	}
+	// Anything which was waiting in the transmit FIFO now goes out the
+	// Bulk IN endpoint.
+	fillTransmitPacketBufferAndTransmit();
+}
+
+/** Callback which is called whenever a packet is transmitted on the Bulk
+  * OUT endpoint (endpoint number #BULK_RECEIVE_ENDPOINT_NUMBER). */
+void ep4TransmitCallback(void)
+{
+	// Since this is the OUT endpoint, this callback should never be called.
+	usbFatalError();
+}
+
+#endif // #ifdef USB_VENDOR_BULK
+
 /** HID class-specific "Get Descriptor" request, as defined in section 7.1.1
   * of the HID specification. This allows the host to retrieve HID
   * class-specific information about a USB device.
@@ -400,6 +754,9 @@ static void getDescriptor(uint8_t type, uint8_t index, uint16_t lang_id, uint16_
 /** HID class-specific "Get Report" request, as defined in section 7.2.1
   * of the HID specification. This is an alternative way for the host to
   * receive reports from a device, as opposed to the usual method of polling
+  * the Interrupt IN endpoint. The first one of these switches transmission
+  * over to the control endpoint for good (well, until the device is
+  * unconfigured or reset), since a host which uses it probably can't use
   * the Interrupt IN endpoint.
   * \param report_id Report ID of the desired report. For this driver, this
   *                  means the number of data bytes in the report.
@@ -422,41 +779,26 @@ static void getReport(uint8_t report_id, uint16_t length)
 	}
 	else
 	{
-		// Build a report and send it.
-		do_build_transmit_report = true;
-		current_transmit_report_length = 0;
-		desired_transmit_report_length = length;
-		buildTransmitReport(report_id);
-		// Two ways this loop can end:
-		// 1. The report length reaches the desired length, in which case the
-		//    report is sent and do_build_transmit_report is set to false.
-		// 2. The transmit interrupt report buffer is emptied, in which
-		//    case interrupt_transmit_queued will be set to 0. Further bytes
-		//    will have to come from somewhere else.
-		while (interrupt_transmit_queued && do_build_transmit_report)
-		{
-			buildTransmitReport(stealByteFromInterruptReport());
-		}
-		// Two ways this loop can end:
-		// 1. The report length reaches the desired length, in which case the
-		//    report is sent and do_build_transmit_report is set to false.
-		// 2. The transmit FIFO is emptied before the report reaches the
-		//    desired size, so nothing is sent and do_build_transmit_report
-		//    remains set to true. streamPutOneByte() will handle the rest.
-		while (!isCircularBufferEmpty(&transmit_fifo) && do_build_transmit_report)
-		{
-			buildTransmitReport(circularBufferRead(&transmit_fifo, true));
-		}
-		// If the control request ate up the entire interrupt transmit
-		// report but left the transmit FIFO full, streamPutOneByte() will
-		// deadlock. This is because it waits for the transmit FIFO to become
-		// not full, yet there is no interrupt transmit queued to consume
-		// the transmit FIFO. Thus to avoid this deadlock, queue an interrupt
-		// transmit if there is anything in the transmit FIFO.
-		if (!interrupt_transmit_queued)
+		if (!use_control_transport)
 		{
-			fillTransmitPacketBufferAndTransmit();
+			use_control_transport = true;
+			// Anything already queued on the Interrupt IN endpoint is sent
+			// in this (and maybe the next) report instead; see
+			// fillTransmitReport().
+			if (interrupt_transmits_queued > 0)
+			{
+				usbCancelTransmit(TRANSMIT_ENDPOINT_NUMBER);
+			}
+			interrupt_packet_offset = 0;
 		}
+		get_report_packet_buffer[0] = report_id;
+		current_transmit_report_length = 1;
+		desired_transmit_report_length = length;
+		do_build_transmit_report = true;
+		// If there isn't enough to fill the report yet, the rest is added
+		// as streamPutOneByte() or streamPutBytes() write it; until then,
+		// the host is NAKed.
+		fillTransmitReport();
 	}
 }
 
@@ -487,7 +829,7 @@ static void setReport(uint8_t report_id, uint16_t length)
 		usbControlNextStage();
 		expected_control_report_id = report_id;
 		expect_control_report = true;
-		if (circularBufferSpaceRemaining(&receive_fifo) < RECEIVE_HEADROOM)
+		if (!isSpaceForAnotherReceive())
 		{
 			// Not enough space in receive FIFO to handle request.
 			usbSuppressControlReceive(); // do not immediately proceed to Data stage
@@ -607,18 +949,38 @@ void usbClassSetConfiguration(uint8_t new_configuration_value)
 	if ((old_configuration_value == 0) && (new_configuration_value != 0))
 	{
 		// Transition from unconfigured to configured.
-		interrupt_transmit_queued = false;
-		interrupt_receive_queued = true;
+		use_control_transport = false;
+		interrupt_packet_offset = 0;
+		interrupt_transmits_queued = 0;
+		interrupt_receives_queued = 1; // usbEnableEndpoint() queues one
+		oldest_interrupt_packet = 0;
 		usbEnableEndpoint(TRANSMIT_ENDPOINT_NUMBER, IN_ENDPOINT, &transmit_endpoint_state);
 		usbEnableEndpoint(RECEIVE_ENDPOINT_NUMBER, OUT_ENDPOINT, &receive_endpoint_state);
+#ifdef USB_VENDOR_BULK
+		use_bulk_transport = false;
+		bulk_transfer_unterminated = false;
+		bulk_transmits_queued = 0;
+		bulk_receives_queued = 1; // usbEnableEndpoint() queues one
+		oldest_bulk_packet = 0;
+		usbEnableEndpoint(BULK_TRANSMIT_ENDPOINT_NUMBER, IN_ENDPOINT, &bulk_transmit_endpoint_state);
+		usbEnableEndpoint(BULK_RECEIVE_ENDPOINT_NUMBER, OUT_ENDPOINT, &bulk_receive_endpoint_state);
+#endif // #ifdef USB_VENDOR_BULK
 	}
 	else if ((old_configuration_value != 0) && (new_configuration_value == 0))
 	{
 		// Transition from configured to unconfigured.
 		usbDisableEndpoint(TRANSMIT_ENDPOINT_NUMBER);
 		usbDisableEndpoint(RECEIVE_ENDPOINT_NUMBER);
-		interrupt_transmit_queued = false;
-		interrupt_receive_queued = false;
+		use_control_transport = false;
+		interrupt_transmits_queued = 0;
+		interrupt_receives_queued = 0;
+#ifdef USB_VENDOR_BULK
+		usbDisableEndpoint(BULK_TRANSMIT_ENDPOINT_NUMBER);
+		usbDisableEndpoint(BULK_RECEIVE_ENDPOINT_NUMBER);
+		use_bulk_transport = false;
+		bulk_transmits_queued = 0;
+		bulk_receives_queued = 0;
+#endif // #ifdef USB_VENDOR_BULK
 		usbClassAbortControlTransfer(); // will reset state
 	}
 	old_configuration_value = new_configuration_value;
@@ -645,6 +1007,121 @@ void usbHIDStreamInit(void)
 	transmit_endpoint_state.transmitCallback = &ep1TransmitCallback;
 	receive_endpoint_state.receiveCallback = &ep2ReceiveCallback;
 	receive_endpoint_state.transmitCallback = &ep2TransmitCallback;
+#ifdef USB_VENDOR_BULK
+	bulk_transmit_endpoint_state.receiveCallback = &ep3ReceiveCallback;
+	bulk_transmit_endpoint_state.transmitCallback = &ep3TransmitCallback;
+	bulk_receive_endpoint_state.receiveCallback = &ep4ReceiveCallback;
+	bulk_receive_endpoint_state.transmitCallback = &ep4TransmitCallback;
+#endif // #ifdef USB_VENDOR_BULK
+}
+
+/** Queue a receive (on either the control endpoint or the Interrupt OUT
+  * endpoint) if one is needed and there is now enough space in the receive
+  * FIFO. This should be called every time bytes are removed from the receive
+  * FIFO. */
+static void queueReceiveIfSpaceAvailable(void)
+{
+	uint32_t status;
+
+	// While the receive FIFO is above the low watermark, there's no room
+	// for another receive, so don't bother with the critical section below.
+	// If the flag is set just after this check, a later call will see it,
+	// since there are still bytes left to read.
+	if (!do_control_receive_queue && (circularBufferBytesUsed(&receive_fifo) > RECEIVE_LOW_WATERMARK))
+	{
+		return;
+	}
+	// It's probably safe to leave interrupts enabled, but just to be sure,
+	// disable them so that no race conditions can occur.
+	status = disableInterrupts();
+	// Control transfers take precedence over interrupt transfers, because
+	// a control transfer will block all subsequent control transfers, which
+	// would make device reconfiguration difficult.
+	if (do_control_receive_queue)
+	{
+		if (isSpaceForAnotherReceive())
+		{
+			do_control_receive_queue = false;
+			usbQueueReceivePacket(CONTROL_ENDPOINT_NUMBER);
+		}
+	}
+	else if (usbIsEndpointEnabled(RECEIVE_ENDPOINT_NUMBER))
+	{
+		queueInterruptReceives();
+	}
+	restoreInterrupts(status);
+}
+
+/** Send everything in the transmit FIFO, even if it's less
+  * than #TRANSMIT_HIGH_WATERMARK bytes. This must be done before the device
+  * waits for (or checks for) anything from the host, since the host may be
+  * waiting for those bytes before it sends anything.
+  */
+static void flushTransmitFIFO(void)
+{
+	if (!isCircularBufferEmpty(&transmit_fifo))
+	{
+		transmit_flush_requested = true;
+		fillTransmitPacketBufferAndTransmit();
+	}
+}
+
+/** Wait until there is at least one byte in the receive FIFO. The circular
+  * buffer functions would wait anyway; this flushes the transmit FIFO first
+  * and records the wait in the trace buffer (see trace.c), since it is time
+  * spent waiting for the host.
+  */
+static void waitForReceiveData(void)
+{
+	if (isCircularBufferEmpty(&receive_fifo))
+	{
+		flushTransmitFIFO();
+		traceEvent(TRACE_RX_WAIT_BEGIN, 0);
+		while (isCircularBufferEmpty(&receive_fifo))
+		{
+			enterIdleMode();
+		}
+		traceEvent(TRACE_RX_WAIT_END, 0);
+	}
+}
+
+#ifdef ENABLE_DIAGNOSTICS
+/** Get the endpoint which bytes in the transmit FIFO will go out of, so
+  * that transmit FIFO statistics can be attributed to it.
+  * \return The endpoint number.
+  */
+static unsigned int getTransmitEndpoint(void)
+{
+#ifdef USB_VENDOR_BULK
+	if (use_bulk_transport)
+	{
+		return BULK_TRANSMIT_ENDPOINT_NUMBER;
+	}
+#endif // #ifdef USB_VENDOR_BULK
+	if (use_control_transport)
+	{
+		return CONTROL_ENDPOINT_NUMBER;
+	}
+	return TRANSMIT_ENDPOINT_NUMBER;
+}
+#endif // #ifdef ENABLE_DIAGNOSTICS
+
+/** Wait until there is space for at least one byte in the transmit FIFO.
+  * Like waitForReceiveData(), this records the wait in the trace buffer.
+  * The wait is also counted in the diagnostics for the transmit endpoint.
+  */
+static void waitForTransmitSpace(void)
+{
+	if (isCircularBufferFull(&transmit_fifo))
+	{
+		diagnosticsUSBEvent(getTransmitEndpoint(), DIAGNOSTICS_USB_FIFO_FULL);
+		traceEvent(TRACE_TX_WAIT_BEGIN, 0);
+		while (isCircularBufferFull(&transmit_fifo))
+		{
+			enterIdleMode();
+		}
+		traceEvent(TRACE_TX_WAIT_END, 0);
+	}
 }
 
 /** Grab one byte from the communication stream. There is no way for this
@@ -672,34 +1149,72 @@ void usbHIDStreamInit(void)
   */
 uint8_t streamGetOneByte(void)
 {
-	uint32_t status;
 	uint8_t one_byte;
 
+	waitForReceiveData();
 	one_byte = circularBufferRead(&receive_fifo, false);
-	// It's probably safe to leave interrupts enabled, but just to be sure,
-	// disable them so that no race conditions can occur.
-	status = disableInterrupts();
-	// Control transfers take precedence over interrupt transfers, because
-	// a control transfer will block all subsequent control transfers, which
-	// would make device reconfiguration difficult.
-	if (do_control_receive_queue)
+	queueReceiveIfSpaceAvailable();
+	return one_byte;
+}
+
+/** Grab a number of bytes from the communication stream. This behaves
+  * exactly like calling streamGetOneByte() length times, but bytes are
+  * removed from the receive FIFO in chunks.
+  * \param buffer The received bytes will be written here. This must have
+  *               space for length bytes.
+  * \param length The number of bytes to receive.
+  */
+void streamGetBytes(uint8_t *buffer, uint32_t length)
+{
+	uint32_t count;
+
+	while (length > 0)
 	{
-		if (circularBufferSpaceRemaining(&receive_fifo) >= RECEIVE_HEADROOM)
-		{
-			do_control_receive_queue = false;
-			usbQueueReceivePacket(CONTROL_ENDPOINT_NUMBER);
-		}
+		waitForReceiveData();
+		count = circularBufferReadBytes(&receive_fifo, buffer, length, false);
+		queueReceiveIfSpaceAvailable();
+		buffer += count;
+		length -= count;
 	}
-	else if (!interrupt_receive_queued)
+}
+
+/** Throw away a number of bytes from the communication stream. This behaves
+  * exactly like streamGetBytes(), but whatever is in the receive FIFO is
+  * dropped in one go, so the FIFO empties and the next receive is queued
+  * as soon as each report arrives.
+  * \param length The number of bytes to throw away.
+  */
+void streamDiscardBytes(uint32_t length)
+{
+	uint32_t count;
+
+	while (length > 0)
 	{
-		if (circularBufferSpaceRemaining(&receive_fifo) >= RECEIVE_HEADROOM)
-		{
-			interrupt_receive_queued = true;
-			usbQueueReceivePacket(RECEIVE_ENDPOINT_NUMBER);
-		}
+		waitForReceiveData();
+		count = circularBufferDiscardBytes(&receive_fifo, length, false);
+		queueReceiveIfSpaceAvailable();
+		length -= count;
+	}
+}
+
+/** Check whether there is at least one byte in the receive FIFO. If there
+  * isn't, the transmit FIFO is flushed, since this is polled during
+  * long-running operations and the host may be waiting for a response (eg.
+  * to GetProgress) before it sends anything else.
+  * \return true if streamGetOneByte() would return without waiting, false
+  *         otherwise.
+  */
+bool streamIsByteAvailable(void)
+{
+	if (isCircularBufferEmpty(&receive_fifo))
+	{
+		flushTransmitFIFO();
+		return false;
+	}
+	else
+	{
+		return true;
 	}
-	restoreInterrupts(status);
-	return one_byte;
 }
 
 /** Send one byte to the communication stream. There is no way for this
@@ -718,35 +1233,51 @@ void streamPutOneByte(uint8_t one_byte)
 
 	// Ensure that there is space in the transmit FIFO so that the call to
 	// circularBufferWrite() below cannot fail.
-	while (isCircularBufferFull(&transmit_fifo))
-	{
-		enterIdleMode();
-	}
+	waitForTransmitSpace();
 	// Everything below is in a critical section to avoid race conditions
 	// with the "Get Report" request.
 	status = disableInterrupts();
-	if (do_build_transmit_report)
-	{
-		// Keep adding bytes to the transmit report until it reaches the
-		// desired length.
-		buildTransmitReport(one_byte);
-	}
-	else
-	{
-		// Since transmitted bytes are fed to this function one-at-a-time,
-		// there's no way to determine whether there are bytes after this one
-		// or not. So this function will just transmit the first byte in a
-		// packet all by itself (which isn't very efficient). If there are
-		// bytes immediately after this one, they will queue up in the transmit
-		// FIFO, where they will be efficiently grouped into a packet by
-		// ep1TransmitCallback().
-		// Note that is_irq is set because interrupts are disabled; that's
-		// equivalent to an interrupt request handler context.
-		circularBufferWrite(&transmit_fifo, one_byte, true);
-	}
-	if (!interrupt_transmit_queued)
+	// Since transmitted bytes are fed to this function one-at-a-time,
+	// there's no way to determine whether there are bytes after this one
+	// or not. So this function will just transmit the first byte in a
+	// packet all by itself (which isn't very efficient). If there are
+	// bytes immediately after this one, they will queue up in the transmit
+	// FIFO, where they will be efficiently grouped into a packet by
+	// ep1TransmitCallback().
+	// Note that is_irq is set because interrupts are disabled; that's
+	// equivalent to an interrupt request handler context.
+	circularBufferWrite(&transmit_fifo, one_byte, true);
+	diagnosticsUSBFIFODepth(getTransmitEndpoint(), circularBufferBytesUsed(&transmit_fifo));
+	// This does nothing if enough packets are already queued (on whichever
+	// endpoint is being used for transmission). If a "Get Report" request
+	// is waiting, this adds the byte to its report.
+	fillTransmitPacketBufferAndTransmit();
+	restoreInterrupts(status);
+}
+
+/** Send a number of bytes to the communication stream. This behaves exactly
+  * like calling streamPutOneByte() length times, but bytes are added to the
+  * transmit FIFO in chunks. Since the FIFO then contains the whole chunk by
+  * the time a transmit is queued, this also avoids sending the first byte
+  * of each chunk in a packet all by itself.
+  * \param buffer The bytes to send.
+  * \param length The number of bytes to send.
+  */
+void streamPutBytes(const uint8_t *buffer, uint32_t length)
+{
+	uint32_t status;
+	uint32_t count;
+
+	while (length > 0)
 	{
+		// See streamPutOneByte() for why this is needed.
+		waitForTransmitSpace();
+		status = disableInterrupts();
+		count = circularBufferWriteBytes(&transmit_fifo, buffer, length, true);
+		diagnosticsUSBFIFODepth(getTransmitEndpoint(), circularBufferBytesUsed(&transmit_fifo));
 		fillTransmitPacketBufferAndTransmit();
+		restoreInterrupts(status);
+		buffer += count;
+		length -= count;
 	}
-	restoreInterrupts(status);
 }
@@ -14,6 +14,7 @@
 #include "../hwinterface.h"
 #include "../baseconv.h"
 #include "../prandom.h"
+#include "../wallet.h"
 #include "ssd1306.h"
 #include "pushbuttons.h"
 
@@ -23,20 +24,92 @@
   */
 #define MAX_OUTPUTS		16
 
+#ifdef DEFER_OUTPUT_FORMATTING
+/** Storage for transaction outputs, in binary form. These are only converted
+  * to text when they are displayed. */
+static OutputDescriptor list_output[MAX_OUTPUTS];
+#else
 /** Storage for the text of transaction output amounts. */
 static char list_amount[MAX_OUTPUTS][TEXT_AMOUNT_LENGTH];
 /** Storage for the text of transaction output addresses. */
 static char list_address[MAX_OUTPUTS][TEXT_ADDRESS_LENGTH];
-/** Index into #list_amount and #list_address which specifies where the next
-  * output amount/address will be copied into. */
+#endif // #ifdef DEFER_OUTPUT_FORMATTING
+/** Index into the output list which specifies where the next output will be
+  * copied into. */
 static uint32_t list_index;
 /** Whether the transaction fee has been set. If
   * the transaction fee still hasn't been set after parsing, then the
   * transaction is free. */
 static bool transaction_fee_set;
+#ifdef DEFER_OUTPUT_FORMATTING
+/** Storage for transaction fee amount, as a 64 bit, unsigned, little-endian
+  * integer. This is only valid if #transaction_fee_set is true. */
+static uint8_t transaction_fee_amount[8];
+#else
 /** Storage for transaction fee amount. This is only valid
   * if #transaction_fee_set is true. */
 static char transaction_fee_amount[TEXT_AMOUNT_LENGTH];
+#endif // #ifdef DEFER_OUTPUT_FORMATTING
+
+#ifdef DEFER_OUTPUT_FORMATTING
+
+/** Notify the user interface that the transaction parser has seen a new
+  * transaction output. Outputs which pay back to the currently loaded
+  * wallet (change) aren't stored, since the user doesn't need to approve
+  * them; see isOwnAddress().
+  * \param output The transaction output. This will be copied.
+  * \return false if no error occurred, true if there was not enough space to
+  *         store the output.
+  */
+bool newOutputSeen(OutputDescriptor *output)
+{
+	if ((output->address_version == ADDRESS_VERSION_PUBKEY) && isOwnAddress(output->hash))
+	{
+		return false; // change
+	}
+	if (list_index >= MAX_OUTPUTS)
+	{
+		return true; // not enough space to store the output
+	}
+	memcpy(&(list_output[list_index]), output, sizeof(OutputDescriptor));
+	list_index++;
+	return false; // success
+}
+
+/** Notify the user interface that the transaction parser has seen the
+  * transaction fee. If there is no transaction fee, the transaction parser
+  * will not call this.
+  * \param amount The transaction fee, in 10 ^ -8 BTC, as a 64 bit, unsigned,
+  *               little-endian integer.
+  */
+void setTransactionFee(uint8_t *amount)
+{
+	memcpy(transaction_fee_amount, amount, sizeof(transaction_fee_amount));
+	transaction_fee_set = true;
+}
+
+/** Get the text of one of the stored transaction outputs.
+  * \param text_amount The amount will be written here. This must have space
+  *                    for #TEXT_AMOUNT_LENGTH characters.
+  * \param text_address The address will be written here. This must have
+  *                     space for #TEXT_ADDRESS_LENGTH characters.
+  * \param index Index of the output in the output list.
+  */
+static void getOutputText(char *text_amount, char *text_address, uint32_t index)
+{
+	outputDescriptorToText(text_amount, text_address, &(list_output[index]));
+}
+
+/** Get the text of the stored transaction fee.
+  * \param text_amount The fee will be written here. This must have space
+  *                    for #TEXT_AMOUNT_LENGTH characters.
+  */
+static void getTransactionFeeText(char *text_amount)
+{
+	amountToText(text_amount, transaction_fee_amount);
+}
+
+#else
 
 /** Notify the user interface that the transaction parser has seen a new
   * Bitcoin amount/address pair.
@@ -79,6 +152,30 @@ void setTransactionFee(char *text_amount)
 	transaction_fee_set = true;
 }
 
+/** Get the text of one of the stored transaction outputs.
+  * \param text_amount The amount will be written here. This must have space
+  *                    for #TEXT_AMOUNT_LENGTH characters.
+  * \param text_address The address will be written here. This must have
+  *                     space for #TEXT_ADDRESS_LENGTH characters.
+  * \param index Index of the output in the output list.
+  */
+static void getOutputText(char *text_amount, char *text_address, uint32_t index)
+{
+	strcpy(text_amount, list_amount[index]);
+	strcpy(text_address, list_address[index]);
+}
+
+/** Get the text of the stored transaction fee.
+  * \param text_amount The fee will be written here. This must have space
+  *                    for #TEXT_AMOUNT_LENGTH characters.
+  */
+static void getTransactionFeeText(char *text_amount)
+{
+	strcpy(text_amount, transaction_fee_amount);
+}
+
+#endif // #ifdef DEFER_OUTPUT_FORMATTING
+
 /** Notify the user interface that the list of Bitcoin amount/address pairs
   * should be cleared. */
 void clearOutputsSeen(void)
@@ -128,6 +225,10 @@ static void displayAction(AskUserCommand command)
     {
         writeStringToDisplayWordWrap("Delete existing wallet?");
     }
+	else if (command == ASKUSER_KEEP_UNLOCKED)
+	{
+		writeStringToDisplayWordWrap("Keep wallet unlocked across sessions?");
+	}
 	else
 	{
 		writeStringToDisplayWordWrap("Unknown command");
@@ -142,6 +243,8 @@ bool userDenied(AskUserCommand command)
 {
 	uint8_t i;
 	bool r; // what will be returned
+	char text_amount[TEXT_AMOUNT_LENGTH];
+	char text_address[TEXT_ADDRESS_LENGTH];
 
 	clearDisplay();
 	displayOn();
@@ -157,6 +260,7 @@ bool userDenied(AskUserCommand command)
     case ASKUSER_CHANGE_KEY:
     case ASKUSER_GET_MASTER_KEY:
     case ASKUSER_DELETE_WALLET:
+    case ASKUSER_KEEP_UNLOCKED:
         waitForNoButtonPress();
 		displayAction(command);
 		r = waitForButtonPress();
@@ -166,12 +270,13 @@ bool userDenied(AskUserCommand command)
 		// wrapping wastes too much display space.
 		for (i = 0; i < list_index; i++)
 		{
+			getOutputText(text_amount, text_address, i);
 			clearDisplay();
 			waitForNoButtonPress();
 			writeStringToDisplay("Send ");
-			writeStringToDisplay(list_amount[i]);
+			writeStringToDisplay(text_amount);
 			writeStringToDisplay(" BTC to ");
-			writeStringToDisplay(list_address[i]);
+			writeStringToDisplay(text_address);
 			writeStringToDisplay("?");
 			r = waitForButtonPress();
 			if (r)
@@ -184,11 +289,12 @@ bool userDenied(AskUserCommand command)
 		}
 		if (!r && transaction_fee_set)
 		{
+			getTransactionFeeText(text_amount);
 			clearDisplay();
 			waitForNoButtonPress();
 			writeStringToDisplay("Transaction fee:");
 			nextLine();
-			writeStringToDisplay(transaction_fee_amount);
+			writeStringToDisplay(text_amount);
 			writeStringToDisplay(" BTC.");
 			nextLine();
 			writeStringToDisplay("Is this okay?");
@@ -32,6 +32,7 @@
 #include "transaction.h"
 #include "prandom.h"
 #include "hwinterface.h"
+#include "scratch.h"
 #include "storage_common.h"
 
 #ifdef TEST_PRANDOM
@@ -39,13 +40,21 @@
 #include "wallet.h"
 #endif // #ifdef TEST_PRANDOM
 
-/** Because stdlib.h might not be included, NULL might be undefined. NULL
-  * is only used as a placeholder pointer for getRandom256Internal() if
-  * there is no appropriate pointer. */
+/** Because stdlib.h might not be included, NULL might be undefined. */
 #ifndef NULL
 #define NULL ((void *)0) 
 #endif // #ifndef NULL
 
+#ifndef ENTROPY_POOL_PERSIST_INTERVAL
+/** Number of getRandom256() calls between writes of the RAM-cached entropy
+  * pool (see #cached_pool_state) to non-volatile memory. Larger values mean
+  * fewer non-volatile memory writes, at the cost of losing more accumulated
+  * HWRNG entropy if the device loses power before the next write.
+  * \warning This must be >= 1.
+  */
+#define ENTROPY_POOL_PERSIST_INTERVAL	16
+#endif // #ifndef ENTROPY_POOL_PERSIST_INTERVAL
+
 /** The parent public key for the BIP 0032 deterministic key generator (see
   * generateDeterministic256()). The contents of this variable are only valid
   * if #cached_parent_public_key_valid is true.
@@ -57,9 +66,43 @@
   * a cache.
   * \warning The x and y components are stored in little-endian format.
   */
-static PointAffine cached_parent_public_key;
+static THREAD_LOCAL PointAffine cached_parent_public_key;
 /** Specifies whether the contents of #parent_public_key are valid. */
-static bool cached_parent_public_key_valid;
+static THREAD_LOCAL bool cached_parent_public_key_valid;
+
+#if defined(TEST_PRANDOM) || defined(TEST_WALLET) || defined(HOSTLIB)
+/** Comb table (see buildPointCombTable()) of #comb_table_public_key, which
+  * lets publicKeyFromHmac() multiply a parent public key at fixed-base speed
+  * instead of using the generic pointMultiply(). The table is built the
+  * first time a parent public key is used, and kept until a different one
+  * is used or clearParentPublicKeyCache() is called, so deriving many public
+  * keys of the same wallet only builds it once. Only public key derivation
+  * (which the device itself never does) needs this, so it isn't included in
+  * firmware. The contents of this variable are only valid
+  * if #comb_table_valid is true. */
+static THREAD_LOCAL PointCombTable comb_table;
+/** The parent public key which #comb_table was built from. */
+static THREAD_LOCAL PointAffine comb_table_public_key;
+/** Specifies whether the contents of #comb_table are valid. */
+static THREAD_LOCAL bool comb_table_valid;
+#endif // #if defined(TEST_PRANDOM) || defined(TEST_WALLET) || defined(HOSTLIB)
+
+/** RAM copy of the state of the persistent entropy pool, which getRandom256()
+  * uses so that it doesn't need a non-volatile memory read and write per
+  * call. The contents of this variable are only valid
+  * if #is_pool_cached is true.
+  *
+  * The state written to non-volatile memory is never this state itself, but
+  * H(state | padding) (with a different padding from getRandom256Internal()).
+  * That way, the state which will be loaded after a power loss has never been
+  * used to generate outputs, even if the last few updates of the RAM state
+  * never made it to non-volatile memory. */
+static THREAD_LOCAL uint8_t cached_pool_state[ENTROPY_POOL_LENGTH];
+/** Specifies whether the contents of #cached_pool_state are valid. */
+static THREAD_LOCAL bool is_pool_cached;
+/** Number of getRandom256() calls since #cached_pool_state was last
+  * written to non-volatile memory. */
+static THREAD_LOCAL uint32_t draws_since_persist;
 
 #ifdef TEST_PRANDOM
 /** Hack to allow test to access derived chain code. This is needed for the
@@ -77,13 +120,28 @@ static uint8_t test_chain_code[32];
   */
 static void setParentPublicKeyFromPrivateKey(BigNum256 parent_private_key)
 {
-	setToG(&cached_parent_public_key);
-	pointMultiply(&cached_parent_public_key, parent_private_key);
+	pointMultiplyBase(&cached_parent_public_key, parent_private_key);
+	cached_parent_public_key_valid = true;
+}
+
+/** Set the parent public key for the deterministic key generator (see
+  * generateDeterministic256()) directly, without deriving it from the parent
+  * private key. This is for callers which have kept a copy of the parent
+  * public key somewhere (for example, in a wallet record), since it avoids
+  * the point multiplication that setParentPublicKeyFromPrivateKey() does.
+  * \param parent_public_key The parent public key. This must correspond to
+  *                          the parent private key of the seed which will
+  *                          be passed to generateDeterministic256().
+  */
+void setParentPublicKey(const PointAffine *parent_public_key)
+{
+	memcpy(&cached_parent_public_key, parent_public_key, sizeof(cached_parent_public_key));
 	cached_parent_public_key_valid = true;
 }
 
-/** Clear the parent public key cache (see #parent_private_key). This should
-  * be called whenever a wallet is unloaded, so that subsequent calls to
+/** Clear the parent public key cache (see #parent_private_key), and the comb
+  * table used for public key derivation. This should be called whenever a
+  * wallet is unloaded, so that subsequent calls to
   * generateDeterministic256() don't result in addresses from the old wallet.
   */
 void clearParentPublicKeyCache(void)
@@ -91,6 +149,11 @@ void clearParentPublicKeyCache(void)
 	memset(&cached_parent_public_key, 0xff, sizeof(cached_parent_public_key)); // just to be sure
 	memset(&cached_parent_public_key, 0, sizeof(cached_parent_public_key));
 	cached_parent_public_key_valid = false;
+#if defined(TEST_PRANDOM) || defined(TEST_WALLET) || defined(HOSTLIB)
+	memset(&comb_table, 0, sizeof(comb_table));
+	memset(&comb_table_public_key, 0, sizeof(comb_table_public_key));
+	comb_table_valid = false;
+#endif // #if defined(TEST_PRANDOM) || defined(TEST_WALLET) || defined(HOSTLIB)
 }
 
 /** Calculate the entropy pool checksum of an entropy pool state.
@@ -113,16 +176,13 @@ static void calculateEntropyPoolChecksum(uint8_t *out, uint8_t *pool_state)
 {
 	HashState hs;
 	uint8_t hash[32];
-	uint8_t i;
 
 	// RIPEMD-160 is used instead of SHA-256 because SHA-256 is already used
 	// by getRandom256() to generate output values from the pool state.
-	ripemd160Begin(&hs);
-	for (i = 0; i < ENTROPY_POOL_LENGTH; i++)
-	{
-		ripemd160WriteByte(&hs, pool_state[i]);
-	}
-	ripemd160Finish(&hs);
+#if ENTROPY_POOL_LENGTH > HASH_SHORT_MESSAGE_MAX
+#error "ENTROPY_POOL_LENGTH is too big for ripemd160Short()"
+#endif
+	ripemd160Short(&hs, pool_state, ENTROPY_POOL_LENGTH);
 	writeHashToByteArray(hash, &hs, true);
 #if POOL_CHECKSUM_LENGTH > 20
 #error "POOL_CHECKSUM_LENGTH is bigger than RIPEMD-160 hash size"
@@ -130,14 +190,26 @@ static void calculateEntropyPoolChecksum(uint8_t *out, uint8_t *pool_state)
 	memcpy(out, hash, POOL_CHECKSUM_LENGTH);
 }
 
-/** Set (overwrite) the persistent entropy pool.
+/** Discard the RAM-cached entropy pool state (see #cached_pool_state), so
+  * that the next call to getRandom256() will load the persistent entropy pool
+  * from non-volatile memory. */
+static void invalidateEntropyPoolCache(void)
+{
+	memset(cached_pool_state, 0xff, sizeof(cached_pool_state)); // just to be sure
+	memset(cached_pool_state, 0, sizeof(cached_pool_state));
+	is_pool_cached = false;
+	draws_since_persist = 0;
+}
+
+/** Write an entropy pool state and its checksum to non-volatile memory. This
+  * does not touch the RAM-cached state.
   * \param in_pool_state A byte array specifying the desired contents of the
   *                      persistent entropy pool. This must have a length
   *                      of #ENTROPY_POOL_LENGTH bytes.
   * \return false on success, true if an error (couldn't write to non-volatile
   *         memory) occurred.
   */
-bool setEntropyPool(uint8_t *in_pool_state)
+static bool writeEntropyPool(uint8_t *in_pool_state)
 {
 	uint8_t checksum[POOL_CHECKSUM_LENGTH];
 
@@ -157,6 +229,82 @@ bool setEntropyPool(uint8_t *in_pool_state)
 	return false; // success
 }
 
+/** Set (overwrite) the persistent entropy pool. This also discards the
+  * RAM-cached state, so that getRandom256() picks up the new state.
+  * \param in_pool_state A byte array specifying the desired contents of the
+  *                      persistent entropy pool. This must have a length
+  *                      of #ENTROPY_POOL_LENGTH bytes.
+  * \return false on success, true if an error (couldn't write to non-volatile
+  *         memory) occurred.
+  */
+bool setEntropyPool(uint8_t *in_pool_state)
+{
+	invalidateEntropyPoolCache();
+	return writeEntropyPool(in_pool_state);
+}
+
+/** Write the RAM-cached entropy pool state to non-volatile memory, in the
+  * form H(state | padding), where H(x) is the SHA-256 hash of x and padding
+  * consists of 32 0x43 bytes. See #cached_pool_state for why the state isn't
+  * written directly.
+  * \return false on success, true if an error (couldn't write to non-volatile
+  *         memory) occurred.
+  */
+static bool persistCachedEntropyPool(void)
+{
+	HashState hs;
+	uint8_t persisted_state[32];
+	uint8_t i;
+	bool r;
+
+	sha256Begin(&hs);
+	for (i = 0; i < ENTROPY_POOL_LENGTH; i++)
+	{
+		sha256WriteByte(&hs, cached_pool_state[i]);
+	}
+	for (i = 0; i < 32; i++)
+	{
+		sha256WriteByte(&hs, 0x43); // padding
+	}
+	sha256Finish(&hs);
+	writeHashToByteArray(persisted_state, &hs, true);
+	r = writeEntropyPool(persisted_state);
+	memset(persisted_state, 0, sizeof(persisted_state));
+	if (!r)
+	{
+		draws_since_persist = 0;
+	}
+	return r;
+}
+
+/** Write the RAM-cached entropy pool state to non-volatile memory now, instead
+  * of waiting for the next periodic write (see
+  * #ENTROPY_POOL_PERSIST_INTERVAL). getRandom256() is safe without this,
+  * but calling it (for example, before a planned power down) preserves
+  * HWRNG entropy accumulated since the last write.
+  * \return false on success, true if an error (couldn't write to non-volatile
+  *         memory) occurred.
+  */
+bool flushEntropyPool(void)
+{
+	if (is_pool_cached && (draws_since_persist > 0))
+	{
+		return persistCachedEntropyPool();
+	}
+	return false; // nothing to do
+}
+
+/** Background task (see addBackgroundTask()) which calls flushEntropyPool(),
+  * so that entropy accumulated while handling a request reaches
+  * non-volatile memory once the device goes idle, instead of being lost if
+  * the device is unplugged before the next periodic write. A failed write
+  * is ignored; the next call will try again.
+  */
+void flushEntropyPoolWhenIdle(void)
+{
+	flushEntropyPool();
+}
+
 /** Obtain the contents of the persistent entropy pool.
   * \param out_pool_state A byte array specifying where the contents of the
   *                       persistent entropy pool should be placed. This must
@@ -245,31 +393,20 @@ bool initialiseEntropyPool(uint8_t *initial_pool_state)
   * of random bits ensures that outputs will still be unpredictable, albeit
   * not strictly meeting their advertised amount of entropy.
   * \param n The final 256 bit random value will be written here.
-  * \param pool_state If use_pool_state is true, then the the state of the
-  *                   persistent entropy pool will be read from and written to
-  *                   this byte array. The byte array must be of
-  *                   length #ENTROPY_POOL_LENGTH bytes. If use_pool_state is
-  *                   false, this parameter will be ignored.
-  * \param use_pool_state Specifies whether to use RAM (true) or
-  *                       non-volatile memory (false) to access the persistent
-  *                       entropy pool. If this is true, the persistent
-  *                       entropy pool will be read/written from/to the byte
-  *                       array specified by pool_state. If this is false, the
-  *                       persistent entropy pool will be read/written from/to
-  *                       non-volatile memory. The option of using RAM is
-  *                       provided for cases where random numbers are needed
-  *                       but non-volatile memory is being cleared.
-  * \return false on success, true if an error (couldn't access
-  *         non-volatile memory, or invalid entropy pool checksum) occurred.
+  * \param pool_state The state of the entropy pool will be read from and
+  *                   written to this byte array. The byte array must be of
+  *                   length #ENTROPY_POOL_LENGTH bytes. Callers are
+  *                   responsible for loading it from and saving it to
+  *                   non-volatile memory, if appropriate.
+  * \return false on success, true if an error (HWRNG failure) occurred.
   */
-static bool getRandom256Internal(BigNum256 n, uint8_t *pool_state, bool use_pool_state)
+static bool getRandom256Internal(BigNum256 n, uint8_t *pool_state)
 {
 	int r;
 	uint16_t total_entropy;
 	uint8_t random_bytes[MAX(32, ENTROPY_POOL_LENGTH)];
 	uint8_t intermediate[32];
 	HashState hs;
-	uint8_t i;
 
 	// Hash in HWRNG randomness until we've reached the entropy required.
 	// This needs to happen before hashing the pool itself due to the
@@ -289,28 +426,12 @@ static bool getRandom256Internal(BigNum256 n, uint8_t *pool_state, bool use_pool
 		// it returns a non-zero value. If anything in this while loop is
 		// changed, make sure the code still respects this assumption.
 		total_entropy = (uint16_t)(total_entropy + r);
-		for (i = 0; i < 32; i++)
-		{
-			sha256WriteByte(&hs, random_bytes[i]);
-		}
+		sha256WriteBytes(&hs, random_bytes, 32);
 	}
 
 	// Now include the previous state of the pool.
-	if (use_pool_state)
-	{
-		memcpy(random_bytes, pool_state, ENTROPY_POOL_LENGTH);
-	}
-	else
-	{
-		if (getEntropyPool(random_bytes))
-		{
-			return true; // error reading from non-volatile memory, or invalid checksum
-		}
-	}
-	for (i = 0; i < ENTROPY_POOL_LENGTH; i++)
-	{
-		sha256WriteByte(&hs, random_bytes[i]);
-	}
+	memcpy(random_bytes, pool_state, ENTROPY_POOL_LENGTH);
+	sha256WriteBytes(&hs, random_bytes, ENTROPY_POOL_LENGTH);
 	sha256Finish(&hs);
 	writeHashToByteArray(intermediate, &hs, true);
 
@@ -319,30 +440,15 @@ static bool getRandom256Internal(BigNum256 n, uint8_t *pool_state, bool use_pool
 	// attacker who obtained access to the pool state could determine
 	// the most recent returned random output.
 	sha256Begin(&hs);
-	for (i = 0; i < 32; i++)
-	{
-		sha256WriteByte(&hs, intermediate[i]);
-	}
-	for (i = 0; i < 32; i++)
-	{
-		sha256WriteByte(&hs, 0x42); // padding
-	}
+	sha256WriteBytes(&hs, intermediate, 32);
+	memset(random_bytes, 0x42, 32); // padding
+	sha256WriteBytes(&hs, random_bytes, 32);
 	sha256Finish(&hs);
 	writeHashToByteArray(random_bytes, &hs, true);
 
-	// Save the pool state to non-volatile memory immediately as we don't want
-	// it to be possible to reuse the pool state.
-	if (use_pool_state)
-	{
-		memcpy(pool_state, random_bytes, ENTROPY_POOL_LENGTH);
-	}
-	else
-	{
-		if (setEntropyPool(random_bytes))
-		{
-			return true; // error writing to non-volatile memory
-		}
-	}
+	// Update the pool state immediately as we don't want it to be possible
+	// to reuse the pool state.
+	memcpy(pool_state, random_bytes, ENTROPY_POOL_LENGTH);
 	// Hash the intermediate state twice to generate the random bytes to
 	// return.
 	// We can't output the pool state directly, or an attacker who knew that
@@ -352,24 +458,53 @@ static bool getRandom256Internal(BigNum256 n, uint8_t *pool_state, bool use_pool
 	// H(intermediate) while the next pool state will be
 	// H(intermediate | padding). We've prevented a length extension
 	// attack as described above, but there may be other attacks.
-	sha256Begin(&hs);
-	for (i = 0; i < ENTROPY_POOL_LENGTH; i++)
-	{
-		sha256WriteByte(&hs, intermediate[i]);
-	}
-	sha256FinishDouble(&hs);
+	sha256Short(&hs, intermediate, ENTROPY_POOL_LENGTH);
+	sha256Rehash(&hs);
 	writeHashToByteArray(n, &hs, true);
 	return false; // success
 }
 
 /** Version of getRandom256Internal() which uses non-volatile memory to store
   * the persistent entropy pool. See getRandom256Internal() for more details.
+  *
+  * The pool is loaded into RAM (see #cached_pool_state) on first use, and
+  * only written back every #ENTROPY_POOL_PERSIST_INTERVAL calls, so that bulk
+  * requests aren't throttled by non-volatile memory writes. Given the same
+  * initial pool state and HWRNG output, this returns exactly what
+  * getRandom256TemporaryPool() would.
   * \param n See getRandom256Internal()
-  * \return See getRandom256Internal()
+  * \return false on success, true if an error (HWRNG failure, couldn't
+  *         access non-volatile memory, or invalid entropy pool checksum)
+  *         occurred.
   */
 bool getRandom256(BigNum256 n)
 {
-	return getRandom256Internal(n, NULL, false);
+	if (!is_pool_cached)
+	{
+		if (getEntropyPool(cached_pool_state))
+		{
+			invalidateEntropyPoolCache();
+			return true; // error reading from non-volatile memory, or invalid checksum
+		}
+		is_pool_cached = true;
+		// Replace the state in non-volatile memory straight away, so that the
+		// state which was just loaded can never be loaded again.
+		if (persistCachedEntropyPool())
+		{
+			invalidateEntropyPoolCache();
+			return true; // error writing to non-volatile memory
+		}
+	}
+	if (getRandom256Internal(n, cached_pool_state))
+	{
+		return true;
+	}
+	draws_since_persist++;
+	if (draws_since_persist >= ENTROPY_POOL_PERSIST_INTERVAL)
+	{
+		return persistCachedEntropyPool();
+	}
+	return false; // success
 }
 
 /** Version of getRandom256Internal() which uses RAM to store
@@ -382,7 +517,7 @@ bool getRandom256(BigNum256 n)
   */
 bool getRandom256TemporaryPool(BigNum256 n, uint8_t *pool_state)
 {
-	return getRandom256Internal(n, pool_state, true);
+	return getRandom256Internal(n, pool_state);
 }
 
 /** Generate an insecure one-time password.
@@ -427,6 +562,10 @@ void generateInsecureOTP(char *otp)
 	otp[OTP_LENGTH - 1] = '\0';
 }
 
+/** Length of the message which generateDeterministic256() passes to
+  * HMAC-SHA512: 04 (1 byte) + x (32 bytes) + y (32 bytes) + num (4 bytes). */
+#define HMAC_MESSAGE_LENGTH		69
+
 /** Use a combination of cryptographic primitives to deterministically
   * generate a new 256 bit number.
   *
@@ -451,12 +590,12 @@ bool generateDeterministic256(BigNum256 out, const uint8_t *seed, const uint32_t
 {
 	BigNum256 i_l;
 	uint8_t k_par[32];
-	uint8_t hash[SHA512_HASH_LENGTH];
-	uint8_t hmac_message[69]; // 04 (1 byte) + x (32 bytes) + y (32 bytes) + num (4 bytes)
+	ScratchMark mark;
+	uint8_t *hash;
+	uint8_t *hmac_message;
 
 	setFieldToN();
-	memcpy(k_par, seed, 32);
-	swapEndian256(k_par); // since seed is big-endian
+	bigLoadBigEndian(k_par, seed); // since seed is big-endian
 	bigModulo(k_par, k_par); // just in case
 	// k_par cannot be 0. If it is zero, then the output of this generator
 	// will always be 0.
@@ -464,6 +603,9 @@ bool generateDeterministic256(BigNum256 out, const uint8_t *seed, const uint32_t
 	{
 		return true; // invalid seed
 	}
+	mark = scratchMark();
+	hash = scratchAllocate(SHA512_HASH_LENGTH);
+	hmac_message = scratchAllocate(HMAC_MESSAGE_LENGTH);
 	if (!cached_parent_public_key_valid)
 	{
 		setParentPublicKeyFromPrivateKey(k_par);
@@ -476,23 +618,22 @@ bool generateDeterministic256(BigNum256 out, const uint8_t *seed, const uint32_t
 	// big-endian format.
 	// TODO: Remove this all and implement updated BIP 32
 	hmac_message[0] = 0x04;
-	memcpy(&(hmac_message[1]), cached_parent_public_key.x, 32);
-	swapEndian256(&(hmac_message[1]));
-	memcpy(&(hmac_message[33]), cached_parent_public_key.y, 32);
-	swapEndian256(&(hmac_message[33]));
+	bigStoreBigEndian(&(hmac_message[1]), cached_parent_public_key.x);
+	bigStoreBigEndian(&(hmac_message[33]), cached_parent_public_key.y);
 	writeU32BigEndian(&(hmac_message[65]), num);
-	hmacSha512(hash, &(seed[32]), 32, hmac_message, sizeof(hmac_message));
+	hmacSha512(hash, &(seed[32]), 32, hmac_message, HMAC_MESSAGE_LENGTH);
 
 	setFieldToN();
 	i_l = (BigNum256)hash;
 	swapEndian256(i_l); // since hash is big-endian
 	bigModulo(i_l, i_l); // just in case
-	bigMultiply(out, i_l, k_par);
+	multiplyModN(out, i_l, k_par);
 
 #ifdef TEST_PRANDOM
 	memcpy(test_chain_code, &(hash[32]), sizeof(test_chain_code));
 #endif // #ifdef TEST_PRANDOM
 
+	scratchRelease(mark);
 	return false; // success
 }
 
@@ -517,6 +658,7 @@ void corruptEntropyPool(void)
 	nonVolatileRead(&one_byte, PARTITION_GLOBAL, ADDRESS_POOL_CHECKSUM, 1);
 	one_byte = (uint8_t)(one_byte ^ 0xde);
 	nonVolatileWrite(&one_byte, PARTITION_GLOBAL, ADDRESS_POOL_CHECKSUM, 1);
+	invalidateEntropyPoolCache(); // otherwise getRandom256() won't notice
 }
 
 /** Set this to true to simulate the HWRNG breaking. */
@@ -539,9 +681,77 @@ int hardwareRandom32Bytes(uint8_t *buffer)
 	return 8;
 }
 
+/** Report some fixed HWRNG health statistics, so that the output of tests
+  * which ask for them is repeatable.
+  * \param out_health The statistics will be written here.
+  *                   See #HWRNGHealthStruct.
+  */
+void getHWRNGHealth(HWRNGHealth *out_health)
+{
+	memset(out_health, 0, sizeof(*out_health));
+	out_health->has_statistics = true;
+	out_health->mean = -0x8000; // -0.5
+	out_health->variance = 0x640000; // 100
+	out_health->max_bin = 40;
+	out_health->bandwidth = 100;
+	out_health->entropy_estimate = 0x70000; // 7
+	out_health->arrays_tested = 3;
+	out_health->arrays_failed = 1;
+	out_health->last_failed_tests = 64;
+	out_health->samples_tested = 3 * 4096;
+	out_health->bytes_delivered = 1024;
+}
+
 #endif // #ifdef TEST
 
-#if defined(TEST_PRANDOM) || defined(TEST_WALLET)
+#if defined(TEST_PRANDOM) || defined(TEST_WALLET) || defined(HOSTLIB)
+
+/** Write the message which BIP 0032 public key derivation passes to
+  * HMAC-SHA512.
+  * \param hmac_message The message will be written here. This must have
+  *                     space for #HMAC_MESSAGE_LENGTH bytes.
+  * \param in_parent_public_key The parent public key.
+  * \param num The child number.
+  */
+static void writePublicKeyHmacMessage(uint8_t *hmac_message, PointAffine *in_parent_public_key, const uint32_t num)
+{
+	hmac_message[0] = 0x04;
+	bigStoreBigEndian(&(hmac_message[1]), in_parent_public_key->x);
+	bigStoreBigEndian(&(hmac_message[33]), in_parent_public_key->y);
+	writeU32BigEndian(&(hmac_message[65]), num);
+}
+
+/** Derive a child public key from its parent and the HMAC-SHA512 of the
+  * message written by writePublicKeyHmacMessage().
+  * \param out_public_key The child public key will be written here.
+  * \param in_parent_public_key The parent public key.
+  * \param hash The HMAC-SHA512 hash. Its first 32 bytes will be
+  *             overwritten.
+  */
+static void publicKeyFromHmac(PointAffine *out_public_key, PointAffine *in_parent_public_key, uint8_t *hash)
+{
+	BigNum256 i_l;
+
+	setFieldToN();
+	i_l = (BigNum256)hash;
+	swapEndian256(i_l); // since hash is big-endian
+	bigModulo(i_l, i_l); // just in case
+	if (in_parent_public_key->is_point_at_infinity)
+	{
+		// buildPointCombTable() can't handle this, but it won't happen with
+		// a real wallet anyway.
+		memcpy(out_public_key, in_parent_public_key, sizeof(PointAffine));
+		pointMultiply(out_public_key, i_l);
+		return;
+	}
+	if (!comb_table_valid || (memcmp(&comb_table_public_key, in_parent_public_key, sizeof(PointAffine)) != 0))
+	{
+		buildPointCombTable(&comb_table, in_parent_public_key);
+		memcpy(&comb_table_public_key, in_parent_public_key, sizeof(PointAffine));
+		comb_table_valid = true;
+	}
+	pointMultiplyComb(out_public_key, &comb_table, i_l);
+}
 
 /** Use a combination of cryptographic primitives to deterministically
   * generate a new public key.
@@ -561,25 +771,62 @@ int hardwareRandom32Bytes(uint8_t *buffer)
 void generateDeterministicPublicKey(PointAffine *out_public_key, PointAffine *in_parent_public_key, const uint8_t *chain_code, const uint32_t num)
 {
 	uint8_t hash[SHA512_HASH_LENGTH];
-	uint8_t hmac_message[69]; // 04 (1 byte) + x (32 bytes) + y (32 bytes) + num (4 bytes)
-	BigNum256 i_l;
+	uint8_t hmac_message[HMAC_MESSAGE_LENGTH];
 
-	hmac_message[0] = 0x04;
-	memcpy(&(hmac_message[1]), in_parent_public_key->x, 32);
-	swapEndian256(&(hmac_message[1]));
-	memcpy(&(hmac_message[33]), in_parent_public_key->y, 32);
-	swapEndian256(&(hmac_message[33]));
-	writeU32BigEndian(&(hmac_message[65]), num);
+	writePublicKeyHmacMessage(hmac_message, in_parent_public_key, num);
 	hmacSha512(hash, chain_code, 32, hmac_message, sizeof(hmac_message));
-	setFieldToN();
-	i_l = (BigNum256)hash;
-	swapEndian256(i_l); // since hash is big-endian
-	bigModulo(i_l, i_l); // just in case
-	memcpy(out_public_key, in_parent_public_key, sizeof(PointAffine));
-	pointMultiply(out_public_key, i_l);
+	publicKeyFromHmac(out_public_key, in_parent_public_key, hash);
+}
+
+#endif // #if defined(TEST_PRANDOM) || defined(TEST_WALLET) || defined(HOSTLIB)
+
+#if defined(TEST_PRANDOM) || defined(HOSTLIB)
+
+/** Derive the public keys of a contiguous range of children of the same
+  * parent. The results are the same as calling
+  * generateDeterministicPublicKey() for each child, but the key padding of
+  * HMAC-SHA512 is only hashed once, and the HMACs are calculated
+  * #HMAC_SHA512_BATCH_SIZE at a time using hmacSha512ComputeMulti().
+  * \param out_public_keys The generated public keys will be written here,
+  *                        one after the other. This must have space for
+  *                        count public keys.
+  * \param in_parent_public_key See generateDeterministicPublicKey().
+  * \param chain_code See generateDeterministicPublicKey().
+  * \param start_num The counter of the first public key to generate.
+  * \param count The number of public keys to generate.
+  */
+void generateDeterministicPublicKeys(PointAffine *out_public_keys, PointAffine *in_parent_public_key, const uint8_t *chain_code, const uint32_t start_num, uint32_t count)
+{
+	HmacSha512Context ctx;
+	uint8_t hashes[HMAC_SHA512_BATCH_SIZE * SHA512_HASH_LENGTH];
+	uint8_t hmac_messages[HMAC_SHA512_BATCH_SIZE * HMAC_MESSAGE_LENGTH];
+	uint32_t num;
+	uint32_t n;
+	uint32_t i;
+
+	hmacSha512Begin(&ctx, chain_code, 32);
+	num = start_num;
+	while (count > 0)
+	{
+		n = MIN(count, HMAC_SHA512_BATCH_SIZE);
+		for (i = 0; i < n; i++)
+		{
+			writePublicKeyHmacMessage(&(hmac_messages[i * HMAC_MESSAGE_LENGTH]), in_parent_public_key, num + i);
+		}
+		hmacSha512ComputeMulti(hashes, &ctx, hmac_messages, HMAC_MESSAGE_LENGTH, n);
+		for (i = 0; i < n; i++)
+		{
+			publicKeyFromHmac(out_public_keys, in_parent_public_key, &(hashes[i * SHA512_HASH_LENGTH]));
+			out_public_keys++;
+		}
+		num += n;
+		count -= n;
+	}
+	memset(&ctx, 0, sizeof(ctx));
+	memset(hashes, 0, sizeof(hashes));
 }
 
-#endif // #if defined(TEST_PRANDOM) || defined(TEST_WALLET)
+#endif // #if defined(TEST_PRANDOM) || defined(HOSTLIB)
 
 #ifdef TEST_PRANDOM
 
@@ -686,6 +933,11 @@ static void type2DeterministicTest(uint8_t *seed, uint32_t num)
 	}
 }
 
+/** Number of public keys to derive in the generateDeterministicPublicKeys()
+  * test. This isn't a multiple of #HMAC_SHA512_BATCH_SIZE, so that a partly
+  * filled final batch is covered. */
+#define TEST_BATCH_KEYS				11
+
 /** A proper test suite for randomness would be quite big, so this test
   * spits out samples into random.dat, where they can be analysed using
   * an external program.
@@ -694,6 +946,7 @@ int main(int argc, char **argv)
 {
 	uint8_t r[32];
 	int i, j;
+	size_t offset, other_offset;
 	int num_samples;
 	bool abort;
 	int is_broken;
@@ -710,6 +963,8 @@ int main(int argc, char **argv)
 	uint8_t generated_using_ram[1024];
 	uint8_t public_key_binary[65];
 	PointAffine public_key;
+	PointAffine compare_public_key;
+	PointAffine batch_public_keys[TEST_BATCH_KEYS];
 	char otp[OTP_LENGTH];
 	char otp2[OTP_LENGTH];
 
@@ -843,6 +1098,37 @@ int main(int argc, char **argv)
 		type2DeterministicTest(seed, 0xffffffff);
 	}
 
+	// generateDeterministicPublicKeys() should give the same results as
+	// generateDeterministicPublicKey(), including across a batch boundary
+	// and when the counter wraps around.
+	memcpy(seed, sipa_test_master_seed, SEED_LENGTH);
+	memcpy(key2, seed, 32);
+	swapEndian256(key2);
+	setToG(&public_key);
+	pointMultiply(&public_key, key2);
+	for (i = 0; i < 2; i++)
+	{
+		generateDeterministicPublicKeys(batch_public_keys, &public_key, &(seed[32]), (i == 0) ? 1 : 0xfffffff8, TEST_BATCH_KEYS);
+		abort = false;
+		for (j = 0; j < TEST_BATCH_KEYS; j++)
+		{
+			generateDeterministicPublicKey(&compare_public_key, &public_key, &(seed[32]), ((i == 0) ? 1 : 0xfffffff8) + (uint32_t)j);
+			if (memcmp(&compare_public_key, &(batch_public_keys[j]), sizeof(PointAffine)))
+			{
+				printf("generateDeterministicPublicKeys() mismatch, i = %d, j = %d\n", i, j);
+				abort = true;
+			}
+		}
+		if (abort)
+		{
+			reportFailure();
+		}
+		else
+		{
+			reportSuccess();
+		}
+	}
+
 	// Test if setEntropyPool() works.
 	for (i = 0; i < ENTROPY_POOL_LENGTH; i++)
 	{
@@ -955,6 +1241,127 @@ int main(int argc, char **argv)
 		reportSuccess();
 	}
 
+	// getRandom256() should replace the persistent entropy pool as soon as
+	// it loads it, so that the loaded state can never be loaded again.
+	memset(pool_state, 42, ENTROPY_POOL_LENGTH);
+	setEntropyPool(pool_state);
+	getRandom256(r);
+	getEntropyPool(compare_pool_state);
+	if (!memcmp(pool_state, compare_pool_state, ENTROPY_POOL_LENGTH))
+	{
+		printf("getRandom256() not replacing persistent entropy pool on load\n");
+		reportFailure();
+	}
+	else
+	{
+		reportSuccess();
+	}
+
+	// After that, the persistent entropy pool should only be written every
+	// ENTROPY_POOL_PERSIST_INTERVAL calls.
+	abort = false;
+	for (i = 1; i < (ENTROPY_POOL_PERSIST_INTERVAL - 1); i++)
+	{
+		getRandom256(r);
+		getEntropyPool(pool_state);
+		if (memcmp(pool_state, compare_pool_state, ENTROPY_POOL_LENGTH))
+		{
+			printf("getRandom256() writing persistent entropy pool too often, i = %d\n", i);
+			abort = true;
+			break;
+		}
+	}
+	if (abort)
+	{
+		reportFailure();
+	}
+	else
+	{
+		reportSuccess();
+	}
+	getRandom256(r);
+	getEntropyPool(pool_state);
+	if (!memcmp(pool_state, compare_pool_state, ENTROPY_POOL_LENGTH))
+	{
+		printf("getRandom256() not writing persistent entropy pool periodically\n");
+		reportFailure();
+	}
+	else
+	{
+		reportSuccess();
+	}
+
+	// flushEntropyPool() should write the pool only if it has changed since
+	// the last write.
+	getEntropyPool(compare_pool_state);
+	flushEntropyPool();
+	getEntropyPool(pool_state);
+	if (memcmp(pool_state, compare_pool_state, ENTROPY_POOL_LENGTH))
+	{
+		printf("flushEntropyPool() writing unchanged pool\n");
+		reportFailure();
+	}
+	else
+	{
+		reportSuccess();
+	}
+	getRandom256(r);
+	flushEntropyPool();
+	getEntropyPool(pool_state);
+	if (!memcmp(pool_state, compare_pool_state, ENTROPY_POOL_LENGTH))
+	{
+		printf("flushEntropyPool() not writing pool\n");
+		reportFailure();
+	}
+	else
+	{
+		reportSuccess();
+	}
+
+	// Even with a broken HWRNG, simulating a power loss (by reloading the
+	// persistent entropy pool without flushing it first) should never cause
+	// outputs to repeat.
+	memset(pool_state, 42, ENTROPY_POOL_LENGTH);
+	setEntropyPool(pool_state);
+	for (offset = 0; offset < sizeof(generated_using_nv); offset += 32)
+	{
+		if ((offset % 96) == 64)
+		{
+			getEntropyPool(pool_state);
+			setEntropyPool(pool_state); // discards RAM-cached state
+		}
+		if (getRandom256(&(generated_using_nv[offset])))
+		{
+			printf("Unexpected failure of getRandom256()\n");
+			exit(1);
+		}
+	}
+	abort = false;
+	for (offset = 0; offset < sizeof(generated_using_nv); offset += 32)
+	{
+		for (other_offset = 0; other_offset < offset; other_offset += 32)
+		{
+			if (!memcmp(&(generated_using_nv[offset]), &(generated_using_nv[other_offset]), 32))
+			{
+				printf("getRandom256() output repeated after reload, offset = %u\n", (unsigned int)offset);
+				abort = true;
+				break;
+			}
+		}
+		if (abort)
+		{
+			break;
+		}
+	}
+	if (abort)
+	{
+		reportFailure();
+	}
+	else
+	{
+		reportSuccess();
+	}
+
 	// initialiseEntropyPool() should directly set the entropy pool state if
 	// the current state is invalid.
 	memset(pool_state, 0, ENTROPY_POOL_LENGTH);
@@ -11,10 +11,7 @@
 #include "common.h"
 #include "bignum256.h"
 #include "storage_common.h"
-
-#ifdef TEST
 #include "ecdsa.h"
-#endif // #ifdef TEST
 
 /** Length, in bytes, of the seed that generateDeterministic256() requires.
   * \warning This must be a multiple of 16 in order for backupWallet() to work
@@ -45,10 +42,13 @@
 #error POOL_CHECKSUM_LENGTH is too big
 #endif
 
+extern void setParentPublicKey(const PointAffine *parent_public_key);
 extern void clearParentPublicKeyCache(void);
 extern bool setEntropyPool(uint8_t *in_pool_state);
 extern bool getEntropyPool(uint8_t *out_pool_state);
 extern bool initialiseEntropyPool(uint8_t *initial_pool_state);
+extern bool flushEntropyPool(void);
+extern void flushEntropyPoolWhenIdle(void);
 extern bool getRandom256(BigNum256 n);
 extern bool getRandom256TemporaryPool(BigNum256 n, uint8_t *pool_state);
 extern void generateInsecureOTP(char *otp);
@@ -56,7 +56,10 @@ extern bool generateDeterministic256(BigNum256 out, const uint8_t *seed, const u
 #ifdef TEST
 extern void initialiseDefaultEntropyPool(void);
 extern void corruptEntropyPool(void);
-extern void generateDeterministicPublicKey(PointAffine *out_public_key, PointAffine *in_parent_public_key, const uint8_t *chain_code, const uint32_t num);
 #endif // #ifdef TEST
+#if defined(TEST) || defined(HOSTLIB)
+extern void generateDeterministicPublicKey(PointAffine *out_public_key, PointAffine *in_parent_public_key, const uint8_t *chain_code, const uint32_t num);
+extern void generateDeterministicPublicKeys(PointAffine *out_public_keys, PointAffine *in_parent_public_key, const uint8_t *chain_code, const uint32_t start_num, uint32_t count);
+#endif // #if defined(TEST) || defined(HOSTLIB)
 
 #endif // #ifndef PRANDOM_H_INCLUDED
@@ -9,6 +9,11 @@
   * on 30-August-2011.
   * All references in source comments to "the paper" refer to that.
   *
+  * On platforms with plenty of program memory, define RIPEMD160_UNROLLED to
+  * use an alternative ripemd160Block() which unrolls all 160 rounds, so
+  * that the message word selection, rotate amounts and added constants
+  * don't need to be looked up at run time. It is about 5 times larger.
+  *
   * This file is licensed as described by the file LICENCE.
   */
 
@@ -19,10 +24,243 @@
 #include "test_helpers.h"
 #endif // #ifdef TEST_RIPEMD160
 
+#ifdef BENCH_RIPEMD160
+#include <stdlib.h>
+#include "test_helpers.h"
+#endif // #ifdef BENCH_RIPEMD160
+
 #include "common.h"
 #include "hash.h"
 #include "ripemd160.h"
 
+#ifdef RIPEMD160_UNROLLED
+
+// These are the same as the functions in the #else branch below, except
+// that they're macros, so that the unrolled rounds in ripemd160Block() don't
+// depend on the compiler's willingness to inline things.
+#define ROL(x, n)			(((x) << (n)) | ((x) >> (32 - (n))))
+#define F0(x, y, z)			((x) ^ (y) ^ (z))
+#define F1(x, y, z)			(((x) & (y)) | (~(x) & (z)))
+#define F2(x, y, z)			(((x) | ~(y)) ^ (z))
+#define F3(x, y, z)			(((x) & (z)) | ((y) & ~(z)))
+#define F4(x, y, z)			((x) ^ ((y) | ~(z)))
+
+/** One round of RIPEMD-160. Instead of shuffling the working variables at
+  * the end of every round, the caller rotates the argument list. The
+  * message word, rotate amount and added constant are passed in directly,
+  * so that they end up as immediate operands instead of table lookups. */
+#define ROUND(a, b, c, d, e, f, x, s, k) \
+	a = ROL(a + f(b, c, d) + (x) + (k), s) + e; \
+	c = ROL(c, 10)
+
+/** Update hash value based on the contents of a full message buffer.
+  * This is an implementation of HashState#hashBlock(). All 80 rounds of
+  * both lines are unrolled.
+  * \param hs The hash state to update.
+  */
+static HOT_FUNCTION void ripemd160Block(HashState *hs)
+{
+	// 1 = unprimed, 2 = primed.
+	// A to E are the variables used in the pseudo-code of Appendix A
+	// of the paper.
+	uint32_t A1, B1, C1, D1, E1;
+	uint32_t A2, B2, C2, D2, E2;
+	uint32_t T;
+
+	A1 = hs->h[0];
+	A2 = A1;
+	B1 = hs->h[1];
+	B2 = B1;
+	C1 = hs->h[2];
+	C2 = C1;
+	D1 = hs->h[3];
+	D2 = D1;
+	E1 = hs->h[4];
+	E2 = E1;
+	// Main (unprimed) line.
+	// Rounds 0 to 15.
+	ROUND(A1, B1, C1, D1, E1, F0, hs->m[0], 11, 0x00000000);
+	ROUND(E1, A1, B1, C1, D1, F0, hs->m[1], 14, 0x00000000);
+	ROUND(D1, E1, A1, B1, C1, F0, hs->m[2], 15, 0x00000000);
+	ROUND(C1, D1, E1, A1, B1, F0, hs->m[3], 12, 0x00000000);
+	ROUND(B1, C1, D1, E1, A1, F0, hs->m[4], 5, 0x00000000);
+	ROUND(A1, B1, C1, D1, E1, F0, hs->m[5], 8, 0x00000000);
+	ROUND(E1, A1, B1, C1, D1, F0, hs->m[6], 7, 0x00000000);
+	ROUND(D1, E1, A1, B1, C1, F0, hs->m[7], 9, 0x00000000);
+	ROUND(C1, D1, E1, A1, B1, F0, hs->m[8], 11, 0x00000000);
+	ROUND(B1, C1, D1, E1, A1, F0, hs->m[9], 13, 0x00000000);
+	ROUND(A1, B1, C1, D1, E1, F0, hs->m[10], 14, 0x00000000);
+	ROUND(E1, A1, B1, C1, D1, F0, hs->m[11], 15, 0x00000000);
+	ROUND(D1, E1, A1, B1, C1, F0, hs->m[12], 6, 0x00000000);
+	ROUND(C1, D1, E1, A1, B1, F0, hs->m[13], 7, 0x00000000);
+	ROUND(B1, C1, D1, E1, A1, F0, hs->m[14], 9, 0x00000000);
+	ROUND(A1, B1, C1, D1, E1, F0, hs->m[15], 8, 0x00000000);
+	// Rounds 16 to 31.
+	ROUND(E1, A1, B1, C1, D1, F1, hs->m[7], 7, 0x5a827999);
+	ROUND(D1, E1, A1, B1, C1, F1, hs->m[4], 6, 0x5a827999);
+	ROUND(C1, D1, E1, A1, B1, F1, hs->m[13], 8, 0x5a827999);
+	ROUND(B1, C1, D1, E1, A1, F1, hs->m[1], 13, 0x5a827999);
+	ROUND(A1, B1, C1, D1, E1, F1, hs->m[10], 11, 0x5a827999);
+	ROUND(E1, A1, B1, C1, D1, F1, hs->m[6], 9, 0x5a827999);
+	ROUND(D1, E1, A1, B1, C1, F1, hs->m[15], 7, 0x5a827999);
+	ROUND(C1, D1, E1, A1, B1, F1, hs->m[3], 15, 0x5a827999);
+	ROUND(B1, C1, D1, E1, A1, F1, hs->m[12], 7, 0x5a827999);
+	ROUND(A1, B1, C1, D1, E1, F1, hs->m[0], 12, 0x5a827999);
+	ROUND(E1, A1, B1, C1, D1, F1, hs->m[9], 15, 0x5a827999);
+	ROUND(D1, E1, A1, B1, C1, F1, hs->m[5], 9, 0x5a827999);
+	ROUND(C1, D1, E1, A1, B1, F1, hs->m[2], 11, 0x5a827999);
+	ROUND(B1, C1, D1, E1, A1, F1, hs->m[14], 7, 0x5a827999);
+	ROUND(A1, B1, C1, D1, E1, F1, hs->m[11], 13, 0x5a827999);
+	ROUND(E1, A1, B1, C1, D1, F1, hs->m[8], 12, 0x5a827999);
+	// Rounds 32 to 47.
+	ROUND(D1, E1, A1, B1, C1, F2, hs->m[3], 11, 0x6ed9eba1);
+	ROUND(C1, D1, E1, A1, B1, F2, hs->m[10], 13, 0x6ed9eba1);
+	ROUND(B1, C1, D1, E1, A1, F2, hs->m[14], 6, 0x6ed9eba1);
+	ROUND(A1, B1, C1, D1, E1, F2, hs->m[4], 7, 0x6ed9eba1);
+	ROUND(E1, A1, B1, C1, D1, F2, hs->m[9], 14, 0x6ed9eba1);
+	ROUND(D1, E1, A1, B1, C1, F2, hs->m[15], 9, 0x6ed9eba1);
+	ROUND(C1, D1, E1, A1, B1, F2, hs->m[8], 13, 0x6ed9eba1);
+	ROUND(B1, C1, D1, E1, A1, F2, hs->m[1], 15, 0x6ed9eba1);
+	ROUND(A1, B1, C1, D1, E1, F2, hs->m[2], 14, 0x6ed9eba1);
+	ROUND(E1, A1, B1, C1, D1, F2, hs->m[7], 8, 0x6ed9eba1);
+	ROUND(D1, E1, A1, B1, C1, F2, hs->m[0], 13, 0x6ed9eba1);
+	ROUND(C1, D1, E1, A1, B1, F2, hs->m[6], 6, 0x6ed9eba1);
+	ROUND(B1, C1, D1, E1, A1, F2, hs->m[13], 5, 0x6ed9eba1);
+	ROUND(A1, B1, C1, D1, E1, F2, hs->m[11], 12, 0x6ed9eba1);
+	ROUND(E1, A1, B1, C1, D1, F2, hs->m[5], 7, 0x6ed9eba1);
+	ROUND(D1, E1, A1, B1, C1, F2, hs->m[12], 5, 0x6ed9eba1);
+	// Rounds 48 to 63.
+	ROUND(C1, D1, E1, A1, B1, F3, hs->m[1], 11, 0x8f1bbcdc);
+	ROUND(B1, C1, D1, E1, A1, F3, hs->m[9], 12, 0x8f1bbcdc);
+	ROUND(A1, B1, C1, D1, E1, F3, hs->m[11], 14, 0x8f1bbcdc);
+	ROUND(E1, A1, B1, C1, D1, F3, hs->m[10], 15, 0x8f1bbcdc);
+	ROUND(D1, E1, A1, B1, C1, F3, hs->m[0], 14, 0x8f1bbcdc);
+	ROUND(C1, D1, E1, A1, B1, F3, hs->m[8], 15, 0x8f1bbcdc);
+	ROUND(B1, C1, D1, E1, A1, F3, hs->m[12], 9, 0x8f1bbcdc);
+	ROUND(A1, B1, C1, D1, E1, F3, hs->m[4], 8, 0x8f1bbcdc);
+	ROUND(E1, A1, B1, C1, D1, F3, hs->m[13], 9, 0x8f1bbcdc);
+	ROUND(D1, E1, A1, B1, C1, F3, hs->m[3], 14, 0x8f1bbcdc);
+	ROUND(C1, D1, E1, A1, B1, F3, hs->m[7], 5, 0x8f1bbcdc);
+	ROUND(B1, C1, D1, E1, A1, F3, hs->m[15], 6, 0x8f1bbcdc);
+	ROUND(A1, B1, C1, D1, E1, F3, hs->m[14], 8, 0x8f1bbcdc);
+	ROUND(E1, A1, B1, C1, D1, F3, hs->m[5], 6, 0x8f1bbcdc);
+	ROUND(D1, E1, A1, B1, C1, F3, hs->m[6], 5, 0x8f1bbcdc);
+	ROUND(C1, D1, E1, A1, B1, F3, hs->m[2], 12, 0x8f1bbcdc);
+	// Rounds 64 to 79.
+	ROUND(B1, C1, D1, E1, A1, F4, hs->m[4], 9, 0xa953fd4e);
+	ROUND(A1, B1, C1, D1, E1, F4, hs->m[0], 15, 0xa953fd4e);
+	ROUND(E1, A1, B1, C1, D1, F4, hs->m[5], 5, 0xa953fd4e);
+	ROUND(D1, E1, A1, B1, C1, F4, hs->m[9], 11, 0xa953fd4e);
+	ROUND(C1, D1, E1, A1, B1, F4, hs->m[7], 6, 0xa953fd4e);
+	ROUND(B1, C1, D1, E1, A1, F4, hs->m[12], 8, 0xa953fd4e);
+	ROUND(A1, B1, C1, D1, E1, F4, hs->m[2], 13, 0xa953fd4e);
+	ROUND(E1, A1, B1, C1, D1, F4, hs->m[10], 12, 0xa953fd4e);
+	ROUND(D1, E1, A1, B1, C1, F4, hs->m[14], 5, 0xa953fd4e);
+	ROUND(C1, D1, E1, A1, B1, F4, hs->m[1], 12, 0xa953fd4e);
+	ROUND(B1, C1, D1, E1, A1, F4, hs->m[3], 13, 0xa953fd4e);
+	ROUND(A1, B1, C1, D1, E1, F4, hs->m[8], 14, 0xa953fd4e);
+	ROUND(E1, A1, B1, C1, D1, F4, hs->m[11], 11, 0xa953fd4e);
+	ROUND(D1, E1, A1, B1, C1, F4, hs->m[6], 8, 0xa953fd4e);
+	ROUND(C1, D1, E1, A1, B1, F4, hs->m[15], 5, 0xa953fd4e);
+	ROUND(B1, C1, D1, E1, A1, F4, hs->m[13], 6, 0xa953fd4e);
+	// Parallel (primed) line.
+	// Rounds 0 to 15.
+	ROUND(A2, B2, C2, D2, E2, F4, hs->m[5], 8, 0x50a28be6);
+	ROUND(E2, A2, B2, C2, D2, F4, hs->m[14], 9, 0x50a28be6);
+	ROUND(D2, E2, A2, B2, C2, F4, hs->m[7], 9, 0x50a28be6);
+	ROUND(C2, D2, E2, A2, B2, F4, hs->m[0], 11, 0x50a28be6);
+	ROUND(B2, C2, D2, E2, A2, F4, hs->m[9], 13, 0x50a28be6);
+	ROUND(A2, B2, C2, D2, E2, F4, hs->m[2], 15, 0x50a28be6);
+	ROUND(E2, A2, B2, C2, D2, F4, hs->m[11], 15, 0x50a28be6);
+	ROUND(D2, E2, A2, B2, C2, F4, hs->m[4], 5, 0x50a28be6);
+	ROUND(C2, D2, E2, A2, B2, F4, hs->m[13], 7, 0x50a28be6);
+	ROUND(B2, C2, D2, E2, A2, F4, hs->m[6], 7, 0x50a28be6);
+	ROUND(A2, B2, C2, D2, E2, F4, hs->m[15], 8, 0x50a28be6);
+	ROUND(E2, A2, B2, C2, D2, F4, hs->m[8], 11, 0x50a28be6);
+	ROUND(D2, E2, A2, B2, C2, F4, hs->m[1], 14, 0x50a28be6);
+	ROUND(C2, D2, E2, A2, B2, F4, hs->m[10], 14, 0x50a28be6);
+	ROUND(B2, C2, D2, E2, A2, F4, hs->m[3], 12, 0x50a28be6);
+	ROUND(A2, B2, C2, D2, E2, F4, hs->m[12], 6, 0x50a28be6);
+	// Rounds 16 to 31.
+	ROUND(E2, A2, B2, C2, D2, F3, hs->m[6], 9, 0x5c4dd124);
+	ROUND(D2, E2, A2, B2, C2, F3, hs->m[11], 13, 0x5c4dd124);
+	ROUND(C2, D2, E2, A2, B2, F3, hs->m[3], 15, 0x5c4dd124);
+	ROUND(B2, C2, D2, E2, A2, F3, hs->m[7], 7, 0x5c4dd124);
+	ROUND(A2, B2, C2, D2, E2, F3, hs->m[0], 12, 0x5c4dd124);
+	ROUND(E2, A2, B2, C2, D2, F3, hs->m[13], 8, 0x5c4dd124);
+	ROUND(D2, E2, A2, B2, C2, F3, hs->m[5], 9, 0x5c4dd124);
+	ROUND(C2, D2, E2, A2, B2, F3, hs->m[10], 11, 0x5c4dd124);
+	ROUND(B2, C2, D2, E2, A2, F3, hs->m[14], 7, 0x5c4dd124);
+	ROUND(A2, B2, C2, D2, E2, F3, hs->m[15], 7, 0x5c4dd124);
+	ROUND(E2, A2, B2, C2, D2, F3, hs->m[8], 12, 0x5c4dd124);
+	ROUND(D2, E2, A2, B2, C2, F3, hs->m[12], 7, 0x5c4dd124);
+	ROUND(C2, D2, E2, A2, B2, F3, hs->m[4], 6, 0x5c4dd124);
+	ROUND(B2, C2, D2, E2, A2, F3, hs->m[9], 15, 0x5c4dd124);
+	ROUND(A2, B2, C2, D2, E2, F3, hs->m[1], 13, 0x5c4dd124);
+	ROUND(E2, A2, B2, C2, D2, F3, hs->m[2], 11, 0x5c4dd124);
+	// Rounds 32 to 47.
+	ROUND(D2, E2, A2, B2, C2, F2, hs->m[15], 9, 0x6d703ef3);
+	ROUND(C2, D2, E2, A2, B2, F2, hs->m[5], 7, 0x6d703ef3);
+	ROUND(B2, C2, D2, E2, A2, F2, hs->m[1], 15, 0x6d703ef3);
+	ROUND(A2, B2, C2, D2, E2, F2, hs->m[3], 11, 0x6d703ef3);
+	ROUND(E2, A2, B2, C2, D2, F2, hs->m[7], 8, 0x6d703ef3);
+	ROUND(D2, E2, A2, B2, C2, F2, hs->m[14], 6, 0x6d703ef3);
+	ROUND(C2, D2, E2, A2, B2, F2, hs->m[6], 6, 0x6d703ef3);
+	ROUND(B2, C2, D2, E2, A2, F2, hs->m[9], 14, 0x6d703ef3);
+	ROUND(A2, B2, C2, D2, E2, F2, hs->m[11], 12, 0x6d703ef3);
+	ROUND(E2, A2, B2, C2, D2, F2, hs->m[8], 13, 0x6d703ef3);
+	ROUND(D2, E2, A2, B2, C2, F2, hs->m[12], 5, 0x6d703ef3);
+	ROUND(C2, D2, E2, A2, B2, F2, hs->m[2], 14, 0x6d703ef3);
+	ROUND(B2, C2, D2, E2, A2, F2, hs->m[10], 13, 0x6d703ef3);
+	ROUND(A2, B2, C2, D2, E2, F2, hs->m[0], 13, 0x6d703ef3);
+	ROUND(E2, A2, B2, C2, D2, F2, hs->m[4], 7, 0x6d703ef3);
+	ROUND(D2, E2, A2, B2, C2, F2, hs->m[13], 5, 0x6d703ef3);
+	// Rounds 48 to 63.
+	ROUND(C2, D2, E2, A2, B2, F1, hs->m[8], 15, 0x7a6d76e9);
+	ROUND(B2, C2, D2, E2, A2, F1, hs->m[6], 5, 0x7a6d76e9);
+	ROUND(A2, B2, C2, D2, E2, F1, hs->m[4], 8, 0x7a6d76e9);
+	ROUND(E2, A2, B2, C2, D2, F1, hs->m[1], 11, 0x7a6d76e9);
+	ROUND(D2, E2, A2, B2, C2, F1, hs->m[3], 14, 0x7a6d76e9);
+	ROUND(C2, D2, E2, A2, B2, F1, hs->m[11], 14, 0x7a6d76e9);
+	ROUND(B2, C2, D2, E2, A2, F1, hs->m[15], 6, 0x7a6d76e9);
+	ROUND(A2, B2, C2, D2, E2, F1, hs->m[0], 14, 0x7a6d76e9);
+	ROUND(E2, A2, B2, C2, D2, F1, hs->m[5], 6, 0x7a6d76e9);
+	ROUND(D2, E2, A2, B2, C2, F1, hs->m[12], 9, 0x7a6d76e9);
+	ROUND(C2, D2, E2, A2, B2, F1, hs->m[2], 12, 0x7a6d76e9);
+	ROUND(B2, C2, D2, E2, A2, F1, hs->m[13], 9, 0x7a6d76e9);
+	ROUND(A2, B2, C2, D2, E2, F1, hs->m[9], 12, 0x7a6d76e9);
+	ROUND(E2, A2, B2, C2, D2, F1, hs->m[7], 5, 0x7a6d76e9);
+	ROUND(D2, E2, A2, B2, C2, F1, hs->m[10], 15, 0x7a6d76e9);
+	ROUND(C2, D2, E2, A2, B2, F1, hs->m[14], 8, 0x7a6d76e9);
+	// Rounds 64 to 79.
+	ROUND(B2, C2, D2, E2, A2, F0, hs->m[12], 8, 0x00000000);
+	ROUND(A2, B2, C2, D2, E2, F0, hs->m[15], 5, 0x00000000);
+	ROUND(E2, A2, B2, C2, D2, F0, hs->m[10], 12, 0x00000000);
+	ROUND(D2, E2, A2, B2, C2, F0, hs->m[4], 9, 0x00000000);
+	ROUND(C2, D2, E2, A2, B2, F0, hs->m[1], 12, 0x00000000);
+	ROUND(B2, C2, D2, E2, A2, F0, hs->m[5], 5, 0x00000000);
+	ROUND(A2, B2, C2, D2, E2, F0, hs->m[8], 14, 0x00000000);
+	ROUND(E2, A2, B2, C2, D2, F0, hs->m[7], 6, 0x00000000);
+	ROUND(D2, E2, A2, B2, C2, F0, hs->m[6], 8, 0x00000000);
+	ROUND(C2, D2, E2, A2, B2, F0, hs->m[2], 13, 0x00000000);
+	ROUND(B2, C2, D2, E2, A2, F0, hs->m[13], 6, 0x00000000);
+	ROUND(A2, B2, C2, D2, E2, F0, hs->m[14], 5, 0x00000000);
+	ROUND(E2, A2, B2, C2, D2, F0, hs->m[0], 15, 0x00000000);
+	ROUND(D2, E2, A2, B2, C2, F0, hs->m[3], 13, 0x00000000);
+	ROUND(C2, D2, E2, A2, B2, F0, hs->m[9], 11, 0x00000000);
+	ROUND(B2, C2, D2, E2, A2, F0, hs->m[11], 11, 0x00000000);
+	// After 80 rounds, the argument list has been rotated 80 times, which
+	// is a multiple of 5, so the variables are back in their usual places.
+	T = hs->h[1] + C1 + D2;
+	hs->h[1] = hs->h[2] + D1 + E2;
+	hs->h[2] = hs->h[3] + E1 + A2;
+	hs->h[3] = hs->h[4] + A1 + B2;
+	hs->h[4] = hs->h[0] + B1 + C2;
+	hs->h[0] = T;
+}
+
+#else
+
 /** Selection of message word for main rounds. */
 static uint8_t r1[80] PROGMEM = {
 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
@@ -124,7 +362,7 @@ static uint32_t f4(uint32_t x, uint32_t y, uint32_t z)
   * This is an implementation of HashState#hashBlock().
   * \param hs The hash state to update.
   */
-static void ripemd160Block(HashState *hs)
+static HOT_FUNCTION void ripemd160Block(HashState *hs)
 {
 	// 1 = unprimed, 2 = primed.
 	// A to E and T are the variables used in the pseudo-code of Appendix A
@@ -206,6 +444,8 @@ static void ripemd160Block(HashState *hs)
 	hs->h[0] = T;
 }
 
+#endif // #ifdef RIPEMD160_UNROLLED
+
 /** Begin calculating hash for new message.
   * \param hs The hash state to initialise.
   */
@@ -234,6 +474,20 @@ void ripemd160WriteByte(HashState *hs, uint8_t byte)
 	hashWriteByte(hs, byte);
 }
 
+/** Add an array of bytes to the message buffer, calling ripemd160Block()
+  * whenever the message buffer is full. This is faster than calling
+  * ripemd160WriteByte() for each byte.
+  * \param hs The hash state to act on. The hash state must be one that has
+  *           been initialised using ripemd160Begin() at some time in the
+  *           past.
+  * \param bytes The bytes to add.
+  * \param length The number of bytes to add.
+  */
+void ripemd160WriteBytes(HashState *hs, const uint8_t *bytes, uint32_t length)
+{
+	hashWriteBytes(hs, bytes, length);
+}
+
 /** Finalise the hashing of a message by writing appropriate padding and
   * length bytes.
   * \param hs The hash state to act on. The hash state must be one that has
@@ -245,25 +499,43 @@ void ripemd160Finish(HashState *hs)
 	hashFinish(hs);
 }
 
+/** Calculate the RIPEMD-160 hash of a short message in one go. This gives
+  * the same result as ripemd160Begin(), ripemd160WriteBytes() then
+  * ripemd160Finish(), but only calls ripemd160Block() once (see
+  * hashShortMessage()).
+  * \param hs The hash state to use. When this returns, the hash will be in
+  *           HashState#h, just as if ripemd160Finish() had been called.
+  * \param message The message to hash.
+  * \param length The length of the message, in bytes. This must be no more
+  *               than #HASH_SHORT_MESSAGE_MAX.
+  */
+void ripemd160Short(HashState *hs, const uint8_t *message, uint8_t length)
+{
+	ripemd160Begin(hs);
+	hashShortMessage(hs, message, length);
+}
+
 #ifdef TEST_RIPEMD160
 
 /** Where hash value will be stored after ripemd160() returns. */
 static uint32_t h[5];
 
 /** Calculate RIPEMD-160 hash of a message. The result is returned in #h.
+  * The first byte is written using ripemd160WriteByte() and the rest are
+  * written using ripemd160WriteBytes(), so that both are tested.
   * \param message The message to calculate the hash of. This must be a byte
   *                array of the size specified by length.
   * \param length The length (in bytes) of the message.
   */
 static void ripemd160(uint8_t *message, uint32_t length)
 {
-	uint32_t i;
 	HashState hs;
 
 	ripemd160Begin(&hs);
-	for (i = 0; i < length; i++)
+	if (length > 0)
 	{
-		ripemd160WriteByte(&hs, message[i]);
+		ripemd160WriteByte(&hs, message[0]);
+		ripemd160WriteBytes(&hs, &(message[1]), length - 1);
 	}
 	ripemd160Finish(&hs);
 	memcpy(h, hs.h, 20);
@@ -300,6 +572,7 @@ int main(void)
 	int i;
 	char *str;
 	uint32_t *compare_h;
+	HashState hs;
 
 	initTests(__FILE__);
 
@@ -321,6 +594,26 @@ int main(void)
 		}
 	}
 
+	// ripemd160Short() should agree with the general functions for every
+	// length it accepts.
+	str = malloc(HASH_SHORT_MESSAGE_MAX);
+	for (i = 0; i <= HASH_SHORT_MESSAGE_MAX; i++)
+	{
+		fillWithRandom((uint8_t *)str, (unsigned int)i);
+		ripemd160((uint8_t *)str, (uint32_t)i);
+		ripemd160Short(&hs, (uint8_t *)str, (uint8_t)i);
+		if (!memcmp(h, hs.h, 20))
+		{
+			reportSuccess();
+		}
+		else
+		{
+			printf("ripemd160Short() mismatch, length = %d\n", i);
+			reportFailure();
+		}
+	}
+	free(str);
+
 	// Million "a" test.
 	str = malloc(1000000);
 	memset(str, 'a', 1000000);
@@ -344,3 +637,39 @@ int main(void)
 }
 
 #endif // #ifdef TEST_RIPEMD160
+
+#ifdef BENCH_RIPEMD160
+
+/** Input for the RIPEMD-160 benchmarks. */
+static uint8_t bench_input[1024];
+
+/** Hash a short (one block) message. */
+static void benchRipemd160Short(void)
+{
+	HashState hs;
+
+	ripemd160Begin(&hs);
+	ripemd160WriteBytes(&hs, bench_input, 64);
+	ripemd160Finish(&hs);
+}
+
+/** Hash a 1024 byte message. */
+static void benchRipemd160Long(void)
+{
+	HashState hs;
+
+	ripemd160Begin(&hs);
+	ripemd160WriteBytes(&hs, bench_input, sizeof(bench_input));
+	ripemd160Finish(&hs);
+}
+
+int main(void)
+{
+	initBenchmarks(__FILE__);
+	fillWithRandom(bench_input, sizeof(bench_input));
+	runHostBenchmark("ripemd160_64", &benchRipemd160Short, 64);
+	runHostBenchmark("ripemd160_1024", &benchRipemd160Long, sizeof(bench_input));
+	exit(0);
+}
+
+#endif // #ifdef BENCH_RIPEMD160
@@ -3,9 +3,12 @@
   * \brief Describes functions exported by ripemd160.c.
   *
   * To calculate a RIPEMD-160 hash, call ripemd160Begin(), then call
-  * ripemd160WriteByte() for each byte of the message, then call
+  * ripemd160WriteByte() for each byte of the message (or
+  * ripemd160WriteBytes() for an array of bytes), then call
   * ripemd160Finish(). The hash will be in HashState#h, but it can also be
   * extracted and placed into to a byte array using writeHashToByteArray().
+  * Messages of up to #HASH_SHORT_MESSAGE_MAX bytes can instead be hashed
+  * with a single call to ripemd160Short().
   *
   * This file is licensed as described by the file LICENCE.
   */
@@ -18,6 +21,8 @@
 
 extern void ripemd160Begin(HashState *hs);
 extern void ripemd160WriteByte(HashState *hs, uint8_t byte);
+extern void ripemd160WriteBytes(HashState *hs, const uint8_t *bytes, uint32_t length);
 extern void ripemd160Finish(HashState *hs);
+extern void ripemd160Short(HashState *hs, const uint8_t *message, uint8_t length);
 
 #endif // #ifndef RIPEMD160_H_INCLUDED
@@ -0,0 +1,222 @@
+/** \file scratch.c
+  *
+  * \brief Allocates temporary buffers for cryptographic calculations.
+  *
+  * The cryptographic functions use a lot of temporary buffers, and those
+  * functions nest (eg. ecdsaSign() calls pointMultiplyBase(), which calls
+  * pointAdd(), which calls bigMultiplyModP()). When every buffer is a local
+  * variable, the stack has to be big enough for the sum of every stack
+  * frame, including padding, saved registers and anything the compiler
+  * decides to spill, and the only way to find out how big that is is to
+  * measure it. Buffers allocated here instead come from one statically
+  * allocated arena of #SCRATCH_SIZE bytes, which shows up in the linker map
+  * like any other static variable, so the stack reservation can be reduced
+  * accordingly.
+  *
+  * Allocation is strictly last-in, first-out. A function which needs
+  * scratch space calls scratchMark(), then scratchAllocate() as many times
+  * as it needs, then scratchRelease() with the mark before it returns. Every
+  * return path must release. Released space is cleared, so that (as with
+  * the explicit memset() calls this replaces) intermediate results don't
+  * linger in RAM (see sanitiseRam()).
+  *
+  * There's only one thread of execution and interrupt handlers don't do
+  * any cryptography, so no locking is needed.
+  *
+  * This file is licensed as described by the file LICENCE.
+  */
+
+#ifdef TEST_SCRATCH
+#include <stdio.h>
+#include <stdlib.h>
+#include "ecdsa.h"
+#include "hmac_sha512.h"
+#include "pbkdf2.h"
+#include "test_helpers.h"
+#endif // #ifdef TEST_SCRATCH
+
+#include "common.h"
+#include "hwinterface.h"
+#include "scratch.h"
+
+/** Allocations are rounded up to a multiple of this many bytes, so that
+  * every allocation is suitably aligned for 32 bit accesses. */
+#define SCRATCH_ALIGNMENT			4
+
+/** The arena itself. It's declared as an array of words so that it is
+  * aligned to #SCRATCH_ALIGNMENT. */
+static THREAD_LOCAL uint32_t scratch_arena[(SCRATCH_SIZE + SCRATCH_ALIGNMENT - 1) / SCRATCH_ALIGNMENT];
+/** Number of bytes of #scratch_arena which are currently allocated. */
+static THREAD_LOCAL uint16_t scratch_used;
+/** Largest value #scratch_used has had. */
+static THREAD_LOCAL uint16_t scratch_peak;
+
+/** Remember the current position in the scratch arena.
+  * \return A mark which should be passed to scratchRelease() once the space
+  *         allocated after this call is no longer needed.
+  */
+ScratchMark scratchMark(void)
+{
+	return scratch_used;
+}
+
+/** Allocate space from the scratch arena. This calls fatalError() if there
+  * isn't enough space, since that means #SCRATCH_SIZE is too small for this
+  * build.
+  * \param size The number of bytes to allocate.
+  * \return A pointer to the allocated space, aligned
+  *         to #SCRATCH_ALIGNMENT. The contents are unspecified.
+  */
+void *scratchAllocate(uint16_t size)
+{
+	uint8_t *allocated;
+	uint16_t rounded_size;
+
+	rounded_size = (uint16_t)((size + SCRATCH_ALIGNMENT - 1) & ~(SCRATCH_ALIGNMENT - 1));
+	if ((rounded_size < size) || (rounded_size > (sizeof(scratch_arena) - scratch_used)))
+	{
+		fatalError(); // scratch arena is too small
+	}
+	allocated = &(((uint8_t *)scratch_arena)[scratch_used]);
+	scratch_used = (uint16_t)(scratch_used + rounded_size);
+	if (scratch_used > scratch_peak)
+	{
+		scratch_peak = scratch_used;
+	}
+	return allocated;
+}
+
+/** Free and clear everything which was allocated after a mark was taken.
+  * \param mark The mark, as returned by scratchMark(). Marks must be released
+  *             in the reverse order to the order they were taken in.
+  */
+void scratchRelease(ScratchMark mark)
+{
+	if (mark > scratch_used)
+	{
+		fatalError(); // released out of order
+	}
+	memset(&(((uint8_t *)scratch_arena)[mark]), 0, (size_t)(scratch_used - mark));
+	scratch_used = mark;
+}
+
+/** Get the most scratch space which has been in use at once.
+  * \return The peak usage in bytes. This should never exceed #SCRATCH_SIZE.
+  */
+uint16_t getScratchPeak(void)
+{
+	return scratch_peak;
+}
+
+#ifdef TEST_SCRATCH
+
+/** Check whether a region of memory is all zero.
+  * \param buffer The region to check.
+  * \param length The length of the region, in bytes.
+  * \return true if every byte is zero, false otherwise.
+  */
+static bool isAllZero(const uint8_t *buffer, unsigned int length)
+{
+	unsigned int i;
+
+	for (i = 0; i < length; i++)
+	{
+		if (buffer[i] != 0)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+int main(void)
+{
+	ScratchMark outer;
+	ScratchMark inner;
+	uint8_t *a;
+	uint8_t *b;
+	uint8_t *c;
+	uint8_t r[32];
+	uint8_t s[32];
+	uint8_t hash[32];
+	uint8_t private_key[32];
+	uint8_t out[SHA512_HASH_LENGTH];
+
+	initTests(__FILE__);
+
+	// Allocations should be aligned and shouldn't overlap.
+	outer = scratchMark();
+	a = scratchAllocate(5);
+	b = scratchAllocate(32);
+	if ((outer == 0) && ((((uintptr_t)a) & (SCRATCH_ALIGNMENT - 1)) == 0)
+		&& ((((uintptr_t)b) & (SCRATCH_ALIGNMENT - 1)) == 0) && (b >= (a + 5)))
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("Allocations are misaligned or overlap\n");
+		reportFailure();
+	}
+	memset(a, 0xaa, 5);
+	memset(b, 0xbb, 32);
+
+	// Releasing a nested mark should only free and clear what was
+	// allocated after it.
+	inner = scratchMark();
+	c = scratchAllocate(64);
+	memset(c, 0xcc, 64);
+	scratchRelease(inner);
+	if (isAllZero(c, 64) && (a[4] == 0xaa) && (b[31] == 0xbb) && (scratchMark() == inner))
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("Releasing nested mark didn't work\n");
+		reportFailure();
+	}
+
+	// Space should be re-used after release.
+	if (scratchAllocate(64) == c)
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("Released space isn't re-used\n");
+		reportFailure();
+	}
+	scratchRelease(outer);
+	if (isAllZero(a, 5) && isAllZero(b, 32) && (scratchMark() == 0))
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("Releasing outer mark didn't clear everything\n");
+		reportFailure();
+	}
+
+	// The heaviest users of scratch space should fit, and should release
+	// everything they allocate.
+	fillWithRandom(hash, sizeof(hash));
+	fillWithRandom(private_key, sizeof(private_key));
+	ecdsaSign(r, s, hash, private_key);
+	pbkdf2(out, private_key, sizeof(private_key), hash, sizeof(hash));
+	if ((scratchMark() == 0) && (getScratchPeak() <= SCRATCH_SIZE))
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("Scratch space leaked or overflowed\n");
+		reportFailure();
+	}
+	printf("Peak scratch usage: %u of %u bytes\n", (unsigned int)getScratchPeak(), (unsigned int)SCRATCH_SIZE);
+
+	finishTests();
+	exit(0);
+}
+
+#endif // #ifdef TEST_SCRATCH
@@ -0,0 +1,32 @@
+/** \file scratch.h
+  *
+  * \brief Describes functions and types exported by scratch.c.
+  *
+  * This file is licensed as described by the file LICENCE.
+  */
+
+#ifndef SCRATCH_H_INCLUDED
+#define SCRATCH_H_INCLUDED
+
+#include "common.h"
+
+#ifndef SCRATCH_SIZE
+/** Size, in bytes, of the scratch arena which scratchAllocate() allocates
+  * from. This must be large enough for the deepest nesting of scratch
+  * allocations, otherwise scratchAllocate() will call fatalError(); the
+  * unit tests check this using getScratchPeak(). This can be overridden by
+  * defining SCRATCH_SIZE in the platform's build settings. */
+#define SCRATCH_SIZE				512
+#endif // #ifndef SCRATCH_SIZE
+
+/** Position in the scratch arena, as returned by scratchMark(). Passing this
+  * to scratchRelease() frees everything allocated after the mark was
+  * taken. */
+typedef uint16_t ScratchMark;
+
+extern ScratchMark scratchMark(void);
+extern void *scratchAllocate(uint16_t size);
+extern void scratchRelease(ScratchMark mark);
+extern uint16_t getScratchPeak(void);
+
+#endif // #ifndef SCRATCH_H_INCLUDED
@@ -4,6 +4,20 @@
   *
   * The code here is based on formulae and pseudo-code in FIPS PUB 180-3.
   *
+  * On platforms with plenty of program memory and a reasonable number of
+  * registers, define SHA256_UNROLLED to use an alternative sha256Block()
+  * which unrolls the rounds and uses a 16 word rolling message schedule
+  * instead of a 64 word one. It is about 3 times larger.
+  *
+  * On hosts, define SHA256_MULTI_BUFFER so that sha256BlockMulti() hashes
+  * several independent message blocks at once, one per lane of a vector
+  * register. This uses GCC's generic vector extensions, so the compiler
+  * picks the instructions: SSE2 on x86-64 or NEON on ARM by default, or
+  * AVX2 if the build allows it (eg. -mavx2, or -march=native). Both SSE2
+  * and NEON are part of the baseline of those architectures, so no run-time
+  * CPU detection is needed. Without SHA256_MULTI_BUFFER, sha256BlockMulti()
+  * just calls sha256Block() for each hash state.
+  *
   * This file is licensed as described by the file LICENCE.
   */
 
@@ -14,12 +28,30 @@
 #include "test_helpers.h"
 #endif // #ifdef TEST_SHA256
 
+#ifdef BENCH_SHA256
+#include <stdlib.h>
+#include "test_helpers.h"
+#endif // #ifdef BENCH_SHA256
+
 #include "common.h"
 #include "hash.h"
 #include "sha256.h"
 
+#if CONSTANT_RAM_BUDGET >= (64 + 256)
+/** Storage attribute for #k. There's enough of #CONSTANT_RAM_BUDGET (after
+  * G in ecdsa.c) for #k, so it goes in RAM. */
+#define K_STORAGE
+/** Read one of the constants in #k. */
+#define LOOKUP_K(i)		(k[i])
+#else
+/** Storage attribute for #k. */
+#define K_STORAGE		PROGMEM
+/** Read one of the constants in #k. */
+#define LOOKUP_K(i)		(LOOKUP_DWORD(k[i]))
+#endif // #if CONSTANT_RAM_BUDGET >= (64 + 256)
+
 /** Constants for SHA-256. See section 4.2.2 of FIPS PUB 180-3. */
-static const uint32_t k[64] PROGMEM = {
+static const uint32_t k[64] K_STORAGE = {
 0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
@@ -37,6 +69,118 @@ static const uint32_t k[64] PROGMEM = {
 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
 
+#if defined(SHA256_MULTI_BUFFER) && !defined(__GNUC__)
+#error "SHA256_MULTI_BUFFER needs GCC's vector extensions"
+#endif // #if defined(SHA256_MULTI_BUFFER) && !defined(__GNUC__)
+
+#ifndef SHA256_LANES
+/** Number of message blocks which sha256BlockMulti() hashes at once, if
+  * SHA256_MULTI_BUFFER is defined. 4 fills a 128 bit vector register
+  * (SSE2, NEON); 8 fills a 256 bit one (AVX2). This can be overridden by
+  * defining SHA256_LANES in the platform's build settings. */
+#define SHA256_LANES				4
+#endif // #ifndef SHA256_LANES
+
+#if defined(SHA256_UNROLLED) || defined(SHA256_MULTI_BUFFER)
+
+// These are the same as the functions in the #else branch below, except
+// that they're macros, so that the unrolled rounds in sha256Block() don't
+// depend on the compiler's willingness to inline things. GCC recognises the
+// rotate idiom and will use a single instruction where there is one
+// (eg. "rotr" on MIPS32r2, "rors" on ARMv6-M).
+#define ROTR(x, n)			(((x) >> (n)) | ((x) << (32 - (n))))
+#define CH(x, y, z)			((z) ^ ((x) & ((y) ^ (z))))
+#define MAJ(x, y, z)		(((x) & (y)) | ((z) & ((x) | (y))))
+#define BIG_SIGMA0(x)		(ROTR(x, 2) ^ ROTR(x, 13) ^ ROTR(x, 22))
+#define BIG_SIGMA1(x)		(ROTR(x, 6) ^ ROTR(x, 11) ^ ROTR(x, 25))
+#define LITTLE_SIGMA0(x)	(ROTR(x, 7) ^ ROTR(x, 18) ^ ((x) >> 3))
+#define LITTLE_SIGMA1(x)	(ROTR(x, 17) ^ ROTR(x, 19) ^ ((x) >> 10))
+
+/** Calculate the next message schedule word, in place, in the 16 word
+  * rolling message schedule w. */
+#define SCHEDULE(i)			(w[i] += LITTLE_SIGMA1(w[((i) + 14) & 15]) + w[((i) + 9) & 15] + LITTLE_SIGMA0(w[((i) + 1) & 15]))
+
+/** One round of SHA-256. Instead of shuffling the working variables at the
+  * end of every round, the caller rotates the argument list. */
+#define ROUND(a, b, c, d, e, f, g, h, i) \
+	t1 = h + BIG_SIGMA1(e) + CH(e, f, g) + LOOKUP_K(t + (i)) + w[i]; \
+	d += t1; \
+	h = t1 + BIG_SIGMA0(a) + MAJ(a, b, c)
+
+/** Sixteen rounds of SHA-256, which use every word of the rolling
+  * message schedule once. */
+#define SIXTEEN_ROUNDS() \
+	ROUND(a, b, c, d, e, f, g, h, 0); \
+	ROUND(h, a, b, c, d, e, f, g, 1); \
+	ROUND(g, h, a, b, c, d, e, f, 2); \
+	ROUND(f, g, h, a, b, c, d, e, 3); \
+	ROUND(e, f, g, h, a, b, c, d, 4); \
+	ROUND(d, e, f, g, h, a, b, c, 5); \
+	ROUND(c, d, e, f, g, h, a, b, 6); \
+	ROUND(b, c, d, e, f, g, h, a, 7); \
+	ROUND(a, b, c, d, e, f, g, h, 8); \
+	ROUND(h, a, b, c, d, e, f, g, 9); \
+	ROUND(g, h, a, b, c, d, e, f, 10); \
+	ROUND(f, g, h, a, b, c, d, e, 11); \
+	ROUND(e, f, g, h, a, b, c, d, 12); \
+	ROUND(d, e, f, g, h, a, b, c, 13); \
+	ROUND(c, d, e, f, g, h, a, b, 14); \
+	ROUND(b, c, d, e, f, g, h, a, 15)
+
+#endif // #if defined(SHA256_UNROLLED) || defined(SHA256_MULTI_BUFFER)
+
+#ifdef SHA256_UNROLLED
+
+/** Update hash value based on the contents of a full message buffer.
+  * This is an implementation of HashState#hashBlock().
+  * This implements the pseudo-code in section 6.2.2 of FIPS PUB 180-3, but
+  * the rounds are unrolled (16 at a time) and only the most recent 16 words
+  * of the message schedule are kept. Since everything here is a macro, this
+  * doesn't call any other functions, so it can be a #RAM_FUNCTION.
+  * \param hs The hash state to update.
+  */
+static RAM_FUNCTION HOT_FUNCTION void sha256Block(HashState *hs)
+{
+	uint32_t a, b, c, d, e, f, g, h;
+	uint32_t t1;
+	uint8_t t;
+	uint8_t i;
+	uint32_t w[16];
+
+	for (i = 0; i < 16; i++)
+	{
+		w[i] = hs->m[i];
+	}
+	a = hs->h[0];
+	b = hs->h[1];
+	c = hs->h[2];
+	d = hs->h[3];
+	e = hs->h[4];
+	f = hs->h[5];
+	g = hs->h[6];
+	h = hs->h[7];
+	t = 0;
+	SIXTEEN_ROUNDS();
+	for (t = 16; t < 64; t = (uint8_t)(t + 16))
+	{
+		for (i = 0; i < 16; i++)
+		{
+			SCHEDULE(i);
+		}
+		SIXTEEN_ROUNDS();
+	}
+	hs->h[0] += a;
+	hs->h[1] += b;
+	hs->h[2] += c;
+	hs->h[3] += d;
+	hs->h[4] += e;
+	hs->h[5] += f;
+	hs->h[6] += g;
+	hs->h[7] += h;
+}
+
+#else
+
 /** Rotate right.
   * \param x The integer to rotate right.
   * \param n Number of times to rotate right.
@@ -110,7 +254,7 @@ static uint32_t littleSigma1(uint32_t x)
   * This implements the pseudo-code in section 6.2.2 of FIPS PUB 180-3.
   * \param hs The hash state to update.
   */
-static void sha256Block(HashState *hs)
+static HOT_FUNCTION void sha256Block(HashState *hs)
 {
 	uint32_t a, b, c, d, e, f, g, h;
 	uint32_t t1, t2;
@@ -135,7 +279,7 @@ static void sha256Block(HashState *hs)
 	h = hs->h[7];
 	for (t = 0; t < 64; t++)
 	{
-		t1 = h + bigSigma1(e) + ch(e, f, g) + LOOKUP_DWORD(k[t]) + w[t];
+		t1 = h + bigSigma1(e) + ch(e, f, g) + LOOKUP_K(t) + w[t];
 		t2 = bigSigma0(a) + maj(a, b, c);
 		h = g;
 		g = f;
@@ -156,6 +300,8 @@ static void sha256Block(HashState *hs)
 	hs->h[7] += h;
 }
 
+#endif // #ifdef SHA256_UNROLLED
+
 /** Begin calculating hash for new message.
   * See section 5.3.3 of FIPS PUB 180-3.
   * \param hs The hash state to initialise.
@@ -187,6 +333,19 @@ void sha256WriteByte(HashState *hs, uint8_t byte)
 	hashWriteByte(hs, byte);
 }
 
+/** Add an array of bytes to the message buffer, calling sha256Block()
+  * whenever the message buffer is full. This is faster than calling
+  * sha256WriteByte() for each byte.
+  * \param hs The hash state to act on. The hash state must be one that has
+  *           been initialised using sha256Begin() at some time in the past.
+  * \param bytes The bytes to add.
+  * \param length The number of bytes to add.
+  */
+void sha256WriteBytes(HashState *hs, const uint8_t *bytes, uint32_t length)
+{
+	hashWriteBytes(hs, bytes, length);
+}
+
 /** Finalise the hashing of a message by writing appropriate padding and
   * length bytes.
   * \param hs The hash state to act on. The hash state must be one that has
@@ -204,17 +363,204 @@ void sha256Finish(HashState *hs)
   */
 void sha256FinishDouble(HashState *hs)
 {
-	uint8_t temp[32];
+	sha256Finish(hs);
+	sha256Rehash(hs);
+}
+
+/** Calculate the SHA-256 hash of a short message in one go. This gives the
+  * same result as sha256Begin(), sha256WriteBytes() then sha256Finish(),
+  * but only calls sha256Block() once (see hashShortMessage()).
+  * \param hs The hash state to use. When this returns, the hash will be in
+  *           HashState#h, just as if sha256Finish() had been called.
+  * \param message The message to hash.
+  * \param length The length of the message, in bytes. This must be no more
+  *               than #HASH_SHORT_MESSAGE_MAX.
+  */
+void sha256Short(HashState *hs, const uint8_t *message, uint8_t length)
+{
+	sha256Begin(hs);
+	hashShortMessage(hs, message, length);
+}
+
+/** Replace a finished SHA-256 hash with the SHA-256 hash of it, as needed
+  * for a double SHA-256 hash. The 32 byte message is always exactly the
+  * words of the first hash, so the message block (including padding) is
+  * filled in from them directly, without going through a byte array.
+  * \param hs The hash state to act on. sha256Finish() (or sha256Short())
+  *           must have been called on it.
+  */
+void sha256Rehash(HashState *hs)
+{
+	uint32_t first_hash[8];
 	uint8_t i;
 
-	sha256Finish(hs);
-	writeHashToByteArray(temp, hs, true);
+	for (i = 0; i < 8; i++)
+	{
+		first_hash[i] = hs->h[i];
+	}
 	sha256Begin(hs);
-	for (i = 0; i < 32; i++)
+	for (i = 0; i < 8; i++)
 	{
-		sha256WriteByte(hs, temp[i]);
+		hs->m[i] = first_hash[i];
+	}
+	hs->m[8] = 0x80000000;
+	// m[9] to m[14] were cleared by sha256Begin().
+	hs->m[15] = 256; // length in bits
+	sha256Block(hs);
+	clearM(hs);
+}
+
+#ifdef SHA256_MULTI_BUFFER
+
+/** A vector with one 32 bit word for each lane. The macros used by
+  * sha256Block() (when SHA256_UNROLLED is defined) work unchanged on these,
+  * since GCC applies arithmetic and shifts to each lane separately. */
+typedef uint32_t Sha256Vector __attribute__((vector_size(SHA256_LANES * 4)));
+
+/** Update up to #SHA256_LANES hash states at once, one per vector lane.
+  * \param states The hash states to update. Each one must have a full
+  *               message buffer.
+  * \param count The number of hash states in states. This must be between 1
+  *              and #SHA256_LANES inclusive. Unused lanes duplicate the
+  *              first hash state, and their results are thrown away.
+  */
+static void sha256BlockLanes(HashState **states, uint8_t count)
+{
+	Sha256Vector a, b, c, d, e, f, g, h;
+	Sha256Vector t1;
+	Sha256Vector w[16];
+	Sha256Vector initial[8];
+	HashState *hs;
+	uint8_t t;
+	uint8_t i;
+	uint8_t lane;
+
+	for (lane = 0; lane < SHA256_LANES; lane++)
+	{
+		hs = states[(lane < count) ? lane : 0];
+		for (i = 0; i < 16; i++)
+		{
+			w[i][lane] = hs->m[i];
+		}
+		for (i = 0; i < 8; i++)
+		{
+			initial[i][lane] = hs->h[i];
+		}
+	}
+	a = initial[0];
+	b = initial[1];
+	c = initial[2];
+	d = initial[3];
+	e = initial[4];
+	f = initial[5];
+	g = initial[6];
+	h = initial[7];
+	t = 0;
+	SIXTEEN_ROUNDS();
+	for (t = 16; t < 64; t = (uint8_t)(t + 16))
+	{
+		for (i = 0; i < 16; i++)
+		{
+			SCHEDULE(i);
+		}
+		SIXTEEN_ROUNDS();
+	}
+	for (lane = 0; lane < count; lane++)
+	{
+		hs = states[lane];
+		hs->h[0] += a[lane];
+		hs->h[1] += b[lane];
+		hs->h[2] += c[lane];
+		hs->h[3] += d[lane];
+		hs->h[4] += e[lane];
+		hs->h[5] += f[lane];
+		hs->h[6] += g[lane];
+		hs->h[7] += h[lane];
+	}
+}
+
+#endif // #ifdef SHA256_MULTI_BUFFER
+
+/** Update several independent hash states, each of which has a full message
+  * buffer, as if sha256Block() was called on each one. This is for callers
+  * which fill HashState#m themselves (see hash160Batch()). If
+  * SHA256_MULTI_BUFFER is defined, #SHA256_LANES blocks are hashed at once.
+  * Like sha256Block(), this doesn't clear or otherwise touch the message
+  * buffers.
+  * \param states The hash states to update. Each one must have been
+  *               initialised using sha256Begin().
+  * \param count The number of hash states in states.
+  */
+void sha256BlockMulti(HashState **states, uint8_t count)
+{
+#ifdef SHA256_MULTI_BUFFER
+	uint8_t n;
+
+	while (count > 0)
+	{
+		n = (uint8_t)MIN(count, SHA256_LANES);
+		sha256BlockLanes(states, n);
+		states += n;
+		count = (uint8_t)(count - n);
+	}
+#else
+	uint8_t i;
+
+	for (i = 0; i < count; i++)
+	{
+		sha256Block(states[i]);
+	}
+#endif // #ifdef SHA256_MULTI_BUFFER
+}
+
+/** Begin calculating two SHA-256 hashes which will absorb mostly the same
+  * bytes. See #Sha256Pair for more information.
+  * \param pair The pair to initialise.
+  * \param hs_a The hash state to use for lane A (which receives every byte).
+  * \param hs_b The hash state to use for lane B (which may skip bytes).
+  */
+void sha256PairBegin(Sha256Pair *pair, HashState *hs_a, HashState *hs_b)
+{
+	pair->hs_a = hs_a;
+	pair->hs_b = hs_b;
+	pair->in_lockstep = true;
+	sha256Begin(hs_a);
+}
+
+/** Add an array of bytes to lane A of a pair and, optionally, to lane B.
+  * \param pair The pair to act on. This must have been initialised using
+  *             sha256PairBegin() at some time in the past.
+  * \param bytes The bytes to add.
+  * \param length The number of bytes to add.
+  * \param include_b If this is true, the bytes will be added to both lanes.
+  *                  If this is false, they will only be added to lane A.
+  */
+void sha256PairWriteBytes(Sha256Pair *pair, const uint8_t *bytes, uint32_t length, bool include_b)
+{
+	if (pair->in_lockstep && !include_b)
+	{
+		// The lanes are about to diverge.
+		sha256PairSync(pair);
+		pair->in_lockstep = false;
+	}
+	sha256WriteBytes(pair->hs_a, bytes, length);
+	if (!pair->in_lockstep && include_b)
+	{
+		sha256WriteBytes(pair->hs_b, bytes, length);
+	}
+}
+
+/** Make sure that lane B of a pair is up to date. This must be called
+  * before lane B's hash state is finished or otherwise used directly.
+  * \param pair The pair to act on. This must have been initialised using
+  *             sha256PairBegin() at some time in the past.
+  */
+void sha256PairSync(Sha256Pair *pair)
+{
+	if (pair->in_lockstep)
+	{
+		memcpy(pair->hs_b, pair->hs_a, sizeof(HashState));
 	}
-	sha256Finish(hs);
 }
 
 #ifdef TEST_SHA256
@@ -223,19 +569,23 @@ void sha256FinishDouble(HashState *hs)
 static uint32_t h[8];
 
 /** Calculate SHA-256 hash of a message. The result is returned in #h.
+  * The first byte is written using sha256WriteByte() and the rest are
+  * written using sha256WriteBytes(), so that both are tested, and so that
+  * sha256WriteBytes() has to deal with a message buffer which isn't
+  * word-aligned.
   * \param message The message to calculate the hash of. This must be a byte
   *                array of the size specified by length.
   * \param length The length (in bytes) of the message.
   */
 static void sha256(uint8_t *message, uint32_t length)
 {
-	uint32_t i;
 	HashState hs;
 
 	sha256Begin(&hs);
-	for (i = 0; i < length; i++)
+	if (length > 0)
 	{
-		sha256WriteByte(&hs, message[i]);
+		sha256WriteByte(&hs, message[0]);
+		sha256WriteBytes(&hs, &(message[1]), length - 1);
 	}
 	sha256Finish(&hs);
 	memcpy(h, hs.h, 32);
@@ -334,13 +684,207 @@ http://csrc.nist.gov/groups/STM/cavp/index.html#03", filename);
 	fclose(f);
 }
 
+/** Test that a #Sha256Pair gives the same results as two independent hash
+  * states, for a range of points where lane B stops and starts skipping
+  * bytes.
+  */
+static void testPair(void)
+{
+	uint8_t message[300];
+	HashState hs_a;
+	HashState hs_b;
+	HashState compare_a;
+	HashState compare_b;
+	Sha256Pair pair;
+	unsigned int skip_start;
+	unsigned int skip_end;
+	unsigned int i;
+
+	for (i = 0; i < sizeof(message); i++)
+	{
+		message[i] = (uint8_t)(i * 7 + 3);
+	}
+	for (skip_start = 0; skip_start < sizeof(message); skip_start += 37)
+	{
+		for (skip_end = skip_start; skip_end < sizeof(message); skip_end += 53)
+		{
+			// Lane B skips bytes skip_start to skip_end - 1 (inclusive).
+			sha256PairBegin(&pair, &hs_a, &hs_b);
+			sha256PairWriteBytes(&pair, message, skip_start, true);
+			sha256PairWriteBytes(&pair, &(message[skip_start]), skip_end - skip_start, false);
+			sha256PairWriteBytes(&pair, &(message[skip_end]), sizeof(message) - skip_end, true);
+			sha256PairSync(&pair);
+			sha256Finish(&hs_a);
+			sha256Finish(&hs_b);
+			sha256Begin(&compare_a);
+			sha256WriteBytes(&compare_a, message, sizeof(message));
+			sha256Finish(&compare_a);
+			sha256Begin(&compare_b);
+			sha256WriteBytes(&compare_b, message, skip_start);
+			sha256WriteBytes(&compare_b, &(message[skip_end]), sizeof(message) - skip_end);
+			sha256Finish(&compare_b);
+			if (memcmp(hs_a.h, compare_a.h, 32) || memcmp(hs_b.h, compare_b.h, 32))
+			{
+				printf("Sha256Pair mismatch, skip_start = %u, skip_end = %u\n", skip_start, skip_end);
+				reportFailure();
+			}
+			else
+			{
+				reportSuccess();
+			}
+		}
+	}
+}
+
+/** Check that sha256Short() and sha256Rehash() give the same results as
+  * the general functions, for every message length sha256Short() accepts.
+  */
+static void testShort(void)
+{
+	uint8_t message[HASH_SHORT_MESSAGE_MAX];
+	uint8_t first_hash[32];
+	HashState hs;
+	HashState compare;
+	unsigned int length;
+
+	for (length = 0; length <= HASH_SHORT_MESSAGE_MAX; length++)
+	{
+		fillWithRandom(message, length);
+		sha256Short(&hs, message, (uint8_t)length);
+		sha256Begin(&compare);
+		sha256WriteBytes(&compare, message, length);
+		sha256Finish(&compare);
+		if (memcmp(hs.h, compare.h, 32))
+		{
+			printf("sha256Short() mismatch, length = %u\n", length);
+			reportFailure();
+		}
+		else
+		{
+			reportSuccess();
+		}
+		// Double hash the long way.
+		writeHashToByteArray(first_hash, &compare, true);
+		sha256Begin(&compare);
+		sha256WriteBytes(&compare, first_hash, 32);
+		sha256Finish(&compare);
+		sha256Rehash(&hs);
+		if (memcmp(hs.h, compare.h, 32))
+		{
+			printf("sha256Rehash() mismatch, length = %u\n", length);
+			reportFailure();
+		}
+		else
+		{
+			reportSuccess();
+		}
+	}
+}
+
+/** Maximum number of hash states to give sha256BlockMulti() in
+  * testBlockMulti(). This is more than #SHA256_LANES so that groups of
+  * lanes, and a partly filled final group, are both covered. */
+#define TEST_MULTI_STATES			19
+
+/** Check that sha256BlockMulti() gives the same results as sha256Block() on
+  * each hash state, for every number of hash states up to
+  * #TEST_MULTI_STATES.
+  */
+static void testBlockMulti(void)
+{
+	HashState hs[TEST_MULTI_STATES];
+	HashState compare[TEST_MULTI_STATES];
+	HashState *states[TEST_MULTI_STATES];
+	uint8_t count;
+	uint8_t block;
+	uint8_t i;
+	bool failed;
+
+	for (count = 1; count <= TEST_MULTI_STATES; count++)
+	{
+		for (i = 0; i < count; i++)
+		{
+			sha256Begin(&(hs[i]));
+			sha256Begin(&(compare[i]));
+			states[i] = &(hs[i]);
+		}
+		// Use two blocks, so that the chaining values differ between lanes.
+		for (block = 0; block < 2; block++)
+		{
+			for (i = 0; i < count; i++)
+			{
+				fillWithRandom((uint8_t *)hs[i].m, sizeof(hs[i].m));
+				memcpy(compare[i].m, hs[i].m, sizeof(hs[i].m));
+				sha256Block(&(compare[i]));
+			}
+			sha256BlockMulti(states, count);
+		}
+		failed = false;
+		for (i = 0; i < count; i++)
+		{
+			if (memcmp(hs[i].h, compare[i].h, 32))
+			{
+				failed = true;
+			}
+		}
+		if (failed)
+		{
+			printf("sha256BlockMulti() mismatch, count = %u\n", count);
+			reportFailure();
+		}
+		else
+		{
+			reportSuccess();
+		}
+	}
+}
+
 int main(void)
 {
 	initTests(__FILE__);
 	scanTestVectors("SHA256ShortMsg.rsp");
 	scanTestVectors("SHA256LongMsg.rsp");
+	testPair();
+	testShort();
+	testBlockMulti();
 	finishTests();
 	exit(0);
 }
 
 #endif // #ifdef TEST_SHA256
+
+#ifdef BENCH_SHA256
+
+/** Input for the SHA-256 benchmarks. */
+static uint8_t bench_input[1024];
+
+/** Hash a short (one block) message. */
+static void benchSha256Short(void)
+{
+	HashState hs;
+
+	sha256Begin(&hs);
+	sha256WriteBytes(&hs, bench_input, 64);
+	sha256Finish(&hs);
+}
+
+/** Hash a 1024 byte message. */
+static void benchSha256Long(void)
+{
+	HashState hs;
+
+	sha256Begin(&hs);
+	sha256WriteBytes(&hs, bench_input, sizeof(bench_input));
+	sha256Finish(&hs);
+}
+
+int main(void)
+{
+	initBenchmarks(__FILE__);
+	fillWithRandom(bench_input, sizeof(bench_input));
+	runHostBenchmark("sha256_64", &benchSha256Short, 64);
+	runHostBenchmark("sha256_1024", &benchSha256Long, sizeof(bench_input));
+	exit(0);
+}
+
+#endif // #ifdef BENCH_SHA256
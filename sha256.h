@@ -3,10 +3,14 @@
   * \brief Describes functions and constants exported by sha256.c.
   *
   * To calculate a SHA-256 hash, call sha256Begin(), then call
-  * sha256WriteByte() for each byte of the message, then call
+  * sha256WriteByte() for each byte of the message (or sha256WriteBytes()
+  * for an array of bytes), then call
   * sha256Finish() (or sha256FinishDouble(), if you want a double SHA-256
   * hash). The hash will be in HashState#h, but it can also be
   * extracted and placed into to a byte array using writeHashToByteArray().
+  * Messages of up to #HASH_SHORT_MESSAGE_MAX bytes can instead be hashed
+  * with a single call to sha256Short(), and a finished hash can be hashed
+  * again using sha256Rehash().
   *
   * This file is licensed as described by the file LICENCE.
   */
@@ -20,9 +24,33 @@
 /** Length, in bytes, of the output of the SHA-256 hash function. */
 #define SHA256_HASH_LENGTH 32
 
+/** A pair of SHA-256 hash states ("lanes") which absorb mostly the same
+  * bytes. Lane A receives every byte, while lane B may skip some bytes.
+  * As long as both lanes have received identical bytes, only lane A is
+  * actually updated, so the work of hashing those bytes is shared. Once
+  * lane B skips some bytes, lane A is copied into lane B and the lanes are
+  * updated separately from then on. */
+typedef struct Sha256PairStruct
+{
+	/** Hash state of lane A. */
+	HashState *hs_a;
+	/** Hash state of lane B. This is only valid if
+	  * Sha256Pair#in_lockstep is false. */
+	HashState *hs_b;
+	/** true if both lanes have received identical bytes so far. */
+	bool in_lockstep;
+} Sha256Pair;
+
 extern void sha256Begin(HashState *hs);
 extern void sha256WriteByte(HashState *hs, uint8_t byte);
+extern void sha256WriteBytes(HashState *hs, const uint8_t *bytes, uint32_t length);
 extern void sha256Finish(HashState *hs);
 extern void sha256FinishDouble(HashState *hs);
+extern void sha256Short(HashState *hs, const uint8_t *message, uint8_t length);
+extern void sha256Rehash(HashState *hs);
+extern void sha256BlockMulti(HashState **states, uint8_t count);
+extern void sha256PairBegin(Sha256Pair *pair, HashState *hs_a, HashState *hs_b);
+extern void sha256PairWriteBytes(Sha256Pair *pair, const uint8_t *bytes, uint32_t length, bool include_b);
+extern void sha256PairSync(Sha256Pair *pair);
 
 #endif // #ifndef SHA256_H_INCLUDED
@@ -16,6 +16,11 @@
   * - Some (RAM) space efficiency is achieved by storing samples in a
   *   histogram (see #packed_histogram_buffer), instead of storing them in a
   *   FIFO buffer.
+  * - Sums of powers of samples (see #power_sums) and the sum needed for
+  *   entropy estimation (see #entropy_sum) are accumulated as samples are
+  *   added, so that calculateMoments() and estimateEntropy() don't have to
+  *   walk the histogram. The logarithms which estimateEntropy() needs come
+  *   from a small lookup table (see log2Lookup()).
   *
   * This file is licensed as described by the file LICENCE.
   */
@@ -24,6 +29,7 @@
 #include "fix16.h"
 #include "fft.h"
 #include "statistics.h"
+#include "statistics_log2_table.h"
 
 /** The maximum number of counts which can be held in one histogram bin. */
 #define MAX_HISTOGRAM_VALUE			((1 << BITS_PER_HISTOGRAM_BIN) - 1)
@@ -39,41 +45,44 @@
   * value, and each bin has an associated count, which represents how many
   * times that value occurred.
   */
-static uint32_t packed_histogram_buffer[((HISTOGRAM_NUM_BINS * BITS_PER_HISTOGRAM_BIN) / 32) + 1];
+static THREAD_LOCAL uint32_t packed_histogram_buffer[((HISTOGRAM_NUM_BINS * BITS_PER_HISTOGRAM_BIN) / 32) + 1];
 
 /** An estimate of the power spectral density of the HWRNG. As more samples
   * are collected, FFT results will be accumulated here. The more samples,
   * the more accurate the estimate will be.
   */
-fix16_t psd_accumulator[FFT_SIZE + 1];
+THREAD_LOCAL fix16_t psd_accumulator[FFT_SIZE + 1];
 
 /** This will be true if there was an arithmetic error in the calculation
   * of power spectral density (see #psd_accumulator). This will be false if
   * there haven't been any arithmetic errors so far.
   */
-bool psd_accumulator_error_occurred;
+THREAD_LOCAL bool psd_accumulator_error_occurred;
 
 /** This will be set to true if one of the histogram bins overflows. */
-bool histogram_overflow_occurred;
+THREAD_LOCAL bool histogram_overflow_occurred;
 /** Number of samples that have been placed in the histogram. */
-uint32_t samples_in_histogram;
-/** The index (bin number) into the histogram buffer where the histogram
-  * iterator is currently at. */
-static uint32_t iterator_index;
-/** The count within a histogram bin where the histogram iterator is currently
-  * at. */
-static uint32_t iterator_count;
-/** Cached value of histogram counts in the bin specified by #iterator_index.
-  * This is used to speed up getTermFromIterator(). */
-static uint32_t cached_histogram_count;
-/** Cached value of scaled sample value for the bin specified
-  * by #iterator_index. This is used to speed up getTermFromIterator(). */
-static fix16_t cached_scaled_sample;
+THREAD_LOCAL uint32_t samples_in_histogram;
+/** Sums of powers of (sample - #HISTOGRAM_NUM_BINS / 2), over every sample
+  * in the histogram. Entry k - 1 is the sum of the k-th powers. These are
+  * exact: with #SAMPLE_COUNT samples of at most 10 bits each, the largest
+  * sum (of fourth powers) is less than 2 ^ 48. */
+static THREAD_LOCAL int64_t power_sums[4];
+/** Sum of c * log2lookup(c) over every histogram bin, where c is the count
+  * in that bin and log2lookup() is log2Lookup(). This is in Q16.16
+  * representation. Because the same log2Lookup() values are added and
+  * subtracted as bins change, this doesn't accumulate rounding errors. */
+static THREAD_LOCAL int64_t entropy_sum;
+/** The largest count in any histogram bin. */
+static THREAD_LOCAL uint32_t max_histogram_count;
 
 /** Reset all histogram counts to 0. */
 void clearHistogram(void)
 {
 	memset(packed_histogram_buffer, 0, sizeof(packed_histogram_buffer));
+	memset(power_sums, 0, sizeof(power_sums));
+	entropy_sum = 0;
+	max_histogram_count = 0;
 	samples_in_histogram = 0;
 	histogram_overflow_occurred = false;
 }
@@ -151,13 +160,112 @@ static void putHistogram(uint32_t index, uint32_t value)
 	}
 }
 
+/** Calculate the base 2 logarithm of an integer, using #log2_lookup and
+  * linear interpolation. The result is accurate to about 1 LSB.
+  * \param x The integer to take the logarithm of. This must be non-zero.
+  * \return log2(x), in Q16.16 representation.
+  */
+static uint32_t log2Lookup(uint32_t x)
+{
+	uint32_t exponent;
+	uint32_t index;
+	uint32_t fraction;
+	uint32_t lower;
+	uint32_t upper;
+
+	if (x == 0)
+	{
+		// This should never happen.
+		fix16_error_occurred = true;
+		return 0;
+	}
+	// Normalise x so that its most significant bit is bit 31. Then x
+	// represents a mantissa in [1, 2).
+	exponent = 31;
+	if ((x & 0xffff0000) == 0)
+	{
+		x <<= 16;
+		exponent -= 16;
+	}
+	if ((x & 0xff000000) == 0)
+	{
+		x <<= 8;
+		exponent -= 8;
+	}
+	if ((x & 0xf0000000) == 0)
+	{
+		x <<= 4;
+		exponent -= 4;
+	}
+	if ((x & 0xc0000000) == 0)
+	{
+		x <<= 2;
+		exponent -= 2;
+	}
+	if ((x & 0x80000000) == 0)
+	{
+		x <<= 1;
+		exponent -= 1;
+	}
+	// The bits after the leading 1 select a table entry and the position
+	// between that entry and the next one.
+	index = (x >> (31 - LOG2_TABLE_BITS)) & (LOG2_TABLE_SIZE - 1);
+	fraction = (x >> (31 - LOG2_TABLE_BITS - 16)) & 0xffff;
+	lower = log2_lookup[index];
+	if (index == (LOG2_TABLE_SIZE - 1))
+	{
+		upper = 0x00010000; // log2(2) = 1
+	}
+	else
+	{
+		upper = log2_lookup[index + 1];
+	}
+	return (exponent << 16) + lower + (((upper - lower) * fraction + 0x8000) >> 16);
+}
+
+/** Calculate count * log2(count), which is each bin's contribution to
+  * #entropy_sum.
+  * \param count The count in the histogram bin.
+  * \return count * log2(count), in Q16.16 representation.
+  */
+static int64_t entropyTerm(uint32_t count)
+{
+	if (count == 0)
+	{
+		return 0; // the limit of x * log2(x) as x -> 0 is 0
+	}
+	return (int64_t)count * log2Lookup(count);
+}
+
 /** Increments the count of a histogram bin.
   * \param index The histogram bin to modify.
   */
 void incrementHistogram(uint32_t index)
 {
-	putHistogram(index, getHistogram(index) + 1);
+	int32_t x;
+	int32_t x_squared;
+	uint32_t count;
+
+	count = getHistogram(index);
+	putHistogram(index, count + 1);
 	samples_in_histogram++;
+	if ((index < HISTOGRAM_NUM_BINS) && (count < MAX_HISTOGRAM_VALUE))
+	{
+		entropy_sum += entropyTerm(count + 1) - entropyTerm(count);
+		if ((count + 1) > max_histogram_count)
+		{
+			max_histogram_count = count + 1;
+		}
+	}
+	if (index < HISTOGRAM_NUM_BINS)
+	{
+		x = (int32_t)index - (HISTOGRAM_NUM_BINS / 2);
+		x_squared = x * x;
+		power_sums[0] += x;
+		power_sums[1] += x_squared;
+		power_sums[2] += (int64_t)x_squared * x;
+		power_sums[3] += (int64_t)x_squared * x_squared;
+	}
 }
 
 /** Apply scaling and an offset to ADC sample values so that overflow will
@@ -175,128 +283,141 @@ fix16_t scaleSample(int sample_int)
 	return r;
 }
 
-/** This must be called whenever the iterator is active and #iterator_index
-  * changes. */
-static void updateIteratorCache(void)
-{
-	cached_histogram_count = getHistogram(iterator_index);
-	cached_scaled_sample = scaleSample((int)iterator_index);
-}
-
-/** Reset the histogram iterator back to the start. */
-static void resetIterator(void)
-{
-	iterator_index = 0;
-	iterator_count = 0;
-	updateIteratorCache();
-}
-
-/** Uses an iterator over the histogram to obtain one term in a central
-  * moment calculation. The iterator goes over each item (count) from each
-  * histogram bin (index).
-  * \param mean The mean to calculate the central moment about.
-  * \param power Which central moment to calculate (1 = first, 2 = second
-  *              etc.). This must be positive and non-zero.
-  * \return One term for the calculation of the specified central moment.
+/** Divide, rounding the quotient to the nearest integer.
+  * \param dividend The number to divide.
+  * \param divisor The number to divide by. This must be positive.
+  * \return The rounded quotient.
   */
-static fix16_t getTermFromIterator(fix16_t mean, uint32_t power)
+static int64_t divideAndRound(int64_t dividend, int64_t divisor)
 {
-	uint32_t i;
-	fix16_t scaled_sample;
-	fix16_t r;
-
-	// Search for the index (bin number) of the next count.
-	while (iterator_count >= cached_histogram_count)
+	if (dividend >= 0)
 	{
-		iterator_count = 0;
-		iterator_index++;
-		if (iterator_index >= HISTOGRAM_NUM_BINS)
-		{
-			// Iterator ran past end of samples. This should never happen.
-			fix16_error_occurred = true;
-			return fix16_zero;
-		}
-		updateIteratorCache();
+		return (dividend + (divisor >> 1)) / divisor;
 	}
-
-	iterator_count++;
-	scaled_sample = fix16_sub(cached_scaled_sample, mean);
-	r = scaled_sample;
-	for (i = 1; i < power; i++)
+	else
 	{
-		r = fix16_mul(r, scaled_sample);
+		return -((-dividend + (divisor >> 1)) / divisor);
 	}
-	return r;
 }
 
-/** Recursive handler for calculateCentralMoment(). Recursion is used to do
-  * pairwise averaging. Pairwise averaging is just like pairwise summation,
-  * except there's a divide by 2 after each sum.
-  * Why do pairwise averaging? So that overflow is less likely to occur.
-  * \param mean The mean to calculate the central moment about.
-  * \param power Which central moment to calculate (1 = first, 2 = second
-  *              etc.).
-  * \param level The number of terms to use in the estimation of the central
-  *              moment.
-  * \return An estimate of the value of the specified central moment.
+/** Convert a sum of #SAMPLE_COUNT terms, each a product of power unscaled
+  * samples, into the fixed-point average of the corresponding scaled terms.
+  * The scaling is the same as scaleSample()'s.
+  * \param sum The sum to convert.
+  * \param power The number of samples in the product in each term.
+  * \return The fixed-point average. If it doesn't fit in a fix16_t,
+  *         #fix16_error_occurred will be set.
   */
-static fix16_t calculateCentralMomentRecursive(fix16_t mean, uint32_t power, uint32_t level)
+static fix16_t sumToFix16(int64_t sum, uint32_t power)
 {
-	fix16_t term1;
-	fix16_t term2;
+	int64_t divisor;
+	uint32_t i;
 
-	if (level <= 2)
+	// The divisor is SAMPLE_COUNT * SAMPLE_SCALE_DOWN ^ power / 65536. The
+	// division by 65536 converts the result to Q16.16 representation.
+#if ((SAMPLE_COUNT * SAMPLE_SCALE_DOWN) < 65536)
+#error "SAMPLE_COUNT * SAMPLE_SCALE_DOWN too small"
+#endif // #if ((SAMPLE_COUNT * SAMPLE_SCALE_DOWN) < 65536)
+	divisor = (SAMPLE_COUNT * SAMPLE_SCALE_DOWN) / 65536;
+	for (i = 1; i < power; i++)
 	{
-		term1 = getTermFromIterator(mean, power);
-		term2 = getTermFromIterator(mean, power);
+		divisor *= SAMPLE_SCALE_DOWN;
 	}
-	else
+	sum = divideAndRound(sum, divisor);
+	if ((sum > fix16_maximum) || (sum <= fix16_minimum))
 	{
-		term1 = calculateCentralMomentRecursive(mean, power, level >> 1);
-		term2 = calculateCentralMomentRecursive(mean, power, level >> 1);
+		fix16_error_occurred = true;
+		return fix16_overflow;
 	}
-	return fix16_mul(fix16_add(term1, term2), FIX16_RECIPROCAL_OF(2));
+	return (fix16_t)sum;
 }
 
-/** Examines the histogram and calculates a central moment from it. This does
-  * require the mean to be known. If the mean is not known, it can be
-  * calculated using this function by passing mean = 0.0 and power = 1.
-  * \param mean The mean to calculate the central moment about.
-  * \param power Which central moment to calculate (1 = first, 2 = second
-  *              etc.).
-  * \return The value of the specified central moment
+/** Calculate the mean and the second, third and fourth central moments of
+  * the samples in the histogram. This uses the sums of powers accumulated
+  * by incrementHistogram(), so it takes constant time. Samples are scaled
+  * and offset as in scaleSample().
+  *
+  * All the calculations on the (unscaled) sums are done exactly using 64 bit
+  * integers. The histogram must contain exactly #SAMPLE_COUNT samples,
+  * otherwise the results will be wrong and intermediate values may
+  * overflow.
+  * \param out_mean The mean will be written here.
+  * \param out_variance The variance (second central moment) will be written
+  *                     here.
+  * \param out_kappa3 The third central moment will be written here.
+  * \param out_kappa4 The fourth central moment will be written here.
   */
-fix16_t calculateCentralMoment(fix16_t mean, uint32_t power)
+void calculateMoments(fix16_t *out_mean, fix16_t *out_variance, fix16_t *out_kappa3, fix16_t *out_kappa4)
 {
-	resetIterator();
-	return calculateCentralMomentRecursive(mean, power, SAMPLE_COUNT);
+	int64_t c;
+	int64_t c2;
+	int64_t c3;
+	int64_t t1;
+	int64_t t2;
+	int64_t t3;
+	int64_t t4;
+	int64_t m2;
+	int64_t m3;
+	int64_t m4;
+
+	// Move the origin to c, which is the mean rounded to the nearest
+	// integer. Using the binomial theorem, the sums of powers of
+	// (sample - c) can be calculated exactly from the sums of powers of
+	// samples.
+	c = divideAndRound(power_sums[0], SAMPLE_COUNT);
+	c2 = c * c;
+	c3 = c2 * c;
+	t1 = power_sums[0] - (SAMPLE_COUNT * c);
+	t2 = power_sums[1] - (2 * c * power_sums[0]) + (SAMPLE_COUNT * c2);
+	t3 = power_sums[2] - (3 * c * power_sums[1]) + (3 * c2 * power_sums[0]) - (SAMPLE_COUNT * c3);
+	t4 = power_sums[3] - (4 * c * power_sums[2]) + (6 * c2 * power_sums[1]) - (4 * c3 * power_sums[0]) + (SAMPLE_COUNT * c3 * c);
+	// Now the distance between c and the mean is t1 / SAMPLE_COUNT, which
+	// is at most 0.5. So the terms which correct for that distance are
+	// small, and rounding them causes negligible error.
+	m2 = t2 - divideAndRound(t1 * t1, SAMPLE_COUNT);
+	m3 = t3 - divideAndRound(3 * t1 * t2, SAMPLE_COUNT) + divideAndRound(2 * t1 * t1 * t1, (int64_t)SAMPLE_COUNT * SAMPLE_COUNT);
+	m4 = t4 - divideAndRound(4 * t1 * t3, SAMPLE_COUNT) + divideAndRound(6 * t1 * t1 * t2, (int64_t)SAMPLE_COUNT * SAMPLE_COUNT) - divideAndRound(3 * t1 * t1 * t1 * t1, (int64_t)SAMPLE_COUNT * SAMPLE_COUNT * SAMPLE_COUNT);
+
+	*out_mean = sumToFix16(power_sums[0], 1);
+	*out_variance = sumToFix16(m2, 2);
+	*out_kappa3 = sumToFix16(m3, 3);
+	*out_kappa4 = sumToFix16(m4, 4);
 }
 
 /** Obtains an estimate of the (Shannon) entropy per sample, based on the
-  * histogram.
+  * histogram. Since the sum this needs is maintained by incrementHistogram(),
+  * this takes constant time, and it can be called at any time, not just when
+  * the histogram contains #SAMPLE_COUNT samples.
   * \return The value of the estimate, in bits per sample.
   */
 fix16_t estimateEntropy(void)
 {
-	uint32_t i;
-	fix16_t sum;
-	fix16_t term;
-	fix16_t log_term;
+	uint32_t n;
 
 	// Definition of (Shannon) entropy: H(X) = sum(-p(x_i) * log(p(x_i))).
-	sum = fix16_zero;
-	for (i = 0; i < HISTOGRAM_NUM_BINS; i++)
+	// With p(x_i) = c_i / n, where c_i is the count in bin i and n is the
+	// number of samples, this is log2(n) - sum(c_i * log2(c_i)) / n.
+	n = samples_in_histogram;
+	if (n == 0)
 	{
-		term = fix16_from_int(getHistogram(i));
-		if (term != fix16_zero)
-		{
-			term = fix16_mul(term, FIX16_RECIPROCAL_OF(SAMPLE_COUNT));
-			log_term = fix16_log2(term);
-			term = fix16_mul(term, log_term);
-			sum = fix16_sub(sum, term);
-		}
+		return fix16_zero;
+	}
+	return (fix16_t)((int64_t)log2Lookup(n) - divideAndRound(entropy_sum, n));
+}
+
+/** Obtains an estimate of the min-entropy per sample, based on the
+  * histogram. The min-entropy is -log2(max(p(x_i))), so it's determined by
+  * the most frequent sample value. It is never more than the Shannon entropy
+  * estimated by estimateEntropy(). This takes constant time.
+  * \return The value of the estimate, in bits per sample.
+  */
+fix16_t estimateMinEntropy(void)
+{
+	if ((samples_in_histogram == 0) || (max_histogram_count == 0))
+	{
+		return fix16_zero;
 	}
-	return sum;
+	return (fix16_t)((int32_t)log2Lookup(samples_in_histogram) - (int32_t)log2Lookup(max_histogram_count));
 }
 
 /** Subtract the mean off every input value in a FFT buffer. Both real and
@@ -407,7 +528,14 @@ void accumulatePowerSpectralDensity(volatile uint16_t *source_buffer)
 }
 
 /** Calculate the (cyclic) autocorrelation by using the power spectral density
-  * estimate (#psd_accumulator).
+  * estimate (#psd_accumulator). By the Wiener-Khinchin theorem, the
+  * autocorrelation is the inverse Fourier transform of the power spectral
+  * density, so this only needs one inverse FFT; the forward FFTs were
+  * already done by accumulatePowerSpectralDensity(). The power spectral
+  * density is real and even-symmetric, so fftPostProcessRealEven() is used
+  * to finish the transform, which does half the multiplications of
+  * fftPostProcessReal(). Only the real components of the result are
+  * meaningful; the imaginary components are set to 0.
   * \param fft_buffer The result of the autocorrelation computation will be
   *                   written here.
   * \return false if the calculation completed successfully, true if there was
@@ -447,7 +575,7 @@ bool calculateAutoCorrelation(ComplexFixed *fft_buffer)
 	{
 		return true;
 	}
-	if (fftPostProcessReal(fft_buffer, true))
+	if (fftPostProcessRealEven(fft_buffer))
 	{
 		return true;
 	}
@@ -38,16 +38,17 @@
   */
 #define SAMPLE_SCALE_DOWN			64
 
-extern bool histogram_overflow_occurred;
-extern uint32_t samples_in_histogram;
-extern fix16_t psd_accumulator[FFT_SIZE + 1];
-extern bool psd_accumulator_error_occurred;
+extern THREAD_LOCAL bool histogram_overflow_occurred;
+extern THREAD_LOCAL uint32_t samples_in_histogram;
+extern THREAD_LOCAL fix16_t psd_accumulator[FFT_SIZE + 1];
+extern THREAD_LOCAL bool psd_accumulator_error_occurred;
 
 extern void clearHistogram(void);
 extern void incrementHistogram(uint32_t index);
 extern fix16_t scaleSample(int sample_int);
-extern fix16_t calculateCentralMoment(fix16_t mean, uint32_t power);
+extern void calculateMoments(fix16_t *out_mean, fix16_t *out_variance, fix16_t *out_kappa3, fix16_t *out_kappa4);
 extern fix16_t estimateEntropy(void);
+extern fix16_t estimateMinEntropy(void);
 extern void subtractMeanFromFftBuffer(ComplexFixed *fft_buffer);
 extern void clearPowerSpectralDensity(void);
 extern void accumulatePowerSpectralDensity(volatile uint16_t *source_buffer);
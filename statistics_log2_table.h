@@ -0,0 +1,47 @@
+/** \file statistics_log2_table.h
+  *
+  * \brief Contains the base 2 logarithm lookup table used by statistics.c.
+  *
+  * The table is log2(1 + i / #LOG2_TABLE_SIZE) for i in
+  * [0, #LOG2_TABLE_SIZE), multiplied by 65536 and rounded to the nearest
+  * integer. statistics.c linearly interpolates between entries. With 128
+  * entries, the interpolation error is less than one Q16.16 LSB.
+  *
+  * This file should only be included by statistics.c.
+  *
+  * This file is licensed as described by the file LICENCE.
+  */
+
+#ifndef STATISTICS_LOG2_TABLE_H_INCLUDED
+#define STATISTICS_LOG2_TABLE_H_INCLUDED
+
+#include "common.h"
+
+/** log2(#LOG2_TABLE_SIZE); the number of mantissa bits used to index
+  * #log2_lookup. */
+#define LOG2_TABLE_BITS		7
+/** Number of entries in #log2_lookup. */
+#define LOG2_TABLE_SIZE		(1 << LOG2_TABLE_BITS)
+
+// Table generated using gen_log2.
+// Table size: 128.
+static const uint16_t log2_lookup[128] = {
+0x0000, 0x02e0, 0x05ba, 0x088e, 0x0b5d, 0x0e27, 0x10eb, 0x13aa,
+0x1664, 0x1919, 0x1bc8, 0x1e73, 0x2119, 0x23ba, 0x2656, 0x28ed,
+0x2b80, 0x2e0f, 0x3098, 0x331e, 0x359f, 0x381b, 0x3a94, 0x3d08,
+0x3f78, 0x41e4, 0x444c, 0x46b0, 0x4910, 0x4b6c, 0x4dc5, 0x5019,
+0x526a, 0x54b7, 0x5700, 0x5946, 0x5b89, 0x5dc7, 0x6003, 0x623a,
+0x646f, 0x66a0, 0x68ce, 0x6af8, 0x6d20, 0x6f44, 0x7165, 0x7383,
+0x759d, 0x77b5, 0x79ca, 0x7bdb, 0x7dea, 0x7ff6, 0x81ff, 0x8405,
+0x8608, 0x8809, 0x8a06, 0x8c01, 0x8dfa, 0x8fef, 0x91e2, 0x93d2,
+0x95c0, 0x97ab, 0x9994, 0x9b7a, 0x9d5e, 0x9f3f, 0xa11e, 0xa2fa,
+0xa4d4, 0xa6ab, 0xa881, 0xaa53, 0xac24, 0xadf2, 0xafbe, 0xb188,
+0xb350, 0xb515, 0xb6d9, 0xb89a, 0xba59, 0xbc16, 0xbdd1, 0xbf8a,
+0xc140, 0xc2f5, 0xc4a8, 0xc658, 0xc807, 0xc9b4, 0xcb5f, 0xcd08,
+0xceaf, 0xd054, 0xd1f7, 0xd399, 0xd538, 0xd6d6, 0xd872, 0xda0c,
+0xdba5, 0xdd3b, 0xded0, 0xe063, 0xe1f5, 0xe385, 0xe513, 0xe69f,
+0xe82a, 0xe9b3, 0xeb3b, 0xecc1, 0xee45, 0xefc8, 0xf149, 0xf2c8,
+0xf446, 0xf5c3, 0xf73e, 0xf8b7, 0xfa2f, 0xfba5, 0xfd1a, 0xfe8e
+};
+
+#endif // #ifndef STATISTICS_LOG2_TABLE_H_INCLUDED
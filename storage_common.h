@@ -26,5 +26,13 @@
 #define ADDRESS_POOL_CHECKSUM	96
 /** Address where device UUID is located. */
 #define ADDRESS_DEVICE_UUID		128
+/** Address where the number of PBKDF2 iterations chosen by
+  * calibrateKeyDerivation() is located. This is stored as a 32 bit
+  * little-endian value followed by its bitwise complement. */
+#define ADDRESS_PBKDF2_ITERATIONS	144
+/** Address where the layout of the accounts partition is recorded (see
+  * getNumberOfWallets() in wallet.c). This is stored as a 32 bit
+  * little-endian value followed by its bitwise complement. */
+#define ADDRESS_ACCOUNTS_LAYOUT		152
 
 #endif // #ifndef STORAGE_COMMON_H_INCLUDED
@@ -41,6 +41,14 @@
 #include "messages.pb.h"
 #include "sha256.h"
 #include "transaction.h"
+#include "hmac_drbg.h"
+#include "bip32.h"
+#include "tasks.h"
+#include "diagnostics.h"
+#include "trace.h"
+#ifdef ENABLE_BENCHMARK
+#include "benchmark.h"
+#endif // #ifdef ENABLE_BENCHMARK
 
 #ifdef TEST_STREAM_COMM
 #include "test_helpers.h"
@@ -51,10 +59,95 @@ bool mainInputStreamCallback(pb_istream_t *stream, uint8_t *buf, size_t count);
 bool mainOutputStreamCallback(pb_ostream_t *stream, const uint8_t *buf, size_t count);
 static void writeFailureString(StringSet set, uint8_t spec);
 bool hashFieldCallback(pb_istream_t *stream, const pb_field_t *field, void **arg);
+bool signaturesCallback(pb_ostream_t *stream, const pb_field_t *field, void * const *arg);
 
 /** Maximum size (in bytes) of any protocol buffer message sent by functions
-  * in this file. */
-#define MAX_SEND_SIZE			255
+  * in this file. This needs to be large enough for an Addresses message
+  * with #ECDSA_MAX_BATCH addresses in it, and for a Signatures message with
+  * #TRANSACTION_MAX_BATCH signatures (77 bytes each) in it. */
+#define MAX_SEND_SIZE			700
+
+#ifndef STREAM_STAGING_SIZE
+/** Size (in bytes) of the buffer which sendPacket() encodes messages into.
+  * A message's length has to be sent before the message, so a message
+  * which fits in this buffer only needs to be encoded once. Larger
+  * messages (or all messages, if this is 0) are encoded twice: once to
+  * calculate their length and once to send them. This can be overridden by
+  * defining STREAM_STAGING_SIZE in the platform's build settings.
+  */
+#define STREAM_STAGING_SIZE		MAX_SEND_SIZE
+#endif // #ifndef STREAM_STAGING_SIZE
+
+#if STREAM_STAGING_SIZE > 0
+// The specialised encoders and decoders work on #staging_buffer, so they
+// aren't used without it.
+#include "messages_fast.h"
+#endif // #if STREAM_STAGING_SIZE > 0
+
+#ifndef MAX_OUTSTANDING_REQUESTS
+/** Number of requests which the host may send ahead, before receiving the
+  * response to the first of them, when tagged packets are in use (see
+  * PROTOCOL). Requests which have been sent ahead wait in the stream
+  * device's receive buffer until processPacket() gets to them, so this
+  * should be small enough that that many short requests fit there. This
+  * can be overridden by defining MAX_OUTSTANDING_REQUESTS in the platform's
+  * build settings.
+  */
+#define MAX_OUTSTANDING_REQUESTS	4
+#endif // #ifndef MAX_OUTSTANDING_REQUESTS
+
+#ifndef APPROVED_TRANSACTION_CACHE_ENTRIES
+/** Number of approved transaction hashes which are remembered (see
+  * approveTransaction()), so that a host can interleave the signing of
+  * that many transactions without the user having to approve them again.
+  * This can be overridden by defining APPROVED_TRANSACTION_CACHE_ENTRIES in
+  * the platform's build settings.
+  */
+#define APPROVED_TRANSACTION_CACHE_ENTRIES	4
+#endif // #ifndef APPROVED_TRANSACTION_CACHE_ENTRIES
+
+#ifndef APPROVED_TRANSACTION_MAX_AGE
+/** An approved transaction hash is forgotten if this many signing requests
+  * (for any transaction) go by without it being used. This stops an old
+  * approval from being used much later on in a long session. This can be
+  * overridden by defining APPROVED_TRANSACTION_MAX_AGE in the platform's
+  * build settings.
+  */
+#define APPROVED_TRANSACTION_MAX_AGE		64
+#endif // #ifndef APPROVED_TRANSACTION_MAX_AGE
+
+/** Number of bytes which a bulk GetEntropy request (see getBulkEntropy())
+  * will generate from its HMAC_DRBG instance before reseeding it. */
+#define BULK_ENTROPY_RESEED_INTERVAL	4096
+/** Number of bytes which bulkEntropyCallback() generates and sends at a
+  * time. This must be a factor of #BULK_ENTROPY_RESEED_INTERVAL. */
+#define BULK_ENTROPY_CHUNK_SIZE			128
+/** Number of bytes of entropy which getStreamedEntropy() sends in each
+  * Entropy packet. This must be a multiple of 32, since getRandom256()
+  * produces 32 bytes at a time. */
+#define STREAMED_ENTROPY_CHUNK_SIZE		128
+/** Number of bytes which readFieldBytes() reads from the stream at a time.
+  * Larger values mean fewer calls into the stream device (and its FIFO), at
+  * the cost of more stack space. */
+#define FIELD_CHUNK_SIZE				32
+
+#ifndef MAX_PAYLOAD_LENGTH
+/** Largest packet payload, in bytes, which the device will look at. If a
+  * packet header declares a longer payload, receivePacketHeader() throws
+  * the whole payload away straight from the stream device and the packet
+  * is rejected without being parsed. The default leaves room for a
+  * transaction of #MAX_TRANSACTION_SIZE bytes plus the fields around it.
+  * This can be overridden by defining MAX_PAYLOAD_LENGTH in the platform's
+  * build settings.
+  */
+#define MAX_PAYLOAD_LENGTH				(MAX_TRANSACTION_SIZE + 4096)
+#endif // #ifndef MAX_PAYLOAD_LENGTH
+
+/** Message ID which receivePacketHeader() returns for a packet whose
+  * payload was too long (see #MAX_PAYLOAD_LENGTH). This isn't the ID of any
+  * real packet type, so anything waiting for a particular packet treats it
+  * as unexpected. */
+#define PACKET_TYPE_OVERSIZED			0xffff
 
 /** Union of field buffers for all protocol buffer messages. They're placed
   * in a union to make memory access more efficient, since the functions in
@@ -78,12 +171,33 @@ union MessageBufferUnion
 	ListWallets list_wallets;
 	Wallets wallets;
 	BackupWallet backup_wallet;
+	WalletBackup wallet_backup;
 	RestoreWallet restore_wallet;
 	GetDeviceUUID get_device_uuid;
 	DeviceUUID device_uuid;
 	GetEntropy get_entropy;
 	GetMasterPublicKey get_master_public_key;
 	MasterPublicKey master_public_key;
+	GetAddressRange get_address_range;
+	GetExtendedPublicKey get_extended_public_key;
+	ExtendedPublicKey extended_public_key;
+	GetProgress get_progress;
+	CancelOperation cancel_operation;
+	GetRNGHealth get_rng_health;
+	RNGHealth rng_health;
+	GetWalletSnapshot get_wallet_snapshot;
+#ifdef ENABLE_BENCHMARK
+	Benchmark benchmark;
+	BenchmarkResult benchmark_result;
+#endif // #ifdef ENABLE_BENCHMARK
+#ifdef ENABLE_DIAGNOSTICS
+	GetDiagnostics get_diagnostics;
+	Diagnostics diagnostics;
+#endif // #ifdef ENABLE_DIAGNOSTICS
+#ifdef ENABLE_TRACE
+	GetTrace get_trace;
+	Trace trace;
+#endif // #ifdef ENABLE_TRACE
 };
 
 /** Determines the string that writeStringCallback() will write. */
@@ -95,14 +209,37 @@ struct StringSetAndSpec
 	uint8_t next_spec;
 };
 
-/** The transaction hash of the most recently approved transaction. This is
+/** A transaction which the user has approved. */
+struct ApprovedTransaction
+{
+	/** Transaction hash, as calculated by parseTransaction(). */
+	uint8_t transaction_hash[32];
+	/** Value of #signing_request_count when this was last used. */
+	uint32_t last_used;
+	/** false means disregard this entry, true means it is valid. */
+	bool valid;
+};
+
+/** Transaction hashes of the most recently approved transactions. These are
   * stored so that if a transaction needs to be signed multiple times (eg.
   * if it has more than one input), the user doesn't have to approve every
-  * one. */
-static uint8_t prev_transaction_hash[32];
-/** false means disregard #prev_transaction_hash, true means
-  * that #prev_transaction_hash is valid. */
-static bool prev_transaction_hash_valid;
+  * one, even if the host signs for other transactions in between. */
+static struct ApprovedTransaction approved_transactions[APPROVED_TRANSACTION_CACHE_ENTRIES];
+/** Number of signing requests which have been passed to
+  * approveTransaction(), modulo 2 ^ 32. This is used to expire and evict
+  * entries of #approved_transactions. */
+static uint32_t signing_request_count;
+
+/** Signature hash for speculativeSign() to sign. */
+static uint8_t speculative_sig_hash[32];
+/** Private key for speculativeSign() to sign with. This is cleared as soon
+  * as it isn't needed. */
+static uint8_t speculative_private_key[32];
+/** Signature computed by speculativeSign(). This is only sent to the host if
+  * the user approves the transaction. */
+static uint8_t speculative_signature[MAX_SIGNATURE_LENGTH];
+/** Length, in bytes, of #speculative_signature. */
+static uint8_t speculative_signature_length;
 
 /** Length of current packet's payload. */
 static uint32_t payload_length;
@@ -114,18 +251,51 @@ static struct StringSetAndSpec string_arg;
 /** Alternate copy of #string_arg, for when more than one string needs to be
   * written. */
 static struct StringSetAndSpec string_arg_alt;
-/** Current number of wallets; used for the listWalletsCallback() callback
+/** First wallet number to list; used for the listWalletsCallback() callback
   * function. */
-static uint32_t number_of_wallets;
+static uint32_t list_start;
+/** One more than the last wallet number to list; used for the
+  * listWalletsCallback() callback function. */
+static uint32_t list_end;
 /** Pointer to bytes of entropy to send to the host; used for
   * the getEntropyCallback() callback function. */
 static uint8_t *entropy_buffer;
 /** Number of bytes of entropy to send to the host; used for
   * the getEntropyCallback() callback function. */
 static size_t num_entropy_bytes;
+/** Number of bytes of entropy to send to the host; used for
+  * the bulkEntropyCallback() callback function. This is separate from
+  * #num_entropy_bytes because a size_t may be too small. */
+static uint32_t num_bulk_entropy_bytes;
+/** HMAC_DRBG instance used by the bulkEntropyCallback() callback function.
+  * Don't put this on the stack, for the same reasons as #string_arg. */
+static HMACDRBGState bulk_entropy_drbg;
+/** Pointer to addresses to send to the host; used for the
+  * addressRangeCallback() callback function. */
+static uint8_t *range_addresses;
+/** Pointer to public keys to send to the host; used for the
+  * addressRangeCallback() callback function. */
+static PointAffine *range_public_keys;
+/** Address handle of the first address in #range_addresses. */
+static AddressHandle range_start;
+/** Number of addresses in #range_addresses and #range_public_keys. */
+static uint8_t range_count;
+/** If this is true, addressRangeCallback() leaves the address out of each
+  * Address message, since the host can calculate it from the public key. */
+static bool range_omit_addresses;
 /** Storage for fields of SignTransaction message. Needed for the
   * signTransactionCallback() callback function. */
 static SignTransaction sign_transaction;
+/** Storage for fields of SignTransactionBatch message. Needed for the
+  * signTransactionBatchCallback() callback function. */
+static SignTransactionBatch sign_transaction_batch;
+/** Pointer to signatures to send to the host, #MAX_SIGNATURE_LENGTH bytes
+  * apart; used for the signaturesCallback() callback function. */
+static uint8_t *batch_signatures;
+/** Pointer to lengths of the signatures in #batch_signatures. */
+static uint8_t *batch_signature_lengths;
+/** Number of signatures in #batch_signatures. */
+static uint8_t batch_signature_count;
 /** Double SHA-256 of a field parsed by hashFieldCallback(). */
 static uint8_t field_hash[32];
 /** Whether #field_hash has been set. */
@@ -137,6 +307,45 @@ static size_t session_id_length;
   * a reset hasn't occurred. */
 static uint8_t session_id[64];
 
+/** Whether the host asked to use tagged packets in the most recent
+  * Initialize message. */
+static bool tagged_packets_enabled;
+/** Whether the host, in the most recent Initialize message, said that it
+  * would always reply to a ButtonRequest with ButtonAck. If so,
+  * buttonInterjection() doesn't bother asking. */
+static bool implicit_button_ack;
+/** Whether the packet header most recently read by receivePacketHeader()
+  * was for a tagged packet. */
+static bool received_packet_tagged;
+/** Tag of the packet header most recently read by receivePacketHeader(),
+  * if it was for a tagged packet. */
+static uint16_t received_tag;
+/** Whether packets sent by sendPacketHeader() should be tagged. This is
+  * latched by processPacket() from the request it is handling, so that the
+  * response (and any interjections) carry that request's tag. */
+static bool response_tagged;
+/** Tag which sendPacketHeader() will use if #response_tagged is true. */
+static uint16_t response_tag;
+
+/** Whether processPacket() is in the middle of handling a request. */
+static bool processing_packet;
+/** The long-running operation which the device is busy with, as most
+  * recently reported to longOperationYield(). */
+static LongOperation current_operation;
+/** How much of #current_operation has been done. */
+static uint32_t operation_completed;
+/** Total size of #current_operation, in the same units
+  * as #operation_completed. */
+static uint32_t operation_total;
+/** Whether the host has cancelled the long-running operation of the request
+  * which processPacket() is handling. */
+static bool operation_cancelled;
+
+#if STREAM_STAGING_SIZE > 0
+/** Where sendPacket() encodes messages before sending them. */
+static uint8_t staging_buffer[STREAM_STAGING_SIZE];
+#endif // #if STREAM_STAGING_SIZE > 0
+
 /** nanopb input stream which uses mainInputStreamCallback() as a stream
   * callback. */
 pb_istream_t main_input_stream = {&mainInputStreamCallback, NULL, 0, NULL};
@@ -150,6 +359,43 @@ pb_ostream_t main_output_stream = {&mainOutputStreamCallback, NULL, 0, 0, NULL};
 static char test_otp[OTP_LENGTH] = {'1', '2', '3', '4', '\0'};
 #endif // #ifdef TEST_STREAM_COMM
 
+/** Read bytes from the stream device. Everything in this file should use
+  * this instead of calling streamGetBytes() directly, so that the time
+  * spent is counted as receive time (see diagnostics.c).
+  * \param buffer The byte array where the bytes will be placed. This must
+  *               have enough space to store length bytes.
+  * \param length The number of bytes to read.
+  */
+static void receiveBytes(uint8_t *buffer, uint32_t length)
+{
+#ifdef ENABLE_DIAGNOSTICS
+	DiagnosticsPhase previous_phase;
+
+	previous_phase = diagnosticsSetPhase(DIAGNOSTICS_PHASE_RECEIVE);
+	streamGetBytes(buffer, length);
+	diagnosticsSetPhase(previous_phase);
+#else
+	streamGetBytes(buffer, length);
+#endif // #ifdef ENABLE_DIAGNOSTICS
+}
+
+/** Throw away bytes from the stream device. Like receiveBytes(), the time
+  * spent is counted as receive time.
+  * \param length The number of bytes to throw away.
+  */
+static void discardBytes(uint32_t length)
+{
+#ifdef ENABLE_DIAGNOSTICS
+	DiagnosticsPhase previous_phase;
+
+	previous_phase = diagnosticsSetPhase(DIAGNOSTICS_PHASE_RECEIVE);
+	streamDiscardBytes(length);
+	diagnosticsSetPhase(previous_phase);
+#else
+	streamDiscardBytes(length);
+#endif // #ifdef ENABLE_DIAGNOSTICS
+}
+
 /** Read bytes from the stream.
   * \param buffer The byte array where the bytes will be placed. This must
   *               have enough space to store length bytes.
@@ -157,30 +403,29 @@ static char test_otp[OTP_LENGTH] = {'1', '2', '3', '4', '\0'};
   */
 static void getBytesFromStream(uint8_t *buffer, uint8_t length)
 {
-	uint8_t i;
-
-	for (i = 0; i < length; i++)
-	{
-		buffer[i] = streamGetOneByte();
-	}
+	receiveBytes(buffer, length);
 	payload_length -= length;
 }
 
-/** Write a number of bytes to the output stream.
+/** Write a number of bytes to the output stream. The time spent is counted
+  * as send time (see diagnostics.c).
   * \param buffer The array of bytes to be written.
   * \param length The number of bytes to write.
   */
 static void writeBytesToStream(const uint8_t *buffer, size_t length)
 {
-	size_t i;
-
-	for (i = 0; i < length; i++)
-	{
-		streamPutOneByte(buffer[i]);
-	}
+#ifdef ENABLE_DIAGNOSTICS
+	DiagnosticsPhase previous_phase;
+
+	previous_phase = diagnosticsSetPhase(DIAGNOSTICS_PHASE_SEND);
+	streamPutBytes(buffer, (uint32_t)length);
+	diagnosticsSetPhase(previous_phase);
+#else
+	streamPutBytes(buffer, (uint32_t)length);
+#endif // #ifdef ENABLE_DIAGNOSTICS
 }
 
-/** nanopb input stream callback which uses streamGetOneByte() to get the
+/** nanopb input stream callback which uses streamGetBytes() to get the
   * requested bytes.
   * \param stream Input stream object that issued the callback.
   * \param buf Buffer to fill with requested bytes.
@@ -189,27 +434,23 @@ static void writeBytesToStream(const uint8_t *buffer, size_t length)
   */
 bool mainInputStreamCallback(pb_istream_t *stream, uint8_t *buf, size_t count)
 {
-	size_t i;
-
 	if (buf == NULL)
 	{
 		fatalError(); // this should never happen
 	}
-	for (i = 0; i < count; i++)
+	if (count > payload_length)
 	{
-		if (payload_length == 0)
-		{
-			// Attempting to read past end of payload.
-			stream->bytes_left = 0;
-			return false;
-		}
-		buf[i] = streamGetOneByte();
-		payload_length--;
+		// Attempting to read past end of payload. Whatever is left of the
+		// payload will be discarded by readAndIgnoreInput().
+		stream->bytes_left = 0;
+		return false;
 	}
+	receiveBytes(buf, (uint32_t)count);
+	payload_length -= (uint32_t)count;
 	return true;
 }
 
-/** nanopb output stream callback which uses streamPutOneByte() to send a byte
+/** nanopb output stream callback which uses streamPutBytes() to send a byte
   * buffer.
   * \param stream Output stream object that issued the callback.
   * \param buf Buffer with bytes to send.
@@ -229,16 +470,71 @@ bool mainOutputStreamCallback(pb_ostream_t *stream, const uint8_t *buf, size_t c
   */
 static void readAndIgnoreInput(void)
 {
-	if (payload_length > 0)
+	discardBytes(payload_length);
+	payload_length = 0;
+}
+
+/** Read the rest of a length-delimited field from a nanopb input stream,
+  * in chunks of up to #FIELD_CHUNK_SIZE bytes, so that long fields don't
+  * cost one stream callback per byte.
+  * \param stream Input stream to read from.
+  * \param hs If this is not NULL, every byte read will be written to this
+  *           SHA-256 hash state. If this is NULL, the bytes are discarded.
+  * \return true on success, false on failure (nanopb convention).
+  */
+static bool readFieldBytes(pb_istream_t *stream, HashState *hs)
+{
+	uint8_t buffer[FIELD_CHUNK_SIZE];
+	size_t chunk;
+
+	while (stream->bytes_left > 0)
 	{
-		for (; payload_length > 0; payload_length--)
+		chunk = MIN(stream->bytes_left, sizeof(buffer));
+		if (!pb_read(stream, buffer, chunk))
+		{
+			return false;
+		}
+		if (hs != NULL)
 		{
-			streamGetOneByte();
+			sha256WriteBytes(hs, buffer, (uint32_t)chunk);
 		}
 	}
+	return true;
 }
 
-/** Receive a message from the stream #main_input_stream.
+#if STREAM_STAGING_SIZE > 0
+/** Check whether a message (or any of its submessages) has callback fields.
+  * Callbacks such as signTransactionCallback() read their field straight
+  * from the stream, so messages which have them can't be staged.
+  * \param fields Field description array of the message.
+  * \return true if there are callback fields, false if there are none.
+  */
+static bool hasCallbackFields(const pb_field_t fields[])
+{
+	const pb_field_t *field;
+
+	for (field = fields; field->tag != 0; field++)
+	{
+		if (PB_ATYPE(field->type) == PB_ATYPE_CALLBACK)
+		{
+			return true;
+		}
+		if ((PB_LTYPE(field->type) == PB_LTYPE_SUBMESSAGE)
+			&& hasCallbackFields((const pb_field_t *)field->ptr))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+#endif // #if STREAM_STAGING_SIZE > 0
+
+/** Receive a message from the stream #main_input_stream. If the payload
+  * fits in #staging_buffer and the message has no callback fields, the
+  * payload is read in one go and decoded from memory, which lets nanopb
+  * decode tags and varints without a stream callback per byte. Messages
+  * which have a specialised decoder (see messages_fast.h) are decoded with
+  * that instead of nanopb.
   * \param fields Field description array.
   * \param dest_struct Where field data will be stored.
   * \return false on success, true if a parse error occurred.
@@ -246,6 +542,38 @@ static void readAndIgnoreInput(void)
 static bool receiveMessage(const pb_field_t fields[], void *dest_struct)
 {
 	bool r;
+#if STREAM_STAGING_SIZE > 0
+	pb_istream_t staged_stream;
+	uint32_t length;
+	bool parse_error;
+
+	if ((payload_length <= sizeof(staging_buffer)) && !hasCallbackFields(fields))
+	{
+		// The staging buffer is otherwise only used by sendPacket(), and the
+		// decoded message never points into it.
+		length = payload_length;
+		receiveBytes(staging_buffer, length);
+		payload_length = 0;
+		if (canFastDecode(fields))
+		{
+			parse_error = fastDecode(fields, staging_buffer, length, dest_struct);
+		}
+		else
+		{
+			staged_stream = pb_istream_from_buffer(staging_buffer, length);
+			r = pb_decode(&staged_stream, fields, dest_struct);
+			parse_error = (staged_stream.bytes_left > 0) || !r;
+		}
+		// The payload may contain secrets (eg. passwords).
+		memset(staging_buffer, 0, sizeof(staging_buffer));
+		if (parse_error)
+		{
+			writeFailureString(STRINGSET_MISC, MISCSTR_INVALID_PACKET);
+			return true;
+		}
+		return false;
+	}
+#endif // #if STREAM_STAGING_SIZE > 0
 
 	r = pb_decode(&main_input_stream, fields, dest_struct);
 	// In order for the message to be considered valid, it must also occupy
@@ -262,21 +590,80 @@ static bool receiveMessage(const pb_field_t fields[], void *dest_struct)
 	}
 }
 
-/** Send a packet.
+/** Send the header of a packet. The payload must be sent immediately after
+  * this, using #main_output_stream. If the request being handled was a
+  * tagged packet, this sends a tagged packet header with the same tag.
+  * \param message_id The message ID of the packet.
+  * \param length The length, in bytes, of the payload.
+  */
+static void sendPacketHeader(uint16_t message_id, uint32_t length)
+{
+	uint8_t buffer[10];
+	uint8_t header_length;
+
+	buffer[0] = '#';
+	buffer[1] = '#';
+	buffer[2] = (uint8_t)(message_id >> 8);
+	buffer[3] = (uint8_t)message_id;
+	writeU32BigEndian(&(buffer[4]), length);
+	header_length = 8;
+	if (response_tagged)
+	{
+		buffer[1] = 'T';
+		buffer[8] = (uint8_t)(response_tag >> 8);
+		buffer[9] = (uint8_t)response_tag;
+		header_length = 10;
+	}
+	writeBytesToStream(buffer, header_length);
+}
+
+/** Send a packet. Messages which have a specialised encoder (see
+  * messages_fast.h) are encoded with that instead of nanopb.
   * \param message_id The message ID of the packet.
   * \param fields Field description array.
   * \param src_struct Field data which will be serialised and sent.
   */
 static void sendPacket(uint16_t message_id, const pb_field_t fields[], const void *src_struct)
 {
-	uint8_t buffer[4];
 	pb_ostream_t substream;
+#if STREAM_STAGING_SIZE > 0
+	size_t length;
+#endif // #if STREAM_STAGING_SIZE > 0
 
 #ifdef TEST_STREAM_COMM
 	// From PROTOCOL, the current received packet must be fully consumed
 	// before any response can be sent.
 	assert(payload_length == 0);
 #endif
+#if STREAM_STAGING_SIZE > 0
+	if ((sizeof(staging_buffer) >= FAST_ENCODE_MAX_SIZE) && canFastEncode(fields))
+	{
+		if (fastEncode(fields, src_struct, staging_buffer, &length))
+		{
+			fatalError(); // pb_encode() would have failed too
+		}
+		else
+		{
+			sendPacketHeader(message_id, (uint32_t)length);
+			writeBytesToStream(staging_buffer, length);
+			memset(staging_buffer, 0, length);
+		}
+		return;
+	}
+	// Try encoding the message into the staging buffer, so that it only has
+	// to be encoded once. Some messages contain things like entropy, so the
+	// staging buffer is cleared afterwards.
+	substream = pb_ostream_from_buffer(staging_buffer, sizeof(staging_buffer));
+	if (pb_encode(&substream, fields, src_struct))
+	{
+		sendPacketHeader(message_id, (uint32_t)substream.bytes_written);
+		writeBytesToStream(staging_buffer, substream.bytes_written);
+		memset(staging_buffer, 0, substream.bytes_written);
+		return;
+	}
+	// The message didn't fit, so fall back to encoding it twice.
+	memset(staging_buffer, 0, sizeof(staging_buffer));
+#endif // #if STREAM_STAGING_SIZE > 0
 	// Use a non-writing substream to get the length of the message without
 	// storing it anywhere.
 	substream.callback = NULL;
@@ -288,13 +675,7 @@ static void sendPacket(uint16_t message_id, const pb_field_t fields[], const voi
 		fatalError();
 	}
 
-	// Send packet header.
-	streamPutOneByte('#');
-	streamPutOneByte('#');
-	streamPutOneByte((uint8_t)(message_id >> 8));
-	streamPutOneByte((uint8_t)message_id);
-	writeU32BigEndian(buffer, substream.bytes_written);
-	writeBytesToStream(buffer, 4);
+	sendPacketHeader(message_id, (uint32_t)substream.bytes_written);
 	// Send actual message.
 	main_output_stream.bytes_written = 0;
 	main_output_stream.max_size = substream.bytes_written;
@@ -313,11 +694,16 @@ static void sendPacket(uint16_t message_id, const pb_field_t fields[], const voi
   */
 bool writeStringCallback(pb_ostream_t *stream, const pb_field_t *field, void * const *arg)
 {
-	uint16_t i;
+	const char *str;
 	uint16_t length;
-	char c;
 	struct StringSetAndSpec **ptr_arg_s;
 	struct StringSetAndSpec *arg_s;
+#if defined(AVR) && defined(__GNUC__)
+	uint16_t i;
+	uint8_t j;
+	uint8_t chunk_length;
+	uint8_t buffer[16];
+#endif // #if defined(AVR) && defined(__GNUC__)
 
 	ptr_arg_s = (struct StringSetAndSpec **)arg;
 	if (ptr_arg_s == NULL)
@@ -329,27 +715,38 @@ bool writeStringCallback(pb_ostream_t *stream, const pb_field_t *field, void * c
 	{
 		fatalError(); // this should never happen
 	}
-	length = getStringLength(arg_s->next_set, arg_s->next_spec);
+	str = getStringSpan(arg_s->next_set, arg_s->next_spec, &length);
 	if (!pb_encode_tag_for_field(stream, field))
 	{
 		return false;
 	}
-	// Cannot use pb_encode_string() because it expects a pointer to the
-	// contents of an entire string; getString() does not return such a
-	// pointer.
+#if defined(AVR) && defined(__GNUC__)
+	// The string is in program memory, so pb_encode_string() can't read it
+	// directly. Copy it into RAM a chunk at a time instead.
 	if (!pb_encode_varint(stream, (uint64_t)length))
 	{
 		return false;
 	}
-	for (i = 0; i < length; i++)
+	for (i = 0; i < length; i = (uint16_t)(i + chunk_length))
 	{
-		c = getString(arg_s->next_set, arg_s->next_spec, i);
-		if (!pb_write(stream, (uint8_t *)&c, 1))
+		chunk_length = sizeof(buffer);
+		if ((uint16_t)(length - i) < chunk_length)
+		{
+			chunk_length = (uint8_t)(length - i);
+		}
+		for (j = 0; j < chunk_length; j++)
+		{
+			buffer[j] = LOOKUP_BYTE(str[i + j]);
+		}
+		if (!pb_write(stream, buffer, chunk_length))
 		{
 			return false;
 		}
 	}
 	return true;
+#else
+	return pb_encode_string(stream, (const uint8_t *)str, length);
+#endif // #if defined(AVR) && defined(__GNUC__)
 }
 
 /** Sends a Failure message with the specified error message.
@@ -389,30 +786,148 @@ static void translateWalletError(WalletErrors r)
 	}
 }
 
-/** Receive packet header.
+/** Receive packet header. Tagged packet headers (see PROTOCOL) are only
+  * accepted if the host asked for them in the most recent Initialize
+  * message. The tag, if any, is written to #received_tag. If the payload is
+  * longer than #MAX_PAYLOAD_LENGTH, it is discarded here, at whatever speed
+  * the stream device can manage, and #PACKET_TYPE_OVERSIZED is returned
+  * instead of the packet's message ID.
   * \return Message ID (i.e. command type) of packet.
   */
 static uint16_t receivePacketHeader(void)
 {
 	uint8_t buffer[4];
+	uint8_t tag_buffer[2];
 	uint16_t message_id;
 
 	getBytesFromStream(buffer, 2);
-	if ((buffer[0] != '#') || (buffer[1] != '#'))
+	if ((buffer[0] != '#')
+		|| ((buffer[1] != '#') && ((buffer[1] != 'T') || !tagged_packets_enabled)))
 	{
 		fatalError(); // invalid header
 	}
+	received_packet_tagged = (buffer[1] == 'T');
 	getBytesFromStream(buffer, 2);
 	message_id = (uint16_t)(((uint16_t)buffer[0] << 8) | ((uint16_t)buffer[1]));
 	getBytesFromStream(buffer, 4);
+	if (received_packet_tagged)
+	{
+		getBytesFromStream(tag_buffer, 2);
+		received_tag = (uint16_t)(((uint16_t)tag_buffer[0] << 8) | ((uint16_t)tag_buffer[1]));
+	}
 	payload_length = readU32BigEndian(buffer);
+	if (payload_length > MAX_PAYLOAD_LENGTH)
+	{
+		readAndIgnoreInput();
+		message_id = PACKET_TYPE_OVERSIZED;
+	}
 	// TODO: size_t not generally uint32_t
 	main_input_stream.bytes_left = payload_length;
 	return message_id;
 }
 
+/** Send a Progress message describing #current_operation. */
+static void sendProgress(void)
+{
+	Progress message_buffer;
+
+	message_buffer.operation = (uint32_t)current_operation;
+	message_buffer.completed = operation_completed;
+	message_buffer.total = operation_total;
+	sendPacket(PACKET_TYPE_PROGRESS, Progress_fields, &message_buffer);
+}
+
+/** This should be called periodically by long-running operations, so that
+  * the device can answer GetProgress and honour CancelOperation packets
+  * while it is busy (see PROTOCOL). The stream is only checked once the
+  * whole of the current request (including replies to interjections) has
+  * been read, since until then any bytes waiting in the stream belong to
+  * that request. Any other packet which arrives here gets a Failure
+  * response, since the device can't handle two requests at once. This also
+  * gives background tasks (see tasks.c) a turn, so that they aren't starved
+  * during long-running operations.
+  * \param operation The operation which is in progress.
+  * \param completed How much of the operation has been done, in whatever
+  *                  units suit the operation.
+  * \param total Total size of the operation, in the same units
+  *              as completed.
+  * \return false if the operation should continue, true if the host has
+  *         cancelled it.
+  */
+bool longOperationYield(LongOperation operation, uint32_t completed, uint32_t total)
+{
+	uint16_t message_id;
+	bool saved_response_tagged;
+	uint16_t saved_response_tag;
+	GetProgress get_progress;
+	CancelOperation cancel_operation;
+
+	current_operation = operation;
+	operation_completed = completed;
+	operation_total = total;
+	runBackgroundTasks();
+	if (!processing_packet || (payload_length > 0))
+	{
+		return operation_cancelled;
+	}
+	while (!operation_cancelled && streamIsByteAvailable())
+	{
+		message_id = receivePacketHeader();
+		// Responses to packets received here carry their own tags, not the
+		// tag of the request being handled.
+		saved_response_tagged = response_tagged;
+		saved_response_tag = response_tag;
+		response_tagged = received_packet_tagged;
+		response_tag = received_tag;
+		if (message_id == PACKET_TYPE_GET_PROGRESS)
+		{
+			if (!receiveMessage(GetProgress_fields, &get_progress))
+			{
+				sendProgress();
+			}
+		}
+		else if (message_id == PACKET_TYPE_CANCEL_OPERATION)
+		{
+			if (!receiveMessage(CancelOperation_fields, &cancel_operation))
+			{
+				operation_cancelled = true;
+			}
+		}
+		else
+		{
+			readAndIgnoreInput();
+			writeFailureString(STRINGSET_MISC, MISCSTR_UNEXPECTED_PACKET);
+		}
+		response_tagged = saved_response_tagged;
+		response_tag = saved_response_tag;
+	}
+	return operation_cancelled;
+}
+
+/** Ask the user to approve an action and wait for a button press, sending
+  * a Failure if the user denies.
+  * \param command The action to ask the user about. See #AskUserCommandEnum.
+  * \return false if the user accepted, true if the user denied.
+  */
+static bool askUserDirectly(AskUserCommand command)
+{
+	bool permission_denied;
+
+	diagnosticsSetPhase(DIAGNOSTICS_PHASE_USER_WAIT);
+	traceEvent(TRACE_USER_WAIT_BEGIN, 0);
+	permission_denied = userDenied(command);
+	traceEvent(TRACE_USER_WAIT_END, 0);
+	diagnosticsSetPhase(DIAGNOSTICS_PHASE_COMPUTE);
+	if (permission_denied)
+	{
+		writeFailureString(STRINGSET_MISC, MISCSTR_PERMISSION_DENIED_USER);
+	}
+	return permission_denied;
+}
+
 /** Begin ButtonRequest interjection. This asks the host whether it is okay
-  * to prompt the user and wait for a button press.
+  * to prompt the user and wait for a button press. If the host already said
+  * it is (see #implicit_button_ack), the user is asked straight away.
   * \param command The action to ask the user about. See #AskUserCommandEnum.
   * \return false if the user accepted, true if the user or host denied.
   */
@@ -424,9 +939,17 @@ static bool buttonInterjection(AskUserCommand command)
 	ButtonCancel button_cancel;
 	bool receive_failure;
 
+	if (implicit_button_ack)
+	{
+		return askUserDirectly(command);
+	}
 	memset(&button_request, 0, sizeof(button_request));
 	sendPacket(PACKET_TYPE_BUTTON_REQUEST, ButtonRequest_fields, &button_request);
+	diagnosticsSetPhase(DIAGNOSTICS_PHASE_USER_WAIT);
+	traceEvent(TRACE_USER_WAIT_BEGIN, PACKET_TYPE_BUTTON_REQUEST);
 	message_id = receivePacketHeader();
+	traceEvent(TRACE_USER_WAIT_END, 0);
+	diagnosticsSetPhase(DIAGNOSTICS_PHASE_COMPUTE);
 	if (message_id == PACKET_TYPE_BUTTON_ACK)
 	{
 		// Host will allow button press.
@@ -437,15 +960,7 @@ static bool buttonInterjection(AskUserCommand command)
 		}
 		else
 		{
-			if (userDenied(command))
-			{
-				writeFailureString(STRINGSET_MISC, MISCSTR_PERMISSION_DENIED_USER);
-				return true;
-			}
-			else
-			{
-				return false;
-			}
+			return askUserDirectly(command);
 		}
 	}
 	else if (message_id == PACKET_TYPE_BUTTON_CANCEL)
@@ -484,7 +999,11 @@ static bool pinInterjection(void)
 
 	memset(&pin_request, 0, sizeof(pin_request));
 	sendPacket(PACKET_TYPE_PIN_REQUEST, PinRequest_fields, &pin_request);
+	diagnosticsSetPhase(DIAGNOSTICS_PHASE_USER_WAIT);
+	traceEvent(TRACE_USER_WAIT_BEGIN, PACKET_TYPE_PIN_REQUEST);
 	message_id = receivePacketHeader();
+	traceEvent(TRACE_USER_WAIT_END, 0);
+	diagnosticsSetPhase(DIAGNOSTICS_PHASE_COMPUTE);
 	if (message_id == PACKET_TYPE_PIN_ACK)
 	{
 		// Host has just sent password.
@@ -545,7 +1064,11 @@ static bool otpInterjection(AskUserCommand command)
 	displayOTP(command, otp);
 	memset(&otp_request, 0, sizeof(otp_request));
 	sendPacket(PACKET_TYPE_OTP_REQUEST, OtpRequest_fields, &otp_request);
+	diagnosticsSetPhase(DIAGNOSTICS_PHASE_USER_WAIT);
+	traceEvent(TRACE_USER_WAIT_BEGIN, PACKET_TYPE_OTP_REQUEST);
 	message_id = receivePacketHeader();
+	traceEvent(TRACE_USER_WAIT_END, 0);
+	diagnosticsSetPhase(DIAGNOSTICS_PHASE_COMPUTE);
 	clearOTP();
 	if (message_id == PACKET_TYPE_OTP_ACK)
 	{
@@ -588,10 +1111,107 @@ static bool otpInterjection(AskUserCommand command)
 	}
 }
 
+/** Forget every transaction that the user has approved, so that the next
+  * signing request for any transaction needs to be approved again.
+  */
+static void clearApprovedTransactions(void)
+{
+	memset(approved_transactions, 0, sizeof(approved_transactions));
+}
+
+/** Get permission from the user to sign a transaction. This is only done
+  * once for every distinct transaction hash (see #approved_transactions),
+  * so that the user doesn't have to approve every input of a transaction.
+  * Approvals which haven't been used for #APPROVED_TRANSACTION_MAX_AGE
+  * signing requests expire, and if there's no room for a new approval, the
+  * least recently used one is replaced.
+  * \param transaction_hash The transaction hash calculated by
+  *                         parseTransaction() or parseTransactionBatch().
+  *                         This should be called straight after one of
+  *                         them, since they log all the outputs to the user
+  *                         interface.
+  * \return true if signing is okay, false if the user denied permission (in
+  *         which case a response has already been sent).
+  */
+static bool approveTransaction(uint8_t *transaction_hash)
+{
+	struct ApprovedTransaction *entry;
+	uint32_t age;
+	uint32_t oldest_age;
+	uint8_t i;
+	uint8_t replace;
+	bool permission_denied;
+
+	signing_request_count++;
+	// Does transaction_hash match a previously approved transaction? While
+	// looking, expire old entries and find the one to replace if the user
+	// approves a new transaction.
+	replace = 0;
+	oldest_age = 0;
+	for (i = 0; i < APPROVED_TRANSACTION_CACHE_ENTRIES; i++)
+	{
+		entry = &(approved_transactions[i]);
+		age = signing_request_count - entry->last_used;
+		if (entry->valid && (age > APPROVED_TRANSACTION_MAX_AGE))
+		{
+			entry->valid = false;
+		}
+		if (entry->valid)
+		{
+			if (bigCompare(transaction_hash, entry->transaction_hash) == BIGCMP_EQUAL)
+			{
+				entry->last_used = signing_request_count;
+				return true;
+			}
+		}
+		else
+		{
+			age = 0xffffffff; // always replace invalid entries first
+		}
+		if (age > oldest_age)
+		{
+			oldest_age = age;
+			replace = i;
+		}
+	}
+	// Need to explicitly get permission from user.
+	permission_denied = buttonInterjection(ASKUSER_SIGN_TRANSACTION);
+	if (!permission_denied)
+	{
+		// User approved transaction.
+		entry = &(approved_transactions[replace]);
+		memcpy(entry->transaction_hash, transaction_hash, 32);
+		entry->last_used = signing_request_count;
+		entry->valid = true;
+		return true;
+	}
+	return false;
+}
+
+/** Compute the signature for a SignTransaction request, using
+  * #speculative_sig_hash and #speculative_private_key. This is run as a
+  * one-shot background task (see scheduleOneShotTask()), so that on
+  * platforms which run background tasks while waiting for the user, the
+  * signature is ready by the time the user approves the transaction.
+  */
+static void speculativeSign(void)
+{
+	if (signTransaction(speculative_signature, &speculative_signature_length, speculative_sig_hash, speculative_private_key))
+	{
+		fatalError(); // signature failed self-verification
+	}
+	memset(speculative_private_key, 0, sizeof(speculative_private_key));
+}
+
 /** nanopb field callback for signature data of SignTransaction message. This
   * does (or more accurately, delegates) all the "work" of transaction
   * signing: parsing the transaction, asking the user for approval, generating
   * the signature and sending the signature.
+  *
+  * The signature is computed by speculativeSign(), which is scheduled before
+  * the user is asked, so it can run while the device waits for the user.
+  * The signature is only sent if the user approves the transaction; in any
+  * case, it is cleared before this returns.
   * \param stream Input stream to read from.
   * \param field Field which contains the signature data.
   * \param arg Unused.
@@ -599,15 +1219,10 @@ static bool otpInterjection(AskUserCommand command)
   */
 bool signTransactionCallback(pb_istream_t *stream, const pb_field_t *field, void **arg)
 {
-	AddressHandle ah;
-	bool approved;
-	bool permission_denied;
 	TransactionErrors r;
 	WalletErrors wallet_return;
 	uint8_t transaction_hash[32];
 	uint8_t sig_hash[32];
-	uint8_t private_key[32];
-	uint8_t signature_length;
 	Signature message_buffer;
 
 	// Validate transaction and calculate hashes of it.
@@ -627,122 +1242,383 @@ bool signTransactionCallback(pb_istream_t *stream, const pb_field_t *field, void
 		return true;
 	}
 
-	// Get permission from user.
-	approved = false;
-	// Does transaction_hash match previous approved transaction?
-	if (prev_transaction_hash_valid)
+	// Errors from getPrivateKey() are only reported after the user has been
+	// asked, as they always have been.
+	wallet_return = getPrivateKey(speculative_private_key, sign_transaction.address_handle);
+	if (wallet_return == WALLET_NO_ERROR)
 	{
-		if (bigCompare(transaction_hash, prev_transaction_hash) == BIGCMP_EQUAL)
-		{
-			approved = true;
-		}
+		memcpy(speculative_sig_hash, sig_hash, sizeof(speculative_sig_hash));
+		scheduleOneShotTask(&speculativeSign);
 	}
-	if (!approved)
-	{
-		// Need to explicitly get permission from user.
-		// The call to parseTransaction() should have logged all the outputs
-		// to the user interface.
-		permission_denied = buttonInterjection(ASKUSER_SIGN_TRANSACTION);
-		if (!permission_denied)
-		{
-			// User approved transaction.
-			approved = true;
-			memcpy(prev_transaction_hash, transaction_hash, 32);
-			prev_transaction_hash_valid = true;
-		}
-	} // if (!approved)
-	if (approved)
+	if (approveTransaction(transaction_hash))
 	{
 		// Okay to sign transaction.
-		signature_length = 0;
-		ah = sign_transaction.address_handle;
-		if (getPrivateKey(private_key, ah) == WALLET_NO_ERROR)
+		if (wallet_return == WALLET_NO_ERROR)
 		{
 			if (sizeof(message_buffer.signature_data.bytes) < MAX_SIGNATURE_LENGTH)
 			{
 				// This should never happen.
 				fatalError();
 			}
-			signTransaction(message_buffer.signature_data.bytes, &signature_length, sig_hash, private_key);
-			message_buffer.signature_data.size = signature_length;
+			finishOneShotTask(); // in case it hasn't been run yet
+			memcpy(message_buffer.signature_data.bytes, speculative_signature, speculative_signature_length);
+			message_buffer.signature_data.size = speculative_signature_length;
 			sendPacket(PACKET_TYPE_SIGNATURE, Signature_fields, &message_buffer);
 		}
 		else
 		{
-			wallet_return = walletGetLastError();
 			translateWalletError(wallet_return);
 		}
 	}
+	// If the user denied permission, the signature must not be kept around.
+	cancelOneShotTask();
+	memset(speculative_private_key, 0, sizeof(speculative_private_key));
+	memset(speculative_signature, 0, sizeof(speculative_signature));
+	speculative_signature_length = 0;
 	return true;
 }
 
-/** Send a packet containing an address and its corresponding public key.
-  * This can generate new addresses as well as obtain old addresses. Both
-  * use cases were combined into one function because they involve similar
-  * processes.
-  * \param generate_new If this is true, a new address will be generated
-  *                     and the address handle of the generated address will
-  *                     be prepended to the output packet.
-  *                     If this is false, the address handle specified by ah
-  *                     will be used.
-  * \param ah Address handle to use (if generate_new is false).
+/** nanopb field callback which will write repeated Signature messages; one
+  * for each signature in #batch_signatures.
+  * \param stream Output stream to write to.
+  * \param field Field which contains the Signature submessage.
+  * \param arg Unused.
+  * \return true on success, false on failure (nanopb convention).
   */
-static NOINLINE void getAndSendAddressAndPublicKey(bool generate_new, AddressHandle ah)
+bool signaturesCallback(pb_ostream_t *stream, const pb_field_t *field, void * const *arg)
 {
-	Address message_buffer;
-	PointAffine public_key;
-	WalletErrors r;
+	Signature message_buffer;
+	uint8_t i;
 
-	message_buffer.address.size = 20;
-	if (generate_new)
+	if ((batch_signatures == NULL) || (batch_signature_lengths == NULL))
 	{
-		r = WALLET_NO_ERROR;
-		ah = makeNewAddress(message_buffer.address.bytes, &public_key);
-		if (ah == BAD_ADDRESS_HANDLE)
-		{
-			r = walletGetLastError();
-		}
+		return false;
 	}
-	else
+	if (sizeof(message_buffer.signature_data.bytes) < MAX_SIGNATURE_LENGTH)
 	{
-		r = getAddressAndPublicKey(message_buffer.address.bytes, &public_key, ah);
+		// This should never happen.
+		fatalError();
 	}
-
-	if (r == WALLET_NO_ERROR)
+	for (i = 0; i < batch_signature_count; i++)
 	{
-		message_buffer.address_handle = ah;
-		if (sizeof(message_buffer.public_key.bytes) < ECDSA_MAX_SERIALISE_SIZE) // sanity check
+		message_buffer.signature_data.size = batch_signature_lengths[i];
+		memcpy(message_buffer.signature_data.bytes, &(batch_signatures[i * MAX_SIGNATURE_LENGTH]), batch_signature_lengths[i]);
+		if (!pb_encode_tag_for_field(stream, field))
 		{
-			fatalError();
-			return;
+			return false;
+		}
+		if (!pb_encode_submessage(stream, Signature_fields, &message_buffer))
+		{
+			return false;
 		}
-		message_buffer.public_key.size = ecdsaSerialise(message_buffer.public_key.bytes, &public_key, true);
-		sendPacket(PACKET_TYPE_ADDRESS_PUBKEY, Address_fields, &message_buffer);
 	}
-	else
-	{
-		translateWalletError(r);
-	} // end if (r == WALLET_NO_ERROR)
+	return true;
 }
 
-/** nanopb field callback which will write repeated WalletInfo messages; one
-  * for each wallet on the device.
-  * \param stream Output stream to write to.
-  * \param field Field which contains the WalletInfo submessage.
+/** nanopb field callback for transaction data of SignTransactionBatch
+  * message. This is like signTransactionCallback(), except the transaction
+  * is parsed and approved once, then one signature is generated for every
+  * entry in the input_index list of the message. An input can be listed
+  * more than once, with different address handles, so that one input (eg. a
+  * pay to script hash multisig input) can be signed with several keys. The
+  * transaction parser only sees each input once.
+  * \param stream Input stream to read from.
+  * \param field Field which contains the transaction data.
   * \param arg Unused.
   * \return true on success, false on failure (nanopb convention).
   */
-bool listWalletsCallback(pb_ostream_t *stream, const pb_field_t *field, void * const *arg)
+bool signTransactionBatchCallback(pb_istream_t *stream, const pb_field_t *field, void **arg)
 {
-	uint32_t version;
-	uint32_t i;
-	WalletInfo message_buffer;
-
-	for (i = 0; i < number_of_wallets; i++)
-	{
-		message_buffer.wallet_number = i;
-		message_buffer.wallet_name.size = NAME_LENGTH;
-		message_buffer.wallet_uuid.size = UUID_LENGTH;
+	Signatures message_buffer;
+	TransactionErrors r;
+	WalletErrors wallet_return;
+	uint8_t transaction_hash[32];
+	uint8_t sig_hashes[TRANSACTION_MAX_BATCH * 32];
+	uint8_t private_key[32];
+	uint8_t signatures[TRANSACTION_MAX_BATCH * MAX_SIGNATURE_LENGTH];
+	uint8_t signature_lengths[TRANSACTION_MAX_BATCH];
+	uint32_t unique_indices[TRANSACTION_MAX_BATCH];
+	uint8_t lanes[TRANSACTION_MAX_BATCH];
+	uint8_t num_unique;
+	uint8_t count;
+	uint8_t i;
+	uint8_t j;
+	bool repeated_pair;
+
+	// Every distinct input gets one signature hash (lane) from the parser;
+	// lanes[i] is the lane of entry i. Listing the same input with the same
+	// address handle twice is pointless, so that's rejected.
+	num_unique = 0;
+	repeated_pair = false;
+	for (i = 0; (i < sign_transaction_batch.input_index_count) && (i < TRANSACTION_MAX_BATCH); i++)
+	{
+		for (j = 0; j < i; j++)
+		{
+			if ((sign_transaction_batch.input_index[j] == sign_transaction_batch.input_index[i])
+				&& (sign_transaction_batch.address_handle[j] == sign_transaction_batch.address_handle[i]))
+			{
+				repeated_pair = true;
+			}
+		}
+		for (j = 0; j < num_unique; j++)
+		{
+			if (unique_indices[j] == sign_transaction_batch.input_index[i])
+			{
+				break;
+			}
+		}
+		if (j == num_unique)
+		{
+			unique_indices[num_unique] = sign_transaction_batch.input_index[i];
+			num_unique++;
+		}
+		lanes[i] = j;
+	}
+
+	if ((sign_transaction_batch.address_handle_count != sign_transaction_batch.input_index_count)
+		|| (sign_transaction_batch.input_index_count == 0)
+		|| (sign_transaction_batch.input_index_count > TRANSACTION_MAX_BATCH)
+		|| repeated_pair)
+	{
+		// Discard transaction data, since it can't be signed.
+		if (!readFieldBytes(stream, NULL))
+		{
+			return false;
+		}
+		if (sign_transaction_batch.input_index_count > TRANSACTION_MAX_BATCH)
+		{
+			writeFailureString(STRINGSET_MISC, MISCSTR_PARAM_TOO_LARGE);
+		}
+		else
+		{
+			writeFailureString(STRINGSET_MISC, MISCSTR_INVALID_PACKET);
+		}
+		return true;
+	}
+	count = (uint8_t)sign_transaction_batch.input_index_count;
+
+	// Validate transaction and calculate hashes of it.
+	clearOutputsSeen();
+	r = parseTransactionBatch(sig_hashes, transaction_hash, stream->bytes_left, unique_indices, num_unique, sign_transaction_batch.use_bip143);
+	// See signTransactionCallback() for why this is needed.
+	payload_length -= stream->bytes_left;
+	stream->bytes_left = 0;
+	if (r != TRANSACTION_NO_ERROR)
+	{
+		// Transaction parse error.
+		writeFailureString(STRINGSET_TRANSACTION, (uint8_t)r);
+		return true;
+	}
+
+	if (approveTransaction(transaction_hash))
+	{
+		// All signatures must be generated before anything can be sent,
+		// because it's too late to send a Failure once the Signatures
+		// packet has started.
+		for (i = 0; i < count; i++)
+		{
+			if (getPrivateKey(private_key, sign_transaction_batch.address_handle[i]) != WALLET_NO_ERROR)
+			{
+				wallet_return = walletGetLastError();
+				translateWalletError(wallet_return);
+				return true;
+			}
+			if (signTransaction(&(signatures[i * MAX_SIGNATURE_LENGTH]), &(signature_lengths[i]), &(sig_hashes[lanes[i] * 32]), private_key))
+			{
+				fatalError(); // signature failed self-verification
+			}
+		}
+		batch_signatures = signatures;
+		batch_signature_lengths = signature_lengths;
+		batch_signature_count = count;
+		message_buffer.signature.funcs.encode = &signaturesCallback;
+		sendPacket(PACKET_TYPE_SIGNATURES, Signatures_fields, &message_buffer);
+		batch_signature_count = 0;
+		batch_signatures = NULL;
+		batch_signature_lengths = NULL;
+	}
+	return true;
+}
+
+/** Send a packet containing an address and its corresponding public key.
+  * This can generate new addresses as well as obtain old addresses. Both
+  * use cases were combined into one function because they involve similar
+  * processes.
+  * \param generate_new If this is true, a new address will be generated
+  *                     and the address handle of the generated address will
+  *                     be prepended to the output packet.
+  *                     If this is false, the address handle specified by ah
+  *                     will be used.
+  * \param ah Address handle to use (if generate_new is false).
+  */
+static NOINLINE void getAndSendAddressAndPublicKey(bool generate_new, AddressHandle ah)
+{
+	Address message_buffer;
+	PointAffine public_key;
+	WalletErrors r;
+
+	message_buffer.address.size = 20;
+	if (generate_new)
+	{
+		r = WALLET_NO_ERROR;
+		ah = makeNewAddress(message_buffer.address.bytes, &public_key);
+		if (ah == BAD_ADDRESS_HANDLE)
+		{
+			r = walletGetLastError();
+		}
+	}
+	else
+	{
+		r = getAddressAndPublicKey(message_buffer.address.bytes, &public_key, ah);
+	}
+
+	if (r == WALLET_NO_ERROR)
+	{
+		message_buffer.address_handle = ah;
+		message_buffer.has_address = true;
+		if (sizeof(message_buffer.public_key.bytes) < ECDSA_MAX_SERIALISE_SIZE) // sanity check
+		{
+			fatalError();
+			return;
+		}
+		message_buffer.public_key.size = ecdsaSerialise(message_buffer.public_key.bytes, &public_key, true);
+		sendPacket(PACKET_TYPE_ADDRESS_PUBKEY, Address_fields, &message_buffer);
+	}
+	else
+	{
+		translateWalletError(r);
+	} // end if (r == WALLET_NO_ERROR)
+}
+
+/** Create the wallet described by a NewWallet message and send the
+  * response. This must only be called once the user has approved the
+  * creation of the wallet, and after the password (if any) has been hashed
+  * into #field_hash. If the host asked for the wallet to stay unlocked
+  * across sessions, the user is asked to approve that too.
+  * \param new_wallet The NewWallet message, which may be part of a
+  *                   RestoreWallet message.
+  * \param use_seed See newWallet().
+  * \param seed See newWallet(). If backup_uuid is not NULL, this is the
+  *             encrypted seed of a backup (see restoreWalletBackup()).
+  * \param backup_uuid UUID from the backup, or NULL if seed isn't from a
+  *                    backup made by exportWalletBackup().
+  * \param backup_digest Digest from the backup. This is ignored if
+  *                      backup_uuid is NULL.
+  */
+static void createWallet(NewWallet *new_wallet, bool use_seed, uint8_t *seed, uint8_t *backup_uuid, uint8_t *backup_digest)
+{
+	unsigned int password_length;
+	WalletErrors r;
+#ifdef ENABLE_KEEP_UNLOCKED
+	bool keep_unlocked;
+#endif // #ifdef ENABLE_KEEP_UNLOCKED
+
+	if (field_hash_set)
+	{
+		password_length = sizeof(field_hash);
+	}
+	else
+	{
+		password_length = 0; // no password
+	}
+#ifdef ENABLE_KEEP_UNLOCKED
+	// Wallets without a password are never locked, so there's nothing to
+	// ask about.
+	keep_unlocked = (password_length > 0) && new_wallet->has_keep_unlocked && new_wallet->keep_unlocked;
+	if (keep_unlocked)
+	{
+		if (buttonInterjection(ASKUSER_KEEP_UNLOCKED))
+		{
+			return; // permission denied; buttonInterjection() has responded
+		}
+	}
+#endif // #ifdef ENABLE_KEEP_UNLOCKED
+	// Whatever wallet was loaded is about to be unloaded.
+	clearApprovedTransactions();
+	if (backup_uuid != NULL)
+	{
+		// A hidden wallet has to use the UUID of the wallet it hides behind,
+		// so it can't be restored from a backup made elsewhere.
+		if (new_wallet->is_hidden)
+		{
+			r = WALLET_INVALID_OPERATION;
+		}
+		else
+		{
+			r = restoreWalletBackup(
+				new_wallet->wallet_number,
+				new_wallet->wallet_name.bytes,
+				backup_uuid,
+				seed,
+				backup_digest,
+				field_hash,
+				password_length);
+		}
+	}
+	else
+	{
+		r = newWallet(
+			new_wallet->wallet_number,
+			new_wallet->wallet_name.bytes,
+			use_seed,
+			seed,
+			new_wallet->is_hidden,
+			field_hash,
+			password_length);
+	}
+#ifdef ENABLE_KEEP_UNLOCKED
+	if ((r == WALLET_NO_ERROR) && keep_unlocked)
+	{
+		r = setWalletKeepUnlocked(true);
+	}
+#endif // #ifdef ENABLE_KEEP_UNLOCKED
+	translateWalletError(r);
+}
+
+/** Send an encrypted backup of the currently loaded wallet to the host, in
+  * one WalletBackup packet (see exportWalletBackup()). This must only be
+  * called once the user has approved the backup. */
+static NOINLINE void sendWalletBackup(void)
+{
+	WalletBackup message_buffer;
+	WalletErrors r;
+
+	r = exportWalletBackup(
+		message_buffer.wallet_uuid.bytes,
+		message_buffer.encrypted_seed.bytes,
+		message_buffer.digest.bytes);
+	if (r == WALLET_NO_ERROR)
+	{
+		message_buffer.wallet_uuid.size = UUID_LENGTH;
+		message_buffer.encrypted_seed.size = SEED_LENGTH;
+		message_buffer.digest.size = sizeof(message_buffer.digest.bytes);
+		sendPacket(PACKET_TYPE_WALLET_BACKUP, WalletBackup_fields, &message_buffer);
+	}
+	else
+	{
+		translateWalletError(r);
+	}
+	memset(&message_buffer, 0, sizeof(message_buffer));
+}
+
+/** nanopb field callback which will write repeated WalletInfo messages; one
+  * for each wallet with a wallet number from #list_start to #list_end - 1.
+  * \param stream Output stream to write to.
+  * \param field Field which contains the WalletInfo submessage.
+  * \param arg Unused.
+  * \return true on success, false on failure (nanopb convention).
+  */
+bool listWalletsCallback(pb_ostream_t *stream, const pb_field_t *field, void * const *arg)
+{
+	uint32_t version;
+	uint32_t i;
+	WalletInfo message_buffer;
+
+	for (i = list_start; i < list_end; i++)
+	{
+		message_buffer.wallet_number = i;
+		message_buffer.wallet_name.size = NAME_LENGTH;
+		message_buffer.wallet_uuid.size = UUID_LENGTH;
 		if (getWalletInfo(
 			&version,
 			message_buffer.wallet_name.bytes,
@@ -768,6 +1644,682 @@ bool listWalletsCallback(pb_ostream_t *stream, const pb_field_t *field, void * c
 	return true;
 }
 
+/** nanopb field callback which will write repeated Address messages; one
+  * for each address in #range_addresses.
+  * \param stream Output stream to write to.
+  * \param field Field which contains the Address submessage.
+  * \param arg Unused.
+  * \return true on success, false on failure (nanopb convention).
+  */
+bool addressRangeCallback(pb_ostream_t *stream, const pb_field_t *field, void * const *arg)
+{
+	Address message_buffer;
+	uint8_t i;
+
+	if ((range_addresses == NULL) || (range_public_keys == NULL))
+	{
+		return false;
+	}
+	for (i = 0; i < range_count; i++)
+	{
+		message_buffer.address_handle = range_start + i;
+		message_buffer.has_address = !range_omit_addresses;
+		message_buffer.address.size = 20;
+		memcpy(message_buffer.address.bytes, &(range_addresses[i * 20]), 20);
+		message_buffer.public_key.size = ecdsaSerialise(message_buffer.public_key.bytes, &(range_public_keys[i]), true);
+		if (!pb_encode_tag_for_field(stream, field))
+		{
+			return false;
+		}
+		if (!pb_encode_submessage(stream, Address_fields, &message_buffer))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/** Reset the session, as Initialize (and GetWalletSnapshot) asks. This
+  * forgets approvals, clears sensitive data from RAM and unloads the
+  * current wallet.
+  * \param new_session_id The host's session identifier, which will be
+  *                       echoed back in Features (see fillFeatures()).
+  * \param length The length of new_session_id, in bytes.
+  * \param use_tagged_packets Whether the host wants to use tagged packets
+  *                           for the rest of the session.
+  * \param skip_button_requests Whether the host will always allow the user
+  *                             to be asked for permission, so that
+  *                             ButtonRequest interjections can be skipped
+  *                             for the rest of the session.
+  * \param lock_wallets Whether to lock every wallet, including those which
+  *                     were allowed to stay unlocked across sessions.
+  * \return #WALLET_NO_ERROR on success, or one of #WalletErrorsEnum if an
+  *         error occurred.
+  */
+static WalletErrors startSession(const uint8_t *new_session_id, size_t length, bool use_tagged_packets, bool skip_button_requests, bool lock_wallets)
+{
+	if (length >= sizeof(session_id))
+	{
+		fatalError(); // sanity check failed
+	}
+	tagged_packets_enabled = use_tagged_packets;
+	implicit_button_ack = skip_button_requests;
+	session_id_length = length;
+	memcpy(session_id, new_session_id, session_id_length);
+	clearApprovedTransactions();
+	// The RAM-cached entropy pool is about to be cleared, so write it now
+	// rather than lose what was accumulated since the last write. There's
+	// nothing useful to do if this fails.
+	flushEntropyPool();
+	sanitiseRam();
+	if (lock_wallets)
+	{
+		return lockAllWallets();
+	}
+	else
+	{
+		return endWalletSession();
+	}
+}
+
+/** Fill in a Features message, which describes this device and echoes
+  * the current session identifier.
+  * \param features The message to fill in. This should have been cleared
+  *                 beforehand.
+  */
+static void fillFeatures(Features *features)
+{
+	features->echoed_session_id.size = session_id_length;
+	if (session_id_length >= sizeof(features->echoed_session_id.bytes))
+	{
+		fatalError(); // sanity check failed
+	}
+	memcpy(features->echoed_session_id.bytes, session_id, session_id_length);
+	string_arg.next_set = STRINGSET_MISC;
+	string_arg.next_spec = MISCSTR_VENDOR;
+	features->vendor.funcs.encode = &writeStringCallback;
+	features->vendor.arg = &string_arg;
+	features->has_major_version = true;
+	features->major_version = VERSION_MAJOR;
+	features->has_minor_version = true;
+	features->minor_version = VERSION_MINOR;
+	string_arg_alt.next_set = STRINGSET_MISC;
+	string_arg_alt.next_spec = MISCSTR_CONFIG;
+	features->config.funcs.encode = &writeStringCallback;
+	features->config.arg = &string_arg_alt;
+	features->has_otp = true;
+	features->otp = true;
+	features->has_pin = true;
+	features->pin = true;
+	features->has_spv = true;
+	features->spv = true;
+	features->algo_count = 1;
+	features->algo[0] = Algorithm_BIP32;
+	features->has_debug_link = true;
+	features->debug_link = false;
+	features->has_max_outstanding_requests = true;
+	if (tagged_packets_enabled)
+	{
+		features->max_outstanding_requests = MAX_OUTSTANDING_REQUESTS;
+	}
+	else
+	{
+		features->max_outstanding_requests = 1;
+	}
+	features->has_implicit_button_ack = true;
+	features->implicit_button_ack = implicit_button_ack;
+}
+
+/** Load a wallet. If the wallet is encrypted, the host is asked for its
+  * password with a PinRequest interjection, unless the request already
+  * carried one.
+  * \param wallet_number The wallet number of the wallet to load.
+  * \param has_password Whether the request carried a password, in which
+  *                     case #field_hash must already contain its hash.
+  * \param out_r The result of loading the wallet (see #WalletErrors) will be
+  *              written here. It is only valid if this returns false.
+  * \return false if loading the wallet was attempted, true if the host
+  *         didn't supply a password (in which case a Failure has already
+  *         been sent).
+  */
+static bool loadWalletWithPin(uint32_t wallet_number, bool has_password, WalletErrors *out_r)
+{
+	// Approvals don't carry over to the newly loaded wallet.
+	clearApprovedTransactions();
+	// Attempt load with no password.
+	*out_r = initWallet(wallet_number, field_hash, 0);
+	if (*out_r == WALLET_NOT_THERE)
+	{
+		// Attempt load with password.
+		if (!has_password && pinInterjection())
+		{
+			return true;
+		}
+		if (!field_hash_set)
+		{
+			fatalError(); // this should never happen
+		}
+		*out_r = initWallet(wallet_number, field_hash, sizeof(field_hash));
+	}
+	return false;
+}
+
+/** Get the addresses and public keys of a contiguous range of address
+  * handles and send them all in one packet. This is faster than
+  * sending #PACKET_TYPE_GET_ADDRESS_PUBKEY for each address, since the
+  * public keys are calculated together (see getAddressesAndPublicKeys()).
+  * \param start_ah Address handle of the first address in the range.
+  * \param count Number of addresses in the range.
+  * \param omit_addresses Whether to leave addresses out of the response,
+  *                       sending only the public keys.
+  */
+static NOINLINE void getAndSendAddressRange(AddressHandle start_ah, uint32_t count, bool omit_addresses)
+{
+	Addresses message_buffer;
+	uint8_t addresses[ECDSA_MAX_BATCH * 20];
+	PointAffine public_keys[ECDSA_MAX_BATCH];
+	WalletErrors r;
+
+	if (count > ECDSA_MAX_BATCH)
+	{
+		writeFailureString(STRINGSET_MISC, MISCSTR_PARAM_TOO_LARGE);
+		return;
+	}
+	// All addresses must be calculated before anything can be sent, because
+	// it's too late to send a Failure once the Addresses packet has started.
+	r = getAddressesAndPublicKeys(addresses, public_keys, start_ah, (uint8_t)count);
+	if (r != WALLET_NO_ERROR)
+	{
+		translateWalletError(r);
+		return;
+	}
+	range_addresses = addresses;
+	range_public_keys = public_keys;
+	range_start = start_ah;
+	range_count = (uint8_t)count;
+	range_omit_addresses = omit_addresses;
+	message_buffer.address.funcs.encode = &addressRangeCallback;
+	sendPacket(PACKET_TYPE_ADDRESSES, Addresses_fields, &message_buffer);
+	range_omit_addresses = false;
+	range_count = 0;
+	range_addresses = NULL;
+	range_public_keys = NULL;
+}
+
+/** Do what Initialize, LoadWallet, GetNumberOfAddresses and (optionally)
+  * GetMasterPublicKey and GetAddressRange would do, and send the results
+  * in one WalletSnapshot packet. If any step fails, a Failure is sent
+  * instead and the remaining steps are skipped.
+  * \param request The GetWalletSnapshot request.
+  */
+static NOINLINE void getAndSendWalletSnapshot(GetWalletSnapshot *request)
+{
+	WalletSnapshot message_buffer;
+	uint8_t addresses[ECDSA_MAX_BATCH * 20];
+	PointAffine public_keys[ECDSA_MAX_BATCH];
+	PointAffine master_public_key;
+	uint32_t version;
+	uint32_t num_addresses;
+	uint32_t count;
+	WalletErrors r;
+
+	count = 0;
+	if (request->has_number_of_recent_addresses)
+	{
+		count = request->number_of_recent_addresses;
+	}
+	if (count > ECDSA_MAX_BATCH)
+	{
+		writeFailureString(STRINGSET_MISC, MISCSTR_PARAM_TOO_LARGE);
+		return;
+	}
+	r = startSession(
+		request->session_id.bytes,
+		request->session_id.size,
+		request->has_use_tagged_packets && request->use_tagged_packets,
+		request->has_implicit_button_ack && request->implicit_button_ack,
+		request->has_lock_wallets && request->lock_wallets);
+	if (r == WALLET_NO_ERROR)
+	{
+		if (loadWalletWithPin(request->wallet_number, field_hash_set, &r))
+		{
+			return; // host didn't supply a password
+		}
+	}
+	memset(&message_buffer, 0, sizeof(message_buffer));
+	if (r == WALLET_NO_ERROR)
+	{
+		message_buffer.wallet_info.wallet_number = request->wallet_number;
+		message_buffer.wallet_info.wallet_name.size = NAME_LENGTH;
+		message_buffer.wallet_info.wallet_uuid.size = UUID_LENGTH;
+		r = getWalletInfo(
+			&version,
+			message_buffer.wallet_info.wallet_name.bytes,
+			message_buffer.wallet_info.wallet_uuid.bytes,
+			request->wallet_number);
+	}
+	if (r == WALLET_NO_ERROR)
+	{
+		num_addresses = getNumAddresses();
+		r = walletGetLastError();
+		if (r == WALLET_EMPTY)
+		{
+			// A wallet with no addresses is still worth a snapshot.
+			num_addresses = 0;
+			r = WALLET_NO_ERROR;
+		}
+		message_buffer.number_of_addresses = num_addresses;
+	}
+	if (r != WALLET_NO_ERROR)
+	{
+		translateWalletError(r);
+		return;
+	}
+	if (request->has_include_master_public_key && request->include_master_public_key)
+	{
+		if (buttonInterjection(ASKUSER_GET_MASTER_KEY))
+		{
+			return;
+		}
+		if (otpInterjection(ASKUSER_GET_MASTER_KEY))
+		{
+			return;
+		}
+		r = getMasterPublicKey(&master_public_key, message_buffer.master_public_key.chain_code.bytes);
+		if (r != WALLET_NO_ERROR)
+		{
+			translateWalletError(r);
+			return;
+		}
+		message_buffer.has_master_public_key = true;
+		message_buffer.master_public_key.chain_code.size = 32;
+		if (sizeof(message_buffer.master_public_key.public_key.bytes) < ECDSA_MAX_SERIALISE_SIZE) // sanity check
+		{
+			fatalError();
+			return;
+		}
+		message_buffer.master_public_key.public_key.size = ecdsaSerialise(message_buffer.master_public_key.public_key.bytes, &master_public_key, true);
+	}
+	count = MIN(count, num_addresses);
+	if (count > 0)
+	{
+		// As in getAndSendAddressRange(), everything must be calculated
+		// before the WalletSnapshot packet is started.
+		r = getAddressesAndPublicKeys(addresses, public_keys, num_addresses - count + 1, (uint8_t)count);
+		if (r != WALLET_NO_ERROR)
+		{
+			translateWalletError(r);
+			return;
+		}
+		range_addresses = addresses;
+		range_public_keys = public_keys;
+		range_start = num_addresses - count + 1;
+		range_count = (uint8_t)count;
+		message_buffer.address.funcs.encode = &addressRangeCallback;
+	}
+	fillFeatures(&(message_buffer.features));
+	sendPacket(PACKET_TYPE_WALLET_SNAPSHOT, WalletSnapshot_fields, &message_buffer);
+	range_count = 0;
+	range_addresses = NULL;
+	range_public_keys = NULL;
+}
+
+/** List some or all of the wallets on the device, and send the list. Only
+  * wallet numbers from start to start + count - 1 are examined, which bounds
+  * the size of the response (and the time taken to build it).
+  * \param start The first wallet number to examine.
+  * \param count The number of wallet numbers to examine. This is clipped to
+  *              the number of wallet numbers after start.
+  * \param check_changed Whether to skip the list if it hasn't changed since
+  *                      the host last saw it.
+  * \param changed_since The wallet list generation the host last saw (see
+  *                      getWalletListGeneration()). This is ignored if
+  *                      check_changed is false.
+  */
+static NOINLINE void getAndSendWalletList(uint32_t start, uint32_t count, bool check_changed, uint32_t changed_since)
+{
+	Wallets message_buffer;
+	uint32_t total;
+
+	total = getNumberOfWallets();
+	if (total == 0)
+	{
+		translateWalletError(walletGetLastError());
+		return;
+	}
+	if (start >= total)
+	{
+		translateWalletError(WALLET_INVALID_WALLET_NUM);
+		return;
+	}
+	if (count > (total - start))
+	{
+		count = total - start;
+	}
+
+	memset(&message_buffer, 0, sizeof(message_buffer));
+	message_buffer.has_generation = true;
+	message_buffer.generation = getWalletListGeneration();
+	if (check_changed && (changed_since == message_buffer.generation))
+	{
+		message_buffer.has_unchanged = true;
+		message_buffer.unchanged = true;
+	}
+	else
+	{
+		list_start = start;
+		list_end = start + count;
+		if (list_end < total)
+		{
+			message_buffer.has_next_wallet_number = true;
+			message_buffer.next_wallet_number = list_end;
+		}
+		message_buffer.wallet_info.funcs.encode = &listWalletsCallback;
+	}
+	sendPacket(PACKET_TYPE_WALLETS, Wallets_fields, &message_buffer);
+	list_start = 0;
+	list_end = 0;
+}
+
+#ifdef ENABLE_BENCHMARK
+/** Time how long a primitive takes to run (see runBenchmark()) and send the
+  * result.
+  * \param primitive The primitive to time; one of #BenchmarkPrimitives.
+  * \param iterations Number of times to run the primitive.
+  */
+static NOINLINE void runAndSendBenchmark(uint32_t primitive, uint32_t iterations)
+{
+	BenchmarkResult message_buffer;
+
+	if (runBenchmark(&(message_buffer.ticks), primitive, iterations))
+	{
+		writeFailureString(STRINGSET_MISC, MISCSTR_INVALID_PACKET);
+		return;
+	}
+	message_buffer.primitive = primitive;
+	message_buffer.iterations = iterations;
+	sendPacket(PACKET_TYPE_BENCHMARK_RESULT, BenchmarkResult_fields, &message_buffer);
+}
+#endif // #ifdef ENABLE_BENCHMARK
+
+#ifdef ENABLE_DIAGNOSTICS
+/** nanopb field callback which will write repeated PacketStatistics
+  * messages; one for each packet type which has been handled at least once.
+  * \param stream Output stream to write to.
+  * \param field Field which contains the PacketStatistics submessage.
+  * \param arg Unused.
+  * \return true on success, false on failure (nanopb convention).
+  */
+bool packetStatisticsCallback(pb_ostream_t *stream, const pb_field_t *field, void * const *arg)
+{
+	PacketStatistics message_buffer;
+	const CommandDiagnostics *entry;
+	uint16_t packet_type;
+
+	for (packet_type = 0; packet_type < DIAGNOSTICS_NUM_PACKET_TYPES; packet_type++)
+	{
+		entry = getCommandDiagnostics(packet_type);
+		if (entry->count > 0)
+		{
+			message_buffer.packet_type = packet_type;
+			message_buffer.count = entry->count;
+			message_buffer.min_ticks = entry->min_ticks;
+			message_buffer.max_ticks = entry->max_ticks;
+			message_buffer.total_ticks = entry->total_ticks;
+			message_buffer.max_stack_bytes = entry->max_stack_bytes;
+			if (!pb_encode_tag_for_field(stream, field))
+			{
+				return false;
+			}
+			if (!pb_encode_submessage(stream, PacketStatistics_fields, &message_buffer))
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+/** Write an array of numbers as a repeated uint32 field.
+  * \param stream Output stream to write to.
+  * \param field Field which contains the numbers.
+  * \param values The numbers to write.
+  * \param count The number of numbers to write.
+  * \return true on success, false on failure (nanopb convention).
+  */
+static bool writeRepeatedU32(pb_ostream_t *stream, const pb_field_t *field, const uint32_t *values, unsigned int count)
+{
+	unsigned int i;
+
+	for (i = 0; i < count; i++)
+	{
+		if (!pb_encode_tag_for_field(stream, field))
+		{
+			return false;
+		}
+		if (!pb_encode_varint(stream, (uint64_t)values[i]))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/** nanopb field callback which will write the histogram of non-volatile
+  * storage flush times; one number for each bucket.
+  * \param stream Output stream to write to.
+  * \param field Field which contains the histogram.
+  * \param arg Unused.
+  * \return true on success, false on failure (nanopb convention).
+  */
+bool flushHistogramCallback(pb_ostream_t *stream, const pb_field_t *field, void * const *arg)
+{
+	return writeRepeatedU32(stream, field, getNVDiagnostics()->flush_histogram, DIAGNOSTICS_NV_FLUSH_BUCKETS);
+}
+
+/** nanopb field callback which will write the erase count of each
+  * non-volatile storage sector.
+  * \param stream Output stream to write to.
+  * \param field Field which contains the erase counts.
+  * \param arg Unused.
+  * \return true on success, false on failure (nanopb convention).
+  */
+bool sectorEraseCountsCallback(pb_ostream_t *stream, const pb_field_t *field, void * const *arg)
+{
+	return writeRepeatedU32(stream, field, getNVDiagnostics()->sector_erase_counts, DIAGNOSTICS_NV_SECTORS);
+}
+
+/** nanopb field callback which will write the time taken by each step of
+  * the platform's boot sequence.
+  * \param stream Output stream to write to.
+  * \param field Field which contains the boot step times.
+  * \param arg Unused.
+  * \return true on success, false on failure (nanopb convention).
+  */
+bool bootStepTicksCallback(pb_ostream_t *stream, const pb_field_t *field, void * const *arg)
+{
+	const uint32_t *ticks;
+	unsigned int count;
+
+	ticks = getBootStepTicks(&count);
+	return writeRepeatedU32(stream, field, ticks, count);
+}
+
+/** nanopb field callback which will write repeated USBEndpointStatistics
+  * messages; one for each USB endpoint which has been used.
+  * \param stream Output stream to write to.
+  * \param field Field which contains the USBEndpointStatistics submessage.
+  * \param arg Points to an array of #DIAGNOSTICS_USB_ENDPOINTS
+  *            USBEndpointDiagnostics, indexed by endpoint number.
+  * \return true on success, false on failure (nanopb convention).
+  */
+bool usbEndpointsCallback(pb_ostream_t *stream, const pb_field_t *field, void * const *arg)
+{
+	USBEndpointStatistics message_buffer;
+	const USBEndpointDiagnostics *entry;
+	unsigned int endpoint;
+	unsigned int i;
+	bool is_used;
+
+	for (endpoint = 0; endpoint < DIAGNOSTICS_USB_ENDPOINTS; endpoint++)
+	{
+		entry = &(((const USBEndpointDiagnostics *)*arg)[endpoint]);
+		is_used = (entry->packets > 0);
+		for (i = 0; i < DIAGNOSTICS_USB_NUMBER_OF_EVENTS; i++)
+		{
+			if (entry->events[i] > 0)
+			{
+				is_used = true;
+			}
+		}
+		if (is_used)
+		{
+			message_buffer.endpoint = endpoint;
+			message_buffer.packets = entry->packets;
+			message_buffer.bytes = entry->bytes;
+			message_buffer.stalls = entry->events[DIAGNOSTICS_USB_STALL];
+			message_buffer.fifo_full = entry->events[DIAGNOSTICS_USB_FIFO_FULL];
+			message_buffer.fifo_empty = entry->events[DIAGNOSTICS_USB_FIFO_EMPTY];
+			message_buffer.max_fifo_depth = entry->max_fifo_depth;
+			if (!pb_encode_tag_for_field(stream, field))
+			{
+				return false;
+			}
+			if (!pb_encode_submessage(stream, USBEndpointStatistics_fields, &message_buffer))
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+/** Send the request timing, non-volatile storage, stack, boot and USB
+  * statistics gathered by diagnostics.c. The phase totals and USB
+  * statistics are copied first, since sending the message changes them and
+  * the message may be encoded twice (see sendPacket()). The statistics for
+  * each packet type and the stack statistics don't change until this
+  * request is finished, and sending doesn't touch non-volatile storage. */
+static NOINLINE void sendDiagnostics(void)
+{
+	Diagnostics message_buffer;
+	const NVDiagnostics *nv;
+	USBEndpointDiagnostics usb[DIAGNOSTICS_USB_ENDPOINTS];
+	unsigned int endpoint;
+
+	message_buffer.packet_statistics.funcs.encode = &packetStatisticsCallback;
+	message_buffer.compute_ticks = getPhaseTicks(DIAGNOSTICS_PHASE_COMPUTE);
+	message_buffer.receive_ticks = getPhaseTicks(DIAGNOSTICS_PHASE_RECEIVE);
+	message_buffer.user_wait_ticks = getPhaseTicks(DIAGNOSTICS_PHASE_USER_WAIT);
+	message_buffer.send_ticks = getPhaseTicks(DIAGNOSTICS_PHASE_SEND);
+	nv = getNVDiagnostics();
+	message_buffer.nv_statistics.reads = nv->events[DIAGNOSTICS_NV_READ];
+	message_buffer.nv_statistics.writes = nv->events[DIAGNOSTICS_NV_WRITE];
+	message_buffer.nv_statistics.flushes = nv->flushes;
+	message_buffer.nv_statistics.erases = nv->events[DIAGNOSTICS_NV_ERASE];
+	message_buffer.nv_statistics.cache_hits = nv->events[DIAGNOSTICS_NV_CACHE_HIT];
+	message_buffer.nv_statistics.cache_misses = nv->events[DIAGNOSTICS_NV_CACHE_MISS];
+	message_buffer.nv_statistics.max_flush_ticks = nv->max_flush_ticks;
+	message_buffer.nv_statistics.flush_histogram.funcs.encode = &flushHistogramCallback;
+	message_buffer.nv_statistics.sector_erase_counts.funcs.encode = &sectorEraseCountsCallback;
+	message_buffer.stack_size = getStackSize();
+	message_buffer.max_stack_bytes = getPeakStackUsage();
+	message_buffer.boot_step_ticks.funcs.encode = &bootStepTicksCallback;
+	for (endpoint = 0; endpoint < DIAGNOSTICS_USB_ENDPOINTS; endpoint++)
+	{
+		memcpy(&(usb[endpoint]), getUSBDiagnostics(endpoint), sizeof(usb[endpoint]));
+	}
+	message_buffer.usb_endpoints.funcs.encode = &usbEndpointsCallback;
+	message_buffer.usb_endpoints.arg = usb;
+	sendPacket(PACKET_TYPE_DIAGNOSTICS, Diagnostics_fields, &message_buffer);
+}
+#endif // #ifdef ENABLE_DIAGNOSTICS
+
+#ifdef ENABLE_TRACE
+/** nanopb field callback which will write repeated TraceEntry messages;
+  * one for each event in the trace buffer, oldest first.
+  * \param stream Output stream to write to.
+  * \param field Field which contains the TraceEntry submessage.
+  * \param arg Unused.
+  * \return true on success, false on failure (nanopb convention).
+  */
+bool traceEntriesCallback(pb_ostream_t *stream, const pb_field_t *field, void * const *arg)
+{
+	TraceEntry message_buffer;
+	const TraceRecord *record;
+	unsigned int i;
+
+	for (i = 0; i < getTraceCount(); i++)
+	{
+		record = getTraceRecord(i);
+		message_buffer.timestamp = record->timestamp;
+		message_buffer.event = record->event;
+		message_buffer.arg = record->arg;
+		if (!pb_encode_tag_for_field(stream, field))
+		{
+			return false;
+		}
+		if (!pb_encode_submessage(stream, TraceEntry_fields, &message_buffer))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/** Send the contents of the trace buffer (see trace.c). Recording is paused
+  * while the buffer is sent, so that the buffer doesn't change between the
+  * two times sendPacket() may encode the message, and so that the trace
+  * isn't cluttered with the events caused by sending it.
+  * \param clear Whether to clear the trace buffer after sending it.
+  */
+static NOINLINE void sendTrace(bool clear)
+{
+	Trace message_buffer;
+	bool was_paused;
+
+	was_paused = tracePause(true);
+	message_buffer.entries.funcs.encode = &traceEntriesCallback;
+	message_buffer.total_events = getTraceTotal();
+	sendPacket(PACKET_TYPE_TRACE, Trace_fields, &message_buffer);
+	if (clear)
+	{
+		traceClear();
+	}
+	tracePause(was_paused);
+}
+#endif // #ifdef ENABLE_TRACE
+
+/** Send health and throughput statistics for the hardware random number
+  * generator (see getHWRNGHealth()). Unlike the timing statistics, these are
+  * always available, since a production device should be able to report
+  * whether its entropy source is working. */
+static NOINLINE void sendRNGHealth(void)
+{
+	RNGHealth message_buffer;
+	HWRNGHealth health;
+
+	getHWRNGHealth(&health);
+	message_buffer.has_statistics = health.has_statistics;
+	message_buffer.mean = health.mean;
+	message_buffer.variance = health.variance;
+	message_buffer.kappa3 = health.kappa3;
+	message_buffer.kappa4 = health.kappa4;
+	message_buffer.max_bin = health.max_bin;
+	message_buffer.bandwidth = health.bandwidth;
+	message_buffer.max_autocorrelation = health.max_autocorrelation;
+	message_buffer.entropy_estimate = health.entropy_estimate;
+	message_buffer.last_failed_tests = health.last_failed_tests;
+	message_buffer.arrays_tested = health.arrays_tested;
+	message_buffer.arrays_failed = health.arrays_failed;
+	message_buffer.samples_tested = health.samples_tested;
+	message_buffer.bytes_delivered = health.bytes_delivered;
+	message_buffer.blocked_calls = health.blocked_calls;
+	message_buffer.blocked_ticks = health.blocked_ticks;
+	message_buffer.max_blocked_ticks = health.max_blocked_ticks;
+	sendPacket(PACKET_TYPE_RNG_HEALTH, RNGHealth_fields, &message_buffer);
+}
+
 /** nanopb field callback which will write out the contents
   * of #entropy_buffer.
   * \param stream Output stream to write to.
@@ -827,12 +2379,202 @@ static NOINLINE void getBytesOfEntropy(uint32_t num_bytes)
 		random_bytes_index &= 31;
 	}
 	message_buffer.entropy.funcs.encode = &getEntropyCallback;
+	message_buffer.has_sequence_number = false;
+	message_buffer.has_end_of_stream = false;
+	message_buffer.has_digest = false;
 	entropy_buffer = random_bytes;
 	sendPacket(PACKET_TYPE_ENTROPY, Entropy_fields, &message_buffer);
 	num_entropy_bytes = 0;
 	entropy_buffer = NULL;
 }
 
+/** Return bytes of entropy from the random number generation system,
+  * sending them in chunks of #STREAMED_ENTROPY_CHUNK_SIZE bytes as they are
+  * generated. Unlike getBytesOfEntropy(), this only needs one chunk of RAM,
+  * so any number of bytes can be requested. The cost is that a failure
+  * can't be reported before anything is sent: instead the chunks are
+  * followed by either an end of stream packet, which carries a digest of
+  * every chunk, or a Failure packet, in which case the host must discard
+  * all the chunks (see PROTOCOL).
+  * \param num_bytes Number of bytes of entropy to send to stream.
+  */
+static NOINLINE void getStreamedEntropy(uint32_t num_bytes)
+{
+	Entropy message_buffer;
+	HashState hs;
+	uint8_t chunk[STREAMED_ENTROPY_CHUNK_SIZE];
+	unsigned int chunk_length;
+	unsigned int i;
+
+	sha256Begin(&hs);
+	message_buffer.entropy.funcs.encode = &getEntropyCallback;
+	message_buffer.has_sequence_number = true;
+	message_buffer.sequence_number = 0;
+	message_buffer.has_end_of_stream = false;
+	message_buffer.has_digest = false;
+	entropy_buffer = chunk;
+	while (num_bytes > 0)
+	{
+		if (num_bytes > sizeof(chunk))
+		{
+			chunk_length = sizeof(chunk);
+		}
+		else
+		{
+			chunk_length = (unsigned int)num_bytes;
+		}
+		for (i = 0; i < chunk_length; i += 32)
+		{
+			if (getRandom256(&(chunk[i])))
+			{
+				memset(chunk, 0, sizeof(chunk));
+				num_entropy_bytes = 0;
+				entropy_buffer = NULL;
+				translateWalletError(WALLET_RNG_FAILURE);
+				return;
+			}
+		}
+		sha256WriteBytes(&hs, chunk, chunk_length);
+		num_entropy_bytes = chunk_length;
+		sendPacket(PACKET_TYPE_ENTROPY, Entropy_fields, &message_buffer);
+		message_buffer.sequence_number++;
+		num_bytes -= chunk_length;
+	}
+	memset(chunk, 0, sizeof(chunk));
+
+	sha256FinishDouble(&hs);
+	num_entropy_bytes = 0;
+	message_buffer.has_end_of_stream = true;
+	message_buffer.end_of_stream = true;
+	message_buffer.has_digest = true;
+	message_buffer.digest.size = 32;
+	writeHashToByteArray(message_buffer.digest.bytes, &hs, true);
+	sendPacket(PACKET_TYPE_ENTROPY, Entropy_fields, &message_buffer);
+	entropy_buffer = NULL;
+}
+
+/** nanopb field callback which will generate and write out
+  * #num_bulk_entropy_bytes bytes from #bulk_entropy_drbg, reseeding it
+  * every #BULK_ENTROPY_RESEED_INTERVAL bytes. The bytes are written as they
+  * are generated, so there is no limit on how many can be sent.
+  * \param stream Output stream to write to.
+  * \param field Field which contains the the entropy bytes.
+  * \param arg Unused.
+  * \return true on success, false on failure (nanopb convention).
+  */
+bool bulkEntropyCallback(pb_ostream_t *stream, const pb_field_t *field, void * const *arg)
+{
+	uint8_t chunk[BULK_ENTROPY_CHUNK_SIZE];
+	uint8_t reseed_material[32];
+	uint32_t remaining;
+	uint32_t since_reseed;
+	unsigned int chunk_length;
+	bool r;
+
+	if (!pb_encode_tag_for_field(stream, field))
+	{
+		return false;
+	}
+	if (!pb_encode_varint(stream, num_bulk_entropy_bytes))
+	{
+		return false;
+	}
+	r = true;
+	remaining = num_bulk_entropy_bytes;
+	since_reseed = 0;
+	while (remaining > 0)
+	{
+		if (since_reseed == BULK_ENTROPY_RESEED_INTERVAL)
+		{
+			if (getRandom256(reseed_material))
+			{
+				r = false;
+				break;
+			}
+			drbgReseed(&bulk_entropy_drbg, reseed_material, sizeof(reseed_material));
+			since_reseed = 0;
+		}
+		if (remaining > sizeof(chunk))
+		{
+			chunk_length = sizeof(chunk);
+		}
+		else
+		{
+			chunk_length = (unsigned int)remaining;
+		}
+		drbgGenerate(chunk, &bulk_entropy_drbg, chunk_length, NULL, 0);
+		if (!pb_write(stream, chunk, chunk_length))
+		{
+			r = false;
+			break;
+		}
+		remaining -= chunk_length;
+		since_reseed += chunk_length;
+	}
+	memset(chunk, 0, sizeof(chunk));
+	memset(reseed_material, 0, sizeof(reseed_material));
+	return r;
+}
+
+/** Return bytes of entropy from a HMAC_DRBG instance which is seeded from
+  * the random number generation system. Unlike getBytesOfEntropy(), this
+  * doesn't need to buffer the bytes, so any number can be requested.
+  * \param num_bytes Number of bytes of entropy to send to stream.
+  */
+static NOINLINE void getBulkEntropy(uint32_t num_bytes)
+{
+	Entropy message_buffer;
+	pb_ostream_t substream;
+	uint8_t seed_material[64];
+	uint32_t message_length;
+
+	// The message may be much larger than #MAX_SEND_SIZE, so calculate its
+	// length directly instead of letting sendPacket() do a sizing pass.
+	substream.callback = NULL;
+	substream.state = NULL;
+	substream.max_size = 16;
+	substream.bytes_written = 0;
+	if (!pb_encode_tag(&substream, PB_WT_STRING, Entropy_entropy_tag)
+		|| !pb_encode_varint(&substream, num_bytes))
+	{
+		fatalError(); // this should never happen
+	}
+	if (num_bytes > (0xffffffff - substream.bytes_written))
+	{
+		writeFailureString(STRINGSET_MISC, MISCSTR_PARAM_TOO_LARGE);
+		return;
+	}
+	message_length = (uint32_t)substream.bytes_written + num_bytes;
+
+	// Like in getBytesOfEntropy(), nothing can be sent until the DRBG has
+	// been successfully seeded.
+	if (getRandom256(seed_material) || getRandom256(&(seed_material[32])))
+	{
+		memset(seed_material, 0, sizeof(seed_material));
+		translateWalletError(WALLET_RNG_FAILURE);
+		return;
+	}
+	drbgInstantiate(&bulk_entropy_drbg, seed_material, sizeof(seed_material));
+	memset(seed_material, 0, sizeof(seed_material));
+
+	sendPacketHeader(PACKET_TYPE_ENTROPY, message_length);
+	main_output_stream.bytes_written = 0;
+	main_output_stream.max_size = message_length;
+	message_buffer.entropy.funcs.encode = &bulkEntropyCallback;
+	message_buffer.has_sequence_number = false;
+	message_buffer.has_end_of_stream = false;
+	message_buffer.has_digest = false;
+	num_bulk_entropy_bytes = num_bytes;
+	// If a reseed fails part way through, the packet can't be retracted,
+	// and sending unreseeded bytes instead would be misleading. So halt.
+	if (!pb_encode(&main_output_stream, Entropy_fields, &message_buffer))
+	{
+		fatalError();
+	}
+	num_bulk_entropy_bytes = 0;
+	memset(&bulk_entropy_drbg, 0, sizeof(bulk_entropy_drbg));
+}
+
 /** nanopb field callback which calculates the double SHA-256 of an arbitrary
   * number of bytes. This is useful if we don't care about the contents of a
   * field but want to compress an arbitrarily-sized field into a fixed-length
@@ -844,18 +2586,13 @@ static NOINLINE void getBytesOfEntropy(uint32_t num_bytes)
   */
 bool hashFieldCallback(pb_istream_t *stream, const pb_field_t *field, void **arg)
 {
-	uint8_t one_byte;
 	HashState hs;
 
 	sha256Begin(&hs);
-	while (stream->bytes_left > 0)
-    {
-		if (!pb_read(stream, &one_byte, 1))
-		{
-			return false;
-		}
-        sha256WriteByte(&hs, one_byte);
-    }
+	if (!readFieldBytes(stream, &hs))
+	{
+		return false;
+	}
 	sha256FinishDouble(&hs);
 	writeHashToByteArray(field_hash, &hs, true);
 	field_hash_set = true;
@@ -884,8 +2621,21 @@ void processPacket(void)
 	WalletErrors wallet_return;
 	char ping_greeting[sizeof(message_buffer.ping.greeting)];
 	bool has_ping_greeting;
+	uint32_t path[sizeof(message_buffer.get_extended_public_key.path) / sizeof(uint32_t)];
+	unsigned int path_length;
 
 	message_id = receivePacketHeader();
+	diagnosticsBeginPacket();
+	traceEvent(TRACE_PACKET_BEGIN, message_id);
+	// Interjection replies may also be tagged, but it's the tag of this
+	// request which matters for everything sent while handling it.
+	response_tagged = received_packet_tagged;
+	response_tag = received_tag;
+	processing_packet = true;
+	current_operation = LONG_OPERATION_NONE;
+	operation_completed = 0;
+	operation_total = 0;
+	operation_cancelled = false;
 
 	// Checklist for each case:
 	// 1. Have you checked or dealt with length?
@@ -904,49 +2654,21 @@ void processPacket(void)
 	case PACKET_TYPE_INITIALIZE:
 		// Reset state and report features.
 		session_id_length = 0; // just in case receiveMessage() fails
+		tagged_packets_enabled = false;
+		implicit_button_ack = false;
 		receive_failure = receiveMessage(Initialize_fields, &(message_buffer.initialize));
 		if (!receive_failure)
 		{
-			session_id_length = message_buffer.initialize.session_id.size;
-			if (session_id_length >= sizeof(session_id))
-			{
-				fatalError(); // sanity check failed
-			}
-			memcpy(session_id, message_buffer.initialize.session_id.bytes, session_id_length);
-			prev_transaction_hash_valid = false;
-			sanitiseRam();
-			wallet_return = uninitWallet();
+			wallet_return = startSession(
+				message_buffer.initialize.session_id.bytes,
+				message_buffer.initialize.session_id.size,
+				message_buffer.initialize.has_use_tagged_packets && message_buffer.initialize.use_tagged_packets,
+				message_buffer.initialize.has_implicit_button_ack && message_buffer.initialize.implicit_button_ack,
+				message_buffer.initialize.has_lock_wallets && message_buffer.initialize.lock_wallets);
 			if (wallet_return == WALLET_NO_ERROR)
 			{
 				memset(&message_buffer, 0, sizeof(message_buffer));
-				message_buffer.features.echoed_session_id.size = session_id_length;
-				if (session_id_length >= sizeof(message_buffer.features.echoed_session_id.bytes))
-				{
-					fatalError(); // sanity check failed
-				}
-				memcpy(message_buffer.features.echoed_session_id.bytes, session_id, session_id_length);
-				string_arg.next_set = STRINGSET_MISC;
-				string_arg.next_spec = MISCSTR_VENDOR;
-				message_buffer.features.vendor.funcs.encode = &writeStringCallback;
-				message_buffer.features.vendor.arg = &string_arg;
-				message_buffer.features.has_major_version = true;
-				message_buffer.features.major_version = VERSION_MAJOR;
-				message_buffer.features.has_minor_version = true;
-				message_buffer.features.minor_version = VERSION_MINOR;
-				string_arg_alt.next_set = STRINGSET_MISC;
-				string_arg_alt.next_spec = MISCSTR_CONFIG;
-				message_buffer.features.config.funcs.encode = &writeStringCallback;
-				message_buffer.features.config.arg = &string_arg_alt;
-				message_buffer.features.has_otp = true;
-				message_buffer.features.otp = true;
-				message_buffer.features.has_pin = true;
-				message_buffer.features.pin = true;
-				message_buffer.features.has_spv = true;
-				message_buffer.features.spv = true;
-				message_buffer.features.algo_count = 1;
-				message_buffer.features.algo[0] = Algorithm_BIP32;
-				message_buffer.features.has_debug_link = true;
-				message_buffer.features.debug_link = false;
+				fillFeatures(&(message_buffer.features));
 				sendPacket(PACKET_TYPE_FEATURES, Features_fields, &(message_buffer.features));
 			}
 			else
@@ -956,6 +2678,22 @@ void processPacket(void)
 		}
 		break;
 
+	case PACKET_TYPE_GET_WALLET_SNAPSHOT:
+		// Initialize, load wallet and report on it, all at once.
+		session_id_length = 0; // just in case receiveMessage() fails
+		tagged_packets_enabled = false;
+		implicit_button_ack = false;
+		field_hash_set = false;
+		memset(field_hash, 0, sizeof(field_hash));
+		message_buffer.get_wallet_snapshot.password.funcs.decode = &hashFieldCallback;
+		message_buffer.get_wallet_snapshot.password.arg = NULL;
+		receive_failure = receiveMessage(GetWalletSnapshot_fields, &(message_buffer.get_wallet_snapshot));
+		if (!receive_failure)
+		{
+			getAndSendWalletSnapshot(&(message_buffer.get_wallet_snapshot));
+		}
+		break;
+
 	case PACKET_TYPE_PING:
 		// Ping request.
 		receive_failure = receiveMessage(Ping_fields, &(message_buffer.ping));
@@ -1003,6 +2741,7 @@ void processPacket(void)
 				invalid_otp = otpInterjection(ASKUSER_DELETE_WALLET);
 				if (!invalid_otp)
 				{
+					clearApprovedTransactions();
 					wallet_return = deleteWallet(message_buffer.delete_wallet.wallet_handle);
 					translateWalletError(wallet_return);
 				}
@@ -1022,23 +2761,7 @@ void processPacket(void)
 			permission_denied = buttonInterjection(ASKUSER_NEW_WALLET);
 			if (!permission_denied)
 			{
-				if (field_hash_set)
-				{
-					password_length = sizeof(field_hash);
-				}
-				else
-				{
-					password_length = 0; // no password
-				}
-				wallet_return = newWallet(
-					message_buffer.new_wallet.wallet_number,
-					message_buffer.new_wallet.wallet_name.bytes,
-					false,
-					NULL,
-					message_buffer.new_wallet.is_hidden,
-					field_hash,
-					password_length);
-				translateWalletError(wallet_return);
+				createWallet(&(message_buffer.new_wallet), false, NULL, NULL, NULL);
 			}
 		}
 		break;
@@ -1083,6 +2806,19 @@ void processPacket(void)
 		}
 		break;
 
+	case PACKET_TYPE_GET_ADDRESS_RANGE:
+		// Get addresses and public keys corresponding to a range of address
+		// handles.
+		receive_failure = receiveMessage(GetAddressRange_fields, &(message_buffer.get_address_range));
+		if (!receive_failure)
+		{
+			getAndSendAddressRange(
+				message_buffer.get_address_range.start_address_handle,
+				message_buffer.get_address_range.number_of_addresses,
+				message_buffer.get_address_range.has_omit_addresses && message_buffer.get_address_range.omit_addresses);
+		}
+		break;
+
 	case PACKET_TYPE_SIGN_TRANSACTION:
 		// Sign a transaction.
 		sign_transaction.transaction_data.funcs.decode = &signTransactionCallback;
@@ -1090,28 +2826,23 @@ void processPacket(void)
 		receiveMessage(SignTransaction_fields, &sign_transaction);
 		break;
 
+	case PACKET_TYPE_SIGN_TRANSACTION_BATCH:
+		// Sign several inputs of a transaction.
+		sign_transaction_batch.transaction_data.funcs.decode = &signTransactionBatchCallback;
+		// Everything else is handled in signTransactionBatchCallback().
+		receiveMessage(SignTransactionBatch_fields, &sign_transaction_batch);
+		break;
+
 	case PACKET_TYPE_LOAD_WALLET:
 		// Load wallet.
+		field_hash_set = false;
+		memset(field_hash, 0, sizeof(field_hash));
+		message_buffer.load_wallet.password.funcs.decode = &hashFieldCallback;
+		message_buffer.load_wallet.password.arg = NULL;
 		receive_failure = receiveMessage(LoadWallet_fields, &(message_buffer.load_wallet));
 		if (!receive_failure)
 		{
-			// Attempt load with no password.
-			wallet_return = initWallet(message_buffer.load_wallet.wallet_number, field_hash, 0);
-			if (wallet_return == WALLET_NOT_THERE)
-			{
-				// Attempt load with password.
-				permission_denied = pinInterjection();
-				if (!permission_denied)
-				{
-					if (!field_hash_set)
-					{
-						fatalError(); // this should never happen
-					}
-					wallet_return = initWallet(message_buffer.load_wallet.wallet_number, field_hash, sizeof(field_hash));
-					translateWalletError(wallet_return);
-				}
-			}
-			else
+			if (!loadWalletWithPin(message_buffer.load_wallet.wallet_number, field_hash_set, &wallet_return))
 			{
 				translateWalletError(wallet_return);
 			}
@@ -1136,8 +2867,13 @@ void processPacket(void)
 					else
 					{
 						wallet_return = sanitiseEverything();
+						if (wallet_return == WALLET_NO_ERROR)
+						{
+							wallet_return = calibrateKeyDerivation();
+						}
 						translateWalletError(wallet_return);
 						uninitWallet(); // force wallet to unload
+						clearApprovedTransactions();
 					}
 				}
 			}
@@ -1193,17 +2929,11 @@ void processPacket(void)
 		receive_failure = receiveMessage(ListWallets_fields, &(message_buffer.list_wallets));
 		if (!receive_failure)
 		{
-			number_of_wallets = getNumberOfWallets();
-			if (number_of_wallets == 0)
-			{
-				wallet_return = walletGetLastError();
-				translateWalletError(wallet_return);
-			}
-			else
-			{
-				message_buffer.wallets.wallet_info.funcs.encode = &listWalletsCallback;
-				sendPacket(PACKET_TYPE_WALLETS, Wallets_fields, &(message_buffer.wallets));
-			}
+			getAndSendWalletList(
+				message_buffer.list_wallets.start_wallet_number,
+				message_buffer.list_wallets.has_number_of_wallets ? message_buffer.list_wallets.number_of_wallets : 0xffffffff,
+				message_buffer.list_wallets.has_changed_since,
+				message_buffer.list_wallets.changed_since);
 		}
 		break;
 
@@ -1212,11 +2942,30 @@ void processPacket(void)
 		receive_failure = receiveMessage(BackupWallet_fields, &(message_buffer.backup_wallet));
 		if (!receive_failure)
 		{
-			permission_denied = buttonInterjection(ASKUSER_BACKUP_WALLET);
-			if (!permission_denied)
+			if (message_buffer.backup_wallet.has_to_host && message_buffer.backup_wallet.to_host)
 			{
-				wallet_return = backupWallet(message_buffer.backup_wallet.is_encrypted, message_buffer.backup_wallet.device);
-				translateWalletError(wallet_return);
+				// Only encrypted backups may leave the device this way.
+				if (!message_buffer.backup_wallet.is_encrypted)
+				{
+					translateWalletError(WALLET_INVALID_OPERATION);
+				}
+				else
+				{
+					permission_denied = buttonInterjection(ASKUSER_BACKUP_WALLET);
+					if (!permission_denied)
+					{
+						sendWalletBackup();
+					}
+				}
+			}
+			else
+			{
+				permission_denied = buttonInterjection(ASKUSER_BACKUP_WALLET);
+				if (!permission_denied)
+				{
+					wallet_return = backupWallet(message_buffer.backup_wallet.is_encrypted, message_buffer.backup_wallet.device);
+					translateWalletError(wallet_return);
+				}
 			}
 		}
 		break;
@@ -1230,7 +2979,11 @@ void processPacket(void)
 		receive_failure = receiveMessage(RestoreWallet_fields, &(message_buffer.restore_wallet));
 		if (!receive_failure)
 		{
-			if (message_buffer.restore_wallet.seed.size != SEED_LENGTH)
+			if ((message_buffer.restore_wallet.seed.size != SEED_LENGTH)
+				|| (message_buffer.restore_wallet.has_wallet_uuid
+				&& (!message_buffer.restore_wallet.has_digest
+				|| (message_buffer.restore_wallet.wallet_uuid.size != UUID_LENGTH)
+				|| (message_buffer.restore_wallet.digest.size != 32))))
 			{
 				writeFailureString(STRINGSET_MISC, MISCSTR_INVALID_PACKET);
 			}
@@ -1239,23 +2992,19 @@ void processPacket(void)
 				permission_denied = buttonInterjection(ASKUSER_RESTORE_WALLET);
 				if (!permission_denied)
 				{
-					if (field_hash_set)
+					if (message_buffer.restore_wallet.has_wallet_uuid)
 					{
-						password_length = sizeof(field_hash);
+						createWallet(
+							&(message_buffer.restore_wallet.new_wallet),
+							true,
+							message_buffer.restore_wallet.seed.bytes,
+							message_buffer.restore_wallet.wallet_uuid.bytes,
+							message_buffer.restore_wallet.digest.bytes);
 					}
 					else
 					{
-						password_length = 0; // no password
+						createWallet(&(message_buffer.restore_wallet.new_wallet), true, message_buffer.restore_wallet.seed.bytes, NULL, NULL);
 					}
-					wallet_return = newWallet(
-						message_buffer.restore_wallet.new_wallet.wallet_number,
-						message_buffer.restore_wallet.new_wallet.wallet_name.bytes,
-						true,
-						message_buffer.restore_wallet.seed.bytes,
-						message_buffer.restore_wallet.new_wallet.is_hidden,
-						field_hash,
-						password_length);
-					translateWalletError(wallet_return);
 				}
 			}
 		}
@@ -1278,47 +3027,156 @@ void processPacket(void)
 		}
 		break;
 
-	case PACKET_TYPE_GET_ENTROPY:
-		// Get an arbitrary number of bytes of entropy.
-		receive_failure = receiveMessage(GetEntropy_fields, &(message_buffer.get_entropy));
+	case PACKET_TYPE_GET_ENTROPY:
+		// Get an arbitrary number of bytes of entropy.
+		receive_failure = receiveMessage(GetEntropy_fields, &(message_buffer.get_entropy));
+		if (!receive_failure)
+		{
+			if (message_buffer.get_entropy.has_bulk && message_buffer.get_entropy.bulk)
+			{
+				getBulkEntropy(message_buffer.get_entropy.number_of_bytes);
+			}
+			else if (message_buffer.get_entropy.has_streamed && message_buffer.get_entropy.streamed)
+			{
+				getStreamedEntropy(message_buffer.get_entropy.number_of_bytes);
+			}
+			else
+			{
+				getBytesOfEntropy(message_buffer.get_entropy.number_of_bytes);
+			}
+		}
+		break;
+
+	case PACKET_TYPE_GET_MASTER_KEY:
+		// Get master public key and chain code.
+		receive_failure = receiveMessage(GetMasterPublicKey_fields, &(message_buffer.get_master_public_key));
+		if (!receive_failure)
+		{
+			permission_denied = buttonInterjection(ASKUSER_GET_MASTER_KEY);
+			if (!permission_denied)
+			{
+				invalid_otp = otpInterjection(ASKUSER_GET_MASTER_KEY);
+				if (!invalid_otp)
+				{
+					wallet_return = getMasterPublicKey(&master_public_key, message_buffer.master_public_key.chain_code.bytes);
+					if (wallet_return == WALLET_NO_ERROR)
+					{
+						message_buffer.master_public_key.chain_code.size = 32;
+						if (sizeof(message_buffer.master_public_key.public_key.bytes) < ECDSA_MAX_SERIALISE_SIZE) // sanity check
+						{
+							fatalError();
+							return;
+						}
+						message_buffer.master_public_key.public_key.size = ecdsaSerialise(message_buffer.master_public_key.public_key.bytes, &master_public_key, true);
+						sendPacket(PACKET_TYPE_MASTER_KEY, MasterPublicKey_fields, &(message_buffer.master_public_key));
+					}
+					else
+					{
+						translateWalletError(wallet_return);
+					}
+				}
+			}
+		}
+		break;
+
+	case PACKET_TYPE_GET_EXTENDED_KEY:
+		// Get BIP32 extended public key. This gives away as much as the
+		// master public key does, so ask the user in the same way.
+		receive_failure = receiveMessage(GetExtendedPublicKey_fields, &(message_buffer.get_extended_public_key));
+		if (!receive_failure)
+		{
+			permission_denied = buttonInterjection(ASKUSER_GET_MASTER_KEY);
+			if (!permission_denied)
+			{
+				invalid_otp = otpInterjection(ASKUSER_GET_MASTER_KEY);
+				if (!invalid_otp)
+				{
+					// The path is copied out because message_buffer is a union.
+					path_length = (unsigned int)message_buffer.get_extended_public_key.path_count;
+					memcpy(path, message_buffer.get_extended_public_key.path, path_length * sizeof(uint32_t));
+					if (sizeof(message_buffer.extended_public_key.xpub.bytes) < BIP32_XPUB_LENGTH) // sanity check
+					{
+						fatalError();
+						return;
+					}
+					wallet_return = getExtendedPublicKey(message_buffer.extended_public_key.xpub.bytes, path, path_length);
+					if (wallet_return == WALLET_NO_ERROR)
+					{
+						message_buffer.extended_public_key.xpub.size = BIP32_XPUB_LENGTH;
+						sendPacket(PACKET_TYPE_EXTENDED_KEY, ExtendedPublicKey_fields, &(message_buffer.extended_public_key));
+					}
+					else
+					{
+						translateWalletError(wallet_return);
+					}
+				}
+			}
+		}
+		break;
+
+#ifdef ENABLE_BENCHMARK
+	case PACKET_TYPE_BENCHMARK:
+		// Time a cryptographic primitive.
+		receive_failure = receiveMessage(Benchmark_fields, &(message_buffer.benchmark));
+		if (!receive_failure)
+		{
+			runAndSendBenchmark(message_buffer.benchmark.primitive, message_buffer.benchmark.iterations);
+		}
+		break;
+#endif // #ifdef ENABLE_BENCHMARK
+
+#ifdef ENABLE_DIAGNOSTICS
+	case PACKET_TYPE_GET_DIAGNOSTICS:
+		// Report request timing statistics.
+		receive_failure = receiveMessage(GetDiagnostics_fields, &(message_buffer.get_diagnostics));
+		if (!receive_failure)
+		{
+			sendDiagnostics();
+		}
+		break;
+#endif // #ifdef ENABLE_DIAGNOSTICS
+
+#ifdef ENABLE_TRACE
+	case PACKET_TYPE_GET_TRACE:
+		// Report the most recent events.
+		receive_failure = receiveMessage(GetTrace_fields, &(message_buffer.get_trace));
+		if (!receive_failure)
+		{
+			sendTrace(message_buffer.get_trace.has_clear && message_buffer.get_trace.clear);
+		}
+		break;
+#endif // #ifdef ENABLE_TRACE
+
+	case PACKET_TYPE_GET_RNG_HEALTH:
+		// Report HWRNG health and throughput statistics.
+		receive_failure = receiveMessage(GetRNGHealth_fields, &(message_buffer.get_rng_health));
 		if (!receive_failure)
 		{
-			getBytesOfEntropy(message_buffer.get_entropy.number_of_bytes);
+			sendRNGHealth();
 		}
 		break;
 
-	case PACKET_TYPE_GET_MASTER_KEY:
-		// Get master public key and chain code.
-		receive_failure = receiveMessage(GetMasterPublicKey_fields, &(message_buffer.get_master_public_key));
+	case PACKET_TYPE_GET_PROGRESS:
+		// The long-running operation this was meant for (if any) has already
+		// finished, so there's nothing in progress.
+		receive_failure = receiveMessage(GetProgress_fields, &(message_buffer.get_progress));
 		if (!receive_failure)
 		{
-			permission_denied = buttonInterjection(ASKUSER_GET_MASTER_KEY);
-			if (!permission_denied)
-			{
-				invalid_otp = otpInterjection(ASKUSER_GET_MASTER_KEY);
-				if (!invalid_otp)
-				{
-					wallet_return = getMasterPublicKey(&master_public_key, message_buffer.master_public_key.chain_code.bytes);
-					if (wallet_return == WALLET_NO_ERROR)
-					{
-						message_buffer.master_public_key.chain_code.size = 32;
-						if (sizeof(message_buffer.master_public_key.public_key.bytes) < ECDSA_MAX_SERIALISE_SIZE) // sanity check
-						{
-							fatalError();
-							return;
-						}
-						message_buffer.master_public_key.public_key.size = ecdsaSerialise(message_buffer.master_public_key.public_key.bytes, &master_public_key, true);
-						sendPacket(PACKET_TYPE_MASTER_KEY, MasterPublicKey_fields, &(message_buffer.master_public_key));
-					}
-					else
-					{
-						translateWalletError(wallet_return);
-					}
-				}
-			}
+			sendProgress();
 		}
 		break;
 
+	case PACKET_TYPE_CANCEL_OPERATION:
+		// Likewise, there's nothing to cancel. CancelOperation never gets a
+		// response.
+		receiveMessage(CancelOperation_fields, &(message_buffer.cancel_operation));
+		break;
+
+	case PACKET_TYPE_OVERSIZED:
+		// The payload has already been thrown away by receivePacketHeader().
+		writeFailureString(STRINGSET_MISC, MISCSTR_PARAM_TOO_LARGE);
+		break;
+
 	default:
 		// Unknown message ID.
 		readAndIgnoreInput();
@@ -1326,6 +3184,9 @@ void processPacket(void)
 		break;
 
 	}
+	processing_packet = false;
+	traceEvent(TRACE_PACKET_END, message_id);
+	diagnosticsEndPacket(message_id);
 }
 
 #ifdef TEST
@@ -1390,6 +3251,21 @@ uint8_t streamGetOneByte(void)
 	}
 }
 
+/** Check whether there are any bytes left in the test stream.
+  * \return true if streamGetOneByte() would succeed, false otherwise.
+  */
+bool streamIsByteAvailable(void)
+{
+	if (is_infinite_zero_stream)
+	{
+		return true;
+	}
+	else
+	{
+		return (stream != NULL) && (stream_ptr < stream_length);
+	}
+}
+
 /** Simulate the sending of a byte by displaying its value.
   * \param one_byte The byte to send.
   */
@@ -1398,6 +3274,59 @@ void streamPutOneByte(uint8_t one_byte)
 	printf(" %02x", (int)one_byte);
 }
 
+/** Get bytes from the contents of the buffer set by setTestInputStream().
+  * \param buffer The bytes will be written here. This must have space for
+  *               length bytes.
+  * \param length The number of bytes to get.
+  */
+void streamGetBytes(uint8_t *buffer, uint32_t length)
+{
+	uint32_t i;
+
+	for (i = 0; i < length; i++)
+	{
+		buffer[i] = streamGetOneByte();
+	}
+}
+
+/** Skip bytes in the contents of the buffer set by setTestInputStream().
+  * Like streamGetOneByte(), this complains about reading past the end of
+  * the stream.
+  * \param length The number of bytes to skip.
+  */
+void streamDiscardBytes(uint32_t length)
+{
+	if (is_infinite_zero_stream)
+	{
+		return;
+	}
+	if (stream == NULL)
+	{
+		printf("ERROR: Tried to read a stream whose contents weren't set.\n");
+		exit(1);
+	}
+	if (length > (stream_length - stream_ptr))
+	{
+		printf("ERROR: Tried to read past end of stream\n");
+		exit(1);
+	}
+	stream_ptr += length;
+}
+
+/** Simulate the sending of bytes by displaying their values.
+  * \param buffer The bytes to send.
+  * \param length The number of bytes to send.
+  */
+void streamPutBytes(const uint8_t *buffer, uint32_t length)
+{
+	uint32_t i;
+
+	for (i = 0; i < length; i++)
+	{
+		streamPutOneByte(buffer[i]);
+	}
+}
+
 /** Helper for getString().
   * \param set See getString().
   * \param spec See getString().
@@ -1463,7 +3392,7 @@ static const char *getStringInternal(StringSet set, uint8_t spec)
 			return "Invalid address handle";
 			break;
 		case WALLET_BACKUP_ERROR:
-			return "Seed could not be written to specified device";
+			return "Seed could not be written to specified device, or backup is corrupt";
 			break;
 		case WALLET_RNG_FAILURE:
 			return "Failure in random number generation system";
@@ -1480,6 +3409,9 @@ static const char *getStringInternal(StringSet set, uint8_t spec)
 		case WALLET_BAD_ADDRESS:
 			return "Bad non-volatile address or partition number";
 			break;
+		case WALLET_CANCELLED:
+			return "Operation cancelled by host";
+			break;
 		default:
 			assert(0);
 		}
@@ -1509,6 +3441,9 @@ static const char *getStringInternal(StringSet set, uint8_t spec)
 		case TRANSACTION_INVALID_REFERENCE:
 			return "Invalid transaction reference";
 			break;
+		case TRANSACTION_PREVOUT_NOT_CACHED:
+			return "Input transaction not cached";
+			break;
 		default:
 			assert(0);
 		}
@@ -1538,6 +3473,25 @@ uint16_t getStringLength(StringSet set, uint8_t spec)
 	return (uint16_t)strlen(getStringInternal(set, spec));
 }
 
+/** Get one of the device's strings.
+  * \param set Specifies which set of strings to use; should be
+  *            one of #StringSetEnum.
+  * \param spec Specifies which string to get. The interpretation of this
+  *             depends on the value of set; see #StringSetEnum for
+  *             clarification.
+  * \param out_length The length of the string, in number of characters, will
+  *                   be written here.
+  * \return A pointer to the first character of the string.
+  */
+const char *getStringSpan(StringSet set, uint8_t spec, uint16_t *out_length)
+{
+	const char *str;
+
+	str = getStringInternal(set, spec);
+	*out_length = (uint16_t)strlen(str);
+	return str;
+}
+
 /** Obtain one character from one of the device's strings.
   * \param set Specifies which set of strings to use; should be
   *            one of #StringSetEnum.
@@ -1592,6 +3546,9 @@ static void printAction(AskUserCommand command)
 	case ASKUSER_DELETE_WALLET:
 		printf("Delete existing wallet? ");
 		break;
+	case ASKUSER_KEEP_UNLOCKED:
+		printf("Keep wallet unlocked across sessions? ");
+		break;
 	default:
 		fatalError();
 	}
@@ -1691,6 +3648,62 @@ static const uint8_t test_stream_get_address0[] = {
 0x23, 0x23, 0x00, 0x09, 0x00, 0x00, 0x00, 0x02,
 0x08, 0x00};
 
+/** Test stream data for: get addresses 1 to 4. */
+static const uint8_t test_stream_get_address_range[] = {
+0x23, 0x23, 0x00, 0x18, 0x00, 0x00, 0x00, 0x04,
+0x08, 0x01, 0x10, 0x04};
+
+/** Test stream data for: get addresses 3 to 5 (which goes past the last
+  * address). */
+static const uint8_t test_stream_get_address_range_past_end[] = {
+0x23, 0x23, 0x00, 0x18, 0x00, 0x00, 0x00, 0x04,
+0x08, 0x03, 0x10, 0x03};
+
+/** Test stream data for: get 100 addresses starting at 1 (which is too
+  * many addresses for one packet). */
+static const uint8_t test_stream_get_address_range_too_many[] = {
+0x23, 0x23, 0x00, 0x18, 0x00, 0x00, 0x00, 0x04,
+0x08, 0x01, 0x10, 0x64};
+
+/** Test stream data for: get addresses 1 to 4, without the addresses (only
+  * the public keys). */
+static const uint8_t test_stream_get_address_range_omit[] = {
+0x23, 0x23, 0x00, 0x18, 0x00, 0x00, 0x00, 0x06,
+0x08, 0x01, 0x10, 0x04, 0x18, 0x01};
+
+#ifdef ENABLE_BENCHMARK
+/** Test stream data for: time 3 SHA-256 blocks. */
+static const uint8_t test_stream_benchmark_sha256[] = {
+0x23, 0x23, 0x00, 0x19, 0x00, 0x00, 0x00, 0x04,
+0x08, 0x05, 0x10, 0x03};
+
+/** Test stream data for: time an invalid primitive. */
+static const uint8_t test_stream_benchmark_invalid[] = {
+0x23, 0x23, 0x00, 0x19, 0x00, 0x00, 0x00, 0x04,
+0x08, 0x7f, 0x10, 0x01};
+#endif // #ifdef ENABLE_BENCHMARK
+
+#ifdef ENABLE_DIAGNOSTICS
+/** Test stream data for: get request timing statistics. */
+static const uint8_t test_stream_get_diagnostics[] = {
+0x23, 0x23, 0x00, 0x1e, 0x00, 0x00, 0x00, 0x00};
+#endif // #ifdef ENABLE_DIAGNOSTICS
+
+#ifdef ENABLE_TRACE
+/** Test stream data for: get event trace and clear it afterwards. */
+static const uint8_t test_stream_get_trace_clear[] = {
+0x23, 0x23, 0x00, 0x20, 0x00, 0x00, 0x00, 0x02,
+0x08, 0x01};
+
+/** Test stream data for: get event trace. */
+static const uint8_t test_stream_get_trace[] = {
+0x23, 0x23, 0x00, 0x20, 0x00, 0x00, 0x00, 0x00};
+#endif // #ifdef ENABLE_TRACE
+
+/** Test stream data for: get HWRNG health statistics. */
+static const uint8_t test_stream_get_rng_health[] = {
+0x23, 0x23, 0x00, 0x1f, 0x00, 0x00, 0x00, 0x00};
+
 /** Test stream data for: sign something and allow button press. */
 static uint8_t test_stream_sign_tx[] = {
 0x23, 0x23, 0x00, 0x0a, 0x00, 0x00, 0x01, 0xa0,
@@ -1801,6 +3814,30 @@ static const uint8_t test_stream_format[] = {
 0x23, 0x23, 0x00, 0x57, 0x00, 0x00, 0x00, 0x06,
 0x0a, 0x04, 0x31, 0x32, 0x33, 0x34};
 
+/** Test stream data for: format storage, but ask for progress and then
+  * cancel while the device is busy. This relies on the test stream being
+  * entirely available as soon as the format starts. */
+static const uint8_t test_stream_format_cancel[] = {
+0x23, 0x23, 0x00, 0x0d, 0x00, 0x00, 0x00, 0x22,
+0x0a, 0x20,
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+
+0x23, 0x23, 0x00, 0x51, 0x00, 0x00, 0x00, 0x00,
+
+0x23, 0x23, 0x00, 0x57, 0x00, 0x00, 0x00, 0x06,
+0x0a, 0x04, 0x31, 0x32, 0x33, 0x34,
+
+0x23, 0x23, 0x00, 0x1c, 0x00, 0x00, 0x00, 0x00,
+
+0x23, 0x23, 0x00, 0x1d, 0x00, 0x00, 0x00, 0x00};
+
+/** Test stream data for: get progress when the device isn't busy. */
+static const uint8_t test_stream_get_progress[] = {
+0x23, 0x23, 0x00, 0x1c, 0x00, 0x00, 0x00, 0x00};
+
 /** Test stream data for: load wallet using correct key. */
 static const uint8_t test_stream_load_correct[] = {
 0x23, 0x23, 0x00, 0x0b, 0x00, 0x00, 0x00, 0x02,
@@ -1817,6 +3854,30 @@ static const uint8_t test_stream_load_correct[] = {
 0x00, 0x11, 0x00, 0x00, 0x00, 0x00, 0x45, 0x00,
 0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46};
 
+/** Test stream data for: get a snapshot of wallet 0, including the 2 most
+  * recent addresses, and send the correct key. The master public key isn't
+  * included, since any ButtonAck here would be read (and rejected) while the
+  * key is being derived. */
+static const uint8_t test_stream_get_wallet_snapshot[] = {
+0x23, 0x23, 0x00, 0x21, 0x00, 0x00, 0x00, 0x08,
+0x0a, 0x04, 0x61, 0x62, 0x63, 0x64, 0x30, 0x02,
+
+0x23, 0x23, 0x00, 0x54, 0x00, 0x00, 0x00, 0x42,
+0x0a, 0x40,
+0x42, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff,
+0x00, 0x42, 0x00, 0x00, 0x00, 0x00, 0xfe, 0x00,
+0x00, 0x00, 0x42, 0x00, 0x00, 0xfd, 0x00, 0x00,
+0x00, 0x00, 0x00, 0x42, 0xfc, 0x00, 0x00, 0x00,
+0x00, 0x00, 0x00, 0xee, 0x43, 0x00, 0x00, 0x00,
+0x00, 0x00, 0x10, 0x00, 0x00, 0x44, 0x00, 0x00,
+0x00, 0x11, 0x00, 0x00, 0x00, 0x00, 0x45, 0x00,
+0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46};
+
+/** Test stream data for: get a snapshot with too many recent addresses. */
+static const uint8_t test_stream_get_wallet_snapshot_too_many[] = {
+0x23, 0x23, 0x00, 0x21, 0x00, 0x00, 0x00, 0x08,
+0x0a, 0x04, 0x61, 0x62, 0x63, 0x64, 0x30, 0x64};
+
 /** Test stream data for: load wallet using incorrect key. */
 static const uint8_t test_stream_load_incorrect[] = {
 0x23, 0x23, 0x00, 0x0b, 0x00, 0x00, 0x00, 0x02,
@@ -1859,10 +3920,52 @@ static const uint8_t test_stream_load_with_changed_key[] = {
 0xff, 0xfe, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
 
+/** Test stream data for: initialise and say that every ButtonRequest would
+  * be answered with ButtonAck. */
+static const uint8_t test_stream_init_implicit_ack[] = {
+0x23, 0x23, 0x00, 0x17, 0x00, 0x00, 0x00, 0x06, 0x0a, 0x02, 0x61, 0x62,
+0x20, 0x01};
+
+/** Test stream data for: load wallet with the changed key included in the
+  * request, so that there's no PinRequest. */
+static const uint8_t test_stream_load_inline_key[] = {
+0x23, 0x23, 0x00, 0x0b, 0x00, 0x00, 0x00, 0x24,
+0x08, 0x00,
+0x12, 0x20,
+0xff, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+0xff, 0xfe, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+
+/** Test stream data for: get master public key without a ButtonAck, since
+  * the host said it would always send one. The OTP is still needed. */
+static const uint8_t test_get_master_public_key_implicit_ack[] = {
+0x23, 0x23, 0x00, 0x15, 0x00, 0x00, 0x00, 0x00,
+
+0x23, 0x23, 0x00, 0x57, 0x00, 0x00, 0x00, 0x06,
+0x0a, 0x04, 0x31, 0x32, 0x33, 0x34};
+
 /** Test stream data for: list wallets. */
 static const uint8_t test_stream_list_wallets[] = {
 0x23, 0x23, 0x00, 0x10, 0x00, 0x00, 0x00, 0x00};
 
+/** Test stream data for: list wallets, unless the list hasn't changed since
+  * generation 6. */
+static const uint8_t test_stream_list_wallets_unchanged[] = {
+0x23, 0x23, 0x00, 0x10, 0x00, 0x00, 0x00, 0x02,
+0x18, 0x06};
+
+/** Test stream data for: list only wallet 0. */
+static const uint8_t test_stream_list_wallets_first[] = {
+0x23, 0x23, 0x00, 0x10, 0x00, 0x00, 0x00, 0x02,
+0x10, 0x01};
+
+/** Test stream data for: list wallets starting at wallet 127 (which is past
+  * the last wallet). */
+static const uint8_t test_stream_list_wallets_past_end[] = {
+0x23, 0x23, 0x00, 0x10, 0x00, 0x00, 0x00, 0x02,
+0x08, 0x7f};
+
 /** Test stream data for: change wallet name and allow button press. */
 static const uint8_t test_stream_change_name[] = {
 0x23, 0x23, 0x00, 0x0f, 0x00, 0x00, 0x00, 0x0c,
@@ -1878,6 +3981,20 @@ static const uint8_t test_stream_backup_wallet[] = {
 
 0x23, 0x23, 0x00, 0x51, 0x00, 0x00, 0x00, 0x00};
 
+/** Test stream data for: send encrypted backup to host and allow button
+  * press. */
+static const uint8_t test_stream_backup_wallet_to_host[] = {
+0x23, 0x23, 0x00, 0x11, 0x00, 0x00, 0x00, 0x04,
+0x08, 0x01, // encrypted
+0x18, 0x01, // to host
+
+0x23, 0x23, 0x00, 0x51, 0x00, 0x00, 0x00, 0x00};
+
+/** Test stream data for: send unencrypted backup to host (should fail). */
+static const uint8_t test_stream_backup_wallet_to_host_unencrypted[] = {
+0x23, 0x23, 0x00, 0x11, 0x00, 0x00, 0x00, 0x02,
+0x18, 0x01}; // to host
+
 /** Test stream data for: delete wallet and allow button press. */
 static const uint8_t test_stream_delete[] = {
 0x23, 0x23, 0x00, 0x16, 0x00, 0x00, 0x00, 0x02,
@@ -1914,10 +4031,58 @@ static const uint8_t test_stream_restore_wallet[] = {
 
 0x23, 0x23, 0x00, 0x51, 0x00, 0x00, 0x00, 0x00};
 
+/** Test stream data for: restore encrypted backup with wrong digest (should
+  * fail). */
+static const uint8_t test_stream_restore_backup_bad_digest[] = {
+0x23, 0x23, 0x00, 0x12, 0x00, 0x00, 0x00, 0xae,
+0x0a, 0x36,
+0x08, 0x00, // wallet number
+0x12, 0x20,
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // encryption key
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+0x1a, 0x0e,
+0x65, 0x65, 0x65, 0x65, 0x65, 0x65, 0x65, 0x20, // name
+0x66, 0x66, 0x20, 0x20, 0x20, 0x6F,
+0x20, 0x00, // make hidden?
+0x12, 0x40,
+0x12, 0x34, 0x56, 0x78, 0x9a, 0xbc, 0xde, 0xf0, // seed
+0x12, 0x34, 0x56, 0x78, 0x9a, 0xbc, 0xde, 0xf0,
+0x12, 0x34, 0x56, 0x00, 0x9a, 0xbc, 0xde, 0xf0,
+0x12, 0x34, 0x56, 0x78, 0x9a, 0xbc, 0xde, 0xf0,
+0x12, 0x34, 0x56, 0x78, 0x9a, 0xbc, 0xde, 0xf0,
+0xea, 0x11, 0x44, 0xf0, 0x0f, 0xb0, 0x0b, 0x50,
+0x12, 0x34, 0x56, 0x78, 0x9a, 0xbc, 0xde, 0xf0,
+0x12, 0x34, 0xde, 0xad, 0xfe, 0xed, 0xde, 0xf0,
+0x1a, 0x10,
+0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef, // wallet UUID
+0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef,
+0x22, 0x20,
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // digest
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+
+0x23, 0x23, 0x00, 0x51, 0x00, 0x00, 0x00, 0x00};
+
 /** Test stream data for: get device UUID. */
 static const uint8_t test_stream_get_device_uuid[] = {
 0x23, 0x23, 0x00, 0x13, 0x00, 0x00, 0x00, 0x00};
 
+/** Test stream data for: initialise and ask to use tagged packets. */
+static const uint8_t test_stream_init_tagged[] = {
+0x23, 0x23, 0x00, 0x17, 0x00, 0x00, 0x00, 0x06, 0x0a, 0x02, 0x61, 0x62,
+0x10, 0x01};
+
+/** Test stream data for: pipelined ping (tag 0x0102), get device UUID (tag
+  * 0x0103) and ping (tag 0xfffe), all sent before any response. */
+static const uint8_t test_stream_pipelined[] = {
+0x23, 0x54, 0x00, 0x00, 0x00, 0x00, 0x00, 0x05, 0x01, 0x02,
+0x0a, 0x03, 0x4d, 0x6f, 0x6f,
+0x23, 0x54, 0x00, 0x13, 0x00, 0x00, 0x00, 0x00, 0x01, 0x03,
+0x23, 0x54, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0xfe};
+
 /** Test stream data for: get 0 bytes of entropy. */
 static const uint8_t test_stream_get_entropy0[] = {
 0x23, 0x23, 0x00, 0x14, 0x00, 0x00, 0x00, 0x02, 0x08, 0x00};
@@ -1934,6 +4099,23 @@ static const uint8_t test_stream_get_entropy32[] = {
 static const uint8_t test_stream_get_entropy100[] = {
 0x23, 0x23, 0x00, 0x14, 0x00, 0x00, 0x00, 0x02, 0x08, 0x64};
 
+/** Test stream data for: get 5000 bytes of entropy in bulk mode. This is
+  * enough to cause a reseed. */
+static const uint8_t test_stream_get_entropy5000_bulk[] = {
+0x23, 0x23, 0x00, 0x14, 0x00, 0x00, 0x00, 0x05, 0x08, 0x88, 0x27, 0x10,
+0x01};
+
+/** Test stream data for: get 300 bytes of entropy in streamed mode. This
+  * should produce three chunks and an end of stream packet. */
+static const uint8_t test_stream_get_entropy300_streamed[] = {
+0x23, 0x23, 0x00, 0x14, 0x00, 0x00, 0x00, 0x05, 0x08, 0xac, 0x02, 0x18,
+0x01};
+
+/** Test stream data for: get 0 bytes of entropy in streamed mode. This
+  * should produce only an end of stream packet. */
+static const uint8_t test_stream_get_entropy0_streamed[] = {
+0x23, 0x23, 0x00, 0x14, 0x00, 0x00, 0x00, 0x04, 0x08, 0x00, 0x18, 0x01};
+
 /** Ping (get version). */
 static const uint8_t test_stream_ping[] = {
 0x23, 0x23, 0x00, 0x00, 0x00, 0x00, 0x00, 0x05, 0x0a, 0x03, 0x4d, 0x6f, 0x6f};
@@ -1953,6 +4135,65 @@ static const uint8_t test_get_master_public_key_no_press[] = {
 
 0x23, 0x23, 0x00, 0x52, 0x00, 0x00, 0x00, 0x00};
 
+/** Get extended public key of m/44'/0'/0' and allow button press. */
+static const uint8_t test_get_extended_public_key[] = {
+0x23, 0x23, 0x00, 0x1b, 0x00, 0x00, 0x00, 0x12,
+0x08, 0xac, 0x80, 0x80, 0x80, 0x08,
+0x08, 0x80, 0x80, 0x80, 0x80, 0x08,
+0x08, 0x80, 0x80, 0x80, 0x80, 0x08,
+
+0x23, 0x23, 0x00, 0x51, 0x00, 0x00, 0x00, 0x00,
+
+0x23, 0x23, 0x00, 0x57, 0x00, 0x00, 0x00, 0x06,
+0x0a, 0x04, 0x31, 0x32, 0x33, 0x34};
+
+/** Get extended public key of the master node and allow button press. */
+static const uint8_t test_get_extended_public_key_master[] = {
+0x23, 0x23, 0x00, 0x1b, 0x00, 0x00, 0x00, 0x00,
+
+0x23, 0x23, 0x00, 0x51, 0x00, 0x00, 0x00, 0x00,
+
+0x23, 0x23, 0x00, 0x57, 0x00, 0x00, 0x00, 0x06,
+0x0a, 0x04, 0x31, 0x32, 0x33, 0x34};
+
+/** Get extended public key of m/0 but don't allow button press. */
+static const uint8_t test_get_extended_public_key_no_press[] = {
+0x23, 0x23, 0x00, 0x1b, 0x00, 0x00, 0x00, 0x02,
+0x08, 0x00,
+
+0x23, 0x23, 0x00, 0x52, 0x00, 0x00, 0x00, 0x00};
+
+/** Start of test stream data for: sign the transaction in
+  * #test_stream_sign_tx using a batch with one input. The rest of the stream
+  * is copied from #test_stream_sign_tx by sendSignBatchTestStream(). */
+static const uint8_t test_stream_sign_tx_batch_prefix[] = {
+0x23, 0x23, 0x00, 0x1a, 0x00, 0x00, 0x01, 0xa2,
+0x08, 0x01, 0x10, 0x00, 0x22};
+
+/** Like #test_stream_sign_tx_batch_prefix, but using BIP 143 signature
+  * hashes. */
+static const uint8_t test_stream_sign_tx_batch_bip143_prefix[] = {
+0x23, 0x23, 0x00, 0x1a, 0x00, 0x00, 0x01, 0xa4,
+0x08, 0x01, 0x10, 0x00, 0x18, 0x01, 0x22};
+
+/** Like #test_stream_sign_tx_batch_prefix, but the same input is signed
+  * using two keys (address handles 1 and 2). */
+static const uint8_t test_stream_sign_tx_batch_cosign_prefix[] = {
+0x23, 0x23, 0x00, 0x1a, 0x00, 0x00, 0x01, 0xa6,
+0x08, 0x01, 0x08, 0x02, 0x10, 0x00, 0x10, 0x00, 0x22};
+
+/** Like #test_stream_sign_tx_batch_prefix, but the same input and address
+  * handle are listed twice. */
+static const uint8_t test_stream_sign_tx_batch_duplicate_prefix[] = {
+0x23, 0x23, 0x00, 0x1a, 0x00, 0x00, 0x01, 0xa6,
+0x08, 0x01, 0x08, 0x01, 0x10, 0x00, 0x10, 0x00, 0x22};
+
+/** Like #test_stream_sign_tx_batch_prefix, but there are more address
+  * handles than input indices. */
+static const uint8_t test_stream_sign_tx_batch_mismatch_prefix[] = {
+0x23, 0x23, 0x00, 0x1a, 0x00, 0x00, 0x01, 0xa4,
+0x08, 0x01, 0x08, 0x02, 0x10, 0x00, 0x22};
+
 /** Test stream data for: load but don't allow password to be sent. */
 static const uint8_t test_stream_load_no_key[] = {
 0x23, 0x23, 0x00, 0x0b, 0x00, 0x00, 0x00, 0x02,
@@ -1975,6 +4216,227 @@ static void sendOneTestStream(const uint8_t *test_stream, uint32_t size)
   * case (use of a constant byte array). */
 #define SEND_ONE_TEST_STREAM(x)	sendOneTestStream(x, (uint32_t)sizeof(x));
 
+/** Test response of processPacket() for a SignTransactionBatch test stream.
+  * The test stream consists of prefix followed by the transaction data (and
+  * everything after it) of #test_stream_sign_tx.
+  * \param prefix Packet header and message fields up to and including the
+  *               tag of the transaction_data field.
+  * \param prefix_size The length of prefix, in bytes.
+  */
+static void sendSignBatchTestStream(const uint8_t *prefix, uint32_t prefix_size)
+{
+	uint8_t *buffer;
+	uint32_t size;
+
+	// Copy from the length of the transaction_data field of
+	// #test_stream_sign_tx.
+	size = prefix_size + (uint32_t)sizeof(test_stream_sign_tx) - 11;
+	buffer = malloc(size);
+	memcpy(buffer, prefix, prefix_size);
+	memcpy(&(buffer[prefix_size]), &(test_stream_sign_tx[11]), sizeof(test_stream_sign_tx) - 11);
+	sendOneTestStream(buffer, size);
+	free(buffer);
+}
+
+/** Test response of processPacket() for a SignTransaction packet whose
+  * payload is one byte longer than #MAX_PAYLOAD_LENGTH. The payload is all
+  * zeroes; it should be thrown away without being parsed. */
+static void sendOversizedTestStream(void)
+{
+	uint8_t *buffer;
+	uint32_t size;
+
+	size = 8 + MAX_PAYLOAD_LENGTH + 1;
+	buffer = calloc(size, 1);
+	buffer[0] = '#';
+	buffer[1] = '#';
+	buffer[2] = 0x00;
+	buffer[3] = PACKET_TYPE_SIGN_TRANSACTION;
+	writeU32BigEndian(&(buffer[4]), MAX_PAYLOAD_LENGTH + 1);
+	sendOneTestStream(buffer, size);
+	if (streamIsByteAvailable())
+	{
+		printf("Oversized payload wasn't completely discarded\n");
+		reportFailure();
+	}
+	else
+	{
+		reportSuccess();
+	}
+	free(buffer);
+}
+
+/** Test response of processPacket() for a RestoreWallet packet containing a
+  * genuine backup of the currently loaded wallet (see exportWalletBackup()),
+  * restored into wallet 1 using the wrong password. This should fail
+  * without creating a wallet. The packet is
+  * #test_stream_restore_backup_bad_digest, with the backup and a different
+  * password and wallet number patched in.
+  */
+static void sendRestoreBackupWrongPasswordTestStream(void)
+{
+	uint8_t buffer[sizeof(test_stream_restore_backup_bad_digest)];
+	uint32_t version;
+	uint8_t name[NAME_LENGTH];
+	uint8_t uuid[UUID_LENGTH];
+
+	memcpy(buffer, test_stream_restore_backup_bad_digest, sizeof(buffer));
+	if (exportWalletBackup(&(buffer[132]), &(buffer[66]), &(buffer[150])) != WALLET_NO_ERROR)
+	{
+		printf("Couldn't export backup\n");
+		reportFailure();
+		return;
+	}
+	buffer[11] = 1; // wallet number
+	buffer[14] ^= 1; // password
+	sendOneTestStream(buffer, (uint32_t)sizeof(buffer));
+	if ((getWalletInfo(&version, name, uuid, 1) == WALLET_NO_ERROR) && (version == VERSION_NOTHING_THERE))
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("Restoring a backup with the wrong password created a wallet\n");
+		reportFailure();
+	}
+}
+
+#if STREAM_STAGING_SIZE > 0
+/** Check that a message's specialised encoder (see messages_fast.h)
+  * produces the same bytes as pb_encode().
+  * \param fields Field description array of the message.
+  * \param src_struct Field data which will be encoded.
+  */
+static void checkFastEncode(const pb_field_t fields[], const void *src_struct)
+{
+	uint8_t fast_buffer[FAST_ENCODE_MAX_SIZE];
+	uint8_t nanopb_buffer[FAST_ENCODE_MAX_SIZE];
+	size_t fast_length;
+	pb_ostream_t stream;
+
+	stream = pb_ostream_from_buffer(nanopb_buffer, sizeof(nanopb_buffer));
+	if (!canFastEncode(fields)
+		|| fastEncode(fields, src_struct, fast_buffer, &fast_length)
+		|| !pb_encode(&stream, fields, src_struct)
+		|| (fast_length != stream.bytes_written)
+		|| memcmp(fast_buffer, nanopb_buffer, fast_length))
+	{
+		printf("Specialised encoder doesn't match nanopb\n");
+		reportFailure();
+	}
+	else
+	{
+		reportSuccess();
+	}
+}
+
+/** Check that a message's specialised decoder (see messages_fast.h)
+  * accepts and rejects the same encoded messages as pb_decode(), and
+  * decodes the accepted ones the same way. Every prefix of the encoded
+  * message is tried, so that truncated messages are tested too.
+  * \param fields Field description array of the message.
+  * \param buffer The encoded message.
+  * \param length The length of the encoded message, in bytes.
+  * \param message_size The size of the message's structure, in bytes.
+  */
+static void checkFastDecode(const pb_field_t fields[], const uint8_t *buffer, size_t length, size_t message_size)
+{
+	uint8_t fast_message[128];
+	uint8_t nanopb_message[128];
+	size_t i;
+	bool fast_error;
+	bool nanopb_error;
+	pb_istream_t stream;
+
+	if (!canFastDecode(fields) || (message_size > sizeof(fast_message)))
+	{
+		printf("Message can't be tested\n");
+		reportFailure();
+		return;
+	}
+	for (i = 0; i <= length; i++)
+	{
+		memset(fast_message, 0, sizeof(fast_message));
+		memset(nanopb_message, 0, sizeof(nanopb_message));
+		fast_error = fastDecode(fields, buffer, i, fast_message);
+		stream = pb_istream_from_buffer((uint8_t *)buffer, i);
+		nanopb_error = !pb_decode(&stream, fields, nanopb_message);
+		if ((fast_error != nanopb_error)
+			|| (!fast_error && memcmp(fast_message, nanopb_message, message_size)))
+		{
+			printf("Specialised decoder doesn't match nanopb for %u of %u bytes\n", (unsigned int)i, (unsigned int)length);
+			reportFailure();
+		}
+		else
+		{
+			reportSuccess();
+		}
+	}
+}
+
+/** Test the specialised encoders and decoders in messages_fast.h against
+  * nanopb, using random messages. */
+static void testFastCodecs(void)
+{
+	int i;
+	uint32_t value;
+	Address address;
+	Signature signature;
+	NumberOfAddresses number_of_addresses;
+	GetAddressAndPublicKey get_address;
+	uint8_t buffer[32];
+	pb_ostream_t stream;
+
+	for (i = 0; i < 1000; i++)
+	{
+		// The shift ensures that varints of every length are tested.
+		fillWithRandom((uint8_t *)&value, sizeof(value));
+		value >>= (i % 32);
+
+		memset(&address, 0, sizeof(address));
+		address.address_handle = value;
+		address.public_key.size = (size_t)i % (sizeof(address.public_key.bytes) + 1);
+		fillWithRandom(address.public_key.bytes, (unsigned int)address.public_key.size);
+		address.has_address = ((i & 1) != 0);
+		address.address.size = sizeof(address.address.bytes);
+		fillWithRandom(address.address.bytes, (unsigned int)address.address.size);
+		checkFastEncode(Address_fields, &address);
+
+		memset(&signature, 0, sizeof(signature));
+		signature.signature_data.size = (size_t)i % (sizeof(signature.signature_data.bytes) + 1);
+		fillWithRandom(signature.signature_data.bytes, (unsigned int)signature.signature_data.size);
+		checkFastEncode(Signature_fields, &signature);
+
+		memset(&number_of_addresses, 0, sizeof(number_of_addresses));
+		number_of_addresses.number_of_addresses = value;
+		checkFastEncode(NumberOfAddresses_fields, &number_of_addresses);
+
+		// Decoders must skip unknown fields, so add some to half of the
+		// messages. Empty messages are tested with the same encoding,
+		// where every field is unknown.
+		memset(&get_address, 0, sizeof(get_address));
+		get_address.address_handle = value;
+		stream = pb_ostream_from_buffer(buffer, sizeof(buffer));
+		pb_encode(&stream, GetAddressAndPublicKey_fields, &get_address);
+		if ((i & 1) != 0)
+		{
+			buffer[stream.bytes_written++] = 0x28; // field 5, varint
+			buffer[stream.bytes_written++] = 0x81;
+			buffer[stream.bytes_written++] = 0x01;
+			buffer[stream.bytes_written++] = 0x32; // field 6, length-delimited
+			buffer[stream.bytes_written++] = 0x02;
+			buffer[stream.bytes_written++] = 0xaa;
+			buffer[stream.bytes_written++] = 0xbb;
+			buffer[stream.bytes_written++] = 0x3d; // field 7, 32 bit
+			fillWithRandom(&(buffer[stream.bytes_written]), 4);
+			stream.bytes_written += 4;
+		}
+		checkFastDecode(GetAddressAndPublicKey_fields, buffer, stream.bytes_written, sizeof(GetAddressAndPublicKey));
+		checkFastDecode(ButtonAck_fields, buffer, stream.bytes_written, sizeof(ButtonAck));
+	}
+}
+#endif // #if STREAM_STAGING_SIZE > 0
+
 int main(void)
 {
 	int i;
@@ -1986,6 +4448,10 @@ int main(void)
 
 	printf("Initialising...\n");
 	SEND_ONE_TEST_STREAM(test_stream_init);
+	printf("Formatting, but asking for progress then cancelling (expect Progress then Failure)...\n");
+	SEND_ONE_TEST_STREAM(test_stream_format_cancel);
+	printf("Getting progress while idle (expect operation 0)...\n");
+	SEND_ONE_TEST_STREAM(test_stream_get_progress);
 	printf("Formatting...\n");
 	SEND_ONE_TEST_STREAM(test_stream_format);
 	printf("Listing wallets...\n");
@@ -2005,16 +4471,46 @@ int main(void)
 	SEND_ONE_TEST_STREAM(test_stream_get_address1);
 	printf("Getting address 0...\n");
 	SEND_ONE_TEST_STREAM(test_stream_get_address0);
+	printf("Getting addresses 1 to 4...\n");
+	SEND_ONE_TEST_STREAM(test_stream_get_address_range);
+	printf("Getting addresses 3 to 5...\n");
+	SEND_ONE_TEST_STREAM(test_stream_get_address_range_past_end);
+	printf("Getting 100 addresses...\n");
+	SEND_ONE_TEST_STREAM(test_stream_get_address_range_too_many);
+	printf("Getting addresses 1 to 4 without addresses...\n");
+	SEND_ONE_TEST_STREAM(test_stream_get_address_range_omit);
+	printf("Getting wallet snapshot with 2 recent addresses...\n");
+	SEND_ONE_TEST_STREAM(test_stream_get_wallet_snapshot);
+	printf("Getting wallet snapshot with 100 recent addresses...\n");
+	SEND_ONE_TEST_STREAM(test_stream_get_wallet_snapshot_too_many);
 	printf("Signing transaction...\n");
 	SEND_ONE_TEST_STREAM(test_stream_sign_tx);
 	printf("Signing transaction again...\n");
 	SEND_ONE_TEST_STREAM(test_stream_sign_tx);
+	printf("Signing transaction using a batch...\n");
+	sendSignBatchTestStream(test_stream_sign_tx_batch_prefix, (uint32_t)sizeof(test_stream_sign_tx_batch_prefix));
+	printf("Signing transaction using a BIP 143 batch...\n");
+	sendSignBatchTestStream(test_stream_sign_tx_batch_bip143_prefix, (uint32_t)sizeof(test_stream_sign_tx_batch_bip143_prefix));
+	printf("Signing one input with two keys using a batch...\n");
+	sendSignBatchTestStream(test_stream_sign_tx_batch_cosign_prefix, (uint32_t)sizeof(test_stream_sign_tx_batch_cosign_prefix));
+	printf("Signing transaction using a batch with a duplicate entry...\n");
+	sendSignBatchTestStream(test_stream_sign_tx_batch_duplicate_prefix, (uint32_t)sizeof(test_stream_sign_tx_batch_duplicate_prefix));
+	printf("Signing transaction using a batch with mismatched lists...\n");
+	sendSignBatchTestStream(test_stream_sign_tx_batch_mismatch_prefix, (uint32_t)sizeof(test_stream_sign_tx_batch_mismatch_prefix));
+	printf("Signing transaction with an oversized payload (expect Failure: Parameter too large)...\n");
+	sendOversizedTestStream();
 	printf("Loading wallet using incorrect key...\n");
 	SEND_ONE_TEST_STREAM(test_stream_load_incorrect);
 	printf("Loading wallet using correct key...\n");
 	SEND_ONE_TEST_STREAM(test_stream_load_correct);
 	printf("Changing wallet key...\n");
 	SEND_ONE_TEST_STREAM(test_stream_change_key);
+	printf("Initialising with implicit ButtonAck...\n");
+	SEND_ONE_TEST_STREAM(test_stream_init_implicit_ack);
+	printf("Loading wallet with changed key in the request (expect no PinRequest)...\n");
+	SEND_ONE_TEST_STREAM(test_stream_load_inline_key);
+	printf("Getting master public key (expect OtpRequest but no ButtonRequest)...\n");
+	SEND_ONE_TEST_STREAM(test_get_master_public_key_implicit_ack);
 	printf("Initialising again...\n");
 	SEND_ONE_TEST_STREAM(test_stream_init);
 	printf("Loading wallet using changed key...\n");
@@ -2023,10 +4519,24 @@ int main(void)
 	SEND_ONE_TEST_STREAM(test_stream_change_name);
 	printf("Listing wallets...\n");
 	SEND_ONE_TEST_STREAM(test_stream_list_wallets);
+	printf("Listing wallets if changed (expect unchanged)...\n");
+	SEND_ONE_TEST_STREAM(test_stream_list_wallets_unchanged);
+	printf("Listing only wallet 0...\n");
+	SEND_ONE_TEST_STREAM(test_stream_list_wallets_first);
+	printf("Listing wallets from past the end...\n");
+	SEND_ONE_TEST_STREAM(test_stream_list_wallets_past_end);
 	printf("Backing up a wallet...\n");
 	SEND_ONE_TEST_STREAM(test_stream_backup_wallet);
+	printf("Sending an encrypted backup to the host...\n");
+	SEND_ONE_TEST_STREAM(test_stream_backup_wallet_to_host);
+	printf("Restoring an encrypted backup with the wrong password...\n");
+	sendRestoreBackupWrongPasswordTestStream();
+	printf("Sending an unencrypted backup to the host...\n");
+	SEND_ONE_TEST_STREAM(test_stream_backup_wallet_to_host_unencrypted);
 	printf("Deleting a wallet...\n");
 	SEND_ONE_TEST_STREAM(test_stream_delete);
+	printf("Restoring an encrypted backup with the wrong digest...\n");
+	SEND_ONE_TEST_STREAM(test_stream_restore_backup_bad_digest);
 	printf("Restoring a wallet...\n");
 	SEND_ONE_TEST_STREAM(test_stream_restore_wallet);
 	printf("Getting device UUID...\n");
@@ -2039,14 +4549,62 @@ int main(void)
 	SEND_ONE_TEST_STREAM(test_stream_get_entropy32);
 	printf("Getting 100 bytes of entropy...\n");
 	SEND_ONE_TEST_STREAM(test_stream_get_entropy100);
+	printf("Getting 5000 bytes of entropy in bulk mode...\n");
+	SEND_ONE_TEST_STREAM(test_stream_get_entropy5000_bulk);
+	printf("Getting 300 bytes of entropy in streamed mode...\n");
+	SEND_ONE_TEST_STREAM(test_stream_get_entropy300_streamed);
+	printf("Getting 0 bytes of entropy in streamed mode...\n");
+	SEND_ONE_TEST_STREAM(test_stream_get_entropy0_streamed);
 	printf("Pinging...\n");
 	SEND_ONE_TEST_STREAM(test_stream_ping);
 	printf("Getting master public key...\n");
 	SEND_ONE_TEST_STREAM(test_get_master_public_key);
 	printf("Getting master public key but not allowing button press...\n");
 	SEND_ONE_TEST_STREAM(test_get_master_public_key_no_press);
+	printf("Getting extended public key of m/44'/0'/0'...\n");
+	SEND_ONE_TEST_STREAM(test_get_extended_public_key);
+	printf("Getting extended public key of master node...\n");
+	SEND_ONE_TEST_STREAM(test_get_extended_public_key_master);
+	printf("Getting extended public key but not allowing button press...\n");
+	SEND_ONE_TEST_STREAM(test_get_extended_public_key_no_press);
 	printf("Loading wallet but not allowing password to be sent...\n");
 	SEND_ONE_TEST_STREAM(test_stream_load_no_key);
+	printf("Initialising with tagged packets...\n");
+	SEND_ONE_TEST_STREAM(test_stream_init_tagged);
+	printf("Sending 3 pipelined requests (responses should have tags 0102, 0103 and fffe)...\n");
+	setTestInputStream(test_stream_pipelined, (uint32_t)sizeof(test_stream_pipelined));
+	for (i = 0; i < 3; i++)
+	{
+		processPacket();
+		printf("\n");
+	}
+	printf("Initialising without tagged packets...\n");
+	SEND_ONE_TEST_STREAM(test_stream_init);
+	printf("Pinging (response should be untagged)...\n");
+	SEND_ONE_TEST_STREAM(test_stream_ping);
+#ifdef ENABLE_BENCHMARK
+	printf("Timing SHA-256...\n");
+	SEND_ONE_TEST_STREAM(test_stream_benchmark_sha256);
+	printf("Timing an invalid primitive...\n");
+	SEND_ONE_TEST_STREAM(test_stream_benchmark_invalid);
+#endif // #ifdef ENABLE_BENCHMARK
+#ifdef ENABLE_DIAGNOSTICS
+	printf("Getting request timing statistics...\n");
+	SEND_ONE_TEST_STREAM(test_stream_get_diagnostics);
+#endif // #ifdef ENABLE_DIAGNOSTICS
+#ifdef ENABLE_TRACE
+	printf("Getting event trace, then clearing it...\n");
+	SEND_ONE_TEST_STREAM(test_stream_get_trace_clear);
+	printf("Getting event trace (should only have end of previous request and start of this one)...\n");
+	SEND_ONE_TEST_STREAM(test_stream_get_trace);
+#endif // #ifdef ENABLE_TRACE
+	printf("Getting HWRNG health statistics...\n");
+	SEND_ONE_TEST_STREAM(test_stream_get_rng_health);
+
+#if STREAM_STAGING_SIZE > 0
+	printf("Testing specialised message encoders and decoders...\n");
+	testFastCodecs();
+#endif // #if STREAM_STAGING_SIZE > 0
 
 	finishTests();
 	exit(0);
@@ -60,6 +60,31 @@
 #define PACKET_TYPE_DELETE_WALLET		0x16
 /** Initialise device's state. */
 #define PACKET_TYPE_INITIALIZE			0x17
+/** Get addresses and public keys for a range of address handles. */
+#define PACKET_TYPE_GET_ADDRESS_RANGE	0x18
+/** Time a cryptographic primitive (only in builds with ENABLE_BENCHMARK
+  * defined). */
+#define PACKET_TYPE_BENCHMARK			0x19
+/** Sign several inputs of a transaction with only one approval. */
+#define PACKET_TYPE_SIGN_TRANSACTION_BATCH	0x1A
+/** Get BIP32 extended public key of a node. */
+#define PACKET_TYPE_GET_EXTENDED_KEY	0x1B
+/** Get progress of the long-running operation which the device is busy
+  * with. */
+#define PACKET_TYPE_GET_PROGRESS		0x1C
+/** Cancel the long-running operation which the device is busy with. */
+#define PACKET_TYPE_CANCEL_OPERATION	0x1D
+/** Get request timing statistics (only in builds with ENABLE_DIAGNOSTICS
+  * defined). */
+#define PACKET_TYPE_GET_DIAGNOSTICS		0x1E
+/** Get health and throughput statistics for the hardware random number
+  * generator. */
+#define PACKET_TYPE_GET_RNG_HEALTH		0x1F
+/** Get the event trace (only in builds with ENABLE_TRACE defined). */
+#define PACKET_TYPE_GET_TRACE			0x20
+/** Start a session, load a wallet and get what the host usually needs to
+  * know about it, all at once. */
+#define PACKET_TYPE_GET_WALLET_SNAPSHOT	0x21
 /** An address from a wallet (response to #PACKET_TYPE_GET_ADDRESS_PUBKEY
   * or #PACKET_TYPE_NEW_ADDRESS). */
 #define PACKET_TYPE_ADDRESS_PUBKEY		0x30
@@ -77,7 +102,8 @@
 #define PACKET_TYPE_FAILURE				0x35
 /** Device UUID (response to #PACKET_TYPE_GET_DEVICE_UUID). */
 #define PACKET_TYPE_DEVICE_UUID			0x36
-/** Some bytes of entropy (response to #PACKET_TYPE_GET_ENTROPY). */
+/** Some bytes of entropy (response to #PACKET_TYPE_GET_ENTROPY). A streamed
+  * request gets several of these; see PROTOCOL. */
 #define PACKET_TYPE_ENTROPY				0x37
 /** Master public key (response to #PACKET_TYPE_GET_MASTER_KEY). */
 #define PACKET_TYPE_MASTER_KEY			0x38
@@ -85,6 +111,30 @@
 #define PACKET_TYPE_SIGNATURE			0x39
 /** Version information and list of features. */
 #define PACKET_TYPE_FEATURES			0x3a
+/** Addresses from a wallet (response to #PACKET_TYPE_GET_ADDRESS_RANGE). */
+#define PACKET_TYPE_ADDRESSES			0x3b
+/** Benchmark timing (response to #PACKET_TYPE_BENCHMARK). */
+#define PACKET_TYPE_BENCHMARK_RESULT	0x3c
+/** Signatures (response to #PACKET_TYPE_SIGN_TRANSACTION_BATCH). */
+#define PACKET_TYPE_SIGNATURES			0x3d
+/** BIP32 extended public key (response to #PACKET_TYPE_GET_EXTENDED_KEY). */
+#define PACKET_TYPE_EXTENDED_KEY		0x3e
+/** Progress of long-running operation (response to
+  * #PACKET_TYPE_GET_PROGRESS). */
+#define PACKET_TYPE_PROGRESS			0x3f
+/** Request timing statistics (response to #PACKET_TYPE_GET_DIAGNOSTICS). */
+#define PACKET_TYPE_DIAGNOSTICS			0x40
+/** Hardware random number generator statistics (response
+  * to #PACKET_TYPE_GET_RNG_HEALTH). */
+#define PACKET_TYPE_RNG_HEALTH			0x41
+/** Event trace (response to #PACKET_TYPE_GET_TRACE). */
+#define PACKET_TYPE_TRACE				0x42
+/** Encrypted wallet backup (response to #PACKET_TYPE_BACKUP_WALLET with
+  * to_host set). */
+#define PACKET_TYPE_WALLET_BACKUP		0x43
+/** Features and loaded wallet information (response to
+  * #PACKET_TYPE_GET_WALLET_SNAPSHOT). */
+#define PACKET_TYPE_WALLET_SNAPSHOT		0x44
 /** Device wants to wait for button press (beginning of ButtonRequest
   * interjection). */
 #define PACKET_TYPE_BUTTON_REQUEST		0x50
@@ -111,7 +161,20 @@
 #define PACKET_TYPE_OTP_CANCEL			0x58
 /**@}*/
 
+/** Long-running operations which call longOperationYield(). These values
+  * are reported to the host in Progress messages. */
+typedef enum LongOperationEnum
+{
+	/** No long-running operation is in progress. */
+	LONG_OPERATION_NONE			=	0,
+	/** Deriving a wallet encryption key using pbkdf2(). */
+	LONG_OPERATION_DERIVE_KEY	=	1,
+	/** Sanitising (clearing) non-volatile storage. */
+	LONG_OPERATION_SANITISE		=	2
+} LongOperation;
+
 extern void processPacket(void);
+extern bool longOperationYield(LongOperation operation, uint32_t completed, uint32_t total);
 #ifdef TEST
 extern void setTestInputStream(const uint8_t *buffer, uint32_t length);
 extern void setInfiniteZeroInputStream(void);
@@ -0,0 +1,254 @@
+/** \file tasks.c
+  *
+  * \brief Runs background tasks while the firmware would otherwise be
+  *        waiting or busy.
+  *
+  * The firmware has only one thread of execution: processPacket() handles a
+  * request from start to finish. Some platform work (eg. testing hardware
+  * random number generator samples) doesn't need to happen at any particular
+  * time, but it's better if it happens while the CPU would otherwise be idle,
+  * or in small pieces during long-running operations, rather than making a
+  * request wait for it. This implements a very simple cooperative scheduler
+  * for that: platform code registers tasks using addBackgroundTask(), and
+  * runBackgroundTasks() gives each task one turn. runBackgroundTasks() is
+  * called from longOperationYield() and from the platform's idle loops.
+  *
+  * Since tasks can't be preempted, each call to a task must not take long.
+  * Tasks must not use the communication stream.
+  *
+  * There is also room for one one-shot task (see scheduleOneShotTask()),
+  * which is run once, at the next opportunity. This is for work which
+  * the firmware knows it will probably need soon, and would like to get
+  * done while it is waiting for the user anyway (eg. computing a signature
+  * while the user looks over a transaction). A one-shot task may take
+  * longer than a normal background task, since it runs only once, but it
+  * still must not use the communication stream.
+  *
+  * This file is licensed as described by the file LICENCE.
+  */
+
+#ifdef TEST_TASKS
+#include <stdio.h>
+#include <stdlib.h>
+#include "test_helpers.h"
+#endif // #ifdef TEST_TASKS
+
+#include <stdlib.h> // for definition of NULL
+#include "common.h"
+#include "tasks.h"
+
+/** Registered background tasks, in the order they will be run. */
+static BackgroundTask background_tasks[MAX_BACKGROUND_TASKS];
+/** Number of valid entries in #background_tasks. */
+static uint8_t num_background_tasks;
+/** Whether runBackgroundTasks() is currently running. This stops tasks from
+  * running recursively if a task does something which ends up calling
+  * runBackgroundTasks() again. */
+static bool running_background_tasks;
+/** One-shot task which is waiting to be run, or NULL if there isn't one. */
+static BackgroundTask one_shot_task;
+
+/** Register a background task. Tasks are never removed, so this is usually
+  * called during startup.
+  * \param task The task to add.
+  * \return false on success, true if there is no space for the task (see
+  *         #MAX_BACKGROUND_TASKS).
+  */
+bool addBackgroundTask(BackgroundTask task)
+{
+	if (num_background_tasks >= MAX_BACKGROUND_TASKS)
+	{
+		return true;
+	}
+	background_tasks[num_background_tasks] = task;
+	num_background_tasks++;
+	return false;
+}
+
+/** Arrange for a task to be run once, the next time runBackgroundTasks() or
+  * finishOneShotTask() is called. This replaces any one-shot task which
+  * hasn't run yet.
+  * \param task The task to run.
+  */
+void scheduleOneShotTask(BackgroundTask task)
+{
+	one_shot_task = task;
+}
+
+/** Make sure that the one-shot task (see scheduleOneShotTask()) has run. If
+  * it hasn't run yet, it is run now. */
+void finishOneShotTask(void)
+{
+	BackgroundTask task;
+
+	task = one_shot_task;
+	if (task != NULL)
+	{
+		one_shot_task = NULL;
+		task();
+	}
+}
+
+/** Stop the one-shot task (see scheduleOneShotTask()) from running, if it
+  * hasn't run already. */
+void cancelOneShotTask(void)
+{
+	one_shot_task = NULL;
+}
+
+/** Give each registered background task one turn, then run the one-shot
+  * task, if there is one. This does nothing if called from within a
+  * background task. */
+void runBackgroundTasks(void)
+{
+	uint8_t i;
+
+	if (running_background_tasks)
+	{
+		return;
+	}
+	running_background_tasks = true;
+	for (i = 0; i < num_background_tasks; i++)
+	{
+		background_tasks[i]();
+	}
+	finishOneShotTask();
+	running_background_tasks = false;
+}
+
+#ifdef TEST_TASKS
+
+/** Number of times testTaskA() has been called. */
+static unsigned int task_a_count;
+/** Number of times testTaskB() has been called. */
+static unsigned int task_b_count;
+
+/** Background task which counts its calls. */
+static void testTaskA(void)
+{
+	task_a_count++;
+}
+
+/** Background task which counts its calls and tries to run all background
+  * tasks again, which should do nothing. */
+static void testTaskB(void)
+{
+	task_b_count++;
+	runBackgroundTasks();
+}
+
+/** Number of times testOneShotTask() has been called. */
+static unsigned int one_shot_count;
+
+/** One-shot task which counts its calls. */
+static void testOneShotTask(void)
+{
+	one_shot_count++;
+}
+
+/** Check how many times testOneShotTask() has been called.
+  * \param expected The expected number of calls.
+  * \param name Description of the test, printed on failure.
+  */
+static void checkOneShotCount(unsigned int expected, const char *name)
+{
+	if (one_shot_count != expected)
+	{
+		printf("One-shot task ran %u times, expected %u, for: %s\n", one_shot_count, expected, name);
+		reportFailure();
+	}
+	else
+	{
+		reportSuccess();
+	}
+}
+
+int main(void)
+{
+	unsigned int i;
+
+	initTests(__FILE__);
+
+	// With nothing registered, this should do nothing.
+	runBackgroundTasks();
+	reportSuccess();
+
+	if (addBackgroundTask(&testTaskA) || addBackgroundTask(&testTaskB))
+	{
+		printf("Couldn't add background tasks\n");
+		reportFailure();
+	}
+	else
+	{
+		reportSuccess();
+	}
+	for (i = 0; i < 10; i++)
+	{
+		runBackgroundTasks();
+	}
+	// testTaskB()'s nested call shouldn't have run anything.
+	if ((task_a_count != 10) || (task_b_count != 10))
+	{
+		printf("Background tasks ran the wrong number of times (%u, %u)\n", task_a_count, task_b_count);
+		reportFailure();
+	}
+	else
+	{
+		reportSuccess();
+	}
+
+	// Fill up the rest of the task table, then check that one more is
+	// rejected.
+	for (i = 2; i < MAX_BACKGROUND_TASKS; i++)
+	{
+		if (addBackgroundTask(&testTaskA))
+		{
+			printf("Couldn't add background task %u\n", i);
+			reportFailure();
+		}
+	}
+	if (!addBackgroundTask(&testTaskA))
+	{
+		printf("Added more than MAX_BACKGROUND_TASKS background tasks\n");
+		reportFailure();
+	}
+	else
+	{
+		reportSuccess();
+	}
+	task_a_count = 0;
+	runBackgroundTasks();
+	if (task_a_count != (MAX_BACKGROUND_TASKS - 1))
+	{
+		printf("Full task table ran testTaskA() %u times\n", task_a_count);
+		reportFailure();
+	}
+	else
+	{
+		reportSuccess();
+	}
+
+	// A one-shot task should run exactly once, whether it's run by
+	// runBackgroundTasks() or finishOneShotTask().
+	scheduleOneShotTask(&testOneShotTask);
+	runBackgroundTasks();
+	runBackgroundTasks();
+	finishOneShotTask();
+	checkOneShotCount(1, "runBackgroundTasks()");
+	scheduleOneShotTask(&testOneShotTask);
+	finishOneShotTask();
+	runBackgroundTasks();
+	finishOneShotTask();
+	checkOneShotCount(2, "finishOneShotTask()");
+	// Cancelled one-shot tasks shouldn't run at all.
+	scheduleOneShotTask(&testOneShotTask);
+	cancelOneShotTask();
+	runBackgroundTasks();
+	finishOneShotTask();
+	checkOneShotCount(2, "cancelOneShotTask()");
+
+	finishTests();
+	exit(0);
+}
+
+#endif // #ifdef TEST_TASKS
@@ -0,0 +1,31 @@
+/** \file tasks.h
+  *
+  * \brief Describes functions and types exported by tasks.c.
+  *
+  * This file is licensed as described by the file LICENCE.
+  */
+
+#ifndef TASKS_H_INCLUDED
+#define TASKS_H_INCLUDED
+
+#include "common.h"
+
+#ifndef MAX_BACKGROUND_TASKS
+/** Maximum number of background tasks which can be registered using
+  * addBackgroundTask(). This can be overridden by defining
+  * MAX_BACKGROUND_TASKS in the platform's build settings. */
+#define MAX_BACKGROUND_TASKS		5
+#endif // #ifndef MAX_BACKGROUND_TASKS
+
+/** A background task. Each call should do a small, bounded amount of work
+  * and then return; state which needs to survive between calls must be kept
+  * by the task itself (eg. in static variables). */
+typedef void (*BackgroundTask)(void);
+
+extern bool addBackgroundTask(BackgroundTask task);
+extern void runBackgroundTasks(void);
+extern void scheduleOneShotTask(BackgroundTask task);
+extern void finishOneShotTask(void);
+extern void cancelOneShotTask(void);
+
+#endif // #ifndef TASKS_H_INCLUDED
@@ -6,6 +6,9 @@
   * unit to the compiler. Thus this file should not be compiled in non-test
   * builds.
   *
+  * If BENCH is defined, this also has the helpers used by the host
+  * benchmarks (the bench_<module> targets in the Makefile).
+  *
   * This file is licensed as described by the file LICENCE.
   */
 
@@ -16,6 +19,21 @@
 #include <time.h>
 #include "test_helpers.h"
 
+#ifdef BENCH
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+/** Defined if readCycleCounter() can read a real CPU cycle counter. */
+#define HAVE_CYCLE_COUNTER
+#endif // #if defined(__x86_64__) || defined(__i386__)
+
+#ifndef BENCH_MIN_SECONDS
+/** Minimum time, in seconds, which runHostBenchmark() will time a function
+  * for. Longer times give steadier results. This can be overridden by
+  * defining BENCH_MIN_SECONDS. */
+#define BENCH_MIN_SECONDS		0.25
+#endif // #ifndef BENCH_MIN_SECONDS
+#endif // #ifdef BENCH
+
 /** Number of test cases which succeeded. */
 static int succeeded;
 /** Number of test cases which failed. */
@@ -148,5 +166,105 @@ void finishTests(void)
 	printf("Tests which failed: %d\n", failed);
 }
 
-#endif // #ifdef TEST
+#ifdef BENCH
+
+/** Get the current time from a monotonic clock.
+  * \return The current time, in seconds.
+  */
+static double getSeconds(void)
+{
+	struct timespec now;
 
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)now.tv_sec + (double)now.tv_nsec / 1.0e9;
+}
+
+#ifdef HAVE_CYCLE_COUNTER
+/** Read the CPU's cycle counter (on x86, the time stamp counter, which
+  * counts at the processor's nominal clock rate).
+  * \return The current value of the cycle counter.
+  */
+static uint64_t readCycleCounter(void)
+{
+	return __rdtsc();
+}
+#endif // #ifdef HAVE_CYCLE_COUNTER
+
+/** This must be called before running any host benchmarks. It prints a
+  * header line which describes the fields that runHostBenchmark() prints.
+  * \param source_file_name The name of the file being benchmarked. The use
+  *                         of the __FILE__ macro is probably a good idea.
+  */
+void initBenchmarks(const char *source_file_name)
+{
+	srand(42);
+	printf("# benchmarks for file: %s\n", source_file_name);
+	printf("# name\titerations\tops_per_sec\tns_per_op\tcycles_per_op\tcycles_per_byte\n");
+}
+
+/** Time a function and print the result as one tab-separated line (see
+  * initBenchmarks() for the fields). The function is run with an increasing
+  * number of iterations until that takes at least #BENCH_MIN_SECONDS. Fields
+  * which can't be calculated (eg. cycles per byte for something which
+  * doesn't process bytes) are printed as "-".
+  * \param name Name of the benchmark. This should not contain whitespace.
+  * \param function The function to time.
+  * \param bytes_per_op The number of bytes that one call to function
+  *                     processes, or 0 if that doesn't make sense.
+  */
+void runHostBenchmark(const char *name, BenchFunction function, uint32_t bytes_per_op)
+{
+	unsigned long iterations;
+	unsigned long i;
+	double start;
+	double elapsed;
+#ifdef HAVE_CYCLE_COUNTER
+	uint64_t start_cycles;
+	uint64_t cycles;
+	double cycles_per_op;
+#endif // #ifdef HAVE_CYCLE_COUNTER
+
+	function(); // warm up caches
+	iterations = 1;
+	while (true)
+	{
+		start = getSeconds();
+#ifdef HAVE_CYCLE_COUNTER
+		start_cycles = readCycleCounter();
+#endif // #ifdef HAVE_CYCLE_COUNTER
+		for (i = 0; i < iterations; i++)
+		{
+			function();
+		}
+#ifdef HAVE_CYCLE_COUNTER
+		cycles = readCycleCounter() - start_cycles;
+#endif // #ifdef HAVE_CYCLE_COUNTER
+		elapsed = getSeconds() - start;
+		if (elapsed >= BENCH_MIN_SECONDS)
+		{
+			break;
+		}
+		iterations *= 2;
+	}
+
+	printf("%s\t%lu\t%.1f\t%.1f", name, iterations, (double)iterations / elapsed, elapsed * 1.0e9 / (double)iterations);
+#ifdef HAVE_CYCLE_COUNTER
+	cycles_per_op = (double)cycles / (double)iterations;
+	printf("\t%.1f", cycles_per_op);
+	if (bytes_per_op != 0)
+	{
+		printf("\t%.2f\n", cycles_per_op / (double)bytes_per_op);
+	}
+	else
+	{
+		printf("\t-\n");
+	}
+#else
+	printf("\t-\t-\n");
+#endif // #ifdef HAVE_CYCLE_COUNTER
+	fflush(stdout);
+}
+
+#endif // #ifdef BENCH
+
+#endif // #ifdef TEST
@@ -25,6 +25,14 @@ extern void reportFailure(void);
 extern void initTests(const char *source_file_name);
 extern void finishTests(void);
 
+#ifdef BENCH
+/** A function which runHostBenchmark() can time. */
+typedef void (*BenchFunction)(void);
+
+extern void initBenchmarks(const char *source_file_name);
+extern void runHostBenchmark(const char *name, BenchFunction function, uint32_t bytes_per_op);
+#endif // #ifdef BENCH
+
 #endif // #ifdef TEST
 
 #endif // #ifndef TEST_HELPERS_H_INCLUDED
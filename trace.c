@@ -0,0 +1,267 @@
+/** \file trace.c
+  *
+  * \brief Records a timeline of events, for debugging latency problems.
+  *
+  * diagnostics.c says how much time went into each phase of each packet
+  * type, but not why one particular request was slow. For that, the code
+  * calls traceEvent() at key points (see #TraceEventTypeEnum), and each
+  * event is recorded, along with the time it happened, in a ring buffer
+  * of #TRACE_BUFFER_ENTRIES entries. The host can retrieve the buffer using
+  * a GetTrace packet and reconstruct a timeline of the most recent events,
+  * eg. to see whether a slow SignTransaction was waiting for the host, for
+  * the user, for non-volatile storage or for arithmetic.
+  *
+  * Since recording an event takes a little time and the buffer takes RAM,
+  * this is only compiled in if ENABLE_TRACE is defined. The timestamps come
+  * from getCycleCount(), so one of ENABLE_DIAGNOSTICS or ENABLE_BENCHMARK
+  * must also be defined. traceEvent() must not be called from interrupt
+  * handlers.
+  *
+  * This file is licensed as described by the file LICENCE.
+  */
+
+#ifdef TEST_TRACE
+#include <stdio.h>
+#include <stdlib.h>
+#include "test_helpers.h"
+#endif // #ifdef TEST_TRACE
+
+#include "common.h"
+#include "hwinterface.h"
+#include "trace.h"
+
+#ifdef ENABLE_TRACE
+
+/** The ring buffer of events. */
+static TraceRecord trace_buffer[TRACE_BUFFER_ENTRIES];
+/** Index into #trace_buffer where the next event will be written. */
+static unsigned int trace_next;
+/** Number of valid entries in #trace_buffer. */
+static unsigned int trace_count;
+/** Number of events recorded since the buffer was last cleared, including
+  * those which have since been overwritten. */
+static uint32_t trace_total;
+/** Whether recording is paused (see tracePause()). */
+static bool trace_paused;
+
+/** Record an event in the trace buffer. If the buffer is full, the oldest
+  * event is overwritten.
+  * \param event What happened.
+  * \param arg Event-dependent argument (see #TraceEventTypeEnum). Only the
+  *            least significant 16 bits are recorded.
+  */
+void traceEvent(TraceEventType event, uint32_t arg)
+{
+	TraceRecord *record;
+
+	if (trace_paused)
+	{
+		return;
+	}
+	record = &(trace_buffer[trace_next]);
+	record->timestamp = getCycleCount();
+	record->event = (uint16_t)event;
+	record->arg = (uint16_t)arg;
+	trace_next++;
+	if (trace_next == TRACE_BUFFER_ENTRIES)
+	{
+		trace_next = 0;
+	}
+	if (trace_count < TRACE_BUFFER_ENTRIES)
+	{
+		trace_count++;
+	}
+	trace_total++;
+}
+
+/** Pause or resume recording. While paused, traceEvent() does nothing. This
+  * is used while the buffer is being sent, since sending may itself cause
+  * events and the buffer must not change between the two encoding passes
+  * of sendPacket().
+  * \param pause true to pause recording, false to resume it.
+  * \return Whether recording was paused before this call.
+  */
+bool tracePause(bool pause)
+{
+	bool was_paused;
+
+	was_paused = trace_paused;
+	trace_paused = pause;
+	return was_paused;
+}
+
+/** Discard every event in the trace buffer. */
+void traceClear(void)
+{
+	trace_next = 0;
+	trace_count = 0;
+	trace_total = 0;
+}
+
+/** Get the number of events in the trace buffer.
+  * \return The number of events, which is at most #TRACE_BUFFER_ENTRIES.
+  */
+unsigned int getTraceCount(void)
+{
+	return trace_count;
+}
+
+/** Get one event from the trace buffer.
+  * \param index Which event to get, where 0 is the oldest. This must be less
+  *              than the value returned by getTraceCount().
+  * \return The event.
+  */
+const TraceRecord *getTraceRecord(unsigned int index)
+{
+	unsigned int position;
+
+	if (index >= trace_count)
+	{
+		fatalError(); // this should never happen
+	}
+	position = trace_next + TRACE_BUFFER_ENTRIES - trace_count + index;
+	if (position >= TRACE_BUFFER_ENTRIES)
+	{
+		position -= TRACE_BUFFER_ENTRIES;
+	}
+	return &(trace_buffer[position]);
+}
+
+/** Get the number of events recorded since the buffer was last cleared.
+  * If this is larger than getTraceCount(), the oldest events have been
+  * overwritten.
+  * \return The number of events, modulo 2 ^ 32.
+  */
+uint32_t getTraceTotal(void)
+{
+	return trace_total;
+}
+
+#endif // #ifdef ENABLE_TRACE
+
+#ifdef TEST_TRACE
+
+/** Fake cycle counter, so that timestamps are predictable. */
+static uint32_t fake_cycle_count;
+
+uint32_t getCycleCount(void)
+{
+	return fake_cycle_count;
+}
+
+/** Check that the trace buffer contains the expected events.
+  * \param first_arg arg of the oldest event; each later event should have
+  *                  an arg one larger, and a timestamp 10 times its arg.
+  * \param count Expected number of events in the buffer.
+  * \param total Expected total number of events recorded.
+  * \param name Description of the test, printed on failure.
+  */
+static void checkTrace(unsigned int first_arg, unsigned int count, uint32_t total, const char *name)
+{
+	const TraceRecord *record;
+	unsigned int i;
+	bool wrong;
+
+	wrong = (getTraceCount() != count) || (getTraceTotal() != total);
+	for (i = 0; !wrong && (i < count); i++)
+	{
+		record = getTraceRecord(i);
+		if ((record->event != TRACE_PACKET_BEGIN) || (record->arg != (first_arg + i))
+			|| (record->timestamp != ((first_arg + i) * 10)))
+		{
+			wrong = true;
+		}
+	}
+	if (!wrong)
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("Trace buffer has wrong contents for: %s\n", name);
+		reportFailure();
+	}
+}
+
+/** Record an event with arg i at time 10 * i.
+  * \param i The arg to use.
+  */
+static void recordEvent(unsigned int i)
+{
+	fake_cycle_count = i * 10;
+	traceEvent(TRACE_PACKET_BEGIN, i);
+}
+
+int main(void)
+{
+	unsigned int i;
+
+	initTests(__FILE__);
+
+	checkTrace(0, 0, 0, "initial state");
+
+	// Events should come out oldest first.
+	for (i = 0; i < 5; i++)
+	{
+		recordEvent(i);
+	}
+	checkTrace(0, 5, 5, "partially full");
+
+	// Once full, the oldest events should be overwritten.
+	for (i = 5; i < (TRACE_BUFFER_ENTRIES + 7); i++)
+	{
+		recordEvent(i);
+	}
+	checkTrace(7, TRACE_BUFFER_ENTRIES, TRACE_BUFFER_ENTRIES + 7, "wrapped around");
+
+	// Nothing should be recorded while paused.
+	if (!tracePause(true))
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("Trace initially paused\n");
+		reportFailure();
+	}
+	recordEvent(1000);
+	if (tracePause(false))
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("tracePause() didn't pause\n");
+		reportFailure();
+	}
+	checkTrace(7, TRACE_BUFFER_ENTRIES, TRACE_BUFFER_ENTRIES + 7, "paused");
+
+	// Clearing should empty the buffer, and recording should start again
+	// from the beginning.
+	traceClear();
+	checkTrace(0, 0, 0, "cleared");
+	for (i = 3; i < 6; i++)
+	{
+		recordEvent(i);
+	}
+	checkTrace(3, 3, 3, "after clear");
+
+	// The argument is truncated to 16 bits.
+	traceClear();
+	traceEvent(TRACE_NV_ERASE, 0x12345);
+	if ((getTraceCount() == 1) && (getTraceRecord(0)->arg == 0x2345)
+		&& (getTraceRecord(0)->event == TRACE_NV_ERASE))
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("Argument not truncated properly\n");
+		reportFailure();
+	}
+
+	finishTests();
+	exit(0);
+}
+
+#endif // #ifdef TEST_TRACE
@@ -0,0 +1,112 @@
+/** \file trace.h
+  *
+  * \brief Describes functions and types exported by trace.c.
+  *
+  * This file is licensed as described by the file LICENCE.
+  */
+
+#ifndef TRACE_H_INCLUDED
+#define TRACE_H_INCLUDED
+
+#include "common.h"
+
+#if defined(ENABLE_TRACE) && !defined(ENABLE_BENCHMARK) && !defined(ENABLE_DIAGNOSTICS)
+#error "ENABLE_TRACE needs getCycleCount(); define ENABLE_DIAGNOSTICS as well"
+#endif
+
+#ifndef TRACE_BUFFER_ENTRIES
+/** Number of events which the trace buffer holds. Once it is full, each new
+  * event overwrites the oldest one. Each entry takes 8 bytes of RAM. This
+  * can be overridden by defining TRACE_BUFFER_ENTRIES in the platform's
+  * build settings. */
+#define TRACE_BUFFER_ENTRIES		64
+#endif // #ifndef TRACE_BUFFER_ENTRIES
+
+/** Events which can be recorded using traceEvent(). These values are sent
+  * to the host (see the Trace message in messages.proto), so existing
+  * values shouldn't be changed. Events which begin and end something come
+  * in pairs, so the time taken is the difference between their
+  * timestamps. */
+typedef enum TraceEventTypeEnum
+{
+	/** processPacket() received a packet header. arg is the packet type. */
+	TRACE_PACKET_BEGIN			=	1,
+	/** processPacket() finished handling a packet. arg is the packet
+	  * type. */
+	TRACE_PACKET_END			=	2,
+	/** The device began waiting for the user. arg is the packet type of the
+	  * interjection (eg. #PACKET_TYPE_BUTTON_REQUEST) if it is waiting for
+	  * the host's response to that, or 0 if it is waiting for the user to
+	  * press a button on the device. */
+	TRACE_USER_WAIT_BEGIN		=	3,
+	/** The device stopped waiting for the user. */
+	TRACE_USER_WAIT_END			=	4,
+	/** Key derivation using PBKDF2 began. */
+	TRACE_KEY_DERIVATION_BEGIN	=	5,
+	/** Key derivation using PBKDF2 finished. arg is 0 on success and 1 if
+	  * it was cancelled. */
+	TRACE_KEY_DERIVATION_END	=	6,
+	/** Transaction parsing began. arg is the length of the transaction, in
+	  * bytes. */
+	TRACE_PARSE_BEGIN			=	7,
+	/** Transaction parsing finished. arg is the #TransactionErrorsEnum
+	  * value. */
+	TRACE_PARSE_END				=	8,
+	/** Signing of one signature hash began. */
+	TRACE_SIGN_BEGIN			=	9,
+	/** Signing of one signature hash finished. */
+	TRACE_SIGN_END				=	10,
+	/** nonVolatileFlush() began. */
+	TRACE_NV_FLUSH_BEGIN		=	11,
+	/** nonVolatileFlush() finished. arg is the #NonVolatileReturnEnum
+	  * value. */
+	TRACE_NV_FLUSH_END			=	12,
+	/** A sector of non-volatile memory was erased. arg is the sector
+	  * number. */
+	TRACE_NV_ERASE				=	13,
+	/** A stream read found the receive FIFO empty, so the device began
+	  * waiting for the host. */
+	TRACE_RX_WAIT_BEGIN			=	14,
+	/** The stream read which was waiting for the host got its data. */
+	TRACE_RX_WAIT_END			=	15,
+	/** A stream write found the transmit FIFO full, so the device began
+	  * waiting for the host. */
+	TRACE_TX_WAIT_BEGIN			=	16,
+	/** The stream write which was waiting for the host could continue. */
+	TRACE_TX_WAIT_END			=	17,
+	/** Sanitising of (part of) non-volatile storage began. arg is the
+	  * partition. */
+	TRACE_SANITISE_BEGIN		=	18,
+	/** Sanitising of non-volatile storage finished. arg is the
+	  * #WalletErrorsEnum value. */
+	TRACE_SANITISE_END			=	19
+} TraceEventType;
+
+/** One entry in the trace buffer. */
+typedef struct TraceRecordStruct
+{
+	/** Value of getCycleCount() when the event happened. */
+	uint32_t timestamp;
+	/** What happened; one of #TraceEventTypeEnum. */
+	uint16_t event;
+	/** Event-dependent argument, truncated to 16 bits. */
+	uint16_t arg;
+} TraceRecord;
+
+#ifdef ENABLE_TRACE
+
+extern void traceEvent(TraceEventType event, uint32_t arg);
+extern bool tracePause(bool pause);
+extern void traceClear(void);
+extern unsigned int getTraceCount(void);
+extern const TraceRecord *getTraceRecord(unsigned int index);
+extern uint32_t getTraceTotal(void);
+
+#else
+
+// Without ENABLE_TRACE, nothing is recorded.
+#define traceEvent(event, arg)
+
+#endif // #ifdef ENABLE_TRACE
+
+#endif // #ifndef TRACE_H_INCLUDED
@@ -12,6 +12,19 @@
   * the "r" and "s" values (see ecdsaSign()) in DER format. See the code of
   * signTransaction() for the guts.
   *
+  * If TRANSACTION_VERIFY_SIGNATURES is defined, signTransaction() checks
+  * every signature using ecdsaVerify() before releasing it. This protects
+  * against fault attacks on the signing process (a faulty signature can
+  * reveal the private key), at a cost of about 1.3 times the time taken by
+  * a point multiplication for each signature.
+  *
+  * Output amounts and the transaction fee are 64 bit integers. On platforms
+  * with native 64 bit arithmetic, define TRANSACTION_64BIT_AMOUNTS so that
+  * they are checked and added up as uint64_t values, instead of as 8 byte
+  * multi-precision integers using the functions in bignum256.c. Amounts
+  * still enter and leave this file (eg. setTransactionFee()) as 8 byte
+  * little-endian arrays, so nothing outside this file needs to know.
+  *
   * This file is licensed as described by the file LICENCE.
   */
 
@@ -26,6 +39,12 @@
 #include "wallet.h"
 #endif // #ifdef TEST_TRANSACTION
 
+#ifdef BENCH_TRANSACTION
+#include <stdlib.h>
+#include "test_helpers.h"
+#include "stream_comm.h"
+#endif // #ifdef BENCH_TRANSACTION
+
 #include "common.h"
 #include "endian.h"
 #include "ecdsa.h"
@@ -35,10 +54,8 @@
 #include "prandom.h"
 #include "hwinterface.h"
 #include "transaction.h"
+#include "trace.h"
 
-/** The maximum size of a transaction (in bytes) which parseTransaction()
-  * is prepared to handle. */
-#define MAX_TRANSACTION_SIZE	2000000
 /** The maximum number of inputs that the transaction parser is prepared
   * to handle. This should be small enough that a transaction with the
   * maximum number of inputs is still less than #MAX_TRANSACTION_SIZE bytes in
@@ -54,6 +71,90 @@
   */
 #define MAX_OUTPUTS				2000
 
+/** Size, in bytes, of the read-ahead buffer which transaction data is read
+  * into from the stream device. 64 bytes is the payload size of one USB
+  * full-speed packet, so the parser consumes data roughly in units of whole
+  * stream packets, while the stream device's receive interrupt is already
+  * filling its FIFO with the next packet.
+  * \warning This must be <= 255, since read-ahead positions are stored in
+  *          uint8_t variables.
+  */
+#define TRANSACTION_READ_AHEAD	64
+
+/** Value for #batch_script_lane which means "no lane". */
+#define NO_BATCH_LANE			0xff
+
+/** Value of the byte before each transaction in the input stream which
+  * means "the main transaction". */
+#define TRANSACTION_TYPE_MAIN		0x00
+/** Value of the byte before each transaction in the input stream which
+  * means "a cached input reference"; see parseTransaction(). */
+#define TRANSACTION_TYPE_CACHED_REF	0x02
+
+/** What needs to be remembered about an input in order to calculate its
+  * BIP 143 signature hash once the whole transaction has been parsed. */
+struct BIP143Input
+{
+	/** Outpoint (reference hash followed by output number) of the input. */
+	uint8_t outpoint[36];
+	/** scriptCode of the input, without its length prefix. This is the pay
+	  * to public key hash script of the output which the input references. */
+	uint8_t script_code[25];
+	/** Amount of the output which the input references. */
+	uint8_t amount[8];
+};
+
+/** State for calculating BIP 143 signature hashes. The hash states are the
+  * "midstates" which are shared by every input, so that once the
+  * transaction has been parsed, the work needed for each input doesn't
+  * depend on the size of the transaction. */
+struct BIP143State
+{
+	/** Hashes every outpoint of the main transaction (hashPrevouts). */
+	HashState prevouts_hs;
+	/** Hashes every sequence of the main transaction (hashSequence). */
+	HashState sequence_hs;
+	/** Hashes every output of the main transaction (hashOutputs). */
+	HashState outputs_hs;
+	/** One entry for each input being signed for. */
+	struct BIP143Input inputs[TRANSACTION_MAX_BATCH];
+};
+
+/** Storage for parseTransactionBatch(). The two ways of calculating
+  * signature hashes are never used at the same time, so they share the
+  * same memory. */
+union BatchStorageUnion
+{
+	/** One hash state for each input, for legacy signature hashes. */
+	HashState lanes[TRANSACTION_MAX_BATCH];
+	/** Midstates and per-input data, for BIP 143 signature hashes. */
+	struct BIP143State bip143;
+};
+
+/** An output of an input transaction which was previously parsed in full. The
+  * input transaction's hash was calculated by the transaction parser, so the
+  * amount can be trusted as much as if the input transaction was sent
+  * again. */
+struct PrevoutCacheEntry
+{
+	/** Whether this entry is in use. */
+	bool valid;
+	/** Outpoint (reference hash followed by output number) of the output, in
+	  * the same format as it appears in the inputs of a transaction. */
+	uint8_t outpoint[36];
+	/** Amount of the output. */
+	uint8_t amount[8];
+};
+
+#ifdef TRANSACTION_64BIT_AMOUNTS
+/** The maximum amount that can appear in an output, in satoshis. This
+  * represents 21 million BTC. */
+#define MAX_MONEY				2100000000000000ULL
+
+/** The transaction fee amount, calculated as output amounts subtracted from
+  * input amounts. */
+static THREAD_LOCAL uint64_t transaction_fee_amount;
+#else
 /** The maximum amount that can appear in an output, stored as a little-endian
   * multi-precision integer. This represents 21 million BTC. */
 static const uint8_t max_money[] = {
@@ -61,45 +162,180 @@ static const uint8_t max_money[] = {
 
 /** The transaction fee amount, calculated as output amounts subtracted from
   * input amounts. */
-static uint8_t transaction_fee_amount[8];
+static THREAD_LOCAL uint8_t transaction_fee_amount[8];
+#endif // #ifdef TRANSACTION_64BIT_AMOUNTS
 
 /** Where the transaction parser is within a transaction. 0 = first byte,
   * 1 = second byte etc. */
-static uint32_t transaction_data_index;
+static THREAD_LOCAL uint32_t transaction_data_index;
 /** The total length of the transaction being parsed, in number of bytes. */
-static uint32_t transaction_length;
+static THREAD_LOCAL uint32_t transaction_length;
+/** Number of bytes which have been read from the stream device so far. This
+  * is always at least #transaction_data_index, since bytes may be waiting
+  * in #read_ahead_buffer. It never exceeds #transaction_length, so the
+  * read-ahead never consumes data which belongs to the next packet. */
+static THREAD_LOCAL uint32_t transaction_fetch_index;
+/** Transaction data which has been read from the stream device but not yet
+  * consumed by the parser. */
+static THREAD_LOCAL uint8_t read_ahead_buffer[TRANSACTION_READ_AHEAD];
+/** Index into #read_ahead_buffer of the next byte to give to the parser. */
+static THREAD_LOCAL uint8_t read_ahead_start;
+/** Number of valid bytes in #read_ahead_buffer. */
+static THREAD_LOCAL uint8_t read_ahead_end;
 /** If this is true, then as the transaction contents are read from the
   * stream device, they will not be included in the calculation of the
   * transaction hash (see parseTransaction() for what this is all about).
   * If this is false, then they will be included. */
-static bool suppress_transaction_hash;
+static THREAD_LOCAL bool suppress_transaction_hash;
 /** If this is false, then as the transaction contents are read from the
   * stream device, they will not be included in the calculation of the
   * transaction hash or the signature hash. If this is true, then they
   * will be included. This is used to stop #sig_hash_hs_ptr
   * and #transaction_hash_hs_ptr from being written to if they don't point
   * to a valid hash state. */
-static bool hs_ptr_valid;
+static THREAD_LOCAL bool hs_ptr_valid;
 /** Pointer to hash state used to calculate the signature
   * hash (see parseTransaction() for what this is all about).
   * \warning If this does not point to a valid hash state structure, ensure
   *          that #hs_ptr_valid is false to
   *          stop getTransactionBytes() from attempting to dereference this.
   */
-static HashState *sig_hash_hs_ptr;
+static THREAD_LOCAL HashState *sig_hash_hs_ptr;
 /** Pointer to hash state used to calculate the transaction
   * hash (see parseTransaction() for what this is all about).
   * \warning If this does not point to a valid hash state structure, ensure
   *          that #hs_ptr_valid is false to
   *          stop getTransactionBytes() from attempting to dereference this.
   */
-static HashState *transaction_hash_hs_ptr;
+static THREAD_LOCAL HashState *transaction_hash_hs_ptr;
+/** Pairs up #sig_hash_hs_ptr (lane A) and #transaction_hash_hs_ptr
+  * (lane B), so that bytes which go into both hashes only need to be hashed
+  * once (until the first input script is encountered).
+  * \warning sha256PairSync() must be called before using
+  *          #transaction_hash_hs_ptr directly.
+  */
+static THREAD_LOCAL Sha256Pair hash_pair;
+/** Number of extra signature hashes which are being calculated alongside
+  * #sig_hash_hs_ptr, one for each input listed in a call to
+  * parseTransactionBatch(). This is 0 except while the main (spending)
+  * transaction of a batch is being parsed.
+  * \warning If this is non-zero, #batch_hs must point to an array with at
+  *          least this many hash states.
+  */
+static THREAD_LOCAL uint8_t batch_lanes_active;
+/** Number of inputs to calculate signature hashes for (see
+  * parseTransactionBatch()). This is 0 for parseTransaction(). */
+static THREAD_LOCAL uint8_t batch_count;
+/** Hash states used to calculate the signature hashes of a batch. Lane k
+  * sees the main transaction as it would be signed for input
+  * batch_input_indices[k]: with that input's script included and every other
+  * input script empty. */
+static THREAD_LOCAL HashState *batch_hs;
+/** Input indices (0 = first input) to calculate signature hashes for. This
+  * has #batch_count entries. */
+static THREAD_LOCAL const uint32_t *batch_input_indices;
+/** Signature hashes from a batch will be written here, 32 bytes per lane. */
+static THREAD_LOCAL uint8_t *batch_sig_hashes;
+/** Lane of #batch_hs which should see the input script currently being
+  * read, or #NO_BATCH_LANE if no lane should. */
+static THREAD_LOCAL uint8_t batch_script_lane;
+/** If this is true, the signature hashes of a batch are calculated as
+  * described in BIP 143, using #bip143_state. If this is false, they are
+  * calculated the legacy way, using #batch_hs. */
+static THREAD_LOCAL bool batch_bip143;
+/** State for BIP 143 signature hashes. This is only valid while
+  * #batch_bip143 is true. */
+static THREAD_LOCAL struct BIP143State *bip143_state;
+/** If this is not NULL, all transaction data which is included in the
+  * signature hash will also be written to this hash state. This is used to
+  * calculate BIP 143's hashOutputs. */
+static THREAD_LOCAL HashState *outputs_hs_ptr;
+/** Number of input transactions which have been parsed so far. Since their
+  * order must match the order of the inputs of the main transaction, this
+  * is also the index of the input that the current input transaction
+  * belongs to. */
+static THREAD_LOCAL uint32_t ref_transactions_seen;
+/** Outputs of input transactions which have previously been parsed. */
+static THREAD_LOCAL struct PrevoutCacheEntry prevout_cache[TRANSACTION_PREVOUT_CACHE_ENTRIES];
+/** Index into #prevout_cache of the entry which will be replaced next. */
+static THREAD_LOCAL uint8_t prevout_cache_next;
+
+/** Refill #read_ahead_buffer from the stream device. This reads as much as
+  * will fit in the buffer, but never goes beyond the end of the transaction
+  * data. This must only be called when #read_ahead_buffer is empty and
+  * there is transaction data left to read.
+  */
+static void refillReadAhead(void)
+{
+	uint32_t chunk;
+
+	chunk = transaction_length - transaction_fetch_index;
+	if (chunk > sizeof(read_ahead_buffer))
+	{
+		chunk = sizeof(read_ahead_buffer);
+	}
+	streamGetBytes(read_ahead_buffer, chunk);
+	transaction_fetch_index += chunk;
+	read_ahead_start = 0;
+	read_ahead_end = (uint8_t)chunk;
+}
+
+/** Write transaction data to every hash state which is currently
+  * interested in it. This does nothing if #hs_ptr_valid is false.
+  * \param data The transaction data to hash.
+  * \param length The number of bytes to hash.
+  */
+static void hashTransactionBytes(const uint8_t *data, uint8_t length)
+{
+	uint8_t k;
+
+	if (hs_ptr_valid)
+	{
+		sha256PairWriteBytes(&hash_pair, data, length, !suppress_transaction_hash);
+		for (k = 0; k < batch_lanes_active; k++)
+		{
+			if (!suppress_transaction_hash || (k == batch_script_lane))
+			{
+				sha256WriteBytes(&(batch_hs[k]), data, length);
+			}
+		}
+		if (outputs_hs_ptr != NULL)
+		{
+			sha256WriteBytes(outputs_hs_ptr, data, length);
+		}
+	}
+}
+
+/** Check whether a read of transaction data would go beyond the end of the
+  * transaction data.
+  * \param length The number of bytes that would be read.
+  * \return false if the read is okay, true if it would go beyond the end of
+  *         the transaction data.
+  */
+static bool isReadPastEnd(uint32_t length)
+{
+	if (transaction_data_index > (0xffffffff - length))
+	{
+		// transaction_data_index + length will overflow.
+		// Since transaction_length <= 0xffffffff, this implies that the read
+		// will go past the end of the transaction.
+		return true;
+	}
+	if (transaction_data_index + length > transaction_length)
+	{
+		return true;
+	}
+	return false;
+}
 
 /** Get transaction data by reading from the stream device, checking that
   * the read operation won't go beyond the end of the transaction data.
+  * Data comes out of #read_ahead_buffer, which is refilled from the stream
+  * device in chunks of up to #TRANSACTION_READ_AHEAD bytes.
   * 
-  * Since all transaction data is read using this function, the updating
-  * of #sig_hash_hs_ptr and #transaction_hash_hs_ptr is also done.
+  * Since all transaction data is read using this function (or
+  * skipTransactionBytes()), the updating of #sig_hash_hs_ptr and
+  * #transaction_hash_hs_ptr is also done.
   * \param buffer An array of bytes which will be filled with the transaction
   *               data (if everything goes well). It must have space for
   *               length bytes.
@@ -109,40 +345,192 @@ static HashState *transaction_hash_hs_ptr;
   */
 static bool getTransactionBytes(uint8_t *buffer, uint8_t length)
 {
-	uint8_t i;
-	uint8_t one_byte;
+	uint8_t *ptr;
+	uint8_t remaining;
+	uint8_t chunk;
 
-	if (transaction_data_index > (0xffffffff - (uint32_t)length))
+	if (isReadPastEnd(length))
 	{
-		// transaction_data_index + (uint32_t)length will overflow.
-		// Since transaction_length <= 0xffffffff, this implies that the read
-		// will go past the end of the transaction.
 		return true; // trying to read past end of transaction
 	}
-	if (transaction_data_index + (uint32_t)length > transaction_length)
+	ptr = buffer;
+	remaining = length;
+	while (remaining > 0)
+	{
+		if (read_ahead_start == read_ahead_end)
+		{
+			refillReadAhead();
+		}
+		chunk = (uint8_t)(read_ahead_end - read_ahead_start);
+		if (chunk > remaining)
+		{
+			chunk = remaining;
+		}
+		memcpy(ptr, &(read_ahead_buffer[read_ahead_start]), chunk);
+		read_ahead_start = (uint8_t)(read_ahead_start + chunk);
+		ptr += chunk;
+		remaining = (uint8_t)(remaining - chunk);
+	}
+	hashTransactionBytes(buffer, length);
+	transaction_data_index += length;
+	return false;
+}
+
+/** Read and discard transaction data, for fields which the parser doesn't
+  * need to look at. This has the same effect as calling
+  * getTransactionBytes() once for every byte, but the data is hashed
+  * straight out of #read_ahead_buffer, one refill at a time, instead of
+  * being copied anywhere.
+  * \param length The number of bytes to skip.
+  * \return false on success, true if a stream read error occurred or if the
+  *         read would go beyond the end of the transaction data. If the
+  *         read would go beyond the end, nothing is consumed.
+  */
+static bool skipTransactionBytes(uint32_t length)
+{
+	uint8_t chunk;
+
+	if (isReadPastEnd(length))
 	{
 		return true; // trying to read past end of transaction
 	}
-	else
+	transaction_data_index += length;
+	while (length > 0)
 	{
-		for (i = 0; i < length; i++)
+		if (read_ahead_start == read_ahead_end)
 		{
-			one_byte = streamGetOneByte();
-			buffer[i] = one_byte;
-			if (hs_ptr_valid)
-			{
-				sha256WriteByte(sig_hash_hs_ptr, one_byte);
-				if (!suppress_transaction_hash)
-				{
-					sha256WriteByte(transaction_hash_hs_ptr, one_byte);
-				}
-			}
-			transaction_data_index++;
+			refillReadAhead();
 		}
-		return false;
+		chunk = (uint8_t)(read_ahead_end - read_ahead_start);
+		if (chunk > length)
+		{
+			chunk = (uint8_t)length;
+		}
+		hashTransactionBytes(&(read_ahead_buffer[read_ahead_start]), chunk);
+		read_ahead_start = (uint8_t)(read_ahead_start + chunk);
+		length -= chunk;
+	}
+	return false;
+}
+
+#ifdef TRANSACTION_64BIT_AMOUNTS
+
+/** Convert an amount, as it appears in a transaction, to a native integer.
+  * \param amount The amount, as an 8 byte little-endian array.
+  * \return The amount.
+  */
+static uint64_t readAmount(const uint8_t *amount)
+{
+	return ((uint64_t)readU32LittleEndian(&(amount[4])) << 32) | readU32LittleEndian(amount);
+}
+
+/** Check whether an amount is more than all the money there will ever be.
+  * \param amount The amount, as an 8 byte little-endian array.
+  * \return false if the amount is okay, true if it is too high.
+  */
+static bool isAmountTooHigh(const uint8_t *amount)
+{
+	return readAmount(amount) > MAX_MONEY;
+}
+
+/** Add an input amount to #transaction_fee_amount.
+  * \param amount The amount, as an 8 byte little-endian array.
+  * \return false on success, true if the addition overflowed.
+  */
+static bool addToFee(const uint8_t *amount)
+{
+	uint64_t a;
+
+	a = readAmount(amount);
+	if (transaction_fee_amount > (0xffffffffffffffffULL - a))
+	{
+		return true;
 	}
+	transaction_fee_amount += a;
+	return false;
+}
+
+/** Subtract an output amount from #transaction_fee_amount.
+  * \param amount The amount, as an 8 byte little-endian array.
+  * \return false on success, true if the subtraction underflowed (the
+  *         outputs add up to more than the inputs).
+  */
+static bool subtractFromFee(const uint8_t *amount)
+{
+	uint64_t a;
+
+	a = readAmount(amount);
+	if (a > transaction_fee_amount)
+	{
+		return true;
+	}
+	transaction_fee_amount -= a;
+	return false;
+}
+
+/** Get the value of #transaction_fee_amount.
+  * \param out The fee will be written here, as an 8 byte little-endian
+  *            array.
+  */
+static void getFeeAmount(uint8_t *out)
+{
+	writeU32LittleEndian(out, (uint32_t)transaction_fee_amount);
+	writeU32LittleEndian(&(out[4]), (uint32_t)(transaction_fee_amount >> 32));
+}
+
+/** Set #transaction_fee_amount to 0. */
+static void clearFeeAmount(void)
+{
+	transaction_fee_amount = 0;
+}
+
+#else
+
+/** Check whether an amount is more than all the money there will ever be.
+  * \param amount The amount, as an 8 byte little-endian array.
+  * \return false if the amount is okay, true if it is too high.
+  */
+static bool isAmountTooHigh(const uint8_t *amount)
+{
+	return bigCompareVariableSize((uint8_t *)amount, (uint8_t *)max_money, 8) == BIGCMP_GREATER;
+}
+
+/** Add an input amount to #transaction_fee_amount.
+  * \param amount The amount, as an 8 byte little-endian array.
+  * \return false on success, true if the addition overflowed.
+  */
+static bool addToFee(const uint8_t *amount)
+{
+	return bigAddVariableSizeNoModulo(transaction_fee_amount, transaction_fee_amount, (uint8_t *)amount, 8) != 0;
+}
+
+/** Subtract an output amount from #transaction_fee_amount.
+  * \param amount The amount, as an 8 byte little-endian array.
+  * \return false on success, true if the subtraction underflowed (the
+  *         outputs add up to more than the inputs).
+  */
+static bool subtractFromFee(const uint8_t *amount)
+{
+	return bigSubtractVariableSizeNoModulo(transaction_fee_amount, transaction_fee_amount, (uint8_t *)amount, 8) != 0;
+}
+
+/** Get the value of #transaction_fee_amount.
+  * \param out The fee will be written here, as an 8 byte little-endian
+  *            array.
+  */
+static void getFeeAmount(uint8_t *out)
+{
+	memcpy(out, transaction_fee_amount, sizeof(transaction_fee_amount));
+}
+
+/** Set #transaction_fee_amount to 0. */
+static void clearFeeAmount(void)
+{
+	memset(transaction_fee_amount, 0, sizeof(transaction_fee_amount));
 }
 
+#endif // #ifdef TRANSACTION_64BIT_AMOUNTS
+
 /** Checks whether the transaction parser is at the end of the transaction
   * data.
   * \return false if not at the end of the transaction data, true if at the
@@ -204,6 +592,142 @@ static bool getVarInt(uint32_t *out)
 	return false; // success
 }
 
+/** Calculate the BIP 143 signature hash of every input in a batch, using
+  * the midstates in #bip143_state. This should be called after the whole of
+  * the main transaction has been successfully parsed. Since the
+  * transaction parser only accepts version 1 transactions with a locktime
+  * of 0 and a hashtype of 1, those fields aren't stored anywhere.
+  */
+static void finishBIP143SigHashes(void)
+{
+	uint8_t hash_prevouts[32];
+	uint8_t hash_sequence[32];
+	uint8_t hash_outputs[32];
+	uint8_t temp[4];
+	HashState hs;
+	struct BIP143Input *input;
+	uint8_t k;
+
+	sha256FinishDouble(&(bip143_state->prevouts_hs));
+	writeHashToByteArray(hash_prevouts, &(bip143_state->prevouts_hs), true);
+	sha256FinishDouble(&(bip143_state->sequence_hs));
+	writeHashToByteArray(hash_sequence, &(bip143_state->sequence_hs), true);
+	sha256FinishDouble(&(bip143_state->outputs_hs));
+	writeHashToByteArray(hash_outputs, &(bip143_state->outputs_hs), true);
+	for (k = 0; k < batch_count; k++)
+	{
+		input = &(bip143_state->inputs[k]);
+		sha256Begin(&hs);
+		writeU32LittleEndian(temp, 0x00000001); // version
+		sha256WriteBytes(&hs, temp, 4);
+		sha256WriteBytes(&hs, hash_prevouts, 32);
+		sha256WriteBytes(&hs, hash_sequence, 32);
+		sha256WriteBytes(&hs, input->outpoint, 36);
+		sha256WriteByte(&hs, sizeof(input->script_code));
+		sha256WriteBytes(&hs, input->script_code, sizeof(input->script_code));
+		sha256WriteBytes(&hs, input->amount, 8);
+		writeU32LittleEndian(temp, 0xFFFFFFFF); // sequence
+		sha256WriteBytes(&hs, temp, 4);
+		sha256WriteBytes(&hs, hash_outputs, 32);
+		writeU32LittleEndian(temp, 0x00000000); // locktime
+		sha256WriteBytes(&hs, temp, 4);
+		writeU32LittleEndian(temp, 0x00000001); // hashtype
+		sha256WriteBytes(&hs, temp, 4);
+		sha256FinishDouble(&hs);
+		writeHashToByteArray(&(batch_sig_hashes[k * 32]), &hs, false);
+	}
+}
+
+/** Find an entry of #prevout_cache.
+  * \param outpoint The outpoint (reference hash followed by output number) to
+  *                 look for.
+  * \return A pointer to the entry, or NULL if the outpoint isn't cached.
+  */
+static struct PrevoutCacheEntry *prevoutCacheLookup(const uint8_t *outpoint)
+{
+	uint8_t i;
+
+	for (i = 0; i < TRANSACTION_PREVOUT_CACHE_ENTRIES; i++)
+	{
+		if (prevout_cache[i].valid && !memcmp(prevout_cache[i].outpoint, outpoint, sizeof(prevout_cache[i].outpoint)))
+		{
+			return &(prevout_cache[i]);
+		}
+	}
+	return NULL;
+}
+
+/** Remember an output of an input transaction in #prevout_cache. If the
+  * output is already cached, its entry is updated, otherwise the oldest
+  * entry is replaced.
+  * \param outpoint The outpoint (reference hash followed by output number) of
+  *                 the output.
+  * \param amount The amount of the output.
+  */
+static void prevoutCacheStore(const uint8_t *outpoint, const uint8_t *amount)
+{
+	struct PrevoutCacheEntry *entry;
+
+	entry = prevoutCacheLookup(outpoint);
+	if (entry == NULL)
+	{
+		entry = &(prevout_cache[prevout_cache_next]);
+		prevout_cache_next++;
+		if (prevout_cache_next >= TRANSACTION_PREVOUT_CACHE_ENTRIES)
+		{
+			prevout_cache_next = 0;
+		}
+	}
+	memcpy(entry->outpoint, outpoint, sizeof(entry->outpoint));
+	memcpy(entry->amount, amount, sizeof(entry->amount));
+	entry->valid = true;
+}
+
+/** Parse a cached input reference, which stands in for an input transaction
+  * which was parsed in full by an earlier call to parseTransaction() or
+  * parseTransactionBatch(). This does everything parsing the input
+  * transaction would have done, using the amount from #prevout_cache.
+  * \param ref_compare_hs See parseTransactionInternal().
+  * \return See parseTransaction().
+  */
+static TransactionErrors parseCachedReference(HashState *ref_compare_hs)
+{
+	uint8_t outpoint[36];
+	struct PrevoutCacheEntry *entry;
+	uint8_t k;
+
+	if (getTransactionBytes(outpoint, 36))
+	{
+		return TRANSACTION_INVALID_FORMAT; // transaction truncated
+	}
+	entry = prevoutCacheLookup(outpoint);
+	if (entry == NULL)
+	{
+		return TRANSACTION_PREVOUT_NOT_CACHED; // input transaction must be sent
+	}
+	// This has to match what is written for a full input transaction: the
+	// output number, then the (backwards) input transaction hash.
+	sha256WriteBytes(ref_compare_hs, &(outpoint[32]), 4);
+	sha256WriteBytes(ref_compare_hs, outpoint, 32);
+	if (addToFee(entry->amount))
+	{
+		return TRANSACTION_INVALID_AMOUNT; // overflow occurred (carry occurred)
+	}
+	if (batch_bip143)
+	{
+		// BIP 143 signature hashes commit to input amounts.
+		for (k = 0; k < batch_count; k++)
+		{
+			if (batch_input_indices[k] == ref_transactions_seen)
+			{
+				memcpy(bip143_state->inputs[k].amount, entry->amount, 8);
+			}
+		}
+	}
+	ref_transactions_seen++;
+	return TRANSACTION_NO_ERROR;
+}
+
 /** See comments for parseTransaction() for description of what this does
   * and return values. However, the guts of the transaction parser are in
   * the code to this function.
@@ -226,17 +750,26 @@ static TransactionErrors parseTransactionInternal(BigNum256 sig_hash, BigNum256
 {
 	uint8_t temp[32];
 	uint8_t ref_compare_hash[32];
+	uint8_t ref_outpoint[36];
+	uint8_t ref_amount[8];
 	uint32_t num_inputs;
 	uint32_t num_outputs;
 	uint32_t script_length;
 	uint8_t input_reference_num_buffer[4];
 	uint16_t i;
 	uint8_t j;
-	uint32_t k;
+	uint8_t k;
+	uint8_t lanes_found;
+	uint8_t lanes_expected;
+	uint8_t bip143_lane;
 	uint32_t output_num_select;
 	bool is_ref;
+	bool bip143_active;
+	OutputDescriptor output;
+#ifndef DEFER_OUTPUT_FORMATTING
 	char text_amount[TEXT_AMOUNT_LENGTH];
 	char text_address[TEXT_ADDRESS_LENGTH];
+#endif // #ifndef DEFER_OUTPUT_FORMATTING
 
 	if (transaction_length > MAX_TRANSACTION_SIZE)
 	{
@@ -252,7 +785,7 @@ static TransactionErrors parseTransactionInternal(BigNum256 sig_hash, BigNum256
 	{
 		return TRANSACTION_INVALID_FORMAT; // transaction truncated
 	}
-	if (temp[0] != 0)
+	if (temp[0] != TRANSACTION_TYPE_MAIN)
 	{
 		is_ref = true;
 	}
@@ -261,6 +794,10 @@ static TransactionErrors parseTransactionInternal(BigNum256 sig_hash, BigNum256
 		is_ref = false;
 	}
 	*is_ref_out = is_ref;
+	if (temp[0] == TRANSACTION_TYPE_CACHED_REF)
+	{
+		return parseCachedReference(ref_compare_hs);
+	}
 
 	output_num_select = 0;
 	if (is_ref)
@@ -270,10 +807,8 @@ static TransactionErrors parseTransactionInternal(BigNum256 sig_hash, BigNum256
 		{
 			return TRANSACTION_INVALID_FORMAT; // transaction truncated
 		}
-		for (j = 0; j < 4; j++)
-		{
-			sha256WriteByte(ref_compare_hs, temp[j]);
-		}
+		sha256WriteBytes(ref_compare_hs, temp, 4);
+		memcpy(&(ref_outpoint[32]), temp, 4);
 		output_num_select = readU32LittleEndian(temp);
 	}
 	else
@@ -284,8 +819,30 @@ static TransactionErrors parseTransactionInternal(BigNum256 sig_hash, BigNum256
 		sha256Begin(ref_compare_hs);
 	}
 
-	sha256Begin(sig_hash_hs_ptr);
-	sha256Begin(transaction_hash_hs_ptr);
+	sha256PairBegin(&hash_pair, sig_hash_hs_ptr, transaction_hash_hs_ptr);
+	bip143_active = false;
+	lanes_expected = 0;
+	if (!is_ref)
+	{
+		if (batch_bip143)
+		{
+			sha256Begin(&(bip143_state->prevouts_hs));
+			sha256Begin(&(bip143_state->sequence_hs));
+			sha256Begin(&(bip143_state->outputs_hs));
+			bip143_active = true;
+		}
+		else
+		{
+			for (k = 0; k < batch_count; k++)
+			{
+				sha256Begin(&(batch_hs[k]));
+			}
+			batch_lanes_active = batch_count;
+		}
+		lanes_expected = batch_count;
+	}
+	batch_script_lane = NO_BATCH_LANE;
+	lanes_found = 0;
 	hs_ptr_valid = true;
 	suppress_transaction_hash = false;
 
@@ -316,25 +873,44 @@ static TransactionErrors parseTransactionInternal(BigNum256 sig_hash, BigNum256
 	// Process each input.
 	for (i = 0; i < num_inputs; i++)
 	{
-		// Get input transaction reference hash.
-		if (getTransactionBytes(temp, 32))
-		{
-			return TRANSACTION_INVALID_FORMAT; // transaction truncated
-		}
-		// Get input transaction reference number.
-		if (getTransactionBytes(input_reference_num_buffer, 4))
+		if (is_ref)
 		{
-			return TRANSACTION_INVALID_FORMAT; // transaction truncated
+			// Input references of input transactions aren't checked, so
+			// skip the reference hash and number.
+			if (skipTransactionBytes(36))
+			{
+				return TRANSACTION_INVALID_FORMAT; // transaction truncated
+			}
 		}
-		if (!is_ref)
+		else
 		{
-			for (j = 0; j < 4; j++)
+			// Get input transaction reference hash.
+			if (getTransactionBytes(temp, 32))
+			{
+				return TRANSACTION_INVALID_FORMAT; // transaction truncated
+			}
+			// Get input transaction reference number.
+			if (getTransactionBytes(input_reference_num_buffer, 4))
 			{
-				sha256WriteByte(ref_compare_hs, input_reference_num_buffer[j]);
+				return TRANSACTION_INVALID_FORMAT; // transaction truncated
 			}
-			for (j = 0; j < 32; j++)
+			sha256WriteBytes(ref_compare_hs, input_reference_num_buffer, 4);
+			sha256WriteBytes(ref_compare_hs, temp, 32);
+		}
+		bip143_lane = NO_BATCH_LANE;
+		if (bip143_active)
+		{
+			sha256WriteBytes(&(bip143_state->prevouts_hs), temp, 32);
+			sha256WriteBytes(&(bip143_state->prevouts_hs), input_reference_num_buffer, 4);
+			for (k = 0; k < batch_count; k++)
 			{
-				sha256WriteByte(ref_compare_hs, temp[j]);
+				if (batch_input_indices[k] == i)
+				{
+					bip143_lane = k;
+					lanes_found++;
+					memcpy(bip143_state->inputs[k].outpoint, temp, 32);
+					memcpy(&(bip143_state->inputs[k].outpoint[32]), input_reference_num_buffer, 4);
+				}
 			}
 		}
 		// The Bitcoin protocol for signing a transaction involves replacing
@@ -345,20 +921,56 @@ static TransactionErrors parseTransactionInternal(BigNum256 sig_hash, BigNum256
 		// which input is being signed for, so the calculation of the
 		// transaction hash ignores input scripts.
 		suppress_transaction_hash = true;
+		// In a batch, only the lane signing for this input sees its script.
+		// Every other lane sees an empty script.
+		for (k = 0; k < batch_lanes_active; k++)
+		{
+			if (batch_input_indices[k] == i)
+			{
+				batch_script_lane = k;
+				lanes_found++;
+			}
+			else
+			{
+				sha256WriteByte(&(batch_hs[k]), 0x00);
+			}
+		}
 		// Get input script length.
 		if (getVarInt(&script_length))
 		{
 			return TRANSACTION_INVALID_FORMAT; // transaction truncated or varint too big
 		}
-		// Skip the script because it's useless here.
-		for (k = 0; k < script_length; k++)
+		if (bip143_lane != NO_BATCH_LANE)
 		{
-			if (getTransactionBytes(temp, 1))
+			// BIP 143 needs the script to become the scriptCode of the
+			// input. Only pay to public key hash scripts are supported.
+			if (script_length != sizeof(bip143_state->inputs[bip143_lane].script_code))
+			{
+				return TRANSACTION_NON_STANDARD; // nonstandard script
+			}
+			if (getTransactionBytes(bip143_state->inputs[bip143_lane].script_code, (uint8_t)script_length))
+			{
+				return TRANSACTION_INVALID_FORMAT; // transaction truncated
+			}
+			if ((bip143_state->inputs[bip143_lane].script_code[0] != 0x76)
+				|| (bip143_state->inputs[bip143_lane].script_code[1] != 0xa9)
+				|| (bip143_state->inputs[bip143_lane].script_code[2] != 0x14)
+				|| (bip143_state->inputs[bip143_lane].script_code[23] != 0x88)
+				|| (bip143_state->inputs[bip143_lane].script_code[24] != 0xac))
+			{
+				return TRANSACTION_NON_STANDARD; // nonstandard script
+			}
+		}
+		else
+		{
+			// Skip the script because it's useless here.
+			if (skipTransactionBytes(script_length))
 			{
 				return TRANSACTION_INVALID_FORMAT; // transaction truncated
 			}
 		}
 		suppress_transaction_hash = false;
+		batch_script_lane = NO_BATCH_LANE;
 		// Check sequence. Since locktime is checked below, this check
 		// is probably superfluous. But it's better to be safe than sorry.
 		if (getTransactionBytes(temp, 4))
@@ -369,7 +981,15 @@ static TransactionErrors parseTransactionInternal(BigNum256 sig_hash, BigNum256
 		{
 			return TRANSACTION_NON_STANDARD; // replacement not supported
 		}
+		if (bip143_active)
+		{
+			sha256WriteBytes(&(bip143_state->sequence_hs), temp, 4);
+		}
 	} // end for (i = 0; i < num_inputs; i++)
+	if (lanes_found != lanes_expected)
+	{
+		return TRANSACTION_INVALID_REFERENCE; // batch input index out of range
+	}
 
 	if (!is_ref)
 	{
@@ -403,6 +1023,10 @@ static TransactionErrors parseTransactionInternal(BigNum256 sig_hash, BigNum256
 		}
 	}
 
+	if (bip143_active)
+	{
+		outputs_hs_ptr = &(bip143_state->outputs_hs);
+	}
 	// Process each output.
 	for (i = 0; i < num_outputs; i++)
 	{
@@ -411,7 +1035,7 @@ static TransactionErrors parseTransactionInternal(BigNum256 sig_hash, BigNum256
 		{
 			return TRANSACTION_INVALID_FORMAT; // transaction truncated
 		}
-		if (bigCompareVariableSize(temp, (uint8_t *)max_money, 8) == BIGCMP_GREATER)
+		if (isAmountTooHigh(temp))
 		{
 			return TRANSACTION_INVALID_AMOUNT; // amount too high
 		}
@@ -419,19 +1043,31 @@ static TransactionErrors parseTransactionInternal(BigNum256 sig_hash, BigNum256
 		{
 			if (i == output_num_select)
 			{
-				if (bigAddVariableSizeNoModulo(transaction_fee_amount, transaction_fee_amount, temp, 8))
+				if (addToFee(temp))
 				{
 					return TRANSACTION_INVALID_AMOUNT; // overflow occurred (carry occurred)
 				}
+				memcpy(ref_amount, temp, 8);
+				if (batch_bip143)
+				{
+					// BIP 143 signature hashes commit to input amounts.
+					for (k = 0; k < batch_count; k++)
+					{
+						if (batch_input_indices[k] == ref_transactions_seen)
+						{
+							memcpy(bip143_state->inputs[k].amount, temp, 8);
+						}
+					}
+				}
 			}
 		}
 		else
 		{
-			if (bigSubtractVariableSizeNoModulo(transaction_fee_amount, transaction_fee_amount, temp, 8))
+			if (subtractFromFee(temp))
 			{
 				return TRANSACTION_INVALID_AMOUNT; // overflow occurred (borrow occurred)
 			}
-			amountToText(text_amount, temp);
+			memcpy(output.amount, temp, 8);
 		}
 		// Get output script length.
 		if (getVarInt(&script_length))
@@ -442,12 +1078,9 @@ static TransactionErrors parseTransactionInternal(BigNum256 sig_hash, BigNum256
 		{
 			// The actual output scripts of input transactions don't need to
 			// be parsed (only the amount matters), so skip the script.
-			for (k = 0; k < script_length; k++)
+			if (skipTransactionBytes(script_length))
 			{
-				if (getTransactionBytes(temp, 1))
-				{
-					return TRANSACTION_INVALID_FORMAT; // transaction truncated
-				}
+				return TRANSACTION_INVALID_FORMAT; // transaction truncated
 			}
 		}
 		else
@@ -470,7 +1103,8 @@ static TransactionErrors parseTransactionInternal(BigNum256 sig_hash, BigNum256
 				{
 					return TRANSACTION_INVALID_FORMAT; // transaction truncated
 				}
-				hashToAddr(text_address, temp, ADDRESS_VERSION_PUBKEY);
+				output.address_version = ADDRESS_VERSION_PUBKEY;
+				memcpy(output.hash, temp, 20);
 				// Look for: OP_EQUALVERIFY OP_CHECKSIG.
 				if (getTransactionBytes(temp, 2))
 				{
@@ -497,7 +1131,8 @@ static TransactionErrors parseTransactionInternal(BigNum256 sig_hash, BigNum256
 				{
 					return TRANSACTION_INVALID_FORMAT; // transaction truncated
 				}
-				hashToAddr(text_address, temp, ADDRESS_VERSION_P2SH);
+				output.address_version = ADDRESS_VERSION_P2SH;
+				memcpy(output.hash, temp, 20);
 				// Look for: OP_EQUAL.
 				if (getTransactionBytes(temp, 1))
 				{
@@ -512,12 +1147,18 @@ static TransactionErrors parseTransactionInternal(BigNum256 sig_hash, BigNum256
 			{
 				return TRANSACTION_NON_STANDARD; // nonstandard transaction
 			}
+#ifdef DEFER_OUTPUT_FORMATTING
+			if (newOutputSeen(&output))
+#else
+			outputDescriptorToText(text_amount, text_address, &output);
 			if (newOutputSeen(text_amount, text_address))
+#endif // #ifdef DEFER_OUTPUT_FORMATTING
 			{
 				return TRANSACTION_TOO_MANY_OUTPUTS; // too many outputs
 			}
 		} // end if (is_ref)
 	} // end for (i = 0; i < num_outputs; i++)
+	outputs_hs_ptr = NULL;
 
 	// Check locktime.
 	if (getTransactionBytes(temp, 4))
@@ -547,13 +1188,20 @@ static TransactionErrors parseTransactionInternal(BigNum256 sig_hash, BigNum256
 			return TRANSACTION_INVALID_FORMAT; // junk at end of transaction data
 		}
 
-		if (!bigIsZeroVariableSize(transaction_fee_amount, sizeof(transaction_fee_amount)))
+		getFeeAmount(temp);
+		if (!bigIsZeroVariableSize(temp, 8))
 		{
-			amountToText(text_amount, transaction_fee_amount);
+#ifdef DEFER_OUTPUT_FORMATTING
+			setTransactionFee(temp);
+#else
+			amountToText(text_amount, temp);
 			setTransactionFee(text_amount);
+#endif // #ifdef DEFER_OUTPUT_FORMATTING
 		}
 	}
 
+	// Lane B must be brought up to date before lane A is finished.
+	sha256PairSync(&hash_pair);
 	sha256FinishDouble(sig_hash_hs_ptr);
 	// The signature hash is written in a little-endian format because it
 	// is used as a little-endian multi-precision integer in
@@ -561,6 +1209,15 @@ static TransactionErrors parseTransactionInternal(BigNum256 sig_hash, BigNum256
 	writeHashToByteArray(sig_hash, sig_hash_hs_ptr, false);
 	sha256FinishDouble(transaction_hash_hs_ptr);
 	writeHashToByteArray(transaction_hash, transaction_hash_hs_ptr, false);
+	for (k = 0; k < batch_lanes_active; k++)
+	{
+		sha256FinishDouble(&(batch_hs[k]));
+		writeHashToByteArray(&(batch_sig_hashes[k * 32]), &(batch_hs[k]), false);
+	}
+	if (bip143_active)
+	{
+		finishBIP143SigHashes();
+	}
 
 	if (is_ref)
 	{
@@ -569,12 +1226,67 @@ static TransactionErrors parseTransactionInternal(BigNum256 sig_hash, BigNum256
 		for (j = 32; j--; )
 		{
 			sha256WriteByte(ref_compare_hs, sig_hash[j]);
+			ref_outpoint[31 - j] = sig_hash[j];
 		}
+		prevoutCacheStore(ref_outpoint, ref_amount);
+		ref_transactions_seen++;
 	}
 
 	return TRANSACTION_NO_ERROR;
 }
 
+/** Parse the input stream as a bunch of concatenated transactions, as
+  * described in the comments for parseTransaction(). This is the part that is
+  * common to parseTransaction() and parseTransactionBatch(); the caller must
+  * set up #batch_count and #batch_bip143 (and if #batch_count is non-zero,
+  * the other batch variables) beforehand.
+  * \param sig_hash See parseTransaction().
+  * \param transaction_hash See parseTransaction().
+  * \param length See parseTransaction().
+  * \return See parseTransaction().
+  */
+static TransactionErrors parseTransactionCommon(BigNum256 sig_hash, BigNum256 transaction_hash, uint32_t length)
+{
+	TransactionErrors r;
+	bool is_ref;
+	HashState sig_hash_hs;
+	HashState transaction_hash_hs;
+	HashState ref_compare_hs;
+
+	traceEvent(TRACE_PARSE_BEGIN, length);
+	hs_ptr_valid = false;
+	transaction_data_index = 0;
+	transaction_length = length;
+	transaction_fetch_index = 0;
+	read_ahead_start = 0;
+	read_ahead_end = 0;
+	clearFeeAmount();
+	sig_hash_hs_ptr = &sig_hash_hs;
+	transaction_hash_hs_ptr = &transaction_hash_hs;
+	sha256Begin(&ref_compare_hs);
+	ref_transactions_seen = 0;
+	outputs_hs_ptr = NULL;
+
+	hs_ptr_valid = true;
+	do
+	{
+		r = parseTransactionInternal(sig_hash, transaction_hash, &is_ref, &ref_compare_hs);
+	} while ((r == TRANSACTION_NO_ERROR) && is_ref);
+	batch_lanes_active = 0;
+	outputs_hs_ptr = NULL;
+	hs_ptr_valid = false;
+
+	// Always try to consume the entire stream. Nothing is being hashed any
+	// more, so anything left in the read-ahead buffer can simply be dropped
+	// and the rest of the transaction discarded without being looked at.
+	streamDiscardBytes(transaction_length - transaction_fetch_index);
+	transaction_fetch_index = transaction_length;
+	transaction_data_index = transaction_length;
+	read_ahead_start = read_ahead_end;
+	traceEvent(TRACE_PARSE_END, r);
+	return r;
+}
+
 /** Parse a Bitcoin transaction, extracting the output amounts/addresses,
   * validating the transaction (ensuring that it is "standard") and computing
   * a double SHA-256 hash of the transaction. This double SHA-256 hash is the
@@ -600,6 +1312,19 @@ static TransactionErrors parseTransactionInternal(BigNum256 sig_hash, BigNum256
   * amounts is to look at the output amounts of the transactions the inputs
   * refer to.
   *
+  * Each transaction in the input stream is preceded by one byte: 0x00 for
+  * the spending transaction, 0x01 for an input transaction. An input
+  * transaction is then followed by the 4 byte output number of the output
+  * which is spent. Sending every input transaction for every signing
+  * session is expensive, so the transaction parser remembers the outputs
+  * of input transactions it has parsed (see
+  * #TRANSACTION_PREVOUT_CACHE_ENTRIES). If an output has been remembered, its
+  * input transaction can be replaced by 0x02 followed by the 36 byte
+  * outpoint (reference hash followed by output number, exactly as it
+  * appears in the input of the spending transaction). If the output isn't
+  * remembered, #TRANSACTION_PREVOUT_NOT_CACHED is returned and the host
+  * should send the full input transaction instead.
+  *
   * \param sig_hash The signature hash will be written here (if everything
   *                 goes well), as a 32 byte little-endian multi-precision
   *                 number.
@@ -615,34 +1340,106 @@ static TransactionErrors parseTransactionInternal(BigNum256 sig_hash, BigNum256
 TransactionErrors parseTransaction(BigNum256 sig_hash, BigNum256 transaction_hash, uint32_t length)
 {
 	TransactionErrors r;
-	uint8_t junk;
-	bool is_ref;
-	HashState sig_hash_hs;
-	HashState transaction_hash_hs;
-	HashState ref_compare_hs;
 
-	hs_ptr_valid = false;
-	transaction_data_index = 0;
-	transaction_length = length;
-	memset(transaction_fee_amount, 0, sizeof(transaction_fee_amount));
-	sig_hash_hs_ptr = &sig_hash_hs;
-	transaction_hash_hs_ptr = &transaction_hash_hs;
-	sha256Begin(&ref_compare_hs);
+	batch_count = 0;
+	batch_bip143 = false;
+	performanceBurstBegin();
+	r = parseTransactionCommon(sig_hash, transaction_hash, length);
+	performanceBurstEnd();
+	return r;
+}
 
-	hs_ptr_valid = true;
-	do
+/** Parse a Bitcoin transaction, just like parseTransaction(), but calculate
+  * the signature hashes for several inputs at once. This way the input
+  * transactions only need to be sent, parsed and approved once, no matter
+  * how many inputs need to be signed.
+  *
+  * The input stream should have the same format as for parseTransaction(),
+  * except that the spending transaction should have the appropriate
+  * (referenced output) script in the input script of every input listed in
+  * input_indices. When calculating the signature hash for one of those
+  * inputs, all other input scripts are treated as empty, regardless of what
+  * the input stream contains for them. Thus each signature hash is identical
+  * to what parseTransaction() would calculate when signing for that input
+  * alone.
+  *
+  * Alternatively, if use_bip143 is true, the signature hashes are calculated
+  * as described in BIP 143, for pay to witness public key hash inputs. The
+  * hashPrevouts, hashSequence and hashOutputs midstates are calculated once
+  * for the whole transaction, so the extra work for each input has a
+  * constant size. In this case, the input script of every listed input must
+  * be the input's scriptCode (the pay to public key hash script which
+  * corresponds to its witness program), and the amount of each listed input
+  * is taken from the corresponding input transaction.
+  * \param sig_hashes The signature hashes will be written here (if
+  *                   everything goes well), one 32 byte little-endian
+  *                   multi-precision number for each entry of input_indices,
+  *                   in the same order. This must have space for
+  *                   count * 32 bytes.
+  * \param transaction_hash See parseTransaction().
+  * \param length See parseTransaction().
+  * \param input_indices Indices (0 = first input) of the inputs to calculate
+  *                      signature hashes for. There must be no duplicates.
+  * \param count Number of entries in input_indices. This must be between 1
+  *              and #TRANSACTION_MAX_BATCH inclusive.
+  * \param use_bip143 false to calculate legacy signature hashes, true to
+  *                   calculate BIP 143 signature hashes.
+  * \return One of the values in #TransactionErrorsEnum.
+  *         #TRANSACTION_INVALID_REFERENCE will be returned if input_indices
+  *         or count are invalid.
+  */
+TransactionErrors parseTransactionBatch(uint8_t *sig_hashes, BigNum256 transaction_hash, uint32_t length, const uint32_t *input_indices, uint8_t count, bool use_bip143)
+{
+	TransactionErrors r;
+	union BatchStorageUnion storage;
+	uint8_t unused_sig_hash[32];
+	uint8_t i;
+	uint8_t j;
+	bool indices_valid;
+
+	indices_valid = true;
+	if ((count == 0) || (count > TRANSACTION_MAX_BATCH))
 	{
-		r = parseTransactionInternal(sig_hash, transaction_hash, &is_ref, &ref_compare_hs);
-	} while ((r == TRANSACTION_NO_ERROR) && is_ref);
-	hs_ptr_valid = false;
+		indices_valid = false;
+	}
+	else
+	{
+		for (i = 0; i < count; i++)
+		{
+			for (j = (uint8_t)(i + 1); j < count; j++)
+			{
+				if (input_indices[i] == input_indices[j])
+				{
+					indices_valid = false;
+				}
+			}
+		}
+	}
 
-	// Always try to consume the entire stream.
-	while (!isEndOfTransactionData())
+	if (indices_valid)
 	{
-		if (getTransactionBytes(&junk, 1))
-		{
-			break;
-		}
+		batch_hs = storage.lanes;
+		bip143_state = &(storage.bip143);
+		batch_input_indices = input_indices;
+		batch_sig_hashes = sig_hashes;
+		batch_count = count;
+		batch_bip143 = use_bip143;
+	}
+	else
+	{
+		// Parse the transaction anyway, so that the input stream is
+		// consumed in the same way as for any other parse error.
+		batch_count = 0;
+		batch_bip143 = false;
+	}
+	performanceBurstBegin();
+	r = parseTransactionCommon(unused_sig_hash, transaction_hash, length);
+	performanceBurstEnd();
+	batch_count = 0;
+	batch_bip143 = false;
+	if (!indices_valid)
+	{
+		return TRANSACTION_INVALID_REFERENCE;
 	}
 	return r;
 }
@@ -676,8 +1473,9 @@ static uint8_t encapsulateSignature(uint8_t *signature, BigNum256 r, BigNum256 s
 	uint8_t sequence_length;
 	uint8_t i;
 
-	memcpy(&(signature[R_OFFSET + 1]), r, 32);
-	memcpy(&(signature[S_OFFSET + 1]), s, 32);
+	// Integers in DER are big-endian.
+	bigStoreBigEndian(&(signature[R_OFFSET + 1]), r);
+	bigStoreBigEndian(&(signature[S_OFFSET + 1]), s);
 	// Place an extra leading zero in front of r and s, just in case their
 	// most significant bit is 1.
 	// Integers in DER are always 2s-complement signed, but r and s are
@@ -689,10 +1487,6 @@ static uint8_t encapsulateSignature(uint8_t *signature, BigNum256 r, BigNum256 s
 	signature[R_OFFSET] = 0x00;
 	signature[S_OFFSET] = 0x00;
 
-	// Integers in DER are big-endian.
-	swapEndian256(&(signature[R_OFFSET + 1]));
-	swapEndian256(&(signature[S_OFFSET + 1]));
-
 	sequence_length = 0x46; // 2 + 33 + 2 + 33
 	signature[R_OFFSET - 2] = 0x02; // INTEGER
 	signature[R_OFFSET - 1] = 0x21; // length of INTEGER
@@ -756,17 +1550,32 @@ static uint8_t encapsulateSignature(uint8_t *signature, BigNum256 r, BigNum256 s
   *                 parseTransaction()).
   * \param private_key The private key to sign the transaction with. This must
   *                    be a 32 byte little-endian multi-precision integer.
-  * \return false on success, or true if an error occurred while trying to
-  *         obtain a random number.
+  * \return false on success, or true if the signature failed
+  *         self-verification (this can only happen if
+  *         TRANSACTION_VERIFY_SIGNATURES is defined). If the signature failed
+  *         self-verification, nothing will be written to signature.
   */
-void signTransaction(uint8_t *signature, uint8_t *out_length, BigNum256 sig_hash, BigNum256 private_key)
+bool signTransaction(uint8_t *signature, uint8_t *out_length, BigNum256 sig_hash, BigNum256 private_key)
 {
 	uint8_t r[32];
 	uint8_t s[32];
+#ifdef TRANSACTION_VERIFY_SIGNATURES
+	PointAffine public_key;
+#endif // #ifdef TRANSACTION_VERIFY_SIGNATURES
 
 	*out_length = 0;
+	traceEvent(TRACE_SIGN_BEGIN, 0);
 	ecdsaSign(r, s, sig_hash, private_key);
+	traceEvent(TRACE_SIGN_END, 0);
+#ifdef TRANSACTION_VERIFY_SIGNATURES
+	pointMultiplyBase(&public_key, private_key);
+	if (ecdsaVerify(r, s, sig_hash, &public_key))
+	{
+		return true;
+	}
+#endif // #ifdef TRANSACTION_VERIFY_SIGNATURES
 	*out_length = encapsulateSignature(signature, r, s);
+	return false;
 }
 
 #ifdef TEST
@@ -774,19 +1583,53 @@ void signTransaction(uint8_t *signature, uint8_t *out_length, BigNum256 sig_hash
 /** Number of outputs seen. */
 static int num_outputs_seen;
 
+#ifdef DEFER_OUTPUT_FORMATTING
+
+bool newOutputSeen(OutputDescriptor *output)
+{
+	char text_amount[TEXT_AMOUNT_LENGTH];
+	char text_address[TEXT_ADDRESS_LENGTH];
+
+	outputDescriptorToText(text_amount, text_address, output);
+#ifndef BENCH
+	printf("Amount: %s\n", text_amount);
+	printf("Address: %s\n", text_address);
+#endif // #ifndef BENCH
+	num_outputs_seen++;
+	return false; // success
+}
+
+void setTransactionFee(uint8_t *amount)
+{
+	char text_amount[TEXT_AMOUNT_LENGTH];
+
+	amountToText(text_amount, amount);
+#ifndef BENCH
+	printf("Transaction fee: %s\n", text_amount);
+#endif // #ifndef BENCH
+}
+
+#else
+
 bool newOutputSeen(char *text_amount, char *text_address)
 {
+#ifndef BENCH
 	printf("Amount: %s\n", text_amount);
 	printf("Address: %s\n", text_address);
+#endif // #ifndef BENCH
 	num_outputs_seen++;
 	return false; // success
 }
 
 void setTransactionFee(char *text_amount)
 {
+#ifndef BENCH
 	printf("Transaction fee: %s\n", text_amount);
+#endif // #ifndef BENCH
 }
 
+#endif // #ifdef DEFER_OUTPUT_FORMATTING
+
 void clearOutputsSeen(void)
 {
 	num_outputs_seen = 0;
@@ -892,6 +1735,10 @@ static const uint8_t good_full_transaction[] = {
 0x01, 0x00, 0x00, 0x00 // hashtype
 };
 
+#endif // #ifdef TEST_TRANSACTION
+
+#if defined(TEST_TRANSACTION) || defined(BENCH_TRANSACTION)
+
 /** The input transaction from #good_full_transaction. */
 static const uint8_t good_input_transaction[] = {
 0x01, 0x00, 0x00, 0x00, // output number to examine
@@ -986,36 +1833,6 @@ static const uint8_t good_main_transaction[] = {
 0x01, 0x00, 0x00, 0x00 // hashtype
 };
 
-/** The main transaction from #good_full_transaction, with the inputs
-  * removed. */
-static const uint8_t inputs_removed_transaction[] = {
-0x01, 0x00, 0x00, 0x00, // version
-0x01, // number of inputs
-0x02, // number of outputs
-0x00, 0x46, 0xc3, 0x23, 0x00, 0x00, 0x00, 0x00, // 6 BTC
-0x19, // script length
-0x76, // OP_DUP
-0xA9, // OP_HASH160
-0x14, // 20 bytes of data follows
-// 11MXTrefsj1ZS3Q5e9D6DxGzZKHWALyo9
-0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99,
-0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff, 0x00, 0x11, 0x22, 0x33,
-0x88, // OP_EQUALVERIFY
-0xAC, // OP_CHECKSIG
-0x87, 0xd6, 0x12, 0x00, 0x00, 0x00, 0x00, 0x00, // 0.01234567 BTC
-0x19, // script length
-0x76, // OP_DUP
-0xA9, // OP_HASH160
-0x14, // 20 bytes of data follows
-// 16eCeyy63xi5yde9VrX4XCcRrCKZwtUZK
-0x01, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99,
-0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff, 0x00, 0x11, 0x22, 0x33,
-0x88, // OP_EQUALVERIFY
-0xAC, // OP_CHECKSIG
-0x00, 0x00, 0x00, 0x00, // locktime
-0x01, 0x00, 0x00, 0x00 // hashtype
-};
-
 /** One input for a transaction. This was extracted
   * from the main transaction in #good_full_transaction. */
 static const uint8_t one_input[] = {
@@ -1074,6 +1891,40 @@ static const uint8_t output_address2[] = {
 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff, 0x00, 0x11, 0x22, 0x33
 };
 
+#endif // #if defined(TEST_TRANSACTION) || defined(BENCH_TRANSACTION)
+
+#ifdef TEST_TRANSACTION
+
+/** The main transaction from #good_full_transaction, with the inputs
+  * removed. */
+static const uint8_t inputs_removed_transaction[] = {
+0x01, 0x00, 0x00, 0x00, // version
+0x01, // number of inputs
+0x02, // number of outputs
+0x00, 0x46, 0xc3, 0x23, 0x00, 0x00, 0x00, 0x00, // 6 BTC
+0x19, // script length
+0x76, // OP_DUP
+0xA9, // OP_HASH160
+0x14, // 20 bytes of data follows
+// 11MXTrefsj1ZS3Q5e9D6DxGzZKHWALyo9
+0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99,
+0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff, 0x00, 0x11, 0x22, 0x33,
+0x88, // OP_EQUALVERIFY
+0xAC, // OP_CHECKSIG
+0x87, 0xd6, 0x12, 0x00, 0x00, 0x00, 0x00, 0x00, // 0.01234567 BTC
+0x19, // script length
+0x76, // OP_DUP
+0xA9, // OP_HASH160
+0x14, // 20 bytes of data follows
+// 16eCeyy63xi5yde9VrX4XCcRrCKZwtUZK
+0x01, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99,
+0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff, 0x00, 0x11, 0x22, 0x33,
+0x88, // OP_EQUALVERIFY
+0xAC, // OP_CHECKSIG
+0x00, 0x00, 0x00, 0x00, // locktime
+0x01, 0x00, 0x00, 0x00 // hashtype
+};
+
 /** The main transaction from #good_full_transaction, with the input
   * script set to a blank (zero-length) script. */
 static const uint8_t good_main_transaction_blank_script[] = {
@@ -2423,6 +3274,37 @@ const struct EncapsulateSignatureTestStruct encapsulate_tests[] = {
 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x01}}
 };
 
+/** Input indices for parseTransactionBatch() tests. */
+static const uint32_t batch_indices_one[] = {0};
+static const uint32_t batch_indices_three[] = {2, 0, 1};
+static const uint32_t batch_indices_some[] = {1, 4};
+static const uint32_t batch_indices_duplicate[] = {1, 1};
+static const uint32_t batch_indices_all[TRANSACTION_MAX_BATCH + 1] = {
+7, 6, 5, 4, 3, 2, 1, 0, 8};
+
+/** Input indices for the BIP 143 parseTransactionBatch() test. */
+static const uint32_t bip143_indices[] = {2, 0};
+
+/** Expected BIP 143 signature hashes for inputs 2 and 0 (in that order) of
+  * a transaction generated by generateTestTransaction() with 3 inputs and 2
+  * outputs, where the 5th byte of each input's script has been set to the
+  * index of the input. These were calculated using an independent
+  * implementation of BIP 143, which was checked against the test vectors in
+  * BIP 143. */
+static const uint8_t bip143_expected_sig_hashes[64] = {
+0x47, 0x27, 0xa8, 0xf9, 0xff, 0xdf, 0xd7, 0xc2,
+0x0e, 0x8e, 0x76, 0x87, 0x12, 0xad, 0xed, 0xa1,
+0x96, 0xc5, 0xf8, 0xbd, 0xb8, 0x8e, 0xb8, 0xe2,
+0x2f, 0x12, 0x27, 0x3a, 0xab, 0xe9, 0x84, 0xab,
+0x60, 0x46, 0xc4, 0x22, 0xda, 0x0f, 0x56, 0xec,
+0x21, 0x03, 0x61, 0xa1, 0xee, 0x81, 0xa6, 0xaf,
+0xb6, 0x51, 0x4b, 0x53, 0x9c, 0x09, 0xe3, 0xf5,
+0x17, 0xae, 0x36, 0xe2, 0xad, 0x63, 0xcb, 0x0e};
+
+#endif // #ifdef TEST_TRANSACTION
+
+#if defined(TEST_TRANSACTION) || defined(BENCH_TRANSACTION)
+
 /** After each call to generateTestTransaction(), this will contain the offset
   * within the "full" transaction where the main transaction begins. */
 static uint32_t main_offset;
@@ -2567,6 +3449,10 @@ static uint8_t *generateTestTransaction(uint32_t *out_length, uint32_t num_input
 	return buffer;
 }
 
+#endif // #if defined(TEST_TRANSACTION) || defined(BENCH_TRANSACTION)
+
+#ifdef TEST_TRANSACTION
+
 /** Check that the number of outputs seen is as expected.
   * \param target The expected number of outputs.
   */
@@ -2694,6 +3580,200 @@ static void prependGoodP2SHInputsTestTransaction(const uint8_t *buffer, uint32_t
 	free(new_buffer);
 }
 
+/** Test parseTransactionBatch() on a transaction generated by
+  * generateTestTransaction(), by checking that every signature hash it
+  * calculates matches the one calculated by parseTransaction() on a copy of
+  * the transaction with every other input script removed.
+  * \param num_inputs Number of inputs in the generated transaction.
+  * \param input_indices See parseTransactionBatch().
+  * \param count See parseTransactionBatch().
+  * \param name The test name. This is displayed on stdout if a test fails.
+  */
+static void testTransactionBatch(uint32_t num_inputs, const uint32_t *input_indices, uint8_t count, const char *name)
+{
+	uint8_t *full;
+	uint8_t *single;
+	uint32_t full_length;
+	uint32_t single_length;
+	uint32_t i;
+	uint32_t in_ptr;
+	uint32_t out_ptr;
+	uint8_t k;
+	uint8_t sig_hashes[TRANSACTION_MAX_BATCH * 32];
+	uint8_t batch_transaction_hash[32];
+	uint8_t sig_hash[32];
+	uint8_t transaction_hash[32];
+	TransactionErrors r;
+
+	full = generateTestTransaction(&full_length, num_inputs, 2);
+	// Make every input script different, so that mixing up lanes will be
+	// noticed.
+	for (i = 0; i < num_inputs; i++)
+	{
+		full[main_offset + 5 + i * sizeof(one_input) + 40] = (uint8_t)i;
+	}
+	clearOutputsSeen();
+	setTestInputStream(full, full_length);
+	r = parseTransactionBatch(sig_hashes, batch_transaction_hash, full_length, input_indices, count, false);
+	if (r != TRANSACTION_NO_ERROR)
+	{
+		printf("parseTransactionBatch() returned %d for \"%s\"\n", (int)r, name);
+		reportFailure();
+		free(full);
+		return;
+	}
+	single = malloc(full_length);
+	for (k = 0; k < count; k++)
+	{
+		// Copy everything up to the first input, then each input, with its
+		// script removed unless it is the one being signed for.
+		in_ptr = main_offset + 5;
+		memcpy(single, full, in_ptr);
+		out_ptr = in_ptr;
+		for (i = 0; i < num_inputs; i++)
+		{
+			if (i == input_indices[k])
+			{
+				memcpy(&(single[out_ptr]), &(full[in_ptr]), sizeof(one_input));
+				out_ptr += sizeof(one_input);
+			}
+			else
+			{
+				memcpy(&(single[out_ptr]), &(full[in_ptr]), 36);
+				single[out_ptr + 36] = 0x00; // script length
+				memcpy(&(single[out_ptr + 37]), &(full[in_ptr + 62]), 4); // sequence
+				out_ptr += 41;
+			}
+			in_ptr += sizeof(one_input);
+		}
+		memcpy(&(single[out_ptr]), &(full[in_ptr]), full_length - in_ptr);
+		single_length = out_ptr + full_length - in_ptr;
+		clearOutputsSeen();
+		setTestInputStream(single, single_length);
+		r = parseTransaction(sig_hash, transaction_hash, single_length);
+		if ((r != TRANSACTION_NO_ERROR)
+			|| memcmp(sig_hash, &(sig_hashes[k * 32]), 32)
+			|| memcmp(transaction_hash, batch_transaction_hash, 32))
+		{
+			printf("Batch signature hash %u mismatch for \"%s\"\n", (unsigned int)k, name);
+			reportFailure();
+		}
+		else
+		{
+			reportSuccess();
+		}
+	}
+	free(single);
+	free(full);
+}
+
+/** Test parseTransactionBatch() in BIP 143 mode, using the transaction
+  * described in #bip143_expected_sig_hashes.
+  * \param corrupt_script If this is true, the script of one of the inputs
+  *                       being signed for will not be a pay to public key
+  *                       hash script, and parseTransactionBatch() is
+  *                       expected to reject the transaction.
+  */
+static void testBIP143TransactionBatch(bool corrupt_script)
+{
+	uint8_t *full;
+	uint32_t full_length;
+	uint32_t i;
+	uint8_t sig_hashes[TRANSACTION_MAX_BATCH * 32];
+	uint8_t transaction_hash[32];
+	uint8_t legacy_sig_hash[32];
+	uint8_t legacy_transaction_hash[32];
+	TransactionErrors r;
+
+	full = generateTestTransaction(&full_length, 3, 2);
+	for (i = 0; i < 3; i++)
+	{
+		full[main_offset + 5 + i * sizeof(one_input) + 40] = (uint8_t)i;
+	}
+	if (corrupt_script)
+	{
+		full[main_offset + 5 + 36 + 25] = 0x87; // last byte of input 0 script
+	}
+	setTestInputStream(full, full_length);
+	parseTransaction(legacy_sig_hash, legacy_transaction_hash, full_length);
+	clearOutputsSeen();
+	setTestInputStream(full, full_length);
+	r = parseTransactionBatch(sig_hashes, transaction_hash, full_length, bip143_indices, 2, true);
+	if (corrupt_script)
+	{
+		if (r != TRANSACTION_NON_STANDARD)
+		{
+			printf("BIP 143 batch accepts non-standard scriptCode\n");
+			reportFailure();
+		}
+		else
+		{
+			reportSuccess();
+		}
+	}
+	else
+	{
+		if ((r != TRANSACTION_NO_ERROR)
+			|| memcmp(sig_hashes, bip143_expected_sig_hashes, sizeof(bip143_expected_sig_hashes)))
+		{
+			printf("BIP 143 batch signature hash mismatch\n");
+			reportFailure();
+		}
+		else
+		{
+			reportSuccess();
+		}
+		// The transaction hash shouldn't depend on how signature hashes are
+		// calculated.
+		if (memcmp(transaction_hash, legacy_transaction_hash, 32))
+		{
+			printf("BIP 143 batch transaction hash mismatch\n");
+			reportFailure();
+		}
+		else
+		{
+			reportSuccess();
+		}
+	}
+	free(full);
+}
+
+/** Check that parseTransactionBatch() rejects a list of input indices, and
+  * still consumes the whole transaction.
+  * \param num_inputs Number of inputs in the generated transaction.
+  * \param input_indices See parseTransactionBatch().
+  * \param count See parseTransactionBatch().
+  * \param name The test name. This is displayed on stdout if a test fails.
+  */
+static void testBadTransactionBatch(uint32_t num_inputs, const uint32_t *input_indices, uint8_t count, const char *name)
+{
+	uint8_t *full;
+	uint32_t full_length;
+	uint8_t sig_hashes[TRANSACTION_MAX_BATCH * 32];
+	uint8_t transaction_hash[32];
+	TransactionErrors r;
+
+	full = generateTestTransaction(&full_length, num_inputs, 2);
+	clearOutputsSeen();
+	setTestInputStream(full, full_length);
+	r = parseTransactionBatch(sig_hashes, transaction_hash, full_length, input_indices, count, false);
+	if (r != TRANSACTION_INVALID_REFERENCE)
+	{
+		printf("parseTransactionBatch() returned %d for \"%s\"\n", (int)r, name);
+		reportFailure();
+	}
+	else if (!isEndOfTransactionData())
+	{
+		printf("parseTransactionBatch() didn't eat everything for \"%s\"\n", name);
+		reportFailure();
+	}
+	else
+	{
+		reportSuccess();
+	}
+	free(full);
+}
+
 int main(void)
 {
 	int i;
@@ -2712,6 +3792,13 @@ int main(void)
 	uint8_t transaction_hash_input_changed[32];
 	uint8_t sig_hash_output_changed[32];
 	uint8_t transaction_hash_output_changed[32];
+	uint8_t cached_transaction[sizeof(good_main_transaction) + 38];
+	uint8_t sig_hash_cached[32];
+	uint8_t transaction_hash_cached[32];
+	uint8_t expected_fee[8];
+	uint8_t cached_fee[8];
+	uint8_t dummy_outpoint[36];
+	TransactionErrors r;
 	uint8_t signature[MAX_SIGNATURE_LENGTH];
 	uint8_t signature_length;
 	HashState test_hs;
@@ -3119,8 +4206,69 @@ int main(void)
 		reportSuccess();
 	}
 
+	// Once an input transaction has been parsed, it can be replaced by a
+	// cached input reference, without changing any of the results.
+	memset(prevout_cache, 0, sizeof(prevout_cache));
+	prependGoodInputTestTransaction(good_main_transaction, sizeof(good_main_transaction), "cache_fill", TRANSACTION_NO_ERROR);
+	getFeeAmount(expected_fee);
+	cached_transaction[0] = 0x02; // is_ref = 2 (cached input)
+	memcpy(&(cached_transaction[1]), &(good_main_transaction[5]), 36); // outpoint of first input
+	cached_transaction[37] = 0x00; // is_ref = 0 (main)
+	memcpy(&(cached_transaction[38]), good_main_transaction, sizeof(good_main_transaction));
+	setTestInputStream(cached_transaction, sizeof(cached_transaction));
+	r = parseTransaction(sig_hash_cached, transaction_hash_cached, sizeof(cached_transaction));
+	getFeeAmount(cached_fee);
+	if (r != TRANSACTION_NO_ERROR)
+	{
+		printf("Cached input reference not accepted, r = %d\n", (int)r);
+		reportFailure();
+	}
+	else if (memcmp(sig_hash_cached, sig_hash, 32) || memcmp(transaction_hash_cached, transaction_hash, 32))
+	{
+		printf("Cached input reference changes hashes\n");
+		reportFailure();
+	}
+	else if (memcmp(cached_fee, expected_fee, sizeof(expected_fee)))
+	{
+		printf("Cached input reference changes transaction fee\n");
+		reportFailure();
+	}
+	else
+	{
+		reportSuccess();
+	}
+	testTransaction(cached_transaction, 20, "cache_truncated", TRANSACTION_INVALID_FORMAT);
+	// A different output of the same input transaction wasn't cached.
+	cached_transaction[33] ^= 0x01;
+	testTransaction(cached_transaction, sizeof(cached_transaction), "cache_wrong_output", TRANSACTION_PREVOUT_NOT_CACHED);
+	cached_transaction[33] ^= 0x01;
+	testTransaction(cached_transaction, sizeof(cached_transaction), "cache_again", TRANSACTION_NO_ERROR);
+	// Filling the cache with other outputs should evict the entry.
+	for (i = 0; i < TRANSACTION_PREVOUT_CACHE_ENTRIES; i++)
+	{
+		memset(dummy_outpoint, i + 1, sizeof(dummy_outpoint));
+		prevoutCacheStore(dummy_outpoint, expected_fee);
+	}
+	testTransaction(cached_transaction, sizeof(cached_transaction), "cache_evicted", TRANSACTION_PREVOUT_NOT_CACHED);
+	// An empty cache shouldn't match anything.
+	memset(prevout_cache, 0, sizeof(prevout_cache));
+	testTransaction(cached_transaction, sizeof(cached_transaction), "cache_empty", TRANSACTION_PREVOUT_NOT_CACHED);
+
+	// The signature hashes calculated by parseTransactionBatch() should be
+	// the same as from signing for each input individually.
+	testTransactionBatch(1, batch_indices_one, 1, "batch_one");
+	testTransactionBatch(3, batch_indices_three, 3, "batch_three");
+	testTransactionBatch(5, batch_indices_some, 2, "batch_some");
+	testTransactionBatch(TRANSACTION_MAX_BATCH, batch_indices_all, TRANSACTION_MAX_BATCH, "batch_max");
+	testBadTransactionBatch(3, batch_indices_three, 0, "batch_empty");
+	testBadTransactionBatch(TRANSACTION_MAX_BATCH + 1, batch_indices_all, TRANSACTION_MAX_BATCH + 1, "batch_too_many");
+	testBadTransactionBatch(3, batch_indices_duplicate, 2, "batch_duplicate");
+	testBadTransactionBatch(3, batch_indices_some, 2, "batch_out_of_range");
+	testBIP143TransactionBatch(false);
+	testBIP143TransactionBatch(true);
+
 	// Check that the transaction parser doesn't choke on a transaction
-	// with the maximum possible size. This test takes a while.
+	// with the maximum possible size.
 	testTransaction(NULL, 0xffffffff, "max_size", TRANSACTION_TOO_LARGE);
 
 	// Go through encapsulateSignature() tests.
@@ -3152,8 +4300,8 @@ int main(void)
 	memset(signature, 0, sizeof(signature));
 	memset(&signature_length, 0, sizeof(signature_length));
 	memset(sig_hash, 42, 32);
-	signTransaction(signature, &signature_length, sig_hash, (BigNum256)private_key);
-	if ((signature[0] != 0x30)
+	if (signTransaction(signature, &signature_length, sig_hash, (BigNum256)private_key)
+		|| (signature[0] != 0x30)
 		|| (signature_length == 0))
 	{
 		printf("signTransaction() isn't writing to its outputs\n");
@@ -3169,3 +4317,117 @@ int main(void)
 }
 
 #endif // #ifdef TEST_TRANSACTION
+
+#ifdef BENCH_TRANSACTION
+
+/** Number of inputs/outputs in each of the generated transactions that
+  * benchmarks sweep over. The main transaction of each has this many inputs
+  * and 2 outputs, or 1 input and this many outputs. Every input of the main
+  * transaction comes with its own referenced (is_ref = 1) input
+  * transaction, so the input sweep also measures the cost of parsing and
+  * hashing input transactions. */
+static const uint32_t bench_sweep_sizes[] = {1, 10, 100, 1000};
+
+/** Transaction which benchParseTransaction() and benchParseAndSign()
+  * operate on. */
+static const uint8_t *bench_transaction;
+/** Length, in bytes, of #bench_transaction. */
+static uint32_t bench_transaction_length;
+/** Private key which benchParseAndSign() signs with. */
+static uint8_t bench_private_key[32];
+
+/** Parse (and hash) #bench_transaction. */
+static void benchParseTransaction(void)
+{
+	uint8_t sig_hash[32];
+	uint8_t transaction_hash[32];
+
+	clearOutputsSeen();
+	setTestInputStream(bench_transaction, bench_transaction_length);
+	parseTransaction(sig_hash, transaction_hash, bench_transaction_length);
+}
+
+/** Parse (and hash) #bench_transaction, then sign it, like the handler for
+  * a SignTransaction message would. */
+static void benchParseAndSign(void)
+{
+	uint8_t sig_hash[32];
+	uint8_t transaction_hash[32];
+	uint8_t signature[73];
+	uint8_t signature_length;
+
+	clearOutputsSeen();
+	setTestInputStream(bench_transaction, bench_transaction_length);
+	parseTransaction(sig_hash, transaction_hash, bench_transaction_length);
+	signTransaction(signature, &signature_length, sig_hash, bench_private_key);
+}
+
+/** Benchmark parsing and parsing + signing of one transaction.
+  * \param transaction The transaction data, including referenced input
+  *                    transactions.
+  * \param length The length, in bytes, of the transaction data.
+  * \param num_inputs The number of inputs in the main transaction (for
+  *                   naming the benchmark).
+  * \param num_outputs The number of outputs in the main transaction (for
+  *                    naming the benchmark).
+  */
+static void benchTransaction(const uint8_t *transaction, uint32_t length, uint32_t num_inputs, uint32_t num_outputs)
+{
+	uint8_t sig_hash[32];
+	uint8_t transaction_hash[32];
+	TransactionErrors r;
+	char name[64];
+
+	bench_transaction = transaction;
+	bench_transaction_length = length;
+	// Don't bother timing transactions which don't parse; their timings
+	// would be meaningless.
+	clearOutputsSeen();
+	setTestInputStream(bench_transaction, bench_transaction_length);
+	r = parseTransaction(sig_hash, transaction_hash, bench_transaction_length);
+	if (r != TRANSACTION_NO_ERROR)
+	{
+		printf("parseTransaction() returned %d for %u inputs, %u outputs\n", (int)r, (unsigned int)num_inputs, (unsigned int)num_outputs);
+		exit(1);
+	}
+	sprintf(name, "parse_%uin_%uout", (unsigned int)num_inputs, (unsigned int)num_outputs);
+	runHostBenchmark(name, &benchParseTransaction, length);
+	sprintf(name, "parse_sign_%uin_%uout", (unsigned int)num_inputs, (unsigned int)num_outputs);
+	runHostBenchmark(name, &benchParseAndSign, length);
+}
+
+/** Benchmark one generated transaction.
+  * \param num_inputs The number of inputs in the main transaction.
+  * \param num_outputs The number of outputs in the main transaction.
+  */
+static void benchGeneratedTransaction(uint32_t num_inputs, uint32_t num_outputs)
+{
+	uint8_t *transaction;
+	uint32_t length;
+
+	transaction = generateTestTransaction(&length, num_inputs, num_outputs);
+	benchTransaction(transaction, length, num_inputs, num_outputs);
+	free(transaction);
+}
+
+int main(void)
+{
+	unsigned int i;
+
+	initBenchmarks(__FILE__);
+	fillWithRandom(bench_private_key, sizeof(bench_private_key));
+	bench_private_key[31] &= 0x7f; // make sure it's less than n
+	for (i = 0; i < (sizeof(bench_sweep_sizes) / sizeof(bench_sweep_sizes[0])); i++)
+	{
+		benchGeneratedTransaction(bench_sweep_sizes[i], 2);
+	}
+	benchGeneratedTransaction(MAX_INPUTS, 2);
+	for (i = 0; i < (sizeof(bench_sweep_sizes) / sizeof(bench_sweep_sizes[0])); i++)
+	{
+		benchGeneratedTransaction(1, bench_sweep_sizes[i]);
+	}
+	benchGeneratedTransaction(1, MAX_OUTPUTS);
+	exit(0);
+}
+
+#endif // #ifdef BENCH_TRANSACTION
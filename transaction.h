@@ -14,6 +14,33 @@
 /** Maximum size (in number of bytes) of the DER format ECDSA signature which
   * signTransaction() generates. */
 #define MAX_SIGNATURE_LENGTH		73
+/** The maximum size of a transaction (in bytes) which parseTransaction()
+  * is prepared to handle. */
+#define MAX_TRANSACTION_SIZE		2000000
+
+#ifndef TRANSACTION_MAX_BATCH
+/** Maximum number of inputs that parseTransactionBatch() can calculate
+  * signature hashes for in one call. Each one costs about 110 bytes of stack
+  * space while parsing, plus space to store its signature. This can be
+  * overridden by defining TRANSACTION_MAX_BATCH in the platform's build
+  * settings.
+  * \warning This must be < 255. It also shouldn't be more than the
+  *          max_count of the repeated fields of SignTransactionBatch in
+  *          messages.proto, otherwise the extra capacity can never be used.
+  */
+#define TRANSACTION_MAX_BATCH		8
+#endif // #ifndef TRANSACTION_MAX_BATCH
+
+#ifndef TRANSACTION_PREVOUT_CACHE_ENTRIES
+/** Number of referenced outputs (outpoint and amount) of input transactions
+  * which the transaction parser remembers, so that a later parse can refer
+  * to them without the input transaction being sent again. Each entry costs
+  * 45 bytes of RAM. This can be overridden by defining
+  * TRANSACTION_PREVOUT_CACHE_ENTRIES in the platform's build settings.
+  * \warning This must be at least 1 and < 256.
+  */
+#define TRANSACTION_PREVOUT_CACHE_ENTRIES	8
+#endif // #ifndef TRANSACTION_PREVOUT_CACHE_ENTRIES
 
 /** Return values for parseTransaction(). */
 typedef enum TransactionErrorsEnum
@@ -34,10 +61,15 @@ typedef enum TransactionErrorsEnum
 	  * the calculated transaction fee is negative. */
 	TRANSACTION_INVALID_AMOUNT			=	7,
 	/** Reference to an inner transaction is invalid. */
-	TRANSACTION_INVALID_REFERENCE		=	8
+	TRANSACTION_INVALID_REFERENCE		=	8,
+	/** A cached input reference was used, but the transaction parser doesn't
+	  * remember the output it refers to. The full input transaction needs to
+	  * be sent instead. */
+	TRANSACTION_PREVOUT_NOT_CACHED		=	9
 } TransactionErrors;
 
 extern TransactionErrors parseTransaction(BigNum256 sig_hash, BigNum256 transaction_hash, uint32_t length);
-extern void signTransaction(uint8_t *signature, uint8_t *out_length, BigNum256 sig_hash, BigNum256 private_key);
+extern TransactionErrors parseTransactionBatch(uint8_t *sig_hashes, BigNum256 transaction_hash, uint32_t length, const uint32_t *input_indices, uint8_t count, bool use_bip143);
+extern bool signTransaction(uint8_t *signature, uint8_t *out_length, BigNum256 sig_hash, BigNum256 private_key);
 
 #endif // #ifndef TRANSACTION_H_INCLUDED
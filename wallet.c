@@ -38,7 +38,7 @@
 #include "wallet.h"
 #include "prandom.h"
 #include "sha256.h"
-#include "ripemd160.h"
+#include "hash160.h"
 #include "ecdsa.h"
 #include "hwinterface.h"
 #include "xex.h"
@@ -46,12 +46,118 @@
 #include "storage_common.h"
 #include "hmac_sha512.h"
 #include "pbkdf2.h"
+#include "bip32.h"
+#include "stream_comm.h"
+#include "trace.h"
 
 /** Length of the checksum field of a wallet record. This is 32 since SHA-256
   * is used to calculate the checksum and the output of SHA-256 is 32 bytes
   * long. */
 #define CHECKSUM_LENGTH			32
 
+#ifndef WALLET_INDEX_ENTRIES
+/** Number of entries in the address index of each wallet (see
+  * #WalletIndexEntry). The index caches the public keys and addresses of
+  * address handles which have been looked up, so that looking one of them
+  * up again doesn't require a point multiplication. Any address handle can
+  * be cached, but each one can only go in one entry (see getIndexSlot()),
+  * so the index holds at most the #WALLET_INDEX_ENTRIES most recently
+  * looked up consecutive address handles, however many addresses the wallet
+  * has. Each entry takes up space in the accounts partition, so this can be
+  * set to 0 on platforms with little non-volatile storage; that disables
+  * the index.
+  */
+#define WALLET_INDEX_ENTRIES	4
+#endif // #ifndef WALLET_INDEX_ENTRIES
+
+#ifndef WALLET_CHANGE_FILTER_ENTRIES
+/** Number of entries in the change filter of each wallet (see
+  * #ChangeFilterEntry). The change filter remembers addresses which
+  * makeNewAddress() has handed out, so that isOwnAddress() can recognise
+  * transaction outputs which pay back to the wallet (change) without
+  * deriving every address. Each address can only go in one entry (see
+  * getChangeFilterSlot()), so once the filter fills up, older addresses
+  * start to be forgotten; a forgotten address is just treated like
+  * anyone else's. Each entry takes up space in the accounts partition, so
+  * this can be set to 0 on platforms with little non-volatile storage; that
+  * disables the change filter.
+  * \warning This must be <= 65536.
+  */
+#define WALLET_CHANGE_FILTER_ENTRIES	16
+#endif // #ifndef WALLET_CHANGE_FILTER_ENTRIES
+
+#ifndef WALLET_DIRECTORY_ENTRIES
+/** Number of wallets (starting from wallet number 0) whose publicly
+  * available information getWalletInfo() remembers in RAM (see
+  * #WalletDirectoryEntry), so that listing wallets doesn't read every wallet
+  * record from non-volatile storage each time. Wallets with higher wallet
+  * numbers are read from non-volatile storage as usual. Each entry costs
+  * about 64 bytes of RAM. This can be overridden by defining
+  * WALLET_DIRECTORY_ENTRIES in the platform's build settings.
+  * \warning This must be at least 1.
+  */
+#define WALLET_DIRECTORY_ENTRIES	8
+#endif // #ifndef WALLET_DIRECTORY_ENTRIES
+
+#ifndef ADDRESS_RESERVATION_BLOCK
+#ifdef TEST_WALLET
+/** Small enough that the tests (which can only create
+  * #MAX_TESTING_ADDRESSES addresses) cross a few reservation blocks. */
+#define ADDRESS_RESERVATION_BLOCK	3
+#else
+/** Number of address handles which makeNewAddress() reserves each time it
+  * has to write the wallet record. The wallet record stores how many
+  * address handles have been reserved, not how many have been handed out,
+  * so only one in every #ADDRESS_RESERVATION_BLOCK calls to
+  * makeNewAddress() writes to non-volatile storage. Reserved handles which
+  * were never handed out become ordinary addresses the next time the wallet
+  * is loaded, so handles are never reused, but getNumAddresses() may jump
+  * ahead after a reset. This can be overridden by defining
+  * ADDRESS_RESERVATION_BLOCK in the platform's build settings; setting it
+  * to 1 restores one write per new address.
+  * \warning This must be at least 1.
+  */
+#define ADDRESS_RESERVATION_BLOCK	32
+#endif // #ifdef TEST_WALLET
+#endif // #ifndef ADDRESS_RESERVATION_BLOCK
+
+#ifndef WALLET_CONTEXTS
+/** Number of encrypted wallets which stay unlocked (see #WalletContext)
+  * after another wallet is loaded, so that switching back to one of them
+  * doesn't require key derivation. Each context costs about 80 bytes of
+  * RAM. This can be overridden by defining WALLET_CONTEXTS in the
+  * platform's build settings.
+  * \warning This must be at least 1.
+  */
+#define WALLET_CONTEXTS				2
+#endif // #ifndef WALLET_CONTEXTS
+
+#ifndef WALLET_PREDERIVED_ADDRESSES
+/** Number of addresses which prederiveAddresses() keeps ready in RAM (see
+  * #PrederivedAddress), beyond the last address handle handed out by
+  * makeNewAddress(). Each entry costs about 90 bytes of RAM. This can be
+  * overridden by defining WALLET_PREDERIVED_ADDRESSES in the platform's
+  * build settings; setting it to 0 disables pre-derivation.
+  */
+#define WALLET_PREDERIVED_ADDRESSES	2
+#endif // #ifndef WALLET_PREDERIVED_ADDRESSES
+
+#ifdef ENABLE_KEEP_UNLOCKED
+#ifndef KEEP_UNLOCKED_TIMEOUT
+/** Number of seconds for which an unlocked wallet (see #WalletContext) that
+  * isn't loaded stays unlocked after it was last used. This matters most
+  * for wallets which are allowed to stay unlocked across sessions (see
+  * setWalletKeepUnlocked()). This can be overridden by defining
+  * KEEP_UNLOCKED_TIMEOUT in the platform's build settings. */
+#define KEEP_UNLOCKED_TIMEOUT		300
+#endif // #ifndef KEEP_UNLOCKED_TIMEOUT
+#endif // #ifdef ENABLE_KEEP_UNLOCKED
+
+/** Bit in the flags field of a wallet record which is set if the user
+  * allowed the wallet to stay unlocked across sessions. See
+  * setWalletKeepUnlocked(). */
+#define WALLET_FLAG_KEEP_UNLOCKED	0x01
+
 /** Structure of the unencrypted portion of a wallet record. */
 struct WalletRecordUnencryptedStruct
 {
@@ -67,16 +173,46 @@ struct WalletRecordUnencryptedStruct
 	uint8_t uuid[UUID_LENGTH];
 };
 
+/** Value of the format field of a wallet record which was written before
+  * that field existed (it used to be reserved and set to zero). In this
+  * format, the checksum covers the counter block (see #COUNTER_BLOCK_LENGTH)
+  * and num_addresses_check is random padding. Wallet records in this format
+  * are converted to #WALLET_FORMAT_SEPARATE_COUNTER when they are loaded. */
+#define WALLET_FORMAT_ORIGINAL			0
+/** Value of the format field of a wallet record in which the counter block
+  * (see #COUNTER_BLOCK_LENGTH) is left out of the checksum, and is instead
+  * checked using num_addresses_check. Reserving address handles or
+  * changing flags then only rewrites that one encrypted block, instead of
+  * the whole wallet record. */
+#define WALLET_FORMAT_SEPARATE_COUNTER	1
+
+/** Length, in bytes, of the counter block of a wallet record. This is the
+  * first block of the encrypted portion, which holds everything that
+  * changes after the wallet is created, apart from the name. It is exactly
+  * one XEX block, so that it can be rewritten without reading or
+  * re-encrypting anything else. */
+#define COUNTER_BLOCK_LENGTH			16
+
 /** Structure of the encrypted portion of a wallet record. */
 struct WalletRecordEncryptedStruct
 {
-	/** Number of addresses in this wallet. */
+	/** Number of address handles which have been reserved in this wallet
+	  * (see #ADDRESS_RESERVATION_BLOCK). This is at least the number of
+	  * addresses which have been handed out. */
 	uint32_t num_addresses;
+	/** Bitwise complement of num_addresses. Since the counter block is
+	  * encrypted, corrupting any of it will (almost certainly) make this
+	  * not match. */
+	uint32_t num_addresses_check;
 	/** Random padding. This is random to try and thwart known-plaintext
 	  * attacks. */
-	uint8_t padding[8];
+	uint8_t padding[4];
+	/** Bit field of options, made up of WALLET_FLAG_* values. */
+	uint8_t flags;
+	/** Layout of this wallet record. Should be one of WALLET_FORMAT_*. */
+	uint8_t format;
 	/** Reserved for future use. Set to all zeroes. */
-	uint8_t reserved[4];
+	uint8_t reserved[2];
 	/** Seed for deterministic private key generator. */
 	uint8_t seed[SEED_LENGTH];
 	/** SHA-256 of everything except this. */
@@ -95,29 +231,218 @@ typedef struct WalletRecordStruct
 	struct WalletRecordEncryptedStruct encrypted;
 } WalletRecord;
 
+/** Structure of an entry in the address index of a wallet. The address
+  * index is stored, encrypted, in the wallet's extras (see
+  * #WALLET_EXTRAS_SIZE); each wallet has #WALLET_INDEX_ENTRIES entries. An
+  * address handle can only be in the entry which getIndexSlot() picks for
+  * it. */
+typedef struct WalletIndexEntryStruct
+{
+	/** Address handle this entry is for. If this is 0 or if getIndexSlot()
+	  * doesn't pick this entry for it, then the entry is empty. */
+	uint32_t address_handle;
+	/** Set to all zeroes. This makes it unlikely that random data will be
+	  * mistaken for a valid entry. */
+	uint8_t check[8];
+	/** x component of the public key, in little-endian format. */
+	uint8_t public_key_x[32];
+	/** y component of the public key, in little-endian format. */
+	uint8_t public_key_y[32];
+	/** The address corresponding to the public key. */
+	uint8_t address[20];
+} WalletIndexEntry;
+
+/** Structure of an entry in the change filter of a wallet. The change
+  * filter is stored, encrypted, in the wallet's extras (see
+  * #WALLET_EXTRAS_SIZE); each wallet has #WALLET_CHANGE_FILTER_ENTRIES
+  * entries. An address can only be in the entry which getChangeFilterSlot()
+  * picks for it. */
+typedef struct ChangeFilterEntryStruct
+{
+	/** The first 4 bytes of the address this entry is for. */
+	uint8_t fingerprint[4];
+	/** Address handle of the address this entry is for, or 0 if the entry
+	  * is empty. */
+	uint32_t address_handle;
+} ChangeFilterEntry;
+
+/** Length, in bytes, of the check field of a stored parent public key (see
+  * #ParentKeyEntry). This is short enough for the entry to be a whole
+  * number of AES blocks, without wasting space in the extras of every
+  * wallet. */
+#define PARENT_KEY_CHECK_LENGTH		16
+
+/** Structure of the stored parent public key of a wallet. This is stored,
+  * encrypted, in the wallet's extras (see #WALLET_EXTRAS_SIZE) instead of
+  * in the wallet record, so that wallet records keep the size (and
+  * therefore the location) they always had. Storing it means that loading a wallet doesn't require a point
+  * multiplication; see loadParentPublicKey(). */
+typedef struct ParentKeyEntryStruct
+{
+	/** x component of the parent public key of the deterministic private key
+	  * generator, in little-endian format. */
+	uint8_t public_key_x[32];
+	/** y component of the parent public key of the deterministic private key
+	  * generator, in little-endian format. */
+	uint8_t public_key_y[32];
+	/** The first #PARENT_KEY_CHECK_LENGTH bytes of the SHA-256 of the
+	  * public key followed by the seed of the wallet it belongs to. An entry
+	  * whose check doesn't match is ignored, so an entry left over from
+	  * another wallet (or a corrupted one) is never used. */
+	uint8_t check[PARENT_KEY_CHECK_LENGTH];
+} ParentKeyEntry;
+
+/** Number of bytes which each wallet uses for its extras: its stored parent
+  * public key, its address index and its change filter, in that order. The
+  * extras of each wallet are stored together, after the last wallet record
+  * in the accounts partition, but only once the partition has been
+  * formatted with room for them (see #ACCOUNTS_LAYOUT_WITH_EXTRAS). */
+#define WALLET_EXTRAS_SIZE	(sizeof(ParentKeyEntry) + WALLET_INDEX_ENTRIES * sizeof(WalletIndexEntry) \
+	+ WALLET_CHANGE_FILTER_ENTRIES * sizeof(ChangeFilterEntry))
+
+/** Number of bytes each wallet uses in a formatted accounts partition: its
+  * wallet record and its extras. This only decides how many wallets fit in
+  * the partition once it has been formatted; in the original layout, each
+  * wallet only uses sizeof(WalletRecord) bytes. See getNumberOfWallets().
+  */
+#define WALLET_FOOTPRINT	(sizeof(WalletRecord) + WALLET_EXTRAS_SIZE)
+
+/** Value stored at #ADDRESS_ACCOUNTS_LAYOUT once the accounts partition has
+  * been formatted with room for the address index, change filter and stored
+  * parent public key of each wallet, so that each wallet uses
+  * #WALLET_FOOTPRINT bytes. Before those existed, the accounts partition
+  * held nothing but wallet records, one every sizeof(WalletRecord) bytes.
+  * Partitions in that layout are left in it until they are formatted (see
+  * sanitiseEverything()), since any slot could hold a wallet; a hidden
+  * wallet can't even be told apart from an empty slot. */
+#define ACCOUNTS_LAYOUT_WITH_EXTRAS		1
+
+/** In-RAM copy of the unencrypted, publicly available part of a wallet
+  * record. See #wallet_directory. */
+typedef struct WalletDirectoryEntryStruct
+{
+	/** Whether the rest of this entry matches what is in non-volatile
+	  * storage. */
+	bool valid;
+	/** Wallet version. Should be one of #WalletVersion. */
+	uint32_t version;
+	/** Name of the wallet. */
+	uint8_t name[NAME_LENGTH];
+	/** Wallet UUID. */
+	uint8_t uuid[UUID_LENGTH];
+} WalletDirectoryEntry;
+
+/** What is remembered about an unlocked encrypted wallet, so that it can be
+  * loaded again without calling pbkdf2(). The wallet record itself is always
+  * re-read from non-volatile storage (which is cheap), so the only things
+  * which need to be kept are the derived encryption key and the number of
+  * address handles which have been handed out. */
+typedef struct WalletContextStruct
+{
+	/** Whether this context holds an unlocked wallet. */
+	bool in_use;
+	/** Address of the wallet record in non-volatile storage. */
+	uint32_t nv_address;
+	/** SHA-256 of the wallet's UUID followed by the password used to unlock
+	  * it. This is only used to recognise the password; anyone who can read
+	  * it can also read #key. */
+	uint8_t password_hash[32];
+	/** The encryption key derived from the password. */
+	uint8_t key[WALLET_ENCRYPTION_KEY_LENGTH];
+	/** Number of reserved address handles when the wallet was last
+	  * unloaded. */
+	uint32_t num_addresses_reserved;
+	/** Number of issued address handles when the wallet was last
+	  * unloaded. */
+	uint32_t num_addresses_issued;
+	/** Value of #wallet_context_clock when this context was last used. The
+	  * least recently used context is the one which is replaced. */
+	uint32_t last_used;
+#ifdef ENABLE_KEEP_UNLOCKED
+	/** Whether the wallet is allowed to stay unlocked across sessions
+	  * (see endWalletSession()). */
+	bool keep_unlocked;
+	/** Value of getSecondsCounter() when this context was last used, for
+	  * timing out contexts which stay unlocked across sessions. */
+	uint32_t last_used_time;
+#endif // #ifdef ENABLE_KEEP_UNLOCKED
+} WalletContext;
+
+/** An address and public key of the currently loaded wallet which has been
+  * calculated ahead of time, by prederiveAddresses(). */
+typedef struct PrederivedAddressStruct
+{
+	/** The address handle this entry is for, or 0 if the entry is empty. */
+	AddressHandle address_handle;
+	/** The address corresponding to the public key. */
+	uint8_t address[20];
+	/** The public key of the address handle. */
+	PointAffine public_key;
+} PrederivedAddress;
+
 /** The most recent error to occur in a function in this file,
   * or #WALLET_NO_ERROR if no error occurred in the most recent function
   * call. See #WalletErrorsEnum for possible values. */
-static WalletErrors last_error;
+static THREAD_LOCAL WalletErrors last_error;
 /** This will be false if a wallet is not currently loaded. This will be true
   * if a wallet is currently loaded. */
-static bool wallet_loaded;
+static THREAD_LOCAL bool wallet_loaded;
 /** Whether the currently loaded wallet is a hidden wallet. If
   * #wallet_loaded is false (i.e. no wallet is loaded), then the meaning of
   * this variable is undefined. */
-static bool is_hidden_wallet;
+static THREAD_LOCAL bool is_hidden_wallet;
 /** This will only be valid if a wallet is loaded. It contains a cache of the
   * currently loaded wallet record. If #wallet_loaded is false (i.e. no wallet
   * is loaded), then the contents of this variable are undefined. */
-static WalletRecord current_wallet;
+static THREAD_LOCAL WalletRecord current_wallet;
+/** Parent public key of the deterministic private key generator of the
+  * currently loaded wallet. The contents of this variable are only valid if
+  * #current_parent_public_key_valid is true. */
+static THREAD_LOCAL PointAffine current_parent_public_key;
+/** Specifies whether the contents of #current_parent_public_key are
+  * valid. */
+static THREAD_LOCAL bool current_parent_public_key_valid;
 /** The address in non-volatile memory where the currently loaded wallet
   * record is. If #wallet_loaded is false (i.e. no wallet is loaded), then the
   * contents of this variable are undefined. */
-static uint32_t wallet_nv_address;
+static THREAD_LOCAL uint32_t wallet_nv_address;
+/** Number of addresses which have been handed out in the currently loaded
+  * wallet. This is between 0 and the number of reserved address handles in
+  * #current_wallet (inclusive), and is only written to non-volatile storage
+  * indirectly, as that reservation. If #wallet_loaded is false (i.e. no
+  * wallet is loaded), then the contents of this variable are undefined. */
+static THREAD_LOCAL uint32_t num_addresses_issued;
 /** Cache of number of wallets that can fit in non-volatile storage. This will
   * be 0 if a value hasn't been calculated yet. This is set by
   * getNumberOfWallets(). */
-static uint32_t num_wallets;
+static THREAD_LOCAL uint32_t num_wallets;
+/** Whether the accounts partition has room for the address index, change
+  * filter and stored parent public key of each wallet (see
+  * #ACCOUNTS_LAYOUT_WITH_EXTRAS). If this is false, none of those are read
+  * or written. This is set by getNumberOfWallets(), and is only valid if
+  * #num_wallets is non-zero. */
+static THREAD_LOCAL bool wallet_extras_enabled;
+/** Directory of the first #WALLET_DIRECTORY_ENTRIES wallets, used by
+  * getWalletInfo(). Entries are filled in as they are first read and are all
+  * invalidated whenever a wallet record is written. */
+static THREAD_LOCAL WalletDirectoryEntry wallet_directory[WALLET_DIRECTORY_ENTRIES];
+/** Incremented whenever any wallet record changes in non-volatile storage,
+  * so that the host can tell whether its copy of the wallet list is stale.
+  * See getWalletListGeneration(). */
+static THREAD_LOCAL uint32_t wallet_list_generation;
+/** Unlocked encrypted wallets. The currently loaded wallet (if it is
+  * encrypted) is one of these. */
+static THREAD_LOCAL WalletContext wallet_contexts[WALLET_CONTEXTS];
+/** The entry in #wallet_contexts for the currently loaded wallet, or NULL
+  * if no wallet is loaded or if the current wallet is unencrypted. */
+static THREAD_LOCAL WalletContext *current_context;
+/** Incremented every time a wallet context is used. */
+static THREAD_LOCAL uint32_t wallet_context_clock;
+#if WALLET_PREDERIVED_ADDRESSES > 0
+/** Addresses of the currently loaded wallet which have been calculated
+  * ahead of time. These are all cleared when the wallet is unloaded. */
+static THREAD_LOCAL PrederivedAddress prederived_addresses[WALLET_PREDERIVED_ADDRESSES];
+#endif // #if WALLET_PREDERIVED_ADDRESSES > 0
 
 #ifdef TEST
 /** The file to perform test non-volatile I/O on. */
@@ -134,10 +459,33 @@ WalletErrors walletGetLastError(void)
 	return last_error;
 }
 
+/** Mark every entry of #wallet_directory as invalid. This must be called
+  * whenever the unencrypted portion of any wallet record changes in
+  * non-volatile storage. */
+static void invalidateWalletDirectory(void)
+{
+	memset(wallet_directory, 0, sizeof(wallet_directory));
+	wallet_list_generation++;
+}
+
+/** Get a number which changes whenever any wallet record is written, so
+  * that the information returned by getWalletInfo() can be assumed to be
+  * unchanged if this returns the same value as before. The number is only
+  * kept in RAM, so it means nothing across resets. Writes which don't
+  * change anything returned by getWalletInfo() (for example, reserving more
+  * addresses) may still change it.
+  * \return The current wallet list generation.
+  */
+uint32_t getWalletListGeneration(void)
+{
+	return wallet_list_generation;
+}
+
 #ifdef TEST
 
 void initWalletTest(void)
 {
+	invalidateWalletDirectory();
 	wallet_test_file = fopen("wallet_test.bin", "w+b");
 	if (wallet_test_file == NULL)
 	{
@@ -165,9 +513,12 @@ static bool suppress_set_entropy_pool;
 /** Calculate the checksum (SHA-256 hash) of the current wallet's contents.
   * \param hash The resulting SHA-256 hash will be written here. This must
   *             be a byte array with space for #CHECKSUM_LENGTH bytes.
-  * \return See #NonVolatileReturnEnum.
+  * \param format Which wallet record format to calculate the checksum for.
+  *               Must be one of WALLET_FORMAT_*. For
+  *               #WALLET_FORMAT_SEPARATE_COUNTER, the counter block is
+  *               skipped.
   */
-static void calculateWalletChecksum(uint8_t *hash)
+static void calculateWalletChecksum(uint8_t *hash, uint8_t format)
 {
 	uint8_t *ptr;
 	unsigned int i;
@@ -177,6 +528,11 @@ static void calculateWalletChecksum(uint8_t *hash)
 	ptr = (uint8_t *)&current_wallet;
 	for (i = 0; i < sizeof(WalletRecord); i++)
 	{
+		if ((format == WALLET_FORMAT_SEPARATE_COUNTER)
+			&& (i == offsetof(WalletRecord, encrypted)))
+		{
+			i += COUNTER_BLOCK_LENGTH;
+		}
 		// Skip checksum when calculating the checksum.
 		if (i == offsetof(WalletRecord, encrypted.checksum))
 		{
@@ -191,6 +547,13 @@ static void calculateWalletChecksum(uint8_t *hash)
 	writeHashToByteArray(hash, &hs, true);
 }
 
+/** Set the check field of the counter block of #current_wallet, so that it
+  * matches the num_addresses field. */
+static void updateCounterBlockCheck(void)
+{
+	current_wallet.encrypted.num_addresses_check = ~current_wallet.encrypted.num_addresses;
+}
+
 /** Load contents of non-volatile memory into a #WalletRecord structure. This
   * doesn't care if there is or isn't actually a wallet at the specified
   * address.
@@ -207,8 +570,9 @@ static WalletErrors readWalletRecord(WalletRecord *wallet_record, uint32_t addre
 	encrypted_size = sizeof(wallet_record->encrypted);
 	// Before doing any reading, do some sanity checks. These ensure that the
 	// size of the unencrypted and encrypted portions are an integer multiple
-	// of the AES block size.
-	if (((unencrypted_size % 16) != 0) || ((encrypted_size % 16) != 0))
+	// of the AES block size, and that the counter block is one AES block.
+	if (((unencrypted_size % 16) != 0) || ((encrypted_size % 16) != 0)
+		|| (offsetof(struct WalletRecordEncryptedStruct, seed) != COUNTER_BLOCK_LENGTH))
 	{
 		return WALLET_INVALID_OPERATION;
 	}
@@ -239,6 +603,7 @@ static WalletErrors readWalletRecord(WalletRecord *wallet_record, uint32_t addre
   */
 static WalletErrors writeCurrentWalletRecord(uint32_t address)
 {
+	invalidateWalletDirectory();
 	if (nonVolatileWrite(
 		(uint8_t *)&(current_wallet.unencrypted),
 		PARTITION_ACCOUNTS,
@@ -262,2715 +627,5200 @@ static WalletErrors writeCurrentWalletRecord(uint32_t address)
 	return WALLET_NO_ERROR;
 }
 
-/** Using the specified password and UUID (as the salt), derive an encryption
-  * key and begin using it.
-  *
-  * This needs to be in wallet.c because there are situations (creating and
-  * restoring a wallet) when the wallet UUID is not known before the beginning
-  * of the appropriate function call.
-  * \param uuid Byte array containing the wallet UUID. This must be
-  *             exactly #UUID_LENGTH bytes long.
-  * \param password Password to use in key derivation.
-  * \param password_length Length of password, in bytes. Use 0 to specify no
-  *                        password (i.e. wallet is unencrypted).
+/** Store part of #current_wallet into non-volatile memory, without calling
+  * nonVolatileFlush(). This is for updates which only change a few fields,
+  * so that the rest of the wallet record doesn't have to be encrypted and
+  * written again.
+  * \param offset Offset within the wallet record of the first byte to store.
+  * \param length Number of bytes to store. The range of bytes must lie
+  *               entirely within either the unencrypted portion or the
+  *               encrypted portion.
+  * \return See #WalletErrors.
   */
-static void deriveAndSetEncryptionKey(const uint8_t *uuid, const uint8_t *password, const unsigned int password_length)
+static WalletErrors writeCurrentWalletRecordPart(uint32_t offset, uint32_t length)
 {
-	uint8_t derived_key[SHA512_HASH_LENGTH];
+	NonVolatileReturn r;
 
-	if (sizeof(derived_key) < WALLET_ENCRYPTION_KEY_LENGTH)
+	if (offset < offsetof(WalletRecord, encrypted))
 	{
-		fatalError(); // this should never happen
+		invalidateWalletDirectory();
+		r = nonVolatileWrite(
+			&(((uint8_t *)&current_wallet)[offset]),
+			PARTITION_ACCOUNTS,
+			wallet_nv_address + offset,
+			length);
 	}
-	if (password_length > 0)
+	else
 	{
-		pbkdf2(derived_key, password, password_length, uuid, UUID_LENGTH);
-		setEncryptionKey(derived_key);
+		r = encryptedNonVolatileWrite(
+			&(((uint8_t *)&current_wallet)[offset]),
+			PARTITION_ACCOUNTS,
+			wallet_nv_address + offset,
+			length);
 	}
-	else
+	if (r != NV_NO_ERROR)
 	{
-		// No password i.e. wallet is unencrypted.
-		memset(derived_key, 0, sizeof(derived_key));
-		setEncryptionKey(derived_key);
+		return WALLET_WRITE_ERROR;
 	}
+	return WALLET_NO_ERROR;
 }
 
-/** Initialise a wallet (load it if it's there).
-  * \param wallet_spec The wallet number of the wallet to load.
-  * \param password Password to use to derive wallet encryption key.
-  * \param password_length Length of password, in bytes. Use 0 to specify no
-  *                        password (i.e. wallet is unencrypted).
-  * \return #WALLET_NO_ERROR on success, or one of #WalletErrorsEnum if an
-  *         error occurred.
+/** Store the counter block of #current_wallet into non-volatile memory. This
+  * will also call nonVolatileFlush(). The checksum doesn't cover the counter
+  * block, so nothing else needs to be written.
+  * \return See #WalletErrors.
   */
-WalletErrors initWallet(uint32_t wallet_spec, const uint8_t *password, const unsigned int password_length)
+static WalletErrors writeCurrentCounterBlock(void)
 {
 	WalletErrors r;
-	uint8_t hash[CHECKSUM_LENGTH];
-	uint8_t uuid[UUID_LENGTH];
 
-	if (uninitWallet() != WALLET_NO_ERROR)
+	updateCounterBlockCheck();
+	r = writeCurrentWalletRecordPart(offsetof(WalletRecord, encrypted), COUNTER_BLOCK_LENGTH);
+	if (r != WALLET_NO_ERROR)
 	{
-		return last_error; // propagate error code
+		return r;
+	}
+	if (nonVolatileFlush() != NV_NO_ERROR)
+	{
+		return WALLET_WRITE_ERROR;
 	}
+	return WALLET_NO_ERROR;
+}
 
-	if (getNumberOfWallets() == 0)
+/** Get the address in non-volatile memory of the extras (see
+  * #WALLET_EXTRAS_SIZE) of a wallet. #num_wallets must be valid, and
+  * #wallet_extras_enabled must be true.
+  * \param wallet_spec The wallet number of the wallet.
+  * \return The address in non-volatile memory of the extras.
+  */
+static uint32_t getWalletExtrasAddress(uint32_t wallet_spec)
+{
+	return num_wallets * (uint32_t)sizeof(WalletRecord) + wallet_spec * (uint32_t)WALLET_EXTRAS_SIZE;
+}
+
+/** Find out which entry in the address index an address handle goes in.
+  * Consecutive address handles go in consecutive entries, wrapping around
+  * at the end of the index, so for address handles 1 to
+  * #WALLET_INDEX_ENTRIES, entry n is for address handle n + 1. Finding an
+  * address handle therefore only needs one read, however big the wallet
+  * is.
+  * \param ah The address handle to look up. This must not be 0.
+  * \return The index (0 based) of the entry.
+  */
+static uint32_t getIndexSlot(AddressHandle ah)
+{
+#if WALLET_INDEX_ENTRIES > 0
+	return (ah - 1) % WALLET_INDEX_ENTRIES;
+#else
+	return 0;
+#endif // #if WALLET_INDEX_ENTRIES > 0
+}
+
+/** Get the address in non-volatile memory of an entry in the address index
+  * of the currently loaded wallet. #num_wallets must be valid.
+  * \param slot The index (0 based) of the entry. This must be less than
+  *             #WALLET_INDEX_ENTRIES.
+  * \return The address in non-volatile memory of the entry.
+  */
+static uint32_t getIndexEntryAddress(uint32_t slot)
+{
+	return getWalletExtrasAddress(wallet_nv_address / (uint32_t)sizeof(WalletRecord))
+		+ (uint32_t)sizeof(ParentKeyEntry) + slot * (uint32_t)sizeof(WalletIndexEntry);
+}
+
+/** Write an entry into the address index of the currently loaded wallet,
+  * without calling nonVolatileFlush().
+  * \param address The address to store in the entry. This must be a byte
+  *                array of length 20 bytes. Use NULL to make the entry empty.
+  * \param public_key The public key to store in the entry. This is ignored
+  *                   if address is NULL.
+  * \param ah The address handle to write the entry of. This replaces
+  *           whatever was in the entry which getIndexSlot() picks for it.
+  *           If the index is disabled (or there's no room for it; see
+  *           #wallet_extras_enabled), nothing will be written.
+  * \return See #WalletErrors.
+  */
+static WalletErrors storeIndexEntry(uint8_t *address, PointAffine *public_key, AddressHandle ah)
+{
+	WalletIndexEntry entry;
+
+	if ((ah == 0) || (WALLET_INDEX_ENTRIES == 0) || !wallet_extras_enabled)
 	{
-		return last_error; // propagate error code
+		return WALLET_NO_ERROR;
 	}
-	if (wallet_spec >= num_wallets)
+	memset(&entry, 0, sizeof(entry));
+	if (address != NULL)
 	{
-		last_error = WALLET_INVALID_WALLET_NUM;
-		return last_error;
+		entry.address_handle = ah;
+		memcpy(entry.public_key_x, public_key->x, 32);
+		memcpy(entry.public_key_y, public_key->y, 32);
+		memcpy(entry.address, address, 20);
 	}
-	wallet_nv_address = wallet_spec * sizeof(WalletRecord);
-
-	if (nonVolatileRead(uuid, PARTITION_ACCOUNTS, wallet_nv_address + offsetof(WalletRecord, unencrypted.uuid), UUID_LENGTH) != NV_NO_ERROR)
+	if (encryptedNonVolatileWrite((uint8_t *)&entry, PARTITION_ACCOUNTS, getIndexEntryAddress(getIndexSlot(ah)), sizeof(entry)) != NV_NO_ERROR)
 	{
-		last_error = WALLET_READ_ERROR;
-		return last_error;
+		return WALLET_WRITE_ERROR;
 	}
-	deriveAndSetEncryptionKey(uuid, password, password_length);
+	return WALLET_NO_ERROR;
+}
 
-	r = readWalletRecord(&current_wallet, wallet_nv_address);
+/** Write an entry into the address index of the currently loaded wallet. This
+  * will also call nonVolatileFlush().
+  * \param address See storeIndexEntry().
+  * \param public_key See storeIndexEntry().
+  * \param ah See storeIndexEntry().
+  * \return See #WalletErrors.
+  */
+static WalletErrors writeIndexEntry(uint8_t *address, PointAffine *public_key, AddressHandle ah)
+{
+	WalletErrors r;
+
+	r = storeIndexEntry(address, public_key, ah);
 	if (r != WALLET_NO_ERROR)
 	{
-		last_error = r;
-		return last_error;
+		return r;
+	}
+	if (nonVolatileFlush() != NV_NO_ERROR)
+	{
+		return WALLET_WRITE_ERROR;
 	}
+	return WALLET_NO_ERROR;
+}
 
-	if (current_wallet.unencrypted.version == VERSION_NOTHING_THERE)
+/** Look up an address handle in the address index of the currently loaded
+  * wallet.
+  * \param out_address The address will be written here, if the index has an
+  *                    entry for the address handle. This must be a byte
+  *                    array with space for 20 bytes.
+  * \param out_public_key The public key will be written here, if the index
+  *                       has an entry for the address handle.
+  * \param ah The address handle to look up.
+  * \return true if the index had an entry for the address handle, false if
+  *         it didn't (or if it couldn't be read, or if there's no room for
+  *         the index; see #wallet_extras_enabled).
+  */
+static bool readIndexEntry(uint8_t *out_address, PointAffine *out_public_key, AddressHandle ah)
+{
+	WalletIndexEntry entry;
+	uint8_t i;
+
+	if ((ah == 0) || (WALLET_INDEX_ENTRIES == 0) || !wallet_extras_enabled)
 	{
-		is_hidden_wallet = true;
+		return false;
 	}
-	else if ((current_wallet.unencrypted.version == VERSION_UNENCRYPTED)
-		|| (current_wallet.unencrypted.version == VERSION_IS_ENCRYPTED))
+	if (encryptedNonVolatileRead((uint8_t *)&entry, PARTITION_ACCOUNTS, getIndexEntryAddress(getIndexSlot(ah)), sizeof(entry)) != NV_NO_ERROR)
 	{
-		is_hidden_wallet = false;
+		return false;
 	}
-	else
+	if (entry.address_handle != ah)
 	{
-		last_error = WALLET_NOT_THERE;
-		return last_error;
+		return false;
+	}
+	for (i = 0; i < sizeof(entry.check); i++)
+	{
+		if (entry.check[i] != 0)
+		{
+			return false;
+		}
 	}
+	memcpy(out_public_key->x, entry.public_key_x, 32);
+	memcpy(out_public_key->y, entry.public_key_y, 32);
+	out_public_key->is_point_at_infinity = 0;
+	memcpy(out_address, entry.address, 20);
+	return true;
+}
 
-	// Calculate checksum and check that it matches.
-	calculateWalletChecksum(hash);
-	if (bigCompareVariableSize(current_wallet.encrypted.checksum, hash, CHECKSUM_LENGTH) != BIGCMP_EQUAL)
+/** Make every entry in the address index of the currently loaded wallet
+  * empty. This needs to be done whenever the index could contain entries
+  * that are valid under the current encryption key, but which are for
+  * a different seed (for example, after creating a new wallet). The empty
+  * entries are encrypted, so that they look like any other entries. The
+  * entries are adjacent, so they are all written before a single
+  * nonVolatileFlush(), instead of one flush per entry.
+  * \return See #WalletErrors.
+  */
+static WalletErrors clearIndex(void)
+{
+	WalletErrors r;
+	AddressHandle ah;
+
+	for (ah = 1; ah <= WALLET_INDEX_ENTRIES; ah++)
 	{
-		last_error = WALLET_NOT_THERE;
-		return last_error;
+		r = storeIndexEntry(NULL, NULL, ah);
+		if (r != WALLET_NO_ERROR)
+		{
+			return r;
+		}
 	}
+	if (nonVolatileFlush() != NV_NO_ERROR)
+	{
+		return WALLET_WRITE_ERROR;
+	}
+	return WALLET_NO_ERROR;
+}
 
-	wallet_loaded = true;
-	last_error = WALLET_NO_ERROR;
-	return last_error;
+/** Find out which entry in the change filter an address goes in.
+  * Addresses are hashes, so their last bytes are already evenly
+  * distributed.
+  * \param address The address to look up. This must be a byte array of
+  *                length 20 bytes.
+  * \return The index (0 based) of the entry.
+  */
+static uint32_t getChangeFilterSlot(const uint8_t *address)
+{
+#if WALLET_CHANGE_FILTER_ENTRIES > 0
+	return (((uint32_t)address[18] << 8) | address[19]) % WALLET_CHANGE_FILTER_ENTRIES;
+#else
+	return 0;
+#endif // #if WALLET_CHANGE_FILTER_ENTRIES > 0
 }
 
-/** Unload wallet, so that it cannot be used until initWallet() is called.
-  * \return #WALLET_NO_ERROR on success, or one of #WalletErrorsEnum if an
-  *         error occurred.
+/** Get the address in non-volatile memory of an entry in the change filter
+  * of the currently loaded wallet. #num_wallets must be valid.
+  * \param slot The index (0 based) of the entry. This must be less than
+  *             #WALLET_CHANGE_FILTER_ENTRIES.
+  * \return The address in non-volatile memory of the entry.
   */
-WalletErrors uninitWallet(void)
+static uint32_t getChangeFilterEntryAddress(uint32_t slot)
 {
-	clearParentPublicKeyCache();
-	wallet_loaded = false;
-	is_hidden_wallet = false;
-	wallet_nv_address = 0;
-	memset(&current_wallet, 0, sizeof(WalletRecord));
-	last_error = WALLET_NO_ERROR;
-	return last_error;
+	return getWalletExtrasAddress(wallet_nv_address / (uint32_t)sizeof(WalletRecord))
+		+ (uint32_t)(sizeof(ParentKeyEntry) + WALLET_INDEX_ENTRIES * sizeof(WalletIndexEntry))
+		+ slot * (uint32_t)sizeof(ChangeFilterEntry);
 }
 
-#ifdef TEST_WALLET
-void logVersionFieldWrite(uint32_t address);
-#endif // #ifdef TEST_WALLET
+/** Write an entry into the change filter of the currently loaded wallet,
+  * without calling nonVolatileFlush(). If there's no room for the change
+  * filter (see #wallet_extras_enabled), nothing will be written.
+  * \param entry The entry to write.
+  * \param slot The index (0 based) of the entry. This must be less than
+  *             #WALLET_CHANGE_FILTER_ENTRIES.
+  * \return See #WalletErrors.
+  */
+static WalletErrors storeChangeFilterEntry(ChangeFilterEntry *entry, uint32_t slot)
+{
+	if (!wallet_extras_enabled)
+	{
+		return WALLET_NO_ERROR;
+	}
+	if (encryptedNonVolatileWrite((uint8_t *)entry, PARTITION_ACCOUNTS, getChangeFilterEntryAddress(slot), sizeof(ChangeFilterEntry)) != NV_NO_ERROR)
+	{
+		return WALLET_WRITE_ERROR;
+	}
+	return WALLET_NO_ERROR;
+}
 
-/** Sanitise (clear) a selected area of non-volatile storage.
-  * \param partition The partition the area is contained in. Must be one
-  *                  of #NVPartitions.
-  * \param start The first address within the partition which will be cleared.
-  *              Must be a multiple of 4.
-  * \param length The number of bytes to clear. Must be a multiple of 4.
-  * \return #WALLET_NO_ERROR on success, or one of #WalletErrorsEnum if an
-  *         error occurred.
+/** Add an address to the change filter of the currently loaded wallet. This
+  * replaces whatever was in the entry which getChangeFilterSlot() picks for
+  * it. Nothing is written if that entry is already there, since writes are
+  * much slower than reads. If the change filter is disabled, nothing will be
+  * written.
+  * \param address The address to add. This must be a byte array of length
+  *                20 bytes.
+  * \param ah The address handle of the address.
+  * \return See #WalletErrors.
   */
-static WalletErrors sanitiseNonVolatileStorage(NVPartitions partition, uint32_t start, uint32_t length)
+static WalletErrors addToChangeFilter(const uint8_t *address, AddressHandle ah)
 {
-	uint8_t buffer[32];
-	uint8_t pool_state[ENTROPY_POOL_LENGTH];
-	uint32_t address;
-	uint32_t bytes_written;
-	uint32_t bytes_to_write;
-	NonVolatileReturn r;
-	uint8_t pass;
+	ChangeFilterEntry entry;
+	ChangeFilterEntry old_entry;
+	uint32_t slot;
+	WalletErrors r;
 
-	if (getEntropyPool(pool_state))
+	if ((WALLET_CHANGE_FILTER_ENTRIES == 0) || !wallet_extras_enabled)
 	{
-		last_error = WALLET_RNG_FAILURE;
-		return last_error;
+		return WALLET_NO_ERROR;
 	}
-
-	// The following check guards all occurrences of (address + length + offset)
-	// from integer overflow, for all reasonable values of "offset".
-	if ((start > 0x10000000) || (length >  0x10000000))
+	memcpy(entry.fingerprint, address, sizeof(entry.fingerprint));
+	entry.address_handle = ah;
+	slot = getChangeFilterSlot(address);
+	if ((encryptedNonVolatileRead((uint8_t *)&old_entry, PARTITION_ACCOUNTS, getChangeFilterEntryAddress(slot), sizeof(old_entry)) == NV_NO_ERROR)
+		&& !memcmp(&old_entry, &entry, sizeof(entry)))
 	{
-		// address might overflow.
-		last_error = WALLET_BAD_ADDRESS;
-		return last_error;
+		return WALLET_NO_ERROR;
 	}
-
-	// The "must be a multiple of 4" checks are there so that version fields
-	// (which are 4 bytes long) are always either completely cleared or not
-	// touched at all.
-	if (((start % 4) != 0) || ((length % 4) != 0))
+	r = storeChangeFilterEntry(&entry, slot);
+	if (r != WALLET_NO_ERROR)
 	{
-		// start and length not multiples of 4.
-		last_error = WALLET_BAD_ADDRESS;
-		return last_error;
+		return r;
+	}
+	if (nonVolatileFlush() != NV_NO_ERROR)
+	{
+		return WALLET_WRITE_ERROR;
 	}
+	return WALLET_NO_ERROR;
+}
 
-	// 4 pass format: all 0s, all 1s, random, random. This ensures that
-	// every bit is cleared at least once, set at least once and ends up
-	// in an unpredictable state.
-	// It is crucial that the last pass is random for two reasons:
-	// 1. A new device UUID is written, if necessary.
-	// 2. Hidden wallets are actually plausibly deniable.
-	for (pass = 0; pass < 4; pass++)
+/** Make every entry in the change filter of the currently loaded wallet
+  * empty. Like clearIndex(), this needs to be done whenever the change
+  * filter could contain entries which are valid under the current
+  * encryption key, but which are for a different seed.
+  * \return See #WalletErrors.
+  */
+static WalletErrors clearChangeFilter(void)
+{
+	ChangeFilterEntry entry;
+	WalletErrors r;
+	uint32_t slot;
+
+	memset(&entry, 0, sizeof(entry));
+	for (slot = 0; slot < WALLET_CHANGE_FILTER_ENTRIES; slot++)
 	{
-		address = start;
-		bytes_written = 0;
-		while (bytes_written < length)
+		r = storeChangeFilterEntry(&entry, slot);
+		if (r != WALLET_NO_ERROR)
 		{
-			if (pass == 0)
-			{
-				memset(buffer, 0, sizeof(buffer));
-			}
-			else if (pass == 1)
-			{
-				memset(buffer, 0xff, sizeof(buffer));
-			}
-			else
-			{
-				if (getRandom256TemporaryPool(buffer, pool_state))
-				{
-					// Before returning, attempt to write the persistent
-					// entropy pool state back into non-volatile memory.
-					// The return value of setEntropyPool() is ignored because
-					// if a failure occurs, then WALLET_RNG_FAILURE is a
-					// suitable return value anyway.
-#ifdef TEST_WALLET
-					if (!suppress_set_entropy_pool)
-#endif // #ifdef TEST_WALLET
-					{
-						setEntropyPool(pool_state);
-					}
-					last_error = WALLET_RNG_FAILURE;
-					return last_error;
-				}
-			}
-			bytes_to_write = length - bytes_written;
-			if (bytes_to_write > sizeof(buffer))
-			{
-				bytes_to_write = sizeof(buffer);
-			}
-			if (bytes_to_write > 0)
-			{
-				r = nonVolatileWrite(buffer, partition, address, bytes_to_write);
-				if (r != NV_NO_ERROR)
-				{
-					last_error = WALLET_WRITE_ERROR;
-					return last_error;
-				}
-			}
-			address += bytes_to_write;
-			bytes_written += bytes_to_write;
-		} // end while (bytes_written < length)
-
-		// After each pass, flush write buffers to ensure that
-		// non-volatile memory is actually overwritten.
-		r = nonVolatileFlush();
-		if (r != NV_NO_ERROR)
-		{
-			last_error = WALLET_WRITE_ERROR;
-			return last_error;
-		}
-	} // end for (pass = 0; pass < 4; pass++)
-
-#ifdef TEST_WALLET
-	if (!suppress_set_entropy_pool)
-#endif // #ifdef TEST_WALLET
-	{
-		// Write back persistent entropy pool state.
-		if (setEntropyPool(pool_state))
-		{
-			last_error = WALLET_RNG_FAILURE;
-			return last_error;
+			return r;
 		}
 	}
-
-	// At this point the selected area is now filled with random data.
-	// Some functions in this file expect non-random data in certain locations.
-
-	// If the selected area includes the device UUID, then a new device
-	// UUID needs to be written. But if the selected area includes the
-	// device UUID, then it will be overwritten with random data in the
-	// above loop. Thus no additional work is needed.
-
-	// Write VERSION_NOTHING_THERE to all possible locations of the
-	// version field. This ensures that a wallet won't accidentally
-	// (1 in 2 ^ 31 chance) be recognised as a valid wallet by
-	// getWalletInfo().
-	if (partition == PARTITION_ACCOUNTS)
+	if (nonVolatileFlush() != NV_NO_ERROR)
 	{
-		address = start;
-		address /= sizeof(WalletRecord);
-		address *= sizeof(WalletRecord);
-		address += offsetof(WalletRecord, unencrypted.version);
-		// address is now rounded down to the first possible address where
-		// the version field of a wallet could be stored.
-		memset(buffer, 0, sizeof(uint32_t));
-		while ((address + sizeof(uint32_t)) <= (start + length))
-		{
-			// An additional range check against start is needed because the
-			// initial value of address is rounded down; thus it could be
-			// rounded down below start.
-			if (address >= start)
-			{
-				r = nonVolatileWrite(buffer, partition, address, sizeof(uint32_t));
-				if (r == NV_NO_ERROR)
-				{
-					r = nonVolatileFlush();
-				}
-				else if (r != NV_NO_ERROR)
-				{
-					last_error = WALLET_WRITE_ERROR;
-					return last_error;
-				}
-#ifdef TEST_WALLET
-				if (r == NV_NO_ERROR)
-				{
-					logVersionFieldWrite(address);
-				}
-#endif // #ifdef TEST_WALLET
-			}
-			address += sizeof(WalletRecord);
-		} // end while ((address + sizeof(uint32_t)) <= (start + length))
-	} // end if (partition == PARTITION_ACCOUNTS)
-
-	last_error = WALLET_NO_ERROR;
-	return last_error;
+		return WALLET_WRITE_ERROR;
+	}
+	return WALLET_NO_ERROR;
 }
 
-/** Sanitise (clear) the entire contents of a partition.
-  * \param partition The partition to clear. Must be one of #NVPartitions.
-  * \return #WALLET_NO_ERROR on success, or one of #WalletErrorsEnum if an
-  *         error occurred.
+/** Get the address in non-volatile memory of the stored parent public key
+  * (see #ParentKeyEntry) of the currently loaded wallet. #num_wallets must
+  * be valid.
+  * \return The address in non-volatile memory of the entry.
   */
-static WalletErrors sanitisePartition(NVPartitions partition)
+static uint32_t getParentKeyEntryAddress(void)
 {
-	uint32_t size;
-
-	if (nonVolatileGetSize(&size, partition) != NV_NO_ERROR)
-	{
-		last_error = WALLET_BAD_ADDRESS;
-		return last_error;
-	}
-	last_error = sanitiseNonVolatileStorage(partition, 0, size);
-	return last_error;
+	return getWalletExtrasAddress(wallet_nv_address / (uint32_t)sizeof(WalletRecord));
 }
 
-/** Sanitise (clear) all partitions.
-  * \return #WALLET_NO_ERROR on success, or one of #WalletErrorsEnum if an
-  *         error occurred.
+/** Calculate the check field of a stored parent public key (see
+  * #ParentKeyEntry), for the seed of the currently loaded wallet.
+  * \param hash The SHA-256 hash whose first #PARENT_KEY_CHECK_LENGTH bytes
+  *             are the check field will be written here. This must be a
+  *             byte array with space for #CHECKSUM_LENGTH bytes.
+  * \param entry The entry to calculate the check field of. Its check field
+  *              is ignored.
   */
-WalletErrors sanitiseEverything(void)
+static void calculateParentKeyCheck(uint8_t *hash, ParentKeyEntry *entry)
 {
-	last_error = sanitisePartition(PARTITION_GLOBAL);
-	if (last_error == WALLET_NO_ERROR)
+	HashState hs;
+	unsigned int i;
+
+	sha256Begin(&hs);
+	for (i = 0; i < sizeof(entry->public_key_x); i++)
 	{
-		last_error = sanitisePartition(PARTITION_ACCOUNTS);
+		sha256WriteByte(&hs, entry->public_key_x[i]);
 	}
-	return last_error;
+	for (i = 0; i < sizeof(entry->public_key_y); i++)
+	{
+		sha256WriteByte(&hs, entry->public_key_y[i]);
+	}
+	for (i = 0; i < SEED_LENGTH; i++)
+	{
+		sha256WriteByte(&hs, current_wallet.encrypted.seed[i]);
+	}
+	sha256Finish(&hs);
+	writeHashToByteArray(hash, &hs, true);
 }
 
-/** Computes wallet version of current wallet. This is in its own function
-  * because it's used by both newWallet() and changeEncryptionKey().
+/** Store #current_parent_public_key as the stored parent public key of the
+  * currently loaded wallet. This will also call nonVolatileFlush(). If
+  * there's no room for it (see #wallet_extras_enabled), nothing will be
+  * written. #current_parent_public_key_valid must be true.
   * \return See #WalletErrors.
   */
-static WalletErrors updateWalletVersion(void)
+static WalletErrors writeParentKeyEntry(void)
 {
-	if (is_hidden_wallet)
+	ParentKeyEntry entry;
+	uint8_t hash[CHECKSUM_LENGTH];
+
+	if (!wallet_extras_enabled)
 	{
-		// Hidden wallets should not ever have their version fields updated;
-		// that would give away their presence.
-		return WALLET_INVALID_OPERATION;
+		return WALLET_NO_ERROR;
 	}
-	if (isEncryptionKeyNonZero())
+	memcpy(entry.public_key_x, current_parent_public_key.x, 32);
+	memcpy(entry.public_key_y, current_parent_public_key.y, 32);
+	calculateParentKeyCheck(hash, &entry);
+	memcpy(entry.check, hash, sizeof(entry.check));
+	if (encryptedNonVolatileWrite((uint8_t *)&entry, PARTITION_ACCOUNTS, getParentKeyEntryAddress(), sizeof(entry)) != NV_NO_ERROR)
 	{
-		current_wallet.unencrypted.version = VERSION_IS_ENCRYPTED;
+		return WALLET_WRITE_ERROR;
 	}
-	else
+	if (nonVolatileFlush() != NV_NO_ERROR)
 	{
-		current_wallet.unencrypted.version = VERSION_UNENCRYPTED;
+		return WALLET_WRITE_ERROR;
 	}
 	return WALLET_NO_ERROR;
 }
 
-/** Delete a wallet, so that it's contents can no longer be retrieved from
-  * non-volatile storage.
-  * \param wallet_spec The wallet number of the wallet to delete. The wallet
-  *                    doesn't have to "exist"; calling this function for a
-  *                    non-existent wallet will clear the non-volatile space
-  *                    associated with it. This is useful for deleting a
-  *                    hidden wallet.
-  * \warning This is irreversible; the only way to access the wallet after
-  *          deletion is to restore a backup.
+/** Derive the parent public key of the currently loaded wallet from its
+  * seed, and put it in #current_parent_public_key. This requires a point
+  * multiplication, so it should only be done when there's no valid stored
+  * copy. */
+static void deriveParentPublicKey(void)
+{
+	uint8_t k_par[32];
+
+	bigLoadBigEndian(k_par, current_wallet.encrypted.seed); // since seed is big-endian
+	setFieldToN();
+	bigModulo(k_par, k_par); // just in case
+	pointMultiplyBase(&current_parent_public_key, k_par);
+	memset(k_par, 0, sizeof(k_par));
+	current_parent_public_key_valid = true;
+}
+
+/** Put the parent public key of the currently loaded wallet in
+  * #current_parent_public_key, and use it to prime the deterministic key
+  * generator. The stored copy is used if it is valid. Otherwise (for
+  * example, for a wallet created before parent public keys were stored, or
+  * if the stored copy was corrupted), the parent public key is derived
+  * again and stored, so that this only happens once. If there's no room for
+  * a stored copy (see #wallet_extras_enabled), nothing is done here, and the
+  * parent public key is derived when it is first needed.
+  * \return See #WalletErrors.
   */
-WalletErrors deleteWallet(uint32_t wallet_spec)
+static WalletErrors loadParentPublicKey(void)
 {
-	uint32_t address;
+	ParentKeyEntry entry;
+	uint8_t hash[CHECKSUM_LENGTH];
+	WalletErrors r;
 
-	if (getNumberOfWallets() == 0)
+	if (!wallet_extras_enabled)
 	{
-		return last_error; // propagate error code
+		return WALLET_NO_ERROR;
 	}
-	if (wallet_spec >= num_wallets)
+	if (encryptedNonVolatileRead((uint8_t *)&entry, PARTITION_ACCOUNTS, getParentKeyEntryAddress(), sizeof(entry)) != NV_NO_ERROR)
 	{
-		last_error = WALLET_INVALID_WALLET_NUM;
-		return last_error;
+		return WALLET_READ_ERROR;
 	}
-	// Always unload current wallet, just in case the current wallet is the
-	// one being deleted.
-	if (uninitWallet() != WALLET_NO_ERROR)
+	calculateParentKeyCheck(hash, &entry);
+	if (bigCompareVariableSize(entry.check, hash, sizeof(entry.check)) == BIGCMP_EQUAL)
 	{
-		return last_error; // propagate error code
+		memcpy(current_parent_public_key.x, entry.public_key_x, 32);
+		memcpy(current_parent_public_key.y, entry.public_key_y, 32);
+		current_parent_public_key.is_point_at_infinity = 0;
+		current_parent_public_key_valid = true;
 	}
-	address = wallet_spec * sizeof(WalletRecord);
-	last_error = sanitiseNonVolatileStorage(PARTITION_ACCOUNTS, address, sizeof(WalletRecord));
-	return last_error;
+	else
+	{
+		deriveParentPublicKey();
+		r = writeParentKeyEntry();
+		if (r != WALLET_NO_ERROR)
+		{
+			return r;
+		}
+	}
+	setParentPublicKey(&current_parent_public_key);
+	return WALLET_NO_ERROR;
 }
 
-/** Create new wallet. A brand new wallet contains no addresses and should
-  * have a unique, unpredictable deterministic private key generation seed.
-  * \param wallet_spec The wallet number of the new wallet.
-  * \param name Should point to #NAME_LENGTH bytes (padded with spaces if
-  *             necessary) containing the desired name of the wallet.
-  * \param use_seed If this is true, then the contents of seed will be
-  *                 used as the deterministic private key generation seed.
-  *                 If this is false, then the contents of seed will be
-  *                 ignored.
-  * \param seed The deterministic private key generation seed to use in the
-  *             new wallet. This should be a byte array of length #SEED_LENGTH
-  *             bytes. This parameter will be ignored if use_seed is false.
-  * \param make_hidden Whether to make the new wallet a hidden wallet.
-  * \param password Password to use to derive wallet encryption key.
-  * \param password_length Length of password, in bytes. Use 0 to specify no
-  *                        password (i.e. wallet is unencrypted).
-  * \return #WALLET_NO_ERROR on success, or one of #WalletErrorsEnum if an
-  *         error occurred. If this returns #WALLET_NO_ERROR, then the
-  *         wallet will also be loaded.
-  * \warning This will erase the current one.
+/** Look up an address handle in #prederived_addresses.
+  * \param ah The address handle to look up.
+  * \return The entry for the address handle, or NULL if there isn't one.
   */
-WalletErrors newWallet(uint32_t wallet_spec, uint8_t *name, bool use_seed, uint8_t *seed, bool make_hidden, const uint8_t *password, const unsigned int password_length)
+static PrederivedAddress *findPrederivedAddress(AddressHandle ah)
 {
-	uint8_t random_buffer[32];
-	uint8_t uuid[UUID_LENGTH];
-	WalletErrors r;
+#if WALLET_PREDERIVED_ADDRESSES > 0
+	uint8_t i;
+#endif // #if WALLET_PREDERIVED_ADDRESSES > 0
 
-	if (uninitWallet() != WALLET_NO_ERROR)
+	if (ah == 0)
 	{
-		return last_error; // propagate error code
+		return NULL; // empty entries have address handle 0
 	}
-
-	if (getNumberOfWallets() == 0)
+#if WALLET_PREDERIVED_ADDRESSES > 0
+	for (i = 0; i < WALLET_PREDERIVED_ADDRESSES; i++)
 	{
-		return last_error; // propagate error code
+		if (prederived_addresses[i].address_handle == ah)
+		{
+			return &(prederived_addresses[i]);
+		}
 	}
-	if (wallet_spec >= num_wallets)
+#endif // #if WALLET_PREDERIVED_ADDRESSES > 0
+	return NULL;
+}
+
+/** Empty every entry of #prederived_addresses. This must be done whenever
+  * the currently loaded wallet is unloaded. */
+static void clearPrederivedAddresses(void)
+{
+#if WALLET_PREDERIVED_ADDRESSES > 0
+	memset(prederived_addresses, 0, sizeof(prederived_addresses));
+#endif // #if WALLET_PREDERIVED_ADDRESSES > 0
+}
+
+/** Get the number of PBKDF2 iterations to use for key derivation. This is
+  * the number stored by calibrateKeyDerivation() if there is a valid one,
+  * otherwise it is the platform's default (see getPBKDF2Iterations()).
+  * \return The number of iterations.
+  */
+static uint32_t getKeyDerivationIterations(void)
+{
+	uint8_t buffer[8];
+	uint32_t num_iterations;
+
+	if (nonVolatileRead(buffer, PARTITION_GLOBAL, ADDRESS_PBKDF2_ITERATIONS, sizeof(buffer)) == NV_NO_ERROR)
 	{
-		last_error = WALLET_INVALID_WALLET_NUM;
-		return last_error;
+		num_iterations = readU32LittleEndian(buffer);
+		if ((num_iterations == ~readU32LittleEndian(&(buffer[4])))
+			&& (num_iterations >= PBKDF2_MIN_ITERATIONS) && (num_iterations <= PBKDF2_MAX_ITERATIONS)
+			&& ((num_iterations & (num_iterations - 1)) == 0))
+		{
+			return num_iterations;
+		}
 	}
-	wallet_nv_address = wallet_spec * sizeof(WalletRecord);
+	return getPBKDF2Iterations();
+}
 
-	// Check for existing wallet.
-	r = readWalletRecord(&current_wallet, wallet_nv_address);
-	if (r != WALLET_NO_ERROR)
+/** Measure how many PBKDF2 iterations fit in PBKDF2_TARGET_CYCLES on this
+  * device, and store the answer in non-volatile storage so that all future
+  * key derivation uses it. Since changing the number of iterations makes
+  * every existing encrypted wallet inaccessible, this should only be called
+  * just after the accounts partition has been sanitised (i.e. when the
+  * wallet area is formatted). If PBKDF2_TARGET_CYCLES isn't defined, this
+  * does nothing, so getPBKDF2Iterations() stays in use.
+  * \return #WALLET_NO_ERROR on success, or one of #WalletErrorsEnum if an
+  *         error occurred.
+  */
+WalletErrors calibrateKeyDerivation(void)
+{
+#ifdef PBKDF2_TARGET_CYCLES
+	uint8_t buffer[8];
+	uint32_t num_iterations;
+
+	num_iterations = calibratePBKDF2Iterations(PBKDF2_TARGET_CYCLES);
+	writeU32LittleEndian(buffer, num_iterations);
+	writeU32LittleEndian(&(buffer[4]), ~num_iterations);
+	if (nonVolatileWrite(buffer, PARTITION_GLOBAL, ADDRESS_PBKDF2_ITERATIONS, sizeof(buffer)) != NV_NO_ERROR)
 	{
-		last_error = r;
+		last_error = WALLET_WRITE_ERROR;
 		return last_error;
 	}
-	if (current_wallet.unencrypted.version != VERSION_NOTHING_THERE)
+	if (nonVolatileFlush() != NV_NO_ERROR)
 	{
-		last_error = WALLET_ALREADY_EXISTS;
+		last_error = WALLET_WRITE_ERROR;
 		return last_error;
 	}
+#endif // #ifdef PBKDF2_TARGET_CYCLES
+	last_error = WALLET_NO_ERROR;
+	return last_error;
+}
 
-	if (make_hidden)
-	{
-		// The creation of a hidden wallet is supposed to be discreet, so
-		// all unencrypted fields should be left untouched. This forces us to
-		// use the existing UUID.
-		memcpy(uuid, current_wallet.unencrypted.uuid, UUID_LENGTH);
-	}
-	else
+/** Using the specified password and UUID (as the salt), derive an encryption
+  * key and begin using it.
+  *
+  * This needs to be in wallet.c because there are situations (creating and
+  * restoring a wallet) when the wallet UUID is not known before the beginning
+  * of the appropriate function call.
+  * \param uuid Byte array containing the wallet UUID. This must be
+  *             exactly #UUID_LENGTH bytes long.
+  * \param password Password to use in key derivation.
+  * \param password_length Length of password, in bytes. Use 0 to specify no
+  *                        password (i.e. wallet is unencrypted).
+  * \return #WALLET_NO_ERROR on success, or #WALLET_CANCELLED if the host
+  *         cancelled key derivation. In the latter case, the encryption key
+  *         is left unchanged.
+  */
+static WalletErrors deriveAndSetEncryptionKey(const uint8_t *uuid, const uint8_t *password, const unsigned int password_length)
+{
+	uint8_t derived_key[SHA512_HASH_LENGTH];
+
+	if (sizeof(derived_key) < WALLET_ENCRYPTION_KEY_LENGTH)
 	{
-		// Generate wallet UUID now, because it is needed to derive the wallet
-		// encryption key.
-		if (getRandom256(random_buffer))
-		{
-			last_error = WALLET_RNG_FAILURE;
-			return last_error;
-		}
-		memcpy(uuid, random_buffer, UUID_LENGTH);
+		fatalError(); // this should never happen
 	}
-	deriveAndSetEncryptionKey(uuid, password, password_length);
-
-	// Update unencrypted fields of current_wallet.
-	if (!make_hidden)
+	if (password_length > 0)
 	{
-		r = updateWalletVersion();
-		if (r != WALLET_NO_ERROR)
+		traceEvent(TRACE_KEY_DERIVATION_BEGIN, 0);
+		if (pbkdf2WithIterations(derived_key, password, password_length, uuid, UUID_LENGTH, getKeyDerivationIterations()))
 		{
-			last_error = r;
-			return last_error;
+			traceEvent(TRACE_KEY_DERIVATION_END, 1);
+			return WALLET_CANCELLED;
 		}
-		memset(current_wallet.unencrypted.reserved, 0, sizeof(current_wallet.unencrypted.reserved));
-		memcpy(current_wallet.unencrypted.name, name, NAME_LENGTH);
-		memcpy(current_wallet.unencrypted.uuid, uuid, UUID_LENGTH);
+		traceEvent(TRACE_KEY_DERIVATION_END, 0);
+		setEncryptionKey(derived_key);
+	}
+	else
+	{
+		// No password i.e. wallet is unencrypted.
+		memset(derived_key, 0, sizeof(derived_key));
+		setEncryptionKey(derived_key);
 	}
+	return WALLET_NO_ERROR;
+}
 
-	// Update encrypted fields of current_wallet.
-	current_wallet.encrypted.num_addresses = 0;
-	if (getRandom256(random_buffer))
+/** Calculate the hash which is used to recognise the password of a wallet
+  * context (see #WalletContext).
+  * \param out The hash will be written here. This must be a byte array with
+  *            space for 32 bytes.
+  * \param uuid Byte array containing the wallet UUID. This must be
+  *             exactly #UUID_LENGTH bytes long.
+  * \param password The password.
+  * \param password_length Length of password, in bytes.
+  */
+static void calculatePasswordHash(uint8_t *out, const uint8_t *uuid, const uint8_t *password, const unsigned int password_length)
+{
+	HashState hs;
+	unsigned int i;
+
+	sha256Begin(&hs);
+	for (i = 0; i < UUID_LENGTH; i++)
 	{
-		last_error = WALLET_RNG_FAILURE;
-		return last_error;
+		sha256WriteByte(&hs, uuid[i]);
 	}
-	memcpy(current_wallet.encrypted.padding, random_buffer, sizeof(current_wallet.encrypted.padding));
-	memset(current_wallet.encrypted.reserved, 0, sizeof(current_wallet.encrypted.reserved));
-	if (use_seed)
+	for (i = 0; i < password_length; i++)
 	{
-		memcpy(current_wallet.encrypted.seed, seed, SEED_LENGTH);
+		sha256WriteByte(&hs, password[i]);
 	}
-	else
+	sha256Finish(&hs);
+	writeHashToByteArray(out, &hs, true);
+}
+
+/** Find the wallet context for a wallet, if it is unlocked. A context
+  * which has timed out (see expireWalletContexts()) is forgotten here
+  * instead of being returned, so that the timeout holds even if
+  * expireWalletContexts() hasn't been called since.
+  * \param nv_address Address of the wallet record in non-volatile storage.
+  * \param password_hash The password hash, as calculated by
+  *                      calculatePasswordHash().
+  * \return The wallet context, or NULL if there isn't one.
+  */
+static WalletContext *findWalletContext(uint32_t nv_address, const uint8_t *password_hash)
+{
+	unsigned int i;
+
+	for (i = 0; i < WALLET_CONTEXTS; i++)
 	{
-		if (getRandom256(random_buffer))
-		{
-			last_error = WALLET_RNG_FAILURE;
-			return last_error;
-		}
-		memcpy(current_wallet.encrypted.seed, random_buffer, 32);
-		if (getRandom256(random_buffer))
+		if (wallet_contexts[i].in_use && (wallet_contexts[i].nv_address == nv_address)
+			&& (memcmp(wallet_contexts[i].password_hash, password_hash, 32) == 0))
 		{
-			last_error = WALLET_RNG_FAILURE;
-			return last_error;
+#ifdef ENABLE_KEEP_UNLOCKED
+			if ((current_context != &(wallet_contexts[i]))
+				&& ((getSecondsCounter() - wallet_contexts[i].last_used_time) >= KEEP_UNLOCKED_TIMEOUT))
+			{
+				memset(&(wallet_contexts[i]), 0, sizeof(WalletContext));
+				return NULL;
+			}
+#endif // #ifdef ENABLE_KEEP_UNLOCKED
+			return &(wallet_contexts[i]);
 		}
-		memcpy(&(current_wallet.encrypted.seed[32]), random_buffer, 32);
 	}
-	calculateWalletChecksum(current_wallet.encrypted.checksum);
+	return NULL;
+}
 
-	r = writeCurrentWalletRecord(wallet_nv_address);
-	if (r != WALLET_NO_ERROR)
+/** Get a wallet context to put a newly unlocked wallet in. If every context
+  * is in use, the least recently used one is forgotten.
+  * \return The (cleared) wallet context.
+  */
+static WalletContext *allocateWalletContext(void)
+{
+	WalletContext *context;
+	unsigned int i;
+
+	context = &(wallet_contexts[0]);
+	for (i = 0; i < WALLET_CONTEXTS; i++)
 	{
-		last_error = r;
-		return last_error;
+		if (!wallet_contexts[i].in_use)
+		{
+			context = &(wallet_contexts[i]);
+			break;
+		}
+		if (wallet_contexts[i].last_used < context->last_used)
+		{
+			context = &(wallet_contexts[i]);
+		}
 	}
-
-	last_error = initWallet(wallet_spec, password, password_length);
-	return last_error;
+	memset(context, 0, sizeof(WalletContext));
+	return context;
 }
 
-/** Generate a new address using the deterministic private key generator.
-  * \param out_address The new address will be written here (if everything
-  *                    goes well). This must be a byte array with space for
-  *                    20 bytes.
-  * \param out_public_key The public key corresponding to the new address will
-  *                       be written here (if everything goes well).
-  * \return The address handle of the new address on success,
-  *         or #BAD_ADDRESS_HANDLE if an error occurred.
-  *         Use walletGetLastError() to get more detail about an error.
+/** Forget the wallet contexts of every wallet at one place in non-volatile
+  * storage. This must be called whenever a wallet record is deleted or
+  * replaced, since the cached keys may no longer be right.
+  * \param nv_address Address of the wallet record in non-volatile storage.
   */
-AddressHandle makeNewAddress(uint8_t *out_address, PointAffine *out_public_key)
+static void forgetWalletContexts(uint32_t nv_address)
 {
-	WalletErrors r;
+	unsigned int i;
 
-	if (!wallet_loaded)
+	for (i = 0; i < WALLET_CONTEXTS; i++)
 	{
-		last_error = WALLET_NOT_LOADED;
-		return BAD_ADDRESS_HANDLE;
+		if (wallet_contexts[i].in_use && (wallet_contexts[i].nv_address == nv_address))
+		{
+			if (current_context == &(wallet_contexts[i]))
+			{
+				current_context = NULL;
+			}
+			memset(&(wallet_contexts[i]), 0, sizeof(WalletContext));
+		}
 	}
-#ifdef TEST_WALLET
-	if (current_wallet.encrypted.num_addresses >= MAX_TESTING_ADDRESSES)
-#else
-	if (current_wallet.encrypted.num_addresses >= MAX_ADDRESSES)
-#endif // #ifdef TEST_WALLET
+}
+
+/** Mark a wallet context as just used. This must only be called while the
+  * context's wallet is loaded.
+  * \param context The wallet context.
+  */
+static void touchWalletContext(WalletContext *context)
+{
+	context->last_used = ++wallet_context_clock;
+#ifdef ENABLE_KEEP_UNLOCKED
+	context->keep_unlocked = ((current_wallet.encrypted.flags & WALLET_FLAG_KEEP_UNLOCKED) != 0);
+	context->last_used_time = getSecondsCounter();
+#endif // #ifdef ENABLE_KEEP_UNLOCKED
+}
+
+/** Forget every wallet context. */
+static void forgetAllWalletContexts(void)
+{
+	current_context = NULL;
+	memset(wallet_contexts, 0, sizeof(wallet_contexts));
+	wallet_context_clock = 0;
+}
+
+/** Lock every unlocked wallet, including the current one, so that loading
+  * any encrypted wallet requires key derivation again. This also unloads
+  * the current wallet.
+  * \return #WALLET_NO_ERROR on success, or one of #WalletErrorsEnum if an
+  *         error occurred.
+  */
+WalletErrors lockAllWallets(void)
+{
+	if (uninitWallet() != WALLET_NO_ERROR)
 	{
-		last_error = WALLET_FULL;
-		return BAD_ADDRESS_HANDLE;
+		return last_error; // propagate error code
 	}
-	(current_wallet.encrypted.num_addresses)++;
-	calculateWalletChecksum(current_wallet.encrypted.checksum);
-	r = writeCurrentWalletRecord(wallet_nv_address);
-	if (r != WALLET_NO_ERROR)
+	forgetAllWalletContexts();
+	last_error = WALLET_NO_ERROR;
+	return last_error;
+}
+
+#ifdef ENABLE_KEEP_UNLOCKED
+/** Lock every unlocked wallet which hasn't been used for
+  * #KEEP_UNLOCKED_TIMEOUT seconds. The current wallet's context is left
+  * alone, since it is in use. Platforms should
+  * call this periodically (eg. as a background task; see
+  * addBackgroundTask()), so that wallets time out even if the host goes
+  * away.
+  */
+void expireWalletContexts(void)
+{
+	uint32_t now;
+	unsigned int i;
+
+	now = getSecondsCounter();
+	for (i = 0; i < WALLET_CONTEXTS; i++)
 	{
-		last_error = r;
-		return BAD_ADDRESS_HANDLE;
+		if (wallet_contexts[i].in_use && (current_context != &(wallet_contexts[i]))
+			&& ((now - wallet_contexts[i].last_used_time) >= KEEP_UNLOCKED_TIMEOUT))
+		{
+			memset(&(wallet_contexts[i]), 0, sizeof(WalletContext));
+		}
 	}
-	last_error = getAddressAndPublicKey(out_address, out_public_key, current_wallet.encrypted.num_addresses);
-	if (last_error != WALLET_NO_ERROR)
+}
+#endif // #ifdef ENABLE_KEEP_UNLOCKED
+
+/** Unload the current wallet and lock every wallet, except those which the
+  * user allowed to stay unlocked across sessions (see
+  * setWalletKeepUnlocked()) and which haven't timed out. This is what
+  * happens at the start of a session; without ENABLE_KEEP_UNLOCKED, it's
+  * the same as lockAllWallets().
+  * \return #WALLET_NO_ERROR on success, or one of #WalletErrorsEnum if an
+  *         error occurred.
+  */
+WalletErrors endWalletSession(void)
+{
+#ifdef ENABLE_KEEP_UNLOCKED
+	unsigned int i;
+
+	if (uninitWallet() != WALLET_NO_ERROR)
 	{
-		return BAD_ADDRESS_HANDLE;
+		return last_error; // propagate error code
 	}
-	else
+	for (i = 0; i < WALLET_CONTEXTS; i++)
 	{
-		return current_wallet.encrypted.num_addresses;
+		if (!wallet_contexts[i].keep_unlocked)
+		{
+			memset(&(wallet_contexts[i]), 0, sizeof(WalletContext));
+		}
 	}
+	expireWalletContexts();
+	last_error = WALLET_NO_ERROR;
+	return last_error;
+#else
+	return lockAllWallets();
+#endif // #ifdef ENABLE_KEEP_UNLOCKED
 }
 
-/** Given an address handle, use the deterministic private key
-  * generator to generate the address and public key associated
-  * with that address handle.
-  * \param out_address The address will be written here (if everything
-  *                    goes well). This must be a byte array with space for
-  *                    20 bytes.
-  * \param out_public_key The public key corresponding to the address will
-  *                       be written here (if everything goes well).
-  * \param ah The address handle to obtain the address/public key of.
+/** Remember the wallet at #wallet_nv_address, which must use the current
+  * encryption key, in a wallet context so that it can be loaded again
+  * without key derivation.
+  * \param password_hash The password hash, as calculated by
+  *                      calculatePasswordHash().
+  * \return The wallet context.
+  */
+static WalletContext *rememberWallet(const uint8_t *password_hash)
+{
+	WalletContext *context;
+
+	context = allocateWalletContext();
+	context->in_use = true;
+	context->nv_address = wallet_nv_address;
+	memcpy(context->password_hash, password_hash, 32);
+	getEncryptionKey(context->key);
+	touchWalletContext(context);
+	return context;
+}
+
+/** Read the wallet record at #wallet_nv_address into #current_wallet,
+  * using the current encryption key, and check that it is valid.
   * \return #WALLET_NO_ERROR on success, or one of #WalletErrorsEnum if an
   *         error occurred.
   */
-WalletErrors getAddressAndPublicKey(uint8_t *out_address, PointAffine *out_public_key, AddressHandle ah)
+static WalletErrors loadCurrentWalletRecord(void)
 {
-	uint8_t buffer[32];
-	uint8_t serialised[ECDSA_MAX_SERIALISE_SIZE];
-	uint8_t serialised_size;
-	HashState hs;
 	WalletErrors r;
-	uint8_t i;
+	uint8_t hash[CHECKSUM_LENGTH];
+	uint8_t format;
 
-	if (!wallet_loaded)
+	r = readWalletRecord(&current_wallet, wallet_nv_address);
+	if (r != WALLET_NO_ERROR)
 	{
-		last_error = WALLET_NOT_LOADED;
-		return last_error;
+		return r;
 	}
-	if (current_wallet.encrypted.num_addresses == 0)
+
+	if (current_wallet.unencrypted.version == VERSION_NOTHING_THERE)
 	{
-		last_error = WALLET_EMPTY;
-		return last_error;
+		is_hidden_wallet = true;
 	}
-	if ((ah == 0) || (ah > current_wallet.encrypted.num_addresses) || (ah == BAD_ADDRESS_HANDLE))
+	else if ((current_wallet.unencrypted.version == VERSION_UNENCRYPTED)
+		|| (current_wallet.unencrypted.version == VERSION_IS_ENCRYPTED))
 	{
-		last_error = WALLET_INVALID_HANDLE;
-		return last_error;
+		is_hidden_wallet = false;
+	}
+	else
+	{
+		return WALLET_NOT_THERE;
 	}
 
-	// Calculate private key.
-	r = getPrivateKey(buffer, ah);
-	if (r != WALLET_NO_ERROR)
+	// Calculate checksum and check that it matches.
+	format = current_wallet.encrypted.format;
+	if ((format != WALLET_FORMAT_ORIGINAL) && (format != WALLET_FORMAT_SEPARATE_COUNTER))
 	{
-		last_error = r;
-		return r;
+		return WALLET_NOT_THERE;
 	}
-	// Calculate public key.
-	setToG(out_public_key);
-	pointMultiply(out_public_key, buffer);
-	// Calculate address.
-	serialised_size = ecdsaSerialise(serialised, out_public_key, true);
-	if (serialised_size < 2)
+	if ((format == WALLET_FORMAT_SEPARATE_COUNTER)
+		&& (current_wallet.encrypted.num_addresses_check != ~current_wallet.encrypted.num_addresses))
 	{
-		// Somehow, the public ended up as the point at infinity.
-		last_error = WALLET_INVALID_HANDLE;
-		return last_error;
+		return WALLET_NOT_THERE;
 	}
-	sha256Begin(&hs);
-	for (i = 0; i < serialised_size; i++)
+	calculateWalletChecksum(hash, format);
+	if (bigCompareVariableSize(current_wallet.encrypted.checksum, hash, CHECKSUM_LENGTH) != BIGCMP_EQUAL)
 	{
-		sha256WriteByte(&hs, serialised[i]);
+		return WALLET_NOT_THERE;
 	}
-	sha256Finish(&hs);
-	writeHashToByteArray(buffer, &hs, true);
-	ripemd160Begin(&hs);
-	for (i = 0; i < 32; i++)
+
+	if (format == WALLET_FORMAT_ORIGINAL)
 	{
-		ripemd160WriteByte(&hs, buffer[i]);
+		// Convert the wallet record in place. Nothing moves, so this works
+		// for hidden wallets too, and the unencrypted portion is unchanged.
+		// The old padding is kept as the new padding, so no random numbers
+		// are needed.
+		current_wallet.encrypted.format = WALLET_FORMAT_SEPARATE_COUNTER;
+		updateCounterBlockCheck();
+		calculateWalletChecksum(current_wallet.encrypted.checksum, WALLET_FORMAT_SEPARATE_COUNTER);
+		r = writeCurrentWalletRecord(wallet_nv_address);
+		if (r != WALLET_NO_ERROR)
+		{
+			return r;
+		}
 	}
-	ripemd160Finish(&hs);
-	writeHashToByteArray(buffer, &hs, true);
-	memcpy(out_address, buffer, 20);
 
-	last_error = WALLET_NO_ERROR;
-	return last_error;
+	return loadParentPublicKey();
 }
 
-/** Get the master public key of the currently loaded wallet. Every public key
-  * (and address) in a wallet can be derived from the master public key and
-  * chain code. However, even with posession of the master public key, all
-  * private keys are still secret.
-  * \param out_public_key The master public key will be written here.
-  * \param out_chain_code The chain code will be written here. This must be a
-  *                       byte array with space for 32 bytes.
+/** Initialise a wallet (load it if it's there). If the wallet is encrypted
+  * and was unlocked recently with the same password (see #WalletContext),
+  * then the encryption key is not derived again.
+  * \param wallet_spec The wallet number of the wallet to load.
+  * \param password Password to use to derive wallet encryption key.
+  * \param password_length Length of password, in bytes. Use 0 to specify no
+  *                        password (i.e. wallet is unencrypted).
   * \return #WALLET_NO_ERROR on success, or one of #WalletErrorsEnum if an
   *         error occurred.
   */
-WalletErrors getMasterPublicKey(PointAffine *out_public_key, uint8_t *out_chain_code)
+WalletErrors initWallet(uint32_t wallet_spec, const uint8_t *password, const unsigned int password_length)
 {
-	uint8_t local_seed[SEED_LENGTH]; // need a local copy to modify
-	BigNum256 k_par;
+	WalletErrors r;
+	uint8_t uuid[UUID_LENGTH];
+	uint8_t password_hash[32];
+	WalletContext *context;
 
-	if (!wallet_loaded)
+	if (uninitWallet() != WALLET_NO_ERROR)
 	{
-		last_error = WALLET_NOT_LOADED;
-		return last_error;
+		return last_error; // propagate error code
 	}
-	memcpy(local_seed, current_wallet.encrypted.seed, SEED_LENGTH);
-	memcpy(out_chain_code, &(local_seed[32]), 32);
-	k_par = (BigNum256)local_seed;
-	swapEndian256(k_par); // since seed is big-endian
-	setFieldToN();
-	bigModulo(k_par, k_par); // just in case
-	setToG(out_public_key);
-	pointMultiply(out_public_key, k_par);
-	last_error = WALLET_NO_ERROR;
-	return last_error;
-}
 
-/** Get the current number of addresses in a wallet.
-  * \return The current number of addresses on success, or 0 if an error
-  *         occurred. Use walletGetLastError() to get more detail about
-  *         an error.
-  */
-uint32_t getNumAddresses(void)
-{
-	if (!wallet_loaded)
-	{
-		last_error = WALLET_NOT_LOADED;
-		return 0;
-	}
-	if (current_wallet.encrypted.num_addresses == 0)
-	{
-		last_error = WALLET_EMPTY;
-		return 0;
-	}
-	else
-	{
-		last_error = WALLET_NO_ERROR;
-		return current_wallet.encrypted.num_addresses;
-	}
-}
-
-/** Given an address handle, use the deterministic private key
-  * generator to generate the private key associated with that address handle.
-  * \param out The private key will be written here (if everything goes well).
-  *            This must be a byte array with space for 32 bytes.
-  * \param ah The address handle to obtain the private key of.
-  * \return #WALLET_NO_ERROR on success, or one of #WalletErrorsEnum if an
-  *         error occurred.
-  */
-WalletErrors getPrivateKey(uint8_t *out, AddressHandle ah)
-{
-	if (!wallet_loaded)
+	if (getNumberOfWallets() == 0)
 	{
-		last_error = WALLET_NOT_LOADED;
-		return last_error;
+		return last_error; // propagate error code
 	}
-	if (current_wallet.encrypted.num_addresses == 0)
+	if (wallet_spec >= num_wallets)
 	{
-		last_error = WALLET_EMPTY;
+		last_error = WALLET_INVALID_WALLET_NUM;
 		return last_error;
 	}
-	if ((ah == 0) || (ah > current_wallet.encrypted.num_addresses) || (ah == BAD_ADDRESS_HANDLE))
+	wallet_nv_address = wallet_spec * sizeof(WalletRecord);
+
+	if (nonVolatileRead(uuid, PARTITION_ACCOUNTS, wallet_nv_address + offsetof(WalletRecord, unencrypted.uuid), UUID_LENGTH) != NV_NO_ERROR)
 	{
-		last_error = WALLET_INVALID_HANDLE;
+		last_error = WALLET_READ_ERROR;
 		return last_error;
 	}
-	if (generateDeterministic256(out, current_wallet.encrypted.seed, ah))
+	context = NULL;
+	if (password_length > 0)
 	{
-		// This should never happen.
-		last_error = WALLET_RNG_FAILURE;
-		return last_error;
+		calculatePasswordHash(password_hash, uuid, password, password_length);
+		context = findWalletContext(wallet_nv_address, password_hash);
 	}
-	last_error = WALLET_NO_ERROR;
-	return last_error;
-}
-
-/** Change the encryption key of a wallet.
-  * \param password Password to use to derive wallet encryption key.
-  * \param password_length Length of password, in bytes. Use 0 to specify no
-  *                        password (i.e. wallet is unencrypted).
-  * \return #WALLET_NO_ERROR on success, or one of #WalletErrorsEnum if an
-  *         error occurred.
-  */
-WalletErrors changeEncryptionKey(const uint8_t *password, const unsigned int password_length)
-{
-	WalletErrors r;
-
-	if (!wallet_loaded)
+	r = WALLET_NOT_THERE;
+	if (context != NULL)
 	{
-		last_error = WALLET_NOT_LOADED;
-		return last_error;
+		setEncryptionKey(context->key);
+		r = loadCurrentWalletRecord();
+		if (r != WALLET_NO_ERROR)
+		{
+			// The context is stale; fall back to key derivation.
+			memset(context, 0, sizeof(WalletContext));
+			context = NULL;
+		}
 	}
-
-	deriveAndSetEncryptionKey(current_wallet.unencrypted.uuid, password, password_length);
-	// Updating the version field for a hidden wallet would reveal
-	// where it is, so don't do it.
-	if (!is_hidden_wallet)
+	if (context == NULL)
 	{
-		r = updateWalletVersion();
+		r = deriveAndSetEncryptionKey(uuid, password, password_length);
 		if (r != WALLET_NO_ERROR)
 		{
 			last_error = r;
 			return last_error;
 		}
+		r = loadCurrentWalletRecord();
 	}
-
-	calculateWalletChecksum(current_wallet.encrypted.checksum);
-	last_error = writeCurrentWalletRecord(wallet_nv_address);
-	return last_error;
-}
-
-/** Change the name of the currently loaded wallet.
-  * \param new_name This should point to #NAME_LENGTH bytes (padded with
-  *                 spaces if necessary) containing the new desired name of
-  *                 the wallet.
-  * \return #WALLET_NO_ERROR on success, or one of #WalletErrorsEnum if an
-  *         error occurred.
-  */
-WalletErrors changeWalletName(uint8_t *new_name)
-{
-	if (!wallet_loaded)
+	if (r != WALLET_NO_ERROR)
 	{
-		last_error = WALLET_NOT_LOADED;
+		last_error = r;
 		return last_error;
 	}
-	if (is_hidden_wallet)
+
+	// Whether or not they were handed out before, every reserved address
+	// handle now counts as issued, so that none of them can be reused. The
+	// exception is when the wallet was unloaded earlier in this session and
+	// the reservation hasn't changed since then.
+	num_addresses_issued = current_wallet.encrypted.num_addresses;
+	if ((context != NULL) && !context->in_use)
 	{
-		// Wallet name updates on a hidden wallet would reveal where it is
-		// (since names are publicly visible), so don't allow name changes.
-		last_error = WALLET_INVALID_OPERATION;
-		return last_error;
+		// The context timed out (see expireWalletContexts()) while the
+		// wallet record was being read. The key is still good, so just
+		// remember it again.
+		context = NULL;
 	}
-
-	memcpy(current_wallet.unencrypted.name, new_name, NAME_LENGTH);
-	calculateWalletChecksum(current_wallet.encrypted.checksum);
-	last_error = writeCurrentWalletRecord(wallet_nv_address);
+	if (context != NULL)
+	{
+		if (context->num_addresses_reserved == current_wallet.encrypted.num_addresses)
+		{
+			num_addresses_issued = context->num_addresses_issued;
+		}
+		current_context = context;
+		touchWalletContext(current_context);
+	}
+	else if (password_length > 0)
+	{
+		current_context = rememberWallet(password_hash);
+	}
+	memset(password_hash, 0, sizeof(password_hash));
+	wallet_loaded = true;
+	last_error = WALLET_NO_ERROR;
 	return last_error;
 }
 
-/** Obtain publicly available information about a wallet. "Publicly available"
-  * means that the leakage of that information would have a relatively low
-  * impact on security (compared to the leaking of, say, the deterministic
-  * private key generator seed).
-  *
-  * Note that unlike most of the other wallet functions, this function does
-  * not require the wallet to be loaded. This is so that a user can be
-  * presented with a list of all the wallets stored on a hardware Bitcoin
-  * wallet, without having to know the encryption key to each wallet.
-  * \param out_version The version (see #WalletVersion) of the wallet will be
-  *                    written to here (if everything goes well).
-  * \param out_name The (space-padded) name of the wallet will be written
-  *                 to here (if everything goes well). This should be a
-  *                 byte array with enough space to store #NAME_LENGTH bytes.
-  * \param out_uuid The wallet UUID will be written to here (if everything
-  *                 goes well). This should be a byte array with enough space
-  *                 to store #UUID_LENGTH bytes.
-  * \param wallet_spec The wallet number of the wallet to query.
+/** Unload wallet, so that it cannot be used until initWallet() is called.
+  * If the wallet is encrypted, it stays unlocked (see #WalletContext); use
+  * lockAllWallets() to lock it.
   * \return #WALLET_NO_ERROR on success, or one of #WalletErrorsEnum if an
   *         error occurred.
   */
-WalletErrors getWalletInfo(uint32_t *out_version, uint8_t *out_name, uint8_t *out_uuid, uint32_t wallet_spec)
+WalletErrors uninitWallet(void)
 {
-	WalletErrors r;
-	WalletRecord local_wallet_record;
-	uint32_t local_wallet_nv_address;
-
-	if (getNumberOfWallets() == 0)
-	{
-		return last_error; // propagate error code
-	}
-	if (wallet_spec >= num_wallets)
-	{
-		last_error = WALLET_INVALID_WALLET_NUM;
-		return last_error;
-	}
-	local_wallet_nv_address = wallet_spec * sizeof(WalletRecord);
-	r = readWalletRecord(&local_wallet_record, local_wallet_nv_address);
-	if (r != WALLET_NO_ERROR)
+	if (current_context != NULL)
 	{
-		last_error = r;
-		return last_error;
+		current_context->num_addresses_reserved = current_wallet.encrypted.num_addresses;
+		current_context->num_addresses_issued = num_addresses_issued;
+		touchWalletContext(current_context);
+		current_context = NULL;
 	}
-	*out_version = local_wallet_record.unencrypted.version;
-	memcpy(out_name, local_wallet_record.unencrypted.name, NAME_LENGTH);
-	memcpy(out_uuid, local_wallet_record.unencrypted.uuid, UUID_LENGTH);
-
+	clearParentPublicKeyCache();
+	memset(&current_parent_public_key, 0, sizeof(current_parent_public_key));
+	current_parent_public_key_valid = false;
+	bip32ClearCache();
+	clearPrederivedAddresses();
+	wallet_loaded = false;
+	is_hidden_wallet = false;
+	wallet_nv_address = 0;
+	memset(&current_wallet, 0, sizeof(WalletRecord));
 	last_error = WALLET_NO_ERROR;
 	return last_error;
 }
 
-/** Initiate a wallet backup of the currently loaded wallet.
-  * \param do_encrypt Whether the wallet backup will be written in encrypted
-  *                   form.
-  * \param destination_device See writeBackupSeed().
+#ifdef TEST_WALLET
+void logVersionFieldWrite(uint32_t address);
+#endif // #ifdef TEST_WALLET
+
+/** Sanitise (clear) a selected area of non-volatile storage. This can take
+  * a while, so it calls longOperationYield() between passes and between
+  * chunks of the random passes. If the host cancels, the area is left
+  * partially cleared.
+  * \param partition The partition the area is contained in. Must be one
+  *                  of #NVPartitions.
+  * \param start The first address within the partition which will be cleared.
+  *              Must be a multiple of 4.
+  * \param length The number of bytes to clear. Must be a multiple of 4.
   * \return #WALLET_NO_ERROR on success, or one of #WalletErrorsEnum if an
   *         error occurred.
   */
-WalletErrors backupWallet(bool do_encrypt, uint32_t destination_device)
+static WalletErrors sanitiseNonVolatileStorage(NVPartitions partition, uint32_t start, uint32_t length)
 {
-	uint8_t encrypted_seed[SEED_LENGTH];
-	uint8_t n[16];
-	bool r;
-	uint8_t i;
+	uint8_t buffer[32];
+	uint8_t pool_state[ENTROPY_POOL_LENGTH];
+	uint32_t address;
+	uint32_t bytes_written;
+	uint32_t bytes_to_write;
+	NonVolatileReturn r;
+	uint8_t pass;
+	bool cancelled;
 
-	if (!wallet_loaded)
+	if (getEntropyPool(pool_state))
 	{
-		last_error = WALLET_NOT_LOADED;
+		last_error = WALLET_RNG_FAILURE;
 		return last_error;
 	}
-
-	if (do_encrypt)
-	{
-#ifdef TEST
-		assert(SEED_LENGTH % 16 == 0);
-#endif
-		memset(n, 0, 16);
-		for (i = 0; i < SEED_LENGTH; i = (uint8_t)(i + 16))
-		{
-			writeU32LittleEndian(n, i);
-			xexEncrypt(&(encrypted_seed[i]), &(current_wallet.encrypted.seed[i]), n, 1);
-		}
-		r = writeBackupSeed(encrypted_seed, do_encrypt, destination_device);
-	}
-	else
+	if (partition == PARTITION_ACCOUNTS)
 	{
-		r = writeBackupSeed(current_wallet.encrypted.seed, do_encrypt, destination_device);
+		invalidateWalletDirectory();
 	}
-	if (r)
+
+	// The following check guards all occurrences of (address + length + offset)
+	// from integer overflow, for all reasonable values of "offset".
+	if ((start > 0x10000000) || (length >  0x10000000))
 	{
-		last_error = WALLET_BACKUP_ERROR;
+		// address might overflow.
+		last_error = WALLET_BAD_ADDRESS;
 		return last_error;
 	}
-	else
+
+	// The "must be a multiple of 4" checks are there so that version fields
+	// (which are 4 bytes long) are always either completely cleared or not
+	// touched at all.
+	if (((start % 4) != 0) || ((length % 4) != 0))
 	{
-		last_error = WALLET_NO_ERROR;
+		// start and length not multiples of 4.
+		last_error = WALLET_BAD_ADDRESS;
 		return last_error;
 	}
-}
-
-/** Get the number of wallets which can fit in non-volatile storage, assuming
-  * the storage format specified in storage_common.h.
-  * This will set #num_wallets.
-  * \return The number of wallets on success, or 0 if a read error occurred.
-  */
-uint32_t getNumberOfWallets(void)
-{
-	uint32_t size;
 
-	last_error = WALLET_NO_ERROR;
-	if (num_wallets == 0)
+	// 4 pass format: all 0s, all 1s, random, random. This ensures that
+	// every bit is cleared at least once, set at least once and ends up
+	// in an unpredictable state.
+	// It is crucial that the last pass is random for two reasons:
+	// 1. A new device UUID is written, if necessary.
+	// 2. Hidden wallets are actually plausibly deniable.
+	cancelled = false;
+	for (pass = 0; (pass < 4) && !cancelled; pass++)
 	{
-		// Need to calculate number of wallets that can fit in non-volatile
-		// storage.
-		if (nonVolatileGetSize(&size, PARTITION_ACCOUNTS) == NV_NO_ERROR)
+		cancelled = longOperationYield(LONG_OPERATION_SANITISE, pass * length, 4 * length);
+		if (cancelled)
 		{
-			num_wallets = size / sizeof(WalletRecord);
+			break;
 		}
-		else
+		if (pass < 2)
 		{
-			last_error = WALLET_READ_ERROR;
-			num_wallets = 0;
+			// The constant passes are handed to the platform in one go, so
+			// that it can use native erase/program commands.
+			r = nonVolatileFill(partition, start, length, (uint8_t)((pass == 0) ? 0x00 : 0xff));
+			if (r != NV_NO_ERROR)
+			{
+				last_error = WALLET_WRITE_ERROR;
+				return last_error;
+			}
 		}
-	}
-	return num_wallets;
-}
-
-#ifdef TEST
-
-/** Size of global partition, in bytes. */
-#define TEST_GLOBAL_PARTITION_SIZE		512
-/** Size of accounts partition, in bytes. */
-#define TEST_ACCOUNTS_PARTITION_SIZE	1024
-
-/** Use this to stop nonVolatileWrite() from logging
-  * all non-volatile writes to stdout. */
-static bool suppress_write_debug_info;
-
-/** Size of accounts partition. This can be modified to test the behaviour of
-  * getNumberOfWallets(). */
-static uint32_t accounts_partition_size = TEST_ACCOUNTS_PARTITION_SIZE;
-
-#ifdef TEST_WALLET
-/** Highest non-volatile address that nonVolatileWrite() has written to.
-  * Index to this array = partition number. */
-static uint32_t maximum_address_written[2];
-/** Lowest non-volatile address that nonVolatileWrite() has written to.
-  * Index to this array = partition number. */
-static uint32_t minimum_address_written[2];
+		else
+		{
+			address = start;
+			bytes_written = 0;
+			while (bytes_written < length)
+			{
+				cancelled = longOperationYield(LONG_OPERATION_SANITISE, pass * length + bytes_written, 4 * length);
+				if (cancelled)
+				{
+					break;
+				}
+				if (getRandom256TemporaryPool(buffer, pool_state))
+				{
+					// Before returning, attempt to write the persistent
+					// entropy pool state back into non-volatile memory.
+					// The return value of setEntropyPool() is ignored because
+					// if a failure occurs, then WALLET_RNG_FAILURE is a
+					// suitable return value anyway.
+#ifdef TEST_WALLET
+					if (!suppress_set_entropy_pool)
 #endif // #ifdef TEST_WALLET
+					{
+						setEntropyPool(pool_state);
+					}
+					last_error = WALLET_RNG_FAILURE;
+					return last_error;
+				}
+				bytes_to_write = length - bytes_written;
+				if (bytes_to_write > sizeof(buffer))
+				{
+					bytes_to_write = sizeof(buffer);
+				}
+				if (bytes_to_write > 0)
+				{
+					r = nonVolatileWrite(buffer, partition, address, bytes_to_write);
+					if (r != NV_NO_ERROR)
+					{
+						last_error = WALLET_WRITE_ERROR;
+						return last_error;
+					}
+				}
+				address += bytes_to_write;
+				bytes_written += bytes_to_write;
+			} // end while (bytes_written < length)
+		} // end if (pass < 2)
 
-/** Get size of a partition.
-  * \param out_size On success, the size of the partition (in number of bytes)
-  *                 will be written here.
-  * \param partition Partition to query. Must be one of #NVPartitions.
-  * \return See #NonVolatileReturnEnum for return values.
-  */
-extern NonVolatileReturn nonVolatileGetSize(uint32_t *out_size, NVPartitions partition)
-{
-	if (partition == PARTITION_GLOBAL)
+		// After each pass, flush write buffers to ensure that
+		// non-volatile memory is actually overwritten.
+		r = nonVolatileFlush();
+		if (r != NV_NO_ERROR)
+		{
+			last_error = WALLET_WRITE_ERROR;
+			return last_error;
+		}
+	} // end for (pass = 0; (pass < 4) && !cancelled; pass++)
+
+#ifdef TEST_WALLET
+	if (!suppress_set_entropy_pool)
+#endif // #ifdef TEST_WALLET
 	{
-		*out_size = TEST_GLOBAL_PARTITION_SIZE;
-		return NV_NO_ERROR;
+		// Write back persistent entropy pool state. This is done even if the
+		// host cancelled, because the random passes may have used it.
+		if (setEntropyPool(pool_state))
+		{
+			last_error = WALLET_RNG_FAILURE;
+			return last_error;
+		}
 	}
-	else if (partition == PARTITION_ACCOUNTS)
+	if (cancelled)
 	{
-		*out_size = accounts_partition_size;
-		return NV_NO_ERROR;
+		last_error = WALLET_CANCELLED;
+		return last_error;
 	}
-	else
+
+	// At this point the selected area is now filled with random data.
+	// Some functions in this file expect non-random data in certain locations.
+
+	// If the selected area includes the device UUID, then a new device
+	// UUID needs to be written. But if the selected area includes the
+	// device UUID, then it will be overwritten with random data in the
+	// above loop. Thus no additional work is needed.
+
+	// Write VERSION_NOTHING_THERE to all possible locations of the
+	// version field. This ensures that a wallet won't accidentally
+	// (1 in 2 ^ 31 chance) be recognised as a valid wallet by
+	// getWalletInfo().
+	if (partition == PARTITION_ACCOUNTS)
 	{
-		return NV_INVALID_ADDRESS;
-	}
+		address = start;
+		address /= sizeof(WalletRecord);
+		address *= sizeof(WalletRecord);
+		address += offsetof(WalletRecord, unencrypted.version);
+		// address is now rounded down to the first possible address where
+		// the version field of a wallet could be stored.
+		memset(buffer, 0, sizeof(uint32_t));
+		while ((address + sizeof(uint32_t)) <= (start + length))
+		{
+			// An additional range check against start is needed because the
+			// initial value of address is rounded down; thus it could be
+			// rounded down below start.
+			if (address >= start)
+			{
+				r = nonVolatileWrite(buffer, partition, address, sizeof(uint32_t));
+				if (r == NV_NO_ERROR)
+				{
+					r = nonVolatileFlush();
+				}
+				else if (r != NV_NO_ERROR)
+				{
+					last_error = WALLET_WRITE_ERROR;
+					return last_error;
+				}
+#ifdef TEST_WALLET
+				if (r == NV_NO_ERROR)
+				{
+					logVersionFieldWrite(address);
+				}
+#endif // #ifdef TEST_WALLET
+			}
+			address += sizeof(WalletRecord);
+		} // end while ((address + sizeof(uint32_t)) <= (start + length))
+	} // end if (partition == PARTITION_ACCOUNTS)
+
+	last_error = WALLET_NO_ERROR;
+	return last_error;
 }
 
-/** Write to non-volatile storage. All platform-independent code assumes that
-  * non-volatile memory acts like NOR flash/EEPROM: arbitrary bits may be
-  * reset from 1 to 0 ("programmed") in any order, but setting bits
-  * from 0 to 1 ("erasing") is very expensive.
-  * \param data A pointer to the data to be written.
-  * \param partition The partition to write to. Must be one of #NVPartitions.
-  * \param address Byte offset specifying where in the partition to
-  *                start writing to.
-  * \param length The number of bytes to write.
-  * \return See #NonVolatileReturnEnum for return values.
-  * \warning Writes may be buffered; use nonVolatileFlush() to be sure that
-  *          data is actually written to non-volatile storage.
+/** Sanitise (clear) the entire contents of a partition.
+  * \param partition The partition to clear. Must be one of #NVPartitions.
+  * \return #WALLET_NO_ERROR on success, or one of #WalletErrorsEnum if an
+  *         error occurred.
   */
-NonVolatileReturn nonVolatileWrite(uint8_t *data, NVPartitions partition, uint32_t address, uint32_t length)
+static WalletErrors sanitisePartition(NVPartitions partition)
 {
-	uint32_t partition_offset;
 	uint32_t size;
-	NonVolatileReturn r;
-#if !defined(TEST_XEX) && !defined(TEST_PRANDOM)
-	uint32_t i;
-#endif // #if !defined(TEST_XEX) && !defined(TEST_PRANDOM)
 
-	if ((address > 0x10000000) || (length > 0x10000000))
-	{
-		// address + length might overflow.
-		return NV_INVALID_ADDRESS;
-	}
-	r = nonVolatileGetSize(&size, partition);
-	if (r != NV_NO_ERROR)
+	if (nonVolatileGetSize(&size, partition) != NV_NO_ERROR)
 	{
-		return r;
+		last_error = WALLET_BAD_ADDRESS;
+		return last_error;
 	}
-	if ((address + length) > size)
+	if (partition == PARTITION_ACCOUNTS)
 	{
-		return NV_INVALID_ADDRESS;
+		forgetAllWalletContexts();
 	}
+	traceEvent(TRACE_SANITISE_BEGIN, partition);
+	last_error = sanitiseNonVolatileStorage(partition, 0, size);
+	traceEvent(TRACE_SANITISE_END, last_error);
+	return last_error;
+}
 
-#ifdef TEST_WALLET
-	if (length > 0)
-	{
-		if (address < minimum_address_written[partition])
-		{
-			minimum_address_written[partition] = address;
-		}
-		if ((address + length - 1) > maximum_address_written[partition])
-		{
-			maximum_address_written[partition] = address + length - 1;
-		}
-	}
-#endif // #ifdef TEST_WALLET
+/** Record that the accounts partition has room for the address index,
+  * change filter and stored parent public key of each wallet (see
+  * #ACCOUNTS_LAYOUT_WITH_EXTRAS). This must only be done just after the
+  * accounts partition has been sanitised, since it changes the meaning of
+  * most of the partition.
+  * \return #WALLET_NO_ERROR on success, or one of #WalletErrorsEnum if an
+  *         error occurred.
+  */
+static WalletErrors setAccountsLayoutWithExtras(void)
+{
+	uint8_t buffer[8];
 
-	// Don't output write debugging info when testing xex.c or prandom.c,
-	// otherwise the console will go crazy (since they do a lot of writing).
-#if !defined(TEST_XEX) && !defined(TEST_PRANDOM)
-	if (!suppress_write_debug_info)
-	{
-		printf("nv write, part = %d, addr = 0x%08x, length = 0x%04x, data =", (int)partition, (int)address, (int)length);
-		for (i = 0; i < length; i++)
-		{
-			printf(" %02x", data[i]);
-		}
-		printf("\n");
-	}
-#endif // #if !defined(TEST_XEX) && !defined(TEST_PRANDOM)
-	if (partition == PARTITION_GLOBAL)
+	writeU32LittleEndian(buffer, ACCOUNTS_LAYOUT_WITH_EXTRAS);
+	writeU32LittleEndian(&(buffer[4]), ~(uint32_t)ACCOUNTS_LAYOUT_WITH_EXTRAS);
+	num_wallets = 0; // force getNumberOfWallets() to look at the layout again
+	if (nonVolatileWrite(buffer, PARTITION_GLOBAL, ADDRESS_ACCOUNTS_LAYOUT, sizeof(buffer)) != NV_NO_ERROR)
 	{
-		partition_offset = 0;
+		return WALLET_WRITE_ERROR;
 	}
-	else
+	if (nonVolatileFlush() != NV_NO_ERROR)
 	{
-		assert(nonVolatileGetSize(&partition_offset, PARTITION_GLOBAL) == NV_NO_ERROR);
+		return WALLET_WRITE_ERROR;
 	}
-	fseek(wallet_test_file, (long)(partition_offset + address), SEEK_SET);
-	fwrite(data, (size_t)length, 1, wallet_test_file);
-	return NV_NO_ERROR;
+	return WALLET_NO_ERROR;
 }
 
-/** Read from non-volatile storage.
-  * \param data A pointer to the buffer which will receive the data.
-  * \param partition The partition to read from. Must be one of #NVPartitions.
-  * \param address Byte offset specifying where in the partition to
-  *                start reading from.
-  * \param length The number of bytes to read.
-  * \return See #NonVolatileReturnEnum for return values.
+/** Sanitise (clear) all partitions. Since that leaves no wallets behind,
+  * the accounts partition is then switched to the layout which has room for
+  * the address index, change filter and stored parent public key of each
+  * wallet (see #ACCOUNTS_LAYOUT_WITH_EXTRAS).
+  * \return #WALLET_NO_ERROR on success, or one of #WalletErrorsEnum if an
+  *         error occurred.
   */
-extern NonVolatileReturn nonVolatileRead(uint8_t *data, NVPartitions partition, uint32_t address, uint32_t length)
+WalletErrors sanitiseEverything(void)
 {
-	uint32_t partition_offset;
-	uint32_t size;
-	NonVolatileReturn r;
-
-	if ((address > 0x10000000) || (length > 0x10000000))
+	last_error = sanitisePartition(PARTITION_GLOBAL);
+	if (last_error == WALLET_NO_ERROR)
 	{
-		// address + length might overflow.
-		return NV_INVALID_ADDRESS;
+		last_error = sanitisePartition(PARTITION_ACCOUNTS);
 	}
-	r = nonVolatileGetSize(&size, partition);
-	if (r != NV_NO_ERROR)
+	if (last_error == WALLET_NO_ERROR)
 	{
-		return r;
+		last_error = setAccountsLayoutWithExtras();
 	}
-	if ((address + length) > size)
+	return last_error;
+}
+
+/** Computes wallet version of current wallet. This is in its own function
+  * because it's used by both newWallet() and changeEncryptionKey().
+  * \return See #WalletErrors.
+  */
+static WalletErrors updateWalletVersion(void)
+{
+	if (is_hidden_wallet)
 	{
-		return NV_INVALID_ADDRESS;
+		// Hidden wallets should not ever have their version fields updated;
+		// that would give away their presence.
+		return WALLET_INVALID_OPERATION;
 	}
-
-	if (partition == PARTITION_GLOBAL)
+	if (isEncryptionKeyNonZero())
 	{
-		partition_offset = 0;
+		current_wallet.unencrypted.version = VERSION_IS_ENCRYPTED;
 	}
 	else
 	{
-		assert(nonVolatileGetSize(&partition_offset, PARTITION_GLOBAL) == NV_NO_ERROR);
+		current_wallet.unencrypted.version = VERSION_UNENCRYPTED;
 	}
-	fseek(wallet_test_file, (long)(partition_offset + address), SEEK_SET);
-	fread(data, (size_t)length, 1, wallet_test_file);
-	return NV_NO_ERROR;
-}
-
-/** Ensure that all buffered writes are committed to non-volatile storage.
-  * Since this is for testing only, this probably doesn't need to be called
-  * at all.
-  * \return See #NonVolatileReturnEnum for return values.
-  */
-NonVolatileReturn nonVolatileFlush(void)
-{
-	fflush(wallet_test_file);
-	return NV_NO_ERROR;
+	return WALLET_NO_ERROR;
 }
 
-/** Pretend to overwrite anything in RAM which could contain sensitive
-  * data. */
-void sanitiseRam(void)
+/** Delete a wallet, so that it's contents can no longer be retrieved from
+  * non-volatile storage.
+  * \param wallet_spec The wallet number of the wallet to delete. The wallet
+  *                    doesn't have to "exist"; calling this function for a
+  *                    non-existent wallet will clear the non-volatile space
+  *                    associated with it. This is useful for deleting a
+  *                    hidden wallet.
+  * \warning This is irreversible; the only way to access the wallet after
+  *          deletion is to restore a backup.
+  */
+WalletErrors deleteWallet(uint32_t wallet_spec)
 {
-	// do nothing
+	uint32_t address;
+
+	if (getNumberOfWallets() == 0)
+	{
+		return last_error; // propagate error code
+	}
+	if (wallet_spec >= num_wallets)
+	{
+		last_error = WALLET_INVALID_WALLET_NUM;
+		return last_error;
+	}
+	// Always unload current wallet, just in case the current wallet is the
+	// one being deleted.
+	if (uninitWallet() != WALLET_NO_ERROR)
+	{
+		return last_error; // propagate error code
+	}
+	address = wallet_spec * sizeof(WalletRecord);
+	forgetWalletContexts(address);
+	last_error = sanitiseNonVolatileStorage(PARTITION_ACCOUNTS, address, sizeof(WalletRecord));
+	if (last_error != WALLET_NO_ERROR)
+	{
+		return last_error;
+	}
+	if (wallet_extras_enabled)
+	{
+		// The wallet's address index, change filter and stored parent
+		// public key have to go too.
+		last_error = sanitiseNonVolatileStorage(PARTITION_ACCOUNTS, getWalletExtrasAddress(wallet_spec), (uint32_t)WALLET_EXTRAS_SIZE);
+	}
+	return last_error;
 }
 
-/** Where test wallet backups will be written to, for comparison. */
-static uint8_t test_wallet_backup[SEED_LENGTH];
+/** Encrypt or decrypt a wallet seed for a backup, using the current
+  * encryption key. Each 16 byte block is encrypted using its offset within
+  * the seed as the tweak.
+  * \param out The encrypted (or decrypted) seed will be written here. This
+  *            must be a byte array with space for #SEED_LENGTH bytes.
+  * \param in The seed to encrypt (or decrypt). This must be a byte array of
+  *           length #SEED_LENGTH bytes, and it may be the same as out.
+  * \param decrypt false to encrypt, true to decrypt.
+  */
+static void encryptBackupSeed(uint8_t *out, uint8_t *in, bool decrypt)
+{
+	uint8_t n[16];
+	uint8_t i;
 
-/** Write backup seed to some output device. The choice of output device and
-  * seed representation is up to the platform-dependent code. But a typical
-  * example would be displaying the seed as a hexadecimal string on a LCD.
-  * \param seed A byte array of length #SEED_LENGTH bytes which contains the
-  *             backup seed.
-  * \param is_encrypted Specifies whether the seed has been encrypted.
-  * \param destination_device Specifies which (platform-dependent) device the
-  *                           backup seed should be sent to.
-  * \return false on success, true if the backup seed could not be written
-  *         to the destination device.
+#ifdef TEST
+	assert(SEED_LENGTH % 16 == 0);
+#endif
+	memset(n, 0, 16);
+	for (i = 0; i < SEED_LENGTH; i = (uint8_t)(i + 16))
+	{
+		writeU32LittleEndian(n, i);
+		if (decrypt)
+		{
+			xexDecrypt(&(out[i]), &(in[i]), n, 1);
+		}
+		else
+		{
+			xexEncrypt(&(out[i]), &(in[i]), n, 1);
+		}
+	}
+}
+
+/** Calculate the digest which protects a backup created by
+  * exportWalletBackup(). It covers the unencrypted seed, so that it catches
+  * a wrong password as well as corruption in transit.
+  * \param out The digest will be written here. This must be a byte array
+  *            with space for 32 bytes.
+  * \param uuid The wallet UUID, which must be #UUID_LENGTH bytes long.
+  * \param seed The unencrypted seed, which must be #SEED_LENGTH bytes long.
   */
-bool writeBackupSeed(uint8_t *seed, bool is_encrypted, uint32_t destination_device)
+static void calculateBackupDigest(uint8_t *out, const uint8_t *uuid, const uint8_t *seed)
 {
-	int i;
+	HashState hs;
 
-	if (destination_device > 0)
+	sha256Begin(&hs);
+	sha256WriteBytes(&hs, uuid, UUID_LENGTH);
+	sha256WriteBytes(&hs, seed, SEED_LENGTH);
+	sha256Finish(&hs);
+	writeHashToByteArray(out, &hs, true);
+}
+
+/** Create new wallet. This is the common part of newWallet() and
+  * restoreWalletBackup(); see newWallet() for a description of most of the
+  * parameters.
+  * \param wallet_spec See newWallet().
+  * \param name See newWallet().
+  * \param use_seed See newWallet().
+  * \param seed See newWallet(). If backup_uuid is not NULL, this is
+  *             the encrypted seed from the backup instead.
+  * \param make_hidden See newWallet(). This must be false if backup_uuid is
+  *                    not NULL.
+  * \param backup_uuid UUID of the wallet that seed was backed up from (see
+  *                    exportWalletBackup()), or NULL if seed isn't from such
+  *                    a backup.
+  * \param backup_digest Digest from the backup. This is ignored if
+  *                      backup_uuid is NULL.
+  * \param password See newWallet().
+  * \param password_length See newWallet().
+  * \return See newWallet(), or #WALLET_BACKUP_ERROR if the decrypted seed
+  *         doesn't match backup_digest.
+  */
+static WalletErrors createNewWallet(uint32_t wallet_spec, uint8_t *name, bool use_seed, uint8_t *seed, bool make_hidden, const uint8_t *backup_uuid, const uint8_t *backup_digest, const uint8_t *password, const unsigned int password_length)
+{
+	uint8_t random_buffer[32];
+	uint8_t uuid[UUID_LENGTH];
+	uint8_t password_hash[32];
+	uint8_t calculated_digest[32];
+	WalletErrors r;
+
+	if (uninitWallet() != WALLET_NO_ERROR)
 	{
-		return true;
+		return last_error; // propagate error code
+	}
+
+	if (getNumberOfWallets() == 0)
+	{
+		return last_error; // propagate error code
+	}
+	if (wallet_spec >= num_wallets)
+	{
+		last_error = WALLET_INVALID_WALLET_NUM;
+		return last_error;
+	}
+	wallet_nv_address = wallet_spec * sizeof(WalletRecord);
+
+	// Check for existing wallet.
+	r = readWalletRecord(&current_wallet, wallet_nv_address);
+	if (r != WALLET_NO_ERROR)
+	{
+		last_error = r;
+		return last_error;
+	}
+	if (current_wallet.unencrypted.version != VERSION_NOTHING_THERE)
+	{
+		last_error = WALLET_ALREADY_EXISTS;
+		return last_error;
+	}
+	forgetWalletContexts(wallet_nv_address);
+
+	if (backup_uuid != NULL)
+	{
+		// The backup's seed is encrypted using a key derived from its UUID,
+		// so the restored wallet keeps that UUID.
+		memcpy(uuid, backup_uuid, UUID_LENGTH);
+	}
+	else if (make_hidden)
+	{
+		// The creation of a hidden wallet is supposed to be discreet, so
+		// all unencrypted fields should be left untouched. This forces us to
+		// use the existing UUID.
+		memcpy(uuid, current_wallet.unencrypted.uuid, UUID_LENGTH);
 	}
 	else
 	{
-		printf("Test wallet seed written:");
-		for (i = 0; i < SEED_LENGTH; i++)
+		// Generate wallet UUID now, because it is needed to derive the wallet
+		// encryption key.
+		if (getRandom256(random_buffer))
 		{
-			printf(" %02x", seed[i]);
+			last_error = WALLET_RNG_FAILURE;
+			return last_error;
 		}
-		printf("\n");
-		if (is_encrypted)
+		memcpy(uuid, random_buffer, UUID_LENGTH);
+	}
+	r = deriveAndSetEncryptionKey(uuid, password, password_length);
+	if (r != WALLET_NO_ERROR)
+	{
+		last_error = r;
+		return last_error;
+	}
+
+	// Update unencrypted fields of current_wallet.
+	if (!make_hidden)
+	{
+		r = updateWalletVersion();
+		if (r != WALLET_NO_ERROR)
 		{
-			printf("Seed is encrypted\n");
+			last_error = r;
+			return last_error;
 		}
-		else
+		memset(current_wallet.unencrypted.reserved, 0, sizeof(current_wallet.unencrypted.reserved));
+		memcpy(current_wallet.unencrypted.name, name, NAME_LENGTH);
+		memcpy(current_wallet.unencrypted.uuid, uuid, UUID_LENGTH);
+	}
+
+	// Update encrypted fields of current_wallet.
+	current_wallet.encrypted.num_addresses = 0;
+	if (getRandom256(random_buffer))
+	{
+		last_error = WALLET_RNG_FAILURE;
+		return last_error;
+	}
+	memcpy(current_wallet.encrypted.padding, random_buffer, sizeof(current_wallet.encrypted.padding));
+	updateCounterBlockCheck();
+	current_wallet.encrypted.flags = 0;
+	current_wallet.encrypted.format = WALLET_FORMAT_SEPARATE_COUNTER;
+	memset(current_wallet.encrypted.reserved, 0, sizeof(current_wallet.encrypted.reserved));
+	if (backup_uuid != NULL)
+	{
+		encryptBackupSeed(current_wallet.encrypted.seed, seed, true);
+		// A wrong password gives a garbage seed. Catch that here, before
+		// anything is written.
+		calculateBackupDigest(calculated_digest, uuid, current_wallet.encrypted.seed);
+		if (memcmp(calculated_digest, backup_digest, sizeof(calculated_digest)) != 0)
 		{
-			printf("Seed is unencrypted\n");
+			memset(&current_wallet, 0, sizeof(WalletRecord));
+			clearEncryptionKey();
+			last_error = WALLET_BACKUP_ERROR;
+			return last_error;
 		}
-		memcpy(test_wallet_backup, seed, SEED_LENGTH);
-		return false;
 	}
-}
-
-#endif // #ifdef TEST
-
-#ifdef TEST_WALLET
+	else if (use_seed)
+	{
+		memcpy(current_wallet.encrypted.seed, seed, SEED_LENGTH);
+	}
+	else
+	{
+		if (getRandom256(random_buffer))
+		{
+			last_error = WALLET_RNG_FAILURE;
+			return last_error;
+		}
+		memcpy(current_wallet.encrypted.seed, random_buffer, 32);
+		if (getRandom256(random_buffer))
+		{
+			last_error = WALLET_RNG_FAILURE;
+			return last_error;
+		}
+		memcpy(&(current_wallet.encrypted.seed[32]), random_buffer, 32);
+	}
+	calculateWalletChecksum(current_wallet.encrypted.checksum, WALLET_FORMAT_SEPARATE_COUNTER);
 
-/** List of non-volatile addresses that logVersionFieldWrite() received. */
-uint32_t version_field_writes[TEST_ACCOUNTS_PARTITION_SIZE / sizeof(WalletRecord) + 2];
-/** Index into #version_field_writes where next entry will be written. */
-int version_field_index;
+	r = writeCurrentWalletRecord(wallet_nv_address);
+	if (r != WALLET_NO_ERROR)
+	{
+		last_error = r;
+		return last_error;
+	}
+	// There could be an old wallet's address index and change filter
+	// encrypted using the same key (e.g. when a hidden wallet is created
+	// over another one).
+	r = clearIndex();
+	if (r == WALLET_NO_ERROR)
+	{
+		r = clearChangeFilter();
+	}
+	if (r == WALLET_NO_ERROR)
+	{
+		// Derive the parent public key once, here, instead of every time the
+		// wallet is loaded.
+		deriveParentPublicKey();
+		r = writeParentKeyEntry();
+	}
+	if (r != WALLET_NO_ERROR)
+	{
+		last_error = r;
+		return last_error;
+	}
 
-/** This will be called by sanitiseNonVolatileStorage() every time it
-  * clears the version field of a wallet. This is used to test whether
-  * sanitiseNonVolatileStorage() is clearing version fields properly.
-  * \param address The address (in non-volatile storage) where the cleared
-  *                version field is.
-  */
-void logVersionFieldWrite(uint32_t address)
-{
-	if (version_field_index < (sizeof(version_field_writes) / sizeof(uint32_t)))
+	// Remember the new wallet, so that initWallet() doesn't have to derive
+	// the encryption key again.
+	if (password_length > 0)
 	{
-		version_field_writes[version_field_index++] = address;
+		calculatePasswordHash(password_hash, uuid, password, password_length);
+		rememberWallet(password_hash);
+		memset(password_hash, 0, sizeof(password_hash));
 	}
+
+	last_error = initWallet(wallet_spec, password, password_length);
+	return last_error;
 }
 
-/** Clear the list of version field writes. */
-void clearVersionFieldWriteLog(void)
+/** Create new wallet. A brand new wallet contains no addresses and should
+  * have a unique, unpredictable deterministic private key generation seed.
+  * \param wallet_spec The wallet number of the new wallet.
+  * \param name Should point to #NAME_LENGTH bytes (padded with spaces if
+  *             necessary) containing the desired name of the wallet.
+  * \param use_seed If this is true, then the contents of seed will be
+  *                 used as the deterministic private key generation seed.
+  *                 If this is false, then the contents of seed will be
+  *                 ignored.
+  * \param seed The deterministic private key generation seed to use in the
+  *             new wallet. This should be a byte array of length #SEED_LENGTH
+  *             bytes. This parameter will be ignored if use_seed is false.
+  * \param make_hidden Whether to make the new wallet a hidden wallet.
+  * \param password Password to use to derive wallet encryption key.
+  * \param password_length Length of password, in bytes. Use 0 to specify no
+  *                        password (i.e. wallet is unencrypted).
+  * \return #WALLET_NO_ERROR on success, or one of #WalletErrorsEnum if an
+  *         error occurred. If this returns #WALLET_NO_ERROR, then the
+  *         wallet will also be loaded.
+  * \warning This will erase the current one.
+  */
+WalletErrors newWallet(uint32_t wallet_spec, uint8_t *name, bool use_seed, uint8_t *seed, bool make_hidden, const uint8_t *password, const unsigned int password_length)
 {
-	version_field_index = 0;
+	return createNewWallet(wallet_spec, name, use_seed, seed, make_hidden, NULL, NULL, password, password_length);
 }
 
-/** Call nearly all wallet functions and make sure they
-  * return #WALLET_NOT_LOADED somehow. This should only be called if a wallet
-  * is not loaded. */
-static void checkFunctionsReturnWalletNotLoaded(void)
+/** Create new wallet from a backup made by exportWalletBackup(), possibly
+  * on another device. Unlike restoring a seed using newWallet(), the seed
+  * never appears in plaintext outside the device, and the restored wallet
+  * keeps the UUID of the original.
+  * \param wallet_spec See newWallet().
+  * \param name See newWallet().
+  * \param uuid UUID of the backed up wallet. This must be a byte array of
+  *             length #UUID_LENGTH bytes.
+  * \param encrypted_seed Encrypted seed from the backup. This must be a byte
+  *                       array of length #SEED_LENGTH bytes.
+  * \param digest Digest from the backup. This must be a byte array of length
+  *               32 bytes.
+  * \param password Password of the backed up wallet.
+  * \param password_length Length of password, in bytes.
+  * \return #WALLET_NO_ERROR on success, #WALLET_BACKUP_ERROR if the digest
+  *         doesn't match the decrypted seed (because the backup is corrupted
+  *         or the password is wrong), or one of #WalletErrorsEnum if another
+  *         error occurred. If this returns #WALLET_NO_ERROR, then the wallet
+  *         will also be loaded.
+  */
+WalletErrors restoreWalletBackup(uint32_t wallet_spec, uint8_t *name, const uint8_t *uuid, uint8_t *encrypted_seed, const uint8_t *digest, const uint8_t *password, const unsigned int password_length)
 {
-	uint8_t temp[128];
-	uint32_t check_num_addresses;
-	AddressHandle ah;
-	PointAffine public_key;
+	return createNewWallet(wallet_spec, name, true, encrypted_seed, false, uuid, digest, password, password_length);
+}
 
-	// newWallet() not tested because it calls initWallet() when it's done.
+/** Generate a new address using the deterministic private key generator.
+  * Address handles are reserved in blocks of #ADDRESS_RESERVATION_BLOCK, so
+  * most calls don't write to non-volatile storage.
+  * \param out_address The new address will be written here (if everything
+  *                    goes well). This must be a byte array with space for
+  *                    20 bytes.
+  * \param out_public_key The public key corresponding to the new address will
+  *                       be written here (if everything goes well).
+  * \return The address handle of the new address on success,
+  *         or #BAD_ADDRESS_HANDLE if an error occurred.
+  *         Use walletGetLastError() to get more detail about an error.
+  */
+AddressHandle makeNewAddress(uint8_t *out_address, PointAffine *out_public_key)
+{
+	WalletErrors r;
+	uint32_t limit;
+	uint32_t old_reserved;
+
+	if (!wallet_loaded)
+	{
+		last_error = WALLET_NOT_LOADED;
+		return BAD_ADDRESS_HANDLE;
+	}
+#ifdef TEST_WALLET
+	limit = MAX_TESTING_ADDRESSES;
+#else
+	limit = MAX_ADDRESSES;
+#endif // #ifdef TEST_WALLET
+	if (num_addresses_issued >= limit)
+	{
+		last_error = WALLET_FULL;
+		return BAD_ADDRESS_HANDLE;
+	}
+	if (num_addresses_issued >= current_wallet.encrypted.num_addresses)
+	{
+		// Out of reserved handles; reserve another block. The reservation
+		// must reach non-volatile storage before any handle from it is
+		// handed out, otherwise a handle could be reused after a reset.
+		old_reserved = current_wallet.encrypted.num_addresses;
+		if ((limit - num_addresses_issued) < ADDRESS_RESERVATION_BLOCK)
+		{
+			current_wallet.encrypted.num_addresses = limit;
+		}
+		else
+		{
+			current_wallet.encrypted.num_addresses = num_addresses_issued + ADDRESS_RESERVATION_BLOCK;
+		}
+		r = writeCurrentCounterBlock();
+		if (r != WALLET_NO_ERROR)
+		{
+			current_wallet.encrypted.num_addresses = old_reserved;
+			updateCounterBlockCheck();
+			last_error = r;
+			return BAD_ADDRESS_HANDLE;
+		}
+	}
+	num_addresses_issued++;
+	last_error = getAddressAndPublicKey(out_address, out_public_key, num_addresses_issued);
+	if (last_error == WALLET_NO_ERROR)
+	{
+		last_error = addToChangeFilter(out_address, num_addresses_issued);
+	}
+	if (last_error != WALLET_NO_ERROR)
+	{
+		return BAD_ADDRESS_HANDLE;
+	}
+	else
+	{
+		return num_addresses_issued;
+	}
+}
+
+/** Check whether an address belongs to the currently loaded wallet, so that
+  * the user interface can tell change outputs apart from outputs which pay
+  * someone else. Only addresses which makeNewAddress() has handed out and
+  * which are still in the change filter (see #WALLET_CHANGE_FILTER_ENTRIES)
+  * are recognised. This costs one encrypted non-volatile read, plus (only
+  * if the address looks like it could be one of the wallet's) one call to
+  * getAddressAndPublicKey() to make sure, so a false positive is not
+  * possible.
+  * \param address The address to check. This must be a byte array of length
+  *                20 bytes (the 160 bit hash from a pay to public key hash
+  *                output script).
+  * \return true if the address is one of the wallet's, false if it isn't,
+  *         if it couldn't be recognised or if an error occurred. Use
+  *         walletGetLastError() to tell the last two apart.
+  */
+bool isOwnAddress(const uint8_t *address)
+{
+	ChangeFilterEntry entry;
+	uint8_t own_address[20];
+	PointAffine public_key;
+
+	if (!wallet_loaded)
+	{
+		last_error = WALLET_NOT_LOADED;
+		return false;
+	}
+	last_error = WALLET_NO_ERROR;
+	if ((WALLET_CHANGE_FILTER_ENTRIES == 0) || !wallet_extras_enabled)
+	{
+		return false;
+	}
+	if (encryptedNonVolatileRead((uint8_t *)&entry, PARTITION_ACCOUNTS, getChangeFilterEntryAddress(getChangeFilterSlot(address)), sizeof(entry)) != NV_NO_ERROR)
+	{
+		last_error = WALLET_READ_ERROR;
+		return false;
+	}
+	if ((entry.address_handle == 0) || (entry.address_handle > num_addresses_issued)
+		|| (memcmp(entry.fingerprint, address, sizeof(entry.fingerprint)) != 0))
+	{
+		return false;
+	}
+	if (getAddressAndPublicKey(own_address, &public_key, entry.address_handle) != WALLET_NO_ERROR)
+	{
+		return false;
+	}
+	return memcmp(own_address, address, 20) == 0;
+}
+
+/** Calculate the address corresponding to a public key. The address is
+  * RIPEMD-160 of SHA-256 of the compressed, serialised public key.
+  * \param out_address The address will be written here (if everything
+  *                    goes well). This must be a byte array with space for
+  *                    20 bytes.
+  * \param public_key The public key to calculate the address of.
+  * \return #WALLET_NO_ERROR on success, or #WALLET_INVALID_HANDLE if the
+  *         public key is the point at infinity.
+  */
+static WalletErrors publicKeyToAddress(uint8_t *out_address, PointAffine *public_key)
+{
+	uint8_t serialised[ECDSA_MAX_SERIALISE_SIZE];
+	uint8_t serialised_size;
+
+	serialised_size = ecdsaSerialise(serialised, public_key, true);
+	if (serialised_size < 2)
+	{
+		// Somehow, the public ended up as the point at infinity.
+		return WALLET_INVALID_HANDLE;
+	}
+	hash160(out_address, serialised, serialised_size);
+	return WALLET_NO_ERROR;
+}
+
+/** Calculate the address and public key of an address handle of the
+  * currently loaded wallet. Unlike getAddressAndPublicKey(), this doesn't
+  * check whether the address handle has been handed out, so it can be used
+  * to calculate addresses ahead of time.
+  * \param out_address The address will be written here (if everything
+  *                    goes well). This must be a byte array with space for
+  *                    20 bytes.
+  * \param out_public_key The public key will be written here (if
+  *                       everything goes well).
+  * \param ah The address handle to calculate the address/public key of.
+  * \return #WALLET_NO_ERROR on success, or one of #WalletErrorsEnum if an
+  *         error occurred.
+  */
+static WalletErrors deriveAddressAndPublicKey(uint8_t *out_address, PointAffine *out_public_key, AddressHandle ah)
+{
+	uint8_t buffer[32];
+
+	// Calculate private key.
+	if (generateDeterministic256(buffer, current_wallet.encrypted.seed, ah))
+	{
+		// This should never happen.
+		return WALLET_RNG_FAILURE;
+	}
+	// Calculate public key.
+	pointMultiplyBase(out_public_key, buffer);
+	memset(buffer, 0, sizeof(buffer));
+	// Calculate address.
+	return publicKeyToAddress(out_address, out_public_key);
+}
+
+/** Given an address handle, use the deterministic private key
+  * generator to generate the address and public key associated
+  * with that address handle.
+  * \param out_address The address will be written here (if everything
+  *                    goes well). This must be a byte array with space for
+  *                    20 bytes.
+  * \param out_public_key The public key corresponding to the address will
+  *                       be written here (if everything goes well).
+  * \param ah The address handle to obtain the address/public key of.
+  * \return #WALLET_NO_ERROR on success, or one of #WalletErrorsEnum if an
+  *         error occurred.
+  */
+WalletErrors getAddressAndPublicKey(uint8_t *out_address, PointAffine *out_public_key, AddressHandle ah)
+{
+	PrederivedAddress *prederived;
+
+	if (!wallet_loaded)
+	{
+		last_error = WALLET_NOT_LOADED;
+		return last_error;
+	}
+	if (num_addresses_issued == 0)
+	{
+		last_error = WALLET_EMPTY;
+		return last_error;
+	}
+	if ((ah == 0) || (ah > num_addresses_issued) || (ah == BAD_ADDRESS_HANDLE))
+	{
+		last_error = WALLET_INVALID_HANDLE;
+		return last_error;
+	}
+
+	// The address index may already have the answer.
+	if (readIndexEntry(out_address, out_public_key, ah))
+	{
+		last_error = WALLET_NO_ERROR;
+		return last_error;
+	}
+
+	// Otherwise, prederiveAddresses() may have calculated it already.
+	prederived = findPrederivedAddress(ah);
+	if (prederived != NULL)
+	{
+		memcpy(out_address, prederived->address, 20);
+		memcpy(out_public_key, &(prederived->public_key), sizeof(PointAffine));
+		last_error = WALLET_NO_ERROR;
+	}
+	else
+	{
+		last_error = deriveAddressAndPublicKey(out_address, out_public_key, ah);
+	}
+	if (last_error == WALLET_NO_ERROR)
+	{
+		last_error = writeIndexEntry(out_address, out_public_key, ah);
+	}
+	return last_error;
+}
+
+/** Calculate the address and public key of one of the next
+  * #WALLET_PREDERIVED_ADDRESSES address handles (the ones makeNewAddress()
+  * will hand out next) of the currently loaded wallet, so that they don't
+  * have to be calculated when they are asked for. This does at most one
+  * point multiplication per call, and nothing once all of those address
+  * handles have been calculated. It is meant to be registered as a
+  * background task (see addBackgroundTask()) on platforms which can spare
+  * the time for a point multiplication while idle.
+  */
+void prederiveAddresses(void)
+{
+#if WALLET_PREDERIVED_ADDRESSES > 0
+	PrederivedAddress *slot;
+	AddressHandle ah;
+	uint8_t i;
+
+	if (!wallet_loaded)
+	{
+		return;
+	}
+	// Find the first upcoming address handle which hasn't been calculated.
+	ah = BAD_ADDRESS_HANDLE;
+	for (i = 1; i <= WALLET_PREDERIVED_ADDRESSES; i++)
+	{
+		if (num_addresses_issued > (MAX_ADDRESSES - i))
+		{
+			break; // no more address handles can be handed out
+		}
+		if (findPrederivedAddress(num_addresses_issued + i) == NULL)
+		{
+			ah = num_addresses_issued + i;
+			break;
+		}
+	}
+	if (ah == BAD_ADDRESS_HANDLE)
+	{
+		return; // nothing to do
+	}
+	// Replace the entry with the lowest address handle. Empty entries have
+	// address handle 0, so they are used first. Since at least one of the
+	// upcoming address handles isn't in #prederived_addresses, the entry
+	// being replaced won't be one of them.
+	slot = &(prederived_addresses[0]);
+	for (i = 1; i < WALLET_PREDERIVED_ADDRESSES; i++)
+	{
+		if (prederived_addresses[i].address_handle < slot->address_handle)
+		{
+			slot = &(prederived_addresses[i]);
+		}
+	}
+	slot->address_handle = 0;
+	if (deriveAddressAndPublicKey(slot->address, &(slot->public_key), ah) == WALLET_NO_ERROR)
+	{
+		slot->address_handle = ah;
+	}
+#endif // #if WALLET_PREDERIVED_ADDRESSES > 0
+}
+
+/** Obtain the addresses and public keys of a contiguous range of address
+  * handles. This gives the same results as calling getAddressAndPublicKey()
+  * for each address handle in the range, but it's faster, since all the
+  * public keys are calculated together using pointMultiplyBaseBatch().
+  * \param out_addresses The addresses will be written here (if everything
+  *                      goes well). This must be a byte array with space
+  *                      for 20 * count bytes.
+  * \param out_public_keys The public keys corresponding to the addresses
+  *                        will be written here (if everything goes well).
+  *                        This must have space for count points.
+  * \param start_ah The address handle of the first address in the range.
+  * \param count The number of addresses in the range. This must be between
+  *              1 and #ECDSA_MAX_BATCH (inclusive).
+  * \return #WALLET_NO_ERROR on success, or one of #WalletErrorsEnum if an
+  *         error occurred.
+  */
+WalletErrors getAddressesAndPublicKeys(uint8_t *out_addresses, PointAffine *out_public_keys, AddressHandle start_ah, uint8_t count)
+{
+	uint8_t private_keys[ECDSA_MAX_BATCH * 32];
+	WalletErrors r;
+	uint8_t i;
+
+	if (!wallet_loaded)
+	{
+		last_error = WALLET_NOT_LOADED;
+		return last_error;
+	}
+	if (num_addresses_issued == 0)
+	{
+		last_error = WALLET_EMPTY;
+		return last_error;
+	}
+	if ((count == 0) || (count > ECDSA_MAX_BATCH))
+	{
+		last_error = WALLET_INVALID_OPERATION;
+		return last_error;
+	}
+	// The comparisons are arranged so that they can't overflow.
+	if ((start_ah == 0) || (start_ah > num_addresses_issued)
+		|| ((num_addresses_issued - start_ah) < (uint32_t)(count - 1)))
+	{
+		last_error = WALLET_INVALID_HANDLE;
+		return last_error;
+	}
+
+	// Calculate private keys.
+	for (i = 0; i < count; i++)
+	{
+		r = getPrivateKey(&(private_keys[i * 32]), start_ah + i);
+		if (r != WALLET_NO_ERROR)
+		{
+			memset(private_keys, 0, sizeof(private_keys));
+			last_error = r;
+			return r;
+		}
+	}
+	// Calculate public keys.
+	pointMultiplyBaseBatch(out_public_keys, private_keys, count);
+	memset(private_keys, 0, sizeof(private_keys));
+	// Calculate addresses.
+	for (i = 0; i < count; i++)
+	{
+		r = publicKeyToAddress(&(out_addresses[i * 20]), &(out_public_keys[i]));
+		if (r != WALLET_NO_ERROR)
+		{
+			last_error = r;
+			return r;
+		}
+	}
+
+	last_error = WALLET_NO_ERROR;
+	return last_error;
+}
+
+/** Get the master public key of the currently loaded wallet. Every public key
+  * (and address) in a wallet can be derived from the master public key and
+  * chain code. However, even with posession of the master public key, all
+  * private keys are still secret.
+  * \param out_public_key The master public key will be written here.
+  * \param out_chain_code The chain code will be written here. This must be a
+  *                       byte array with space for 32 bytes.
+  * \return #WALLET_NO_ERROR on success, or one of #WalletErrorsEnum if an
+  *         error occurred.
+  */
+WalletErrors getMasterPublicKey(PointAffine *out_public_key, uint8_t *out_chain_code)
+{
+	if (!wallet_loaded)
+	{
+		last_error = WALLET_NOT_LOADED;
+		return last_error;
+	}
+	if (!current_parent_public_key_valid)
+	{
+		deriveParentPublicKey();
+	}
+	memcpy(out_chain_code, &(current_wallet.encrypted.seed[32]), 32);
+	memcpy(out_public_key, &current_parent_public_key, sizeof(PointAffine));
+	last_error = WALLET_NO_ERROR;
+	return last_error;
+}
+
+/** Get the BIP32 extended public key of a node of the currently loaded
+  * wallet. The seed is used directly as the BIP32 master node; its layout
+  * (32 byte big-endian private key followed by 32 byte chain code) is the
+  * same as that of a node. With the extended public key, a host can derive
+  * all non-hardened descendants of the node without asking the device.
+  * \param out The serialised extended public key will be written here (see
+  *            bip32GetExtendedPublicKey()). This must be a byte array with
+  *            space for #BIP32_XPUB_LENGTH bytes.
+  * \param path Path from the master node to the desired node.
+  * \param path_length Number of steps in path.
+  * \return #WALLET_NO_ERROR on success, or one of #WalletErrorsEnum if an
+  *         error occurred.
+  */
+WalletErrors getExtendedPublicKey(uint8_t *out, const uint32_t *path, const unsigned int path_length)
+{
+	if (!wallet_loaded)
+	{
+		last_error = WALLET_NOT_LOADED;
+		return last_error;
+	}
+	if (bip32GetExtendedPublicKey(out, current_wallet.encrypted.seed, path, path_length))
+	{
+		last_error = WALLET_INVALID_OPERATION;
+		return last_error;
+	}
+	last_error = WALLET_NO_ERROR;
+	return last_error;
+}
+
+/** Get the current number of addresses in a wallet.
+  * \return The current number of addresses on success, or 0 if an error
+  *         occurred. Use walletGetLastError() to get more detail about
+  *         an error.
+  */
+uint32_t getNumAddresses(void)
+{
+	if (!wallet_loaded)
+	{
+		last_error = WALLET_NOT_LOADED;
+		return 0;
+	}
+	if (num_addresses_issued == 0)
+	{
+		last_error = WALLET_EMPTY;
+		return 0;
+	}
+	else
+	{
+		last_error = WALLET_NO_ERROR;
+		return num_addresses_issued;
+	}
+}
+
+/** Given an address handle, use the deterministic private key
+  * generator to generate the private key associated with that address handle.
+  * \param out The private key will be written here (if everything goes well).
+  *            This must be a byte array with space for 32 bytes.
+  * \param ah The address handle to obtain the private key of.
+  * \return #WALLET_NO_ERROR on success, or one of #WalletErrorsEnum if an
+  *         error occurred.
+  */
+WalletErrors getPrivateKey(uint8_t *out, AddressHandle ah)
+{
+	if (!wallet_loaded)
+	{
+		last_error = WALLET_NOT_LOADED;
+		return last_error;
+	}
+	if (num_addresses_issued == 0)
+	{
+		last_error = WALLET_EMPTY;
+		return last_error;
+	}
+	if ((ah == 0) || (ah > num_addresses_issued) || (ah == BAD_ADDRESS_HANDLE))
+	{
+		last_error = WALLET_INVALID_HANDLE;
+		return last_error;
+	}
+	if (generateDeterministic256(out, current_wallet.encrypted.seed, ah))
+	{
+		// This should never happen.
+		last_error = WALLET_RNG_FAILURE;
+		return last_error;
+	}
+	last_error = WALLET_NO_ERROR;
+	return last_error;
+}
+
+/** Change the encryption key of a wallet.
+  * \param password Password to use to derive wallet encryption key.
+  * \param password_length Length of password, in bytes. Use 0 to specify no
+  *                        password (i.e. wallet is unencrypted).
+  * \return #WALLET_NO_ERROR on success, or one of #WalletErrorsEnum if an
+  *         error occurred.
+  */
+WalletErrors changeEncryptionKey(const uint8_t *password, const unsigned int password_length)
+{
+	WalletErrors r;
+	uint8_t password_hash[32];
+#if WALLET_CHANGE_FILTER_ENTRIES > 0
+	ChangeFilterEntry change_filter[WALLET_CHANGE_FILTER_ENTRIES];
+	uint32_t slot;
+#endif // #if WALLET_CHANGE_FILTER_ENTRIES > 0
+
+	if (!wallet_loaded)
+	{
+		last_error = WALLET_NOT_LOADED;
+		return last_error;
+	}
+
+#if WALLET_CHANGE_FILTER_ENTRIES > 0
+	// Unlike the address index, the change filter can't be filled again
+	// without deriving every address, so it is decrypted here, using the
+	// old key, and encrypted again using the new key below. Entries which
+	// can't be read are just left empty.
+	for (slot = 0; slot < WALLET_CHANGE_FILTER_ENTRIES; slot++)
+	{
+		if (!wallet_extras_enabled
+			|| (encryptedNonVolatileRead((uint8_t *)&(change_filter[slot]), PARTITION_ACCOUNTS, getChangeFilterEntryAddress(slot), sizeof(ChangeFilterEntry)) != NV_NO_ERROR))
+		{
+			memset(&(change_filter[slot]), 0, sizeof(ChangeFilterEntry));
+		}
+	}
+#endif // #if WALLET_CHANGE_FILTER_ENTRIES > 0
+	r = deriveAndSetEncryptionKey(current_wallet.unencrypted.uuid, password, password_length);
+	if (r != WALLET_NO_ERROR)
+	{
+		last_error = r;
+		return last_error;
+	}
+	// Any remembered key for this wallet is about to become wrong.
+	forgetWalletContexts(wallet_nv_address);
+	// Updating the version field for a hidden wallet would reveal
+	// where it is, so don't do it.
+	if (!is_hidden_wallet)
+	{
+		r = updateWalletVersion();
+		if (r != WALLET_NO_ERROR)
+		{
+			last_error = r;
+			return last_error;
+		}
+	}
+
+	calculateWalletChecksum(current_wallet.encrypted.checksum, WALLET_FORMAT_SEPARATE_COUNTER);
+	last_error = writeCurrentWalletRecord(wallet_nv_address);
+	if (last_error != WALLET_NO_ERROR)
+	{
+		return last_error;
+	}
+	if (password_length > 0)
+	{
+		calculatePasswordHash(password_hash, current_wallet.unencrypted.uuid, password, password_length);
+		current_context = rememberWallet(password_hash);
+		memset(password_hash, 0, sizeof(password_hash));
+	}
+	// The address index was encrypted using the old key. Rather than
+	// re-encrypting it, just let it be filled again. The stored parent
+	// public key is in RAM, so it is simply written again.
+	last_error = clearIndex();
+	if ((last_error == WALLET_NO_ERROR) && current_parent_public_key_valid)
+	{
+		last_error = writeParentKeyEntry();
+	}
+#if WALLET_CHANGE_FILTER_ENTRIES > 0
+	for (slot = 0; (last_error == WALLET_NO_ERROR) && (slot < WALLET_CHANGE_FILTER_ENTRIES); slot++)
+	{
+		last_error = storeChangeFilterEntry(&(change_filter[slot]), slot);
+	}
+	if ((last_error == WALLET_NO_ERROR) && (nonVolatileFlush() != NV_NO_ERROR))
+	{
+		last_error = WALLET_WRITE_ERROR;
+	}
+#endif // #if WALLET_CHANGE_FILTER_ENTRIES > 0
+	return last_error;
+}
+
+/** Change the name of the currently loaded wallet.
+  * \param new_name This should point to #NAME_LENGTH bytes (padded with
+  *                 spaces if necessary) containing the new desired name of
+  *                 the wallet.
+  * \return #WALLET_NO_ERROR on success, or one of #WalletErrorsEnum if an
+  *         error occurred.
+  */
+WalletErrors changeWalletName(uint8_t *new_name)
+{
+	if (!wallet_loaded)
+	{
+		last_error = WALLET_NOT_LOADED;
+		return last_error;
+	}
+	if (is_hidden_wallet)
+	{
+		// Wallet name updates on a hidden wallet would reveal where it is
+		// (since names are publicly visible), so don't allow name changes.
+		last_error = WALLET_INVALID_OPERATION;
+		return last_error;
+	}
+
+	memcpy(current_wallet.unencrypted.name, new_name, NAME_LENGTH);
+	calculateWalletChecksum(current_wallet.encrypted.checksum, WALLET_FORMAT_SEPARATE_COUNTER);
+	// Only the name and the checksum change, so there's no need to encrypt
+	// and write the seed again.
+	last_error = writeCurrentWalletRecordPart(offsetof(WalletRecord, unencrypted.name), NAME_LENGTH);
+	if (last_error == WALLET_NO_ERROR)
+	{
+		last_error = writeCurrentWalletRecordPart(offsetof(WalletRecord, encrypted.checksum), CHECKSUM_LENGTH);
+	}
+	if ((last_error == WALLET_NO_ERROR) && (nonVolatileFlush() != NV_NO_ERROR))
+	{
+		last_error = WALLET_WRITE_ERROR;
+	}
+	return last_error;
+}
+
+/** Set whether the currently loaded wallet may stay unlocked across
+  * sessions. If it may, then starting a new session (see endWalletSession())
+  * doesn't lock it, so that it can be loaded again without key derivation,
+  * as long as that happens within #KEEP_UNLOCKED_TIMEOUT seconds of its last
+  * use. This is stored in the wallet record. It only has an effect if
+  * ENABLE_KEEP_UNLOCKED is defined.
+  * \param keep_unlocked Whether the wallet may stay unlocked.
+  * \return #WALLET_NO_ERROR on success, or one of #WalletErrorsEnum if an
+  *         error occurred.
+  */
+WalletErrors setWalletKeepUnlocked(bool keep_unlocked)
+{
+	uint8_t old_flags;
+
+	if (!wallet_loaded)
+	{
+		last_error = WALLET_NOT_LOADED;
+		return last_error;
+	}
+	if (current_context == NULL)
+	{
+		// Unencrypted wallets are never locked in the first place.
+		last_error = WALLET_INVALID_OPERATION;
+		return last_error;
+	}
+
+	old_flags = current_wallet.encrypted.flags;
+	if (keep_unlocked)
+	{
+		current_wallet.encrypted.flags |= WALLET_FLAG_KEEP_UNLOCKED;
+	}
+	else
+	{
+		current_wallet.encrypted.flags &= (uint8_t)~WALLET_FLAG_KEEP_UNLOCKED;
+	}
+	last_error = writeCurrentCounterBlock();
+	if (last_error != WALLET_NO_ERROR)
+	{
+		// Keep the in-RAM copy consistent with what is stored.
+		current_wallet.encrypted.flags = old_flags;
+		return last_error;
+	}
+	touchWalletContext(current_context);
+	return last_error;
+}
+
+/** Obtain publicly available information about a wallet. "Publicly available"
+  * means that the leakage of that information would have a relatively low
+  * impact on security (compared to the leaking of, say, the deterministic
+  * private key generator seed).
+  *
+  * Note that unlike most of the other wallet functions, this function does
+  * not require the wallet to be loaded. This is so that a user can be
+  * presented with a list of all the wallets stored on a hardware Bitcoin
+  * wallet, without having to know the encryption key to each wallet.
+  *
+  * The information for the first #WALLET_DIRECTORY_ENTRIES wallets is
+  * remembered in RAM, so asking for it again doesn't need to read
+  * non-volatile storage.
+  * \param out_version The version (see #WalletVersion) of the wallet will be
+  *                    written to here (if everything goes well).
+  * \param out_name The (space-padded) name of the wallet will be written
+  *                 to here (if everything goes well). This should be a
+  *                 byte array with enough space to store #NAME_LENGTH bytes.
+  * \param out_uuid The wallet UUID will be written to here (if everything
+  *                 goes well). This should be a byte array with enough space
+  *                 to store #UUID_LENGTH bytes.
+  * \param wallet_spec The wallet number of the wallet to query.
+  * \return #WALLET_NO_ERROR on success, or one of #WalletErrorsEnum if an
+  *         error occurred.
+  */
+WalletErrors getWalletInfo(uint32_t *out_version, uint8_t *out_name, uint8_t *out_uuid, uint32_t wallet_spec)
+{
+	struct WalletRecordUnencryptedStruct unencrypted;
+	WalletDirectoryEntry *entry;
+	uint32_t local_wallet_nv_address;
+
+	if (getNumberOfWallets() == 0)
+	{
+		return last_error; // propagate error code
+	}
+	if (wallet_spec >= num_wallets)
+	{
+		last_error = WALLET_INVALID_WALLET_NUM;
+		return last_error;
+	}
+	entry = NULL;
+	if (wallet_spec < WALLET_DIRECTORY_ENTRIES)
+	{
+		entry = &(wallet_directory[wallet_spec]);
+	}
+	if ((entry == NULL) || !entry->valid)
+	{
+		// Only the unencrypted portion is needed, so there's no need to
+		// use readWalletRecord().
+		local_wallet_nv_address = wallet_spec * sizeof(WalletRecord);
+		if (nonVolatileRead(
+			(uint8_t *)&unencrypted,
+			PARTITION_ACCOUNTS,
+			local_wallet_nv_address + offsetof(WalletRecord, unencrypted),
+			sizeof(unencrypted)) != NV_NO_ERROR)
+		{
+			last_error = WALLET_READ_ERROR;
+			return last_error;
+		}
+		*out_version = unencrypted.version;
+		memcpy(out_name, unencrypted.name, NAME_LENGTH);
+		memcpy(out_uuid, unencrypted.uuid, UUID_LENGTH);
+		if (entry != NULL)
+		{
+			entry->version = unencrypted.version;
+			memcpy(entry->name, unencrypted.name, NAME_LENGTH);
+			memcpy(entry->uuid, unencrypted.uuid, UUID_LENGTH);
+			entry->valid = true;
+		}
+	}
+	else
+	{
+		*out_version = entry->version;
+		memcpy(out_name, entry->name, NAME_LENGTH);
+		memcpy(out_uuid, entry->uuid, UUID_LENGTH);
+	}
+
+	last_error = WALLET_NO_ERROR;
+	return last_error;
+}
+
+/** Initiate a wallet backup of the currently loaded wallet.
+  * \param do_encrypt Whether the wallet backup will be written in encrypted
+  *                   form.
+  * \param destination_device See writeBackupSeed().
+  * \return #WALLET_NO_ERROR on success, or one of #WalletErrorsEnum if an
+  *         error occurred.
+  */
+WalletErrors backupWallet(bool do_encrypt, uint32_t destination_device)
+{
+	uint8_t encrypted_seed[SEED_LENGTH];
+	bool r;
+
+	if (!wallet_loaded)
+	{
+		last_error = WALLET_NOT_LOADED;
+		return last_error;
+	}
+
+	if (do_encrypt)
+	{
+		encryptBackupSeed(encrypted_seed, current_wallet.encrypted.seed, false);
+		r = writeBackupSeed(encrypted_seed, do_encrypt, destination_device);
+	}
+	else
+	{
+		r = writeBackupSeed(current_wallet.encrypted.seed, do_encrypt, destination_device);
+	}
+	if (r)
+	{
+		last_error = WALLET_BACKUP_ERROR;
+		return last_error;
+	}
+	else
+	{
+		last_error = WALLET_NO_ERROR;
+		return last_error;
+	}
+}
+
+/** Export an encrypted backup of the currently loaded wallet, so that the
+  * host can restore it (using restoreWalletBackup()) without the seed being
+  * written to a slow output device. The seed is encrypted the same way as
+  * by backupWallet(), so the backup is no more sensitive than the host's
+  * copy of an encrypted backup. A wallet without a password has an all-zero
+  * encryption key, so it can't be exported this way.
+  * \param out_uuid The wallet UUID will be written here. This must be a byte
+  *                 array with space for #UUID_LENGTH bytes.
+  * \param out_encrypted_seed The encrypted seed will be written here. This
+  *                           must be a byte array with space for
+  *                           #SEED_LENGTH bytes.
+  * \param out_digest A digest of the UUID and unencrypted seed, which
+  *                   restoreWalletBackup() will check, will be written here.
+  *                   This must be a byte array with space for 32 bytes.
+  * \return #WALLET_NO_ERROR on success, #WALLET_INVALID_OPERATION if the
+  *         wallet doesn't have a password, or one of #WalletErrorsEnum if
+  *         another error occurred.
+  */
+WalletErrors exportWalletBackup(uint8_t *out_uuid, uint8_t *out_encrypted_seed, uint8_t *out_digest)
+{
+	if (!wallet_loaded)
+	{
+		last_error = WALLET_NOT_LOADED;
+		return last_error;
+	}
+	// Don't trust the host to say whether the wallet is encrypted. Only a
+	// wallet which was loaded using a password has a context.
+	if ((current_context == NULL) && (current_wallet.unencrypted.version != VERSION_IS_ENCRYPTED))
+	{
+		last_error = WALLET_INVALID_OPERATION;
+		return last_error;
+	}
+	memcpy(out_uuid, current_wallet.unencrypted.uuid, UUID_LENGTH);
+	encryptBackupSeed(out_encrypted_seed, current_wallet.encrypted.seed, false);
+	calculateBackupDigest(out_digest, out_uuid, current_wallet.encrypted.seed);
+	last_error = WALLET_NO_ERROR;
+	return last_error;
+}
+
+/** Get the number of wallets which can fit in non-volatile storage. This
+  * depends on the layout of the accounts partition (see
+  * #ACCOUNTS_LAYOUT_WITH_EXTRAS). A partition which hasn't been formatted
+  * since the layout was introduced only holds wallet records, so every
+  * wallet stays where it was, but there's no address index, change filter
+  * or stored parent public key for any wallet. Once the partition has been
+  * formatted, each wallet has all of those, but takes up #WALLET_FOOTPRINT
+  * bytes instead of sizeof(WalletRecord) bytes, so fewer wallets fit. For
+  * example, the PIC32 accounts partition holds 17 wallets before it is
+  * formatted and 4 after, and the LPC11Uxx one holds 20 before and 4
+  * after.
+  * This will set #num_wallets and #wallet_extras_enabled.
+  * \return The number of wallets on success, or 0 if a read error occurred.
+  */
+uint32_t getNumberOfWallets(void)
+{
+	uint32_t size;
+	uint8_t buffer[8];
+	uint32_t layout;
+
+	last_error = WALLET_NO_ERROR;
+	if (num_wallets == 0)
+	{
+		// Need to calculate number of wallets that can fit in non-volatile
+		// storage.
+		if ((nonVolatileGetSize(&size, PARTITION_ACCOUNTS) == NV_NO_ERROR)
+			&& (nonVolatileRead(buffer, PARTITION_GLOBAL, ADDRESS_ACCOUNTS_LAYOUT, sizeof(buffer)) == NV_NO_ERROR))
+		{
+			layout = readU32LittleEndian(buffer);
+			wallet_extras_enabled = (layout == ACCOUNTS_LAYOUT_WITH_EXTRAS)
+				&& (layout == ~readU32LittleEndian(&(buffer[4])));
+			if (wallet_extras_enabled)
+			{
+				num_wallets = size / (uint32_t)WALLET_FOOTPRINT;
+			}
+			else
+			{
+				num_wallets = size / (uint32_t)sizeof(WalletRecord);
+			}
+		}
+		else
+		{
+			last_error = WALLET_READ_ERROR;
+			num_wallets = 0;
+		}
+	}
+	return num_wallets;
+}
+
+#ifdef TEST
+
+/** Size of global partition, in bytes. */
+#define TEST_GLOBAL_PARTITION_SIZE		512
+/** Size of accounts partition, in bytes. This is enough for two wallets
+  * once the partition is formatted (see #WALLET_FOOTPRINT), and for many
+  * more in the original layout, which the tests check too. */
+#define TEST_ACCOUNTS_PARTITION_SIZE	2048
+
+/** Use this to stop nonVolatileWrite() from logging
+  * all non-volatile writes to stdout. */
+static bool suppress_write_debug_info;
+
+/** Size of accounts partition. This can be modified to test the behaviour of
+  * getNumberOfWallets(). */
+static uint32_t accounts_partition_size = TEST_ACCOUNTS_PARTITION_SIZE;
+
+#ifdef TEST_WALLET
+/** Highest non-volatile address that nonVolatileWrite() has written to.
+  * Index to this array = partition number. */
+static uint32_t maximum_address_written[2];
+/** Lowest non-volatile address that nonVolatileWrite() has written to.
+  * Index to this array = partition number. */
+static uint32_t minimum_address_written[2];
+#endif // #ifdef TEST_WALLET
+
+/** Get size of a partition.
+  * \param out_size On success, the size of the partition (in number of bytes)
+  *                 will be written here.
+  * \param partition Partition to query. Must be one of #NVPartitions.
+  * \return See #NonVolatileReturnEnum for return values.
+  */
+extern NonVolatileReturn nonVolatileGetSize(uint32_t *out_size, NVPartitions partition)
+{
+	if (partition == PARTITION_GLOBAL)
+	{
+		*out_size = TEST_GLOBAL_PARTITION_SIZE;
+		return NV_NO_ERROR;
+	}
+	else if (partition == PARTITION_ACCOUNTS)
+	{
+		*out_size = accounts_partition_size;
+		return NV_NO_ERROR;
+	}
+	else
+	{
+		return NV_INVALID_ADDRESS;
+	}
+}
+
+/** Write to non-volatile storage. All platform-independent code assumes that
+  * non-volatile memory acts like NOR flash/EEPROM: arbitrary bits may be
+  * reset from 1 to 0 ("programmed") in any order, but setting bits
+  * from 0 to 1 ("erasing") is very expensive.
+  * \param data A pointer to the data to be written.
+  * \param partition The partition to write to. Must be one of #NVPartitions.
+  * \param address Byte offset specifying where in the partition to
+  *                start writing to.
+  * \param length The number of bytes to write.
+  * \return See #NonVolatileReturnEnum for return values.
+  * \warning Writes may be buffered; use nonVolatileFlush() to be sure that
+  *          data is actually written to non-volatile storage.
+  */
+NonVolatileReturn nonVolatileWrite(uint8_t *data, NVPartitions partition, uint32_t address, uint32_t length)
+{
+	uint32_t partition_offset;
+	uint32_t size;
+	NonVolatileReturn r;
+#if !defined(TEST_XEX) && !defined(TEST_PRANDOM)
+	uint32_t i;
+#endif // #if !defined(TEST_XEX) && !defined(TEST_PRANDOM)
+
+	if ((address > 0x10000000) || (length > 0x10000000))
+	{
+		// address + length might overflow.
+		return NV_INVALID_ADDRESS;
+	}
+	r = nonVolatileGetSize(&size, partition);
+	if (r != NV_NO_ERROR)
+	{
+		return r;
+	}
+	if ((address + length) > size)
+	{
+		return NV_INVALID_ADDRESS;
+	}
+
+#ifdef TEST_WALLET
+	if (length > 0)
+	{
+		if (address < minimum_address_written[partition])
+		{
+			minimum_address_written[partition] = address;
+		}
+		if ((address + length - 1) > maximum_address_written[partition])
+		{
+			maximum_address_written[partition] = address + length - 1;
+		}
+	}
+#endif // #ifdef TEST_WALLET
+
+	// Don't output write debugging info when testing xex.c or prandom.c,
+	// otherwise the console will go crazy (since they do a lot of writing).
+#if !defined(TEST_XEX) && !defined(TEST_PRANDOM)
+	if (!suppress_write_debug_info)
+	{
+		printf("nv write, part = %d, addr = 0x%08x, length = 0x%04x, data =", (int)partition, (int)address, (int)length);
+		for (i = 0; i < length; i++)
+		{
+			printf(" %02x", data[i]);
+		}
+		printf("\n");
+	}
+#endif // #if !defined(TEST_XEX) && !defined(TEST_PRANDOM)
+	if (partition == PARTITION_GLOBAL)
+	{
+		partition_offset = 0;
+	}
+	else
+	{
+		assert(nonVolatileGetSize(&partition_offset, PARTITION_GLOBAL) == NV_NO_ERROR);
+	}
+	fseek(wallet_test_file, (long)(partition_offset + address), SEEK_SET);
+	fwrite(data, (size_t)length, 1, wallet_test_file);
+	return NV_NO_ERROR;
+}
+
+/** Fill an area of non-volatile storage with a single byte value. This has
+  * the same effect as calling nonVolatileWrite() with a buffer filled
+  * with value.
+  * \param partition The partition to fill. Must be one of #NVPartitions.
+  * \param address Byte offset specifying where in the partition to
+  *                start filling.
+  * \param length The number of bytes to fill.
+  * \param value The byte value to fill the area with.
+  * \return See #NonVolatileReturnEnum for return values.
+  */
+NonVolatileReturn nonVolatileFill(NVPartitions partition, uint32_t address, uint32_t length, uint8_t value)
+{
+	uint8_t buffer[32];
+	uint32_t partition_offset;
+	uint32_t size;
+	uint32_t chunk_length;
+	NonVolatileReturn r;
+
+	if ((address > 0x10000000) || (length > 0x10000000))
+	{
+		// address + length might overflow.
+		return NV_INVALID_ADDRESS;
+	}
+	r = nonVolatileGetSize(&size, partition);
+	if (r != NV_NO_ERROR)
+	{
+		return r;
+	}
+	if ((address + length) > size)
+	{
+		return NV_INVALID_ADDRESS;
+	}
+
+#ifdef TEST_WALLET
+	if (length > 0)
+	{
+		if (address < minimum_address_written[partition])
+		{
+			minimum_address_written[partition] = address;
+		}
+		if ((address + length - 1) > maximum_address_written[partition])
+		{
+			maximum_address_written[partition] = address + length - 1;
+		}
+	}
+#endif // #ifdef TEST_WALLET
+
+#if !defined(TEST_XEX) && !defined(TEST_PRANDOM)
+	if (!suppress_write_debug_info)
+	{
+		printf("nv write, part = %d, addr = 0x%08x, length = 0x%04x, fill = %02x\n", (int)partition, (int)address, (int)length, (int)value);
+	}
+#endif // #if !defined(TEST_XEX) && !defined(TEST_PRANDOM)
+	if (partition == PARTITION_GLOBAL)
+	{
+		partition_offset = 0;
+	}
+	else
+	{
+		assert(nonVolatileGetSize(&partition_offset, PARTITION_GLOBAL) == NV_NO_ERROR);
+	}
+	memset(buffer, value, sizeof(buffer));
+	fseek(wallet_test_file, (long)(partition_offset + address), SEEK_SET);
+	while (length > 0)
+	{
+		chunk_length = MIN(length, (uint32_t)sizeof(buffer));
+		fwrite(buffer, (size_t)chunk_length, 1, wallet_test_file);
+		length -= chunk_length;
+	}
+	return NV_NO_ERROR;
+}
+
+/** Read from non-volatile storage.
+  * \param data A pointer to the buffer which will receive the data.
+  * \param partition The partition to read from. Must be one of #NVPartitions.
+  * \param address Byte offset specifying where in the partition to
+  *                start reading from.
+  * \param length The number of bytes to read.
+  * \return See #NonVolatileReturnEnum for return values.
+  */
+extern NonVolatileReturn nonVolatileRead(uint8_t *data, NVPartitions partition, uint32_t address, uint32_t length)
+{
+	uint32_t partition_offset;
+	uint32_t size;
+	NonVolatileReturn r;
+
+	if ((address > 0x10000000) || (length > 0x10000000))
+	{
+		// address + length might overflow.
+		return NV_INVALID_ADDRESS;
+	}
+	r = nonVolatileGetSize(&size, partition);
+	if (r != NV_NO_ERROR)
+	{
+		return r;
+	}
+	if ((address + length) > size)
+	{
+		return NV_INVALID_ADDRESS;
+	}
+
+	if (partition == PARTITION_GLOBAL)
+	{
+		partition_offset = 0;
+	}
+	else
+	{
+		assert(nonVolatileGetSize(&partition_offset, PARTITION_GLOBAL) == NV_NO_ERROR);
+	}
+	fseek(wallet_test_file, (long)(partition_offset + address), SEEK_SET);
+	fread(data, (size_t)length, 1, wallet_test_file);
+	return NV_NO_ERROR;
+}
+
+/** Ensure that all buffered writes are committed to non-volatile storage.
+  * Since this is for testing only, this probably doesn't need to be called
+  * at all.
+  * \return See #NonVolatileReturnEnum for return values.
+  */
+NonVolatileReturn nonVolatileFlush(void)
+{
+	fflush(wallet_test_file);
+	return NV_NO_ERROR;
+}
+
+/** Pretend to overwrite anything in RAM which could contain sensitive
+  * data. */
+void sanitiseRam(void)
+{
+	// do nothing
+}
+
+#ifdef ENABLE_KEEP_UNLOCKED
+/** Fake seconds counter, so that the wallet tests can control the passage
+  * of time. */
+static uint32_t fake_seconds_counter;
+
+/** Stand-in for the platform's seconds counter.
+  * \return The value of #fake_seconds_counter.
+  */
+uint32_t getSecondsCounter(void)
+{
+	return fake_seconds_counter;
+}
+#endif // #ifdef ENABLE_KEEP_UNLOCKED
+
+/** Where test wallet backups will be written to, for comparison. */
+static uint8_t test_wallet_backup[SEED_LENGTH];
+
+/** Write backup seed to some output device. The choice of output device and
+  * seed representation is up to the platform-dependent code. But a typical
+  * example would be displaying the seed as a hexadecimal string on a LCD.
+  * \param seed A byte array of length #SEED_LENGTH bytes which contains the
+  *             backup seed.
+  * \param is_encrypted Specifies whether the seed has been encrypted.
+  * \param destination_device Specifies which (platform-dependent) device the
+  *                           backup seed should be sent to.
+  * \return false on success, true if the backup seed could not be written
+  *         to the destination device.
+  */
+bool writeBackupSeed(uint8_t *seed, bool is_encrypted, uint32_t destination_device)
+{
+	int i;
+
+	if (destination_device > 0)
+	{
+		return true;
+	}
+	else
+	{
+		printf("Test wallet seed written:");
+		for (i = 0; i < SEED_LENGTH; i++)
+		{
+			printf(" %02x", seed[i]);
+		}
+		printf("\n");
+		if (is_encrypted)
+		{
+			printf("Seed is encrypted\n");
+		}
+		else
+		{
+			printf("Seed is unencrypted\n");
+		}
+		memcpy(test_wallet_backup, seed, SEED_LENGTH);
+		return false;
+	}
+}
+
+#endif // #ifdef TEST
+
+#ifdef TEST_WALLET
+
+/** List of non-volatile addresses that logVersionFieldWrite() received. */
+uint32_t version_field_writes[TEST_ACCOUNTS_PARTITION_SIZE / sizeof(WalletRecord) + 2];
+/** Index into #version_field_writes where next entry will be written. */
+int version_field_index;
+
+/** This will be called by sanitiseNonVolatileStorage() every time it
+  * clears the version field of a wallet. This is used to test whether
+  * sanitiseNonVolatileStorage() is clearing version fields properly.
+  * \param address The address (in non-volatile storage) where the cleared
+  *                version field is.
+  */
+void logVersionFieldWrite(uint32_t address)
+{
+	if (version_field_index < (sizeof(version_field_writes) / sizeof(uint32_t)))
+	{
+		version_field_writes[version_field_index++] = address;
+	}
+}
+
+/** Clear the list of version field writes. */
+void clearVersionFieldWriteLog(void)
+{
+	version_field_index = 0;
+}
+
+/** Call nearly all wallet functions and make sure they
+  * return #WALLET_NOT_LOADED somehow. This should only be called if a wallet
+  * is not loaded. */
+static void checkFunctionsReturnWalletNotLoaded(void)
+{
+	uint8_t temp[128];
+	uint32_t check_num_addresses;
+	AddressHandle ah;
+	PointAffine public_key;
+
+	// newWallet() not tested because it calls initWallet() when it's done.
 	ah = makeNewAddress(temp, &public_key);
 	if ((ah == BAD_ADDRESS_HANDLE) && (walletGetLastError() == WALLET_NOT_LOADED))
 	{
 		reportSuccess();
 	}
-	else
+	else
+	{
+		printf("makeNewAddress() doesn't recognise when wallet isn't loaded\n");
+		reportFailure();
+	}
+	check_num_addresses = getNumAddresses();
+	if ((check_num_addresses == 0) && (walletGetLastError() == WALLET_NOT_LOADED))
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("getNumAddresses() doesn't recognise when wallet isn't loaded\n");
+		reportFailure();
+	}
+	if (getAddressAndPublicKey(temp, &public_key, 0) == WALLET_NOT_LOADED)
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("getAddressAndPublicKey() doesn't recognise when wallet isn't loaded\n");
+		reportFailure();
+	}
+	if (getPrivateKey(temp, 0) == WALLET_NOT_LOADED)
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("getPrivateKey() doesn't recognise when wallet isn't loaded\n");
+		reportFailure();
+	}
+	if (changeEncryptionKey(temp, 0) == WALLET_NOT_LOADED)
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("changeEncryptionKey() doesn't recognise when wallet isn't loaded\n");
+		reportFailure();
+	}
+	if (changeWalletName(temp) == WALLET_NOT_LOADED)
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("changeWalletName() doesn't recognise when wallet isn't loaded\n");
+		reportFailure();
+	}
+	if (backupWallet(false, 0) == WALLET_NOT_LOADED)
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("backupWallet() doesn't recognise when wallet isn't loaded\n");
+		reportFailure();
+	}
+	if (exportWalletBackup(temp, &(temp[16]), &(temp[80])) == WALLET_NOT_LOADED)
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("exportWalletBackup() doesn't recognise when wallet isn't loaded\n");
+		reportFailure();
+	}
+	if (getMasterPublicKey(&public_key, temp) == WALLET_NOT_LOADED)
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("getMasterPublicKey() doesn't recognise when wallet isn't loaded\n");
+		reportFailure();
+	}
+	if (getExtendedPublicKey(temp, NULL, 0) == WALLET_NOT_LOADED)
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("getExtendedPublicKey() doesn't recognise when wallet isn't loaded\n");
+		reportFailure();
+	}
+}
+
+/** Call all wallet functions which accept a wallet number and check
+  * that they fail or succeed for a given wallet number.
+  * \param wallet_spec The wallet number to check.
+  * \param should_succeed true if the wallet number is valid (and thus the
+  *                       wallet functions should succeed), false if the wallet
+  *                       number is not valid (and thus the wallet functions
+  *                       should fail).
+  */
+static void checkWalletSpecFunctions(uint32_t wallet_spec, bool should_succeed)
+{
+	uint8_t wallet_uuid[UUID_LENGTH];
+	uint8_t name[NAME_LENGTH];
+	uint32_t version;
+	WalletErrors wallet_return;
+
+	memset(name, ' ', NAME_LENGTH);
+	uninitWallet();
+	wallet_return = newWallet(wallet_spec, name, false, NULL, false, NULL, 0);
+	if (should_succeed && (wallet_return != WALLET_NO_ERROR))
+	{
+		printf("newWallet() failed with wallet number %u when it should have succeeded\n", wallet_spec);
+		reportFailure();
+	}
+	else
+	{
+		reportSuccess();
+	}
+	if (!should_succeed && (wallet_return != WALLET_INVALID_WALLET_NUM))
+	{
+		printf("newWallet() did not return WALLET_INVALID_WALLET_NUM with wallet number %u when it should have\n", wallet_spec);
+		reportFailure();
+	}
+	else
+	{
+		reportSuccess();
+	}
+
+	uninitWallet();
+	// This call to initWallet() must be placed after the call to newWallet()
+	// so that if should_succeed is true, there's a valid wallet in the
+	// specified place.
+	wallet_return = initWallet(wallet_spec, NULL, 0);
+	if (should_succeed && (wallet_return != WALLET_NO_ERROR))
+	{
+		printf("initWallet() failed with wallet number %u when it should have succeeded\n", wallet_spec);
+		reportFailure();
+	}
+	else
+	{
+		reportSuccess();
+	}
+	if (!should_succeed && (wallet_return != WALLET_INVALID_WALLET_NUM))
+	{
+		printf("initWallet() did not return WALLET_INVALID_WALLET_NUM with wallet number %u when it should have\n", wallet_spec);
+		reportFailure();
+	}
+	else
+	{
+		reportSuccess();
+	}
+
+	uninitWallet();
+	wallet_return = getWalletInfo(&version, name, wallet_uuid, wallet_spec);
+	if (should_succeed && (wallet_return != WALLET_NO_ERROR))
+	{
+		printf("getWalletInfo() failed with wallet number %u when it should have succeeded\n", wallet_spec);
+		reportFailure();
+	}
+	else
+	{
+		reportSuccess();
+	}
+	if (!should_succeed && (wallet_return != WALLET_INVALID_WALLET_NUM))
+	{
+		printf("getWalletInfo() did not return WALLET_INVALID_WALLET_NUM with wallet number %u when it should have\n", wallet_spec);
+		reportFailure();
+	}
+	else
+	{
+		reportSuccess();
+	}
+}
+
+const uint8_t test_password0[] = "1234";
+const uint8_t test_password1[] = "ABCDEFGHJ!!!!";
+const uint8_t new_test_password[] = "new password";
+
+int main(void)
+{
+	uint8_t temp[128];
+	uint8_t address1[20];
+	uint8_t address2[20];
+	uint8_t compare_address[20];
+	uint8_t name[NAME_LENGTH];
+	uint8_t name2[NAME_LENGTH];
+	uint8_t compare_name[NAME_LENGTH];
+	uint8_t wallet_uuid[UUID_LENGTH];
+	uint8_t wallet_uuid2[UUID_LENGTH];
+	uint32_t version;
+	uint8_t seed1[SEED_LENGTH];
+	uint8_t seed2[SEED_LENGTH];
+	uint8_t encrypted_seed[SEED_LENGTH];
+	uint8_t chain_code[32];
+	struct WalletRecordUnencryptedStruct unencrypted_part;
+	struct WalletRecordUnencryptedStruct compare_unencrypted_part;
+	uint8_t *address_buffer;
+	uint8_t one_byte;
+	uint8_t rewritten_byte;
+	uint32_t start_address;
+	uint32_t end_address;
+	uint32_t version_field_address;
+	uint32_t returned_num_wallets;
+	uint32_t stupidly_calculated_num_wallets;
+	uint32_t generation;
+	AddressHandle *handles_buffer;
+	AddressHandle ah;
+	AddressHandle ah2;
+	PointAffine master_public_key;
+	PointAffine public_key;
+	PointAffine compare_public_key;
+	PointAffine public_key2;
+	PointAffine *public_key_buffer;
+	PointAffine compare_public_keys[ECDSA_MAX_BATCH];
+	uint8_t compare_addresses[ECDSA_MAX_BATCH * 20];
+	bool abort;
+	bool is_zero;
+	bool abort_duplicate;
+	bool abort_error;
+	int i;
+	int j;
+	int k;
+	int footprint;
+	int version_field_counter;
+	bool found;
+	uint32_t histogram[256];
+	uint32_t histogram_count;
+	uint8_t copy_of_nv[TEST_GLOBAL_PARTITION_SIZE + TEST_ACCOUNTS_PARTITION_SIZE];
+	uint8_t copy_of_nv2[TEST_GLOBAL_PARTITION_SIZE + TEST_ACCOUNTS_PARTITION_SIZE];
+	uint8_t pool_state[ENTROPY_POOL_LENGTH];
+	uint32_t num_addresses_reserved;
+	WalletRecord wallet_record;
+
+	initTests(__FILE__);
+
+	initWalletTest();
+	initialiseDefaultEntropyPool();
+	suppress_set_entropy_pool = false;
+	// Blank out non-volatile storage area (set to all nulls).
+	temp[0] = 0;
+	for (i = 0; i < (TEST_GLOBAL_PARTITION_SIZE + TEST_ACCOUNTS_PARTITION_SIZE); i++)
+	{
+		fwrite(temp, 1, 1, wallet_test_file);
+	}
+
+	// Check that sanitiseEverything() is able to function with NV
+	// storage in this state.
+	minimum_address_written[PARTITION_GLOBAL] = 0xffffffff;
+	maximum_address_written[PARTITION_GLOBAL] = 0;
+	minimum_address_written[PARTITION_ACCOUNTS] = 0xffffffff;
+	maximum_address_written[PARTITION_ACCOUNTS] = 0;
+	if (sanitiseEverything() == WALLET_NO_ERROR)
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("Cannot nuke NV storage using sanitiseEverything()\n");
+		reportFailure();
+	}
+
+	// Check that sanitiseNonVolatileStorage() overwrote (almost) everything
+	// with random data.
+	memset(histogram, 0, sizeof(histogram));
+	histogram_count = 0;
+	fseek(wallet_test_file, 0, SEEK_SET);
+	for (i = 0; i < (TEST_GLOBAL_PARTITION_SIZE + TEST_ACCOUNTS_PARTITION_SIZE); i++)
+	{
+		fread(temp, 1, 1, wallet_test_file);
+		histogram[temp[0]]++;
+		histogram_count++;
+	}
+	// "Random data" here is defined as: no value appears more than 1/16 of the time.
+	abort = false;
+	for (i = 0; i < 256; i++)
+	{
+		if (histogram[i] > (histogram_count / 16))
+		{
+			printf("sanitiseNonVolatileStorage() causes %02x to appear improbably often\n", i);
+			reportFailure();
+			abort = true;
+		}
+	}
+	if (!abort)
+	{
+		reportSuccess();
+	}
+
+	// Check that sanitiseEverything() overwrote everything.
+	if ((minimum_address_written[PARTITION_GLOBAL] != 0)
+		|| (maximum_address_written[PARTITION_GLOBAL] != (TEST_GLOBAL_PARTITION_SIZE - 1))
+		|| (minimum_address_written[PARTITION_ACCOUNTS] != 0)
+		|| (maximum_address_written[PARTITION_ACCOUNTS] != (TEST_ACCOUNTS_PARTITION_SIZE - 1)))
+	{
+		printf("sanitiseEverything() did not overwrite everything\n");
+		reportFailure();
+	}
+	else
+	{
+		reportSuccess();
+	}
+
+	// Check that the version field is "wallet not there".
+	if (getWalletInfo(&version, temp, wallet_uuid, 0) == WALLET_NO_ERROR)
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("getWalletInfo() failed after sanitiseNonVolatileStorage() was called\n");
+		reportFailure();
+	}
+	if (version == VERSION_NOTHING_THERE)
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("sanitiseNonVolatileStorage() does not set version to nothing there\n");
+		reportFailure();
+	}
+
+	// initWallet() hasn't been called yet, so nearly every function should
+	// return WALLET_NOT_THERE somehow.
+	checkFunctionsReturnWalletNotLoaded();
+
+	// The non-volatile storage area was blanked out, so there shouldn't be a
+	// (valid) wallet there.
+	if (initWallet(0, NULL, 0) == WALLET_NOT_THERE)
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("initWallet() doesn't recognise when wallet isn't there\n");
+		reportFailure();
+	}
+
+	// Try creating a wallet and testing initWallet() on it.
+	memcpy(name, "123456789012345678901234567890abcdefghij", NAME_LENGTH);
+	if (newWallet(0, name, false, NULL, false, NULL, 0) == WALLET_NO_ERROR)
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("Could not create new wallet\n");
+		reportFailure();
+	}
+	if (initWallet(0, NULL, 0) == WALLET_NO_ERROR)
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("initWallet() does not recognise new wallet\n");
+		reportFailure();
+	}
+	if ((getNumAddresses() == 0) && (walletGetLastError() == WALLET_EMPTY))
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("New wallet isn't empty\n");
+		reportFailure();
+	}
+
+	// Check that the version field is "unencrypted wallet".
+	if (getWalletInfo(&version, temp, wallet_uuid, 0) == WALLET_NO_ERROR)
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("getWalletInfo() failed after newWallet() was called\n");
+		reportFailure();
+	}
+	if (version == VERSION_UNENCRYPTED)
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("newWallet() does not set version to unencrypted wallet\n");
+		reportFailure();
+	}
+
+	// Check that sanitise_nv_wallet() deletes wallet.
+	if (sanitiseEverything() == WALLET_NO_ERROR)
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("Cannot nuke NV storage using sanitiseNonVolatileStorage()\n");
+		reportFailure();
+	}
+	if (initWallet(0, NULL, 0) == WALLET_NOT_THERE)
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("sanitiseEverything() isn't deleting wallet\n");
+		reportFailure();
+	}
+
+	// Check that newWallet() works.
+	if (newWallet(0, name, false, NULL, false, NULL, 0) == WALLET_NO_ERROR)
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("newWallet() fails for recently sanitised NV storage\n");
+		reportFailure();
+	}
+	if (makeNewAddress(temp, &public_key) != BAD_ADDRESS_HANDLE)
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("Couldn't create new address in new wallet\n");
+		reportFailure();
+	}
+
+	// newWallet() shouldn't overwrite an existing wallet.
+	if (newWallet(0, name, false, NULL, false, NULL, 0) == WALLET_ALREADY_EXISTS)
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("newWallet() overwrites existing wallet\n");
+		reportFailure();
+	}
+
+	// Check that a deleteWallet()/newWallet() sequence does overwrite an
+	// existing wallet.
+	if (deleteWallet(0) == WALLET_NO_ERROR)
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("deleteWallet() failed\n");
+		reportFailure();
+	}
+	if (newWallet(0, name, false, NULL, false, NULL, 0) == WALLET_NO_ERROR)
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("newWallet() fails for recently deleted wallet\n");
+		reportFailure();
+	}
+
+	// Check that deleteWallet() deletes wallet.
+	deleteWallet(0);
+	newWallet(0, name, false, NULL, false, NULL, 0);
+	if (initWallet(0, NULL, 0) == WALLET_NO_ERROR)
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("initWallet() failed just after calling newWallet()\n");
+		reportFailure();
+	}
+	deleteWallet(0);
+	if (initWallet(0, NULL, 0) == WALLET_NOT_THERE)
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("deleteWallet() isn't deleting wallet\n");
+		reportFailure();
+	}
+
+	// Check that deleteWallet() doesn't affect other wallets.
+	deleteWallet(0);
+	deleteWallet(1);
+	newWallet(0, name, false, NULL, false, NULL, 0);
+	newWallet(1, name, false, NULL, false, NULL, 0);
+	deleteWallet(1);
+	if (initWallet(0, NULL, 0) == WALLET_NO_ERROR)
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("deleteWallet() collateral damage to wallet 0\n");
+		reportFailure();
+	}
+	deleteWallet(0);
+	deleteWallet(1);
+	newWallet(0, name, false, NULL, false, NULL, 0);
+	newWallet(1, name, false, NULL, false, NULL, 0);
+	deleteWallet(0);
+	if (initWallet(1, NULL, 0) == WALLET_NO_ERROR)
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("deleteWallet() collateral damage to wallet 1\n");
+		reportFailure();
+	}
+
+	// Make some new addresses, then delete it and create a new wallet,
+	// making sure the new wallet is empty (i.e. check that deleteWallet()
+	// actually deletes a wallet).
+	deleteWallet(0);
+	newWallet(0, name, false, NULL, false, NULL, 0);
+	if (makeNewAddress(temp, &public_key) != BAD_ADDRESS_HANDLE)
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("Couldn't create new address in new wallet 2\n");
+		reportFailure();
+	}
+	deleteWallet(0);
+	newWallet(0, name, false, NULL, false, NULL, 0);
+	if ((getNumAddresses() == 0) && (walletGetLastError() == WALLET_EMPTY))
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("deleteWallet() doesn't delete existing wallet\n");
+		reportFailure();
+	}
+
+	// Unload wallet and make sure everything realises that the wallet is
+	// not loaded.
+	if (uninitWallet() == WALLET_NO_ERROR)
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("uninitWallet() failed to do its basic job\n");
+		reportFailure();
+	}
+	checkFunctionsReturnWalletNotLoaded();
+
+	// Load wallet again. Since there is actually a wallet there, this
+	// should succeed.
+	if (initWallet(0, NULL, 0) == WALLET_NO_ERROR)
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("uninitWallet() appears to be permanent\n");
+		reportFailure();
+	}
+
+	// Change bytes in non-volatile memory and make sure initWallet() fails
+	// because of the checksum check.
+	if (uninitWallet() != WALLET_NO_ERROR)
+	{
+		printf("uninitWallet() failed to do its basic job 2\n");
+		reportFailure();
+	}
+	abort = false;
+	for (i = 0; i < sizeof(WalletRecord); i++)
+	{
+		if (nonVolatileRead(&one_byte, PARTITION_ACCOUNTS, (uint32_t)i, 1) != NV_NO_ERROR)
+		{
+			printf("NV read fail\n");
+			abort = true;
+			break;
+		}
+		one_byte++;
+		if (nonVolatileWrite(&one_byte, PARTITION_ACCOUNTS, (uint32_t)i, 1) != NV_NO_ERROR)
+		{
+			printf("NV write fail\n");
+			abort = true;
+			break;
+		}
+		if (initWallet(0, NULL, 0) == WALLET_NO_ERROR)
+		{
+			printf("Wallet still loads when wallet checksum is wrong, offset = %d\n", i);
+			abort = true;
+			break;
+		}
+		one_byte--;
+		if (nonVolatileWrite(&one_byte, PARTITION_ACCOUNTS, (uint32_t)i, 1) != NV_NO_ERROR)
+		{
+			printf("NV write fail\n");
+			abort = true;
+			break;
+		}
+	}
+	if (!abort)
+	{
+		reportSuccess();
+	}
+	else
+	{
+		reportFailure();
+	}
+
+	// deleteWallet() should succeed even if aimed at a wallet that
+	// "isn't there"; this is how hidden wallets can be deleted.
+	deleteWallet(0);
+	if (deleteWallet(0) == WALLET_NO_ERROR)
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("deleteWallet() can't delete wallet that isn't there\n");
+		reportFailure();
+	}
+
+	// Create 2 new wallets and check that their addresses aren't the same
+	deleteWallet(0);
+	newWallet(0, name, false, NULL, false, NULL, 0);
+	if (makeNewAddress(address1, &public_key) != BAD_ADDRESS_HANDLE)
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("Couldn't create new address in new wallet\n");
+		reportFailure();
+	}
+	deleteWallet(0);
+	newWallet(0, name, false, NULL, false, NULL, 0);
+	memset(address2, 0, 20);
+	memset(&public_key, 0, sizeof(PointAffine));
+	if (makeNewAddress(address2, &public_key) != BAD_ADDRESS_HANDLE)
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("Couldn't create new address in new wallet\n");
+		reportFailure();
+	}
+	if (memcmp(address1, address2, 20))
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("New wallets are creating identical addresses\n");
+		reportFailure();
+	}
+
+	// Check that makeNewAddress() wrote to its outputs.
+	is_zero = true;
+	for (i = 0; i < 20; i++)
+	{
+		if (address2[i] != 0)
+		{
+			is_zero = false;
+			break;
+		}
+	}
+	if (is_zero)
+	{
+		printf("makeNewAddress() doesn't write the address\n");
+		reportFailure();
+	}
+	else
+	{
+		reportSuccess();
+	}
+	if (bigIsZero(public_key.x))
+	{
+		printf("makeNewAddress() doesn't write the public key\n");
+		reportFailure();
+	}
+	else
+	{
+		reportSuccess();
+	}
+
+	// Make some new addresses, up to a limit.
+	// Also check that addresses are unique.
+	deleteWallet(0);
+	newWallet(0, name, false, NULL, false, NULL, 0);
+	abort = false;
+	abort_error = false;
+	address_buffer = (uint8_t *)malloc(MAX_TESTING_ADDRESSES * 20);
+	for (i = 0; i < MAX_TESTING_ADDRESSES; i++)
+	{
+		if (makeNewAddress(&(address_buffer[i * 20]), &public_key) == BAD_ADDRESS_HANDLE)
+		{
+			printf("Couldn't create new address in new wallet\n");
+			reportFailure();
+			abort_error = true;
+			break;
+		}
+		for (j = 0; j < i; j++)
+		{
+			if (!memcmp(&(address_buffer[i * 20]), &(address_buffer[j * 20]), 20))
+			{
+				printf("Wallet addresses aren't unique\n");
+				reportFailure();
+				abort = true;
+				break;
+			}
+		}
+		if (abort || abort_error)
+		{
+			break;
+		}
+	}
+	free(address_buffer);
+	if (!abort)
+	{
+		reportSuccess();
+	}
+	if (!abort_error)
+	{
+		reportSuccess();
+	}
+
+	// The wallet should be full now.
+	// Check that making a new address now causes an appropriate error.
+	if (makeNewAddress(temp, &public_key) == BAD_ADDRESS_HANDLE)
+	{
+		if (walletGetLastError() == WALLET_FULL)
+		{
+			reportSuccess();
+		}
+		else
+		{
+			printf("Creating a new address on a full wallet gives incorrect error\n");
+			reportFailure();
+		}
+	}
+	else
+	{
+		printf("Creating a new address on a full wallet succeeds (it's not supposed to)\n");
+		reportFailure();
+	}
+
+	// Check that getNumAddresses() fails when the wallet is empty.
+	deleteWallet(0);
+	newWallet(0, name, false, NULL, false, NULL, 0);
+	if (getNumAddresses() == 0)
+	{
+		if (walletGetLastError() == WALLET_EMPTY)
+		{
+			reportSuccess();
+		}
+		else
+		{
+			printf("getNumAddresses() doesn't recognise wallet is empty\n");
+			reportFailure();
+		}
+	}
+	else
+	{
+		printf("getNumAddresses() succeeds when used on empty wallet\n");
+		reportFailure();
+	}
+
+	// Create a bunch of addresses in the (now empty) wallet and check that
+	// getNumAddresses() returns the right number.
+	address_buffer = (uint8_t *)malloc(MAX_TESTING_ADDRESSES * 20);
+	public_key_buffer = (PointAffine *)malloc(MAX_TESTING_ADDRESSES * sizeof(PointAffine));
+	handles_buffer = (AddressHandle *)malloc(MAX_TESTING_ADDRESSES * sizeof(AddressHandle));
+	abort = false;
+	for (i = 0; i < MAX_TESTING_ADDRESSES; i++)
+	{
+		ah = makeNewAddress(&(address_buffer[i * 20]), &(public_key_buffer[i]));
+		handles_buffer[i] = ah;
+		if (ah == BAD_ADDRESS_HANDLE)
+		{
+			printf("Couldn't create new address in new wallet\n");
+			abort = true;
+			reportFailure();
+			break;
+		}
+	}
+	if (!abort)
+	{
+		reportSuccess();
+	}
+	if (getNumAddresses() == MAX_TESTING_ADDRESSES)
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("getNumAddresses() returns wrong number of addresses\n");
+		reportFailure();
+	}
+
+	// The wallet should contain unique addresses.
+	abort_duplicate = false;
+	for (i = 0; i < MAX_TESTING_ADDRESSES; i++)
+	{
+		for (j = 0; j < i; j++)
+		{
+			if (!memcmp(&(address_buffer[i * 20]), &(address_buffer[j * 20]), 20))
+			{
+				printf("Wallet has duplicate addresses\n");
+				abort_duplicate = true;
+				reportFailure();
+				break;
+			}
+		}
+		if (abort_duplicate)
+		{
+			break;
+		}
+	}
+	if (!abort_duplicate)
+	{
+		reportSuccess();
+	}
+
+	// The wallet should contain unique public keys.
+	abort_duplicate = false;
+	for (i = 0; i < MAX_TESTING_ADDRESSES; i++)
 	{
-		printf("makeNewAddress() doesn't recognise when wallet isn't loaded\n");
-		reportFailure();
+		for (j = 0; j < i; j++)
+		{
+			if (bigCompare(public_key_buffer[i].x, public_key_buffer[j].x) == BIGCMP_EQUAL)
+			{
+				printf("Wallet has duplicate public keys\n");
+				abort_duplicate = true;
+				reportFailure();
+				break;
+			}
+		}
+		if (abort_duplicate)
+		{
+			break;
+		}
 	}
-	check_num_addresses = getNumAddresses();
-	if ((check_num_addresses == 0) && (walletGetLastError() == WALLET_NOT_LOADED))
+	if (!abort_duplicate)
 	{
 		reportSuccess();
 	}
-	else
+
+	// The address handles should start at 1 and be sequential.
+	abort = false;
+	for (i = 0; i < MAX_TESTING_ADDRESSES; i++)
 	{
-		printf("getNumAddresses() doesn't recognise when wallet isn't loaded\n");
-		reportFailure();
+		if (handles_buffer[i] != (AddressHandle)(i + 1))
+		{
+			printf("Address handle %d should be %d, but got %d\n", i, i + 1, (int)handles_buffer[i]);
+			abort = true;
+			reportFailure();
+			break;
+		}
 	}
-	if (getAddressAndPublicKey(temp, &public_key, 0) == WALLET_NOT_LOADED)
+	if (!abort)
 	{
 		reportSuccess();
 	}
-	else
+
+	// While there's a bunch of addresses in the wallet, check that
+	// getAddressAndPublicKey() obtains the same address and public key as
+	// makeNewAddress().
+	abort_error = false;
+	abort = false;
+	for (i = 0; i < MAX_TESTING_ADDRESSES; i++)
 	{
-		printf("getAddressAndPublicKey() doesn't recognise when wallet isn't loaded\n");
-		reportFailure();
+		ah = handles_buffer[i];
+		if (getAddressAndPublicKey(address1, &public_key, ah) != WALLET_NO_ERROR)
+		{
+			printf("Couldn't obtain address in wallet\n");
+			abort_error = true;
+			reportFailure();
+			break;
+		}
+		if ((memcmp(address1, &(address_buffer[i * 20]), 20))
+			|| (bigCompare(public_key.x, public_key_buffer[i].x) != BIGCMP_EQUAL)
+			|| (bigCompare(public_key.y, public_key_buffer[i].y) != BIGCMP_EQUAL))
+		{
+			printf("getAddressAndPublicKey() returned mismatching address or public key, ah = %d\n", i);
+			abort = true;
+			reportFailure();
+			break;
+		}
 	}
-	if (getPrivateKey(temp, 0) == WALLET_NOT_LOADED)
+	if (!abort)
 	{
 		reportSuccess();
 	}
-	else
+	if (!abort_error)
 	{
-		printf("getPrivateKey() doesn't recognise when wallet isn't loaded\n");
-		reportFailure();
+		reportSuccess();
 	}
-	if (changeEncryptionKey(temp, 0) == WALLET_NOT_LOADED)
+
+	// Check that getAddressesAndPublicKeys() obtains the same addresses and
+	// public keys as makeNewAddress(), for every range of address handles.
+	abort = false;
+	for (i = 0; i < MAX_TESTING_ADDRESSES; i++)
+	{
+		for (j = 1; (j <= ECDSA_MAX_BATCH) && ((i + j) <= MAX_TESTING_ADDRESSES); j++)
+		{
+			if (getAddressesAndPublicKeys(compare_addresses, compare_public_keys, handles_buffer[i], (uint8_t)j) != WALLET_NO_ERROR)
+			{
+				printf("Couldn't obtain range of addresses in wallet, start = %d, count = %d\n", i, j);
+				abort = true;
+				break;
+			}
+			if ((memcmp(compare_addresses, &(address_buffer[i * 20]), (size_t)(j * 20)))
+				|| (bigCompare(compare_public_keys[j - 1].x, public_key_buffer[i + j - 1].x) != BIGCMP_EQUAL)
+				|| (bigCompare(compare_public_keys[j - 1].y, public_key_buffer[i + j - 1].y) != BIGCMP_EQUAL))
+			{
+				printf("getAddressesAndPublicKeys() returned mismatching address or public key, start = %d, count = %d\n", i, j);
+				abort = true;
+				break;
+			}
+		}
+		if (abort)
+		{
+			break;
+		}
+	}
+	if (!abort)
 	{
 		reportSuccess();
 	}
 	else
 	{
-		printf("changeEncryptionKey() doesn't recognise when wallet isn't loaded\n");
 		reportFailure();
 	}
-	if (changeWalletName(temp) == WALLET_NOT_LOADED)
+
+	// Check that getAddressesAndPublicKeys() rejects ranges which go past the
+	// last address and ranges of invalid size.
+	if (getAddressesAndPublicKeys(compare_addresses, compare_public_keys, MAX_TESTING_ADDRESSES, 2) == WALLET_INVALID_HANDLE)
 	{
 		reportSuccess();
 	}
 	else
 	{
-		printf("changeWalletName() doesn't recognise when wallet isn't loaded\n");
+		printf("getAddressesAndPublicKeys() doesn't recognise range past the last address\n");
 		reportFailure();
 	}
-	if (backupWallet(false, 0) == WALLET_NOT_LOADED)
+	if (getAddressesAndPublicKeys(compare_addresses, compare_public_keys, 0, 1) == WALLET_INVALID_HANDLE)
 	{
 		reportSuccess();
 	}
 	else
 	{
-		printf("backupWallet() doesn't recognise when wallet isn't loaded\n");
+		printf("getAddressesAndPublicKeys() doesn't recognise 0 as invalid address handle\n");
 		reportFailure();
 	}
-	if (getMasterPublicKey(&public_key, temp) == WALLET_NOT_LOADED)
+	if (getAddressesAndPublicKeys(compare_addresses, compare_public_keys, 1, 0) == WALLET_INVALID_OPERATION)
 	{
 		reportSuccess();
 	}
 	else
 	{
-		printf("getMasterPublicKey() doesn't recognise when wallet isn't loaded\n");
+		printf("getAddressesAndPublicKeys() doesn't recognise 0 as invalid count\n");
 		reportFailure();
 	}
-}
-
-/** Call all wallet functions which accept a wallet number and check
-  * that they fail or succeed for a given wallet number.
-  * \param wallet_spec The wallet number to check.
-  * \param should_succeed true if the wallet number is valid (and thus the
-  *                       wallet functions should succeed), false if the wallet
-  *                       number is not valid (and thus the wallet functions
-  *                       should fail).
-  */
-static void checkWalletSpecFunctions(uint32_t wallet_spec, bool should_succeed)
-{
-	uint8_t wallet_uuid[UUID_LENGTH];
-	uint8_t name[NAME_LENGTH];
-	uint32_t version;
-	WalletErrors wallet_return;
 
-	memset(name, ' ', NAME_LENGTH);
-	uninitWallet();
-	wallet_return = newWallet(wallet_spec, name, false, NULL, false, NULL, 0);
-	if (should_succeed && (wallet_return != WALLET_NO_ERROR))
-	{
-		printf("newWallet() failed with wallet number %u when it should have succeeded\n", wallet_spec);
-		reportFailure();
-	}
-	else
+	// Test getAddressAndPublicKey() and getPrivateKey() functions using
+	// invalid and then valid address handles.
+	if (getAddressAndPublicKey(temp, &public_key, 0) == WALLET_INVALID_HANDLE)
 	{
 		reportSuccess();
 	}
-	if (!should_succeed && (wallet_return != WALLET_INVALID_WALLET_NUM))
+	else
 	{
-		printf("newWallet() did not return WALLET_INVALID_WALLET_NUM with wallet number %u when it should have\n", wallet_spec);
+		printf("getAddressAndPublicKey() doesn't recognise 0 as invalid address handle\n");
 		reportFailure();
 	}
-	else
+	if (getPrivateKey(temp, 0) == WALLET_INVALID_HANDLE)
 	{
 		reportSuccess();
 	}
-
-	uninitWallet();
-	// This call to initWallet() must be placed after the call to newWallet()
-	// so that if should_succeed is true, there's a valid wallet in the
-	// specified place.
-	wallet_return = initWallet(wallet_spec, NULL, 0);
-	if (should_succeed && (wallet_return != WALLET_NO_ERROR))
+	else
 	{
-		printf("initWallet() failed with wallet number %u when it should have succeeded\n", wallet_spec);
+		printf("getPrivateKey() doesn't recognise 0 as invalid address handle\n");
 		reportFailure();
 	}
-	else
+	if (getAddressAndPublicKey(temp, &public_key, BAD_ADDRESS_HANDLE) == WALLET_INVALID_HANDLE)
 	{
 		reportSuccess();
 	}
-	if (!should_succeed && (wallet_return != WALLET_INVALID_WALLET_NUM))
+	else
 	{
-		printf("initWallet() did not return WALLET_INVALID_WALLET_NUM with wallet number %u when it should have\n", wallet_spec);
+		printf("getAddressAndPublicKey() doesn't recognise BAD_ADDRESS_HANDLE as invalid address handle\n");
 		reportFailure();
 	}
-	else
+	if (getPrivateKey(temp, BAD_ADDRESS_HANDLE) == WALLET_INVALID_HANDLE)
 	{
 		reportSuccess();
 	}
-
-	uninitWallet();
-	wallet_return = getWalletInfo(&version, name, wallet_uuid, wallet_spec);
-	if (should_succeed && (wallet_return != WALLET_NO_ERROR))
+	else
 	{
-		printf("getWalletInfo() failed with wallet number %u when it should have succeeded\n", wallet_spec);
+		printf("getPrivateKey() doesn't recognise BAD_ADDRESS_HANDLE as invalid address handle\n");
 		reportFailure();
 	}
-	else
+	if (getAddressAndPublicKey(temp, &public_key, handles_buffer[0]) == WALLET_NO_ERROR)
 	{
 		reportSuccess();
 	}
-	if (!should_succeed && (wallet_return != WALLET_INVALID_WALLET_NUM))
+	else
 	{
-		printf("getWalletInfo() did not return WALLET_INVALID_WALLET_NUM with wallet number %u when it should have\n", wallet_spec);
+		printf("getAddressAndPublicKey() doesn't recognise valid address handle\n");
 		reportFailure();
 	}
-	else
+	if (getPrivateKey(temp, handles_buffer[0]) == WALLET_NO_ERROR)
 	{
 		reportSuccess();
 	}
-}
-
-const uint8_t test_password0[] = "1234";
-const uint8_t test_password1[] = "ABCDEFGHJ!!!!";
-const uint8_t new_test_password[] = "new password";
-
-int main(void)
-{
-	uint8_t temp[128];
-	uint8_t address1[20];
-	uint8_t address2[20];
-	uint8_t compare_address[20];
-	uint8_t name[NAME_LENGTH];
-	uint8_t name2[NAME_LENGTH];
-	uint8_t compare_name[NAME_LENGTH];
-	uint8_t wallet_uuid[UUID_LENGTH];
-	uint8_t wallet_uuid2[UUID_LENGTH];
-	uint32_t version;
-	uint8_t seed1[SEED_LENGTH];
-	uint8_t seed2[SEED_LENGTH];
-	uint8_t encrypted_seed[SEED_LENGTH];
-	uint8_t chain_code[32];
-	struct WalletRecordUnencryptedStruct unencrypted_part;
-	struct WalletRecordUnencryptedStruct compare_unencrypted_part;
-	uint8_t *address_buffer;
-	uint8_t one_byte;
-	uint32_t start_address;
-	uint32_t end_address;
-	uint32_t version_field_address;
-	uint32_t returned_num_wallets;
-	uint32_t stupidly_calculated_num_wallets;
-	AddressHandle *handles_buffer;
-	AddressHandle ah;
-	PointAffine master_public_key;
-	PointAffine public_key;
-	PointAffine compare_public_key;
-	PointAffine *public_key_buffer;
-	bool abort;
-	bool is_zero;
-	bool abort_duplicate;
-	bool abort_error;
-	int i;
-	int j;
-	int version_field_counter;
-	bool found;
-	uint32_t histogram[256];
-	uint32_t histogram_count;
-	uint8_t copy_of_nv[TEST_GLOBAL_PARTITION_SIZE + TEST_ACCOUNTS_PARTITION_SIZE];
-	uint8_t copy_of_nv2[TEST_GLOBAL_PARTITION_SIZE + TEST_ACCOUNTS_PARTITION_SIZE];
-	uint8_t pool_state[ENTROPY_POOL_LENGTH];
-
-	initTests(__FILE__);
-
-	initWalletTest();
-	initialiseDefaultEntropyPool();
-	suppress_set_entropy_pool = false;
-	// Blank out non-volatile storage area (set to all nulls).
-	temp[0] = 0;
-	for (i = 0; i < (TEST_GLOBAL_PARTITION_SIZE + TEST_ACCOUNTS_PARTITION_SIZE); i++)
+	else
 	{
-		fwrite(temp, 1, 1, wallet_test_file);
+		printf("getPrivateKey() doesn't recognise valid address handle\n");
+		reportFailure();
 	}
 
-	// Check that sanitiseEverything() is able to function with NV
-	// storage in this state.
-	minimum_address_written[PARTITION_GLOBAL] = 0xffffffff;
-	maximum_address_written[PARTITION_GLOBAL] = 0;
-	minimum_address_written[PARTITION_ACCOUNTS] = 0xffffffff;
-	maximum_address_written[PARTITION_ACCOUNTS] = 0;
-	if (sanitiseEverything() == WALLET_NO_ERROR)
+	free(address_buffer);
+	free(public_key_buffer);
+	free(handles_buffer);
+
+	// Check that changeEncryptionKey() works.
+	if (changeEncryptionKey(new_test_password, sizeof(new_test_password)) == WALLET_NO_ERROR)
 	{
 		reportSuccess();
 	}
 	else
 	{
-		printf("Cannot nuke NV storage using sanitiseEverything()\n");
+		printf("Couldn't change encryption key\n");
 		reportFailure();
 	}
 
-	// Check that sanitiseNonVolatileStorage() overwrote (almost) everything
-	// with random data.
-	memset(histogram, 0, sizeof(histogram));
-	histogram_count = 0;
-	fseek(wallet_test_file, 0, SEEK_SET);
-	for (i = 0; i < (TEST_GLOBAL_PARTITION_SIZE + TEST_ACCOUNTS_PARTITION_SIZE); i++)
+	// Check that the version field is "encrypted wallet".
+	if (getWalletInfo(&version, temp, wallet_uuid, 0) == WALLET_NO_ERROR)
 	{
-		fread(temp, 1, 1, wallet_test_file);
-		histogram[temp[0]]++;
-		histogram_count++;
+		reportSuccess();
 	}
-	// "Random data" here is defined as: no value appears more than 1/16 of the time.
-	abort = false;
-	for (i = 0; i < 256; i++)
+	else
 	{
-		if (histogram[i] > (histogram_count / 16))
-		{
-			printf("sanitiseNonVolatileStorage() causes %02x to appear improbably often\n", i);
-			reportFailure();
-			abort = true;
-		}
+		printf("getWalletInfo() failed after changeEncryptionKey() was called\n");
+		reportFailure();
 	}
-	if (!abort)
+	if (version == VERSION_IS_ENCRYPTED)
 	{
 		reportSuccess();
 	}
-
-	// Check that sanitiseEverything() overwrote everything.
-	if ((minimum_address_written[PARTITION_GLOBAL] != 0)
-		|| (maximum_address_written[PARTITION_GLOBAL] != (TEST_GLOBAL_PARTITION_SIZE - 1))
-		|| (minimum_address_written[PARTITION_ACCOUNTS] != 0)
-		|| (maximum_address_written[PARTITION_ACCOUNTS] != (TEST_ACCOUNTS_PARTITION_SIZE - 1)))
+	else
 	{
-		printf("sanitiseEverything() did not overwrite everything\n");
+		printf("changeEncryptionKey() does not set version to encrypted wallet\n");
 		reportFailure();
 	}
-	else
+
+	// Check name matches what was given in newWallet().
+	if (!memcmp(temp, name, NAME_LENGTH))
 	{
 		reportSuccess();
 	}
+	else
+	{
+		printf("getWalletInfo() doesn't return correct name when wallet is loaded\n");
+		reportFailure();
+	}
 
-	// Check that the version field is "wallet not there".
+	// Check that getWalletInfo() still works after unloading wallet.
+	uninitWallet();
 	if (getWalletInfo(&version, temp, wallet_uuid, 0) == WALLET_NO_ERROR)
 	{
 		reportSuccess();
 	}
 	else
 	{
-		printf("getWalletInfo() failed after sanitiseNonVolatileStorage() was called\n");
+		printf("getWalletInfo() failed after uninitWallet() was called\n");
 		reportFailure();
 	}
-	if (version == VERSION_NOTHING_THERE)
+	if (version == VERSION_IS_ENCRYPTED)
 	{
 		reportSuccess();
 	}
 	else
 	{
-		printf("sanitiseNonVolatileStorage() does not set version to nothing there\n");
+		printf("uninitWallet() caused wallet version to change\n");
 		reportFailure();
 	}
 
-	// initWallet() hasn't been called yet, so nearly every function should
-	// return WALLET_NOT_THERE somehow.
-	checkFunctionsReturnWalletNotLoaded();
-
-	// The non-volatile storage area was blanked out, so there shouldn't be a
-	// (valid) wallet there.
-	if (initWallet(0, NULL, 0) == WALLET_NOT_THERE)
+	// Check name matches what was given in newWallet().
+	if (!memcmp(temp, name, NAME_LENGTH))
 	{
 		reportSuccess();
 	}
 	else
 	{
-		printf("initWallet() doesn't recognise when wallet isn't there\n");
+		printf("getWalletInfo() doesn't return correct name when wallet is not loaded\n");
 		reportFailure();
 	}
 
-	// Try creating a wallet and testing initWallet() on it.
-	memcpy(name, "123456789012345678901234567890abcdefghij", NAME_LENGTH);
-	if (newWallet(0, name, false, NULL, false, NULL, 0) == WALLET_NO_ERROR)
+	// Change wallet's name and check that getWalletInfo() reflects the
+	// name change.
+	initWallet(0, new_test_password, sizeof(new_test_password));
+	memcpy(name, "HHHHH HHHHHHHHHHHHHHHHH HHHHHHHHHHHHHH  ", NAME_LENGTH);
+	if (changeWalletName(name) == WALLET_NO_ERROR)
 	{
 		reportSuccess();
 	}
 	else
 	{
-		printf("Could not create new wallet\n");
+		printf("changeWalletName() couldn't change name\n");
 		reportFailure();
 	}
-	if (initWallet(0, NULL, 0) == WALLET_NO_ERROR)
+	getWalletInfo(&version, temp, wallet_uuid, 0);
+	if (!memcmp(temp, name, NAME_LENGTH))
 	{
 		reportSuccess();
 	}
 	else
 	{
-		printf("initWallet() does not recognise new wallet\n");
+		printf("getWalletInfo() doesn't reflect name change\n");
 		reportFailure();
 	}
-	if ((getNumAddresses() == 0) && (walletGetLastError() == WALLET_EMPTY))
+
+	// Check that name change is preserved when unloading and loading a
+	// wallet.
+	uninitWallet();
+	getWalletInfo(&version, temp, wallet_uuid, 0);
+	if (!memcmp(temp, name, NAME_LENGTH))
 	{
 		reportSuccess();
 	}
 	else
 	{
-		printf("New wallet isn't empty\n");
+		printf("getWalletInfo() doesn't reflect name change after unloading wallet\n");
 		reportFailure();
 	}
 
-	// Check that the version field is "unencrypted wallet".
-	if (getWalletInfo(&version, temp, wallet_uuid, 0) == WALLET_NO_ERROR)
+	// Check that initWallet() succeeds (changing the name changes the
+	// checksum, so this tests whether the checksum was updated).
+	if (initWallet(0, new_test_password, sizeof(new_test_password)) == WALLET_NO_ERROR)
 	{
 		reportSuccess();
 	}
 	else
 	{
-		printf("getWalletInfo() failed after newWallet() was called\n");
+		printf("initWallet() failed after name change\n");
 		reportFailure();
 	}
-	if (version == VERSION_UNENCRYPTED)
+	getWalletInfo(&version, temp, wallet_uuid, 0);
+	if (!memcmp(temp, name, NAME_LENGTH))
 	{
 		reportSuccess();
 	}
 	else
 	{
-		printf("newWallet() does not set version to unencrypted wallet\n");
+		printf("getWalletInfo() doesn't reflect name change after reloading wallet\n");
 		reportFailure();
 	}
 
-	// Check that sanitise_nv_wallet() deletes wallet.
-	if (sanitiseEverything() == WALLET_NO_ERROR)
+	// getWalletInfo() should be answering from its directory. Change the
+	// stored name behind its back; the old name should still be returned
+	// until a wallet record is written.
+	one_byte = 'Z';
+	nonVolatileWrite(&one_byte, PARTITION_ACCOUNTS, offsetof(WalletRecord, unencrypted) + offsetof(struct WalletRecordUnencryptedStruct, name), 1);
+	getWalletInfo(&version, temp, wallet_uuid, 0);
+	if (!memcmp(temp, name, NAME_LENGTH))
 	{
 		reportSuccess();
 	}
 	else
 	{
-		printf("Cannot nuke NV storage using sanitiseNonVolatileStorage()\n");
+		printf("getWalletInfo() isn't using its directory\n");
 		reportFailure();
 	}
-	if (initWallet(0, NULL, 0) == WALLET_NOT_THERE)
+	invalidateWalletDirectory();
+	getWalletInfo(&version, temp, wallet_uuid, 0);
+	if (temp[0] == 'Z')
 	{
 		reportSuccess();
 	}
 	else
 	{
-		printf("sanitiseEverything() isn't deleting wallet\n");
+		printf("getWalletInfo() doesn't re-read invalidated directory entry\n");
 		reportFailure();
 	}
-
-	// Check that newWallet() works.
-	if (newWallet(0, name, false, NULL, false, NULL, 0) == WALLET_NO_ERROR)
+	generation = getWalletListGeneration();
+	getWalletInfo(&version, temp, wallet_uuid, 0);
+	if (getWalletListGeneration() == generation)
 	{
 		reportSuccess();
 	}
 	else
 	{
-		printf("newWallet() fails for recently sanitised NV storage\n");
+		printf("getWalletInfo() changes wallet list generation\n");
 		reportFailure();
 	}
-	if (makeNewAddress(temp, &public_key) != BAD_ADDRESS_HANDLE)
+	changeWalletName(name);
+	getWalletInfo(&version, temp, wallet_uuid, 0);
+	if (!memcmp(temp, name, NAME_LENGTH))
 	{
 		reportSuccess();
 	}
 	else
 	{
-		printf("Couldn't create new address in new wallet\n");
+		printf("changeWalletName() doesn't invalidate directory\n");
 		reportFailure();
 	}
-
-	// newWallet() shouldn't overwrite an existing wallet.
-	if (newWallet(0, name, false, NULL, false, NULL, 0) == WALLET_ALREADY_EXISTS)
+	if (getWalletListGeneration() != generation)
 	{
 		reportSuccess();
 	}
 	else
 	{
-		printf("newWallet() overwrites existing wallet\n");
+		printf("changeWalletName() doesn't change wallet list generation\n");
 		reportFailure();
 	}
 
-	// Check that a deleteWallet()/newWallet() sequence does overwrite an
-	// existing wallet.
-	if (deleteWallet(0) == WALLET_NO_ERROR)
+	// Check that loading the wallet with the old key fails.
+	uninitWallet();
+	if (initWallet(0, NULL, 0) == WALLET_NOT_THERE)
 	{
 		reportSuccess();
 	}
 	else
 	{
-		printf("deleteWallet() failed\n");
+		printf("Loading wallet with old encryption key succeeds\n");
 		reportFailure();
 	}
-	if (newWallet(0, name, false, NULL, false, NULL, 0) == WALLET_NO_ERROR)
+
+	// Check that loading the wallet with the new key succeeds.
+	uninitWallet();
+	if (initWallet(0, new_test_password, sizeof(new_test_password)) == WALLET_NO_ERROR)
 	{
 		reportSuccess();
 	}
 	else
 	{
-		printf("newWallet() fails for recently deleted wallet\n");
+		printf("Loading wallet with new encryption key fails\n");
 		reportFailure();
 	}
 
-	// Check that deleteWallet() deletes wallet.
+	// Test the getAddressAndPublicKey() and getPrivateKey() functions on an
+	// empty wallet.
 	deleteWallet(0);
 	newWallet(0, name, false, NULL, false, NULL, 0);
-	if (initWallet(0, NULL, 0) == WALLET_NO_ERROR)
+	if (getAddressAndPublicKey(temp, &public_key, 0) == WALLET_EMPTY)
 	{
 		reportSuccess();
 	}
 	else
 	{
-		printf("initWallet() failed just after calling newWallet()\n");
+		printf("getAddressAndPublicKey() doesn't deal with empty wallets correctly\n");
 		reportFailure();
 	}
-	deleteWallet(0);
-	if (initWallet(0, NULL, 0) == WALLET_NOT_THERE)
+	if (getPrivateKey(temp, 0) == WALLET_EMPTY)
 	{
 		reportSuccess();
 	}
 	else
 	{
-		printf("deleteWallet() isn't deleting wallet\n");
+		printf("getPrivateKey() doesn't deal with empty wallets correctly\n");
 		reportFailure();
 	}
 
-	// Check that deleteWallet() doesn't affect other wallets.
-	deleteWallet(0);
-	deleteWallet(1);
-	newWallet(0, name, false, NULL, false, NULL, 0);
-	newWallet(1, name, false, NULL, false, NULL, 0);
-	deleteWallet(1);
-	if (initWallet(0, NULL, 0) == WALLET_NO_ERROR)
-	{
-		reportSuccess();
-	}
-	else
-	{
-		printf("deleteWallet() collateral damage to wallet 0\n");
-		reportFailure();
-	}
+	// Test wallet backup to valid device.
 	deleteWallet(0);
-	deleteWallet(1);
 	newWallet(0, name, false, NULL, false, NULL, 0);
-	newWallet(1, name, false, NULL, false, NULL, 0);
-	deleteWallet(0);
-	if (initWallet(1, NULL, 0) == WALLET_NO_ERROR)
+	if (backupWallet(false, 0) == WALLET_NO_ERROR)
 	{
 		reportSuccess();
 	}
 	else
 	{
-		printf("deleteWallet() collateral damage to wallet 1\n");
+		printf("Unencrypted backupWallet() doesn't work\n");
 		reportFailure();
 	}
+	memcpy(seed1, test_wallet_backup, SEED_LENGTH);
+	makeNewAddress(address1, &public_key); // save this for later
 
-	// Make some new addresses, then delete it and create a new wallet,
-	// making sure the new wallet is empty (i.e. check that deleteWallet()
-	// actually deletes a wallet).
-	deleteWallet(0);
-	newWallet(0, name, false, NULL, false, NULL, 0);
-	if (makeNewAddress(temp, &public_key) != BAD_ADDRESS_HANDLE)
+	// Test wallet backup to invalid device.
+	if (backupWallet(false, 1) == WALLET_BACKUP_ERROR)
 	{
 		reportSuccess();
 	}
 	else
 	{
-		printf("Couldn't create new address in new wallet 2\n");
+		printf("backupWallet() doesn't deal with invalid device correctly\n");
 		reportFailure();
 	}
+
+	// Delete wallet and check that seed of a new wallet is different.
 	deleteWallet(0);
 	newWallet(0, name, false, NULL, false, NULL, 0);
-	if ((getNumAddresses() == 0) && (walletGetLastError() == WALLET_EMPTY))
+	backupWallet(false, 0);
+	memcpy(seed2, test_wallet_backup, SEED_LENGTH);
+	if (memcmp(seed1, seed2, SEED_LENGTH))
 	{
 		reportSuccess();
 	}
 	else
 	{
-		printf("deleteWallet() doesn't delete existing wallet\n");
+		printf("Seed of new wallet matches older one.\n");
 		reportFailure();
 	}
 
-	// Unload wallet and make sure everything realises that the wallet is
-	// not loaded.
-	if (uninitWallet() == WALLET_NO_ERROR)
+	// Try to restore a wallet backup.
+	deleteWallet(0);
+	if (newWallet(0, name, true, seed1, false, test_password0, sizeof(test_password0)) == WALLET_NO_ERROR)
 	{
 		reportSuccess();
 	}
 	else
 	{
-		printf("uninitWallet() failed to do its basic job\n");
+		printf("Could not restore wallet\n");
 		reportFailure();
 	}
-	checkFunctionsReturnWalletNotLoaded();
 
-	// Load wallet again. Since there is actually a wallet there, this
-	// should succeed.
-	if (initWallet(0, NULL, 0) == WALLET_NO_ERROR)
+	// Does the first address of the restored wallet match the old wallet?
+	makeNewAddress(address2, &public_key);
+	if (!memcmp(address1, address2, 20))
 	{
 		reportSuccess();
 	}
 	else
 	{
-		printf("uninitWallet() appears to be permanent\n");
+		printf("Restored wallet doesn't generate the same address\n");
 		reportFailure();
 	}
 
-	// Change bytes in non-volatile memory and make sure initWallet() fails
-	// because of the checksum check.
-	if (uninitWallet() != WALLET_NO_ERROR)
-	{
-		printf("uninitWallet() failed to do its basic job 2\n");
-		reportFailure();
-	}
-	abort = false;
-	for (i = 0; i < sizeof(WalletRecord); i++)
+	// Test wallet backup with encryption.
+	if (backupWallet(true, 0) == WALLET_NO_ERROR)
 	{
-		if (nonVolatileRead(&one_byte, PARTITION_ACCOUNTS, (uint32_t)i, 1) != NV_NO_ERROR)
-		{
-			printf("NV read fail\n");
-			abort = true;
-			break;
-		}
-		one_byte++;
-		if (nonVolatileWrite(&one_byte, PARTITION_ACCOUNTS, (uint32_t)i, 1) != NV_NO_ERROR)
-		{
-			printf("NV write fail\n");
-			abort = true;
-			break;
-		}
-		if (initWallet(0, NULL, 0) == WALLET_NO_ERROR)
-		{
-			printf("Wallet still loads when wallet checksum is wrong, offset = %d\n", i);
-			abort = true;
-			break;
-		}
-		one_byte--;
-		if (nonVolatileWrite(&one_byte, PARTITION_ACCOUNTS, (uint32_t)i, 1) != NV_NO_ERROR)
-		{
-			printf("NV write fail\n");
-			abort = true;
-			break;
-		}
+		reportSuccess();
 	}
-	if (!abort)
+	else
+	{
+		printf("Encrypted backupWallet() doesn't work\n");
+		reportFailure();
+	}
+	memcpy(encrypted_seed, test_wallet_backup, SEED_LENGTH);
+
+	// Decrypt the encrypted seed and check it matches the unencrypted one.
+	memset(temp, 0, 16);
+	for (i = 0; i < SEED_LENGTH; i += 16)
+	{
+		writeU32LittleEndian(temp, (uint32_t)i);
+		xexDecrypt(&(seed2[i]), &(encrypted_seed[i]), temp, 1);
+	}
+	if (!memcmp(seed1, seed2, SEED_LENGTH))
 	{
 		reportSuccess();
 	}
 	else
 	{
+		printf("Decrypted seed does not match encrypted one.\n");
 		reportFailure();
 	}
 
-	// deleteWallet() should succeed even if aimed at a wallet that
-	// "isn't there"; this is how hidden wallets can be deleted.
-	deleteWallet(0);
-	if (deleteWallet(0) == WALLET_NO_ERROR)
+	// Exporting a backup should give the same encrypted seed as an encrypted
+	// backupWallet().
+	if (exportWalletBackup(wallet_uuid, seed2, temp) == WALLET_NO_ERROR)
 	{
 		reportSuccess();
 	}
 	else
 	{
-		printf("deleteWallet() can't delete wallet that isn't there\n");
+		printf("exportWalletBackup() doesn't work\n");
+		reportFailure();
+	}
+	if (!memcmp(seed2, encrypted_seed, SEED_LENGTH))
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("exportWalletBackup() seed doesn't match encrypted backupWallet()\n");
 		reportFailure();
 	}
 
-	// Create 2 new wallets and check that their addresses aren't the same
+	// A wallet without a password mustn't be exported, since its backup
+	// would be encrypted using an all-zero key.
 	deleteWallet(0);
-	newWallet(0, name, false, NULL, false, NULL, 0);
-	if (makeNewAddress(address1, &public_key) != BAD_ADDRESS_HANDLE)
+	if (newWallet(0, name, true, seed1, false, NULL, 0) != WALLET_NO_ERROR)
+	{
+		printf("Could not create unencrypted wallet\n");
+		reportFailure();
+	}
+	if (exportWalletBackup(wallet_uuid2, seed2, &(temp[32])) == WALLET_INVALID_OPERATION)
 	{
 		reportSuccess();
 	}
 	else
 	{
-		printf("Couldn't create new address in new wallet\n");
+		printf("exportWalletBackup() exported an unencrypted wallet\n");
 		reportFailure();
 	}
+
+	// A backup with a bad digest should be rejected, without creating a
+	// wallet.
 	deleteWallet(0);
-	newWallet(0, name, false, NULL, false, NULL, 0);
-	memset(address2, 0, 20);
-	memset(&public_key, 0, sizeof(PointAffine));
-	if (makeNewAddress(address2, &public_key) != BAD_ADDRESS_HANDLE)
+	temp[0] ^= 1;
+	if (restoreWalletBackup(0, name, wallet_uuid, encrypted_seed, temp, test_password0, sizeof(test_password0)) == WALLET_BACKUP_ERROR)
 	{
 		reportSuccess();
 	}
 	else
 	{
-		printf("Couldn't create new address in new wallet\n");
+		printf("restoreWalletBackup() doesn't check digest\n");
 		reportFailure();
 	}
-	if (memcmp(address1, address2, 20))
+	if (initWallet(0, test_password0, sizeof(test_password0)) == WALLET_NOT_THERE)
 	{
 		reportSuccess();
 	}
 	else
 	{
-		printf("New wallets are creating identical addresses\n");
+		printf("restoreWalletBackup() with bad digest created a wallet\n");
 		reportFailure();
 	}
+	temp[0] ^= 1;
 
-	// Check that makeNewAddress() wrote to its outputs.
-	is_zero = true;
-	for (i = 0; i < 20; i++)
+	// So should a backup restored using the wrong password.
+	if (restoreWalletBackup(0, name, wallet_uuid, encrypted_seed, temp, test_password1, sizeof(test_password1)) == WALLET_BACKUP_ERROR)
 	{
-		if (address2[i] != 0)
-		{
-			is_zero = false;
-			break;
-		}
+		reportSuccess();
 	}
-	if (is_zero)
+	else
 	{
-		printf("makeNewAddress() doesn't write the address\n");
+		printf("restoreWalletBackup() doesn't check password\n");
 		reportFailure();
 	}
-	else
+	if (initWallet(0, test_password1, sizeof(test_password1)) == WALLET_NOT_THERE)
 	{
 		reportSuccess();
 	}
-	if (bigIsZero(public_key.x))
+	else
 	{
-		printf("makeNewAddress() doesn't write the public key\n");
+		printf("restoreWalletBackup() with wrong password created a wallet\n");
 		reportFailure();
 	}
-	else
+
+	// Restoring the backup should give back the same wallet, with the same
+	// UUID.
+	if (restoreWalletBackup(0, name, wallet_uuid, encrypted_seed, temp, test_password0, sizeof(test_password0)) == WALLET_NO_ERROR)
 	{
 		reportSuccess();
 	}
-
-	// Make some new addresses, up to a limit.
-	// Also check that addresses are unique.
-	deleteWallet(0);
-	newWallet(0, name, false, NULL, false, NULL, 0);
-	abort = false;
-	abort_error = false;
-	address_buffer = (uint8_t *)malloc(MAX_TESTING_ADDRESSES * 20);
-	for (i = 0; i < MAX_TESTING_ADDRESSES; i++)
+	else
 	{
-		if (makeNewAddress(&(address_buffer[i * 20]), &public_key) == BAD_ADDRESS_HANDLE)
-		{
-			printf("Couldn't create new address in new wallet\n");
-			reportFailure();
-			abort_error = true;
-			break;
-		}
-		for (j = 0; j < i; j++)
-		{
-			if (!memcmp(&(address_buffer[i * 20]), &(address_buffer[j * 20]), 20))
-			{
-				printf("Wallet addresses aren't unique\n");
-				reportFailure();
-				abort = true;
-				break;
-			}
-		}
-		if (abort || abort_error)
-		{
-			break;
-		}
+		printf("Could not restore exported backup\n");
+		reportFailure();
 	}
-	free(address_buffer);
-	if (!abort)
+	makeNewAddress(address2, &public_key);
+	if (!memcmp(address1, address2, 20))
 	{
 		reportSuccess();
 	}
-	if (!abort_error)
+	else
+	{
+		printf("Restored exported backup doesn't generate the same address\n");
+		reportFailure();
+	}
+	exportWalletBackup(wallet_uuid2, seed2, &(temp[32]));
+	if (!memcmp(wallet_uuid, wallet_uuid2, UUID_LENGTH) && !memcmp(seed2, encrypted_seed, SEED_LENGTH)
+		&& !memcmp(temp, &(temp[32]), 32))
 	{
 		reportSuccess();
 	}
+	else
+	{
+		printf("Restored exported backup has different UUID or seed\n");
+		reportFailure();
+	}
 
-	// The wallet should be full now.
-	// Check that making a new address now causes an appropriate error.
-	if (makeNewAddress(temp, &public_key) == BAD_ADDRESS_HANDLE)
+	// Test that sanitiseNonVolatileStorage() doesn't accept addresses which
+	// aren't a multiple of 4.
+	if (sanitiseNonVolatileStorage(PARTITION_GLOBAL, 1, 16) == WALLET_BAD_ADDRESS)
 	{
-		if (walletGetLastError() == WALLET_FULL)
-		{
-			reportSuccess();
-		}
-		else
-		{
-			printf("Creating a new address on a full wallet gives incorrect error\n");
-			reportFailure();
-		}
+		reportSuccess();
 	}
 	else
 	{
-		printf("Creating a new address on a full wallet succeeds (it's not supposed to)\n");
+		printf("sanitiseNonVolatileStorage() accepts start address which is not a multiple of 4\n");
 		reportFailure();
 	}
-
-	// Check that getNumAddresses() fails when the wallet is empty.
-	deleteWallet(0);
-	newWallet(0, name, false, NULL, false, NULL, 0);
-	if (getNumAddresses() == 0)
+	if (sanitiseNonVolatileStorage(PARTITION_GLOBAL, 0, 15) == WALLET_BAD_ADDRESS)
 	{
-		if (walletGetLastError() == WALLET_EMPTY)
-		{
-			reportSuccess();
-		}
-		else
-		{
-			printf("getNumAddresses() doesn't recognise wallet is empty\n");
-			reportFailure();
-		}
+		reportSuccess();
 	}
 	else
 	{
-		printf("getNumAddresses() succeeds when used on empty wallet\n");
+		printf("sanitiseNonVolatileStorage() accepts length which is not a multiple of 4\n");
 		reportFailure();
 	}
 
-	// Create a bunch of addresses in the (now empty) wallet and check that
-	// getNumAddresses() returns the right number.
-	address_buffer = (uint8_t *)malloc(MAX_TESTING_ADDRESSES * 20);
-	public_key_buffer = (PointAffine *)malloc(MAX_TESTING_ADDRESSES * sizeof(PointAffine));
-	handles_buffer = (AddressHandle *)malloc(MAX_TESTING_ADDRESSES * sizeof(AddressHandle));
-	abort = false;
-	for (i = 0; i < MAX_TESTING_ADDRESSES; i++)
+	// Test that sanitiseNonVolatileStorage() detects possible overflows.
+	if (sanitiseNonVolatileStorage(PARTITION_GLOBAL, 0x80000000, 0x80000000) == WALLET_BAD_ADDRESS)
 	{
-		ah = makeNewAddress(&(address_buffer[i * 20]), &(public_key_buffer[i]));
-		handles_buffer[i] = ah;
-		if (ah == BAD_ADDRESS_HANDLE)
-		{
-			printf("Couldn't create new address in new wallet\n");
-			abort = true;
-			reportFailure();
-			break;
-		}
+		reportSuccess();
 	}
-	if (!abort)
+	else
 	{
-		reportSuccess();
+		printf("sanitiseNonVolatileStorage() not detecting overflow 1\n");
+		reportFailure();
 	}
-	if (getNumAddresses() == MAX_TESTING_ADDRESSES)
+	if (sanitiseNonVolatileStorage(PARTITION_GLOBAL, 0xffffffff, 1) == WALLET_BAD_ADDRESS)
 	{
 		reportSuccess();
 	}
 	else
 	{
-		printf("getNumAddresses() returns wrong number of addresses\n");
+		printf("sanitiseNonVolatileStorage() not detecting overflow 2\n");
 		reportFailure();
 	}
-
-	// The wallet should contain unique addresses.
-	abort_duplicate = false;
-	for (i = 0; i < MAX_TESTING_ADDRESSES; i++)
+	if (sanitiseNonVolatileStorage(PARTITION_GLOBAL, 1, 0xffffffff) == WALLET_BAD_ADDRESS)
 	{
-		for (j = 0; j < i; j++)
-		{
-			if (!memcmp(&(address_buffer[i * 20]), &(address_buffer[j * 20]), 20))
-			{
-				printf("Wallet has duplicate addresses\n");
-				abort_duplicate = true;
-				reportFailure();
-				break;
-			}
-		}
-		if (abort_duplicate)
-		{
-			break;
-		}
+		reportSuccess();
 	}
-	if (!abort_duplicate)
+	else
 	{
-		reportSuccess();
+		printf("sanitiseNonVolatileStorage() not detecting overflow 3\n");
+		reportFailure();
 	}
 
-	// The wallet should contain unique public keys.
-	abort_duplicate = false;
-	for (i = 0; i < MAX_TESTING_ADDRESSES; i++)
+	// Test that sanitiseNonVolatileStorage() clears the correct area.
+	// Previously, sanitiseNonVolatileStorage() required the start and end
+	// parameters to be a multiple of 32 (because it uses a write buffer
+	// with that length). That restriction has since been relaxed. This test
+	// case checks that the code handles non-multiples of 32 properly.
+	suppress_write_debug_info = true; // stop console from going crazy
+	suppress_set_entropy_pool = true; // avoid spurious entropy pool update writes
+	abort = false;
+	for (i = 0; i < 2000; i++)
 	{
-		for (j = 0; j < i; j++)
+		initialiseDefaultEntropyPool(); // needed in case pool or checksum gets corrupted by writes
+		minimum_address_written[PARTITION_ACCOUNTS] = 0xffffffff;
+		maximum_address_written[PARTITION_ACCOUNTS] = 0;
+		start_address = (uint32_t)((rand() % TEST_ACCOUNTS_PARTITION_SIZE) & 0xfffffffc);
+		end_address = start_address + (uint32_t)((rand() % TEST_ACCOUNTS_PARTITION_SIZE) & 0xfffffffc);
+		if (end_address > TEST_ACCOUNTS_PARTITION_SIZE)
 		{
-			if (bigCompare(public_key_buffer[i].x, public_key_buffer[j].x) == BIGCMP_EQUAL)
+			end_address = TEST_ACCOUNTS_PARTITION_SIZE;
+		}
+		if (start_address != end_address)
+		{
+			sanitiseNonVolatileStorage(PARTITION_ACCOUNTS, start_address, end_address - start_address);
+			if ((minimum_address_written[PARTITION_ACCOUNTS] != start_address)
+				|| (maximum_address_written[PARTITION_ACCOUNTS] != (end_address - 1)))
 			{
-				printf("Wallet has duplicate public keys\n");
-				abort_duplicate = true;
+				printf("sanitiseNonVolatileStorage() not clearing correct area\n");
+				printf("start = 0x%08x, end = 0x%08x\n", start_address, end_address);
+				abort = true;
 				reportFailure();
 				break;
 			}
 		}
-		if (abort_duplicate)
-		{
-			break;
-		}
 	}
-	if (!abort_duplicate)
+	if (!abort)
 	{
 		reportSuccess();
 	}
 
-	// The address handles should start at 1 and be sequential.
-	abort = false;
-	for (i = 0; i < MAX_TESTING_ADDRESSES; i++)
-	{
-		if (handles_buffer[i] != (AddressHandle)(i + 1))
-		{
-			printf("Address handle %d should be %d, but got %d\n", i, i + 1, (int)handles_buffer[i]);
-			abort = true;
-			reportFailure();
-			break;
-		}
+	// Also check that sanitiseNonVolatileStorage() does nothing if length is 0.
+	initialiseDefaultEntropyPool(); // needed in case pool or checksum gets corrupted by writes
+	minimum_address_written[PARTITION_ACCOUNTS] = 0xffffffff;
+	maximum_address_written[PARTITION_ACCOUNTS] = 0;
+	// Use offsetof(WalletRecord, unencrypted.version) to try and
+	// trick the "clear version field" logic.
+	start_address = offsetof(WalletRecord, unencrypted.version);
+	sanitiseNonVolatileStorage(PARTITION_ACCOUNTS, start_address, 0);
+	if ((minimum_address_written[PARTITION_ACCOUNTS] != 0xffffffff) || (maximum_address_written[PARTITION_ACCOUNTS] != 0))
+	{
+		printf("sanitiseNonVolatileStorage() clearing something when it's not supposed to\n");
+		reportFailure();
 	}
-	if (!abort)
+	else
 	{
 		reportSuccess();
 	}
 
-	// While there's a bunch of addresses in the wallet, check that
-	// getAddressAndPublicKey() obtains the same address and public key as
-	// makeNewAddress().
-	abort_error = false;
+	// Check that sanitiseNonVolatileStorage() is clearing the correct version
+	// fields of any wallets in range.
+	suppress_write_debug_info = true; // stop console from going crazy
+	suppress_set_entropy_pool = false;
 	abort = false;
-	for (i = 0; i < MAX_TESTING_ADDRESSES; i++)
+	for (i = 0; i < 5000; i++)
 	{
-		ah = handles_buffer[i];
-		if (getAddressAndPublicKey(address1, &public_key, ah) != WALLET_NO_ERROR)
+		start_address = (uint32_t)((rand() % TEST_ACCOUNTS_PARTITION_SIZE) & 0xfffffffc);
+		end_address = start_address + (uint32_t)((rand() % TEST_ACCOUNTS_PARTITION_SIZE) & 0xfffffffc);
+		if (end_address > TEST_ACCOUNTS_PARTITION_SIZE)
+		{
+			end_address = TEST_ACCOUNTS_PARTITION_SIZE;
+		}
+		initialiseDefaultEntropyPool(); // needed in case pool or checksum gets corrupted by writes
+		clearVersionFieldWriteLog();
+		sanitiseNonVolatileStorage(PARTITION_ACCOUNTS, start_address, end_address - start_address);
+		// version_field_address is stepped through every possible address
+		// (ignoring start_address and end_address) that could hold a wallet's
+		// version field.
+		version_field_address = (uint8_t *)&(current_wallet.unencrypted.version) - (uint8_t *)&current_wallet;
+		version_field_counter = 0;
+		while ((version_field_address + 4) <= TEST_ACCOUNTS_PARTITION_SIZE)
+		{
+			if ((version_field_address >= start_address)
+				&& ((version_field_address + 4) <= end_address))
+			{
+				// version_field_address should be in the list somewhere.
+				found = false;
+				for (j = 0; j < version_field_index; j++)
+				{
+					if (version_field_address == version_field_writes[j])
+					{
+						found = true;
+						break;
+					}
+				}
+				if (!found)
+				{
+					printf("sanitiseNonVolatileStorage() did not clear version field at 0x%08x\n", version_field_address);
+					reportFailure();
+					abort = true;
+					break;
+				}
+				version_field_counter++;
+			}
+			version_field_address += sizeof(WalletRecord);
+		} // end while ((version_field_address + 4) <= TEST_ACCOUNTS_PARTITION_SIZE)
+		if (abort)
 		{
-			printf("Couldn't obtain address in wallet\n");
-			abort_error = true;
-			reportFailure();
 			break;
 		}
-		if ((memcmp(address1, &(address_buffer[i * 20]), 20))
-			|| (bigCompare(public_key.x, public_key_buffer[i].x) != BIGCMP_EQUAL)
-			|| (bigCompare(public_key.y, public_key_buffer[i].y) != BIGCMP_EQUAL))
+
+		// sanitiseNonVolatileStorage() should clear the version fields of any
+		// wallets in range, but it should also ignore all version fields not
+		// in range.
+		if (version_field_counter != version_field_index)
 		{
-			printf("getAddressAndPublicKey() returned mismatching address or public key, ah = %d\n", i);
-			abort = true;
+			printf("sanitiseNonVolatileStorage() is clearing out of range version fields\n");
 			reportFailure();
+			abort = true;
 			break;
 		}
-	}
+	} // end for (i = 0; i < 5000; i++)
 	if (!abort)
 	{
 		reportSuccess();
 	}
-	if (!abort_error)
-	{
-		reportSuccess();
-	}
+	suppress_write_debug_info = false; // can start reporting writes again
 
-	// Test getAddressAndPublicKey() and getPrivateKey() functions using
-	// invalid and then valid address handles.
-	if (getAddressAndPublicKey(temp, &public_key, 0) == WALLET_INVALID_HANDLE)
+	// Check that sanitising the global partition does not touch any version
+	// fields.
+	clearVersionFieldWriteLog();
+	sanitisePartition(PARTITION_GLOBAL);
+	if (version_field_index == 0)
 	{
 		reportSuccess();
 	}
 	else
 	{
-		printf("getAddressAndPublicKey() doesn't recognise 0 as invalid address handle\n");
+		printf("sanitisePartition(PARTITION_GLOBAL) is touching version fields\n");
 		reportFailure();
 	}
-	if (getPrivateKey(temp, 0) == WALLET_INVALID_HANDLE)
-	{
-		reportSuccess();
-	}
-	else
+
+	// Check that sanitising the accounts partition touches all version fields.
+	clearVersionFieldWriteLog();
+	sanitisePartition(PARTITION_ACCOUNTS);
+	// version_field_address is stepped through every possible address
+	// (ignoring start_address and end_address) that could hold a wallet's
+	// version field.
+	version_field_address = (uint8_t *)&(current_wallet.unencrypted.version) - (uint8_t *)&current_wallet;
+	version_field_counter = 0;
+	while ((version_field_address + 4) <= TEST_ACCOUNTS_PARTITION_SIZE)
 	{
-		printf("getPrivateKey() doesn't recognise 0 as invalid address handle\n");
-		reportFailure();
-	}
-	if (getAddressAndPublicKey(temp, &public_key, BAD_ADDRESS_HANDLE) == WALLET_INVALID_HANDLE)
+		version_field_counter++;
+		version_field_address += sizeof(WalletRecord);
+	} // end while ((version_field_address + 4) <= TEST_ACCOUNTS_PARTITION_SIZE)
+	if (version_field_index == version_field_counter)
 	{
 		reportSuccess();
 	}
 	else
 	{
-		printf("getAddressAndPublicKey() doesn't recognise BAD_ADDRESS_HANDLE as invalid address handle\n");
+		printf("sanitisePartition(PARTITION_ACCOUNTS) not touching all version fields\n");
 		reportFailure();
 	}
-	if (getPrivateKey(temp, BAD_ADDRESS_HANDLE) == WALLET_INVALID_HANDLE)
-	{
-		reportSuccess();
+
+	// Check that getNumberOfWallets() works and returns the appropriate value
+	// for various non-volatile storage sizes, in both layouts of the accounts
+	// partition. The partition was last sanitised on its own, so it is in
+	// the original layout, which only has wallet records. The layout with
+	// room for each wallet's extras is checked last, so that it is used by
+	// the following tests.
+	for (k = 0; k < 2; k++)
+	{
+		if (k == 1)
+		{
+			setAccountsLayoutWithExtras();
+		}
+		abort = false;
+		abort_error = false;
+		// Step in increments of 1 byte to look for off-by-one errors.
+		for (i = TEST_ACCOUNTS_PARTITION_SIZE; i < TEST_ACCOUNTS_PARTITION_SIZE + 1024; i++)
+		{
+			accounts_partition_size = (uint32_t)i;
+			num_wallets = 0; // reset cache
+			returned_num_wallets = getNumberOfWallets();
+			if (returned_num_wallets == 0)
+			{
+				printf("getNumberOfWallets() doesn't work\n");
+				reportFailure();
+				abort_error = true;
+				break;
+			}
+			stupidly_calculated_num_wallets = 0;
+			// In the original layout, each wallet only needs space for its
+			// record. Otherwise, it also needs space for its address index,
+			// change filter and stored parent public key.
+			footprint = (k == 0) ? (int)sizeof(WalletRecord) : (int)WALLET_FOOTPRINT;
+			for (j = 0; (j + footprint - 1) < i; j += footprint)
+			{
+				stupidly_calculated_num_wallets++;
+			}
+			if ((stupidly_calculated_num_wallets != returned_num_wallets)
+				|| (wallet_extras_enabled != (k == 1)))
+			{
+				printf("getNumberOfWallets() returning inappropriate value\n");
+				reportFailure();
+				abort = true;
+				break;
+			}
+		}
+		if (!abort)
+		{
+			reportSuccess();
+		}
+		if (!abort_error)
+		{
+			reportSuccess();
+		}
 	}
-	else
+	accounts_partition_size = TEST_ACCOUNTS_PARTITION_SIZE;
+	num_wallets = 0; // reset cache for next test
+
+	// For all functions which accept wallet numbers, try some wallet numbers
+	// which are in or out of range.
+	returned_num_wallets = getNumberOfWallets();
+	checkWalletSpecFunctions(0, true); // first one
+	// The next line does assume that returned_num_wallets > 1.
+	checkWalletSpecFunctions(returned_num_wallets - 1, true); // last one
+	checkWalletSpecFunctions(returned_num_wallets, false); // out of range
+	// The next line does assume that returned_num_wallets != 0xffffffff.
+	checkWalletSpecFunctions(returned_num_wallets + 1, false); // out of range
+	checkWalletSpecFunctions(0xffffffff, false); // out of range
+
+	// Create one wallet and some addresses, then create another wallet with a
+	// different wallet number and see if it overwrites the first one
+	// (it shouldn't).
+	uninitWallet();
+	memcpy(name, "A wallet with wallet number 0           ", NAME_LENGTH);
+	deleteWallet(0);
+	newWallet(0, name, false, NULL, false, NULL, 0);
+	makeNewAddress(address1, &public_key);
+	makeNewAddress(address1, &public_key);
+	ah = makeNewAddress(address1, &public_key);
+	uninitWallet();
+	memcpy(name2, "A wallet with wallet number 1           ", NAME_LENGTH);
+	deleteWallet(1);
+	newWallet(1, name2, false, NULL, false, NULL, 0);
+	makeNewAddress(address2, &public_key);
+	ah2 = makeNewAddress(address2, &public_key);
+	uninitWallet();
+	initWallet(0, NULL, 0);
+	getAddressAndPublicKey(compare_address, &public_key, ah);
+	if (memcmp(address1, compare_address, 20))
 	{
-		printf("getPrivateKey() doesn't recognise BAD_ADDRESS_HANDLE as invalid address handle\n");
+		printf("Creating wallet 1 seems to mangle wallet 0\n");
 		reportFailure();
 	}
-	if (getAddressAndPublicKey(temp, &public_key, handles_buffer[0]) == WALLET_NO_ERROR)
-	{
-		reportSuccess();
-	}
 	else
-	{
-		printf("getAddressAndPublicKey() doesn't recognise valid address handle\n");
-		reportFailure();
-	}
-	if (getPrivateKey(temp, handles_buffer[0]) == WALLET_NO_ERROR)
 	{
 		reportSuccess();
 	}
-	else
-	{
-		printf("getPrivateKey() doesn't recognise valid address handle\n");
-		reportFailure();
-	}
-
-	free(address_buffer);
-	free(public_key_buffer);
-	free(handles_buffer);
+	// Now:
+	// name contains name of wallet 0,
+	// name2 contains name of wallet 1,
+	// address1 contains the most recently created address in wallet 0,
+	// address2 contains the most recently created address in wallet 1.
 
-	// Check that changeEncryptionKey() works.
-	if (changeEncryptionKey(new_test_password, sizeof(new_test_password)) == WALLET_NO_ERROR)
-	{
-		reportSuccess();
-	}
-	else
+	// Unload wallet 0 then load wallet 1 and make sure wallet 1 was loaded.
+	uninitWallet();
+	initWallet(1, NULL, 0);
+	getAddressAndPublicKey(compare_address, &public_key, ah2);
+	if (memcmp(address2, compare_address, 20))
 	{
-		printf("Couldn't change encryption key\n");
+		printf("Loading wallet 0 seems to prevent wallet 1 from being loaded\n");
 		reportFailure();
 	}
-
-	// Check that the version field is "encrypted wallet".
-	if (getWalletInfo(&version, temp, wallet_uuid, 0) == WALLET_NO_ERROR)
+	else
 	{
 		reportSuccess();
 	}
-	else
+
+	// Check getWalletInfo() returns the name that was set for both wallets.
+	getWalletInfo(&version, compare_name, wallet_uuid, 0);
+	if (memcmp(name, compare_name, NAME_LENGTH))
 	{
-		printf("getWalletInfo() failed after changeEncryptionKey() was called\n");
+		printf("Wallet 0's name got mangled\n");
 		reportFailure();
 	}
-	if (version == VERSION_IS_ENCRYPTED)
+	else
 	{
 		reportSuccess();
 	}
-	else
+	getWalletInfo(&version, compare_name, wallet_uuid, 1);
+	if (memcmp(name2, compare_name, NAME_LENGTH))
 	{
-		printf("changeEncryptionKey() does not set version to encrypted wallet\n");
+		printf("Wallet 1's name got mangled\n");
 		reportFailure();
 	}
-
-	// Check name matches what was given in newWallet().
-	if (!memcmp(temp, name, NAME_LENGTH))
-	{
-		reportSuccess();
-	}
 	else
 	{
-		printf("getWalletInfo() doesn't return correct name when wallet is loaded\n");
-		reportFailure();
+		reportSuccess();
 	}
 
-	// Check that getWalletInfo() still works after unloading wallet.
+	// Set wallet 1 to have a different encryption key from wallet 0 and
+	// check that the correct encryption key (and only that one) works.
+	deleteWallet(0);
+	newWallet(0, name, false, NULL, false, test_password0, sizeof(test_password0));
+	makeNewAddress(address1, &public_key);
 	uninitWallet();
-	if (getWalletInfo(&version, temp, wallet_uuid, 0) == WALLET_NO_ERROR)
-	{
-		reportSuccess();
-	}
-	else
+	deleteWallet(1);
+	newWallet(1, name2, false, NULL, false, test_password1, sizeof(test_password1));
+	makeNewAddress(address2, &public_key);
+	uninitWallet();
+	if (initWallet(0, test_password0, sizeof(test_password0)) != WALLET_NO_ERROR)
 	{
-		printf("getWalletInfo() failed after uninitWallet() was called\n");
+		printf("Cannot load wallet 0 with correct key\n");
 		reportFailure();
 	}
-	if (version == VERSION_IS_ENCRYPTED)
+	else
 	{
 		reportSuccess();
 	}
-	else
+	uninitWallet();
+	if (initWallet(0, test_password1, sizeof(test_password1)) == WALLET_NO_ERROR)
 	{
-		printf("uninitWallet() caused wallet version to change\n");
+		printf("Wallet 0 can be loaded with wallet 1's key\n");
 		reportFailure();
 	}
-
-	// Check name matches what was given in newWallet().
-	if (!memcmp(temp, name, NAME_LENGTH))
+	else
 	{
 		reportSuccess();
 	}
-	else
+	uninitWallet();
+	if (initWallet(1, test_password0, sizeof(test_password0)) == WALLET_NO_ERROR)
 	{
-		printf("getWalletInfo() doesn't return correct name when wallet is not loaded\n");
+		printf("Wallet 1 can be loaded with wallet 0's key\n");
 		reportFailure();
 	}
-
-	// Change wallet's name and check that getWalletInfo() reflects the
-	// name change.
-	initWallet(0, new_test_password, sizeof(new_test_password));
-	memcpy(name, "HHHHH HHHHHHHHHHHHHHHHH HHHHHHHHHHHHHH  ", NAME_LENGTH);
-	if (changeWalletName(name) == WALLET_NO_ERROR)
+	else
 	{
 		reportSuccess();
 	}
-	else
+	uninitWallet();
+	if (initWallet(1, test_password1, sizeof(test_password1)) != WALLET_NO_ERROR)
 	{
-		printf("changeWalletName() couldn't change name\n");
+		printf("Cannot load wallet 1 with correct key\n");
 		reportFailure();
 	}
-	getWalletInfo(&version, temp, wallet_uuid, 0);
-	if (!memcmp(temp, name, NAME_LENGTH))
+	else
 	{
 		reportSuccess();
 	}
-	else
+	uninitWallet();
+
+	// Change wallet 1's key and check that it doesn't change wallet 0.
+	initWallet(1, test_password1, sizeof(test_password1));
+	changeEncryptionKey(new_test_password, sizeof(new_test_password));
+	uninitWallet();
+	if (initWallet(0, test_password0, sizeof(test_password0)) != WALLET_NO_ERROR)
 	{
-		printf("getWalletInfo() doesn't reflect name change\n");
+		printf("Cannot load wallet 0 with correct key after wallet 1's key was changed\n");
 		reportFailure();
 	}
-
-	// Check that name change is preserved when unloading and loading a
-	// wallet.
-	uninitWallet();
-	getWalletInfo(&version, temp, wallet_uuid, 0);
-	if (!memcmp(temp, name, NAME_LENGTH))
+	else
 	{
 		reportSuccess();
 	}
-	else
+	uninitWallet();
+
+	// Check that wallet 1 can be loaded with the new key.
+	if (initWallet(1, new_test_password, sizeof(new_test_password)) != WALLET_NO_ERROR)
 	{
-		printf("getWalletInfo() doesn't reflect name change after unloading wallet\n");
+		printf("Cannot load wallet 1 with correct key after wallet 1's key was changed\n");
 		reportFailure();
 	}
-
-	// Check that initWallet() succeeds (changing the name changes the
-	// checksum, so this tests whether the checksum was updated).
-	if (initWallet(0, new_test_password, sizeof(new_test_password)) == WALLET_NO_ERROR)
+	else
 	{
 		reportSuccess();
 	}
-	else
+	uninitWallet();
+
+	// So far, the multiple wallet tests have only looked at wallets 0 and 1.
+	// The following test creates the maximum number of wallets that
+	// non-volatile storage can hold and checks that they can all create
+	// addresses independently.
+	returned_num_wallets = getNumberOfWallets();
+	address_buffer = (uint8_t *)malloc(returned_num_wallets * 20);
+	for (i = 0; i < (int)returned_num_wallets; i++)
 	{
-		printf("initWallet() failed after name change\n");
-		reportFailure();
+		deleteWallet((uint32_t)i);
+		newWallet((uint32_t)i, name, false, NULL, false, NULL, 0);
+		makeNewAddress(&(address_buffer[i * 20]), &public_key);
+		uninitWallet();
 	}
-	getWalletInfo(&version, temp, wallet_uuid, 0);
-	if (!memcmp(temp, name, NAME_LENGTH))
+	abort = false;
+	for (i = 0; i < (int)returned_num_wallets; i++)
 	{
-		reportSuccess();
+		initWallet((uint32_t)i, NULL, 0);
+		getAddressAndPublicKey(compare_address, &public_key, 1);
+		if (memcmp(&(address_buffer[i * 20]), compare_address, 20))
+		{
+			printf("Wallet %d got corrupted\n", i);
+			reportFailure();
+			abort = true;
+			break;
+		}
+		uninitWallet();
 	}
-	else
+	if (!abort)
 	{
-		printf("getWalletInfo() doesn't reflect name change after reloading wallet\n");
-		reportFailure();
+		reportSuccess();
 	}
 
-	// Check that loading the wallet with the old key fails.
-	uninitWallet();
-	if (initWallet(0, NULL, 0) == WALLET_NOT_THERE)
+	// Check that addresses from each wallet are unique.
+	abort_duplicate = false;
+	for (i = 0; i < (int)returned_num_wallets; i++)
 	{
-		reportSuccess();
+		for (j = 0; j < i; j++)
+		{
+			if (!memcmp(&(address_buffer[i * 20]), &(address_buffer[j * 20]), 20))
+			{
+				printf("Different wallets generate the same addresses\n");
+				abort_duplicate = true;
+				reportFailure();
+				break;
+			}
+		}
+		if (abort_duplicate)
+		{
+			break;
+		}
 	}
-	else
+	if (!abort_duplicate)
 	{
-		printf("Loading wallet with old encryption key succeeds\n");
-		reportFailure();
+		reportSuccess();
 	}
+	free(address_buffer);
 
-	// Check that loading the wallet with the new key succeeds.
-	uninitWallet();
-	if (initWallet(0, new_test_password, sizeof(new_test_password)) == WALLET_NO_ERROR)
+	// An accounts partition in the original layout must keep every wallet
+	// slot it always had, since there's no way of telling whether a slot
+	// holds a hidden wallet. Fill every slot and use each wallet (which
+	// would write to its address index, change filter and stored parent
+	// public key, if there was room for them), then check that none of the
+	// wallets got corrupted.
+	memset(copy_of_nv, 0, 8);
+	nonVolatileWrite(copy_of_nv, PARTITION_GLOBAL, ADDRESS_ACCOUNTS_LAYOUT, 8);
+	nonVolatileFlush();
+	num_wallets = 0; // reset cache
+	returned_num_wallets = getNumberOfWallets();
+	if (returned_num_wallets == (TEST_ACCOUNTS_PARTITION_SIZE / sizeof(WalletRecord)))
 	{
 		reportSuccess();
 	}
 	else
 	{
-		printf("Loading wallet with new encryption key fails\n");
+		printf("Original layout doesn't have every wallet slot\n");
 		reportFailure();
 	}
-
-	// Test the getAddressAndPublicKey() and getPrivateKey() functions on an
-	// empty wallet.
-	deleteWallet(0);
-	newWallet(0, name, false, NULL, false, NULL, 0);
-	if (getAddressAndPublicKey(temp, &public_key, 0) == WALLET_EMPTY)
+	address_buffer = (uint8_t *)malloc(returned_num_wallets * 20);
+	for (i = 0; i < (int)returned_num_wallets; i++)
 	{
-		reportSuccess();
+		deleteWallet((uint32_t)i);
+		newWallet((uint32_t)i, name, false, NULL, false, NULL, 0);
+		makeNewAddress(&(address_buffer[i * 20]), &public_key);
+		makeNewAddress(address1, &public_key);
+		getAddressAndPublicKey(address1, &public_key, 1);
+		isOwnAddress(address1);
+		uninitWallet();
 	}
-	else
+	abort = false;
+	for (i = 0; i < (int)returned_num_wallets; i++)
 	{
-		printf("getAddressAndPublicKey() doesn't deal with empty wallets correctly\n");
-		reportFailure();
+		if ((initWallet((uint32_t)i, NULL, 0) != WALLET_NO_ERROR)
+			|| (getAddressAndPublicKey(compare_address, &public_key, 1) != WALLET_NO_ERROR)
+			|| memcmp(&(address_buffer[i * 20]), compare_address, 20))
+		{
+			printf("Wallet %d in original layout got corrupted\n", i);
+			reportFailure();
+			abort = true;
+			break;
+		}
+		// There's no stored master public key, so it has to be derived.
+		getMasterPublicKey(&master_public_key, chain_code);
+		generateDeterministicPublicKey(&compare_public_key, &master_public_key, chain_code, 1);
+		if (memcmp(&public_key, &compare_public_key, sizeof(PointAffine)))
+		{
+			printf("Wallet %d in original layout has wrong master public key\n", i);
+			reportFailure();
+			abort = true;
+			break;
+		}
+		uninitWallet();
 	}
-	if (getPrivateKey(temp, 0) == WALLET_EMPTY)
+	if (!abort)
 	{
 		reportSuccess();
 	}
-	else
-	{
-		printf("getPrivateKey() doesn't deal with empty wallets correctly\n");
-		reportFailure();
-	}
+	free(address_buffer);
 
-	// Test wallet backup to valid device.
-	deleteWallet(0);
-	newWallet(0, name, false, NULL, false, NULL, 0);
-	if (backupWallet(false, 0) == WALLET_NO_ERROR)
+	// Clear NV storage, then create a new hidden wallet.
+	sanitiseEverything();
+	nonVolatileRead((uint8_t *)&unencrypted_part, PARTITION_ACCOUNTS, 0, sizeof(unencrypted_part));
+	memcpy(name, "This will be ignored                    ", NAME_LENGTH);
+	if (newWallet(0, name, false, NULL, true, test_password0, sizeof(test_password0)) != WALLET_NO_ERROR)
 	{
-		reportSuccess();
+		printf("Couldn't create new hidden wallet\n");
+		reportFailure();
 	}
 	else
 	{
-		printf("Unencrypted backupWallet() doesn't work\n");
-		reportFailure();
+		reportSuccess();
 	}
-	memcpy(seed1, test_wallet_backup, SEED_LENGTH);
-	makeNewAddress(address1, &public_key); // save this for later
 
-	// Test wallet backup to invalid device.
-	if (backupWallet(false, 1) == WALLET_BACKUP_ERROR)
+	// Check that the hidden wallet can function as a wallet by creating an
+	// address.
+	if (makeNewAddress(address1, &public_key) == BAD_ADDRESS_HANDLE)
 	{
-		reportSuccess();
+		printf("Couldn't create new address in hidden wallet\n");
+		reportFailure();
 	}
 	else
 	{
-		printf("backupWallet() doesn't deal with invalid device correctly\n");
-		reportFailure();
+		reportSuccess();
 	}
+	uninitWallet();
 
-	// Delete wallet and check that seed of a new wallet is different.
-	deleteWallet(0);
-	newWallet(0, name, false, NULL, false, NULL, 0);
-	backupWallet(false, 0);
-	memcpy(seed2, test_wallet_backup, SEED_LENGTH);
-	if (memcmp(seed1, seed2, SEED_LENGTH))
+	// Check that unencrypted part (which contains name/version) wasn't
+	// touched.
+	nonVolatileRead((uint8_t *)&compare_unencrypted_part, PARTITION_ACCOUNTS, 0, sizeof(compare_unencrypted_part));
+	if (memcmp(&unencrypted_part, &compare_unencrypted_part, sizeof(unencrypted_part)))
 	{
-		reportSuccess();
+		printf("Creation of hidden wallet writes to unencrypted portion of wallet storage\n");
+		reportFailure();
 	}
 	else
 	{
-		printf("Seed of new wallet matches older one.\n");
-		reportFailure();
+		reportSuccess();
 	}
 
-	// Try to restore a wallet backup.
-	deleteWallet(0);
-	if (newWallet(0, name, true, seed1, false, test_password0, sizeof(test_password0)) == WALLET_NO_ERROR)
+	// Is it possible to load the hidden wallet?
+	uninitWallet();
+	if (initWallet(0, test_password0, sizeof(test_password0)) != WALLET_NO_ERROR)
 	{
-		reportSuccess();
+		printf("Could not load hidden wallet\n");
+		reportFailure();
 	}
 	else
 	{
-		printf("Could not restore wallet\n");
-		reportFailure();
+		reportSuccess();
 	}
 
-	// Does the first address of the restored wallet match the old wallet?
-	makeNewAddress(address2, &public_key);
-	if (!memcmp(address1, address2, 20))
+	// It should be possible to change the encryption key of a hidden wallet.
+	if (changeEncryptionKey(new_test_password, sizeof(new_test_password)) != WALLET_NO_ERROR)
 	{
-		reportSuccess();
+		printf("Couldn't change encryption key for hidden wallet\n");
+		reportFailure();
 	}
 	else
 	{
-		printf("Restored wallet doesn't generate the same address\n");
-		reportFailure();
+		reportSuccess();
 	}
 
-	// Test wallet backup with encryption.
-	if (backupWallet(true, 0) == WALLET_NO_ERROR)
+	// Check that the unencrypted part (which contains name/version) wasn't
+	// touched.
+	uninitWallet();
+	nonVolatileRead((uint8_t *)&compare_unencrypted_part, PARTITION_ACCOUNTS, 0, sizeof(compare_unencrypted_part));
+	if (memcmp(&unencrypted_part, &compare_unencrypted_part, sizeof(unencrypted_part)))
 	{
-		reportSuccess();
+		printf("Key change on hidden wallet results in writes to unencrypted portion of wallet storage\n");
+		reportFailure();
 	}
 	else
 	{
-		printf("Encrypted backupWallet() doesn't work\n");
-		reportFailure();
+		reportSuccess();
 	}
-	memcpy(encrypted_seed, test_wallet_backup, SEED_LENGTH);
 
-	// Decrypt the encrypted seed and check it matches the unencrypted one.
-	memset(temp, 0, 16);
-	for (i = 0; i < SEED_LENGTH; i += 16)
-	{
-		writeU32LittleEndian(temp, (uint32_t)i);
-		xexDecrypt(&(seed2[i]), &(encrypted_seed[i]), temp, 1);
+	// The hidden wallet should be loadable with the new key but not the old.
+	uninitWallet();
+	if (initWallet(0, new_test_password, sizeof(new_test_password)) != WALLET_NO_ERROR)
+	{
+		printf("Could not load hidden wallet after encryption key change\n");
+		reportFailure();
 	}
-	if (!memcmp(seed1, seed2, SEED_LENGTH))
+	else
 	{
 		reportSuccess();
 	}
-	else
+	uninitWallet();
+	if (initWallet(0, test_password0, sizeof(test_password0)) != WALLET_NOT_THERE)
 	{
-		printf("Decrypted seed does not match encrypted one.\n");
+		printf("Could load hidden wallet with old encryption key\n");
 		reportFailure();
 	}
-
-	// Test that sanitiseNonVolatileStorage() doesn't accept addresses which
-	// aren't a multiple of 4.
-	if (sanitiseNonVolatileStorage(PARTITION_GLOBAL, 1, 16) == WALLET_BAD_ADDRESS)
+	else
 	{
 		reportSuccess();
 	}
-	else
+
+	// Change key to all 00s (representing an "unencrypted" wallet) and do
+	// the above key change tests.
+	initWallet(0, new_test_password, sizeof(new_test_password));
+	if (changeEncryptionKey(NULL, 0) != WALLET_NO_ERROR)
 	{
-		printf("sanitiseNonVolatileStorage() accepts start address which is not a multiple of 4\n");
+		printf("Couldn't change encryption key for hidden wallet 2\n");
 		reportFailure();
 	}
-	if (sanitiseNonVolatileStorage(PARTITION_GLOBAL, 0, 15) == WALLET_BAD_ADDRESS)
+	else
 	{
 		reportSuccess();
 	}
-	else
+	uninitWallet();
+	nonVolatileRead((uint8_t *)&compare_unencrypted_part, PARTITION_ACCOUNTS, 0, sizeof(compare_unencrypted_part));
+	if (memcmp(&unencrypted_part, &compare_unencrypted_part, sizeof(unencrypted_part)))
 	{
-		printf("sanitiseNonVolatileStorage() accepts length which is not a multiple of 4\n");
+		printf("Key change on hidden wallet results in writes to unencrypted portion of wallet storage 2\n");
 		reportFailure();
 	}
-
-	// Test that sanitiseNonVolatileStorage() detects possible overflows.
-	if (sanitiseNonVolatileStorage(PARTITION_GLOBAL, 0x80000000, 0x80000000) == WALLET_BAD_ADDRESS)
+	else
 	{
 		reportSuccess();
 	}
-	else
+	uninitWallet();
+	if (initWallet(0, NULL, 0) != WALLET_NO_ERROR)
 	{
-		printf("sanitiseNonVolatileStorage() not detecting overflow 1\n");
+		printf("Could not load hidden wallet after encryption key change 2\n");
 		reportFailure();
 	}
-	if (sanitiseNonVolatileStorage(PARTITION_GLOBAL, 0xffffffff, 1) == WALLET_BAD_ADDRESS)
+	else
 	{
 		reportSuccess();
 	}
-	else
+	uninitWallet();
+	if (initWallet(0, new_test_password, sizeof(new_test_password)) != WALLET_NOT_THERE)
 	{
-		printf("sanitiseNonVolatileStorage() not detecting overflow 2\n");
+		printf("Could load hidden wallet with old encryption key 2\n");
 		reportFailure();
 	}
-	if (sanitiseNonVolatileStorage(PARTITION_GLOBAL, 1, 0xffffffff) == WALLET_BAD_ADDRESS)
-	{
-		reportSuccess();
-	}
 	else
 	{
-		printf("sanitiseNonVolatileStorage() not detecting overflow 3\n");
-		reportFailure();
+		reportSuccess();
 	}
 
-	// Test that sanitiseNonVolatileStorage() clears the correct area.
-	// Previously, sanitiseNonVolatileStorage() required the start and end
-	// parameters to be a multiple of 32 (because it uses a write buffer
-	// with that length). That restriction has since been relaxed. This test
-	// case checks that the code handles non-multiples of 32 properly.
-	suppress_write_debug_info = true; // stop console from going crazy
-	suppress_set_entropy_pool = true; // avoid spurious entropy pool update writes
-	abort = false;
-	for (i = 0; i < 2000; i++)
+	// Wallet name changes on a hidden wallet should be disallowed.
+	initWallet(0, NULL, 0);
+	memcpy(name2, "This will also be ignored               ", NAME_LENGTH);
+	if (changeWalletName(name2) != WALLET_INVALID_OPERATION)
 	{
-		initialiseDefaultEntropyPool(); // needed in case pool or checksum gets corrupted by writes
-		minimum_address_written[PARTITION_ACCOUNTS] = 0xffffffff;
-		maximum_address_written[PARTITION_ACCOUNTS] = 0;
-		start_address = (uint32_t)((rand() % TEST_ACCOUNTS_PARTITION_SIZE) & 0xfffffffc);
-		end_address = start_address + (uint32_t)((rand() % TEST_ACCOUNTS_PARTITION_SIZE) & 0xfffffffc);
-		if (end_address > TEST_ACCOUNTS_PARTITION_SIZE)
-		{
-			end_address = TEST_ACCOUNTS_PARTITION_SIZE;
-		}
-		if (start_address != end_address)
-		{
-			sanitiseNonVolatileStorage(PARTITION_ACCOUNTS, start_address, end_address - start_address);
-			if ((minimum_address_written[PARTITION_ACCOUNTS] != start_address)
-				|| (maximum_address_written[PARTITION_ACCOUNTS] != (end_address - 1)))
-			{
-				printf("sanitiseNonVolatileStorage() not clearing correct area\n");
-				printf("start = 0x%08x, end = 0x%08x\n", start_address, end_address);
-				abort = true;
-				reportFailure();
-				break;
-			}
-		}
+		printf("Wallet name change is allowed on a hidden wallet\n");
+		reportFailure();
 	}
-	if (!abort)
+	else
 	{
 		reportSuccess();
 	}
 
-	// Also check that sanitiseNonVolatileStorage() does nothing if length is 0.
-	initialiseDefaultEntropyPool(); // needed in case pool or checksum gets corrupted by writes
-	minimum_address_written[PARTITION_ACCOUNTS] = 0xffffffff;
-	maximum_address_written[PARTITION_ACCOUNTS] = 0;
-	// Use offsetof(WalletRecord, unencrypted.version) to try and
-	// trick the "clear version field" logic.
-	start_address = offsetof(WalletRecord, unencrypted.version);
-	sanitiseNonVolatileStorage(PARTITION_ACCOUNTS, start_address, 0);
-	if ((minimum_address_written[PARTITION_ACCOUNTS] != 0xffffffff) || (maximum_address_written[PARTITION_ACCOUNTS] != 0))
+	// Check that the wallet is still intact by getting the previously
+	// generated address from it.
+	initWallet(0, NULL, 0);
+	if (getAddressAndPublicKey(address2, &public_key, 1) != WALLET_NO_ERROR)
 	{
-		printf("sanitiseNonVolatileStorage() clearing something when it's not supposed to\n");
+		printf("Couldn't get address from hidden wallet\n");
 		reportFailure();
 	}
 	else
 	{
 		reportSuccess();
 	}
-
-	// Check that sanitiseNonVolatileStorage() is clearing the correct version
-	// fields of any wallets in range.
-	suppress_write_debug_info = true; // stop console from going crazy
-	suppress_set_entropy_pool = false;
-	abort = false;
-	for (i = 0; i < 5000; i++)
+	if (memcmp(address1, address2, 20))
 	{
-		start_address = (uint32_t)((rand() % TEST_ACCOUNTS_PARTITION_SIZE) & 0xfffffffc);
-		end_address = start_address + (uint32_t)((rand() % TEST_ACCOUNTS_PARTITION_SIZE) & 0xfffffffc);
-		if (end_address > TEST_ACCOUNTS_PARTITION_SIZE)
-		{
-			end_address = TEST_ACCOUNTS_PARTITION_SIZE;
-		}
-		initialiseDefaultEntropyPool(); // needed in case pool or checksum gets corrupted by writes
-		clearVersionFieldWriteLog();
-		sanitiseNonVolatileStorage(PARTITION_ACCOUNTS, start_address, end_address - start_address);
-		// version_field_address is stepped through every possible address
-		// (ignoring start_address and end_address) that could hold a wallet's
-		// version field.
-		version_field_address = (uint8_t *)&(current_wallet.unencrypted.version) - (uint8_t *)&current_wallet;
-		version_field_counter = 0;
-		while ((version_field_address + 4) <= TEST_ACCOUNTS_PARTITION_SIZE)
-		{
-			if ((version_field_address >= start_address)
-				&& ((version_field_address + 4) <= end_address))
-			{
-				// version_field_address should be in the list somewhere.
-				found = false;
-				for (j = 0; j < version_field_index; j++)
-				{
-					if (version_field_address == version_field_writes[j])
-					{
-						found = true;
-						break;
-					}
-				}
-				if (!found)
-				{
-					printf("sanitiseNonVolatileStorage() did not clear version field at 0x%08x\n", version_field_address);
-					reportFailure();
-					abort = true;
-					break;
-				}
-				version_field_counter++;
-			}
-			version_field_address += sizeof(WalletRecord);
-		} // end while ((version_field_address + 4) <= TEST_ACCOUNTS_PARTITION_SIZE)
-		if (abort)
-		{
-			break;
-		}
-
-		// sanitiseNonVolatileStorage() should clear the version fields of any
-		// wallets in range, but it should also ignore all version fields not
-		// in range.
-		if (version_field_counter != version_field_index)
-		{
-			printf("sanitiseNonVolatileStorage() is clearing out of range version fields\n");
-			reportFailure();
-			abort = true;
-			break;
-		}
-	} // end for (i = 0; i < 5000; i++)
-	if (!abort)
+		printf("Addresses in hidden wallet are getting mangled\n");
+		reportFailure();
+	}
+	else
 	{
 		reportSuccess();
 	}
-	suppress_write_debug_info = false; // can start reporting writes again
 
-	// Check that sanitising the global partition does not touch any version
-	// fields.
-	clearVersionFieldWriteLog();
-	sanitisePartition(PARTITION_GLOBAL);
-	if (version_field_index == 0)
+	// Create a non-hidden wallet, then overwrite it with a hidden wallet.
+	// The resulting version field should still be VERSION_NOTHING_THERE.
+	uninitWallet();
+	deleteWallet(0);
+	newWallet(0, name, false, NULL, false, NULL, 0);
+	deleteWallet(0);
+	newWallet(0, name, false, NULL, true, NULL, 0);
+	getWalletInfo(&version, temp, wallet_uuid, 0);
+	if (version != VERSION_NOTHING_THERE)
 	{
-		reportSuccess();
+		printf("Hidden wallet's version field is not VERSION_NOTHING_THERE\n");
+		reportFailure();
 	}
 	else
 	{
-		printf("sanitisePartition(PARTITION_GLOBAL) is touching version fields\n");
-		reportFailure();
+		reportSuccess();
 	}
 
-	// Check that sanitising the accounts partition touches all version fields.
-	clearVersionFieldWriteLog();
-	sanitisePartition(PARTITION_ACCOUNTS);
-	// version_field_address is stepped through every possible address
-	// (ignoring start_address and end_address) that could hold a wallet's
-	// version field.
-	version_field_address = (uint8_t *)&(current_wallet.unencrypted.version) - (uint8_t *)&current_wallet;
-	version_field_counter = 0;
-	while ((version_field_address + 4) <= TEST_ACCOUNTS_PARTITION_SIZE)
+	// Create two wallets. Their UUIDs should not be the same.
+	uninitWallet();
+	deleteWallet(0);
+	newWallet(0, name, false, NULL, false, NULL, 0);
+	deleteWallet(1);
+	newWallet(1, name, false, NULL, false, NULL, 0);
+	getWalletInfo(&version, temp, wallet_uuid, 0);
+	getWalletInfo(&version, temp, wallet_uuid2, 1);
+	if (!memcmp(wallet_uuid, wallet_uuid2, UUID_LENGTH))
 	{
-		version_field_counter++;
-		version_field_address += sizeof(WalletRecord);
-	} // end while ((version_field_address + 4) <= TEST_ACCOUNTS_PARTITION_SIZE)
-	if (version_field_index == version_field_counter)
+		printf("Wallet UUIDs not unique\n");
+		reportFailure();
+	}
+	else
 	{
 		reportSuccess();
 	}
-	else
+
+	// Overwrite wallet 0. The UUID should change.
+	uninitWallet();
+	deleteWallet(0);
+	newWallet(0, name, false, NULL, false, test_password0, sizeof(test_password0));
+	getWalletInfo(&version, temp, wallet_uuid2, 0);
+	if (!memcmp(wallet_uuid, wallet_uuid2, UUID_LENGTH))
 	{
-		printf("sanitisePartition(PARTITION_ACCOUNTS) not touching all version fields\n");
+		printf("Wallet UUIDs aren't changing on overwrite\n");
 		reportFailure();
 	}
-
-	// Check that getNumberOfWallets() works and returns the appropriate value
-	// for various non-volatile storage sizes.
-	abort = false;
-	abort_error = false;
-	// Step in increments of 1 byte to look for off-by-one errors.
-	for (i = TEST_ACCOUNTS_PARTITION_SIZE; i < TEST_ACCOUNTS_PARTITION_SIZE + 1024; i++)
+	else
 	{
-		accounts_partition_size = i;
-		num_wallets = 0; // reset cache
-		returned_num_wallets = getNumberOfWallets();
-		if (returned_num_wallets == 0)
-		{
-			printf("getNumberOfWallets() doesn't work\n");
-			reportFailure();
-			abort_error = true;
-			break;
-		}
-		stupidly_calculated_num_wallets = 0;
-		for (j = 0; (int)(j + (sizeof(WalletRecord) - 1)) < i; j += sizeof(WalletRecord))
-		{
-			stupidly_calculated_num_wallets++;
-		}
-		if (stupidly_calculated_num_wallets != returned_num_wallets)
-		{
-			printf("getNumberOfWallets() returning inappropriate value\n");
-			reportFailure();
-			abort = true;
-			break;
-		}
+		reportSuccess();
 	}
-	if (!abort)
+
+	// Perform a few operations on the wallet. The wallet UUID shouldn't change.
+	uninitWallet();
+	getWalletInfo(&version, temp, wallet_uuid, 0);
+	initWallet(0, test_password0, sizeof(test_password0));
+	changeEncryptionKey(NULL, 0);
+	makeNewAddress(address1, &public_key);
+	changeWalletName(name2);
+	uninitWallet();
+	initWallet(0, NULL, 0);
+	getWalletInfo(&version, temp, wallet_uuid2, 0);
+	if (memcmp(wallet_uuid, wallet_uuid2, UUID_LENGTH))
 	{
-		reportSuccess();
+		printf("Wallet UUIDs changing when the wallet is used\n");
+		reportFailure();
 	}
-	if (!abort_error)
+	else
 	{
 		reportSuccess();
 	}
-	accounts_partition_size = TEST_ACCOUNTS_PARTITION_SIZE;
-	num_wallets = 0; // reset cache for next test
 
-	// For all functions which accept wallet numbers, try some wallet numbers
-	// which are in or out of range.
-	returned_num_wallets = getNumberOfWallets();
-	checkWalletSpecFunctions(0, true); // first one
-	// The next line does assume that returned_num_wallets > 1.
-	checkWalletSpecFunctions(returned_num_wallets - 1, true); // last one
-	checkWalletSpecFunctions(returned_num_wallets, false); // out of range
-	// The next line does assume that returned_num_wallets != 0xffffffff.
-	checkWalletSpecFunctions(returned_num_wallets + 1, false); // out of range
-	checkWalletSpecFunctions(0xffffffff, false); // out of range
-
-	// Create one wallet and some addresses, then create another wallet with a
-	// different wallet number and see if it overwrites the first one
-	// (it shouldn't).
+	// Check that getMasterPublicKey() works.
 	uninitWallet();
-	memcpy(name, "A wallet with wallet number 0           ", NAME_LENGTH);
 	deleteWallet(0);
 	newWallet(0, name, false, NULL, false, NULL, 0);
-	makeNewAddress(address1, &public_key);
-	makeNewAddress(address1, &public_key);
-	makeNewAddress(address1, &public_key);
-	uninitWallet();
-	memcpy(name2, "A wallet with wallet number 1           ", NAME_LENGTH);
-	deleteWallet(1);
-	newWallet(1, name2, false, NULL, false, NULL, 0);
-	makeNewAddress(address2, &public_key);
-	makeNewAddress(address2, &public_key);
-	uninitWallet();
 	initWallet(0, NULL, 0);
-	ah = getNumAddresses();
-	getAddressAndPublicKey(compare_address, &public_key, ah);
-	if (memcmp(address1, compare_address, 20))
+	if (getMasterPublicKey(&master_public_key, chain_code) != WALLET_NO_ERROR)
 	{
-		printf("Creating wallet 1 seems to mangle wallet 0\n");
+		printf("getMasterPublicKey() fails in the simplest case\n");
 		reportFailure();
 	}
 	else
 	{
 		reportSuccess();
 	}
-	// Now:
-	// name contains name of wallet 0,
-	// name2 contains name of wallet 1,
-	// address1 contains the most recently created address in wallet 0,
-	// address2 contains the most recently created address in wallet 1.
 
-	// Unload wallet 0 then load wallet 1 and make sure wallet 1 was loaded.
+	// Check that the stored master public key is the one derived from the
+	// seed, even after the wallet is reloaded.
+	backupWallet(false, 0);
+	memcpy(seed1, test_wallet_backup, SEED_LENGTH);
+	swapEndian256(seed1); // since seed is big-endian
+	setFieldToN();
+	bigModulo(seed1, seed1);
+	pointMultiplyBase(&compare_public_key, seed1);
 	uninitWallet();
-	initWallet(1, NULL, 0);
-	ah = getNumAddresses();
-	getAddressAndPublicKey(compare_address, &public_key, ah);
-	if (memcmp(address2, compare_address, 20))
+	initWallet(0, NULL, 0);
+	getMasterPublicKey(&master_public_key, chain_code);
+	if (memcmp(&master_public_key, &compare_public_key, sizeof(PointAffine)))
 	{
-		printf("Loading wallet 0 seems to prevent wallet 1 from being loaded\n");
+		printf("Stored master public key doesn't match seed\n");
 		reportFailure();
 	}
 	else
@@ -2978,21 +5828,28 @@ int main(void)
 		reportSuccess();
 	}
 
-	// Check getWalletInfo() returns the name that was set for both wallets.
-	getWalletInfo(&version, compare_name, wallet_uuid, 0);
-	if (memcmp(name, compare_name, NAME_LENGTH))
+	// Check that a corrupted stored master public key isn't used, and that
+	// it is replaced when the wallet is loaded.
+	nonVolatileRead(&one_byte, PARTITION_ACCOUNTS, getParentKeyEntryAddress(), 1);
+	one_byte ^= 0x01;
+	nonVolatileWrite(&one_byte, PARTITION_ACCOUNTS, getParentKeyEntryAddress(), 1);
+	nonVolatileFlush();
+	uninitWallet();
+	initWallet(0, NULL, 0);
+	getMasterPublicKey(&master_public_key, chain_code);
+	if (memcmp(&master_public_key, &compare_public_key, sizeof(PointAffine)))
 	{
-		printf("Wallet 0's name got mangled\n");
+		printf("Corrupted stored master public key is used\n");
 		reportFailure();
 	}
 	else
 	{
 		reportSuccess();
 	}
-	getWalletInfo(&version, compare_name, wallet_uuid, 1);
-	if (memcmp(name2, compare_name, NAME_LENGTH))
+	nonVolatileRead(&rewritten_byte, PARTITION_ACCOUNTS, getParentKeyEntryAddress(), 1);
+	if (rewritten_byte == one_byte)
 	{
-		printf("Wallet 1's name got mangled\n");
+		printf("Corrupted stored master public key isn't replaced\n");
 		reportFailure();
 	}
 	else
@@ -3000,429 +5857,661 @@ int main(void)
 		reportSuccess();
 	}
 
-	// Set wallet 1 to have a different encryption key from wallet 0 and
-	// check that the correct encryption key (and only that one) works.
-	deleteWallet(0);
-	newWallet(0, name, false, NULL, false, test_password0, sizeof(test_password0));
-	makeNewAddress(address1, &public_key);
-	uninitWallet();
-	deleteWallet(1);
-	newWallet(1, name2, false, NULL, false, test_password1, sizeof(test_password1));
-	makeNewAddress(address2, &public_key);
-	uninitWallet();
-	if (initWallet(0, test_password0, sizeof(test_password0)) != WALLET_NO_ERROR)
+	// Wallet records must keep their original size, otherwise existing
+	// wallets would no longer be found where they were written.
+	if (sizeof(WalletRecord) == 176)
 	{
-		printf("Cannot load wallet 0 with correct key\n");
+		reportSuccess();
+	}
+	else
+	{
+		printf("Wallet records have changed size\n");
+		reportFailure();
+	}
+
+	// Check that wallet public keys can be derived from the public key and
+	// chain code that getMasterPublicKey() returned.
+	generateDeterministicPublicKey(&public_key, &master_public_key, chain_code, 1);
+	makeNewAddress(address1, &compare_public_key);
+	if (memcmp(&public_key, &compare_public_key, sizeof(PointAffine)))
+	{
+		printf("Address 1 can't be derived from master public key\n");
 		reportFailure();
 	}
 	else
 	{
 		reportSuccess();
 	}
-	uninitWallet();
-	if (initWallet(0, test_password1, sizeof(test_password1)) == WALLET_NO_ERROR)
+	generateDeterministicPublicKey(&public_key, &master_public_key, chain_code, 2);
+	makeNewAddress(address1, &compare_public_key);
+	if (memcmp(&public_key, &compare_public_key, sizeof(PointAffine)))
 	{
-		printf("Wallet 0 can be loaded with wallet 1's key\n");
+		printf("Address 2 can't be derived from master public key\n");
 		reportFailure();
 	}
 	else
 	{
 		reportSuccess();
 	}
+
+	// Check that the address index is filled as addresses are generated, and
+	// that it gives the same results as calculating addresses from scratch.
+	// Address handles past the end of the index should replace the ones
+	// which are #WALLET_INDEX_ENTRIES before them.
 	uninitWallet();
-	if (initWallet(1, test_password0, sizeof(test_password0)) == WALLET_NO_ERROR)
+	deleteWallet(0);
+	newWallet(0, name, false, NULL, false, NULL, 0);
+	if (readIndexEntry(address1, &public_key, 1))
 	{
-		printf("Wallet 1 can be loaded with wallet 0's key\n");
+		printf("Address index not empty for new wallet\n");
 		reportFailure();
 	}
 	else
 	{
 		reportSuccess();
 	}
+	for (i = 0; i < (WALLET_INDEX_ENTRIES + 2); i++)
+	{
+		makeNewAddress(address1, &public_key);
+	}
 	uninitWallet();
-	if (initWallet(1, test_password1, sizeof(test_password1)) != WALLET_NO_ERROR)
+	initWallet(0, NULL, 0);
+	abort = false;
+	for (ah = 1; ah <= (WALLET_INDEX_ENTRIES + 2); ah++)
+	{
+		found = readIndexEntry(address1, &public_key, ah);
+		if (found != (ah > 2))
+		{
+			printf("Address index entry for handle %u is wrong\n", (unsigned int)ah);
+			abort = true;
+			break;
+		}
+	}
+	for (ah = 1; !abort && (ah <= (WALLET_INDEX_ENTRIES + 2)); ah++)
+	{
+		getAddressesAndPublicKeys(compare_address, &compare_public_key, ah, 1);
+		getAddressAndPublicKey(address2, &public_key, ah);
+		if (memcmp(address2, compare_address, 20) || memcmp(&public_key, &compare_public_key, sizeof(PointAffine)))
+		{
+			printf("Address index gives wrong address for handle %u\n", (unsigned int)ah);
+			abort = true;
+			break;
+		}
+	}
+	if (abort)
 	{
-		printf("Cannot load wallet 1 with correct key\n");
 		reportFailure();
 	}
 	else
 	{
 		reportSuccess();
 	}
-	uninitWallet();
 
-	// Change wallet 1's key and check that it doesn't change wallet 0.
-	initWallet(1, test_password1, sizeof(test_password1));
-	changeEncryptionKey(new_test_password, sizeof(new_test_password));
-	uninitWallet();
-	if (initWallet(0, test_password0, sizeof(test_password0)) != WALLET_NO_ERROR)
+	// Changing the encryption key should empty the address index, but
+	// lookups should still work.
+	changeEncryptionKey(test_password0, sizeof(test_password0));
+	if (readIndexEntry(address1, &public_key, 1))
 	{
-		printf("Cannot load wallet 0 with correct key after wallet 1's key was changed\n");
+		printf("Address index not emptied by changeEncryptionKey()\n");
 		reportFailure();
 	}
 	else
 	{
 		reportSuccess();
 	}
-	uninitWallet();
+	getAddressesAndPublicKeys(compare_address, &compare_public_key, 1, 1);
+	getAddressAndPublicKey(address2, &public_key, 1);
+	if (memcmp(address2, compare_address, 20) || memcmp(&public_key, &compare_public_key, sizeof(PointAffine))
+		|| !readIndexEntry(address1, &public_key, 1))
+	{
+		printf("Address index not refilled after changeEncryptionKey()\n");
+		reportFailure();
+	}
+	else
+	{
+		reportSuccess();
+	}
+	changeEncryptionKey(NULL, 0);
 
-	// Check that wallet 1 can be loaded with the new key.
-	if (initWallet(1, new_test_password, sizeof(new_test_password)) != WALLET_NO_ERROR)
+	// Check that isOwnAddress() recognises addresses which makeNewAddress()
+	// handed out, even after reloading the wallet or changing its key, but
+	// not an address which only shares a change filter entry with one.
+	uninitWallet();
+	deleteWallet(0);
+	newWallet(0, name, false, NULL, false, NULL, 0);
+	makeNewAddress(address1, &public_key);
+	makeNewAddress(address2, &public_key);
+	memcpy(compare_address, address2, 20);
+	compare_address[10] ^= 0x01;
+	abort = false;
+	for (i = 0; !abort && (i < 3); i++)
+	{
+		if (i == 1)
+		{
+			uninitWallet();
+			initWallet(0, NULL, 0);
+		}
+		else if (i == 2)
+		{
+			changeEncryptionKey(test_password0, sizeof(test_password0));
+		}
+		if (!isOwnAddress(address1) || !isOwnAddress(address2))
+		{
+			printf("isOwnAddress() doesn't recognise own address, case %d\n", i);
+			abort = true;
+		}
+		if (isOwnAddress(compare_address))
+		{
+			printf("isOwnAddress() recognises someone else's address, case %d\n", i);
+			abort = true;
+		}
+	}
+	changeEncryptionKey(NULL, 0);
+	if (abort)
 	{
-		printf("Cannot load wallet 1 with correct key after wallet 1's key was changed\n");
 		reportFailure();
 	}
 	else
 	{
 		reportSuccess();
 	}
+	// A new wallet (with the same key) shouldn't inherit the change filter.
 	uninitWallet();
-
-	// So far, the multiple wallet tests have only looked at wallets 0 and 1.
-	// The following test creates the maximum number of wallets that
-	// non-volatile storage can hold and checks that they can all create
-	// addresses independently.
-	returned_num_wallets = getNumberOfWallets();
-	address_buffer = (uint8_t *)malloc(returned_num_wallets * 20);
-	for (i = 0; i < (int)returned_num_wallets; i++)
+	deleteWallet(0);
+	newWallet(0, name, false, NULL, false, NULL, 0);
+	makeNewAddress(address2, &public_key);
+	if (isOwnAddress(address1))
 	{
-		deleteWallet((uint32_t)i);
-		newWallet((uint32_t)i, name, false, NULL, false, NULL, 0);
-		makeNewAddress(&(address_buffer[i * 20]), &public_key);
-		uninitWallet();
+		printf("New wallet recognises old wallet's address\n");
+		reportFailure();
+	}
+	else
+	{
+		reportSuccess();
 	}
+
+	// Check that prederiveAddresses() calculates the next few addresses, one
+	// per call, and that makeNewAddress() and getAddressAndPublicKey() give
+	// the same results with it as without it.
+	uninitWallet();
+	deleteWallet(0);
+	newWallet(0, name, false, NULL, false, NULL, 0);
 	abort = false;
-	for (i = 0; i < (int)returned_num_wallets; i++)
+	for (i = 0; i < WALLET_PREDERIVED_ADDRESSES; i++)
 	{
-		initWallet((uint32_t)i, NULL, 0);
-		getAddressAndPublicKey(compare_address, &public_key, 1);
-		if (memcmp(&(address_buffer[i * 20]), compare_address, 20))
+		prederiveAddresses();
+		if ((findPrederivedAddress((AddressHandle)(i + 1)) == NULL)
+			|| (findPrederivedAddress((AddressHandle)(i + 2)) != NULL))
 		{
-			printf("Wallet %d got corrupted\n", i);
-			reportFailure();
+			printf("Address handle %u not prederived in order\n", (unsigned int)(i + 1));
 			abort = true;
-			break;
 		}
-		uninitWallet();
 	}
-	if (!abort)
+	prederiveAddresses(); // should do nothing
+	if (findPrederivedAddress(WALLET_PREDERIVED_ADDRESSES + 1) != NULL)
 	{
-		reportSuccess();
+		printf("Too many addresses prederived\n");
+		abort = true;
 	}
-
-	// Check that addresses from each wallet are unique.
-	abort_duplicate = false;
-	for (i = 0; i < (int)returned_num_wallets; i++)
+	for (i = 0; i < MAX_TESTING_ADDRESSES; i++)
 	{
-		for (j = 0; j < i; j++)
+		ah = makeNewAddress(address1, &public_key);
+		getAddressesAndPublicKeys(compare_address, &compare_public_key, ah, 1);
+		getAddressAndPublicKey(address2, &public_key2, ah);
+		if (memcmp(address1, compare_address, 20) || memcmp(&public_key, &compare_public_key, sizeof(PointAffine))
+			|| memcmp(address2, compare_address, 20) || memcmp(&public_key2, &compare_public_key, sizeof(PointAffine)))
 		{
-			if (!memcmp(&(address_buffer[i * 20]), &(address_buffer[j * 20]), 20))
-			{
-				printf("Different wallets generate the same addresses\n");
-				abort_duplicate = true;
-				reportFailure();
-				break;
-			}
+			printf("Prederived address for handle %u is wrong\n", (unsigned int)ah);
+			abort = true;
 		}
-		if (abort_duplicate)
+		prederiveAddresses();
+	}
+	if (abort)
+	{
+		reportFailure();
+	}
+	else
+	{
+		reportSuccess();
+	}
+	// Unloading the wallet should forget every prederived address, and
+	// nothing should be prederived while no wallet is loaded.
+	uninitWallet();
+	prederiveAddresses();
+	abort = false;
+	for (ah = 1; ah <= (MAX_TESTING_ADDRESSES + WALLET_PREDERIVED_ADDRESSES); ah++)
+	{
+		if (findPrederivedAddress(ah) != NULL)
 		{
-			break;
+			abort = true;
 		}
 	}
-	if (!abort_duplicate)
+	if (abort)
+	{
+		printf("Prederived addresses not cleared by uninitWallet()\n");
+		reportFailure();
+	}
+	else
 	{
 		reportSuccess();
 	}
-	free(address_buffer);
+	initWallet(0, NULL, 0);
 
-	// Clear NV storage, then create a new hidden wallet.
-	sanitiseEverything();
-	nonVolatileRead((uint8_t *)&unencrypted_part, PARTITION_ACCOUNTS, 0, sizeof(unencrypted_part));
-	memcpy(name, "This will be ignored                    ", NAME_LENGTH);
-	if (newWallet(0, name, false, NULL, true, test_password0, sizeof(test_password0)) != WALLET_NO_ERROR)
+	// Check that makeNewAddress() only writes the wallet record when it runs
+	// out of reserved address handles, and that reserved handles are never
+	// reused after the wallet is reloaded.
+	uninitWallet();
+	deleteWallet(0);
+	newWallet(0, name, false, NULL, false, NULL, 0);
+	abort = false;
+	for (i = 0; i < MAX_TESTING_ADDRESSES; i++)
+	{
+		minimum_address_written[PARTITION_ACCOUNTS] = 0xffffffff;
+		maximum_address_written[PARTITION_ACCOUNTS] = 0;
+		ah = makeNewAddress(address1, &public_key);
+		if ((minimum_address_written[PARTITION_ACCOUNTS] < (wallet_nv_address + sizeof(WalletRecord)))
+			&& (maximum_address_written[PARTITION_ACCOUNTS] >= wallet_nv_address))
+		{
+			found = true; // wallet record was written
+		}
+		else
+		{
+			found = false;
+		}
+		if ((ah != (AddressHandle)(i + 1)) || (found != ((i % ADDRESS_RESERVATION_BLOCK) == 0)))
+		{
+			printf("Address handle %u reserved incorrectly\n", (unsigned int)(i + 1));
+			abort = true;
+			break;
+		}
+	}
+	if (abort)
 	{
-		printf("Couldn't create new hidden wallet\n");
 		reportFailure();
 	}
 	else
 	{
 		reportSuccess();
 	}
-
-	// Check that the hidden wallet can function as a wallet by creating an
-	// address.
-	if (makeNewAddress(address1, &public_key) == BAD_ADDRESS_HANDLE)
+	uninitWallet();
+	deleteWallet(0);
+	newWallet(0, name, false, NULL, false, NULL, 0);
+	makeNewAddress(address1, &public_key);
+	uninitWallet();
+	initWallet(0, NULL, 0);
+	if ((getNumAddresses() == ADDRESS_RESERVATION_BLOCK)
+		&& (makeNewAddress(address1, &public_key) == (ADDRESS_RESERVATION_BLOCK + 1)))
 	{
-		printf("Couldn't create new address in hidden wallet\n");
-		reportFailure();
+		reportSuccess();
 	}
 	else
 	{
-		reportSuccess();
+		printf("Reserved address handles not skipped after reload\n");
+		reportFailure();
 	}
-	uninitWallet();
 
-	// Check that unencrypted part (which contains name/version) wasn't
-	// touched.
-	nonVolatileRead((uint8_t *)&compare_unencrypted_part, PARTITION_ACCOUNTS, 0, sizeof(compare_unencrypted_part));
-	if (memcmp(&unencrypted_part, &compare_unencrypted_part, sizeof(unencrypted_part)))
+	// Reserving address handles should only write the counter block. The
+	// next address is put in the address index and change filter
+	// beforehand, so that makeNewAddress() doesn't need to write anything
+	// else for it.
+	for (i = 1; i < ADDRESS_RESERVATION_BLOCK; i++)
 	{
-		printf("Creation of hidden wallet writes to unencrypted portion of wallet storage\n");
-		reportFailure();
+		makeNewAddress(address1, &public_key);
 	}
-	else
+	deriveAddressAndPublicKey(address1, &public_key, num_addresses_issued + 1);
+	writeIndexEntry(address1, &public_key, num_addresses_issued + 1);
+	addToChangeFilter(address1, num_addresses_issued + 1);
+	minimum_address_written[PARTITION_ACCOUNTS] = 0xffffffff;
+	maximum_address_written[PARTITION_ACCOUNTS] = 0;
+	makeNewAddress(address1, &public_key);
+	if ((minimum_address_written[PARTITION_ACCOUNTS] == (wallet_nv_address + offsetof(WalletRecord, encrypted)))
+		&& (maximum_address_written[PARTITION_ACCOUNTS] == (wallet_nv_address + offsetof(WalletRecord, encrypted) + COUNTER_BLOCK_LENGTH - 1)))
 	{
 		reportSuccess();
 	}
-
-	// Is it possible to load the hidden wallet?
-	uninitWallet();
-	if (initWallet(0, test_password0, sizeof(test_password0)) != WALLET_NO_ERROR)
+	else
 	{
-		printf("Could not load hidden wallet\n");
+		printf("Reserving address handles writes more than the counter block\n");
 		reportFailure();
 	}
-	else
+
+	// The extras of the last wallet must end within the accounts partition,
+	// and must not run into each other.
+	getNumberOfWallets();
+	if (wallet_extras_enabled
+		&& (getWalletExtrasAddress(num_wallets - 1) + WALLET_EXTRAS_SIZE <= TEST_ACCOUNTS_PARTITION_SIZE)
+		&& (getWalletExtrasAddress(1) - getWalletExtrasAddress(0) == WALLET_EXTRAS_SIZE))
 	{
 		reportSuccess();
 	}
-
-	// It should be possible to change the encryption key of a hidden wallet.
-	if (changeEncryptionKey(new_test_password, sizeof(new_test_password)) != WALLET_NO_ERROR)
+	else
 	{
-		printf("Couldn't change encryption key for hidden wallet\n");
+		printf("Wallet extras don't fit in the accounts partition\n");
 		reportFailure();
 	}
-	else
+
+	// Wallet records in the original format should still load, and should
+	// be converted when they are.
+	num_addresses_reserved = current_wallet.encrypted.num_addresses;
+	current_wallet.encrypted.format = WALLET_FORMAT_ORIGINAL;
+	current_wallet.encrypted.num_addresses_check = 0x5a5aa5a5; // was padding
+	calculateWalletChecksum(current_wallet.encrypted.checksum, WALLET_FORMAT_ORIGINAL);
+	writeCurrentWalletRecord(wallet_nv_address);
+	uninitWallet();
+	if ((initWallet(0, NULL, 0) == WALLET_NO_ERROR)
+		&& (getNumAddresses() == num_addresses_reserved))
 	{
 		reportSuccess();
 	}
-
-	// Check that the unencrypted part (which contains name/version) wasn't
-	// touched.
-	uninitWallet();
-	nonVolatileRead((uint8_t *)&compare_unencrypted_part, PARTITION_ACCOUNTS, 0, sizeof(compare_unencrypted_part));
-	if (memcmp(&unencrypted_part, &compare_unencrypted_part, sizeof(unencrypted_part)))
+	else
 	{
-		printf("Key change on hidden wallet results in writes to unencrypted portion of wallet storage\n");
+		printf("Can't load wallet record in original format\n");
 		reportFailure();
 	}
-	else
+	readWalletRecord(&wallet_record, wallet_nv_address);
+	if ((wallet_record.encrypted.format == WALLET_FORMAT_SEPARATE_COUNTER)
+		&& (wallet_record.encrypted.num_addresses == num_addresses_reserved)
+		&& (wallet_record.encrypted.num_addresses_check == ~num_addresses_reserved))
 	{
 		reportSuccess();
 	}
-
-	// The hidden wallet should be loadable with the new key but not the old.
-	uninitWallet();
-	if (initWallet(0, new_test_password, sizeof(new_test_password)) != WALLET_NO_ERROR)
+	else
 	{
-		printf("Could not load hidden wallet after encryption key change\n");
+		printf("Wallet record in original format not converted\n");
 		reportFailure();
 	}
-	else
+	// An unknown format shouldn't load, even with a valid checksum.
+	current_wallet.encrypted.format = 2;
+	calculateWalletChecksum(current_wallet.encrypted.checksum, WALLET_FORMAT_SEPARATE_COUNTER);
+	writeCurrentWalletRecord(wallet_nv_address);
+	if (initWallet(0, NULL, 0) == WALLET_NOT_THERE)
 	{
 		reportSuccess();
 	}
-	uninitWallet();
-	if (initWallet(0, test_password0, sizeof(test_password0)) != WALLET_NOT_THERE)
+	else
 	{
-		printf("Could load hidden wallet with old encryption key\n");
+		printf("Wallet record in unknown format loads\n");
 		reportFailure();
 	}
-	else
+
+	// Check that switching between encrypted wallets resumes where each one
+	// left off, which only happens if it stayed unlocked.
+	uninitWallet();
+	deleteWallet(0);
+	deleteWallet(1);
+	newWallet(0, name, false, NULL, false, test_password0, sizeof(test_password0));
+	makeNewAddress(address1, &public_key);
+	newWallet(1, name2, false, NULL, false, test_password1, sizeof(test_password1));
+	makeNewAddress(address2, &public_key);
+	initWallet(0, test_password0, sizeof(test_password0));
+	ah = makeNewAddress(address1, &public_key);
+	initWallet(1, test_password1, sizeof(test_password1));
+	ah2 = makeNewAddress(address2, &public_key);
+	if ((ah == 2) && (ah2 == 2))
 	{
 		reportSuccess();
 	}
-
-	// Change key to all 00s (representing an "unencrypted" wallet) and do
-	// the above key change tests.
-	initWallet(0, new_test_password, sizeof(new_test_password));
-	if (changeEncryptionKey(NULL, 0) != WALLET_NO_ERROR)
+	else
 	{
-		printf("Couldn't change encryption key for hidden wallet 2\n");
+		printf("Switching wallets doesn't keep them unlocked\n");
 		reportFailure();
 	}
-	else
+	// Locking should force a fresh load, which skips reserved handles.
+	lockAllWallets();
+	if ((getNumAddresses() == 0) && (walletGetLastError() == WALLET_NOT_LOADED))
 	{
 		reportSuccess();
 	}
-	uninitWallet();
-	nonVolatileRead((uint8_t *)&compare_unencrypted_part, PARTITION_ACCOUNTS, 0, sizeof(compare_unencrypted_part));
-	if (memcmp(&unencrypted_part, &compare_unencrypted_part, sizeof(unencrypted_part)))
+	else
 	{
-		printf("Key change on hidden wallet results in writes to unencrypted portion of wallet storage 2\n");
+		printf("lockAllWallets() doesn't unload wallet\n");
 		reportFailure();
 	}
-	else
+	initWallet(0, test_password0, sizeof(test_password0));
+	if (makeNewAddress(address1, &public_key) == (ADDRESS_RESERVATION_BLOCK + 1))
 	{
 		reportSuccess();
 	}
-	uninitWallet();
-	if (initWallet(0, NULL, 0) != WALLET_NO_ERROR)
+	else
 	{
-		printf("Could not load hidden wallet after encryption key change 2\n");
+		printf("lockAllWallets() doesn't lock wallets\n");
 		reportFailure();
 	}
-	else
+	// A wrong password must not match an unlocked wallet.
+	if (initWallet(0, test_password1, sizeof(test_password1)) == WALLET_NOT_THERE)
 	{
 		reportSuccess();
 	}
-	uninitWallet();
-	if (initWallet(0, new_test_password, sizeof(new_test_password)) != WALLET_NOT_THERE)
+	else
 	{
-		printf("Could load hidden wallet with old encryption key 2\n");
+		printf("Unlocked wallet loaded with wrong password\n");
 		reportFailure();
 	}
-	else
+	// After changing the password, only the new one should work.
+	initWallet(0, test_password0, sizeof(test_password0));
+	changeEncryptionKey(new_test_password, sizeof(new_test_password));
+	initWallet(1, test_password1, sizeof(test_password1));
+	if ((initWallet(0, test_password0, sizeof(test_password0)) == WALLET_NOT_THERE)
+		&& (initWallet(0, new_test_password, sizeof(new_test_password)) == WALLET_NO_ERROR))
 	{
 		reportSuccess();
 	}
-
-	// Wallet name changes on a hidden wallet should be disallowed.
-	initWallet(0, NULL, 0);
-	memcpy(name2, "This will also be ignored               ", NAME_LENGTH);
-	if (changeWalletName(name2) != WALLET_INVALID_OPERATION)
+	else
 	{
-		printf("Wallet name change is allowed on a hidden wallet\n");
+		printf("Unlocked wallet not updated by changeEncryptionKey()\n");
 		reportFailure();
 	}
-	else
+	// Replacing a wallet must not leave the old one unlocked.
+	getAddressAndPublicKey(address1, &public_key, 1);
+	deleteWallet(0);
+	newWallet(0, name, false, NULL, false, new_test_password, sizeof(new_test_password));
+	makeNewAddress(address2, &public_key);
+	initWallet(1, test_password1, sizeof(test_password1));
+	initWallet(0, new_test_password, sizeof(new_test_password));
+	getAddressAndPublicKey(compare_address, &public_key, 1);
+	if (memcmp(address1, compare_address, 20) && !memcmp(address2, compare_address, 20))
 	{
 		reportSuccess();
 	}
-
-	// Check that the wallet is still intact by getting the previously
-	// generated address from it.
-	initWallet(0, NULL, 0);
-	if (getAddressAndPublicKey(address2, &public_key, 1) != WALLET_NO_ERROR)
+	else
 	{
-		printf("Couldn't get address from hidden wallet\n");
+		printf("Replaced wallet still unlocked\n");
 		reportFailure();
 	}
-	else
+	changeEncryptionKey(NULL, 0);
+	uninitWallet();
+
+#ifdef ENABLE_KEEP_UNLOCKED
+	// Check that only wallets which are allowed to stay unlocked across
+	// sessions survive the end of a session.
+	deleteWallet(0);
+	deleteWallet(1);
+	newWallet(0, name, false, NULL, false, test_password0, sizeof(test_password0));
+	if (setWalletKeepUnlocked(true) == WALLET_NO_ERROR)
 	{
 		reportSuccess();
 	}
-	if (memcmp(address1, address2, 20))
+	else
 	{
-		printf("Addresses in hidden wallet are getting mangled\n");
+		printf("Couldn't allow wallet to stay unlocked\n");
 		reportFailure();
 	}
-	else
+	makeNewAddress(address1, &public_key);
+	newWallet(1, name2, false, NULL, false, test_password1, sizeof(test_password1));
+	makeNewAddress(address2, &public_key);
+	endWalletSession();
+	if ((getNumAddresses() == 0) && (walletGetLastError() == WALLET_NOT_LOADED))
 	{
 		reportSuccess();
 	}
-
-	// Create a non-hidden wallet, then overwrite it with a hidden wallet.
-	// The resulting version field should still be VERSION_NOTHING_THERE.
-	uninitWallet();
-	deleteWallet(0);
-	newWallet(0, name, false, NULL, false, NULL, 0);
-	deleteWallet(0);
-	newWallet(0, name, false, NULL, true, NULL, 0);
-	getWalletInfo(&version, temp, wallet_uuid, 0);
-	if (version != VERSION_NOTHING_THERE)
+	else
 	{
-		printf("Hidden wallet's version field is not VERSION_NOTHING_THERE\n");
+		printf("endWalletSession() doesn't unload wallet\n");
 		reportFailure();
 	}
-	else
+	initWallet(0, test_password0, sizeof(test_password0));
+	ah = makeNewAddress(address1, &public_key);
+	initWallet(1, test_password1, sizeof(test_password1));
+	ah2 = makeNewAddress(address2, &public_key);
+	if ((ah == 2) && (ah2 == (ADDRESS_RESERVATION_BLOCK + 1)))
 	{
 		reportSuccess();
 	}
-
-	// Create two wallets. Their UUIDs should not be the same.
-	uninitWallet();
-	deleteWallet(0);
-	newWallet(0, name, false, NULL, false, NULL, 0);
-	deleteWallet(1);
-	newWallet(1, name, false, NULL, false, NULL, 0);
-	getWalletInfo(&version, temp, wallet_uuid, 0);
-	getWalletInfo(&version, temp, wallet_uuid2, 1);
-	if (!memcmp(wallet_uuid, wallet_uuid2, UUID_LENGTH))
+	else
 	{
-		printf("Wallet UUIDs not unique\n");
+		printf("endWalletSession() locks the wrong wallets\n");
 		reportFailure();
 	}
-	else
+	// The setting is stored in the wallet record, so it should still apply
+	// after the wallet has been locked and unlocked again.
+	lockAllWallets();
+	initWallet(0, test_password0, sizeof(test_password0));
+	ah = makeNewAddress(address1, &public_key);
+	endWalletSession();
+	initWallet(0, test_password0, sizeof(test_password0));
+	if (makeNewAddress(address1, &public_key) == (ah + 1))
 	{
 		reportSuccess();
 	}
-
-	// Overwrite wallet 0. The UUID should change.
-	uninitWallet();
+	else
+	{
+		printf("Stay unlocked setting not stored\n");
+		reportFailure();
+	}
+	// Unlocked wallets should time out, but only once they haven't been
+	// used for KEEP_UNLOCKED_TIMEOUT seconds. In the checks below, a wallet
+	// which was locked is detectable because all of its reserved address
+	// handles count as issued after it is unlocked again. The wallet is
+	// recreated so that the tests don't run out of addresses.
 	deleteWallet(0);
 	newWallet(0, name, false, NULL, false, test_password0, sizeof(test_password0));
-	getWalletInfo(&version, temp, wallet_uuid2, 0);
-	if (!memcmp(wallet_uuid, wallet_uuid2, UUID_LENGTH))
+	setWalletKeepUnlocked(true);
+	makeNewAddress(address1, &public_key);
+	ah = getNumAddresses();
+	uninitWallet();
+	fake_seconds_counter += KEEP_UNLOCKED_TIMEOUT - 1;
+	expireWalletContexts();
+	initWallet(0, test_password0, sizeof(test_password0));
+	ah2 = getNumAddresses();
+	uninitWallet();
+	fake_seconds_counter += KEEP_UNLOCKED_TIMEOUT;
+	endWalletSession();
+	initWallet(0, test_password0, sizeof(test_password0));
+	if ((ah2 == ah) && (getNumAddresses() > ah))
 	{
-		printf("Wallet UUIDs aren't changing on overwrite\n");
-		reportFailure();
+		reportSuccess();
 	}
 	else
 	{
-		reportSuccess();
+		printf("Unlocked wallet timeout doesn't work\n");
+		reportFailure();
 	}
-
-	// Perform a few operations on the wallet. The wallet UUID shouldn't change.
+	// The loaded wallet should never time out.
+	makeNewAddress(address1, &public_key);
+	fake_seconds_counter += KEEP_UNLOCKED_TIMEOUT;
+	expireWalletContexts();
+	ah = getNumAddresses();
 	uninitWallet();
-	getWalletInfo(&version, temp, wallet_uuid, 0);
 	initWallet(0, test_password0, sizeof(test_password0));
-	changeEncryptionKey(NULL, 0);
+	if (getNumAddresses() == ah)
+	{
+		reportSuccess();
+	}
+	else
+	{
+		printf("Loaded wallet timed out\n");
+		reportFailure();
+	}
+	// The timeout should hold even if nothing calls expireWalletContexts().
 	makeNewAddress(address1, &public_key);
-	changeWalletName(name2);
+	ah = getNumAddresses();
 	uninitWallet();
-	initWallet(0, NULL, 0);
-	getWalletInfo(&version, temp, wallet_uuid2, 0);
-	if (memcmp(wallet_uuid, wallet_uuid2, UUID_LENGTH))
+	fake_seconds_counter += KEEP_UNLOCKED_TIMEOUT;
+	initWallet(0, test_password0, sizeof(test_password0));
+	if (getNumAddresses() > ah)
 	{
-		printf("Wallet UUIDs changing when the wallet is used\n");
-		reportFailure();
+		reportSuccess();
 	}
 	else
+	{
+		printf("Timed out wallet unlocked without key derivation\n");
+		reportFailure();
+	}
+	// An explicit lock should lock everything.
+	lockAllWallets();
+	initWallet(0, test_password0, sizeof(test_password0));
+	if (getNumAddresses() > ah)
 	{
 		reportSuccess();
 	}
-
-	// Check that getMasterPublicKey() works.
-	uninitWallet();
-	deleteWallet(0);
-	newWallet(0, name, false, NULL, false, NULL, 0);
-	initWallet(0, NULL, 0);
-	if (getMasterPublicKey(&master_public_key, chain_code) != WALLET_NO_ERROR)
+	else
 	{
-		printf("getMasterPublicKey() fails in the simplest case\n");
+		printf("lockAllWallets() doesn't lock wallets which stay unlocked\n");
 		reportFailure();
 	}
-	else
+	// Unencrypted wallets are never locked, so the setting makes no sense
+	// for them.
+	changeEncryptionKey(NULL, 0);
+	if (setWalletKeepUnlocked(true) == WALLET_INVALID_OPERATION)
 	{
 		reportSuccess();
 	}
-
-	// Check that wallet public keys can be derived from the public key and
-	// chain code that getMasterPublicKey() returned.
-	generateDeterministicPublicKey(&public_key, &master_public_key, chain_code, 1);
-	makeNewAddress(address1, &compare_public_key);
-	if (memcmp(&public_key, &compare_public_key, sizeof(PointAffine)))
+	else
 	{
-		printf("Address 1 can't be derived from master public key\n");
+		printf("Unencrypted wallet allowed to stay unlocked\n");
 		reportFailure();
 	}
+	uninitWallet();
+	if (setWalletKeepUnlocked(true) == WALLET_NOT_LOADED)
+	{
+		reportSuccess();
+	}
 	else
+	{
+		printf("setWalletKeepUnlocked() works with no wallet loaded\n");
+		reportFailure();
+	}
+#endif // #ifdef ENABLE_KEEP_UNLOCKED
+
+	// Check that a stored number of PBKDF2 iterations is only used if it's
+	// valid.
+	writeU32LittleEndian(copy_of_nv, 256);
+	writeU32LittleEndian(&(copy_of_nv[4]), ~(uint32_t)256);
+	nonVolatileWrite(copy_of_nv, PARTITION_GLOBAL, ADDRESS_PBKDF2_ITERATIONS, 8);
+	if (getKeyDerivationIterations() == 256)
 	{
 		reportSuccess();
 	}
-	generateDeterministicPublicKey(&public_key, &master_public_key, chain_code, 2);
-	makeNewAddress(address1, &compare_public_key);
-	if (memcmp(&public_key, &compare_public_key, sizeof(PointAffine)))
+	else
 	{
-		printf("Address 2 can't be derived from master public key\n");
+		printf("Stored number of PBKDF2 iterations not used\n");
 		reportFailure();
 	}
+	copy_of_nv[4] ^= 1;
+	nonVolatileWrite(copy_of_nv, PARTITION_GLOBAL, ADDRESS_PBKDF2_ITERATIONS, 8);
+	if (getKeyDerivationIterations() == getPBKDF2Iterations())
+	{
+		reportSuccess();
+	}
 	else
+	{
+		printf("Corrupted number of PBKDF2 iterations used\n");
+		reportFailure();
+	}
+	writeU32LittleEndian(copy_of_nv, 257);
+	writeU32LittleEndian(&(copy_of_nv[4]), ~(uint32_t)257);
+	nonVolatileWrite(copy_of_nv, PARTITION_GLOBAL, ADDRESS_PBKDF2_ITERATIONS, 8);
+	if (getKeyDerivationIterations() == getPBKDF2Iterations())
 	{
 		reportSuccess();
 	}
+	else
+	{
+		printf("Number of PBKDF2 iterations which isn't a power of 2 used\n");
+		reportFailure();
+	}
+	memset(copy_of_nv, 0, 8);
+	nonVolatileWrite(copy_of_nv, PARTITION_GLOBAL, ADDRESS_PBKDF2_ITERATIONS, 8);
 
 	// Check that sanitisePartition() only affects one partition.
 	suppress_set_entropy_pool = true; // avoid spurious writes to global partition
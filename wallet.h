@@ -68,7 +68,8 @@ typedef enum WalletErrorsEnum
 	WALLET_NOT_LOADED			=	7,
 	/** Invalid address handle. */
 	WALLET_INVALID_HANDLE		=	8,
-	/** Backup seed could not be written to specified device. */
+	/** Backup seed could not be written to specified device, or a backup
+	  * which was to be restored is corrupt. */
 	WALLET_BACKUP_ERROR			=	9,
 	/** Problem with random number generation system. */
 	WALLET_RNG_FAILURE			=	10,
@@ -79,25 +80,41 @@ typedef enum WalletErrorsEnum
 	/** A wallet already exists at the specified location. */
 	WALLET_ALREADY_EXISTS		=	13,
 	/** Bad non-volatile storage address or partition number. */
-	WALLET_BAD_ADDRESS			=	14
+	WALLET_BAD_ADDRESS			=	14,
+	/** The host cancelled the operation (see longOperationYield()). */
+	WALLET_CANCELLED			=	15
 } WalletErrors;
 
 extern WalletErrors walletGetLastError(void);
 extern WalletErrors initWallet(uint32_t wallet_spec, const uint8_t *password, const unsigned int password_length);
 extern WalletErrors uninitWallet(void);
+extern WalletErrors lockAllWallets(void);
+extern WalletErrors endWalletSession(void);
+#ifdef ENABLE_KEEP_UNLOCKED
+extern void expireWalletContexts(void);
+#endif // #ifdef ENABLE_KEEP_UNLOCKED
 extern WalletErrors sanitiseEverything(void);
+extern WalletErrors calibrateKeyDerivation(void);
 extern WalletErrors deleteWallet(uint32_t wallet_spec);
 extern WalletErrors newWallet(uint32_t wallet_spec, uint8_t *name, bool use_seed, uint8_t *seed, bool make_hidden, const uint8_t *password, const unsigned int password_length);
+extern WalletErrors restoreWalletBackup(uint32_t wallet_spec, uint8_t *name, const uint8_t *uuid, uint8_t *encrypted_seed, const uint8_t *digest, const uint8_t *password, const unsigned int password_length);
 extern AddressHandle makeNewAddress(uint8_t *out_address, PointAffine *out_public_key);
+extern void prederiveAddresses(void);
 extern WalletErrors getAddressAndPublicKey(uint8_t *out_address, PointAffine *out_public_key, AddressHandle ah);
+extern WalletErrors getAddressesAndPublicKeys(uint8_t *out_addresses, PointAffine *out_public_keys, AddressHandle start_ah, uint8_t count);
 extern WalletErrors getMasterPublicKey(PointAffine *out_public_key, uint8_t *out_chain_code);
+extern WalletErrors getExtendedPublicKey(uint8_t *out, const uint32_t *path, const unsigned int path_length);
 extern uint32_t getNumAddresses(void);
+extern bool isOwnAddress(const uint8_t *address);
 extern WalletErrors getPrivateKey(uint8_t *out, AddressHandle ah);
 extern WalletErrors changeEncryptionKey(const uint8_t *password, const unsigned int password_length);
 extern WalletErrors changeWalletName(uint8_t *new_name);
+extern WalletErrors setWalletKeepUnlocked(bool keep_unlocked);
 extern WalletErrors getWalletInfo(uint32_t *out_version, uint8_t *out_name, uint8_t *out_uuid, uint32_t wallet_spec);
 extern WalletErrors backupWallet(bool do_encrypt, uint32_t destination_device);
+extern WalletErrors exportWalletBackup(uint8_t *out_uuid, uint8_t *out_encrypted_seed, uint8_t *out_digest);
 extern uint32_t getNumberOfWallets(void);
+extern uint32_t getWalletListGeneration(void);
 
 #ifdef TEST
 extern void initWalletTest(void);
@@ -24,6 +24,10 @@
   * This file is licensed as described by the file LICENCE.
   */
 
+#ifdef TEST
+#include <assert.h>
+#endif // #ifdef TEST
+
 #ifdef TEST_XEX
 #include <stdlib.h>
 #include <stdio.h>
@@ -32,6 +36,11 @@
 #include "wallet.h"
 #endif // #ifdef TEST_XEX
 
+#ifdef BENCH_XEX
+#include <stdlib.h>
+#include "test_helpers.h"
+#endif // #ifdef BENCH_XEX
+
 #include "common.h"
 #include "aes.h"
 #include "prandom.h"
@@ -39,10 +48,20 @@
 #include "endian.h"
 
 /** Primary encryption key. */
-static uint8_t nv_storage_encrypt_key[16];
+static THREAD_LOCAL uint8_t nv_storage_encrypt_key[16];
 /** The tweak key can be considered as a secondary, independent encryption
   * key. */
-static uint8_t nv_storage_tweak_key[16];
+static THREAD_LOCAL uint8_t nv_storage_tweak_key[16];
+/** Expanded version of #nv_storage_encrypt_key. This is only valid if
+  * #are_keys_expanded is true. */
+static THREAD_LOCAL uint8_t expanded_encrypt_key[EXPANDED_KEY_SIZE];
+/** Expanded version of #nv_storage_tweak_key. This is only valid if
+  * #are_keys_expanded is true. */
+static THREAD_LOCAL uint8_t expanded_tweak_key[EXPANDED_KEY_SIZE];
+/** Whether #expanded_encrypt_key and #expanded_tweak_key are up to date. The
+  * key schedules are computed on first use after every key change, so that
+  * the expansion is done once per key change instead of once per block. */
+static THREAD_LOCAL bool are_keys_expanded;
 
 /** Double a 128 bit integer under GF(2 ^ 128) with
   * reducing polynomial x ^ 128 + x ^ 7 + x ^ 2 + x + 1.
@@ -85,27 +104,24 @@ static void doubleInGF(uint8_t *op1)
   */
 static void xexEnDecrypt(uint8_t *out, uint8_t *in, uint8_t *n, uint8_t seq, uint8_t *tweak_key, uint8_t *encrypt_key, bool is_decrypt)
 {
-	uint8_t expanded_key[EXPANDED_KEY_SIZE];
 	uint8_t delta[16];
 	uint8_t buffer[16];
 	uint8_t i;
 
-	aesExpandKey(expanded_key, tweak_key);
-	aesEncrypt(delta, n, expanded_key);
+	aesEncrypt(delta, n, tweak_key);
 	for (i = 0; i < seq; i++)
 	{
 		doubleInGF(delta);
 	}
 	memcpy(buffer, in, 16);
 	xor16Bytes(buffer, delta);
-	aesExpandKey(expanded_key, encrypt_key);
 	if (is_decrypt)
 	{
-		aesDecrypt(out, buffer, expanded_key);
+		aesDecrypt(out, buffer, encrypt_key);
 	}
 	else
 	{
-		aesEncrypt(out, buffer, expanded_key);
+		aesEncrypt(out, buffer, encrypt_key);
 	}
 	xor16Bytes(out, delta);
 }
@@ -123,8 +139,9 @@ static void xexEnDecrypt(uint8_t *out, uint8_t *in, uint8_t *n, uint8_t seq, uin
   *          tweakable parameters.
   * \param seq Specifies the block within the data unit. This is the other
   *            tweakable parameter.
-  * \param tweak_key A 128 bit AES key.
-  * \param encrypt_key Another 128 bit AES key. This must be independent of
+  * \param tweak_key A 128 bit AES key, expanded using aesExpandKey().
+  * \param encrypt_key Another 128 bit AES key, expanded using
+  *                    aesExpandKey(). This must be independent of
   *                    tweak_key.
   * \warning Don't use seq = 0, as this presents a security
   *          vulnerability (albeit a convoluted one). For more details about
@@ -152,6 +169,18 @@ static void xexDecryptInternal(uint8_t *out, uint8_t *in, uint8_t *n, uint8_t se
 	xexEnDecrypt(out, in, n, seq, tweak_key, encrypt_key, true);
 }
 
+/** Make sure that #expanded_encrypt_key and #expanded_tweak_key are
+  * expanded versions of the current keys. */
+static void expandKeysIfNecessary(void)
+{
+	if (!are_keys_expanded)
+	{
+		aesExpandKey(expanded_encrypt_key, nv_storage_encrypt_key);
+		aesExpandKey(expanded_tweak_key, nv_storage_tweak_key);
+		are_keys_expanded = true;
+	}
+}
+
 /** Encrypt one 16 byte block using AES in XEX mode. This uses the encryption
   * key set by setEncryptionKey().
   * \param out The resulting ciphertext will be written to here. This must be
@@ -163,7 +192,8 @@ static void xexDecryptInternal(uint8_t *out, uint8_t *in, uint8_t *n, uint8_t se
   */
 void xexEncrypt(uint8_t *out, uint8_t *in, uint8_t *n, uint8_t seq)
 {
-	xexEncryptInternal(out, in, n, seq, nv_storage_tweak_key, nv_storage_encrypt_key);
+	expandKeysIfNecessary();
+	xexEncryptInternal(out, in, n, seq, expanded_tweak_key, expanded_encrypt_key);
 }
 
 /** Decrypt the 16 byte block using AES in XEX mode. This uses the encryption
@@ -177,7 +207,8 @@ void xexEncrypt(uint8_t *out, uint8_t *in, uint8_t *n, uint8_t seq)
   */
 void xexDecrypt(uint8_t *out, uint8_t *in, uint8_t *n, uint8_t seq)
 {
-	xexDecryptInternal(out, in, n, seq, nv_storage_tweak_key, nv_storage_encrypt_key);
+	expandKeysIfNecessary();
+	xexDecryptInternal(out, in, n, seq, expanded_tweak_key, expanded_encrypt_key);
 }
 
 /** Set the combined encryption key.
@@ -190,6 +221,7 @@ void setEncryptionKey(const uint8_t *in)
 {
 	memcpy(nv_storage_encrypt_key, in, 16);
 	memcpy(nv_storage_tweak_key, &(in[16]), 16);
+	are_keys_expanded = false;
 }
 
 /** Get the combined encryption key.
@@ -241,12 +273,79 @@ void clearEncryptionKey(void)
 	memset(nv_storage_encrypt_key, 0xff, 16);
 	memset(nv_storage_tweak_key, 0, 16);
 	memset(nv_storage_encrypt_key, 0, 16);
+	memset(expanded_tweak_key, 0xff, EXPANDED_KEY_SIZE);
+	memset(expanded_encrypt_key, 0xff, EXPANDED_KEY_SIZE);
+	memset(expanded_tweak_key, 0, EXPANDED_KEY_SIZE);
+	memset(expanded_encrypt_key, 0, EXPANDED_KEY_SIZE);
+	are_keys_expanded = false;
+}
+
+/** Number of 16 byte blocks which encryptedNonVolatileWrite() and
+  * encryptedNonVolatileRead() will process with each call to
+  * nonVolatileRead() or nonVolatileWrite(). Larger values mean fewer
+  * calls to the non-volatile storage interface, at the expense of stack
+  * space (32 bytes per block). */
+#ifndef XEX_CHUNK_BLOCKS
+#define XEX_CHUNK_BLOCKS	4
+#endif // #ifndef XEX_CHUNK_BLOCKS
+
+/** Encrypt or decrypt, in place, a run of consecutive 16 byte blocks from
+  * non-volatile storage. Each block is its own data unit (n is the address
+  * of the block and seq is 1), exactly as if xexEncrypt() or xexDecrypt()
+  * were called on each block individually.
+  * \param buffer The blocks to encrypt or decrypt. This must be a byte array
+  *               of length 16 * num_blocks.
+  * \param address The address in non-volatile storage of the first block.
+  *                This must be a multiple of 16.
+  * \param num_blocks The number of blocks to process. This must not be
+  *                   larger than #XEX_CHUNK_BLOCKS.
+  * \param is_decrypt To decrypt, use true. To encrypt, use false.
+  */
+static void xexEnDecryptChunk(uint8_t *buffer, uint32_t address, uint8_t num_blocks, bool is_decrypt)
+{
+	uint8_t delta[XEX_CHUNK_BLOCKS][16];
+	uint8_t n[16];
+	uint8_t temp[16];
+	uint8_t *block;
+	uint8_t i;
+
+#ifdef TEST
+	assert(num_blocks <= XEX_CHUNK_BLOCKS);
+	assert((address & 0x0000000f) == 0);
+#endif // #ifdef TEST
+	expandKeysIfNecessary();
+	memset(n, 0, 16);
+	for (i = 0; i < num_blocks; i++)
+	{
+		writeU32LittleEndian(n, address + 16 * (uint32_t)i);
+		aesEncrypt(delta[i], n, expanded_tweak_key);
+		doubleInGF(delta[i]); // seq = 1
+	}
+	for (i = 0; i < num_blocks; i++)
+	{
+		block = &(buffer[16 * i]);
+		xor16Bytes(block, delta[i]);
+		if (is_decrypt)
+		{
+			aesDecrypt(temp, block, expanded_encrypt_key);
+		}
+		else
+		{
+			aesEncrypt(temp, block, expanded_encrypt_key);
+		}
+		memcpy(block, temp, 16);
+		xor16Bytes(block, delta[i]);
+	}
 }
 
 /** Wrapper around nonVolatileWrite() which also encrypts data
   * using xexEncrypt(). Because this uses encryption, it is much slower
   * than nonVolatileWrite(). The parameters and return values are identical
   * to that of nonVolatileWrite().
+  *
+  * Data is processed in chunks of up to #XEX_CHUNK_BLOCKS blocks. Only
+  * blocks which are partially overwritten need to be read and decrypted
+  * first; blocks which are completely overwritten are just encrypted.
   * \param data A pointer to the data to be written.
   * \param partition The partition to write to. Must be one of #NVPartitions.
   * \param address Byte offset specifying where in the partition to
@@ -259,44 +358,78 @@ void clearEncryptionKey(void)
 NonVolatileReturn encryptedNonVolatileWrite(uint8_t *data, NVPartitions partition, uint32_t address, uint32_t length)
 {
 	uint32_t block_start;
-	uint32_t block_end;
+	uint32_t blocks_remaining;
+	uint32_t chunk_length;
+	uint32_t copy_length;
 	uint8_t block_offset;
-	uint8_t ciphertext[16];
-	uint8_t plaintext[16];
-	uint8_t n[16];
+	uint8_t num_blocks;
+	uint8_t last;
+	uint8_t chunk[XEX_CHUNK_BLOCKS * 16];
 	NonVolatileReturn r;
 
-	block_start = address & 0xfffffff0;
-	block_offset = (uint8_t)(address & 0x0000000f);
-	block_end = (address + length - 1) & 0xfffffff0;
 	if ((address + length) < address)
 	{
 		// Overflow occurred.
 		return NV_INVALID_ADDRESS;
 	}
+	if (length == 0)
+	{
+		return NV_NO_ERROR;
+	}
 
-	memset(n, 0, 16);
-	for (; block_start <= block_end; block_start += 16)
+	block_start = address & 0xfffffff0;
+	block_offset = (uint8_t)(address & 0x0000000f);
+	blocks_remaining = ((((address + length - 1) & 0xfffffff0) - block_start) >> 4) + 1;
+	while (blocks_remaining > 0)
 	{
-		r = nonVolatileRead(ciphertext, partition, block_start, 16);
-		if (r != NV_NO_ERROR)
+		if (blocks_remaining > XEX_CHUNK_BLOCKS)
 		{
-			return r;
+			num_blocks = XEX_CHUNK_BLOCKS;
 		}
-		writeU32LittleEndian(n, block_start);
-		xexDecrypt(plaintext, ciphertext, n, 1);
-		while (length && block_offset < 16)
+		else
 		{
-			plaintext[block_offset++] = *data++;
-			length--;
+			num_blocks = (uint8_t)blocks_remaining;
 		}
+		chunk_length = 16 * (uint32_t)num_blocks;
+		copy_length = chunk_length - block_offset;
+		if (copy_length > length)
+		{
+			copy_length = length;
+		}
+		last = (uint8_t)(num_blocks - 1);
+		// Partially overwritten blocks can only occur at the start or end
+		// of a chunk.
+		if ((block_offset != 0) || ((block_offset + copy_length) < chunk_length))
+		{
+			r = nonVolatileRead(chunk, partition, block_start, chunk_length);
+			if (r != NV_NO_ERROR)
+			{
+				return r;
+			}
+			if (block_offset != 0)
+			{
+				xexEnDecryptChunk(chunk, block_start, 1, true);
+			}
+			// If the chunk is only one block long, it may have been
+			// decrypted already.
+			if (((block_offset + copy_length) < chunk_length)
+				&& ((last != 0) || (block_offset == 0)))
+			{
+				xexEnDecryptChunk(&(chunk[16 * last]), block_start + 16 * (uint32_t)last, 1, true);
+			}
+		}
+		memcpy(&(chunk[block_offset]), data, copy_length);
+		data += copy_length;
+		length -= copy_length;
 		block_offset = 0;
-		xexEncrypt(ciphertext, plaintext, n, 1);
-		r = nonVolatileWrite(ciphertext, partition, block_start, 16);
+		xexEnDecryptChunk(chunk, block_start, num_blocks, false);
+		r = nonVolatileWrite(chunk, partition, block_start, chunk_length);
 		if (r != NV_NO_ERROR)
 		{
 			return r;
 		}
+		block_start += chunk_length;
+		blocks_remaining -= num_blocks;
 	}
 
 	return NV_NO_ERROR;
@@ -306,6 +439,8 @@ NonVolatileReturn encryptedNonVolatileWrite(uint8_t *data, NVPartitions partitio
   * using xexDecrypt(). Because this uses encryption, it is much slower
   * than nonVolatileRead(). The parameters and return values are identical
   * to that of nonVolatileRead().
+  *
+  * Data is processed in chunks of up to #XEX_CHUNK_BLOCKS blocks.
   * \param data A pointer to the buffer which will receive the data.
   * \param partition The partition to read from. Must be one of #NVPartitions.
   * \param address Byte offset specifying where in the partition to
@@ -316,38 +451,55 @@ NonVolatileReturn encryptedNonVolatileWrite(uint8_t *data, NVPartitions partitio
 NonVolatileReturn encryptedNonVolatileRead(uint8_t *data, NVPartitions partition, uint32_t address, uint32_t length)
 {
 	uint32_t block_start;
-	uint32_t block_end;
+	uint32_t blocks_remaining;
+	uint32_t chunk_length;
+	uint32_t copy_length;
 	uint8_t block_offset;
-	uint8_t ciphertext[16];
-	uint8_t plaintext[16];
-	uint8_t n[16];
+	uint8_t num_blocks;
+	uint8_t chunk[XEX_CHUNK_BLOCKS * 16];
 	NonVolatileReturn r;
 
-	block_start = address & 0xfffffff0;
-	block_offset = (uint8_t)(address & 0x0000000f);
-	block_end = (address + length - 1) & 0xfffffff0;
 	if ((address + length) < address)
 	{
 		// Overflow occurred.
 		return NV_INVALID_ADDRESS;
 	}
+	if (length == 0)
+	{
+		return NV_NO_ERROR;
+	}
 
-	memset(n, 0, 16);
-	for (; block_start <= block_end; block_start += 16)
+	block_start = address & 0xfffffff0;
+	block_offset = (uint8_t)(address & 0x0000000f);
+	blocks_remaining = ((((address + length - 1) & 0xfffffff0) - block_start) >> 4) + 1;
+	while (blocks_remaining > 0)
 	{
-		r = nonVolatileRead(ciphertext, partition, block_start, 16);
+		if (blocks_remaining > XEX_CHUNK_BLOCKS)
+		{
+			num_blocks = XEX_CHUNK_BLOCKS;
+		}
+		else
+		{
+			num_blocks = (uint8_t)blocks_remaining;
+		}
+		chunk_length = 16 * (uint32_t)num_blocks;
+		r = nonVolatileRead(chunk, partition, block_start, chunk_length);
 		if (r != NV_NO_ERROR)
 		{
 			return r;
 		}
-		writeU32LittleEndian(n, block_start);
-		xexDecrypt(plaintext, ciphertext, n, 1);
-		while (length && block_offset < 16)
+		xexEnDecryptChunk(chunk, block_start, num_blocks, true);
+		copy_length = chunk_length - block_offset;
+		if (copy_length > length)
 		{
-			*data++ = plaintext[block_offset++];
-			length--;
+			copy_length = length;
 		}
+		memcpy(data, &(chunk[block_offset]), copy_length);
+		data += copy_length;
+		length -= copy_length;
 		block_offset = 0;
+		block_start += chunk_length;
+		blocks_remaining -= num_blocks;
 	}
 
 	return NV_NO_ERROR;
@@ -379,6 +531,8 @@ static void scanTestVectors(char *filename, int is_data_unit_seq_number)
 	char buffer[100];
 	uint8_t tweak_key[16];
 	uint8_t encrypt_key[16];
+	uint8_t expanded_tweak[EXPANDED_KEY_SIZE];
+	uint8_t expanded_encrypt[EXPANDED_KEY_SIZE];
 	uint8_t tweak_value[16];
 	uint8_t *plaintext;
 	uint8_t *ciphertext;
@@ -551,12 +705,14 @@ from http://csrc.nist.gov/groups/STM/cavp/#08\n", filename);
 			} // end for (j = 0; j < 2; j++)
 
 			// Do encryption/decryption and compare
+			aesExpandKey(expanded_tweak, tweak_key);
+			aesExpandKey(expanded_encrypt, encrypt_key);
 			test_failed = false;
 			if (is_encrypt)
 			{
 				for (i = 0; i < data_unit_length; i += 16)
 				{
-					xexEncryptInternal(&(compare[i]), &(plaintext[i]), tweak_value, (uint8_t)(i >> 4), tweak_key, encrypt_key);
+					xexEncryptInternal(&(compare[i]), &(plaintext[i]), tweak_value, (uint8_t)(i >> 4), expanded_tweak, expanded_encrypt);
 					if (memcmp(&(compare[i]), &(ciphertext[i]), 16))
 					{
 						test_failed = true;
@@ -568,7 +724,7 @@ from http://csrc.nist.gov/groups/STM/cavp/#08\n", filename);
 			{
 				for (i = 0; i < data_unit_length; i += 16)
 				{
-					xexDecryptInternal(&(compare[i]), &(ciphertext[i]), tweak_value, (uint8_t)(i >> 4), tweak_key, encrypt_key);
+					xexDecryptInternal(&(compare[i]), &(ciphertext[i]), tweak_value, (uint8_t)(i >> 4), expanded_tweak, expanded_encrypt);
 					if (memcmp(&(compare[i]), &(plaintext[i]), 16))
 					{
 						test_failed = true;
@@ -647,6 +803,28 @@ int main(void)
 		}
 	}
 
+	// The chunked implementation must produce exactly the same ciphertext
+	// as encrypting each block individually (with n = address, seq = 1).
+	for (i = 0; i < MAX_ADDRESS; i += 16)
+	{
+		uint8_t n[16];
+		uint8_t ciphertext[16];
+
+		memset(n, 0, 16);
+		writeU32LittleEndian(n, i);
+		nonVolatileRead(ciphertext, PARTITION_ACCOUNTS, i, 16);
+		xexDecrypt(buffer, ciphertext, n, 1);
+		if (memcmp(&(what_storage_should_be[i]), buffer, 16))
+		{
+			printf("Storage format mismatch, address = 0x%08x\n", i);
+			reportFailure();
+		}
+		else
+		{
+			reportSuccess();
+		}
+	}
+
 	// Now read and write randomly, mirroring the reads and writes to the
 	// what_storage_should_be array.
 	for (i = 0; i < NUM_RW_TESTS; i++)
@@ -766,3 +944,38 @@ int main(void)
 }
 
 #endif // #ifdef TEST_XEX
+
+#ifdef BENCH_XEX
+
+/** Block to encrypt/decrypt. */
+static uint8_t bench_block[16];
+/** Nonce/tweak for #bench_block. */
+static uint8_t bench_n[16];
+
+/** Encrypt one block. */
+static void benchXexEncrypt(void)
+{
+	xexEncrypt(bench_block, bench_block, bench_n, 1);
+}
+
+/** Decrypt one block. */
+static void benchXexDecrypt(void)
+{
+	xexDecrypt(bench_block, bench_block, bench_n, 1);
+}
+
+int main(void)
+{
+	uint8_t key[32];
+
+	initBenchmarks(__FILE__);
+	fillWithRandom(key, sizeof(key));
+	fillWithRandom(bench_block, sizeof(bench_block));
+	fillWithRandom(bench_n, sizeof(bench_n));
+	setEncryptionKey(key);
+	runHostBenchmark("xex_encrypt_16", &benchXexEncrypt, 16);
+	runHostBenchmark("xex_decrypt_16", &benchXexDecrypt, 16);
+	exit(0);
+}
+
+#endif // #ifdef BENCH_XEX